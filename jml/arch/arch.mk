@@ -13,6 +13,7 @@ LIBARCH_SOURCES := \
 	environment_static.cc \
 	cpu_info.cc \
 	vm.cc \
+	huge_page_allocator.cc \
 	info.cc \
 	rtti_utils.cc \
 	rt.cc
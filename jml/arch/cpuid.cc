@@ -90,6 +90,13 @@ uint32_t cpuid_flags()
     return cpuid(1).edx;
 }
 
+bool invariant_tsc()
+{
+    if (cpuid(CPUID_EXT_LEVEL).eax < CPUID_EXT_APM_INFO)
+        return false;
+    return cpuid(CPUID_EXT_APM_INFO).edx & (1 << 8);
+}
+
 namespace {
 
 std::string to_ascii(uint32_t x)
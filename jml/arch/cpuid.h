@@ -84,7 +84,13 @@ struct CPU_Info {
             uint32_t xtpr:1;      // 14
             uint32_t res6:3;      // 15, 16, 17
             uint32_t dca:1;       // 18
-            uint32_t res7:14;
+            uint32_t sse41:1;     // 19
+            uint32_t sse42:1;     // 20
+            uint32_t res7:2;      // 21, 22
+            uint32_t popcnt:1;    // 23
+            uint32_t res8:4;      // 24 - 27
+            uint32_t avx:1;       // 28
+            uint32_t res9:3;
         };
         uint32_t standard2;
     };
@@ -156,6 +162,12 @@ JML_ALWAYS_INLINE const CPU_Info & cpu_info()
 }
 
 uint32_t cpuid_flags();
+
+/** Whether the tick counter runs at a constant rate whatever the frequency
+    and sleep state of the cores, in which case it can be used as a clock.
+*/
+bool invariant_tsc();
+
 std::string vendor_id();
 std::string model_id();
 
@@ -0,0 +1,150 @@
+/* huge_page_allocator.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Allocator that puts containers on huge pages.
+*/
+
+#include "huge_page_allocator.h"
+#include "jml/arch/exception.h"
+#include <mutex>
+
+
+using namespace std;
+
+
+namespace ML {
+
+
+/*****************************************************************************/
+/* HUGE PAGE ARENA                                                           */
+/*****************************************************************************/
+
+namespace {
+
+enum {
+    num_linear_classes = 64,     // 16 to 1024 bytes by 16 bytes
+    first_log_class_shift = 11,  // then 2048 bytes and up by doubling
+    num_classes = num_linear_classes + 8
+};
+
+size_t round_to_huge_page(size_t bytes)
+{
+    return (bytes + huge_page_size - 1) & ~(size_t)(huge_page_size - 1);
+}
+
+} // file scope
+
+Huge_Page_Arena::
+Huge_Page_Arena(Huge_Page_Mode mode)
+    : mode_(mode), free_lists_(num_classes),
+      current_(0), current_end_(0), bytes_mapped_(0)
+{
+}
+
+Huge_Page_Arena::
+~Huge_Page_Arena()
+{
+    for (void * chunk: chunks_)
+        huge_page_free(chunk, huge_page_size);
+}
+
+int
+Huge_Page_Arena::
+size_class(size_t bytes)
+{
+    if (bytes <= 16)
+        return 0;
+    if (bytes <= 1024)
+        return (bytes - 1) / 16;
+    if (bytes > max_small_size)
+        throw Exception("Huge_Page_Arena: no size class for %zd bytes", bytes);
+
+    int shift = 64 - __builtin_clzll(bytes - 1);
+    return num_linear_classes + shift - first_log_class_shift;
+}
+
+size_t
+Huge_Page_Arena::
+class_size(int size_class)
+{
+    if (size_class < num_linear_classes)
+        return (size_class + 1) * 16;
+    return size_t(1) << (size_class - num_linear_classes
+                         + first_log_class_shift);
+}
+
+void *
+Huge_Page_Arena::
+allocate(size_t bytes)
+{
+    if (bytes > max_small_size) {
+        void * mem = huge_page_alloc(bytes, mode_);
+        std::lock_guard<Spinlock> guard(lock_);
+        bytes_mapped_ += round_to_huge_page(bytes);
+        return mem;
+    }
+
+    int cls = size_class(bytes);
+    size_t size = class_size(cls);
+
+    std::lock_guard<Spinlock> guard(lock_);
+
+    if (void * mem = free_lists_[cls]) {
+        free_lists_[cls] = *(void **)mem;
+        return mem;
+    }
+
+    if (current_end_ - current_ < (ssize_t)size) {
+        // Hand out the rest of the chunk as the largest blocks that fit
+        // before moving on to a new one
+        while (current_end_ - current_ >= 16) {
+            size_t left = current_end_ - current_;
+            int c = size_class(std::min<size_t>(left, max_small_size));
+            if (class_size(c) > left) --c;
+
+            *(void **)current_ = free_lists_[c];
+            free_lists_[c] = current_;
+            current_ += class_size(c);
+        }
+
+        char * chunk = (char *)huge_page_alloc(huge_page_size, mode_);
+        chunks_.push_back(chunk);
+        bytes_mapped_ += huge_page_size;
+        current_ = chunk;
+        current_end_ = chunk + huge_page_size;
+    }
+
+    void * mem = current_;
+    current_ += size;
+    return mem;
+}
+
+void
+Huge_Page_Arena::
+deallocate(void * mem, size_t bytes)
+{
+    if (!mem) return;
+
+    if (bytes > max_small_size) {
+        huge_page_free(mem, bytes);
+        std::lock_guard<Spinlock> guard(lock_);
+        bytes_mapped_ -= round_to_huge_page(bytes);
+        return;
+    }
+
+    int cls = size_class(bytes);
+
+    std::lock_guard<Spinlock> guard(lock_);
+    *(void **)mem = free_lists_[cls];
+    free_lists_[cls] = mem;
+}
+
+std::shared_ptr<Huge_Page_Arena> huge_page_arena(Huge_Page_Mode mode)
+{
+    if (mode == HP_NONE)
+        return nullptr;
+    return std::make_shared<Huge_Page_Arena>(mode);
+}
+
+} // namespace ML
@@ -0,0 +1,173 @@
+/* huge_page_allocator.h                                           -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Allocator that puts containers on huge pages.
+*/
+
+#ifndef __jml__arch__huge_page_allocator_h__
+#define __jml__arch__huge_page_allocator_h__
+
+#include "jml/arch/vm.h"
+#include "jml/arch/spinlock.h"
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+namespace ML {
+
+
+/*****************************************************************************/
+/* HUGE PAGE ARENA                                                           */
+/*****************************************************************************/
+
+/** Memory pool carved out of huge page backed chunks, for the large and
+    randomly accessed tables whose lookups are dominated by TLB misses.
+
+    Blocks up to max_small_size bytes are rounded up to a size class and
+    come from huge_page_size chunks; freed blocks go on the free list of
+    their class to be reused by the next allocation of that class, and the
+    chunks are only unmapped when the arena is destroyed.  Larger blocks get
+    a mapping of their own.  Thread safe.
+*/
+
+struct Huge_Page_Arena {
+    Huge_Page_Arena(Huge_Page_Mode mode = HP_TRANSPARENT);
+    ~Huge_Page_Arena();
+
+    Huge_Page_Arena(const Huge_Page_Arena & other) = delete;
+    Huge_Page_Arena & operator = (const Huge_Page_Arena & other) = delete;
+
+    void * allocate(size_t bytes);
+    void deallocate(void * mem, size_t bytes);
+
+    Huge_Page_Mode mode() const { return mode_; }
+
+    /** Bytes currently mapped by the arena. */
+    size_t bytes_mapped() const { return bytes_mapped_; }
+
+    enum {
+        max_small_size = 256 * 1024
+    };
+
+    /** Size class of a block of the given size, and the size of the blocks
+        of a class.  Classes go up by 16 bytes up to 1024 bytes and double
+        from there on.
+    */
+    static int size_class(size_t bytes);
+    static size_t class_size(int size_class);
+
+private:
+    Huge_Page_Mode mode_;
+    Spinlock lock_;
+
+    std::vector<void *> free_lists_;           // intrusive, per class
+    char * current_;                           // rest of the last chunk
+    char * current_end_;
+    std::vector<void *> chunks_;
+    size_t bytes_mapped_;
+};
+
+
+/*****************************************************************************/
+/* HUGE PAGE ALLOCATOR                                                       */
+/*****************************************************************************/
+
+/** STL allocator that allocates from a Huge_Page_Arena, which it shares
+    with its copies.  Without an arena it uses operator new, so that a
+    container can take one whether or not huge pages are turned on.
+
+    The allocator goes along with the contents when a container is assigned
+    or swapped, so that an empty container can be switched over to an
+    arena by assigning it an empty container that has one.
+*/
+
+template<typename T>
+struct Huge_Page_Allocator {
+    typedef T value_type;
+    typedef T * pointer;
+    typedef const T * const_pointer;
+    typedef T & reference;
+    typedef const T & const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template<typename U>
+    struct rebind {
+        typedef Huge_Page_Allocator<U> other;
+    };
+
+    Huge_Page_Allocator(std::shared_ptr<Huge_Page_Arena> arena = nullptr)
+        : arena(std::move(arena))
+    {
+    }
+
+    template<typename U>
+    Huge_Page_Allocator(const Huge_Page_Allocator<U> & other)
+        : arena(other.arena)
+    {
+    }
+
+    T * allocate(size_t n, const void * hint = 0)
+    {
+        if (!arena)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(arena->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T * p, size_t n)
+    {
+        if (!arena)
+            ::operator delete(p);
+        else arena->deallocate(p, n * sizeof(T));
+    }
+
+    size_t max_size() const
+    {
+        return size_t(-1) / sizeof(T);
+    }
+
+    template<typename U, typename... Args>
+    void construct(U * p, Args&&... args)
+    {
+        ::new ((void *)p) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U * p)
+    {
+        p->~U();
+    }
+
+    T * address(T & x) const { return &x; }
+    const T * address(const T & x) const { return &x; }
+
+    std::shared_ptr<Huge_Page_Arena> arena;
+};
+
+template<typename T, typename U>
+bool operator == (const Huge_Page_Allocator<T> & a,
+                  const Huge_Page_Allocator<U> & b)
+{
+    return a.arena == b.arena;
+}
+
+template<typename T, typename U>
+bool operator != (const Huge_Page_Allocator<T> & a,
+                  const Huge_Page_Allocator<U> & b)
+{
+    return a.arena != b.arena;
+}
+
+/** New arena of the given mode, or null for HP_NONE, for the allocators of
+    the containers that it's to be shared by.
+*/
+std::shared_ptr<Huge_Page_Arena> huge_page_arena(Huge_Page_Mode mode);
+
+} // namespace ML
+
+#endif /* __jml__arch__huge_page_allocator_h__ */
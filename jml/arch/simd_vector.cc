@@ -829,6 +829,76 @@ double vec_dotprod_dp(const float * x, const float * y, size_t n)
     return res;
 }
 
+void vec_dotprod_dp(const float * x, const float * y, size_t stride,
+                    size_t k, double * r, size_t n)
+{
+    unsigned j = 0;
+
+    for (; j + 4 <= k;  j += 4) {
+        const float * y0 = y + (j + 0) * stride;
+        const float * y1 = y + (j + 1) * stride;
+        const float * y2 = y + (j + 2) * stride;
+        const float * y3 = y + (j + 3) * stride;
+
+        v2df rr0 = vec_splat(0.0), rr1 = rr0, rr2 = rr0, rr3 = rr0;
+        unsigned i = 0;
+
+        for (; i + 4 <= n;  i += 4) {
+            v4sf xxxx = __builtin_ia32_loadups(x + i);
+
+            v4sf yyyy0 = __builtin_ia32_loadups(y0 + i);
+            yyyy0 *= xxxx;
+            rr0 += __builtin_ia32_cvtps2pd(yyyy0);
+            yyyy0 = __builtin_ia32_shufps(yyyy0, yyyy0, 14);
+            rr0 += __builtin_ia32_cvtps2pd(yyyy0);
+
+            v4sf yyyy1 = __builtin_ia32_loadups(y1 + i);
+            yyyy1 *= xxxx;
+            rr1 += __builtin_ia32_cvtps2pd(yyyy1);
+            yyyy1 = __builtin_ia32_shufps(yyyy1, yyyy1, 14);
+            rr1 += __builtin_ia32_cvtps2pd(yyyy1);
+
+            v4sf yyyy2 = __builtin_ia32_loadups(y2 + i);
+            yyyy2 *= xxxx;
+            rr2 += __builtin_ia32_cvtps2pd(yyyy2);
+            yyyy2 = __builtin_ia32_shufps(yyyy2, yyyy2, 14);
+            rr2 += __builtin_ia32_cvtps2pd(yyyy2);
+
+            v4sf yyyy3 = __builtin_ia32_loadups(y3 + i);
+            yyyy3 *= xxxx;
+            rr3 += __builtin_ia32_cvtps2pd(yyyy3);
+            yyyy3 = __builtin_ia32_shufps(yyyy3, yyyy3, 14);
+            rr3 += __builtin_ia32_cvtps2pd(yyyy3);
+        }
+
+        double results[8];
+        *(v2df *)(results + 0) = rr0;
+        *(v2df *)(results + 2) = rr1;
+        *(v2df *)(results + 4) = rr2;
+        *(v2df *)(results + 6) = rr3;
+
+        double res0 = results[0] + results[1];
+        double res1 = results[2] + results[3];
+        double res2 = results[4] + results[5];
+        double res3 = results[6] + results[7];
+
+        for (;  i < n;  ++i) {
+            res0 += x[i] * y0[i];
+            res1 += x[i] * y1[i];
+            res2 += x[i] * y2[i];
+            res3 += x[i] * y3[i];
+        }
+
+        r[j + 0] = res0;
+        r[j + 1] = res1;
+        r[j + 2] = res2;
+        r[j + 3] = res3;
+    }
+
+    for (;  j < k;  ++j)
+        r[j] = vec_dotprod_dp(x, y + j * stride, n);
+}
+
 double vec_dotprod_dp(const double * x, const float * y, size_t n)
 {
     double res = 0.0;
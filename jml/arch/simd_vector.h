@@ -129,6 +129,13 @@ void vec_add(const double * x, const float * y, double * r, size_t n);
 
 /* Floating point using double precision accumulation */
 double vec_dotprod_dp(const float * x, const float * y, size_t n);
+
+/* k dot products of x with the vectors y, y + stride, ... y + (k-1) * stride,
+   written to r.  The vectors are done four at a time, so that each value of
+   x is loaded once for all four of them. */
+void vec_dotprod_dp(const float * x, const float * y, size_t stride,
+                    size_t k, double * r, size_t n);
+
 double vec_sum_dp(const float * x, size_t n);
 void vec_add(const double * x, double k, const float * y, double * r,
              size_t n);
@@ -13,6 +13,7 @@ $(eval $(call test,sse2_math_test,arch,boost))
 $(eval $(call test,info_test,arch,boost))
 $(eval $(call test,rtti_utils_test,arch,boost))
 $(eval $(call test,thread_specific_test,arch boost_thread,boost))
+$(eval $(call test,huge_page_allocator_test,arch boost_thread,boost))
 
 # test made manual due to the new kernel restrictions on the opening of
 # /proc/self/pagemap:
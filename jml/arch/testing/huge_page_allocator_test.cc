@@ -0,0 +1,139 @@
+/* huge_page_allocator_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Test for the huge page allocator.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "jml/arch/huge_page_allocator.h"
+
+#include <boost/test/unit_test.hpp>
+#include <unordered_map>
+#include <map>
+#include <thread>
+#include <string>
+
+
+using namespace ML;
+using namespace std;
+
+
+BOOST_AUTO_TEST_CASE( test_parse_mode )
+{
+    BOOST_CHECK_EQUAL(parse_huge_page_mode("none"), HP_NONE);
+    BOOST_CHECK_EQUAL(parse_huge_page_mode("transparent"), HP_TRANSPARENT);
+    BOOST_CHECK_EQUAL(parse_huge_page_mode("explicit"), HP_EXPLICIT);
+    BOOST_CHECK_THROW(parse_huge_page_mode("2MB"), ML::Exception);
+    BOOST_CHECK_EQUAL(print(HP_EXPLICIT), string("explicit"));
+}
+
+BOOST_AUTO_TEST_CASE( test_huge_page_alloc )
+{
+    // Explicit falls back to transparent when nothing is reserved
+    for (auto mode: { HP_NONE, HP_TRANSPARENT, HP_EXPLICIT }) {
+        char * mem = (char *)huge_page_alloc(3 * huge_page_size + 1, mode);
+        BOOST_CHECK_EQUAL((size_t)mem % huge_page_size, 0);
+        mem[0] = 1;
+        mem[4 * huge_page_size - 1] = 1;
+        huge_page_free(mem, 3 * huge_page_size + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_size_classes )
+{
+    BOOST_CHECK_EQUAL(Huge_Page_Arena::size_class(0), 0);
+    BOOST_CHECK_EQUAL(Huge_Page_Arena::size_class(16), 0);
+    BOOST_CHECK_EQUAL(Huge_Page_Arena::size_class(17), 1);
+    BOOST_CHECK_EQUAL(Huge_Page_Arena::class_size(63), 1024);
+
+    for (size_t bytes = 1;  bytes <= Huge_Page_Arena::max_small_size;
+         bytes += 7) {
+        int cls = Huge_Page_Arena::size_class(bytes);
+        BOOST_REQUIRE_GE(Huge_Page_Arena::class_size(cls), bytes);
+        if (cls > 0)
+            BOOST_REQUIRE_LT(Huge_Page_Arena::class_size(cls - 1), bytes);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_arena )
+{
+    Huge_Page_Arena arena;
+
+    // Freed blocks are reused by the next allocation of their class
+    void * p1 = arena.allocate(40);
+    arena.deallocate(p1, 40);
+    BOOST_CHECK_EQUAL(arena.allocate(48), p1);
+    BOOST_CHECK_EQUAL(arena.bytes_mapped(), huge_page_size);
+
+    // Large blocks get their own mapping
+    void * large = arena.allocate(Huge_Page_Arena::max_small_size + 1);
+    BOOST_CHECK_EQUAL((size_t)large % huge_page_size, 0);
+    BOOST_CHECK_EQUAL(arena.bytes_mapped(), 2 * huge_page_size);
+    arena.deallocate(large, Huge_Page_Arena::max_small_size + 1);
+    BOOST_CHECK_EQUAL(arena.bytes_mapped(), huge_page_size);
+
+    // Going over a chunk
+    vector<char *> blocks;
+    for (unsigned i = 0;  i < 100;  ++i) {
+        blocks.push_back((char *)arena.allocate(100000));
+        std::fill(blocks.back(), blocks.back() + 100000, char(i));
+    }
+    for (unsigned i = 0;  i < 100;  ++i) {
+        BOOST_CHECK_EQUAL(blocks[i][0], char(i));
+        BOOST_CHECK_EQUAL(blocks[i][99999], char(i));
+        BOOST_CHECK_EQUAL((size_t)blocks[i] % 16, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_containers )
+{
+    typedef Huge_Page_Allocator<pair<const int, string> > Allocator;
+    typedef unordered_map<int, string, std::hash<int>, std::equal_to<int>,
+                          Allocator> Map;
+
+    for (auto mode: { HP_NONE, HP_TRANSPARENT }) {
+        Map map;
+
+        // Switched over by assigning an empty map
+        map = Map(0, std::hash<int>(), std::equal_to<int>(),
+                  huge_page_arena(mode));
+        BOOST_CHECK_EQUAL(bool(map.get_allocator().arena), mode != HP_NONE);
+
+        for (int i = 0;  i < 100000;  ++i)
+            map[i] = to_string(i);
+        for (int i = 0;  i < 100000;  i += 2)
+            map.erase(i);
+
+        BOOST_CHECK_EQUAL(map.size(), 50000);
+        for (int i = 1;  i < 100000;  i += 2)
+            BOOST_REQUIRE_EQUAL(map[i], to_string(i));
+    }
+
+    typedef map<int, int, std::less<int>,
+                Huge_Page_Allocator<pair<const int, int> > > Tree;
+    Tree tree(std::less<int>(), huge_page_arena(HP_TRANSPARENT));
+
+    // The arena is shared by the threads
+    Tree trees[4];
+    vector<std::thread> threads;
+    for (int t = 0;  t < 4;  ++t) {
+        trees[t] = Tree(std::less<int>(), tree.get_allocator());
+        threads.emplace_back([&, t] () {
+                for (int i = 0;  i < 10000;  ++i)
+                    trees[t][i] = i;
+            });
+    }
+    for (auto & thread: threads)
+        thread.join();
+
+    for (int i = 0;  i < 10000;  i += 4)
+        tree[i] = i;
+    BOOST_CHECK_EQUAL(tree.size(), 2500);
+    for (auto & t: trees) {
+        BOOST_CHECK_EQUAL(t.size(), 10000);
+        BOOST_CHECK(t.get_allocator() == tree.get_allocator());
+    }
+}
@@ -360,6 +360,39 @@ BOOST_AUTO_TEST_CASE(vec_dotprod_test)
     vec_dotprod_dp_mixed_test_case(123);
 }
 
+void vec_dotprod_dp_batch_test_case(int nvals, int k)
+{
+    cerr << "testing vec_dotprod_dp batch nvals " << nvals << " k " << k
+         << endl;
+
+    int stride = nvals + 3;
+    float x[nvals], y[k * stride];
+    double r[k];
+
+    for (unsigned i = 0; i < nvals;  ++i)
+        x[i] = rand() / 16384.0;
+    for (unsigned i = 0; i < k * stride;  ++i)
+        y[i] = rand() / 16384.0;
+
+    SIMD::vec_dotprod_dp(x, y, stride, k, r, nvals);
+
+    // Same order of operations as doing them one by one
+    for (unsigned j = 0;  j < k;  ++j)
+        BOOST_CHECK_EQUAL(r[j], SIMD::vec_dotprod_dp(x, y + j * stride, nvals));
+}
+
+BOOST_AUTO_TEST_CASE(vec_dotprod_dp_batch_test)
+{
+    for (int k: { 1, 3, 4, 5, 8, 11 }) {
+        vec_dotprod_dp_batch_test_case(1, k);
+        vec_dotprod_dp_batch_test_case(3, k);
+        vec_dotprod_dp_batch_test_case(4, k);
+        vec_dotprod_dp_batch_test_case(9, k);
+        vec_dotprod_dp_batch_test_case(16, k);
+        vec_dotprod_dp_batch_test_case(123, k);
+    }
+}
+
 template<typename T1, typename T2>
 void vec_accum_prod3_test_case(int nvals)
 {
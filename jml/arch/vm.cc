@@ -13,12 +13,15 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <errno.h>
 
 #include <boost/bind.hpp>
 #include <boost/crc.hpp>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
 
 
 using namespace std;
@@ -376,6 +379,92 @@ dump(std::ostream & stream) const
 }
 
 
+/*****************************************************************************/
+/* HUGE PAGES                                                                */
+/*****************************************************************************/
+
+Huge_Page_Mode parse_huge_page_mode(const std::string & mode)
+{
+    if (mode == "none") return HP_NONE;
+    if (mode == "transparent") return HP_TRANSPARENT;
+    if (mode == "explicit") return HP_EXPLICIT;
+    throw Exception("unknown huge page mode '" + mode + "'");
+}
+
+const char * print(Huge_Page_Mode mode)
+{
+    switch (mode) {
+    case HP_NONE: return "none";
+    case HP_TRANSPARENT: return "transparent";
+    case HP_EXPLICIT: return "explicit";
+    default: return "unknown";
+    }
+}
+
+namespace {
+
+size_t round_to_huge_page(size_t bytes)
+{
+    return (bytes + huge_page_size - 1) & ~(size_t)(huge_page_size - 1);
+}
+
+} // file scope
+
+void * huge_page_alloc(size_t bytes, Huge_Page_Mode mode)
+{
+    bytes = round_to_huge_page(std::max<size_t>(bytes, 1));
+
+    if (mode == HP_EXPLICIT) {
+        void * mem = mmap(0, bytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED)
+            return mem;
+
+        static bool warned = false;
+        if (!warned) {
+            cerr << "warning: no reserved huge pages left ("
+                 << strerror(errno) << "); using transparent huge pages"
+                 << endl;
+            warned = true;
+        }
+    }
+
+    // Map an extra huge page so that the start can be aligned on one, which
+    // is needed for the kernel to back it with huge pages, then give back
+    // what's on either side.
+    size_t mapped = bytes + huge_page_size;
+    void * mem = mmap(0, mapped, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        throw Exception(errno, format("mmap of %zd bytes", mapped),
+                        "huge_page_alloc()");
+
+    char * start = (char *)round_to_huge_page((size_t)mem);
+    char * end = start + bytes;
+
+    if (start != mem)
+        munmap(mem, start - (char *)mem);
+    if (end != (char *)mem + mapped)
+        munmap(end, (char *)mem + mapped - end);
+
+    if (mode != HP_NONE && madvise(start, bytes, MADV_HUGEPAGE) == -1) {
+        static bool warned = false;
+        if (!warned) {
+            cerr << "warning: transparent huge pages are unavailable: "
+                 << strerror(errno) << endl;
+            warned = true;
+        }
+    }
+
+    return start;
+}
+
+void huge_page_free(void * mem, size_t bytes)
+{
+    if (!mem) return;
+    munmap(mem, round_to_huge_page(std::max<size_t>(bytes, 1)));
+}
+
 } // namespace ML
 
 
@@ -172,6 +172,44 @@ inline ssize_t to_page_num(ssize_t val)
 void dump_maps(std::ostream & stream = std::cerr);
 
 
+/*****************************************************************************/
+/* HUGE PAGES                                                                */
+/*****************************************************************************/
+
+enum {
+    huge_page_shift = 21,
+    huge_page_size  = 1 << huge_page_shift
+};
+
+/** How memory gets backed by 2MB pages, which cover 512 times more memory
+    per TLB entry than normal pages.
+*/
+enum Huge_Page_Mode {
+    HP_NONE,         ///< Normal pages
+    HP_TRANSPARENT,  ///< Normal pages that the kernel is asked to merge
+    HP_EXPLICIT      ///< Pages from the reserved hugetlbfs pool
+};
+
+/** Parses "none", "transparent" or "explicit". */
+Huge_Page_Mode parse_huge_page_mode(const std::string & mode);
+
+const char * print(Huge_Page_Mode mode);
+
+/** Maps bytes of anonymous memory, rounded up to a multiple of
+    huge_page_size and aligned on a huge page.
+
+    HP_TRANSPARENT madvise()s the mapping with MADV_HUGEPAGE, which only
+    takes effect when /sys/kernel/mm/transparent_hugepage/enabled isn't
+    "never".  HP_EXPLICIT uses MAP_HUGETLB, which needs pages to have been
+    reserved through /proc/sys/vm/nr_hugepages; when there aren't enough it
+    falls back to HP_TRANSPARENT.  Throws if the memory can't be mapped.
+*/
+void * huge_page_alloc(size_t bytes, Huge_Page_Mode mode);
+
+/** Unmaps memory returned by huge_page_alloc() for the same size. */
+void huge_page_free(void * mem, size_t bytes);
+
+
 /*****************************************************************************/
 /* PAGEMAP_READER                                                            */
 /*****************************************************************************/
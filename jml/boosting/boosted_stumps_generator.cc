@@ -77,6 +77,8 @@ configure(const Configuration & config)
     config.find(output_function,      "output_function");
     config.find(short_circuit_window, "short_circuit_window");
     config.find(trace_training_acc,   "trace_training_acc");
+
+    weak_learner.configure(config);
 }
 
 void
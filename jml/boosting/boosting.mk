@@ -53,7 +53,8 @@ LIBBOOSTING_SOURCES := \
 	feature.cc \
 	bit_compressed_index.cc \
 	label.cc \
-	buckets.cc
+	buckets.cc \
+	compiled_trees.cc
 
 LIBBOOSTING_LINK :=	utils db algebra arch judy ACE boost_regex boost_thread worker_task
 
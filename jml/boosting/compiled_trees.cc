@@ -0,0 +1,337 @@
+/* compiled_trees.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tree based classifiers flattened into an array of nodes for scoring.
+*/
+
+#include "compiled_trees.h"
+#include "decision_tree.h"
+#include "boosted_stumps.h"
+#include "committee.h"
+#include "stump.h"
+#include "feature_space.h"
+#include "jml/utils/floating_point.h"
+#include "jml/arch/demangle.h"
+#include <cmath>
+#include <map>
+
+
+using namespace std;
+
+
+namespace ML {
+
+namespace {
+
+/** Logistic output of Boosted_Stumps::predict(). */
+float logit(float val)
+{
+    /* Avoid an overflow from the exp. */
+    val = std::min(val, fp_traits<float>::max_exp_arg * 0.9f);
+    double e = exp(val);
+    return e / (e + (1.0 / e));
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* COMPILED_TREES::COMPILER                                                  */
+/*****************************************************************************/
+
+struct Compiled_Trees::Compiler {
+    Compiler(Compiled_Trees & result, const Classifier_Impl & classifier,
+             const std::vector<Feature> & features)
+        : result(result), feature_space(*classifier.feature_space())
+    {
+        for (unsigned i = 0;  i < features.size();  ++i)
+            feature_index.insert(make_pair(features[i], i));
+    }
+
+    Compiled_Trees & result;
+    const Feature_Space & feature_space;
+    std::map<Feature, int> feature_index;
+
+    void add(const Classifier_Impl & classifier, float weight, bool top)
+    {
+        if (weight == 0.0) return;
+
+        if (auto tree = dynamic_cast<const Decision_Tree *>(&classifier)) {
+            result.roots.push_back(add_tree(tree->tree.root, weight));
+        }
+        else if (auto stump = dynamic_cast<const Stump *>(&classifier)) {
+            result.roots.push_back(add_stump(*stump, weight));
+        }
+        else if (auto stumps
+                 = dynamic_cast<const Boosted_Stumps *>(&classifier)) {
+            /* The transformation isn't linear, so it can only be done once
+               everything has been added up. */
+            if (stumps->output != Boosted_Stumps::RAW) {
+                if (!top)
+                    throw Exception("Compiled_Trees: can't compile boosted "
+                                    "stumps with a transformed output "
+                                    "within another classifier");
+                result.output = (stumps->output == Boosted_Stumps::LOGIT
+                                 ? LOGIT : LOGIT_NORM);
+            }
+
+            add_bias(stumps->bias, weight);
+            for (const Stump & stump: *stumps)
+                result.roots.push_back(add_stump(stump, weight));
+        }
+        else if (auto committee
+                 = dynamic_cast<const Committee *>(&classifier)) {
+            add_bias(committee->bias, weight);
+            for (unsigned i = 0;  i < committee->classifiers.size();  ++i)
+                add(*committee->classifiers[i],
+                    weight * committee->weights[i],
+                    false /* top */);
+        }
+        else throw Exception("Compiled_Trees: can't compile a "
+                             + demangle(typeid(classifier).name()));
+    }
+
+    void add_bias(const distribution<float> & bias, float weight)
+    {
+        for (unsigned i = 0;  i < bias.size() && i < result.bias.size();  ++i)
+            result.bias[i] += weight * bias[i];
+    }
+
+    int add_tree(const Tree::Ptr & ptr, float weight)
+    {
+        if (!ptr) return 0;  // the empty leaf
+        if (!ptr.node()) return add_leaf(ptr.leaf()->pred, weight);
+
+        const Tree::Node & node = *ptr.node();
+        int index = add_split(node.split);
+
+        int child_false = add_tree(node.child_false, weight);
+        int child_true = add_tree(node.child_true, weight);
+        int child_missing = add_tree(node.child_missing, weight);
+
+        Node & added = result.nodes[index];
+        added.child[false] = child_false;
+        added.child[true] = child_true;
+        added.child[MISSING] = child_missing;
+
+        return index;
+    }
+
+    int add_stump(const Stump & stump, float weight)
+    {
+        int index = add_split(stump.split);
+
+        int child_false = add_leaf(stump.action.pred_false, weight);
+        int child_true = add_leaf(stump.action.pred_true, weight);
+        int child_missing = add_leaf(stump.action.pred_missing, weight);
+
+        Node & added = result.nodes[index];
+        added.child[false] = child_false;
+        added.child[true] = child_true;
+        added.child[MISSING] = child_missing;
+
+        return index;
+    }
+
+    int add_split(const Split & split)
+    {
+        auto it = feature_index.find(split.feature());
+        if (it == feature_index.end())
+            throw Exception("Compiled_Trees: classifier uses feature "
+                            + feature_space.print(split.feature())
+                            + " which isn't in the feature list");
+
+        Node node;
+        node.split_val = split.split_val();
+        node.index = it->second;
+        node.op = split.op();
+        node.child[0] = node.child[1] = node.child[2] = 0;
+
+        result.nodes.push_back(node);
+        return result.nodes.size() - 1;
+    }
+
+    int add_leaf(const distribution<float> & values, float weight)
+    {
+        Node node;
+        node.split_val = 0.0;
+        node.index = result.leaf_values.size();
+        node.op = LEAF;
+        node.child[0] = node.child[1] = node.child[2] = 0;
+
+        for (int i = 0;  i < result.label_count_;  ++i)
+            result.leaf_values.push_back(i < (int)values.size()
+                                         ? weight * values[i] : 0.0f);
+
+        result.nodes.push_back(node);
+        return result.nodes.size() - 1;
+    }
+};
+
+
+/*****************************************************************************/
+/* COMPILED_TREES                                                            */
+/*****************************************************************************/
+
+Compiled_Trees::
+Compiled_Trees()
+    : output(RAW), label_count_(0), feature_count_(0)
+{
+}
+
+Compiled_Trees::
+Compiled_Trees(const Classifier_Impl & classifier,
+               const std::vector<Feature> & features)
+{
+    compile(classifier, features);
+}
+
+void
+Compiled_Trees::
+compile(const Classifier_Impl & classifier,
+        const std::vector<Feature> & features)
+{
+    nodes.clear();
+    roots.clear();
+    leaf_values.clear();
+    output = RAW;
+    label_count_ = classifier.label_count();
+    feature_count_ = features.size();
+    bias.clear();
+    bias.resize(label_count_);
+
+    Compiler compiler(*this, classifier, features);
+
+    /* Node 0 is an empty leaf, for missing branches of the trees */
+    compiler.add_leaf(distribution<float>(), 0.0);
+
+    compiler.add(classifier, 1.0, true /* top */);
+}
+
+JML_ALWAYS_INLINE
+int
+Compiled_Trees::
+walk(int index, const float * features) const
+{
+    const Node * nodes = &this->nodes[0];
+
+    for (;;) {
+        const Node & node = nodes[index];
+        if (node.op == LEAF) return node.index;
+
+        /* Same as Split::apply(), but without branches */
+        float val = features[node.index];
+        int outcomes = (val < node.split_val)
+            | ((val == node.split_val) << 1)
+            | 4;
+        int outcome = (outcomes >> node.op) & 1;
+        outcome = (std::isnan(val) ? (int)MISSING : outcome);
+
+        index = node.child[outcome];
+    }
+}
+
+void
+Compiled_Trees::
+transform(float * output) const
+{
+    double total = 0.0;
+
+    for (int i = 0;  i < label_count_;  ++i) {
+        output[i] = logit(output[i]);
+        total += output[i];
+    }
+
+    if (this->output != LOGIT_NORM) return;
+
+    if ((float)total == 0.0F) {
+        for (int i = 0;  i < label_count_;  ++i)
+            output[i] = 1.0 / label_count_;
+    }
+    else {
+        for (int i = 0;  i < label_count_;  ++i)
+            output[i] /= total;
+    }
+}
+
+void
+Compiled_Trees::
+predict(const float * features, float * output) const
+{
+    predict(features, 1, feature_count_, output);
+}
+
+Label_Dist
+Compiled_Trees::
+predict(const float * features) const
+{
+    Label_Dist result(label_count_);
+    predict(features, &result[0]);
+    return result;
+}
+
+float
+Compiled_Trees::
+predict(int label, const float * features) const
+{
+    if (label < 0 || label >= label_count_)
+        throw Exception(format("Compiled_Trees::predict(): attempt to predict "
+                               "label %d with label_count %d",
+                               label, label_count_));
+
+    if (output == LOGIT_NORM) {
+        /* Need to predict all, so we know how to normalize. */
+        float outputs[label_count_];
+        predict(features, outputs);
+        return outputs[label];
+    }
+
+    const float * leaves = &leaf_values[0];
+
+    float result = bias[label];
+    for (int root: roots)
+        result += leaves[walk(root, features) + label];
+
+    if (output == LOGIT)
+        result = logit(result);
+
+    return result;
+}
+
+void
+Compiled_Trees::
+predict(const float * features, size_t n, size_t stride,
+        float * output) const
+{
+    int nl = label_count_;
+    const float * leaves = &leaf_values[0];
+
+    for (size_t i = 0;  i < n;  ++i)
+        std::copy(bias.begin(), bias.end(), output + i * nl);
+
+    /* Each tree is walked for a block of vectors before going on to the
+       next.  The walks within a block don't depend on each other, so they
+       overlap in the pipeline. */
+    enum { BLOCK_SIZE = 64 };
+
+    for (size_t first = 0;  first < n;  first += BLOCK_SIZE) {
+        size_t last = std::min<size_t>(n, first + BLOCK_SIZE);
+
+        for (int root: roots) {
+            for (size_t i = first;  i < last;  ++i) {
+                const float * leaf = leaves + walk(root, features + i * stride);
+                float * out = output + i * nl;
+                for (int j = 0;  j < nl;  ++j)
+                    out[j] += leaf[j];
+            }
+        }
+    }
+
+    if (this->output != RAW) {
+        for (size_t i = 0;  i < n;  ++i)
+            transform(output + i * nl);
+    }
+}
+
+} // namespace ML
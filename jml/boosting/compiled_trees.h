@@ -0,0 +1,118 @@
+/* compiled_trees.h                                                -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tree based classifiers flattened into an array of nodes for scoring.
+*/
+
+#ifndef __boosting__compiled_trees_h__
+#define __boosting__compiled_trees_h__
+
+#include "classifier.h"
+#include <vector>
+#include <stdint.h>
+
+
+namespace ML {
+
+
+/*****************************************************************************/
+/* COMPILED_TREES                                                            */
+/*****************************************************************************/
+
+/** A decision tree, a stump, a set of boosted stumps or a committee of any
+    of those (which is what the boosting generator produces) flattened into
+    one array of nodes.  It scores dense feature vectors without going
+    through a Feature_Set, the virtual predict methods or a pointer per
+    node.
+
+    The nodes of each tree are laid out depth first, and each leaf holds its
+    outputs already multiplied by the weight of its tree in the committee,
+    so that scoring is a walk down each tree adding up the leaves reached.
+    The walk picks the child to go to by indexing rather than by branching
+    on the outcome of the split.  The batch predict walks each tree for a
+    block of vectors at a time, so that the tree stays in cache while it's
+    being used.
+
+    The vectors contain the given list of features, as for the
+    Classifier_Impl::optimize() methods, with NaN for a missing feature.  As
+    each feature has exactly one value, the output is the same as that of
+    the classifier's optimized predict.
+*/
+
+struct Compiled_Trees {
+    Compiled_Trees();
+
+    /** Compile the classifier for vectors of the given features.  Throws if
+        the classifier isn't one that can be compiled, or if it uses a
+        feature that isn't in the list. */
+    Compiled_Trees(const Classifier_Impl & classifier,
+                   const std::vector<Feature> & features);
+
+    void compile(const Classifier_Impl & classifier,
+                 const std::vector<Feature> & features);
+
+    size_t label_count() const { return label_count_; }
+    size_t feature_count() const { return feature_count_; }
+    size_t tree_count() const { return roots.size(); }
+    size_t node_count() const { return nodes.size(); }
+
+    /** Score one feature vector, writing label_count() outputs. */
+    void predict(const float * features, float * output) const;
+
+    /** Score one feature vector, returning the output distribution. */
+    Label_Dist predict(const float * features) const;
+
+    /** Score one label for one feature vector. */
+    float predict(int label, const float * features) const;
+
+    /** Score n feature vectors, the i-th one starting at
+        features + i * stride, writing label_count() outputs for each one
+        into output. */
+    void predict(const float * features, size_t n, size_t stride,
+                 float * output) const;
+
+private:
+    struct Compiler;
+
+    /** Transformation done on the output; see Boosted_Stumps::Output. */
+    enum Output {
+        RAW,
+        LOGIT,
+        LOGIT_NORM
+    };
+
+    /** Split or leaf.  A leaf has op LEAF, and its index is the offset of
+        its outputs in leaf_values.  For a split, the index is that of the
+        feature and the children are indexed by the outcome of the split
+        (false, true or MISSING). */
+    struct Node {
+        float split_val;
+        uint32_t index:30;
+        uint32_t op:2;
+        int32_t child[3];
+    };
+
+    enum { LEAF = 3 };
+
+    /** Walk down the tree from the given node, returning the offset of the
+        outputs of the leaf reached. */
+    int walk(int node, const float * features) const;
+
+    /** Apply the output transformation to one vector's outputs. */
+    void transform(float * output) const;
+
+    std::vector<Node> nodes;         ///< Nodes of all of the trees
+    std::vector<int> roots;          ///< Root node of each tree
+    std::vector<float> leaf_values;  ///< label_count() outputs per leaf
+    std::vector<float> bias;         ///< Added to every output
+    Output output;
+    int label_count_;
+    int feature_count_;
+};
+
+
+} // namespace ML
+
+
+#endif /* __boosting__compiled_trees_h__ */
@@ -53,6 +53,8 @@ configure(const Configuration & config)
     config.find(max_depth, "max_depth");
     config.find(update_alg, "update_alg");
     config.find(random_feature_propn, "random_feature_propn");
+    config.find(num_buckets, "num_buckets");
+    config.find(bucket_density, "bucket_density");
 }
 
 void
@@ -64,6 +66,8 @@ defaults()
     max_depth = -1;
     update_alg = Stump::PROB;
     random_feature_propn = 1.0;
+    num_buckets = 255;
+    bucket_density = 0.2;
 }
 
 Config_Options
@@ -79,7 +83,13 @@ options() const
         .add("update_alg", update_alg,
              "select the type of output that the tree gives")
         .add("random_feature_propn", random_feature_propn, "0.0-1.0",
-             "proportion of the features to enable (for random forests)");
+             "proportion of the features to enable (for random forests)")
+        .add("num_buckets", num_buckets, "2-65535",
+             "number of buckets of the histograms that real features are "
+             "split over")
+        .add("bucket_density", bucket_density, "0.0-1.0",
+             "split the features present in more than this proportion of "
+             "the examples over histograms; 0 for all of them");
     
     return result;
 }
@@ -847,6 +857,7 @@ train_recursive(Thread_Context & context,
         
         Accum accum(*model.feature_space(), nl, trace);
         Trainer trainer;
+        trainer.set_buckets(num_buckets, bucket_density);
     
         trainer.test_all
             (context, features, data, model.predicted(),
@@ -864,6 +875,7 @@ train_recursive(Thread_Context & context,
         
         Accum accum(*model.feature_space(), nl, trace);
         Trainer trainer;
+        trainer.set_buckets(num_buckets, bucket_density);
     
         trainer.test_all
             (context, features, data, model.predicted(),
@@ -965,6 +977,78 @@ train_recursive(Thread_Context & context,
     return node;
 }
 
+struct Decision_Tree_Generator::Train_Recursive_Regression_Job {
+
+    Tree::Ptr & ptr;
+    const Decision_Tree_Generator * generator;
+    Thread_Context context;
+    const Training_Data & data;
+    const vector<float> & weights;
+    const vector<Feature> & features;
+    const distribution<float> & in_class;
+    int depth;
+    int max_depth;
+    Tree & tree;
+
+    Train_Recursive_Regression_Job(Tree::Ptr & ptr,
+                                   const Decision_Tree_Generator * generator,
+                                   const Thread_Context & context,
+                                   const Training_Data & data,
+                                   const vector<float> & weights,
+                                   const vector<Feature> & features,
+                                   const distribution<float> & in_class,
+                                   int depth, int max_depth,
+                                   Tree & tree)
+        : ptr(ptr), generator(generator), context(context), data(data),
+          weights(weights), features(features),
+          in_class(in_class), depth(depth), max_depth(max_depth),
+          tree(tree)
+    {
+    }
+
+    void operator () ()
+    {
+        ptr = generator->train_recursive_regression(context, data, weights,
+                                                    features, in_class,
+                                                    depth, max_depth, tree);
+    }
+};
+
+void
+Decision_Tree_Generator::
+do_branch_regression(Tree::Ptr & ptr,
+                     int & group_to_wait_on,
+                     Thread_Context & context,
+                     const Training_Data & data,
+                     const vector<float> & weights,
+                     const vector<Feature> & features,
+                     const distribution<float> & new_in_class,
+                     double total_in_class,
+                     int new_depth, int max_depth,
+                     Tree & tree) const
+{
+    if (total_in_class > 1024) {
+        // Worth multithreading... do it
+        if (group_to_wait_on == -1) {
+            // Create a new group
+            group_to_wait_on = context.worker().get_group(NO_JOB,
+                                                          "regression tree",
+                                                          context.group());
+        }
+        Thread_Context child_context = context.child(group_to_wait_on);
+
+        Train_Recursive_Regression_Job job(ptr, this, child_context, data,
+                                           weights, features, new_in_class,
+                                           new_depth, max_depth, tree);
+
+        context.worker().add(job, "train regression tree branch",
+                             child_context.group());
+    }
+    else ptr = train_recursive_regression(context, data, weights, features,
+                                          new_in_class, new_depth, max_depth,
+                                          tree);
+}
+
 Tree::Ptr
 Decision_Tree_Generator::
 train_recursive_regression(Thread_Context & context,
@@ -1049,14 +1133,13 @@ train_recursive_regression(Thread_Context & context,
     
     Accum accum(*model.feature_space(), nl, trace);
     Trainer trainer;
-    
-    vector<Feature> features = features_;
+    trainer.set_buckets(num_buckets, bucket_density);
     
     /* We need it in a fixed array like this. */
     boost::multi_array<float, 2> weights2(boost::extents[weights.size()][1]);
     std::copy(weights.begin(), weights.end(), weights2.data());
-    trainer.test_all_and_sort(features, data, model.predicted(), weights2,
-                              in_class, accum);
+    trainer.test_all(context, features_, data, model.predicted(), weights2,
+                     in_class, accum);
     
     //cerr << " decision tree training: best is "
     //     << feature_space()->print(feature)
@@ -1095,18 +1178,27 @@ train_recursive_regression(Thread_Context & context,
     node->examples = total_weight;
     node->pred = leaf.pred;
 
-    node->child_true
-        = train_recursive_regression(context, data, weights, features,
-                                     class_true, depth + 1, max_depth,
-                                     tree);
-    node->child_false
-        = train_recursive_regression(context, data, weights, features,
-                                     class_false, depth + 1, max_depth,
-                                     tree); 
-    node->child_missing
-        = train_recursive_regression(context, data, weights, features,
-                                     class_missing, depth + 1, max_depth,
-                                     tree);
+    int group_to_wait_for = -1;
+
+    do_branch_regression(node->child_true, group_to_wait_for,
+                         context, data, weights, features_,
+                         class_true, total_true, depth + 1, max_depth,
+                         tree);
+
+    do_branch_regression(node->child_false, group_to_wait_for,
+                         context, data, weights, features_,
+                         class_false, total_false, depth + 1, max_depth,
+                         tree);
+
+    do_branch_regression(node->child_missing, group_to_wait_for,
+                         context, data, weights, features_,
+                         class_missing, total_missing, depth + 1, max_depth,
+                         tree);
+
+    if (group_to_wait_for != -1) {
+        context.worker().unlock_group(group_to_wait_for);
+        context.worker().run_until_finished(group_to_wait_for);
+    }
     
     return node;
 }
@@ -70,6 +70,8 @@ public:
     int trace;
     Stump::Update update_alg;
     float random_feature_propn;
+    int num_buckets;
+    float bucket_density;
 
     /* Once init has been called, we clone our potential models from this
        one. */
@@ -111,7 +113,19 @@ public:
                    int new_depth, int max_depth,
                    Tree & tree) const;
     
+    void do_branch_regression(Tree::Ptr & ptr,
+                              int & group_to_wait_on,
+                              Thread_Context & context,
+                              const Training_Data & data,
+                              const std::vector<float> & weights,
+                              const std::vector<Feature> & features,
+                              const distribution<float> & new_in_class,
+                              double total_in_class,
+                              int new_depth, int max_depth,
+                              Tree & tree) const;
+
     struct Train_Recursive_Job;
+    struct Train_Recursive_Regression_Job;
 };
 
 
@@ -19,6 +19,15 @@
 #include "jml/utils/smart_ptr_utils.h"
 #include <boost/tuple/tuple.hpp>
 #include "stdint.h"
+#include <fstream>
+#include <sstream>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace DB;
@@ -817,6 +826,73 @@ get_sizes(const std::string & filename,
 
 } // file scope
 
+/** The column file format.  The file starts with the magic number and the
+    length of the header, which are followed by the serialized header and
+    then by the columns from the next page boundary onwards:
+
+    header:  "DENSE_COLUMNS", version, rows, variables, stride, feature space
+    columns: for each variable, the value of each row, padded to the stride
+
+    The columns start on a page boundary and are a whole number of pages
+    long, so that the values of a feature are paged in on their own.
+*/
+
+namespace {
+
+const char COLUMN_MAGIC[8] = { 'J', 'M', 'L', '_', 'C', 'O', 'L', 'S' };
+
+const size_t COLUMN_PAGE = 4096;
+
+size_t round_to_page(size_t bytes)
+{
+    return (bytes + COLUMN_PAGE - 1) / COLUMN_PAGE * COLUMN_PAGE;
+}
+
+} // file scope
+
+struct Dense_Training_Data::Columns {
+    Columns(const std::string & filename)
+        : start(0), length(0), row_count(0), var_count(0), stride(0),
+          data(0)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw Exception("couldn't open column file " + filename + ": "
+                            + strerror(errno));
+
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            ::close(fd);
+            throw Exception("couldn't stat column file " + filename);
+        }
+        length = st.st_size;
+
+        /* Private, so that modify_feature() can write to the rows without
+           touching the file. */
+        void * addr = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                           fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            throw Exception("couldn't map column file " + filename + ": "
+                            + strerror(errno));
+        start = (char *)addr;
+    }
+
+    ~Columns()
+    {
+        if (start) munmap(start, length);
+    }
+
+    char * start;
+    size_t length;
+    size_t row_count;
+    size_t var_count;
+    size_t stride;         ///< Number of floats from a column to the next
+    float * data;
+
+    float * column(size_t var) const { return data + var * stride; }
+};
+
 void Dense_Training_Data::
 add_data()
 {
@@ -824,8 +900,8 @@ add_data()
     Training_Data::clear();
     Training_Data::init(feature_space());
     
-    int nv = dataset.shape()[1];
-    int nx = dataset.shape()[0];
+    int nv = variable_count();
+    int nx = row_count();
 
     /* Feature vector */
     std::shared_ptr<vector<Feature> >
@@ -833,10 +909,13 @@ add_data()
     for (unsigned j = 0;  j < nv;  ++j)
         (*feature_vec)[j] = Feature(j);
     
-    /* Add data */
+    /* Add data.  The rows of a mapped dataset go down its columns. */
+    int stride = sizeof(float);
+    if (columns) stride = columns->stride * sizeof(float);
+
     for (unsigned x = 0;  x < nx;  ++x) {
         std::shared_ptr<Dense_Feature_Set> features
-            (new Dense_Feature_Set(feature_vec, &dataset[x][0]));
+            (new Dense_Feature_Set(feature_vec, &value(x, 0), stride));
         //cerr << "got row " << feature_space()->print(*features) << endl;
         add_example(features);
     }
@@ -895,6 +974,11 @@ Dense_Training_Data::
 init(const std::vector<std::string> & filenames,
      std::shared_ptr<Dense_Feature_Space> feature_space)
 {
+    if (filenames.size() == 1 && is_column_file(filenames[0])) {
+        init_columns(filenames[0], feature_space);
+        return;
+    }
+
     vector<Data_Source> data_sources;
     for (unsigned i = 0;  i < filenames.size();  ++i)
         data_sources.push_back(Data_Source(filenames[i]));
@@ -1174,6 +1258,159 @@ init(const std::vector<Data_Source> & data_sources,
     //}
 }
 
+bool
+Dense_Training_Data::
+is_column_file(const std::string & filename)
+{
+    std::ifstream stream(filename.c_str(), ios::binary);
+    char magic[sizeof(COLUMN_MAGIC)];
+    if (!stream.read(magic, sizeof(magic)))
+        return false;
+    return std::equal(magic, magic + sizeof(magic), COLUMN_MAGIC);
+}
+
+void
+Dense_Training_Data::
+save_columns(const std::string & filename) const
+{
+    size_t nx = row_count(), nv = variable_count();
+    size_t stride = round_to_page(nx * sizeof(float)) / sizeof(float);
+
+    if (stride * sizeof(float) > INT_MAX)
+        throw Exception(format("Dense_Training_Data::save_columns(): %zd "
+                               "rows are too many for a column file", nx));
+
+    std::ostringstream header_stream;
+    {
+        Store_Writer store(header_stream);
+        store << string("DENSE_COLUMNS") << compact_size_t(1)
+              << compact_size_t(nx) << compact_size_t(nv)
+              << compact_size_t(stride);
+        feature_space()->serialize(store);
+    }
+    string header = header_stream.str();
+    uint64_t header_length = header.size();
+
+    std::ofstream stream(filename.c_str(), ios::binary | ios::trunc);
+    stream.write(COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+    stream.write((const char *)&header_length, sizeof(header_length));
+    stream << header;
+
+    size_t written = sizeof(COLUMN_MAGIC) + sizeof(header_length)
+        + header.size();
+    vector<char> padding(round_to_page(written) - written);
+    stream.write(&padding[0], padding.size());
+
+    /* Transpose the rows a block at a time. */
+    vector<float> block(std::min<size_t>(stride, 65536));
+
+    for (unsigned v = 0;  v < nv;  ++v) {
+        for (size_t x = 0;  x < stride;  x += block.size()) {
+            size_t n = std::min(block.size(), stride - x);
+            for (size_t i = 0;  i < n;  ++i)
+                block[i] = (x + i < nx ? value(x + i, v) : 0.0);
+            stream.write((const char *)&block[0], n * sizeof(float));
+        }
+    }
+
+    if (!stream)
+        throw Exception("couldn't write column file " + filename);
+}
+
+void
+Dense_Training_Data::
+init_columns(const std::string & filename,
+             std::shared_ptr<Dense_Feature_Space> feature_space)
+{
+    Training_Data::init(feature_space);
+
+    std::shared_ptr<Columns> cols(new Columns(filename));
+
+    uint64_t header_length;
+    size_t header_start = sizeof(COLUMN_MAGIC) + sizeof(header_length);
+    if (cols->length < header_start)
+        throw Exception("column file " + filename + " is truncated");
+    std::copy(cols->start + sizeof(COLUMN_MAGIC), cols->start + header_start,
+              (char *)&header_length);
+
+    size_t data_offset = round_to_page(header_start + header_length);
+    if (cols->length < data_offset)
+        throw Exception("column file " + filename + " is truncated");
+
+    Store_Reader store(cols->start + header_start, header_length);
+
+    string type;
+    compact_size_t version, nx, nv, stride;
+    store >> type >> version;
+    if (type != "DENSE_COLUMNS")
+        throw Exception("column file " + filename + " has a header of type "
+                        + type);
+    if (version != 1)
+        throw Exception(format("column file %s has version %zd; only 1 is "
+                               "supported", filename.c_str(), version.size_));
+    store >> nx >> nv >> stride;
+
+    if (stride < nx || stride * sizeof(float) > INT_MAX
+        || cols->length < data_offset + nv * stride * sizeof(float))
+        throw Exception("column file " + filename + " is truncated or has "
+                        "bad dimensions");
+
+    /* Take the feature space from the file unless we were given one. */
+    if (feature_space->variable_count() == 0)
+        feature_space->reconstitute(store);
+    else {
+        Dense_Feature_Space file_space;
+        file_space.reconstitute(store);
+        if (file_space.feature_names() != feature_space->feature_names())
+            throw Exception("column file " + filename + " has different "
+                            "variables than the feature space");
+    }
+
+    cols->row_count = nx;
+    cols->var_count = nv;
+    cols->stride = stride;
+    cols->data = (float *)(cols->start + data_offset);
+
+    dataset.resize(boost::extents[0][0]);
+    row_comments.clear();
+    row_offsets.clear();
+    columns = cols;
+
+    add_data();
+}
+
+size_t
+Dense_Training_Data::
+variable_count() const
+{
+    if (columns) return columns->var_count;
+    return dataset.shape()[1];
+}
+
+size_t
+Dense_Training_Data::
+row_count() const
+{
+    if (columns) return columns->row_count;
+    return dataset.shape()[0];
+}
+
+float &
+Dense_Training_Data::
+value(size_t row, size_t var)
+{
+    if (columns) return columns->column(var)[row];
+    return dataset[row][var];
+}
+
+float
+Dense_Training_Data::
+value(size_t row, size_t var) const
+{
+    if (columns) return columns->column(var)[row];
+    return dataset[row][var];
+}
+
 Dense_Training_Data * Dense_Training_Data::make_copy() const
 {
     return new Dense_Training_Data(*this);
@@ -1212,10 +1449,10 @@ modify_feature(int example_number,
 {
     //return Training_Data::modify_feature(example_number, feature, new_value);
 
-    if (feature.type() < 0 || feature.type() >= example_count())
+    if (feature.type() < 0 || feature.type() >= variable_count())
         throw Exception("can't add feature to dense dataset");
 
-    float & val = dataset[example_number][feature.type()];
+    float & val = value(example_number, feature.type());
     float result = val;
     val = new_value;
     return result;
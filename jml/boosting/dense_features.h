@@ -316,6 +316,18 @@ public:
               const char * data_end,
               std::shared_ptr<Dense_Feature_Space> feature_space);
 
+    /** Save the dataset to the given file in the binary column format.
+        init() recognises those files and maps them into memory instead of
+        parsing them, so that a dataset is ready as soon as it's opened.
+        The values of each feature are stored contiguously, so that only the
+        columns of the features that are indexed are ever read from the
+        disk, and the dataset can be larger than the memory.
+    */
+    void save_columns(const std::string & filename) const;
+
+    /** Is the given file in the binary column format? */
+    static bool is_column_file(const std::string & filename);
+
 private:
     struct Data_Source;
 
@@ -324,6 +336,10 @@ private:
     void init(const std::vector<Data_Source> & data_sources,
               std::shared_ptr<Dense_Feature_Space> feature_space);
 
+    /** Initialise by mapping the given column file. */
+    void init_columns(const std::string & filename,
+                      std::shared_ptr<Dense_Feature_Space> feature_space);
+
 public:
     /** Polymorphic copy. */
     virtual Dense_Training_Data * make_copy() const;
@@ -332,7 +348,7 @@ public:
         doesn't populate it. */
     virtual Dense_Training_Data * make_type() const;
 
-    size_t variable_count() const { return dataset.shape()[1]; }
+    size_t variable_count() const;
 
     virtual size_t row_offset(size_t row) const;
 
@@ -348,6 +364,18 @@ protected:
     /** Dense version of the dataset. */
     boost::multi_array<float, 2> dataset;
 
+    /** The columns of a dataset that was mapped from a column file, in
+        which case dataset is empty. */
+    struct Columns;
+    std::shared_ptr<Columns> columns;
+
+    /** Number of rows in the dataset, whether mapped or not. */
+    size_t row_count() const;
+
+    /** Value of the given variable in the given row. */
+    float & value(size_t row, size_t var);
+    float value(size_t row, size_t var) const;
+
     /** The comment attached to each of the examples. */
     std::vector<std::string> row_comments;
 
@@ -372,8 +400,9 @@ protected:
 class Dense_Feature_Set : public Feature_Set {
 public:
     Dense_Feature_Set(std::shared_ptr<const std::vector<Feature> > features,
-                      const float * values)
-    : features(features), values(values)
+                      const float * values,
+                      int value_stride = sizeof(float))
+    : features(features), values(values), value_stride(value_stride)
     {
     }
 
@@ -383,7 +412,7 @@ public:
     get_data(bool need_sorted = false) const
     {
         return boost::make_tuple
-            (&(*features)[0], values, sizeof(Feature), sizeof(float), 
+            (&(*features)[0], values, sizeof(Feature), value_stride,
              features->size());
     }
 
@@ -393,6 +422,7 @@ public:
 
     std::shared_ptr<const std::vector<Feature> > features;
     const float * values;
+    int value_stride;    ///< Bytes between the values of two features
 
     virtual Dense_Feature_Set * make_copy() const;
 };
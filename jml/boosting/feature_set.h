@@ -58,8 +58,8 @@ struct Feature_Set_Const_Iterator {
     {
         size_t i_f = (size_t)feat;
         size_t i_v = (size_t)val;
-        i_f += feat_stride * num;
-        i_v += val_stride * num;
+        i_f += (ssize_t)feat_stride * num;
+        i_v += (ssize_t)val_stride * num;
         feat = (const Feature *)i_f;
         val = (const float *)i_v;
     }
@@ -17,6 +17,7 @@
 #include <limits>
 #include "jml/utils/vector_utils.h"
 #include "jml/compiler/compiler.h"
+#include "jml/arch/simd_vector.h"
 
 using namespace std;
 using namespace ML::DB;
@@ -161,6 +162,13 @@ GLZ_Classifier::predict(const distribution<float> & features_c,
     return do_predict_impl(&features_c[0], 0);
 }
 
+Label_Dist
+GLZ_Classifier::predict(const float * features_c,
+                        PredictionContext * context) const
+{
+    return do_predict_impl(features_c, 0);
+}
+
 bool
 GLZ_Classifier::
 optimization_supported() const
@@ -312,6 +320,79 @@ do_predict_impl(int label,
     return do_accum(features_c, indexes, label);
 }
 
+void
+GLZ_Classifier::
+predict(const float * features_c, size_t n, size_t stride,
+        float * output) const
+{
+    do_predict_impl(features_c, 0, n, stride, output);
+}
+
+void
+GLZ_Classifier::
+predict(const float * features_c, size_t n, size_t stride,
+        float * output, const Optimization_Info & info) const
+{
+    if (!predict_is_optimized() || !info)
+        throw Exception("GLZ_Classifier::predict(): not optimized");
+
+    /* The vectors are in the order that info maps from, so find where each
+       of our features is in them rather than mapping each vector. */
+    int nout = info.features_out();
+    int from_index[nout];
+    std::fill(from_index, from_index + nout, -1);
+    for (unsigned i = 0;  i < info.indexes.size();  ++i)
+        if (info.indexes[i] != -1)
+            from_index[info.indexes[i]] = i;
+
+    int indexes[features.size()];
+    for (unsigned j = 0;  j < features.size();  ++j) {
+        indexes[j] = from_index[feature_indexes[j]];
+        if (indexes[j] == -1)
+            throw Exception("GLZ_Classifier::predict(): feature "
+                            + feature_space()->print(features[j].feature)
+                            + " isn't in the input vectors");
+    }
+
+    do_predict_impl(features_c, indexes, n, stride, output);
+}
+
+void
+GLZ_Classifier::
+do_predict_impl(const float * features_c,
+                const int * indexes,
+                size_t n, size_t stride,
+                float * output) const
+{
+    int nl = label_count();
+    int nf = features.size();
+
+    enum { BLOCK_SIZE = 16 };
+    float decoded[BLOCK_SIZE * nf];
+    double accum[BLOCK_SIZE];
+
+    for (size_t first = 0;  first < n;  first += BLOCK_SIZE) {
+        int nb = std::min<size_t>(BLOCK_SIZE, n - first);
+
+        for (int i = 0;  i < nb;  ++i) {
+            const float * fv = features_c + (first + i) * stride;
+            for (int j = 0;  j < nf;  ++j) {
+                int idx = (indexes ? indexes[j] : j);
+                decoded[i * nf + j] = decode_value(fv[idx], features[j]);
+            }
+        }
+
+        for (int l = 0;  l < nl;  ++l) {
+            SIMD::vec_dotprod_dp(&weights[l][0], decoded, nf, nb, accum, nf);
+
+            float bias = (add_bias ? weights[l][nf] : 0.0);
+            for (int i = 0;  i < nb;  ++i)
+                output[(first + i) * nl + l]
+                    = apply_link_inverse(accum[i] + bias, link);
+        }
+    }
+}
+
 
 std::vector<ML::Feature>
 GLZ_Classifier::
@@ -108,6 +108,18 @@ public:
     distribution<float> predict(const float * features,
                                 PredictionContext * context = 0) const;
 
+    /** Predict for n mapped feature vectors, the i-th of which starts at
+        features + i * stride, writing label_count() outputs for each one
+        into output.  The vectors are decoded a block at a time and each
+        label's weights are applied to the whole block at once. */
+    void predict(const float * features, size_t n, size_t stride,
+                 float * output) const;
+
+    /** Same, but for vectors in the order given to optimize(), as for the
+        optimized predict. */
+    void predict(const float * features, size_t n, size_t stride,
+                 float * output, const Optimization_Info & info) const;
+
     /** Is optimization supported by the classifier? */
     virtual bool optimization_supported() const;
 
@@ -166,6 +178,12 @@ protected:
                     const float * features,
                     const int * indexes) const;
 
+    void
+    do_predict_impl(const float * features,
+                    const int * indexes,
+                    size_t n, size_t stride,
+                    float * output) const;
+
     // Internal function used to do the actual work
     double
     do_accum(const float * features_c,
@@ -63,7 +63,7 @@ public:
     /** Apply and return a distribution */
     Label_Dist apply(const Split::Weights & weights) const
     {
-        Label_Dist result;
+        Label_Dist result(pred_true.size());
         apply(result, weights);
         return result;
     }
@@ -79,6 +79,8 @@ configure(const Configuration & config)
     config.find(trace,                "trace");
     config.find(update_alg,           "update_alg");
     config.find(ignore_highest,       "ignore_highest");
+    config.find(num_buckets,          "num_buckets");
+    config.find(bucket_density,       "bucket_density");
 }
 
 void
@@ -91,6 +93,8 @@ defaults()
     trace = 0;
     update_alg = Stump::NORMAL;
     ignore_highest = 0.0;
+    num_buckets = 255;
+    bucket_density = 0.2;
 }
 
 Config_Options
@@ -107,6 +111,12 @@ options() const
              "select the harshness of the update algorithm")
         .add("ignore_highest", ignore_highest, "0.0<=N<1.0",
              "ignore the examples witht the highest N% of weights")
+        .add("num_buckets", num_buckets, "2-65535",
+             "number of buckets of the histograms that real features are "
+             "split over")
+        .add("bucket_density", bucket_density, "0.0-1.0",
+             "split the features present in more than this proportion of "
+             "the examples over histograms; 0 for all of them")
         .add("trace", trace, "0-",
              "trace training (very detailed) to given level");
 
@@ -403,6 +413,7 @@ train_all(Thread_Context & context,
         
         Accum accum(feature_space, fair, committee_size, C(), trace);
         Trainer trainer(trace, worker);
+        trainer.set_buckets(num_buckets, bucket_density);
         
         Trainer::Test_All_Job<Accum, LW_Array<const float>, distribution<float> >
             job(features, data, model.predicted(), weights,
@@ -438,6 +449,7 @@ train_all(Thread_Context & context,
         typedef Stump_Trainer_Parallel<W, Z, Stream_Tracer> Trainer;
         Accum accum(feature_space, fair, committee_size, update_alg, trace);
         Trainer trainer(trace, worker);
+        trainer.set_buckets(num_buckets, bucket_density);
 
         Trainer::Test_All_Job<Accum, LW_Array<const float>, distribution<float> >
             job(features, data, model.predicted(), weights,
@@ -471,6 +483,7 @@ train_all(Thread_Context & context,
 
         Accum accum(feature_space, fair, committee_size, update_alg, trace);
         Trainer trainer(trace, worker);
+        trainer.set_buckets(num_buckets, bucket_density);
         
         //cerr << "trainer = " << &trainer << endl;
         //cerr << "accum.tracer() = " << accum.tracer.operator bool() << endl;
@@ -508,6 +521,7 @@ train_all(Thread_Context & context,
             
             Accum accum(feature_space, fair, committee_size, update_alg, trace);
             Trainer trainer(trace, worker);
+            trainer.set_buckets(num_buckets, bucket_density);
             
             Trainer::Test_All_Job<Accum, LW_Array<const float>,
                                   distribution<float> >
@@ -526,6 +540,7 @@ train_all(Thread_Context & context,
             
             Accum accum(feature_space, fair, committee_size, update_alg);
             Trainer trainer(worker);
+            trainer.set_buckets(num_buckets, bucket_density);
 
             Trainer::Test_All_Job<Accum, LW_Array<const float>, distribution<float> >
                 job(features, data, model.predicted(), weights,
@@ -72,6 +72,8 @@ public:
     int committee_size;
     Stump::Update update_alg;
     float feature_prop;
+    int num_buckets;
+    float bucket_density;
 
     /* Once init has been called, we clone our potential models from this
        one. */
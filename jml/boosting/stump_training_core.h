@@ -166,15 +166,47 @@ JML_ALWAYS_INLINE int get_advance(const std::vector<const float *> & weights)
 
 template<class W, class Z, class Tracer=No_Trace>
 struct Stump_Trainer {
-    Stump_Trainer() {}
+    Stump_Trainer()
+        : num_buckets(255), bucket_density(0.2)
+    {
+    }
     
     Stump_Trainer(const Tracer & tracer)
-        : tracer(tracer)
+        : tracer(tracer), num_buckets(255), bucket_density(0.2)
     {
     }
 
     mutable Tracer tracer;  ///< Object to which we trace
 
+    /** Number of buckets that the values of a real feature are binned into
+        when its split point is searched for over a histogram of the
+        buckets, rather than over all of its sorted values.  The buckets
+        are computed once per feature and dataset and cached in the index.
+    */
+    int num_buckets;
+
+    /** The real and boolean features that occur in more than this
+        proportion of the examples are tested over the histogram of their
+        buckets.  A density of 0 tests all of them that way, which trades
+        some accuracy of the split points for much faster training on
+        large datasets.
+    */
+    float bucket_density;
+
+    /** Set up the histogram training from the generator's options. */
+    void set_buckets(int num_buckets, float bucket_density)
+    {
+        this->num_buckets = num_buckets;
+        this->bucket_density = bucket_density;
+    }
+
+    /** Do we search the split of the given feature over its buckets? */
+    bool use_buckets(const Training_Data & data, const Feature & feature) const
+    {
+        return bucket_density <= 0.0
+            || data.index().density(feature) > bucket_density;
+    }
+
     /** This is an object used for example weights which acts as a vector
         of all 1s.  It specifies that each example counts for the same
         amount, without needing to use any memory.
@@ -674,11 +706,11 @@ struct Stump_Trainer {
 
         ++num_boolean;
 
-        /* See if we can do it by buckets.  We only do so if more than 20% of
-           the examples include this feature (otherwise it will probably be
-           slower).
+        /* See if we can do it by buckets.  By default we only do so if more
+           than 20% of the examples include this feature (otherwise it will
+           probably be slower).
         */
-        if (data.index().density(feature) > 0.2)
+        if (use_buckets(data, feature))
             return test_buckets(feature, data, predicted, weights, ex_weights,
                                 default_w, results, 2,
                                 false /* categorical; false since doesn't
@@ -894,15 +926,14 @@ struct Stump_Trainer {
         using namespace std;
         //cerr << "test_real" << endl;
 
-        /* See if we can do it by buckets.  We only do so if more than 20% of
-           the examples include this feature (otherwise it will probably be
-           slower).
+        /* See if we can do it by buckets.  By default we only do so if more
+           than 20% of the examples include this feature (otherwise it will
+           probably be slower).
         */
 
-        if (data.index().density(feature) > 0.2)
+        if (use_buckets(data, feature))
             return test_buckets(feature, data, predicted, weights, ex_weights,
-                                default_w, results,
-                                255 /* num_buckets; TODO: configurable */,
+                                default_w, results, num_buckets,
                                 false /* categorical */,
                                 advance);
 
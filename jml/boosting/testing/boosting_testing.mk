@@ -5,6 +5,8 @@ $(eval $(call test,decision_tree_unlimited_depth_test,boosting utils arch worker
 $(eval $(call test,glz_classifier_test,boosting utils arch worker_task,boost))
 $(eval $(call test,probabilizer_test,boosting utils arch,boost))
 $(eval $(call test,feature_info_test,boosting utils arch,boost))
+$(eval $(call test,compiled_trees_test,boosting utils arch,boost))
+$(eval $(call test,dense_column_file_test,boosting utils arch,boost))
 $(eval $(call test,weighted_training_test,boosting,boost manual))
 
 $(eval $(call program,dataset_nan_test,boosting utils arch boosting_tools))
@@ -0,0 +1,271 @@
+/* compiled_trees_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Test of the compiled tree scorer against the classifiers it's compiled
+   from.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <iostream>
+#include <random>
+
+#include "jml/boosting/compiled_trees.h"
+#include "jml/boosting/decision_tree.h"
+#include "jml/boosting/boosted_stumps.h"
+#include "jml/boosting/committee.h"
+#include "jml/boosting/stump.h"
+#include "jml/boosting/dense_features.h"
+#include "jml/boosting/feature_info.h"
+#include "jml/utils/smart_ptr_utils.h"
+#include "jml/arch/timers.h"
+
+using namespace ML;
+using namespace std;
+
+namespace {
+
+const int nfeatures = 6;
+const int nlabels = 2;
+const float NaN = std::numeric_limits<float>::quiet_NaN();
+
+std::mt19937 rng(42);
+
+float random_val()
+{
+    // Few enough values that some of them are equal to the split points
+    return (rng() % 21) / 4.0 - 2.5;
+}
+
+Label_Dist random_dist()
+{
+    Label_Dist result(nlabels);
+    for (unsigned i = 0;  i < nlabels;  ++i)
+        result[i] = (rng() % 1000) / 500.0 - 1.0;
+    return result;
+}
+
+Split random_split(const Dense_Feature_Space & fs)
+{
+    static const Split::Op ops[3] = { Split::LESS, Split::EQUAL,
+                                      Split::NOT_MISSING };
+    Split::Op op = ops[rng() % 3];
+    Feature feature = fs.features()[1 + rng() % nfeatures];
+    return Split(feature, op == Split::NOT_MISSING ? 0.0 : random_val(), op);
+}
+
+Tree::Ptr random_tree(Tree & tree, const Dense_Feature_Space & fs, int depth)
+{
+    if (depth == 0 || rng() % 8 == 0)
+        return tree.new_leaf(random_dist(), 1.0);
+
+    Tree::Node * node = tree.new_node();
+    node->split = random_split(fs);
+    node->child_true = random_tree(tree, fs, depth - 1);
+    node->child_false = random_tree(tree, fs, depth - 1);
+    // Sometimes leave out the missing branch
+    if (rng() % 2)
+        node->child_missing = random_tree(tree, fs, depth - 1);
+    return node;
+}
+
+std::shared_ptr<Decision_Tree>
+random_decision_tree(std::shared_ptr<Dense_Feature_Space> fs, int depth)
+{
+    auto result = std::make_shared<Decision_Tree>(fs, fs->features()[0]);
+    result->tree.root = random_tree(result->tree, *fs, depth);
+    return result;
+}
+
+std::shared_ptr<Boosted_Stumps>
+random_boosted_stumps(std::shared_ptr<Dense_Feature_Space> fs, int nstumps)
+{
+    auto result = std::make_shared<Boosted_Stumps>(fs, fs->features()[0]);
+    result->bias = random_dist();
+    for (unsigned i = 0;  i < nstumps;  ++i) {
+        Split split = random_split(*fs);
+        result->insert(Stump(fs->features()[0], split.feature(),
+                             split.split_val(),
+                             random_dist(), random_dist(), random_dist(),
+                             Stump::NORMAL, fs));
+    }
+    result->calc_sum_missing();
+    return result;
+}
+
+/** Random feature vectors, with about one value in eight missing. */
+std::vector<float> random_vectors(int n)
+{
+    std::vector<float> result;
+    for (unsigned i = 0;  i < n * nfeatures;  ++i)
+        result.push_back(rng() % 8 == 0 ? NaN : random_val());
+    return result;
+}
+
+struct Fixture {
+    Fixture()
+        : fsp(new Dense_Feature_Space())
+    {
+        fsp->add_feature("LABEL", Feature_Info(BOOLEAN, false, true));
+        for (unsigned i = 0;  i < nfeatures;  ++i)
+            fsp->add_feature(format("feature%d", i), REAL);
+
+        features.assign(fsp->features().begin() + 1, fsp->features().end());
+    }
+
+    std::shared_ptr<Feature_Set> encode(const float * vec)
+    {
+        distribution<float> dist(1 + nfeatures);
+        std::copy(vec, vec + nfeatures, dist.begin() + 1);
+        return fsp->encode(dist);
+    }
+
+    /** Check that the compiled classifier gives the same outputs as the
+        classifier itself. */
+    void check(const Classifier_Impl & classifier)
+    {
+        Compiled_Trees compiled(classifier, features);
+        BOOST_CHECK_EQUAL(compiled.label_count(), nlabels);
+        BOOST_CHECK_EQUAL(compiled.feature_count(), nfeatures);
+
+        int n = 500;
+        std::vector<float> vecs = random_vectors(n);
+
+        // Batch predict, including with a stride that skips values
+        std::vector<float> batch(n * nlabels);
+        compiled.predict(&vecs[0], n, nfeatures, &batch[0]);
+
+        std::vector<float> strided(n * (nfeatures + 1), 1000.0);
+        for (unsigned i = 0;  i < n;  ++i)
+            std::copy(&vecs[i * nfeatures], &vecs[(i + 1) * nfeatures],
+                      &strided[i * (nfeatures + 1)]);
+        std::vector<float> batch2(n * nlabels);
+        compiled.predict(&strided[0], n, nfeatures + 1, &batch2[0]);
+
+        for (unsigned i = 0;  i < n;  ++i) {
+            const float * vec = &vecs[i * nfeatures];
+            Label_Dist expected = classifier.predict(*encode(vec));
+            Label_Dist dist = compiled.predict(vec);
+
+            for (unsigned l = 0;  l < nlabels;  ++l) {
+                BOOST_CHECK_CLOSE(dist[l] + 10.0, expected[l] + 10.0, 1e-3);
+                BOOST_CHECK_CLOSE(compiled.predict(l, vec) + 10.0,
+                                  expected[l] + 10.0, 1e-3);
+                BOOST_CHECK_EQUAL(batch[i * nlabels + l], dist[l]);
+                BOOST_CHECK_EQUAL(batch2[i * nlabels + l], dist[l]);
+            }
+        }
+    }
+
+    std::shared_ptr<Dense_Feature_Space> fsp;
+    std::vector<Feature> features;
+};
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_compiled_decision_tree )
+{
+    Fixture fixture;
+    for (unsigned i = 0;  i < 20;  ++i)
+        fixture.check(*random_decision_tree(fixture.fsp, 6));
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_committee )
+{
+    Fixture fixture;
+
+    Committee committee(fixture.fsp, fixture.fsp->features()[0]);
+    committee.bias = random_dist();
+    for (unsigned i = 0;  i < 50;  ++i)
+        committee.add(random_decision_tree(fixture.fsp, 4),
+                      (rng() % 100) / 100.0);
+    committee.add(random_boosted_stumps(fixture.fsp, 20), 0.5);
+
+    fixture.check(committee);
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_boosted_stumps )
+{
+    Fixture fixture;
+
+    auto stumps = random_boosted_stumps(fixture.fsp, 50);
+    fixture.check(*stumps);
+
+    stumps->output = Boosted_Stumps::LOGIT;
+    fixture.check(*stumps);
+
+    stumps->output = Boosted_Stumps::LOGIT_NORM;
+    fixture.check(*stumps);
+
+    // A transformed output can't be compiled within a committee
+    Committee committee(fixture.fsp, fixture.fsp->features()[0]);
+    committee.add(stumps);
+    BOOST_CHECK_THROW(Compiled_Trees(committee, fixture.features),
+                      Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_missing_feature )
+{
+    Fixture fixture;
+
+    auto tree = random_decision_tree(fixture.fsp, 6);
+    std::vector<Feature> features(fixture.features.begin(),
+                                  fixture.features.begin() + 1);
+    BOOST_CHECK_THROW(Compiled_Trees(*tree, features), Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_trees_speed )
+{
+    Fixture fixture;
+
+    Committee committee(fixture.fsp, fixture.fsp->features()[0]);
+    committee.bias = random_dist();
+    for (unsigned i = 0;  i < 200;  ++i)
+        committee.add(random_decision_tree(fixture.fsp, 6), 0.01);
+
+    int n = 2000;
+    std::vector<float> vecs = random_vectors(n);
+    std::vector<float> output(n * nlabels);
+    double total = 0.0;
+
+    {
+        std::vector<std::shared_ptr<Feature_Set> > fsets;
+        for (unsigned i = 0;  i < n;  ++i)
+            fsets.push_back(fixture.encode(&vecs[i * nfeatures]));
+
+        Timer timer;
+        for (unsigned i = 0;  i < n;  ++i)
+            total += committee.predict(*fsets[i])[0];
+        cerr << "predict: " << timer.elapsed() << endl;
+    }
+
+    {
+        Optimization_Info info = committee.optimize(fixture.features);
+
+        Timer timer;
+        for (unsigned i = 0;  i < n;  ++i)
+            total += committee.predict(&vecs[i * nfeatures], info)[0];
+        cerr << "optimized predict: " << timer.elapsed() << endl;
+    }
+
+    {
+        Timer timer;
+        Compiled_Trees compiled(committee, fixture.features);
+        cerr << "compile: " << timer.elapsed() << endl;
+
+        timer.restart();
+        for (unsigned i = 0;  i < n;  ++i)
+            total += compiled.predict(&vecs[i * nfeatures])[0];
+        cerr << "compiled predict: " << timer.elapsed() << endl;
+
+        timer.restart();
+        compiled.predict(&vecs[0], n, nfeatures, &output[0]);
+        cerr << "compiled batch predict: " << timer.elapsed() << endl;
+    }
+
+    cerr << "total " << total << endl;
+}
@@ -82,3 +82,64 @@ BOOST_AUTO_TEST_CASE( test_decision_tree_multithreaded1 )
 
     generator.generate(context, data, training_weights, features);
 }
+
+BOOST_AUTO_TEST_CASE( test_decision_tree_regression_buckets )
+{
+    /* A step function, learnt by a regression tree that searches all of
+       the features over a histogram of a few buckets. */
+
+    Dense_Feature_Space fs;
+    fs.add_feature("LABEL", Feature_Info(REAL, false, true));
+    fs.add_feature("feature1", REAL);
+    fs.add_feature("feature2", REAL);
+
+    std::shared_ptr<Dense_Feature_Space> fsp(make_unowned_sp(fs));
+
+    Training_Data data(fsp);
+
+    int nfv = 10000;
+
+    for (unsigned i = 0;  i < nfv;  ++i) {
+        distribution<float> features;
+        features.push_back(i < 2500 ? 1.0 : (i < 7500 ? 5.0 : 2.0));
+        features.push_back(i);
+        features.push_back(i % 7);
+
+        data.add_example(fs.encode(features));
+    }
+
+    Configuration config;
+    config.parse_string("trace=0\nmax_depth=3\n"
+                        "bucket_density=0\nnum_buckets=16\n",
+                        "inbuilt config file");
+
+    Decision_Tree_Generator generator;
+    generator.configure(config);
+    generator.init(fsp, fs.features()[0]);
+
+    BOOST_CHECK_EQUAL(generator.num_buckets, 16);
+    BOOST_CHECK_EQUAL(generator.bucket_density, 0.0);
+
+    distribution<float> training_weights(nfv, 1);
+
+    vector<Feature> features = fs.features();
+    features.erase(features.begin(), features.begin() + 1);
+
+    Thread_Context context;
+
+    std::shared_ptr<Classifier_Impl> tree
+        = generator.generate(context, data, training_weights, features);
+
+    /* The 16 buckets hold 625 values each, and the steps are on bucket
+       boundaries. */
+    for (unsigned i = 125;  i < nfv;  i += 250) {
+        distribution<float> features;
+        features.push_back(0);
+        features.push_back(i);
+        features.push_back(i % 7);
+
+        float expected = i < 2500 ? 1.0 : (i < 7500 ? 5.0 : 2.0);
+        BOOST_CHECK_CLOSE(tree->predict(0, *fs.encode(features)),
+                          expected, 1e-3);
+    }
+}
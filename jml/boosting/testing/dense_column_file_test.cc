@@ -0,0 +1,77 @@
+/* dense_column_file_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Test of the memory mapped column format of the dense training data.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+#include <sstream>
+
+#include "jml/boosting/dense_features.h"
+#include "jml/boosting/training_index.h"
+#include "jml/utils/guard.h"
+
+using namespace ML;
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( test_column_file_round_trip )
+{
+    string filename = "build/x86_64/tmp/dense_column_file_test.cols";
+    Call_Guard guard([&] () { unlink(filename.c_str()); });
+
+    /* More rows than are transposed at once, with a categorical feature. */
+    size_t nx = 70000;
+    std::ostringstream text;
+    text << "LABEL:k=BOOLEAN x y colour" << endl;
+    const char * colours[3] = { "red", "green", "blue" };
+    for (unsigned i = 0;  i < nx;  ++i)
+        text << (i % 2) << " " << i * 0.5 << " " << (i % 7) << " "
+             << colours[i % 3] << endl;
+    string str = text.str();
+
+    Dense_Training_Data data;
+    data.init(str.c_str(), str.c_str() + str.size());
+    BOOST_REQUIRE_EQUAL(data.example_count(), nx);
+
+    BOOST_CHECK(!Dense_Training_Data::is_column_file(filename));
+    data.save_columns(filename);
+    BOOST_CHECK(Dense_Training_Data::is_column_file(filename));
+
+    std::shared_ptr<Dense_Feature_Space> fs(new Dense_Feature_Space());
+    Dense_Training_Data mapped(filename, fs);
+
+    BOOST_REQUIRE_EQUAL(mapped.example_count(), nx);
+    BOOST_CHECK_EQUAL(mapped.variable_count(), 4);
+    BOOST_CHECK(fs->feature_names()
+                == vector<string>({ "LABEL", "x", "y", "colour" }));
+    BOOST_CHECK_EQUAL(fs->info(fs->get_feature("colour")).type(), CATEGORICAL);
+
+    for (unsigned i = 0;  i < nx;  i += 997) {
+        const Feature_Set & row = mapped[i];
+        BOOST_REQUIRE_EQUAL(row.size(), 4);
+        for (unsigned v = 0;  v < 4;  ++v)
+            BOOST_CHECK_EQUAL(row[Feature(v)], data[i][Feature(v)]);
+    }
+    BOOST_CHECK_EQUAL(fs->print(Feature(3), mapped[4][Feature(3)]), "green");
+
+    /* The index is built from the columns */
+    BOOST_CHECK_EQUAL(mapped.index().count(Feature(1)), nx);
+    BOOST_CHECK_EQUAL(mapped.index().range(Feature(1)).second,
+                      (nx - 1) * 0.5);
+
+    /* Writes go to our copy of the pages, not to the file */
+    BOOST_CHECK_EQUAL(mapped.modify_feature(10, Feature(2), 100.0), 3.0);
+    BOOST_CHECK_EQUAL(mapped[10][Feature(2)], 100.0);
+    BOOST_CHECK_EQUAL(Dense_Training_Data(filename)[10][Feature(2)], 3.0);
+
+    /* A feature space that doesn't match is rejected */
+    std::shared_ptr<Dense_Feature_Space> other(new Dense_Feature_Space());
+    other->add_feature("LABEL", BOOLEAN);
+    Dense_Training_Data other_data;
+    BOOST_CHECK_THROW(other_data.init(filename, other), std::exception);
+}
@@ -164,6 +164,32 @@ BOOST_AUTO_TEST_CASE( test_glz_classifier_missing )
     Optimization_Info info = classifier->optimize(fs.features());
 
     BOOST_CHECK(info);
+
+    // Check that the batch predict gives the same as one at a time
+    const GLZ_Classifier & glz
+        = dynamic_cast<const GLZ_Classifier &>(*classifier);
+
+    int n = 37;
+    vector<float> vecs;
+    for (unsigned i = 0;  i < n;  ++i) {
+        vecs.push_back(i % 3 == 0);  // label; not used
+        vecs.push_back(i % 2 == 0 ? (i % 3 == 0) : NaN);
+        vecs.push_back(i % 2 == 1 ? (i % 3 == 0) : NaN);
+        vecs.push_back(i % 5 == 0);
+    }
+
+    vector<float> output(n * 2), output2(n * 2);
+    glz.predict(&vecs[1], n, 4, &output[0]);
+    glz.predict(&vecs[0], n, 4, &output2[0], info);
+
+    for (unsigned i = 0;  i < n;  ++i) {
+        Label_Dist expected = glz.predict(&vecs[i * 4 + 1]);
+        Label_Dist expected2 = classifier->predict(&vecs[i * 4], info);
+        for (unsigned l = 0;  l < 2;  ++l) {
+            BOOST_CHECK_CLOSE(output[i * 2 + l], expected[l], 1e-4);
+            BOOST_CHECK_CLOSE(output2[i * 2 + l], expected2[l], 1e-4);
+        }
+    }
 }
 
 BOOST_AUTO_TEST_CASE( test_glz_classifier_missing2 )
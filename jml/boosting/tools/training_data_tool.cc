@@ -231,6 +231,7 @@ try
     int verbosity           = 1;
     bool is_regression      = false;   // Set to be a regression?
     bool by_label           = false;
+    string column_file;
 
     vector<string> dataset_files;
 
@@ -253,7 +254,10 @@ try
             ( "dataset", value<vector<string> >(&dataset_files),
               "datasets to process" )
             ( "by-label", value<bool>(&by_label)->zero_tokens(),
-              "further break down stats by label");
+              "further break down stats by label")
+            ( "save-columns,C", value<string>(&column_file),
+              "save the dataset to FILE in the binary column format, which "
+              "is memory mapped when loaded" );
 
         output_options.add_options()
             ( "verbosity,v", value(&verbosity),
@@ -287,6 +291,9 @@ try
     if (dataset_files.empty())
         throw Exception("error: need to specify at least one data set");
 
+    if (column_file != "" && dataset_files.size() != 1)
+        throw Exception("error: can only save one data set to a column file");
+
     /* Variables for holding our datasets and feature spaces. */
     vector<std::shared_ptr<Dense_Training_Data> > data(dataset_files.size());
     vector<std::shared_ptr<Dense_Feature_Space> > fs(dataset_files.size());
@@ -301,6 +308,9 @@ try
         data[i].reset(new Dense_Training_Data());
         data[i]->init(dataset_files[i], fs[i]);
 
+        if (column_file != "")
+            data[i]->save_columns(column_file);
+
         if (verbosity > 0)
             cout << "dataset \'" << dataset_files[i] << "\': "
                  << data[i]->all_features().size() << " features, "
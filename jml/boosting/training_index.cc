@@ -82,7 +82,6 @@ init(const Training_Data & data,
         for (Feature_Set::const_iterator it = fs.begin();
              it != fs.end();  ++it, ++i) {
             const Feature & feat = it.feature();
-            float val = it.value();
 
 #if 0 // debugging sort() problem               
             if (doneFeatures.count(feat)) {
@@ -105,10 +104,13 @@ init(const Training_Data & data,
 #endif
 
             /* Save a map lookup for the common case of always the same
-               features or always the same ones at the start. */
+               features or always the same ones at the start.  The values
+               of the features that aren't indexed aren't read, so that the
+               columns of a mapped dataset that aren't needed aren't paged
+               in. */
             if (i < features.size() && features[i] == feat) {
                 if (entries[i]->used)
-                    entries[i]->insert(val, x, nx, sparse, fs);
+                    entries[i]->insert(it.value(), x, nx, sparse, fs);
             }
             else {
                 Index_Entry & entry = itl->index[feat];
@@ -119,7 +121,7 @@ init(const Training_Data & data,
                     entry.feature_space = itl->feature_space;
                 }
                 if (entry.used)
-                    entry.insert(val, x, nx, sparse, fs);
+                    entry.insert(it.value(), x, nx, sparse, fs);
             }
         }
     }
@@ -0,0 +1,130 @@
+/* arena.h                                                         -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Monotonic allocator for objects that all die at the same time.
+*/
+
+#ifndef __utils__arena_h__
+#define __utils__arena_h__
+
+#include "jml/arch/spinlock.h"
+#include "jml/arch/exception.h"
+#include <mutex>
+#include <utility>
+#include <cstdlib>
+#include <stdint.h>
+
+namespace ML {
+
+
+/*****************************************************************************/
+/* ARENA                                                                     */
+/*****************************************************************************/
+
+/** Bump allocator where individual allocations are never freed; all the
+    memory is released at once by reset() or when the arena is destroyed.
+    The first InlineSize bytes are stored within the arena itself so that
+    small object graphs don't touch the heap at all.
+
+    Destructors of the objects created in the arena are NOT called by the
+    arena; that's the responsability of the owner.
+
+    allocate() and create() are thread safe while reset() is not.
+*/
+template<size_t InlineSize = 512>
+struct Arena {
+
+    enum { DefaultAlignment = 16, BlockSize = 4096 };
+
+    Arena()
+        : blocks(0), pos(inlineBlock), end(inlineBlock + InlineSize)
+    {
+    }
+
+    ~Arena()
+    {
+        freeBlocks();
+    }
+
+    Arena(const Arena &) = delete;
+    Arena & operator = (const Arena &) = delete;
+
+    void * allocate(size_t size, size_t alignment = DefaultAlignment)
+    {
+        std::lock_guard<Spinlock> guard(lock);
+
+        char * p = align(pos, alignment);
+        if (p + size > end)
+            p = newBlock(size, alignment);
+
+        pos = p + size;
+        return p;
+    }
+
+    template<typename T, typename... Args>
+    T * create(Args &&... args)
+    {
+        void * mem = allocate(sizeof(T), alignof(T));
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    /** Releases all the memory of the arena. Not thread safe. */
+    void reset()
+    {
+        freeBlocks();
+        pos = inlineBlock;
+        end = inlineBlock + InlineSize;
+    }
+
+    /** Whether everything allocated so far fit in the inline storage. */
+    bool isInline() const { return !blocks; }
+
+private:
+
+    struct Block {
+        Block * next;
+    };
+
+    static char * align(char * p, size_t alignment)
+    {
+        uintptr_t val = (uintptr_t)p;
+        return (char *)((val + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    }
+
+    char * newBlock(size_t size, size_t alignment)
+    {
+        size_t needed = sizeof(Block) + alignment + size;
+        size_t blockSize = needed > BlockSize ? needed : BlockSize;
+
+        Block * block = (Block *)malloc(blockSize);
+        if (!block)
+            throw Exception("couldn't allocate arena block");
+
+        block->next = blocks;
+        blocks = block;
+
+        char * start = (char *)block;
+        end = start + blockSize;
+        return align(start + sizeof(Block), alignment);
+    }
+
+    void freeBlocks()
+    {
+        while (blocks) {
+            Block * next = blocks->next;
+            free(blocks);
+            blocks = next;
+        }
+    }
+
+    char inlineBlock[InlineSize] __attribute__((__aligned__(DefaultAlignment)));
+    Block * blocks;
+    char * pos;
+    char * end;
+    Spinlock lock;
+};
+
+} // namespace ML
+
+#endif /* __utils__arena_h__ */
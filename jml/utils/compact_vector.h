@@ -9,6 +9,9 @@
 
    Conforms to the interface of std::vector and has iterator validity
    guarantees that are at least as strong.
+
+   Trivially copyable elements are moved around with memcpy when the vector
+   grows or changes storage.
 */
 
 #ifndef __utils__compact_vector_h__
@@ -25,6 +28,8 @@
 #include <algorithm>
 #include <utility>
 #include <initializer_list>
+#include <type_traits>
+#include <cstring>
 #include <stdint.h>
 
 namespace ML {
@@ -45,6 +50,11 @@ public:
     typedef Data & reference;
     typedef const Data & const_reference;
     enum { Internal = Internal_ };
+
+    /** Whether the elements can be moved to new memory by copying their
+        bytes.
+    */
+    enum { Relocatable = std::is_trivially_copyable<Data>::value };
     
     compact_vector()
         : size_(0), is_internal_(true)
@@ -93,9 +103,7 @@ public:
         : size_(other.size_), is_internal_(other.is_internal_)
     {
         if (other.is_internal_) {
-            uninitialized_move_and_destroy(other.internal(),
-                                           other.internal() + other.size_,
-                                           internal());
+            relocate(other.internal(), other.size_, internal());
         }
         else {
             ext.pointer_ = other.ext.pointer_;
@@ -116,7 +124,7 @@ public:
 
     compact_vector & operator = (compact_vector && other)
     {
-        compact_vector new_me(other);
+        compact_vector new_me(std::move(other));
         swap(new_me);
         return *this;
     }
@@ -145,16 +153,13 @@ public:
             for (size_type i = 0;  i < size() && i < other.size();  ++i)
                 std::swap(internal()[i], other.internal()[i]);
 
-            // Copy leftovers
-            for (size_type i = size();  i < other.size();  ++i) {
-                new (internal() + i) Data(other.internal()[i]);
-                other.internal()[i].~Data();
-            }
-
-            for (size_type i = other.size();  i < size();  ++i) {
-                new (other.internal() + i) Data(internal()[i]);
-                internal()[i].~Data();
-            }
+            // Move leftovers
+            if (size() < other.size())
+                relocate(other.internal() + size(), other.size() - size(),
+                         internal() + size());
+            else if (other.size() < size())
+                relocate(internal() + other.size(), size() - other.size(),
+                         other.internal() + other.size());
             
             swap_size(other);
             
@@ -176,9 +181,8 @@ public:
 
         other.is_internal_ = true;
 
-        // Initialize and copy the internal elements for the other one
-        uninitialized_move_and_destroy(internal(), internal() + size_,
-                                       other.internal());
+        // Move the internal elements across to the other one
+        relocate(internal(), size_, other.internal());
         
         is_internal_ = false;
         swap_size(other);
@@ -216,8 +220,7 @@ public:
         to_alloc = std::min<size_t>(to_alloc, max_size());
 
         compact_vector new_me;
-        // new_me.init_move(begin(), end(), to_alloc);
-        new_me.init_copy(begin(), end(), to_alloc);
+        new_me.init_move(data(), data() + size_, to_alloc);
         swap(new_me);
     }
 
@@ -239,8 +242,7 @@ public:
         if  (!is_internal() && new_size <= Internal) {
             // Need to convert to internal representation
             compact_vector new_me;
-            // new_me.init_move((begin(), begin() + new_size, new_size);
-            new_me.init_copy(begin(), begin() + new_size, new_size);
+            new_me.init_move(data(), data() + new_size, new_size);
             
             swap(new_me);
             return;
@@ -255,8 +257,8 @@ public:
     template<typename... Args>
     void emplace_back(Args&&... args)
     {
-        if (size_ >= capacity())
-            reserve(size_ * 2);
+        if (JML_UNLIKELY(size_ >= capacity()))
+            reserve(size_ + 1);
 
         new (data() + size_) Data(std::forward<Args>(args)...);
         ++size_;
@@ -272,6 +274,26 @@ public:
         emplace_back(d);
     }
 
+    /** Append the elements in [first, last) with a single check for
+        growth, rather than one per element as with push_back().
+    */
+    template<class ForwardIterator>
+    void append(ForwardIterator first, ForwardIterator last)
+    {
+        size_t n = std::distance(first, last);
+        if (size_ + n > capacity())
+            reserve(size_ + n);
+
+        Data * p = data() + size_;
+        for (; first != last;  ++first, ++p, ++size_)
+            new (p) Data(*first);
+    }
+
+    void append(std::initializer_list<Data> list)
+    {
+        append(list.begin(), list.end());
+    }
+
     void pop_back()
     {
         if (Safe && empty())
@@ -299,6 +321,12 @@ public:
     iterator insert(iterator pos,
                     ForwardIterator f, ForwardIterator l)
     {
+        if (pos == end()) {
+            size_type index = size_;
+            append(f, l);
+            return begin() + index;
+        }
+
         size_type nelements = std::distance(f, l);
 
         iterator result = start_insert(pos, nelements);
@@ -499,22 +527,43 @@ private:
         }
     }
 
-#if 0 // Enable once our g++ version supports std::move_if_noexcept
-    template<class InputIterator>
-    void init_move(InputIterator first, InputIterator last, size_t to_alloc)
+    /** Initialize from the elements of another vector, which are left
+        moved from (or copied, when their move could throw).
+    */
+    void init_move(Data * first, Data * last, size_t to_alloc)
     {
         init(to_alloc);
 
+        size_t n = last - first;
+        if (Safe && n > to_alloc)
+            throw Exception("compact_vector: internal logic error in init()");
+
         Data * p = data();
 
+        if (Relocatable) {
+            if (n) std::memcpy((void *)p, (const void *)first, n * sizeof(Data));
+            size_ = n;
+            return;
+        }
+
         // Move the objects across into the uninitialized memory
-        for (; first != last;  ++first, ++p, ++size_) {
-            if (Safe && size_ > to_alloc)
-                throw Exception("compact_vector: internal logic error in init()");
+        for (; first != last;  ++first, ++p, ++size_)
             new (p) Data(std::move_if_noexcept(*first));
+    }
+
+    /** Move n elements to uninitialized memory, destroying the originals. */
+    static void relocate(Data * from, size_t n, Data * to)
+    {
+        if (Relocatable) {
+            if (n) std::memcpy((void *)to, (const void *)from, n * sizeof(Data));
+            return;
+        }
+
+        for (size_t i = 0;  i < n;  ++i) {
+            new (to + i) Data(std::move(from[i]));
+            from[i].~Data();
         }
     }
-#endif
 
     void swap_size(compact_vector & other)
     {
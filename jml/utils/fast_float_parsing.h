@@ -25,6 +25,7 @@
 
 
 #include "jml/utils/parse_context.h"
+#include "jml/utils/fast_int_parsing.h"
 #include <limits>
 #include <errno.h>
 
@@ -84,6 +85,68 @@ exp10_int(int val)
     return result;
 }
 
+/** Parses a plain decimal number (sign, digits, fraction and a short
+    exponent) from the block of memory starting at p, advancing p past it.
+
+    It only succeeds when the digits fit exactly in a double and the power
+    of ten does too, in which case a single multiply or divide gives the
+    correctly rounded result.  Anything else (nan, inf, long mantissas or
+    large exponents) is left for match_float() to deal with.
+*/
+inline bool match_simple_double(const char * & p, const char * end,
+                                double & result)
+{
+    static const double exact_exp10[23] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+        1e22
+    };
+
+    const char * q = p;
+
+    bool negative = false;
+    if (q < end && (*q == '+' || *q == '-'))
+        negative = *q++ == '-';
+
+    unsigned long long mantissa = 0;
+    int digits = match_digits(q, end, mantissa);
+    int exponent = 0;
+
+    if (q < end && *q == '.') {
+        ++q;
+        int fraction = match_digits(q, end, mantissa);
+        digits += fraction;
+        exponent = -fraction;
+    }
+
+    if (digits == 0 || digits > 19)
+        return false;
+
+    if (q < end && (*q == 'e' || *q == 'E')) {
+        ++q;
+        bool negativeExponent = false;
+        if (q < end && (*q == '+' || *q == '-'))
+            negativeExponent = *q++ == '-';
+
+        unsigned long long e10 = 0;
+        int expDigits = match_digits(q, end, e10);
+        if (expDigits == 0 || expDigits > 4)
+            return false;
+        exponent += negativeExponent ? -(int)e10 : (int)e10;
+    }
+
+    if (mantissa > (1ULL << 53) || exponent < -22 || exponent > 22)
+        return false;
+
+    double value = mantissa;
+    if (exponent < 0) value /= exact_exp10[-exponent];
+    else value *= exact_exp10[exponent];
+
+    result = negative ? -value : value;
+    p = q;
+    return true;
+}
+
 template<typename Float>
 inline bool match_float(Float & result, Parse_Context & c)
 {
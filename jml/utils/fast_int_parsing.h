@@ -24,7 +24,9 @@
 #define __utils__fast_int_parsing_h__
 
 #include "jml/utils/parse_context.h"
+#include "jml/arch/arch.h"
 #include <iostream>
+#include <cstring>
 
 using namespace std;
 
@@ -218,6 +220,63 @@ inline bool match_long_long(long long int & result, Parse_Context & c)
     return true;
 }
 
+/*****************************************************************************/
+/* DIGIT RUNS                                                                */
+/*****************************************************************************/
+
+/** These work straight on a block of memory, for the fast paths of the
+    Parse_Context matchers that can see a whole number in their buffer.
+*/
+
+#if JML_INTEL_ISA
+
+/** Are the eight characters packed (little endian) into x all digits? */
+inline bool is_eight_digits(uint64_t x)
+{
+    return (x & 0xF0F0F0F0F0F0F0F0ULL) == 0x3030303030303030ULL
+        && ((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL)
+            == 0x3030303030303030ULL;
+}
+
+/** Value of the eight digits packed into x, combining them in pairs, then
+    in fours and then in eights with a multiply each time.
+*/
+inline uint64_t parse_eight_digits(uint64_t x)
+{
+    x = (x & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+    x = (x & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+    return (x & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32;
+}
+
+#endif // JML_INTEL_ISA
+
+/** Accumulates the run of digits starting at p into val, advancing p past
+    them.  Returns the number of digits in the run; past 19 of them val may
+    have overflowed and only the count is meaningful.
+*/
+inline int match_digits(const char * & p, const char * end,
+                        unsigned long long & val)
+{
+    const char * start = p;
+
+#if JML_INTEL_ISA
+    while (end - p >= 8) {
+        uint64_t x;
+        std::memcpy(&x, p, 8);
+        if (!is_eight_digits(x)) break;
+        val = val * 100000000ULL + parse_eight_digits(x);
+        p += 8;
+    }
+#endif // JML_INTEL_ISA
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        val = val * 10 + (*p - '0');
+        ++p;
+    }
+
+    return p - start;
+}
+
 } // namespace ML
 
 #endif /* __utils__fast_int_parsing_h__ */
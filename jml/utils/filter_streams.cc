@@ -33,7 +33,9 @@
 #include "jml/arch/exception.h"
 #include "jml/arch/format.h"
 #include "string_functions.h"
+#include "file_functions.h"
 #include <errno.h>
+#include <sys/stat.h>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
@@ -455,6 +457,55 @@ status() const
 }
 
 
+/*****************************************************************************/
+/* MAPPED STREAMBUF                                                          */
+/*****************************************************************************/
+
+namespace {
+
+/** Streambuf whose get area is the whole of a memory mapped file, so that
+    reading from it never needs a system call nor a copy into a buffer.
+*/
+
+struct MappedStreambuf : public std::streambuf {
+    MappedStreambuf(const std::string & filename)
+        : buffer(filename)
+    {
+        char * start = const_cast<char *>(buffer.start());
+        setg(start, start, start + buffer.size());
+    }
+
+    File_Read_Buffer buffer;
+
+protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which)
+    {
+        if (!(which & ios_base::in))
+            return pos_type(off_type(-1));
+
+        off_type pos = off;
+        if (dir == ios_base::cur)
+            pos += gptr() - eback();
+        else if (dir == ios_base::end)
+            pos += egptr() - eback();
+
+        if (pos < 0 || pos > egptr() - eback())
+            return pos_type(off_type(-1));
+
+        setg(eback(), eback() + pos, egptr());
+        return pos_type(pos);
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which)
+    {
+        return seekoff(off_type(pos), ios_base::beg, which);
+    }
+};
+
+} // file scope
+
+
 /*****************************************************************************/
 /* FILTER_ISTREAM                                                            */
 /*****************************************************************************/
@@ -473,6 +524,15 @@ filter_istream(const std::string & file, std::ios_base::openmode mode,
     open(file, mode, compression);
 }
 
+filter_istream::
+filter_istream(const std::string & uri,
+               const std::map<std::string, std::string> & options)
+    : istream(std::cin.rdbuf()),
+      deferredFailure(false)
+{
+    open(uri, options);
+}
+
 filter_istream::
 filter_istream(filter_istream && other) noexcept
     : istream(other.rdbuf()),
@@ -513,18 +573,34 @@ filter_istream::
 open(const std::string & uri,
      std::ios_base::openmode mode,
      const std::string & compression)
+{
+    open(uri, createOptions(mode, compression, -1));
+}
+
+void
+filter_istream::
+open(const std::string & uri,
+     const std::map<std::string, std::string> & options)
 {
     exceptions(ios::badbit);
 
     string scheme, resource;
     std::tie(scheme, resource) = getScheme(uri);
 
+    std::ios_base::openmode mode = getMode(options);
+    if (!mode)
+        mode = std::ios_base::in;
+
+    string compression;
+    auto it = options.find("compression");
+    if (it != options.end())
+        compression = it->second;
+
     const auto & handler = getUriHandler(scheme);
     std::streambuf * buf;
     bool weOwnBuf;
     auto onException = [&]() { this->deferredFailure = true; };
-    std::tie(buf, weOwnBuf) = handler(scheme, resource, mode,
-                                      createOptions(mode, compression, -1),
+    std::tie(buf, weOwnBuf) = handler(scheme, resource, mode, options,
                                       onException);
 
     openFromStreambuf(buf, weOwnBuf, resource, compression);
@@ -566,6 +642,15 @@ openFromStreambuf(std::streambuf * buf,
                      && (ends_with(resource, ".lz4")
                          || ends_with(resource, ".lz4~"))));
 
+    if (!gzip && !bzip2 && !lzma && !lz4
+        && dynamic_cast<MappedStreambuf *>(buf)) {
+        // Nothing to filter: read straight from the mapped pages
+        this->stream.reset();
+        this->sink = std::move(sink);
+        rdbuf(buf);
+        return;
+    }
+
     if (gzip) new_stream->push(gzip_decompressor());
     if (bzip2) new_stream->push(bzip2_decompressor());
     if (lzma) new_stream->push(lzma_decompressor());
@@ -597,6 +682,16 @@ close()
     }
 }
 
+std::pair<const char *, size_t>
+filter_istream::
+mapped() const
+{
+    auto buf = dynamic_cast<const MappedStreambuf *>(rdbuf());
+    if (!buf)
+        return make_pair(nullptr, 0);
+    return make_pair(buf->buffer.start(), buf->buffer.size());
+}
+
 string
 filter_istream::
 readAll()
@@ -661,6 +756,17 @@ struct RegisterFileHandler {
         if (mode == ios::in) {
             if (resource == "-")
                 return make_pair(cin.rdbuf(), false);
+
+            // Only regular files can be mapped; anything else is read
+            auto it = options.find("mapped");
+            struct stat stats;
+            if (it != options.end()
+                && (it->second == "true" || it->second == "1")
+                && stat(resource.c_str(), &stats) == 0
+                && S_ISREG(stats.st_mode)) {
+                return make_pair(new MappedStreambuf(resource), true);
+            }
+
             unique_ptr<std::filebuf> buf(new std::filebuf);
             buf->open(resource, ios_base::openmode(mode));
 
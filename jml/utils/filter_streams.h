@@ -136,6 +136,12 @@ public:
                    std::ios_base::openmode mode = std::ios_base::in,
                    const std::string & compression = "");
 
+    /* The options are passed on to the uri handler; for example s3 takes
+       "num-threads" and "max-buffer" (bytes) for its parallel reads, and
+       local files take "mapped" to be read through mmap (see mapped()). */
+    filter_istream(const std::string & uri,
+                   const std::map<std::string, std::string> & options);
+
     filter_istream(filter_istream && other) noexcept;
 
     filter_istream & operator = (filter_istream && other);
@@ -146,6 +152,9 @@ public:
               std::ios_base::openmode mode = std::ios_base::in,
               const std::string & comparession = "");
 
+    void open(const std::string & uri,
+              const std::map<std::string, std::string> & options);
+
     void openFromStreambuf(std::streambuf * buf,
                            bool weOwnBuf,
                            const std::string & resource = "",
@@ -156,6 +165,14 @@ public:
     /* read the entire stream into a std::string */
     std::string readAll();
 
+    /* When a local file that isn't compressed was opened with the "mapped"
+       option, returns its contents as they are mapped in memory, which
+       remain valid until the stream is closed; otherwise returns a null
+       pointer.  Reading from the stream doesn't change what is returned,
+       so the data can be split and parsed in place instead of through
+       getline(). */
+    std::pair<const char *, size_t> mapped() const;
+
 private:
     std::unique_ptr<std::istream> stream;
     std::unique_ptr<std::streambuf> sink;
@@ -0,0 +1,721 @@
+/* group_hash.h                                                    -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Open addressing hash map and set that probe a group of buckets at once.
+*/
+
+#ifndef __jml__utils__group_hash_h__
+#define __jml__utils__group_hash_h__
+
+#include "jml/utils/lightweight_hash.h"
+#include "jml/arch/arch.h"
+#include "jml/arch/bitops.h"
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+
+#if JML_INTEL_ISA
+#  include <emmintrin.h>
+#endif
+
+namespace ML {
+
+
+/*****************************************************************************/
+/* GROUP HASH GROUP                                                          */
+/*****************************************************************************/
+
+/** A group of control bytes, one per bucket, that are compared together.
+    A full bucket has the 7 low bits of the hash of its key as its control
+    byte, which leaves the sign bit to mark the empty and deleted ones.  One
+    16 byte SSE2 compare then tells which of a group of buckets may hold a
+    key, and the key itself only needs to be compared in those.
+*/
+struct Group_Hash_Group {
+
+    enum {
+        Width = 16
+    };
+
+    enum Control : int8_t {
+        EMPTY = -128,
+        DELETED = -2
+    };
+
+    /** Loads the Width control bytes from ctrl onwards. */
+    explicit Group_Hash_Group(const int8_t * ctrl)
+    {
+#if JML_INTEL_ISA
+        bytes = _mm_loadu_si128((const __m128i *)ctrl);
+#else
+        std::memcpy(bytes, ctrl, Width);
+#endif
+    }
+
+    /** Mask of the buckets with the given control byte. */
+    uint32_t match(int8_t control) const
+    {
+#if JML_INTEL_ISA
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(control),
+                                                bytes));
+#else
+        uint32_t result = 0;
+        for (unsigned i = 0;  i < Width;  ++i)
+            result |= uint32_t(bytes[i] == control) << i;
+        return result;
+#endif
+    }
+
+    uint32_t matchEmpty() const
+    {
+        return match(EMPTY);
+    }
+
+    /** Mask of the buckets that a new entry can go in. */
+    uint32_t matchEmptyOrDeleted() const
+    {
+#if JML_INTEL_ISA
+        return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), bytes));
+#else
+        uint32_t result = 0;
+        for (unsigned i = 0;  i < Width;  ++i)
+            result |= uint32_t(bytes[i] < -1) << i;
+        return result;
+#endif
+    }
+
+#if JML_INTEL_ISA
+    __m128i bytes;
+#else
+    int8_t bytes[Width];
+#endif
+};
+
+
+/*****************************************************************************/
+/* GROUP HASH BASE                                                           */
+/*****************************************************************************/
+
+/** Table shared by Group_Hash and Group_Hash_Set.  The buckets are probed
+    a group at a time, starting from the one the hash points to and then
+    with growing steps, until a group has a match or an empty bucket.  As
+    the groups don't need to be aligned, the first group of control bytes
+    is repeated after the last one, and so a group that wraps around can
+    still be loaded in one go.
+
+    The table is kept no more than 7/8 full, counting the buckets left
+    deleted by erase(), so that there is always an empty bucket to end the
+    probes.  Unlike Lightweight_Hash, no key value needs to be reserved to
+    mark the empty buckets.
+
+    The control bytes and the buckets are one block of memory that comes
+    from a char allocator, which the copies of the table share.
+*/
+template<class Key, class Bucket, class Ops, class Hash,
+         class Alloc = std::allocator<char> >
+struct Group_Hash_Base {
+
+    typedef Group_Hash_Group Group;
+
+    explicit Group_Hash_Base(const Alloc & alloc = Alloc())
+        : ctrl_(0), buckets_(0), capacity_(0), size_(0), growthLeft_(0),
+          alloc_(alloc)
+    {
+    }
+
+    template<class Iterator>
+    Group_Hash_Base(Iterator first, Iterator last, size_t capacity = 0)
+        : ctrl_(0), buckets_(0), capacity_(0), size_(0), growthLeft_(0)
+    {
+        reserve(capacity ? capacity : std::distance(first, last));
+        for (; first != last;  ++first)
+            find_or_insert(Ops::getKey(*first), *first);
+    }
+
+    Group_Hash_Base(const Group_Hash_Base & other)
+        : ctrl_(0), buckets_(0), capacity_(0), size_(0), growthLeft_(0),
+          alloc_(other.alloc_)
+    {
+        if (other.capacity_ == 0) return;
+
+        allocate(other.capacity_);
+        try {
+            for (size_t i = 0;  i < capacity_;  ++i) {
+                if (other.ctrl_[i] < 0) continue;
+                new (buckets_ + i) Bucket(other.buckets_[i]);
+                set_ctrl(i, other.ctrl_[i]);
+                ++size_;
+            }
+        } catch (...) {
+            destroy();
+            throw;
+        }
+        growthLeft_ = other.growthLeft_;
+    }
+
+    Group_Hash_Base(Group_Hash_Base && other)
+        : ctrl_(other.ctrl_), buckets_(other.buckets_),
+          capacity_(other.capacity_), size_(other.size_),
+          growthLeft_(other.growthLeft_), alloc_(other.alloc_)
+    {
+        other.ctrl_ = 0;
+        other.buckets_ = 0;
+        other.capacity_ = other.size_ = other.growthLeft_ = 0;
+    }
+
+    ~Group_Hash_Base()
+    {
+        destroy();
+    }
+
+    Group_Hash_Base & operator = (const Group_Hash_Base & other)
+    {
+        Group_Hash_Base new_me(other);
+        swap(new_me);
+        return *this;
+    }
+
+    Group_Hash_Base & operator = (Group_Hash_Base && other)
+    {
+        Group_Hash_Base new_me(std::move(other));
+        swap(new_me);
+        return *this;
+    }
+
+    void swap(Group_Hash_Base & other)
+    {
+        std::swap(ctrl_, other.ctrl_);
+        std::swap(buckets_, other.buckets_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(growthLeft_, other.growthLeft_);
+        std::swap(alloc_, other.alloc_);
+    }
+
+    const Alloc & get_allocator() const { return alloc_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    /** Number of buckets, of which no more than 7/8 are used. */
+    size_t capacity() const { return capacity_; }
+
+    /** Removes all entries but keeps the memory. */
+    void clear()
+    {
+        if (capacity_ == 0) return;
+        destroy_buckets();
+        std::memset(ctrl_, Group::EMPTY, capacity_ + Group::Width);
+        size_ = 0;
+        growthLeft_ = max_size(capacity_);
+    }
+
+    /** Removes all entries and frees the memory. */
+    void destroy()
+    {
+        if (!ctrl_) return;
+        destroy_buckets();
+        alloc_.deallocate((char *)ctrl_, bytes_for(capacity_));
+        ctrl_ = 0;
+        buckets_ = 0;
+        capacity_ = size_ = growthLeft_ = 0;
+    }
+
+    bool count(const Key & key) const
+    {
+        return find_full_bucket(key) != NONE;
+    }
+
+    /** Makes room for the given number of entries without rehashing. */
+    void reserve(size_t entries)
+    {
+        size_t needed = Group::Width;
+        while (max_size(needed) < entries)
+            needed *= 2;
+        if (needed > capacity_)
+            rehash(needed);
+    }
+
+    size_t erase(const Key & key)
+    {
+        size_t bucket = find_full_bucket(key);
+        if (bucket == NONE) return 0;
+        erase_bucket(bucket);
+        return 1;
+    }
+
+protected:
+    enum { NONE = size_t(-1) };
+
+    int8_t * ctrl_;       ///< capacity_ + Width control bytes
+    Bucket * buckets_;    ///< capacity_ buckets, after the control bytes
+    size_t capacity_;     ///< Power of two, no less than Width
+    size_t size_;
+    size_t growthLeft_;   ///< Empty buckets that can still be used
+    Alloc alloc_;
+
+    static size_t max_size(size_t capacity)
+    {
+        return capacity - capacity / 8;
+    }
+
+    /** The hash functions in use (std::hash of an integer is the identity)
+        don't mix their bits well enough to take the bucket from the high
+        bits and the control byte from the low ones.
+    */
+    static uint64_t hash_of(const Key & key)
+    {
+        __uint128_t product = (__uint128_t)(uint64_t)Hash()(key)
+            * 0x9e3779b97f4a7c15ULL;
+        return uint64_t(product) ^ uint64_t(product >> 64);
+    }
+
+    static int8_t control_of(uint64_t hash)
+    {
+        return hash & 0x7f;
+    }
+
+    void set_ctrl(size_t bucket, int8_t control)
+    {
+        ctrl_[bucket] = control;
+        if (bucket < Group::Width)
+            ctrl_[capacity_ + bucket] = control;
+    }
+
+    size_t find_bucket(const Key & key, uint64_t hash) const
+    {
+        if (capacity_ == 0) return NONE;
+
+        size_t mask = capacity_ - 1;
+        size_t pos = (hash >> 7) & mask;
+        int8_t control = control_of(hash);
+
+        for (size_t step = Group::Width;  ;  step += Group::Width) {
+            Group group(ctrl_ + pos);
+            for (uint32_t m = group.match(control);  m;  m &= m - 1) {
+                size_t bucket = (pos + lowest_bit(m)) & mask;
+                if (Ops::getKey(buckets_[bucket]) == key)
+                    return bucket;
+            }
+            if (group.matchEmpty())
+                return NONE;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    size_t find_full_bucket(const Key & key) const
+    {
+        return find_bucket(key, hash_of(key));
+    }
+
+    /** First bucket on the probe sequence of the hash that a new entry can
+        go in.
+    */
+    size_t find_free_bucket(uint64_t hash) const
+    {
+        size_t mask = capacity_ - 1;
+        size_t pos = (hash >> 7) & mask;
+
+        for (size_t step = Group::Width;  ;  step += Group::Width) {
+            uint32_t m = Group(ctrl_ + pos).matchEmptyOrDeleted();
+            if (m)
+                return (pos + lowest_bit(m)) & mask;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    /** Returns the bucket of the key, constructing it from the arguments
+        if it wasn't there.
+    */
+    template<typename... Args>
+    std::pair<size_t, bool>
+    find_or_insert(const Key & key, Args &&... args)
+    {
+        uint64_t hash = hash_of(key);
+        size_t bucket = find_bucket(key, hash);
+        if (bucket != NONE)
+            return std::make_pair(bucket, false);
+
+        if (growthLeft_ == 0) {
+            // Grow, unless it's the deleted buckets that are in the way
+            if (size_ * 2 < max_size(capacity_))
+                rehash(capacity_);
+            else rehash(std::max<size_t>(Group::Width, capacity_ * 2));
+        }
+
+        bucket = find_free_bucket(hash);
+        new (buckets_ + bucket) Bucket(std::forward<Args>(args)...);
+        growthLeft_ -= (ctrl_[bucket] == Group::EMPTY);
+        set_ctrl(bucket, control_of(hash));
+        ++size_;
+
+        return std::make_pair(bucket, true);
+    }
+
+    void erase_bucket(size_t bucket)
+    {
+        buckets_[bucket].~Bucket();
+        --size_;
+
+        // If a group containing the bucket has always had an empty bucket,
+        // no probe has gone past it and it can be made empty again.
+        size_t before = (bucket - Group::Width) & (capacity_ - 1);
+        uint32_t emptyBefore = Group(ctrl_ + before).matchEmpty();
+        uint32_t emptyAfter = Group(ctrl_ + bucket).matchEmpty();
+        bool wasNeverFull = emptyBefore && emptyAfter
+            && (__builtin_clz(emptyBefore) - (32 - Group::Width)
+                + __builtin_ctz(emptyAfter)) < Group::Width;
+
+        set_ctrl(bucket, wasNeverFull ? Group::EMPTY : Group::DELETED);
+        growthLeft_ += wasNeverFull;
+    }
+
+    static size_t ctrl_bytes_for(size_t capacity)
+    {
+        size_t ctrlBytes = capacity + Group::Width;
+        return ctrlBytes + (alignof(Bucket) - ctrlBytes % alignof(Bucket))
+            % alignof(Bucket);
+    }
+
+    static size_t bytes_for(size_t capacity)
+    {
+        return ctrl_bytes_for(capacity) + capacity * sizeof(Bucket);
+    }
+
+    void allocate(size_t capacity)
+    {
+        size_t ctrlBytes = ctrl_bytes_for(capacity);
+
+        char * mem = alloc_.allocate(bytes_for(capacity));
+        ctrl_ = (int8_t *)mem;
+        buckets_ = (Bucket *)(mem + ctrlBytes);
+        capacity_ = capacity;
+        size_ = 0;
+        growthLeft_ = max_size(capacity);
+        std::memset(ctrl_, Group::EMPTY, capacity + Group::Width);
+    }
+
+    void rehash(size_t newCapacity)
+    {
+        Group_Hash_Base old(std::move(*this));
+        allocate(newCapacity);
+
+        for (size_t i = 0;  i < old.capacity_;  ++i) {
+            if (old.ctrl_[i] < 0) continue;
+            uint64_t hash = hash_of(Ops::getKey(old.buckets_[i]));
+            size_t bucket = find_free_bucket(hash);
+            new (buckets_ + bucket) Bucket(std::move(old.buckets_[i]));
+            set_ctrl(bucket, control_of(hash));
+        }
+
+        size_ = old.size_;
+        growthLeft_ -= size_;
+    }
+
+    void destroy_buckets()
+    {
+        for (size_t i = 0;  i < capacity_;  ++i)
+            if (ctrl_[i] >= 0)
+                buckets_[i].~Bucket();
+    }
+
+    /* Lightweight_Hash_Iterator walks the buckets by index */
+
+    int advance_to_valid(int index) const
+    {
+        while (index < capacity_ && ctrl_[index] < 0)
+            ++index;
+        return index;
+    }
+
+    int backup_to_valid(int index) const
+    {
+        while (index >= 0 && ctrl_[index] < 0)
+            --index;
+        if (index < 0)
+            throw Exception("backup_to_valid: none found");
+        return index;
+    }
+
+    const Bucket & dereference(int bucket) const
+    {
+        if (bucket < 0 || bucket >= capacity_ || ctrl_[bucket] < 0)
+            throw Exception("dereferencing invalid iterator");
+        return buckets_[bucket];
+    }
+};
+
+
+/*****************************************************************************/
+/* GROUP HASH                                                                */
+/*****************************************************************************/
+
+template<typename Key, typename Value>
+struct Group_Hash_PairOps {
+    static const Key & getKey(const std::pair<Key, Value> & bucket)
+    {
+        return bucket.first;
+    }
+};
+
+/** Hash map with the interface of Lightweight_Hash. */
+
+template<typename Key,
+         typename Value,
+         class Hash = std::hash<Key>,
+         class Bucket = std::pair<Key, Value>,
+         class ConstKeyBucket = std::pair<const Key, Value>,
+         class Ops = Group_Hash_PairOps<Key, Value>,
+         class Alloc = std::allocator<char> >
+struct Group_Hash
+    : public Group_Hash_Base<Key, Bucket, Ops, Hash, Alloc> {
+
+    typedef Lightweight_Hash_Iterator<Key, const Value, const Group_Hash,
+                                      const Bucket>
+    const_iterator;
+    typedef Lightweight_Hash_Iterator<Key, Value, Group_Hash,
+                                      ConstKeyBucket> iterator;
+
+    typedef Group_Hash_Base<Key, Bucket, Ops, Hash, Alloc> Base;
+
+    Group_Hash()
+    {
+    }
+
+    explicit Group_Hash(const Alloc & alloc)
+        : Base(alloc)
+    {
+    }
+
+    template<class Iterator>
+    Group_Hash(Iterator first, Iterator last, size_t capacity = 0)
+        : Base(first, last, capacity)
+    {
+    }
+
+    Group_Hash(const Group_Hash & other)
+        : Base(other)
+    {
+    }
+
+    Group_Hash(Group_Hash && other)
+        : Base(std::move(other))
+    {
+    }
+
+    Group_Hash & operator = (const Group_Hash & other)
+    {
+        Base::operator = (other);
+        return *this;
+    }
+
+    Group_Hash & operator = (Group_Hash && other)
+    {
+        Base::operator = (std::move(other));
+        return *this;
+    }
+
+    void swap(Group_Hash & other)
+    {
+        Base::swap(other);
+    }
+
+    using Base::size;
+    using Base::empty;
+    using Base::capacity;
+    using Base::clear;
+    using Base::count;
+    using Base::erase;
+    using Base::reserve;
+    using Base::get_allocator;
+
+    iterator begin()
+    {
+        if (empty()) return end();
+        return iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, this->capacity());
+    }
+
+    const_iterator begin() const
+    {
+        if (empty()) return end();
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, this->capacity());
+    }
+
+    iterator find(const Key & key)
+    {
+        size_t bucket = this->find_full_bucket(key);
+        if (bucket == Base::NONE) return end();
+        return iterator(this, bucket);
+    }
+
+    const_iterator find(const Key & key) const
+    {
+        size_t bucket = this->find_full_bucket(key);
+        if (bucket == Base::NONE) return end();
+        return const_iterator(this, bucket);
+    }
+
+    Value & operator [] (const Key & key)
+    {
+        size_t bucket = this->find_or_insert(key, key, Value()).first;
+        return this->buckets_[bucket].second;
+    }
+
+    std::pair<iterator, bool>
+    insert(const Bucket & val)
+    {
+        std::pair<size_t, bool> r = this->find_or_insert(val.first, val);
+        return std::make_pair(iterator(this, r.first), r.second);
+    }
+
+    void erase(const iterator & it)
+    {
+        this->dereference(it.index);
+        this->erase_bucket(it.index);
+    }
+
+private:
+    template<typename K, typename V, class H, class CB>
+    friend class Lightweight_Hash_Iterator;
+
+    using Base::dereference;
+    ConstKeyBucket & dereference(int bucket)
+    {
+        Base::dereference(bucket);
+        return reinterpret_cast<ConstKeyBucket &>(this->buckets_[bucket]);
+    }
+};
+
+
+/*****************************************************************************/
+/* GROUP HASH SET                                                            */
+/*****************************************************************************/
+
+template<typename Key>
+struct Group_Hash_ScalarOps {
+    static const Key & getKey(const Key & bucket)
+    {
+        return bucket;
+    }
+};
+
+/** Hash set with the interface of Lightweight_Hash_Set. */
+
+template<typename Key, class Hash = std::hash<Key>,
+         class Bucket = Key,
+         class Ops = Group_Hash_ScalarOps<Key> >
+struct Group_Hash_Set
+    : public Group_Hash_Base<Key, Bucket, Ops, Hash> {
+
+    typedef Lightweight_Hash_Iterator<Key, const Key, const Group_Hash_Set,
+                                      const Bucket>
+    const_iterator;
+    typedef const_iterator iterator;
+
+    typedef Group_Hash_Base<Key, Bucket, Ops, Hash> Base;
+
+    Group_Hash_Set()
+    {
+    }
+
+    Group_Hash_Set(const std::initializer_list<Key> & init)
+        : Base(init.begin(), init.end(), init.size())
+    {
+    }
+
+    template<class Iterator>
+    Group_Hash_Set(Iterator first, Iterator last, size_t capacity = 0)
+        : Base(first, last, capacity)
+    {
+    }
+
+    Group_Hash_Set(const Group_Hash_Set & other)
+        : Base(other)
+    {
+    }
+
+    Group_Hash_Set(Group_Hash_Set && other)
+        : Base(std::move(other))
+    {
+    }
+
+    Group_Hash_Set & operator = (const Group_Hash_Set & other)
+    {
+        Base::operator = (other);
+        return *this;
+    }
+
+    Group_Hash_Set & operator = (Group_Hash_Set && other)
+    {
+        Base::operator = (std::move(other));
+        return *this;
+    }
+
+    void swap(Group_Hash_Set & other)
+    {
+        Base::swap(other);
+    }
+
+    using Base::size;
+    using Base::empty;
+    using Base::capacity;
+    using Base::clear;
+    using Base::count;
+    using Base::erase;
+    using Base::reserve;
+
+    const_iterator begin() const
+    {
+        if (empty()) return end();
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, this->capacity());
+    }
+
+    const_iterator find(const Key & key) const
+    {
+        size_t bucket = this->find_full_bucket(key);
+        if (bucket == Base::NONE) return end();
+        return const_iterator(this, bucket);
+    }
+
+    std::pair<const_iterator, bool>
+    insert(const Key & val)
+    {
+        std::pair<size_t, bool> r = this->find_or_insert(val, val);
+        return std::make_pair(const_iterator(this, r.first), r.second);
+    }
+
+    template<typename Iterator>
+    size_t insert(Iterator first, Iterator last)
+    {
+        size_t result = 0;
+        for (; first != last;  ++first)
+            result += insert(*first).second;
+        return result;
+    }
+
+private:
+    template<typename K, typename V, class H, class CB>
+    friend class Lightweight_Hash_Iterator;
+};
+
+
+} // namespace ML
+
+
+#endif /* __jml__utils__group_hash_h__ */
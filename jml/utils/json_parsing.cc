@@ -7,6 +7,13 @@
 
 #include "json_parsing.h"
 #include "jml/arch/format.h"
+#include "jml/utils/compact_vector.h"
+#include "jml/arch/arch.h"
+#include <cstring>
+
+#if JML_INTEL_ISA
+#  include <emmintrin.h>
+#endif
 
 
 using namespace std;
@@ -34,29 +41,69 @@ void skipJsonWhitespace(Parse_Context & context)
            && (context.match_whitespace() || context.match_eol()));
 }
 
+const char * findJsonSpecialChar(const char * p, const char * end)
+{
+#if JML_INTEL_ISA
+    // Non-ASCII bytes are negative, so the signed comparison with the space
+    // catches them along with the control characters
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i del = _mm_set1_epi8(127);
+
+    for (;  end - p >= 16;  p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i special
+            = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, quote),
+                                        _mm_cmpeq_epi8(x, backslash)),
+                           _mm_or_si128(_mm_cmplt_epi8(x, space),
+                                        _mm_cmpeq_epi8(x, del)));
+        int mask = _mm_movemask_epi8(special);
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif // JML_INTEL_ISA
+
+    for (;  p < end;  ++p) {
+        char c = *p;
+        if (c < ' ' || c >= 127 || c == '"' || c == '\\')
+            return p;
+    }
+
+    return end;
+}
+
 char * jsonEscapeCore(const std::string & str, char * p, char * end)
 {
-    for (unsigned i = 0;  i < str.size();  ++i) {
+    const char * s = str.data(), * send = s + str.size();
+
+    while (s < send) {
+        const char * special = findJsonSpecialChar(s, send);
+        if (special != s) {
+            if (p + (special - s) + 4 >= end)
+                return 0;
+            std::memcpy(p, s, special - s);
+            p += special - s;
+            s = special;
+            continue;
+        }
+
         if (p + 4 >= end)
             return 0;
 
-        char c = str[i];
-        if (c >= ' ' && c < 127 && c != '\"' && c != '\\')
-            *p++ = c;
-        else {
-            *p++ = '\\';
-            switch (c) {
-            case '\t': *p++ = ('t');  break;
-            case '\n': *p++ = ('n');  break;
-            case '\r': *p++ = ('r');  break;
-            case '\f': *p++ = ('f');  break;
-            case '\b': *p++ = ('b');  break;
-            case '/':
-            case '\\':
-            case '\"': *p++ = (c);  break;
-            default:
-                throw Exception("Invalid character in JSON string: " + str);
-            }
+        char c = *s++;
+        *p++ = '\\';
+        switch (c) {
+        case '\t': *p++ = ('t');  break;
+        case '\n': *p++ = ('n');  break;
+        case '\r': *p++ = ('r');  break;
+        case '\f': *p++ = ('f');  break;
+        case '\b': *p++ = ('b');  break;
+        case '/':
+        case '\\':
+        case '\"': *p++ = (c);  break;
+        default:
+            throw Exception("Invalid character in JSON string: " + str);
         }
     }
 
@@ -102,6 +149,12 @@ bool matchJsonString(Parse_Context & context, std::string & str)
     std::string result;
 
     while (!context.match_literal('"')) {
+        if (size_t run = jsonPlainRun(context)) {
+            result.append(context.buffer_pos(), run);
+            context.skip_in_buffer(run);
+            continue;
+        }
+
         if (context.eof()) return false;
         int c = *context++;
         //if (c < 0 || c >= 127)
@@ -152,6 +205,15 @@ std::string expectJsonStringAsciiPermissive(Parse_Context & context, char sub)
 
     // Try multiple times to make it fit
     while (!context.match_literal('"')) {
+        size_t run = std::min(jsonPlainRun(context), bufferSize - pos);
+        if (run) {
+            std::copy(context.buffer_pos(), context.buffer_pos() + run,
+                      buffer + pos);
+            pos += run;
+            context.skip_in_buffer(run);
+            continue;
+        }
+
         int c = *context++;
         if (c == '\\') {
             c = *context++;
@@ -211,6 +273,16 @@ std::string expectJsonString(Parse_Context & context)
 
     // Try multiple times to make it fit
     while (!context.match_literal('"')) {
+        // Keep room for the longest encoding after the run
+        size_t run = pos + 6 >= bufferSize ? 0
+            : std::min(jsonPlainRun(context), bufferSize - 6 - pos);
+        if (run) {
+            std::copy(context.buffer_pos(), context.buffer_pos() + run,
+                      buffer + pos);
+            pos += run;
+            context.skip_in_buffer(run);
+            continue;
+        }
 
         int c = *context++;
         if (c == '\\') {
@@ -233,7 +305,7 @@ std::string expectJsonString(Parse_Context & context)
             }
         }
 
-        if ((pos + 6) == bufferSize) {
+        if (pos + 6 >= bufferSize) {
             size_t newBufferSize = bufferSize * 8;
             char * newBuffer = new char[newBufferSize];
 
@@ -294,6 +366,70 @@ std::string expectJsonString(Parse_Context & context)
     return result;
 }
 
+ssize_t expectJsonString(Parse_Context & context, char * buffer, size_t maxLength)
+{
+    skipJsonWhitespace(context);
+    context.expect_literal('"');
+
+    // Room for the longest encoded escape and the null terminator.
+    if (maxLength < 4) return -1;
+    char * end = buffer + maxLength - 4;
+    char * p = buffer;
+
+    while (!context.match_literal('"')) {
+        size_t run = p > end ? 0 : std::min<size_t>(jsonPlainRun(context),
+                                                    end + 1 - p);
+        if (run) {
+            std::copy(context.buffer_pos(), context.buffer_pos() + run, p);
+            p += run;
+            context.skip_in_buffer(run);
+            continue;
+        }
+
+        int c = *context++;
+        if (c == '\\') {
+            c = *context++;
+            switch (c) {
+            case 't': c = '\t';  break;
+            case 'n': c = '\n';  break;
+            case 'r': c = '\r';  break;
+            case 'f': c = '\f';  break;
+            case 'b': c = '\b';  break;
+            case '/': c = '/';   break;
+            case '\\':c = '\\';  break;
+            case '"': c = '"';   break;
+            case 'u': {
+                c = context.expect_hex4();
+                break;
+            }
+            default:
+                context.exception("invalid escaped char");
+            }
+        }
+
+        // Embedded nulls can't be represented in a null terminated string.
+        if (c == 0 || p > end) return -1;
+
+        if (c <= 0x7f) {
+            *p++ = c;
+            continue;
+        }
+
+        // Only unicode escapes get here since raw UTF-8 bytes are negative.
+        if (c <= 0x7ff) {
+            *p++ = 0xC0 | (c >> 6);
+        }
+        else {
+            *p++ = 0xE0 | (c >> 12);
+            *p++ = 0x80 | ((c >> 6) & 0x3F);
+        }
+        *p++ = 0x80 | (c & 0x3F);
+    }
+
+    *p = 0;
+    return p - buffer;
+}
+
 ssize_t expectJsonStringAscii(Parse_Context & context, char * buffer, size_t maxLength)
 {
     skipJsonWhitespace(context);
@@ -304,6 +440,15 @@ ssize_t expectJsonStringAscii(Parse_Context & context, char * buffer, size_t max
 
     // Try multiple times to make it fit
     while (!context.match_literal('"')) {
+        size_t run = std::min(jsonPlainRun(context), bufferSize - pos);
+        if (run) {
+            std::copy(context.buffer_pos(), context.buffer_pos() + run,
+                      buffer + pos);
+            pos += run;
+            context.skip_in_buffer(run);
+            continue;
+        }
+
         int c = *context++;
         if (c == '\\') {
             c = *context++;
@@ -354,15 +499,15 @@ std::string expectJsonStringAscii(Parse_Context & context)
 
     // Try multiple times to make it fit
     while (!context.match_literal('"')) {
-
-#if 0 // attempt to do it a block at a time
-        char * bufferEnd = cbuffer + bufferSize;
-
-        int charsMatched
-            = context.match_text(buffer + pos, buffer + bufferSize,
-                                 "\"\\");
-        pos += charsMatched;
-#endif
+        // Copy a block at a time up to the next character that needs work
+        size_t run = std::min(jsonPlainRun(context), bufferSize - pos);
+        if (run) {
+            std::copy(context.buffer_pos(), context.buffer_pos() + run,
+                      buffer + pos);
+            pos += run;
+            context.skip_in_buffer(run);
+            continue;
+        }
 
         int c = *context++;
         if (c == '\\') {
@@ -409,6 +554,70 @@ std::string expectJsonStringAscii(Parse_Context & context)
     return result;
 }
 
+namespace {
+
+void skipJsonString(Parse_Context & context)
+{
+    context.expect_literal('"');
+
+    while (!context.match_literal('"')) {
+        if (size_t run = jsonPlainRun(context)) {
+            context.skip_in_buffer(run);
+            continue;
+        }
+
+        if (*context++ != '\\') continue;
+
+        char c = *context++;
+        if (c == 'u') context.expect_hex4();
+        else if (!c || !strchr("tnrfb/\\\"", c))
+            context.exception("invalid escaped char");
+    }
+}
+
+} // file scope
+
+void skipJson(Parse_Context & context)
+{
+    skipJsonWhitespace(context);
+
+    if (*context == '"')
+        skipJsonString(context);
+
+    else if (*context == '[') {
+        expectJsonArray(context, [] (int, Parse_Context & context)
+                {
+                    skipJson(context);
+                });
+    }
+
+    else if (context.match_literal('{')) {
+        skipJsonWhitespace(context);
+        if (context.match_literal('}')) return;
+
+        for (;;) {
+            skipJsonWhitespace(context);
+            skipJsonString(context);
+            skipJsonWhitespace(context);
+            context.expect_literal(':');
+            skipJson(context);
+            skipJsonWhitespace(context);
+
+            if (!context.match_literal(',')) break;
+        }
+
+        skipJsonWhitespace(context);
+        context.expect_literal('}');
+    }
+
+    else if (context.match_literal("null")
+            || context.match_literal("true")
+            || context.match_literal("false"))
+        return;
+
+    else expectJsonNumber(context);
+}
+
 bool
 matchJsonNull(Parse_Context & context)
 {
@@ -521,6 +730,56 @@ expectJsonObjectAscii(Parse_Context & context,
     context.expect_literal('}');
 }
 
+void
+expectJsonObjectUtf8(Parse_Context & context,
+                     const std::function<void (const char *, Parse_Context &)> & onEntry)
+{
+    skipJsonWhitespace(context);
+
+    if (context.match_literal("null"))
+        return;
+
+    context.expect_literal('{');
+
+    skipJsonWhitespace(context);
+
+    if (context.match_literal('}')) return;
+
+    for (;;) {
+        skipJsonWhitespace(context);
+
+        char keyBuffer[1024];
+        const char * key = keyBuffer;
+        string longKey;
+
+        {
+            Parse_Context::Revert_Token token(context);
+            if (expectJsonString(context, keyBuffer, 1024) != -1)
+                token.ignore();
+            else {
+                token.apply();
+                longKey = expectJsonString(context);
+                key = longKey.c_str();
+            }
+        }
+
+        skipJsonWhitespace(context);
+
+        context.expect_literal(':');
+
+        skipJsonWhitespace(context);
+
+        onEntry(key, context);
+
+        skipJsonWhitespace(context);
+
+        if (!context.match_literal(',')) break;
+    }
+
+    skipJsonWhitespace(context);
+    context.expect_literal('}');
+}
+
 bool
 matchJsonObject(Parse_Context & context,
                 const std::function<bool (const std::string &, Parse_Context &)> & onEntry)
@@ -560,14 +819,14 @@ JsonNumber expectJsonNumber(Parse_Context & context)
 {
     JsonNumber result;
 
-    std::string number;
-    number.reserve(32);
+    // Numbers are almost always short enough to avoid allocating.
+    compact_vector<char, 64> number;
 
     bool negative = false;
     bool doublePrecision = false;
 
     if (context.match_literal('-')) {
-        number += '-';
+        number.push_back('-');
         negative = true;
     }
 
@@ -592,30 +851,30 @@ JsonNumber expectJsonNumber(Parse_Context & context)
     }
 
     while (context && isdigit(*context)) {
-        number += *context++;
+        number.push_back(*context++);
     }
 
     if (context.match_literal('.')) {
         doublePrecision = true;
-        number += '.';
+        number.push_back('.');
 
         while (context && isdigit(*context)) {
-            number += *context++;
+            number.push_back(*context++);
         }
     }
 
     char sci = context ? *context : '\0';
     if (sci == 'e' || sci == 'E') {
         doublePrecision = true;
-        number += *context++;
+        number.push_back(*context++);
 
         char sign = context ? *context : '\0';
         if (sign == '+' || sign == '-') {
-            number += *context++;
+            number.push_back(*context++);
         }
 
         while (context && isdigit(*context)) {
-            number += *context++;
+            number.push_back(*context++);
         }
     }
 
@@ -624,29 +883,33 @@ JsonNumber expectJsonNumber(Parse_Context & context)
         if (number.empty())
             context.exception("expected number");
 
+        number.push_back(0);
+        const char * str = &number[0];
+        const char * strEnd = str + number.size() - 1;
+
         if (doublePrecision) {
             char * endptr = 0;
             errno = 0;
-            result.fp = strtod(number.c_str(), &endptr);
-            if (errno || endptr != number.c_str() + number.length())
+            result.fp = strtod(str, &endptr);
+            if (errno || endptr != strEnd)
                 context.exception(ML::format("failed to convert '%s' to long long",
-                                             number.c_str()));
+                                             str));
             result.type = JsonNumber::FLOATING_POINT;
         } else if (negative) {
             char * endptr = 0;
             errno = 0;
-            result.sgn = strtol(number.c_str(), &endptr, 10);
-            if (errno || endptr != number.c_str() + number.length())
+            result.sgn = strtol(str, &endptr, 10);
+            if (errno || endptr != strEnd)
                 context.exception(ML::format("failed to convert '%s' to long long",
-                                             number.c_str()));
+                                             str));
             result.type = JsonNumber::SIGNED_INT;
         } else {
             char * endptr = 0;
             errno = 0;
-            result.uns = strtoull(number.c_str(), &endptr, 10);
-            if (errno || endptr != number.c_str() + number.length())
+            result.uns = strtoull(str, &endptr, 10);
+            if (errno || endptr != strEnd)
                 context.exception(ML::format("failed to convert '%s' to unsigned long long",
-                                             number.c_str()));
+                                             str));
             result.type = JsonNumber::UNSIGNED_INT;
         }
     } catch (const std::exception & exc) {
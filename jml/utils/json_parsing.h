@@ -26,8 +26,31 @@ std::string jsonEscape(const std::string & str);
 
 void jsonEscape(const std::string & str, std::ostream & out);
 
+/** Return the first character in [p, end) that can't be copied verbatim
+    into or out of a JSON string: a quote, a backslash, a control character,
+    DEL or a non-ASCII byte.  Returns end if there are none.
+*/
+const char * findJsonSpecialChar(const char * p, const char * end);
+
+/** Number of characters from the current position of the context, within
+    its current buffer, that can be copied verbatim out of a JSON string.
+*/
+inline size_t jsonPlainRun(const Parse_Context & context)
+{
+    const char * p = context.buffer_pos();
+    return findJsonSpecialChar(p, context.buffer_end()) - p;
+}
+
 std::string expectJsonString(Parse_Context & context);
 
+/*
+ * Output goes into the given buffer, of the given maximum length, as a null
+ * terminated UTF-8 string. If it doesn't fit or if it contains a null
+ * character, then return -1.
+ */
+ssize_t expectJsonString(Parse_Context & context, char * buf,
+                         size_t maxLength);
+
 /*
  * If non-ascii characters are found an exception is thrown
  */
@@ -66,12 +89,23 @@ void
 expectJsonObjectAscii(Parse_Context & context,
                       const std::function<void (const char *, Parse_Context &)> & onEntry);
 
+/** Same as expectJsonObject but the key is passed as a null terminated
+    string which, unlike expectJsonObjectAscii, can hold any character. Keys
+    are decoded in a buffer so that they don't need to be allocated.
+*/
+void
+expectJsonObjectUtf8(Parse_Context & context,
+                     const std::function<void (const char *, Parse_Context &)> & onEntry);
+
 bool
 matchJsonObject(Parse_Context & context,
                 const std::function<bool (const std::string &, Parse_Context &)> & onEntry);
 
 void skipJsonWhitespace(Parse_Context & context);
 
+/** Skips over a JSON value without decoding it or allocating anything. */
+void skipJson(Parse_Context & context);
+
 inline bool expectJsonBool(Parse_Context & context)
 {
     if (context.match_literal("true"))
@@ -111,12 +145,35 @@ bool matchJsonNumber(Parse_Context & context, JsonNumber & num);
 
 #ifdef CPPTL_JSON_H_INCLUDED
 
+/** Decodes the string in a buffer so that only the copy held by the value is
+    allocated. Kept out of line so that the buffer isn't part of the stack
+    frame of every level of a nested value.
+*/
+inline __attribute__((noinline)) Json::Value
+expectJsonStringValue(Parse_Context & context)
+{
+    char buffer[4096];
+
+    Parse_Context::Revert_Token token(context);
+    ssize_t len = expectJsonString(context, buffer, sizeof(buffer));
+    if (len == -1) {
+        token.apply();
+        return expectJsonString(context);
+    }
+
+    token.ignore();
+
+    // Must be const or the range constructor would build an array.
+    const char * str = buffer;
+    return Json::Value(str, str + len);
+}
+
 inline Json::Value
 expectJson(Parse_Context & context)
 {
     context.skip_whitespace();
     if (*context == '"')
-        return expectJsonString(context);
+        return expectJsonStringValue(context);
     else if (context.match_literal("null"))
         return Json::Value();
     else if (context.match_literal("true"))
@@ -133,11 +190,11 @@ expectJson(Parse_Context & context)
         return result;
     } else if (*context == '{') {
         Json::Value result(Json::objectValue);
-        expectJsonObject(context,
-                         [&] (const std::string & key, Parse_Context & context)
-                         {
-                             result[key] = expectJson(context);
-                         });
+        expectJsonObjectUtf8(context,
+                             [&] (const char * key, Parse_Context & context)
+                             {
+                                 result[key] = expectJson(context);
+                             });
         return result;
     } else {
         JsonNumber number = expectJsonNumber(context);
@@ -204,10 +204,53 @@ expect_text(const char * delimiters, bool allow_empty, const char * error)
     return result;
 }
 
+size_t
+Parse_Context::
+scan_integer(unsigned long long & mag, bool & negative,
+             bool allow_sign, bool allow_dot) const
+{
+    const char * p = cur_;
+
+    negative = false;
+    if (allow_sign && p < ebuf_ && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+
+    mag = 0;
+    int digits = match_digits(p, ebuf_, mag);
+    if (digits == 0 || digits > 19 || p == ebuf_)
+        return 0;
+
+    // a decimal point is the start of a mantissa; see match_unsigned_long_long
+    if (allow_dot && *p == '.')
+        return 0;
+
+    return p - cur_;
+}
+
+size_t
+Parse_Context::
+scan_double(double & val) const
+{
+    const char * p = cur_;
+    if (!match_simple_double(p, ebuf_, val) || p == ebuf_)
+        return 0;
+    return p - cur_;
+}
+
 bool
 Parse_Context::
 match_int(int & val_, int min, int max)
 {
+    unsigned long long mag;
+    bool negative;
+    if (size_t n = scan_integer(mag, negative, true, false)) {
+        long val = negative ? (long)(0 - mag) : (long)mag;
+        if (val < min || val > max) return false;
+        val_ = val;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token tok(*this);
     long val = 0;
     if (!ML::match_int(val, *this)) return false;
@@ -252,6 +295,16 @@ bool
 Parse_Context::
 match_unsigned(unsigned & val_, unsigned min, unsigned max)
 {
+    unsigned long long mag;
+    bool negative;
+    if (size_t n = scan_integer(mag, negative, false, false)) {
+        unsigned long val = mag;
+        if (val < min || val > max) return false;
+        val_ = val;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token tok(*this);
     unsigned long val;
     if (!ML::match_unsigned(val, *this)) return false;
@@ -274,6 +327,16 @@ bool
 Parse_Context::
 match_long(long & val_, long min, long max)
 {
+    unsigned long long mag;
+    bool negative;
+    if (size_t n = scan_integer(mag, negative, true, false)) {
+        long val = negative ? (long)(0 - mag) : (long)mag;
+        if (val < min || val > max) return false;
+        val_ = val;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token tok(*this);
     long val = 0;
     if (!ML::match_long(val, *this)) return false;
@@ -297,6 +360,16 @@ Parse_Context::
 match_unsigned_long(unsigned long & val_, unsigned long min,
                          unsigned long max)
 {
+    unsigned long long mag;
+    bool negative;
+    if (size_t n = scan_integer(mag, negative, false, false)) {
+        unsigned long val = mag;
+        if (val < min || val > max) return false;
+        val_ = val;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token tok(*this);
     unsigned long val = 0;
     if (!ML::match_unsigned_long(val, *this)) return false;
@@ -320,6 +393,16 @@ bool
 Parse_Context::
 match_long_long(long long & val_, long long min, long long max)
 {
+    unsigned long long mag;
+    bool negative;
+    if (size_t n = scan_integer(mag, negative, true, true)) {
+        long long val = negative ? (long long)(0 - mag) : (long long)mag;
+        if (val < min || val > max) return false;
+        val_ = val;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token tok(*this);
     long long val = 0;
     if (!ML::match_long_long(val, *this)) return false;
@@ -343,6 +426,15 @@ Parse_Context::
 match_unsigned_long_long(unsigned long long & val_, unsigned long long min,
                          unsigned long long max)
 {
+    unsigned long long mag;
+    bool negative;
+    if (size_t n = scan_integer(mag, negative, false, true)) {
+        if (mag < min || mag > max) return false;
+        val_ = mag;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token tok(*this);
     unsigned long long val = 0;
     if (!ML::match_unsigned_long_long(val, *this)) return false;
@@ -366,6 +458,15 @@ bool
 Parse_Context::
 match_float(float & val, float min, float max)
 {
+    double d;
+    if (size_t n = scan_double(d)) {
+        float f = d;
+        if (f < min || f > max) return false;
+        val = f;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token t(*this);
     if (!ML::match_float(val, *this)) return false;
     if (val < min || val > max) return false;
@@ -387,6 +488,14 @@ bool
 Parse_Context::
 match_double(double & val, double min, double max)
 {
+    double d;
+    if (size_t n = scan_double(d)) {
+        if (d < min || d > max) return false;
+        val = d;
+        skip_in_buffer(n);
+        return true;
+    }
+
     Revert_Token t(*this);
     if (!ML::match_float(val, *this)) return false;
     if (val < min || val > max) return false;
@@ -404,6 +513,28 @@ expect_double(double min, double max, const char * error)
     return val;
 }
 
+void
+Parse_Context::
+skip_lines_in_buffer(size_t n)
+{
+    const char * end = cur_ + n;
+    const char * last_newline = 0;
+
+    for (const char * p = cur_;
+         (p = (const char *)memchr(p, '\n', end - p));  ++p) {
+        ++line_;
+        last_newline = p;
+    }
+
+    // The column after a newline is 1, as in operator ++
+    col_ = last_newline ? end - last_newline : col_ + n;
+    ofs_ += n;
+    cur_ = end;
+
+    if (cur_ == ebuf_)
+        next_buffer();
+}
+
 std::string
 Parse_Context::
 where() const
@@ -472,6 +472,26 @@ struct Parse_Context {
         return make_unnamed_bool(!eof());
     }
 
+    /** The characters from the current position up to the end of the
+        current buffer, for scanning them in bulk.  Both are equal at the
+        end of the file.
+    */
+    const char * buffer_pos() const { return cur_; }
+    const char * buffer_end() const { return ebuf_; }
+
+    /** Consume n characters of the current buffer, none of which may be a
+        newline.  This is the bulk version of operator ++.
+    */
+    JML_ALWAYS_INLINE void skip_in_buffer(size_t n)
+    {
+        cur_ += n;  ofs_ += n;  col_ += n;
+        if (JML_UNLIKELY(cur_ == ebuf_))
+            next_buffer();
+    }
+
+    /** As skip_in_buffer(), but the characters may contain newlines. */
+    void skip_lines_in_buffer(size_t n);
+
     bool match_eol(bool eof_is_eol = true)
     {
         if (eof_is_eol && eof()) return true;  // EOF is considered EOL
@@ -711,6 +731,15 @@ private:
         possible. */
     void free_buffers();
 
+    /** Fast paths for the numeric matchers.  They only look at the current
+        buffer and return the number of characters that the number takes
+        up, or zero if it is not simple enough or reaches the end of the
+        buffer, in which case the general matcher deals with it.
+    */
+    size_t scan_integer(unsigned long long & mag, bool & negative,
+                        bool allow_sign, bool allow_dot) const;
+    size_t scan_double(double & val) const;
+
     /** This contains a single contiguous block of text. */
     struct Buffer {
         Buffer(uint64_t ofs = 0, const char * pos = 0, size_t size = 0,
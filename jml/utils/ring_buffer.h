@@ -2,400 +2,366 @@
    Jeremy Barnes, 25 May 2012
    Copyright (c) 2012 Datacratic.  All rights reserved.
 
-   Ring buffer for when there are one or more producers and one consumer
-   chasing each other.
+   Ring buffer for when there are one or more producers and one or more
+   consumers chasing each other.
 */
 
 #ifndef __jml_utils__ring_buffer_h__
 #define __jml_utils__ring_buffer_h__
 
-#include <vector>
 #include "jml/arch/futex.h"
-#include "jml/arch/spinlock.h"
+#include <chrono>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace ML {
 
+
+/*****************************************************************************/
+/* RING BUFFER BASE                                                          */
+/*****************************************************************************/
+
+/** Bounded ring buffer that any number of writers and readers can use at
+    the same time without taking a lock.
+
+    Each slot carries a sequence number that tells whether it's ready to be
+    written to for a given turn of the ring or holds a request for a
+    reader: writers claim a position with a compare and swap and publish the
+    request by bumping the sequence of its slot, and readers do the same on
+    their side, so that a thread that's preempted half way only holds back
+    the slot it owns and not the others.
+
+    The try* functions never block.  The others wait on a futex when the
+    buffer is full or empty; the futexes are only touched when there is
+    someone waiting, so that a push or pop that doesn't have to wait makes
+    no system call.
+
+    The size is rounded up to a power of two, and that many requests fit.
+*/
 template<typename Request>
 struct RingBufferBase {
+
     RingBufferBase(size_t size)
     {
         init(size);
     }
 
+    RingBufferBase(const RingBufferBase & other) = delete;
+    RingBufferBase & operator = (const RingBufferBase & other) = delete;
+
     RingBufferBase(RingBufferBase && other)
         noexcept
     {
         *this = std::move(other);
     }
 
+    /** Not thread safe: nothing may use either buffer while it's moved. */
     RingBufferBase & operator = (RingBufferBase && other)
         noexcept
     {
-        ring = std::move(other.ring);
-        bufferSize = other.bufferSize;
-        other.bufferSize = 0;
-        readPosition = other.readPosition;
-        other.readPosition = 0;
-        writePosition = other.writePosition;
+        slots = std::move(other.slots);
+        mask = other.mask;
+        other.mask = 0;
+        writePosition.store(other.writePosition.load());
         other.writePosition = 0;
+        readPosition.store(other.readPosition.load());
+        other.readPosition = 0;
+        pushEvents = 0;
+        popEvents = 0;
+        pushWaiters = 0;
+        popWaiters = 0;
 
         return *this;
     }
 
-    std::vector<Request> ring;
-    int bufferSize;
-    int readPosition;
-    int writePosition;
-
     void init(size_t numEntries)
     {
-        ring.resize(numEntries);
-        bufferSize = numEntries;
-        readPosition = 0;
+        size_t capacity = 2;
+        while (capacity < numEntries) capacity *= 2;
+
+        mask = capacity - 1;
+        slots.reset(new Slot[capacity]);
+        for (size_t i = 0;  i < capacity;  ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+
         writePosition = 0;
+        readPosition = 0;
+        pushEvents = 0;
+        popEvents = 0;
+        pushWaiters = 0;
+        popWaiters = 0;
     }
-};
-
-/*****************************************************************************/
-/* RING BUFFER SINGLE WRITER MULTIPLE READERS                                */
-/*****************************************************************************/
 
-/** Single writer multiple reader ring buffer. */
-template<typename Request>
-struct RingBufferSWMR : public RingBufferBase<Request> {
-    using RingBufferBase<Request>::init;
-    using RingBufferBase<Request>::ring;
-    using RingBufferBase<Request>::bufferSize;
-    using RingBufferBase<Request>::readPosition;
-    using RingBufferBase<Request>::writePosition;
+    size_t capacity() const { return mask + 1; }
 
-    RingBufferSWMR(size_t size)
-        : RingBufferBase<Request>(size)
+    /** Number of requests in the buffer.  Only a hint while it's used. */
+    size_t size() const
     {
+        size_t read = readPosition.load(std::memory_order_relaxed);
+        size_t write = writePosition.load(std::memory_order_relaxed);
+        return write > read ? write - read : 0;
     }
 
-    typedef std::timed_mutex Mutex;
-    mutable Mutex readMutex;  // todo: we don't need this... get rid of it
-    typedef std::unique_lock<Mutex> Guard;
-
-    void push(const Request & request)
+    bool empty() const
     {
-        for (;;) {
-            // What position would the read position be in if the buffer was
-            // full?  
-            unsigned fullReadPosition = (writePosition + 1) % bufferSize;
-            if (readPosition == fullReadPosition)
-                ML::futex_wait(readPosition, fullReadPosition);
-            else break;
-        }
+        return size() == 0;
+    }
 
-        ring[writePosition] = request;
-        writePosition = (writePosition + 1) % bufferSize;
-        ML::futex_wake(writePosition);
+    template<typename R>
+    bool tryPush(R && request)
+    {
+        if (!tryPushImpl(std::forward<R>(request)))
+            return false;
+        notify(pushEvents, popWaiters);
+        return true;
     }
 
-    void push(Request && request)
+    /** Waits for there to be room in the buffer. */
+    template<typename R>
+    void push(R && request)
     {
-        for (;;) {
-            // What position would the read position be in if the buffer was
-            // full?  
-            unsigned fullReadPosition = (writePosition + 1) % bufferSize;
-            if (readPosition == fullReadPosition)
-                ML::futex_wait(readPosition, fullReadPosition);
-            else break;
-        }
-        
-        std::swap(ring[writePosition], request);
-        writePosition = (writePosition + 1) % bufferSize;
-        ML::futex_wake(writePosition);
+        wait(popEvents, pushWaiters,
+             [&] () { return this->tryPush(std::forward<R>(request)); });
     }
 
-    void waitUntilEmpty()
+    /** Waits at most maxWaitTime seconds for there to be room. */
+    template<typename R>
+    bool tryPush(R && request, double maxWaitTime)
     {
-        for (;;) {
-            int readPos = readPosition;
-            if (readPos == writePosition)
-                return;
-            ML::futex_wait(readPosition, readPos);
-        }
+        return wait(popEvents, pushWaiters,
+                    [&] () { return this->tryPush(std::forward<R>(request)); },
+                    maxWaitTime);
     }
 
-    bool tryPush(const Request & request)
+    bool tryPop(Request & result)
     {
-        // What position would the read position be in if the buffer was
-        // full?  
-        unsigned fullReadPosition = (writePosition + 1) % bufferSize;
-        if (readPosition == fullReadPosition)
+        if (!tryPopImpl(result))
             return false;
-                       
-        ring[writePosition] = request;
-        writePosition = (writePosition + 1) % bufferSize;
-        ML::futex_wake(writePosition);
+        notify(popEvents, pushWaiters);
         return true;
     }
 
-    bool tryPush(Request && request)
+    /** Waits at most maxWaitTime seconds for a request to come in. */
+    bool tryPop(Request & result, double maxWaitTime)
     {
-        // What position would the read position be in if the buffer was
-        // full?  
-        unsigned fullReadPosition = (writePosition + 1) % bufferSize;
-        if (readPosition == fullReadPosition)
-            return false;
-                       
-        std::swap(ring[writePosition], request);
-        writePosition = (writePosition + 1) % bufferSize;
-        ML::futex_wake(writePosition);
-        return true;
+        return wait(pushEvents, popWaiters,
+                    [&] () { return this->tryPop(result); },
+                    maxWaitTime);
     }
 
     Request pop()
     {
         Request result;
-
-        {
-            Guard guard(readMutex);  // todo... can get rid of this one...
-
-            // Wait until write position != read position, ie not full
-            for (;;) {
-                if (writePosition == readPosition)
-                    ML::futex_wait(writePosition, readPosition);
-                else break;
-            }
-
-            result = ring[readPosition];
-            ring[readPosition] = Request();
-            readPosition = (readPosition + 1) % bufferSize;
-        }
-        ML::futex_wake(readPosition);
-
+        wait(pushEvents, popWaiters,
+             [&] () { return this->tryPop(result); });
         return result;
     }
 
-    bool tryPop(Request & result, double maxWaitTime)
+    std::vector<Request> tryPopMulti(size_t nbrRequests)
     {
-        {
-            // todo... can get rid of this one...
-            Guard guard(readMutex,
-                        std::chrono::microseconds(uint64_t(maxWaitTime * 1000000)));
-            if (!guard)
-                return false;
-
-            // Wait until write position != read position, ie not full
-            if (writePosition == readPosition) {
-                ML::futex_wait(writePosition, readPosition, maxWaitTime);
-                if (writePosition == readPosition) return false;
-            }
+        std::vector<Request> result;
 
-            //std::swap(result, ring[readPosition]);
-            result = std::move(ring[readPosition]);
-            //ring[readPosition] = Request();
-            readPosition = (readPosition + 1) % bufferSize;
-        }
-        ML::futex_wake(readPosition);
+        Request request;
+        while (result.size() < nbrRequests && tryPopImpl(request))
+            result.emplace_back(std::move(request));
+        if (!result.empty())
+            notify(popEvents, pushWaiters);
 
-        return true;
+        return result;
     }
 
-    bool tryPop(Request & result)
+    /** Tells whether the next pop would find a request. */
+    bool couldPop() const
     {
-        {
-            // todo... can get rid of this one...
-            Guard guard(readMutex, std::try_to_lock_t());
-            if (!guard)
-                return false;
-
-            // Wait until write position != read position, ie not full
-            if (writePosition == readPosition)
-                return false;
-            
-            //std::swap(result, ring[readPosition]);
-            result = std::move(ring[readPosition]);
-            //ring[readPosition] = Request();
-            readPosition = (readPosition + 1) % bufferSize;
-        }
-        ML::futex_wake(readPosition);
-
-        return true;
+        size_t pos = readPosition.load(std::memory_order_relaxed);
+        const Slot & slot = slots[pos & mask];
+        return slot.sequence.load(std::memory_order_acquire) == pos + 1;
     }
 
-};
-
-
-/*****************************************************************************/
-/* RING BUFFER SINGLE READER MULTIPLE WRITERS                                */
-/*****************************************************************************/
-
-template<typename Request>
-struct RingBufferSRMW : public RingBufferBase<Request> {
-    using RingBufferBase<Request>::init;
-    using RingBufferBase<Request>::ring;
-    using RingBufferBase<Request>::bufferSize;
-    using RingBufferBase<Request>::readPosition;
-    using RingBufferBase<Request>::writePosition;
-
-    RingBufferSRMW(size_t size)
-        : RingBufferBase<Request>(size)
+    /** Waits until the readers have taken everything that was pushed. */
+    void waitUntilEmpty()
     {
+        wait(popEvents, pushWaiters, [&] () { return this->empty(); });
     }
 
-    RingBufferSRMW(const RingBufferSRMW & other) = delete;
-    RingBufferSRMW & operator = (const RingBufferSRMW & other) = delete;
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Request request;
+    };
 
-    RingBufferSRMW(RingBufferSRMW && other)
-        noexcept
-        : RingBufferBase<Request>(std::move(other))
-    {
-    }
-
-    RingBufferSRMW & operator = (RingBufferSRMW && other)
-        noexcept
+    template<typename R>
+    bool tryPushImpl(R && request)
     {
-        Guard guard(other.mutex);
+        size_t pos = writePosition.load(std::memory_order_relaxed);
+        Slot * slot;
 
-        RingBufferBase<Request>::operator = (std::move(other));
+        for (;;) {
+            slot = &slots[pos & mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            ssize_t diff = ssize_t(sequence) - ssize_t(pos);
+
+            if (diff == 0) {
+                if (writePosition.compare_exchange_weak(
+                                pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) return false;  // full
+            else pos = writePosition.load(std::memory_order_relaxed);
+        }
 
-        return *this;
+        slot->request = std::forward<R>(request);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
     }
 
-    typedef ML::Spinlock Mutex;
-    mutable Mutex mutex; // todo: get rid of...
-    typedef std::unique_lock<Mutex> Guard;
-    
-    void push(const Request & request)
+    bool tryPopImpl(Request & result)
     {
-        Guard guard(mutex);
+        size_t pos = readPosition.load(std::memory_order_relaxed);
+        Slot * slot;
 
         for (;;) {
-            // What position would the read position be in if the buffer was
-            // full?  
-            unsigned fullReadPosition = (writePosition + 1) % bufferSize;
-            if (readPosition == fullReadPosition)
-                ML::futex_wait(readPosition, fullReadPosition);
-            else break;
+            slot = &slots[pos & mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            ssize_t diff = ssize_t(sequence) - ssize_t(pos + 1);
+
+            if (diff == 0) {
+                if (readPosition.compare_exchange_weak(
+                                pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) return false;  // empty
+            else pos = readPosition.load(std::memory_order_relaxed);
         }
-                       
-        //ring[writePosition] = request;
-        ring[writePosition] = request;
-        writePosition = (writePosition + 1) % bufferSize;
-        ML::futex_wake(writePosition);
+
+        result = std::move(slot->request);
+        slot->request = Request();
+        slot->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
     }
 
-    bool tryPush(const Request & request)
+    /** Wakes up whoever waits on events, if anyone does.  The fence pairs
+        with the one in wait() so that either the waiter sees what we did or
+        we see the waiter.
+    */
+    static void notify(std::atomic<int> & events, std::atomic<int> & waiters)
     {
-        Guard guard(mutex);
-
-        // What position would the read position be in if the buffer was
-        // full?  
-        unsigned fullReadPosition = (writePosition + 1) % bufferSize;
-        if (readPosition == fullReadPosition)
-            return false;
-
-        //ring[writePosition] = request;
-        ring[writePosition] = request;
-        writePosition = (writePosition + 1) % bufferSize;
-        ML::futex_wake(writePosition);
-
-        return true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed)) {
+            ++events;
+            ML::futex_wake(events);
+        }
     }
 
-    bool tryPush(Request && request)
+    /** Calls attempt until it succeeds, sleeping on events in between.  A
+        negative maxWaitTime waits forever.
+    */
+    template<typename Attempt>
+    static bool wait(std::atomic<int> & events, std::atomic<int> & waiters,
+                     Attempt && attempt, double maxWaitTime = -1.0)
     {
-        Guard guard(mutex);
+        typedef std::chrono::steady_clock Clock;
 
-        // What position would the read position be in if the buffer was
-        // full?
-        unsigned fullReadPosition = (writePosition + 1) % bufferSize;
-        if (readPosition == fullReadPosition)
-            return false;
+        if (attempt())
+            return true;
 
-        //ring[writePosition] = request;
-        ring[writePosition] = std::move(request);
-        writePosition = (writePosition + 1) % bufferSize;
-        ML::futex_wake(writePosition);
+        Clock::time_point deadline;
+        if (maxWaitTime >= 0.0)
+            deadline = Clock::now()
+                + std::chrono::duration_cast<Clock::duration>
+                    (std::chrono::duration<double>(maxWaitTime));
 
-        return true;
-    }
+        for (;;) {
+            double timeLeft = -1.0;
+            if (maxWaitTime >= 0.0) {
+                timeLeft = std::chrono::duration<double>
+                    (deadline - Clock::now()).count();
+                if (timeLeft <= 0.0)
+                    return false;
+            }
 
-    Request pop()
-    {
-        Request result;
+            ++waiters;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int seen = events.load(std::memory_order_relaxed);
 
-        {
-            // Wait until write position != read position, ie not full
-            for (;;) {
-                if (writePosition == readPosition)
-                    ML::futex_wait(writePosition, readPosition);
-                else break;
+            bool done = attempt();
+            if (!done) {
+                if (timeLeft < 0.0)
+                    ML::futex_wait(events, seen);
+                else ML::futex_wait(events, seen, timeLeft);
+                done = attempt();
             }
 
-            result = ring[readPosition];
-            ring[readPosition] = Request();
-            readPosition = (readPosition + 1) % bufferSize;
+            --waiters;
+            if (done) return true;
         }
-        ML::futex_wake(readPosition);
-
-        return result;
     }
 
-    bool tryPop(Request & result)
-    {
-        if (writePosition == readPosition)
-            return false;
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+
+    // Kept apart so that the writers and the readers don't share a line.
+    char pad0[64];
+    std::atomic<size_t> writePosition;
+    std::atomic<int> pushEvents;   ///< Bumped on push when readers wait
+    std::atomic<int> popWaiters;
+    char pad1[64];
+    std::atomic<size_t> readPosition;
+    std::atomic<int> popEvents;    ///< Bumped on pop when writers wait
+    std::atomic<int> pushWaiters;
+    char pad2[64];
+};
 
-        result = ring[readPosition];
-        ring[readPosition] = Request();
-        readPosition = (readPosition + 1) % bufferSize;
-        ML::futex_wake(readPosition);
-        
-        return true;
-    }
 
-    bool tryPop(Request & result, double maxWaitTime)
-    {
-        {
-            // Wait until write position != read position, ie not full
-            for (;;) {
-                if (writePosition == readPosition) {
-                    if (ML::futex_wait(writePosition, readPosition, maxWaitTime) == -1
-                        && errno == ETIMEDOUT)
-                        return false;
-                }
-                else break;
-            }
-            
-            result = ring[readPosition];
-            ring[readPosition] = Request();
-            readPosition = (readPosition + 1) % bufferSize;
-        }
-        ML::futex_wake(readPosition);
+/*****************************************************************************/
+/* RING BUFFER SINGLE WRITER MULTIPLE READERS                                */
+/*****************************************************************************/
 
-        return true;
-    }
+/** Single writer multiple reader ring buffer. */
+template<typename Request>
+struct RingBufferSWMR : public RingBufferBase<Request> {
 
-    std::vector<Request> tryPopMulti(size_t nbrRequests)
+    RingBufferSWMR(size_t size)
+        : RingBufferBase<Request>(size)
     {
-        std::vector<Request> result;
-
-        for (size_t i = 0;
-             writePosition != readPosition && i < nbrRequests;
-             i++) {
-            result.emplace_back(std::move(ring[readPosition]));
-            ring[readPosition] = Request();
-            readPosition = (readPosition + 1) % bufferSize;
-        }
-        ML::futex_wake(readPosition);
-        
-        return result;
     }
 
-    bool couldPop() const
+    RingBufferSWMR(RingBufferSWMR && other) = default;
+    RingBufferSWMR & operator = (RingBufferSWMR && other) = default;
+};
+
+
+/*****************************************************************************/
+/* RING BUFFER SINGLE READER MULTIPLE WRITERS                                */
+/*****************************************************************************/
+
+/** Single reader multiple writer ring buffer. */
+template<typename Request>
+struct RingBufferSRMW : public RingBufferBase<Request> {
+
+    RingBufferSRMW(size_t size)
+        : RingBufferBase<Request>(size)
     {
-        return writePosition != readPosition;
     }
+
+    RingBufferSRMW(RingBufferSRMW && other) = default;
+    RingBufferSRMW & operator = (RingBufferSRMW && other) = default;
 };
 
+
+/*****************************************************************************/
+/* LOCK FREE RING BUFFER SRMW                                                */
+/*****************************************************************************/
+
+/** All the ring buffers are now lock free; kept for the code that asked for
+    this one by name.
+*/
+template<typename Request>
+using RingBufferLockFreeSRMW = RingBufferSRMW<Request>;
+
 } // namespace ML
 
 #endif /* __jml_utils__ring_buffer_h__ */
@@ -0,0 +1,83 @@
+/* arena_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the arena allocator.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "jml/utils/arena.h"
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+#include <set>
+
+using namespace ML;
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( test_inline )
+{
+    Arena<256> arena;
+
+    char * c = (char *)arena.allocate(1, 1);
+    uint64_t * i = arena.create<uint64_t>(42);
+    BOOST_CHECK_EQUAL(*i, 42);
+    BOOST_CHECK_EQUAL((uintptr_t)i % alignof(uint64_t), 0);
+    BOOST_CHECK(c < (char *)i);
+    BOOST_CHECK(arena.isInline());
+
+    // Goes over the inline storage.
+    char * big = (char *)arena.allocate(10000);
+    BOOST_CHECK(!arena.isInline());
+    BOOST_CHECK_EQUAL((uintptr_t)big % 16, 0);
+    std::fill(big, big + 10000, 'x');
+
+    arena.reset();
+    BOOST_CHECK(arena.isInline());
+    BOOST_CHECK_EQUAL((char *)arena.allocate(1, 1), c);
+}
+
+BOOST_AUTO_TEST_CASE( test_blocks )
+{
+    Arena<0> arena;
+    set<uintptr_t> seen;
+
+    for (unsigned i = 0;  i < 10000;  ++i) {
+        unsigned * p = arena.create<unsigned>(i);
+        BOOST_CHECK(seen.insert((uintptr_t)p).second);
+        BOOST_CHECK_EQUAL(*p, i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_threads )
+{
+    Arena<512> arena;
+
+    enum { NumThreads = 8, NumPerThread = 10000 };
+    vector< vector<uint64_t *> > results(NumThreads);
+
+    auto doThread = [&] (int thread)
+        {
+            for (unsigned i = 0;  i < NumPerThread;  ++i)
+                results[thread].push_back(
+                        arena.create<uint64_t>(thread * NumPerThread + i));
+        };
+
+    vector<std::thread> threads;
+    for (unsigned i = 0;  i < NumThreads;  ++i)
+        threads.emplace_back(doThread, i);
+    for (auto & t: threads)
+        t.join();
+
+    set<uint64_t *> seen;
+    for (unsigned i = 0;  i < NumThreads;  ++i) {
+        for (unsigned j = 0;  j < NumPerThread;  ++j) {
+            BOOST_CHECK_EQUAL(*results[i][j], i * NumPerThread + j);
+            seen.insert(results[i][j]);
+        }
+    }
+    BOOST_CHECK_EQUAL(seen.size(), NumThreads * NumPerThread);
+}
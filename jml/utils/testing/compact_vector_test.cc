@@ -566,3 +566,77 @@ BOOST_AUTO_TEST_CASE( check_c11_ops )
 
     BOOST_CHECK_EQUAL(constructed, destroyed);
 }
+
+BOOST_AUTO_TEST_CASE( check_append )
+{
+    constructed = destroyed = 0;
+
+    {
+        vector<Obj> objs = { 1, 2, 3, 4, 5, 6, 7 };
+        compact_vector<Obj, 3, unsigned> v = { 0 };
+
+        v.append(objs.begin(), objs.end());
+        BOOST_CHECK_EQUAL(v.size(), 8);
+        BOOST_CHECK_EQUAL(v.capacity(), 8);
+        for (unsigned i = 0;  i < v.size();  ++i)
+            BOOST_CHECK_EQUAL(v[i], i);
+
+        v.append({ 8, 9 });
+        BOOST_CHECK_EQUAL(v.size(), 10);
+        BOOST_CHECK_EQUAL(v[9], 9);
+
+        auto it = v.insert(v.end(), objs.begin(), objs.begin() + 2);
+        BOOST_CHECK(it == v.begin() + 10);
+        BOOST_CHECK_EQUAL(v.size(), 12);
+        BOOST_CHECK_EQUAL(v[11], 2);
+    }
+
+    BOOST_CHECK_EQUAL(constructed, destroyed);
+}
+
+struct Dims {
+    short width;
+    short height;
+};
+
+BOOST_AUTO_TEST_CASE( check_relocatable )
+{
+    typedef compact_vector<Dims, 3, uint16_t> Vec;
+    BOOST_CHECK(Vec::Relocatable);
+    BOOST_CHECK(!(compact_vector<Obj, 3>::Relocatable));
+
+    Vec v;
+    for (short i = 0;  i < 100;  ++i)
+        v.push_back({ i, short(i * 2) });
+
+    Vec small = { { 1, 2 } };
+    small.swap(v);
+    BOOST_CHECK_EQUAL(v.size(), 1);
+    BOOST_CHECK_EQUAL(v[0].height, 2);
+    BOOST_REQUIRE_EQUAL(small.size(), 100);
+
+    Vec moved(std::move(v));
+    BOOST_CHECK_EQUAL(moved.size(), 1);
+    BOOST_CHECK_EQUAL(moved[0].width, 1);
+
+    small.resize(2);
+    for (short i = 0;  i < 2;  ++i) {
+        BOOST_CHECK_EQUAL(small[i].width, i);
+        BOOST_CHECK_EQUAL(small[i].height, i * 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( check_growth_moves )
+{
+    // Growing moves the elements that can't throw when moved, rather than
+    // copying them
+    compact_vector<std::string, 2> v;
+    v.push_back(std::string(100, 'a'));
+    const char * chars = v[0].c_str();
+
+    for (unsigned i = 0;  i < 10;  ++i)
+        v.push_back(std::string(100, 'b'));
+
+    BOOST_CHECK_EQUAL(v[0], std::string(100, 'a'));
+    BOOST_CHECK_EQUAL((const void *)v[0].c_str(), (const void *)chars);
+}
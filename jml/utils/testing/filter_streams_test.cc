@@ -560,3 +560,55 @@ BOOST_AUTO_TEST_CASE(test_filter_stream_exceptions_destruction_istream)
 }
 
 #endif
+
+#if 1
+BOOST_AUTO_TEST_CASE( test_mapped_file_in )
+{
+    string filename = "filter_streams_test-mapped.txt";
+    FileCleanup cleanup(filename);
+
+    string text;
+    for (int i = 0; i < 100000; i++)
+        text += "line " + to_string(i) + "\n";
+    {
+        ofstream out(filename);
+        out << text;
+    }
+
+    // Not asking for it, the file is read as usual
+    {
+        ML::filter_istream inS(filename);
+        BOOST_CHECK(inS.mapped().first == nullptr);
+        BOOST_CHECK_EQUAL(inS.readAll(), text);
+    }
+
+    ML::filter_istream inS(filename, { { "mapped", "true" } });
+    auto mapped = inS.mapped();
+    BOOST_REQUIRE(mapped.first != nullptr);
+    BOOST_CHECK_EQUAL(string(mapped.first, mapped.second), text);
+
+    string line;
+    getline(inS, line);
+    BOOST_CHECK_EQUAL(line, "line 0");
+
+    // Seeking moves within the mapping
+    inS.seekg(-6, ios::end);
+    getline(inS, line);
+    BOOST_CHECK_EQUAL(line, "99999");
+    inS.seekg(0);
+    BOOST_CHECK_EQUAL(inS.readAll(), text);
+    BOOST_CHECK_EQUAL(inS.mapped().first, mapped.first);
+
+    // A compressed file is decompressed from the mapping
+    string gzFilename = filename + ".gz";
+    FileCleanup gzCleanup(gzFilename);
+    {
+        ML::filter_ostream out(gzFilename);
+        out << text;
+    }
+
+    ML::filter_istream gzInS(gzFilename, { { "mapped", "true" } });
+    BOOST_CHECK(gzInS.mapped().first == nullptr);
+    BOOST_CHECK_EQUAL(gzInS.readAll(), text);
+}
+#endif
@@ -0,0 +1,192 @@
+/* group_hash_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Test program for the group probed hash.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#undef NDEBUG
+
+#include "jml/utils/group_hash.h"
+#include <boost/test/unit_test.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <set>
+#include "live_counting_obj.h"
+
+using namespace ML;
+using namespace std;
+
+BOOST_AUTO_TEST_CASE(test_group_hash)
+{
+    Group_Hash<int, int> h;
+    const Group_Hash<int, int> & ch = h;
+
+    BOOST_CHECK_EQUAL(h.empty(), true);
+    BOOST_CHECK_EQUAL(h.size(), 0);
+    BOOST_CHECK_EQUAL(h.begin(), h.end());
+    BOOST_CHECK_EQUAL(ch.begin(), ch.end());
+    BOOST_CHECK(h.find(1) == h.end());
+    BOOST_CHECK_EQUAL(h.count(1), 0);
+
+    h.reserve(16);
+    BOOST_CHECK(h.capacity() >= 16);
+    BOOST_CHECK_EQUAL(h.begin(), h.end());
+
+    // No key is reserved to mark the empty buckets
+    h[0] = 10;
+    h[-1] = 20;
+
+    BOOST_CHECK_EQUAL(h[0], 10);
+    BOOST_CHECK_EQUAL(h[-1], 20);
+    BOOST_CHECK_EQUAL(h.size(), 2);
+    BOOST_CHECK_EQUAL(++++h.begin(), h.end());
+
+    auto res = h.insert(make_pair(0, 30));
+    BOOST_CHECK_EQUAL(res.second, false);
+    BOOST_CHECK_EQUAL(res.first->second, 10);
+
+    res = h.insert(make_pair(1, 30));
+    BOOST_CHECK_EQUAL(res.second, true);
+    BOOST_CHECK_EQUAL(res.first->first, 1);
+    BOOST_CHECK_EQUAL(ch.find(1)->second, 30);
+
+    BOOST_CHECK_EQUAL(h.erase(1), 1);
+    BOOST_CHECK_EQUAL(h.erase(1), 0);
+    BOOST_CHECK(h.find(1) == h.end());
+    BOOST_CHECK_EQUAL(h.size(), 2);
+
+    h.reserve(1024);
+    BOOST_CHECK_EQUAL(h[0], 10);
+    BOOST_CHECK_EQUAL(h[-1], 20);
+    BOOST_CHECK_EQUAL(h.size(), 2);
+
+    h.clear();
+    BOOST_CHECK_EQUAL(h.size(), 0);
+    BOOST_CHECK(h.find(0) == h.end());
+}
+
+BOOST_AUTO_TEST_CASE(test_group_hash_against_unordered_map)
+{
+    // Random inserts and erases, with few enough keys that most of them
+    // land on deleted buckets
+    std::mt19937 rng(42);
+    Group_Hash<uint64_t, int> h;
+    std::unordered_map<uint64_t, int> ref;
+
+    for (unsigned i = 0;  i < 200000;  ++i) {
+        uint64_t key = rng() % 5000;
+        if (key == 0) key = rng();   // some keys that are never erased
+
+        if (rng() % 3 == 0) {
+            BOOST_REQUIRE_EQUAL(h.erase(key), ref.erase(key));
+        }
+        else {
+            h[key] = i;
+            ref[key] = i;
+        }
+        BOOST_REQUIRE_EQUAL(h.size(), ref.size());
+    }
+
+    BOOST_CHECK(h.capacity() <= 16384);
+
+    size_t n = 0;
+    for (auto it = h.begin(), end = h.end();  it != end;  ++it, ++n) {
+        auto jt = ref.find(it->first);
+        BOOST_REQUIRE(jt != ref.end());
+        BOOST_CHECK_EQUAL(it->second, jt->second);
+    }
+    BOOST_CHECK_EQUAL(n, ref.size());
+
+    Group_Hash<uint64_t, int> h2 = h;
+    Group_Hash<uint64_t, int> h3(std::move(h));
+    BOOST_CHECK_EQUAL(h.size(), 0);
+    BOOST_CHECK(h.find(1) == h.end());
+
+    for (auto & entry: ref) {
+        BOOST_CHECK_EQUAL(h2.find(entry.first)->second, entry.second);
+        BOOST_CHECK_EQUAL(h3.find(entry.first)->second, entry.second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_group_hash_strings)
+{
+    Group_Hash<std::string, int> h;
+    for (unsigned i = 0;  i < 1000;  ++i)
+        h["agent_" + to_string(i)] = i;
+
+    BOOST_CHECK_EQUAL(h.size(), 1000);
+    for (unsigned i = 0;  i < 1000;  ++i)
+        BOOST_CHECK_EQUAL(h.find("agent_" + to_string(i))->second, i);
+    BOOST_CHECK(h.find("agent_1000") == h.end());
+
+    for (unsigned i = 0;  i < 1000;  i += 2)
+        h.erase(h.find("agent_" + to_string(i)));
+    BOOST_CHECK_EQUAL(h.size(), 500);
+    BOOST_CHECK(h.find("agent_2") == h.end());
+    BOOST_CHECK_EQUAL(h.find("agent_3")->second, 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_group_hash_construct_destroy)
+{
+    constructed = destroyed = 0;
+
+    {
+        Group_Hash<int, Obj> h;
+        for (unsigned i = 0;  i < 1000;  ++i)
+            h[i] = i;
+        for (unsigned i = 0;  i < 1000;  i += 3)
+            h.erase(i);
+
+        Group_Hash<int, Obj> h2 = h;
+        BOOST_CHECK_EQUAL(h2.size(), h.size());
+        BOOST_CHECK_EQUAL(h2[1].val, 1);
+
+        h.clear();
+        BOOST_CHECK_EQUAL(constructed - destroyed, h2.size());
+    }
+
+    BOOST_CHECK_EQUAL(constructed, destroyed);
+}
+
+BOOST_AUTO_TEST_CASE(test_group_hash_set)
+{
+    int nobj = 100;
+
+    vector<int> objects;
+    for (unsigned j = 0;  j < nobj;  ++j)
+        objects.push_back(random());
+
+    Group_Hash_Set<int> s;
+
+    BOOST_CHECK_EQUAL(s.size(), 0);
+
+    for (unsigned i = 0;  i < nobj;  ++i) {
+        BOOST_CHECK_EQUAL(s.count(objects[i]), 0);
+        s.insert(objects[i]);
+        BOOST_CHECK_EQUAL(s.size(), i + 1);
+        BOOST_CHECK_EQUAL(s.count(objects[i]), 1);
+    }
+
+    vector<int> obj2(s.begin(), s.end());
+    std::sort(objects.begin(), objects.end());
+    std::sort(obj2.begin(), obj2.end());
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(objects.begin(), objects.end(),
+                                  obj2.begin(), obj2.end());
+
+    Group_Hash_Set<int> s2 = s;
+    vector<int> obj3(s2.begin(), s2.end());
+    std::sort(obj3.begin(), obj3.end());
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(objects.begin(), objects.end(),
+                                  obj3.begin(), obj3.end());
+
+    Group_Hash_Set<int> s3 = { -1, 0, 1 };
+    BOOST_CHECK_EQUAL(s3.size(), 3);
+    BOOST_CHECK_EQUAL(s3.count(-1), 1);
+    BOOST_CHECK_EQUAL(s3.count(2), 0);
+}
@@ -14,6 +14,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/auto_unit_test.hpp>
 #include <math.h>
+#include <sstream>
 
 using namespace ML;
 
@@ -86,3 +87,100 @@ BOOST_AUTO_TEST_CASE( test1 )
     BOOST_CHECK_THROW(testHex4("002G", 2), std::exception);
     BOOST_CHECK_THROW(testHex4("002.", 2), std::exception);
 }
+
+void testSkip(const std::string & str)
+{
+    Parse_Context context(str, str.c_str(), str.c_str() + str.size());
+    skipJson(context);
+    skipJsonWhitespace(context);
+    context.expect_eof();
+}
+
+BOOST_AUTO_TEST_CASE( test_skip )
+{
+    testSkip("null");
+    testSkip(" true ");
+    testSkip("-1.5e3");
+    testSkip("\"a \\\"quoted\\\" \\u00e9 string\"");
+    testSkip("[]");
+    testSkip("{}");
+    testSkip("[1, [2, [3]], {\"a\": {\"b\": [true, false, null]}}]");
+    testSkip("{ \"key\" : \"value\", \"\\u0000\": [ \"x\" ] }");
+
+    JML_TRACE_EXCEPTIONS(false);
+    BOOST_CHECK_THROW(testSkip("[1, 2"), std::exception);
+    BOOST_CHECK_THROW(testSkip("{\"a\" 1}"), std::exception);
+    BOOST_CHECK_THROW(testSkip("\"\\q\""), std::exception);
+    BOOST_CHECK_THROW(testSkip("nul"), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_string_buffer )
+{
+    auto parse = [] (const std::string & str, size_t maxLength) -> std::string
+        {
+            Parse_Context context(str, str.c_str(), str.c_str() + str.size());
+            char buffer[maxLength];
+            ssize_t len = expectJsonString(context, buffer, maxLength);
+            if (len == -1) return "<overflow>";
+            BOOST_CHECK_EQUAL(strlen(buffer), len);
+            return buffer;
+        };
+
+    BOOST_CHECK_EQUAL(parse("\"hello\"", 16), "hello");
+    BOOST_CHECK_EQUAL(parse("\"a\\tb\\\\c\"", 16), "a\tb\\c");
+    BOOST_CHECK_EQUAL(parse("\"\\u00e9\\u20ac\"", 16), "\xc3\xa9\xe2\x82\xac");
+    BOOST_CHECK_EQUAL(parse("\"\xc3\xa9\"", 16), "\xc3\xa9");
+    BOOST_CHECK_EQUAL(parse("\"hello\"", 4), "<overflow>");
+    BOOST_CHECK_EQUAL(parse("\"a\\u0000b\"", 16), "<overflow>");
+
+    std::string str = "\"" + std::string(100, 'x') + "\"";
+    Parse_Context context(str, str.c_str(), str.c_str() + str.size());
+    BOOST_CHECK_EQUAL(expectJsonString(context), std::string(100, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE( test_string_runs )
+{
+    // Put each kind of special character at every position of strings
+    // longer than a vector, and check the scan finds the first one
+    const char specials[] = { '"', '\\', '\n', '\x01', '\x7f', '\xc3' };
+
+    for (unsigned len = 0;  len < 40;  ++len) {
+        std::string s(len, 'a');
+        BOOST_CHECK(findJsonSpecialChar(s.data(), s.data() + len)
+                    == s.data() + len);
+
+        for (unsigned i = 0;  i < len;  ++i) {
+            for (char c: specials) {
+                std::string s2 = s;
+                s2[i] = c;
+                BOOST_CHECK_EQUAL(findJsonSpecialChar(s2.data(),
+                                                      s2.data() + len)
+                                  - s2.data(), i);
+            }
+        }
+    }
+
+    // Runs of plain characters across the buffers of a chunked stream
+    std::string text = std::string(50, 'x') + "\\t" + std::string(20, 'y')
+        + "\\u00e9" + std::string(33, 'z');
+    std::string expected = std::string(50, 'x') + "\t" + std::string(20, 'y')
+        + "\xc3\xa9" + std::string(33, 'z');
+
+    for (unsigned chunkSize: { 1, 7, 16, 4096 }) {
+        std::istringstream stream("\"" + text + "\" \"" + text + "\" 1");
+        Parse_Context context("stream", stream, 1, 1, chunkSize);
+        BOOST_CHECK_EQUAL(expectJsonString(context), expected);
+        skipJson(context);
+        BOOST_CHECK_EQUAL(context.get_col(), 2 * text.size() + 6);
+        skipJsonWhitespace(context);
+        BOOST_CHECK_EQUAL(expectJsonNumber(context).uns, 1);
+    }
+
+    std::string ascii = "\"" + std::string(40, 'a') + "\\\"b\"";
+    Parse_Context context(ascii, ascii.c_str(), ascii.c_str() + ascii.size());
+    BOOST_CHECK_EQUAL(expectJsonStringAscii(context),
+                      std::string(40, 'a') + "\"b");
+
+    BOOST_CHECK_EQUAL(jsonEscape(std::string(40, 'a') + "\"\n/"),
+                      std::string(40, 'a') + "\\\"\\n/");
+}
@@ -644,3 +644,57 @@ BOOST_AUTO_TEST_CASE(test_match_literal_at_eof)
     BOOST_CHECK(c1.match_literal("hello"));
     BOOST_CHECK(!c1.match_literal("one"));
 }
+
+BOOST_AUTO_TEST_CASE(test_number_fast_paths)
+{
+    // All but the last number end within the buffer and so go through the
+    // fast paths of the matchers
+    string s = "12345678901234567,-42,+7,123,4.5,0.1,1.5e3,-2.5E-4,-0.0,"
+        "123456789012345678901,9007199254740993,1e400,nan,99";
+    Parse_Context c(s, s.c_str(), s.c_str() + s.length());
+
+    BOOST_CHECK_EQUAL(c.expect_long_long(), 12345678901234567LL);
+    c.expect_literal(',');
+    BOOST_CHECK_EQUAL(c.expect_int(), -42);
+    c.expect_literal(',');
+    unsigned u;
+    BOOST_CHECK(!c.match_unsigned(u));
+    BOOST_CHECK_EQUAL(c.expect_long(), 7);
+    c.expect_literal(',');
+    BOOST_CHECK_EQUAL(c.expect_unsigned_long_long(), 123);
+    BOOST_CHECK_EQUAL(c.get_col(), 29);
+    c.expect_literal(',');
+    unsigned long long ull;
+    BOOST_CHECK(!c.match_unsigned_long_long(ull));
+    BOOST_CHECK_EQUAL(c.expect_double(), 4.5);
+    c.expect_literal(',');
+
+    BOOST_CHECK_EQUAL(c.expect_double(), 0.1);
+    c.expect_literal(',');
+    BOOST_CHECK_EQUAL(c.expect_float(), 1500.0f);
+    c.expect_literal(',');
+    BOOST_CHECK_EQUAL(c.expect_double(), -2.5e-4);
+    c.expect_literal(',');
+    double d = c.expect_double();
+    BOOST_CHECK_EQUAL(d, 0.0);
+    BOOST_CHECK(std::signbit(d));
+    c.expect_literal(',');
+
+    // Too many digits, too large a mantissa or exponent and nan are all
+    // handed to the general parser
+    BOOST_CHECK_EQUAL(c.expect_double(), 123456789012345678901.0);
+    c.expect_literal(',');
+    BOOST_CHECK_EQUAL(c.expect_double(), 9007199254740992.0);
+    c.expect_literal(',');
+    BOOST_CHECK(std::isinf(c.expect_double()));
+    c.expect_literal(',');
+    BOOST_CHECK(std::isnan(c.expect_double()));
+    c.expect_literal(',');
+
+    // Out of range values are rejected without moving
+    int i;
+    BOOST_CHECK(!c.match_int(i, 0, 10));
+    BOOST_CHECK_EQUAL(c.get_offset(), s.length() - 2);
+    BOOST_CHECK_EQUAL(c.expect_int(0, 100), 99);
+    BOOST_CHECK(c.eof());
+}
@@ -0,0 +1,159 @@
+/* ring_buffer_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the lock free ring buffers.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "jml/utils/ring_buffer.h"
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+#include <string>
+
+using namespace ML;
+using namespace std;
+
+
+BOOST_AUTO_TEST_CASE( test_lock_free_ring_buffer_single_thread )
+{
+    RingBufferLockFreeSRMW<string> ring(3);
+    BOOST_CHECK_EQUAL(ring.capacity(), 4);
+
+    string value;
+    BOOST_CHECK(!ring.tryPop(value));
+
+    // Goes around a few times.
+    for (int round = 0;  round < 5;  ++round) {
+        for (int i = 0;  i < 4;  ++i)
+            BOOST_CHECK(ring.tryPush(to_string(round * 4 + i)));
+        BOOST_CHECK(!ring.tryPush(string("full")));
+
+        for (int i = 0;  i < 4;  ++i) {
+            BOOST_CHECK(ring.tryPop(value));
+            BOOST_CHECK_EQUAL(value, to_string(round * 4 + i));
+        }
+        BOOST_CHECK(!ring.tryPop(value));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_lock_free_ring_buffer_threads )
+{
+    enum { NumWriters = 4, PerWriter = 200000 };
+
+    RingBufferLockFreeSRMW<uint64_t> ring(1024);
+
+    std::atomic<uint64_t> dropped(0);
+    std::vector<std::thread> writers;
+    for (uint64_t w = 0;  w < NumWriters;  ++w) {
+        writers.emplace_back([&, w] () {
+                    for (uint64_t i = 0;  i < PerWriter;  ++i)
+                        if (!ring.tryPush(w << 32 | i)) ++dropped;
+                });
+    }
+
+    // Each writer's values must come out in order and exactly once.
+    std::vector<int64_t> last(NumWriters, -1);
+    uint64_t popped = 0;
+    std::atomic<bool> writing(true);
+
+    std::thread joiner([&] () {
+                for (auto & writer: writers) writer.join();
+                writing = false;
+            });
+
+    for (;;) {
+        bool done = !writing;
+        uint64_t value;
+        while (ring.tryPop(value)) {
+            int w = value >> 32;
+            int64_t i = value & 0xffffffff;
+            BOOST_REQUIRE_LT(w, NumWriters);
+            BOOST_REQUIRE_GT(i, last[w]);
+            last[w] = i;
+            ++popped;
+        }
+        if (done) break;
+    }
+
+    joiner.join();
+
+    BOOST_CHECK_EQUAL(popped + dropped, NumWriters * PerWriter);
+}
+
+BOOST_AUTO_TEST_CASE( test_ring_buffer_blocking )
+{
+    enum { NumWriters = 3, NumReaders = 3, PerWriter = 100000 };
+
+    // Small so that the writers and readers both have to wait
+    RingBufferSRMW<uint64_t> ring(16);
+
+    std::vector<std::thread> writers;
+    for (uint64_t w = 0;  w < NumWriters;  ++w) {
+        writers.emplace_back([&, w] () {
+                    for (uint64_t i = 0;  i < PerWriter;  ++i)
+                        ring.push(w << 32 | i);
+                });
+    }
+
+    std::atomic<uint64_t> popped(0), total(0);
+    std::vector<std::thread> readers;
+    for (unsigned r = 0;  r < NumReaders;  ++r) {
+        readers.emplace_back([&] () {
+                    for (;;) {
+                        uint64_t value = ring.pop();
+                        if (value == uint64_t(-1)) break;
+                        total += value & 0xffffffff;
+                        ++popped;
+                    }
+                });
+    }
+
+    for (auto & writer: writers) writer.join();
+    for (unsigned r = 0;  r < NumReaders;  ++r)
+        ring.push(uint64_t(-1));
+    for (auto & reader: readers) reader.join();
+
+    uint64_t perWriter = uint64_t(PerWriter) * (PerWriter - 1) / 2;
+    BOOST_CHECK_EQUAL(popped, NumWriters * PerWriter);
+    BOOST_CHECK_EQUAL(total, NumWriters * perWriter);
+    BOOST_CHECK(!ring.couldPop());
+}
+
+BOOST_AUTO_TEST_CASE( test_ring_buffer_timeout_and_empty )
+{
+    RingBufferSWMR<string> ring(4);
+
+    string value;
+    BOOST_CHECK(!ring.tryPop(value, 0.01));
+
+    std::thread reader([&] () {
+                string value;
+                for (unsigned i = 0;  i < 100;  ++i) {
+                    BOOST_CHECK(ring.tryPop(value, 10.0));
+                    BOOST_CHECK_EQUAL(value, to_string(i));
+                }
+            });
+
+    for (unsigned i = 0;  i < 100;  ++i)
+        ring.push(to_string(i));
+
+    ring.waitUntilEmpty();
+    BOOST_CHECK(ring.empty());
+    reader.join();
+
+    ring.push(string("a"));
+    ring.push(string("b"));
+    auto values = ring.tryPopMulti(5);
+    BOOST_REQUIRE_EQUAL(values.size(), 2);
+    BOOST_CHECK_EQUAL(values[1], "b");
+
+    // Moved buffers keep what they hold
+    ring.push(string("c"));
+    RingBufferSWMR<string> moved(std::move(ring));
+    BOOST_CHECK_EQUAL(moved.pop(), "c");
+}
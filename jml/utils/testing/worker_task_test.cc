@@ -160,3 +160,84 @@ BOOST_AUTO_TEST_CASE( test_exception )
                           std::exception);
     }
 }
+
+BOOST_AUTO_TEST_CASE( test_nested_groups )
+{
+    /* Each child group is created and filled by a job of the parent group,
+       so its jobs start out on a worker's queue and get stolen from there.
+       The parent must only finish once all of its children have. */
+    int nchildren = 20, njobs = 100;
+
+    for (int nthreads: { 0, 1, 4 }) {
+        Worker_Task worker(nthreads);
+
+        std::atomic<int> jobs_run(0), children_finished(0);
+        int parent_finished = 0, children_before_parent = -1;
+
+        auto finish_parent = [&] ()
+            {
+                children_before_parent = children_finished;
+                ++parent_finished;
+            };
+
+        auto add_child = [&] (int parent)
+            {
+                int child = worker.get_group([&] () { ++children_finished; },
+                                             "child", parent);
+                Call_Guard guard(boost::bind(&Worker_Task::unlock_group,
+                                             boost::ref(worker),
+                                             child));
+
+                for (unsigned i = 0;  i < njobs;  ++i)
+                    worker.add([&] () { ++jobs_run; }, "job", child);
+            };
+
+        int parent = worker.get_group(finish_parent, "parent");
+        {
+            Call_Guard guard(boost::bind(&Worker_Task::unlock_group,
+                                         boost::ref(worker),
+                                         parent));
+
+            for (unsigned i = 0;  i < nchildren;  ++i)
+                worker.add(std::bind<void>(add_child, parent),
+                           "add child", parent);
+        }
+
+        worker.run_until_finished(parent);
+
+        BOOST_CHECK_EQUAL(jobs_run, nchildren * njobs);
+        BOOST_CHECK_EQUAL(children_finished, nchildren);
+        BOOST_CHECK_EQUAL(children_before_parent, nchildren);
+        BOOST_CHECK_EQUAL(parent_finished, 1);
+        BOOST_CHECK_EQUAL(worker.queued(), 0);
+        BOOST_CHECK_EQUAL(worker.finished(), nchildren * (njobs + 1));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_exception_in_child_group )
+{
+    Worker_Task worker(2);
+    set_trace_exceptions(false);
+
+    int parent = worker.get_group(NO_JOB, "parent");
+    int child = worker.get_group(NO_JOB, "child", parent);
+    {
+        Call_Guard guard(boost::bind(&Worker_Task::unlock_group,
+                                     boost::ref(worker),
+                                     child));
+
+        for (unsigned i = 0;  i < 100;  ++i)
+            worker.add(i == 50 ? Job(exception_job) : Job(null_job),
+                       "job", child);
+    }
+
+    {
+        JML_TRACE_EXCEPTIONS(false);
+        BOOST_CHECK_THROW(worker.run_until_finished(child), std::exception);
+    }
+
+    /* The failed child doesn't hold up its parent */
+    worker.run_until_finished(parent, true /* unlock */);
+    BOOST_CHECK_EQUAL(worker.queued(), 0);
+    BOOST_CHECK_EQUAL(worker.running(), 0);
+}
@@ -11,6 +11,7 @@
 #include "jml/arch/timers.h"
 #include "jml/utils/string_functions.h"
 #include <iostream>
+#include <deque>
 #include <boost/utility.hpp>
 #include "jml/utils/environment.h"
 #include "jml/utils/guard.h"
@@ -46,6 +47,63 @@ void log(const string & msg)
 
 const Job NO_JOB;
 
+namespace {
+
+std::atomic<uint64_t> next_serial(1);
+
+/* The task and queue of the worker thread we're running on, if any */
+thread_local uint64_t worker_serial = 0;
+thread_local int worker_queue = -1;
+
+} // file scope
+
+
+/*****************************************************************************/
+/* WORKER_TASK QUEUE                                                         */
+/*****************************************************************************/
+
+/* The owning thread pushes and pops at the back; other threads steal from
+   the front.  The lock is only ever contended by a thief, and the size lets
+   the thieves pass over empty queues without taking it. */
+
+struct Worker_Task::Queue {
+    Queue()
+        : size(0)
+    {
+    }
+
+    void push(Job_Info && info)
+    {
+        Guard guard(lock);
+        jobs.emplace_back(std::move(info));
+        ++size;
+    }
+
+    bool pop(Job_Info & info, bool newest)
+    {
+        if (size == 0) return false;
+
+        Guard guard(lock);
+        if (jobs.empty()) return false;
+
+        if (newest) {
+            info = std::move(jobs.back());
+            jobs.pop_back();
+        }
+        else {
+            info = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        --size;
+
+        return true;
+    }
+
+    Lock lock;
+    std::deque<Job_Info> jobs;
+    std::atomic<int> size;
+};
+
 
 /*****************************************************************************/
 /* WORKER_TASK                                                               */
@@ -61,9 +119,9 @@ instance(int thr)
 
 Worker_Task::
 Worker_Task(int threads)
-    : jobs_sem(0), finished_sem(1), state_change_sem(0), shutdown_sem(0),
-      next_group(0), next_job(0), num_queued(0),
-      num_running(0), force_finished(false)
+    : serial_(next_serial++), next_queue(0), next_worker(0),
+      next_group(0), next_job(0), num_queued(0), num_running(0),
+      state_epoch(0), num_sleeping(0), force_finished(false)
 {
     if (threads == -1)
         threads = num_cpus();
@@ -72,6 +130,10 @@ Worker_Task(int threads)
 
     //cerr << "creating worker task with " << threads << " threads" << endl;
 
+    /* With no threads, the calling thread runs everything from one queue */
+    for (int i = 0;  i < std::max(threads, 1);  ++i)
+        queues.emplace_back(new Queue());
+
     /* Create our threads */
     for (unsigned i = 0;  i < threads;  ++i)
         workerThreads_.emplace_back(new std::thread(std::bind(&Worker_Task::runWorkerThread, this)));
@@ -83,25 +145,21 @@ Worker_Task::
     log("~Worker_Task: stopping worker task\n");
     force_finished = true;
 
-    // Wake up all tasks by providing jobs
-    for (unsigned i = 0;  i < threads_;  ++i)
-        jobs_sem.release();
+    // Wake up all of the threads so that they see that we're finished
+    notify_state_changed();
 
     /* TODO: finish all tasks */
-    if (jobs.size() || groups.size())
-        cerr << "at the end, there were " << jobs.size()
-             << " jobs outstanding and "
-             << groups.size() << " groups outstanding" << endl;
-
-    for (unsigned i = 0;  i < threads_;  ++i)
-        shutdown_sem.acquire();
+    {
+        Guard guard(groups_lock);
+        if (num_queued || groups.size())
+            cerr << "at the end, there were " << num_queued
+                 << " jobs outstanding and "
+                 << groups.size() << " groups outstanding" << endl;
+    }
 
     // Join all worker threads
-    for (auto & t: workerThreads_) {
-        while (!t->joinable())
-            ML::sleep(0.01);
+    for (auto & t: workerThreads_)
         t->join();
-    }
 
     log("~Worker_Task: stopped worker task\n");
 }
@@ -115,83 +173,72 @@ get_group(const Job & group_finish, const std::string & info_str,
 
     if (!locked) cerr << "warning: creating unlocked group" << endl;
 
-    Guard guard(lock);
-    Id id = next_group++;
-    groups[id].finished = group_finish;
-    groups[id].parent_group = parent_group;
-    groups[id].locked = locked;
-    groups[id].info = info_str;
-
-    /* Add a job for the group.  This allows us to keep track of where the child
-       jobs get inserted. */
-    Job_Info info(group_finish, Job(),
-                  format("job for group %lld: ", id) + info_str, -1, id);
-    
-    Jobs::iterator where = jobs.end();
-
-    /* Insert it at the end of its parent's jobs if it has one. */
+    std::shared_ptr<Group_Info> parent;
     if (parent_group != -1) {
-        groups[parent_group].groups_outstanding += 1;
-        where = groups[parent_group].group_job;
+        parent = find_group(parent_group);
+        if (!parent)
+            throw Exception("Worker_Task::get_group(): parent group info "
+                            "has none");
+        ++parent->outstanding;
     }
-    
-    Jobs::iterator it = jobs.insert(where, info);
-    groups[id].group_job = it;
-    
-    notify_state_changed();
-    
+
+    Id id = next_group++;
+    auto group = std::make_shared<Group_Info>(id, group_finish,
+                                              std::move(parent), locked,
+                                              info_str);
+
+    Guard guard(groups_lock);
+    groups[id] = std::move(group);
+
     return id;
 }
 
 void Worker_Task::unlock_group(int group)
 {
     //cerr << "unlocked group " << group << endl;
-    Guard guard(lock);
-    if (!groups.count(group))
+    std::shared_ptr<Group_Info> group_info = find_group(group);
+    if (!group_info)
         throw Exception("Worker_Task::unlock_group(): group info has none");
-    groups[group].locked = false;
-    check_finished_ul(group);
 
-    notify_state_changed();
+    if (group_info->locked.exchange(false))
+        release_group(group_info);
+    else if (group_info->outstanding == 0)
+        finish_group(group_info);
 }
 
 Worker_Task::Id
 Worker_Task::
 add(const Job & job, const Job & error, const std::string & job_info, Id group)
 {
-    /* Wait to manupulate */
-    Guard guard(lock);
-    Job_Info info(job, error, job_info, next_job++, group);
-
-    /* Find where to put it. */
+    std::shared_ptr<Group_Info> group_info;
 
     if (group != -1) {
-        if (!groups.count(group))
+        group_info = find_group(group);
+        if (!group_info)
             throw Exception("Worker_Task::add(): group info has none");
 
-        Group_Info & group_info = groups[group];
-        if (group_info.exc) {
+        if (group_info->failed) {
             log("ignoring job addition to an error group\n");
             return -1;
         }
-        ++group_info.jobs_outstanding;
-        
-        /* Jobs::iterator it = */ jobs.insert(group_info.group_job, info);
+        ++group_info->outstanding;
     }
-    else jobs.push_back(info);
-    
+
+    Id id = next_job++;
+
+    /* Our own threads keep the jobs they add; anyone else's are dealt out
+       over the queues. */
+    int queue = my_queue();
+    if (queue == -1)
+        queue = next_queue++ % queues.size();
+
     ++num_queued;
-    
-    jobs_sem.release();  // release one to allow something to run the job
-    
-    /* If this is the first job running, then we are no longer finished so we
-       acquire the finished semaphore. */
-    if (num_queued + num_running == 1)
-        finished_sem.acquire();
+    queues[queue]->push(Job_Info(job, error, job_info, id,
+                                 std::move(group_info)));
 
-    notify_state_changed();
+    notify_state_changed(false /* all */);
     
-    return info.id;
+    return id;
 }
 
 Worker_Task::Id
@@ -203,11 +250,8 @@ add(const Job & job, const std::string & job_info, Id group)
 
 void Worker_Task::finish_all()
 {
-    /* Wait until we are finished */
-    finished_sem.acquire();
-
-    /* Let something else finish */
-    finished_sem.release();
+    /* Help out until we are finished */
+    run_until([&] () { return num_queued + num_running == 0; });
 }
 
 void Worker_Task::clear_all()
@@ -219,687 +263,322 @@ int Worker_Task::runWorkerThread()
 {
     //cerr << "worker function" << endl;
     
+    worker_serial = serial_;
+    worker_queue = next_worker++;
+
     /* This is the worker function.  We grab work while there is any until it
        is time to exit. */
-    
-    while (!force_finished) {
-        
-        log("runWorkerThread: getting job\n");
-        Job_Info info = get_job();
-        log("runWorkerThread: got job: " + to_string(info.id) + "\n");
-
-        if (force_finished) break;
-
-        try {
-            log("runWorkerThread: running job\n");
-            //cerr << "thread " << ACE_OS::thr_self() << " is running job "
-            //     << info.id << " (" << info.info << ")" << endl;
-            if (!info.invalidGroup) {
-                info.job();
-            }
-            else {
-                log("skipping job from invalid group\n");
-            }
-        }
-        catch (const std::exception & exc) {
-            log("runWorkerThread: job exception: " + string(exc.what())
-                + "\n");
-            // TODO: make this exception go to the calling process
-            //cerr << "thread " << ACE_OS::thr_self() << " running job "
-            //     << info.id << " (" << info.info << "): " << endl;
-            //cerr << "warning: job threw exception: "
-            //     << exc.what() << endl;
-            try {
-                if (info.error) info.error();
-            }
-            catch (const std::exception & exc) {
-                cerr << "warning: job error function throw exception: "
-                     << exc.what() << endl;
-            }
+    run_until([&] () -> bool { return force_finished; });
 
-            /* Indicate that the job's group had an error. */
-            if (info.group != -1) {
-                Guard guard(lock);
-                Group_Info & group_info = groups[info.group];
-                if (!group_info.exc) {
-                    /* When a job fails in a group, all remaining jobs from
-                       this group are marked for skipping and the queue is
-                       cleaned up gradually via get_job/finish_job. This
-                       marking is performed by both the worker and control
-                       threads. When it is known that all jobs have been fully
-                       executed or skipped, the group is then removed and the
-                       exception rethrown from the control thread. */
-                    group_info.exc = current_exception();
-                    mark_group_jobs_invalid_ul(group_info, info.group);
-                }
-            }
-        }
-        //cerr << "thread " << ACE_OS::thr_self() << " is finished job "
-        //     << info.id << " (" << info.info << ")" << endl;
-        finish_job(info);
-    }
-
-    shutdown_sem.release();
-    
     return 0;
 }
 
-void Worker_Task::notify_state_changed()
+int Worker_Task::my_queue() const
 {
-    // must be called with the lock held
-    for (set<Semaphore *>::const_iterator it = state_semaphores.begin();
-         it != state_semaphores.end();  ++it)
-        (*it)->release();
-}
+    if (worker_serial == serial_)
+        return worker_queue;
 
-void Worker_Task::add_state_semaphore(Semaphore & sem)
-{
-    Guard guard(lock);
-    if (state_semaphores.count(&sem))
-        throw Exception("same state semaphore added twice");
-    state_semaphores.insert(&sem);
-}
+    /* With no worker threads, the calling thread owns the only queue */
+    if (threads_ == 0)
+        return 0;
 
-void Worker_Task::remove_state_semaphore(Semaphore & sem)
-{
-    Guard guard(lock);
-    if (!state_semaphores.count(&sem))
-        throw Exception("state semaphore was lost");
-    state_semaphores.erase(&sem);
+    return -1;
 }
 
-void Worker_Task::run_until_released(Semaphore & sem, int group)
+std::shared_ptr<Worker_Task::Group_Info>
+Worker_Task::
+find_group(Id group)
 {
-    /* We check at every change in state for either a) the semaphore
-       being free or b) a job being available. */
-
-    Semaphore state_semaphore(0);
-    add_state_semaphore(state_semaphore);
-
-    /* Make sure we remove this semaphore at the end. */
-    Call_Guard guard(boost::bind(&Worker_Task::remove_state_semaphore,
-                                 this, boost::ref(state_semaphore)));
-    
-    while (sem.tryacquire() == -1) {
-
-        /* Run a job, if there is one old job to finish. */
-        
-        Job_Info info;
-        if (try_get_job(info, group)) {
-            // release lock here
+    /* Jobs tend to be added to the same group many times in a row, so each
+       thread remembers the last group it found to avoid taking the lock.
+       Ids are never reused within a task. */
+    static thread_local uint64_t last_serial = 0;
+    static thread_local Id last_id = -1;
+    static thread_local std::shared_ptr<Group_Info> last_group;
 
-            try {
-                if (!info.invalidGroup) {
-                    info.job();
-                }
-                else {
-                    log("skipping job from invalid group\n");
-                }
-            }
-            catch (const std::exception & exc) {
-                // TODO: make this exception go to the calling process
-                cerr << "warning: job threw exception: "
-                     << exc.what() << endl;
-                try {
-                    if (info.error) info.error();
-                }
-                catch (const std::exception & exc) {
-                    cerr << "warning: job error function throw exception: "
-                         << exc.what() << endl;
-                }
-            }
+    if (last_serial == serial_ && last_id == group
+        && last_group && !last_group->done)
+        return last_group;
 
-            finish_job(info);
+    std::shared_ptr<Group_Info> result;
+    {
+        Guard guard(groups_lock);
+        auto it = groups.find(group);
+        if (it != groups.end())
+            result = it->second;
+    }
 
-            continue;
-        }
+    /* A group that failed is still there until its exception has been
+       handled; one that finished normally is on its way out. */
+    if (result && result->done && !result->failed)
+        result.reset();
 
-        /* Wait for a state change. */
-        state_semaphore.acquire();
-    }
-    
-    sem.release();
-}
+    last_serial = serial_;
+    last_id = group;
+    last_group = result;
 
-void
-Worker_Task::
-cancel_group(Group_Info & group_info, int group)
-{
-    Guard guard(lock);
-    cancel_group_ul(group_info, group);
+    return result;
 }
 
-void
-Worker_Task::
-cancel_group_ul(Group_Info & group_info, int group)
+bool Worker_Task::try_get_job(Job_Info & info)
 {
-    log("cancel_group_ul\n");
-    //cerr << "thread " << ACE_OS::thr_self() << " cancel_group() "
-    //     << group_info.info << endl;
-    
-    /* We clean up the group by scanning through its list of tasks, removing
-       those that haven't run yet, and calling all of the handlers. */
-    Jobs::iterator it = jobs.begin();
-        
-    /* Iterate through this group's jobs. */
-        
-    while (it != group_info.group_job) {
-        while (it != group_info.group_job
-               && (it->id == -1 || !in_group(*it, group))) ++it;
-            
-        if (it == group_info.group_job) break;
-            
-        /* Remove this job. */
-        //cerr << "removing job " << it->id << " (" << it->info
-        //     << ")" << endl;
-
-            
-        Jobs::iterator next = it;
-        ++next;
-        remove_job_ul(it);
-        it = next;
-    }
-    
-    log("finished clearning jobs for group " + to_string(group) + "\n");
-}
+    if (num_queued == 0) return false;
 
-void
-Worker_Task::
-mark_group_jobs_invalid_ul(Group_Info & group_info, int group)
-{
-    log("mark_group_jobs_invalid_ul\n");
+    int nqueues = queues.size();
+    int self = my_queue();
 
-    if (group == -1) {
-        throw ML::Exception("cannot mark group -1 as invalid");
-    }
+    /* Other threads start stealing at a different queue each time so that
+       they don't all go for the first one. */
+    static thread_local unsigned victim = 0;
+    int start = (self == -1 ? victim++ % nqueues : self);
 
-    for (Jobs::iterator it = jobs.begin(); it != group_info.group_job; it++) {
-        if (it->group == group) {
-            it->invalidGroup = true;
+    for (int i = 0;  i < nqueues;  ++i) {
+        int queue = (start + i) % nqueues;
+        if (queues[queue]->pop(info, queue == self)) {
+            ++num_running;
+            --num_queued;
+            return true;
         }
     }
 
-    log("mark_group_jobs_invalid_ul done\n");
+    return false;
 }
 
-void
-Worker_Task::
-wait_group_finished(Group_Info & group_info, int group)
+void Worker_Task::run_job(Job_Info & info)
 {
-    // cancel_group(group_info, group);
-    /* Wait until everything has stopped running in this group. */
+    Group_Info * group = info.group.get();
+
+    try {
+        //cerr << "thread " << ACE_OS::thr_self() << " is running job "
+        //     << info.id << " (" << info.info << ")" << endl;
+        if (!group || !group->failed) {
+            info.job();
+        }
+        else {
+            log("skipping job from invalid group\n");
+        }
+    }
+    catch (const std::exception & exc) {
+        log("run_job: job exception: " + string(exc.what()) + "\n");
+        try {
+            if (info.error) info.error();
+        }
+        catch (const std::exception & exc) {
+            cerr << "warning: job error function throw exception: "
+                 << exc.what() << endl;
+        }
 
-    Semaphore state_semaphore(0);
-    add_state_semaphore(state_semaphore);
+        /* When a job fails in a group, the rest of the group's jobs are
+           skipped as they come up, and the exception is rethrown from the
+           control thread once they have all been run or skipped. */
+        if (group && !group->failed.exchange(true))
+            group->exc = current_exception();
+    }
 
-    /* Make sure we remove this semaphore at the end. */
-    Call_Guard guard(boost::bind(&Worker_Task::remove_state_semaphore,
-                                 this, boost::ref(state_semaphore)));
-    
-    while (group_info.jobs_running > 0)
-        state_semaphore.acquire();
+    --num_running;
 
-    /* Group should be finished. */
-    log("group finished\n");
+    if (group)
+        release_group(info.group);
+
+    if (num_queued + num_running == 0)
+        notify_state_changed();
 }
 
 void
 Worker_Task::
-run_until_finished(int group, bool unlock)
+run_until(const std::function<bool ()> & finished, double timeout)
 {
-    /* We check at every change in state for either a) the group being
-       finished or b) an error from the group or c) a job being available.
-    */
+    int idle = 0;
 
-    map<Id, Group_Info>::iterator group_it;
-    
-    /* Lock the group so that it doesn't get removed. */
-    {
-        Guard guard(lock);
-        group_it = groups.find(group);
-        if (group_it == groups.end()) {
-            if (!unlock) return;  // group must have finished
-            throw Exception("Worker_Task::run_until_finished(): "
-                            "group doesn't exist but should be locked");
-        }
-        if (group_it->second.locked && !unlock)
-            throw Exception("Worker_Task::run_until_finished(): "
-                            "group is locked; it won't ever finish");
-        group_it->second.locked = true;
-    }
-
-    /* The group is locked for now; make sure it will be unlocked at the
-       end. */
-    Call_Guard unlock_guard(boost::bind(&Worker_Task::unlock_group,
-                                        this, group));
-    
-    /* Since the group is locked, this object must remain in memory here
-       and so we don't need to lock to access it.  (A map's iterators
-       aren't invalidated unless the actual object itself is removed).
-    */
-    Group_Info & group_info = group_it->second;
-
-    /* Create a semaphore so that we get notified of state changes. */
-    Semaphore state_semaphore(0);
-    add_state_semaphore(state_semaphore);
-    
-    /* Make sure we remove this semaphore at the end. */
-    Call_Guard state_guard(boost::bind(&Worker_Task::remove_state_semaphore,
-                                       this, boost::ref(state_semaphore)));
-    
     for (;;) {
-        //cerr << "thread " << ACE_OS::thr_self() << " is waiting for group "
-        //     << group << " to finish" << endl;
+        if (finished()) return;
 
-        /* Is the group finished?  If so, we can get out of here. */
-        {
-            if (group_info.jobs_outstanding
-                + group_info.jobs_running
-                + group_info.groups_outstanding == 0) {
-                /* We're finished */
-
-                /* If the group had an error, clean up the group structures,
-                 * then rethrow the exception that occurred. */
-                if (group_info.exc) {
-                    //cerr << "thread " << ACE_OS::thr_self()
-                    //     << " had a group error" << endl;
-
-                    /* Save and replace the exception ptr, as we're about to
-                       remove the group. */
-                    exception_ptr exc = group_info.exc;
-                    group_info.exc = exception_ptr();
-
-                    /* Unlock the group to allow everything to finish. */
-                    unlock_guard.clear();
-                    unlock_group(group);
-
-                    /* Done; throw the exception. */
-                    if (exc)
-                        rethrow_exception(exc);
-                }
-                else
-                    return;
-            }
-        }
-
-        /* Run a job if we can */
         Job_Info info;
-        log("run_until_finished: try to get job\n");
-        if (try_get_job(info, group)) {
-            log("run_until_finished: got job: " + to_string(info.id) + "\n");
-            try {
-                //cerr << "thread " << ACE_OS::thr_self() << " is running job "
-                //     << info.id << " (" << info.info << ")" << endl;
-                log("run_until_finished: running job\n");
-                if (!info.invalidGroup) {
-                    info.job();
-                }
-                else {
-                    log("skipping job from invalid group\n");
-                }
-
-                //cerr << "thread " << ACE_OS::thr_self() << " finished job "
-                //     << info.id << " (" << info.info << ")" << endl;
-            }
-            catch (const std::exception & exc) {
-                log("run_until_finished: job exception\n");
-                // TODO: make this exception go to the calling process
-                //cerr << "thread " << ACE_OS::thr_self() << " running job "
-                //     << info.id << " (" << info.info << "):" << endl;
-                // cerr << "run_until_finished: warning: job threw exception: "
-                //      << exc.what() << endl;
-                try {
-                    if (info.error) info.error();
-                }
-                catch (const std::exception & exc) {
-                    cerr << "warning: job error function throw exception: "
-                         << exc.what() << endl;
-                }
-
-                /* Indicate that the job's group had an error. */
-                if (info.group != -1) {
-                    Guard guard(lock);
-                    Group_Info & group_info = groups[info.group];
-                    if (!group_info.exc) {
-                        group_info.exc = current_exception();
-                        mark_group_jobs_invalid_ul(group_info, info.group);
-                    }
-                }
-            }
-            finish_job(info);
-            
-            continue;  // no state change needed
+        if (try_get_job(info)) {
+            run_job(info);
+            idle = 0;
+            continue;
         }
-        
-        /* Wait for a state change. */
-        state_semaphore.acquire();
-    }
-}
 
-void
-Worker_Task::
-lend_thread(int group)
-{
-    /* Run a job if we can */
-    Job_Info info;
-    if (try_get_job(info, group)) {
-        try {
-            //cerr << "thread " << ACE_OS::thr_self() << " is running job "
-            //     << info.id << " (" << info.info << ")" << endl;
-            if (!info.invalidGroup) {
-                info.job();
-            }
-            else {
-                log("skipping job from invalid group\n");
-            }
+        /* Nothing to do.  Yield for a while in case something turns up,
+           then go to sleep. */
+        if (++idle < 100) {
+            sched_yield();
+            continue;
         }
-        catch (const std::exception & exc) {
-            // TODO: make this exception go to the calling process
-            //cerr << "thread " << ACE_OS::thr_self() << " running job "
-            //     << info.id << " (" << info.info << "):" << endl;
-            cerr << "warning: job threw exception: "
-                 << exc.what() << endl;
-            try {
-                if (info.error) info.error();
-            }
-            catch (const std::exception & exc) {
-                cerr << "warning: job error function throw exception: "
-                     << exc.what() << endl;
-            }
 
-            /* Indicate that the job's group had an error. */
-            if (info.group != -1) {
-                Guard guard(lock);
-                Group_Info & group_info = groups[info.group];
-                if (!group_info.exc) {
-                    group_info.exc = current_exception();
-                    cancel_group_ul(group_info, info.group);
-                }
-            }
-        }
-        //cerr << "thread " << ACE_OS::thr_self() << " finished job "
-        //     << info.id << " (" << info.info << ")" << endl;
-        finish_job(info);
-    }
-}
+        /* Once we're counted as sleeping, whoever changes the state next
+           will wake us up, so look one last time before going to sleep. */
+        uint64_t epoch = state_epoch;
+        ++num_sleeping;
 
-bool Worker_Task::in_group(const Job_Info & info, int group)
-{
-    if (group == -1) return true;
-    
-    /* Check all parents. */
-    if (info.group == group) return true;
-    else if (info.group == -1) return false;
-    else {
-        Group_Info * group_info = &groups[info.group];
-        
-        while (group_info) {
-            Id parent = group_info->parent_group;
-
-            if (parent == -1) group_info = 0;
-            else {
-                if (!groups.count(parent))
-                    throw Exception("Worker_Task::in_group(): invalid "
-                                    "group number");
-                group_info = &groups[parent];
+        bool found = try_get_job(info);
+        if (!found) {
+            if (finished()) {
+                --num_sleeping;
+                return;
             }
-        }
-    }
-
-    return false;
-}
 
-Worker_Task::Job_Info
-Worker_Task::get_job(int group)
-{
-    /* Block until we can acquire a semaphore to have jobs. */
-    for (unsigned i = 0;  i < 100;  ++i) {
-        if (jobs_sem.tryacquire() == 0) {
-            return get_job_impl(group);
+            auto woken = [&] ()
+                {
+                    return state_epoch != epoch || force_finished;
+                };
+
+            Guard guard(sleep_lock);
+            if (timeout > 0)
+                wakeup.wait_for(guard,
+                                std::chrono::microseconds
+                                    ((long long)(timeout * 1000000)),
+                                woken);
+            else wakeup.wait(guard, woken);
         }
-        sched_yield();
-    }
-    jobs_sem.acquire();
-
-    return get_job_impl(group);
-}
 
-bool Worker_Task::try_get_job(Worker_Task::Job_Info & job, int group)
-{
-    if (jobs_sem.tryacquire() == -1) return false;
-    
-    job = get_job_impl(group);
-    return true;
-}
+        --num_sleeping;
 
-Worker_Task::Job_Info Worker_Task::get_job_impl(int group)
-{
-    //cerr << "thread " << ACE_OS::thr_self()
-    //     << " is getting a job in group " << group
-    //     << endl;
-    if (force_finished) return Job_Info();
-
-    for (unsigned i = 0;  i < 100;  ++i) {
-        Guard guard(lock, std::try_to_lock);
-        if (guard)
-            return get_job_impl_ul(group);
-        sched_yield();
+        if (found) {
+            run_job(info);
+            idle = 0;
+        }
     }
-
-    Guard guard(lock);
-
-    //static int numJobs = 0;
-    //cerr << "getting job " << ++numJobs << endl;
-
-    return get_job_impl_ul(group);
 }
 
-Worker_Task::Job_Info
+void
 Worker_Task::
-get_job_impl_ul(int group)
+release_group(const std::shared_ptr<Group_Info> & group)
 {
-    //cerr << "thread " << ACE_OS::thr_self()
-    //     << " is getting a job in group " << group
-    //     << endl;
-    if (force_finished) return Job_Info();
-
-    Jobs::iterator it;
-
-    if (group == -1) {
-        it = jobs.begin();
-
-        /* Try to find one whose id isn't -1 but which is in the group
-           anyway. */
-        while (it != jobs.end() && it->id == -1) ++it;
-        
-        if (it == jobs.end())
-            throw Exception("get_job(): internal error: "
-                            "semaphore acquired with zero jobs");
-    }
-    else {
-        map<Id, Group_Info>::const_iterator group_it
-            = groups.find(group);
-        if (group_it == groups.end()) {
-            //throw Exception("iterator not found in group");
-            cerr << "couldn't find group " << group << " in  list"
-                 << endl;
-            return get_job_impl_ul(-1);
-        }
-        else if (group_it->second.exc)
-            return get_job_impl_ul(-1);  // group has an error; we don't do it
-        else it = jobs.begin();
-        
-        /* Try to find one whose id isn't -1 but which is in the group
-           anyway. */
-        while (it != group_it->second.group_job
-               && (it->id == -1 || !in_group(*it, group)))
-            ++it;
-        
-        /* If we didn't find one in our group, we select any job at all
-           so that we make some progress. */
-        if (it == group_it->second.group_job || !in_group(*it, group))
-            return get_job_impl_ul(-1);
-    }
-    
-    Job_Info result = *it;
-    ++num_running;
+    int left = --group->outstanding;
 
-    if (result.group != -1) ++groups[result.group].jobs_running;
-    
-    --num_queued;
-    jobs.erase(it);
+    if (left < 0)
+        throw Exception("Worker_Task::release_group(): "
+                        "group has negative outstanding count");
 
-    notify_state_changed();
+    if (left == 0)
+        finish_group(group);
 
-    return result;
+    /* Anyone waiting for the group holds it too */
+    else if (left == 1)
+        notify_state_changed();
 }
 
 void
 Worker_Task::
-finish_job(const Job_Info & info)
+finish_group(std::shared_ptr<Group_Info> group)
 {
-    Guard guard(lock, std::defer_lock);
+    /* Go up through the list of parents and notify everywhere of what is
+       finished. */
+    while (group && !group->done.exchange(true)) {
+        //cerr << "finished group " << group->id << endl;
 
-    for (unsigned i = 0;  i < 100;  ++i) {
-        guard.try_lock();
-        if (guard) break;
-    }
+        /* If group has an exception attached to it, it must stay around
+           until the control thread handles it. */
+        if (!group->failed) {
+            try {
+                if (group->finished)
+                    group->finished();
+            }
+            catch (const std::exception & exc) {
+                cerr << "Worker_Task::finish_group(): " << exc.what() << endl;
+            }
 
-    if (!guard)
-        guard.lock();
+            Guard guard(groups_lock);
+            groups.erase(group->id);
+        }
 
-    --num_running;
-    
-    /* Finish off the group if we need to. */
-    Id group = info.group;
-    if (group != -1) {
+        std::shared_ptr<Group_Info> parent = group->parent;
+        if (parent && --parent->outstanding == 0)
+            group = std::move(parent);
+        else group.reset();
+    }
 
-        if (!groups.count(group))
-            throw Exception("Worker_Task::finish_job(): invalid group number");
+    notify_state_changed();
+}
 
-        Group_Info * group_info = &groups[group];
+void Worker_Task::notify_state_changed(bool all)
+{
+    ++state_epoch;
 
-        --group_info->jobs_outstanding;
-        --group_info->jobs_running;
+    if (num_sleeping == 0) return;
 
-        if (group_info->jobs_outstanding < 0)
-            throw Exception("Worker_Task::finish_job(): "
-                            "group has negative outstanding count");
+    Guard guard(sleep_lock);
+    if (all) wakeup.notify_all();
+    else wakeup.notify_one();
+}
 
-        if (group_info->jobs_running < 0)
-            throw Exception("Worker_Task::finish_job(): "
-                            "group has negative running count");
-        
-        check_finished_ul(group);
-    }
+void Worker_Task::run_until_released(Semaphore & sem, int group)
+{
+    /* Nothing tells us when the semaphore is released, so we poll it as
+       well as checking at every change in state. */
+    run_until([&] () { return sem.tryacquire() != -1; }, 0.001);
     
-    if (num_queued + num_running == 0) finished_sem.release();
-
-    notify_state_changed();
+    sem.release();
 }
 
 void
 Worker_Task::
-remove_job_ul(const Jobs::iterator & it)
+run_until_finished(int group, bool unlock)
 {
-    --num_queued;
-    
-    if (jobs_sem.tryacquire() == -1) {
-        log(string("remove_job_ul error:\n")
-            + "errno = " + to_string(errno) + "\n"
-            + "error = " + strerror(errno) + "\n"
-            + "Worker_Task::remove_job_ul(): couldn't acquire the job "
-            + "semaphore\n"
-            + "force_finished = " + to_string(force_finished) + "\n");
-        dump();
-        abort();
+    std::shared_ptr<Group_Info> group_info = find_group(group);
+    if (!group_info) {
+        if (!unlock) return;  // group must have finished
+        throw Exception("Worker_Task::run_until_finished(): "
+                        "group doesn't exist but should be locked");
     }
 
-    /* Finish off the group if we need to. */
-    Id group = it->group;
-    if (group != -1) {
+    /* Lock the group so that it doesn't finish until we have seen it
+       finish.  If it's already locked, we take over that lock. */
+    if (group_info->locked.exchange(true)) {
+        if (!unlock)
+            throw Exception("Worker_Task::run_until_finished(): "
+                            "group is locked; it won't ever finish");
+    }
+    else ++group_info->outstanding;
 
-        if (!groups.count(group))
-            throw Exception("Worker_Task::finish_job(): invalid group number");
+    /* The group is locked for now; make sure it will be unlocked at the
+       end. */
+    auto release_lock = [&] ()
+        {
+            group_info->locked = false;
+            release_group(group_info);
+        };
+    Call_Guard unlock_guard(release_lock);
 
-        Group_Info * group_info = &groups[group];
+    /* Once our lock is all that's left, the group is finished */
+    run_until([&] () { return group_info->outstanding == 1; });
 
-        --group_info->jobs_outstanding;
+    unlock_guard.clear();
+    release_lock();
 
-        if (group_info->jobs_outstanding < 0)
-            throw Exception("Worker_Task::finish_job(): "
-                            "group has negative outstanding count");
-        
-        check_finished_ul(group);
+    /* If the group had an error, clean up the group structures, then
+       rethrow the exception that occurred. */
+    if (group_info->failed) {
+        {
+            Guard guard(groups_lock);
+            groups.erase(group_info->id);
+        }
+        rethrow_exception(group_info->exc);
     }
-
-    jobs.erase(it);
-    
-    if (num_queued + num_running == 0) finished_sem.release();
-    
-    notify_state_changed();
 }
 
-bool Worker_Task::check_finished(Id group)
+void
+Worker_Task::
+lend_thread(int group)
 {
-    Guard guard(lock);
-    return check_finished_ul(group);
+    /* Run a job if we can */
+    Job_Info info;
+    if (try_get_job(info))
+        run_job(info);
 }
 
-bool Worker_Task::check_finished_ul(Id group)
+bool Worker_Task::check_finished(Id group)
 {
-    if (!groups.count(group))
-        throw Exception("Worker_Task::finish_job(): invalid group number");
-    
-    Group_Info * group_info = &groups[group];
-
-    /* Go through the list of parents and notify everywhere of what is
-       finished. */
-    while (group_info && group_info->jobs_outstanding == 0
-           && group_info->groups_outstanding == 0) {
-        //cerr << "  *** yes, group " << group << " is finished" << endl;
-
-        /* If group has an exception attached to it, it must stay in memory
-           until the control thread handles it. */
-        if (group_info->exc || group_info->locked) return false;
+    std::shared_ptr<Group_Info> group_info = find_group(group);
+    if (!group_info)
+        throw Exception("Worker_Task::check_finished(): invalid group number");
 
-        //cerr << "finished group " << group << endl;
+    if (group_info->outstanding == 0)
+        finish_group(group_info);
 
-        try {
-            if (group_info->finished && !group_info->exc)
-                group_info->finished();
-        }
-        catch (const std::exception & exc) {
-            cerr << "Worker_Task::check_finished(): " << exc.what() << endl;
-        }
-        
-        /* Get rid of the job for the group. */
-        jobs.erase(group_info->group_job);
-
-        Id parent = group_info->parent_group;
-
-        if (parent == -1) group_info = 0;
-        else {
-            if (!groups.count(parent))
-                throw Exception("Worker_Task::finish_job(): invalid "
-                                "group number");
-            group_info = &groups[parent];
-            --group_info->groups_outstanding;
-
-            if (group_info->groups_outstanding < 0) {
-                dump();
-                cerr << "check_finished(" << group << "): "
-                     << "groups_outstainding < 0" << endl;
-                cerr << "parent = " << parent << endl;
-            }
-        }
-        groups.erase(group);
-        group = parent;
-
-        notify_state_changed();
-    }
-    
-    return false;
+    return group_info->done;
 }
 
 int Worker_Task::queued() const
@@ -924,7 +603,7 @@ dump(std::ostream & stream, int indent) const
     string i(indent, ' ');
     stream << i << "Job_Info @ " << this << endl;
     stream << i << "  id         = " << id << endl;
-    stream << i << "  group      = " << group << endl;
+    stream << i << "  group      = " << (group ? group->id : -1) << endl;
     stream << i << "  info       = " << info << endl;
     stream << i << "  job set    = " << (bool)job << endl;
     stream << i << "  error set  = " << (bool)error << endl;
@@ -936,14 +615,15 @@ dump(std::ostream & stream, int indent) const
 {
     string i(indent, ' ');
     stream << i << "Group_Info @ " << this << endl;
+    stream << i << "  id                 = " << id << endl;
     stream << i << "  info               = " << info << endl;
-    stream << i << "  jobs outstanding   = " << jobs_outstanding << endl;
-    stream << i << "  jobs running       = " << jobs_running << endl;
-    stream << i << "  groups outstanding = " << groups_outstanding << endl;
-    stream << i << "  parent group       = " << parent_group << endl;
-    stream << i << "  group job          = " << &(*group_job) << endl;
+    stream << i << "  outstanding        = " << outstanding << endl;
+    stream << i << "  parent group       = " << (parent ? parent->id : -1)
+           << endl;
     stream << i << "  locked             = " << locked << endl;
-    stream << i << "  exc              = "   << (bool)exc << endl;
+    stream << i << "  failed             = " << failed << endl;
+    stream << i << "  done               = " << done << endl;
+    stream << i << "  exc                = " << (bool)exc << endl;
     stream << i << "  finished set       = " << (bool)finished << endl;
 }
 
@@ -954,26 +634,32 @@ dump() const
     std::ostream & stream = cerr;
 
     stream << "Worker_Task @ " << this << endl;
-    stream << "  number of jobs   = " << jobs.size() << endl;
+    stream << "  threads          = " << threads_ << endl;
     stream << "  next group       = " << next_group << endl;
     stream << "  next job         = " << next_job << endl;
     stream << "  num queued       = " << num_queued << endl;
     stream << "  num running      = " << num_running << endl;
-    stream << "  number of groups = " << groups.size() << endl;
-    stream << "  state semaphores = " << state_semaphores.size() << endl;
-    stream << "  force finishned  = " << force_finished << endl;
+    stream << "  num sleeping     = " << num_sleeping << endl;
+    stream << "  force finished   = " << force_finished << endl;
     stream << endl;
-    stream << "  jobs:" << endl;
-    int i = 0;
-    for (Jobs::const_iterator it = jobs.begin();  it != jobs.end();  ++it, ++i) {
-        stream << "   " << i << ":" << endl;
-        it->dump(cerr, 4);
+    stream << "  queues:" << endl;
+    for (unsigned i = 0;  i < queues.size();  ++i) {
+        Guard guard(queues[i]->lock);
+        stream << "   " << i << ": " << queues[i]->jobs.size()
+               << " jobs" << endl;
+        int j = 0;
+        for (auto it = queues[i]->jobs.begin(), end = queues[i]->jobs.end();
+             it != end;  ++it, ++j) {
+            stream << "    " << j << ":" << endl;
+            it->dump(cerr, 5);
+        }
     }
     stream << "  groups:" << endl;
-    for (map<Id, Group_Info>::const_iterator it = groups.begin();
-         it != groups.end();  ++it) {
+    Guard guard(groups_lock);
+    stream << "  number of groups = " << groups.size() << endl;
+    for (auto it = groups.begin(), end = groups.end();  it != end;  ++it) {
         stream << "   group with ID " << it->first << ":" << endl;
-        it->second.dump(cerr, 4);
+        it->second->dump(cerr, 4);
     }
     stream << endl;
 }
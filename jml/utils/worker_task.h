@@ -9,15 +9,19 @@
 #pragma once
 
 #include "jml/utils/guard.h"
+#include "jml/utils/group_hash.h"
 #include "jml/arch/format.h"
 #include "jml/arch/spinlock.h"
 #include "jml/arch/semaphore.h"
+#include <atomic>
+#include <condition_variable>
 #include <functional>
-#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <thread>
+#include <vector>
 
 
 namespace ML {
@@ -46,12 +50,17 @@ int num_threads();
    The jobs can be arranged in groups, with a job that gets run once the
    group is finished, and the groups can be arranged in a hierarchy.
 
-   The jobs are scheduled such that with any group, jobs belonging to an
-   earlier subgroup are all scheduled before any belonging to a later
-   subgroup, regardless of the order in which they are scheduled.  (This
-   corresponds to a depth first search through the group tree).  The effect
-   is to guarantee that the average number of groups outstanding will be
-   as small as possible.
+   Each worker thread has its own deque of jobs.  Jobs added from a worker
+   thread go onto its deque and it runs them newest first, which goes
+   depth first into the groups that its jobs create and so keeps the number
+   of groups outstanding small.  A thread that runs out of work steals the
+   oldest job of another thread, which is the one nearest the top of the
+   group tree and so likely to carry the most work.  Jobs added from any
+   other thread are spread over the workers' deques.
+
+   The groups are reference counted and finish on the last of their jobs
+   and child groups, so apart from looking up a group by its id no lock is
+   shared by all of the threads.
 
    It works multithreaded, and deals with all locking and unlocking.
 */
@@ -75,9 +84,8 @@ public:
         is finished.  Note that if nothing is ever added to the group, it won't
         be finished automatically unless check_finished() is called.
 
-        It will be inserted into the jobs list just after the last job with
-        the same parent group, so that the children of parent groups will be
-        completed in preference to their sisters.
+        The group finishes once all of its jobs and child groups have
+        finished, and then it counts as finished towards its parent group.
 
         If lock is set to true, then it will not ever be automatically removed
         until it is unlocked.  This stops a newly-created group from being
@@ -144,10 +152,8 @@ public:
 
     /** This function lends the calling thread to the worker task until the
         given semaphore is released.  The semaphore will be checked on each
-        state change.  If the group argument is given, then this thread
-        will only schedule jobs from the given group (or its children), which
-        can be used to avoid the thread being used for other work in the
-        task.
+        state change.  The calling thread runs any jobs that are waiting in
+        the meantime; the group argument is kept for compatibility.
 
         If any of the jobs throw an exception, then another exception will
         be thrown from the given job.
@@ -155,7 +161,8 @@ public:
     void run_until_released(Semaphore & sem, int group = -1);
 
     /** Lend the calling thread to the worker task until the given group
-        has finished.
+        has finished.  It runs any of the jobs that are waiting, starting
+        with those of the calling thread if it's a worker thread.
 
         An exception in a group job is handled by throwing an exception from
         this function.
@@ -175,113 +182,117 @@ public:
 private:
     int threads_;
 
+    /** Tells our worker threads apart from those of other tasks. */
+    uint64_t serial_;
+
     std::vector<std::unique_ptr<std::thread> > workerThreads_;
     
-    struct Job_Info;
+    struct Group_Info;
 
-    typedef std::list<Job_Info> Jobs;
-    
     struct Job_Info {
-        Job_Info() : id(-1), group(-1) {}
+        Job_Info() : id(-1) {}
         Job_Info(const Job & job, const Job & error,
-                 const std::string & info, Id id, Id group = -1)
-            : job(job), error(error), id(id), group(group),
-              invalidGroup(false), info(info) {}
+                 const std::string & info, Id id,
+                 std::shared_ptr<Group_Info> group)
+            : job(job), error(error), id(id), group(std::move(group)),
+              info(info) {}
         Job job;
         Job error;
-        Id id;    // if -1, this is a group end marker
-        Id group;
-        bool invalidGroup; // true is group has error set
+        Id id;
+        std::shared_ptr<Group_Info> group;
         std::string info;
         void dump(std::ostream & stream, int indent = 0) const;
     };
 
     struct Group_Info {
-        Group_Info()
-            : jobs_outstanding(0), jobs_running(0),
-              groups_outstanding(0), parent_group(0),
-              locked(false)
+        Group_Info(Id id, const Job & finished,
+                   std::shared_ptr<Group_Info> parent, bool locked,
+                   const std::string & info)
+            : id(id), finished(finished), parent(std::move(parent)),
+              outstanding(locked), locked(locked), failed(false),
+              done(false), info(info)
         {
         }
 
+        Id id;
         Job finished;
-        int jobs_outstanding;      ///< Number of jobs waiting for
-        int jobs_running;          ///< Number of jobs that are running
-        int groups_outstanding;    ///< Number of groups waiting for
-        Id parent_group;           ///< Group to notify when finished
-        Jobs::iterator group_job;  ///< Job for the group; always last
-        bool locked;
+        std::shared_ptr<Group_Info> parent;  ///< Group to notify when finished
+
+        /** Number of jobs and child groups that haven't finished, plus one
+            while the group is locked.  The group finishes when it drops to
+            zero. */
+        std::atomic<int> outstanding;
+        std::atomic<bool> locked;
+        std::atomic<bool> failed;  ///< A job threw; skip the rest
+        std::atomic<bool> done;    ///< Has finished
         std::exception_ptr exc;    ///< Exception to rethrow
         std::string info;
 
         void dump(std::ostream & stream, int indent = 0) const;
     };
 
-    /** Get a job. */
-    Job_Info get_job(int group = -1);
-
-    /** Tries to get a job, but doesn't fail if there isn't one. */
-    bool try_get_job(Job_Info & info, int group = -1);
-
-    /** Implementation of the get_job methods.  Requires that the jobs_sem
-        be acquired. */
-    Job_Info get_job_impl(int group);
-    
-    /** Unlocked implementation of the get_job methods.  Requires that the
-        jobs_sem be acquired and that the lock already be held. */
-    Job_Info get_job_impl_ul(int group);
-    
-    void finish_job(const Job_Info & info);
-
-    void remove_job_ul(const Jobs::iterator & it);
+    /** Deque of jobs belonging to one worker thread. */
+    struct Queue;
 
-    void add_state_semaphore(Semaphore & sem);
+    /** Index of the calling thread's queue, or -1 if it's not one of our
+        worker threads. */
+    int my_queue() const;
 
-    void remove_state_semaphore(Semaphore & sem);
+    /** Look up the group with the given id, returning null if it has
+        finished. */
+    std::shared_ptr<Group_Info> find_group(Id group);
 
-    void notify_state_changed();
+    /** Take a job from our own queue or else steal one from another.
+        Returns false if there are none. */
+    bool try_get_job(Job_Info & info);
 
-    // Check_finished, bit without the lock held
-    bool check_finished_ul(Id group);
+    /** Run the job and account for it being finished. */
+    void run_job(Job_Info & info);
 
-    /** Is the given job in the group?  Searches up the parent hierarchy. */
-    bool in_group(const Job_Info & info, int group);
+    /** Run jobs until finished() returns true, sleeping while there are
+        none.  If timeout is positive, finished() is polled at least that
+        often as well. */
+    void run_until(const std::function<bool ()> & finished,
+                   double timeout = -1.0);
 
-    /** Removes all queued jobs in the group.  Running jobs are left alone. */
-    void cancel_group(Group_Info & group_info, int group);
+    /** Take away one of the group's outstanding jobs, groups or locks,
+        finishing it if that was the last. */
+    void release_group(const std::shared_ptr<Group_Info> & group);
 
-    /** Removes all queued jobs in the group.  Running jobs are left alone. 
-        Lock must already be held. */
-    void cancel_group_ul(Group_Info & group_info, int group);
+    /** Call the group's finish job and release its parent. */
+    void finish_group(std::shared_ptr<Group_Info> group);
 
-    /** Marks invalid all the jobs belonging to a group, so that the worker threads can
-     * skip those jobs easily and in a lockless manner */
-    void mark_group_jobs_invalid_ul(Group_Info & group_info, int group);
-
-    /** Waits for running jobs to finish. */
-    void wait_group_finished(Group_Info & group_info, int group);
+    /** Wake up a sleeping thread to run a newly added job, or all of them
+        when a group or the whole task may have finished. */
+    void notify_state_changed(bool all = true);
 
     typedef std::mutex Lock;
-    //typedef Spinlock Lock;
     typedef std::unique_lock<Lock> Guard;
 
-    Semaphore jobs_sem, finished_sem, state_change_sem, shutdown_sem;
+    std::vector<std::unique_ptr<Queue> > queues;
+
+    /** Where the next job added by a thread other than our workers goes. */
+    std::atomic<unsigned> next_queue;
+    std::atomic<int> next_worker;
 
-    /** Jobs we are running. */
-    Jobs jobs;
-    Id next_group;
-    Id next_job;
-    int num_queued;
-    int num_running;
-    Lock lock;
+    std::atomic<Id> next_group;
+    std::atomic<Id> next_job;
+    std::atomic<int> num_queued;
+    std::atomic<int> num_running;
 
-    /** Groups that are currently running. */
-    std::map<Id, Group_Info> groups;
+    /** Groups that are currently running, by id.  Only used to look up the
+        ids that are passed in. */
+    mutable Lock groups_lock;
+    Group_Hash<Id, std::shared_ptr<Group_Info> > groups;
 
-    /** Semaphores that get released on each state change. */
-    std::set<Semaphore *> state_semaphores;
+    /** Threads with nothing to do sleep on wakeup until the state epoch
+        changes. */
+    std::atomic<uint64_t> state_epoch;
+    std::atomic<int> num_sleeping;
+    Lock sleep_lock;
+    std::condition_variable wakeup;
 
-    volatile bool force_finished;
+    std::atomic<bool> force_finished;
 
     /* Dump everything to cerr; for debugging */
     void dump() const;
@@ -7,6 +7,7 @@
 
 #include "rtbkit/common/account_key.h"
 #include "jml/db/persistent.h"
+#include <mutex>
 
 using namespace std;
 using namespace ML;
@@ -50,4 +51,67 @@ reconstitute(ML::DB::Store_Reader & store)
     store.load(static_cast<AccountKeyBase &>(*this));
 }
 
+
+/*****************************************************************************/
+/* ACCOUNT HANDLES                                                           */
+/*****************************************************************************/
+
+AccountHandle
+AccountHandles::
+intern(const AccountKey & account)
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    auto it = handles.find(account);
+    if (it != handles.end()) return it->second;
+
+    if (entries.size() >= NoAccount)
+        throw ML::Exception("too many account handles");
+
+    AccountHandle handle = entries.size();
+    entries.emplace_back(new Entry { account, account.toString('.') });
+    handles[account] = handle;
+    return handle;
+}
+
+const AccountHandles::Entry &
+AccountHandles::
+entry(AccountHandle handle) const
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    if (handle >= entries.size())
+        throw ML::Exception("unknown account handle %u", handle);
+    return *entries[handle];
+}
+
+const AccountKey &
+AccountHandles::
+key(AccountHandle handle) const
+{
+    return entry(handle).key;
+}
+
+const std::string &
+AccountHandles::
+metricName(AccountHandle handle) const
+{
+    return entry(handle).metricName;
+}
+
+size_t
+AccountHandles::
+size() const
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+    return entries.size();
+}
+
+AccountHandles &
+accountHandles()
+{
+    static AccountHandles table;
+    return table;
+}
+
 } // namespace RTBKIT
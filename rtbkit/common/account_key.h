@@ -9,8 +9,11 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <unordered_map>
 #include "jml/utils/string_functions.h"
 #include "jml/arch/exception.h"
+#include "jml/arch/spinlock.h"
 #include "jml/db/persistent_fwd.h"
 #include "soa/jsoncpp/json.h"
 #include "soa/service/json_codec.h"
@@ -186,3 +189,59 @@ namespace Datacratic {
     };
 }
 
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* ACCOUNT HANDLES                                                           */
+/*****************************************************************************/
+
+/** Small integer standing for an account, so that the bid path can get to
+    its banker account and metrics without hashing, comparing or formatting
+    its key.  Handles are dense and never reused.
+*/
+typedef uint32_t AccountHandle;
+
+/** Accounts that were given a handle, which is done when an agent is
+    configured rather than for each bid.
+
+    All the operations are thread safe.
+*/
+struct AccountHandles {
+
+    enum { NoAccount = uint32_t(-1) };
+
+    /** Returns the handle of the account, assigning one if it had none. */
+    AccountHandle intern(const AccountKey & account);
+
+    /** Returns the account with the given handle. */
+    const AccountKey & key(AccountHandle handle) const;
+
+    /** Returns the account's key joined with '.', as used in the names of
+        its metrics.
+    */
+    const std::string & metricName(AccountHandle handle) const;
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        AccountKey key;
+        std::string metricName;
+    };
+
+    const Entry & entry(AccountHandle handle) const;
+
+    mutable ML::Spinlock lock;
+    std::unordered_map<AccountKey, AccountHandle> handles;
+
+    // Individual allocations so that the references returned stay valid when
+    // the vector grows.
+    std::vector<std::unique_ptr<Entry> > entries;
+};
+
+/** Table used by the router and the bankers. */
+AccountHandles & accountHandles();
+
+} // namespace RTBKIT
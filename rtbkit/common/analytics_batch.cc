@@ -0,0 +1,62 @@
+/* analytics_batch.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Decoding of the analytics batches.
+*/
+
+#include "analytics_batch.h"
+#include "jml/arch/exception.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* ANALYTICS BATCH                                                           */
+/*****************************************************************************/
+
+const std::string AnalyticsBatch::Channel = "BATCH";
+
+size_t
+AnalyticsBatch::
+forEach(const std::string & data, const OnEvent & onEvent)
+{
+    const char * p = data.data();
+    const char * e = p + data.size();
+
+    auto readUint = [&] () -> uint32_t
+        {
+            if (e - p < (ssize_t)sizeof(uint32_t))
+                throw ML::Exception("analytics batch is truncated");
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            p += sizeof(value);
+            return value;
+        };
+
+    size_t numEvents = 0;
+    while (p != e) {
+        uint32_t numFields = readUint();
+
+        vector<string> fields;
+        fields.reserve(numFields);
+        for (uint32_t i = 0; i < numFields; ++i) {
+            uint32_t size = readUint();
+            if (size_t(e - p) < size)
+                throw ML::Exception("analytics batch is truncated");
+            fields.emplace_back(p, size);
+            p += size;
+        }
+
+        onEvent(std::move(fields));
+        ++numEvents;
+    }
+
+    return numEvents;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,160 @@
+/* analytics_batch.h                                               -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Many analytics events packed into a single message.
+*/
+
+#pragma once
+
+#include "soa/types/date.h"
+#include "soa/types/string.h"
+#include "soa/jsoncpp/value.h"
+#include "jml/arch/format.h"
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* ANALYTICS BATCH                                                           */
+/*****************************************************************************/
+
+/** Packs events made of a channel and a list of fields into one buffer so
+    that they can be sent as a single message instead of one message per
+    event and one frame per field.
+
+    Each event is a uint32 count of fields followed by each field as a
+    uint32 length and its bytes, all in host order. The fields are turned
+    into strings the same way encodeMessage() does for the zeromq frames,
+    so that an event read back from the batch is identical to the message
+    it would have been published as.
+
+    Not thread safe.
+*/
+struct AnalyticsBatch {
+
+    /** Channel on which the batches are published. */
+    static const std::string Channel;
+
+    AnalyticsBatch()
+        : numEvents(0)
+    {
+    }
+
+    template<typename... Args>
+    void add(const std::string & channel, const Args & ... args)
+    {
+        size_t start = buffer.size();
+        appendUint(0);
+        uint32_t numFields = appendFields(channel, args...);
+        buffer.replace(start, sizeof(numFields),
+                       (const char *)&numFields, sizeof(numFields));
+        ++numEvents;
+    }
+
+    /** Number of events in the batch. */
+    size_t size() const { return numEvents; }
+    bool empty() const { return numEvents == 0; }
+
+    /** Size of the encoded batch in bytes. */
+    size_t bytes() const { return buffer.size(); }
+
+    const std::string & data() const { return buffer; }
+
+    void clear()
+    {
+        buffer.clear();
+        numEvents = 0;
+    }
+
+    void swap(AnalyticsBatch & other)
+    {
+        buffer.swap(other.buffer);
+        std::swap(numEvents, other.numEvents);
+    }
+
+    typedef std::function<void (std::vector<std::string> && fields)> OnEvent;
+
+    /** Calls onEvent with the fields of each event of an encoded batch, the
+        channel first, and returns the number of events. Throws if the batch
+        is truncated.
+    */
+    static size_t forEach(const std::string & data, const OnEvent & onEvent);
+
+private:
+    std::string buffer;
+    size_t numEvents;
+
+    void appendUint(uint32_t value)
+    {
+        buffer.append((const char *)&value, sizeof(value));
+    }
+
+    void appendBytes(const char * data, size_t size)
+    {
+        appendUint(size);
+        buffer.append(data, size);
+    }
+
+    unsigned appendField(const std::string & field)
+    {
+        appendBytes(field.data(), field.size());
+        return 1;
+    }
+
+    unsigned appendField(const char * field)
+    {
+        appendBytes(field, strlen(field));
+        return 1;
+    }
+
+    unsigned appendField(const Datacratic::Utf8String & field)
+    {
+        return appendField(field.rawString());
+    }
+
+    unsigned appendField(const Json::Value & field)
+    {
+        return appendField(field.toStringNoNewLine());
+    }
+
+    unsigned appendField(const std::vector<std::string> & fields)
+    {
+        for (auto & field: fields)
+            appendField(field);
+        return fields.size();
+    }
+
+    unsigned appendField(const Datacratic::Date & date)
+    {
+        return appendField(ML::format("%.5f", date.secondsSinceEpoch()));
+    }
+
+    unsigned appendField(int i) { return appendField(ML::format("%d", i)); }
+    unsigned appendField(unsigned int i) { return appendField(ML::format("%u", i)); }
+    unsigned appendField(long i) { return appendField(ML::format("%ld", i)); }
+    unsigned appendField(unsigned long i) { return appendField(ML::format("%lu", i)); }
+    unsigned appendField(double d) { return appendField(ML::format("%f", d)); }
+    unsigned appendField(char c) { return appendField(ML::format("%c", c)); }
+
+    uint32_t appendFields()
+    {
+        return 0;
+    }
+
+    template<typename Head, typename... Tail>
+    uint32_t appendFields(const Head & head, const Tail & ... tail)
+    {
+        uint32_t numFields = appendField(head);
+        return numFields + appendFields(tail...);
+    }
+};
+
+} // namespace RTBKIT
@@ -11,6 +11,7 @@
 #include "analytics_publisher.h"
 #include "soa/jsoncpp/value.h"
 #include "soa/jsoncpp/reader.h"
+#include "jml/utils/exc_check.h"
 
 using namespace std;
 using namespace Datacratic;
@@ -19,11 +20,29 @@ using namespace Datacratic;
 /* ANALYTICS PUBLISHER                                                          */
 /********************************************************************************/
 
+AnalyticsPublisher::
+AnalyticsPublisher()
+    : initialized(false), live(false),
+      channelFilter(channelFilterGc),
+      maxBatchSize(1), http2(false),
+      numQueued(0), numDropped(0), numSent(0)
+{
+}
+
 void
 AnalyticsPublisher::
-init(const string & baseUrl, const int numConnections)
+init(const string & baseUrl, const int numConnections,
+     size_t maxBatchSize, double maxBatchLatency, size_t queueSize)
 {
-    client = make_shared<HttpClient>(baseUrl, numConnections);
+    ExcCheckGreater(maxBatchSize, 0, "batches need at least one event");
+    ExcCheckGreater(maxBatchLatency, 0.0, "batch latency must be positive");
+
+    this->maxBatchSize = maxBatchSize;
+    events.reset(new ML::RingBufferLockFreeSRMW<Event>(queueSize));
+
+    // HTTP/2 is only in the curl based client
+    client = make_shared<HttpClient>(baseUrl, numConnections, 0, http2 ? 1 : 0);
+    client->enableHttp2(http2);
     client->sendExpect100Continue(false);
     addSource("analytics::client", client);
     cout << "analytics client is initialized" << endl;
@@ -38,6 +57,11 @@ init(const string & baseUrl, const int numConnections)
     };
     addPeriodic("analytics::syncFilters", 10.0, syncFilters);
 
+    auto drain = [&] (uint64_t wakeups) {
+        drainEvents();
+    };
+    addPeriodic("analytics::events", maxBatchLatency, drain);
+
     initialized = true;
 }
 
@@ -57,27 +81,74 @@ shutdown()
 
 void
 AnalyticsPublisher::
-sendEvent(const string & channel, const string & event)
+drainEvents()
 {
-    auto onResponse = [] (const HttpRequest & rq,
-            HttpClientError error,
-            int status,
-            string && headers,
-            string && body)
-    {
-        if (status != 200) {
-            cout << "status: " << status << endl
-                 << "error: " << error << endl;
+    Event event;
+
+    if (maxBatchSize == 1) {
+        while (events->tryPop(event)) {
+            sendEvent(event.channel, event.event);
+            ++numSent;
         }
-    };
+        return;
+    }
+
+    Json::Value batch(Json::arrayValue);
+
+    while (events->tryPop(event)) {
+        Json::Value & entry = batch[batch.size()];
+        entry["channel"] = std::move(event.channel);
+        entry["event"] = std::move(event.event);
+
+        if (batch.size() == maxBatchSize) {
+            sendBatch(batch);
+            batch = Json::Value(Json::arrayValue);
+        }
+    }
+
+    if (batch.size()) sendBatch(batch);
+}
+
+namespace {
+
+void onEventResponse(const HttpRequest & rq,
+                     HttpClientError error,
+                     int status,
+                     string && headers,
+                     string && body)
+{
+    if (status != 200) {
+        cout << "status: " << status << endl
+             << "error: " << error << endl;
+    }
+}
+
+} // file scope
+
+void
+AnalyticsPublisher::
+sendEvent(const string & channel, const string & event)
+{
     string ressource("/v1/event");
-    auto const & cbs = make_shared<HttpClientSimpleCallbacks>(onResponse);
+    auto const & cbs = make_shared<HttpClientSimpleCallbacks>(onEventResponse);
     Json::Value payload(Json::objectValue);
     payload["channel"] = channel;
     payload["event"] = event;
     client->post(ressource, cbs, payload);
 }
 
+void
+AnalyticsPublisher::
+sendBatch(const Json::Value & batch)
+{
+    string ressource("/v1/events");
+    auto const & cbs = make_shared<HttpClientSimpleCallbacks>(onEventResponse);
+    Json::Value payload(Json::objectValue);
+    payload["events"] = batch;
+    client->post(ressource, cbs, payload);
+    numSent += batch.size();
+}
+
 void
 AnalyticsPublisher::
 checkHeartbeat()
@@ -114,10 +185,13 @@ syncChannelFilters()
         if (status != 200) return;
         Json::Value filters = Json::parse(body);
         if (filters.isObject()) {
-            std::lock_guard<std::mutex> lock(mu);
+            std::lock_guard<std::mutex> lock(channelFilterLock);
+            std::unique_ptr<ChannelFilter> newFilter(
+                    new ChannelFilter(*channelFilter()));
             for ( auto it = filters.begin(); it != filters.end(); ++it) {
-                channelFilter[it.memberName()] = (*it).asBool();
+                (*newFilter)[it.memberName()] = (*it).asBool();
             }
+            channelFilter.replace(newFilter.release());
         }
     };
     if (!live) return;
@@ -10,10 +10,17 @@
 #include <sstream>
 #include <unordered_map>
 #include <utility>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 #include "soa/service/message_loop.h"
 #include "soa/service/http_client.h"
 #include "soa/service/service_utils.h"
+#include "soa/gc/gc_lock.h"
+#include "soa/gc/rcu_protected.h"
+#include "jml/arch/thread_specific.h"
+#include "jml/utils/ring_buffer.h"
 
 typedef std::unordered_map< std::string, bool > ChannelFilter;
 
@@ -21,40 +28,98 @@ typedef std::unordered_map< std::string, bool > ChannelFilter;
 /* ANALYTICS PUBLISHER                                                          */
 /********************************************************************************/
 
+/** Publishes events to the analytics endpoint without blocking the threads
+    that publish them.
+
+    publish() formats the event and pushes it to a lock free ring buffer; it
+    doesn't take any lock and drops the event, counting it, when the ring is
+    full rather than waiting for the endpoint. The message loop of the
+    publisher drains the ring every maxBatchLatency seconds and sends the
+    events by batches of up to maxBatchSize per POST to /v1/events, or one
+    at a time to /v1/event when maxBatchSize is 1.
+*/
 struct AnalyticsPublisher : public Datacratic::MessageLoop {
 
-    AnalyticsPublisher() : initialized(false) {}
+    AnalyticsPublisher();
 
-    void init(const std::string & baseUrl, const int numConnections);
+    void init(const std::string & baseUrl, const int numConnections,
+              size_t maxBatchSize = 100, double maxBatchLatency = 0.1,
+              size_t queueSize = 65536);
     bool initialized;
 
+    /** Sends the events over HTTP/2, multiplexed on a single connection
+        instead of one request per connection at a time.  Must be called
+        before init().
+    */
+    void enableHttp2(bool value) { http2 = value; }
+
     void start();
 
     void shutdown();
 
     void syncChannelFilters();
 
+    /** Returns true if events published on the channel would be sent to
+        the endpoint.  Callers that have to format the fields of an event
+        can check it first to skip the work for the disabled channels.
+    */
+    bool isEnabled(const std::string & channel) const
+    {
+        if (!live.load(std::memory_order_relaxed)) return false;
+
+        auto filters = channelFilter();
+        auto it = filters->find(channel);
+        return it != filters->end() && it->second;
+    }
+
     template<typename... Args>
     void publish(const std::string & channel, const Args & ... args)
     {
-        if (!live) return;
+        if (!isEnabled(channel)) return;
 
-        std::lock_guard<std::mutex> lock(mu);
-        auto it = channelFilter.find(channel);
-        if (it == channelFilter.end() || !it->second) return;
-
-        std::stringstream ss;
+        std::stringstream & ss = *streams.get();
+        ss.str("");
         make_message(ss, args...);
-        sendEvent(channel, ss.str());
+
+        if (events->tryPush(Event{ channel, ss.str() }))
+            ++numQueued;
+        else ++numDropped;
     }
 
+    /** Number of events handed to the HTTP client so far. */
+    uint64_t sentEvents() const { return numSent; }
+
+    /** Number of events dropped because the queue was full. */
+    uint64_t droppedEvents() const { return numDropped; }
+
 private:
-    std::mutex mu;
+    struct Event {
+        std::string channel;
+        std::string event;
+    };
+
     std::shared_ptr<Datacratic::HttpClient> client;
-    bool live;
-    ChannelFilter channelFilter;
+    std::atomic<bool> live;
+
+    Datacratic::GcLock channelFilterGc;
+    Datacratic::RcuProtected<ChannelFilter> channelFilter;
+    std::mutex channelFilterLock;  // Serializes the updates
+
+    std::unique_ptr< ML::RingBufferLockFreeSRMW<Event> > events;
+    size_t maxBatchSize;
+    bool http2;
+
+    std::atomic<uint64_t> numQueued;
+    std::atomic<uint64_t> numDropped;
+    std::atomic<uint64_t> numSent;
+
+    ML::ThreadSpecificInstanceInfo<std::stringstream, AnalyticsPublisher> streams;
+
+    /** Sends all the queued events. */
+    void drainEvents();
 
     void sendEvent(const std::string & channel, const std::string & event);
+    void sendBatch(const Json::Value & batch);
 
     void checkHeartbeat();
 
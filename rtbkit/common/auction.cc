@@ -6,6 +6,7 @@
 */
 
 #include "rtbkit/common/auction.h"
+#include "rtbkit/common/mem_usage.h"
 #include "jml/arch/exception.h"
 #include "jml/arch/format.h"
 #include "jml/arch/backtrace.h"
@@ -200,6 +201,14 @@ reconstitute(DB::Store_Reader & store)
     localStatus = (WinLoss)localStatusi;
 }
 
+size_t
+Auction::Response::
+memUsage() const
+{
+    return sizeof(*this)
+        + heapBytes(agent) + heapBytes(meta) + heapBytes(creativeName);
+}
+
 void
 Auction::Response::
 createDescription(AuctionResponseDescription & d) {
@@ -218,7 +227,8 @@ createDescription(AuctionResponseDescription & d) {
 
 Auction::
 Auction()
-    : isZombie(false), exchangeConnector(nullptr), data(new Data())
+    : isZombie(false), hasRequestSerialized(false),
+      exchangeConnector(nullptr), data(newData().release())
 {
 }
 
@@ -230,32 +240,107 @@ Auction(ExchangeConnector * exchangeConnector,
         const std::string & requestStrFormat,
         Date start,
         Date expiry)
-    : isZombie(false), start(start), expiry(expiry),
-      request(request),
-      requestStr(requestStr),
-      requestStrFormat(requestStrFormat),
-      exchangeConnector(exchangeConnector),
-      handleAuction(handleAuction),
-      data(new Data(numSpots()))
+    : isZombie(false), hasRequestSerialized(false),
+      exchangeConnector(nullptr), data(nullptr)
 {
+    reset(exchangeConnector, std::move(handleAuction), std::move(request),
+          requestStr, requestStrFormat, start, expiry);
+}
+
+void
+Auction::
+reset(ExchangeConnector * exchangeConnector,
+      HandleAuction handleAuction,
+      std::shared_ptr<BidRequest> request,
+      const std::string & requestStr,
+      const std::string & requestStrFormat,
+      Date start,
+      Date expiry)
+{
+    clear();
+
+    this->start = start;
+    this->expiry = expiry;
+    this->request = std::move(request);
+    this->requestStr = requestStr;
+    this->requestStrFormat = requestStrFormat;
+    this->exchangeConnector = exchangeConnector;
+    this->handleAuction = std::move(handleAuction);
+    this->data = newData(numSpots()).release();
+
     ML::atomic_add(created, 1);
 
-    this->id = request->auctionId;
-    this->requestSerialized = request->serializeToString();
+    this->id = this->request->auctionId;
+}
+
+void
+Auction::
+clear()
+{
+    if (data) {
+        destroyData();
+        ML::atomic_add(destroyed, 1);
+    }
+
+    isZombie = false;
+    start = expiry = lossAssumed = Date();
+    doneParsing = inPrepro = outOfPrepro = doneAugmenting = Date();
+    inStartBidding = doneFiltering = sentToAgents = lastBid = Date();
+
+    id = Id();
+    request.reset();
+    requestStr.clear();
+    requestStrFormat.clear();
+    requestOriginal.clear();
+    requestSerialized.clear();
+    hasRequestSerialized = false;
+    requestEncoded.clear();
+
+    augmentations.clear();
+    agentAugmentations.clear();
+
+    exchangeConnector = nullptr;
+    handleAuction.clear();
+}
+
+const std::string &
+Auction::
+serializedRequest() const
+{
+    if (!hasRequestSerialized.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> guard(requestSerializedLock);
+        if (!hasRequestSerialized.load(std::memory_order_relaxed)) {
+            requestSerialized = request->serializeToString();
+            hasRequestSerialized.store(true, std::memory_order_release);
+        }
+    }
+    return requestSerialized;
 }
 
 Auction::
 ~Auction()
 {
-    // Clean up the chain of data pointers
+    if (data) {
+        destroyData();
+        ML::atomic_add(destroyed, 1);
+    }
+}
+
+void
+Auction::
+destroyData()
+{
+    // Clean up the chain of data pointers; the memory all belongs to the
+    // arena, which is rewound for the next use of the auction.
     Data * d = data;
     while (d) {
         Data * d2 = d->oldData;
-        delete d;
+        d->~Data();
         d = d2;
     }
 
-    ML::atomic_add(destroyed, 1);
+    data = nullptr;
+    arena.reset();
 }
 
 long long Auction::created = 0;
@@ -295,7 +380,7 @@ setResponse(int spotNum, Response newResponse)
 
     WinLoss result;
 
-    auto_ptr<Data> newData(new Data());
+    DataPtr newData = this->newData();
 
     for (;;) {
         if (current->tooLate)
@@ -346,6 +431,29 @@ getResponses() const
     return current->responses;
 }
 
+size_t
+Auction::
+memUsage() const
+{
+    size_t result = sizeof(*this)
+        + heapBytes(requestStr) + heapBytes(requestStrFormat)
+        + heapBytes(requestOriginal);
+
+    // The parsed request is taken to be about as big as its text
+    if (request) result += requestStr.size();
+
+    // Old versions of the data live as long as the auction so this one
+    // can't go away under us.
+    const Data * current = this->data;
+    for (auto & spot: current->responses) {
+        result += sizeof(spot);
+        for (auto & response: spot)
+            result += response.memUsage();
+    }
+
+    return result;
+}
+
 void
 Auction::
 addDataSources(const std::set<std::string> & sources)
@@ -353,7 +461,7 @@ addDataSources(const std::set<std::string> & sources)
     if (sources.empty()) return;
 
     Data * current = this->data;
-    unique_ptr<Data> newData(new Data);
+    DataPtr newData;
 
     for (;;) {
 
@@ -363,10 +471,13 @@ addDataSources(const std::set<std::string> & sources)
         // Nothing new was added, just bail.
         if (newSources.size() == current->dataSources.size()) return;
 
-        if (!newData) newData.reset(new Data);
+        if (!newData) newData = this->newData();
         *newData = *current;
         std::swap(newData->dataSources, newSources);
 
+        // Readers might still be looking at the current version.
+        newData->oldData = current;
+
         if (!ML::cmp_xchg(this->data, current, newData.get())) continue;
         newData.release();
         return;
@@ -391,7 +502,7 @@ finish()
         if (current->tooLate)
             return false;
 
-        auto_ptr<Data> newData(new Data(*current));
+        DataPtr newData = this->newData(*current);
 
         for (unsigned spotNum = 0;  spotNum < numSpots(); ++spotNum) {
             if (newData->hasValidResponse(spotNum))
@@ -421,7 +532,7 @@ setError(const std::string & error, const std::string & details)
         if (current->tooLate)
             return false;
 
-        auto_ptr<Data> newData(new Data(*current));
+        DataPtr newData = this->newData(*current);
         
         newData->error = error;
         newData->details = details;
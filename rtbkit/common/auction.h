@@ -16,11 +16,16 @@
 #include "rtbkit/common/win_cost_model.h"
 #include <boost/function.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <map>
 #include "soa/jsoncpp/json.h"
 #include "soa/types/date.h"
 #include "jml/arch/atomic_ops.h"
 #include "jml/arch/exception.h"
 #include "jml/utils/compact_vector.h"
+#include "jml/utils/arena.h"
 #include "jml/db/persistent_fwd.h"
 
 namespace RTBKIT {
@@ -56,6 +61,24 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     
     ~Auction();
 
+    /** Make this auction the same as one constructed with the given
+        arguments.  The strings and containers keep their capacity, so that
+        pooled auctions can be reused without allocating.
+    */
+    void reset(ExchangeConnector * exchangeConnector,
+               HandleAuction handleAuction,
+               std::shared_ptr<BidRequest> request,
+               const std::string & requestStr,
+               const std::string & requestStrFormat,
+               Date start,
+               Date expiry);
+
+    /** Drop the request, the responses and everything else that refers to
+        the auction while keeping the capacity of the strings and
+        containers.  Nothing else may be using the auction.
+    */
+    void clear();
+
     bool isZombie;  ///< Auction was externally cancelled
 
     Date start;
@@ -67,23 +90,58 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     Date inPrepro, outOfPrepro;
     Date doneAugmenting;
     Date inStartBidding;
+    Date doneFiltering;
+    Date sentToAgents;
+    Date lastBid;
 
     Id id;
     std::shared_ptr<BidRequest>  request;
     std::string requestStr;  ///< Stringified version of request
     std::string requestStrFormat;  ///< Format of stringified request
-    std::string requestSerialized; ///< Serialized bid request (canonical)
     std::string requestOriginal;
 
+    /** The bid request serialized in BidRequest::BinaryFormat.  It's made
+        the first time it's asked for and then shared by everything that
+        sends the request on, so the request must not change after that.
+    */
+    const std::string & serializedRequest() const;
+
+    mutable std::string requestSerialized; ///< Cache for serializedRequest()
+    mutable std::atomic<bool> hasRequestSerialized;
+    mutable std::mutex requestSerializedLock;
+
+    /** The bid request encoded in the given wire format by encode, which is
+        only called the first time the format is asked for.  All the bidder
+        interfaces the auction is sent to share the result, so a request
+        that goes to several of them is encoded once per format.  Thread
+        safe; like serializedRequest(), the request must not change after
+        it's been encoded.
+    */
+    template<typename T>
+    std::shared_ptr<const T>
+    encodedRequest(const std::string & format,
+                   const std::function<T ()> & encode) const
+    {
+        std::lock_guard<std::mutex> guard(requestEncodedLock);
+        auto & entry = requestEncoded[format];
+        if (!entry)
+            entry = std::make_shared<const T>(encode());
+        return std::static_pointer_cast<const T>(entry);
+    }
+
+    /// Cache for encodedRequest(), by format
+    mutable std::map<std::string, std::shared_ptr<const void> > requestEncoded;
+    mutable std::mutex requestEncodedLock;
+
     ///< AugmentationList for each augmentors.
     std::unordered_map<std::string, AugmentationList> augmentations;
     AgentAugmentations agentAugmentations; ///< per agent augmentations.
 
     /** How much time is still available for the auction (in seconds). */
-    double timeAvailable(Date now = Date::now()) const;
+    double timeAvailable(Date now = Date::nowFast()) const;
 
     /** How much time has been used by the auction (in seconds). */
-    double timeUsed(Date now = Date::now()) const;
+    double timeUsed(Date now = Date::nowFast()) const;
 
     /** If this value is set, then the bid has already been sent of and it's
         too late to modify the object any more.
@@ -147,7 +205,8 @@ struct Auction : public std::enable_shared_from_this<Auction> {
               agentConfig(agentConfig),
               visitChannels(visitChannels),
               agentCreativeIndex(agentCreativeIndex),
-              wcm(wcm)
+              wcm(wcm),
+              accountHandle(AccountHandles::NoAccount)
         {
         }
 
@@ -186,6 +245,13 @@ struct Auction : public std::enable_shared_from_this<Auction> {
         /** Win cost model for this auction. */
         WinCostModel wcm;
 
+        /** Handle of the account, which the router uses to talk to the
+            banker without looking the account up.
+
+            WARNING: This member will not be serialized either.
+        */
+        AccountHandle accountHandle;
+
         static std::string print(WinLoss wl);
         Json::Value toJson() const;
         std::string toJsonStr() const;
@@ -196,6 +262,9 @@ struct Auction : public std::enable_shared_from_this<Auction> {
         /** Is this a valid response? */
         bool valid() const;
 
+        /** Rough number of bytes held by the response.  See mem_usage.h. */
+        size_t memUsage() const;
+
         static void createDescription(AuctionResponseDescription&);
     };
 
@@ -248,6 +317,13 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     */
     const std::vector<std::vector<Response> > & getResponses() const;
 
+    /** Rough number of bytes held by the auction, its request and its
+        current responses.  See mem_usage.h.
+
+        Thread safe.
+    */
+    size_t memUsage() const;
+
     ExchangeConnector * exchangeConnector; ///< Exchange connector for auction
     HandleAuction handleAuction;   ///< Callback for when auction is finished
 
@@ -297,6 +373,27 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     }
 
 private:
+    /** Every version of Data lives until the auction is destroyed so they're
+        allocated in an arena which frees them all at once. The inline storage
+        is enough for the few versions an auction usually goes through.
+    */
+    ML::Arena<1024> arena;
+
+    /** Only runs the destructor; the memory belongs to the arena. */
+    struct DestroyData {
+        void operator () (Data * d) const { d->~Data(); }
+    };
+    typedef std::unique_ptr<Data, DestroyData> DataPtr;
+
+    template<typename... Args>
+    DataPtr newData(Args&&... args)
+    {
+        return DataPtr(arena.create<Data>(std::forward<Args>(args)...));
+    }
+
+    /** Destroy every version of the data and give back their memory. */
+    void destroyData();
+
     Data * data;
 
 public:
@@ -0,0 +1,263 @@
+/* auction_pool.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Pool of auctions and bid requests.
+*/
+
+#include "auction_pool.h"
+
+using namespace std;
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* CONTROL BLOCKS                                                            */
+/*****************************************************************************/
+
+/** Free list of shared pointer control blocks. */
+
+struct AuctionPool::ControlBlocks {
+
+    /** Largest control block that is recycled. */
+    enum { BlockSize = 64 };
+
+    ControlBlocks(size_t maxFree)
+    {
+        freeBlocks.reserve(maxFree);
+    }
+
+    ~ControlBlocks()
+    {
+        for (void * block: freeBlocks)
+            ::operator delete(block);
+    }
+
+    void * allocate(size_t size)
+    {
+        if (size > BlockSize)
+            return ::operator new(size);
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if (!freeBlocks.empty()) {
+                void * block = freeBlocks.back();
+                freeBlocks.pop_back();
+                return block;
+            }
+        }
+
+        return ::operator new(BlockSize);
+    }
+
+    void release(void * block, size_t size) noexcept
+    {
+        if (size <= BlockSize) {
+            std::unique_lock<std::mutex> guard(lock);
+            if (freeBlocks.size() < freeBlocks.capacity()) {
+                freeBlocks.push_back(block);
+                return;
+            }
+        }
+
+        ::operator delete(block);
+    }
+
+    std::mutex lock;
+    std::vector<void *> freeBlocks;
+};
+
+
+/*****************************************************************************/
+/* CONTROL BLOCK ALLOCATOR                                                   */
+/*****************************************************************************/
+
+/** Allocator for the control blocks of the shared pointers handed out by
+    the pool, which the control block keeps until its memory has been given
+    back.
+*/
+template<typename T>
+struct AuctionPool::ControlBlockAllocator {
+    typedef T value_type;
+
+    ControlBlockAllocator(std::shared_ptr<ControlBlocks> blocks)
+        : blocks(std::move(blocks))
+    {
+    }
+
+    template<typename U>
+    ControlBlockAllocator(const ControlBlockAllocator<U> & other)
+        : blocks(other.blocks)
+    {
+    }
+
+    T * allocate(size_t n)
+    {
+        return (T *)blocks->allocate(n * sizeof(T));
+    }
+
+    void deallocate(T * p, size_t n) noexcept
+    {
+        blocks->release(p, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator == (const ControlBlockAllocator<U> & other) const
+    {
+        return blocks == other.blocks;
+    }
+
+    template<typename U>
+    bool operator != (const ControlBlockAllocator<U> & other) const
+    {
+        return blocks != other.blocks;
+    }
+
+    std::shared_ptr<ControlBlocks> blocks;
+};
+
+
+/*****************************************************************************/
+/* AUCTION POOL                                                              */
+/*****************************************************************************/
+
+AuctionPool::
+AuctionPool(size_t maxFree)
+    : controlBlocks_(std::make_shared<ControlBlocks>(2 * maxFree))
+{
+    freeAuctions_.reserve(maxFree);
+    freeBidRequests_.reserve(maxFree);
+}
+
+AuctionPool::
+~AuctionPool()
+{
+    for (Auction * auction: freeAuctions_)
+        delete auction;
+    for (BidRequest * request: freeBidRequests_)
+        delete request;
+}
+
+std::shared_ptr<BidRequest>
+AuctionPool::
+getBidRequest()
+{
+    BidRequest * request = pop(freeBidRequests_);
+    if (!request)
+        request = new BidRequest();
+    return share(request);
+}
+
+std::shared_ptr<Auction>
+AuctionPool::
+getAuction(ExchangeConnector * exchangeConnector,
+           Auction::HandleAuction handleAuction,
+           std::shared_ptr<BidRequest> request,
+           const std::string & requestStr,
+           const std::string & requestStrFormat,
+           Date start,
+           Date expiry)
+{
+    Auction * auction = pop(freeAuctions_);
+
+    if (!auction) {
+        auction = new Auction(exchangeConnector, std::move(handleAuction),
+                              std::move(request), requestStr,
+                              requestStrFormat, start, expiry);
+    }
+    else {
+        try {
+            auction->reset(exchangeConnector, std::move(handleAuction),
+                           std::move(request), requestStr,
+                           requestStrFormat, start, expiry);
+        } catch (...) {
+            release(auction);
+            throw;
+        }
+    }
+
+    return share(auction);
+}
+
+size_t
+AuctionPool::
+freeAuctions() const
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    return freeAuctions_.size();
+}
+
+size_t
+AuctionPool::
+freeBidRequests() const
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    return freeBidRequests_.size();
+}
+
+template<typename T>
+std::shared_ptr<T>
+AuctionPool::
+share(T * object)
+{
+    /* the deleter keeps the pool alive until it has been called, but no
+       longer: the control block can outlive it */
+    auto deleter = [pool = shared_from_this()] (T * object) mutable
+        {
+            std::shared_ptr<AuctionPool> owner = std::move(pool);
+            owner->release(object);
+        };
+
+    return std::shared_ptr<T>(object, std::move(deleter),
+                              ControlBlockAllocator<T>(controlBlocks_));
+}
+
+void
+AuctionPool::
+release(Auction * auction)
+    noexcept
+{
+    auction->clear();
+    if (!push(freeAuctions_, auction))
+        delete auction;
+}
+
+void
+AuctionPool::
+release(BidRequest * request)
+    noexcept
+{
+    request->clear();
+    if (!push(freeBidRequests_, request))
+        delete request;
+}
+
+template<typename T>
+T *
+AuctionPool::
+pop(std::vector<T *> & freeList)
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    if (freeList.empty())
+        return nullptr;
+    T * result = freeList.back();
+    freeList.pop_back();
+    return result;
+}
+
+template<typename T>
+bool
+AuctionPool::
+push(std::vector<T *> & freeList, T * object)
+    noexcept
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    if (freeList.size() >= freeList.capacity())
+        return false;
+    freeList.push_back(object);
+    return true;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,85 @@
+/* auction_pool.h                                                  -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Pool of auctions and bid requests that are recycled once they die.
+*/
+
+#pragma once
+
+#include "rtbkit/common/auction.h"
+#include <mutex>
+#include <vector>
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* AUCTION POOL                                                              */
+/*****************************************************************************/
+
+/** Hands out auctions and bid requests that go back to the pool, cleared
+    but with their capacity kept, once the last reference to them goes.  In
+    the router that's on the auction graveyard thread rather than the
+    thread of the exchange connector that allocated them, so the free lists
+    are protected by a lock which is only held to push or pop one entry.
+
+    The control blocks of the returned shared pointers are recycled as
+    well, so that an auction in steady state doesn't go to malloc for the
+    objects themselves.  They are kept apart from the pool, as a recycled
+    auction's shared_from_this() still refers to its last control block
+    and that mustn't keep the pool alive.
+*/
+
+struct AuctionPool : public std::enable_shared_from_this<AuctionPool> {
+
+    AuctionPool(size_t maxFree = 1024);
+    ~AuctionPool();
+
+    AuctionPool(const AuctionPool & other) = delete;
+    AuctionPool & operator = (const AuctionPool & other) = delete;
+
+    /** Return an empty bid request, as if it were newly constructed. */
+    std::shared_ptr<BidRequest> getBidRequest();
+
+    /** Return an auction with the same state as one constructed from the
+        given arguments.
+    */
+    std::shared_ptr<Auction>
+    getAuction(ExchangeConnector * exchangeConnector,
+               Auction::HandleAuction handleAuction,
+               std::shared_ptr<BidRequest> request,
+               const std::string & requestStr,
+               const std::string & requestStrFormat,
+               Date start,
+               Date expiry);
+
+    /** Number of objects kept for reuse. */
+    size_t freeAuctions() const;
+    size_t freeBidRequests() const;
+
+private:
+    struct ControlBlocks;
+    template<typename T> struct ControlBlockAllocator;
+
+    template<typename T>
+    std::shared_ptr<T> share(T * object);
+
+    void release(Auction * auction) noexcept;
+    void release(BidRequest * request) noexcept;
+
+    template<typename T>
+    T * pop(std::vector<T *> & freeList);
+
+    template<typename T>
+    bool push(std::vector<T *> & freeList, T * object) noexcept;
+
+    /* the free lists never grow past the capacity reserved up front, so
+       that giving an object back never allocates */
+    mutable std::mutex lock_;
+    std::vector<Auction *> freeAuctions_;
+    std::vector<BidRequest *> freeBidRequests_;
+    std::shared_ptr<ControlBlocks> controlBlocks_;
+};
+
+} // namespace RTBKIT
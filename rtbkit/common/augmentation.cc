@@ -8,8 +8,10 @@
 
 #include "rtbkit/common/augmentation.h"
 #include "jml/arch/format.h"
+#include "jml/db/persistent.h"
 
 #include <iostream>
+#include <sstream>
 #include <algorithm>
 
 using namespace std;
@@ -99,6 +101,35 @@ fromJson(const Json::Value& json)
 }
 
 
+void
+Augmentation::
+serialize(ML::DB::Store_Writer & store) const
+{
+    unsigned char version = 0;
+    store << version;
+    store.save(tags);
+
+    // Most augmentors only set tags so the data is only written as JSON when
+    // there is some.
+    store << (data.isNull() ? string() : data.toStringNoNewLine());
+}
+
+void
+Augmentation::
+reconstitute(ML::DB::Store_Reader & store)
+{
+    unsigned char version;
+    store >> version;
+    if (version != 0)
+        throw ML::Exception("invalid Augmentation version");
+    store.load(tags);
+
+    string dataStr;
+    store >> dataStr;
+    data = dataStr.empty() ? Json::Value() : Json::parse(dataStr);
+}
+
+
 /******************************************************************************/
 /* AUGMENTATION LIST                                                          */
 /******************************************************************************/
@@ -185,4 +216,54 @@ fromJson(const Json::Value& json)
     return list;
 }
 
+void
+AugmentationList::
+serialize(ML::DB::Store_Writer & store) const
+{
+    unsigned char version = 0;
+    store << version << ML::DB::compact_size_t(size());
+    for (const auto & entry: *this) {
+        entry.first.serialize(store);
+        entry.second.serialize(store);
+    }
+}
+
+void
+AugmentationList::
+reconstitute(ML::DB::Store_Reader & store)
+{
+    unsigned char version;
+    store >> version;
+    if (version != 0)
+        throw ML::Exception("invalid AugmentationList version");
+
+    clear();
+    ML::DB::compact_size_t n(store);
+    for (size_t i = 0; i < n; ++i) {
+        AccountKey account;
+        account.reconstitute(store);
+        (*this)[account].reconstitute(store);
+    }
+}
+
+std::string
+AugmentationList::
+serializeToString() const
+{
+    ostringstream stream;
+    ML::DB::Store_Writer store(stream);
+    serialize(store);
+    return stream.str();
+}
+
+AugmentationList
+AugmentationList::
+createFromString(const std::string & str)
+{
+    ML::DB::Store_Reader store(str.c_str(), str.size());
+    AugmentationList result;
+    result.reconstitute(store);
+    return result;
+}
+
 } // namespace RTBKIT
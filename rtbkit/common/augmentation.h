@@ -43,6 +43,9 @@ struct Augmentation
 
     Json::Value toJson() const;
     static Augmentation fromJson(const Json::Value& json);
+
+    void serialize(ML::DB::Store_Writer & store) const;
+    void reconstitute(ML::DB::Store_Reader & store);
 };
 
 /** Agent name to stringified augemntation.
@@ -84,6 +87,15 @@ struct AugmentationList : public AugmentationListBase
 
     Json::Value toJson() const;
     static AugmentationList fromJson(const Json::Value& json);
+
+    /** Binary encoding used between the augmentors and the router, which
+        avoids going through JSON for anything but the data.
+    */
+    void serialize(ML::DB::Store_Writer & store) const;
+    void reconstitute(ML::DB::Store_Reader & store);
+
+    std::string serializeToString() const;
+    static AugmentationList createFromString(const std::string & str);
 };
 
 
@@ -271,6 +271,7 @@ fromJson(const Json::Value & val)
         return;
     }
     else if (val.isArray()) {
+        reserve(val.size());
         for (unsigned i = 0;  i < val.size();  ++i) {
             Format f;
             f.fromJson(val[i]);
@@ -401,7 +402,18 @@ struct FormatSetDescription
     virtual void printJsonTyped(const FormatSet * val,
                                 JsonPrintingContext & context) const
     {
-        context.writeJson(val->toJson());
+        // Same as toJson(), without building the Json::Value
+        if (val->empty()) {
+            context.writeNull();
+            return;
+        }
+
+        context.startArray(val->size());
+        for (auto & format: *val) {
+            context.newArrayElement();
+            context.writeString(format.print());
+        }
+        context.endArray();
     }
 
     virtual bool isDefaultTyped(const FormatSet * val) const
@@ -523,6 +535,7 @@ SmallIntVector getDims(const Json::Value & val)
     SmallIntVector result;
 
     if (val.isArray()) {
+        result.reserve(val.size());
         for (unsigned i = 0;  i < val.size();  ++i)
             result.push_back(val[i].asInt());
     }
@@ -597,6 +610,7 @@ fromJson(const Json::Value & val)
             formats.clear();
             if (widths.size() != heights.size())
                 throw ML::Exception("widths and heights must have same size");
+            formats.reserve(widths.size());
             for (unsigned i = 0;  i < widths.size();  ++i)
                 formats.push_back(Format(widths[i], heights[i]));
         }
@@ -893,10 +907,76 @@ getDefaultDescription(RTBKIT::UserIds *)
 }
 
 
+/*****************************************************************************/
+/* FLAT USER IDS                                                             */
+/*****************************************************************************/
+
+FlatUserIds::
+FlatUserIds(const UserIds & ids)
+{
+    entries.reserve(ids.size());
+
+    auto & keys = requestKeys();
+    for (const auto & entry : ids)
+        entries.push_back({ keys.intern(entry.first), &entry.second });
+
+    std::sort(entries.begin(), entries.end());
+}
+
+const Id *
+FlatUserIds::
+find(const std::string & domain) const
+{
+    InternedKey key = requestKeys().lookup(domain);
+    if (key == InternTable::NoKey) return nullptr;
+    return find(key);
+}
+
+
 /*****************************************************************************/
 /* BID REQUEST                                                               */
 /*****************************************************************************/
 
+void
+BidRequest::
+clear()
+{
+    auctionId = Id();
+    auctionType = AuctionType::SECOND_PRICE;
+    timeAvailableMs = 0.0;
+    timestamp = Date();
+    isTest = false;
+
+    protocolVersion.clear();
+    exchange.clear();
+    provider.clear();
+    userAgentIPHash = Id();
+
+    site.reset();
+    app.reset();
+    device.reset();
+    user.reset();
+    imp.clear();
+    regs.reset();
+
+    language = Datacratic::UnicodeString();
+    location = Location();
+    url = Url();
+    ipAddress.clear();
+    userAgent = Datacratic::UnicodeString();
+    userIds = UserIds();
+    restrictions = SegmentsBySource();
+    segments = SegmentsBySource();
+
+    meta = Json::Value();
+    unparseable = Json::Value();
+    bidCurrency.clear();
+    blockedCategories.clear();
+    badv.clear();
+    winSurcharges.clear();
+    ext = Json::Value();
+}
+
 void
 BidRequest::
 sortAll()
@@ -1104,6 +1184,9 @@ createFromJson(const Json::Value & json)
     return result;
 }
 
+// Defined before atInit below which registers it.
+const std::string BidRequest::BinaryFormat = "rtbkit-binary";
+
 namespace {
 
 static const DefaultDescription<BidRequest> BidRequestDesc;
@@ -1130,12 +1213,21 @@ struct CanonicalParser {
     }
 };
 
+BidRequest * parseBinary(const std::string & str)
+{
+    DB::Store_Reader store(str.c_str(), str.size());
+    std::unique_ptr<BidRequest> result(new BidRequest());
+    result->reconstitute(store);
+    return result.release();
+}
+
 struct AtInit {
     AtInit()
     {
         PluginInterface<BidRequest>::registerPlugin("recoset", CanonicalParser::parse);
         PluginInterface<BidRequest>::registerPlugin("datacratic", CanonicalParser::parse);
         PluginInterface<BidRequest>::registerPlugin("rtbkit", CanonicalParser::parse);
+        PluginInterface<BidRequest>::registerPlugin(BidRequest::BinaryFormat, parseBinary);
     }
 } atInit;
 } // file scope
@@ -1254,17 +1346,68 @@ operator >> (ML::DB::Store_Reader & store, Json::Value & val)
 }
 
 
+namespace {
+
+/** The OpenRTB objects don't have a binary serialization so they are stored
+    as JSON, but only when they're present.
+*/
+template<typename T>
+void serializeOptional(ML::DB::Store_Writer & store, const Optional<T> & val)
+{
+    bool present = val.get();
+    store << present;
+    if (present)
+        store << jsonEncodeStr(*val);
+}
+
+template<typename T>
+void reconstituteOptional(ML::DB::Store_Reader & store, Optional<T> & val)
+{
+    bool present;
+    store >> present;
+    if (!present) {
+        val.reset();
+        return;
+    }
+
+    string json;
+    store >> json;
+    val.reset(new T(jsonDecodeStr<T>(json)));
+}
+
+} // file scope
+
 void
 BidRequest::
 serialize(ML::DB::Store_Writer & store) const
 {
     using namespace ML::DB;
-    unsigned char version = 2;
+    unsigned char version = 3;
     store << version << auctionId << language << protocolVersion
           << exchange << provider << timestamp << isTest
           << location << userIds << imp << url << ipAddress << userAgent
           << restrictions << segments << meta
           << winSurcharges;
+
+    // Version 3 carries the rest of the request so that it can replace the
+    // JSON sent to the agents.
+    store << auctionType.val << timeAvailableMs << userAgentIPHash;
+
+    serializeOptional(store, site);
+    serializeOptional(store, app);
+    serializeOptional(store, device);
+    serializeOptional(store, user);
+    serializeOptional(store, regs);
+
+    store << compact_size_t(bidCurrency.size());
+    for (CurrencyCode code : bidCurrency)
+        store << uint32_t(code);
+
+    store << compact_size_t(blockedCategories.size());
+    for (const auto & category : blockedCategories)
+        store << category.val;
+
+    store << badv << ext << unparseable;
 }
 
 void
@@ -1277,7 +1420,7 @@ reconstitute(ML::DB::Store_Reader & store)
 
     store >> version;
 
-    if (version != 2)
+    if (version != 2 && version != 3)
         throw ML::Exception("problem reconstituting BidRequest: "
                             "invalid version");
 
@@ -1285,6 +1428,35 @@ reconstitute(ML::DB::Store_Reader & store)
           >> exchange >> provider >> timestamp >> isTest
           >> location >> userIds >> imp >> url >> ipAddress >> userAgent
           >> restrictions >> segments >> meta >> winSurcharges;
+
+    if (version < 3) return;
+
+    store >> auctionType.val >> timeAvailableMs >> userAgentIPHash;
+
+    reconstituteOptional(store, site);
+    reconstituteOptional(store, app);
+    reconstituteOptional(store, device);
+    reconstituteOptional(store, user);
+    reconstituteOptional(store, regs);
+
+    compact_size_t numCurrencies(store);
+    bidCurrency.clear();
+    bidCurrency.reserve(numCurrencies);
+    for (unsigned i = 0;  i < numCurrencies;  ++i) {
+        uint32_t code;
+        store >> code;
+        bidCurrency.push_back(CurrencyCode(code));
+    }
+
+    compact_size_t numCategories(store);
+    blockedCategories.clear();
+    for (unsigned i = 0;  i < numCategories;  ++i) {
+        string category;
+        store >> category;
+        blockedCategories.push_back(OpenRTB::ContentCategory(category));
+    }
+
+    store >> badv >> ext >> unparseable;
 }
 
 } // namespace RTBKIT
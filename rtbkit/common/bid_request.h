@@ -222,6 +222,69 @@ ValueDescriptionT<RTBKIT::UserIds> *
 getDefaultDescription(RTBKIT::UserIds * = 0);
 
 
+/*****************************************************************************/
+/* FLAT USER IDS                                                             */
+/*****************************************************************************/
+
+/** Read-only view of a UserIds stored as a vector sorted by interned domain;
+    see FlatSegmentsBySource. Only valid as long as the UserIds it was built
+    from is alive and unmodified.
+*/
+
+struct FlatUserIds {
+
+    struct Entry {
+        InternedKey domain;
+        const Id * id;
+
+        bool operator < (const Entry & other) const
+        {
+            return domain < other.domain;
+        }
+    };
+
+    typedef ML::compact_vector<Entry, 4, uint32_t, false> Entries;
+    typedef Entries::const_iterator const_iterator;
+
+    FlatUserIds() {}
+    explicit FlatUserIds(const UserIds & ids);
+
+    /** Returns the id for the domain or null if it isn't present. */
+    const Id * find(InternedKey domain) const
+    {
+        for (const Entry & entry : entries) {
+            if (entry.domain >= domain)
+                return entry.domain == domain ? entry.id : nullptr;
+        }
+        return nullptr;
+    }
+
+    const Id * find(const std::string & domain) const;
+
+    /** Returns the id for the domain or a null Id if it isn't present. */
+    Id get(InternedKey domain) const
+    {
+        const Id * id = find(domain);
+        return id ? *id : Id();
+    }
+
+    Id get(const std::string & domain) const
+    {
+        const Id * id = find(domain);
+        return id ? *id : Id();
+    }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+private:
+    Entries entries;
+};
+
+
 
 /*****************************************************************************/
 /* LOCATION                                                                  */
@@ -273,6 +336,12 @@ struct BidRequest {
     {
     }
 
+    /** Return to the state of a newly constructed request, but keeping the
+        capacity of the strings and vectors so that a pooled request can be
+        parsed into again without allocating.
+    */
+    void clear();
+
     Id auctionId;
     AuctionType auctionType;
     double timeAvailableMs;
@@ -427,6 +496,12 @@ struct BidRequest {
 
     std::string serializeToString() const;
     static BidRequest createFromString(const std::string & str);
+
+    /** Source under which the binary encoding produced by
+        serializeToString() is registered as a parser. Sending this format
+        to the agents saves them a full JSON parse of the request.
+    */
+    static const std::string BinaryFormat;
 };
 
 IMPL_SERIALIZE_RECONSTITUTE(BidRequest);
@@ -30,4 +30,25 @@ BidRequestPipeline::create(
     return std::shared_ptr<BidRequestPipeline>(factory(std::move(serviceName), std::move(proxies), json));
 }
 
+void
+BidRequestPipeline::preBidRequestAsync(
+        const ExchangeConnector* exchange,
+        const HttpHeader& header,
+        const std::string& payload,
+        Date deadline,
+        const OnPipelineDone& onDone)
+{
+    onDone(preBidRequest(exchange, header, payload));
+}
+
+void
+BidRequestPipeline::postBidRequestAsync(
+        const ExchangeConnector* exchange,
+        const std::shared_ptr<Auction>& auction,
+        Date deadline,
+        const OnPipelineDone& onDone)
+{
+    onDone(postBidRequest(exchange, auction));
+}
+
 } // namespace RTBKIT
@@ -12,6 +12,8 @@
 #include "soa/jsoncpp/json.h"
 #include "rtbkit/common/exchange_connector.h"
 #include "rtbkit/common/bid_request.h"
+#include "soa/types/date.h"
+#include <functional>
 #include <string>
 #include <memory>
 
@@ -22,6 +24,11 @@ enum class PipelineStatus {
     Stop
 };
 
+/** Called by an asynchronous pipeline stage once it's done with a request.
+    It can be called from any thread but must be called exactly once.
+*/
+typedef std::function<void (PipelineStatus)> OnPipelineDone;
+
 class BidRequestPipeline : public Datacratic::ServiceBase {
 public:
 
@@ -52,6 +59,34 @@ public:
             const ExchangeConnector* exchange,
             const std::shared_ptr<Auction>& auction) = 0;
 
+    /** Asynchronous versions of preBidRequest and postBidRequest, used by
+        the exchange connectors so that a stage doing I/O doesn't hold up the
+        thread serving the request.
+
+        The stage calls onDone once it's finished, which can be after the
+        call returns.  The connector stops waiting at the deadline and carries
+        on as if the stage had returned Continue, so stages should give up
+        by then.  The arguments are only guaranteed to live until the call
+        returns; a stage that keeps working on them must take a copy.
+
+        The default implementations call the synchronous versions and onDone
+        straight away.
+    */
+    virtual void
+    preBidRequestAsync(
+            const ExchangeConnector* exchange,
+            const Datacratic::HttpHeader& header,
+            const std::string& payload,
+            Datacratic::Date deadline,
+            const OnPipelineDone& onDone);
+
+    virtual void
+    postBidRequestAsync(
+            const ExchangeConnector* exchange,
+            const std::shared_ptr<Auction>& auction,
+            Datacratic::Date deadline,
+            const OnPipelineDone& onDone);
+
 };
 
 } // namespace RTBKIT
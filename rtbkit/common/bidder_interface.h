@@ -104,6 +104,11 @@ struct BidderInterface : public ServiceBase
                          std::string const & agent,
                          int ping) = 0;
 
+    /** Send whatever was held back to be sent in batches, such as losses.
+        Called regularly from the router's loop.
+    */
+    virtual void flush() { }
+
     virtual void registerLoopMonitor(LoopMonitor *monitor) const { }
 
     //
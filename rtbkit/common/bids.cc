@@ -10,6 +10,11 @@
 
 #include "jml/utils/exc_check.h"
 #include "jml/utils/json_parsing.h"
+#include "soa/jsoncpp/reader.h"
+#include "soa/jsoncpp/writer.h"
+
+#include <climits>
+#include <string.h>
 
 using namespace std;
 using namespace ML;
@@ -224,10 +229,68 @@ toJson() const
     return json;
 }
 
+namespace {
+
+/** Same output as writing Bid::toJson() but without building the
+    Json::Value.
+*/
+void appendBidJson(std::string & out, const Bid & bid)
+{
+    if (bid.isNullBid()) {
+        out += "null";
+        return;
+    }
+
+    out += '{';
+    if (!bid.account.empty()) {
+        out += "\"account\":";
+        out += Json::valueToQuotedString(bid.account.toString().c_str());
+        out += ',';
+    }
+    out += "\"creative\":";
+    out += Json::valueToString(Json::Int(bid.creativeIndex));
+    out += ",\"ext\":";
+    out += bid.ext.toStringNoNewLine();
+    out += ",\"price\":";
+    out += Json::valueToQuotedString(bid.price.toString().c_str());
+    out += ",\"priority\":";
+    out += Json::valueToString(bid.priority);
+    out += ",\"spotIndex\":";
+    out += Json::valueToString(Json::Int(bid.spotIndex));
+    out += '}';
+}
+
+} // file scope
+
 std::string
 Bids::
-toJsonStr() const{
-    return toJson().toStringNoNewLine();
+toJsonStr() const
+{
+    // This is done for every bid the agents send so the JSON is written
+    // directly.
+    std::string result;
+    result.reserve(64 + 128 * size());
+
+    result += "{\"bids\":[";
+    for (size_t i = 0; i < size(); ++i) {
+        if (i) result += ',';
+        appendBidJson(result, (*this)[i]);
+    }
+    result += ']';
+
+    if (!dataSources.empty()) {
+        result += ",\"sources\":[";
+        bool first = true;
+        for (const string& dataSource : dataSources) {
+            if (!first) result += ',';
+            result += Json::valueToQuotedString(dataSource.c_str());
+            first = false;
+        }
+        result += ']';
+    }
+
+    result += '}';
+    return result;
 }
 
 Bids
@@ -278,6 +341,355 @@ fromJson(const std::string& raw)
     return result;
 }
 
+namespace {
+
+/** Reads JSON straight from the bytes of a bid response.  Unlike
+    Parse_Context it doesn't allocate anything, which is why it's used
+    instead for the bids the router gets.  Strings must be ASCII, as with
+    Bid::fromJson().
+*/
+struct BidsScanner {
+
+    BidsScanner(const char * start, const char * end)
+        : start(start), p(start), end(end)
+    {
+    }
+
+    void error(const std::string & what) const
+    {
+        throw ML::Exception("parsing bids at offset %zd: %s",
+                            p - start, what.c_str());
+    }
+
+    void skipWhitespace()
+    {
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            ++p;
+    }
+
+    bool match(char c)
+    {
+        skipWhitespace();
+        if (p == end || *p != c)
+            return false;
+        ++p;
+        return true;
+    }
+
+    void expect(char c)
+    {
+        if (!match(c))
+            error(std::string("expected '") + c + "'");
+    }
+
+    bool matchNull()
+    {
+        skipWhitespace();
+        if (end - p < 4 || strncmp(p, "null", 4) != 0)
+            return false;
+        p += 4;
+        return true;
+    }
+
+    void expectEnd()
+    {
+        skipWhitespace();
+        if (p != end)
+            error("trailing characters");
+    }
+
+    /** Reads a string into the buffer, null terminated. */
+    void expectString(char * buf, size_t size)
+    {
+        expect('"');
+
+        size_t n = 0;
+        for (;;) {
+            if (p == end)
+                error("unterminated string");
+            char c = *p++;
+            if (c == '"')
+                break;
+
+            if (c == '\\') {
+                if (p == end)
+                    error("unterminated string");
+                switch (c = *p++) {
+                case '"': case '\\': case '/': break;
+                case 'b': c = '\b';  break;
+                case 'f': c = '\f';  break;
+                case 'n': c = '\n';  break;
+                case 'r': c = '\r';  break;
+                case 't': c = '\t';  break;
+                case 'u': c = expectAsciiEscape();  break;
+                default: error("invalid escape in string");
+                }
+            }
+            else if (c & 0x80)
+                error("non-ASCII character in string");
+
+            if (n + 1 >= size)
+                error("string is too long");
+            buf[n++] = c;
+        }
+        buf[n] = 0;
+    }
+
+    char expectAsciiEscape()
+    {
+        if (end - p < 4)
+            error("truncated unicode escape");
+
+        int code = 0;
+        for (int i = 0;  i < 4;  ++i) {
+            char c = *p++;
+            code *= 16;
+            if (c >= '0' && c <= '9') code += c - '0';
+            else if (c >= 'a' && c <= 'f') code += c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code += c - 'A' + 10;
+            else error("invalid unicode escape");
+        }
+
+        if (code == 0 || code >= 0x80)
+            error("non-ASCII character in string");
+        return code;
+    }
+
+    /** Copies the characters of a number into the buffer so that it can be
+        given to strtol or strtod, which need a null terminator.
+    */
+    void expectNumber(char * buf, size_t size)
+    {
+        skipWhitespace();
+
+        size_t n = 0;
+        while (p != end && *p && strchr("0123456789+-.eE", *p)) {
+            if (n + 1 >= size)
+                error("number is too long");
+            buf[n++] = *p++;
+        }
+        if (n == 0)
+            error("expected a number");
+        buf[n] = 0;
+    }
+
+    int expectInt()
+    {
+        char buf[32];
+        expectNumber(buf, sizeof(buf));
+
+        char * ep;
+        errno = 0;
+        long val = strtol(buf, &ep, 10);
+        if (*ep || errno || val < INT_MIN || val > INT_MAX)
+            error("expected an integer");
+        return val;
+    }
+
+    double expectDouble()
+    {
+        char buf[64];
+        expectNumber(buf, sizeof(buf));
+
+        char * ep;
+        double val = strtod(buf, &ep);
+        if (*ep)
+            error("expected a number");
+        return val;
+    }
+
+    /** Decodes any JSON value, which is the one place that allocates. */
+    void expectJson(Json::Value & value)
+    {
+        skipWhitespace();
+        const char * valueStart = p;
+        skipValue();
+
+        Json::Reader reader;
+        if (!reader.parse(valueStart, p, value, false))
+            error("invalid JSON value: " + reader.getFormattedErrorMessages());
+    }
+
+    /** Moves past a JSON value without checking it any further than needed
+        to find where it ends.
+    */
+    void skipValue()
+    {
+        int depth = 0;
+        do {
+            skipWhitespace();
+            if (p == end)
+                error("truncated value");
+
+            const char * before = p;
+            switch (*p) {
+            case '"':
+                for (++p;  p != end && *p != '"';  ++p)
+                    if (*p == '\\' && p + 1 != end)
+                        ++p;
+                if (p == end)
+                    error("unterminated string");
+                ++p;
+                break;
+            case '{': case '[': ++depth;  ++p;  break;
+            case '}': case ']': --depth;  ++p;  break;
+            case ',': case ':': ++p;  break;
+            default:
+                while (p != end && *p && !strchr(",:{}[]\" \t\r\n", *p))
+                    ++p;
+            }
+
+            if (p == before)
+                error("invalid character");
+        } while (depth > 0);
+    }
+
+    /** Calls onField with the key of each field of an object, the scanner
+        being on the field's value.
+    */
+    template<typename OnField>
+    void forEachField(const OnField & onField)
+    {
+        expect('{');
+        if (match('}'))
+            return;
+        do {
+            char key[64];
+            expectString(key, sizeof(key));
+            expect(':');
+            onField(key);
+        } while (match(','));
+        expect('}');
+    }
+
+    template<typename OnElement>
+    void forEachElement(const OnElement & onElement)
+    {
+        expect('[');
+        if (match(']'))
+            return;
+        do {
+            onElement();
+        } while (match(','));
+        expect(']');
+    }
+
+    const char * start;
+    const char * p;
+    const char * end;
+};
+
+void parseBid(BidsScanner & scanner, Bid & bid)
+{
+    bid = Bid();
+
+    if (scanner.matchNull())
+        return;  // null bid
+
+    auto onBidField = [&] (const char * fieldName)
+        {
+            switch (fieldName[0]) {
+
+            case 'a':
+                if (!strcmp(fieldName, "account")) {
+                    char account[256];
+                    scanner.expectString(account, sizeof(account));
+                    bid.account = AccountKey(account);
+                    return;
+                }
+                break;
+
+            case 'c':
+                if (!strcmp(fieldName, "creative")) {
+                    bid.creativeIndex = scanner.expectInt();
+                    return;
+                }
+                break;
+
+            case 'e':
+                if (!strcmp(fieldName, "ext")) {
+                    scanner.expectJson(bid.ext);
+                    return;
+                }
+                break;
+
+            case 'p':
+                if (!strcmp(fieldName, "price")) {
+                    char price[64];
+                    scanner.expectString(price, sizeof(price));
+                    bid.price = Amount::parse(price);
+                    return;
+                }
+                if (!strcmp(fieldName, "priority")) {
+                    bid.priority = scanner.expectDouble();
+                    return;
+                }
+                break;
+
+            case 's':
+                if (!strcmp(fieldName, "spotIndex")) {
+                    bid.spotIndex = scanner.expectInt();
+                    return;
+                }
+                // Legacy name for priority
+                if (!strcmp(fieldName, "surplus")) {
+                    bid.priority = scanner.expectDouble();
+                    return;
+                }
+                break;
+            }
+
+            scanner.error(std::string("unknown bid field ") + fieldName);
+        };
+
+    scanner.forEachField(onBidField);
+}
+
+} // file scope
+
+void
+Bids::
+parse(const char * start, const char * end, Bids & result)
+{
+    BidsScanner scanner(start, end);
+
+    size_t numBids = 0;
+    result.dataSources.clear();
+
+    auto onBidsField = [&] (const char * fieldName)
+        {
+            if (!strcmp(fieldName, "bids")) {
+                scanner.forEachElement([&] ()
+                    {
+                        if (numBids == result.size())
+                            result.emplace_back();
+                        parseBid(scanner, result[numBids++]);
+                    });
+            }
+            else if (!strcmp(fieldName, "sources")) {
+                scanner.forEachElement([&] ()
+                    {
+                        char source[256];
+                        scanner.expectString(source, sizeof(source));
+                        result.dataSources.insert(source);
+                    });
+            }
+            else scanner.error(std::string("unknown bids field ") + fieldName);
+        };
+
+    scanner.forEachField(onBidsField);
+    scanner.expectEnd();
+
+    result.resize(numBids);
+}
+
+void
+Bids::
+parse(const std::string & raw, Bids & result)
+{
+    parse(raw.c_str(), raw.c_str() + raw.length(), result);
+}
+
 /******************************************************************************/
 /* BID RESULT                                                                 */
 /******************************************************************************/
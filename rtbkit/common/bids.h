@@ -115,6 +115,14 @@ struct Bids : public ML::compact_vector<Bid, 4>
     Json::Value toJson() const;
     std::string toJsonStr() const;
     static Bids fromJson(const std::string& raw);
+
+    /** Parses the same JSON as fromJson() into result, reusing what it
+        already holds.  Nothing is allocated unless there are more than 4
+        bids or an ext, account or sources field, which is what the router
+        relies on for every bid it gets.
+     */
+    static void parse(const char * start, const char * end, Bids & result);
+    static void parse(const std::string & raw, Bids & result);
 };
 
 
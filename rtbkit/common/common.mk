@@ -3,9 +3,12 @@
 LIBBIDREQUEST_SOURCES := \
 	bid_request.cc \
 	segments.cc \
+	roaring_bitmap.cc \
+	interned_key.cc \
 	json_holder.cc \
 	currency.cc \
-	expand_variable.cc 
+	expand_variable.cc \
+	tags.cc
 
 LIBBIDREQUEST_LINK := \
 	types boost_regex db openrtb value_description
@@ -14,6 +17,7 @@ $(eval $(call library,bid_request,$(LIBBIDREQUEST_SOURCES),$(LIBBIDREQUEST_LINK)
 
 LIBRTB_SOURCES := \
 	auction.cc \
+	auction_pool.cc \
 	augmentation.cc \
 	account_key.cc \
 	bids.cc \
@@ -23,11 +27,12 @@ LIBRTB_SOURCES := \
 	win_cost_model.cc \
 	post_auction_proxy.cc \
 	analytics_publisher.cc \
+	analytics_batch.cc \
 	extension.cc \
 	bid_request_pipeline.cc
 
 LIBRTB_LINK := \
-	ACE arch utils jsoncpp boost_thread endpoint boost_regex zmq opstats bid_request
+	ACE arch utils jsoncpp boost_thread endpoint boost_regex zmq opstats bid_request gc
 
 $(eval $(call library,rtb,$(LIBRTB_SOURCES),$(LIBRTB_LINK)))
 
@@ -156,39 +156,51 @@ Amount
 Amount::
 parse(const std::string & value)
 {
-    if (value == "0")
+    return parse(value.c_str());
+}
+
+Amount
+Amount::
+parse(const char * value)
+{
+    if (strcmp(value, "0") == 0)
         return Amount();
 
-    const char * p = value.c_str();
     char * ep = 0;
     errno = 0;
-    long long val = strtoll(p, &ep, 10);
+    long long val = strtoll(value, &ep, 10);
     if (errno != 0)
         throw ML::Exception("invalid amount parsed");
-    string currency(ep);
 
-    if (currency == "") {
-        throw ML::Exception("no currency on Amount " + value);
+    if (*ep == 0) {
+        throw ML::Exception("no currency on Amount " + string(value));
     }
 
-    return Amount(currency, val);
+    return Amount(parseCurrency(ep), val);
 }
 
 CurrencyCode
 Amount::
 parseCurrency(const std::string & currency)
 {
-    if (currency == "NONE")
+    return parseCurrency(currency.c_str());
+}
+
+CurrencyCode
+Amount::
+parseCurrency(const char * currency)
+{
+    if (strcmp(currency, "NONE") == 0)
         return CurrencyCode::CC_NONE;
-    if (currency == "EUR/1M")
+    if (strcmp(currency, "EUR/1M") == 0)
         return CurrencyCode::CC_EUR;
-    if (currency == "USD/1M")
+    if (strcmp(currency, "USD/1M") == 0)
         return CurrencyCode::CC_USD;
-    if (currency == "IMP")
+    if (strcmp(currency, "IMP") == 0)
         return CurrencyCode::CC_IMP;
-    if (currency == "CLK")
+    if (strcmp(currency, "CLK") == 0)
         return CurrencyCode::CC_CLK;
-    throw ML::Exception("unknown currency code " + currency);
+    throw ML::Exception("unknown currency code " + string(currency));
 }
 
 std::ostream &
@@ -312,13 +324,6 @@ getAvailable(const CurrencyCode & currency) const
     return Amount(currency, 0);
 }
 
-bool
-CurrencyPool::
-hasAvailable(const Amount & amount) const
-{
-    return getAvailable(amount.currencyCode).value >= amount.value;
-}
-
 Json::Value
 CurrencyPool::
 toJson() const
@@ -518,7 +523,18 @@ struct AmountDescription
     virtual void printJsonTyped(const Amount * val,
                                 JsonPrintingContext & context) const
     {
-        context.writeJson(val->toJson());
+        // Same as toJson(), without building the Json::Value
+        if (val->isZero()) {
+            context.writeInt(0);
+            return;
+        }
+
+        context.startArray(2);
+        context.newArrayElement();
+        context.writeLongLong(val->value);
+        context.newArrayElement();
+        context.writeString(val->getCurrencyStr());
+        context.endArray();
     }
 
     virtual bool isDefaultTyped(const Amount * val) const
@@ -165,6 +165,7 @@ struct Amount {
     static std::string getCurrencyStr(CurrencyCode currencyCode);
     std::string getCurrencyStr() const;
     static CurrencyCode parseCurrency(const std::string & currency);
+    static CurrencyCode parseCurrency(const char * currency);
 
     std::string toString() const;
 
@@ -172,6 +173,9 @@ struct Amount {
     static Amount fromJson(const Json::Value & json);
     static Amount parse(const std::string & value);
 
+    /** Same as above but doesn't allocate, for the bid parser. */
+    static Amount parse(const char * value);
+
     void serialize(ML::DB::Store_Writer & store) const;
     void reconstitute(ML::DB::Store_Reader & store);
 
@@ -391,15 +395,16 @@ struct CurrencyPool {
 
         for (auto & am: currencyAmounts) {
             if (am.currencyCode == amount.currencyCode) {
-                am += amount;
+                am.value += amount.value;
                 return *this;
             }
         }
 
         currencyAmounts.push_back(amount);
-        std::sort(currencyAmounts.begin(), currencyAmounts.end(),
-                  [] (Amount am1, Amount am2)
-                  { return am1.currencyCode < am2.currencyCode; });
+        if (currencyAmounts.size() > 1)
+            std::sort(currencyAmounts.begin(), currencyAmounts.end(),
+                      [] (Amount am1, Amount am2)
+                      { return am1.currencyCode < am2.currencyCode; });
 
         return *this;
     }
@@ -511,11 +516,26 @@ struct CurrencyPool {
     /** Return if there is enough available to cover the given
         request.
     */
-    bool hasAvailable(const Amount & amount) const;
+    bool hasAvailable(const Amount & amount) const
+    {
+        return valueOf(amount.currencyCode) >= amount.value;
+    }
 
     /** Return the amount available in the given currency code. */
     Amount getAvailable(const CurrencyCode & currency) const;
 
+    /** Return the value held in the given currency code or 0.  Pools
+        almost always hold a single currency so this is meant for the hot
+        paths which don't need an Amount.
+    */
+    int64_t valueOf(CurrencyCode currency) const
+    {
+        for (auto & am: currencyAmounts)
+            if (am.currencyCode == currency)
+                return am.value;
+        return 0;
+    }
+
     bool isNonNegative() const
     {
         for (auto & am: currencyAmounts)
@@ -26,6 +26,7 @@ ExchangeConnector::
 ExchangeConnector(const std::string & name,
                   ServiceBase & parent)
 : ServiceBase(name, parent)
+, auctionPool(std::make_shared<AuctionPool>())
 , hasCurrencyConfigured_(false)
 , currency_("USD")
 , currencyCode_(CurrencyCode::CC_USD)
@@ -47,6 +48,7 @@ ExchangeConnector::
 ExchangeConnector(const std::string & name,
                   std::shared_ptr<ServiceProxies> proxies)
 : ServiceBase(name, proxies)
+, auctionPool(std::make_shared<AuctionPool>())
 , hasCurrencyConfigured_(false)
 , currency_("USD")
 , currencyCode_(CurrencyCode::CC_USD)
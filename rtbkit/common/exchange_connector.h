@@ -9,6 +9,7 @@
 
 #include "soa/service/service_base.h"
 #include "rtbkit/common/auction.h"
+#include "rtbkit/common/auction_pool.h"
 #include "rtbkit/common/win_cost_model.h"
 #include "jml/utils/unnamed_bool.h"
 #include "rtbkit/common/plugin_interface.h"
@@ -65,6 +66,21 @@ struct ExchangeConnector: public ServiceBase {
                                   const std::string & message)> OnAuctionError;
     OnAuctionError onAuctionError;
 
+    /** Pool from which the connector takes its auctions and bid requests;
+        they go back to it once the router is done with them.
+    */
+    std::shared_ptr<AuctionPool> auctionPool;
+
+    /** Tells whether any agent could bid on a request of which only the
+        exchange and the url are known (see FilterPool::preParseMatches).
+        Set by the router, it lets the pre-parse pipeline stage drop the
+        requests that nobody targets before they're parsed.  Empty when the
+        connector isn't connected to a router.
+    */
+    typedef boost::function<bool (const BidRequest & partial)>
+        PreParseMatches;
+    PreParseMatches preParseMatches;
+
     /*************************************************************************/
     /* METHODS CALLED BY THE ROUTER TO CONTROL THE EXCHANGE CONNECTOR        */
     /*************************************************************************/
@@ -77,6 +93,17 @@ struct ExchangeConnector: public ServiceBase {
     virtual void stopRequestLogging() {
     }
 
+    /** Start keeping one in sampleRate of the requests, with their
+        responses, in the given columnar log.  Meant to be left on.
+    */
+    virtual void startRequestSampling(std::string const & filename,
+                                      unsigned sampleRate = 1000) {
+    }
+
+    /** Stop sampling */
+    virtual void stopRequestSampling() {
+    }
+
     /** Configure the exchange connector.  The JSON provided is entirely
         interpreted by the exchange connector itself.
     */
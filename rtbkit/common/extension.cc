@@ -6,78 +6,79 @@
 
 #include "extension.h"
 #include <iostream>
+#include <mutex>
 
 namespace RTBKIT {
 
-bool
-ExtensionPool::has(const std::string& name) const {
-    return getImpl(name).first;
-}
+namespace {
 
-void
-ExtensionPool::add(const std::shared_ptr<Extension>& ext){
-    data.insert(std::make_pair(ext->extensionName(), ext));
+struct SlotTable {
+    std::mutex lock;
+    std::unordered_map<std::string, unsigned> slots;
+};
+
+SlotTable& slotTable() {
+    static SlotTable table;
+    return table;
 }
 
-std::shared_ptr<Extension>
-ExtensionPool::get(const std::string& name) {
-    auto ext = getImpl(name);
-    if (!ext.first) {
-        throw ML::Exception("Unknown extension '%s'", name.c_str());
-    }
+} // file scope
 
-    return ext.second;
+unsigned
+ExtensionPool::slot(const std::string& name) {
+    auto& table = slotTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    return table.slots.insert(
+            std::make_pair(name, table.slots.size())).first->second;
 }
 
-std::shared_ptr<const Extension>
-ExtensionPool::get(const std::string& name) const {
-    auto ext = getImpl(name);
-    if (!ext.first) {
-        throw ML::Exception("Unknown extension '%s'", name.c_str());
-    }
+int
+ExtensionPool::findSlot(const std::string& name) {
+    auto& table = slotTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    auto it = table.slots.find(name);
+    return it == std::end(table.slots) ? -1 : it->second;
+}
 
-    return ext.second;
+bool
+ExtensionPool::has(const std::string& name) const {
+    int index = findSlot(name);
+    return index >= 0 && tryGet(index) != nullptr;
 }
 
-std::shared_ptr<Extension>
-ExtensionPool::tryGet(const std::string& name) {
-    auto ext = getImpl(name);
-    if (!ext.first) {
-        return nullptr;
+void
+ExtensionPool::add(const std::shared_ptr<Extension>& ext){
+    unsigned index = slot(ext->extensionName());
+    if (index >= data.size()) {
+        data.resize(index + 1);
     }
 
-    return ext.second;
+    // The first one added under a name is kept
+    if (!data[index]) {
+        data[index] = ext;
+    }
 }
 
-std::shared_ptr<const Extension>
-ExtensionPool::tryGet(const std::string& name) const {
-    auto ext = getImpl(name);
-    if (!ext.first) {
-        return nullptr;
+std::shared_ptr<Extension>
+ExtensionPool::get(unsigned slot, const char* name) const {
+    auto ext = tryGet(slot);
+    if (!ext) {
+        throw ML::Exception("Unknown extension '%s'", name);
     }
 
-    return ext.second;
+    return ext;
 }
 
 std::vector<std::shared_ptr<Extension>>
 ExtensionPool::list() const {
     std::vector<std::shared_ptr<Extension>> result;
-    result.reserve(data.size());
     for (const auto& ext: data) {
-        result.push_back(ext.second);
+        if (ext) {
+            result.push_back(ext);
+        }
     }
 
     return result;
 }
 
-std::pair<bool, std::shared_ptr<Extension>>
-ExtensionPool::getImpl(const std::string& name) const {
-    auto it = data.find(name);
-    if (it == std::end(data)) {
-        return std::make_pair(false, nullptr);
-    }
-
-    return std::make_pair(true, it->second);
-}
-
 } // namespace RTBKIT
@@ -16,6 +16,7 @@
 #endif
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <type_traits>
 #include <memory>
 
@@ -52,34 +53,44 @@ struct IsExtension {
     static_assert(IsExtension<Type>::value, "The type must be an extension and provide a Name (you should use the NAME macro)"); \
     (void) 0
 
+/** Extensions attached to an agent config or a creative.
+
+    Every extension name gets a fixed slot index the first time it is seen,
+    which for the registered extensions is when their factory is registered
+    at startup.  The pool keeps its extensions in a small array indexed by
+    slot, so the typed accessors used by the filters resolve the slot once
+    per type and then cost an array lookup, with no hashing or string
+    compare.
+*/
 class ExtensionPool {
 public:
     template<typename Ext>
     std::shared_ptr<Ext>
     get() {
         STATIC_ASSERT_EXTENSION(Ext);
-        return std::static_pointer_cast<Ext>(get(Ext::Name));
+        return std::static_pointer_cast<Ext>(get(slotOf<Ext>(), Ext::Name));
     }
 
     template<typename Ext>
     std::shared_ptr<const Ext>
     get() const {
         STATIC_ASSERT_EXTENSION(Ext);
-        return std::static_pointer_cast<const Ext>(get(Ext::Name));
+        return std::static_pointer_cast<const Ext>(
+                get(slotOf<Ext>(), Ext::Name));
     }
 
     template<typename Ext>
     std::shared_ptr<Ext>
     tryGet() {
         STATIC_ASSERT_EXTENSION(Ext);
-        return std::static_pointer_cast<Ext>(tryGet(Ext::Name));
+        return std::static_pointer_cast<Ext>(tryGet(slotOf<Ext>()));
     }
 
     template<typename Ext>
     std::shared_ptr<const Ext>
     tryGet() const {
         STATIC_ASSERT_EXTENSION(Ext);
-        return std::static_pointer_cast<const Ext>(tryGet(Ext::Name));
+        return std::static_pointer_cast<const Ext>(tryGet(slotOf<Ext>()));
     }
 
     bool has(const std::string& name) const;
@@ -87,17 +98,28 @@ public:
 
     std::vector<std::shared_ptr<Extension>> list() const;
 
+    /** Slot index of the extension with the given name, allocated on first
+        use.  Thread safe. */
+    static unsigned slot(const std::string& name);
+
+    /** Slot index of the extension with the given name, or -1 if no
+        extension of that name was ever seen. */
+    static int findSlot(const std::string& name);
+
 private:
-    std::shared_ptr<Extension> get(const std::string& name);
-    std::shared_ptr<const Extension> get(const std::string& name) const;
+    template<typename Ext>
+    static unsigned slotOf() {
+        static const unsigned index = slot(Ext::Name);
+        return index;
+    }
 
-    std::shared_ptr<Extension> tryGet(const std::string& name);
-    std::shared_ptr<const Extension> tryGet(const std::string& name) const;
+    std::shared_ptr<Extension> get(unsigned slot, const char* name) const;
 
-    std::pair<bool, std::shared_ptr<Extension>>
-    getImpl(const std::string& name) const;
+    std::shared_ptr<Extension> tryGet(unsigned slot) const {
+        return slot < data.size() ? data[slot] : nullptr;
+    }
 
-    std::unordered_map<std::string, std::shared_ptr<Extension>> data;
+    std::vector<std::shared_ptr<Extension>> data;
 };
 
 struct ExtensionRegistry {
@@ -105,6 +127,7 @@ struct ExtensionRegistry {
     static void
     registerFactory() {
         STATIC_ASSERT_EXTENSION(Ext);
+        ExtensionPool::slot(Ext::Name);
         PluginInterface<Extension>::registerPlugin(Ext::Name,
             []() {
                 return std::unique_ptr<Extension>(new Ext);
@@ -10,6 +10,12 @@
 #include "rtbkit/core/router/router_types.h"
 #include "jml/utils/compact_vector.h"
 #include "jml/arch/bitops.h"
+#include "jml/arch/arch.h"
+
+#if JML_INTEL_ISA
+#  include "jml/arch/simd.h"
+#  include <emmintrin.h>
+#endif
 
 #include <vector>
 #include <string>
@@ -46,6 +52,12 @@ struct ConfigSet
     typedef uint64_t Word;
     static constexpr size_t Div = sizeof(Word) * 8;
 
+    /** Number of words stored inline before the bitfield goes to the heap.
+        Sized so that copying a set of up to 2048 configs (the const
+        operators do one per call) doesn't allocate.
+    */
+    static constexpr size_t InlineWords = 32;
+
     explicit ConfigSet(bool defaultValue = false) :
         defaultValue(defaultValue ? ~Word(0) : 0)
     {}
@@ -94,6 +106,11 @@ struct ConfigSet
 
     size_t count() const
     {
+#if JML_INTEL_ISA
+        static const bool hasPopcnt = ML::has_popcnt();
+        if (hasPopcnt) return countPopcnt(words(), bitfield.size());
+#endif
+
         size_t total = 0;
 
         for (size_t i = 0; i < bitfield.size(); ++i) {
@@ -114,23 +131,44 @@ struct ConfigSet
         return true;
     }
 
-#define RTBKIT_CONFIG_SET_OP(_op_)                                      \
+    // Processes two words at a time with SSE2 which is always available on
+    // x86_64; the remaining word, if any, is done the old fashioned way.
+#if JML_INTEL_ISA
+#  define RTBKIT_CONFIG_SET_SIMD(_simd_, _dst_, _src_, _i_, _n_)       \
+    for (; _i_ + 2 <= _n_; _i_ += 2) {                                  \
+        __m128i a = _mm_loadu_si128((const __m128i*) (_dst_ + _i_));    \
+        __m128i b = _mm_loadu_si128((const __m128i*) (_src_ + _i_));    \
+        _mm_storeu_si128((__m128i*) (_dst_ + _i_), _simd_(a, b));       \
+    }
+#else
+#  define RTBKIT_CONFIG_SET_SIMD(_simd_, _dst_, _src_, _i_, _n_)
+#endif
+
+#define RTBKIT_CONFIG_SET_OP(_op_, _simd_)                              \
     ConfigSet& operator _op_ (const ConfigSet& other)                   \
     {                                                                   \
         expand(other.size());                                           \
                                                                         \
-        for (size_t i = 0; i < other.bitfield.size(); ++i)              \
-            bitfield[i] _op_ other.bitfield[i];                         \
+        Word* dst = words();                                            \
+        const Word* src = other.words();                                \
+        size_t n = other.bitfield.size();                               \
+                                                                        \
+        size_t i = 0;                                                   \
+        RTBKIT_CONFIG_SET_SIMD(_simd_, dst, src, i, n)                  \
+        for (; i < n; ++i)                                              \
+            dst[i] _op_ src[i];                                         \
                                                                         \
-        for (size_t i = other.bitfield.size(); i < bitfield.size(); ++i) \
-            bitfield[i] _op_ other.defaultValue;                        \
+        for (i = n; i < bitfield.size(); ++i)                           \
+            dst[i] _op_ other.defaultValue;                             \
                                                                         \
         return *this;                                                   \
     }
 
-    RTBKIT_CONFIG_SET_OP(&=)
-    RTBKIT_CONFIG_SET_OP(|=)
-    RTBKIT_CONFIG_SET_OP(^=)
+    RTBKIT_CONFIG_SET_OP(&=, _mm_and_si128)
+    RTBKIT_CONFIG_SET_OP(|=, _mm_or_si128)
+    RTBKIT_CONFIG_SET_OP(^=, _mm_xor_si128)
+
+#undef RTBKIT_CONFIG_SET_SIMD
 
 #undef RTBKIT_CONFIG_SET_OP
 
@@ -203,7 +241,28 @@ struct ConfigSet
     }
 
 private:
-    ML::compact_vector<Word, 8> bitfield;
+
+    Word* words() { return bitfield.empty() ? nullptr : &bitfield[0]; }
+    const Word* words() const
+    {
+        return bitfield.empty() ? nullptr : &bitfield[0];
+    }
+
+#if JML_INTEL_ISA
+    /** The builtin is a table lookup unless the popcnt instruction is
+        enabled so we compile a version that uses it and pick it at runtime.
+    */
+    __attribute__((target("popcnt")))
+    static size_t countPopcnt(const Word* words, size_t n)
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i)
+            total += __builtin_popcountll(words[i]);
+        return total;
+    }
+#endif
+
+    ML::compact_vector<Word, InlineWords> bitfield;
     Word defaultValue;
 };
 
@@ -485,6 +544,37 @@ struct FilterBase
      */
     virtual void filter(FilterState& state) const = 0;
 
+    /** Filters a batch of bid requests, one state per request. The default
+        calls filter() on each state in turn. Filters that can share work
+        between requests, like a lookup keyed on a field that most requests
+        of a batch have in common, should override it.
+
+        Follows the same threading rules as filter().
+     */
+    virtual void filterBatch(const std::vector<FilterState*>& states) const
+    {
+        for (FilterState* state : states) filter(*state);
+    }
+
+
+    /** Indicates that the outcome of the filter only depends on the bid
+        request fields hashed by hashRequest() and that the filter only
+        narrows the configs (no creatives or filter reasons). FilterPool can
+        then cache the combined result of these filters.
+     */
+    virtual bool isRequestStatic() const { return false; }
+
+    /** Hash of the bid request fields that the outcome of the filter depends
+        on. Only called if isRequestStatic() returns true.
+     */
+    virtual uint64_t hashRequest(const FilterState& state) const { return 0; }
+
+    /** Indicates that the outcome of the filter only depends on the exchange
+        and the url of the bid request, which can be scanned out of the raw
+        payload before it's parsed (see FilterPool::preParseMatches).
+     */
+    virtual bool isPreParse() const { return false; }
+
 
     /** Indicates that a new config is available and that it is associated with
         the given index. The configIndex should be used to manipulate the
@@ -0,0 +1,76 @@
+/* interned_key.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Small integer handles for the strings used as keys in bid requests.
+*/
+
+#include "interned_key.h"
+#include "jml/arch/exception.h"
+#include <mutex>
+
+
+using namespace std;
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* INTERN TABLE                                                              */
+/*****************************************************************************/
+
+InternedKey
+InternTable::
+intern(const std::string & key)
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    auto it = handles.find(key);
+    if (it != handles.end()) return it->second;
+
+    if (keys.size() >= NoKey)
+        throw ML::Exception("too many interned keys");
+
+    InternedKey handle = keys.size();
+    keys.emplace_back(new std::string(key));
+    handles[key] = handle;
+    return handle;
+}
+
+InternedKey
+InternTable::
+lookup(const std::string & key) const
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    auto it = handles.find(key);
+    return it == handles.end() ? InternedKey(NoKey) : it->second;
+}
+
+const std::string &
+InternTable::
+str(InternedKey handle) const
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    if (handle >= keys.size())
+        throw ML::Exception("unknown interned key %u", handle);
+    return *keys[handle];
+}
+
+size_t
+InternTable::
+size() const
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+    return keys.size();
+}
+
+InternTable &
+requestKeys()
+{
+    static InternTable table;
+    return table;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,62 @@
+/* interned_key.h                                                  -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Small integer handles for the strings used as keys in bid requests.
+*/
+
+#pragma once
+
+#include "jml/arch/spinlock.h"
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* INTERNED KEY                                                              */
+/*****************************************************************************/
+
+/** Handle for an interned string. Handles are dense and never reused so two
+    keys are equal if and only if their handles are equal.
+*/
+typedef uint32_t InternedKey;
+
+/** Set of interned strings. Handles are handed out in order of interning and
+    stay valid for the lifetime of the table.
+
+    All the operations are thread safe.
+*/
+struct InternTable {
+
+    enum { NoKey = uint32_t(-1) };
+
+    /** Returns the handle of the key, interning it if it wasn't already. */
+    InternedKey intern(const std::string & key);
+
+    /** Returns the handle of the key or NoKey if it was never interned. */
+    InternedKey lookup(const std::string & key) const;
+
+    /** Returns the key that was interned with the given handle. */
+    const std::string & str(InternedKey handle) const;
+
+    size_t size() const;
+
+private:
+    mutable ML::Spinlock lock;
+    std::unordered_map<std::string, InternedKey> handles;
+
+    // Individual allocations so that the references returned by str() stay
+    // valid when the vector grows.
+    std::vector<std::unique_ptr<std::string> > keys;
+};
+
+/** Table used for the segment sources and the user id domains. */
+InternTable & requestKeys();
+
+} // namespace RTBKIT
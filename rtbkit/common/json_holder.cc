@@ -43,20 +43,48 @@ JsonHolder::
 makeString() const
 {
     if (!str.empty()) return;
-    if (!parsed) return;
-    if (parsed->isNull()) return;
-    str = parsed->toString();
+    auto current = std::atomic_load(&parsed);
+    if (!current) return;
+    if (current->isNull()) return;
+    str = current->toString();
     boost::trim(str);
 }
 
-void
+const Json::Value &
 JsonHolder::
 makeJson() const
 {
-    if (parsed) return;
+    std::shared_ptr<const Json::Value> result;
     if (str.empty())
-        parsed.reset(new Json::Value());
-    else parsed.reset(new Json::Value(Json::parse(str)));
+        result.reset(new Json::Value());
+    else result.reset(new Json::Value(Json::parse(str)));
+
+    // If another thread got there first, keep its value and drop ours
+    std::shared_ptr<const Json::Value> current;
+    if (std::atomic_compare_exchange_strong(&parsed, &current, result))
+        return *result;
+    return *current;
+}
+
+void
+JsonHolder::
+parseTyped(void * val, const Datacratic::ValueDescription & desc) const
+{
+    using namespace Datacratic;
+
+    // Null stays as the default constructed value
+    if (!isNonNull()) return;
+
+    auto current = std::atomic_load(&parsed);
+    if (current) {
+        StructuredJsonParsingContext context(*current);
+        desc.parseJson(val, context);
+    }
+    else {
+        StreamingJsonParsingContext context(str, str.c_str(),
+                                            str.c_str() + str.size());
+        desc.parseJson(val, context);
+    }
 }
 
 const std::string JsonHolder::nullStr("null");
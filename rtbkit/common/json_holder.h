@@ -12,7 +12,9 @@
 #include "soa/types/basic_value_descriptions.h"
 #include "jml/db/persistent_fwd.h"
 #include "jml/utils/unnamed_bool.h"
+#include <atomic>
 #include <memory>
+#include <typeinfo>
 
 
 namespace RTBKIT {
@@ -25,6 +27,12 @@ struct JsonHolderDescription;
 
 /** Read-only access to JSON data.  Much more efficient than using a
     Json::Value.
+
+    The structured forms (toJson() and as<T>()) are parsed the first time
+    they are asked for and kept, so a payload that several consumers look at
+    is parsed at most once.  They can be asked for from several threads at
+    once; the parsed values are published atomically.  Assigning to or
+    clearing the holder is not thread safe.
 */
 
 struct JsonHolder {
@@ -47,10 +55,30 @@ struct JsonHolder {
     {
     }
 
+    JsonHolder(const JsonHolder & other)
+        : str(other.str),
+          parsed(std::atomic_load(&other.parsed)),
+          typed(std::atomic_load(&other.typed))
+    {
+    }
+
+    JsonHolder(JsonHolder && other) = default;
+
     ~JsonHolder()
     {
     }
 
+    JsonHolder & operator = (const JsonHolder & other)
+    {
+        if (this == &other) return *this;
+        str = other.str;
+        parsed = std::atomic_load(&other.parsed);
+        typed = std::atomic_load(&other.typed);
+        return *this;
+    }
+
+    JsonHolder & operator = (JsonHolder && other) = default;
+
     JsonHolder & operator = (Json::Value && val)
     {
         clear();
@@ -76,26 +104,54 @@ struct JsonHolder {
     {
         str.clear();
         parsed.reset();
+        typed.reset();
     }
 
     static const std::string nullStr;
     
     const std::string & toString() const
     {
-        if (!parsed) {
+        auto current = std::atomic_load(&parsed);
+        if (!current) {
             if (str.empty()) return nullStr;
             return str;
         }
-        if (parsed->isNull()) return nullStr;
+        if (current->isNull()) return nullStr;
         makeString();
         return str;
     }
 
     const Json::Value & toJson() const
     {
-        if (parsed) return *parsed;
-        makeJson();
-        return *parsed;
+        auto current = std::atomic_load(&parsed);
+        if (current) return *current;
+        return makeJson();
+    }
+
+    /** The data parsed into a T with T's default value description.  It's
+        parsed straight from the string, without going through a Json::Value
+        unless one is already held; null gives a default constructed T.  The
+        reference stays valid until the holder is assigned to or cleared.
+    */
+    template<typename T>
+    const T & as() const
+    {
+        std::shared_ptr<const TypedBase> head = std::atomic_load(&typed);
+        if (const T * found = findTyped<T>(head.get()))
+            return *found;
+
+        auto entry = std::make_shared<Typed<T> >();
+        parseTyped(&entry->value, *Datacratic::getDefaultDescriptionShared<T>());
+
+        // Push it onto the list, unless another thread published one first
+        std::shared_ptr<const TypedBase> published = entry;
+        for (;;) {
+            entry->next = head;
+            if (std::atomic_compare_exchange_weak(&typed, &head, published))
+                return entry->value;
+            if (const T * found = findTyped<T>(head.get()))
+                return *found;
+        }
     }
 
     void serialize(ML::DB::Store_Writer & store) const;
@@ -103,7 +159,8 @@ struct JsonHolder {
     
     bool isNonNull() const
     {
-        if (parsed) return !parsed->isNull();
+        auto current = std::atomic_load(&parsed);
+        if (current) return !current->isNull();
         return !str.empty() && str != "null";
     }
 
@@ -120,9 +177,36 @@ struct JsonHolder {
 
 private:    
     void makeString() const;
-    void makeJson() const;
+    const Json::Value & makeJson() const;
+
+    /** Values parsed by as<T>(), one per type, in a list that is only ever
+        pushed onto. */
+    struct TypedBase {
+        virtual ~TypedBase() {}
+        virtual const std::type_info & type() const = 0;
+        std::shared_ptr<const TypedBase> next;
+    };
+
+    template<typename T>
+    struct Typed : public TypedBase {
+        virtual const std::type_info & type() const { return typeid(T); }
+        T value;
+    };
+
+    template<typename T>
+    static const T * findTyped(const TypedBase * entry)
+    {
+        for (;  entry;  entry = entry->next.get())
+            if (entry->type() == typeid(T))
+                return &static_cast<const Typed<T> *>(entry)->value;
+        return nullptr;
+    }
+
+    void parseTyped(void * val,
+                    const Datacratic::ValueDescription & desc) const;
 
     mutable std::shared_ptr<const Json::Value> parsed;
+    mutable std::shared_ptr<const TypedBase> typed;
 };
 
 IMPL_SERIALIZE_RECONSTITUTE(JsonHolder);
@@ -0,0 +1,71 @@
+/* mem_usage.h                                                     -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Rough accounting of the memory held by the big data structures of the
+   router and the post auction loop.
+*/
+
+#pragma once
+
+#include "soa/types/string.h"
+#include <string>
+#include <stddef.h>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* MEMORY USAGE                                                              */
+/*****************************************************************************/
+
+/* The memUsage() methods of the various structures return an estimate of
+   the bytes that an instance holds, itself included.  They only count what
+   usually matters (the strings and containers that grow with the traffic)
+   and are meant to tell the subsystems apart and to spot leaks, not to add
+   up to the resident size of the process.
+*/
+
+/** Bytes of a string kept outside of the object; short strings are stored
+    inline.
+*/
+inline size_t heapBytes(const std::string & str)
+{
+    return str.capacity() > 15 ? str.capacity() + 1 : 0;
+}
+
+inline size_t heapBytes(const Datacratic::UnicodeString & str)
+{
+    return heapBytes(str.rawString());
+}
+
+/** Estimates the memory held by the entries of a big container from a
+    sample of them, so that it stays cheap to publish periodically.
+*/
+struct MemUsageSample {
+
+    enum { DefaultSamples = 64 };
+
+    MemUsageSample()
+        : bytes(0), samples(0)
+    {
+    }
+
+    void add(size_t entryBytes)
+    {
+        bytes += entryBytes;
+        ++samples;
+    }
+
+    /** Average of the samples times the number of entries. */
+    size_t estimate(size_t numEntries) const
+    {
+        return samples ? bytes * numEntries / samples : 0;
+    }
+
+    size_t bytes;
+    size_t samples;
+};
+
+} // namespace RTBKIT
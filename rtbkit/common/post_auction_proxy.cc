@@ -16,6 +16,48 @@ using namespace Datacratic;
 
 namespace RTBKIT {
 
+/******************************************************************************/
+/* IN PROCESS POST AUCTION                                                    */
+/******************************************************************************/
+
+namespace {
+
+std::shared_ptr<const InProcessPostAuction>
+inProcessShards[InProcessPostAuction::MaxShards];
+
+} // file scope
+
+void
+InProcessPostAuction::
+add(size_t shard, std::shared_ptr<const InProcessPostAuction> local)
+{
+    ExcCheckLess(shard, size_t(MaxShards), "too many in process shards");
+    std::atomic_store(&inProcessShards[shard], std::move(local));
+}
+
+void
+InProcessPostAuction::
+remove(size_t shard, const InProcessPostAuction * local)
+{
+    if (shard >= MaxShards) return;
+
+    auto current = std::atomic_load(&inProcessShards[shard]);
+    if (current.get() != local) return;
+
+    std::atomic_compare_exchange_strong(
+            &inProcessShards[shard], &current,
+            std::shared_ptr<const InProcessPostAuction>());
+}
+
+std::shared_ptr<const InProcessPostAuction>
+InProcessPostAuction::
+get(size_t shard)
+{
+    if (shard >= MaxShards) return nullptr;
+    return std::atomic_load(&inProcessShards[shard]);
+}
+
+
 /******************************************************************************/
 /* POST AUCTION PROXY                                                         */
 /******************************************************************************/
@@ -23,13 +65,15 @@ namespace RTBKIT {
 PostAuctionProxy::
 PostAuctionProxy(ServiceBase& parent) :
     parent(&parent),
-    proxies(parent.getServices())
+    proxies(parent.getServices()),
+    shards(1), inProcess(true), batchSize(1), batchMs(1.0)
 {}
 
 PostAuctionProxy::
 PostAuctionProxy(std::shared_ptr<Datacratic::ServiceProxies> proxies) :
     parent(nullptr),
-    proxies(proxies)
+    proxies(proxies),
+    shards(1), inProcess(true), batchSize(1), batchMs(1.0)
 {}
 
 void
@@ -46,9 +90,17 @@ PostAuctionProxy::
 initZMQ()
 {
     shards = proxies->params.get("postAuctionShards", 1).asInt();
+    inProcess = proxies->params.get("postAuctionInProcess", true).asBool();
+
+    batchSize = proxies->params.get("postAuctionBatchSize", 1).asInt();
+    batchMs = proxies->params.get("postAuctionBatchMs", 1.0).asDouble();
+    ExcCheckGreater(batchSize, 0, "invalid postAuctionBatchSize");
+    batches.resize(shards);
 
     zmq.reset(new Datacratic::ZmqMultipleNamedClientBusProxy);
     zmq->init(proxies->config);
+    // The auction shards send their events without waiting on each other
+    zmq->enableSocketPerThread();
     zmq->connectAllServiceProviders("rtbPostAuctionService", "events");
 }
 
@@ -92,9 +144,84 @@ sendAuction(std::shared_ptr<SubmittedAuctionEvent> event)
     size_t shard = event->auctionId.hash() % shards;
 
     if (!zmq) http[shard]->forwardAuction(event);
+    else if (auto local = getInProcess(shard)) local->onAuction(event);
     else {
         string str = ML::DB::serializeToString(*event);
-        (void) zmq->sendMessageToShard(shard, "AUCTION", move(str));
+        if (batchSize > 1) queueAuction(shard, move(str));
+        else (void) zmq->sendMessageToShard(shard, "AUCTION", move(str));
+    }
+}
+
+std::shared_ptr<const InProcessPostAuction>
+PostAuctionProxy::
+getInProcess(size_t shard) const
+{
+    if (!inProcess) return nullptr;
+    return InProcessPostAuction::get(shard);
+}
+
+void
+PostAuctionProxy::
+queueAuction(size_t shard, std::string && str)
+{
+    Batch toSend;
+
+    {
+        std::lock_guard<ML::Spinlock> guard(batchLock);
+
+        Batch & batch = batches[shard];
+        if (batch.auctions.empty()) batch.start = Date::now();
+        batch.auctions.push_back(move(str));
+
+        if (batch.auctions.size() < batchSize) return;
+        std::swap(toSend, batch);
+    }
+
+    sendBatch(shard, toSend);
+}
+
+void
+PostAuctionProxy::
+flush(bool force)
+{
+    if (batchSize <= 1) return;
+
+    Date now = Date::now();
+
+    for (size_t shard = 0; shard < batches.size(); ++shard) {
+        Batch toSend;
+
+        {
+            std::lock_guard<ML::Spinlock> guard(batchLock);
+
+            Batch & batch = batches[shard];
+            if (batch.auctions.empty()) continue;
+            if (!force && now.secondsSince(batch.start) * 1000.0 < batchMs)
+                continue;
+
+            std::swap(toSend, batch);
+        }
+
+        sendBatch(shard, toSend);
+    }
+}
+
+void
+PostAuctionProxy::
+sendBatch(size_t shard, const Batch & batch)
+{
+    std::ostringstream stream;
+    ML::DB::Store_Writer store(stream);
+    store << ML::DB::compact_size_t(batch.auctions.size());
+    for (const auto & str : batch.auctions)
+        store << str;
+
+    (void) zmq->sendMessageToShard(shard, "AUCTIONS", stream.str());
+
+    if (parent) {
+        parent->recordOutcome(batch.auctions.size(), "postAuctionBatch.size");
+        parent->recordOutcome(Date::now().secondsSince(batch.start) * 1000.0,
+                              "postAuctionBatch.latencyMs");
     }
 }
 
@@ -105,6 +232,7 @@ sendEvent(std::shared_ptr<PostAuctionEvent> event)
     size_t shard = event->auctionId.hash() % shards;
 
     if (!zmq) http[shard]->forwardEvent(event);
+    else if (auto local = getInProcess(shard)) local->onEvent(event);
     else {
         string str = ML::DB::serializeToString(*event);
         (void) zmq->sendMessageToShard(shard, print(event->type), str);
@@ -9,6 +9,10 @@
 #pragma once
 
 #include "rtbkit/common/auction_events.h"
+#include "jml/arch/spinlock.h"
+
+#include <functional>
+#include <memory>
 
 namespace Datacratic {
 
@@ -21,6 +25,34 @@ namespace RTBKIT {
 
 struct EventForwarder;
 
+
+/******************************************************************************/
+/* IN PROCESS POST AUCTION                                                    */
+/******************************************************************************/
+
+/** Post auction shard that runs in the same process as the proxies that send
+    it events. The proxies hand it their events as is instead of serializing
+    them over zmq.
+ */
+struct InProcessPostAuction
+{
+    std::function<void (std::shared_ptr<SubmittedAuctionEvent>)> onAuction;
+    std::function<void (std::shared_ptr<PostAuctionEvent>)> onEvent;
+
+    enum { MaxShards = 64 };
+
+    /** Makes the shard reachable by the proxies of the process until it's
+        removed. */
+    static void add(size_t shard,
+                    std::shared_ptr<const InProcessPostAuction> local);
+
+    /** Removes the shard if it's still the given one. */
+    static void remove(size_t shard, const InProcessPostAuction * local);
+
+    /** Returns the shard if it runs in this process; null otherwise. */
+    static std::shared_ptr<const InProcessPostAuction> get(size_t shard);
+};
+
 /******************************************************************************/
 /* POST AUCTION PROXY                                                         */
 /******************************************************************************/
@@ -28,9 +60,18 @@ struct EventForwarder;
 /** Event submission proxy for the post auction loop. Takes care of directing
     messages to the correct post auction shard.
 
+    Shards that run in the same process are sent the events directly (see
+    InProcessPostAuction) unless the postAuctionInProcess configuration
+    parameter is false.
+
     Requires that the postAuctionShard configuration parameter be provided in
     the bootstrap.json to determine the number of active post auction shards. If
     not present, assumes that there's only one active post auction shard.
+
+    When postAuctionBatchSize is greater than 1, auctions sent over zmq are
+    coalesced per shard into a single AUCTIONS message once that many are
+    queued or the oldest one has been waiting for postAuctionBatchMs
+    (default 1ms). The owner must call flush() regularly for the latter.
  */
 struct PostAuctionProxy
 {
@@ -48,16 +89,36 @@ struct PostAuctionProxy
     // Sends an event to the post auction loop.
     void sendEvent(std::shared_ptr<PostAuctionEvent> event);
 
+    // Sends the batches of auctions that are due or all of them if force.
+    void flush(bool force = false);
+
 private:
     void initZMQ();
     void initHTTP();
 
+    struct Batch
+    {
+        Datacratic::Date start;
+        std::vector<std::string> auctions;
+    };
+
+    std::shared_ptr<const InProcessPostAuction> getInProcess(size_t shard) const;
+
+    void queueAuction(size_t shard, std::string && str);
+    void sendBatch(size_t shard, const Batch & batch);
+
     Datacratic::ServiceBase* parent;
     std::shared_ptr<Datacratic::ServiceProxies> proxies;
 
     size_t shards;
+    bool inProcess;
     std::unique_ptr<Datacratic::ZmqMultipleNamedClientBusProxy> zmq;
     std::vector< std::shared_ptr<EventForwarder> > http;
+
+    size_t batchSize;
+    double batchMs;
+    ML::Spinlock batchLock;
+    std::vector<Batch> batches;
 };
 
 } // namespace RTBKIT
@@ -0,0 +1,254 @@
+/* roaring_bitmap.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Compressed bitmap of integers for the large segment lists.
+*/
+
+#include "rtbkit/common/roaring_bitmap.h"
+#include "jml/arch/arch.h"
+#include "jml/arch/exception.h"
+#include <algorithm>
+
+#if JML_INTEL_ISA
+#  include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+namespace RTBKIT {
+
+namespace {
+
+enum { BitmapWords = (1 << 16) / 64 };
+
+bool testBit(const vector<uint64_t> & bits, uint16_t low)
+{
+    return (bits[low / 64] >> (low % 64)) & 1;
+}
+
+/** Looks up each of the values of the small array in the large one. */
+bool anyLookup(const vector<uint16_t> & small, const vector<uint16_t> & large)
+{
+    auto first = large.begin(), last = large.end();
+    for (uint16_t value: small) {
+        first = std::lower_bound(first, last, value);
+        if (first == last) return false;
+        if (*first == value) return true;
+    }
+    return false;
+}
+
+#if JML_INTEL_ISA
+
+/** Block of 8 values rotated by N values. */
+template<int N>
+__m128i rotate(__m128i x)
+{
+    return _mm_or_si128(_mm_srli_si128(x, 2 * N), _mm_slli_si128(x, 16 - 2 * N));
+}
+
+/** Whether any of the 8 values of a is equal to any of the 8 of b. */
+bool anyEqual(__m128i a, __m128i b)
+{
+    __m128i eq = _mm_cmpeq_epi16(a, b);
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(a, rotate<1>(b)));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(a, rotate<2>(b)));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(a, rotate<3>(b)));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(a, rotate<4>(b)));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(a, rotate<5>(b)));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(a, rotate<6>(b)));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(a, rotate<7>(b)));
+    return _mm_movemask_epi8(eq) != 0;
+}
+
+#endif
+
+/** Merges two sorted arrays of similar sizes, 8 values against 8 at a time:
+    all the values of a block are compared against all of those of the other
+    before moving on from the block with the smallest last value.
+*/
+bool anyMerge(const vector<uint16_t> & a, const vector<uint16_t> & b)
+{
+    size_t i = 0, j = 0;
+    const size_t na = a.size(), nb = b.size();
+
+#if JML_INTEL_ISA
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(&a[i]));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(&b[j]));
+        if (anyEqual(va, vb)) return true;
+
+        uint16_t lastA = a[i + 7], lastB = b[j + 7];
+        if (lastA <= lastB) i += 8;
+        if (lastB <= lastA) j += 8;
+    }
+#endif
+
+    while (i < na && j < nb) {
+        if (a[i] == b[j]) return true;
+        else if (a[i] < b[j]) ++i;
+        else ++j;
+    }
+
+    return false;
+}
+
+bool anyBitmaps(const vector<uint64_t> & a, const vector<uint64_t> & b)
+{
+#if JML_INTEL_ISA
+    const __m128i * pa = (const __m128i *)a.data();
+    const __m128i * pb = (const __m128i *)b.data();
+    const __m128i zero = _mm_setzero_si128();
+
+    // Checked every 8 vectors, which is the 1024 values of two cache lines
+    for (size_t i = 0;  i < BitmapWords / 2;  i += 8) {
+        __m128i any = _mm_setzero_si128();
+        for (size_t k = 0;  k < 8;  ++k)
+            any = _mm_or_si128(any, _mm_and_si128(_mm_loadu_si128(pa + i + k),
+                                                  _mm_loadu_si128(pb + i + k)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) != 0xffff)
+            return true;
+    }
+    return false;
+#else
+    for (size_t i = 0;  i < BitmapWords;  ++i)
+        if (a[i] & b[i]) return true;
+    return false;
+#endif
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* ROARING BITMAP                                                            */
+/*****************************************************************************/
+
+bool
+RoaringBitmap::Container::
+contains(uint16_t low) const
+{
+    if (isBitmap())
+        return testBit(bits, low);
+    return std::binary_search(values.begin(), values.end(), low);
+}
+
+bool
+RoaringBitmap::Container::
+intersects(const Container & other) const
+{
+    if (isBitmap() && other.isBitmap())
+        return anyBitmaps(bits, other.bits);
+
+    if (isBitmap() || other.isBitmap()) {
+        const Container & bitmap = isBitmap() ? *this : other;
+        const Container & array = isBitmap() ? other : *this;
+        for (uint16_t value: array.values)
+            if (testBit(bitmap.bits, value)) return true;
+        return false;
+    }
+
+    // Way off in size, the merge would mostly skip over the large one
+    if (values.size() * 16 < other.values.size())
+        return anyLookup(values, other.values);
+    if (other.values.size() * 16 < values.size())
+        return anyLookup(other.values, values);
+    return anyMerge(values, other.values);
+}
+
+void
+RoaringBitmap::
+append(int value)
+{
+    uint32_t u = toUnsigned(value);
+    uint16_t key = u >> 16, low = u & 0xffff;
+
+    if (containers.empty() || containers.back().key != key) {
+        if (!containers.empty() && containers.back().key > key)
+            throw ML::Exception("roaring bitmap values must be sorted");
+        containers.emplace_back(key);
+    }
+
+    Container & container = containers.back();
+
+    if (container.isBitmap()) {
+        uint64_t & word = container.bits[low / 64];
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if (!(word & bit)) ++count;
+        word |= bit;
+        return;
+    }
+
+    if (!container.values.empty() && container.values.back() >= low) {
+        if (container.values.back() == low) return;
+        throw ML::Exception("roaring bitmap values must be sorted");
+    }
+
+    container.values.push_back(low);
+    ++count;
+
+    if (container.values.size() > ArrayMax) {
+        container.bits.resize(BitmapWords, 0);
+        for (uint16_t v: container.values)
+            container.bits[v / 64] |= uint64_t(1) << (v % 64);
+        vector<uint16_t>().swap(container.values);
+    }
+}
+
+const RoaringBitmap::Container *
+RoaringBitmap::
+find(uint16_t key) const
+{
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [] (const Container & c, uint16_t key)
+                               {
+                                   return c.key < key;
+                               });
+    if (it == containers.end() || it->key != key)
+        return nullptr;
+    return &*it;
+}
+
+bool
+RoaringBitmap::
+contains(int value) const
+{
+    uint32_t u = toUnsigned(value);
+    const Container * container = find(u >> 16);
+    return container && container->contains(u & 0xffff);
+}
+
+bool
+RoaringBitmap::
+intersects(const RoaringBitmap & other) const
+{
+    auto it1 = containers.begin(), end1 = containers.end();
+    auto it2 = other.containers.begin(), end2 = other.containers.end();
+
+    while (it1 != end1 && it2 != end2) {
+        if (it1->key < it2->key) ++it1;
+        else if (it2->key < it1->key) ++it2;
+        else {
+            if (it1->intersects(*it2)) return true;
+            ++it1;
+            ++it2;
+        }
+    }
+
+    return false;
+}
+
+size_t
+RoaringBitmap::
+memUsage() const
+{
+    size_t result = sizeof(*this) + containers.capacity() * sizeof(Container);
+    for (const Container & container: containers)
+        result += container.values.capacity() * sizeof(uint16_t)
+            + container.bits.capacity() * sizeof(uint64_t);
+    return result;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,90 @@
+/* roaring_bitmap.h                                                -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Compressed bitmap of integers for the large segment lists.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* ROARING BITMAP                                                            */
+/*****************************************************************************/
+
+/** Set of ints split in chunks of 2^16 values that share their high bits.
+    Each chunk is stored either as a sorted array of the low bits when it
+    holds up to ArrayMax values, or as a plain bitmap of 2^16 bits when it
+    holds more.  That keeps sparse sets about as small as a sorted vector
+    while dense sets cost one bit per possible value.
+
+    Testing whether two sets have a value in common goes chunk by chunk:
+    bitmaps are and'ed 128 bits at a time, arrays are compared 8 values
+    against 8, and an array against a bitmap is a bit test per value.
+
+    Built once from a sorted list and immutable after that.
+*/
+
+struct RoaringBitmap {
+
+    enum { ArrayMax = 4096 };
+
+    RoaringBitmap() {}
+
+    /** Builds the set out of a sorted list of ints. */
+    template<typename It>
+    RoaringBitmap(It first, It last)
+    {
+        for (;  first != last;  ++first)
+            append(*first);
+    }
+
+    bool contains(int value) const;
+
+    /** Whether the two sets have at least one value in common. */
+    bool intersects(const RoaringBitmap & other) const;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    /** Bytes taken by the containers. */
+    size_t memUsage() const;
+
+private:
+    /** Values are shifted so that the ints sort the same way as their
+        unsigned keys and low bits.
+    */
+    static uint32_t toUnsigned(int value)
+    {
+        return uint32_t(value) ^ 0x80000000U;
+    }
+
+    struct Container {
+        Container(uint16_t key) : key(key) {}
+
+        bool isBitmap() const { return !bits.empty(); }
+        bool contains(uint16_t low) const;
+        bool intersects(const Container & other) const;
+
+        uint16_t key;
+        std::vector<uint16_t> values;  ///< Sorted low bits while an array
+        std::vector<uint64_t> bits;    ///< 1024 words once a bitmap
+    };
+
+    /** Adds a value greater than any already in the set. */
+    void append(int value);
+
+    const Container * find(uint16_t key) const;
+
+    std::vector<Container> containers;  ///< Sorted by key
+    size_t count = 0;
+};
+
+} // namespace RTBKIT
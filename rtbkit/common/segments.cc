@@ -156,6 +156,8 @@ bool
 SegmentList::
 contains(int i) const
 {
+    if (intBitmap)
+        return intBitmap->contains(i);
     return std::binary_search(ints.begin(), ints.end(), i);
 }
 
@@ -183,6 +185,16 @@ weight(const std::string & str) const
 }
 #endif
 
+/** Bitmap of the ints if there are enough of them and they are sorted. */
+template<typename Ints>
+std::shared_ptr<const RoaringBitmap> makeBitmap(const Ints & ints)
+{
+    if (ints.size() < SegmentList::BitmapThreshold
+        || !std::is_sorted(ints.begin(), ints.end()))
+        return nullptr;
+    return std::make_shared<RoaringBitmap>(ints.begin(), ints.end());
+}
+
 template<typename Seq1, typename Seq2>
 bool anyMatchesLookup(const Seq1 & seq1, const Seq2 & seq2)
 {
@@ -221,18 +233,36 @@ bool anyMatches(const Seq1 & seq1, const Seq2 & seq2)
     }
 }
 
+template<typename Seq>
+bool anyMatchesBitmap(const Seq & seq, const RoaringBitmap & bitmap)
+{
+    for (auto it = seq.begin(), end = seq.end();  it != end;  ++it)
+        if (bitmap.contains(*it)) return true;
+    return false;
+}
+
 bool
 SegmentList::
 match(const SegmentList & other) const
 {
-    return anyMatches(ints, other.ints)
-        || anyMatches(strings, other.strings);
+    bool intsMatch;
+    if (intBitmap && other.intBitmap)
+        intsMatch = intBitmap->intersects(*other.intBitmap);
+    else if (intBitmap)
+        intsMatch = anyMatchesBitmap(other.ints, *intBitmap);
+    else if (other.intBitmap)
+        intsMatch = anyMatchesBitmap(ints, *other.intBitmap);
+    else intsMatch = anyMatches(ints, other.ints);
+
+    return intsMatch || anyMatches(strings, other.strings);
 }
 
 bool
 SegmentList::
 match(const std::vector<int> & other) const
 {
+    if (intBitmap)
+        return anyMatchesBitmap(other, *intBitmap);
     return anyMatches(ints, other);
 }
 
@@ -266,6 +296,9 @@ createFromJson(const Json::Value & json)
     if (!json.isArray())
         throw Exception("augment must be an array of augmentations");
 
+    // Segments are nearly always integers
+    result.ints.reserve(json.size());
+
     for (unsigned i = 0;  i < json.size();  ++i) {
         const Json::Value & val = json[i];
         if (val.isArray()) {
@@ -348,6 +381,7 @@ void
 SegmentList::
 add(int i, float weight)
 {
+    intBitmap.reset();
     ints.push_back(i);
     if (weight != 1.0 || !weights.empty()) {
         if (weights.empty())
@@ -424,6 +458,8 @@ sort()
             weights[i + ints.size()] = ssorted[i].second;
         }
     }
+
+    intBitmap = makeBitmap(ints);
 }
 
 void
@@ -443,6 +479,7 @@ reconstitute(ML::DB::Store_Reader & store)
     if (version > 0)
         throw ML::Exception("unknown SegmentList version");
     store >> ints >> strings >> weights;
+    intBitmap = makeBitmap(ints);
 }
 
 std::string
@@ -631,5 +668,54 @@ reconstitute(ML::DB::Store_Reader & store)
     swap(newMe);
 }
 
+
+/*****************************************************************************/
+/* FLAT SEGMENTS BY SOURCE                                                   */
+/*****************************************************************************/
+
+FlatSegmentsBySource::
+FlatSegmentsBySource(const SegmentsBySource & segments)
+{
+    entries.reserve(segments.size());
+
+    auto & keys = requestKeys();
+    for (const auto & entry : segments) {
+        if (!entry.second)
+            throw ML::Exception("invalid segment list in segments");
+        entries.push_back({ keys.intern(entry.first), entry.second.get() });
+    }
+
+    std::sort(entries.begin(), entries.end());
+}
+
+const SegmentList *
+FlatSegmentsBySource::
+find(const std::string & source) const
+{
+    InternedKey key = requestKeys().lookup(source);
+    if (key == InternTable::NoKey) return nullptr;
+    return find(key);
+}
+
+const SegmentList &
+FlatSegmentsBySource::
+get(InternedKey source) const
+{
+    static const SegmentList NONE;
+
+    const SegmentList * segs = find(source);
+    return segs ? *segs : NONE;
+}
+
+const SegmentList &
+FlatSegmentsBySource::
+get(const std::string & source) const
+{
+    static const SegmentList NONE;
+
+    const SegmentList * segs = find(source);
+    return segs ? *segs : NONE;
+}
+
 } // namespace RTBKIT
 
@@ -9,7 +9,10 @@
 #include "soa/jsoncpp/json.h"
 #include "soa/types/value_description.h"
 #include "soa/types/value_description_fwd.h"
+#include "rtbkit/common/interned_key.h"
+#include "rtbkit/common/roaring_bitmap.h"
 #include <boost/shared_ptr.hpp>
+#include <memory>
 #include <map>
 
 
@@ -29,6 +32,12 @@ enum SegmentResult {
 
 /** A set of integral "segments".
     Immutable once created.
+
+    Once sorted, lists of at least BitmapThreshold ints also get a roaring
+    bitmap of them which contains() and match() use instead of the sorted
+    ints, so that matching the thousands of segments of a user against the
+    thousands of an agent doesn't walk through both lists.  The bitmap is
+    shared between the copies of a list and dropped by add().
 */
 
 struct SegmentList {
@@ -67,6 +76,13 @@ struct SegmentList {
 
     static int parseSegmentNum(const std::string & str);
 
+    enum { BitmapThreshold = 256 };
+
+    /** Bitmap of the ints, or null if there are too few of them or the list
+        isn't sorted.
+    */
+    const RoaringBitmap * bitmap() const { return intBitmap.get(); }
+
     /** Return true if there are only integers in the list. */
     bool intsOnly() const { return strings.empty(); }
 
@@ -78,7 +94,8 @@ struct SegmentList {
     ML::compact_vector<int, 7> ints;          ///< Categories
     std::vector<std::string> strings;         ///< Those that aren't an integer
     ML::compact_vector<float, 5> weights;     ///< Weights over ints and strings
-    
+    std::shared_ptr<const RoaringBitmap> intBitmap;  ///< Index over ints
+
     void serialize(ML::DB::Store_Writer & store) const;
     void reconstitute(ML::DB::Store_Reader & store);
     std::string serializeToString() const;
@@ -155,6 +172,68 @@ struct SegmentsBySource
 
 IMPL_SERIALIZE_RECONSTITUTE(SegmentsBySource);
 
+
+/*****************************************************************************/
+/* FLAT SEGMENTS BY SOURCE                                                   */
+/*****************************************************************************/
+
+/** Read-only view of a SegmentsBySource stored as a vector sorted by interned
+    source. Lookups are a scan over contiguous memory instead of a walk down
+    the tree with a string comparison at each node.
+
+    The view doesn't own the segment lists so copying it doesn't touch any
+    reference count; it's only valid as long as the SegmentsBySource it was
+    built from is alive and unmodified.
+*/
+
+struct FlatSegmentsBySource {
+
+    struct Entry {
+        InternedKey source;
+        const SegmentList * segments;
+
+        bool operator < (const Entry & other) const
+        {
+            return source < other.source;
+        }
+    };
+
+    typedef ML::compact_vector<Entry, 8, uint32_t, false> Entries;
+    typedef Entries::const_iterator const_iterator;
+
+    FlatSegmentsBySource() {}
+    explicit FlatSegmentsBySource(const SegmentsBySource & segments);
+
+    /** Returns the segments of the source or null if the source isn't
+        present.
+    */
+    const SegmentList * find(InternedKey source) const
+    {
+        for (const Entry & entry : entries) {
+            if (entry.source >= source)
+                return entry.source == source ? entry.segments : nullptr;
+        }
+        return nullptr;
+    }
+
+    const SegmentList * find(const std::string & source) const;
+
+    /** Same as SegmentsBySource::get(). */
+    const SegmentList & get(InternedKey source) const;
+    const SegmentList & get(const std::string & source) const;
+
+    bool count(InternedKey source) const { return find(source); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+private:
+    Entries entries;
+};
+
 } // namespace RTBKIT
 
 
@@ -0,0 +1,321 @@
+/* tags.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tags used for creative and campaign filtering.
+*/
+
+#include "tags.h"
+#include "jml/arch/exception.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+
+using namespace std;
+
+
+namespace RTBKIT {
+
+namespace {
+
+struct TagTable {
+    mutex lock;
+    unordered_map<string, unsigned> ids;
+    vector<string> names;
+};
+
+TagTable & tagTable()
+{
+    static TagTable table;
+    return table;
+}
+
+void addArray(Tags & tags, const Json::Value & val, const char * field)
+{
+    if (val.isNull()) return;
+    if (!val.isArray())
+        throw ML::Exception("tag filter field '%s' must be an array", field);
+
+    for (const auto & tag: val)
+        tags.add(tag.asString());
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* TAG                                                                       */
+/*****************************************************************************/
+
+std::string
+Tag::
+toString() const
+{
+    string result = scope;
+    if (!key.empty()) {
+        if (!result.empty()) result += ':';
+        result += key;
+    }
+    if (!value.empty()) {
+        if (!result.empty()) result += '=';
+        result += value;
+    }
+    return result;
+}
+
+unsigned
+Tag::
+intern(const std::string & name)
+{
+    TagTable & table = tagTable();
+    lock_guard<mutex> guard(table.lock);
+
+    auto it = table.ids.find(name);
+    if (it != table.ids.end()) return it->second;
+
+    unsigned id = table.names.size();
+    table.names.push_back(name);
+    table.ids[name] = id;
+    return id;
+}
+
+std::string
+Tag::
+name(unsigned id)
+{
+    TagTable & table = tagTable();
+    lock_guard<mutex> guard(table.lock);
+    return table.names.at(id);
+}
+
+
+/*****************************************************************************/
+/* TAGS                                                                      */
+/*****************************************************************************/
+
+Tags::
+Tags(std::initializer_list<std::string> tags)
+{
+    for (const auto & tag: tags)
+        add(tag);
+}
+
+void
+Tags::
+add(unsigned id)
+{
+    size_t word = id / 64;
+    if (word >= active.size())
+        active.resize(word + 1);
+    active[word] |= uint64_t(1) << (id % 64);
+}
+
+bool
+Tags::
+empty() const
+{
+    for (uint64_t word: active)
+        if (word) return false;
+    return true;
+}
+
+bool
+Tags::
+intersects(const Tags & other) const
+{
+    size_t n = std::min(active.size(), other.active.size());
+    for (size_t i = 0;  i < n;  ++i)
+        if (active[i] & other.active[i]) return true;
+    return false;
+}
+
+bool
+Tags::
+containsAll(const Tags & other) const
+{
+    for (size_t i = 0;  i < other.active.size();  ++i) {
+        uint64_t word = i < active.size() ? active[i] : 0;
+        if ((word & other.active[i]) != other.active[i]) return false;
+    }
+    return true;
+}
+
+Json::Value
+Tags::
+toJson() const
+{
+    Json::Value result(Json::arrayValue);
+    for (size_t i = 0;  i < active.size();  ++i) {
+        for (uint64_t word = active[i];  word;  word &= word - 1)
+            result.append(Tag::name(i * 64 + __builtin_ctzll(word)));
+    }
+    return result;
+}
+
+Tags
+Tags::
+fromJson(const Json::Value & val)
+{
+    Tags result;
+    addArray(result, val, "tags");
+    return result;
+}
+
+
+/*****************************************************************************/
+/* TAG FILTER                                                                */
+/*****************************************************************************/
+
+bool
+TagFilter::
+matches(const Tags & tagsToMatch) const
+{
+    if (!mustIncludeOneOf.empty() && !tagsToMatch.intersects(mustIncludeOneOf))
+        return false;
+    if (!tagsToMatch.containsAll(mustIncludeAllOf))
+        return false;
+    return !tagsToMatch.intersects(mustNotIncludeAnyOf);
+}
+
+Json::Value
+TagFilter::
+toJson() const
+{
+    Json::Value result(Json::objectValue);
+    if (!mustIncludeOneOf.empty())
+        result["oneOf"] = mustIncludeOneOf.toJson();
+    if (!mustIncludeAllOf.empty())
+        result["allOf"] = mustIncludeAllOf.toJson();
+    if (!mustNotIncludeAnyOf.empty())
+        result["noneOf"] = mustNotIncludeAnyOf.toJson();
+    return result;
+}
+
+TagFilter
+TagFilter::
+fromJson(const Json::Value & val)
+{
+    if (!val.isObject())
+        throw ML::Exception("tag filter must be an object");
+
+    TagFilter result;
+    for (auto it = val.begin(), end = val.end();  it != end;  ++it) {
+        string name = it.memberName();
+        if (name == "oneOf")
+            addArray(result.mustIncludeOneOf, *it, "oneOf");
+        else if (name == "allOf")
+            addArray(result.mustIncludeAllOf, *it, "allOf");
+        else if (name == "noneOf")
+            addArray(result.mustNotIncludeAnyOf, *it, "noneOf");
+        else throw ML::Exception("unknown tag filter field '%s'", name.c_str());
+    }
+    return result;
+}
+
+
+/*****************************************************************************/
+/* TAG FILTER EXPRESSION                                                     */
+/*****************************************************************************/
+
+/* Each filter is compiled to a header word, holding the number of words n of
+   its masks and whether it has any tag to include one of, followed by the n
+   words of each of its three masks.
+*/
+
+void
+TagFilterExpression::
+compile()
+{
+    program.clear();
+
+    for (const TagFilter & filter: *this) {
+        size_t n = std::max({ filter.mustIncludeOneOf.active.size(),
+                              filter.mustIncludeAllOf.active.size(),
+                              filter.mustNotIncludeAnyOf.active.size() });
+
+        uint64_t header = n;
+        if (!filter.mustIncludeOneOf.empty())
+            header |= uint64_t(1) << 32;
+        program.push_back(header);
+
+        for (const Tags * mask: { &filter.mustIncludeOneOf,
+                                  &filter.mustIncludeAllOf,
+                                  &filter.mustNotIncludeAnyOf }) {
+            program.insert(program.end(),
+                           mask->active.begin(), mask->active.end());
+            program.resize(program.size() + n - mask->active.size());
+        }
+    }
+}
+
+bool
+TagFilterExpression::
+matches(const Tags & tagsToMatch) const
+{
+    if (empty()) return true;
+
+    if (program.empty()) {
+        for (const TagFilter & filter: *this)
+            if (filter.matches(tagsToMatch)) return true;
+        return false;
+    }
+
+    const uint64_t * tags = tagsToMatch.active.data();
+    size_t numTags = tagsToMatch.active.size();
+
+    const uint64_t * pc = program.data();
+    const uint64_t * end = pc + program.size();
+
+    while (pc < end) {
+        size_t n = *pc & 0xffffffff;
+        bool found = !(*pc >> 32);
+        ++pc;
+
+        const uint64_t * oneOf = pc;
+        const uint64_t * allOf = pc + n;
+        const uint64_t * noneOf = pc + 2 * n;
+        pc += 3 * n;
+
+        bool ok = true;
+        for (size_t i = 0;  i < n && ok;  ++i) {
+            uint64_t word = i < numTags ? tags[i] : 0;
+            found |= (word & oneOf[i]) != 0;
+            ok = (word & allOf[i]) == allOf[i] && !(word & noneOf[i]);
+        }
+
+        if (ok && found) return true;
+    }
+
+    return false;
+}
+
+Json::Value
+TagFilterExpression::
+toJson() const
+{
+    Json::Value result(Json::arrayValue);
+    for (const TagFilter & filter: *this)
+        result.append(filter.toJson());
+    return result;
+}
+
+TagFilterExpression
+TagFilterExpression::
+fromJson(const Json::Value & val)
+{
+    TagFilterExpression result;
+
+    if (val.isArray()) {
+        for (const auto & filter: val)
+            result.push_back(TagFilter::fromJson(filter));
+    }
+    else if (!val.isNull())
+        result.push_back(TagFilter::fromJson(val));
+
+    result.compile();
+    return result;
+}
+
+} // namespace RTBKIT
@@ -1,15 +1,22 @@
 /* tags.h                                                          -*- C++ -*-
    Jeremy Barnes, 26 February 2013
-   
+
    Copyright (c) 2013 Datacratic Inc.  All rights reserved.
 
    Definitions of the "tags" class used for creative and campaign filtering.
-   
+
    This file is part of RTBkit.
 */
 
 #pragma once
 
+#include "soa/jsoncpp/value.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
 
 namespace RTBKIT {
 
@@ -24,6 +31,17 @@ struct Tag {
     std::string scope;
     std::string key;
     std::string value;
+
+    /** Name under which the tag is interned: "scope:key=value", without the
+        parts that are empty. */
+    std::string toString() const;
+
+    /** Small integer standing for the tag with the given name; the same for
+        the whole life of the process.  Thread safe. */
+    static unsigned intern(const std::string & name);
+
+    /** Name of the tag with the given interned id. */
+    static std::string name(unsigned id);
 };
 
 
@@ -31,38 +49,40 @@ struct Tag {
 /* TAGS                                                                      */
 /*****************************************************************************/
 
-struct Tags {
+/** Set of tags, stored as a bitset indexed by the interned tag id so that
+    the filters are evaluated with a few word operations.
+*/
 
-    
+struct Tags {
 
-    /// List of active tags
-    std::vector<uint64_t> active;
-};
+    Tags() {}
+    Tags(std::initializer_list<std::string> tags);
 
-#if 0
-struct TagsContext {
-    BidRequest * breq;
-};
+    void add(const std::string & tag) { add(Tag::intern(tag)); }
+    void add(const Tag & tag) { add(Tag::intern(tag.toString())); }
+    void add(unsigned id);
 
-struct Predicate {
-    virtual ~Predicate()
+    bool contains(unsigned id) const
     {
+        size_t word = id / 64;
+        return word < active.size() && (active[word] >> (id % 64)) & 1;
     }
 
-    bool evaluate(const Tags & tags, TagsContext & context) const = 0;
-};
+    bool empty() const;
 
-struct OrPredicate: public Predicate {
-    
-    std::vector<std::unique_ptr<Predicate> > subexpr;
-};
+    /** Is any of the other's tags set? */
+    bool intersects(const Tags & other) const;
 
-struct AndPredicate: public Predicate {
+    /** Are all of the other's tags set? */
+    bool containsAll(const Tags & other) const;
 
+    Json::Value toJson() const;
+    static Tags fromJson(const Json::Value & val);
 
-    std::vector<std::unique_ptr<Predicate> > subexpr;
+    /// List of active tags
+    std::vector<uint64_t> active;
 };
-#endif
+
 
 /*****************************************************************************/
 /* TAG FILTER                                                                */
@@ -70,7 +90,8 @@ struct AndPredicate: public Predicate {
 
 /** Tag filter.  Represents
 
-    All in mustInclude are set and none in mustNotInclude are set.
+    At least one in mustIncludeOneOf (if it has any), all in mustIncludeAllOf
+    and none in mustNotIncludeAnyOf are set.
 */
 
 struct TagFilter {
@@ -80,6 +101,10 @@ struct TagFilter {
 
     /** Does this filter match the given set of tags? */
     bool matches(const Tags & tagsToMatch) const;
+
+    /** { "oneOf": [ ... ], "allOf": [ ... ], "noneOf": [ ... ] } */
+    Json::Value toJson() const;
+    static TagFilter fromJson(const Json::Value & val);
 };
 
 
@@ -87,12 +112,27 @@ struct TagFilter {
 /* TAG FILTER EXPRESSION                                                     */
 /*****************************************************************************/
 
-/** Class to deal with evaluating a filter expression. */
+/** Class to deal with evaluating a filter expression.  The expression
+    matches if any of its filters does, or if it has no filters at all.
+
+    compile() flattens the filters into a single array of words, one header
+    word followed by the masks of each filter, which matches() walks without
+    any allocation or indirection.  It must be called again whenever the
+    filters change; until it is, matches() evaluates the filters one by
+    one.
+*/
 
 struct TagFilterExpression : public std::vector<TagFilter> {
-    
-};
 
-} // namespace RTBKIT
+    void compile();
+
+    bool matches(const Tags & tagsToMatch) const;
 
+    Json::Value toJson() const;
+    static TagFilterExpression fromJson(const Json::Value & val);
 
+private:
+    std::vector<uint64_t> program;
+};
+
+} // namespace RTBKIT
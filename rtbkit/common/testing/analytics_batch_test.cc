@@ -0,0 +1,65 @@
+/* analytics_batch_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the encoding of the analytics batches.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/common/analytics_batch.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace RTBKIT;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE(analyticsBatchRoundTripTest)
+{
+    AnalyticsBatch batch;
+    BOOST_CHECK(batch.empty());
+
+    batch.add("BID", "2026-10-14", string("agent"), 12, 0.5);
+    batch.add("ERROR", string(), vector<string>{ "a", "b" });
+    batch.add("EMPTY");
+
+    BOOST_CHECK_EQUAL(batch.size(), 3);
+
+    vector<vector<string> > events;
+    size_t numEvents = AnalyticsBatch::forEach(batch.data(),
+            [&] (vector<string> && fields) {
+                events.push_back(std::move(fields));
+            });
+
+    BOOST_CHECK_EQUAL(numEvents, 3);
+    BOOST_REQUIRE_EQUAL(events.size(), 3);
+
+    vector<string> bid = { "BID", "2026-10-14", "agent", "12", "0.500000" };
+    BOOST_CHECK_EQUAL_COLLECTIONS(events[0].begin(), events[0].end(),
+                                  bid.begin(), bid.end());
+
+    vector<string> error = { "ERROR", "", "a", "b" };
+    BOOST_CHECK_EQUAL_COLLECTIONS(events[1].begin(), events[1].end(),
+                                  error.begin(), error.end());
+
+    BOOST_REQUIRE_EQUAL(events[2].size(), 1);
+    BOOST_CHECK_EQUAL(events[2][0], "EMPTY");
+
+    batch.clear();
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK_EQUAL(batch.bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(analyticsBatchTruncatedTest)
+{
+    AnalyticsBatch batch;
+    batch.add("WIN", string("auction"), string("price"));
+
+    string data = batch.data();
+    data.resize(data.size() - 1);
+
+    auto onEvent = [] (vector<string> && fields) {};
+    BOOST_CHECK_THROW(AnalyticsBatch::forEach(data, onEvent), ML::Exception);
+}
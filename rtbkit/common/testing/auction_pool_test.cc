@@ -0,0 +1,126 @@
+/* auction_pool_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the pool of auctions and bid requests.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/common/auction_pool.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace RTBKIT;
+using namespace Datacratic;
+
+
+namespace {
+
+void fillRequest(BidRequest & request)
+{
+    request.auctionId = Id("auction-1");
+    request.auctionType = AuctionType::FIRST_PRICE;
+    request.timeAvailableMs = 100.0;
+    request.timestamp = Date::fromSecondsSinceEpoch(1400000000);
+    request.isTest = true;
+    request.protocolVersion = "2.1";
+    request.exchange = "exchange";
+    request.provider = "provider";
+    request.site.reset(new OpenRTB::Site());
+    request.site->page = Url("http://www.example.com/page");
+    request.imp.emplace_back();
+    request.imp.back().id = Id(1);
+    request.imp.back().formats.push_back(Format(300, 250));
+    request.ipAddress = "127.0.0.1";
+    request.userIds.add(Id("user"), ID_EXCHANGE);
+    request.segments.addInts("source", { 1, 2, 3 });
+    request.meta["key"] = "value";
+    request.ext["ext"] = 1;
+    request.bidCurrency.push_back(CurrencyCode::CC_USD);
+    request.badv.push_back(Utf8String("badv.com"));
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_bid_request_clear )
+{
+    BidRequest request;
+    fillRequest(request);
+
+    size_t capacity = request.imp.capacity();
+    request.clear();
+
+    BOOST_CHECK_EQUAL(request.toJsonStr(), BidRequest().toJsonStr());
+    BOOST_CHECK_EQUAL(request.imp.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_pool_recycles )
+{
+    auto pool = make_shared<AuctionPool>(4);
+
+    auto request = pool->getBidRequest();
+    fillRequest(*request);
+    BidRequest * requestPtr = request.get();
+
+    Date start = Date::now();
+    auto auction = pool->getAuction(nullptr, Auction::HandleAuction(),
+                                    request, request->toJsonStr(),
+                                    "datacratic",
+                                    start, start.plusSeconds(0.1));
+    Auction * auctionPtr = auction.get();
+    BOOST_CHECK_EQUAL(auction->id, Id("auction-1"));
+    BOOST_CHECK_EQUAL(auction->numSpots(), 1);
+    BOOST_CHECK_EQUAL(auction->shared_from_this(), auction);
+    auction->requestOriginal = "original";
+
+    /* the request is still held by the auction */
+    request.reset();
+    BOOST_CHECK_EQUAL(pool->freeBidRequests(), 0);
+
+    long long destroyed = Auction::destroyed;
+    auction.reset();
+    BOOST_CHECK_EQUAL(Auction::destroyed, destroyed + 1);
+    BOOST_CHECK_EQUAL(pool->freeAuctions(), 1);
+    BOOST_CHECK_EQUAL(pool->freeBidRequests(), 1);
+
+    /* the same objects come back, as good as new */
+    request = pool->getBidRequest();
+    BOOST_CHECK_EQUAL(request.get(), requestPtr);
+    BOOST_CHECK_EQUAL(request->toJsonStr(), BidRequest().toJsonStr());
+    request->auctionId = Id("auction-2");
+    request->imp.resize(2);
+
+    auction = pool->getAuction(nullptr, Auction::HandleAuction(),
+                               request, "{}", "datacratic",
+                               start, start.plusSeconds(0.1));
+    BOOST_CHECK_EQUAL(auction.get(), auctionPtr);
+    BOOST_CHECK_EQUAL(auction->id, Id("auction-2"));
+    BOOST_CHECK_EQUAL(auction->numSpots(), 2);
+    BOOST_CHECK_EQUAL(auction->requestOriginal, "");
+    BOOST_CHECK_EQUAL(auction->getResponses().size(), 2);
+    BOOST_CHECK_EQUAL(auction->shared_from_this(), auction);
+    BOOST_CHECK_EQUAL(pool->freeAuctions(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_pool_outlived )
+{
+    /* objects that are still in use keep their pool alive */
+    auto pool = make_shared<AuctionPool>();
+    weak_ptr<AuctionPool> weakPool = pool;
+
+    auto request = pool->getBidRequest();
+    request->imp.emplace_back();
+    Date start = Date::now();
+    auto auction = pool->getAuction(nullptr, Auction::HandleAuction(),
+                                    request, "{}", "datacratic",
+                                    start, start);
+    request.reset();
+    pool.reset();
+
+    BOOST_CHECK(!weakPool.expired());
+    BOOST_CHECK_EQUAL(weakPool.lock()->freeAuctions(), 0);
+    auction.reset();
+    BOOST_CHECK(weakPool.expired());
+}
@@ -71,6 +71,7 @@ struct GenerateCtx : public Context
 
     RNG& rng;
     GeneratorFn generator;
+    ArraySizeFn arraySize;
 };
 
 struct RecordCtx : public Context
@@ -397,6 +398,7 @@ struct NodeArray : public Node
     {
         Json::Value value;
         size_t size = pickRandom(sizes, count, ctx.rng);
+        if (ctx.arraySize) size = ctx.arraySize(ctx.path(), size);
 
         CtxGuard<GenerateCtx> guard(ctx, ArrayIndex);
 
@@ -603,6 +605,7 @@ generate(uint32_t seed) const
     ML::RNG rng(seed);
     Synth::GenerateCtx ctx(rng);
     ctx.generator = generatorFn;
+    ctx.arraySize = arraySizeFn;
 
     return values->generate(ctx);
 }
@@ -615,6 +618,7 @@ generate(RNG& rng) const
 
     Synth::GenerateCtx ctx(rng);
     ctx.generator = generatorFn;
+    ctx.arraySize = arraySizeFn;
 
     return values->generate(ctx);
 }
@@ -53,6 +53,9 @@ struct NodePath : public std::vector<std::string>
 typedef std::function<Json::Value(const NodePath&)> GeneratorFn;
 typedef std::function<bool(const NodePath&)> TestPathFn;
 
+// Given the path of an array and the size picked for it, returns its size.
+typedef std::function<size_t(const NodePath&, size_t)> ArraySizeFn;
+
 static constexpr const char* ArrayIndex = "_i_";
 }
 
@@ -67,6 +70,7 @@ struct BidRequestSynth
     Synth::TestPathFn isGeneratedFn;
     Synth::TestPathFn isCutoffFn;
     Synth::GeneratorFn generatorFn;
+    Synth::ArraySizeFn arraySizeFn;
 
     void record(const Json::Value& json);
     Json::Value generate(uint32_t seed = 0) const;
@@ -0,0 +1,319 @@
+/** bid_request_traffic.cc                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Synthetic bid request traffic.
+
+*/
+
+#include "bid_request_traffic.h"
+#include "soa/jsoncpp/value.h"
+#include "soa/jsoncpp/reader.h"
+#include "jml/utils/filter_streams.h"
+#include "jml/utils/exc_check.h"
+#include "jml/arch/format.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace ML;
+
+namespace RTBKIT {
+
+namespace {
+
+/** Spreads close values over all the bits so that consecutive ranks don't
+    give ids or ips that look alike.
+ */
+uint64_t mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+/** Uniform in [0, 1) with more resolution than RNG::random01() which only
+    has the 24 bits of a float; the tail of a large Zipf needs them.
+ */
+double random01(RNG& rng)
+{
+    uint64_t bits = (uint64_t(rng.random()) << 21) ^ rng.random();
+    return double(bits & ((1ULL << 53) - 1)) / double(1ULL << 53);
+}
+
+} // namespace anonymous
+
+
+/******************************************************************************/
+/* ZIPF DISTRIBUTION                                                          */
+/******************************************************************************/
+
+ZipfDistribution::
+ZipfDistribution(size_t n, double skew)
+{
+    ExcCheck(n > 0, "zipf distribution needs at least one rank");
+    ExcCheck(skew >= 0.0, "zipf distribution needs a positive skew");
+
+    cdf.resize(n);
+
+    double sum = 0.0;
+    for (size_t k = 0; k < n; ++k)
+        cdf[k] = sum += pow(k + 1, -skew);
+
+    for (double& p : cdf) p /= sum;
+}
+
+size_t
+ZipfDistribution::
+operator() (RNG& rng) const
+{
+    double p = random01(rng);
+    auto it = upper_bound(cdf.begin(), cdf.end(), p);
+    return std::min<size_t>(it - cdf.begin(), cdf.size() - 1);
+}
+
+
+/******************************************************************************/
+/* BID REQUEST TRAFFIC                                                        */
+/******************************************************************************/
+
+BidRequestTraffic::Config::
+Config() :
+    seed(1),
+    numUsers(1000000), userSkew(1.0),
+    numUrls(100000), urlSkew(1.0), pagesPerDomain(20)
+{}
+
+BidRequestTraffic::Config
+BidRequestTraffic::
+parseConfig(const Json::Value& json)
+{
+    Config config;
+
+    if (json.isMember("seed")) config.seed = json["seed"].asUInt();
+    if (json.isMember("numUsers")) config.numUsers = json["numUsers"].asUInt();
+    if (json.isMember("userSkew")) config.userSkew = json["userSkew"].asDouble();
+    if (json.isMember("numUrls")) config.numUrls = json["numUrls"].asUInt();
+    if (json.isMember("urlSkew")) config.urlSkew = json["urlSkew"].asDouble();
+    if (json.isMember("pagesPerDomain"))
+        config.pagesPerDomain = json["pagesPerDomain"].asUInt();
+
+    const Json::Value& scales = json["arrayScales"];
+    for (auto it = scales.begin(), end = scales.end(); it != end; ++it)
+        config.arrayScales[it.memberName()] = it->asDouble();
+
+    return config;
+}
+
+BidRequestTraffic::
+BidRequestTraffic(const Config& config) :
+    config(config),
+    rng(config.seed),
+    users(config.numUsers, config.userSkew),
+    urls(config.numUrls, config.urlSkew),
+    numRequests(0),
+    numImps(0), currentUser(-1), currentPage(-1)
+{
+    ExcCheck(config.pagesPerDomain > 0, "pagesPerDomain can't be 0");
+
+    synth.isGeneratedFn = [] (const Synth::NodePath& path) {
+        return kind(path) != Recorded;
+    };
+
+    synth.generatorFn = [=] (const Synth::NodePath& path) {
+        return generate(path);
+    };
+
+    synth.arraySizeFn = [=] (const Synth::NodePath& path, size_t size) {
+        return arraySize(path, size);
+    };
+}
+
+BidRequestTraffic::FieldKind
+BidRequestTraffic::
+kind(const Synth::NodePath& path)
+{
+    if (path.empty()) return Recorded;
+
+    const string& field = path.back();
+    const string& parent = path.size() > 1 ? path[path.size() - 2] : "";
+
+    // Covers the fields of OpenRTB as well as of our own JSON format.
+    if (path.size() == 1 && field == "id") return AuctionId;
+    if (path.size() == 3 && path[0] == "imp" && field == "id") return ImpId;
+
+    if (parent == "user" && (field == "id" || field == "buyeruid"))
+        return UserId;
+    if (path.size() == 2 && path[0] == "userIds") return UserId;
+
+    if (field == "ip" || field == "ipAddress") return Ip;
+    if (field == "page" || field == "url") return Url;
+    if (field == "domain") return Domain;
+    if (field == "ref") return Referrer;
+
+    return Recorded;
+}
+
+void
+BidRequestTraffic::
+record(const Json::Value& request)
+{
+    synth.record(request);
+}
+
+size_t
+BidRequestTraffic::
+recordFile(const std::string& path)
+{
+    filter_istream stream(path);
+    ExcCheck(stream, "can't open " + path);
+
+    size_t count = 0;
+    string line;
+    while (getline(stream, line)) {
+        if (line.empty()) continue;
+        synth.record(Json::parse(line));
+        count++;
+    }
+
+    return count;
+}
+
+void
+BidRequestTraffic::
+dump(std::ostream& stream)
+{
+    synth.dump(stream);
+}
+
+void
+BidRequestTraffic::
+load(std::istream& stream)
+{
+    synth.load(stream);
+}
+
+Json::Value
+BidRequestTraffic::
+next()
+{
+    numRequests++;
+    numImps = 0;
+    currentUser = -1;
+    currentPage = -1;
+
+    return synth.generate(rng);
+}
+
+std::string
+BidRequestTraffic::
+nextString()
+{
+    return next().toStringNoNewLine();
+}
+
+void
+BidRequestTraffic::
+write(std::ostream& stream, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        stream << nextString() << '\n';
+}
+
+Json::Value
+BidRequestTraffic::
+generate(const Synth::NodePath& path)
+{
+    switch (kind(path)) {
+
+    case AuctionId: {
+        // The request count makes it unique while the rest makes it look
+        // like the uuids most exchanges use.
+        uint64_t bits = mix(numRequests ^ (uint64_t(config.seed) << 40));
+        return format("%08x-%04x-%04x-%04x-%012llx",
+                      uint32_t(bits >> 32), uint32_t(bits >> 16) & 0xffff,
+                      uint32_t(bits) & 0xffff, rng.random() & 0xffff,
+                      (unsigned long long) numRequests);
+    }
+
+    case ImpId: return to_string(++numImps);
+
+    case UserId:
+        return format("%016llx", (unsigned long long) mix(user() + 1));
+
+    case Ip: {
+        uint64_t bits = mix(~uint64_t(user()));
+        return format("%d.%d.%d.%d",
+                      int(1 + (bits >> 24) % 223), int((bits >> 16) & 0xff),
+                      int((bits >> 8) & 0xff), int(bits & 0xff));
+    }
+
+    case Url: return url(page());
+    case Domain: return domain(page());
+    case Referrer: return url(urls(rng));
+
+    default: break;
+    }
+
+    ExcCheck(false, "no generator for field " + path.back());
+    return Json::Value();
+}
+
+size_t
+BidRequestTraffic::
+arraySize(const Synth::NodePath& path, size_t size)
+{
+    if (config.arrayScales.empty()) return size;
+
+    // Arrays of arrays are scaled like their outermost array.
+    auto it = find_if(path.rbegin(), path.rend(), [] (const string& field) {
+                return field != Synth::ArrayIndex;
+            });
+    if (it == path.rend()) return size;
+
+    auto scale = config.arrayScales.find(*it);
+    if (scale == config.arrayScales.end()) return size;
+
+    // Rounded up or down at random so that the mean size is scaled exactly.
+    double scaled = size * scale->second;
+    size_t result = scaled;
+    if (rng.random01() < scaled - result) result++;
+    return result;
+}
+
+size_t
+BidRequestTraffic::
+user()
+{
+    if (currentUser < 0) currentUser = users(rng);
+    return currentUser;
+}
+
+size_t
+BidRequestTraffic::
+page()
+{
+    if (currentPage < 0) currentPage = urls(rng);
+    return currentPage;
+}
+
+std::string
+BidRequestTraffic::
+domain(size_t page) const
+{
+    // The most popular pages are on the most popular domains.
+    return format("www.site%zu.com", page / config.pagesPerDomain);
+}
+
+std::string
+BidRequestTraffic::
+url(size_t page) const
+{
+    return format("http://%s/page/%zu.html", domain(page).c_str(), page);
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,154 @@
+/** bid_request_traffic.h                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Synthetic bid request traffic.
+
+*/
+
+#pragma once
+
+#include "bid_request_synth.h"
+#include "jml/utils/rng.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace RTBKIT {
+
+/******************************************************************************/
+/* ZIPF DISTRIBUTION                                                          */
+/******************************************************************************/
+
+/** Picks ranks in [0, n) where rank k comes up in proportion to 1/(k+1)^skew,
+    which is how the popularity of users and pages is usually spread: a few
+    of them show up in most of the requests and the rest in a long tail.
+ */
+struct ZipfDistribution
+{
+    ZipfDistribution(size_t n, double skew);
+
+    size_t operator() (ML::RNG& rng) const;
+
+    size_t size() const { return cdf.size(); }
+
+private:
+    std::vector<double> cdf;
+};
+
+
+/******************************************************************************/
+/* BID REQUEST TRAFFIC                                                        */
+/******************************************************************************/
+
+/** Endless stream of synthetic bid requests in the JSON format of the samples
+    they were learned from.
+
+    The structure of the requests comes from a BidRequestSynth so the number
+    of imps, segments, categories and so on follows the one of the samples.
+    The fields that tell requests apart are generated instead of being picked
+    among the recorded values, which would only ever repeat the samples:
+
+    - the auction and imp ids are unique;
+    - user ids are drawn out of numUsers users and urls out of numUrls pages
+      spread over domains, both following a Zipf distribution;
+    - ips come with the user and domains with the page so that a request is
+      consistent with itself.
+
+    Arrays can be scaled by name (eg. "imp" or "segment") to get requests
+    more complex than the samples. Generating isn't thread-safe.
+ */
+struct BidRequestTraffic
+{
+    struct Config
+    {
+        Config();
+
+        uint32_t seed;
+
+        size_t numUsers;
+        double userSkew;
+
+        size_t numUrls;
+        double urlSkew;
+        size_t pagesPerDomain;
+
+        /** Factor applied to the size of the arrays with the given name. */
+        std::map<std::string, double> arrayScales;
+    };
+
+    BidRequestTraffic(const Config& config = Config());
+
+    // The generators of the synth point back at us.
+    BidRequestTraffic(const BidRequestTraffic&) = delete;
+    BidRequestTraffic& operator= (const BidRequestTraffic&) = delete;
+
+    /** Learns the shape of the requests from a sample. */
+    void record(const Json::Value& request);
+
+    /** Records every request in the file, one per line. The file may be
+        compressed. Returns the number of requests recorded.
+     */
+    size_t recordFile(const std::string& path);
+
+    /** Saves or restores what was learned, which doesn't include the
+        config.
+     */
+    void dump(std::ostream& stream);
+    void load(std::istream& stream);
+
+    Json::Value next();
+
+    /** Next request as JSON on a single line, as exchanges send them. */
+    std::string nextString();
+
+    /** Writes count requests, one per line. */
+    void write(std::ostream& stream, size_t count);
+
+    /** Reads the config from JSON: seed, numUsers, userSkew, numUrls,
+        urlSkew, pagesPerDomain and arrayScales, all optional.
+     */
+    static Config parseConfig(const Json::Value& json);
+
+private:
+    enum FieldKind
+    {
+        Recorded,
+
+        AuctionId,
+        ImpId,
+        UserId,
+        Ip,
+        Url,
+        Domain,
+        Referrer,
+    };
+
+    static FieldKind kind(const Synth::NodePath& path);
+
+    Json::Value generate(const Synth::NodePath& path);
+    size_t arraySize(const Synth::NodePath& path, size_t size);
+
+    size_t user();
+    size_t page();
+    std::string url(size_t page) const;
+    std::string domain(size_t page) const;
+
+    Config config;
+    BidRequestSynth synth;
+    ML::RNG rng;
+
+    ZipfDistribution users;
+    ZipfDistribution urls;
+
+    uint64_t numRequests;
+
+    // State of the request being generated; -1 when not picked yet.
+    size_t numImps;
+    ssize_t currentUser;
+    ssize_t currentPage;
+};
+
+} // namespace RTBKIT
@@ -0,0 +1,192 @@
+/** bid_request_traffic_test.cc                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the synthetic bid request traffic.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "bid_request_traffic.h"
+#include "soa/jsoncpp/value.h"
+#include "soa/jsoncpp/reader.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <map>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+
+namespace {
+
+const char* samples[] = {
+    "{'id':'a1','imp':[{'id':'1','banner':{'w':300,'h':250}}],"
+    "'site':{'domain':'a.com','page':'http://a.com/x'},"
+    "'device':{'ip':'1.2.3.4'},'user':{'id':'u1'},"
+    "'segments':['s1','s2']}",
+
+    "{'id':'a2','imp':[{'id':'1','banner':{'w':728,'h':90}},"
+    "{'id':'2','banner':{'w':300,'h':250}}],"
+    "'site':{'domain':'b.com','page':'http://b.com/y'},"
+    "'device':{'ip':'5.6.7.8'},'user':{'id':'u2'},"
+    "'segments':['s3','s4','s5','s6']}",
+};
+
+void record(BidRequestTraffic& traffic)
+{
+    for (const char* sample : samples)
+        traffic.record(Json::parse(sample));
+}
+
+} // namespace anonymous
+
+
+BOOST_AUTO_TEST_CASE( test_zipf )
+{
+    ZipfDistribution zipf(1000, 1.0);
+    RNG rng(42);
+
+    vector<size_t> counts(zipf.size());
+    for (size_t i = 0; i < 100000; ++i)
+        counts[zipf(rng)]++;
+
+    // With a skew of 1 the first rank comes up about twice as often as the
+    // second and about 1/H(1000) ~ 13% of the time.
+    BOOST_CHECK_GT(counts[0], counts[1] * 1.7);
+    BOOST_CHECK_LT(counts[0], counts[1] * 2.3);
+    BOOST_CHECK_GT(counts[0], 12000);
+    BOOST_CHECK_LT(counts[0], 14000);
+    BOOST_CHECK_GT(counts[999], 0);
+
+    ZipfDistribution uniform(10, 0.0);
+    vector<size_t> flat(uniform.size());
+    for (size_t i = 0; i < 100000; ++i)
+        flat[uniform(rng)]++;
+    for (size_t count : flat) {
+        BOOST_CHECK_GT(count, 9000);
+        BOOST_CHECK_LT(count, 11000);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_generated_fields )
+{
+    BidRequestTraffic::Config config;
+    config.numUsers = 100;
+    config.numUrls = 50;
+    config.pagesPerDomain = 10;
+
+    BidRequestTraffic traffic(config);
+    record(traffic);
+
+    set<string> auctionIds;
+    set<string> users, pages;
+    map<string, string> ipOfUser;
+
+    const size_t count = 10000;
+    for (size_t i = 0; i < count; ++i) {
+        Json::Value br = traffic.next();
+
+        auctionIds.insert(br["id"].asString());
+
+        const Json::Value& imps = br["imp"];
+        BOOST_REQUIRE_GE(imps.size(), 1);
+        BOOST_REQUIRE_LE(imps.size(), 2);
+        for (size_t j = 0; j < imps.size(); ++j)
+            BOOST_CHECK_EQUAL(imps[j]["id"].asString(), to_string(j + 1));
+
+        string user = br["user"]["id"].asString();
+        users.insert(user);
+
+        // The ip follows the user.
+        string ip = br["device"]["ip"].asString();
+        auto it = ipOfUser.insert(make_pair(user, ip)).first;
+        BOOST_CHECK_EQUAL(it->second, ip);
+
+        // The domain follows the page.
+        string page = br["site"]["page"].asString();
+        string domain = br["site"]["domain"].asString();
+        pages.insert(page);
+        BOOST_CHECK_EQUAL(page.find("http://" + domain + "/"), 0);
+    }
+
+    BOOST_CHECK_EQUAL(auctionIds.size(), count);
+    BOOST_CHECK_LE(users.size(), config.numUsers);
+    BOOST_CHECK_GT(users.size(), config.numUsers / 2);
+    BOOST_CHECK_LE(pages.size(), config.numUrls);
+}
+
+BOOST_AUTO_TEST_CASE( test_array_scales )
+{
+    BidRequestTraffic::Config config;
+    BidRequestTraffic plain(config);
+    record(plain);
+
+    config.arrayScales["segments"] = 2.5;
+    BidRequestTraffic scaled(config);
+    record(scaled);
+
+    const size_t count = 10000;
+    double plainSegments = 0, scaledSegments = 0;
+    double plainImps = 0, scaledImps = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        Json::Value a = plain.next();
+        Json::Value b = scaled.next();
+        plainSegments += a["segments"].size();
+        scaledSegments += b["segments"].size();
+        plainImps += a["imp"].size();
+        scaledImps += b["imp"].size();
+    }
+
+    cerr << "segments: " << plainSegments / count
+         << " -> " << scaledSegments / count << endl;
+
+    BOOST_CHECK_CLOSE(scaledSegments / plainSegments, 2.5, 5);
+    BOOST_CHECK_CLOSE(scaledImps / plainImps, 1.0, 5);
+}
+
+BOOST_AUTO_TEST_CASE( test_determinism )
+{
+    BidRequestTraffic a, b;
+    record(a);
+    record(b);
+
+    for (size_t i = 0; i < 100; ++i)
+        BOOST_CHECK_EQUAL(a.nextString(), b.nextString());
+
+    BidRequestTraffic::Config config;
+    config.seed = 2;
+    BidRequestTraffic c(config);
+    record(c);
+    BOOST_CHECK_NE(a.nextString(), c.nextString());
+
+    // A saved model generates the same kind of traffic.
+    stringstream model;
+    a.dump(model);
+    BidRequestTraffic d;
+    d.load(model);
+
+    Json::Value br = d.next();
+    BOOST_CHECK(br.isMember("id"));
+    BOOST_CHECK(br["user"]["id"].isString());
+    BOOST_CHECK_GE(br["imp"].size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_parse_config )
+{
+    auto config = BidRequestTraffic::parseConfig(Json::parse(
+                    "{'seed':7,'numUsers':10,'urlSkew':0.5,"
+                    "'arrayScales':{'imp':3}}"));
+
+    BOOST_CHECK_EQUAL(config.seed, 7);
+    BOOST_CHECK_EQUAL(config.numUsers, 10);
+    BOOST_CHECK_EQUAL(config.urlSkew, 0.5);
+    BOOST_CHECK_EQUAL(config.numUrls, BidRequestTraffic::Config().numUrls);
+    BOOST_CHECK_EQUAL(config.arrayScales["imp"], 3.0);
+}
@@ -19,3 +19,65 @@ BOOST_AUTO_TEST_CASE(creativeMatrixTest)
   BOOST_CHECK_EQUAL(bidObj[0].spotIndex, 0);
   BOOST_CHECK_EQUAL(bidObj[0].ext.toStringNoNewLine(), "[\"test1\",\"test2\"]");
 }
+
+BOOST_AUTO_TEST_CASE(jsonStrTest)
+{
+  std::string testStr = "{\"bids\":[{\"spotIndex\":0,\"creative\":1,\"price\":\"2000USD/1M\",\"priority\":0.5,\"account\":\"a:b\",\"ext\":{\"x\":\"y\"}},null,{\"spotIndex\":2,\"creative\":0,\"price\":\"10USD/1M\"}],\"sources\":[\"s1\",\"s2\"]}";
+  Bids bids = Bids::fromJson(testStr);
+  BOOST_CHECK_EQUAL(bids.size(), 3);
+
+  // The string is written directly but must match the Json::Value.
+  std::string jsonStr = bids.toJsonStr();
+  BOOST_CHECK_EQUAL(Json::parse(jsonStr).toStringNoNewLine(),
+                    bids.toJson().toStringNoNewLine());
+
+  Bids reparsed = Bids::fromJson(jsonStr);
+  BOOST_CHECK_EQUAL(reparsed.size(), 3);
+  BOOST_CHECK_EQUAL(reparsed[0].account.toString(), "a:b");
+  BOOST_CHECK_EQUAL(reparsed[0].priority, 0.5);
+  BOOST_CHECK(reparsed[1].isNullBid());
+  BOOST_CHECK_EQUAL(reparsed[2].price, MicroUSD(10));
+  BOOST_CHECK_EQUAL(reparsed.dataSources.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(parseInPlaceTest)
+{
+  std::vector<std::string> inputs = {
+    "{\"bids\":[{\"spotIndex\":0,\"creative\":1,\"price\":\"2000USD/1M\",\"priority\":0.5,\"account\":\"a:b\",\"ext\":{\"x\":[\"y\",{\"z\":\"]}\"}]}},null,{\"spotIndex\":2,\"creative\":0,\"price\":\"10USD/1M\"}],\"sources\":[\"s1\",\"s2\"]}",
+    " { \"bids\" : [ { } , { \"spotIndex\" : 1 , \"surplus\" : 2e-1 , \"price\" : \"0\" } ] } ",
+    "{\"bids\":[{\"spotIndex\":0,\"price\":\"3USD\\/1M\",\"ext\":null}]}",
+    "{\"bids\":[]}"
+  };
+
+  Bids parsed;
+  for (auto & input: inputs) {
+    Bids expected = Bids::fromJson(input);
+    Bids::parse(input, parsed);
+    BOOST_CHECK_EQUAL(parsed.toJsonStr(), expected.toJsonStr());
+    BOOST_CHECK_EQUAL(parsed.dataSources.size(), expected.dataSources.size());
+  }
+
+  // The bids already there are reused
+  Bids::parse(inputs[0], parsed);
+  BOOST_CHECK_EQUAL(parsed.size(), 3);
+  const Bid * storage = &parsed[0];
+  Bids::parse(inputs[1], parsed);
+  BOOST_CHECK_EQUAL(parsed.size(), 2);
+  BOOST_CHECK_EQUAL(&parsed[0], storage);
+  BOOST_CHECK(parsed[0].isNullBid());
+  BOOST_CHECK_EQUAL(parsed[1].priority, 0.2);
+  BOOST_CHECK(parsed[1].account.empty());
+  BOOST_CHECK(parsed.dataSources.empty());
+
+  std::vector<std::string> invalid = {
+    "",
+    "{\"bids\":[{\"spotIndex\":0}]",
+    "{\"bids\":[{\"spotIndex\":\"0\"}]}",
+    "{\"bids\":[{\"unknown\":0}]}",
+    "{\"bids\":[{\"price\":\"12\"}]}",
+    "{\"bids\":[{\"ext\":{\"x\":}}]}",
+    "{\"bids\":[]} x"
+  };
+  for (auto & input: invalid)
+    BOOST_CHECK_THROW(Bids::parse(input, parsed), std::exception);
+}
@@ -95,3 +95,25 @@ BOOST_AUTO_TEST_CASE( currencyConversion)
         test2(price);
     }
 }
+
+BOOST_AUTO_TEST_CASE( currencyPoolLookups )
+{
+    CurrencyPool pool;
+    BOOST_CHECK_EQUAL(pool.valueOf(CurrencyCode::CC_USD), 0);
+    BOOST_CHECK(pool.hasAvailable(MicroUSD(0)));
+    BOOST_CHECK(!pool.hasAvailable(MicroUSD(1)));
+
+    pool += MicroUSD(100);
+    pool += MicroUSD(50);
+    BOOST_CHECK_EQUAL(pool.currencyAmounts.size(), 1);
+    BOOST_CHECK_EQUAL(pool.valueOf(CurrencyCode::CC_USD), 150);
+    BOOST_CHECK(pool.hasAvailable(MicroUSD(150)));
+    BOOST_CHECK(!pool.hasAvailable(MicroUSD(151)));
+
+    pool += Amount(CurrencyCode::CC_IMP, 10);
+    BOOST_CHECK_EQUAL(pool.currencyAmounts.size(), 2);
+    BOOST_CHECK_EQUAL(pool.valueOf(CurrencyCode::CC_IMP), 10);
+    BOOST_CHECK_EQUAL(pool.valueOf(CurrencyCode::CC_USD), 150);
+    BOOST_CHECK_EQUAL(pool.getAvailable(CurrencyCode::CC_USD), MicroUSD(150));
+    BOOST_CHECK(!pool.hasAvailable(Amount(CurrencyCode::CC_IMP, 11)));
+}
@@ -0,0 +1,72 @@
+/* extension_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the extension pool's slots.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/common/extension.h"
+
+using namespace std;
+using namespace RTBKIT;
+
+namespace {
+
+struct TestExtension : public Extension {
+    NAME("testExtension")
+
+    TestExtension() : value(0) {}
+
+    void parse(const Json::Value& json) { value = json.asInt(); }
+    Json::Value toJson() const { return value; }
+
+    int value;
+};
+
+struct OtherExtension : public Extension {
+    NAME("otherExtension")
+
+    void parse(const Json::Value&) {}
+    Json::Value toJson() const { return Json::Value(); }
+};
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_extension_slots )
+{
+    ExtensionRegistry::registerFactory<TestExtension>();
+
+    unsigned slot = ExtensionPool::slot("testExtension");
+    BOOST_CHECK_EQUAL(ExtensionPool::slot("testExtension"), slot);
+    BOOST_CHECK_EQUAL(ExtensionPool::findSlot("testExtension"), slot);
+    BOOST_CHECK_EQUAL(ExtensionPool::findSlot("neverSeen"), -1);
+
+    ExtensionPool pool;
+    BOOST_CHECK(!pool.tryGet<TestExtension>());
+    BOOST_CHECK(!pool.tryGet<OtherExtension>());
+    BOOST_CHECK_THROW(pool.get<TestExtension>(), ML::Exception);
+    BOOST_CHECK(!pool.has("testExtension"));
+    BOOST_CHECK(!pool.has("neverSeen"));
+
+    pool.add(ExtensionRegistry::create("testExtension", 3));
+    BOOST_CHECK(pool.has("testExtension"));
+    BOOST_CHECK_EQUAL(pool.get<TestExtension>()->value, 3);
+    BOOST_CHECK_EQUAL(pool.tryGet<TestExtension>()->value, 3);
+    BOOST_CHECK(!pool.tryGet<OtherExtension>());
+
+    // The first one added is kept
+    pool.add(ExtensionRegistry::create("testExtension", 4));
+    BOOST_CHECK_EQUAL(pool.get<TestExtension>()->value, 3);
+
+    pool.add(make_shared<OtherExtension>());
+    BOOST_CHECK(pool.tryGet<OtherExtension>());
+    BOOST_CHECK_EQUAL(pool.list().size(), 2);
+
+    const ExtensionPool copy(pool);
+    BOOST_CHECK_EQUAL(copy.get<TestExtension>()->value, 3);
+}
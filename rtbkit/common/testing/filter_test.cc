@@ -114,6 +114,47 @@ BOOST_AUTO_TEST_CASE(configSetTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(configSetWideTest)
+{
+    // Sizes straddle the vectorized pairs of words and the inline storage.
+    for (size_t n : { 1, 63, 64, 65, 129, 200, 2047, 2048, 2049, 5000 }) {
+        ConfigSet setA, setB;
+
+        for (size_t i = 0; i < n; i += 3) setA.set(i);
+        for (size_t i = 0; i < n; i += 2) setB.set(i);
+
+        BOOST_CHECK_EQUAL(setA.count(), (n + 2) / 3);
+        BOOST_CHECK_EQUAL(setB.count(), (n + 1) / 2);
+
+        ConfigSet andSet = setA & setB;
+        ConfigSet orSet = setA | setB;
+        ConfigSet xorSet = setA ^ setB;
+
+        size_t andCount = 0, orCount = 0, xorCount = 0;
+        for (size_t i = 0; i < n; ++i) {
+            bool a = i % 3 == 0, b = i % 2 == 0;
+
+            BOOST_CHECK_EQUAL(andSet.test(i), a && b);
+            BOOST_CHECK_EQUAL(orSet.test(i), a || b);
+            BOOST_CHECK_EQUAL(xorSet.test(i), a != b);
+
+            andCount += a && b;
+            orCount += a || b;
+            xorCount += a != b;
+        }
+
+        BOOST_CHECK_EQUAL(andSet.count(), andCount);
+        BOOST_CHECK_EQUAL(orSet.count(), orCount);
+        BOOST_CHECK_EQUAL(xorSet.count(), xorCount);
+
+        // Words past the end of the smaller set take its default value.
+        ConfigSet all(true);
+        all &= setA;
+        for (size_t i = 0; i < setA.size(); ++i)
+            BOOST_CHECK_EQUAL(all.test(i), i < n && i % 3 == 0);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(creativeMatrixTest)
 {
     enum { n = 10, m = 100 };
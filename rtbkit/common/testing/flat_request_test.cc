@@ -0,0 +1,86 @@
+/** flat_request_test.cc                                 -*- C++ -*-
+    14 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the flat views of the segments and user ids.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/common/bid_request.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( internTable )
+{
+    InternTable table;
+
+    InternedKey a = table.intern("a");
+    InternedKey b = table.intern("b");
+
+    BOOST_CHECK_NE(a, b);
+    BOOST_CHECK_EQUAL(table.intern("a"), a);
+    BOOST_CHECK_EQUAL(table.lookup("b"), b);
+    BOOST_CHECK_EQUAL(table.lookup("c"), InternedKey(InternTable::NoKey));
+    BOOST_CHECK_EQUAL(table.str(a), "a");
+    BOOST_CHECK_EQUAL(table.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE( flatSegments )
+{
+    SegmentsBySource segments;
+    segments.addInts("ints", { 1, 2, 3 });
+    segments.addStrings("strings", { "x", "y" });
+    segments.addInts("empty", {});
+
+    FlatSegmentsBySource flat(segments);
+    BOOST_CHECK_EQUAL(flat.size(), segments.size());
+
+    for (const auto & entry : segments) {
+        BOOST_CHECK_EQUAL(flat.find(entry.first), entry.second.get());
+
+        InternedKey key = requestKeys().lookup(entry.first);
+        BOOST_CHECK_EQUAL(&flat.get(key), entry.second.get());
+    }
+
+    BOOST_CHECK(flat.get("ints").contains(2));
+    BOOST_CHECK(flat.get("strings").contains("y"));
+
+    BOOST_CHECK(!flat.find("unknown"));
+    BOOST_CHECK(flat.get("unknown").empty());
+
+    // Known to the intern table but not present in the request.
+    InternedKey other = requestKeys().intern("other");
+    BOOST_CHECK(!flat.find(other));
+    BOOST_CHECK(!flat.count(other));
+
+    // Copies share the segment lists without touching the refcounts.
+    long useCount = segments["ints"].use_count();
+    FlatSegmentsBySource copy = flat;
+    BOOST_CHECK_EQUAL(copy.find("ints"), flat.find("ints"));
+    BOOST_CHECK_EQUAL(segments["ints"].use_count(), useCount);
+}
+
+BOOST_AUTO_TEST_CASE( flatUserIds )
+{
+    UserIds ids;
+    ids.add(Id("ex"), ID_EXCHANGE);
+    ids.add(Id("pr"), ID_PROVIDER);
+    ids.add(Id("other"), "other");
+
+    FlatUserIds flat(ids);
+    BOOST_CHECK_EQUAL(flat.size(), ids.size());
+
+    BOOST_CHECK_EQUAL(flat.get("xchg"), Id("ex"));
+    BOOST_CHECK_EQUAL(flat.get("prov"), Id("pr"));
+    BOOST_CHECK_EQUAL(flat.get(requestKeys().lookup("other")), Id("other"));
+
+    BOOST_CHECK(!flat.find("unknown"));
+    BOOST_CHECK_EQUAL(flat.get("unknown"), Id());
+}
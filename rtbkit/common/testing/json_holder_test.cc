@@ -0,0 +1,92 @@
+/* json_holder_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the JsonHolder's lazily parsed values.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/common/json_holder.h"
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( test_json_holder_typed )
+{
+    JsonHolder holder(string("[1,2,3]"));
+
+    const vector<int> & vals = holder.as<vector<int> >();
+    BOOST_CHECK_EQUAL(vals.size(), 3);
+    BOOST_CHECK_EQUAL(vals[2], 3);
+
+    // Parsed once; later calls get the same value
+    BOOST_CHECK_EQUAL(&holder.as<vector<int> >(), &vals);
+
+    // Other types are parsed and kept alongside
+    const vector<double> & dvals = holder.as<vector<double> >();
+    BOOST_CHECK_EQUAL(dvals[1], 2.0);
+    BOOST_CHECK_EQUAL(&holder.as<vector<int> >(), &vals);
+    BOOST_CHECK_EQUAL(&holder.as<vector<double> >(), &dvals);
+
+    // The Json::Value is parsed once as well
+    const Json::Value & json = holder.toJson();
+    BOOST_CHECK_EQUAL(json[0].asInt(), 1);
+    BOOST_CHECK_EQUAL(&holder.toJson(), &json);
+
+    // Copies share what was already parsed
+    JsonHolder copy(holder);
+    BOOST_CHECK_EQUAL(&copy.as<vector<int> >(), &vals);
+
+    // Assigning drops it
+    holder = string("[4]");
+    BOOST_CHECK_EQUAL(holder.as<vector<int> >().size(), 1);
+    BOOST_CHECK_EQUAL(holder.as<vector<int> >()[0], 4);
+    BOOST_CHECK_EQUAL(holder.toJson().size(), 1);
+
+    // Held as a Json::Value
+    Json::Value val;
+    val[0] = 5;
+    val[1] = 6;
+    JsonHolder holder2(val);
+    BOOST_CHECK_EQUAL(holder2.as<vector<int> >()[1], 6);
+    BOOST_CHECK_EQUAL(holder2.toString(), "[5,6]");
+
+    // Null gives a default constructed value
+    JsonHolder empty;
+    BOOST_CHECK(empty.as<vector<int> >().empty());
+    BOOST_CHECK(empty.toJson().isNull());
+}
+
+BOOST_AUTO_TEST_CASE( test_json_holder_threads )
+{
+    for (unsigned iter = 0;  iter < 100;  ++iter) {
+        JsonHolder holder(string("[1,2,3,4,5,6,7,8]"));
+
+        int nthreads = 8;
+        vector<const vector<int> *> typed(nthreads);
+        vector<const Json::Value *> json(nthreads);
+
+        vector<thread> threads;
+        for (unsigned i = 0;  i < nthreads;  ++i) {
+            threads.emplace_back([&, i] () {
+                    typed[i] = &holder.as<vector<int> >();
+                    json[i] = &holder.toJson();
+                });
+        }
+        for (auto & t: threads)
+            t.join();
+
+        // Everyone sees the single published value
+        for (unsigned i = 0;  i < nthreads;  ++i) {
+            BOOST_CHECK_EQUAL(typed[i], &holder.as<vector<int> >());
+            BOOST_CHECK_EQUAL(json[i], &holder.toJson());
+        }
+        BOOST_CHECK_EQUAL(holder.as<vector<int> >().size(), 8);
+    }
+}
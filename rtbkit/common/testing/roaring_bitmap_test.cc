@@ -0,0 +1,163 @@
+/* roaring_bitmap_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the roaring bitmap and the segment lists that use it.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/common/roaring_bitmap.h"
+#include "rtbkit/common/segments.h"
+#include "jml/utils/rng.h"
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+
+namespace {
+
+/** Random sorted ints, count of them out of [base, base + range). */
+vector<int> randomInts(RNG & rng, size_t count, int base, int range)
+{
+    set<int> values;
+    while (values.size() < count)
+        values.insert(base + int(rng.random() % range));
+    return vector<int>(values.begin(), values.end());
+}
+
+bool expected(const vector<int> & a, const vector<int> & b)
+{
+    vector<int> common;
+    set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                     back_inserter(common));
+    return !common.empty();
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_contains )
+{
+    vector<int> values = { -70000, -1, 0, 1, 65535, 65536, 1 << 30 };
+    RoaringBitmap bitmap(values.begin(), values.end());
+
+    BOOST_CHECK_EQUAL(bitmap.size(), values.size());
+    for (int v: values)
+        BOOST_CHECK(bitmap.contains(v));
+    for (int v: { -70001, -2, 2, 65534, 65537, (1 << 30) + 1 })
+        BOOST_CHECK(!bitmap.contains(v));
+
+    // Duplicates are counted once, unsorted values are rejected
+    vector<int> dups = { 1, 1, 2, 2, 2, 3 };
+    BOOST_CHECK_EQUAL(RoaringBitmap(dups.begin(), dups.end()).size(), 3);
+    vector<int> unsorted = { 3, 1 };
+    BOOST_CHECK_THROW(RoaringBitmap(unsorted.begin(), unsorted.end()),
+                      std::exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_dense_container )
+{
+    // Enough values in the same chunk to switch it to a bitmap
+    RNG rng(1);
+    vector<int> values = randomInts(rng, 20000, 0, 65536);
+    RoaringBitmap bitmap(values.begin(), values.end());
+
+    BOOST_CHECK_EQUAL(bitmap.size(), values.size());
+    for (int v: values)
+        BOOST_CHECK(bitmap.contains(v));
+
+    size_t found = 0;
+    for (int v = 0;  v < 65536;  ++v)
+        found += bitmap.contains(v);
+    BOOST_CHECK_EQUAL(found, values.size());
+
+    // A bitmap costs 8k per chunk, well under an int per value
+    BOOST_CHECK_LT(bitmap.memUsage(), values.size() * sizeof(int));
+}
+
+BOOST_AUTO_TEST_CASE( test_intersects )
+{
+    RNG rng(2);
+
+    // Sizes that exercise the array/array, array/bitmap and bitmap/bitmap
+    // cases, with ranges that make a match more or less likely.
+    vector<size_t> sizes = { 1, 7, 8, 9, 100, 3000, 5000, 20000 };
+    vector<int> ranges = { 100, 65536, 1000000 };
+
+    for (size_t n1: sizes) {
+        for (size_t n2: sizes) {
+            for (int range: ranges) {
+                if (n1 > size_t(range) / 2 || n2 > size_t(range) / 2)
+                    continue;
+
+                for (unsigned trial = 0;  trial < 5;  ++trial) {
+                    auto a = randomInts(rng, n1, -range / 2, range);
+                    auto b = randomInts(rng, n2, -range / 2, range);
+
+                    RoaringBitmap ba(a.begin(), a.end());
+                    RoaringBitmap bb(b.begin(), b.end());
+
+                    BOOST_CHECK_EQUAL(ba.intersects(bb), expected(a, b));
+                    BOOST_CHECK_EQUAL(bb.intersects(ba), expected(a, b));
+
+                    // Force a single common value into disjoint sets
+                    vector<int> c;
+                    set_difference(b.begin(), b.end(), a.begin(), a.end(),
+                                   back_inserter(c));
+                    if (c.empty()) continue;
+                    RoaringBitmap bc(c.begin(), c.end());
+                    BOOST_CHECK(!ba.intersects(bc));
+
+                    c.push_back(a[rng.random() % a.size()]);
+                    std::sort(c.begin(), c.end());
+                    RoaringBitmap bd(c.begin(), c.end());
+                    BOOST_CHECK(ba.intersects(bd));
+                    BOOST_CHECK(bd.intersects(ba));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_segment_list_bitmap )
+{
+    RNG rng(3);
+
+    auto userInts = randomInts(rng, 2000, 0, 100000);
+    auto agentInts = randomInts(rng, 3000, 0, 100000);
+    auto fewInts = randomInts(rng, 10, 0, 100000);
+
+    SegmentList user(userInts), agent(agentInts), few(fewInts);
+    BOOST_CHECK(user.bitmap());
+    BOOST_CHECK(agent.bitmap());
+    BOOST_CHECK(!few.bitmap());
+
+    BOOST_CHECK_EQUAL(user.match(agent), expected(userInts, agentInts));
+    BOOST_CHECK_EQUAL(user.match(few), expected(userInts, fewInts));
+    BOOST_CHECK_EQUAL(few.match(user), expected(userInts, fewInts));
+    BOOST_CHECK_EQUAL(user.match(fewInts), expected(userInts, fewInts));
+
+    for (int i: userInts)
+        BOOST_CHECK(user.contains(i));
+    BOOST_CHECK(!user.contains(-1));
+
+    // Adding drops the bitmap until the list is sorted again
+    SegmentList copy = user;
+    copy.add(agentInts[0]);
+    BOOST_CHECK(!copy.bitmap());
+    BOOST_CHECK(copy.match(agent));
+    copy.sort();
+    BOOST_CHECK(copy.bitmap());
+    BOOST_CHECK(copy.match(agent));
+
+    // The bitmap is rebuilt when the list is reconstituted
+    auto reconstituted = SegmentList::reconstituteFromString(
+            user.serializeToString());
+    BOOST_CHECK(reconstituted.bitmap());
+    BOOST_CHECK_EQUAL(reconstituted.match(agent), user.match(agent));
+}
@@ -0,0 +1,95 @@
+/* tags_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the tags and the tag filters.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/common/tags.h"
+#include "soa/jsoncpp/json.h"
+#include "jml/arch/exception.h"
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( test_tags )
+{
+    BOOST_CHECK_EQUAL(Tag::intern("a"), Tag::intern("a"));
+    BOOST_CHECK_NE(Tag::intern("a"), Tag::intern("b"));
+    BOOST_CHECK_EQUAL(Tag::name(Tag::intern("a")), "a");
+
+    Tag tag;
+    tag.scope = "campaign";
+    tag.key = "brand";
+    tag.value = "acme";
+    BOOST_CHECK_EQUAL(tag.toString(), "campaign:brand=acme");
+
+    Tags tags { "a", "b" };
+    tags.add(tag);
+    BOOST_CHECK(tags.contains(Tag::intern("a")));
+    BOOST_CHECK(tags.contains(Tag::intern("campaign:brand=acme")));
+    BOOST_CHECK(!tags.contains(Tag::intern("c")));
+    BOOST_CHECK(!tags.empty());
+    BOOST_CHECK(Tags().empty());
+
+    BOOST_CHECK(tags.intersects(Tags { "c", "b" }));
+    BOOST_CHECK(!tags.intersects(Tags { "c" }));
+    BOOST_CHECK(tags.containsAll(Tags { "a", "b" }));
+    BOOST_CHECK(!tags.containsAll(Tags { "a", "c" }));
+    BOOST_CHECK(tags.containsAll(Tags()));
+
+    Tags copy = Tags::fromJson(tags.toJson());
+    BOOST_CHECK(copy.active == tags.active);
+}
+
+BOOST_AUTO_TEST_CASE( test_tag_filter_expression )
+{
+    // Enough tags that the masks span several words.
+    for (unsigned i = 0;  i < 200;  ++i)
+        Tag::intern("filler" + to_string(i));
+
+    auto expr = TagFilterExpression::fromJson(Json::parse(
+            "[ { \"oneOf\": [ \"sports\", \"news\" ], \"noneOf\": [ \"adult\" ] },"
+            "  { \"allOf\": [ \"premium\", \"video\" ] } ]"));
+    BOOST_CHECK_EQUAL(expr.size(), 2);
+
+    auto check = [&] (const Tags & tags, bool expected) {
+        BOOST_CHECK_EQUAL(expr.matches(tags), expected);
+        bool any = false;
+        for (const TagFilter & filter: expr)
+            any = any || filter.matches(tags);
+        BOOST_CHECK_EQUAL(any, expected);
+    };
+
+    check(Tags { "sports" }, true);
+    check(Tags { "news", "filler150" }, true);
+    check(Tags { "sports", "adult" }, false);
+    check(Tags { "premium" }, false);
+    check(Tags { "premium", "video", "adult" }, true);
+    check(Tags { "filler199" }, false);
+    check(Tags(), false);
+
+    auto copy = TagFilterExpression::fromJson(expr.toJson());
+    BOOST_CHECK(copy.matches(Tags { "sports" }));
+    BOOST_CHECK(!copy.matches(Tags { "sports", "adult" }));
+
+    // No filters match everything.
+    BOOST_CHECK(TagFilterExpression().matches(Tags()));
+    BOOST_CHECK(TagFilterExpression::fromJson(Json::Value()).matches(Tags()));
+
+    // Not compiled yet.
+    TagFilterExpression uncompiled;
+    TagFilter filter;
+    filter.mustIncludeAllOf.add("premium");
+    uncompiled.push_back(filter);
+    BOOST_CHECK(uncompiled.matches(Tags { "premium" }));
+    BOOST_CHECK(!uncompiled.matches(Tags { "sports" }));
+
+    BOOST_CHECK_THROW(TagFilter::fromJson(Json::parse("{ \"some\": [] }")),
+                      ML::Exception);
+}
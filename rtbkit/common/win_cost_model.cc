@@ -31,8 +31,125 @@ struct AtInit {
       PluginInterface<WinCostModel>::registerPlugin("none", NoWinCostModel::evaluate);
     }
 } atInit;
+
 } // file scope
 
+struct WinCostModel::Binding {
+    std::string name;
+    Model model;
+};
+
+namespace {
+
+/** Models resolved so far, so that binding a model doesn't go through the
+    plugin table each time.  Plain models are bound once and shared while
+    compiled ones are built from the data of each model that's bound.
+*/
+struct Bindings {
+    struct Entry {
+        WinCostModel::Compiler compiler;
+        std::shared_ptr<const WinCostModel::Binding> plain;
+    };
+
+    std::mutex lock;
+    std::unordered_map<std::string, Entry> table;
+};
+
+Bindings & bindings()
+{
+    static Bindings result;
+    return result;
+}
+
+/** Same key as the plugin table: a "library.plugin" name is registered by
+    the library under the plugin name alone. */
+std::string bindingKey(const std::string & name)
+{
+    return name.substr(name.find('.') + 1);
+}
+
+} // file scope
+
+void
+WinCostModel::
+registerModel(const std::string & name, Model model)
+{
+    PluginInterface<WinCostModel>::registerPlugin(name, model);
+
+    Bindings & b = bindings();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.table.erase(bindingKey(name));
+}
+
+void
+WinCostModel::
+registerCompiler(const std::string & name, Compiler compiler)
+{
+    registerModel(name, [=] (WinCostModel const & model,
+                             Bid const & bid,
+                             Amount const & price)
+                  {
+                      return compiler(model.data)(model, bid, price);
+                  });
+
+    Bindings & b = bindings();
+    std::lock_guard<std::mutex> guard(b.lock);
+    b.table[bindingKey(name)].compiler = compiler;
+}
+
+void
+WinCostModel::
+bind() const
+{
+    Bindings & b = bindings();
+    Compiler compiler;
+
+    {
+        std::lock_guard<std::mutex> guard(b.lock);
+        auto it = b.table.find(bindingKey(name));
+        if(it != b.table.end()) {
+            if(it->second.plain) {
+                binding = it->second.plain;
+                return;
+            }
+            compiler = it->second.compiler;
+        }
+    }
+
+    auto result = std::make_shared<Binding>();
+    result->name = name;
+
+    if(compiler) {
+        result->model = compiler(data);
+    }
+    else if(name.empty()) {
+        result->model = NoWinCostModel::evaluate;
+    }
+    else {
+        // May load the plugin's library, which can register a compiler.
+        Model model = PluginInterface<WinCostModel>::getPlugin(name);
+        if(!model) {
+            throw ML::Exception("win cost model '%s' not found", name.c_str());
+        }
+
+        std::lock_guard<std::mutex> guard(b.lock);
+        auto & entry = b.table[bindingKey(name)];
+        if(entry.compiler) {
+            compiler = entry.compiler;
+        }
+        else {
+            result->model = std::move(model);
+            entry.plain = result;
+        }
+    }
+
+    if(compiler && !result->model) {
+        result->model = compiler(data);
+    }
+
+    binding = std::move(result);
+}
+
 WinCostModel::
 WinCostModel()
 {
@@ -53,12 +170,11 @@ evaluate(Bid const & bid, Amount const & price) const
         return NoWinCostModel::evaluate(*this, bid, price);
     }
 
-    auto model = PluginInterface<WinCostModel>::getPlugin(name);
-    if(!model) {
-        throw ML::Exception("win cost model '%s' not found", name.c_str());
+    if(!binding || binding->name != name) {
+        bind();
     }
 
-    return model(*this, bid, price);
+    return binding->model(*this, bid, price);
 }
 
 Json::Value
@@ -47,10 +47,31 @@ struct WinCostModel {
     // sense any longer  
     // so any use of it should be considered deprecated
     static void registerModel(const std::string & name,
-                              Model model)
-    {
-        PluginInterface<WinCostModel>::registerPlugin(name, model);
-    }
+                              Model model);
+
+    /** Builds the model from its data so that the parameters are parsed
+        once, when the model is bound, instead of on every evaluate().  The
+        built model still gets the WinCostModel, whose data can hold values
+        that are only known when it's evaluated (such as the win).
+    */
+    typedef std::function<Model (Json::Value const & data)> Compiler;
+
+    /** Registers a model built by the given compiler.  The model can also be
+        looked up as a plain model, in which case it's built on every call.
+    */
+    static void registerCompiler(const std::string & name,
+                                 Compiler compiler);
+
+    /** Resolves the model and builds it from the data ahead of evaluate(),
+        which otherwise does it on its first call.  Copies share the binding
+        so a model can be bound once and handed out.  Needs to be called
+        again after the data changes; a model that's shared between threads
+        should be bound before it's evaluated.
+    */
+    void bind() const;
+
+    /// Model resolved by bind()
+    struct Binding;
   
     // --- plugin interface init
     // plugin interface expects this type to be called Factory
@@ -64,6 +85,9 @@ struct WinCostModel {
 public:
     std::string name;
     Json::Value data;
+
+private:
+    mutable std::shared_ptr<const Binding> binding;
 };
 
 IMPL_SERIALIZE_RECONSTITUTE(WinCostModel);
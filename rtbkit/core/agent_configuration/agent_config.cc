@@ -99,6 +99,10 @@ fromJson(const Json::Value & val)
             exchangeFilter.fromJson(value, "exchangeFilter");
         else if (name == "fees")
             fees = Fees::createFees(val["fees"]);
+        else if (name == "tags")
+            tags = Tags::fromJson(value);
+        else if (name == "eligibilityFilter")
+            eligibilityFilter = TagFilterExpression::fromJson(value);
         else if (name == "segmentFilter") {
             jsonForeach(value, [&](const std::string& source, const Json::Value& segValue) {
                 segments[source].fromJson(segValue);
@@ -158,6 +162,10 @@ toJson() const
     }
     if (!dealId.empty())
         result["dealId"] = dealId;
+    if (!tags.empty())
+        result["tags"] = tags.toJson();
+    if (!eligibilityFilter.empty())
+        result["eligibilityFilter"] = eligibilityFilter.toJson();
 
     if (fees) {
         result["fees"] = fees->toJson();
@@ -442,12 +450,16 @@ AgentConfig(std::string name)
       roundRobinWeight(0),
       bidProbability(1.0), minTimeAvailableMs(5.0),
       maxInFlight(100),
+      maxQps(0.0),
       blacklistType(BL_OFF),
       blacklistScope(BL_ACCOUNT), blacklistTime(15.0),
       bidControlType(BC_RELAY), fixedBidCpmInMicros(0),
       winFormat(BRF_FULL),
       lossFormat(BRF_LIGHTWEIGHT),
       errorFormat(BRF_LIGHTWEIGHT),
+      bidRequestFormat(BRQF_JSON),
+      lossNotifications(LN_EACH),
+      lossBatchMs(100),
       name(name)
 {
     addAugmentation("random");
@@ -573,6 +585,51 @@ void fromJson(BidResultFormat & fmt, const Json::Value & j)
                              "full, lightweight, none");
 }
 
+Json::Value toJson(BidRequestFormat fmt)
+{
+    switch (fmt) {
+    case BRQF_JSON:    return "json";
+    case BRQF_BINARY:  return "binary";
+    default:
+        throw ML::Exception("unknown BidRequestFormat");
+    }
+}
+
+void fromJson(BidRequestFormat & fmt, const Json::Value & j)
+{
+    string s = lowercase(j.asString());
+    if (s == "json")
+        fmt = BRQF_JSON;
+    else if (s == "binary")
+        fmt = BRQF_BINARY;
+    else throw ML::Exception("unknown BidRequestFormat " + s + ": accepted "
+                             "json, binary");
+}
+
+Json::Value toJson(LossNotifications ln)
+{
+    switch (ln) {
+    case LN_EACH:     return "each";
+    case LN_BATCHED:  return "batched";
+    case LN_COUNT:    return "count";
+    default:
+        throw ML::Exception("unknown LossNotifications");
+    }
+}
+
+void fromJson(LossNotifications & ln, const Json::Value & j)
+{
+    string s = lowercase(j.asString());
+    if (s == "each")
+        ln = LN_EACH;
+    else if (s == "batched")
+        ln = LN_BATCHED;
+    else if (s == "count")
+        ln = LN_COUNT;
+    else throw ML::Exception("unknown LossNotifications " + s + ": accepted "
+                             "each, batched, count");
+}
+
 void
 AgentConfig::
 fromJson(const Json::Value & json)
@@ -653,6 +710,12 @@ createFromJson(const Json::Value & json)
                 throw Exception("minTimeAvailableMs %f should be not less than 0",
                                 newConfig.minTimeAvailableMs);
         }
+        else if (it.memberName() == "maxQps") {
+            newConfig.maxQps = it->asDouble();
+            if (newConfig.maxQps < 0)
+                throw Exception("maxQps %f should be not less than 0",
+                                newConfig.maxQps);
+        }
         else if (it.memberName() == "maxInFlight") {
             newConfig.maxInFlight = it->asInt();
             if (newConfig.maxInFlight < 0)
@@ -781,6 +844,18 @@ createFromJson(const Json::Value & json)
         else if (it.memberName() == "errorFormat") {
             RTBKIT::fromJson(newConfig.errorFormat, *it);
         }
+        else if (it.memberName() == "bidRequestFormat") {
+            RTBKIT::fromJson(newConfig.bidRequestFormat, *it);
+        }
+        else if (it.memberName() == "lossNotifications") {
+            RTBKIT::fromJson(newConfig.lossNotifications, *it);
+        }
+        else if (it.memberName() == "lossBatchMs") {
+            newConfig.lossBatchMs = it->asInt();
+            if (newConfig.lossBatchMs <= 0)
+                throw Exception("lossBatchMs %d should be positive",
+                                newConfig.lossBatchMs);
+        }
         else if (it.memberName() == "ext") {
             newConfig.ext = *it;
         }
@@ -833,6 +908,8 @@ toJson(bool includeCreatives) const
     result["minTimeAvailableMs"] = minTimeAvailableMs;
     if (maxInFlight != 100)
         result["maxInFlight"] = maxInFlight;
+    if (maxQps != 0.0)
+        result["maxQps"] = maxQps;
 
     if (!bidderInterface.empty())
         result["bidderInterface"] = bidderInterface;
@@ -930,6 +1007,11 @@ toJson(bool includeCreatives) const
     result["winFormat"] = RTBKIT::toJson(winFormat);
     result["lossFormat"] = RTBKIT::toJson(lossFormat);
     result["errorFormat"] = RTBKIT::toJson(errorFormat);
+    result["bidRequestFormat"] = RTBKIT::toJson(bidRequestFormat);
+    if (lossNotifications != LN_EACH) {
+        result["lossNotifications"] = RTBKIT::toJson(lossNotifications);
+        result["lossBatchMs"] = lossBatchMs;
+    }
 
     for (const auto& extension: extensions.list()) {
         result[extension->extensionName()] = extension->toJson();
@@ -280,6 +280,25 @@ enum BidResultFormat {
 Json::Value toJson(BidResultFormat fmt);
 void fromJson(BidResultFormat & fmt, const Json::Value & j);
 
+/** Encoding of the bid requests sent to the agent. */
+enum BidRequestFormat {
+    BRQF_JSON,        ///< Request as received from the exchange
+    BRQF_BINARY       ///< BidRequest::serialize(); no JSON parse needed
+};
+
+Json::Value toJson(BidRequestFormat fmt);
+void fromJson(BidRequestFormat & fmt, const Json::Value & j);
+
+/** How the agent is told about the bids it lost in the router's auction. */
+enum LossNotifications {
+    LN_EACH,          ///< A LOSS message per bid
+    LN_BATCHED,       ///< A LOSSES message with the auction ids, periodically
+    LN_COUNT          ///< A LOSSES message with only their number
+};
+
+Json::Value toJson(LossNotifications ln);
+void fromJson(LossNotifications & ln, const Json::Value & j);
+
 /*****************************************************************************/
 /* AGENT CONFIG                                                              */
 /*****************************************************************************/
@@ -312,6 +331,9 @@ struct AgentConfig {
 
     int maxInFlight;
 
+    /// Maximum rate of bid requests sent to the agent; 0 means no limit.
+    double maxQps;
+
     std::string bidderInterface;
 
     std::vector<std::string> requiredIds;
@@ -427,6 +449,13 @@ struct AgentConfig {
 
     /** Message formats */
     BidResultFormat winFormat, lossFormat, errorFormat;
+    BidRequestFormat bidRequestFormat;
+
+    /** Losses are sent together at most every lossBatchMs milliseconds
+        unless lossNotifications is LN_EACH.
+    */
+    LossNotifications lossNotifications;
+    int lossBatchMs;
     //
     Json::Value ext;
 
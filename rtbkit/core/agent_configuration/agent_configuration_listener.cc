@@ -8,6 +8,17 @@
 #include "agent_configuration_listener.h"
 #include "agent_config.h"
 
+#include "jml/arch/format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sys/utsname.h>
+#include <unistd.h>
+
 namespace RTBKIT {
 
 
@@ -74,12 +85,20 @@ onMessage(const std::vector<std::string> & message)
     const std::string & agent = message.at(1);
     const std::string & configStr = message.at(2);
 
+    unconfirmed.erase(agent);
+
     std::shared_ptr<AgentConfig> config;
 
     if (!configStr.empty()) {
+        auto it = configStrs.find(agent);
+        if (it != configStrs.end() && it->second == configStr)
+            return;
+
         Json::Value j = Json::parse(configStr);
         config.reset(new AgentConfig(AgentConfig::createFromJson(j)));
+        configStrs[agent] = configStr;
     }
+    else configStrs.erase(agent);
 
     /* Now, update the current configuration list */
 
@@ -128,7 +147,234 @@ onMessage(const std::vector<std::string> & message)
 
     if (onConfigChange)
         onConfigChange(agent, config);
+
+    if (!snapshotPath.empty())
+        saveSnapshot();
+}
+
+void
+AgentConfigurationListener::
+loadSnapshot()
+{
+    using namespace std;
+
+    ifstream stream(snapshotPath);
+    if (!stream) return;
+
+    Json::Value snapshot;
+    try {
+        snapshot = Json::parse(string(istreambuf_iterator<char>(stream),
+                                      istreambuf_iterator<char>()));
+    } catch (const std::exception & exc) {
+        cerr << "ignoring agent configuration snapshot " << snapshotPath
+             << ": " << exc.what() << endl;
+        return;
+    }
+
+    std::string path;
+    swap(path, snapshotPath); // don't rewrite it as we load it
+
+    for (auto it = snapshot.begin(), end = snapshot.end(); it != end; ++it) {
+        string agent = it.memberName();
+        try {
+            onMessage({ "CONFIG", agent, (*it).asString() });
+            unconfirmed.insert(agent);
+        } catch (const std::exception & exc) {
+            cerr << "ignoring snapshot configuration of agent " << agent
+                 << ": " << exc.what() << endl;
+        }
+    }
+
+    swap(path, snapshotPath);
+
+    cerr << "loaded " << unconfirmed.size()
+         << " agent configurations from " << snapshotPath << endl;
+
+    if (unconfirmed.empty()) return;
+
+    addPeriodic("AgentConfigurationListener::expireSnapshot",
+                snapshotGracePeriod,
+                [=] (uint64_t) { this->expireSnapshot(); });
+}
+
+void
+AgentConfigurationListener::
+saveSnapshot() const
+{
+    Json::Value snapshot(Json::objectValue);
+    for (const auto & entry: configStrs)
+        snapshot[entry.first] = entry.second;
+
+    // Written aside then moved over so a crash never leaves half a file.
+    std::string tmpPath = snapshotPath + ".tmp";
+    {
+        std::ofstream stream(tmpPath);
+        stream << snapshot.toString();
+        if (!stream) {
+            std::cerr << "couldn't write agent configuration snapshot "
+                      << tmpPath << std::endl;
+            return;
+        }
+    }
+
+    if (rename(tmpPath.c_str(), snapshotPath.c_str()) == -1) {
+        std::cerr << "couldn't write agent configuration snapshot "
+                  << snapshotPath << ": " << strerror(errno) << std::endl;
+    }
+}
+
+void
+AgentConfigurationListener::
+expireSnapshot()
+{
+    std::vector<std::string> agents(unconfirmed.begin(), unconfirmed.end());
+    unconfirmed.clear();
+
+    for (const auto & agent: agents) {
+        std::cerr << "agent " << agent << " from the configuration snapshot "
+                  << "is gone" << std::endl;
+        onMessage({ "CONFIG", agent, "" });
+    }
+}
+
+
+/*****************************************************************************/
+/* AGENT BRIDGE                                                              */
+/*****************************************************************************/
+
+void
+AgentBridge::
+enableShm(std::shared_ptr<ConfigurationService> config,
+          const std::string & serviceName)
+{
+    std::string name = serviceName;
+    std::replace(name.begin(), name.end(), '/', '_');
+
+    shmWakeup = ShmWakeup::create(
+            ML::format("/dev/shm/rtbkit-%d-%s.wakeup", getpid(), name.c_str()));
+
+    utsname host;
+    if (uname(&host) == -1)
+        throw ML::Exception(errno, "uname");
+
+    Json::Value value;
+    value["hostScope"] = host.nodename;
+    config->setUnique(serviceName + "/agentsShm", value);
 }
 
+bool
+AgentBridge::
+acceptShm(const std::string & agent, const std::string & agentWakeupPath)
+{
+    if (!shmWakeup) return false;
+
+    static std::atomic<int> numChannels(0);
+    int n = numChannels++;
+
+    std::string toAgent = ML::format("/rtbkit-%d-%d-out", getpid(), n);
+    std::string fromAgent = ML::format("/rtbkit-%d-%d-in", getpid(), n);
+
+    // The agent unlinks the rings once it has them mapped; they're also
+    // unlinked when we drop the channel in case it never does.
+    auto channel = std::make_shared<ShmChannel>(
+            ShmRing::create(toAgent, shmRingCapacity),
+            ShmRing::create(fromAgent, shmRingCapacity),
+            ShmWakeup::open(agentWakeupPath));
+
+    {
+        std::unique_lock<std::mutex> guard(shmLock);
+        shmChannels[agent] = channel;
+    }
+    unsubscribeBroadcast(agent);
+
+    // Anything sent from now on waits in the ring until the agent has read
+    // this, so it can't overtake what's still on the bus.
+    agents.sendMessage(agent, "SHM_READY", toAgent, fromAgent,
+                       shmWakeup->path());
+
+    std::cerr << "agent " << agent << " switched to shared memory" << std::endl;
+    return true;
+}
+
+void
+AgentBridge::
+removeShm(const std::string & agent)
+{
+    std::unique_lock<std::mutex> guard(shmLock);
+    shmChannels.erase(agent);
+}
+
+void
+AgentBridge::
+receiveShm(std::vector<std::vector<std::string> > & messages)
+{
+    std::unique_lock<std::mutex> guard(shmLock);
+
+    std::vector<std::string> message;
+    for (auto & entry: shmChannels) {
+        while (entry.second->receive(message)) {
+            message.insert(message.begin(), entry.first);
+            messages.emplace_back(std::move(message));
+        }
+    }
+}
+
+size_t
+AgentBridge::
+numShmAgents() const
+{
+    std::unique_lock<std::mutex> guard(shmLock);
+    return shmChannels.size();
+}
+
+void
+AgentBridge::
+enableBroadcast(std::shared_ptr<ConfigurationService> config,
+                const std::string & serviceName,
+                const PortRange & ports)
+{
+    broadcast.reset(new ZmqNamedPublisher(context));
+    broadcast->init(config, serviceName + "/agentsBroadcast");
+    broadcast->bindTcp(ports);
+    broadcast->start();
+}
+
+bool
+AgentBridge::
+subscribeBroadcast(const std::string & agent)
+{
+    if (!broadcast || getShmChannel(agent)) return false;
+
+    int slot;
+    {
+        std::unique_lock<std::mutex> guard(broadcastLock);
+        auto it = broadcastSlots.find(agent);
+        if (it != broadcastSlots.end())
+            slotsUsed[it->second] = false;
+
+        // Reuse the lowest free slot so that the bitmaps stay short
+        slot = std::find(slotsUsed.begin(), slotsUsed.end(), false)
+            - slotsUsed.begin();
+        if (slot == (int)slotsUsed.size())
+            slotsUsed.push_back(true);
+        else slotsUsed[slot] = true;
+
+        broadcastSlots[agent] = slot;
+    }
+
+    agents.sendMessage(agent, "BROADCAST_READY", slot);
+    return true;
+}
+
+void
+AgentBridge::
+unsubscribeBroadcast(const std::string & agent)
+{
+    std::unique_lock<std::mutex> guard(broadcastLock);
+    auto it = broadcastSlots.find(agent);
+    if (it == broadcastSlots.end()) return;
+    slotsUsed[it->second] = false;
+    broadcastSlots.erase(it);
+}
 
 } // namespace RTBKIT
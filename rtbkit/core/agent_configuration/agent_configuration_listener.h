@@ -8,9 +8,13 @@
 #pragma once
 
 #include "soa/service/zmq_endpoint.h"
+#include "soa/service/zmq_named_pub_sub.h"
+#include "soa/service/shm_ring.h"
 #include "rtbkit/core/router/router_types.h"
 #include "soa/gc/rcu_protected.h"
 
+#include <unordered_set>
+
 
 namespace RTBKIT {
 
@@ -48,7 +52,9 @@ struct AllAgentConfig : public std::vector<AgentConfigEntry> {
 struct AgentConfigurationListener: public MessageLoop {
 
     AgentConfigurationListener(std::shared_ptr<zmq::context_t> context)
-        : allAgents(new AllAgentConfig()), configEndpoint(context)
+        : allAgents(new AllAgentConfig()),
+          snapshotGracePeriod(DefaultSnapshotGracePeriod),
+          configEndpoint(context)
     {
     }
 
@@ -83,8 +89,24 @@ struct AgentConfigurationListener: public MessageLoop {
         addSource("AgentConfigurationListener::configEndpoint", configEndpoint);
     }
 
+    enum { DefaultSnapshotGracePeriod = 30 };
+
+    /** Keep a copy of the configuration of every agent in the given file,
+        and start from the copy that's there, if any, instead of waiting for
+        the configuration service.  Agents of the copy whose configuration
+        isn't sent again by the service within the grace period are
+        considered gone.  Must be called before start().
+    */
+    void setSnapshot(const std::string & path,
+                     double gracePeriod = DefaultSnapshotGracePeriod)
+    {
+        snapshotPath = path;
+        snapshotGracePeriod = gracePeriod;
+    }
+
     void start()
     {
+        if (!snapshotPath.empty()) loadSnapshot();
         MessageLoop::start();
     }
 
@@ -119,21 +141,149 @@ private:
     AllAgentConfig * allAgents;
     mutable GcLock allAgentsGc;
 
+    /** Last configuration string received for each agent.  The service
+        replays every configuration when we reconnect, so the ones that
+        didn't change are dropped before being parsed.  Only touched by the
+        message loop.
+    */
+    std::unordered_map<std::string, std::string> configStrs;
+
+    void loadSnapshot();
+    void saveSnapshot() const;
+    void expireSnapshot();
+
+    std::string snapshotPath;
+    double snapshotGracePeriod;
+
+    /** Agents loaded from the snapshot that the service hasn't confirmed
+        yet.  Only touched by the message loop.
+    */
+    std::unordered_set<std::string> unconfirmed;
+
     ZmqNamedClientBusProxy configEndpoint;
 };
 
+
+/*****************************************************************************/
+/* AGENT BRIDGE                                                              */
+/*****************************************************************************/
+
+/** Messages between a service and its bidding agents.  They go over the
+    agents bus, except for the agents on the same host that asked for a
+    shared memory channel once it's enabled; these get the same messages
+    through a pair of rings instead.
+
+    Setting up a channel goes as follows:
+    - the service publishes its host under <service>/agentsShm;
+    - an agent on that host sends SHM_CONNECT over the bus with the path of
+      the pipe it waits on;
+    - the service creates the rings and answers SHM_READY with their names
+      and the path of its own pipe, after which everything but the
+      heartbeats goes through the rings.
+
+    Bid requests can also be broadcast to the agents, to send a request
+    matched by many agents only once:
+    - the service publishes on <service>/agentsBroadcast;
+    - an agent subscribes to it then sends BROADCAST_SUBSCRIBE over the bus;
+    - the service gives the agent a slot with BROADCAST_READY;
+    - each AUCTION published carries a bitmap of the slots of the agents it
+      is for, followed by the name and the frames specific to each of these
+      agents in the order of their slots.
+    Agents on shared memory don't get a slot.  Auctions published before
+    the agent's subscription has reached the service are lost, as are the
+    ones an agent too far behind can't take.
+*/
+
 struct AgentBridge {
     AgentBridge(std::shared_ptr<zmq::context_t> context) :
-        agents(context) {
+        agents(context), shmRingCapacity(DefaultShmRingCapacity),
+        broadcastMinAgents(DefaultBroadcastMinAgents), context(context) {
     }
 
     void shutdown() {
         agents.shutdown();
+        if (broadcast)
+            broadcast->shutdown();
+        std::unique_lock<std::mutex> guard(shmLock);
+        shmChannels.clear();
     }
 
     /// Messages to the agents go out on this
     ZmqNamedClientBus agents;
 
+    enum { DefaultShmRingCapacity = 8 << 20 };
+
+    /** Accept shared memory channels from the agents on this host, which
+        is advertised in the configuration service under the given service
+        name.  Must be called after agents.init().
+    */
+    void enableShm(std::shared_ptr<ConfigurationService> config,
+                   const std::string & serviceName);
+
+    /** Bytes of messages each ring of a channel can hold. */
+    size_t shmRingCapacity;
+
+    /** Pipe signalled when messages come in through shared memory, or null
+        if it isn't enabled.
+    */
+    std::shared_ptr<ShmWakeup> shmWakeup;
+
+    /** Handle an SHM_CONNECT from the given agent.  Returns false, leaving
+        the agent on the bus, if shared memory isn't enabled.
+    */
+    bool acceptShm(const std::string & agent,
+                   const std::string & agentWakeupPath);
+
+    /** Go back to the bus for the given agent. */
+    void removeShm(const std::string & agent);
+
+    /** Take the messages the agents sent through shared memory, each with
+        the name of its agent in front as they come from the bus.
+    */
+    void receiveShm(std::vector<std::vector<std::string> > & messages);
+
+    /** Number of agents using shared memory. */
+    size_t numShmAgents() const;
+
+    enum { DefaultBroadcastMinAgents = 2 };
+
+    /** Publish bid requests on <serviceName>/agentsBroadcast, bound to a
+        port in the given range.
+    */
+    void enableBroadcast(std::shared_ptr<ConfigurationService> config,
+                         const std::string & serviceName,
+                         const PortRange & ports);
+
+    /** Fewest agents with a slot an auction must go to for it to be
+        broadcast rather than sent to each of them.
+    */
+    int broadcastMinAgents;
+
+    /** Handle a BROADCAST_SUBSCRIBE from the given agent by giving it a
+        slot.  Returns false if broadcast isn't enabled or the agent is on
+        shared memory.
+    */
+    bool subscribeBroadcast(const std::string & agent);
+
+    /** Free the slot of the given agent. */
+    void unsubscribeBroadcast(const std::string & agent);
+
+    /** Slot of the given agent, or -1 if it doesn't have one. */
+    int broadcastSlot(const std::string & agent) const
+    {
+        if (!broadcast) return -1;
+        std::unique_lock<std::mutex> guard(broadcastLock);
+        auto it = broadcastSlots.find(agent);
+        return it == broadcastSlots.end() ? -1 : it->second;
+    }
+
+    /** Publish the given message to the subscribed agents.  Thread safe. */
+    template<typename... Args>
+    void broadcastMessage(const std::string & channel, Args&&... args)
+    {
+        broadcast->publish(channel, std::forward<Args>(args)...);
+    }
+
     /** Send the given message to the given bidding agent. */
     template<typename... Args>
     void sendAgentMessage(const std::string & agent,
@@ -141,6 +291,13 @@ struct AgentBridge {
                           const Date & date,
                           Args... args)
     {
+        if (shmWakeup) {
+            if (auto channel = getShmChannel(agent)) {
+                channel->sendMessage(messageType, date,
+                                     std::forward<Args>(args)...);
+                return;
+            }
+        }
         agents.sendMessage(agent, messageType, date,
                            std::forward<Args>(args)...);
     }
@@ -153,9 +310,36 @@ struct AgentBridge {
                           const Date & date,
                           Args... args)
     {
+        if (shmWakeup) {
+            if (auto channel = getShmChannel(agent)) {
+                channel->sendMessage(eventType, messageType, date,
+                                     std::forward<Args>(args)...);
+                return;
+            }
+        }
         agents.sendMessage(agent, eventType, messageType, date,
                            std::forward<Args>(args)...);
     }
+
+private:
+    std::shared_ptr<ShmChannel> getShmChannel(const std::string & agent) const
+    {
+        std::unique_lock<std::mutex> guard(shmLock);
+        auto it = shmChannels.find(agent);
+        if (it == shmChannels.end())
+            return nullptr;
+        return it->second;
+    }
+
+    mutable std::mutex shmLock;
+    std::map<std::string, std::shared_ptr<ShmChannel> > shmChannels;
+
+    std::shared_ptr<zmq::context_t> context;
+    std::unique_ptr<ZmqNamedPublisher> broadcast;
+
+    mutable std::mutex broadcastLock;
+    std::map<std::string, int> broadcastSlots;
+    std::vector<bool> slotsUsed;
 };
 
 
@@ -68,7 +68,7 @@ init()
             for (auto & a: agentInfo) {
                 if (!a.second.config.isNull())
                     listeners.sendMessage(listener, "CONFIG", a.first,
-                                          a.second.config.toString());
+                                          a.second.configStr);
             }
         };
 
@@ -238,10 +238,11 @@ handleAgentConfig(const std::string & agent,
         return;
 
     info.config = config;
+    info.configStr = config.toString();
 
     // Broadcast the configuration to all listeners
     for (auto & l: listenerInfo)
-        listeners.sendMessage(l.first, "CONFIG", agent, config.toString());
+        listeners.sendMessage(l.first, "CONFIG", agent, info.configStr);
 }
 
 void
@@ -7,6 +7,7 @@
 
 #include "blacklist.h"
 #include "agent_config.h"
+#include "jml/utils/exc_check.h"
 
 namespace RTBKIT {
 
@@ -57,10 +58,13 @@ bool
 BlacklistInfo::
 matches(const BidRequest & bidRequest,
         const std::string & agent,
-        const AgentConfig & config) const
+        const AgentConfig & config,
+        Date now) const
 {
     auto matchesEntry = [&] (const Entry & entry) -> bool
         {
+            if (entry.expiry <= now) return false;
+
             switch (config.blacklistScope) {
                 case BL_AGENT:
                     return entry.agent == agent;
@@ -95,19 +99,117 @@ matches(const BidRequest & bidRequest,
     }
 }
 
+
+/*****************************************************************************/
+/* BLACKLIST                                                                 */
+/*****************************************************************************/
+
+Blacklist::
+Blacklist()
+    : shards(NumShards), numUsers(0), lastSwept(-1)
+{
+}
+
 void
 Blacklist::
-doExpiries()
+useHugePages(ML::Huge_Page_Mode mode)
 {
-    Date start = Date::now();
+    ExcCheck(numUsers == 0, "huge pages must be set up on an empty blacklist");
 
-    auto onBlacklistFinished = [&] (const Id & userId,
-                                    BlacklistInfo & info)
-        {
-            return info.expire(start);
-        };
+    // All of the shards share the arena; adding to the blacklist is rare
+    // enough that its lock doesn't matter.
+    auto arena = ML::huge_page_arena(mode);
+    for (auto & shard: shards) {
+        std::lock_guard<ML::Spinlock> guard(shard.lock);
+        shard.users = Users(0, std::hash<Id>(), std::equal_to<Id>(), arena);
+    }
+}
+
+Blacklist::Shard &
+Blacklist::
+shardFor(const Id & id)
+{
+    // The low bits of the hash are used by the buckets of the map.
+    return shards[(id.hash() >> 32) % NumShards];
+}
+
+const Blacklist::Shard &
+Blacklist::
+shardFor(const Id & id) const
+{
+    return shards[(id.hash() >> 32) % NumShards];
+}
 
-    entries.expire(onBlacklistFinished, start);
+size_t
+Blacklist::
+slotOf(Date date)
+{
+    return size_t(date.secondsSinceEpoch()) % WheelSlots;
+}
+
+void
+Blacklist::
+schedule(Shard & shard, const Id & id, Date expiry)
+{
+    shard.wheel[slotOf(expiry)].push_back(Timer{ id, expiry });
+}
+
+void
+Blacklist::
+expireSlot(Shard & shard, size_t slot, Date now)
+{
+    std::vector<Timer> & timers = shard.wheel[slot];
+
+    for (unsigned i = 0;  i < timers.size();  /* no inc */) {
+        Timer timer = timers[i];
+
+        // Due on a later turn of the wheel.
+        if (timer.expiry > now) {
+            ++i;
+            continue;
+        }
+
+        std::swap(timers[i], timers.back());
+        timers.pop_back();
+
+        auto it = shard.users.find(timer.id);
+        if (it == shard.users.end()) continue;
+
+        // The user's earliest expiry has since moved and was rescheduled.
+        BlacklistInfo & info = it->second;
+        if (info.earliestExpiry != timer.expiry) continue;
+
+        Date next = info.expire(now);
+        if (next == Date()) {
+            shard.users.erase(it);
+            --numUsers;
+        }
+        else {
+            info.earliestExpiry = next;
+            schedule(shard, timer.id, next);
+        }
+    }
+}
+
+void
+Blacklist::
+doExpiries(Date now)
+{
+    int64_t second = now.secondsSinceEpoch();
+    if (lastSwept == -1) lastSwept = second - WheelSlots;
+
+    // Past a whole turn, every slot needs to be looked at once.
+    int64_t first = std::max<int64_t>(lastSwept + 1, second - WheelSlots + 1);
+
+    for (auto & shard: shards) {
+        std::lock_guard<ML::Spinlock> guard(shard.lock);
+        for (int64_t s = first;  s <= second;  ++s)
+            expireSlot(shard, s % WheelSlots, now);
+    }
+
+    // Timers due later in the current second still need to be looked at
+    // by the next sweep.
+    lastSwept = second - 1;
 }
 
 bool
@@ -115,29 +217,22 @@ Blacklist::
 matches(const BidRequest & bidRequest, const std::string & agentName,
         const AgentConfig & config) const
 {  
-    bool blocked = false;
-    const Id & exchangeId = bidRequest.userIds.exchangeId;
-    if (!blocked && exchangeId) {
-        // TODO: read lock
-        auto bit = entries.find(exchangeId);
-        if (bit != entries.end()) {
-            const BlacklistInfo & binfo = bit->second;
-            if (binfo.matches(bidRequest, agentName, config))
-                blocked = true;
-        }
-    }
-    const Id & providerId = bidRequest.userIds.providerId;
-    if (!blocked && providerId) {
-        // TODO: read lock
-        auto bit = entries.find(providerId);
-        if (bit != entries.end()) {
-            const BlacklistInfo & binfo = bit->second;
-            if (binfo.matches(bidRequest, agentName, config))
-                blocked = true;
-        }
-    }
+    Date now = Date::now();
+
+    auto matchesId = [&] (const Id & id) -> bool
+        {
+            if (!id) return false;
 
-    return blocked;
+            const Shard & shard = shardFor(id);
+            std::lock_guard<ML::Spinlock> guard(shard.lock);
+
+            auto it = shard.users.find(id);
+            if (it == shard.users.end()) return false;
+            return it->second.matches(bidRequest, agentName, config, now);
+        };
+
+    return matchesId(bidRequest.userIds.exchangeId)
+        || matchesId(bidRequest.userIds.providerId);
 }
 
 void
@@ -145,22 +240,32 @@ Blacklist::
 add(const BidRequest & bidRequest, const std::string & agent,
     const AgentConfig & agentConfig)
 {
+    Date now = Date::now();
+
     auto addToBlacklist = [&] (const Id & id)
         {
             if (!id) return;
 
-            auto it = this->entries.find(id);
-            if (it != this->entries.end()) {
-                Date newExpiry
-                    = it->second.add(bidRequest, agent, agentConfig);
-                if (newExpiry != Date())
-                    this->entries.updateTimeout(it, newExpiry);
-            }
-            else {
-                BlacklistInfo binfo;
-                Date timeout = binfo.add(bidRequest, agent, agentConfig);
-                this->entries.insert(id, binfo, timeout);
+            Shard & shard = shardFor(id);
+            std::lock_guard<ML::Spinlock> guard(shard.lock);
+
+            auto res = shard.users.insert(std::make_pair(id, BlacklistInfo()));
+            BlacklistInfo & info = res.first->second;
+            if (res.second) ++numUsers;
+
+            // Drop what expired since the last sweep; the timer of the
+            // earliest expiry stays valid if there's anything left.
+            else if (info.earliestExpiry <= now) {
+                Date next = info.expire(now);
+                if (next != Date()) {
+                    info.earliestExpiry = next;
+                    schedule(shard, id, next);
+                }
             }
+
+            Date newExpiry = info.add(bidRequest, agent, agentConfig);
+            if (newExpiry != Date())
+                schedule(shard, id, newExpiry);
         };
     
     addToBlacklist(bidRequest.userIds.exchangeId);
@@ -10,9 +10,12 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <unordered_map>
 #include "rtbkit/common/bid_request.h"
 #include "rtbkit/core/router/router_types.h"
-#include "soa/service/timeout_map.h"
+#include "jml/arch/spinlock.h"
+#include "jml/arch/huge_page_allocator.h"
 
 
 namespace RTBKIT {
@@ -37,10 +40,13 @@ struct BlacklistInfo {
     std::vector<Entry> entries;
     Date earliestExpiry;
 
-    /* Does the given agent and bid request match the blacklist? */
+    /* Does the given agent and bid request match the blacklist?  Entries
+       that expired before now are ignored.
+    */
     bool matches(const BidRequest & request,
                  const std::string & agent,
-                 const AgentConfig & agentConfig) const;
+                 const AgentConfig & agentConfig,
+                 Date now = Date()) const;
         
     /** Add the given entry to the blacklist.  Returns Date() if the
         entry is not the earliest expiring entry, or the date of the
@@ -61,11 +67,37 @@ struct BlacklistInfo {
 /* BLACKLIST                                                                 */
 /*****************************************************************************/
 
-/** Indexed on user ID */
+/** Indexed on user ID.
+
+    The users are spread over a fixed number of shards, each with its own
+    hash map and lock, so that the auction shards checking the blacklist
+    and the bids adding to it only contend when they hit the same shard and
+    then only for the time of a hash lookup. All the methods are thread
+    safe.
+
+    The expiries are kept in a timer wheel per shard with one slot per
+    second: a user is put in the slot of its earliest expiry, and
+    doExpiries() only goes through the slots of the seconds that went by
+    since it last ran. Expiries further away than the wheel goes around
+    stay in their slot until their turn comes up. Entries that expired but
+    haven't been swept yet are ignored by matches() and dropped when the
+    user is added to again, so the sweeps can run late without blacklisting
+    anyone for longer.
+*/
 struct Blacklist {
-    void doExpiries();
+    Blacklist();
+
+    /** Expires the entries that are due.  Must not be called by more than
+        one thread at a time.
+    */
+    void doExpiries(Date now = Date::now());
+
+    size_t size() const { return numUsers; }
 
-    size_t size() const { return entries.size(); }
+    /** Puts the users on huge pages of the given mode.  Must be called
+        while the blacklist is empty.
+    */
+    void useHugePages(ML::Huge_Page_Mode mode);
     
     bool matches(const BidRequest & request,
                  const std::string & agentName,
@@ -74,9 +106,42 @@ struct Blacklist {
     void add(const BidRequest & bidRequest,
              const std::string & agent,
              const AgentConfig & agentConfig);
-    
-    typedef TimeoutMap<Id, BlacklistInfo> Entries;
-    Entries entries;
+
+    enum {
+        NumShards = 64,
+        WheelSlots = 1024      ///< Seconds covered by a turn of the wheel
+    };
+
+private:
+    struct Timer {
+        Id id;
+        Date expiry;
+    };
+
+    typedef std::unordered_map<
+        Id, BlacklistInfo, std::hash<Id>, std::equal_to<Id>,
+        ML::Huge_Page_Allocator< std::pair<const Id, BlacklistInfo> > > Users;
+
+    struct Shard {
+        Shard() : wheel(WheelSlots) {}
+
+        mutable ML::Spinlock lock;
+        Users users;
+        std::vector< std::vector<Timer> > wheel;
+    };
+
+    Shard & shardFor(const Id & id);
+    const Shard & shardFor(const Id & id) const;
+
+    static size_t slotOf(Date date);
+    static void schedule(Shard & shard, const Id & id, Date expiry);
+
+    /** Expires the users in the timers of the slot that are due. */
+    void expireSlot(Shard & shard, size_t slot, Date now);
+
+    std::vector<Shard> shards;
+    std::atomic<size_t> numUsers;
+    int64_t lastSwept;         ///< Last second fully swept by doExpiries()
 };
 
 } // namespace RTBKIT
@@ -9,14 +9,18 @@
 #define __rtb_router__include_exclude_h__
 
 #include "jml/arch/exception.h"
-#include "jml/utils/lightweight_hash.h"
+#include "jml/utils/group_hash.h"
 #include "soa/types/url.h"
 #include "soa/jsoncpp/value.h"
 #include <boost/regex.hpp>
 #include <boost/regex/icu.hpp>
 #include "soa/types/string.h"
+#include "intern_pool.h"
 #include <vector>
 #include <set>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
 #include <iostream>
 
 
@@ -32,12 +36,57 @@ inline bool matches(const T & t1, const T & t2)
     return t1 == t2;
 }
 
+/** Iterates over an ASCII string as UTF-32 code points, so that regexes can
+    run over it without going through the UTF-8 decoder.
+*/
+struct AsciiCodePointIterator
+    : public std::iterator<std::random_access_iterator_tag, UChar32,
+                           std::ptrdiff_t, const UChar32 *, UChar32>
+{
+    AsciiCodePointIterator(const char * p = 0)
+        : p(p)
+    {
+    }
+
+    UChar32 operator * () const { return (unsigned char)*p; }
+    UChar32 operator [] (std::ptrdiff_t n) const { return (unsigned char)p[n]; }
+
+    AsciiCodePointIterator & operator ++ () { ++p;  return *this; }
+    AsciiCodePointIterator & operator -- () { --p;  return *this; }
+    AsciiCodePointIterator operator ++ (int) { return AsciiCodePointIterator(p++); }
+    AsciiCodePointIterator operator -- (int) { return AsciiCodePointIterator(p--); }
+
+    AsciiCodePointIterator & operator += (std::ptrdiff_t n) { p += n;  return *this; }
+    AsciiCodePointIterator & operator -= (std::ptrdiff_t n) { p -= n;  return *this; }
+    AsciiCodePointIterator operator + (std::ptrdiff_t n) const { return p + n; }
+    AsciiCodePointIterator operator - (std::ptrdiff_t n) const { return p - n; }
+    std::ptrdiff_t operator - (const AsciiCodePointIterator & other) const
+    {
+        return p - other.p;
+    }
+
+    bool operator == (const AsciiCodePointIterator & other) const { return p == other.p; }
+    bool operator != (const AsciiCodePointIterator & other) const { return p != other.p; }
+    bool operator < (const AsciiCodePointIterator & other) const { return p < other.p; }
+    bool operator > (const AsciiCodePointIterator & other) const { return p > other.p; }
+    bool operator <= (const AsciiCodePointIterator & other) const { return p <= other.p; }
+    bool operator >= (const AsciiCodePointIterator & other) const { return p >= other.p; }
+
+private:
+    const char * p;
+};
+
 inline bool matches(const boost::u32regex & rex, const Utf8String & val)
 {
-    std::string raw(val.rawData(), val.rawLength());
-    boost::match_results<std::string::const_iterator> matches;
-    bool result = boost::u32regex_search(raw, matches, rex) ;
-    return result;
+    const std::string & raw = val.rawString();
+
+    if (val.isAscii()) {
+        AsciiCodePointIterator first(raw.data());
+        AsciiCodePointIterator last(raw.data() + raw.size());
+        return boost::u32regex_search(first, last, rex);
+    }
+
+    return boost::u32regex_search(raw.begin(), raw.end(), rex);
 }
 
 inline bool matches(const boost::u32regex & rex, const Utf32String & val)
@@ -117,7 +166,7 @@ inline uint64_t hashString(const std::string & str)
 
 inline uint64_t hashString(const Utf8String & str)
 {
-    return std::hash<std::string>()(std::string(str.rawData(), str.rawLength()));
+    return std::hash<std::string>()(str.rawString());
 }
 
 
@@ -146,10 +195,20 @@ inline void createRegex(boost::regex & regex, const std::string & str)
 /* CACHED REGEX                                                              */
 /*****************************************************************************/
 
+/** Regex along with the hash of its pattern, used as a key to cache the
+    result of matches.
+
+    Regexes parsed from JSON are compiled once per pattern for all the agent
+    configurations that use it; base shares the compiled state of the
+    interned copy.
+*/
 template<typename Base, typename Str>
 struct CachedRegex {
     Base base;
     uint64_t hash;
+
+    /** Keeps the interned regex alive while this one is in use. */
+    std::shared_ptr<const Base> interned;
     
     CachedRegex()
         : hash(0)
@@ -165,8 +224,18 @@ struct CachedRegex {
 
     void jsonParse(const Json::Value & val)
     {
-        RTBKIT::jsonParse(val, base);
-        hash = std::hash<std::string>() (val.asString());
+        static InternPool<Base> regexes;
+
+        std::string pattern = val.asString();
+        interned = regexes.get(pattern, [&] (const std::string &)
+                {
+                    Base result;
+                    RTBKIT::jsonParse(val, result);
+                    return result;
+                });
+
+        base = *interned;
+        hash = std::hash<std::string>() (pattern);
     }
 
     bool operator < (const CachedRegex & other) const
@@ -180,10 +249,9 @@ struct CachedRegex {
     }
 
     bool matches(const Str & str, uint64_t strHash,
-                 ML::Lightweight_Hash<uint64_t, int> & cache) const
+                 ML::Group_Hash<uint64_t, int> & cache) const
     {
         uint64_t bucket = hash ^ (strHash >> 1);
-        bucket += (bucket == 0);
         int & cached = cache[bucket];
         if (cached == 0)
             cached = RTBKIT::matches(base, str) + 1;
@@ -273,10 +341,9 @@ struct DomainMatcher {
     }
 
     bool matches(const Url & url, uint64_t urlHash,
-                 ML::Lightweight_Hash<uint64_t, int> & cache) const
+                 ML::Group_Hash<uint64_t, int> & cache) const
     {
         uint64_t bucket = hash ^ (urlHash >> 1);
-        bucket += (bucket == 0);
         int & cached = cache[bucket];
         if (cached == 0)
             cached = matches(url) + 1;
@@ -428,6 +495,136 @@ bool anyIsIncludedImpl(const Vec & vec, const IE & include, const IE & exclude)
 
 
 
+/*****************************************************************************/
+/* LITERAL SET                                                               */
+/*****************************************************************************/
+
+/** Set of literal values whose lookups take the same time whatever its
+    size. The hashes of the values are kept in a group probed hash set, which
+    answers the misses (the vast majority of the lookups for include and
+    exclude lists) without touching the values; a hit is then confirmed with
+    a binary search over the sorted values so that colliding hashes can't
+    cause a false positive.
+*/
+template<typename T>
+struct LiteralSet {
+
+    LiteralSet()
+    {
+    }
+
+    template<typename Collection>
+    LiteralSet(const Collection & init)
+        : values(init.begin(), init.end())
+    {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+
+        hashes.reserve(values.size());
+        for (const auto & value: values)
+            hashes.insert(hashOf(value));
+    }
+
+    bool empty() const { return values.empty(); }
+    size_t size() const { return values.size(); }
+
+    bool count(const T & value) const
+    {
+        if (!hashes.count(hashOf(value))) return false;
+        return std::binary_search(values.begin(), values.end(), value);
+    }
+
+    template<class Vec>
+    bool countAny(const Vec & vec) const
+    {
+        for (auto it = vec.begin(), end = vec.end(); it != end; ++it)
+            if (count(*it)) return true;
+        return false;
+    }
+
+private:
+    static uint64_t hashOf(const T & value)
+    {
+        return std::hash<T>()(value);
+    }
+
+    std::vector<T> values;
+    ML::Group_Hash_Set<uint64_t> hashes;
+};
+
+/** The value types of the include and exclude lists that can be compiled
+    into a LiteralSet; the others (regexes, domains) need to be matched one
+    at a time.
+*/
+template<typename T>
+struct IsLiteral {
+    enum { value = false };
+};
+
+template<> struct IsLiteral<std::string> { enum { value = true }; };
+template<> struct IsLiteral<int> { enum { value = true }; };
+
+/** Include and exclude lists compiled into LiteralSets. */
+template<typename T, bool Literal = IsLiteral<T>::value>
+struct CompiledIncludeExclude {
+
+    template<typename IE>
+    CompiledIncludeExclude(const IE & include, const IE & exclude)
+        : include(include), exclude(exclude),
+          includeSize(include.size()), excludeSize(exclude.size())
+    {
+    }
+
+    /** Returns true if the lists haven't been changed since they were
+        compiled.
+    */
+    template<typename IE>
+    bool isCurrent(const IE & include, const IE & exclude) const
+    {
+        return include.size() == includeSize
+            && exclude.size() == excludeSize;
+    }
+
+    bool isIncluded(const T & value) const
+    {
+        if (includeSize && !include.count(value)) return false;
+        return !exclude.count(value);
+    }
+
+    template<typename Vec>
+    bool anyIsIncluded(const Vec & vec) const
+    {
+        if (includeSize && !include.countAny(vec)) return false;
+        return !exclude.countAny(vec);
+    }
+
+    LiteralSet<T> include;
+    LiteralSet<T> exclude;
+    size_t includeSize;
+    size_t excludeSize;
+};
+
+/** Values that can't be compiled; never constructed. */
+template<typename T>
+struct CompiledIncludeExclude<T, false> {
+
+    template<typename IE>
+    CompiledIncludeExclude(const IE &, const IE &)
+    {
+        throw ML::Exception("include/exclude list can't be compiled");
+    }
+
+    template<typename IE>
+    bool isCurrent(const IE &, const IE &) const { return false; }
+
+    template<typename U>
+    bool isIncluded(const U &) const { return false; }
+
+    template<typename Vec>
+    bool anyIsIncluded(const Vec &) const { return false; }
+};
+
+
 /*****************************************************************************/
 /* INCLUDE EXCLUDE                                                           */
 /*****************************************************************************/
@@ -437,6 +634,12 @@ struct IncludeExclude {
     IE include;
     IE exclude;
 
+    /** Lists of literal values that are longer than this are compiled into
+        hash sets by createFromJson() so that checking a value doesn't go
+        through all of them.  The configs with the same lists share them.
+    */
+    enum { CompileThreshold = 16 };
+
     static IncludeExclude
     createFromJson(const Json::Value & val,
                    const std::string & name)
@@ -473,9 +676,30 @@ struct IncludeExclude {
         std::sort(result.include.begin(), result.include.end());
         std::sort(result.exclude.begin(), result.exclude.end());
 
+        if (IsLiteral<T>::value
+            && result.include.size() + result.exclude.size() > CompileThreshold) {
+            static InternPool<Compiled> compiledLists;
+            result.compiled = compiledLists.get(val.toString(),
+                    [&] (const std::string &)
+                    {
+                        return Compiled(result.include, result.exclude);
+                    });
+        }
+
         return result;
     }
 
+    /** Compiles the lists of literal values into hash sets which are then
+        used by isIncluded() and anyIsIncluded() until the lists are changed.
+        Does nothing for the types that need to be matched one at a time
+        such as the regexes.
+    */
+    void compile()
+    {
+        if (!IsLiteral<T>::value) return;
+        compiled = std::make_shared<Compiled>(include, exclude);
+    }
+
     void fromJson(const Json::Value & val, const std::string & name)
     {
         *this = createFromJson(val, name);
@@ -492,6 +716,7 @@ struct IncludeExclude {
     template<typename U>
     bool isIncluded(const U & value) const
     {
+        if (isCompiled()) return compiled->isIncluded(value);
         return isIncludedImpl(value, include, exclude);
     }
     
@@ -503,6 +728,33 @@ struct IncludeExclude {
     
     template<typename Vec>
     bool anyIsIncluded(const Vec & vec) const
+    {
+        // Segment lists have their own matching.
+        typedef std::integral_constant<
+            bool, !std::is_same<Vec, SegmentList>::value> UseCompiled;
+        return anyIsIncluded(vec, UseCompiled());
+    }
+
+private:
+    typedef CompiledIncludeExclude<T> Compiled;
+
+    // Shared so that the copies of the config don't need to compile again.
+    std::shared_ptr<const Compiled> compiled;
+
+    bool isCompiled() const
+    {
+        return compiled && compiled->isCurrent(include, exclude);
+    }
+
+    template<typename Vec>
+    bool anyIsIncluded(const Vec & vec, std::true_type) const
+    {
+        if (isCompiled()) return compiled->anyIsIncluded(vec);
+        return anyIsIncludedImpl(vec, include, exclude);
+    }
+
+    template<typename Vec>
+    bool anyIsIncluded(const Vec & vec, std::false_type) const
     {
         return anyIsIncludedImpl(vec, include, exclude);
     }
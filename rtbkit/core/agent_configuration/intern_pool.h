@@ -0,0 +1,101 @@
+/* intern_pool.h                                                   -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Pool of immutable values shared by content.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* INTERN POOL                                                               */
+/*****************************************************************************/
+
+/** Hands out a single shared copy of the values built from the same content
+    so that the agents that use identical lists don't each build and store
+    their own.
+
+    The pool only holds weak references: a value lives as long as one of its
+    users does and the expired entries are dropped as the pool grows.
+
+    Thread safe.
+*/
+template<typename T, typename Key = std::string>
+struct InternPool {
+
+    InternPool()
+        : nextPrune(MinPrune)
+    {
+    }
+
+    /** Returns the value for the given key, calling create(key) to build it
+        if there is no live copy.
+    */
+    template<typename Create>
+    std::shared_ptr<const T> get(const Key & key, Create && create)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                if (auto value = it->second.lock())
+                    return value;
+            }
+        }
+
+        // Built without the lock since that's the expensive part.
+        std::shared_ptr<const T> value = std::make_shared<T>(create(key));
+
+        std::lock_guard<std::mutex> guard(lock);
+
+        // Another thread might have beaten us to it.
+        auto & entry = entries[key];
+        if (auto existing = entry.lock())
+            return existing;
+
+        entry = value;
+        if (entries.size() >= nextPrune)
+            prune();
+
+        return value;
+    }
+
+    /** Number of entries, including the ones that expired since the last
+        prune.
+    */
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return entries.size();
+    }
+
+private:
+    enum { MinPrune = 64 };
+
+    void prune()
+    {
+        for (auto it = entries.begin();  it != entries.end();) {
+            if (it->second.expired())
+                it = entries.erase(it);
+            else ++it;
+        }
+
+        nextPrune = std::max<size_t>(MinPrune, entries.size() * 2);
+    }
+
+    mutable std::mutex lock;
+    std::unordered_map<Key, std::weak_ptr<const T> > entries;
+    size_t nextPrune;
+};
+
+} // namespace RTBKIT
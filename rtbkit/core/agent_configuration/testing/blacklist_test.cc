@@ -0,0 +1,108 @@
+/* blacklist_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the blacklist and its expiries.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/agent_configuration/blacklist.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+
+using namespace std;
+using namespace RTBKIT;
+
+
+namespace {
+
+BidRequest makeRequest(int user)
+{
+    BidRequest request;
+    request.userIds.exchangeId = Id(user);
+    request.url = Url("http://site.com/");
+    return request;
+}
+
+AgentConfig makeConfig(double blacklistTime)
+{
+    AgentConfig config;
+    config.account = AccountKey("a:b");
+    config.blacklistType = BL_USER;
+    config.blacklistScope = BL_AGENT;
+    config.blacklistTime = blacklistTime;
+    return config;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_blacklist_matches )
+{
+    Blacklist blacklist;
+    AgentConfig config = makeConfig(60);
+
+    for (int i = 1; i <= 1000; ++i)
+        blacklist.add(makeRequest(i), "agent", config);
+
+    BOOST_CHECK_EQUAL(blacklist.size(), 1000);
+
+    // Adding to the same user doesn't add a user.
+    blacklist.add(makeRequest(1), "other", config);
+    BOOST_CHECK_EQUAL(blacklist.size(), 1000);
+
+    for (int i = 1; i <= 1000; ++i)
+        BOOST_CHECK(blacklist.matches(makeRequest(i), "agent", config));
+
+    BOOST_CHECK(blacklist.matches(makeRequest(1), "other", config));
+    BOOST_CHECK(!blacklist.matches(makeRequest(2), "other", config));
+    BOOST_CHECK(!blacklist.matches(makeRequest(1001), "agent", config));
+}
+
+BOOST_AUTO_TEST_CASE( test_blacklist_expiries )
+{
+    Blacklist blacklist;
+    Date now = Date::now();
+
+    AgentConfig shortConfig = makeConfig(10);
+    AgentConfig longConfig = makeConfig(3 * Blacklist::WheelSlots);
+
+    for (int i = 1; i <= 100; ++i)
+        blacklist.add(makeRequest(i), "agent", i % 2 ? shortConfig : longConfig);
+
+    blacklist.doExpiries(now);
+    BOOST_CHECK_EQUAL(blacklist.size(), 100);
+
+    blacklist.doExpiries(now.plusSeconds(5));
+    BOOST_CHECK_EQUAL(blacklist.size(), 100);
+
+    blacklist.doExpiries(now.plusSeconds(12));
+    BOOST_CHECK_EQUAL(blacklist.size(), 50);
+
+    // The long ones come around the wheel a few times before they're due.
+    blacklist.doExpiries(now.plusSeconds(Blacklist::WheelSlots + 20));
+    BOOST_CHECK_EQUAL(blacklist.size(), 50);
+
+    blacklist.doExpiries(now.plusSeconds(2 * Blacklist::WheelSlots + 20));
+    BOOST_CHECK_EQUAL(blacklist.size(), 50);
+
+    blacklist.doExpiries(now.plusSeconds(3 * Blacklist::WheelSlots + 2));
+    BOOST_CHECK_EQUAL(blacklist.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_blacklist_earlier_expiry )
+{
+    Blacklist blacklist;
+    Date now = Date::now();
+
+    // A later entry that expires first moves the expiry of the user up.
+    blacklist.add(makeRequest(1), "agent", makeConfig(100));
+    blacklist.add(makeRequest(1), "other", makeConfig(10));
+
+    blacklist.doExpiries(now.plusSeconds(12));
+    BOOST_CHECK_EQUAL(blacklist.size(), 1);
+
+    blacklist.doExpiries(now.plusSeconds(102));
+    BOOST_CHECK_EQUAL(blacklist.size(), 0);
+}
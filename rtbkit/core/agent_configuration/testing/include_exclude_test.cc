@@ -0,0 +1,158 @@
+/* include_exclude_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the compiled include/exclude lists.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/agent_configuration/include_exclude.h"
+#include "jml/arch/format.h"
+
+#include <random>
+#include <iostream>
+
+using namespace std;
+using namespace RTBKIT;
+
+
+BOOST_AUTO_TEST_CASE( test_literal_set )
+{
+    vector<string> values = { "c", "a", "b", "a", "" };
+    LiteralSet<string> set(values);
+
+    BOOST_CHECK_EQUAL(set.size(), 4);
+    BOOST_CHECK(set.count("a"));
+    BOOST_CHECK(set.count("b"));
+    BOOST_CHECK(set.count("c"));
+    BOOST_CHECK(set.count(""));
+    BOOST_CHECK(!set.count("d"));
+    BOOST_CHECK(!set.count("ab"));
+
+    BOOST_CHECK(set.countAny(vector<string>({ "x", "c" })));
+    BOOST_CHECK(!set.countAny(vector<string>({ "x", "y" })));
+    BOOST_CHECK(!set.countAny(vector<string>()));
+
+    // -1 is the empty bucket of the hash set.
+    LiteralSet<int> ints(vector<int>({ -1, 0, 1 }));
+    BOOST_CHECK(ints.count(-1));
+    BOOST_CHECK(ints.count(0));
+    BOOST_CHECK(!ints.count(-2));
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_matches_linear )
+{
+    mt19937 rng(1234);
+
+    auto randomValue = [&] (int range) {
+        return ML::format("value-%d", int(rng() % range));
+    };
+
+    for (int round = 0; round < 50; ++round) {
+        int range = 100 + rng() % 1000;
+
+        IncludeExclude<string> linear;
+        for (int i = rng() % 100; i > 0; --i)
+            linear.include.push_back(randomValue(range));
+        for (int i = rng() % 100; i > 0; --i)
+            linear.exclude.push_back(randomValue(range));
+
+        IncludeExclude<string> compiled = linear;
+        compiled.compile();
+
+        for (int i = 0; i < 1000; ++i) {
+            string value = randomValue(range);
+            BOOST_CHECK_EQUAL(compiled.isIncluded(value),
+                              linear.isIncluded(value));
+
+            vector<string> values = { value, randomValue(range) };
+            BOOST_CHECK_EQUAL(compiled.anyIsIncluded(values),
+                              linear.anyIsIncluded(values));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_from_json )
+{
+    Json::Value json;
+    for (int i = 0; i < 10000; ++i)
+        json["include"][i] = ML::format("tag-%d", i);
+    json["exclude"][0] = "tag-42";
+
+    auto ie = IncludeExclude<string>::createFromJson(json, "test");
+
+    BOOST_CHECK(ie.isIncluded(string("tag-0")));
+    BOOST_CHECK(ie.isIncluded(string("tag-9999")));
+    BOOST_CHECK(!ie.isIncluded(string("tag-42")));
+    BOOST_CHECK(!ie.isIncluded(string("tag-10000")));
+
+    BOOST_CHECK(ie.anyIsIncluded(vector<string>({ "blah", "tag-43" })));
+    BOOST_CHECK(!ie.anyIsIncluded(vector<string>({ "tag-42", "tag-43" })));
+    BOOST_CHECK(!ie.anyIsIncluded(vector<string>({ "blah" })));
+
+    // Changing the lists goes back to the linear matching.
+    ie.include.push_back("extra");
+    BOOST_CHECK(ie.isIncluded(string("extra")));
+
+    // An empty include list lets everything that isn't excluded in.
+    Json::Value excludes;
+    for (int i = 0; i < 100; ++i)
+        excludes["exclude"][i] = i;
+
+    auto ints = IncludeExclude<int>::createFromJson(excludes, "test");
+    BOOST_CHECK(!ints.isIncluded(0));
+    BOOST_CHECK(!ints.isIncluded(99));
+    BOOST_CHECK(ints.isIncluded(100));
+    BOOST_CHECK(ints.isIncluded(-1));
+}
+
+BOOST_AUTO_TEST_CASE( test_intern_pool )
+{
+    InternPool<string> pool;
+    int created = 0;
+    auto create = [&] (const string & key) { ++created;  return key + "!"; };
+
+    auto a = pool.get("a", create);
+    auto b = pool.get("a", create);
+    BOOST_CHECK_EQUAL(*a, "a!");
+    BOOST_CHECK_EQUAL(a.get(), b.get());
+    BOOST_CHECK_EQUAL(created, 1);
+
+    // Values only live as long as their users.
+    a.reset();
+    b.reset();
+    auto c = pool.get("a", create);
+    BOOST_CHECK_EQUAL(created, 2);
+
+    // Expired entries get dropped as the pool grows.
+    for (int i = 0; i < 1000; ++i)
+        pool.get(ML::format("key-%d", i), create);
+    BOOST_CHECK_LT(pool.size(), 200);
+    BOOST_CHECK_EQUAL(pool.get("a", create).get(), c.get());
+}
+
+BOOST_AUTO_TEST_CASE( test_regex_interned )
+{
+    typedef CachedRegex<boost::regex, string> Regex;
+
+    Json::Value json;
+    json["include"][0] = "^http://.*\\.example\\.com/";
+    json["exclude"][0] = "/private/";
+
+    auto ie1 = IncludeExclude<Regex>::createFromJson(json, "urlFilter");
+    auto ie2 = IncludeExclude<Regex>::createFromJson(json, "urlFilter");
+
+    // Both configs share the compiled regexes.
+    BOOST_CHECK_EQUAL(ie1.include[0].interned.get(),
+                      ie2.include[0].interned.get());
+    BOOST_CHECK_EQUAL(ie1.exclude[0].interned.get(),
+                      ie2.exclude[0].interned.get());
+    BOOST_CHECK_EQUAL(ie1.include[0].hash, ie2.include[0].hash);
+
+    BOOST_CHECK(ie2.isIncluded(string("http://www.example.com/a")));
+    BOOST_CHECK(!ie2.isIncluded(string("http://www.example.com/private/a")));
+    BOOST_CHECK(!ie2.isIncluded(string("http://www.example.org/a")));
+}
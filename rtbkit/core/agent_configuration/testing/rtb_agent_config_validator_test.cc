@@ -235,3 +235,38 @@ BOOST_AUTO_TEST_CASE( test_agent_config_language_filter )
 
     BOOST_CHECK_THROW(config.parse(payload),ML::Exception);
 }
+
+BOOST_AUTO_TEST_CASE( test_agent_config_loss_notifications )
+{
+    auto withLosses = [] (const std::string & fields)
+        {
+            return R"JSON( {
+                "account" : ["hello", "worlds"],
+                "creatives": [
+                { "name": "MaCreative", "height": 250, "width": 300, "id": 5 }
+                ], )JSON" + fields + "}";
+        };
+
+    AgentConfig config;
+    config.parse(withLosses(R"JSON( "test": false )JSON"));
+    BOOST_CHECK_EQUAL(config.lossNotifications, LN_EACH);
+    BOOST_CHECK(!config.toJson().isMember("lossNotifications"));
+
+    config.parse(withLosses(R"JSON(
+                "lossNotifications": "count",
+                "lossBatchMs": 250 )JSON"));
+    BOOST_CHECK_EQUAL(config.lossNotifications, LN_COUNT);
+    BOOST_CHECK_EQUAL(config.lossBatchMs, 250);
+
+    AgentConfig copy;
+    copy.fromJson(config.toJson());
+    BOOST_CHECK_EQUAL(copy.lossNotifications, LN_COUNT);
+    BOOST_CHECK_EQUAL(copy.lossBatchMs, 250);
+
+    BOOST_CHECK_THROW(config.parse(withLosses(
+                R"JSON( "lossNotifications": "sometimes" )JSON")),
+                      ML::Exception);
+    BOOST_CHECK_THROW(config.parse(withLosses(
+                R"JSON( "lossBatchMs": 0 )JSON")),
+                      ML::Exception);
+}
@@ -3,3 +3,5 @@
 
 $(eval $(call test,rtb_agent_config_validator_test,agent_configuration,boost))
 $(eval $(call test,rtb_fees_test,agent_configuration,boost))
+$(eval $(call test,include_exclude_test,agent_configuration,boost))
+$(eval $(call test,blacklist_test,agent_configuration,boost))
@@ -358,6 +358,7 @@ logBidEvents(const Datacratic::EventRecorder & eventRecorder)
     uint32_t attachedBids(0), detachedBids(0), commitments(0), expired(0);
 
     for (auto & it: accounts) {
+        Guard accountGuard(it.second.lock);
         ShadowAccount & account = it.second;
         attachedBids += account.attachedBids;
         detachedBids += account.detachedBids;
@@ -380,11 +381,82 @@ logBidEvents(const Datacratic::EventRecorder & eventRecorder)
 /* ACCOUNTS                                                                  */
 /*****************************************************************************/
 
+Accounts::AccountTotals
+Accounts::AccountTotals::
+of(const Account & a)
+{
+    AccountTotals result;
+    result.effectiveBudget = a.budgetIncreases - a.budgetDecreases
+        + a.recycledIn - a.recycledOut
+        + a.allocatedIn - a.allocatedOut;
+    result.inFlight = a.commitmentsMade - a.commitmentsRetired;
+    result.spent = a.spent;
+    result.adjustments = a.adjustmentsIn - a.adjustmentsOut;
+    result.budgetIncreases = a.budgetIncreases;
+    return result;
+}
+
+Accounts::AccountTotals &
+Accounts::AccountTotals::
+operator += (const AccountTotals & other)
+{
+    effectiveBudget += other.effectiveBudget;
+    inFlight += other.inFlight;
+    spent += other.spent;
+    adjustments += other.adjustments;
+    budgetIncreases += other.budgetIncreases;
+    return *this;
+}
+
+Accounts::AccountTotals &
+Accounts::AccountTotals::
+operator -= (const AccountTotals & other)
+{
+    effectiveBudget -= other.effectiveBudget;
+    inFlight -= other.inFlight;
+    spent -= other.spent;
+    adjustments -= other.adjustments;
+    budgetIncreases -= other.budgetIncreases;
+    return *this;
+}
+
+void
+Accounts::
+updateTotals() const
+{
+    for (const AccountKey & key: pendingTotals) {
+        const AccountInfo & account = getAccountImpl(key);
+        account.totalsPending = false;
+
+        AccountTotals own = AccountTotals::of(account);
+        AccountTotals delta = own;
+        delta -= account.ownTotals;
+        account.ownTotals = own;
+
+        account.subtreeTotals += delta;
+        if (key.size() < 2)
+            continue;
+
+        AccountKey parentKey = key.parent();
+        const AccountInfo & parent = getAccountImpl(parentKey);
+        parent.childBudgetIncreases += delta.budgetIncreases;
+        parent.subtreeTotals += delta;
+
+        while (parentKey.size() > 1) {
+            parentKey.pop_back();
+            getAccountImpl(parentKey).subtreeTotals += delta;
+        }
+    }
+
+    pendingTotals.clear();
+}
+
 void
 Accounts::
 ensureInterAccountConsistency()
 {
     Guard guard(lock);
+    updateTotals();
 
     for (const auto & it: accounts) {
         if (it.first.size() == 1) {
@@ -415,6 +487,7 @@ checkBudgetConsistency(const AccountKey & accountKey, int maxRecursion)
     const
 {
     Guard guard(lock);
+    updateTotals();
 
     ExcAssertEqual(accountKey.size(), 1);
 
@@ -428,12 +501,7 @@ checkBudgetConsistencyImpl(const AccountKey & accountKey, int maxRecursion,
     const
 {
     const AccountInfo & account = getAccountImpl(accountKey);
-    CurrencyPool sumBudgetInc;
-
-    for (const AccountKey & childKey: account.children) {
-        const Account & childAccount = getAccountImpl(childKey);
-        sumBudgetInc += childAccount.budgetIncreases;
-    }
+    const CurrencyPool & sumBudgetInc = account.childBudgetIncreases;
 
     if (account.allocatedOut != sumBudgetInc) {
         cerr << "budget of account " << accountKey
@@ -15,6 +15,7 @@
 #include "rtbkit/common/account_key.h"
 #include "soa/types/date.h"
 #include "jml/utils/string_functions.h"
+#include "jml/utils/compact_vector.h"
 #include <mutex>
 #include <thread>
 #include "jml/arch/spinlock.h"
@@ -469,8 +470,40 @@ struct ShadowAccount {
 
     std::unordered_map<std::string, Commitment> commitments; 
 
+    /** Same check as checkInvariants() without building any pool, since it
+        runs twice on every bid.
+    */
+    bool invariantsHold() const
+    {
+        if (!commitmentsRetired.isNonNegative()
+            || !commitmentsMade.isNonNegative()
+            || !spent.isNonNegative())
+            return false;
+
+        auto balanced = [&] (const CurrencyPool & pool)
+            {
+                for (auto & am: pool.currencyAmounts) {
+                    CurrencyCode c = am.currencyCode;
+                    int64_t credit = netBudget.valueOf(c)
+                        + commitmentsRetired.valueOf(c);
+                    int64_t debit = commitmentsMade.valueOf(c)
+                        + spent.valueOf(c) + balance.valueOf(c);
+                    if (credit != debit)
+                        return false;
+                }
+                return true;
+            };
+
+        return balanced(netBudget) && balanced(commitmentsRetired)
+            && balanced(commitmentsMade) && balanced(spent)
+            && balanced(balance);
+    }
+
     void checkInvariants() const
     {
+        if (invariantsHold())
+            return;
+
         try {
             //ExcAssert(netBudget.isNonNegative());
             ExcAssert(commitmentsRetired.isNonNegative());
@@ -838,11 +871,45 @@ struct Accounts {
 
     Datacratic::Date sessionStart;
 
+    /** The parts of an account that add up into the summaries of its
+        parents.
+    */
+    struct AccountTotals {
+        CurrencyPool effectiveBudget;
+        CurrencyPool inFlight;
+        CurrencyPool spent;
+        CurrencyPool adjustments;
+        CurrencyPool budgetIncreases;
+
+        static AccountTotals of(const Account & account);
+
+        AccountTotals & operator += (const AccountTotals & other);
+        AccountTotals & operator -= (const AccountTotals & other);
+    };
+
     struct AccountInfo: public Account {
+        AccountInfo()
+            : totalsPending(false)
+        {
+        }
+
         std::set<AccountKey> children;
 
         /* spend tracking across sessions */
         CurrencyPool initialSpent;
+
+        /* Totals of the account and all of its sub-accounts, kept up to date
+           by updateTotals() rather than walking the sub-accounts each time
+           they're asked for.  The budgetIncreases of the subtree is
+           meaningless; childBudgetIncreases is the one of the direct
+           children only. */
+        mutable AccountTotals subtreeTotals;
+        mutable CurrencyPool childBudgetIncreases;
+
+        /* What this account contributed to the totals as of the last
+           updateTotals(), and whether it was modified since. */
+        mutable AccountTotals ownTotals;
+        mutable bool totalsPending;
     };
 
     const Account createAccount(const AccountKey & account,
@@ -1044,10 +1111,15 @@ struct Accounts {
         getAccountImpl(account).recuperateTo(getParentAccount(account));
     }
 
+    /** The totals of the summary are maintained as the accounts change, so
+        this only walks the sub-accounts that are returned down to
+        maxDepth.
+    */
     AccountSummary getAccountSummary(const AccountKey & account,
                                      int maxDepth = -1) const
     {
         Guard guard(lock);
+        updateTotals();
         return getAccountSummaryImpl(account, 0, maxDepth);
     }
 
@@ -1056,6 +1128,7 @@ struct Accounts {
         const
     {
         Guard guard(lock);
+        updateTotals();
 
         Json::Value summaries;
 
@@ -1121,6 +1194,26 @@ struct Accounts {
     }
 
 
+    /** Returns the accounts that were modified since the last call and
+        forgets about them, so that only those need to be persisted.
+    */
+    std::vector<AccountKey> takeDirtyAccounts()
+    {
+        Guard guard(lock);
+
+        std::vector<AccountKey> result(dirtyAccounts.begin(),
+                                       dirtyAccounts.end());
+        dirtyAccounts.clear();
+        return result;
+    }
+
+    /** Puts back accounts that were taken but couldn't be persisted. */
+    void markAccountsDirty(const std::vector<AccountKey> & keys)
+    {
+        Guard guard(lock);
+        dirtyAccounts.insert(keys.begin(), keys.end());
+    }
+
     /** interaccount consistency */
     /* "Inconsistent" here means that there is a mismatch between the members
      * used in money transfers for a given Account and the corresponding
@@ -1162,6 +1255,26 @@ private:
     AccountSet outOfSyncAccounts;
     AccountSet inconsistentAccounts;
 
+    /* Accounts handed out for modification since the last
+       takeDirtyAccounts() */
+    AccountSet dirtyAccounts;
+
+    /* Accounts handed out for modification since the last updateTotals() */
+    mutable std::vector<AccountKey> pendingTotals;
+
+    void markTotalsPending(const AccountKey & key, const AccountInfo & info)
+    {
+        if (info.totalsPending)
+            return;
+        info.totalsPending = true;
+        pendingTotals.push_back(key);
+    }
+
+    /** Folds what the modified accounts changed into the totals of their
+        subtrees and those of their parents, so that they are up to date.
+    */
+    void updateTotals() const;
+
 public:
     std::vector<AccountKey>
     getAccountKeys(const AccountKey & prefix = AccountKey(),
@@ -1226,6 +1339,17 @@ public:
               
         doAccount(root, 0, maxDepth);
 
+        // The totals that came along are those of the whole subtrees
+        for (auto & a: result.accounts) {
+            a.second.subtreeTotals = AccountTotals();
+            a.second.childBudgetIncreases.clear();
+            a.second.ownTotals = AccountTotals();
+            a.second.totalsPending = false;
+        }
+        result.pendingTotals.clear();
+        for (auto & a: result.accounts)
+            result.markTotalsPending(a.first, a.second);
+
         return result;
     }
 
@@ -1236,9 +1360,12 @@ private:
     {
         ExcAssertGreaterEqual(accountKey.size(), 1);
 
+        dirtyAccounts.insert(accountKey);
+
         auto it = accounts.find(accountKey);
         if (it != accounts.end()) {
             ExcAssertEqual(it->second.type, type);
+            markTotalsPending(accountKey, it->second);
             return it->second;
         }
         else {
@@ -1253,6 +1380,7 @@ private:
 
             auto & result = accounts[accountKey];
             result.type = type;
+            markTotalsPending(accountKey, result);
             return result;
         }
     }
@@ -1262,6 +1390,8 @@ private:
         auto it = accounts.find(account);
         if (it == accounts.end())
             throw ML::Exception("couldn't get account: " + account.toString());
+        dirtyAccounts.insert(account);
+        markTotalsPending(account, it->second);
         return it->second;
     }
 
@@ -1339,25 +1469,24 @@ private:
     {
         AccountSummary result;
 
-        const Account & a = getAccountImpl(account);
+        const AccountInfo & a = getAccountImpl(account);
+        const AccountTotals & totals = a.subtreeTotals;
 
         result.account = a;
-        result.spent = a.spent;
         result.budget = a.budgetIncreases - a.budgetDecreases;
-        result.effectiveBudget = a.budgetIncreases - a.budgetDecreases 
-                        + a.recycledIn - a.recycledOut
-                        + a.allocatedIn - a.allocatedOut;
-        result.inFlight = a.commitmentsMade - a.commitmentsRetired;
-        result.adjustments = a.adjustmentsIn - a.adjustmentsOut;
-
-        auto doChildAccount = [&] (const AccountKey & key) {
-            auto childSummary = getAccountSummaryImpl(key, depth + 1,
-                                                      maxDepth);
-            result.addChild(key.back(), childSummary,
-                            maxDepth == -1 || depth < maxDepth);
-        };
-        forEachChildAccount(account, doChildAccount);
-        
+        result.effectiveBudget = totals.effectiveBudget;
+        result.inFlight = totals.inFlight;
+        result.spent = totals.spent;
+        result.adjustments = totals.adjustments;
+
+        if (maxDepth == -1 || depth < maxDepth) {
+            auto doChildAccount = [&] (const AccountKey & key) {
+                result.subAccounts[key.back()]
+                    = getAccountSummaryImpl(key, depth + 1, maxDepth);
+            };
+            forEachChildAccount(account, doChildAccount);
+        }
+
         result.adjustedSpent = result.spent - result.adjustments;
 
         result.available = (result.effectiveBudget - result.adjustedSpent - result.inFlight);
@@ -1370,6 +1499,38 @@ private:
 };
 
 
+/*****************************************************************************/
+/* BID AUTHORIZATION                                                         */
+/*****************************************************************************/
+
+/** One of a batch of bids to authorize at once, and whether it was.  The
+    account is referred to rather than copied so it must outlive the batch.
+    When its handle is known, the bankers that keep their accounts by handle
+    use it instead of looking the key up.
+*/
+struct BidAuthorization {
+    BidAuthorization(const AccountKey & account, std::string item,
+                     Amount amount)
+        : account(account), handle(AccountHandles::NoAccount),
+          item(std::move(item)), amount(amount), authorized(false)
+    {
+    }
+
+    BidAuthorization(const AccountKey & account, AccountHandle handle,
+                     std::string item, Amount amount)
+        : account(account), handle(handle),
+          item(std::move(item)), amount(amount), authorized(false)
+    {
+    }
+
+    const AccountKey & account;
+    AccountHandle handle;
+    std::string item;
+    Amount amount;
+    bool authorized;
+};
+
+
 /*****************************************************************************/
 /* SHADOW ACCOUNTS                                                           */
 /*****************************************************************************/
@@ -1380,18 +1541,26 @@ struct ShadowAccounts {
         whenever a new account is created.
     */
     std::function<void (AccountKey)> onNewAccount;
+
+    /* Locking: the map of accounts is protected by lock while each account
+       has its own lock.  Accounts are never removed and the map nodes don't
+       move, so the bid operations only hold the map lock long enough to find
+       their account and bids on different accounts never contend.  When both
+       are needed, the map lock is always taken first.
+    */
     
     const ShadowAccount activateAccount(const AccountKey & account)
     {
-        Guard guard(lock);
-        return getAccountImpl(account);
+        auto & a = getEntry(account);
+        Guard guard(a.lock);
+        return a;
     }
 
     const ShadowAccount syncFromMaster(const AccountKey & account,
                                        const Account & master)
     {
-        Guard guard(lock);
-        auto & a = getAccountImpl(account);
+        auto & a = getEntry(account);
+        Guard guard(a.lock);
         ExcAssert(!a.uninitialized);
         a.syncFromMaster(master);
         return a;
@@ -1404,8 +1573,8 @@ struct ShadowAccounts {
     initializeAndMergeState(const AccountKey & account,
                             const Account & master)
     {
-        Guard guard(lock);
-        auto & a = getAccountImpl(account);
+        auto & a = getEntry(account);
+        Guard guard(a.lock);
         ExcAssert(a.uninitialized);
         a.initializeAndMergeState(master);
         a.uninitialized = false;
@@ -1416,14 +1585,16 @@ struct ShadowAccounts {
     {
         Guard guard(lock);
         for (auto & a: accounts) {
+            Guard accountGuard(a.second.lock);
             a.second.checkInvariants();
         }
     }
 
     const ShadowAccount getAccount(const AccountKey & accountKey) const
     {
-        Guard guard(lock);
-        return getAccountImpl(accountKey);
+        auto & a = getEntry(accountKey);
+        Guard guard(a.lock);
+        return a;
     }
 
     bool accountExists(const AccountKey & accountKey) const
@@ -1437,6 +1608,7 @@ struct ShadowAccounts {
     	Guard guard(lock);
 
     	AccountEntry & account = getAccountImpl(accountKey, false /* call onCreate */);
+        Guard accountGuard(account.lock);
     	bool result = account.first;
 
     	// record that this account creation is requested for the first time
@@ -1454,8 +1626,10 @@ struct ShadowAccounts {
         Guard guard1(lock);
         Guard guard2(master.lock);
 
-        for (auto & a: accounts)
+        for (auto & a: accounts) {
+            Guard accountGuard(a.second.lock);
             a.second.syncToMaster(master.getAccountImpl(a.first));
+        }
     }
 
     void syncFrom(const Accounts & master)
@@ -1464,9 +1638,10 @@ struct ShadowAccounts {
         Guard guard2(master.lock);
 
         for (auto & a: accounts) {
+            Guard accountGuard(a.second.lock);
             a.second.syncFromMaster(master.getAccountImpl(a.first));
             if (master.outOfSyncAccounts.count(a.first) > 0) {
-                outOfSyncAccounts.insert(a.first);
+                a.second.outOfSync = true;
             }
         }
     }
@@ -1477,6 +1652,7 @@ struct ShadowAccounts {
         Guard guard2(master.lock);
 
         for (auto & a: accounts) {
+            Guard accountGuard(a.second.lock);
             a.second.syncToMaster(master.getAccountImpl(a.first));
             a.second.syncFromMaster(master.getAccountImpl(a.first));
         }
@@ -1484,22 +1660,23 @@ struct ShadowAccounts {
 
     bool isInitialized(const AccountKey & accountKey) const
     {
-        Guard guard(lock);
-        return !getAccountImpl(accountKey).uninitialized;
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return !account.uninitialized;
     }
 
     bool isStalled(const AccountKey & accountKey) const
     {
-        Guard guard(lock);
-        auto & account = getAccountImpl(accountKey);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
         return account.uninitialized && account.requested.minutesUntil(Date::now()) >= 1.0;
     }
 
     void reinitializeStalledAccount(const AccountKey & accountKey)
     {
         ExcAssert(isStalled(accountKey));
-        Guard guard(lock);
-        auto & account = getAccountImpl(accountKey);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
         account.first = true;
         account.requested = Date::now();
     }
@@ -1512,9 +1689,40 @@ struct ShadowAccounts {
                       const std::string & item,
                       Amount amount)
     {
-        Guard guard(lock);
-        return (outOfSyncAccounts.count(accountKey) == 0
-                && getAccountImpl(accountKey).authorizeBid(item, amount));
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return !account.outOfSync && account.authorizeBid(item, amount);
+    }
+
+    /** Authorizes each of the bids as authorizeBid() does.  The map lock is
+        taken once to find all of their accounts, then the lock of each
+        account once for all of the bids on it.
+    */
+    void authorizeBids(std::vector<BidAuthorization> & bids)
+    {
+        ML::compact_vector<AccountEntry *, 16> entries;
+        {
+            Guard guard(lock);
+            for (auto & bid: bids)
+                entries.push_back(bid.handle == AccountHandles::NoAccount
+                                  ? &getAccountImpl(bid.account)
+                                  : &getAccountImpl(bid.handle));
+        }
+
+        for (size_t i = 0;  i < bids.size();  ++i) {
+            AccountEntry * account = entries[i];
+            if (!account)
+                continue;  // already done with the bids of an earlier one
+
+            Guard guard(account->lock);
+            for (size_t j = i;  j < bids.size();  ++j) {
+                if (entries[j] != account)
+                    continue;
+                bids[j].authorized = !account->outOfSync
+                    && account->authorizeBid(bids[j].item, bids[j].amount);
+                entries[j] = nullptr;
+            }
+        }
     }
     
     void commitBid(const AccountKey & accountKey,
@@ -1522,23 +1730,33 @@ struct ShadowAccounts {
                    Amount amountPaid,
                    const LineItems & lineItems)
     {
-        Guard guard(lock);
-        return getAccountImpl(accountKey).commitBid(item, amountPaid, lineItems);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return account.commitBid(item, amountPaid, lineItems);
     }
 
     void cancelBid(const AccountKey & accountKey,
                    const std::string & item)
     {
-        Guard guard(lock);
-        return getAccountImpl(accountKey).cancelBid(item);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return account.cancelBid(item);
+    }
+
+    void cancelBid(AccountHandle handle, const std::string & item)
+    {
+        auto & account = getEntry(handle);
+        Guard guard(account.lock);
+        return account.cancelBid(item);
     }
     
     void forceWinBid(const AccountKey & accountKey,
                      Amount amountPaid,
                      const LineItems & lineItems)
     {
-        Guard guard(lock);
-        return getAccountImpl(accountKey).forceWinBid(amountPaid, lineItems);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return account.forceWinBid(amountPaid, lineItems);
     }
 
     /// Commit a bid that has been detached from its tracking
@@ -1547,40 +1765,54 @@ struct ShadowAccounts {
                            Amount amountPaid,
                            const LineItems & lineItems)
     {
-        Guard guard(lock);
-        return getAccountImpl(accountKey)
-            .commitDetachedBid(amountAuthorized, amountPaid, lineItems);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return account.commitDetachedBid(amountAuthorized, amountPaid, lineItems);
     }
 
     /// Commit a specific currency (amountToCommit)
     void commitEvent(const AccountKey & accountKey, const Amount & amountToCommit)
     {
-        Guard guard(lock);
-        return getAccountImpl(accountKey).commitEvent(amountToCommit);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return account.commitEvent(amountToCommit);
     }
 
     Amount detachBid(const AccountKey & accountKey,
                      const std::string & item)
     {
-        Guard guard(lock);
-        return getAccountImpl(accountKey).detachBid(item);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        return account.detachBid(item);
+    }
+
+    Amount detachBid(AccountHandle handle, const std::string & item)
+    {
+        auto & account = getEntry(handle);
+        Guard guard(account.lock);
+        return account.detachBid(item);
     }
 
     void attachBid(const AccountKey & accountKey,
                    const std::string & item,
                    Amount amountAuthorized)
     {
-        Guard guard(lock);
-        getAccountImpl(accountKey).attachBid(item, amountAuthorized);
+        auto & account = getEntry(accountKey);
+        Guard guard(account.lock);
+        account.attachBid(item, amountAuthorized);
     }
 
     void logBidEvents(const Datacratic::EventRecorder & eventRecorder);
 
 private:
 
+    typedef ML::Spinlock Lock;
+    typedef std::unique_lock<Lock> Guard;
+
     struct AccountEntry : public ShadowAccount {
         AccountEntry(bool uninitialized = true, bool first = true)
-            : requested(Date::now()), uninitialized(uninitialized), first(first)
+            : requested(Date::now()), uninitialized(uninitialized), first(first),
+              outOfSync(false)
         {
         }
 
@@ -1598,6 +1830,13 @@ private:
         Date requested;
         bool uninitialized;
         bool first;
+
+        /** The master banker reported the account as out of sync; no more
+            bids are authorized on it.
+        */
+        bool outOfSync;
+
+        mutable Lock lock;
     };
 
     AccountEntry & getAccountImpl(const AccountKey & account,
@@ -1621,15 +1860,49 @@ private:
         return it->second;
     }
 
-    typedef ML::Spinlock Lock;
-    typedef std::unique_lock<Lock> Guard;
+    /** Finds the account under the map lock; it must then be accessed under
+        its own lock.
+    */
+    AccountEntry & getEntry(const AccountKey & account)
+    {
+        Guard guard(lock);
+        return getAccountImpl(account);
+    }
+
+    const AccountEntry & getEntry(const AccountKey & account) const
+    {
+        Guard guard(lock);
+        return getAccountImpl(account);
+    }
+
+    /** Same as getAccountImpl() for an account handle.  The key is only
+        looked up the first time; after that the entry comes from byHandle.
+    */
+    AccountEntry & getAccountImpl(AccountHandle handle)
+    {
+        if (handle < byHandle.size() && byHandle[handle])
+            return *byHandle[handle];
+
+        AccountEntry & entry = getAccountImpl(accountHandles().key(handle));
+        if (handle >= byHandle.size())
+            byHandle.resize(handle + 1, nullptr);
+        byHandle[handle] = &entry;
+        return entry;
+    }
+
+    AccountEntry & getEntry(AccountHandle handle)
+    {
+        Guard guard(lock);
+        return getAccountImpl(handle);
+    }
+
     mutable Lock lock;
 
     typedef std::map<AccountKey, AccountEntry> AccountMap;
     AccountMap accounts;
 
-    typedef std::unordered_set<AccountKey> AccountSet;
-    AccountSet outOfSyncAccounts;
+    /** Entries of the accounts already used by handle, indexed by it. */
+    std::vector<AccountEntry *> byHandle;
 
 public:
     std::vector<AccountKey>
@@ -1654,6 +1927,7 @@ public:
         Guard guard(lock);
         
         for (auto & a: accounts) {
+            Guard accountGuard(a.second.lock);
             onAccount(a.first, a.second);
         }
     }
@@ -1665,6 +1939,7 @@ public:
         Guard guard(lock);
         
         for (auto & a: accounts) {
+            Guard accountGuard(a.second.lock);
             if (a.second.uninitialized || a.second.status == Account::CLOSED)
                 continue;
             onAccount(a.first, a.second);
@@ -6,7 +6,10 @@
 */
 
 #include "application_layer.h"
+#include "jml/arch/format.h"
 #include <type_traits>
+#include <algorithm>
+#include <mutex>
 
 using namespace std;
 
@@ -357,4 +360,247 @@ budgetResultCallback(const BudgetController::OnBudgetResult &onResult)
     };
 }
 
+
+/*****************************************************************************/
+/* SHARDED LAYER                                                             */
+/*****************************************************************************/
+
+namespace {
+
+/** Collects the responses of the requests sent to several shards and calls
+    the callback once all of them are in, with the JSON objects or arrays
+    merged.  The first error wins.
+*/
+struct ShardedResponse {
+    ShardedResponse(size_t numPending, ApplicationLayer::OnRequestResult onResult)
+        : numPending(numPending), code(0), result(Json::nullValue),
+          onResult(std::move(onResult))
+    {
+    }
+
+    void onResponse(std::exception_ptr exc, int statusCode,
+                    const std::string &payload)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+
+        if (!this->exc && !error.size()) {
+            if (exc)
+                this->exc = exc;
+            else if (statusCode != 200) {
+                code = statusCode;
+                error = payload;
+            }
+            else {
+                code = statusCode;
+                try {
+                    merge(Json::parse(payload));
+                } catch (...) {
+                    this->exc = std::current_exception();
+                }
+            }
+        }
+
+        if (--numPending)
+            return;
+
+        guard.unlock();
+
+        if (this->exc)
+            onResult(this->exc, code, "");
+        else if (error.size())
+            onResult(nullptr, code, error);
+        else onResult(nullptr, code, result.toStringNoNewLine());
+    }
+
+    void merge(const Json::Value &value)
+    {
+        if (result.isNull())
+            result = value;
+        else if (result.isObject() && value.isObject()) {
+            for (const auto &member: value.getMemberNames())
+                result[member] = value[member];
+        }
+        else if (result.isArray() && value.isArray()) {
+            for (const auto &item: value)
+                result.append(item);
+        }
+    }
+
+    std::mutex lock;
+    size_t numPending;
+    std::exception_ptr exc;
+    int code;
+    std::string error;
+    Json::Value result;
+    ApplicationLayer::OnRequestResult onResult;
+};
+
+} // file scope
+
+void
+ShardedLayer::
+init(std::vector<std::shared_ptr<ApplicationLayer> > shards, int pointsPerShard)
+{
+    if (shards.empty())
+        throw ML::Exception("sharded layer needs at least one shard");
+
+    this->shards = std::move(shards);
+
+    ring.clear();
+    for (size_t i = 0; i < this->shards.size(); ++i) {
+        addSource(ML::format("ShardedLayer::shard%d", int(i)), this->shards[i]);
+
+        for (int j = 0; j < pointsPerShard; ++j) {
+            string point = ML::format("shard%d-%d", int(i), j);
+            ring.emplace_back(CityHash64(point.c_str(), point.size()), i);
+        }
+    }
+    std::sort(ring.begin(), ring.end());
+}
+
+size_t
+ShardedLayer::
+shardOf(const std::string &topLevelAccount) const
+{
+    uint64_t hash = CityHash64(topLevelAccount.c_str(), topLevelAccount.size());
+    auto it = std::lower_bound(ring.begin(), ring.end(),
+                               std::make_pair(hash, size_t(0)));
+    if (it == ring.end())
+        it = ring.begin();
+    return it->second;
+}
+
+void
+ShardedLayer::
+addAccount(const AccountKey &account,
+           const BudgetController::OnBudgetResult &onResult)
+{
+    shardFor(account).addAccount(account, onResult);
+}
+
+void
+ShardedLayer::
+topupTransfer(const std::string &accountStr,
+              AccountType accountType,
+              CurrencyPool amount,
+              const BudgetController::OnBudgetResult &onResult)
+{
+    shardFor(accountStr).topupTransfer(accountStr, accountType, amount, onResult);
+}
+
+void
+ShardedLayer::
+setBudget(const std::string &topLevelAccount,
+          CurrencyPool amount,
+          const BudgetController::OnBudgetResult &onResult)
+{
+    shardFor(topLevelAccount).setBudget(topLevelAccount, amount, onResult);
+}
+
+void
+ShardedLayer::
+getAccountSummary(
+    const AccountKey &account,
+    int depth,
+    std::function<void (std::exception_ptr, AccountSummary &&)>
+    onResult)
+{
+    shardFor(account).getAccountSummary(account, depth, onResult);
+}
+
+void
+ShardedLayer::
+getAccount(const AccountKey &account,
+           std::function<void (std::exception_ptr, Account &&)> onResult)
+{
+    shardFor(account).getAccount(account, onResult);
+}
+
+void
+ShardedLayer::
+addSpendAccount(const std::string &shadowStr,
+                std::function<void (std::exception_ptr, Account &&)> onDone)
+{
+    shardFor(shadowStr).addSpendAccount(shadowStr, onDone);
+}
+
+void
+ShardedLayer::
+syncAccount(const ShadowAccount &account, const std::string &shadowStr,
+            std::function<void (std::exception_ptr, Account &&)> onDone)
+{
+    shardFor(shadowStr).syncAccount(account, shadowStr, onDone);
+}
+
+void
+ShardedLayer::
+request(std::string method, const std::string &resource,
+        const RestParams &params, const std::string &content, OnRequestResult onResult)
+{
+    static const string accountsPrefix = "/v1/accounts";
+
+    if (resource == accountsPrefix + "/balance"
+        || resource == accountsPrefix + "/shadow") {
+        requestBatched(method, resource, params, content, onResult);
+    }
+    else if (resource.compare(0, accountsPrefix.size() + 1, accountsPrefix + "/") == 0) {
+        size_t start = accountsPrefix.size() + 1;
+        string accountStr = resource.substr(start, resource.find('/', start) - start);
+        shardFor(accountStr).request(method, resource, params, content, onResult);
+    }
+    else if (resource == accountsPrefix && params.hasValue("accountName")) {
+        shardFor(params.getValue("accountName"))
+            .request(method, resource, params, content, onResult);
+    }
+    else requestAll(method, resource, params, content, onResult);
+}
+
+void
+ShardedLayer::
+requestBatched(const std::string &method, const std::string &resource,
+               const RestParams &params, const std::string &content,
+               OnRequestResult onResult)
+{
+    Json::Value request = Json::parse(content);
+    if (!request.isObject())
+        throw ML::Exception("batched request to '%s' must be an object",
+                            resource.c_str());
+
+    std::map<size_t, Json::Value> perShard;
+    for (const auto &key: request.getMemberNames())
+        perShard[shardOf(AccountKey(key).at(0))][key] = request[key];
+
+    if (perShard.empty()) {
+        onResult(nullptr, 200, "{}");
+        return;
+    }
+
+    auto response = std::make_shared<ShardedResponse>(perShard.size(), onResult);
+    auto onDone = [=] (std::exception_ptr exc, int code, const std::string &payload)
+        {
+            response->onResponse(exc, code, payload);
+        };
+
+    for (const auto &shard: perShard) {
+        shards[shard.first]->request(method, resource, params,
+                                     shard.second.toStringNoNewLine(), onDone);
+    }
+}
+
+void
+ShardedLayer::
+requestAll(const std::string &method, const std::string &resource,
+           const RestParams &params, const std::string &content,
+           OnRequestResult onResult)
+{
+    auto response = std::make_shared<ShardedResponse>(shards.size(), onResult);
+    auto onDone = [=] (std::exception_ptr exc, int code, const std::string &payload)
+        {
+            response->onResponse(exc, code, payload);
+        };
+
+    for (auto &shard: shards)
+        shard->request(method, resource, params, content, onDone);
+}
+
 } // namespace RTBKIT
@@ -6,7 +6,8 @@
    for the master banker.
 
    Currently, the SlaveBanker can talk to the MasterBanker eiter via HTTP through
-   the HttpLayer or zeromq via the ZmqLayer
+   the HttpLayer or zeromq via the ZmqLayer.  The ShardedLayer spreads the
+   accounts over several MasterBankers, each reached through one of those.
 
    Note that the ZmqLayer will discover the MasterBanker zmq endpoint via the
    ConfigurationService (most of the time ZooKeeper).
@@ -183,6 +184,94 @@ private:
     budgetResultCallback(const BudgetController::OnBudgetResult & onResult);
 };
 
+/*****************************************************************************/
+/* SHARDED LAYER                                                             */
+/*****************************************************************************/
+
+/** Spreads the accounts over several master bankers, each holding a subset
+    of the top-level accounts along with all their sub-accounts.
+
+    The shard of a top-level account is found by consistent hashing so
+    that all the slaves agree on it as long as they are given the shards in
+    the same order, and so that adding a shard only moves about 1/n of the
+    accounts.
+
+    Requests about an account go to its shard.  The batched requests, whose
+    payload is an object keyed by account, are split between the shards and
+    their responses merged back; the other requests go to all the shards and
+    the JSON object or array responses are merged.
+*/
+struct ShardedLayer : public ApplicationLayer {
+
+    void init(std::vector<std::shared_ptr<ApplicationLayer> > shards,
+              int pointsPerShard = 64);
+
+    /** Index of the shard holding the given top-level account. */
+    size_t shardOf(const std::string &topLevelAccount) const;
+
+    size_t numShards() const { return shards.size(); }
+
+    void addAccount(
+                    const AccountKey &account,
+                    const BudgetController::OnBudgetResult &onResult);
+
+    using ApplicationLayer::topupTransfer;
+    void topupTransfer(
+                    const std::string &accountStr,
+                    AccountType accountType,
+                    CurrencyPool amount,
+                    const BudgetController::OnBudgetResult &onResult);
+
+    void setBudget(
+                   const std::string &topLevelAccount,
+                   CurrencyPool amount,
+                   const BudgetController::OnBudgetResult &onResult);
+
+    void getAccountSummary(
+                   const AccountKey &account,
+                   int depth,
+                   std::function<void (std::exception_ptr, AccountSummary &&)>
+                   onResult);
+
+    void getAccount(
+                   const AccountKey &account,
+                   std::function<void (std::exception_ptr, Account &&)> onResult);
+
+    void addSpendAccount(const std::string &shadowStr,
+                         std::function<void (std::exception_ptr, Account&&)> onDone);
+
+    void syncAccount(const ShadowAccount & account, const std::string &shadowStr,
+                     std::function<void (std::exception_ptr,
+                                   Account &&)> onDone);
+    void request(std::string method, const std::string &resource,
+               const RestParams &params,
+               const std::string &content,
+               OnRequestResult onResult);
+private:
+    std::vector<std::shared_ptr<ApplicationLayer> > shards;
+
+    /// Hash ring: sorted points and the shard that owns each of them
+    std::vector<std::pair<uint64_t, size_t> > ring;
+
+    ApplicationLayer & shardFor(const AccountKey &account) const
+    {
+        return *shards[shardOf(account.at(0))];
+    }
+
+    ApplicationLayer & shardFor(const std::string &accountStr) const
+    {
+        return shardFor(AccountKey(accountStr));
+    }
+
+    void requestBatched(const std::string &method, const std::string &resource,
+                        const RestParams &params, const std::string &content,
+                        OnRequestResult onResult);
+
+    void requestAll(const std::string &method, const std::string &resource,
+                    const RestParams &params, const std::string &content,
+                    OnRequestResult onResult);
+};
+
 template<typename Layer, typename... Args>
 std::shared_ptr<Layer> make_application_layer(Args&& ...args)
 {
@@ -296,6 +296,18 @@ public:
                               const std::string & item,
                               Amount amount) = 0;
 
+    /*
+     * Authorize a batch of bids, setting the authorized field of each one
+     * as authorizeBid() would have returned for it.  Bankers override this
+     * to look up and lock each account once for all of its bids rather than
+     * once per bid.
+     */
+    virtual void authorizeBids(std::vector<BidAuthorization> & bids)
+    {
+        for (auto & bid: bids)
+            bid.authorized = authorizeBid(bid.account, bid.item, bid.amount);
+    }
+
     /*
      * Cancel the bid that was previously authorized. If we fail to find the bid
      * we return false.Otherwise we return the bid amount to the available pool
@@ -325,6 +337,23 @@ public:
     virtual Amount detachBid(const AccountKey & account,
                              const std::string & item) = 0;
 
+    /*
+     * Same as cancelBid() and detachBid() for an account given by its
+     * handle, as interned by accountHandles().  Bankers that keep their
+     * accounts by handle override these to skip the lookup of the key.
+     */
+    virtual void cancelBidByHandle(AccountHandle account,
+                                   const std::string & item)
+    {
+        cancelBid(accountHandles().key(account), item);
+    }
+
+    virtual Amount detachBidByHandle(AccountHandle account,
+                                     const std::string & item)
+    {
+        return detachBid(accountHandles().key(account), item);
+    }
+
     /** Commit a bid.  This is used internally to both cancel and win bids.
         Asynchonous and returns no value.
     */
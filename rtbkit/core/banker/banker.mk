@@ -15,7 +15,7 @@ $(eval $(call library,banker,$(LIBBANKER_SOURCES),$(LIBBANKER_LINK)))
 
 $(eval $(call program,banker_service_runner,banker boost_program_options))
 
-$(eval $(call library,gobanker,go_account.cc local_banker.cc))
+$(eval $(call library,gobanker,go_account.cc local_banker.cc,gc))
 
 $(eval $(call python_program,banker_backup,banker_backup.py))
 $(eval $(call python_program,banker_restore,banker_restore.py))
@@ -16,6 +16,7 @@
 #include <boost/make_shared.hpp>
 
 #include "rtbkit/core/banker/master_banker.h"
+#include "soa/service/redis_cluster.h"
 #include "soa/service/service_utils.h"
 #include "soa/service/process_stats.h"
 #include "jml/utils/pair_utils.h"
@@ -44,7 +45,10 @@ int main(int argc, char ** argv)
     int redisDatabase = 0;
 
     int redisTimeout = 0;
+    int redisConnections = 1;
     int saveInterval = 0;
+    int compactionInterval = 0;
+    int shardIndex = -1;
 
     bool debug = false;
 
@@ -59,8 +63,15 @@ int main(int argc, char ** argv)
          "Database of connection to redis")
         ("redis-save-timeout", value<int>(&redisTimeout)->default_value(10),
          "Delay at which redis calls will timeout")
+        ("redis-connections", value<int>(&redisConnections)->default_value(1),
+         "Number of connections to redis that the commands are spread over")
         ("save-interval", value<int>(&saveInterval)->default_value(10),
          "Periodic delay at which state will be saved")
+        ("compaction-interval", value<int>(&compactionInterval)->default_value(300),
+         "Periodic delay at which all accounts are saved instead of the modified ones")
+        ("shard-index", value<int>(&shardIndex),
+         "Index of this banker in a sharded deployment, each shard must "
+         "persist to its own redis database")
         ("fixed-http-bind-address,a", value(&fixedHttpBindAddresses),
          "Fixed address (host:port or *:port) at which we will always listen")
         ("debug", bool_switch(&debug),
@@ -95,10 +106,16 @@ int main(int argc, char ** argv)
     if (debug)
         banker.debug.activate();
 
+    if (shardIndex >= 0)
+        banker.setShard(shardIndex);
+
     if (redisUri != "nopersistence") {
         std::cout << " redisUri=" << redisUri << std::endl;
         auto address = Redis::Address(redisUri);
-        redis = std::make_shared<Redis::AsyncConnection>(redisUri);
+        if (redisConnections > 1)
+            redis = std::make_shared<Redis::ConnectionPool>(
+                    address, redisConnections);
+        else redis = std::make_shared<Redis::AsyncConnection>(address);
         if(redisPassword != "")
             redis->auth(redisPassword);
         if(redisDatabase != 0)
@@ -109,7 +126,8 @@ int main(int argc, char ** argv)
             persistence->debug.activate();
         banker.init(
                 persistence,
-                saveInterval);
+                saveInterval,
+                compactionInterval);
     }
     else {
         cerr << "*** WARNING ***" << endl;
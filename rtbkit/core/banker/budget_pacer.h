@@ -0,0 +1,118 @@
+/* budget_pacer.h                                                  -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Forecast of the budget a slave banker needs per account.
+*/
+
+#pragma once
+
+#include "rtbkit/common/currency.h"
+#include "rtbkit/common/account_key.h"
+#include <unordered_map>
+#include <algorithm>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* BUDGET PACER                                                              */
+/*****************************************************************************/
+
+/** Decides how much budget a slave banker should hold on each of its spend
+    accounts for the next sync window, based on what was committed on the
+    account over the previous windows.
+
+    The forecast is an exponential moving average of the commitments made per
+    window. An account that used up most of what it was given is assumed to
+    have been starved, since the NOBUDGET rejections don't show up in its
+    commitments, so its forecast is doubled instead. The request is the
+    forecast plus some headroom, bounded by the fixed spend rate that the
+    slave banker would otherwise ask for; a new account starts at that bound.
+
+    Holding less budget on slow accounts leaves more of it in the master for
+    the other slaves and limits the overspend once the budget runs out.
+
+    Not thread safe; meant to be called from the reauthorize loop only.
+*/
+struct BudgetPacer {
+
+    BudgetPacer(double smoothing = 0.25, double headroom = 1.5,
+                double minFraction = 0.01)
+        : smoothing(smoothing), headroom(headroom), minFraction(minFraction)
+    {
+    }
+
+    /** Returns the balance to request for the account given the total of
+        the commitments made on it so far, never more than maxRate.
+    */
+    CurrencyPool next(const AccountKey & account,
+                      const CurrencyPool & commitmentsMade,
+                      const CurrencyPool & maxRate)
+    {
+        auto ret = accounts.insert(std::make_pair(account, State()));
+        State & state = ret.first->second;
+
+        CurrencyPool request, forecasts;
+
+        for (const Amount & cap : maxRate.currencyAmounts) {
+            const CurrencyCode & currency = cap.currencyCode;
+            double max = cap.value;
+            double min = max * minFraction;
+
+            double forecast = max;
+
+            if (!ret.second) {
+                double used =
+                    commitmentsMade.getAvailable(currency).value
+                    - state.commitmentsMade.getAvailable(currency).value;
+                double given = state.request.getAvailable(currency).value;
+                forecast = state.forecast.getAvailable(currency).value;
+
+                used = std::max(used, 0.0);
+
+                if (given > 0.0 && used >= given * 0.9)
+                    forecast = std::max(forecast, used) * 2.0;
+                else forecast += smoothing * (used - forecast);
+
+                forecast = std::min(forecast, max);
+            }
+
+            forecasts += Amount(currency, int64_t(forecast));
+
+            double value = std::max(min, std::min(max, forecast * headroom));
+            request += Amount(currency, int64_t(value));
+        }
+
+        state.commitmentsMade = commitmentsMade;
+        state.request = request;
+        state.forecast = forecasts;
+
+        return request;
+    }
+
+    /** Forgets about an account that is no longer spending. */
+    void erase(const AccountKey & account)
+    {
+        accounts.erase(account);
+    }
+
+    size_t size() const { return accounts.size(); }
+
+    double smoothing;
+    double headroom;
+    double minFraction;
+
+private:
+
+    struct State {
+        CurrencyPool commitmentsMade;  ///< As of the last request
+        CurrencyPool request;          ///< Last balance requested
+        CurrencyPool forecast;         ///< Commitments expected per window
+    };
+
+    std::unordered_map<AccountKey, State> accounts;
+};
+
+} // namespace RTBKIT
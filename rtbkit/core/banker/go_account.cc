@@ -6,6 +6,7 @@
 */
 
 #include "go_account.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -77,20 +78,18 @@ GoAccount::toJson()
 // Router Account
 
 GoRouterAccount::GoRouterAccount(const AccountKey &key)
-    : GoBaseAccount(key)
+    : GoBaseAccount(key), balance(0), bidsLastPeriod(0)
 {
     rate = MicroUSD(0);
-    balance = MicroUSD(0);
 }
 
 GoRouterAccount::GoRouterAccount(Json::Value &json)
-    : GoBaseAccount(json)
+    : GoBaseAccount(json), balance(0), bidsLastPeriod(0)
 {
     if (json.isMember("rate")) rate = MicroUSD(json["rate"].asInt());
     else rate = MicroUSD(0);
 
-    if (json.isMember("balance")) balance = MicroUSD(json["balance"].asInt());
-    else balance = MicroUSD(0);
+    if (json.isMember("balance")) balance = json["balance"].asInt();
 }
 
 void
@@ -102,8 +101,8 @@ GoRouterAccount::setMaxBalance(const Amount & newMaxBalance)
 Amount
 GoRouterAccount::updateBalance(const Amount & newBalance)
 {
-    Amount spent = previousBalance - balance;
-    balance = newBalance;
+    int64_t current = balance.exchange(newBalance.value);
+    Amount spent = previousBalance - MicroUSD(current);
     previousBalance = newBalance;
     return spent;
 }
@@ -111,57 +110,59 @@ GoRouterAccount::updateBalance(const Amount & newBalance)
 Amount
 GoRouterAccount::accumulateBalance(const Amount & newBalance)
 {
-    Amount spent = previousBalance - balance;
-    balance += newBalance;
-    if (balance > maxBalance) {
-        balance = maxBalance;
-    }
-    previousBalance = balance;
+    // Bids keep coming in while the new balance is added so the cap has to
+    // be applied in the same atomic step.
+    int64_t current = balance.load();
+    int64_t next;
+    do {
+        next = std::min(current + newBalance.value, maxBalance.value);
+    } while (!balance.compare_exchange_weak(current, next));
+
+    Amount spent = previousBalance - MicroUSD(current);
+    previousBalance = MicroUSD(next);
     return spent;
 }
 
 bool
 GoRouterAccount::bid(Amount bidPrice)
 {
-    ++bidsLastPeriod;
-    if (balance >= bidPrice) {
-        balance -= bidPrice;
-        return true;
-    }
-    return false;
+    bidsLastPeriod.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t current = balance.load(std::memory_order_relaxed);
+    do {
+        if (current < bidPrice.value)
+            return false;
+    } while (!balance.compare_exchange_weak(current, current - bidPrice.value));
+
+    return true;
 }
 
 void
 GoRouterAccount::toJson(Json::Value &account)
 {
     account["rate"] = rate.value;
-    account["balance"] = balance.value;
+    account["balance"] = int64_t(balance);
     GoBaseAccount::toJson(account);
 }
 
 // Post Auction Account
 GoPostAuctionAccount::GoPostAuctionAccount(const AccountKey &key)
-    : GoBaseAccount(key)
+    : GoBaseAccount(key), imp(0), spend(0)
 {
-    imp = 0;
-    spend = MicroUSD(0);
 }
 
 GoPostAuctionAccount::GoPostAuctionAccount(Json::Value &json)
-    : GoBaseAccount(json)
+    : GoBaseAccount(json), imp(0), spend(0)
 {
     if (json.isMember("imp")) imp = json["imp"].asInt();
-    else imp = 0;
-
-    if (json.isMember("spend")) spend = MicroUSD(json["spend"].asInt());
-    else spend = MicroUSD(0);
+    if (json.isMember("spend")) spend = json["spend"].asInt();
 }
 
 bool
 GoPostAuctionAccount::win(Amount winPrice)
 {
-    spend += winPrice;
-    imp += 1;
+    spend.fetch_add(winPrice.value, std::memory_order_relaxed);
+    imp.fetch_add(1, std::memory_order_relaxed);
     return true;
 }
 
@@ -169,7 +170,7 @@ void
 GoPostAuctionAccount::toJson(Json::Value &account)
 {
     account["imp"] = int64_t(imp);
-    account["spend"] = spend.value;
+    account["spend"] = int64_t(spend);
     GoBaseAccount::toJson(account);
 }
 
@@ -198,8 +199,29 @@ GoBaseAccount::toJson(Json::Value &account)
 
 // Accounts
 
-GoAccounts::GoAccounts() : accounts{}
+GoAccounts::GoAccounts() : accounts{}, published(new AccountMap())
+{
+}
+
+GoAccounts::~GoAccounts()
+{
+    gc.deferBarrier();
+    delete published.load();
+}
+
+void
+GoAccounts::publish()
+{
+    const AccountMap * old = published.exchange(new AccountMap(accounts));
+    gc.defer([=] { delete old; });
+}
+
+const GoAccount*
+GoAccounts::find(const AccountKey &key) const
 {
+    const AccountMap * current = published.load();
+    auto it = current->find(key);
+    return it == current->end() ? nullptr : &it->second;
 }
 
 void
@@ -217,6 +239,7 @@ GoAccounts::add(const AccountKey &key, GoAccountType type)
     if (exists(key)) return;
     std::lock_guard<std::mutex> guard(this->mutex);
     accounts.insert( pair<AccountKey, GoAccount>(key, GoAccount(key, type)) );
+    publish();
 }
 
 bool
@@ -238,6 +261,7 @@ GoAccounts::addFromJsonString(std::string jsonAccount)
         std::lock_guard<std::mutex> guard(this->mutex);
         GoAccount account(json);
         accounts.insert( pair<AccountKey, GoAccount>(key, account) );
+        publish();
         //cout << "account in map: " << accounts[key].toJson() << endl;
         return true;
     } else {
@@ -267,6 +291,7 @@ GoAccounts::replaceFromJsonString(std::string jsonAccount)
                 (account.pal->imp > accounts[key].pal->imp ||
                 account.pal->spend > accounts[key].pal->spend)) {
             accounts[key] = account;
+            publish();
         }
         return true;
     } else {
@@ -296,50 +321,68 @@ GoAccounts::accumulateBalance(const AccountKey &key, const Amount & newBalance)
 Amount
 GoAccounts::getBalance(const AccountKey &key)
 {
-    if (!exists(key)) return MicroUSD(0);
-    std::lock_guard<std::mutex> guard(this->mutex);
-    auto account = get(key);
-    return account->router->balance;
+    Datacratic::GcLockBase::SharedGuard guard(gc, Datacratic::GcLockBase::RD_NO);
+    auto account = find(key);
+    if (!account) return MicroUSD(0);
+    return MicroUSD(int64_t(account->router->balance));
 }
 
 bool
 GoAccounts::bid(const AccountKey &key, Amount bidPrice)
 {
-    if (!exists(key)) return false;
+    Datacratic::GcLockBase::SharedGuard guard(gc, Datacratic::GcLockBase::RD_NO);
+    auto account = find(key);
+    if (!account) return false;
+
+    if (account->type != ROUTER) {
+        throw ML::Exception("GoAccounts::bid: attempt bid on non ROUTER account");
+    }
+
+    return account->router->bid(bidPrice);
+}
+
+void
+GoAccounts::bid(const AccountKey &key, const Amount * bidPrices, size_t numBids,
+                bool * authorized)
+{
+    Datacratic::GcLockBase::SharedGuard guard(gc, Datacratic::GcLockBase::RD_NO);
+    auto account = find(key);
+    if (!account) {
+        std::fill(authorized, authorized + numBids, false);
+        return;
+    }
 
-    std::lock_guard<std::mutex> guard(this->mutex);
-    auto account = get(key);
     if (account->type != ROUTER) {
         throw ML::Exception("GoAccounts::bid: attempt bid on non ROUTER account");
     }
 
-    return account->bid(bidPrice);
+    for (size_t i = 0; i < numBids; ++i)
+        authorized[i] = account->router->bid(bidPrices[i]);
 }
 
 bool
 GoAccounts::win(const AccountKey &key, Amount winPrice)
 {
-    if (!exists(key)) {
+    Datacratic::GcLockBase::SharedGuard guard(gc, Datacratic::GcLockBase::RD_NO);
+    auto account = find(key);
+    if (!account) {
         cout << "account not found, unaccounted win: " << key.toString()
              << " " << winPrice.toString() << endl;
         return false;
     }
 
-    std::lock_guard<std::mutex> guard(this->mutex);
-    auto account = get(key);
     if (account->type != POST_AUCTION) {
         throw ML::Exception("GoAccounts::win: attempt win on non POST_AUCTION account");
     }
 
-    return account->win(winPrice);
+    return account->pal->win(winPrice);
 }
 
 bool
 GoAccounts::exists(const AccountKey &key)
 {
-    std::lock_guard<std::mutex> guard(this->mutex);
-    bool exists = accounts.find(key) != accounts.end();
-    return exists;
+    Datacratic::GcLockBase::SharedGuard guard(gc, Datacratic::GcLockBase::RD_NO);
+    return find(key) != nullptr;
 }
 
 GoAccount*
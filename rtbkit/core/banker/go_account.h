@@ -13,6 +13,7 @@
 #include <unordered_map>
 
 #include "soa/jsoncpp/json.h"
+#include "soa/gc/gc_lock.h"
 #include "rtbkit/common/currency.h"
 #include "rtbkit/common/account_key.h"
 
@@ -27,12 +28,16 @@ struct GoBaseAccount {
     virtual void toJson(Json::Value &account);
 };
 
+/** The balance and the bid count are atomics so that bids can be
+    authorized from any number of threads without a lock; the other
+    members are only touched by the reauthorize loop.
+*/
 struct GoRouterAccount : public GoBaseAccount {
     Amount rate;
-    Amount balance;
+    std::atomic<int64_t> balance;  ///< In USD/1M
     Amount maxBalance;
     Amount previousBalance;
-    int bidsLastPeriod;
+    std::atomic<int> bidsLastPeriod;
 
     GoRouterAccount(const AccountKey &key);
     GoRouterAccount(Json::Value &json);
@@ -46,7 +51,7 @@ struct GoRouterAccount : public GoBaseAccount {
 
 struct GoPostAuctionAccount : public GoBaseAccount {
     std::atomic<int64_t> imp;
-    Amount spend;
+    std::atomic<int64_t> spend;    ///< In USD/1M
 
     GoPostAuctionAccount(const AccountKey &key);
     GoPostAuctionAccount(Json::Value &jsonAccount);
@@ -73,11 +78,20 @@ struct GoAccount {
     Json::Value toJson();
 };
 
+/** The bids and wins only read the map of accounts, so they go through a
+    copy of it which is published under RCU each time an account is added
+    or replaced and spend on the accounts themselves with atomics; they
+    never take the mutex which only serializes the changes to the map.
+*/
 struct GoAccounts {
+    typedef std::unordered_map<AccountKey, GoAccount> AccountMap;
+
     std::mutex mutex;
-    std::unordered_map<AccountKey, GoAccount> accounts;
+    AccountMap accounts;
 
     GoAccounts();
+    ~GoAccounts();
+
     void setMaxBalance(const AccountKey &key, const Amount & maxBalance);
     bool exists(const AccountKey& key);
     void add(const AccountKey&, GoAccountType type);
@@ -87,12 +101,32 @@ struct GoAccounts {
     Amount accumulateBalance(const AccountKey &key, const Amount & newBalance);
     Amount getBalance(const AccountKey &key);
     bool bid(const AccountKey &key, Amount bidPrice);
+
+    /** Same as above for several bids on the account, which is only looked
+        up once.  authorized[i] is set to whether bidPrices[i] went through.
+    */
+    void bid(const AccountKey &key, const Amount * bidPrices, size_t numBids,
+             bool * authorized);
+
     bool win(const AccountKey &key, Amount winPrice);
     Json::Value toJson();
 
 private:
     Amount MaxBalance;
     GoAccount* get(const AccountKey&);
+
+    /** Account in the published copy of the map or null.  Must be called
+        with the gc lock held.
+    */
+    const GoAccount* find(const AccountKey&) const;
+
+    /** Publishes a copy of the accounts to the readers, with the mutex
+        held.
+    */
+    void publish();
+
+    std::atomic<const AccountMap*> published;
+    mutable Datacratic::GcLock gc;
 };
 
 } // namespace RTBKIT
@@ -430,8 +430,7 @@ LocalBanker::sendBidCounts()
     {
         std::lock_guard<std::mutex> guard(this->mutex);
         for (auto it : accounts.accounts) {
-            payload[it.first.toString()] = it.second.router->bidsLastPeriod;
-            it.second.router->bidsLastPeriod = 0;
+            payload[it.first.toString()] = it.second.router->bidsLastPeriod.exchange(0);
         }
     }
     httpClient->post("/bidCounts", cbs, payload, {}, {}, 1.0);
@@ -485,6 +484,42 @@ LocalBanker::bid(const AccountKey &key, Amount bidPrice)
     return canBid;
 }
 
+void
+LocalBanker::
+authorizeBids(std::vector<BidAuthorization> & bids)
+{
+    // The bids of a batch are mostly on the same account, whose local key is
+    // only built and looked up once
+    for (size_t i = 0; i < bids.size();) {
+        const AccountKey & account = bids[i].account;
+        size_t end = i + 1;
+        while (end < bids.size() && bids[end].account == account)
+            ++end;
+
+        ML::compact_vector<Amount, 8> prices;
+        ML::compact_vector<bool, 8> authorized(end - i, false);
+        for (size_t j = i; j < end; ++j)
+            prices.push_back(bids[j].amount);
+
+        string key = account.toString() + ":" + accountSuffix;
+        accounts.bid(key, &prices[0], prices.size(), &authorized[0]);
+
+        for (size_t j = i; j < end; ++j) {
+            bool canBid = bids[j].authorized = authorized[j - i];
+            (canBid) ? recordHit("Bid") : recordHit("noBid");
+
+            if (debug) {
+                if (canBid)
+                    recordHit("account." + account.toString() + ":" + accountSuffixNoDot + ".Bid");
+                else
+                    recordHit("account." + account.toString() + ":" + accountSuffixNoDot + ".noBid");
+            }
+        }
+
+        i = end;
+    }
+}
+
 bool
 LocalBanker::win(const AccountKey &key, Amount winPrice)
 {
@@ -52,6 +52,9 @@ struct LocalBanker : public Banker, Datacratic::MessageLoop, Datacratic::Service
         return bid(account, amount);
     }
 
+    virtual void
+    authorizeBids(std::vector<BidAuthorization> & bids);
+
     virtual void
     cancelBid(const AccountKey & account,
               const std::string & item)
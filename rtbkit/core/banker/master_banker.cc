@@ -132,6 +132,21 @@ saveAll(const Accounts & toSave, OnSavedCallback onSaved)
     /* TODO: we need to check the content of the "banker:accounts" set for
      * "extra" account keys */
 
+    vector<AccountKey> allKeys;
+    auto onAccount = [&] (const AccountKey & key, const Account & account)
+        {
+            allKeys.push_back(key);
+        };
+    toSave.forEachAccount(onAccount);
+
+    saveAccounts(toSave, allKeys, onSaved);
+}
+
+void
+RedisBankerPersistence::
+saveAccounts(const Accounts & toSave, const vector<AccountKey> & toSaveKeys,
+             OnSavedCallback onSaved)
+{
     // Phase 1: we load all of the keys.  This way we can know what is
     // present and deal with keys that should be zeroed out.  We can also
     // detect if we have a synchronization error and bail out.
@@ -145,15 +160,14 @@ saveAll(const Accounts & toSave, OnSavedCallback onSaved)
         return rhs.secondsSince(lhs) * 1000;
     };
 
-    /* fetch all account keys and values from storage */
-    auto onAccount = [&] (const AccountKey & key,
-                          const Account & account)
-        {
-            string keyStr = key.toString();
-            keys.push_back(keyStr);
-            fetchCommand.addArg(PREFIX + keyStr);
-        };
-    toSave.forEachAccount(onAccount);
+    /* fetch the account values from storage */
+    for (const AccountKey & key: toSaveKeys) {
+        if (!toSave.accountPresentAndActive(key).first)
+            continue;
+        string keyStr = key.toString();
+        keys.push_back(keyStr);
+        fetchCommand.addArg(PREFIX + keyStr);
+    }
 
     const Date beforePhase1Time = Date::now();
     auto onPhase1Result = [=] (const Redis::Result & result)
@@ -585,7 +599,10 @@ MasterBanker(std::shared_ptr<ServiceProxies> proxies,
              const string & serviceName)
     : ServiceBase(serviceName, proxies),
       RestServiceEndpoint(proxies->zmqContext),
-      saving(false)
+      shardIndex(-1),
+      saving(false),
+      compactionInterval(Default::CompactionInterval),
+      savingAll(false)
 {
     /* Set the Access-Control-Allow-Origins: * header to allow browser-based
        REST calls directly to the endpoint.
@@ -606,11 +623,13 @@ MasterBanker::
 
 void
 MasterBanker::
-init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
+init(const shared_ptr<BankerPersistence> & storage, double saveInterval,
+     double compactionInterval)
 {
     recordHit("up");
 
     this->storage_ = storage;
+    this->compactionInterval = compactionInterval;
 
     loadStateSync();
 
@@ -625,7 +644,7 @@ init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
                 }
             });
 
-    registerServiceProvider(serviceName(), { "rtbBanker" });
+    registerServiceProvider(serviceName(), serviceClasses());
 
     getServices()->config->removePath(serviceName());
     RestServiceEndpoint::init(getServices()->config, serviceName());
@@ -870,10 +889,20 @@ void
 MasterBanker::
 shutdown()
 {
-    unregisterServiceProvider(serviceName(), { "rtbBanker" });
+    unregisterServiceProvider(serviceName(), serviceClasses());
     RestServiceEndpoint::shutdown();
 }
 
+std::vector<std::string>
+MasterBanker::
+serviceClasses() const
+{
+    std::vector<std::string> result = { "rtbBanker" };
+    if (shardIndex >= 0)
+        result.push_back(ML::format("rtbBanker.%d", shardIndex));
+    return result;
+}
+
 Json::Value
 MasterBanker::
 createAccount(const AccountKey & key, AccountType type)
@@ -916,6 +945,8 @@ onStateSaved(const BankerPersistence::Result& result,
         //     <<  ": banker state saved successfully to backend" << endl;
         recordHit("save.success");
         lastSavedState = Date::now();
+        if (savingAll)
+            lastFullSave = lastSavedState;
     }
     else if (result.status == BankerPersistence::DATA_INCONSISTENCY) {
         recordHit("save.inconsistencies");
@@ -940,6 +971,12 @@ onStateSaved(const BankerPersistence::Result& result,
         throw ML::Exception("status code is not handled");
     }
 
+    // The accounts that couldn't be written go in the next save, except
+    // for the out of sync ones which are skipped anyway.
+    if (result.status != BankerPersistence::SUCCESS)
+        accounts.markAccountsDirty(savingAccounts);
+    savingAccounts.clear();
+
     lastSaveInfo = std::move(info);
     lastSaveStatus = result.status;
 
@@ -963,9 +1000,28 @@ saveState()
         return;
 
     saving = true;
-    storage_->saveAll(accounts, bind(&MasterBanker::onStateSaved, this,
-                                          placeholders::_1,
-                                          placeholders::_2));
+
+    // Only the accounts modified since the last save are written, but a
+    // full save now and then compares every account against the storage
+    // to catch up with anything that could have been missed.
+    Date now = Date::now();
+    savingAll = lastFullSave == Date()
+        || now.secondsSince(lastFullSave) >= compactionInterval;
+    savingAccounts = accounts.takeDirtyAccounts();
+
+    auto onSaved = bind(&MasterBanker::onStateSaved, this,
+                        placeholders::_1,
+                        placeholders::_2);
+
+    if (savingAll) {
+        recordHit("save.full");
+        storage_->saveAll(accounts, onSaved);
+    }
+    else {
+        recordHit("save.incremental");
+        recordLevel(savingAccounts.size(), "save.dirtyAccounts");
+        storage_->saveAccounts(accounts, savingAccounts, onSaved);
+    }
 }
 
 void
@@ -38,6 +38,7 @@ inline std::string restEncode(const AccountKey & val)
 namespace Default {
     static constexpr int RedisTimeout = 10;
     static constexpr double SaveInterval = 10.0;
+    static constexpr double CompactionInterval = 300.0;
 }
 
 
@@ -197,6 +198,16 @@ struct BankerPersistence {
                          OnLoadedCallback onLoaded) = 0;
     virtual void saveAll(const Accounts & toSave,
                          OnSavedCallback onDone) = 0;
+
+    /** Save only the given accounts, which are the ones that changed since
+        the last save.  Backends that can't do better save everything.
+    */
+    virtual void saveAccounts(const Accounts & toSave,
+                              const std::vector<AccountKey> & keys,
+                              OnSavedCallback onDone)
+    {
+        saveAll(toSave, onDone);
+    }
     virtual void restoreFromArchive(const AccountKey & accountName,
                          OnRestoredCallback onRestored) = 0;
 };
@@ -251,6 +262,9 @@ struct RedisBankerPersistence : public BankerPersistence {
 
     void loadAll(const std::string & topLevelKey, OnLoadedCallback onLoaded);
     void saveAll(const Accounts & toSave, OnSavedCallback onDone);
+    void saveAccounts(const Accounts & toSave,
+                      const std::vector<AccountKey> & keys,
+                      OnSavedCallback onDone);
     void restoreFromArchive(const AccountKey & key, OnRestoredCallback onRestored);
 private:
     void moveToActive(const std::vector<AccountKey> & archivedAccountKeys,
@@ -292,8 +306,13 @@ struct MasterBanker
 
     std::shared_ptr<BankerPersistence> storage_;
 
+    /** The state is saved every saveInterval seconds, writing only the
+        accounts that changed except for a full save every
+        compactionInterval seconds.
+    */
     void init(const std::shared_ptr<BankerPersistence> & storage,
-              double saveInterval = Default::SaveInterval);
+              double saveInterval = Default::SaveInterval,
+              double compactionInterval = Default::CompactionInterval);
     void start();
     std::pair<std::string, std::string> bindTcp();
 
@@ -308,6 +327,18 @@ struct MasterBanker
     */
     void bindFixedHttpAddress(const std::string & uri);
 
+    /** Make this banker one of the shards of a sharded deployment, which
+        also registers it under the "rtbBanker.<index>" service class so
+        that the slaves can find each shard.  The slaves decide which
+        accounts end up on which shard.  Must be called before init().
+    */
+    void setShard(int index)
+    {
+        shardIndex = index;
+    }
+
+    int shardIndex;  ///< -1 when the banker isn't sharded
+
     RestRequestRouter router;
     Accounts accounts;
 
@@ -321,6 +352,11 @@ struct MasterBanker
     mutable Lock saveLock;
     int saving;
 
+    double compactionInterval;
+    Date lastFullSave;
+    bool savingAll;
+    std::vector<AccountKey> savingAccounts;  ///< Of the save in progress
+
     Json::Value createAccount(const AccountKey & key, AccountType type);
     Json::Value getAccountsSimpleSummaries(int depth);
 
@@ -350,6 +386,8 @@ struct MasterBanker
     static Logging::Category debug;
 
 private:
+    std::vector<std::string> serviceClasses() const;
+
     const Account onCreateAccount(const AccountKey &account, AccountType type);
     const Account setBudget(const AccountKey &key, const CurrencyPool &newBudget);
     const Account setBalance(const AccountKey &key, CurrencyPool amount, AccountType type);
@@ -71,6 +71,14 @@ authorizeBid(const AccountKey & account,
 //----------------------------------------------------------------------
 void
 NullBanker::
+authorizeBids(std::vector<BidAuthorization> & bids)
+{
+    for (auto & bid: bids)
+        bid.authorized = authorize_;
+}
+//----------------------------------------------------------------------
+void
+NullBanker::
 commitBid(const AccountKey & account,
           const std::string & item,
           Amount amountPaid,
@@ -50,6 +50,8 @@ public:
                               const std::string & item,
                               Amount amount);
 
+    virtual void authorizeBids(std::vector<BidAuthorization> & bids);
+
     /** Commit a bid.  This is used internally to both cancel and win bids.
         Asynchonous and returns no value.
     */
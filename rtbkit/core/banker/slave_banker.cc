@@ -7,6 +7,7 @@
 
 #include "slave_banker.h"
 #include "jml/utils/vector_utils.h"
+#include "jml/utils/string_functions.h"
 
 using namespace std;
 using namespace Datacratic;
@@ -119,7 +120,8 @@ Logging::Category SlaveBanker::error("SlaveBanker Error", SlaveBanker::print);
 Logging::Category SlaveBanker::trace("SlaveBanker Trace", SlaveBanker::print);
 
 SlaveBanker::SlaveBanker()
-    : createdAccounts(128), reauthorizing(false), numReauthorized(0)
+    : createdAccounts(128), syncRate(1.0), batchedSync(false), adaptivePacing(false),
+      reauthorizing(false), numReauthorized(0)
 {
 }
 
@@ -129,7 +131,8 @@ SlaveBanker(
         CurrencyPool spendRate,
         double syncRate,
         bool batchedUpdates)
-    : createdAccounts(128), reauthorizing(false), numReauthorized(0)
+    : createdAccounts(128), syncRate(1.0), batchedSync(false), adaptivePacing(false),
+      reauthorizing(false), numReauthorized(0)
 {
     init(accountSuffix, spendRate, syncRate, batchedUpdates);
 }
@@ -187,6 +190,8 @@ init(const std::string & accountSuffix,
 
     this->accountSuffix = accountSuffix;
     this->spendRate = spendRate * syncRate;
+    this->syncRate = syncRate;
+    this->batchedSync = batchedUpdates;
 
     LOG(print) << "Sync Rate: " << syncRate << std::endl;
     LOG(print) << "Spend Rate: " << spendRate.toJson().toString();
@@ -315,9 +320,9 @@ namespace {
     Logging::Category bankerDebug("BankerDebug");
 }
 
-void
+std::vector<AccountKey>
 SlaveBanker::
-syncAll(std::function<void (std::exception_ptr)> onDone)
+getSyncableAccounts()
 {
     auto allKeys = accounts.getAccountKeys();
 
@@ -335,7 +340,14 @@ syncAll(std::function<void (std::exception_ptr)> onDone)
             }
         }
 
-    allKeys.swap(filteredKeys);
+    return filteredKeys;
+}
+
+void
+SlaveBanker::
+syncAll(std::function<void (std::exception_ptr)> onDone)
+{
+    auto allKeys = getSyncableAccounts();
 
     if (allKeys.empty()) {
         // We need some kind of synchronization here because the lastSync
@@ -405,6 +417,85 @@ syncAll(std::function<void (std::exception_ptr)> onDone)
     }
 }
 
+void
+SlaveBanker::
+syncAllBatched(std::function<void (std::exception_ptr)> onDone)
+{
+    auto finish = [=] (std::exception_ptr exc)
+        {
+            if (!exc) {
+                std::lock_guard<Lock> guard(syncLock);
+                lastSync = Date::now();
+            }
+            if (onDone)
+                onDone(exc);
+            else if (exc)
+                cerr << "warning: batched sync ate exception" << endl;
+        };
+
+    // Shadow accounts that are the same as the last time they were synced
+    // would be a no-op on the master so they're left out of the request.
+    auto sent = std::make_shared<std::unordered_map<AccountKey, std::string> >();
+    Json::Value request(Json::objectValue);
+
+    for (auto & key: getSyncableAccounts()) {
+        Json::Value shadow = accounts.getAccount(key).toJson();
+        std::string shadowStr = shadow.toStringNoNewLine();
+
+        {
+            std::lock_guard<Lock> guard(syncLock);
+            auto it = syncedShadows.find(key);
+            if (it != syncedShadows.end() && it->second == shadowStr)
+                continue;
+        }
+
+        request[getShadowAccountStr(key)]["shadow"] = shadow;
+        (*sent)[key] = std::move(shadowStr);
+    }
+
+    if (sent->empty()) {
+        finish(nullptr);
+        return;
+    }
+
+    auto onResponse = [=] (std::exception_ptr exc, int code,
+                           const std::string & payload)
+        {
+            if (exc) {
+                finish(exc);
+                return;
+            }
+
+            try {
+                if (code != Default::ExpectedMasterHttpCode)
+                    throw ML::Exception("batched sync: expected HTTP %d, got %d",
+                                        Default::ExpectedMasterHttpCode, code);
+
+                Json::Value response = Json::parse(payload);
+                for (const auto & name: response.getMemberNames()) {
+                    AccountKey key = AccountKey(name).parent();
+                    auto master = Account::fromJson(response[name]);
+                    accounts.syncFromMaster(key, master);
+
+                    auto it = sent->find(key);
+                    if (it == sent->end())
+                        continue;
+
+                    std::lock_guard<Lock> guard(syncLock);
+                    syncedShadows[key] = std::move(it->second);
+                }
+            } catch (...) {
+                finish(std::current_exception());
+                return;
+            }
+
+            finish(nullptr);
+        };
+
+    applicationLayer->request("POST", "/v1/accounts/shadow", {},
+                              request.toStringNoNewLine(), onResponse);
+}
+
 void
 SlaveBanker::
 addSpendAccount(const AccountKey & accountKey,
@@ -460,20 +551,21 @@ reportSpend(uint64_t numTimeoutsExpired)
             if (exc)
                 logException(exc, "Exception when reporting spend", error);
         };
-    
-    syncAll(onDone);
+
+    if (batchedSync)
+        syncAllBatched(onDone);
+    else syncAll(onDone);
 }
 
 void
 SlaveBanker::
 reauthorizeBudgetBatched(uint64_t numTimeoutsExpired)
 {
-    Json::Value body;
-    body["amount"] = spendRate.toJson();
-    body["accountType"] = "spend";
-
     Json::Value request;
-    auto onAccount = [&](const AccountKey& key, const ShadowAccount& Account) {
+    auto onAccount = [&](const AccountKey& key, const ShadowAccount& account) {
+        Json::Value body;
+        body["amount"] = getReauthorizeAmount(key, account).toJson();
+        body["accountType"] = "spend";
         request[getShadowAccountStr(key)] = body;
     };
     accounts.forEachInitializedAndActiveAccount(onAccount);
@@ -535,7 +627,7 @@ reauthorizeBudget(uint64_t numTimeoutsExpired)
     auto onAccount = [&] (const AccountKey & key,
                           const ShadowAccount & account)
         {
-            Json::Value payload = spendRate.toJson();
+            Json::Value payload = getReauthorizeAmount(key, account).toJson();
 
             auto onDone = std::bind(&SlaveBanker::onReauthorizeBudgetMessage, this,
                                     key,
@@ -559,6 +651,14 @@ reauthorizeBudget(uint64_t numTimeoutsExpired)
     }
 }
 
+CurrencyPool
+SlaveBanker::
+getReauthorizeAmount(const AccountKey & key, const ShadowAccount & account)
+{
+    if (!adaptivePacing) return spendRate;
+    return pacer.next(key, account.commitmentsMade, spendRate);
+}
+
 void
 SlaveBanker::
 onReauthorizeBudgetMessage(const AccountKey & accountKey,
@@ -616,9 +716,16 @@ getProviderIndicators() const
     bool syncOk = now < lastSync.plusSeconds(Default::MaximumFailSyncSeconds) &&
                   now < lastReauthorize.plusSeconds(Default::MaximumFailSyncSeconds);
 
+    // Health goes down from 1 once a sync is overdue to 0 when it's failed.
+    double age = std::max(now.secondsSince(lastSync),
+                          now.secondsSince(lastReauthorize));
+    double grace = std::max(Default::MaximumFailSyncSeconds - syncRate, 1e-3);
+    double overdue = age - syncRate;
+
     MonitorIndicator ind;
     ind.serviceName = accountSuffix;
     ind.status = syncOk;
+    ind.health = syncOk ? std::min(1.0, std::max(0.0, 1.0 - overdue / grace)) : 0.0;
     ind.message = string() + "Sync with MasterBanker: " + (syncOk ? "OK" : "ERROR");
 
     return ind;
@@ -630,18 +737,22 @@ getProviderIndicators() const
 
 constexpr bool SlaveBankerArguments::Defaults::UseHttp;
 constexpr bool SlaveBankerArguments::Defaults::Batched;
+constexpr bool SlaveBankerArguments::Defaults::AdaptivePacing;
 constexpr int SlaveBankerArguments::Defaults::HttpConnections;
 constexpr bool SlaveBankerArguments::Defaults::TcpNoDelay;
+constexpr int SlaveBankerArguments::Defaults::Shards;
 const std::string SlaveBankerArguments::Defaults::SpendRate{"100000USD/1M"};
 
 SlaveBankerArguments::SlaveBankerArguments()
     : spendRateStr(Defaults::SpendRate)
     , syncRate(Defaults::SyncRate)
     , batched(Defaults::Batched)
+    , adaptivePacing(Defaults::AdaptivePacing)
     , useHttp(Defaults::UseHttp)
     , httpTimeout(Defaults::HttpTimeout)
     , httpConnections(Defaults::HttpConnections)
     , tcpNoDelay(Defaults::TcpNoDelay)
+    , shards(Defaults::Shards)
 {
 }
 
@@ -664,6 +775,9 @@ SlaveBankerArguments::makeProgramOptions(std::string title)
          "frequency at which the slave banker syncs itself with the master banker.")
         ("banker-batched", po::bool_switch(&batched),
          "slave banker now uses batched communication to sync with the master banker.")
+        ("banker-adaptive-pacing", po::bool_switch(&adaptivePacing),
+         "request the budget forecast for each account rather than the fixed spend rate, "
+         "which becomes an upper bound.")
         ("use-http-banker", po::bool_switch(&useHttp),
          "Communicate with the MasterBanker over http")
         ("banker-http-timeouts", po::value<double>(&httpTimeout),
@@ -671,7 +785,10 @@ SlaveBankerArguments::makeProgramOptions(std::string title)
         ("http-connections", po::value<int>(&httpConnections)->default_value(Defaults::HttpConnections),
          "Number of active http connections to use when http is enabled")
         ("banker-tcp-nodelay", po::bool_switch(&tcpNoDelay),
-          "Enable the TCP_NODELAY option for the http banker interface (use with caution)");
+          "Enable the TCP_NODELAY option for the http banker interface (use with caution)")
+        ("banker-shards", po::value<int>(&shards),
+         "Number of master bankers the accounts are sharded over.  With http, "
+         "the banker-uri holds the comma separated uri of each shard.");
 
     return options;
 }
@@ -688,6 +805,7 @@ makeBanker(std::shared_ptr<ServiceProxies> proxies, const std::string& accountSu
 {
     auto spendRate = CurrencyPool(Amount::parse(spendRateStr));
     auto banker = std::make_shared<SlaveBanker>(accountSuffix, spendRate, syncRate, batched);
+    if (adaptivePacing) banker->enableAdaptivePacing();
 
     banker->setApplicationLayer(makeApplicationLayer(std::move(proxies)));
     return banker;
@@ -701,10 +819,37 @@ SlaveBankerArguments::makeBankerDefault(std::shared_ptr<ServiceProxies> proxies)
 std::shared_ptr<ApplicationLayer>
 SlaveBankerArguments::makeApplicationLayer(std::shared_ptr<ServiceProxies> proxies) const
 {
-    std::shared_ptr<ApplicationLayer> layer;
+    ExcCheck(shards > 0, "The number of banker shards must be > 0");
+    if (shards == 1)
+        return makeShardLayer(proxies, proxies->bankerUri, "rtbBanker");
+
+    std::vector<std::string> uris;
     if (useHttp) {
-        auto bankerUri = proxies->bankerUri;
+        uris = ML::split(proxies->bankerUri, ',');
+        ExcCheck(uris.size() == size_t(shards),
+                "the banker-uri must hold the uri of each banker shard");
+    }
+    else uris.resize(shards);
+
+    std::vector<std::shared_ptr<ApplicationLayer> > layers;
+    for (int i = 0; i < shards; ++i) {
+        auto serviceClass = ML::format("rtbBanker.%d", i);
+        layers.push_back(makeShardLayer(proxies, uris[i], serviceClass));
+    }
 
+    LOG(print) << "accounts sharded over " << shards << " MasterBankers"
+               << std::endl;
+
+    return make_application_layer<ShardedLayer>(std::move(layers));
+}
+
+std::shared_ptr<ApplicationLayer>
+SlaveBankerArguments::makeShardLayer(std::shared_ptr<ServiceProxies> proxies,
+                                     const std::string & bankerUri,
+                                     const std::string & serviceClass) const
+{
+    std::shared_ptr<ApplicationLayer> layer;
+    if (useHttp) {
         ExcCheck(!bankerUri.empty(),
                 "the banker-uri must be specified in the bootstrap.json");
         ExcCheck(httpConnections > 0,
@@ -723,7 +868,7 @@ SlaveBankerArguments::makeApplicationLayer(std::shared_ptr<ServiceProxies> proxi
         layer = make_application_layer<HttpLayer>(bankerUri, httpTimeout, httpConnections, tcpNoDelay);
     }
     else {
-        layer = make_application_layer<ZmqLayer>(proxies);
+        layer = make_application_layer<ZmqLayer>(proxies, serviceClass);
         LOG(print) << "using zmq interface for the MasterBanker" << std::endl;
     }
 
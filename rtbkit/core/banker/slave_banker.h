@@ -10,6 +10,7 @@
 
 #include <atomic>
 #include "banker.h"
+#include "budget_pacer.h"
 #include "application_layer.h"
 #include "soa/service/zmq_endpoint.h"
 #include "soa/service/typed_message_channel.h"
@@ -144,6 +145,11 @@ struct SlaveBanker : public Banker, public MessageLoop {
         return accounts.authorizeBid(account, item, amount);
     }
 
+    virtual void authorizeBids(std::vector<BidAuthorization> & bids)
+    {
+        accounts.authorizeBids(bids);
+    }
+
     virtual void commitBid(const AccountKey & account,
                            const std::string & item,
                            Amount amountPaid,
@@ -158,6 +164,18 @@ struct SlaveBanker : public Banker, public MessageLoop {
         return accounts.detachBid(account, item);
     }
 
+    virtual void cancelBidByHandle(AccountHandle account,
+                                   const std::string & item)
+    {
+        accounts.cancelBid(account, item);
+    }
+
+    virtual Amount detachBidByHandle(AccountHandle account,
+                                     const std::string & item)
+    {
+        return accounts.detachBid(account, item);
+    }
+
     virtual void attachBid(const AccountKey & account,
                            const std::string & item,
                            Amount amountAuthorized)
@@ -212,6 +230,14 @@ struct SlaveBanker : public Banker, public MessageLoop {
     void syncAll(std::function<void (std::exception_ptr)> onDone
                  = std::function<void (std::exception_ptr)>());
 
+    /** Synchronize all accounts asynchronously with a single request to the
+        master banker, leaving out the accounts that didn't change since
+        their last successful sync.  Used instead of syncAll() when the
+        updates are batched.
+    */
+    void syncAllBatched(std::function<void (std::exception_ptr)> onDone
+                        = std::function<void (std::exception_ptr)>());
+
     /** Testing only: get the internal state of an account. */
     ShadowAccount getAccountStateDebug(AccountKey accountKey) const
     {
@@ -224,6 +250,16 @@ struct SlaveBanker : public Banker, public MessageLoop {
         addSource("SlaveBanker::ApplicationLayer", *layer);
     }
 
+    /** Request a forecast of what each account will spend over the next
+        sync window instead of the fixed spend rate, which becomes an upper
+        bound. See BudgetPacer.
+    */
+    void enableAdaptivePacing(double headroom = 1.5)
+    {
+        adaptivePacing = true;
+        pacer.headroom = headroom;
+    }
+
     bool isReauthorizing() const
     {
         return reauthorizing;
@@ -270,16 +306,34 @@ private:
     mutable Lock syncLock;
     Datacratic::Date lastSync;
     Datacratic::Date lastReauthorize;
+    double syncRate;
 
     
     /** Periodically we report spend to the banker.*/
     void reportSpend(uint64_t numTimeoutsExpired);
     Date reportSpendSent;
+    bool batchedSync;
+
+    /** Shadow accounts as of their last successful batched sync, so that
+        only the ones that changed are sent.  Protected by syncLock.
+    */
+    std::unordered_map<AccountKey, std::string> syncedShadows;
+
+    /** Puts the stalled accounts back in the initialization queue and
+        returns the keys of the initialized ones.
+    */
+    std::vector<AccountKey> getSyncableAccounts();
 
     /** Periodically we ask the banker to re-authorize our budget. */
     void reauthorizeBudget(uint64_t numTimeoutsExpired);
     CurrencyPool spendRate;
 
+    /** Balance to request for the account on the next reauthorize. */
+    CurrencyPool getReauthorizeAmount(const AccountKey & key,
+                                      const ShadowAccount & account);
+    bool adaptivePacing;
+    BudgetPacer pacer;
+
 
     /// Called when we get an account status back from the master banker
     /// after a synchrnonization
@@ -336,11 +390,13 @@ public:
         static const std::string SpendRate;
         static constexpr double SyncRate = 1.0;
         static constexpr bool Batched = false;
+        static constexpr bool AdaptivePacing = false;
 
         static constexpr bool UseHttp = false;
         static constexpr int HttpConnections = 128;
         static constexpr double HttpTimeout = 3.0;
         static constexpr bool TcpNoDelay = false;
+        static constexpr int Shards = 1;
     };
 
     SlaveBankerArguments();
@@ -361,6 +417,12 @@ public:
     std::shared_ptr<ApplicationLayer> makeApplicationLayer(
             std::shared_ptr<ServiceProxies> proxies) const;
 
+    /** Layer used to talk to a single MasterBanker, or to one shard. */
+    std::shared_ptr<ApplicationLayer> makeShardLayer(
+            std::shared_ptr<ServiceProxies> proxies,
+            const std::string & bankerUri,
+            const std::string & serviceClass) const;
+
     Amount spendRate() const;
 
     static Logging::Category print;
@@ -371,11 +433,13 @@ private:
     std::string spendRateStr;
     double syncRate;
     bool batched;
+    bool adaptivePacing;
 
     bool useHttp;
     double httpTimeout;
     int httpConnections;
     bool tcpNoDelay;
+    int shards;
 };
 
 } // namespace RTBKIT
@@ -19,6 +19,7 @@
 #include "jml/arch/atomic_ops.h"
 #include "jml/arch/timers.h"
 #include "jml/utils/ring_buffer.h"
+#include <algorithm>
 
 
 using namespace std;
@@ -473,6 +474,53 @@ BOOST_AUTO_TEST_CASE( test_accounts )
     cerr << accounts.getAccountSummary(budget) << endl;
 }
 
+BOOST_AUTO_TEST_CASE( test_authorize_bids )
+{
+    Accounts accounts;
+
+    AccountKey budget("budget");
+    AccountKey spend1("budget:spend1");
+    AccountKey spend2("budget:spend2");
+
+    accounts.createBudgetAccount(budget);
+    accounts.createSpendAccount(spend1);
+    accounts.createSpendAccount(spend2);
+
+    accounts.setBudget(budget, USD(10));
+    accounts.setBalance(spend1, USD(2), AT_SPEND);
+    accounts.setBalance(spend2, USD(1), AT_SPEND);
+
+    ShadowAccounts shadow;
+    shadow.activateAccount(spend1);
+    shadow.activateAccount(spend2);
+    shadow.syncFrom(accounts);
+
+    // Interleaved accounts, each running out of budget on its last bid
+    std::vector<BidAuthorization> bids;
+    bids.emplace_back(spend1, "ad1", USD(1));
+    bids.emplace_back(spend2, "ad2", USD(1));
+    bids.emplace_back(spend1, "ad3", USD(1));
+    bids.emplace_back(spend2, "ad4", USD(1));
+    bids.emplace_back(spend1, "ad5", USD(1));
+
+    shadow.authorizeBids(bids);
+
+    BOOST_CHECK_EQUAL(bids[0].authorized, true);
+    BOOST_CHECK_EQUAL(bids[1].authorized, true);
+    BOOST_CHECK_EQUAL(bids[2].authorized, true);
+    BOOST_CHECK_EQUAL(bids[3].authorized, false);
+    BOOST_CHECK_EQUAL(bids[4].authorized, false);
+
+    shadow.checkInvariants();
+
+    // The authorized bids are tracked as with authorizeBid()
+    shadow.cancelBid(spend1, "ad1");
+    shadow.cancelBid(spend2, "ad2");
+    BOOST_CHECK_EQUAL(shadow.authorizeBid(spend2, "ad6", USD(1)), true);
+
+    shadow.checkInvariants();
+}
+
 BOOST_AUTO_TEST_CASE( test_multiple_bidder_threads )
 {
     Accounts master;
@@ -933,3 +981,162 @@ BOOST_AUTO_TEST_CASE( test_account_summary_values )
     BOOST_CHECK_EQUAL(simpleValue, expected);
 }
 
+
+/* the summary totals are maintained as the accounts change; ensure that
+   they match the ones added up from the sub-accounts */
+BOOST_AUTO_TEST_CASE( test_account_summary_totals )
+{
+    Accounts accounts;
+
+    AccountKey top({"top"});
+    vector<AccountKey> spendKeys = {
+        {"top", "a", "x"}, {"top", "a", "y"}, {"top", "b", "z"}
+    };
+
+    accounts.setBudget(top, USD(1000));
+    accounts.setBalance({"top", "a"}, USD(300), AT_BUDGET);
+    accounts.setBalance({"top", "b"}, USD(200), AT_BUDGET);
+    for (auto & key: spendKeys)
+        accounts.setBalance(key, USD(10), AT_SPEND);
+
+    std::function<AccountSummary (const AccountKey &)> addUp
+        = [&] (const AccountKey & key)
+        {
+            Account a = accounts.getAccount(key);
+            AccountSummary result;
+            result.effectiveBudget = a.budgetIncreases - a.budgetDecreases
+                + a.recycledIn - a.recycledOut
+                + a.allocatedIn - a.allocatedOut;
+            result.inFlight = a.commitmentsMade - a.commitmentsRetired;
+            result.spent = a.spent;
+            result.adjustments = a.adjustmentsIn - a.adjustmentsOut;
+
+            for (auto & k: accounts.getAccountKeys(key, key.size() + 1))
+                if (k.size() == key.size() + 1)
+                    result.addChild(k.back(), addUp(k), false);
+            return result;
+        };
+
+    auto checkTotals = [&] (const AccountKey & key)
+        {
+            AccountSummary summary = accounts.getAccountSummary(key, 0);
+            AccountSummary expected = addUp(key);
+            BOOST_CHECK_EQUAL(summary.effectiveBudget,
+                              expected.effectiveBudget);
+            BOOST_CHECK_EQUAL(summary.inFlight, expected.inFlight);
+            BOOST_CHECK_EQUAL(summary.spent, expected.spent);
+            BOOST_CHECK_EQUAL(summary.adjustments, expected.adjustments);
+            BOOST_CHECK(summary.subAccounts.empty());
+        };
+
+    for (unsigned i = 0;  i < 100;  ++i) {
+        const AccountKey & key = spendKeys[i % spendKeys.size()];
+
+        switch (i % 4) {
+        case 0:
+            accounts.setBalance(key, USD(10 + i % 7), AT_SPEND);
+            break;
+        case 1:
+            accounts.importSpend(key, USD(1));
+            break;
+        case 2:
+            accounts.addAdjustment(key, USD(1));
+            break;
+        case 3:
+            accounts.recuperate(key);
+            break;
+        }
+
+        checkTotals(top);
+        checkTotals(key.parent());
+        checkTotals(key);
+    }
+
+    BOOST_CHECK(accounts.checkBudgetConsistency(top));
+
+    /* the totals are those of the part of the tree that was copied */
+    Accounts sub = accounts.getAccounts({"top", "a"}, 1);
+    AccountSummary summary = sub.getAccountSummary({"top", "a"});
+    BOOST_CHECK_EQUAL(summary.effectiveBudget,
+                      accounts.getAccountSummary({"top", "a"}).effectiveBudget);
+    BOOST_CHECK_EQUAL(summary.subAccounts.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE( test_dirty_accounts )
+{
+    Accounts accounts;
+
+    auto takeDirty = [&] () {
+        auto keys = accounts.takeDirtyAccounts();
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    };
+
+    accounts.createAccount({"t"}, AT_BUDGET);
+    accounts.setBudget({"t"}, USD(100));
+    accounts.setBalance({"t", "s"}, USD(10), AT_SPEND);
+
+    vector<AccountKey> expected = { {"t"}, {"t", "s"} };
+    BOOST_CHECK(takeDirty() == expected);
+    BOOST_CHECK(takeDirty().empty());
+
+    /* reads don't make an account dirty */
+    accounts.getAccount({"t", "s"});
+    accounts.getAccountSummary({"t"});
+    BOOST_CHECK(takeDirty().empty());
+
+    /* a transfer modifies both sides */
+    accounts.setBalance({"t", "s"}, USD(5), AT_NONE);
+    BOOST_CHECK(takeDirty() == expected);
+
+    accounts.importSpend({"t", "s"}, USD(1));
+    expected = { {"t", "s"} };
+    BOOST_CHECK(takeDirty() == expected);
+
+    /* accounts that failed to be saved can be put back */
+    accounts.markAccountsDirty(expected);
+    BOOST_CHECK(takeDirty() == expected);
+}
+
+BOOST_AUTO_TEST_CASE( test_account_handles )
+{
+    Accounts accounts;
+
+    AccountKey budget("handles");
+    AccountKey spend("handles:spend");
+
+    accounts.createBudgetAccount(budget);
+    accounts.createSpendAccount(spend);
+    accounts.setBudget(budget, USD(10));
+    accounts.setBalance(spend, USD(2), AT_SPEND);
+
+    AccountHandle handle = accountHandles().intern(spend);
+    BOOST_CHECK_EQUAL(accountHandles().intern(AccountKey("handles:spend")),
+                      handle);
+    BOOST_CHECK_NE(accountHandles().intern(budget), handle);
+    BOOST_CHECK_EQUAL(accountHandles().key(handle), spend);
+    BOOST_CHECK_EQUAL(accountHandles().metricName(handle), "handles.spend");
+    BOOST_CHECK_THROW(accountHandles().key(accountHandles().size()),
+                      ML::Exception);
+
+    ShadowAccounts shadow;
+    shadow.activateAccount(spend);
+    shadow.syncFrom(accounts);
+
+    // Bids by handle and by key end up on the same account
+    std::vector<BidAuthorization> bids;
+    bids.emplace_back(spend, handle, "ad1", USD(1));
+    bids.emplace_back(spend, "ad2", USD(1));
+    bids.emplace_back(spend, handle, "ad3", USD(1));
+    shadow.authorizeBids(bids);
+
+    BOOST_CHECK_EQUAL(bids[0].authorized, true);
+    BOOST_CHECK_EQUAL(bids[1].authorized, true);
+    BOOST_CHECK_EQUAL(bids[2].authorized, false);
+
+    shadow.cancelBid(handle, "ad1");
+    BOOST_CHECK_EQUAL(shadow.detachBid(handle, "ad2"), USD(1));
+    BOOST_CHECK_EQUAL(shadow.getAccount(spend).balance, USD(1));
+
+    shadow.checkInvariants();
+}
@@ -0,0 +1,66 @@
+/* budget_pacer_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the budget forecast of the slave banker.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/banker/budget_pacer.h"
+
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( test_steady_spend )
+{
+    BudgetPacer pacer(0.5 /* smoothing */, 1.5 /* headroom */);
+    AccountKey account("campaign:strategy");
+    CurrencyPool maxRate = USD(100);
+
+    // New accounts get the full spend rate.
+    CurrencyPool committed;
+    BOOST_CHECK_EQUAL(pacer.next(account, committed, maxRate), maxRate);
+
+    // Spending 10 per window converges on 15 with the headroom.
+    CurrencyPool request;
+    for (unsigned i = 0; i < 20; ++i) {
+        committed += USD(10);
+        request = pacer.next(account, committed, maxRate);
+    }
+
+    Amount amount = request.getAvailable(CurrencyCode::CC_USD);
+    BOOST_CHECK_GT(amount, USD(14));
+    BOOST_CHECK_LT(amount, USD(16));
+}
+
+BOOST_AUTO_TEST_CASE( test_starved_account )
+{
+    BudgetPacer pacer(0.5, 1.5, 0.01);
+    AccountKey account("campaign:strategy");
+    CurrencyPool maxRate = USD(100);
+
+    CurrencyPool committed;
+    pacer.next(account, committed, maxRate);
+
+    // Nothing spent for a while brings the request down to the floor.
+    CurrencyPool request;
+    for (unsigned i = 0; i < 50; ++i)
+        request = pacer.next(account, committed, maxRate);
+    BOOST_CHECK_EQUAL(request, USD(1));
+
+    // Using up everything doubles the request until it hits the cap.
+    Amount previous = USD(1);
+    for (unsigned i = 0; i < 10; ++i) {
+        committed += request;
+        request = pacer.next(account, committed, maxRate);
+
+        Amount amount = request.getAvailable(CurrencyCode::CC_USD);
+        BOOST_CHECK_GE(amount, previous);
+        previous = amount;
+    }
+    BOOST_CHECK_EQUAL(request, maxRate);
+}
@@ -18,6 +18,9 @@
 #include "rtbkit/common/currency.h"
 
 #include "rtbkit/core/banker/local_banker.h"
+#include "jml/arch/format.h"
+#include <thread>
+#include <atomic>
 
 using namespace std;
 using namespace ML;
@@ -120,3 +123,66 @@ BOOST_AUTO_TEST_CASE( test_router_accumulate )
     ExcAssertEqual(rBanker.accounts.getBalance(key).value, 10000);
 
 }
+
+/* Bids from several threads on the same accounts while the balance is
+   being topped up must never spend more than what was given. */
+BOOST_AUTO_TEST_CASE( test_router_concurrent_bids )
+{
+    GoAccounts accounts;
+
+    const int numAccounts = 10;
+    const int numThreads = 8;
+    const int bidsPerThread = 200000;
+    const int64_t topup = 100000;
+    const int numTopups = 10;
+
+    vector<AccountKey> keys;
+    for (int i = 0; i < numAccounts; ++i) {
+        AccountKey key(ML::format("parent:child%d:router", i));
+        accounts.add(key, ROUTER);
+        accounts.setMaxBalance(key, MicroUSD(topup * numTopups));
+        keys.push_back(key);
+    }
+
+    std::atomic<int64_t> numBids(0);
+    std::atomic<bool> done(false);
+
+    auto doBids = [&] (int thread) {
+        int64_t bids = 0;
+        for (int i = 0; i < bidsPerThread; ++i) {
+            if (accounts.bid(keys[(i + thread) % numAccounts], MicroUSD(1)))
+                ++bids;
+        }
+        numBids += bids;
+    };
+
+    auto doTopups = [&] () {
+        for (int i = 0; i < numTopups; ++i) {
+            for (auto & key: keys)
+                accounts.accumulateBalance(key, MicroUSD(topup));
+            ML::sleep(0.001);
+        }
+        done = true;
+    };
+
+    Date start = Date::now();
+
+    vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i)
+        threads.emplace_back(doBids, i);
+    threads.emplace_back(doTopups);
+    for (auto & thread: threads)
+        thread.join();
+
+    double elapsed = Date::now().secondsSince(start);
+    cout << numThreads * bidsPerThread << " bids from " << numThreads
+         << " threads in " << elapsed << "s: "
+         << numThreads * bidsPerThread / elapsed << " bids/s" << endl;
+
+    int64_t remaining = 0;
+    for (auto & key: keys)
+        remaining += accounts.getBalance(key).value;
+
+    BOOST_CHECK(done);
+    BOOST_CHECK_EQUAL(numBids + remaining, numAccounts * topup * numTopups);
+}
@@ -0,0 +1,226 @@
+/* sharded_layer_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the routing of the sharded banker application layer.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/banker/application_layer.h"
+#include "jml/arch/format.h"
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+/** Answers the custom requests right away with a canned payload and
+    records the accounts it was asked about.
+*/
+struct MockLayer : public ApplicationLayer {
+
+    MockLayer(const std::string & reply = "{}")
+        : reply(reply)
+    {
+    }
+
+    void addAccount(const AccountKey &account,
+                    const BudgetController::OnBudgetResult &onResult)
+    {
+        accounts.push_back(account.toString());
+        onResult(nullptr);
+    }
+
+    using ApplicationLayer::topupTransfer;
+    void topupTransfer(const std::string &accountStr,
+                       AccountType accountType,
+                       CurrencyPool amount,
+                       const BudgetController::OnBudgetResult &onResult)
+    {
+        accounts.push_back(accountStr);
+        onResult(nullptr);
+    }
+
+    void setBudget(const std::string &topLevelAccount,
+                   CurrencyPool amount,
+                   const BudgetController::OnBudgetResult &onResult)
+    {
+        accounts.push_back(topLevelAccount);
+        onResult(nullptr);
+    }
+
+    void getAccountSummary(const AccountKey &account, int depth,
+                           std::function<void (std::exception_ptr,
+                                               AccountSummary &&)> onResult)
+    {
+        accounts.push_back(account.toString());
+        onResult(nullptr, AccountSummary());
+    }
+
+    void getAccount(const AccountKey &account,
+                    std::function<void (std::exception_ptr, Account &&)> onResult)
+    {
+        accounts.push_back(account.toString());
+        onResult(nullptr, Account());
+    }
+
+    void addSpendAccount(const std::string &shadowStr,
+                         std::function<void (std::exception_ptr, Account&&)> onDone)
+    {
+        accounts.push_back(shadowStr);
+        onDone(nullptr, Account());
+    }
+
+    void syncAccount(const ShadowAccount & account, const std::string &shadowStr,
+                     std::function<void (std::exception_ptr, Account &&)> onDone)
+    {
+        accounts.push_back(shadowStr);
+        onDone(nullptr, Account());
+    }
+
+    void request(std::string method, const std::string &resource,
+                 const RestParams &params, const std::string &content,
+                 OnRequestResult onResult)
+    {
+        resources.push_back(resource);
+        contents.push_back(content);
+        onResult(nullptr, 200, reply);
+    }
+
+    std::string reply;
+    std::vector<std::string> accounts;
+    std::vector<std::string> resources;
+    std::vector<std::string> contents;
+};
+
+struct ShardedFixture {
+    ShardedFixture(int numShards = 4)
+    {
+        std::vector<std::shared_ptr<ApplicationLayer> > layers;
+        for (int i = 0; i < numShards; ++i) {
+            auto mock = std::make_shared<MockLayer>(
+                    ML::format("{\"shard%d\":%d}", i, i));
+            mocks.push_back(mock);
+            layers.push_back(mock);
+        }
+        layer.init(layers);
+    }
+
+    ShardedLayer layer;
+    std::vector<std::shared_ptr<MockLayer> > mocks;
+};
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_account_routing )
+{
+    ShardedFixture fixture;
+    auto & layer = fixture.layer;
+
+    std::vector<int> perShard(layer.numShards());
+
+    for (int i = 0; i < 1000; ++i) {
+        string campaign = ML::format("campaign%d", i);
+        size_t shard = layer.shardOf(campaign);
+        BOOST_REQUIRE_LT(shard, layer.numShards());
+        ++perShard[shard];
+
+        /* every request about a campaign and its sub-accounts goes to the
+           same shard */
+        layer.setBudget(campaign, USD(1), [] (std::exception_ptr) {});
+        layer.addSpendAccount(campaign + ":strategy:slave",
+                              [] (std::exception_ptr, Account &&) {});
+        layer.request("POST", "/v1/accounts/" + campaign + ":strategy/balance",
+                      {}, "{}", [] (std::exception_ptr, int, const string &) {});
+
+        auto & mock = *fixture.mocks[shard];
+        BOOST_CHECK_EQUAL(mock.accounts.back(), campaign + ":strategy:slave");
+        BOOST_CHECK_EQUAL(mock.resources.back(),
+                          "/v1/accounts/" + campaign + ":strategy/balance");
+    }
+
+    /* the points on the ring spread the accounts reasonably evenly */
+    for (int count: perShard) {
+        BOOST_CHECK_GT(count, 100);
+        BOOST_CHECK_LT(count, 450);
+    }
+
+    for (auto & mock: fixture.mocks)
+        BOOST_CHECK_EQUAL(mock->accounts.size(), mock->resources.size() * 2);
+}
+
+BOOST_AUTO_TEST_CASE( test_consistent_hashing )
+{
+    ShardedFixture fourShards(4), fiveShards(5);
+
+    int moved = 0;
+    for (int i = 0; i < 1000; ++i) {
+        string campaign = ML::format("campaign%d", i);
+        size_t before = fourShards.layer.shardOf(campaign);
+        size_t after = fiveShards.layer.shardOf(campaign);
+
+        /* accounts only ever move to the new shard */
+        if (before != after) {
+            BOOST_CHECK_EQUAL(after, 4);
+            ++moved;
+        }
+    }
+
+    BOOST_CHECK_GT(moved, 100);
+    BOOST_CHECK_LT(moved, 350);
+}
+
+BOOST_AUTO_TEST_CASE( test_batched_requests )
+{
+    ShardedFixture fixture;
+    auto & layer = fixture.layer;
+
+    Json::Value request;
+    for (int i = 0; i < 100; ++i)
+        request[ML::format("campaign%d:strategy:slave", i)]["amount"] = i;
+
+    string payload;
+    int code = 0;
+    layer.request("POST", "/v1/accounts/balance", {},
+                  request.toStringNoNewLine(),
+                  [&] (std::exception_ptr exc, int statusCode, const string & body)
+                  {
+                      BOOST_CHECK(!exc);
+                      code = statusCode;
+                      payload = body;
+                  });
+
+    BOOST_CHECK_EQUAL(code, 200);
+
+    /* each shard only got its own accounts and the responses are merged */
+    Json::Value response = Json::parse(payload);
+    size_t numAccounts = 0;
+    for (size_t i = 0; i < fixture.mocks.size(); ++i) {
+        auto & mock = *fixture.mocks[i];
+        if (mock.contents.empty())
+            continue;
+
+        BOOST_CHECK_EQUAL(mock.contents.size(), 1);
+        BOOST_CHECK_EQUAL(response[ML::format("shard%d", i)].asInt(), i);
+
+        Json::Value sent = Json::parse(mock.contents.back());
+        for (const auto & key: sent.getMemberNames())
+            BOOST_CHECK_EQUAL(layer.shardOf(AccountKey(key).at(0)), i);
+        numAccounts += sent.size();
+    }
+    BOOST_CHECK_EQUAL(numAccounts, 100);
+
+    /* requests that aren't about an account go to every shard */
+    layer.request("GET", "/v1/summary", {}, "",
+                  [&] (std::exception_ptr exc, int statusCode, const string & body)
+                  {
+                      payload = body;
+                  });
+    response = Json::parse(payload);
+    BOOST_CHECK_EQUAL(response.size(), fixture.mocks.size());
+}
@@ -15,6 +15,9 @@ Logging::Category MonitorClient::print("[LOG] MonitorClient");
 Logging::Category MonitorClient::error("[ERROR] MonitorClient", MonitorClient::print);
 Logging::Category MonitorClient::trace("[TRACE] MonitorClient", MonitorClient::print);
 
+constexpr double MonitorClient::RampDown;
+constexpr double MonitorClient::RampUp;
+
 MonitorClient::
 ~MonitorClient()
 {
@@ -62,9 +65,17 @@ onResponseReceived(exception_ptr ext, int responseCode, const string & body)
         ML::Set_Trace_Exceptions notrace(false);
         try {
             Json::Value parsedBody = Json::parse(body);
-            if (parsedBody.isMember("status") && parsedBody["status"] == "ok") {
+            bool ok = parsedBody.isMember("status")
+                && parsedBody["status"] == "ok";
+            if (ok) {
                 lastSuccess = lastCheck;
             }
+
+            // Monitors that predate health scores only report the status.
+            if (parsedBody.isMember("health"))
+                lastHealth = max(0.0, min(parsedBody["health"].asDouble(), 1.0));
+            else lastHealth = ok ? 1.0 : 0.0;
+            lastHealthCheck = Date::now();
         }
         catch (const Json::Exception & exc) {
         }
@@ -83,4 +94,38 @@ getStatus(double tolerance)
     return Date::now().secondsSince(lastSuccess) < tolerance;
 }
 
+double
+MonitorClient::
+getHealth(double tolerance)
+    const
+{
+    if (testMode) return testResponse ? 1.0 : 0.0;
+    if (Date::now().secondsSince(lastHealthCheck) >= tolerance) return 0.0;
+    return lastHealth;
+}
+
+double
+MonitorClient::
+updateAcceptRatio(double elapsed, double tolerance)
+{
+    double health = getHealth(tolerance);
+    double ratio = acceptRatio;
+
+    if (health < ratio)
+        ratio = max(health, ratio - RampDown * elapsed);
+    else ratio = min(health, ratio + RampUp * elapsed);
+
+    acceptRatio = ratio;
+    return getAcceptRatio();
+}
+
+double
+MonitorClient::
+getAcceptRatio()
+    const
+{
+    if (testMode) return testResponse ? 1.0 : 0.0;
+    return acceptRatio;
+}
+
 } // RTB
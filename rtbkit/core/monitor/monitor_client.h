@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <vector>
 #include "soa/types/date.h"
@@ -29,6 +30,8 @@ struct MonitorClient : public RestProxy
                   int checkTimeout = DefaultCheckTimeout)
         : RestProxy(context),
           checkTimeout_(checkTimeout),
+          lastHealth(0.0),
+          acceptRatio(0.0),
           testMode(false), testResponse(false)
     {
         onDone = std::bind(&MonitorClient::onResponseReceived, this,
@@ -49,6 +52,24 @@ struct MonitorClient : public RestProxy
         positive and fresh enough to continue operations */
     bool getStatus(double toleranceSec = DefaultTolerance) const;
 
+    /** health score of the system between 0 and 1 as last reported by the
+        Monitor, or 0 if the Monitor hasn't answered within the tolerance */
+    double getHealth(double toleranceSec = DefaultTolerance) const;
+
+    /** moves the accept ratio towards the current health, by at most
+        RampDown per second when going down and RampUp per second when going
+        back up, and returns it. Meant to be called periodically with the
+        time elapsed since the previous call. */
+    double updateAcceptRatio(double elapsed,
+                             double toleranceSec = DefaultTolerance);
+
+    /** proportion of the work that the service should accept, as of the
+        last call to updateAcceptRatio */
+    double getAcceptRatio() const;
+
+    static constexpr double RampDown = 0.25;
+    static constexpr double RampUp = 0.1;
+
     /* private members */
 
     /** method invoked periodically to trigger a request to the Monitor */
@@ -74,6 +95,12 @@ struct MonitorClient : public RestProxy
     /** the timestamp of the last successful check */
     Date lastSuccess;
 
+    /** the last health reported by the Monitor and when it was received */
+    double lastHealth;
+    Date lastHealthCheck;
+
+    std::atomic<double> acceptRatio;
+
     /** helper members to make testing of dependent services easier */
     bool testMode;
     bool testResponse;
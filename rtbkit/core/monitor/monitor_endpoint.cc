@@ -74,13 +74,10 @@ init(const vector<string> & providerClasses)
                        {"GET"},
                        "Return the health status of the system",
                        "",
-                       [] (bool status) {
-                           Json::Value jsonResponse;
-                           jsonResponse["status"] = status ? "ok" : "failure";
-
-                           return jsonResponse;
+                       [] (Json::Value jsonResponse) {
+                           return move(jsonResponse);
                        },
-                       &MonitorEndpoint::getMonitorStatus,
+                       &MonitorEndpoint::getStatusResponse,
                        this);
 
     addRouteSyncReturn(versionNode,
@@ -147,6 +144,31 @@ getMonitorStatus()
     return !disabled;
 }
 
+double
+MonitorEndpoint::
+getMonitorHealth()
+    const
+{
+    if (disabled) return 1.0;
+
+    double health = 1.0;
+    for (const auto & it : providersStatus_)
+        health = std::min(health, it.second.getClassHealth(checkTimeout_));
+
+    return health;
+}
+
+Json::Value
+MonitorEndpoint::
+getStatusResponse()
+    const
+{
+    Json::Value jsonResponse;
+    jsonResponse["status"] = getMonitorStatus() ? "ok" : "failure";
+    jsonResponse["health"] = getMonitorHealth();
+    return jsonResponse;
+}
+
 bool
 MonitorEndpoint::ClassStatus::
 getClassStatus(double checkTimeout) const
@@ -166,6 +188,22 @@ getClassStatus(double checkTimeout) const
     return false;
 }
 
+double
+MonitorEndpoint::ClassStatus::
+getClassHealth(double checkTimeout) const
+{
+    Date now = Date::now();
+
+    double health = 0.0;
+    for (const auto& it: *this) {
+        const MonitorProviderStatus& status = it.second;
+        if (status.lastCheck.plusSeconds(checkTimeout) <= now) continue;
+        health = std::max(health, status.getHealth());
+    }
+
+    return health;
+}
+
 bool
 MonitorEndpoint::
 postServiceIndicators(const string & providerClass,
@@ -189,6 +227,7 @@ postServiceIndicators(const string & providerClass,
     status.lastCheck = Date::now();
     status.lastStatus = ind.status;
     status.lastMessage = ind.message;
+    status.lastHealth = ind.getHealth();
 
     providersStatus_[providerClass][ind.serviceName] = status;
     return true;
@@ -215,9 +254,10 @@ dump(double timeout, ostream& stream) const
         bool isTimeout = status.lastCheck.plusSeconds(timeout) <= now;
 
         stream <<
-            ML::format("    %-20s %-3s %-20s %s\n",
+            ML::format("    %-20s %-3s %4.2f %-20s %s\n",
                     it.first,
                     (status.lastStatus && !isTimeout ? "OK" : "ERR"),
+                    (isTimeout ? 0.0 : status.getHealth()),
                     status.lastCheck.printClassic(),
                     (isTimeout ? "Timeout" : status.lastMessage));
     }
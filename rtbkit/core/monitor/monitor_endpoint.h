@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,13 @@ struct MonitorEndpoint : public Datacratic::ServiceBase,
     /** determines whether the system is working properly or not */
     bool getMonitorStatus() const;
 
+    /** health of the system between 0 and 1: the health of its sickest
+        class, where a class is as healthy as its healthiest service. */
+    double getMonitorHealth() const;
+
+    /** body of the response to GET /v1/status */
+    Json::Value getStatusResponse() const;
+
 
     /** Human readable dump of the state of the various components */
     void dump(std::ostream& stream = std::cerr) const;
@@ -52,6 +60,15 @@ struct MonitorEndpoint : public Datacratic::ServiceBase,
         Datacratic::Date lastCheck;
         bool lastStatus;
         std::string lastMessage;
+
+        /** reported health score; derived from lastStatus when negative */
+        double lastHealth = -1.0;
+
+        double getHealth() const
+        {
+            if (lastHealth >= 0.0) return std::min(lastHealth, 1.0);
+            return lastStatus ? 1.0 : 0.0;
+        }
     };
 
     std::vector<std::string> providerClasses_;
@@ -59,6 +76,7 @@ struct MonitorEndpoint : public Datacratic::ServiceBase,
     struct ClassStatus : public std::map<std::string, MonitorProviderStatus>
     {
         bool getClassStatus(double checkTimeout) const;
+        double getClassHealth(double checkTimeout) const;
         void dump(double checkTimeout, std::ostream& stream = std::cerr) const;
     };
 
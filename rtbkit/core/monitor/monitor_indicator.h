@@ -10,6 +10,7 @@
 
 #include "soa/jsoncpp/value.h"
 
+#include <algorithm>
 #include <string>
 
 namespace RTBKIT {
@@ -19,11 +20,25 @@ namespace RTBKIT {
 /* MONITOR INDICATOR                                                          */
 /******************************************************************************/
 
+/** Status reported by a provider. On top of the binary status, a provider
+    can report a health score between 0 (down) and 1 (fully operational) to
+    let the services that depend on it slow down gradually instead of all at
+    once. Providers that don't set it are scored from their status.
+ */
 struct MonitorIndicator
 {
+    MonitorIndicator() : status(false), health(-1.0) {}
+
     std::string serviceName;
     bool status;
     std::string message;
+    double health;
+
+    double getHealth() const
+    {
+        if (health >= 0.0) return std::min(health, 1.0);
+        return status ? 1.0 : 0.0;
+    }
 
     Json::Value toJson() const
     {
@@ -32,6 +47,7 @@ struct MonitorIndicator
         value["serviceName"] = serviceName;
         value["status"] = status;
         value["message"] = message;
+        value["health"] = getHealth();
 
         return value;
     }
@@ -43,6 +59,8 @@ struct MonitorIndicator
         ind.serviceName = json["serviceName"].asString();
         ind.status = json["status"].asBool();
         ind.message = json["message"].asString();
+        if (json.isMember("health"))
+            ind.health = json["health"].asDouble();
 
         return ind;
     }
@@ -69,3 +69,56 @@ BOOST_AUTO_TEST_CASE( test_monitor_client_onResponseReceived )
     BOOST_CHECK_EQUAL(client.getStatus(), true);
 }
 
+
+BOOST_AUTO_TEST_CASE( test_monitor_client_health )
+{
+    std::shared_ptr<zmq::context_t> zero_context;
+    MonitorClient client(zero_context);
+
+    /* no response yet */
+    BOOST_CHECK_EQUAL(client.getHealth(), 0.0);
+
+    /* monitors without a health score */
+    client.onResponseReceived(nullptr, 200, "{ 'status': 'ok' }");
+    BOOST_CHECK_EQUAL(client.getHealth(), 1.0);
+    client.onResponseReceived(nullptr, 200, "{ 'status': 'failure' }");
+    BOOST_CHECK_EQUAL(client.getHealth(), 0.0);
+
+    client.onResponseReceived(nullptr, 200,
+                              "{ 'status': 'failure', 'health': 0.5 }");
+    BOOST_CHECK_EQUAL(client.getHealth(), 0.5);
+
+    /* too old */
+    client.lastHealthCheck = Date::now().plusSeconds(-20.0);
+    BOOST_CHECK_EQUAL(client.getHealth(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( test_monitor_client_updateAcceptRatio )
+{
+    std::shared_ptr<zmq::context_t> zero_context;
+    MonitorClient client(zero_context);
+
+    BOOST_CHECK_EQUAL(client.getAcceptRatio(), 0.0);
+
+    /* ramps up slowly... */
+    client.onResponseReceived(nullptr, 200, "{ 'status': 'ok' }");
+    BOOST_CHECK_CLOSE(client.updateAcceptRatio(1.0), MonitorClient::RampUp, 1e-6);
+    BOOST_CHECK_CLOSE(client.updateAcceptRatio(2.0), 3 * MonitorClient::RampUp, 1e-6);
+    BOOST_CHECK_EQUAL(client.updateAcceptRatio(100.0), 1.0);
+
+    /* ... down faster, but not past the health... */
+    client.onResponseReceived(nullptr, 200,
+                              "{ 'status': 'failure', 'health': 0.6 }");
+    BOOST_CHECK_CLOSE(client.updateAcceptRatio(1.0), 1.0 - MonitorClient::RampDown, 1e-6);
+    BOOST_CHECK_CLOSE(client.updateAcceptRatio(1.0), 0.6, 1e-6);
+    BOOST_CHECK_CLOSE(client.updateAcceptRatio(1.0), 0.6, 1e-6);
+
+    /* ... and all the way down */
+    client.onResponseReceived(nullptr, 200, "{ 'status': 'failure' }");
+    BOOST_CHECK_EQUAL(client.updateAcceptRatio(100.0), 0.0);
+    BOOST_CHECK_EQUAL(client.getAcceptRatio(), 0.0);
+
+    client.testMode = true;
+    client.testResponse = true;
+    BOOST_CHECK_EQUAL(client.getAcceptRatio(), 1.0);
+}
@@ -81,6 +81,47 @@ BOOST_AUTO_TEST_CASE( test_monitor_getMonitorStatus )
     BOOST_CHECK_EQUAL(endpoint.getMonitorStatus(), false);
 }
 
+BOOST_AUTO_TEST_CASE( test_monitor_getMonitorHealth )
+{
+    auto proxies = std::make_shared<ServiceProxies>();
+    MonitorEndpoint endpoint(proxies);
+    endpoint.init({"c1", "c2"});
+
+    Date now = Date::now();
+    Date oldLastCheck = now.plusSeconds(-10);
+
+    BOOST_CHECK_EQUAL(endpoint.getMonitorHealth(), 0.0);
+
+    endpoint.providersStatus_["c1"]["s1"] = makeStatus(true, now);
+    endpoint.providersStatus_["c2"]["s1"] = makeStatus(true, now);
+    BOOST_CHECK_EQUAL(endpoint.getMonitorHealth(), 1.0);
+
+    /* the healthiest service of a class counts */
+    endpoint.providersStatus_["c1"]["s1"].lastHealth = 0.4;
+    endpoint.providersStatus_["c1"]["s2"] = makeStatus(true, now);
+    endpoint.providersStatus_["c1"]["s2"].lastHealth = 0.7;
+    BOOST_CHECK_EQUAL(endpoint.getMonitorHealth(), 0.7);
+
+    /* the sickest class counts */
+    endpoint.providersStatus_["c2"]["s1"].lastHealth = 0.5;
+    BOOST_CHECK_EQUAL(endpoint.getMonitorHealth(), 0.5);
+
+    endpoint.providersStatus_["c1"]["s2"].lastCheck = oldLastCheck;
+    BOOST_CHECK_EQUAL(endpoint.getMonitorHealth(), 0.4);
+
+    endpoint.providersStatus_["c2"]["s1"] = makeStatus(false, now);
+    BOOST_CHECK_EQUAL(endpoint.getMonitorHealth(), 0.0);
+
+    Json::Value response = endpoint.getStatusResponse();
+    BOOST_CHECK_EQUAL(response["status"].asString(), "failure");
+    BOOST_CHECK_EQUAL(response["health"].asDouble(), 0.0);
+
+    /* reported by the providers */
+    string statusStr = "{ 'status': true, 'serviceName': 's1', 'health': 0.3 }";
+    BOOST_CHECK(endpoint.postServiceIndicators("c2", statusStr));
+    BOOST_CHECK_EQUAL(endpoint.getMonitorHealth(), 0.3);
+}
+
 BOOST_AUTO_TEST_CASE( test_monitor_postServiceIndicators )
 {
     auto proxies = std::make_shared<ServiceProxies>();
@@ -0,0 +1,202 @@
+/* auction_id_filter.h                                 -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Rotating blocked bloom filter of the auction ids tracked by the matcher.
+*/
+
+#pragma once
+
+#include "soa/types/id.h"
+#include "soa/types/date.h"
+#include "jml/arch/exception.h"
+
+#include <deque>
+#include <vector>
+#include <cmath>
+#include <string.h>
+#include <stdint.h>
+
+namespace RTBKIT {
+
+/******************************************************************************/
+/* AUCTION ID FILTER                                                          */
+/******************************************************************************/
+
+/** Set of auction ids with false positives but no false negatives, used to
+    tell in a few nanoseconds that an event can't be for any of the auctions
+    we're tracking.
+
+    The ids go into blocked bloom filters where all of the bits of an id are
+    in the same 64 byte block, so that testing one costs a single cache miss.
+    Ids are added to the newest filter until it holds its capacity, at which
+    point an empty one is started. Each id is given the time until which it
+    must be found, and a filter is only dropped by expire() once all of its
+    ids are past that time.
+
+    The false positive rate is per filter, so capacity should be about the
+    number of ids added over the longest expiry for it to hold.
+ */
+struct AuctionIdFilter
+{
+    enum { DefaultCapacity = 1 << 22 };
+
+    AuctionIdFilter(size_t capacity = DefaultCapacity,
+                    double falsePositiveRate = 0.01) :
+        capacity(capacity)
+    {
+        if (!capacity)
+            throw ML::Exception("auction id filter needs a capacity");
+        if (falsePositiveRate <= 0.0 || falsePositiveRate >= 1.0)
+            throw ML::Exception("invalid false positive rate %f",
+                                falsePositiveRate);
+
+        // Optimal sizing for a classic bloom filter; the blocks make the
+        // actual rate a bit worse, mostly at low rates.
+        double ln2 = std::log(2.0);
+        double bitsPerId = -std::log(falsePositiveRate) / (ln2 * ln2);
+        numHashes = std::max(1, std::min(16, int(bitsPerId * ln2 + 0.5)));
+        numBlocks = std::max<size_t>(1, bitsPerId * capacity / BlockBits + 1);
+
+        filters.emplace_back(numBlocks);
+    }
+
+    /** Adds the id, which will be found until at least the given time. */
+    void add(const Datacratic::Id & id, Datacratic::Date expiry)
+    {
+        if (filters.back().count == capacity)
+            filters.emplace_back(numBlocks);
+
+        Filter & filter = filters.back();
+        uint64_t hash = mix(id.hash());
+        uint64_t * block = filter.block(blockOf(hash));
+        forEachBit(hash, [&] (unsigned bit)
+                {
+                    block[bit / 64] |= uint64_t(1) << (bit % 64);
+                    return true;
+                });
+
+        ++filter.count;
+        if (expiry > filter.expiry) filter.expiry = expiry;
+    }
+
+    /** Returns false if the id was never added or has expired, and true if
+        it was added or, with the false positive rate, if it wasn't.
+     */
+    bool mayContain(const Datacratic::Id & id) const
+    {
+        uint64_t hash = mix(id.hash());
+        size_t blockNum = blockOf(hash);
+
+        // Newest first since that's where most of the known ids are.
+        for (auto it = filters.rbegin(), end = filters.rend(); it != end; ++it) {
+            const uint64_t * block = it->block(blockNum);
+            bool found = forEachBit(hash, [&] (unsigned bit)
+                    {
+                        return (block[bit / 64] >> (bit % 64)) & 1;
+                    });
+            if (found) return true;
+        }
+
+        return false;
+    }
+
+    /** Drops the filters in which every id has expired. The newest one is
+        kept and emptied instead.
+     */
+    void expire(Datacratic::Date now)
+    {
+        while (filters.size() > 1 && filters.front().expiry < now)
+            filters.pop_front();
+
+        Filter & newest = filters.back();
+        if (filters.size() == 1 && newest.count && newest.expiry < now)
+            newest.clear();
+    }
+
+    /** Bytes held by the filters. */
+    size_t memUsage() const
+    {
+        size_t result = sizeof(*this);
+        for (auto & filter: filters)
+            result += sizeof(filter) + filter.bits.size() * sizeof(uint64_t);
+        return result;
+    }
+
+    /** Number of filters an unknown id is tested against. */
+    size_t numFilters() const
+    {
+        return filters.size();
+    }
+
+private:
+
+    enum { BlockBits = 512, BlockWords = BlockBits / 64 };
+
+    struct Filter
+    {
+        Filter(size_t numBlocks) :
+            bits(numBlocks * BlockWords, 0), count(0)
+        {}
+
+        uint64_t * block(size_t blockNum)
+        {
+            return &bits[blockNum * BlockWords];
+        }
+
+        const uint64_t * block(size_t blockNum) const
+        {
+            return &bits[blockNum * BlockWords];
+        }
+
+        void clear()
+        {
+            memset(&bits[0], 0, bits.size() * sizeof(uint64_t));
+            count = 0;
+            expiry = Datacratic::Date();
+        }
+
+        std::vector<uint64_t> bits;
+        size_t count;
+        Datacratic::Date expiry;    ///< Latest expiry of the ids added
+    };
+
+    /** Id::hash() is only good enough for hash tables, where similar ids
+        can get similar hashes; this spreads them over all of the bits.
+     */
+    static uint64_t mix(uint64_t hash)
+    {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    size_t blockOf(uint64_t hash) const
+    {
+        return ((hash >> 32) * numBlocks) >> 32;
+    }
+
+    /** Calls fn with each of the bits of the id within its block, stopping
+        as soon as it returns false, in which case so does this.
+     */
+    template<typename Fn>
+    bool forEachBit(uint64_t hash, const Fn & fn) const
+    {
+        uint32_t h1 = hash;
+        uint32_t h2 = (hash >> 32) * 0x9e3779b9U | 1;
+        for (int i = 0; i < numHashes; ++i, h1 += h2)
+            if (!fn(h1 % BlockBits)) return false;
+        return true;
+    }
+
+    size_t capacity;
+    size_t numBlocks;
+    int numHashes;
+
+    std::deque<Filter> filters;
+};
+
+} // namespace RTBKIT
@@ -14,12 +14,31 @@
 #include "soa/service/typed_message_channel.h"
 #include "rtbkit/common/auction_events.h"
 
+#include <deque>
+#include <memory>
+#include <vector>
+
 namespace RTBKIT {
 
 /******************************************************************************/
 /* EVENT FORWARDER                                                            */
 /******************************************************************************/
 
+/** Forwards auctions and events to a downstream post auction service over
+    HTTP without ever blocking the caller.
+
+    Items are queued in bounded queues, serialized on the forwarder's own
+    thread and batched per endpoint: a batch is posted as soon as it holds
+    MaxBatchSize items or, failing that, within FlushPeriod. A batch of one
+    goes to /v1/<endpoint> and larger ones to /v1/<endpoint>/batch as a JSON
+    array.
+
+    Batches that fail to be delivered (connection error or 5xx) are retried
+    with an exponential backoff up to MaxRetries times. At most
+    MaxPendingRetries batches wait for a retry at once; past that the oldest
+    ones are dropped. Every item that doesn't make it is counted in
+    <endpoint>.dropped.
+ */
 struct EventForwarder :
         public Datacratic::ServiceBase,
         public Datacratic::MessageLoop
@@ -28,15 +47,24 @@ struct EventForwarder :
         ConnectionCount = 1 << 7,
         AuctionQueueSize = 1 << 6,
         EventQueueSize = 1 << 8,
+
+        MaxBatchSize = 1 << 6,
+        MaxRetries = 5,
+        MaxPendingRetries = 1 << 8,
     };
 
+    static constexpr double FlushPeriod = 0.01;
+    static constexpr double RetryDelay = 0.01;
+
     EventForwarder(
             Datacratic::ServiceBase & parent,
             std::string uri, std::string name) :
         ServiceBase(std::move(name), parent),
         client(std::move(uri), ConnectionCount),
         auctionQueue(AuctionQueueSize),
-        eventQueue(EventQueueSize)
+        eventQueue(EventQueueSize),
+        auctions("auctions"),
+        events("events")
     {
         init();
     }
@@ -47,7 +75,9 @@ struct EventForwarder :
         ServiceBase(std::move(name), proxies),
         client(std::move(uri), ConnectionCount),
         auctionQueue(AuctionQueueSize),
-        eventQueue(EventQueueSize)
+        eventQueue(EventQueueSize),
+        auctions("auctions"),
+        events("events")
     {
         init();
     }
@@ -75,6 +105,21 @@ struct EventForwarder :
 
 private:
 
+    /** Serialized items headed for the same endpoint. */
+    struct Batch
+    {
+        Batch(std::string endpoint) :
+            endpoint(std::move(endpoint)), attempts(0)
+        {}
+
+        std::string endpoint;
+        std::vector<std::string> items;
+        Date start;
+
+        int attempts;
+        Date retryAt;
+    };
+
     void init()
     {
         MessageLoop::init();
@@ -88,52 +133,159 @@ private:
         addSource("PostAuctionService::EventForwarder::client", client);
         addSource("PostAuctionService::EventForwarder::auctionQueue", auctionQueue);
         addSource("PostAuctionService::EventForwarder::eventQueue", eventQueue);
+        addPeriodic("PostAuctionService::EventForwarder::flush", FlushPeriod,
+                std::bind(&EventForwarder::flushAll, this));
 
         MessageLoop::start();
     }
 
     template<typename T>
-    void send(const std::string& endpoint, const T& obj)
+    void queue(Batch& batch, const T& obj)
     {
-        recordHit("%s.send", endpoint);
-        Date start = Date::now();
-
         static auto desc = getDefaultDescriptionShared((T*) 0);
 
         std::stringstream stream;
         Datacratic::StreamJsonPrintingContext ctx(stream);
         desc->printJson(&obj, ctx);
 
-        HttpRequest::Content body(stream.str(), "application/json");
+        if (batch.items.empty()) batch.start = Date::now();
+        batch.items.push_back(stream.str());
+
+        if (batch.items.size() >= MaxBatchSize) flush(batch);
+    }
+
+    void flush(Batch& batch)
+    {
+        if (batch.items.empty()) return;
+
+        auto pending = std::make_shared<Batch>(batch.endpoint);
+        pending->items.swap(batch.items);
+        pending->start = batch.start;
+        send(std::move(pending));
+    }
+
+    void flushAll()
+    {
+        flush(auctions);
+        flush(events);
+
+        if (retries.empty()) return;
+
+        Date now = Date::now();
+        std::deque< std::shared_ptr<Batch> > waiting;
+        std::vector< std::shared_ptr<Batch> > due;
+
+        for (auto& batch : retries) {
+            if (batch->retryAt <= now) due.push_back(std::move(batch));
+            else waiting.push_back(std::move(batch));
+        }
+
+        retries.swap(waiting);
+        for (auto& batch : due) send(std::move(batch));
+    }
+
+    void send(std::shared_ptr<Batch> batch)
+    {
+        const std::string& endpoint = batch->endpoint;
+        recordHit("%s.send", endpoint);
+        recordOutcome(batch->items.size(), "%s.batchSize", endpoint);
+
+        std::string resource = "/v1/" + endpoint;
+        std::string payload;
+
+        if (batch->items.size() == 1)
+            payload = batch->items.front();
+        else {
+            resource += "/batch";
+
+            size_t size = 2;
+            for (const auto& item : batch->items) size += item.size() + 1;
+            payload.reserve(size);
+
+            payload += '[';
+            for (size_t i = 0; i < batch->items.size(); ++i) {
+                if (i) payload += ',';
+                payload += batch->items[i];
+            }
+            payload += ']';
+        }
+
+        HttpRequest::Content body(payload, "application/json");
+
+        auto code = std::make_shared<int>(0);
+        auto onResponseStart = [=] (const HttpRequest&, const std::string&, int status) {
+            *code = status;
+        };
 
         auto onDone = [=] (const HttpRequest&, HttpClientError err) {
-            if (err != HttpClientError::None) {
-                recordHit("%s.error", endpoint);
+            if (err != HttpClientError::None || *code >= 500) {
+                recordHit("%s.error", batch->endpoint);
+                retry(batch);
+                return;
+            }
+
+            // The downstream service won't take these any better the second
+            // time around.
+            if (*code >= 400) {
+                recordHit("%s.rejected", batch->endpoint);
+                drop(*batch);
                 return;
             }
 
-            recordHit("%s.success", endpoint);
-            recordOutcome(Date::now().secondsSince(start), "%s.latency", endpoint);
+            recordHit("%s.success", batch->endpoint);
+            recordOutcome(Date::now().secondsSince(batch->start),
+                    "%s.latency", batch->endpoint);
         };
 
-        auto cb = std::make_shared<HttpClientCallbacks>(nullptr, nullptr, nullptr, onDone);
+        auto cb = std::make_shared<HttpClientCallbacks>(
+                onResponseStart, nullptr, nullptr, onDone);
 
-        client.post("/v1/" + endpoint, cb, body, RestParams(), RestParams(), 1);
+        if (!client.post(resource, cb, body, RestParams(), RestParams(), 1)) {
+            recordHit("%s.queueFull", endpoint);
+            retry(std::move(batch));
+        }
+    }
+
+    void retry(std::shared_ptr<Batch> batch)
+    {
+        if (++batch->attempts > MaxRetries) {
+            drop(*batch);
+            return;
+        }
+
+        double delay = RetryDelay * (1 << (batch->attempts - 1));
+        batch->retryAt = Date::now().plusSeconds(delay);
+        retries.push_back(std::move(batch));
+
+        if (retries.size() > MaxPendingRetries) {
+            drop(*retries.front());
+            retries.pop_front();
+        }
+    }
+
+    void drop(const Batch& batch)
+    {
+        recordCount(batch.items.size(), "%s.dropped", batch.endpoint);
     }
 
     void sendAuction(std::shared_ptr<SubmittedAuctionEvent> auction)
     {
-        send("auctions", *auction);
+        queue(auctions, *auction);
     }
 
     void sendEvent(std::shared_ptr<PostAuctionEvent> event)
     {
-        send("events", *event);
+        queue(events, *event);
     }
 
     HttpClient client;
     TypedMessageSink< std::shared_ptr< SubmittedAuctionEvent> > auctionQueue;
     TypedMessageSink< std::shared_ptr< PostAuctionEvent> > eventQueue;
+
+    // Only touched from the forwarder's thread.
+    Batch auctions;
+    Batch events;
+    std::deque< std::shared_ptr<Batch> > retries;
 };
 
 
@@ -91,6 +91,18 @@ struct EventMatcher : public EventRecorder
         auctionTimeout = timeout;
     }
 
+    /** Sets up a filter to turn away the events for unknown auctions
+        without looking them up; a capacity of 0 turns it off.  Ignored by
+        matchers that don't have one.
+    */
+    virtual void setEventFilter(size_t capacity, double falsePositiveRate) {}
+
+    /** Puts the pending auctions on huge pages of the given mode.  Must be
+        called before any auction is tracked.  Ignored by matchers that
+        don't hold any.
+    */
+    virtual void useHugePages(ML::Huge_Page_Mode mode) {}
+
 
     /************************************************************************/
     /* EVENT MATCHING                                                       */
@@ -112,6 +124,13 @@ struct EventMatcher : public EventRecorder
 
     virtual void initStatePersistence(const std::string & path) {}
 
+    /** Sets how the persisted state is written: a flush period of 0 writes
+        each change on its own, otherwise they're committed in batches at
+        that period.  With sync, writes wait until they're on disk.  Must be
+        called before initStatePersistence().
+    */
+    virtual void setPersistenceCommit(double flushPeriod, bool sync) {}
+
 
 protected:
 
@@ -130,8 +130,11 @@ void
 MatchedWinLoss::
 publish(AnalyticsPublisher & logger) const
 {
+    string channel = "MATCHED" + typeString();
+    if (!logger.isEnabled(channel)) return;
+
     logger.publish(
-            "MATCHED" + typeString(),
+            channel,
             publishTimestamp(),
             auctionId.toString(),
             response.account.toString(),
@@ -181,8 +184,11 @@ void
 MatchedCampaignEvent::
 publish(AnalyticsPublisher & logger) const
 {
+    string channel = "MATCHED" + label;
+    if (!logger.isEnabled(channel)) return;
+
     logger.publish(
-            "MATCHED" + label,
+            channel,
             publishTimestamp(),
             auctionId.toString(),
             account.toString()
@@ -211,8 +217,11 @@ void
 UnmatchedEvent::
 publish(AnalyticsPublisher & logger) const
 {
+    string channel = "UNMATCHED" + string(print(event.type));
+    if (!logger.isEnabled(channel)) return;
+
     logger.publish(
-            "UNMATCHED" + string(print(event.type)),
+            channel,
             publishTimestamp(),
             reason,
             event.auctionId.toString(),
@@ -242,6 +251,7 @@ void
 PostAuctionErrorEvent::
 publish(AnalyticsPublisher & logger) const
 {
+    if (!logger.isEnabled("PAERROR")) return;
     logger.publish("PAERROR", publishTimestamp(), key, message);
 }
 
@@ -7,6 +7,7 @@
 */
 
 #include "finished_info.h"
+#include "rtbkit/common/mem_usage.h"
 
 using namespace std;
 using namespace ML;
@@ -55,6 +56,23 @@ addVisit(Date visitTime,
     visits.push_back(visit);
 }
 
+size_t
+FinishedInfo::
+memUsage() const
+{
+    // Each id of the set is in its own tree node
+    size_t result = sizeof(*this)
+        + heapBytes(bidRequestStr) + heapBytes(bidRequestStrFormat)
+        + heapBytes(augmentations.str) + heapBytes(winMeta)
+        + uids.size() * (sizeof(Id) + 4 * sizeof(void *))
+        + bid.memUsage() - sizeof(bid);
+
+    for (auto & visit: visits)
+        result += sizeof(visit) + heapBytes(visit.meta);
+
+    return result;
+}
+
 Json::Value
 FinishedInfo::
 visitsToJson() const
@@ -100,4 +118,38 @@ reconstitute(DB::Store_Reader & store)
 
 IMPL_SERIALIZE_RECONSTITUTE(FinishedInfo::Visit);
 
+void
+FinishedInfo::
+serialize(DB::Store_Writer & store) const
+{
+    unsigned char version = 1;
+    store << version << auctionTime << auctionId << adSpotId << spotIndex
+          << bidRequestStr << bidRequestStrFormat << augmentations
+          << uids << visitChannels << bidTime << bid
+          << winTime << (unsigned char)reportedStatus
+          << winPrice << rawWinPrice << winMeta
+          << static_cast<const std::vector<CampaignEvent> &>(campaignEvents)
+          << visits;
+}
+
+void
+FinishedInfo::
+reconstitute(DB::Store_Reader & store)
+{
+    unsigned char version;
+    store >> version;
+    if (version != 1)
+        throw ML::Exception("invalid FinishedInfo version");
+
+    unsigned char status;
+    store >> auctionTime >> auctionId >> adSpotId >> spotIndex
+          >> bidRequestStr >> bidRequestStrFormat >> augmentations
+          >> uids >> visitChannels >> bidTime >> bid
+          >> winTime >> status
+          >> winPrice >> rawWinPrice >> winMeta
+          >> static_cast<std::vector<CampaignEvent> &>(campaignEvents)
+          >> visits;
+    reportedStatus = (BidStatus)status;
+}
+
 } // namepsace RTBKIT
@@ -127,6 +127,12 @@ struct FinishedInfo {
 
     Json::Value toJson() const;
 
+    /** Rough number of bytes held by the entry.  See mem_usage.h. */
+    size_t memUsage() const;
+
+    void serialize(ML::DB::Store_Writer & store) const;
+    void reconstitute(ML::DB::Store_Reader & store);
+
     bool fromOldRouter;
 };
 
@@ -2,6 +2,7 @@
 
 LIB_POST_AUCTION_SOURCES := \
         simple_event_matcher.cc \
+	submission_info.cc \
 	sharded_event_matcher.cc \
 	events.cc \
 	finished_info.cc \
@@ -43,13 +43,17 @@ PostAuctionRunner() :
     shard(0),
     auctionTimeout(EventMatcher::DefaultAuctionTimeout),
     winTimeout(EventMatcher::DefaultWinTimeout),
+    eventFilterCapacity(0),
+    eventFilterFalsePositiveRate(0.01),
     bidderConfigurationFile("rtbkit/examples/bidder-config.json"),
     analyticsConfigurationFile(""),
     winLossPipeTimeout(PostAuctionService::DefaultWinLossPipeTimeout),
     campaignEventPipeTimeout(PostAuctionService::DefaultCampaignEventPipeTimeout),
     analyticsPublisherOn(false),
     analyticsPublisherConnections(1),
-    localBankerDebug(false)
+    localBankerDebug(false),
+    statePersistenceFlushPeriod(0.0),
+    statePersistenceSync(false)
 {
 }
 
@@ -72,6 +76,10 @@ doOptions(int argc, char ** argv,
          "Timeout for storing win auction")
         ("auction-seconds", value<float>(&auctionTimeout),
          "Timeout to get late win auction")
+        ("event-filter-capacity", value<size_t>(&eventFilterCapacity),
+         "Number of auctions the campaign event bloom filter is sized for; 0 disables it")
+        ("event-filter-fp-rate", value<double>(&eventFilterFalsePositiveRate),
+         "False positive rate of the campaign event bloom filter")
         ("winlossPipe-seconds", value<int>(&winLossPipeTimeout),
          "Timeout before sending error on WinLoss pipe")
         ("campaignEventPipe-seconds", value<int>(&campaignEventPipeTimeout),
@@ -87,7 +95,14 @@ doOptions(int argc, char ** argv,
         ("local-banker-debug", bool_switch(&localBankerDebug),
          "enable local banker debug for more precise tracking by account")
         ("banker-choice", value<string>(&bankerChoice),
-         "split or local banker can be chosen.");
+         "split or local banker can be chosen.")
+        ("state-persistence", value<string>(&statePersistencePath),
+         "directory where the pending auctions are kept across restarts.")
+        ("state-persistence-flush-seconds", value<double>(&statePersistenceFlushPeriod),
+         "commit the pending auctions in batches at this period; the last "
+         "period can be lost on a crash. 0 writes each change directly.")
+        ("state-persistence-sync", bool_switch(&statePersistenceSync),
+         "wait for the pending auctions to be on disk on every commit.");
 
     options_description all_opt = opts;
     all_opt
@@ -131,14 +146,23 @@ init()
 
     postAuctionLoop->setWinTimeout(winTimeout);
     postAuctionLoop->setAuctionTimeout(auctionTimeout);
+    postAuctionLoop->setEventFilter(
+            eventFilterCapacity, eventFilterFalsePositiveRate);
     postAuctionLoop->setWinLossPipeTimeout(winLossPipeTimeout);
     postAuctionLoop->setCampaignEventPipeTimeout(campaignEventPipeTimeout);
 
     LOG(print) << "win timeout is " << winTimeout << std::endl;
     LOG(print) << "auction timeout is " << auctionTimeout << std::endl;
+    LOG(print) << "event filter capacity is " << eventFilterCapacity << std::endl;
     LOG(print) << "winLoss pipe timeout is " << winLossPipeTimeout << std::endl;
     LOG(print) << "campaignEvent pipe timeout is " << campaignEventPipeTimeout << std::endl;
 
+    if (!statePersistencePath.empty()) {
+        postAuctionLoop->setPersistenceCommit(
+                statePersistenceFlushPeriod, statePersistenceSync);
+        postAuctionLoop->initStatePersistence(statePersistencePath);
+    }
+
     if (localBankerUri != "") {
         localBanker = make_shared<LocalBanker>(proxies, POST_AUCTION, postAuctionLoop->serviceName());
         localBanker->init(localBankerUri);
@@ -177,7 +201,8 @@ init()
     if (analyticsPublisherOn) {
         const auto & analyticsPublisherUri = proxies->params["analytics-uri"].asString();
         if (!analyticsPublisherUri.empty()) {
-            postAuctionLoop->initAnalyticsPublisher(analyticsPublisherUri, analyticsPublisherConnections);
+            postAuctionLoop->initAnalyticsPublisher(analyticsPublisherUri, analyticsPublisherConnections,
+                                                    proxies->params.get("analytics-http2", false).asBool());
         }
         else
             LOG(print) << "analyticsPublisher-uri is not in the config" << endl;
@@ -31,6 +31,8 @@ struct PostAuctionRunner {
     size_t shard;
     float auctionTimeout;
     float winTimeout;
+    size_t eventFilterCapacity;
+    double eventFilterFalsePositiveRate;
     std::string bidderConfigurationFile;
     std::string analyticsConfigurationFile;
 
@@ -43,6 +45,9 @@ struct PostAuctionRunner {
     std::string localBankerUri;
     bool localBankerDebug;
     std::string bankerChoice;
+    std::string statePersistencePath;
+    double statePersistenceFlushPeriod;
+    bool statePersistenceSync;
 
     void doOptions(int argc, char ** argv,
                    const boost::program_options::options_description & opts
@@ -38,6 +38,8 @@ PostAuctionService(
 
       auctionTimeout(EventMatcher::DefaultAuctionTimeout),
       winTimeout(EventMatcher::DefaultWinTimeout),
+      eventFilterCapacity(0),
+      eventFilterFalsePositiveRate(0.01),
       winLossPipeTimeout(DefaultWinLossPipeTimeout),
       campaignEventPipeTimeout(DefaultCampaignEventPipeTimeout),
 
@@ -47,6 +49,7 @@ PostAuctionService(
 
       auctions(65536),
       events(65536),
+      shard(0),
 
       endpoint(getZmqContext()),
       bridge(getZmqContext()),
@@ -65,6 +68,8 @@ PostAuctionService(ServiceBase & parent, const std::string & serviceName)
 
       auctionTimeout(EventMatcher::DefaultAuctionTimeout),
       winTimeout(EventMatcher::DefaultWinTimeout),
+      eventFilterCapacity(0),
+      eventFilterFalsePositiveRate(0.01),
 
       loopMonitor(*this),
       configListener(getZmqContext()),
@@ -72,6 +77,7 @@ PostAuctionService(ServiceBase & parent, const std::string & serviceName)
 
       auctions(65536),
       events(65536),
+      shard(0),
 
       endpoint(getZmqContext()),
       bridge(getZmqContext()),
@@ -163,9 +169,12 @@ initMatcher(size_t shards)
         LOG(print) << "Creating ShardedEventMatcher with " << shards << " shards"
             << endl;
 
+        size_t batchSize =
+            getServices()->params.get("postAuctionMatcherBatchSize", 1).asInt();
+
         ShardedEventMatcher* m;
         matcher.reset(m = new ShardedEventMatcher(serviceName(), getServices()));
-        m->init(shards);
+        m->init(shards, batchSize);
         loop.addSource("PostAuctionService::matcher", *m);
     }
 
@@ -185,6 +194,8 @@ initMatcher(size_t shards)
 
     matcher->setWinTimeout(winTimeout);
     matcher->setAuctionTimeout(auctionTimeout);
+    matcher->setEventFilter(eventFilterCapacity, eventFilterFalsePositiveRate);
+    matcher->useHugePages(getHugePageMode("eventMatcher"));
 }
 
 
@@ -210,10 +221,21 @@ initConnections(size_t shard)
     events.onEvent = std::bind(&PostAuctionService::doEvent, this,_1);
     loop.addSource("PostAuctionService::events", events);
 
+    this->shard = shard;
+    inProcess = std::make_shared<InProcessPostAuction>();
+    inProcess->onAuction = [=] (std::shared_ptr<SubmittedAuctionEvent> event) {
+        auctions.push(std::move(event));
+    };
+    inProcess->onEvent = [=] (std::shared_ptr<PostAuctionEvent> event) {
+        events.push(std::move(event));
+    };
+    InProcessPostAuction::add(shard, inProcess);
+
     // Initialize zeromq endpoints
     endpoint.init(getServices()->config, ZMQ_XREP, serviceName() + "/events");
 
     router.bind("AUCTION", std::bind(&PostAuctionService::doAuctionMessage, this, _1));
+    router.bind("AUCTIONS", std::bind(&PostAuctionService::doAuctionBatchMessage, this, _1));
     router.bind("WIN", std::bind(&PostAuctionService::doWinMessage, this, _1));
     router.bind("LOSS", std::bind(&PostAuctionService::doLossMessage, this,_1));
     router.bind("EVENT", std::bind(&PostAuctionService::doCampaignEventMessage, this, _1));
@@ -246,9 +268,11 @@ initConnections(size_t shard)
 
 void
 PostAuctionService::
-initAnalyticsPublisher(const string & baseUrl, const int numConnections)
+initAnalyticsPublisher(const string & baseUrl, const int numConnections,
+                       bool http2)
 {
     LOG(print) << "analyticsPublisherURI: " << baseUrl << endl;
+    analyticsPublisher.enableHttp2(http2);
     analyticsPublisher.init(baseUrl, numConnections);
 }
 
@@ -303,6 +327,26 @@ initRestEndpoint()
             this,
             JsonParam< std::shared_ptr< PostAuctionEvent> >("", "event to submit"));
 
+    addRouteSync(
+            versionNode,
+            "/auctions/batch",
+            {"POST"},
+            "Submit a batch of auctions to the PAL",
+            &PostAuctionService::doAuctionBatch,
+            this,
+            JsonParam< std::vector< std::shared_ptr< SubmittedAuctionEvent> > >(
+                    "", "auctions to submit"));
+
+    addRouteSync(
+            versionNode,
+            "/events/batch",
+            {"POST"},
+            "Submit a batch of events to the PAL",
+            &PostAuctionService::doEventBatch,
+            this,
+            JsonParam< std::vector< std::shared_ptr< PostAuctionEvent> > >(
+                    "", "events to submit"));
+
     addSource("PostAuctionService::restEndpoint", *restEndpoint);
 }
 
@@ -335,6 +379,8 @@ void
 PostAuctionService::
 shutdown()
 {
+    if (inProcess) InProcessPostAuction::remove(shard, inProcess.get());
+
     matcher->shutdown();
     loopMonitor.shutdown();
     loop.shutdown();
@@ -380,6 +426,28 @@ doAuctionMessage(const std::vector<std::string> & message)
     doAuction(std::move(event));
 }
 
+void
+PostAuctionService::
+doAuctionBatchMessage(const std::vector<std::string> & message)
+{
+    recordHit("messages.AUCTIONS");
+
+    std::istringstream stream(message.at(2));
+    ML::DB::Store_Reader store(stream);
+    size_t size = ML::DB::compact_size_t(store);
+    recordOutcome(size, "auctionBatchSize");
+
+    for (size_t i = 0; i < size; ++i) {
+        std::string str;
+        store >> str;
+
+        recordHit("messages.AUCTION");
+        auto event = std::make_shared<SubmittedAuctionEvent>(
+                ML::DB::reconstituteFromString<SubmittedAuctionEvent>(str));
+        doAuction(std::move(event));
+    }
+}
+
 void
 PostAuctionService::
 doWinMessage(const std::vector<std::string> & message)
@@ -519,7 +587,16 @@ doAuction(std::shared_ptr<SubmittedAuctionEvent> event)
 {
     stats.auctions++;
     if (forwarder) forwarder->forwardAuction(event);
+
+    if (!traced(event->auctionId)) {
+        matcher->doAuction(std::move(event));
+        return;
+    }
+
+    Id auctionId = event->auctionId;
+    Date start = Date::now();
     matcher->doAuction(std::move(event));
+    recordSpan(auctionId, "submitted", start, Date::now());
 }
 
 void
@@ -530,6 +607,20 @@ doEvent(std::shared_ptr<PostAuctionEvent> event)
     matcher->doEvent(std::move(event));
 }
 
+void
+PostAuctionService::
+doAuctionBatch(std::vector< std::shared_ptr<SubmittedAuctionEvent> > events)
+{
+    for (auto& event : events) doAuction(std::move(event));
+}
+
+void
+PostAuctionService::
+doEventBatch(std::vector< std::shared_ptr<PostAuctionEvent> > events)
+{
+    for (auto& event : events) doEvent(std::move(event));
+}
+
 void
 PostAuctionService::
 checkExpiredAuctions()
@@ -558,6 +649,8 @@ doMatchedWinLoss(std::shared_ptr<MatchedWinLoss> event)
         {
             bidder->sendWinLossMessage(entry.config, *event);
         });
+
+    recordSpan(event->auctionId, "win", event->timestamp, Date::now());
 }
 
 void
@@ -20,6 +20,7 @@
 #include "soa/service/zmq_message_router.h"
 #include "soa/service/rest_request_router.h"
 #include "rtbkit/common/analytics_publisher.h"
+#include "rtbkit/common/post_auction_proxy.h"
 #include "rtbkit/core/banker/local_banker.h"
 
 namespace RTBKIT {
@@ -51,7 +52,8 @@ struct PostAuctionService : public ServiceBase, public MonitorProvider
 
     void initBidderInterface(Json::Value const & json);
     void init(size_t externalShard = 0, size_t internalShards = 1);
-    void initAnalyticsPublisher(const std::string & baseUrl, const int numConnections);
+    void initAnalyticsPublisher(const std::string & baseUrl, const int numConnections,
+                                bool http2 = false);
     void initAnalytics(const Json::Value & config = Json::Value::null);
     void start(std::function<void ()> onStop = std::function<void ()>());
     void shutdown();
@@ -104,6 +106,17 @@ struct PostAuctionService : public ServiceBase, public MonitorProvider
         if (matcher) matcher->setAuctionTimeout(timeout);
     }
 
+    /** Turns away the campaign events for unknown auctions with a bloom
+        filter sized for capacity auctions; 0 turns it off.  Must be called
+        before initStatePersistence().
+    */
+    void setEventFilter(size_t capacity, double falsePositiveRate = 0.01)
+    {
+        eventFilterCapacity = capacity;
+        eventFilterFalsePositiveRate = falsePositiveRate;
+        if (matcher) matcher->setEventFilter(capacity, falsePositiveRate);
+    }
+
     void setWinLossPipeTimeout(int timeout)
     {
         if (timeout < 0)
@@ -183,10 +196,26 @@ struct PostAuctionService : public ServiceBase, public MonitorProvider
     /* PERSISTENCE                                                          */
     /************************************************************************/
 
+    /** Keeps the pending auctions in leveldb databases under path so that
+        they survive a restart. Must be called after init() and before
+        start().
+    */
     void initStatePersistence(const std::string & path)
     {
-        throw ML::Exception(
-                "post auction service persistence is not yet implemented.");
+        ExcCheck(matcher, "initStatePersistence called before init");
+        matcher->initStatePersistence(path);
+    }
+
+    /** Commits the changes to the persisted state in batches every
+        flushPeriod seconds instead of one at a time, in which case those
+        of the last period are lost on a crash; 0 writes each one directly.
+        With sync, writes wait until they're on disk.  Must be called after
+        init() and before initStatePersistence().
+    */
+    void setPersistenceCommit(double flushPeriod, bool sync = false)
+    {
+        ExcCheck(matcher, "setPersistenceCommit called before init");
+        matcher->setPersistenceCommit(flushPeriod, sync);
     }
 
 
@@ -240,10 +269,13 @@ private:
 
     void doAuction(std::shared_ptr< SubmittedAuctionEvent> event);
     void doEvent(std::shared_ptr<PostAuctionEvent> event);
+    void doAuctionBatch(std::vector< std::shared_ptr<SubmittedAuctionEvent> > events);
+    void doEventBatch(std::vector< std::shared_ptr<PostAuctionEvent> > events);
     void checkExpiredAuctions();
 
     /** Decode from zeromq and handle a new auction that came in. */
     void doAuctionMessage(const std::vector<std::string> & message);
+    void doAuctionBatchMessage(const std::vector<std::string> & message);
 
     /** Decode from zeromq and handle a new auction that came in. */
     void doWinMessage(const std::vector<std::string> & message);
@@ -273,6 +305,9 @@ private:
     float auctionTimeout;
     float winTimeout;
 
+    size_t eventFilterCapacity;
+    double eventFilterFalsePositiveRate;
+
     int winLossPipeTimeout;
     int campaignEventPipeTimeout;
 
@@ -290,6 +325,11 @@ private:
     TypedMessageSink<std::shared_ptr<SubmittedAuctionEvent> > auctions;
     TypedMessageSink<std::shared_ptr<PostAuctionEvent> > events;
 
+    /** Lets the proxies of the process push into auctions and events
+        directly. */
+    size_t shard;
+    std::shared_ptr<InProcessPostAuction> inProcess;
+
     std::unique_ptr<Analytics> analytics;
     ZmqNamedEndpoint endpoint;
 
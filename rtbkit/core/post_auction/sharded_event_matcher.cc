@@ -29,6 +29,7 @@ Logging::Category ShardedEventMatcher::trace("ShardedEventMatcher Trace", Sharde
 ShardedEventMatcher::
 ShardedEventMatcher(std::string prefix, std::shared_ptr<EventService> events) :
     EventMatcher(std::move(prefix), std::move(events)),
+    batchSize(1),
     matchedWinLossEvents(1 << 10),
     matchedCampaignEvents(1 << 8),
     unmatchedEvents(1 << 4),
@@ -39,6 +40,7 @@ ShardedEventMatcher(std::string prefix, std::shared_ptr<EventService> events) :
 ShardedEventMatcher::
 ShardedEventMatcher(std::string prefix, std::shared_ptr<ServiceProxies> proxies) :
     EventMatcher(std::move(prefix), std::move(proxies)),
+    batchSize(1),
     matchedWinLossEvents(1 << 10),
     matchedCampaignEvents(1 << 8),
     unmatchedEvents(1 << 4),
@@ -61,10 +63,14 @@ Shard(std::string prefix, std::shared_ptr<ServiceProxies> proxies) :
 
 void
 ShardedEventMatcher::
-init(size_t numShards)
+init(size_t numShards, size_t batchSize, double flushPeriod)
 {
     if (numShards <= 1)
         THROW(error) << "Invalid number of shards: " << numShards;
+    if (!batchSize)
+        THROW(error) << "Invalid batch size: " << batchSize;
+
+    this->batchSize = batchSize;
 
     shards.reserve(numShards);
 
@@ -95,6 +101,11 @@ init(size_t numShards)
         doError(std::move(event));
     };
     addSource("SahrdedEventMatcher::errorEvents", errorEvents);
+
+    if (batchSize > 1) {
+        addPeriodic("ShardedEventMatcher::flushShards", flushPeriod,
+                [=] (uint64_t) { flushShards(); });
+    }
 }
 
 void
@@ -103,21 +114,27 @@ init(size_t shard, ShardedEventMatcher* parent)
 {
     using std::placeholders::_1;
 
-    auctions.onEvent = [=] (std::shared_ptr<SubmittedAuctionEvent> event) {
-        parent->recordHit("shards.%d.messages.%s", shard, "AUCTION");
+    typedef std::vector< std::shared_ptr<SubmittedAuctionEvent> > AuctionBatch;
+    auctions.sink.onEvent = [=] (AuctionBatch && batch) {
+        for (auto& event : batch) {
+            parent->recordHit("shards.%d.messages.%s", shard, "AUCTION");
 
-        this->matcher.doAuction(std::move(event));
+            this->matcher.doAuction(std::move(event));
+        }
     };
-    addSource("ShardedEventMatcher::Shard::auctions", auctions);
+    addSource("ShardedEventMatcher::Shard::auctions", auctions.sink);
 
-    events.onEvent = [=] (std::shared_ptr<PostAuctionEvent> event) {
-        parent->recordHit("shards.%d.messages.%s", shard, RTBKIT::print(event->type));
-        if (event->type == PAE_CAMPAIGN_EVENT)
-            parent->recordHit("shards.%d.messages.events.%s", shard, event->label);
+    typedef std::vector< std::shared_ptr<PostAuctionEvent> > EventBatch;
+    events.sink.onEvent = [=] (EventBatch && batch) {
+        for (auto& event : batch) {
+            parent->recordHit("shards.%d.messages.%s", shard, RTBKIT::print(event->type));
+            if (event->type == PAE_CAMPAIGN_EVENT)
+                parent->recordHit("shards.%d.messages.events.%s", shard, event->label);
 
-        this->matcher.doEvent(std::move(event));
+            this->matcher.doEvent(std::move(event));
+        }
     };
-    addSource("ShardedEventMatcher::Shard::events", events);
+    addSource("ShardedEventMatcher::Shard::events", events.sink);
 
     addPeriodic("ShardedEventMatcher::checkExpiredAuctions", 0.1,
             std::bind(&SimpleEventMatcher::checkExpiredAuctions, &matcher));
@@ -167,6 +184,25 @@ setAuctionTimeout(float timeout)
     for (auto& shard : shards) shard->matcher.setAuctionTimeout(timeout);
 }
 
+void
+ShardedEventMatcher::
+setEventFilter(size_t capacity, double falsePositiveRate)
+{
+    // Each shard only tracks its share of the auctions.
+    size_t perShard = (capacity + shards.size() - 1) / shards.size();
+    for (auto& shard : shards)
+        shard->matcher.setEventFilter(perShard, falsePositiveRate);
+}
+
+void
+ShardedEventMatcher::
+useHugePages(ML::Huge_Page_Mode mode)
+{
+    // Each shard gets arenas of its own so that their threads don't share
+    // any locks.
+    for (auto& shard : shards) shard->matcher.useHugePages(mode);
+}
+
 
 void
 ShardedEventMatcher::
@@ -185,6 +221,22 @@ shutdown()
 }
 
 
+void
+ShardedEventMatcher::
+initStatePersistence(const std::string & path)
+{
+    for (size_t i = 0; i < shards.size(); ++i)
+        shards[i]->matcher.initStatePersistence(path + "/shard-" + to_string(i));
+}
+
+void
+ShardedEventMatcher::
+setPersistenceCommit(double flushPeriod, bool sync)
+{
+    for (auto& shard : shards) shard->matcher.setPersistenceCommit(flushPeriod, sync);
+}
+
+
 ShardedEventMatcher::Shard&
 ShardedEventMatcher::
 shard(const Id& auctionId)
@@ -197,7 +249,7 @@ ShardedEventMatcher::
 doAuction(std::shared_ptr<SubmittedAuctionEvent> event)
 {
     auto& s = shard(event->auctionId);
-    s.auctions.push(std::move(event));
+    s.auctions.push(std::move(event), batchSize);
 }
 
 void
@@ -205,7 +257,17 @@ ShardedEventMatcher::
 doEvent(std::shared_ptr<PostAuctionEvent> event)
 {
     auto& s = shard(event->auctionId);
-    s.events.push(std::move(event));
+    s.events.push(std::move(event), batchSize);
+}
+
+void
+ShardedEventMatcher::
+flushShards()
+{
+    for (auto& shard : shards) {
+        shard->auctions.flush();
+        shard->events.flush();
+    }
 }
 
 } // namepsace RTBKIT
@@ -16,6 +16,8 @@
 #include "soa/service/logs.h"
 #include "soa/service/typed_message_channel.h"
 
+#include <mutex>
+
 namespace RTBKIT {
 
 /******************************************************************************/
@@ -28,13 +30,19 @@ struct ShardedEventMatcher : public EventMatcher, public MessageLoop
     ShardedEventMatcher(std::string prefix, std::shared_ptr<EventService> events);
     ShardedEventMatcher(std::string prefix, std::shared_ptr<ServiceProxies> proxies);
 
-    void init(size_t shards);
+    /** Events are handed over to the shards in batches of up to batchSize
+        which are also flushed every flushPeriod seconds. A batchSize of 1
+        hands every event over as soon as it comes in.
+     */
+    void init(size_t shards, size_t batchSize = 1, double flushPeriod = 0.001);
     void start();
     void shutdown();
 
     virtual void setBanker(const std::shared_ptr<Banker> & newBanker);
     virtual void setWinTimeout(float timeout);
     virtual void setAuctionTimeout(float timeout);
+    virtual void setEventFilter(size_t capacity, double falsePositiveRate);
+    virtual void useHugePages(ML::Huge_Page_Mode mode);
 
 
     /************************************************************************/
@@ -50,8 +58,59 @@ struct ShardedEventMatcher : public EventMatcher, public MessageLoop
     /** Periodic auction expiry. */
     virtual void checkExpiredAuctions() {}
 
+
+    /************************************************************************/
+    /* PERSISTENCE                                                          */
+    /************************************************************************/
+
+    /** Each shard gets its own store in a sub-directory of path which means
+        that the number of shards must not change between restarts.
+    */
+    virtual void initStatePersistence(const std::string & path);
+
+    virtual void setPersistenceCommit(double flushPeriod, bool sync);
+
 private:
 
+    /** Accumulates the events bound for a shard so that the queue to the
+        shard's thread, along with its wakeup, is only touched once per
+        batch.
+     */
+    template<typename Event>
+    struct BatchQueue
+    {
+        typedef std::vector<Event> Batch;
+
+        BatchQueue(size_t capacity) : sink(capacity) {}
+
+        void push(Event event, size_t batchSize)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending.emplace_back(std::move(event));
+            if (pending.size() >= batchSize) sendPending();
+        }
+
+        void flush()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!pending.empty()) sendPending();
+        }
+
+        TypedMessageSink<Batch> sink;
+
+    private:
+
+        void sendPending()
+        {
+            // The blocking push copies so only use it when the queue is full.
+            if (!sink.tryPush(std::move(pending))) sink.push(pending);
+            pending.clear();
+        }
+
+        std::mutex lock;
+        Batch pending;
+    };
+
     struct Shard : public MessageLoop
     {
         Shard(std::string prefix, std::shared_ptr<EventService> events);
@@ -59,13 +118,16 @@ private:
         void init(size_t shard, ShardedEventMatcher* parent);
 
         SimpleEventMatcher matcher;
-        TypedMessageSink<std::shared_ptr<SubmittedAuctionEvent> > auctions;
-        TypedMessageSink<std::shared_ptr<PostAuctionEvent> > events;
+        BatchQueue<std::shared_ptr<SubmittedAuctionEvent> > auctions;
+        BatchQueue<std::shared_ptr<PostAuctionEvent> > events;
     };
 
     std::vector< std::unique_ptr<Shard> > shards;
     Shard& shard(const Id& auctionId);
 
+    size_t batchSize;
+    void flushShards();
+
     TypedMessageSink<std::shared_ptr<MatchedWinLoss> > matchedWinLossEvents;
     TypedMessageSink<std::shared_ptr<MatchedCampaignEvent> > matchedCampaignEvents;
     TypedMessageSink<std::shared_ptr<UnmatchedEvent> > unmatchedEvents;
@@ -7,6 +7,7 @@
 
 #include "events.h"
 #include "simple_event_matcher.h"
+#include "soa/service/fs_utils.h"
 #include "jml/utils/guard.h"
 
 #include <iostream>
@@ -39,10 +40,10 @@ namespace RTBKIT {
 
 namespace {
 
-template<typename Value>
+template<typename Value, typename SpotIdMap>
 bool findAuction(
         TimeoutMap<pair<Id,Id>, Value> & pending,
-        const std::unordered_map<Id, Id>& spotIdMap,
+        const SpotIdMap& spotIdMap,
         const Id & auctionId, Id & adSpotId, Value & val)
 {
     if (!adSpotId) {
@@ -79,12 +80,16 @@ Logging::Category SimpleEventMatcher::trace("SimpleEventMatcher Trace", SimpleEv
 
 SimpleEventMatcher::
 SimpleEventMatcher(std::string prefix, std::shared_ptr<EventService> events) :
-    EventMatcher(std::move(prefix), std::move(events))
+    EventMatcher(std::move(prefix), std::move(events)),
+    persistenceFlushPeriod(0.0),
+    persistenceSync(false)
 {}
 
 SimpleEventMatcher::
 SimpleEventMatcher(std::string prefix, std::shared_ptr<ServiceProxies> proxies) :
-    EventMatcher(std::move(prefix), std::move(proxies))
+    EventMatcher(std::move(prefix), std::move(proxies)),
+    persistenceFlushPeriod(0.0),
+    persistenceSync(false)
 {}
 
 
@@ -97,10 +102,11 @@ expireSubmitted(Date start, const pair<Id, Id> & key, const SubmissionInfo & inf
 
     // Just making sure it doesn't leak if doBidResult throws.
     spotIdMap.erase(key.first);
+    unpersist(submittedDb, key);
 
     recordHit("submittedAuctionExpiry");
 
-    if (!info.bidRequest) {
+    if (!info.hasBidRequest()) {
         recordHit("submittedAuctionExpiryWithoutBid");
 
         for(const auto& event : info.pendingWinEvents)
@@ -135,6 +141,7 @@ SimpleEventMatcher::
 expireFinished(const pair<Id, Id> & key, const FinishedInfo & info)
 {
     spotIdMap.erase(key.first);
+    unpersist(finishedDb, key);
 
     recordHit("finishedAuctionExpiry");
     return Date();
@@ -159,11 +166,82 @@ checkExpiredAuctions()
             std::bind(&SimpleEventMatcher::expireFinished, this, _1, _2),
             now);
 
+    if (knownAuctions) {
+        knownAuctions->expire(now);
+        recordLevel(knownAuctions->numFilters(), "eventFilter.filters");
+    }
+
+    recordMemUsage();
+
     banker->logBidEvents(*this);
 }
 
 
 
+void
+SimpleEventMatcher::
+recordMemUsage()
+{
+    MemUsageSample submittedBytes;
+    submitted.forSome(MemUsageSample::DefaultSamples,
+            [&] (const pair<Id, Id> &, const SubmissionInfo & info) {
+                submittedBytes.add(info.memUsage());
+            });
+    recordLevel(submittedBytes.estimate(submitted.size()),
+            "memory.submittedBytes");
+
+    MemUsageSample finishedBytes;
+    finished.forSome(MemUsageSample::DefaultSamples,
+            [&] (const pair<Id, Id> &, const FinishedInfo & info) {
+                finishedBytes.add(info.memUsage());
+            });
+    recordLevel(finishedBytes.estimate(finished.size()),
+            "memory.finishedBytes");
+
+    // Each entry of the map is a node holding the two ids
+    size_t spotIdBytes = spotIdMap.size() * (2 * sizeof(Id) + 2 * sizeof(void *));
+    recordLevel(spotIdBytes, "memory.spotIdMapBytes");
+
+    if (knownAuctions)
+        recordLevel(knownAuctions->memUsage(), "memory.eventFilterBytes");
+}
+
+void
+SimpleEventMatcher::
+setEventFilter(size_t capacity, double falsePositiveRate)
+{
+    if (!capacity) {
+        knownAuctions.reset();
+        return;
+    }
+
+    if (submitted.size() || finished.size())
+        THROW(error) << "event filter must be set before any auction is tracked";
+
+    knownAuctions.reset(new AuctionIdFilter(capacity, falsePositiveRate));
+}
+
+void
+SimpleEventMatcher::
+useHugePages(ML::Huge_Page_Mode mode)
+{
+    if (submitted.size() || finished.size())
+        THROW(error) << "huge pages must be set up before any auction is tracked";
+
+    auto arena = ML::huge_page_arena(mode);
+    submitted.useArena(arena);
+    finished.useArena(arena);
+    spotIdMap = SpotIdMap(0, std::hash<Id>(), std::equal_to<Id>(), arena);
+}
+
+void
+SimpleEventMatcher::
+track(const Id & auctionId, Date timeout)
+{
+    if (knownAuctions) knownAuctions->add(auctionId, timeout);
+}
+
+
 void
 SimpleEventMatcher::
 doEvent(std::shared_ptr<PostAuctionEvent> event)
@@ -214,13 +292,15 @@ doAuction(std::shared_ptr<SubmittedAuctionEvent> event)
             recordHit("auctionAlreadySubmitted");
         }
 
-        submission.bidRequest = event->bidRequest();
+        submission.bidRequestStr = std::move(event->bidRequestStr);
         submission.bidRequestStrFormat = std::move(event->bidRequestStrFormat);
         submission.augmentations = std::move(event->augmentations);
         submission.bid = std::move(event->bidResponse);
 
         submitted.emplace(key, submission, lossTimeout);
+        track(auctionId, lossTimeout);
         spotIdMap[key.first] = key.second;
+        persistSubmitted(key);
 
         string transId =
             makeBidId(auctionId, event->adSpotId, submission.bid.agent);
@@ -313,6 +393,7 @@ doWinLoss(std::shared_ptr<PostAuctionEvent> event, bool isReplay)
             info.forceWin(timestamp, price, winPrice, meta.toString());
 
             finished.get(key) = info;
+            persistFinished(key);
 
             doMatchedWinLoss(std::make_shared<MatchedWinLoss>(
                             MatchedWinLoss::LateWin,
@@ -325,7 +406,7 @@ doWinLoss(std::shared_ptr<PostAuctionEvent> event, bool isReplay)
                           "bidResult.%s.winAfterLossAssumedAmount.%s",
                           typeStr, price.getCurrencyStr());
 
-            auto winLatency = Date::now().secondsSince(info.auctionTime);
+            auto winLatency = Date::nowFast().secondsSince(info.auctionTime);
             recordOutcome(winLatency * 1000.0, "winLatencyMs");
         }
 
@@ -348,8 +429,11 @@ doWinLoss(std::shared_ptr<PostAuctionEvent> event, bool isReplay)
         */
         SubmissionInfo info;
         info.pendingWinEvents.push_back(event);
-        submitted.emplace(key, info, Date::now().plusSeconds(auctionTimeout));
+        Date timeout = Date::nowFast().plusSeconds(auctionTimeout);
+        submitted.emplace(key, info, timeout);
+        track(auctionId, timeout);
         spotIdMap[key.first] = key.second;
+        persistSubmitted(key);
 
         return;
     }
@@ -357,17 +441,22 @@ doWinLoss(std::shared_ptr<PostAuctionEvent> event, bool isReplay)
     SubmissionInfo info = submitted.pop(key);
     spotIdMap.erase(key.first);
 
-    if (!info.bidRequest) {
+    if (!info.hasBidRequest()) {
         // We doubled up on a WIN without having got the auction yet
         info.pendingWinEvents.push_back(event);
-        submitted.emplace(key, info, Date::now().plusSeconds(auctionTimeout));
+        Date timeout = Date::nowFast().plusSeconds(auctionTimeout);
+        submitted.emplace(key, info, timeout);
+        track(auctionId, timeout);
         spotIdMap[key.first] = key.second;
+        persistSubmitted(key);
         return;
     }
 
+    unpersist(submittedDb, key);
+
    if(uids.empty()) {
         // If uids is empty in win message, try to get them form BR
-        uids  = info.bidRequest->userIds;
+        uids  = info.bidRequest()->userIds;
     }
 
     auto confidence = status == BS_WIN ?
@@ -424,7 +513,14 @@ doCampaignEvent(std::shared_ptr<PostAuctionEvent> event)
         doUnmatchedEvent(std::make_shared<UnmatchedEvent>(why, *event));
     };
 
-    if (findAuction(submitted, spotIdMap, auctionId, adSpotId, submissionInfo)) {
+    // Most events for auctions we don't know about are turned away here
+    // without having to look through the maps.
+    bool known = !knownAuctions || knownAuctions->mayContain(auctionId);
+    if (!known) recordHit("eventFilter.rejected");
+
+    if (known
+            && findAuction(submitted, spotIdMap, auctionId, adSpotId, submissionInfo))
+    {
         // Record the impression or click in the submission info.  This will
         // then be passed on once the win comes in.
         //
@@ -439,10 +535,13 @@ doCampaignEvent(std::shared_ptr<PostAuctionEvent> event)
         submissionInfo.earlyCampaignEvents.push_back(event);
         submitted.get(make_pair(auctionId, adSpotId)) = submissionInfo;
         spotIdMap[auctionId] = adSpotId;
+        persistSubmitted(make_pair(auctionId, adSpotId));
         return;
     }
 
-    else if (findAuction(finished, spotIdMap, auctionId, adSpotId, finishedInfo)) {
+    else if (known
+            && findAuction(finished, spotIdMap, auctionId, adSpotId, finishedInfo))
+    {
         // Update the info
         if (finishedInfo.campaignEvents.hasEvent(label)) {
             recordHit("delivery.%s.duplicate", label);
@@ -467,6 +566,7 @@ doCampaignEvent(std::shared_ptr<PostAuctionEvent> event)
         finishedInfo.addUids(uids);
 
         finished.get(key) = finishedInfo;
+        persistFinished(key);
 
         doMatchedCampaignEvent(
                 std::make_shared<MatchedCampaignEvent>(label, finishedInfo));
@@ -518,13 +618,17 @@ doBidResult(
 
     string agent = submission.bid.agent;
 
+    auto bidRequest = submission.bidRequest();
+    if (!bidRequest)
+        THROW(error) << "bid result for auction without a bid request";
+
     // Find the adspot ID
-    int adspot_num = submission.bidRequest->findAdSpotIndex(adSpotId);
+    int adspot_num = bidRequest->findAdSpotIndex(adSpotId);
     if (adspot_num == -1) {
         doError("doBidResult.adSpotIdNotFound",
                 "adspot ID " + adSpotId.toString() +
                 " not found in auction " +
-                submission.bidRequestStr().utf8String());
+                submission.bidRequestStr.utf8String());
     }
 
     const Auction::Response & response = submission.bid;
@@ -580,17 +684,17 @@ doBidResult(
         auto transId = makeBidId(auctionId, adSpotId, agent);
         banker->winBid(account, transId, price, LineItems());
 
-        auto winLatency = Date::now().secondsSince(submission.bidRequest->timestamp);
+        auto winLatency = Date::nowFast().secondsSince(bidRequest->timestamp);
         recordOutcome(winLatency * 1000.0, "winLatencyMs");
     }
 
     // Finally, place it in the finished queue
     FinishedInfo i;
-    i.auctionTime = submission.bidRequest->timestamp;
+    i.auctionTime = bidRequest->timestamp;
     i.auctionId = auctionId;
     i.adSpotId = adSpotId;
     i.spotIndex = adspot_num;
-    i.bidRequestStr = submission.bidRequestStr();
+    i.bidRequestStr = submission.bidRequestStr;
     i.bidRequestStrFormat = submission.bidRequestStrFormat ;
     i.bid = response;
     i.reportedStatus = status;
@@ -611,9 +715,11 @@ doBidResult(
     if (status == BS_LOSS)
         expiryInterval = auctionTimeout;
 
-    Date expiryTime = Date::now().plusSeconds(expiryInterval);
+    Date expiryTime = Date::nowFast().plusSeconds(expiryInterval);
     finished.emplace(make_pair(auctionId, adSpotId), i, expiryTime);
+    track(auctionId, expiryTime);
     spotIdMap[auctionId] = adSpotId;
+    persistFinished(make_pair(auctionId, adSpotId));
 }
 
 
@@ -621,7 +727,6 @@ doBidResult(
 /******************************************************************************/
 /* PERSISTENCE                                                                */
 /******************************************************************************/
-// Needs to be properly tested before enabling.
 
 namespace {
 
@@ -649,146 +754,151 @@ std::string stringifyPair(const std::pair<Id, Id> & vals)
     return stream.str();
 }
 
-} // file scope
+template<typename Value>
+std::string stringifyEntry(Date timeout, const Value & value)
+{
+    ostringstream stream;
+    {
+        DB::Store_Writer store(stream);
+        store << timeout << value;
+    }
+
+    return stream.str();
+}
+
+template<typename Value>
+void unstringifyEntry(const std::string & str, Date & timeout, Value & value)
+{
+    istringstream stream(str);
+    DB::Store_Reader store(stream);
+    store >> timeout >> value;
+}
 
+} // file scope
 
-#if 0 // Persistence layer that needs to be reworked.
 
 void
 SimpleEventMatcher::
 initStatePersistence(const std::string & path)
 {
-    typedef PendingPersistenceT<pair<Id, Id>, SubmissionInfo>
-        SubmittedPending;
+    makeUriDirectory(path + "/");
 
-    auto submittedDb = std::make_shared<LeveldbPendingPersistence>();
-    submittedDb->open(path + "/submitted");
-
-    auto submittedPersistence
-        = std::make_shared<SubmittedPending>();
-    submittedPersistence->store = submittedDb;
+    auto openDb = [&] (const std::string & name) {
+        auto db = std::make_shared<LeveldbPendingPersistence>();
+        db->open(path + "/" + name, persistenceSync);
+        return db;
+    };
 
-    auto stringifySubmissionInfo = [] (const SubmissionInfo & info)
-        {
-            return info.serializeToString();
-        };
+    auto reload = [&] (
+            const std::shared_ptr<LeveldbPendingPersistence> & db,
+            const std::function<bool (pair<Id, Id>, const std::string &)> & onEntry)
+    {
+        size_t count = 0;
 
-    auto unstringifySubmissionInfo = [] (const std::string & str)
-        {
-            SubmissionInfo info;
-            info.reconstituteFromString(str);
-            return info;
+        auto onError = [&] (const std::string & key, const std::string &) {
+            db->erase(key);
         };
 
-    submittedPersistence->stringifyKey = stringifyPair;
-    submittedPersistence->unstringifyKey = unstringifyPair;
-    submittedPersistence->stringifyValue = stringifySubmissionInfo;
-    submittedPersistence->unstringifyValue = unstringifySubmissionInfo;
-
-    Date newTimeout = Date::now().plusSeconds(15);
-
-    auto acceptSubmitted = [&] (pair<Id, Id> & key,
-                                SubmissionInfo & info,
-                                Date & timeout) -> bool
-        {
-            info.fromOldRouter = true;
-            newTimeout.addSeconds(0.001);
-            timeout = newTimeout;
-            // this->debugSpot(key.first, key.second, "RECONST SUBMITTED");
-            return true;
-        };
+        db->scan([&] (const std::string & key, const std::string & value) {
+                    auto ids = unstringifyPair(key);
+                    if (!onEntry(ids, value)) return;
 
-    submitted.initFromStore(submittedPersistence,
-                            acceptSubmitted,
-                            Date::now().plusSeconds(15));
+                    spotIdMap[ids.first] = ids.second;
+                    count++;
+                }, onError);
 
-    typedef PendingPersistenceT<pair<Id, Id>, FinishedInfo>
-        FinishedPending;
+        return count;
+    };
 
-    auto finishedDb = std::make_shared<LeveldbPendingPersistence>();
-    finishedDb->open(path + "/finished");
+    submittedDb = openDb("submitted");
+    size_t numSubmitted = reload(submittedDb,
+            [&] (pair<Id, Id> key, const std::string & value) {
+                Date timeout;
+                SubmissionInfo info;
+                unstringifyEntry(value, timeout, info);
+                info.fromOldRouter = true;
+                track(key.first, timeout);
+                return submitted.emplace(std::move(key), std::move(info), timeout);
+            });
 
-    auto finishedPersistence
-        = std::make_shared<FinishedPending>();
-    finishedPersistence->store = finishedDb;
+    finishedDb = openDb("finished");
+    size_t numFinished = reload(finishedDb,
+            [&] (pair<Id, Id> key, const std::string & value) {
+                Date timeout;
+                FinishedInfo info;
+                unstringifyEntry(value, timeout, info);
+                info.fromOldRouter = true;
+                track(key.first, timeout);
+                return finished.emplace(std::move(key), std::move(info), timeout);
+            });
 
-    auto stringifyFinishedInfo = [] (const FinishedInfo & info)
-        {
-            return info.serializeToString();
-        };
+    LOG(print) << "reloaded " << numSubmitted << " submitted and "
+        << numFinished << " finished auctions from " << path << endl;
 
-    auto unstringifyFinishedInfo = [] (const std::string & str)
-        {
-            FinishedInfo info;
-            info.reconstituteFromString(str);
-            return info;
-        };
+    // Only batch once reloaded so that the erases of bad entries made while
+    // scanning go straight through.
+    if (persistenceFlushPeriod > 0.0) {
+        submittedDb->startBatching(persistenceFlushPeriod);
+        finishedDb->startBatching(persistenceFlushPeriod);
+    }
+}
 
-    finishedPersistence->stringifyKey = stringifyPair;
-    finishedPersistence->unstringifyKey = unstringifyPair;
-    finishedPersistence->stringifyValue = stringifyFinishedInfo;
-    finishedPersistence->unstringifyValue = unstringifyFinishedInfo;
+void
+SimpleEventMatcher::
+setPersistenceCommit(double flushPeriod, bool sync)
+{
+    if (flushPeriod < 0.0)
+        THROW(error) << "invalid persistence flush period: " << flushPeriod;
+    if (submittedDb)
+        THROW(error) << "persistence commit must be set before it's started";
 
-    newTimeout = Date::now().plusSeconds(auctionTimeout);
+    persistenceFlushPeriod = flushPeriod;
+    persistenceSync = sync;
+}
 
-    auto acceptFinished = [&] (pair<Id, Id> & key,
-                               FinishedInfo & info,
-                               Date & timeout) -> bool
-        {
-            info.fromOldRouter = true;
-            newTimeout.addSeconds(0.001);
-            timeout = newTimeout;
-            // this->debugSpot(key.first, key.second, "RECONST FINISHED");
+void
+SimpleEventMatcher::
+persistSubmitted(const pair<Id, Id> & key)
+{
+    if (!submittedDb) return;
 
-            return true;
-        };
+    try {
+        submittedDb->put(
+                stringifyPair(key),
+                stringifyEntry(submitted.timeout(key), submitted.get(key)));
+    } catch (const std::exception & exc) {
+        doError("persistence.submitted", exc.what());
+    }
+}
 
-    finished.initFromStore(finishedPersistence,
-                           acceptFinished,
-                           Date::now().plusSeconds(auctionTimeout));
+void
+SimpleEventMatcher::
+persistFinished(const pair<Id, Id> & key)
+{
+    if (!finishedDb) return;
 
-    auto backgroundWork = [=] (volatile int & shutdown, int64_t threadId)
-        {
-            while (!shutdown) {
-                futex_wait(const_cast<int &>(shutdown), 0, 600.0);
-                if (shutdown) break;
-                //continue;
-
-                {
-                    Date start = Date::now();
-                    submittedDb->compact();
-                    Date end = Date::now();
-                    this->recordEvent("persistentData.submitted.compactTimeMs",
-                                  ET_OUTCOME,
-                                  1000.0 * (end.secondsSince(start)));
-                    uint64_t size = submittedDb->getDbSize();
-                    //cerr << "submitted db is " << size / 1024.0 / 1024.0
-                    //     << "MB" << endl;
-                    this->recordEvent("persistentData.submitted.dbSizeMb",
-                                  ET_LEVEL, size / 1024.0 / 1024.0);
-                }
-
-                {
-                    Date start = Date::now();
-                    finishedDb->compact();
-                    Date end = Date::now();
-                    this->recordEvent("persistentData.finished.compactTimeMs",
-                                  ET_OUTCOME,
-                                  1000.0 * (end.secondsSince(start)));
-                    uint64_t size = finishedDb->getDbSize();
-                    //cerr << "finished db is " << size / 1024.0 / 1024.0
-                    //     << "MB" << endl;
-                    this->recordEvent("persistentData.finished.dbSizeMb",
-                                  ET_LEVEL, size / 1024.0 / 1024.0);
-                }
-            }
+    try {
+        finishedDb->put(
+                stringifyPair(key),
+                stringifyEntry(finished.timeout(key), finished.get(key)));
+    } catch (const std::exception & exc) {
+        doError("persistence.finished", exc.what());
+    }
+}
 
-            cerr << "exiting background work thread" << endl;
-        };
+void
+SimpleEventMatcher::
+unpersist(
+        const std::shared_ptr<LeveldbPendingPersistence> & db,
+        const pair<Id, Id> & key)
+{
+    if (!db) return;
 
-    // loop.startSubordinateThread(backgroundWork);
+    try {
+        db->erase(stringifyPair(key));
+    } catch (const std::exception & exc) {
+        doError("persistence.erase", exc.what());
+    }
 }
 
-#endif
-
 } // RTBKIT
@@ -8,11 +8,13 @@
 #pragma once
 
 #include "timeout_map.h"
+#include "auction_id_filter.h"
 #include "event_matcher.h"
 #include "finished_info.h"
 #include "submission_info.h"
 #include "rtbkit/common/auction.h"
-// #include "soa/service/pending_list.h"
+#include "rtbkit/common/mem_usage.h"
+#include "soa/service/pending_list.h"
 #include "soa/service/logs.h"
 
 #include <utility>
@@ -58,12 +60,27 @@ struct SimpleEventMatcher : public EventMatcher
     /** Periodic auction expiry. */
     virtual void checkExpiredAuctions();
 
+    /** Screens campaign events through a bloom filter of the tracked
+        auction ids; a capacity of 0 turns it off.
+    */
+    virtual void setEventFilter(size_t capacity, double falsePositiveRate);
+
+    /** Puts submitted, finished and the spot ids on huge pages. */
+    virtual void useHugePages(ML::Huge_Page_Mode mode);
+
 
     /************************************************************************/
     /* PERSISTENCE                                                          */
     /************************************************************************/
 
-    // virtual void initStatePersistence(const std::string & path);
+    /** Writes the submitted and finished auctions through to leveldb
+        databases under the given directory and reloads whatever is already
+        there so that pending wins survive a restart. Must be called before
+        any events are processed.
+    */
+    virtual void initStatePersistence(const std::string & path);
+
+    virtual void setPersistenceCommit(double flushPeriod, bool sync);
 
     static Logging::Category print;
     static Logging::Category error;
@@ -78,6 +95,12 @@ private:
         THROW(error) << msg;
     }
 
+    /** Publishes estimates of the memory held by the pending auctions. */
+    void recordMemUsage();
+
+    /** Adds the auction to the event filter until the given time. */
+    void track(const Id & auctionId, Date timeout);
+
     void doReallyLateWin(const std::shared_ptr<PostAuctionEvent>& event);
 
     /** We got a win/loss.  Match it up with its bid and pass on to the
@@ -105,6 +128,15 @@ private:
 
     Date expireFinished(const std::pair<Id, Id> & key, const FinishedInfo & info);
 
+    /** Mirror the changes made to submitted and finished in their store; no-ops
+        unless initStatePersistence was called.
+    */
+    void persistSubmitted(const std::pair<Id, Id> & key);
+    void persistFinished(const std::pair<Id, Id> & key);
+    void unpersist(
+            const std::shared_ptr<LeveldbPendingPersistence> & db,
+            const std::pair<Id, Id> & key);
+
 
     /** List of auctions we're currently tracking as submitted.  Note that an
         auction may be both submitted and in flight (if we had submitted a bid
@@ -136,7 +168,21 @@ private:
         which entry is the real entry. So instead we keep an arbitrarily chosen
         entry.
      */
-    std::unordered_map<Id, Id> spotIdMap;
+    typedef std::unordered_map<
+        Id, Id, std::hash<Id>, std::equal_to<Id>,
+        ML::Huge_Page_Allocator< std::pair<const Id, Id> > > SpotIdMap;
+    SpotIdMap spotIdMap;
+
+    /** Every auction id that's in submitted or finished, along with some
+        that have been dropped from them; null if there's no event filter.
+    */
+    std::unique_ptr<AuctionIdFilter> knownAuctions;
+
+    std::shared_ptr<LeveldbPendingPersistence> submittedDb;
+    std::shared_ptr<LeveldbPendingPersistence> finishedDb;
+
+    double persistenceFlushPeriod;
+    bool persistenceSync;
 };
 
 } // RTBKIT
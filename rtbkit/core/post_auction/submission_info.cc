@@ -0,0 +1,97 @@
+/** submission_info.cc                                 -*- C++ -*-
+    Rémi Attab, 18 Apr 2014
+    Copyright (c) 2014 Datacratic.  All rights reserved.
+
+    Implementation of submission info.
+
+*/
+
+#include "submission_info.h"
+#include "rtbkit/common/mem_usage.h"
+
+using namespace std;
+using namespace ML;
+
+namespace RTBKIT {
+
+/*****************************************************************************/
+/* SUBMISSION INFO                                                           */
+/*****************************************************************************/
+
+std::shared_ptr<BidRequest>
+SubmissionInfo::
+bidRequest() const
+{
+    if (!bidRequest_ && !bidRequestStr.empty())
+        bidRequest_.reset(BidRequest::parse(bidRequestStrFormat, bidRequestStr));
+    return bidRequest_;
+}
+
+void
+SubmissionInfo::
+bidRequest(std::shared_ptr<BidRequest> request)
+{
+    bidRequest_ = std::move(request);
+    if (bidRequest_ && bidRequestStr.empty()) {
+        bidRequestStr = Datacratic::UnicodeString(bidRequest_->toJsonStr());
+        bidRequestStrFormat = "datacratic";
+    }
+}
+
+size_t
+SubmissionInfo::
+memUsage() const
+{
+    size_t result = sizeof(*this)
+        + heapBytes(bidRequestStr) + heapBytes(bidRequestStrFormat)
+        + heapBytes(augmentations.str)
+        + bid.memUsage() - sizeof(bid);
+
+    // As for auctions, a decoded request is taken to be as big as its text
+    if (bidRequest_) result += bidRequestStr.rawLength();
+
+    size_t numEvents = pendingWinEvents.size() + earlyCampaignEvents.size();
+    return result + numEvents * sizeof(PostAuctionEvent);
+}
+
+void
+SubmissionInfo::
+serialize(DB::Store_Writer & store) const
+{
+    unsigned char version = 2;
+    store << version << bidRequestStr << bidRequestStrFormat
+          << augmentations << bid
+          << pendingWinEvents << earlyCampaignEvents;
+}
+
+void
+SubmissionInfo::
+reconstitute(DB::Store_Reader & store)
+{
+    unsigned char version;
+    store >> version;
+
+    // Version 1 stored the decoded bid request.
+    std::shared_ptr<BidRequest> request;
+
+    if (version == 1) {
+        unsigned char hasBidRequest;
+        store >> hasBidRequest;
+        if (hasBidRequest) {
+            request = std::make_shared<BidRequest>();
+            store >> *request;
+        }
+        bidRequestStr = Datacratic::UnicodeString();
+    }
+    else if (version == 2)
+        store >> bidRequestStr;
+    else throw ML::Exception("invalid SubmissionInfo version");
+
+    store >> bidRequestStrFormat >> augmentations >> bid
+          >> pendingWinEvents >> earlyCampaignEvents;
+
+    bidRequest_.reset();
+    if (request) bidRequest(request);
+}
+
+} // namespace RTBKIT
@@ -29,13 +29,21 @@ struct SubmissionInfo {
     {
     }
 
-    std::shared_ptr<BidRequest> bidRequest;
+    /** The bid request is kept as it came on the wire and is only decoded
+        when an event is matched against it; most auctions expire without
+        ever needing it and the decoded form is several times larger.
+    */
+    Datacratic::UnicodeString bidRequestStr;
     std::string bidRequestStrFormat;
 
-    Datacratic::UnicodeString bidRequestStr() const {
-        return Datacratic::UnicodeString(bidRequest->toJsonStr());
+    bool hasBidRequest() const
+    {
+        return !bidRequestStr.empty() || bidRequest_;
     }
 
+    std::shared_ptr<BidRequest> bidRequest() const;
+    void bidRequest(std::shared_ptr<BidRequest> request);
+
     JsonHolder augmentations;
     Auction::Response  bid;               ///< Bid we passed on
     bool fromOldRouter;                   ///< Was reconstituted
@@ -48,6 +56,15 @@ struct SubmissionInfo {
     */
     std::vector<std::shared_ptr<PostAuctionEvent> > pendingWinEvents;
     std::vector<std::shared_ptr<PostAuctionEvent> > earlyCampaignEvents;
+
+    /** Rough number of bytes held by the entry.  See mem_usage.h. */
+    size_t memUsage() const;
+
+    void serialize(ML::DB::Store_Writer & store) const;
+    void reconstitute(ML::DB::Store_Reader & store);
+
+private:
+    mutable std::shared_ptr<BidRequest> bidRequest_;  ///< Decoded on demand
 };
 
 
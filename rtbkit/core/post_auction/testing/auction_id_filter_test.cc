@@ -0,0 +1,103 @@
+/* auction_id_filter_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the bloom filter of the auction ids tracked by the matcher.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/post_auction/auction_id_filter.h"
+
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+Id makeId(size_t i)
+{
+    return Id("auction-" + to_string(i));
+}
+
+} // file scope
+
+
+BOOST_AUTO_TEST_CASE( test_no_false_negatives )
+{
+    AuctionIdFilter filter(10000, 0.01);
+    Date expiry = Date::fromSecondsSinceEpoch(100);
+
+    for (size_t i = 0; i < 10000; ++i)
+        filter.add(makeId(i), expiry);
+
+    for (size_t i = 0; i < 10000; ++i)
+        BOOST_REQUIRE(filter.mayContain(makeId(i)));
+
+    BOOST_CHECK_EQUAL(filter.numFilters(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_false_positive_rate )
+{
+    size_t capacity = 100000;
+    AuctionIdFilter filter(capacity, 0.01);
+    Date expiry = Date::fromSecondsSinceEpoch(100);
+
+    for (size_t i = 0; i < capacity; ++i)
+        filter.add(makeId(i), expiry);
+
+    size_t positives = 0;
+    size_t tests = 100000;
+    for (size_t i = 0; i < tests; ++i)
+        positives += filter.mayContain(makeId(capacity + i));
+
+    double rate = double(positives) / tests;
+    BOOST_TEST_MESSAGE("false positive rate " << rate);
+    BOOST_CHECK_LT(rate, 0.02);
+}
+
+BOOST_AUTO_TEST_CASE( test_rotation_and_expiry )
+{
+    AuctionIdFilter filter(1000, 0.01);
+
+    // Three full filters expiring one second apart.
+    for (size_t i = 0; i < 3000; ++i)
+        filter.add(makeId(i), Date::fromSecondsSinceEpoch(10 + i / 1000));
+    BOOST_CHECK_EQUAL(filter.numFilters(), 3);
+
+    for (size_t i = 0; i < 3000; ++i)
+        BOOST_REQUIRE(filter.mayContain(makeId(i)));
+
+    // Nothing's gone until every id of the oldest filter is past its time.
+    filter.expire(Date::fromSecondsSinceEpoch(10));
+    BOOST_CHECK_EQUAL(filter.numFilters(), 3);
+
+    filter.expire(Date::fromSecondsSinceEpoch(10.5));
+    BOOST_CHECK_EQUAL(filter.numFilters(), 2);
+    for (size_t i = 1000; i < 3000; ++i)
+        BOOST_REQUIRE(filter.mayContain(makeId(i)));
+
+    size_t found = 0;
+    for (size_t i = 0; i < 1000; ++i)
+        found += filter.mayContain(makeId(i));
+    BOOST_CHECK_LT(found, 50);
+
+    // The last filter is emptied rather than dropped.
+    filter.expire(Date::fromSecondsSinceEpoch(20));
+    BOOST_CHECK_EQUAL(filter.numFilters(), 1);
+    for (size_t i = 0; i < 3000; ++i)
+        BOOST_REQUIRE(!filter.mayContain(makeId(i)));
+
+    filter.add(makeId(0), Date::fromSecondsSinceEpoch(30));
+    BOOST_CHECK(filter.mayContain(makeId(0)));
+}
+
+BOOST_AUTO_TEST_CASE( test_invalid_parameters )
+{
+    BOOST_CHECK_THROW(AuctionIdFilter(0, 0.01), ML::Exception);
+    BOOST_CHECK_THROW(AuctionIdFilter(100, 0.0), ML::Exception);
+    BOOST_CHECK_THROW(AuctionIdFilter(100, 1.0), ML::Exception);
+}
@@ -0,0 +1,177 @@
+/* timeout_map_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the timing wheel of the post auction timeout map.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/post_auction/timeout_map.h"
+#include "jml/utils/exc_check.h"
+
+#include <map>
+#include <random>
+#include <algorithm>
+
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+size_t expireAll(TimeoutMap<int, int> & map, Date now, vector<int> & keys)
+{
+    return map.expire([&] (int key, int) { keys.push_back(key); }, now);
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_basics )
+{
+    TimeoutMap<int, int> map;
+    Date now = Date::now();
+
+    BOOST_CHECK(map.emplace(1, 10, now.plusSeconds(0.010)));
+    BOOST_CHECK(map.emplace(2, 20, now.plusSeconds(1.0)));
+    BOOST_CHECK(map.emplace(3, 30, now.plusSeconds(100.0)));
+    BOOST_CHECK(!map.emplace(1, 11, now.plusSeconds(5.0)));
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK_EQUAL(map.get(1), 10);
+
+    vector<int> keys;
+    BOOST_CHECK_EQUAL(expireAll(map, now, keys), 0);
+
+    // Timeouts are exact and not rounded to the end of their tick.
+    BOOST_CHECK_EQUAL(expireAll(map, now.plusSeconds(0.0099), keys), 0);
+    BOOST_CHECK_EQUAL(expireAll(map, now.plusSeconds(0.010), keys), 1);
+    BOOST_CHECK_EQUAL(keys.at(0), 1);
+
+    map.update(2, now.plusSeconds(200.0));
+    BOOST_CHECK_EQUAL(expireAll(map, now.plusSeconds(150.0), keys), 1);
+    BOOST_CHECK_EQUAL(keys.at(1), 3);
+
+    BOOST_CHECK_EQUAL(map.pop(2), 20);
+    BOOST_CHECK_EQUAL(map.size(), 0);
+    BOOST_CHECK(!map.erase(2));
+    BOOST_CHECK_EQUAL(expireAll(map, now.plusSeconds(300.0), keys), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_for_some )
+{
+    TimeoutMap<int, int> map;
+    Date now = Date::now();
+    for (int i = 0; i < 100; ++i)
+        map.emplace(i, i * 10, now.plusSeconds(i));
+
+    size_t seen = 0;
+    map.forSome(10, [&] (int key, int value) {
+                BOOST_CHECK_EQUAL(value, key * 10);
+                ++seen;
+            });
+    BOOST_CHECK_EQUAL(seen, 10);
+
+    seen = 0;
+    map.forSome(1000, [&] (int, int) { ++seen; });
+    BOOST_CHECK_EQUAL(seen, 100);
+}
+
+BOOST_AUTO_TEST_CASE( test_past_timeouts )
+{
+    TimeoutMap<int, int> map;
+    Date now = Date::now();
+
+    vector<int> keys;
+    expireAll(map, now, keys);
+
+    map.emplace(1, 1, now.plusSeconds(-10.0));
+    map.emplace(2, 2, now.plusSeconds(-0.5));
+    BOOST_CHECK_EQUAL(expireAll(map, now, keys), 2);
+    BOOST_CHECK_EQUAL(map.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_callback_modifies_map )
+{
+    TimeoutMap<int, int> map;
+    Date now = Date::now();
+
+    map.emplace(1, 1, now.plusSeconds(1.0));
+    map.emplace(2, 2, now.plusSeconds(1.0));
+
+    size_t expired = map.expire([&] (int key, int) {
+                map.erase(3 - key);
+                map.emplace(key + 10, key, now.plusSeconds(2.0));
+            }, now.plusSeconds(1.5));
+
+    BOOST_CHECK_EQUAL(expired, 2);
+    BOOST_CHECK_EQUAL(map.size(), 2);
+    BOOST_CHECK(map.count(11));
+    BOOST_CHECK(map.count(12));
+}
+
+/** Checks the wheel against a map ordered by timeout over random operations
+    spread across all the levels.
+*/
+BOOST_AUTO_TEST_CASE( test_random )
+{
+    TimeoutMap<int, int> map;
+    std::map<int, Date> expected;
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> keyDist(0, 999);
+    std::uniform_real_distribution<double> unitDist(0.0, 1.0);
+
+    auto randomDelay = [&] () {
+        // Mostly short timeouts with a long tail spanning all the levels.
+        return std::pow(10.0, unitDist(rng) * 9.0 - 4.0);
+    };
+
+    Date now = Date::now();
+
+    for (unsigned iter = 0; iter < 50000; ++iter) {
+        int key = keyDist(rng);
+        double op = unitDist(rng);
+
+        if (op < 0.4) {
+            Date timeout = now.plusSeconds(randomDelay());
+            bool inserted = map.emplace(key, key, timeout);
+            BOOST_REQUIRE_EQUAL(inserted, !expected.count(key));
+            if (inserted) expected[key] = timeout;
+        }
+        else if (op < 0.6) {
+            if (!expected.count(key)) continue;
+            Date timeout = now.plusSeconds(randomDelay());
+            map.update(key, timeout);
+            expected[key] = timeout;
+        }
+        else if (op < 0.7) {
+            BOOST_REQUIRE_EQUAL(map.erase(key), expected.erase(key));
+        }
+        else {
+            now = now.plusSeconds(randomDelay() * 0.01);
+
+            vector<int> keys;
+            map.expire([&] (int key, int value) {
+                        BOOST_REQUIRE_EQUAL(key, value);
+                        keys.push_back(key);
+                    }, now);
+
+            vector<int> expectedKeys;
+            for (auto it = expected.begin(); it != expected.end();) {
+                if (it->second <= now) {
+                    expectedKeys.push_back(it->first);
+                    it = expected.erase(it);
+                }
+                else ++it;
+            }
+
+            std::sort(keys.begin(), keys.end());
+            BOOST_REQUIRE(keys == expectedKeys);
+        }
+
+        BOOST_REQUIRE_EQUAL(map.size(), expected.size());
+    }
+}
@@ -12,9 +12,13 @@
 #pragma once
 
 #include "soa/types/date.h"
+#include "jml/utils/exc_check.h"
+#include "jml/arch/huge_page_allocator.h"
 
-#include <set>
-#include <queue>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+#include <stdint.h>
 
 namespace RTBKIT {
 
@@ -22,9 +26,29 @@ namespace RTBKIT {
 /* TIMEOUT MAP                                                                */
 /******************************************************************************/
 
+/** Hierarchical timing wheel with a resolution of 1ms: 4 levels of 256 slots
+    covering respectively 256ms, 65s, 4.6 hours and 49 days. Each entry sits
+    in exactly one intrusive list so emplace(), update(), pop() and erase()
+    are O(1) and no stale entries are ever left behind. expire() costs O(1)
+    per elapsed tick (skipping over the empty levels) plus the cascading of
+    the far entries into the closer levels, which each entry goes through
+    at most once per level.
+
+    Timeouts are still compared exactly so an entry expires as soon as its
+    timeout is reached, not at the end of its tick.
+
+    Entries point to each other so the map can't be copied or moved.
+ */
 template<typename Key, typename Value>
 struct TimeoutMap
 {
+    TimeoutMap() : currentTick(0), started(false)
+    {
+        clearSlots();
+    }
+
+    TimeoutMap(const TimeoutMap&) = delete;
+    TimeoutMap& operator=(const TimeoutMap&) = delete;
 
     size_t size() const
     {
@@ -50,13 +74,31 @@ struct TimeoutMap
         return it->second.value;
     }
 
+    Datacratic::Date timeout(const Key& key) const
+    {
+        auto it = map.find(key);
+        ExcCheck(it != map.end(), "key not present in the timeout map.");
+        return it->second.timeout;
+    }
+
     bool emplace(Key key, Value value, Datacratic::Date timeout)
     {
         auto ret = map.insert(std::make_pair(
                         std::move(key), Entry(std::move(value), timeout)));
         if (!ret.second) return false;
 
-        queue.emplace(ret.first->first, timeout);
+        Entry& entry = ret.first->second;
+        entry.key = &ret.first->first;
+
+        // Line the wheel up on the current time rather than on the first
+        // timeout seen; the later timeouts shouldn't all land in the past.
+        if (!started) {
+            currentTick = std::min(tickOf(Datacratic::Date::now()),
+                                   tickOf(timeout));
+            started = true;
+        }
+
+        place(entry);
         return true;
     }
 
@@ -65,8 +107,10 @@ struct TimeoutMap
         auto it = map.find(key);
         ExcCheck(it != map.end(), "key not present in the timeout map.");
 
-        it->second.timeout = timeout;
-        queue.emplace(key, timeout);
+        Entry& entry = it->second;
+        unlink(entry);
+        entry.timeout = timeout;
+        place(entry);
     }
 
     Value pop(const Key& key)
@@ -75,68 +119,231 @@ struct TimeoutMap
         ExcCheck(it != map.end(), "key not present in the timeout map.");
 
         Value value = std::move(it->second.value);
-        map.erase(it);
+        remove(it);
         return value;
     }
 
     bool erase(const Key& key)
     {
-        return map.erase(key);
+        auto it = map.find(key);
+        if (it == map.end()) return false;
+
+        remove(it);
+        return true;
+    }
+
+    /** Allocates the entries from the given arena, or with operator new if
+        it's null. The map must be empty.
+    */
+    void useArena(std::shared_ptr<ML::Huge_Page_Arena> arena)
+    {
+        ExcCheck(map.empty(), "can't change the arena of a non-empty map.");
+        map = Map(0, std::hash<Key>(), std::equal_to<Key>(), arena);
+    }
+
+    /** Calls fn with up to n of the entries, in no particular order; used to
+        sample the map.
+    */
+    template<typename Fn>
+    void forSome(size_t n, const Fn& fn) const
+    {
+        for (auto it = map.begin(); it != map.end() && n; ++it, --n)
+            fn(it->first, it->second.value);
     }
 
     template<typename Fn>
     size_t expire(const Fn& fn, Datacratic::Date now = Datacratic::Date::now())
     {
-        std::vector< std::pair<Key, Entry> > toExpire;
+        std::vector< std::pair<Key, Value> > toExpire;
         toExpire.reserve(1 << 4);
 
-        while (!queue.empty() && queue.top().timeout <= now) {
-            TimeoutEntry entry = std::move(queue.top());
-            queue.pop();
-
-            auto it = map.find(entry.key);
-            if (it == map.end()) continue;
-            if (it->second.timeout > now) continue;
-
-            toExpire.emplace_back(std::move(*it));
+        // The callback may modify the map so entries are first taken out
+        // and only then handed over.
+        auto take = [&] (Entry* entry) {
+            auto it = map.find(*entry->key);
+            unlink(*entry);
+            toExpire.emplace_back(std::move(it->first), std::move(entry->value));
             map.erase(it);
+        };
+
+        auto takeDue = [&] (Entry* list) {
+            while (list) {
+                Entry* next = list->next;
+                if (list->timeout <= now) take(list);
+                list = next;
+            }
+        };
+
+        takeDue(overdue);
+
+        if (started) {
+            int64_t nowTick = tickOf(now);
+
+            while (currentTick < nowTick) {
+                Entry* list = slots[0][currentTick & SlotMask];
+                while (list) {
+                    Entry* next = list->next;
+                    take(list);
+                    list = next;
+                }
+
+                advance(nowTick);
+            }
+
+            if (currentTick == nowTick)
+                takeDue(slots[0][currentTick & SlotMask]);
         }
 
+        if (map.empty()) started = false;
+
         for (auto& entry : toExpire)
-            fn(std::move(entry.first), std::move(entry.second.value));
+            fn(std::move(entry.first), std::move(entry.second));
 
         return toExpire.size();
     }
 
 private:
 
+    enum {
+        Levels = 4,
+        SlotBits = 8,
+        SlotsPerLevel = 1 << SlotBits,
+        SlotMask = SlotsPerLevel - 1,
+        Overdue = Levels
+    };
+
     struct Entry
     {
         Value value;
         Datacratic::Date timeout;
 
+        const Key* key;
+        Entry* next;
+        Entry** pprev;
+        int level;
+
         Entry(Value value, Datacratic::Date timeout) :
-            value(std::move(value)), timeout(timeout)
+            value(std::move(value)), timeout(timeout),
+            key(nullptr), next(nullptr), pprev(nullptr), level(0)
         {}
     };
 
-    struct TimeoutEntry
+    static int64_t tickOf(Datacratic::Date date)
     {
-        Key key;
-        Datacratic::Date timeout;
+        return std::floor(date.secondsSinceEpoch() * 1000.0);
+    }
 
-        TimeoutEntry(Key key, Datacratic::Date timeout) :
-            key(std::move(key)), timeout(timeout)
-        {}
+    void clearSlots()
+    {
+        for (auto& level : slots)
+            for (auto& slot : level) slot = nullptr;
+        for (auto& n : levelSize) n = 0;
+        overdue = nullptr;
+    }
+
+    /** Files the entry in the list matching its distance to the current
+        tick.
+     */
+    void place(Entry& entry)
+    {
+        int64_t tick = tickOf(entry.timeout);
+        int64_t delta = tick - currentTick;
 
-        bool operator<(const TimeoutEntry& other) const
-        {
-            return timeout > other.timeout;
+        Entry** head;
+        if (delta < 0) {
+            entry.level = Overdue;
+            head = &overdue;
         }
-    };
+        else {
+            // Timeouts too far out for the wheel are cascaded back into the
+            // last level until they come within range.
+            const int64_t maxDelta = (int64_t(1) << (SlotBits * Levels)) - 1;
+            if (delta > maxDelta) tick = currentTick + maxDelta;
+
+            int level = 0;
+            while (level < Levels - 1
+                    && delta >= (int64_t(1) << (SlotBits * (level + 1))))
+                ++level;
+
+            entry.level = level;
+            head = &slots[level][(tick >> (SlotBits * level)) & SlotMask];
+            ++levelSize[level];
+        }
+
+        entry.next = *head;
+        if (entry.next) entry.next->pprev = &entry.next;
+        entry.pprev = head;
+        *head = &entry;
+    }
+
+    void unlink(Entry& entry)
+    {
+        *entry.pprev = entry.next;
+        if (entry.next) entry.next->pprev = entry.pprev;
+        entry.next = nullptr;
+        entry.pprev = nullptr;
+
+        if (entry.level != Overdue) --levelSize[entry.level];
+    }
+
+    typedef std::unordered_map<
+        Key, Entry, std::hash<Key>, std::equal_to<Key>,
+        ML::Huge_Page_Allocator< std::pair<const Key, Entry> > > Map;
+
+    void remove(typename Map::iterator it)
+    {
+        unlink(it->second);
+        map.erase(it);
+        if (map.empty()) started = false;
+    }
+
+    /** Moves the current tick forward, jumping over the ticks that can't
+        have anything to expire, and cascades the far entries that are now
+        within range of a closer level.
+     */
+    void advance(int64_t nowTick)
+    {
+        int level = 0;
+        while (level < Levels && !levelSize[level]) ++level;
+
+        if (level == Levels) {
+            currentTick = nowTick;
+            return;
+        }
+
+        int64_t step = int64_t(1) << (SlotBits * level);
+        currentTick = std::min(nowTick, (currentTick | (step - 1)) + 1);
+
+        for (int l = Levels - 1; l > 0; --l) {
+            int64_t span = int64_t(1) << (SlotBits * l);
+            if (currentTick & (span - 1)) continue;
+            cascade(l, (currentTick >> (SlotBits * l)) & SlotMask);
+        }
+    }
+
+    void cascade(int level, size_t slot)
+    {
+        // Entries can be placed back in the same slot so take the list out
+        // before going through it.
+        Entry* head = slots[level][slot];
+        slots[level][slot] = nullptr;
+        if (head) head->pprev = &head;
+
+        while (head) {
+            Entry* entry = head;
+            unlink(*entry);
+            place(*entry);
+        }
+    }
+
+    Map map;
+
+    int64_t currentTick;  // Ticks before this one were all expired.
+    bool started;         // Whether currentTick was lined up on a time.
 
-    std::unordered_map<Key, Entry> map;
-    std::priority_queue<TimeoutEntry> queue;
+    Entry* slots[Levels][SlotsPerLevel];
+    size_t levelSize[Levels];
+    Entry* overdue;
 };
 
 } // namespace RTBKIT
@@ -0,0 +1,214 @@
+/* auction_stages.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Implementation of the auction stage latencies.
+*/
+
+#include "auction_stages.h"
+#include "jml/arch/format.h"
+#include "jml/utils/exc_assert.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* AUCTION STAGES                                                            */
+/*****************************************************************************/
+
+const char *
+AuctionStages::
+stageName(Stage stage)
+{
+    switch (stage) {
+    case PARSE:       return "parse";
+    case PREPROCESS:  return "preprocess";
+    case AUGMENT:     return "augment";
+    case FILTER:      return "filter";
+    case SEND:        return "send";
+    case BIDS:        return "bids";
+    case RESPONSE:    return "response";
+    case TOTAL:       return "total";
+    default:
+        throw ML::Exception("unknown auction stage %d", int(stage));
+    }
+}
+
+size_t
+AuctionStages::Histogram::
+indexOf(uint64_t value)
+{
+    if (value < SubBuckets) return value;
+
+    int shift = 64 - __builtin_clzll(value) - SubBucketBits;
+    size_t index = shift * HalfSubBuckets + (value >> shift);
+    return std::min<size_t>(index, NumBuckets - 1);
+}
+
+uint64_t
+AuctionStages::Histogram::
+highestOf(size_t index)
+{
+    if (index < SubBuckets) return index;
+
+    int shift = (index - HalfSubBuckets) / HalfSubBuckets;
+    uint64_t subBucket = index - shift * HalfSubBuckets;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+AuctionStages::ThreadHistograms::
+ThreadHistograms()
+{
+    for (auto & histogram: stages)
+        for (auto & count: histogram.counts)
+            count = 0;
+}
+
+AuctionStages::
+AuctionStages()
+    : traceThresholdMs(0.0), traceSampling(100)
+{
+}
+
+AuctionStages::
+~AuctionStages()
+{
+}
+
+AuctionStages::ThreadHistograms &
+AuctionStages::
+threadHistograms()
+{
+    ThreadEntry * entry = entries.get();
+    if (JML_UNLIKELY(!entry->histograms)) {
+        auto histograms = std::make_shared<ThreadHistograms>();
+        std::lock_guard<ML::Spinlock> guard(allLock);
+        all.push_back(histograms);
+        entry->histograms = histograms.get();
+    }
+    return *entry->histograms;
+}
+
+void
+AuctionStages::
+record(const Auction & auction, Date done)
+{
+    ThreadHistograms & histograms = threadHistograms();
+
+    forEachStage(auction, done, [&] (Stage stage, Date from, Date to)
+        {
+            double us = std::max(0.0, to.secondsSince(from) * 1000000.0);
+            size_t index = Histogram::indexOf(us);
+            histograms.stages[stage].counts[index]
+                .fetch_add(1, std::memory_order_relaxed);
+        });
+
+    double thresholdMs = traceThresholdMs.load(std::memory_order_relaxed);
+    if (thresholdMs <= 0.0) return;
+
+    double totalMs = done.secondsSince(auction.start) * 1000.0;
+    if (totalMs < thresholdMs
+        || auction.id.hash() % traceSampling != 0)
+        return;
+
+    Json::Value trace;
+    trace["id"] = auction.id.toString();
+    trace["exchange"] = auction.request->exchange;
+    trace["totalMs"] = totalMs;
+
+    auto doTime = [&] (const char * name, Date date)
+        {
+            if (date == Date()) return;
+            trace["ms"][name] = date.secondsSince(auction.start) * 1000.0;
+        };
+
+    doTime("doneParsing", auction.doneParsing);
+    doTime("inPrepro", auction.inPrepro);
+    doTime("outOfPrepro", auction.outOfPrepro);
+    doTime("doneAugmenting", auction.doneAugmenting);
+    doTime("inStartBidding", auction.inStartBidding);
+    doTime("doneFiltering", auction.doneFiltering);
+    doTime("sentToAgents", auction.sentToAgents);
+    doTime("lastBid", auction.lastBid);
+    doTime("expiry", auction.expiry);
+    doTime("done", done);
+
+    std::lock_guard<std::mutex> guard(traceLock);
+    if (traceStream)
+        *traceStream << trace.toStringNoNewLine() << endl;
+}
+
+void
+AuctionStages::
+report(const EventRecorder & recorder)
+{
+    std::vector<std::shared_ptr<ThreadHistograms> > threads;
+    {
+        std::lock_guard<ML::Spinlock> guard(allLock);
+        threads = all;
+    }
+
+    for (unsigned stage = 0; stage < NUM_STAGES; ++stage) {
+        std::vector<uint64_t> counts(Histogram::NumBuckets);
+        uint64_t total = 0;
+
+        for (auto & thread: threads) {
+            auto & histogram = thread->stages[stage];
+            for (size_t i = 0; i < Histogram::NumBuckets; ++i) {
+                uint64_t count = histogram.counts[i].exchange(0);
+                counts[i] += count;
+                total += count;
+            }
+        }
+
+        if (!total) continue;
+
+        auto percentile = [&] (double percent) -> double
+            {
+                uint64_t rank = std::max<uint64_t>(1, std::ceil(total * percent / 100.0));
+                uint64_t seen = 0;
+                for (size_t i = 0; i < Histogram::NumBuckets; ++i) {
+                    seen += counts[i];
+                    if (seen >= rank)
+                        return Histogram::highestOf(i) / 1000.0;
+                }
+                return 0.0;
+            };
+
+        const char * name = stageName(Stage(stage));
+        recorder.recordLevel(percentile(50), "auctionStages.%s.p50Ms", name);
+        recorder.recordLevel(percentile(90), "auctionStages.%s.p90Ms", name);
+        recorder.recordLevel(percentile(99), "auctionStages.%s.p99Ms", name);
+        recorder.recordLevel(percentile(99.9), "auctionStages.%s.p999Ms", name);
+        recorder.recordLevel(percentile(100), "auctionStages.%s.maxMs", name);
+        recorder.recordLevel(total, "auctionStages.%s.count", name);
+    }
+}
+
+void
+AuctionStages::
+traceSlowAuctions(const std::string & filename,
+                  double thresholdMs, int sampling)
+{
+    ExcCheckGreater(sampling, 0, "sampling must be positive");
+
+    std::lock_guard<std::mutex> guard(traceLock);
+
+    traceThresholdMs = 0.0;
+    traceStream.reset();
+
+    if (filename.empty()) return;
+
+    traceStream.reset(new ML::filter_ostream(filename));
+    traceSampling = sampling;
+    traceThresholdMs = thresholdMs;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,150 @@
+/* auction_stages.h                                                -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Latency of each of the stages an auction goes through in the router.
+*/
+
+#pragma once
+
+#include "rtbkit/common/auction.h"
+#include "soa/service/service_base.h"
+#include "jml/arch/spinlock.h"
+#include "jml/arch/thread_specific.h"
+#include "jml/utils/filter_streams.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* AUCTION STAGES                                                            */
+/*****************************************************************************/
+
+/** Keeps a histogram of the time spent in each stage of the auctions, from
+    the timestamps that are set on the Auction as it goes through the
+    exchange connector and the router. Each stage runs from the end of the
+    previous one so that the time spent waiting in the queues between the
+    threads is accounted for in the stage that follows.
+
+    record() is called by the auction shards once the auction was answered.
+    The histograms are kept per thread so recording only takes relaxed
+    atomic increments on memory that no other thread writes to; report()
+    adds them all up, exports them as levels through the EventRecorder and
+    starts over.
+
+    A sample of the auctions that took longer than a threshold can also be
+    written to a file with all their timestamps, one JSON object per line.
+*/
+struct AuctionStages {
+
+    enum Stage {
+        PARSE,           ///< start to doneParsing
+        PREPROCESS,      ///< doneParsing to outOfPrepro
+        AUGMENT,         ///< outOfPrepro to doneAugmenting
+        FILTER,          ///< doneAugmenting to doneFiltering
+        SEND,            ///< doneFiltering to sentToAgents
+        BIDS,            ///< sentToAgents to lastBid
+        RESPONSE,        ///< last bid or sentToAgents to done
+        TOTAL,           ///< start to done
+        NUM_STAGES
+    };
+
+    static const char * stageName(Stage stage);
+
+    AuctionStages();
+    ~AuctionStages();
+
+    /** Records the stages of an auction that is done; stages whose
+        timestamps weren't set are skipped.
+    */
+    void record(const Auction & auction, Date done = Date::nowFast());
+
+    /** Calls onStage(stage, from, to) for each stage of the auction whose
+        timestamps were set.
+    */
+    template<typename OnStage>
+    static void forEachStage(const Auction & auction, Date done,
+                             OnStage && onStage)
+    {
+        auto doStage = [&] (Stage stage, Date from, Date to)
+            {
+                if (from == Date() || to == Date()) return;
+                onStage(stage, from, to);
+            };
+
+        Date sent = auction.sentToAgents;
+        Date lastBid = std::max(auction.lastBid, sent);
+
+        doStage(PARSE, auction.start, auction.doneParsing);
+        doStage(PREPROCESS, auction.doneParsing, auction.outOfPrepro);
+        doStage(AUGMENT, auction.outOfPrepro, auction.doneAugmenting);
+        doStage(FILTER, auction.doneAugmenting, auction.doneFiltering);
+        doStage(SEND, auction.doneFiltering, sent);
+        if (auction.lastBid != Date())
+            doStage(BIDS, sent, auction.lastBid);
+        doStage(RESPONSE, lastBid, done);
+        doStage(TOTAL, auction.start, done);
+    }
+
+    /** Exports the p50, p90, p99, p999 and max of each stage in ms under
+        auctionStages.<stage> and resets the histograms.
+    */
+    void report(const Datacratic::EventRecorder & recorder);
+
+    /** Writes one in every sampling auction that took over thresholdMs to
+        the given file.  An empty filename turns the traces off.
+    */
+    void traceSlowAuctions(const std::string & filename,
+                           double thresholdMs, int sampling = 100);
+
+private:
+
+    /** Log-linear histogram of microseconds with 16 buckets per power of
+        two, so about 6% of error.
+    */
+    struct Histogram {
+        enum {
+            SubBucketBits = 5,
+            SubBuckets = 1 << SubBucketBits,
+            HalfSubBuckets = SubBuckets / 2,
+            NumBuckets = (40 - SubBucketBits) * HalfSubBuckets + SubBuckets
+        };
+
+        static size_t indexOf(uint64_t value);
+        static uint64_t highestOf(size_t index);
+
+        std::atomic<uint64_t> counts[NumBuckets];
+    };
+
+    struct ThreadHistograms {
+        ThreadHistograms();
+        Histogram stages[NUM_STAGES];
+    };
+
+    /** Per thread pointer to the histograms, which are owned by all. */
+    struct ThreadEntry {
+        ThreadEntry() : histograms(nullptr) {}
+        ThreadHistograms * histograms;
+    };
+
+    ThreadHistograms & threadHistograms();
+
+    ML::ThreadSpecificInstanceInfo<ThreadEntry, AuctionStages> entries;
+
+    ML::Spinlock allLock;
+    std::vector<std::shared_ptr<ThreadHistograms> > all;
+
+    std::mutex traceLock;
+    std::unique_ptr<ML::filter_ostream> traceStream;
+    std::atomic<double> traceThresholdMs;
+    int traceSampling;
+};
+
+} // namespace RTBKIT
@@ -13,6 +13,7 @@
 #include "jml/arch/exception_handler.h"
 #include "soa/service/zmq_utils.h"
 #include <iostream>
+#include <algorithm>
 #include <boost/make_shared.hpp>
 #include "rtbkit/core/agent_configuration/agent_config.h"
 
@@ -35,6 +36,7 @@ AugmentationLoop(ServiceBase & parent,
     : ServiceBase(name, parent),
       allAugmentors(0),
       idle_(1),
+      reserveMs(0.0),
       inbox(65536),
       disconnections(1024),
       toAugmentors(getZmqContext())
@@ -48,6 +50,7 @@ AugmentationLoop(std::shared_ptr<ServiceProxies> proxies,
     : ServiceBase(name, proxies),
       allAugmentors(0),
       idle_(1),
+      reserveMs(0.0),
       inbox(65536),
       disconnections(1024),
       toAugmentors(getZmqContext())
@@ -107,6 +110,10 @@ init()
     addPeriodic("AugmentationLoop::checkExpiries", 0.001,
                 [=] (int) { checkExpiries(); });
 
+    if (!cacheConfigs.empty())
+        addPeriodic("AugmentationLoop::expireCache", 1.0,
+                    [=] (int) { expireCache(); });
+
     addPeriodic("AugmentationLoop::recordStats", 0.977,
                 [=] (int) { recordStats(); });
 }
@@ -154,6 +161,87 @@ bindAugmentors(const std::string & uri)
     }
 }
 
+void
+AugmentationLoop::
+setCache(const std::string & augmentor, double ttlSeconds,
+         const std::string & domain)
+{
+    ExcCheckGreater(ttlSeconds, 0.0, "cache ttl must be positive");
+    ExcCheck(!domain.empty(), "no id domain specified for the cache");
+
+    CacheConfig & config = cacheConfigs[augmentor];
+    config.ttl = ttlSeconds;
+    config.domain = domain;
+}
+
+void
+AugmentationLoop::
+setAffinity(const std::string & augmentor, const std::string & domain,
+            double maxLoad)
+{
+    ExcCheck(!domain.empty(), "no id domain specified for the affinity");
+    ExcCheck(maxLoad > 0.0 && maxLoad <= 1.0,
+             "affinity max load must be in (0, 1]");
+
+    AffinityConfig & config = affinityConfigs[augmentor];
+    config.domain = domain;
+    config.maxLoad = maxLoad;
+}
+
+std::string
+AugmentationLoop::
+cacheKey(const std::string & augmentor, const Auction & auction) const
+{
+    auto it = cacheConfigs.find(augmentor);
+    if (it == cacheConfigs.end()) return "";
+
+    const UserIds & userIds = auction.request->userIds;
+    auto jt = userIds.find(it->second.domain);
+    if (jt == userIds.end() || !jt->second) return "";
+
+    return augmentor + ':' + it->second.domain + ':' + jt->second.toString();
+}
+
+bool
+AugmentationLoop::
+augmentFromCache(Entry & entry, const std::string & augmentor, Date now)
+{
+    const Auction & auction = *entry.info->auction;
+
+    string key = cacheKey(augmentor, auction);
+    if (key.empty()) return false;
+
+    auto it = cache.find(key);
+    if (it == cache.end() || it->second.timeout <= now) {
+        recordHit("augmentor.%s.cache.miss", augmentor);
+        return false;
+    }
+
+    const CachedAugmentation & cached = it->second;
+    const set<string> & agents = entry.augmentorAgents[augmentor];
+    if (!std::includes(cached.agents.begin(), cached.agents.end(),
+                       agents.begin(), agents.end()))
+    {
+        recordHit("augmentor.%s.cache.agentsMismatch", augmentor);
+        return false;
+    }
+
+    recordHit("augmentor.%s.cache.hit", augmentor);
+    recordOutcome(now.secondsSince(cached.created) * 1000.0,
+                  "augmentor.%s.cache.ageMs", augmentor);
+
+    entry.info->auction->augmentations[augmentor].mergeWith(cached.augmentation);
+    return true;
+}
+
+void
+AugmentationLoop::
+expireCache()
+{
+    cache.expire();
+    recordLevel(cache.nodes.size(), "augmentation.cacheSize");
+}
+
 void
 AugmentationLoop::
 handleAugmentorMessage(const std::vector<std::string> & message)
@@ -197,13 +285,24 @@ checkExpiries()
     auto onExpired = [&] (const Id & id,
                           const std::shared_ptr<Entry> & entry) -> Date
         {
-            for (auto it = entry->outstanding.begin(),
-                     end = entry->outstanding.end();
-                 it != end; ++it)
+            // Give up on the augmentors that are past their deadline and
+            // keep waiting on the others.
+            for (auto it = entry->outstanding.begin();
+                 it != entry->outstanding.end();)
             {
+                if (entry->deadlines[*it] > now) {
+                    ++it;
+                    continue;
+                }
+
                 recordHit("augmentor.%s.expiredTooLate", *it);
+                this->releaseInstance(*entry, *it);
+                it = entry->outstanding.erase(it);
             }
-                
+
+            if (!entry->outstanding.empty())
+                return entry->nextDeadline();
+
             this->augmentationExpired(id, *entry);
             return Date();
         };
@@ -270,6 +369,9 @@ augment(const std::shared_ptr<AugmentationInfo> & info,
     // Get a set of all augmentors
     std::set<std::string> augmentors;
 
+    // Time that needs to be left for the bidding once each augmentor is done
+    std::map<std::string, double> timeNeededMs;
+
     // Now go through and find all of the bidders
     for (unsigned i = 0;  i < info->potentialGroups.size();  ++i) {
         const GroupPotentialBidders & group = info->potentialGroups[i];
@@ -280,6 +382,9 @@ augment(const std::shared_ptr<AugmentationInfo> & info,
                 const std::string & name = config.augmentations[k].name;
                 augmentors.insert(name);
                 entry->augmentorAgents[name].insert(bidder.agent);
+
+                double & needed = timeNeededMs[name];
+                needed = std::max(needed, double(config.minTimeAvailableMs));
             }
         }
     }
@@ -303,7 +408,11 @@ augment(const std::shared_ptr<AugmentationInfo> & info,
             string eventName = "augmentor." + it2->name + ".request";
             recordEvent(eventName.c_str());
             
-             entry->outstanding.insert(*it1);
+            entry->outstanding.insert(*it1);
+
+            double reserve = std::max(reserveMs, timeNeededMs[*it1]);
+            entry->deadlines[*it1] = std::min(
+                    timeout, info->auction->expiry.plusSeconds(-reserve / 1000.0));
 
             ++it1;
             ++it2;
@@ -343,24 +452,83 @@ augment(const std::shared_ptr<AugmentationInfo> & info,
     }
 }
 
+namespace {
+
+/** Finalizer of splitmix64; spreads the bits of the combined hashes so that
+    the scores of the instances are independent of each other.
+*/
+uint64_t mixHash(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+} // file scope
+
 std::shared_ptr<AugmentorInstanceInfo>
 AugmentationLoop::
-pickInstance(AugmentorInfo& aug)
+pickAffinityInstance(const AugmentorInfo& aug, const Auction & auction)
 {
+    auto it = affinityConfigs.find(aug.name);
+    if (it == affinityConfigs.end()) return nullptr;
+    const AffinityConfig & config = it->second;
+
+    const UserIds & userIds = auction.request->userIds;
+    auto jt = userIds.find(config.domain);
+    if (jt == userIds.end() || !jt->second) {
+        recordHit("augmentor.%s.affinity.noUserId", aug.name);
+        return nullptr;
+    }
+
+    // Rendezvous hashing: the user goes to the instance with the highest
+    // score, so only the users of an instance that comes or goes move.
+    uint64_t userHash = jt->second.hash();
     std::shared_ptr<AugmentorInstanceInfo> instance;
-    int minInFlights = std::numeric_limits<int>::max();
+    uint64_t maxScore = 0;
 
-    stringstream ss;
+    for (const auto & ptr: aug.instances) {
+        uint64_t score = mixHash(userHash ^ std::hash<string>()(ptr->addr));
+        if (!instance || score > maxScore) {
+            instance = ptr;
+            maxScore = score;
+        }
+    }
 
-    for (auto it = aug.instances.begin(), end = aug.instances.end();
-         it != end; ++it)
-    {
-        auto & ptr = *it;
-        if (ptr->numInFlight >= minInFlights) continue;
-        if (ptr->numInFlight >= ptr->maxInFlight) continue;
+    if (!instance) return nullptr;
 
-        instance = ptr;
-        minInFlights = ptr->numInFlight;
+    if (instance->numInFlight >= config.maxLoad * instance->maxInFlight) {
+        recordHit("augmentor.%s.affinity.overloaded", aug.name);
+        return nullptr;
+    }
+
+    recordHit("augmentor.%s.affinity.routed", aug.name);
+    return instance;
+}
+
+std::shared_ptr<AugmentorInstanceInfo>
+AugmentationLoop::
+pickInstance(AugmentorInfo& aug, const Auction & auction)
+{
+    std::shared_ptr<AugmentorInstanceInfo> instance
+        = pickAffinityInstance(aug, auction);
+
+    if (!instance) {
+        int minInFlights = std::numeric_limits<int>::max();
+
+        for (auto it = aug.instances.begin(), end = aug.instances.end();
+             it != end; ++it)
+        {
+            auto & ptr = *it;
+            if (ptr->numInFlight >= minInFlights) continue;
+            if (ptr->numInFlight >= ptr->maxInFlight) continue;
+
+            instance = ptr;
+            minInFlights = ptr->numInFlight;
+        }
     }
 
     if (instance) instance->numInFlight++;
@@ -383,14 +551,47 @@ doAugmentation(std::shared_ptr<Entry>&& entry)
         return;
     }
 
-    bool sentToAugmentor = false;
+    // Augmentors that we didn't send the request to aren't waited on.
+    std::set<std::string> sent;
+
+    // The request frames are shared by all the augmentors and point
+    // straight into the auction, which serializes the binary one only once.
+    const auto & auction = entry->info->auction;
+    zmq::message_t request, binaryRequest;
+    bool hasRequest = false, hasBinaryRequest = false;
+
+    auto getRequest = [&] (bool binary) -> const zmq::message_t & {
+        if (binary) {
+            if (!hasBinaryRequest) {
+                binaryRequest = sharedMessage(std::shared_ptr<const std::string>(
+                                auction, &auction->serializedRequest()));
+                hasBinaryRequest = true;
+            }
+            return binaryRequest;
+        }
+
+        if (!hasRequest) {
+            request = sharedMessage(std::shared_ptr<const std::string>(
+                            auction, &auction->requestStr));
+            hasRequest = true;
+        }
+        return request;
+    };
 
     for (auto it = entry->outstanding.begin(), end = entry->outstanding.end();
          it != end;  ++it)
     {
+        if (entry->deadlines[*it] <= now) {
+            recordHit("augmentor.%s.skippedNoTime", *it);
+            continue;
+        }
+
+        if (augmentFromCache(*entry, *it, now))
+            continue;
+
         auto & aug = *augmentors[*it];
 
-        auto instance = pickInstance(aug);
+        auto instance = pickInstance(aug, *auction);
         if (!instance) {
             recordHit("augmentor.%s.skippedTooManyInFlight", *it);
             continue;
@@ -406,20 +607,25 @@ doAugmentation(std::shared_ptr<Entry>&& entry)
         writer.save(agents);
 
         // Send the message to the augmentor
+        bool binary = instance->binary;
         toAugmentors.sendMessage(
                 instance->addr,
-                "AUGMENT", "1.0", *it,
-                entry->info->auction->id.toString(),
-                entry->info->auction->requestStrFormat,
-                entry->info->auction->requestStr,
+                "AUGMENT", binary ? "1.1" : "1.0", *it,
+                auction->id.toString(),
+                binary ? BidRequest::BinaryFormat : auction->requestStrFormat,
+                getRequest(binary),
                 availableAgentsStr.str(),
                 Date::now());
 
-        sentToAugmentor = true;
+        sent.insert(*it);
     }
 
-    if (sentToAugmentor)
-        augmenting.insert(entry->info->auction->id, std::move(entry), entry->timeout);
+    entry->outstanding.swap(sent);
+
+    if (!entry->outstanding.empty()) {
+        Date deadline = entry->nextDeadline();
+        augmenting.insert(entry->info->auction->id, std::move(entry), deadline);
+    }
     else entry->onFinished(entry->info);
 
     recordLevel(Date::now().secondsSince(now), "requestTimeMs");
@@ -443,7 +649,8 @@ doConfig(const std::vector<std::string> & message)
         maxInFlight = std::stoi(message[4]);
     if (maxInFlight < 0) maxInFlight = 3000;
 
-    ExcCheckEqual(version, "1.0", "unknown version for config message");
+    ExcCheck(version == "1.0" || version == "1.1",
+             "unknown version for config message");
     ExcCheck(!name.empty(), "no augmentor name specified");
 
     //cerr << "configuring augmentor " << name << " on " << connectTo
@@ -457,7 +664,8 @@ doConfig(const std::vector<std::string> & message)
         recordHit("augmentor.%s.configured", name);
     }
 
-    info->instances.push_back(std::make_shared<AugmentorInstanceInfo>(addr, maxInFlight));
+    info->instances.push_back(std::make_shared<AugmentorInstanceInfo>(
+                    addr, maxInFlight, version == "1.1"));
     recordHit("augmentor.%s.instances.%s.configured", name, addr);
 
 
@@ -521,7 +729,8 @@ doResponse(const std::vector<std::string> & message)
     ExcCheckEqual(message.size(), 7, "response message has wrong size");
 
     const string & version = message[2];
-    ExcCheckEqual(version, "1.0", "unknown response version");
+    ExcCheck(version == "1.0" || version == "1.1", "unknown response version");
+    bool binary = version == "1.1";
 
     const std::string & addr = message[0];
     Date startTime = Date::parseSecondsSinceEpoch(message[3]);
@@ -531,18 +740,24 @@ doResponse(const std::vector<std::string> & message)
 
     ML::Timer timer;
 
+    bool isNull = augmentation == "" || (!binary && augmentation == "null");
+
     AugmentationList augmentationList;
-    if (augmentation != "" && augmentation != "null") {
+    bool parsed = true;
+    if (!isNull) {
         try {
-            Json::Value augmentationJson;
-
             JML_TRACE_EXCEPTIONS(false);
-            augmentationJson = Json::parse(augmentation);
-            augmentationList = AugmentationList::fromJson(augmentationJson);
+            if (binary)
+                augmentationList = AugmentationList::createFromString(augmentation);
+            else {
+                Json::Value augmentationJson = Json::parse(augmentation);
+                augmentationList = AugmentationList::fromJson(augmentationJson);
+            }
         } catch (const std::exception & exc) {
             string eventName = "augmentor." + augmentor
                 + ".responseParsingExceptions";
             recordEvent(eventName.c_str(), ET_COUNT);
+            parsed = false;
         }
     }
 
@@ -560,12 +775,8 @@ doResponse(const std::vector<std::string> & message)
         recordEvent(eventName.c_str(), ET_OUTCOME, responseLength);
     }
 
-    auto augmentorIt = augmentors.find(augmentor);
-    if (augmentorIt != augmentors.end()) {
-        auto instance = augmentorIt->second->findInstance(addr);
-        if (instance) instance->numInFlight--;
-    }
-
+    // The in flight slot of a late response was already given back when its
+    // auction expired.
     auto augmentingIt = augmenting.find(id);
     if (augmentingIt == augmenting.end()) {
         recordHit("augmentation.unknown");
@@ -575,16 +786,29 @@ doResponse(const std::vector<std::string> & message)
     }
 
     auto& entry = *augmentingIt;
+    releaseInstance(*entry.second, augmentor);
 
-    const char* eventType =
-        (augmentation == "" || augmentation == "null") ?
-        "nullResponse" : "validResponse";
+    const char* eventType = isNull ? "nullResponse" : "validResponse";
     recordHit("augmentor.%s.%s", augmentor, eventType);
     recordHit("augmentor.%s.instances.%s.%s", augmentor, addr, eventType);
 
     auto& auctionAugs = entry.second->info->auction->augmentations;
     auctionAugs[augmentor].mergeWith(augmentationList);
 
+    string key = cacheKey(augmentor, *entry.second->info->auction);
+    if (parsed && !key.empty()) {
+        Date now = Date::now();
+
+        CachedAugmentation cached;
+        cached.augmentation = std::move(augmentationList);
+        cached.agents = entry.second->augmentorAgents[augmentor];
+        cached.created = now;
+
+        cache.erase(key);
+        cache.insert(key, std::move(cached),
+                     now.plusSeconds(cacheConfigs[augmentor].ttl));
+    }
+
     entry.second->outstanding.erase(augmentor);
     if (entry.second->outstanding.empty()) {
         entry.second->onFinished(entry.second->info);
@@ -594,16 +818,40 @@ doResponse(const std::vector<std::string> & message)
 
 void
 AugmentationLoop::
-augmentationExpired(const Id & id, const Entry & entry)
+augmentationExpired(const Id & id, Entry & entry)
 {
-    for (const auto & instance: entry.instances) {
-        // If the instance still exsits (it is still alive), we decrement
-        // the inFlight count
-        auto info = instance.second.lock();
-        if (info) info->numInFlight--;
-    }
+    while (!entry.instances.empty())
+        releaseInstance(entry, entry.instances.begin()->first);
 
     entry.onFinished(entry.info);
-}                     
+}
+
+void
+AugmentationLoop::
+releaseInstance(Entry & entry, const std::string & augmentor)
+{
+    auto it = entry.instances.find(augmentor);
+    if (it == entry.instances.end()) return;
+
+    // If the instance still exsits (it is still alive), we decrement
+    // the inFlight count
+    auto info = it->second.lock();
+    if (info) info->numInFlight--;
+
+    entry.instances.erase(it);
+}
+
+Date
+AugmentationLoop::Entry::
+nextDeadline() const
+{
+    Date result = timeout;
+    for (const auto & augmentor: outstanding) {
+        auto it = deadlines.find(augmentor);
+        if (it != deadlines.end())
+            result = std::min(result, it->second);
+    }
+    return result;
+}
 
 } // namespace RTBKIT
@@ -33,13 +33,15 @@ namespace RTBKIT {
 /** Information about a specific augmentor which belongs to an augmentor class.
  */
 struct AugmentorInstanceInfo {
-    AugmentorInstanceInfo(const std::string& addr = "", int maxInFlight = 0) :
-        addr(addr), numInFlight(0), maxInFlight(maxInFlight)
+    AugmentorInstanceInfo(const std::string& addr = "", int maxInFlight = 0,
+                          bool binary = false) :
+        addr(addr), numInFlight(0), maxInFlight(maxInFlight), binary(binary)
     {}
 
     std::string addr;
     int numInFlight;
     int maxInFlight;
+    bool binary;    ///< Speaks version 1.1: binary requests and responses
 };
 
 /** Information about a given class of augmentor. */
@@ -103,11 +105,44 @@ struct AugmentationLoop : public ServiceBase, public MessageLoop {
 
     void bindAugmentors(const std::string & uri);
 
-    /** Push an auction into the augmentor.  Can be called from any thread. */
+    /** Push an auction into the augmentor.  Can be called from any thread.
+
+        Each augmentor is waited on until the earliest of the timeout and the
+        time at which the agents it augments for would no longer have enough
+        time left to bid (their minTimeAvailableMs or the reserve, whichever
+        is larger).  Once every augmentor has answered or reached its
+        deadline the auction goes on with whatever augmentations arrived.
+    */
     void augment(const std::shared_ptr<AugmentationInfo> & info,
                  Date timeout,
                  const OnFinished & onFinished);
 
+    /** Time in milliseconds kept at the end of every auction for the
+        bidding; the augmentors are never waited on past that point.
+        Must be called before start().
+    */
+    void setDeadlineReserve(double reserveMs) { this->reserveMs = reserveMs; }
+
+    /** Keeps the responses of the given augmentor for ttlSeconds, keyed by
+        the id of the user in the given domain (eg "prov" or "xchg"), and
+        answers the later requests for that user locally.  A cached response
+        is only used if it was made for all the agents that the request is
+        now for.  Must be called before start().
+    */
+    void setCache(const std::string & augmentor, double ttlSeconds,
+                  const std::string & domain = "prov");
+
+    /** Sends the requests for the given augmentor to the instance picked by
+        hashing the id of the user in the given domain, so that each instance
+        keeps seeing the same users and its per user state stays warm.  The
+        request goes to the least loaded instance instead if the user has no
+        id in the domain or if its instance already has more than maxLoad of
+        its maxInFlight requests in flight.  Must be called before start().
+    */
+    void setAffinity(const std::string & augmentor,
+                     const std::string & domain = "prov",
+                     double maxLoad = 0.8);
+
 private:
 
     struct Entry {
@@ -122,8 +157,13 @@ private:
         // possibly keeping a dangling pointer
         std::map<std::string, std::weak_ptr<AugmentorInstanceInfo>> instances;
         std::map<std::string, std::set<std::string> > augmentorAgents;
+        /// When we stop waiting on each of the augmentors.
+        std::map<std::string, Date> deadlines;
         OnFinished onFinished;
         Date timeout;
+
+        /** Earliest deadline of the augmentors still outstanding. */
+        Date nextDeadline() const;
     };
 
     /** List of auctions we're currently augmenting.  Once the augmentation
@@ -132,6 +172,36 @@ private:
     typedef TimeoutMap<Id, std::shared_ptr<Entry> > Augmenting;
     Augmenting augmenting;
 
+    struct CacheConfig {
+        double ttl;
+        std::string domain;
+    };
+
+    /** Augmentors whose responses are cached.  Indexed by the augmentor
+        name.
+    */
+    std::map<std::string, CacheConfig> cacheConfigs;
+
+    struct CachedAugmentation {
+        AugmentationList augmentation;
+        std::set<std::string> agents;   ///< Agents it was made for
+        Date created;
+    };
+
+    /** Cached responses, keyed by augmentor, id domain and user id. */
+    typedef TimeoutMap<std::string, CachedAugmentation> Cache;
+    Cache cache;
+
+    struct AffinityConfig {
+        std::string domain;
+        double maxLoad;
+    };
+
+    /** Augmentors whose requests are routed by user id.  Indexed by the
+        augmentor name.
+    */
+    std::map<std::string, AffinityConfig> affinityConfigs;
+
     /** Currently configured augmentors.  Indexed by the augmentor name. */
     std::map<std::string, std::shared_ptr<AugmentorInfo> > augmentors;
 
@@ -154,6 +224,8 @@ private:
 
     int idle_;
 
+    double reserveMs;
+
     /// We pick up augmentations to be done from here
     TypedMessageSink<std::shared_ptr<Entry> > inbox;
     TypedMessageSink<std::string> disconnections;
@@ -167,13 +239,38 @@ private:
 
     void handleAugmentorMessage(const std::vector<std::string> & message);
 
-    std::shared_ptr<AugmentorInstanceInfo> pickInstance(AugmentorInfo& aug);
+    /** Picks the instance of the augmentor that the auction is sent to and
+        takes an in flight slot on it.  Returns null if they're all full.
+    */
+    std::shared_ptr<AugmentorInstanceInfo>
+    pickInstance(AugmentorInfo& aug, const Auction & auction);
+
+    /** Instance that the user of the auction is routed to if the augmentor
+        has an affinity and the instance isn't overloaded, otherwise null.
+    */
+    std::shared_ptr<AugmentorInstanceInfo>
+    pickAffinityInstance(const AugmentorInfo& aug, const Auction & auction);
     void doAugmentation(std::shared_ptr<Entry>&& entry);
 
     void recordStats();
 
     void checkExpiries();
 
+    /** Returns the key of the auction in the cache of the augmentor or an
+        empty string if the augmentor isn't cached or the user has no id in
+        its domain.
+    */
+    std::string cacheKey(const std::string & augmentor,
+                         const Auction & auction) const;
+
+    /** Merges the cached response of the augmentor into the auction of the
+        entry if there is a fresh one.  Returns whether it was found.
+    */
+    bool augmentFromCache(Entry & entry, const std::string & augmentor,
+                          Date now);
+
+    void expireCache();
+
     /** Handle a configuration message from an augmentor. */
     void doConfig(const std::vector<std::string> & message);
 
@@ -186,7 +283,12 @@ private:
     /** Handle a message asking for augmentation. */
     void doAugment(const std::vector<std::string> & message);
 
-    void augmentationExpired(const Id & id, const Entry & entry);
+    void augmentationExpired(const Id & id, Entry & entry);
+
+    /** Gives back the in flight slot taken on the instance of the augmentor
+        for the entry, if it still holds one.
+    */
+    void releaseInstance(Entry & entry, const std::string & augmentor);
 };
 
 } // namespace RTBKIT
@@ -7,13 +7,20 @@
 */
 
 #include "filter_pool.h"
+#include "filters/priority.h"
 #include "rtbkit/common/bid_request.h"
 #include "rtbkit/common/exchange_connector.h"
+#include "rtbkit/common/mem_usage.h"
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "soa/service/service_base.h"
 #include "jml/utils/exc_check.h"
+#include "jml/utils/hash_specializations.h"
 #include "jml/arch/tick_counter.h"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
 
 using namespace std;
 using namespace ML;
@@ -27,7 +34,7 @@ namespace RTBKIT {
 /******************************************************************************/
 
 FilterPool::
-FilterPool() : data(new Data()), events(nullptr) {}
+FilterPool() : data(new Data()), cacheSize_(0), events(nullptr) {}
 
 
 void
@@ -35,6 +42,9 @@ FilterPool::
 init(EventRecorder* events)
 {
     this->events = events;
+
+    // Swapping the data mustn't leave the filtering threads to delete it
+    gc.reclaimInBackground();
 }
 
 
@@ -114,6 +124,69 @@ recordTime(uint64_t start, const FilterBase* filter)
 }
 
 
+const std::vector<unsigned>*
+FilterPool::
+filterOrder(const Data* data, const ExchangeConnector* conn)
+{
+    if (data->orders.empty()) return nullptr;
+
+    auto it = data->orders.find(conn ? conn->exchangeName() : "");
+    return it != data->orders.end() ? &it->second : nullptr;
+}
+
+uint64_t
+FilterPool::
+requestStaticKey(const Data* data, const FilterState& state)
+{
+    uint64_t key = 0;
+    for (unsigned i : data->requestStatic)
+        key = chain_hash(key, data->filters[i]->hashRequest(state));
+    return key;
+}
+
+void
+FilterPool::
+recordSamples(
+        const ExchangeConnector* conn, const std::vector<FilterSample>& samples)
+{
+    string exchange = conn ? conn->exchangeName() : "";
+
+    std::lock_guard<ML::Spinlock> guard(statsLock);
+    ExchangeStats& exchangeStats = stats[exchange];
+    ExchangeStats& exchangeTimes = times[exchange];
+
+    for (const FilterSample& sample : samples) {
+        FilterStats& entry = exchangeStats[sample.filter->name()];
+        entry.samples += sample.requests;
+        entry.ticks += sample.ticks;
+        entry.in += sample.in;
+        entry.out += sample.out;
+
+        FilterStats& time = exchangeTimes[sample.filter->name()];
+        time.samples += sample.requests;
+        time.ticks += sample.ticks;
+    }
+}
+
+FilterPool::ConfigList
+FilterPool::
+makeConfigList(const Data* data, FilterState& state)
+{
+    auto biddableSpots = state.biddableSpots();
+    const ConfigSet& configs = state.configs();
+
+    ConfigList result;
+    for (size_t i = configs.next(); i < configs.size(); i = configs.next(i + 1)) {
+        ConfigEntry entry = data->configs[i];
+        entry.biddableSpots = std::move(biddableSpots[i]);
+        entry.configIndex = i;
+        result.emplace_back(std::move(entry));
+    }
+
+    return result;
+}
+
+
 FilterPool::ConfigList
 FilterPool::
 filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mask)
@@ -124,48 +197,235 @@ filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mas
     ExcCheck(!current->filters.empty(), "No filters registered");
 
     FilterState state(br, conn, current->activeConfigs);
-    state.narrowConfigs(mask);
-
     ConfigSet configs = state.configs();
 
+    const std::vector<unsigned>* order = filterOrder(current, conn);
+
     bool sampleStats = events && (random() % 10 == 0);
     uint64_t ticksStart = sampleStats ? ticks() : 0;
 
-    for (FilterBase* filter : current->filters) {
+    std::vector<FilterSample> samples;
+    if (sampleStats) samples.reserve(current->filters.size());
+
+    // Returns false once every config has been filtered out.
+    auto runFilter = [&] (const FilterBase* filter) {
         filter->filter(state);
 
         const ConfigSet& filtered = state.configs();
 
         if (sampleStats) {
-            ticksStart = recordTime(ticksStart, filter);
+            uint64_t ticksEnd = recordTime(ticksStart, filter);
+            samples.push_back({
+                        filter, 1, ticksEnd - ticksStart,
+                        configs.count(), filtered.count() });
+            ticksStart = ticksEnd;
+
             recordDiff(current, filter, configs ^ filtered);
             if (!state.getFilterReasons().empty()) {
                 recordReason(current, filter, state);
             }
             configs = filtered;
+
+            // Keep the cost of the events out of the next filter's time.
+            ticksStart = ticks();
         }
         state.resetFilterReasons();
 
         if (filtered.empty()) {
             if (sampleStats) 
                 events->recordHit("filters.breakLoop.%s", filter->name());
-            break;
+            return false;
+        }
+        return true;
+    };
+
+    // The result of the request static filters doesn't depend on the mask so
+    // it's cached before the mask is applied.
+    bool useCache = current->cache && !current->requestStatic.empty();
+    if (useCache) {
+        uint64_t key = requestStaticKey(current, state);
+
+        ConfigSet cached;
+        if (current->cache->get(key, cached)) {
+            state.narrowConfigs(cached);
+            if (sampleStats) events->recordHit("filters.cache.hit");
         }
+        else {
+            for (unsigned i : current->requestStatic) {
+                if (!runFilter(current->filters[i].get())) break;
+            }
+            current->cache->put(key, state.configs());
+            if (sampleStats) events->recordHit("filters.cache.miss");
+        }
+
+        if (sampleStats) ticksStart = ticks();
     }
 
-    auto biddableSpots = state.biddableSpots();
+    state.narrowConfigs(mask);
     configs = state.configs();
 
-    ConfigList result;
-    for (size_t i = configs.next(); i < configs.size(); i = configs.next(i + 1)) {
-        ConfigEntry entry = current->configs[i];
-        entry.biddableSpots = std::move(biddableSpots[i]);
-        result.emplace_back(std::move(entry));
+    bool done = useCache && configs.empty();
+
+    for (size_t i = 0; !done && i < current->filters.size(); ++i) {
+        const FilterBase* filter =
+            current->filters[order ? (*order)[i] : i].get();
+
+        if (useCache && filter->isRequestStatic()) continue;
+        done = !runFilter(filter);
     }
 
+    if (sampleStats) recordSamples(conn, samples);
+
+    return makeConfigList(current, state);
+}
+
+
+std::vector<FilterPool::ConfigList>
+FilterPool::
+filterBatch(
+        const std::vector<const BidRequest*>& requests,
+        const ExchangeConnector* conn,
+        const ConfigSet& mask)
+{
+    GcLockBase::SharedGuard guard(gc, GcLockBase::RD_NO);
+
+    const Data* current = data.load();
+    ExcCheck(!current->filters.empty(), "No filters registered");
+
+    std::vector<FilterState> states;
+    states.reserve(requests.size());
+    for (const BidRequest* br : requests)
+        states.emplace_back(*br, conn, current->activeConfigs);
+
+    const std::vector<unsigned>* order = filterOrder(current, conn);
+
+    bool sampleStats = events && (random() % 10 == 0);
+
+    std::vector<FilterSample> samples;
+    if (sampleStats) samples.reserve(current->filters.size());
+
+    // Runs the filter over the states that still have configs and drops the
+    // ones that have none left from live.
+    auto runFilter = [&] (const FilterBase* filter, std::vector<FilterState*>& live) {
+        if (live.empty()) return;
+
+        std::vector<ConfigSet> before;
+        uint64_t ticksStart = 0;
+        if (sampleStats) {
+            before.reserve(live.size());
+            for (const FilterState* state : live)
+                before.push_back(state->configs());
+            ticksStart = ticks();
+        }
+
+        filter->filterBatch(live);
+
+        if (sampleStats) {
+            uint64_t elapsed = ticks() - ticksStart;
+            double us = (elapsed / ticks_per_second) * 1000000.0;
+            events->recordLevel(us / live.size(),
+                    "filters.timingUs.%s", filter->name());
+
+            FilterSample sample = { filter, live.size(), elapsed, 0, 0 };
+            for (size_t i = 0; i < live.size(); ++i) {
+                const ConfigSet& filtered = live[i]->configs();
+                sample.in += before[i].count();
+                sample.out += filtered.count();
+
+                recordDiff(current, filter, before[i] ^ filtered);
+                if (!live[i]->getFilterReasons().empty())
+                    recordReason(current, filter, *live[i]);
+            }
+            samples.push_back(sample);
+        }
+
+        size_t kept = 0;
+        for (FilterState* state : live) {
+            state->resetFilterReasons();
+
+            if (!state->configs().empty()) live[kept++] = state;
+            else if (sampleStats)
+                events->recordHit("filters.breakLoop.%s", filter->name());
+        }
+        live.resize(kept);
+    };
+
+    // Same caching as filter(): only the misses go through the request static
+    // filters, all at once.
+    bool useCache = current->cache && !current->requestStatic.empty();
+    if (useCache) {
+        std::vector<FilterState*> misses;
+        std::vector<uint64_t> keys;
+
+        for (FilterState& state : states) {
+            uint64_t key = requestStaticKey(current, state);
+
+            ConfigSet cached;
+            if (current->cache->get(key, cached)) {
+                state.narrowConfigs(cached);
+                if (sampleStats) events->recordHit("filters.cache.hit");
+            }
+            else {
+                misses.push_back(&state);
+                keys.push_back(key);
+                if (sampleStats) events->recordHit("filters.cache.miss");
+            }
+        }
+
+        std::vector<FilterState*> live = misses;
+        for (unsigned i : current->requestStatic)
+            runFilter(current->filters[i].get(), live);
+
+        for (size_t i = 0; i < misses.size(); ++i)
+            current->cache->put(keys[i], misses[i]->configs());
+    }
+
+    std::vector<FilterState*> live;
+    live.reserve(states.size());
+    for (FilterState& state : states) {
+        state.narrowConfigs(mask);
+        if (!state.configs().empty()) live.push_back(&state);
+    }
+
+    for (size_t i = 0; !live.empty() && i < current->filters.size(); ++i) {
+        const FilterBase* filter =
+            current->filters[order ? (*order)[i] : i].get();
+
+        if (useCache && filter->isRequestStatic()) continue;
+        runFilter(filter, live);
+    }
+
+    if (sampleStats) recordSamples(conn, samples);
+
+    std::vector<ConfigList> result;
+    result.reserve(states.size());
+    for (FilterState& state : states)
+        result.push_back(makeConfigList(current, state));
+
     return result;
 }
 
+bool
+FilterPool::
+preParseMatches(const BidRequest& br, const ExchangeConnector* conn)
+{
+    GcLockBase::SharedGuard guard(gc, GcLockBase::RD_NO);
+
+    const Data* current = data.load();
+
+    FilterState state(br, conn, current->activeConfigs);
+    if (state.configs().empty()) return false;
+
+    for (const auto& filter : current->filters) {
+        if (!filter->isPreParse()) continue;
+
+        filter->filter(state);
+        if (state.configs().empty()) return false;
+    }
+
+    return true;
+}
+
 
 void
 FilterPool::
@@ -179,6 +439,7 @@ addFilter(const string& name)
     do {
         newData.reset(new Data(*oldData));
         newData->addFilter(PluginInterface<FilterBase>::getPlugin(name)());
+        newData->cache = makeCache();
     } while (!setData(oldData, newData));
 
     if (events) events->recordHit("filters.addFilter.%s", name);
@@ -197,6 +458,7 @@ removeFilter(const string& name)
     do {
         newData.reset(new Data(*oldData));
         newData->removeFilter(name);
+        newData->cache = makeCache();
     } while (!setData(oldData, newData));
 
     if (events) events->recordHit("filters.removeFilter.%s", name);
@@ -217,6 +479,7 @@ initWithDefaultFilters()
             newData->addFilter(PluginInterface<FilterBase>::getPlugin(ele)());
             if (events) events->recordHit("filters.addFilter.%s", ele);
         }
+        newData->cache = makeCache();
 
     } while (!setData(oldData, newData));
 
@@ -243,6 +506,7 @@ initWithFiltersFromJson(const Json::Value & json)
             newData->addFilter(PluginInterface<FilterBase>::getPlugin(val.asString())());
             if (events) events->recordHit("filters.addFilter.%s", val.asString());
         }
+        newData->cache = makeCache();
     } while (!setData(oldData, newData));
 }
 
@@ -260,6 +524,7 @@ addConfig(const string& name, const AgentInfo& info)
     do {
         newData.reset(new Data(*oldData));
         index = newData->addConfig(name, info);
+        newData->cache = makeCache();
     } while (!setData(oldData, newData));
 
     if (events) events->recordHit("filters.addConfig");
@@ -280,11 +545,42 @@ removeConfig(const string& name)
     do {
         newData.reset(new Data(*oldData));
         newData->removeConfig(name);
+        newData->cache = makeCache();
     } while (!setData(oldData, newData));
 
     if (events) events->recordHit("filters.removeConfig");
 }
 
+std::vector<unsigned>
+FilterPool::
+updateConfigs(const ConfigUpdates& updates)
+{
+    std::vector<unsigned> indexes(updates.size(), -1);
+    if (updates.empty()) return indexes;
+
+    GcLockBase::SharedGuard guard(gc);
+
+    unique_ptr<Data> newData;
+    Data* oldData = data.load();
+
+    do {
+        newData.reset(new Data(*oldData));
+
+        for (size_t i = 0; i < updates.size(); ++i) {
+            const auto& update = updates[i];
+            if (update.second)
+                indexes[i] = newData->addConfig(update.first, *update.second);
+            else newData->removeConfig(update.first);
+        }
+
+        newData->cache = makeCache();
+    } while (!setData(oldData, newData));
+
+    if (events) events->recordHit("filters.updateConfigs");
+
+    return indexes;
+}
+
 std::vector<string>
 FilterPool::
 getFilterNames() const
@@ -295,7 +591,7 @@ getFilterNames() const
     std::vector<string> filter_names;
     filter_names.reserve(current->filters.size());
 
-    for (FilterBase* filter : current->filters) {
+    for (const auto& filter : current->filters) {
         filter_names.push_back(filter->name());
     }
 
@@ -303,25 +599,307 @@ getFilterNames() const
 }
 
 
+std::shared_ptr<FilterPool::Cache>
+FilterPool::
+makeCache() const
+{
+    size_t size = cacheSize_;
+    return size ? std::make_shared<Cache>(size, cacheArena) : nullptr;
+}
+
+void
+FilterPool::
+useHugePages(ML::Huge_Page_Mode mode)
+{
+    cacheArena = ML::huge_page_arena(mode);
+    setCacheSize(cacheSize_);
+}
+
+void
+FilterPool::
+setCacheSize(size_t size)
+{
+    cacheSize_ = size;
+
+    GcLockBase::SharedGuard guard(gc);
+
+    Data* oldData = data.load();
+    unique_ptr<Data> newData;
+
+    do {
+        newData.reset(new Data(*oldData, Data::ShareFilters()));
+        newData->cache = makeCache();
+    } while (!setData(oldData, newData));
+}
+
+
+double
+FilterPool::FilterStats::
+rank() const
+{
+    enum { MinSamples = 100 };
+
+    // Not enough data so keep it after the filters we know about.
+    if (samples < MinSamples || !in)
+        return std::numeric_limits<double>::infinity();
+
+    // Classic ordering of independent predicates: cost per eliminated config.
+    double cost = double(ticks) / samples;
+    double eliminated = 1.0 - double(out) / in;
+    return cost / std::max(eliminated, 1e-6);
+}
+
+void
+FilterPool::
+reorderFilters()
+{
+    std::unordered_map<string, ExchangeStats> snapshot;
+    {
+        std::lock_guard<ML::Spinlock> guard(statsLock);
+        snapshot = stats;
+
+        // Decay the stats so that the order can adapt to changes in the
+        // traffic. This also compensates the fact that the selectivity of a
+        // filter depends on which filters ran before it.
+        for (auto& exchange : stats) {
+            for (auto& entry : exchange.second) {
+                FilterStats& filter = entry.second;
+                filter.samples /= 2;
+                filter.ticks /= 2;
+                filter.in /= 2;
+                filter.out /= 2;
+            }
+        }
+    }
+
+    GcLockBase::SharedGuard guard(gc);
+
+    Data* oldData = data.load();
+    unique_ptr<Data> newData;
+
+    do {
+        newData.reset(new Data(*oldData, Data::ShareFilters()));
+        newData->orders.clear();
+
+        const auto& filters = newData->filters;
+
+        for (const auto& exchange : snapshot) {
+            std::vector<unsigned> order(filters.size());
+            std::iota(order.begin(), order.end(), 0);
+
+            auto rank = [&] (unsigned i) {
+                auto it = exchange.second.find(filters[i]->name());
+                if (it == exchange.second.end())
+                    return std::numeric_limits<double>::infinity();
+                return it->second.rank();
+            };
+
+            // filters are sorted by priority so the pinned filters are at the
+            // end of the list.
+            auto pinned = std::find_if(order.begin(), order.end(),
+                    [&] (unsigned i) {
+                        return filters[i]->priority() >= Priority::ExchangePre;
+                    });
+
+            std::stable_sort(order.begin(), pinned,
+                    [&] (unsigned lhs, unsigned rhs) {
+                        return rank(lhs) < rank(rhs);
+                    });
+
+            if (!std::is_sorted(order.begin(), order.end()))
+                newData->orders[exchange.first] = std::move(order);
+        }
+
+    } while (!setData(oldData, newData));
+
+    if (events) events->recordHit("filters.reorder");
+}
+
+void
+FilterPool::
+reportFilterTimes()
+{
+    if (!events) return;
+
+    events->recordLevel(gc.numDeferred(), "filters.gc.deferred");
+    events->recordLevel(gc.numDeferOverflows(), "filters.gc.deferOverflows");
+
+    {
+        GcLockBase::SharedGuard guard(gc);
+        const Data* current = data.load();
+        events->recordLevel(current->memUsage(), "filters.memory.dataBytes");
+        events->recordLevel(current->filters.size(), "filters.memory.numFilters");
+    }
+
+    std::unordered_map<string, ExchangeStats> snapshot;
+    {
+        std::lock_guard<ML::Spinlock> guard(statsLock);
+        snapshot.swap(times);
+    }
+
+    for (const auto& exchange : snapshot) {
+        string name = exchange.first.empty() ? "none" : exchange.first;
+
+        uint64_t total = 0;
+        for (const auto& entry : exchange.second)
+            total += entry.second.ticks;
+        if (!total) continue;
+
+        for (const auto& entry : exchange.second) {
+            const FilterStats& time = entry.second;
+            if (!time.samples) continue;
+
+            double us = (time.ticks / ticks_per_second) * 1000000.0;
+
+            events->recordLevel(us / time.samples,
+                    "filters.cpu.%s.%s.usPerCall", name, entry.first);
+            events->recordLevel(100.0 * time.ticks / total,
+                    "filters.cpu.%s.%s.percent", name, entry.first);
+            events->recordLevel(time.samples,
+                    "filters.cpu.%s.%s.sampledCalls", name, entry.first);
+        }
+    }
+}
+
+Json::Value
+FilterPool::
+orderToJson() const
+{
+    std::unordered_map<string, ExchangeStats> snapshot;
+    {
+        std::lock_guard<ML::Spinlock> guard(statsLock);
+        snapshot = stats;
+    }
+
+    GcLockBase::SharedGuard guard(gc, GcLockBase::RD_NO);
+    const Data* current = data.load();
+
+    Json::Value result(Json::objectValue);
+
+    auto toJson = [&] (const string& exchange, const std::vector<unsigned>* order) {
+        Json::Value filters(Json::arrayValue);
+        const ExchangeStats& exchangeStats = snapshot[exchange];
+
+        for (size_t i = 0; i < current->filters.size(); ++i) {
+            const FilterBase* filter =
+                current->filters[order ? (*order)[i] : i].get();
+
+            Json::Value entry;
+            entry["name"] = filter->name();
+
+            auto it = exchangeStats.find(filter->name());
+            if (it != exchangeStats.end() && it->second.samples) {
+                const FilterStats& stat = it->second;
+                entry["samples"] = stat.samples;
+                entry["costNs"] =
+                    (stat.ticks / ticks_per_second) * 1e9 / stat.samples;
+                entry["passRatio"] =
+                    stat.in ? double(stat.out) / stat.in : 1.0;
+            }
+
+            filters.append(entry);
+        }
+
+        result[exchange.empty() ? "default" : exchange] = filters;
+    };
+
+    toJson("", nullptr);
+    for (const auto& entry : current->orders)
+        toJson(entry.first, &entry.second);
+
+    return result;
+}
+
+
+/******************************************************************************/
+/* FILTER POOL - CACHE                                                        */
+/******************************************************************************/
+
+bool
+FilterPool::Cache::
+get(uint64_t key, ConfigSet& configs)
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    auto it = index.find(key);
+    if (it == index.end()) return false;
+
+    entries.splice(entries.begin(), entries, it->second);
+    configs = it->second->second;
+    return true;
+}
+
+void
+FilterPool::Cache::
+put(uint64_t key, const ConfigSet& configs)
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    // Another thread might have beaten us to it.
+    auto it = index.find(key);
+    if (it != index.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    // Recycle the least recently used entry to avoid allocating while holding
+    // the lock.
+    if (index.size() >= capacity) {
+        index.erase(entries.back().first);
+        entries.splice(entries.begin(), entries, std::prev(entries.end()));
+        entries.front() = std::make_pair(key, configs);
+    }
+    else entries.emplace_front(key, configs);
+
+    index[key] = entries.begin();
+}
+
+
 /******************************************************************************/
 /* FILTER POOL - DATA                                                         */
 /******************************************************************************/
 
 FilterPool::Data::
 Data(const Data& other) :
+    requestStatic(other.requestStatic),
     configs(other.configs),
-    activeConfigs(other.activeConfigs)
+    activeConfigs(other.activeConfigs),
+    orders(other.orders)
 {
     filters.reserve(other.filters.size());
-    for (FilterBase* filter : other.filters)
-        filters.push_back(filter->clone());
+    for (const auto& filter : other.filters)
+        filters.emplace_back(filter->clone());
 }
 
+FilterPool::Data::
+Data(const Data& other, ShareFilters) :
+    filters(other.filters),
+    requestStatic(other.requestStatic),
+    configs(other.configs),
+    activeConfigs(other.activeConfigs),
+    orders(other.orders),
+    cache(other.cache)
+{}
 
+size_t
 FilterPool::Data::
-~Data()
+memUsage() const
 {
-    for (FilterBase* filter : filters) delete filter;
+    size_t result = sizeof(*this)
+        + filters.capacity() * sizeof(filters[0])
+        + requestStatic.capacity() * sizeof(unsigned)
+        + configs.capacity() * sizeof(ConfigEntry)
+        + activeConfigs.size() * sizeof(ConfigSet);
+
+    for (const auto& config : configs)
+        result += heapBytes(config.name);
+
+    for (const auto& order : orders) {
+        result += sizeof(order) + 2 * sizeof(void*) + heapBytes(order.first)
+            + order.second.capacity() * sizeof(unsigned);
+    }
+
+    return result;
 }
 
 ssize_t
@@ -352,7 +930,7 @@ addConfig(const string& name, const AgentInfo& info)
 
     activeConfigs.setConfig(index, info.config->creatives.size());
 
-    for (FilterBase* filter : filters)
+    for (const auto& filter : filters)
         filter->addConfig(index, info.config);
 
     return index;
@@ -367,7 +945,7 @@ removeConfig(const string& name)
 
     activeConfigs.resetConfig(index);
 
-    for (FilterBase* filter : filters)
+    for (const auto& filter : filters)
         filter->removeConfig(index, configs[index].config);
 
     configs[index].reset();
@@ -396,10 +974,15 @@ addFilter(FilterBase* filter)
         filter->addConfig(cfgId, configs[cfgId].config);
     }
 
-    filters.push_back(filter);
-    sort(filters.begin(), filters.end(), [] (FilterBase* lhs, FilterBase* rhs) {
+    filters.emplace_back(filter);
+    stable_sort(filters.begin(), filters.end(),
+            [] (const shared_ptr<FilterBase>& lhs, const shared_ptr<FilterBase>& rhs) {
                 return lhs->priority() < rhs->priority();
             });
+
+    // Indexes have changed; the order will be relearned.
+    orders.clear();
+    indexFilters();
 }
 
 void
@@ -409,12 +992,19 @@ removeFilter(const string& name)
     ssize_t index = findFilter(name);
     if (index < 0) return;
 
-    delete filters[index];
-
-    for (size_t i = index; i < filters.size() - 1; ++i)
-        filters[i] = filters[i+1];
+    filters.erase(filters.begin() + index);
+    orders.clear();
+    indexFilters();
+}
 
-    filters.pop_back();
+void
+FilterPool::Data::
+indexFilters()
+{
+    requestStatic.clear();
+    for (size_t i = 0; i < filters.size(); ++i) {
+        if (filters[i]->isRequestStatic()) requestStatic.push_back(i);
+    }
 }
 
 } // namepsace RTBKit
@@ -10,11 +10,15 @@
 
 #include "rtbkit/common/filter.h"
 #include "soa/gc/gc_lock.h"
+#include "jml/arch/spinlock.h"
+#include "jml/arch/huge_page_allocator.h"
 
 #include <atomic>
+#include <list>
 #include <vector>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 
 namespace Datacratic {
@@ -50,7 +54,8 @@ struct FilterPool
             name(std::move(name)),
             config(info.config),
             status(info.status),
-            stats(info.stats)
+            stats(info.stats),
+            configIndex(-1)
         {}
 
         void reset()
@@ -67,6 +72,7 @@ struct FilterPool
 
         // Only used in the instances returned from filter.
         BiddableSpots biddableSpots;
+        unsigned configIndex;
     };
     typedef std::vector<ConfigEntry> ConfigList;
 
@@ -75,6 +81,27 @@ struct FilterPool
             const ExchangeConnector* conn,
             const ConfigSet& mask = ConfigSet(true));
 
+    /** Filters a batch of bid requests coming from the same exchange with a
+        single snapshot of the filters and configs. Each filter runs over all
+        the requests that still have configs left before moving on to the next
+        filter which lets the filters share work between the requests (see
+        FilterBase::filterBatch). Returns the configs of each request in the
+        order of the requests.
+     */
+    std::vector<ConfigList> filterBatch(
+            const std::vector<const BidRequest*>& requests,
+            const ExchangeConnector* conn,
+            const ConfigSet& mask = ConfigSet(true));
+
+
+    /** Whether any config could pass the filters that only depend on the
+        exchange and the url of the request (see FilterBase::isPreParse).
+        Only those two fields of br are looked at, so that the request can be
+        dropped from what's scanned out of its raw payload before it's
+        parsed. A true result doesn't mean that any config will bid.
+     */
+    bool preParseMatches(const BidRequest& br, const ExchangeConnector* conn);
+
 
     // \todo Need batch interfaces of these to alleviate overhead.
     void addFilter(const std::string& name);
@@ -83,20 +110,121 @@ struct FilterPool
     void initWithFiltersFromJson(const Json::Value & json);
 
 
-    // \todo Need batch interfaces to alleviate overhead.
     unsigned addConfig(const std::string& name, const AgentInfo& info);
     void removeConfig(const std::string& name);
 
+    /** Agent configs to add or replace; a null info removes the config. */
+    typedef std::vector< std::pair<std::string, const AgentInfo*> > ConfigUpdates;
+
+    /** Applies all the updates with a single copy and swap of the filters.
+        Returns the filter index of each added config in the order of the
+        updates, or -1 for the removed ones.
+     */
+    std::vector<unsigned> updateConfigs(const ConfigUpdates& updates);
+
     // Added for test purposes
     std::vector<string> getFilterNames() const;
 
+
+    /** Reorders the filters of each exchange using the cost and pass-through
+        ratio sampled during filtering so that the filters which eliminate the
+        most configs for the least amount of work run first. Filters at or
+        above Priority::ExchangePre always run last, in priority order.
+
+        Meant to be called periodically.
+     */
+    void reorderFilters();
+
+    /** Learned filter order for each exchange along with the sampled stats. */
+    Json::Value orderToJson() const;
+
+    /** Publishes the CPU time sampled in each filter for each exchange since
+        the last call as filters.cpu.<exchange>.<filter>.*: the average
+        microseconds per call, the percentage of the time spent filtering
+        the exchange that the filter accounts for and the number of sampled
+        calls. Meant to be called periodically.
+     */
+    void reportFilterTimes();
+
+
+    /** Enables the cache of the combined result of the request static filters
+        (see FilterBase::isRequestStatic) which keeps up to size entries. A size
+        of 0 disables the cache. The cache is cleared whenever the filters or
+        the configs change.
+     */
+    void setCacheSize(size_t size);
+    size_t cacheSize() const { return cacheSize_; }
+
+    /** Puts the cache of the request static filters on huge pages of the
+        given mode. Must be called before filtering starts.
+     */
+    void useHugePages(ML::Huge_Page_Mode mode);
+
 private:
 
+    /** Sampled cost and selectivity of a filter for a given exchange. */
+    struct FilterStats
+    {
+        FilterStats() : samples(0), ticks(0), in(0), out(0) {}
+
+        double rank() const;
+
+        uint64_t samples;
+        uint64_t ticks;
+        uint64_t in;  // configs before the filter ran.
+        uint64_t out; // configs that passed the filter.
+    };
+
+    // Indexed by exchange then by filter name so that it survives changes to
+    // the list of filters.
+    typedef std::unordered_map<std::string, FilterStats> ExchangeStats;
+    std::unordered_map<std::string, ExchangeStats> stats;
+
+    // Same as stats but never decayed; cleared by reportFilterTimes.
+    std::unordered_map<std::string, ExchangeStats> times;
+    mutable ML::Spinlock statsLock;
+
+    /** LRU of the configs left by the request static filters keyed by the hash
+        of the bid request fields they depend on.
+     */
+    struct Cache
+    {
+        Cache(size_t capacity, std::shared_ptr<ML::Huge_Page_Arena> arena) :
+            capacity(capacity),
+            entries(arena),
+            index(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), arena)
+        {}
+
+        bool get(uint64_t key, ConfigSet& configs);
+        void put(uint64_t key, const ConfigSet& configs);
+
+    private:
+        typedef std::list<
+            std::pair<uint64_t, ConfigSet>,
+            ML::Huge_Page_Allocator< std::pair<uint64_t, ConfigSet> > > Entries;
+
+        size_t capacity;
+        Entries entries; // Most recently used first.
+        std::unordered_map<
+            uint64_t, Entries::iterator,
+            std::hash<uint64_t>, std::equal_to<uint64_t>,
+            ML::Huge_Page_Allocator<
+                std::pair<const uint64_t, Entries::iterator> > > index;
+        ML::Spinlock lock;
+    };
+
     struct Data
     {
         Data() {}
+
+        // Deep copy: the filters are cloned so that they can be modified.
         Data(const Data& other);
-        ~Data();
+
+        // Shares the filters and the cache of the other Data which must
+        // therefor not be modified afterwards. Used to publish a new filter
+        // order.
+        struct ShareFilters {};
+        Data(const Data& other, ShareFilters);
 
         ssize_t findConfig(const std::string& name) const;
         unsigned addConfig(const std::string& name, const AgentInfo& info);
@@ -105,22 +233,57 @@ private:
         ssize_t findFilter(const std::string& name) const;
         void addFilter(FilterBase* filter);
         void removeFilter(const std::string& name);
+        void indexFilters();
 
-        // \todo Use unique_ptr when moving to gcc 4.7
-        std::vector<FilterBase*> filters;
+        // Rough bytes held by this generation, not counting the internal
+        // state of the filters.
+        size_t memUsage() const;
+
+        std::vector< std::shared_ptr<FilterBase> > filters;
+
+        // Indexes of the request static filters in priority order.
+        std::vector<unsigned> requestStatic;
 
         std::vector<ConfigEntry> configs;
         CreativeMatrix activeConfigs;
+
+        // Learned order of the filters for each exchange as indexes into
+        // filters. Exchanges without an entry use the priority order.
+        std::unordered_map< std::string, std::vector<unsigned> > orders;
+
+        // Never shared with a Data that has different filters or configs.
+        std::shared_ptr<Cache> cache;
     };
 
+    /** Time spent in a filter over a number of requests. */
+    struct FilterSample
+    {
+        const FilterBase* filter;
+        uint64_t requests;
+        uint64_t ticks;
+        uint64_t in;  // configs before the filter ran.
+        uint64_t out; // configs that passed the filter.
+    };
+
+    static const std::vector<unsigned>*
+    filterOrder(const Data* data, const ExchangeConnector* conn);
+    static uint64_t requestStaticKey(const Data* data, const FilterState& state);
+    static ConfigList makeConfigList(const Data* data, FilterState& state);
+    void recordSamples(
+            const ExchangeConnector* conn,
+            const std::vector<FilterSample>& samples);
+
     bool setData(Data*&, std::unique_ptr<Data>&);
     void recordDiff(const Data* data, const FilterBase* f, const ConfigSet& diff);
     void recordReason(const Data* data, const FilterBase* f, FilterState & state);
     uint64_t recordTime(uint64_t ticks, const FilterBase* filter);
+    std::shared_ptr<Cache> makeCache() const;
 
     std::atomic<Data*> data;
+    std::atomic<size_t> cacheSize_;
+    std::shared_ptr<ML::Huge_Page_Arena> cacheArena; // Shared by the caches.
     std::vector< std::shared_ptr<AgentConfig> > configs;
-    mutable Datacratic::GcLock gc;
+    mutable Datacratic::ScalableGcLock gc;
 
     EventRecorder* events;
 };
@@ -181,12 +181,60 @@ private:
 /* CREATIVE EXCHANGE FILTER                                                   */
 /******************************************************************************/
 
-/** \todo Find a way to write an efficient version of this. */
+/** Creatives are only compatible with the exchanges for which the router
+    stored some provider data on them, which happens when the router
+    configures an agent on an exchange.  That part is precomputed when the
+    config is added to the filter into a table per exchange that holds the
+    matrix of the compatible creatives along with their provider data, so a
+    request only costs a lookup in the table of its exchange and a call to
+    the exchange's bidRequestCreativeFilter() for each compatible creative
+    still in the running.
+
+    The router re-adds its configs to the filters whenever a new exchange
+    connector is configured so that the tables stay in sync with the
+    provider data.
+ */
 struct CreativeExchangeFilter : public IterativeFilter<CreativeExchangeFilter>
 {
     static constexpr const char* name = "CreativeExchange";
     unsigned priority() const { return Priority::CreativeExchange; }
 
+    void addConfig(
+            unsigned cfgIndex, const std::shared_ptr<AgentConfig>& config)
+    {
+        IterativeFilter<CreativeExchangeFilter>::addConfig(cfgIndex, config);
+
+        for (size_t crId = 0; crId < config->creatives.size(); ++crId) {
+            const auto& creative = config->creatives[crId];
+
+            std::lock_guard<ML::Spinlock> guard(creative.lock);
+            for (const auto& entry : creative.providerData) {
+                auto& table = tables[entry.first];
+                table.compatible.set(crId, cfgIndex);
+
+                if (cfgIndex >= table.info.size())
+                    table.info.resize(cfgIndex + 1);
+                auto& info = table.info[cfgIndex];
+                if (crId >= info.size())
+                    info.resize(config->creatives.size());
+                info[crId] = entry.second;
+            }
+        }
+    }
+
+    void removeConfig(
+            unsigned cfgIndex, const std::shared_ptr<AgentConfig>& config)
+    {
+        IterativeFilter<CreativeExchangeFilter>::removeConfig(cfgIndex, config);
+
+        for (auto& entry : tables) {
+            auto& table = entry.second;
+            table.compatible.resetConfig(cfgIndex);
+            if (cfgIndex < table.info.size())
+                table.info[cfgIndex].clear();
+        }
+    }
+
     void filter(FilterState& state) const
     {
         // no exchange connector means evertyhing gets filtered out.
@@ -195,25 +243,27 @@ struct CreativeExchangeFilter : public IterativeFilter<CreativeExchangeFilter>
             return;
         }
 
-        CreativeMatrix creatives;
-
-        for (size_t cfgId = state.configs().next();
-             cfgId < state.configs().size();
-             cfgId = state.configs().next(cfgId+1))
-        {
-            const auto& config = *configs[cfgId];
+        auto it = tables.find(state.exchange->exchangeName());
+        if (it == tables.end()) {
+            state.narrowAllCreatives(CreativeMatrix());
+            return;
+        }
 
-            for (size_t crId = 0; crId < config.creatives.size(); ++crId) {
-                const auto& creative = config.creatives[crId];
+        const ExchangeTable& table = it->second;
+        CreativeMatrix creatives;
 
-                auto exchangeInfo = getExchangeInfo(state, creative);
-                if (!exchangeInfo.first) continue;
+        for (size_t crId = 0; crId < table.compatible.size(); ++crId) {
+            ConfigSet matches = table.compatible[crId] & state.configs();
 
+            for (size_t cfgId = matches.next();
+                 cfgId < matches.size();
+                 cfgId = matches.next(cfgId+1))
+            {
                 bool ret = state.exchange->bidRequestCreativeFilter(
-                        state.request, config, exchangeInfo.second);
+                        state.request, *configs[cfgId],
+                        table.info[cfgId][crId].get());
 
                 if (ret) creatives.set(crId, cfgId);
-
             }
         }
 
@@ -222,15 +272,17 @@ struct CreativeExchangeFilter : public IterativeFilter<CreativeExchangeFilter>
 
 private:
 
-    const std::pair<bool, void*>
-    getExchangeInfo(const FilterState& state, const Creative& creative) const
+    struct ExchangeTable
     {
-        auto it = creative.providerData.find(state.exchange->exchangeName());
+        CreativeMatrix compatible;
 
-        if (it == creative.providerData.end())
-            return std::make_pair(false, nullptr);
-        return std::make_pair(true, it->second.get());
-    }
+        // Provider data of the compatible creatives indexed by config and
+        // creative. Holding on to it keeps it alive for as long as the
+        // filter is in use even if the router replaces it in the meantime.
+        std::vector< std::vector< std::shared_ptr<void> > > info;
+    };
+
+    std::unordered_map<std::string, ExchangeTable> tables;
 };
 
 
@@ -8,10 +8,14 @@
 
 #pragma once
 
+#include "literal_matcher.h"
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "rtbkit/core/agent_configuration/include_exclude.h"
 #include "rtbkit/common/filter.h"
 
+#include <algorithm>
+#include <vector>
+
 
 namespace RTBKIT {
 
@@ -112,6 +116,14 @@ protected:
 /* INTERVAL FILTER                                                            */
 /******************************************************************************/
 
+/** Include filter for ranges of values.
+
+    The intervals of the configs are flattened into an index of the disjoint
+    segments between all of their bounds, each with the configs that cover
+    it, so that a value is matched with a binary search over the bounds
+    instead of a pass over all the intervals. The index is rebuilt whenever
+    the configs change, which is rare compared to the filtering.
+ */
 template<typename T>
 struct IntervalFilter
 {
@@ -126,6 +138,7 @@ struct IntervalFilter
     {
         for (const auto& value : list)
             addConfig(cfgIndex, value);
+        buildIndex();
     }
 
     template<typename List>
@@ -133,20 +146,16 @@ struct IntervalFilter
     {
         for (const auto& value : list)
             removeConfig(cfgIndex, value);
+        buildIndex();
     }
 
     ConfigSet filter(T value) const
     {
-        ConfigSet matches;
-
-        for (size_t i = 0; i < intervals.size(); ++i) {
-            if (value < intervals[i].lowerBound) break;
-            if (!intervals[i].contains(value)) continue;
-
-            matches |= intervals[i].configs;
-        }
+        // Segment i covers [bounds[i], bounds[i + 1]).
+        auto it = std::upper_bound(bounds.begin(), bounds.end(), value);
+        if (it == bounds.begin() || it == bounds.end()) return ConfigSet();
 
-        return matches;
+        return segments[it - bounds.begin() - 1];
     }
 
 private:
@@ -229,6 +238,32 @@ private:
         }
         return -1;
     }
+
+    void buildIndex()
+    {
+        bounds.clear();
+        for (const auto& interval : intervals) {
+            if (interval.configs.empty()) continue;
+            if (!(interval.lowerBound < interval.upperBound)) continue;
+
+            bounds.push_back(interval.lowerBound);
+            bounds.push_back(interval.upperBound);
+        }
+
+        std::sort(bounds.begin(), bounds.end());
+        bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+        segments.assign(bounds.empty() ? 0 : bounds.size() - 1, ConfigSet());
+        for (size_t i = 0; i < segments.size(); ++i) {
+            for (const auto& interval : intervals) {
+                if (interval.contains(bounds[i]))
+                    segments[i] |= interval.configs;
+            }
+        }
+    }
+
+    std::vector<T> bounds;
+    std::vector<ConfigSet> segments;
 };
 
 
@@ -236,9 +271,19 @@ private:
 /* DOMAIN FILTER                                                              */
 /******************************************************************************/
 
+/** Include filter for domains which also matches all of their sub-domains.
+
+    The domains of all the configs are kept in a trie of their labels taken
+    from right to left (com, google, www) where each node holds the configs
+    of the domain that ends there. A host is matched by a single walk of its
+    labels down the trie, whatever the number of domains the configs list,
+    and without building any of its suffixes.
+ */
 template<typename Str>
 struct DomainFilter
 {
+    DomainFilter() : nodes(1) {}
+
     template<typename List>
     bool isEmpty(const List& list) const
     {
@@ -260,15 +305,22 @@ struct DomainFilter
     }
 
     ConfigSet filter(const Url& host) const
+    {
+        return filter(host.host());
+    }
+
+    ConfigSet filter(const std::string& host) const
     {
         ConfigSet matches;
 
-        for (const auto& key : getKeys(host)) {
-            auto it = domainMap.find(key);
-            if (it == domainMap.end()) continue;
+        unsigned node = Root;
+        forEachLabel(host, [&] (const char* label, size_t size) {
+                    node = findChild(node, label, size);
+                    if (node == NoNode) return false;
 
-            matches |= it->second;
-        }
+                    matches |= nodes[node].configs;
+                    return true;
+                });
 
         return matches;
     }
@@ -289,31 +341,96 @@ private:
 
     void addConfig(unsigned cfgIndex, const Str& host)
     {
-        domainMap[host].set(cfgIndex);
+        unsigned node = Root;
+        forEachLabel(host, [&] (const char* label, size_t size) {
+                    node = addChild(node, label, size);
+                    return true;
+                });
+
+        nodes[node].configs.set(cfgIndex);
     }
 
     void removeConfig(unsigned cfgIndex, const Str& host)
     {
-        domainMap[host].reset(cfgIndex);
+        unsigned node = Root;
+        forEachLabel(host, [&] (const char* label, size_t size) {
+                    node = findChild(node, label, size);
+                    return node != NoNode;
+                });
+
+        // Nodes are never removed; an empty one costs a lookup at most.
+        if (node != NoNode) nodes[node].configs.reset(cfgIndex);
     }
 
-    std::vector<std::string> getKeys(const Url& host) const
+    enum { Root = 0, NoNode = unsigned(-1) };
+
+    struct Node
+    {
+        ConfigSet configs;
+
+        // Sorted by label.
+        std::vector< std::pair<std::string, unsigned> > children;
+    };
+
+    /** Calls onLabel with each of the dot separated labels of the host from
+        right to left until it returns false.
+     */
+    template<typename Fn>
+    static void forEachLabel(const std::string& host, Fn onLabel)
     {
-        std::vector<std::string> keys;
+        const char* begin = host.data();
+        const char* last = begin + host.size();
 
-        std::string domain = host.host();
         while (true) {
-            keys.push_back(domain);
+            const char* first = last;
+            while (first != begin && first[-1] != '.') --first;
+
+            if (!onLabel(first, last - first)) return;
+            if (first == begin) return;
 
-            size_t pos = domain.find('.');
-            if (pos == std::string::npos) break;
-            domain = domain.substr(pos+1);
+            last = first - 1;
         }
+    }
+
+    typedef typename std::vector< std::pair<std::string, unsigned> >::const_iterator
+        ChildIt;
 
-        return keys;
+    ChildIt lowerBound(const Node& node, const char* label, size_t size) const
+    {
+        return std::lower_bound(
+                node.children.begin(), node.children.end(), size,
+                [&] (const std::pair<std::string, unsigned>& child, size_t) {
+                    return child.first.compare(0, std::string::npos, label, size) < 0;
+                });
+    }
+
+    unsigned findChild(unsigned parent, const char* label, size_t size) const
+    {
+        const Node& node = nodes[parent];
+        auto it = lowerBound(node, label, size);
+        if (it == node.children.end()) return NoNode;
+        if (it->first.compare(0, std::string::npos, label, size) != 0)
+            return NoNode;
+        return it->second;
     }
 
-    std::unordered_map<std::string, ConfigSet> domainMap;
+    unsigned addChild(unsigned parent, const char* label, size_t size)
+    {
+        unsigned child = findChild(parent, label, size);
+        if (child != NoNode) return child;
+
+        child = nodes.size();
+        nodes.emplace_back();
+
+        auto& children = nodes[parent].children;
+        auto it = lowerBound(nodes[parent], label, size);
+        children.emplace(children.begin() + (it - children.begin()),
+                std::string(label, size), child);
+
+        return child;
+    }
+
+    std::vector<Node> nodes;
 };
 
 /******************************************************************************/
@@ -322,6 +439,11 @@ private:
 
 /** Generic include filter for regexes.
 
+    Every regex from which a required literal can be extracted is indexed in a
+    LiteralMatcher so that a single pass over the string finds the only regexes
+    that could possibly match. Those whose pattern is a plain literal don't even
+    need to be evaluated. The remaining regexes are evaluated one by one.
+
     \todo We could add a TLS cache of all seen values such that we can avoid the
     regex entirely.
  */
@@ -339,6 +461,7 @@ struct RegexFilter
     {
         for (const auto& value : list)
             addConfig(cfgIndex, value);
+        compile();
     }
 
     template<typename List>
@@ -346,14 +469,29 @@ struct RegexFilter
     {
         for (const auto& value : list)
             removeConfig(cfgIndex, value);
+        compile();
     }
 
     ConfigSet filter(const Str& str) const
     {
         ConfigSet matches;
 
-        for (const auto& entry : data)
-            matches |= entry.second.filter(str);
+        for (unsigned index : unindexed)
+            matches |= entries[index].filter(str);
+
+        if (byLiteral.empty()) return matches;
+
+        std::vector<bool> seen(byLiteral.size(), false);
+        matchLiterals(str, [&] (unsigned literal) {
+                    if (seen[literal]) return;
+                    seen[literal] = true;
+
+                    for (unsigned index : byLiteral[literal]) {
+                        const Entry& entry = entries[index];
+                        if (entry.exact) matches |= entry.configs;
+                        else matches |= entry.filter(str);
+                    }
+                });
 
         return matches;
     }
@@ -363,7 +501,10 @@ private:
     void addConfig(unsigned cfgIndex, const Regex& regex)
     {
         auto& entry = data[regex.str()];
-        if (entry.regex.empty()) entry.regex = regex;
+        if (entry.regex.empty()) {
+            entry.regex = regex;
+            entry.required = requiredLiteral(regex);
+        }
         entry.configs.set(cfgIndex);
     }
 
@@ -392,12 +533,72 @@ private:
         Regex regex;
         ConfigSet configs;
 
+        // Analyzed once when the regex is first added since the index is
+        // rebuilt after every change.
+        RequiredLiteral required;
+
         ConfigSet filter(const Str& str) const
         {
             return RTBKIT::matches(regex, str) ? configs : ConfigSet();
         }
     };
 
+    // Flattened copy of data used during filtering.
+    struct Entry : public RegexData
+    {
+        Entry(const RegexData& data, bool exact) :
+            RegexData(data), exact(exact)
+        {}
+
+        bool exact;
+    };
+
+    /** Rebuilds the literal index from scratch. Called after each batch of
+        modifications since this is a lot cheaper then filtering is.
+     */
+    void compile()
+    {
+        entries.clear();
+        unindexed.clear();
+        byLiteral.clear();
+        matcher.clear();
+
+        std::map<std::string, unsigned> literals;
+
+        for (const auto& item : data) {
+            const RequiredLiteral& required = item.second.required;
+
+            unsigned index = entries.size();
+            entries.emplace_back(item.second, required.exact);
+
+            if (required.empty()) {
+                unindexed.push_back(index);
+                continue;
+            }
+
+            auto it = literals.find(required.literal);
+            if (it == literals.end()) {
+                unsigned id = matcher.add(required.literal);
+                it = literals.insert(std::make_pair(required.literal, id)).first;
+                byLiteral.emplace_back();
+            }
+
+            byLiteral[it->second].push_back(index);
+        }
+
+        matcher.compile();
+    }
+
+    template<typename Fn>
+    void matchLiterals(const std::string& str, Fn&& onMatch) const
+    {
+        matcher.match(str, std::forward<Fn>(onMatch));
+    }
+
+    // Only strings are indexed; other string types have no literals.
+    template<typename S, typename Fn>
+    void matchLiterals(const S&, Fn&&) const {}
+
     typedef std::basic_string<typename Regex::value_type> KeyT;
 
     /* \todo gcc 4.6 can't hash u32strings so use a map for now.
@@ -407,6 +608,11 @@ private:
        own because, you guessed it, gcc already defines it. Glorious is it not?
     */
     std::map<KeyT, RegexData> data;
+
+    std::vector<Entry> entries;
+    std::vector<unsigned> unindexed;
+    std::vector< std::vector<unsigned> > byLiteral; // literal id -> entries.
+    LiteralMatcher matcher;
 };
 
 
@@ -527,6 +733,88 @@ private:
 };
 
 
+/******************************************************************************/
+/* SEGMENT INDEX                                                              */
+/******************************************************************************/
+
+/** Inverted index over the include and exclude segment lists of the configs.
+
+    Equivalent to IncludeExcludeFilter<SegmentListFilter> but both sides of the
+    include/exclude are stored in the same posting so that filtering costs a
+    single lookup per segment of the request regardless of how long the
+    configs' segment lists are. The ints and strings of the request are also
+    used directly which avoids the formatting done by SegmentList::forEach.
+
+ */
+struct SegmentIndex
+{
+    SegmentIndex() : emptyIncludes(true) {}
+
+    void setInclude(unsigned cfgIndex, bool value, const SegmentList& segments)
+    {
+        if (segments.empty()) return;
+
+        emptyIncludes.set(cfgIndex, !value);
+        setConfig(cfgIndex, value, segments, &Postings::include);
+    }
+
+    void setExclude(unsigned cfgIndex, bool value, const SegmentList& segments)
+    {
+        if (segments.empty()) return;
+        setConfig(cfgIndex, value, segments, &Postings::exclude);
+    }
+
+    ConfigSet filter(const SegmentList& segments) const
+    {
+        ConfigSet includes = emptyIncludes;
+        ConfigSet excludes;
+
+        auto onPostings = [&] (const Postings& postings) {
+            includes |= postings.include;
+            excludes |= postings.exclude;
+        };
+
+        for (int i : segments.ints) {
+            auto it = intIndex.find(i);
+            if (it != intIndex.end()) onPostings(it->second);
+        }
+
+        for (const std::string& str : segments.strings) {
+            auto it = strIndex.find(str);
+            if (it != strIndex.end()) onPostings(it->second);
+        }
+
+        if (includes.empty()) return includes;
+
+        includes &= excludes.negate();
+        return includes;
+    }
+
+private:
+
+    struct Postings
+    {
+        ConfigSet include;
+        ConfigSet exclude;
+    };
+
+    void setConfig(
+            unsigned cfgIndex, bool value, const SegmentList& segments,
+            ConfigSet Postings::* list)
+    {
+        for (int i : segments.ints)
+            (intIndex[i].*list).set(cfgIndex, value);
+
+        for (const std::string& str : segments.strings)
+            (strIndex[str].*list).set(cfgIndex, value);
+    }
+
+    ConfigSet emptyIncludes;
+    std::unordered_map<int, Postings> intIndex;
+    std::unordered_map<std::string, Postings> strIndex;
+};
+
+
 /******************************************************************************/
 /* INCLUDE EXCLUDE FILTER                                                     */
 /******************************************************************************/
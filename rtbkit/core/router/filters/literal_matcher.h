@@ -0,0 +1,335 @@
+/** literal_matcher.h                                 -*- C++ -*-
+    14 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Multi-pattern literal matcher used to avoid evaluating regexes that can't
+    possibly match a string.
+
+*/
+
+#pragma once
+
+#include <boost/regex.hpp>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* LITERAL MATCHER                                                            */
+/******************************************************************************/
+
+/** Aho-Corasick automaton over a set of literals which finds every literal
+    occuring in a string in a single pass over it.
+
+    Literals must be added before calling compile() and match() can only be
+    called on a compiled matcher. Once compiled, the matcher is immutable and
+    can be used from multiple threads.
+ */
+struct LiteralMatcher
+{
+    LiteralMatcher() { clear(); }
+
+    bool empty() const { return numLiterals == 0; }
+    size_t size() const { return numLiterals; }
+
+    void clear()
+    {
+        nodes.clear();
+        nodes.emplace_back();
+        numLiterals = 0;
+    }
+
+    /** Adds the literal and returns its id. Ids are assigned sequentially. */
+    unsigned add(const std::string& literal)
+    {
+        unsigned node = 0;
+
+        for (char c : literal) {
+            unsigned next = find(node, c);
+            if (next == NoNode) {
+                next = nodes.size();
+                nodes.emplace_back();
+                auto& edges = nodes[node].edges;
+                edges.emplace_back(c, next);
+                std::sort(edges.begin(), edges.end());
+            }
+            node = next;
+        }
+
+        unsigned id = numLiterals++;
+        nodes[node].outputs.push_back(id);
+        return id;
+    }
+
+    /** Builds the failure links of the automaton with a BFS over the trie. */
+    void compile()
+    {
+        std::vector<unsigned> queue;
+        queue.reserve(nodes.size());
+
+        for (const auto& edge : nodes[0].edges) {
+            nodes[edge.second].fail = 0;
+            queue.push_back(edge.second);
+        }
+
+        for (size_t i = 0; i < queue.size(); ++i) {
+            unsigned node = queue[i];
+
+            for (const auto& edge : nodes[node].edges) {
+                unsigned child = edge.second;
+                queue.push_back(child);
+
+                unsigned fail = nodes[node].fail;
+                unsigned next;
+                while ((next = find(fail, edge.first)) == NoNode && fail)
+                    fail = nodes[fail].fail;
+
+                nodes[child].fail = next == NoNode ? 0 : next;
+
+                // Shortcut to the closest suffix which ends a literal.
+                unsigned suffix = nodes[child].fail;
+                nodes[child].output = nodes[suffix].outputs.empty() ?
+                    nodes[suffix].output : suffix;
+            }
+        }
+    }
+
+    /** Calls onMatch(id) for every occurence of a literal in str. */
+    template<typename Fn>
+    void match(const std::string& str, Fn&& onMatch) const
+    {
+        unsigned node = 0;
+
+        for (char c : str) {
+            unsigned next;
+            while ((next = find(node, c)) == NoNode && node)
+                node = nodes[node].fail;
+            node = next == NoNode ? 0 : next;
+
+            for (unsigned out = node; out; out = nodes[out].output) {
+                for (unsigned id : nodes[out].outputs) onMatch(id);
+            }
+        }
+    }
+
+private:
+
+    static constexpr unsigned NoNode = unsigned(-1);
+
+    struct Node
+    {
+        Node() : fail(0), output(0) {}
+
+        std::vector< std::pair<char, unsigned> > edges; // sorted by char.
+        std::vector<unsigned> outputs;
+        unsigned fail;
+        unsigned output; // 0 if no suffix ends a literal.
+    };
+
+    unsigned find(unsigned node, char c) const
+    {
+        const auto& edges = nodes[node].edges;
+        auto it = std::lower_bound(
+                edges.begin(), edges.end(), std::make_pair(c, 0u),
+                [] (const std::pair<char, unsigned>& lhs,
+                    const std::pair<char, unsigned>& rhs)
+                {
+                    return lhs.first < rhs.first;
+                });
+        return it != edges.end() && it->first == c ? it->second : NoNode;
+    }
+
+    std::vector<Node> nodes;
+    size_t numLiterals;
+};
+
+
+/******************************************************************************/
+/* REQUIRED LITERAL                                                           */
+/******************************************************************************/
+
+/** Literal that has to appear in any string matched by a regex. */
+struct RequiredLiteral
+{
+    RequiredLiteral() : exact(false) {}
+
+    bool empty() const { return literal.empty(); }
+
+    std::string literal;
+
+    // The regex matches if and only if the literal appears in the string.
+    bool exact;
+};
+
+/** Extracts the longest literal that must appear in every string that the
+    perl regex searches successfully. The analysis is conservative: anything
+    the parser doesn't understand yields an empty literal, which means that
+    the regex always has to be evaluated.
+ */
+inline RequiredLiteral
+requiredLiteral(const std::string& pattern)
+{
+    RequiredLiteral result;
+
+    std::string best, run;
+    bool exact = true;
+    bool lastIsChar = false; // last token was a char appended to run.
+    int depth = 0;
+
+    auto endRun = [&] {
+        if (run.size() > best.size()) best = run;
+        run.clear();
+        lastIsChar = false;
+    };
+
+    auto addChar = [&] (char c) {
+        if (depth == 0) {
+            run += c;
+            lastIsChar = true;
+        }
+        else exact = false;
+    };
+
+    auto onQuantifier = [&] (bool optional) {
+        exact = false;
+        if (optional && lastIsChar) run.erase(run.size() - 1);
+        endRun();
+    };
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+
+        switch (c) {
+
+        case '\\': {
+            if (++i == pattern.size()) return result;
+            char e = pattern[i];
+
+            if (!std::isalnum(e)) {
+                addChar(e);
+                break;
+            }
+
+            // Only the single character escapes are understood.
+            if (!std::strchr("dDwWsSbBntrfea", e)) return result;
+
+            exact = false;
+            endRun();
+            break;
+        }
+
+        case '[': {
+            exact = false;
+            endRun();
+
+            size_t j = i + 1;
+            if (j < pattern.size() && pattern[j] == '^') ++j;
+            if (j < pattern.size() && pattern[j] == ']') ++j;
+
+            for (; j < pattern.size() && pattern[j] != ']'; ++j) {
+                if (pattern[j] == '\\') ++j;
+                else if (pattern[j] == '[') return result; // [:class:] etc.
+            }
+            if (j >= pattern.size()) return result;
+            i = j;
+            break;
+        }
+
+        case '(':
+            // Flags, lookarounds and the like are best left to the regex.
+            if (i + 1 < pattern.size() && pattern[i + 1] == '?') {
+                if (i + 2 >= pattern.size() || pattern[i + 2] != ':')
+                    return result;
+                i += 2;
+            }
+            exact = false;
+            endRun();
+            ++depth;
+            break;
+
+        case ')':
+            if (--depth < 0) return result;
+            endRun();
+            break;
+
+        case '|':
+            if (depth == 0) return result;
+            break;
+
+        case '.': case '^': case '$':
+            exact = false;
+            endRun();
+            break;
+
+        case '*': case '?':
+            onQuantifier(true);
+            break;
+
+        case '+':
+            onQuantifier(false);
+            break;
+
+        case '{': {
+            size_t end = pattern.find('}', i);
+            if (end == std::string::npos) return result;
+
+            for (size_t j = i + 1; j < end; ++j) {
+                if (!std::isdigit(pattern[j]) && pattern[j] != ',')
+                    return result;
+            }
+
+            onQuantifier(true);
+            i = end;
+            break;
+        }
+
+        case '}': case ']':
+            return result;
+
+        default:
+            addChar(c);
+        }
+    }
+
+    if (depth != 0) return result;
+    endRun();
+
+    // Every literal token ends up in the run and any other token clears exact
+    // so an exact pattern is made of a single run.
+    result.literal = best;
+    result.exact = exact && !best.empty();
+    return result;
+}
+
+inline RequiredLiteral requiredLiteral(const boost::regex& regex)
+{
+    if (regex.empty()) return RequiredLiteral();
+
+    // Only the default case sensitive perl syntax is analyzed.
+    auto flags = regex.flags();
+    if ((flags & boost::regbase::main_option_type) != boost::regbase::perl_syntax_group)
+        return RequiredLiteral();
+    if (flags & (boost::regbase::icase | boost::regbase::mod_x))
+        return RequiredLiteral();
+
+    return requiredLiteral(regex.str());
+}
+
+/** No literal analysis for the other regex types so they are always
+    evaluated.
+ */
+template<typename Regex>
+RequiredLiteral requiredLiteral(const Regex&)
+{
+    return RequiredLiteral();
+}
+
+
+} // namespace RTBKIT
@@ -46,6 +46,12 @@ struct Priority
     static constexpr unsigned LatLong              = 0xF200;
 
     static constexpr unsigned ExchangePost         = 0xFF00;
+
+    // Scores a model for every request so run it on what's left.
+    static constexpr unsigned Model                = 0xFF40;
+
+    // Uses up the agent's share of requests so it has to come last.
+    static constexpr unsigned MaxQps               = 0xFF80;
 };
 
 
@@ -91,11 +91,9 @@ void
 SegmentsFilter::
 filter(FilterState& state) const
 {
-    unordered_set<string> toCheck = excludeIfNotPresent;
-
-    for (const auto& segment : state.request.segments) {
-        toCheck.erase(segment.first);
+    const auto& segments = state.request.segments;
 
+    for (const auto& segment : segments) {
         auto it = data.find(segment.first);
         if (it == data.end()) continue;
 
@@ -110,7 +108,9 @@ filter(FilterState& state) const
         if (state.configs().empty()) return;
     }
 
-    for (const auto& segment : toCheck) {
+    for (const auto& segment : excludeIfNotPresent) {
+        if (segments.count(segment)) continue;
+
         auto it = data.find(segment);
         if (it == data.end()) continue;
 
@@ -161,9 +161,10 @@ filter(FilterState& state) const
 {
     ConfigSet matches = defaultSet;
     ConfigSet excludes;
+    UserHashes hashes;
 
     for (const auto& entry : data) {
-        auto value = getValue(state.request, entry.second);
+        auto value = getValue(state.request, entry.second, hashes);
 
         if (!value.first) excludes |= entry.second.excludeIfEmpty;
         else matches |= entry.second.filter.filter(value.second);
@@ -176,7 +177,7 @@ filter(FilterState& state) const
 namespace {
 
 // \todo Currently uses MD5 which is suboptimal.
-uint64_t calcHash(const std::string& str)
+uint64_t calcHash(const std::string& first, const std::string& second = "")
 {
     CryptoPP::Weak::MD5 md5;
 
@@ -185,8 +186,10 @@ uint64_t calcHash(const std::string& str)
         byte bytes[sizeof(uint64_t)];
     };
 
-    md5.CalculateTruncatedDigest(bytes, sizeof(uint64_t),
-            (const byte *)str.c_str(), str.size());
+    // Same digest as the concatenation of the two strings.
+    md5.Update((const byte *)first.c_str(), first.size());
+    md5.Update((const byte *)second.c_str(), second.size());
+    md5.TruncatedFinal(bytes, sizeof(uint64_t));
 
     return result;
 }
@@ -195,30 +198,56 @@ uint64_t calcHash(const std::string& str)
 
 std::pair<bool, uint64_t>
 UserPartitionFilter::
-getValue(const BidRequest& br, const FilterEntry& entry) const
+getValue(const BidRequest& br, const FilterEntry& entry, UserHashes& hashes) const
 {
     if (entry.hashOn == UserPartition::RANDOM)
         return make_pair(true, random() % entry.modulus);
 
-    string str;
+    ExcAssertGreaterEqual(entry.hashOn, 0);
+    ExcAssertLess(entry.hashOn, UserHashes::Size);
+
+    if (!hashes.done[entry.hashOn]) {
+        hashes.hashes[entry.hashOn] = getHash(br, entry.hashOn);
+        hashes.done[entry.hashOn] = true;
+    }
+
+    const auto& hash = hashes.hashes[entry.hashOn];
+    if (!hash.first) return make_pair(false, 0);
 
-    switch (entry.hashOn) {
+    auto h = hash.second + entry.uid;
+    return make_pair(true, h % entry.modulus);
+}
+
+std::pair<bool, uint64_t>
+UserPartitionFilter::
+getHash(const BidRequest& br, UserPartition::HashOn hashOn)
+{
+    auto isEmpty = [] (const string& str) {
+        return str.empty() || str == "null";
+    };
+
+    switch (hashOn) {
     case UserPartition::EXCHANGEID:
-        str = br.userIds.exchangeId.toString(); break;
+    case UserPartition::PROVIDERID: {
+        const Id& id = hashOn == UserPartition::EXCHANGEID ?
+            br.userIds.exchangeId : br.userIds.providerId;
 
-    case UserPartition::PROVIDERID:
-        str = br.userIds.providerId.toString(); break;
+        string str = id.toString();
+        if (isEmpty(str)) return make_pair(false, 0);
+        return make_pair(true, calcHash(str));
+    }
 
-    case UserPartition::IPUA:
-        str = br.ipAddress + br.userAgent.utf8String(); break;
+    case UserPartition::IPUA: {
+        const string & ua = br.userAgent.utf8String();
+        if (br.ipAddress.size() + ua.size() <= 4 && isEmpty(br.ipAddress + ua))
+            return make_pair(false, 0);
+        return make_pair(true, calcHash(br.ipAddress, ua));
+    }
 
     default: ExcAssert(false);
     };
 
-    if (str.empty() || str == "null") return make_pair(false, 0);
-
-    auto h = calcHash(str) + entry.uid;
-    return make_pair(true, h % entry.modulus);
+    return make_pair(false, 0);
 }
 
 
@@ -247,39 +276,56 @@ void LatLongDevFilter::addConfig(unsigned cfgIndex,
         squares_by_confindx[cfgIndex] = squares;
         configs_with_filt.set(cfgIndex);
     }
+
+    for (const Square & sq : squares) {
+        bool indexed = forEachCell(sq, [&] (uint64_t key) {
+                    grid[key].add(sq, cfgIndex);
+                });
+        if (!indexed) large_squares.add(sq, cfgIndex);
+    }
 }
 
 void LatLongDevFilter::removeConfig(unsigned cfgIndex,
         const std::shared_ptr<RTBKIT::AgentConfig>& config)
 {
-    if ( squares_by_confindx.count(cfgIndex) > 0){
-        squares_by_confindx.erase(cfgIndex);
-        configs_with_filt.reset(cfgIndex);
+    auto it = squares_by_confindx.find(cfgIndex);
+    if (it == squares_by_confindx.end()) return;
+
+    for (const Square & sq : it->second) {
+        bool indexed = forEachCell(sq, [&] (uint64_t key) {
+                    auto cell = grid.find(key);
+                    if (cell == grid.end()) return;
+                    cell->second.remove(cfgIndex);
+                    if (cell->second.empty()) grid.erase(cell);
+                });
+        if (!indexed) large_squares.remove(cfgIndex);
     }
+
+    squares_by_confindx.erase(it);
+    configs_with_filt.reset(cfgIndex);
 }
 
 void LatLongDevFilter::filter(RTBKIT::FilterState& state) const
  {
-    RTBKIT::ConfigSet matches = state.configs();
-
-    auto it = squares_by_confindx.begin();
-    if ( ! checkLatLongPresent(state.request)){
-        // If there is no geo info the filter, then filter out all the
-        // agent configs that has this filter present.
-        state.narrowConfigs(configs_with_filt.negate());
-    } else {
-        // Filter using the lat long of the request and from the configs
-        // of the agents.
-        for ( ; it != squares_by_confindx.end(); ++it ){
-            if (pointInsideAnySquare(state.request.device->geo->lat.val,
-                    state.request.device->geo->lon.val, it->second)) {
-                continue;
-            }
-            matches.reset(it->first);
-        }
-        state.narrowConfigs(matches);
+    // Configs without the filter always go through.
+    RTBKIT::ConfigSet matches = configs_with_filt.negate();
+
+    // If there is no geo info the filter, then filter out all the agent
+    // configs that has this filter present.
+    if (checkLatLongPresent(state.request)) {
+        const float lat = state.request.device->geo->lat.val;
+        const float lon = state.request.device->geo->lon.val;
+        const float y = lat * LATITUDE_1DEGREE_KMS;
+        const float x = lon * LONGITUDE_1DEGREE_KMS * cosInDegrees(lat);
+
+        auto cell = grid.find(cellKey(cellOf(x), cellOf(y)));
+        if (cell != grid.end())
+            cell->second.match(x, y, matches);
+        large_squares.match(x, y, matches);
     }
 
+    state.narrowConfigs(matches);
+
  }
 
 bool LatLongDevFilter::checkLatLongPresent(
@@ -287,12 +333,60 @@ bool LatLongDevFilter::checkLatLongPresent(
 {
     if ( ! req.device) return false;
     if ( ! req.device->geo) return false;
-    if ( req.device->geo->lat.val == std::numeric_limits<float>::quiet_NaN() ||
-         req.device->geo->lon.val == std::numeric_limits<float>::quiet_NaN() )
+    if ( std::isnan(req.device->geo->lat.val) ||
+         std::isnan(req.device->geo->lon.val) )
         return false;
     return true;
 }
 
+void
+LatLongDevFilter::SquareSet::
+add(const Square & sq, unsigned cfgIndex)
+{
+    x_max.push_back(sq.x_max);
+    x_min.push_back(sq.x_min);
+    y_max.push_back(sq.y_max);
+    y_min.push_back(sq.y_min);
+    configs.push_back(cfgIndex);
+}
+
+void
+LatLongDevFilter::SquareSet::
+remove(unsigned cfgIndex)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < configs.size(); ++i) {
+        if (configs[i] == cfgIndex) continue;
+
+        x_max[j] = x_max[i];
+        x_min[j] = x_min[i];
+        y_max[j] = y_max[i];
+        y_min[j] = y_min[i];
+        configs[j] = configs[i];
+        ++j;
+    }
+
+    x_max.resize(j);
+    x_min.resize(j);
+    y_max.resize(j);
+    y_min.resize(j);
+    configs.resize(j);
+}
+
+void
+LatLongDevFilter::SquareSet::
+match(float x, float y, ConfigSet & result) const
+{
+    const size_t n = configs.size();
+    for (size_t i = 0; i < n; ++i) {
+        // Bitwise ands so that all four compares are evaluated without
+        // branching.
+        bool inside = (x < x_max[i]) & (x > x_min[i])
+                    & (y < y_max[i]) & (y > y_min[i]);
+        if (inside) result.set(configs[i]);
+    }
+}
+
 bool
 LatLongDevFilter::pointInsideAnySquare(float lat, float lon,
         const SquareList & squares)
@@ -329,6 +423,7 @@ struct AtInit {
         RTBKIT::FilterBase::registerFactory<RTBKIT::FoldPositionFilter>();
         RTBKIT::FilterBase::registerFactory<RTBKIT::RequiredIdsFilter>();
         RTBKIT::FilterBase::registerFactory<RTBKIT::LatLongDevFilter>();
+        RTBKIT::FilterBase::registerFactory<RTBKIT::MaxQpsFilter>();
     }
 
 } AtInit;
@@ -17,6 +17,8 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 
 namespace RTBKIT {
@@ -44,7 +46,7 @@ private:
         typedef ListFilter<std::string> ExchangeFilterT;
         IncludeExcludeFilter<ExchangeFilterT> exchange;
 
-        IncludeExcludeFilter<SegmentListFilter> ie;
+        SegmentIndex ie;
         ConfigSet excludeIfNotPresent;
 
         ConfigSet applyExchangeFilter(
@@ -89,8 +91,24 @@ private:
         return uint64_t(uid) << 32 | uint64_t(obj.modulus) << 16 | uint64_t(obj.hashOn);
     }
 
+    /** Hash of the request's user for each HashOn, computed at most once per
+        request whatever the number of partitions that use it.
+     */
+    struct UserHashes
+    {
+        UserHashes() { std::fill(std::begin(done), std::end(done), false); }
+
+        enum { Size = UserPartition::IPUA + 1 };
+        bool done[Size];
+        std::pair<bool, uint64_t> hashes[Size];
+    };
+
     std::pair<bool, uint64_t>
-    getValue(const BidRequest& br, const FilterEntry& entry) const;
+    getValue(const BidRequest& br, const FilterEntry& entry,
+            UserHashes& hashes) const;
+
+    static std::pair<bool, uint64_t>
+    getHash(const BidRequest& br, UserPartition::HashOn hashOn);
 
 };
 
@@ -121,6 +139,32 @@ struct HourOfWeekFilter : public FilterBaseT<HourOfWeekFilter>
         state.narrowConfigs(data[state.request.timestamp.hourOfWeek()]);
     }
 
+    // The requests of a batch mostly fall within the same hour so the
+    // gmtime_r call behind hourOfWeek() is only made when the hour changes.
+    void filterBatch(const std::vector<FilterState*>& states) const
+    {
+        int64_t lastHour = -1;
+        unsigned hourOfWeek = 0;
+
+        for (FilterState* state : states) {
+            const Date& ts = state->request.timestamp;
+            ExcCheckNotEqual(ts, Date(), "Null auction date");
+
+            int64_t hour = std::floor(ts.secondsSinceEpoch() / 3600.0);
+            if (hour != lastHour) {
+                hourOfWeek = ts.hourOfWeek();
+                lastHour = hour;
+            }
+            state->narrowConfigs(data[hourOfWeek]);
+        }
+    }
+
+    bool isRequestStatic() const { return true; }
+    uint64_t hashRequest(const FilterState& state) const
+    {
+        return state.request.timestamp.hourOfWeek();
+    }
+
 private:
 
     std::array<ConfigSet, 24 * 7> data;
@@ -146,6 +190,14 @@ struct UrlFilter : public FilterBaseT<UrlFilter>
         state.narrowConfigs(impl.filter(state.request.url.toString()));
     }
 
+    bool isRequestStatic() const { return true; }
+    uint64_t hashRequest(const FilterState& state) const
+    {
+        return std::hash<std::string>()(state.request.url.toString());
+    }
+
+    bool isPreParse() const { return true; }
+
 private:
     typedef RegexFilter<boost::regex, std::string> BaseFilter;
     IncludeExcludeFilter<BaseFilter> impl;
@@ -171,6 +223,14 @@ struct HostFilter : public FilterBaseT<HostFilter>
         state.narrowConfigs(impl.filter(state.request.url));
     }
 
+    bool isRequestStatic() const { return true; }
+    uint64_t hashRequest(const FilterState& state) const
+    {
+        return std::hash<std::string>()(state.request.url.toString());
+    }
+
+    bool isPreParse() const { return true; }
+
 private:
     IncludeExcludeFilter< DomainFilter<std::string> > impl;
 };
@@ -195,6 +255,12 @@ struct LanguageFilter : public FilterBaseT<LanguageFilter>
         state.narrowConfigs(impl.filter(state.request.language.utf8String()));
     }
 
+    bool isRequestStatic() const { return true; }
+    uint64_t hashRequest(const FilterState& state) const
+    {
+        return std::hash<std::string>()(state.request.language.utf8String());
+    }
+
 private:
     typedef RegexFilter<boost::regex, std::string> BaseFilter;
     IncludeExcludeFilter<BaseFilter> impl;
@@ -221,6 +287,13 @@ struct LocationFilter : public FilterBaseT<LocationFilter>
         state.narrowConfigs(impl.filter(location));
     }
 
+    bool isRequestStatic() const { return true; }
+    uint64_t hashRequest(const FilterState& state) const
+    {
+        Datacratic::UnicodeString location = state.request.location.fullLocationString();
+        return std::hash<std::string>()(location.rawString());
+    }
+
 private:
     typedef RegexFilter<boost::u32regex, Datacratic::UnicodeString> BaseFilter;
     IncludeExcludeFilter<BaseFilter> impl;
@@ -287,6 +360,31 @@ struct ExchangeNameFilter : public FilterBaseT<ExchangeNameFilter>
         state.narrowConfigs(data.filter(state.request.exchange));
     }
 
+    // The include/exclude lookup is only redone when the exchange changes
+    // from one request of the batch to the next.
+    void filterBatch(const std::vector<FilterState*>& states) const
+    {
+        const std::string* lastExchange = nullptr;
+        ConfigSet matches;
+
+        for (FilterState* state : states) {
+            const std::string& exchange = state->request.exchange;
+            if (!lastExchange || exchange != *lastExchange) {
+                matches = data.filter(exchange);
+                lastExchange = &exchange;
+            }
+            state->narrowConfigs(matches);
+        }
+    }
+
+    bool isRequestStatic() const { return true; }
+    uint64_t hashRequest(const FilterState& state) const
+    {
+        return std::hash<std::string>()(state.request.exchange);
+    }
+
+    bool isPreParse() const { return true; }
+
 private:
     IncludeExcludeFilter< ListFilter<std::string> > data;
 };
@@ -380,6 +478,60 @@ struct LatLongDevFilter : public RTBKIT::FilterBaseT<LatLongDevFilter>
     std::unordered_map<unsigned, SquareList> squares_by_confindx;
     ConfigSet configs_with_filt;
 
+    /** Squares of many configs laid out as arrays so that the bounds checks
+        of a point against all of them don't branch.
+     */
+    struct SquareSet {
+        void add(const Square & sq, unsigned cfgIndex);
+        void remove(unsigned cfgIndex);
+        bool empty() const { return configs.empty(); }
+
+        /** Sets the configs of the squares that contain the point. */
+        void match(float x, float y, ConfigSet & result) const;
+
+        std::vector<float> x_max, x_min, y_max, y_min;
+        std::vector<unsigned> configs;
+    };
+
+    /** The squares are indexed by the cells of a grid of CELL_KMS sides
+        that they overlap so that a request is only checked against the
+        squares around it. Squares too large for the grid are kept aside and
+        always checked.
+     */
+    static constexpr float CELL_KMS = 20.0;
+    static constexpr int MAX_CELLS_PER_SIDE = 16;
+
+    std::unordered_map<uint64_t, SquareSet> grid;
+    SquareSet large_squares;
+
+    static int64_t cellOf(float coord)
+    {
+        return std::floor(coord / CELL_KMS);
+    }
+
+    static uint64_t cellKey(int64_t x, int64_t y)
+    {
+        return (uint64_t(uint32_t(x)) << 32) | uint32_t(y);
+    }
+
+    /** Calls onCell with the key of every cell overlapped by the square and
+        returns true, or returns false if the square is too large for the
+        grid.
+     */
+    template<typename Fn>
+    static bool forEachCell(const Square & sq, Fn onCell)
+    {
+        int64_t x0 = cellOf(sq.x_min), x1 = cellOf(sq.x_max);
+        int64_t y0 = cellOf(sq.y_min), y1 = cellOf(sq.y_max);
+        if (x1 - x0 >= MAX_CELLS_PER_SIDE || y1 - y0 >= MAX_CELLS_PER_SIDE)
+            return false;
+
+        for (int64_t x = x0; x <= x1; ++x)
+            for (int64_t y = y0; y <= y1; ++y)
+                onCell(cellKey(x, y));
+        return true;
+    }
+
     unsigned priority() const { return Priority::LatLong; } //low priority
 
     static constexpr float LONGITUDE_1DEGREE_KMS = 111.321;
@@ -445,4 +597,104 @@ struct LatLongDevFilter : public RTBKIT::FilterBaseT<LatLongDevFilter>
 };
 
 
+/******************************************************************************/
+/* MAX QPS FILTER                                                             */
+/******************************************************************************/
+
+/** Caps the rate of bid requests that make it through the filters for the
+    agents with a maxQps in their config.
+
+    Each config has a token bucket which allows bursts of up to 100ms worth
+    of requests. The bucket is kept as the theoretical arrival time of the
+    next request in a single atomic so that the router threads can share it
+    without locking; it's held through a shared_ptr so that copies of the
+    filter made by the FilterPool keep using the same bucket.
+
+    The filter runs after every other one so that the tokens are only spent
+    on requests that would otherwise be sent to the agent.
+ */
+struct MaxQpsFilter : public FilterBaseT<MaxQpsFilter>
+{
+    static constexpr const char* name = "MaxQps";
+    unsigned priority() const { return Priority::MaxQps; }
+
+    void addConfig(unsigned cfgIndex, const std::shared_ptr<AgentConfig>& config)
+    {
+        if (config->maxQps <= 0.0) return;
+
+        if (cfgIndex >= buckets.size())
+            buckets.resize(cfgIndex + 1);
+
+        buckets[cfgIndex] = std::make_shared<TokenBucket>(config->maxQps);
+        limited.set(cfgIndex);
+    }
+
+    void removeConfig(
+            unsigned cfgIndex, const std::shared_ptr<AgentConfig>& config)
+    {
+        if (cfgIndex < buckets.size())
+            buckets[cfgIndex].reset();
+        limited.reset(cfgIndex);
+    }
+
+    void filter(FilterState& state) const
+    {
+        ConfigSet matches = state.configs() & limited;
+        if (matches.empty()) return;
+
+        int64_t now = TokenBucket::now();
+        ConfigSet throttled;
+
+        for (size_t i = matches.next();
+             i < matches.size();
+             i = matches.next(i+1))
+        {
+            if (!buckets[i]->tryTake(now)) throttled.set(i);
+        }
+
+        if (!throttled.empty())
+            state.narrowConfigs(throttled.negate());
+    }
+
+private:
+
+    struct TokenBucket
+    {
+        TokenBucket(double qps) :
+            interval(1e9 / qps),
+            tolerance(std::max<int64_t>(interval, 100000000)),
+            nextArrival(0)
+        {}
+
+        /** Returns false if the request goes over the rate. */
+        bool tryTake(int64_t now)
+        {
+            int64_t current = nextArrival.load(std::memory_order_relaxed);
+
+            for (;;) {
+                int64_t next = std::max(current, now) + interval;
+                if (next - now > tolerance) return false;
+
+                if (nextArrival.compare_exchange_weak(current, next))
+                    return true;
+            }
+        }
+
+        static int64_t now()
+        {
+            using namespace std::chrono;
+            return duration_cast<nanoseconds>(
+                    steady_clock::now().time_since_epoch()).count();
+        }
+
+        const int64_t interval;   // ns between two requests
+        const int64_t tolerance;  // ns of requests that can be bursted
+        std::atomic<int64_t> nextArrival;
+    };
+
+    std::vector< std::shared_ptr<TokenBucket> > buckets;
+    ConfigSet limited;
+};
+
+
 } // namespace RTBKIT
@@ -309,3 +309,81 @@ BOOST_AUTO_TEST_CASE( testiPMPFilter )
     check(filter, r0, creatives, 3, { {1}, {1} });
 }
 
+
+
+/******************************************************************************/
+/* EXCHANGE FILTER                                                            */
+/******************************************************************************/
+
+namespace {
+
+/** Only keeps the creatives whose provider data is non-zero. */
+struct InfoExchangeConnector : public FilterExchangeConnector
+{
+    InfoExchangeConnector(const std::string& name) :
+        FilterExchangeConnector(name)
+    {}
+
+    bool bidRequestCreativeFilter(
+            const BidRequest&, const AgentConfig&, const void* info) const
+    {
+        return *reinterpret_cast<const int*>(info) != 0;
+    }
+};
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_CASE( testExchangeFilter )
+{
+    CreativeExchangeFilter filter;
+    CreativeMatrix creatives;
+
+    auto addCr = [] (AgentConfig& cfg,
+                     const std::initializer_list<std::string>& exchanges,
+                     int info = 1)
+    {
+        cfg.creatives.emplace_back();
+        for (const auto& exchange : exchanges)
+            cfg.creatives.back().providerData[exchange] =
+                std::make_shared<int>(info);
+    };
+
+    AgentConfig c0;
+    addCr(c0, { "bob" });
+    addCr(c0, { "alice" });
+    addCr(c0, { "bob", "alice" }, 0);
+
+    AgentConfig c1;
+    addCr(c1, { "bob" }, 0);
+    addCr(c1, {});
+
+    BidRequest r0;
+    addImp(r0, OpenRTB::AdPosition::ABOVE, { {100, 100} });
+    addImp(r0, OpenRTB::AdPosition::ABOVE, { {200, 200} });
+
+    title("exchange-1");
+    addConfig(filter, 0, c0, creatives);
+    addConfig(filter, 1, c1, creatives);
+
+    check(filter, r0, creatives, 0, { {0, 1}, {}, {0} });
+    check(filter, r0, creatives, 1, { {0, 1}, {}, {0} });
+
+    {
+        InfoExchangeConnector conn("bob");
+        FilterState state(r0, &conn, creatives);
+        filter.filter(state);
+        check(state.creatives(0), { {0} });
+    }
+
+    {
+        InfoExchangeConnector conn("carol");
+        FilterState state(r0, &conn, creatives);
+        filter.filter(state);
+        check(state.creatives(0), {});
+    }
+
+    title("exchange-2");
+    removeConfig(filter, 0, c0, creatives);
+
+    check(filter, r0, creatives, 0, { {1} });
+}
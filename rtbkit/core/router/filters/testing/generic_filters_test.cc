@@ -13,6 +13,7 @@
 #include "rtbkit/core/router/filters/generic_filters.h"
 
 #include <boost/test/unit_test.hpp>
+#include <set>
 
 using namespace std;
 using namespace RTBKIT;
@@ -25,6 +26,56 @@ vector<T> makeList(const initializer_list<T>& list)
     return vector<T>(list.begin(), list.end());
 };
 
+BOOST_AUTO_TEST_CASE(requiredLiteralTest)
+{
+    auto doCheck = [] (const string& pattern, const string& literal, bool exact) {
+        RequiredLiteral result = requiredLiteral(boost::regex(pattern));
+        BOOST_CHECK_EQUAL(result.literal, literal);
+        BOOST_CHECK_EQUAL(result.exact, exact);
+    };
+
+    doCheck("abc",           "abc",      true);
+    doCheck("foo\\.com",     "foo.com",  true);
+    doCheck("^http://a+b",   "http://a", false);
+    doCheck("x(y|z)w",       "x",        false);
+    doCheck("ab*c",          "a",        false);
+    doCheck("a{2,3}bc",      "bc",       false);
+    doCheck("[abc]def",      "def",      false);
+    doCheck("sport(s)?\\.",  "sport",    false);
+    doCheck("(?:ab)+cd",     "cd",       false);
+
+    // Things that we can't or won't analyze.
+    doCheck("a|b",           "",         false);
+    doCheck("(?i)abc",       "",         false);
+    doCheck("a\\Qb",         "",         false);
+    doCheck("[[:alpha:]]x",  "",         false);
+
+    RequiredLiteral icase =
+        requiredLiteral(boost::regex("abc", boost::regex::icase));
+    BOOST_CHECK(icase.empty());
+}
+
+BOOST_AUTO_TEST_CASE(literalMatcherTest)
+{
+    vector<string> literals = { "he", "she", "his", "hers", "a", "aa", "bc" };
+
+    LiteralMatcher matcher;
+    for (const auto& literal : literals) matcher.add(literal);
+    matcher.compile();
+
+    for (string str : { "ushers", "ahishers", "aaabcx", "", "zzz" }) {
+        set<unsigned> result;
+        matcher.match(str, [&] (unsigned id) { result.insert(id); });
+
+        set<unsigned> expected;
+        for (unsigned i = 0; i < literals.size(); ++i) {
+            if (str.find(literals[i]) != string::npos) expected.insert(i);
+        }
+
+        BOOST_CHECK(result == expected);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(listFilterTest)
 {
     ListFilter<size_t> filter;
@@ -174,6 +225,32 @@ BOOST_AUTO_TEST_CASE(domainFilterTest)
     check(filter.filter(Url("random.net")),      { });
 }
 
+BOOST_AUTO_TEST_CASE(domainFilterLabelsTest)
+{
+    DomainFilter<std::string> filter;
+
+    filter.addConfig(0, makeList<string>({ "ogle.com" }));
+    filter.addConfig(1, makeList<string>({ "a.b.c.d" }));
+    filter.addConfig(2, makeList<string>({ "b.c.d", "google.com" }));
+
+    title("domain-labels-1");
+    check(filter.filter(Url("google.com")),     { 2 });
+    check(filter.filter(Url("ogle.com")),       { 0 });
+    check(filter.filter(Url("www.ogle.com")),   { 0 });
+    check(filter.filter(Url("x.a.b.c.d")),      { 1, 2 });
+    check(filter.filter(Url("a.b.c.d")),        { 1, 2 });
+    check(filter.filter(Url("c.d")),            { });
+    check(filter.filter(Url("d")),              { });
+
+    title("domain-labels-2");
+    filter.removeConfig(2, makeList<string>({ "b.c.d" }));
+    filter.removeConfig(1, makeList<string>({ "not.there" }));
+
+    check(filter.filter(Url("x.a.b.c.d")),      { 1 });
+    check(filter.filter(Url("b.c.d")),          { });
+    check(filter.filter(Url("google.com")),     { 2 });
+}
+
 BOOST_AUTO_TEST_CASE(regexFilterTest)
 {
     using boost::regex;
@@ -219,6 +296,37 @@ BOOST_AUTO_TEST_CASE(regexFilterTest)
     check(filter.filter("d"),   { });
 }
 
+BOOST_AUTO_TEST_CASE(regexFilterLiteralTest)
+{
+    using boost::regex;
+
+    vector<string> patterns = {
+        "abc", "foo\\.com", "^http://a+b", "x(y|z)w", "ab*c", "(?i)abc",
+        "a|b", "[abc]def", "de\\d+fg", "\\bcar\\b", "q?rs", "a.b", "ab$"
+    };
+
+    vector<string> values = {
+        "abc", "xabcx", "foo.com", "foocom", "http://aab", "http://b", "xyw",
+        "xw", "ac", "abbc", "ABC", "a", "adef", "de12fg", "defg", "a car b",
+        "qrs", "rs", "axb", "abx", ""
+    };
+
+    RegexFilter<regex, string> filter;
+    for (size_t i = 0; i < patterns.size(); ++i)
+        filter.addConfig(i, makeList({ regex(patterns[i]) }));
+
+    for (const auto& value : values) {
+        ConfigSet expected;
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            if (boost::regex_search(value, regex(patterns[i])))
+                expected.set(i);
+        }
+
+        ConfigSet diff = filter.filter(value) ^ expected;
+        BOOST_CHECK_MESSAGE(diff.empty(), value << ": " << diff.print());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(segmentListTest)
 {
     SegmentListFilter filter;
@@ -313,3 +421,57 @@ BOOST_AUTO_TEST_CASE(includeExcludeFilterTest)
     doCheck(filter.filter(4), { 1, 2 });
     doCheck(filter.filter(5), { 1, 2 });
 }
+
+BOOST_AUTO_TEST_CASE(segmentIndexTest)
+{
+    SegmentIndex index;
+    IncludeExcludeFilter<SegmentListFilter> legacy;
+
+    auto doCheck = [&] (const SegmentList& segments) {
+        ConfigSet mask;
+        for (size_t i = 0; i < 4; ++i) mask.set(i);
+
+        ConfigSet expected = legacy.filter(segments) & mask;
+        ConfigSet result = index.filter(segments) & mask;
+
+        BOOST_CHECK_EQUAL(result.print(), expected.print());
+    };
+
+    auto setConfig = [&] (
+            unsigned cfg, bool value,
+            const SegmentList& include, const SegmentList& exclude)
+    {
+        index.setInclude(cfg, value, include);
+        index.setExclude(cfg, value, exclude);
+        legacy.setInclude(cfg, value, include);
+        legacy.setExclude(cfg, value, exclude);
+    };
+
+    vector<SegmentList> requests = {
+        segment(), segment(1), segment(2, 3), segment("a"),
+        segment(1, "b"), segment("c", 4), segment(5), segment(1, 2, 3, "a")
+    };
+
+    auto checkAll = [&] {
+        for (const auto& request : requests) doCheck(request);
+    };
+
+    title("index-1");
+    checkAll();
+
+    title("index-2");
+    setConfig(0, true, segment(1, 2),   segment());
+    setConfig(1, true, segment(),       segment(1, "a"));
+    setConfig(2, true, segment("a", 3), segment(2, "c"));
+    setConfig(3, true, segment(4, "b"), segment(3));
+    checkAll();
+
+    title("index-3");
+    setConfig(2, false, segment("a", 3), segment(2, "c"));
+    checkAll();
+
+    title("index-4");
+    setConfig(1, false, segment(), segment(1, "a"));
+    setConfig(0, false, segment(1, 2), segment());
+    checkAll();
+}
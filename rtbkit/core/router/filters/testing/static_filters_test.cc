@@ -23,6 +23,7 @@
 #include "jml/utils/vector_utils.h"
 
 #include <boost/test/unit_test.hpp>
+#include <random>
 
 using namespace std;
 using namespace ML;
@@ -488,6 +489,105 @@ BOOST_AUTO_TEST_CASE( exchangeName )
     doCheck(req, "adx", { });
 }
 
+/** The request static filters must only hash the fields they depend on so
+    that FilterPool can cache their result.
+ */
+BOOST_AUTO_TEST_CASE( requestStaticHash )
+{
+    ExchangeNameFilter exchangeFilter;
+    UrlFilter urlFilter;
+    HourOfWeekFilter hourFilter;
+    SegmentsFilter segmentsFilter;
+
+    BOOST_CHECK(exchangeFilter.isRequestStatic());
+    BOOST_CHECK(urlFilter.isRequestStatic());
+    BOOST_CHECK(hourFilter.isRequestStatic());
+    BOOST_CHECK(!segmentsFilter.isRequestStatic());
+
+    FilterExchangeConnector conn("ex0");
+    CreativeMatrix activeConfigs;
+
+    auto hash = [&] (const FilterBase& filter, const BidRequest& request) {
+        FilterState state(request, &conn, activeConfigs);
+        return filter.hashRequest(state);
+    };
+
+    BidRequest r0;
+    r0.exchange = "ex0";
+    r0.url = Url("http://www.example.com/a");
+    r0.timestamp = Date::fromSecondsSinceEpoch(1376000000);
+
+    BidRequest r1 = r0;
+    r1.auctionId = Id("bob");
+    addSegment(r1, "seg1", segment(1));
+
+    BOOST_CHECK_EQUAL(hash(exchangeFilter, r0), hash(exchangeFilter, r1));
+    BOOST_CHECK_EQUAL(hash(urlFilter, r0), hash(urlFilter, r1));
+    BOOST_CHECK_EQUAL(hash(hourFilter, r0), hash(hourFilter, r1));
+
+    BidRequest r2 = r0;
+    r2.exchange = "ex1";
+    r2.url = Url("http://www.example.com/b");
+    r2.timestamp = r0.timestamp.plusSeconds(60 * 60);
+
+    BOOST_CHECK_NE(hash(exchangeFilter, r0), hash(exchangeFilter, r2));
+    BOOST_CHECK_NE(hash(urlFilter, r0), hash(urlFilter, r2));
+    BOOST_CHECK_NE(hash(hourFilter, r0), hash(hourFilter, r2));
+}
+
+/** The batch versions of the filters must give the same result as running the
+    filter on each request in turn.
+ */
+BOOST_AUTO_TEST_CASE( filterBatch )
+{
+    ExchangeNameFilter exchangeFilter;
+    HourOfWeekFilter hourFilter;
+
+    AgentConfig c0;
+    c0.exchangeFilter = ie<string>({ "ex0" }, {});
+    c0.hourOfWeekFilter.hourBitmap.reset();
+    for (size_t i = 0; i < 168; i += 2) c0.hourOfWeekFilter.hourBitmap.set(i);
+
+    AgentConfig c1;
+    c1.exchangeFilter = ie<string>({}, { "ex0" });
+
+    for (FilterBase* filter : { (FilterBase*) &exchangeFilter, (FilterBase*) &hourFilter }) {
+        addConfig(*filter, 0, c0);
+        addConfig(*filter, 1, c1);
+    }
+
+    FilterExchangeConnector conn("ex0");
+    CreativeMatrix activeConfigs;
+    activeConfigs.setConfig(0, 1);
+    activeConfigs.setConfig(1, 1);
+
+    // Runs of the same exchange and hour with a few changes in between.
+    vector<BidRequest> requests(40);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        requests[i].exchange = (i / 7) % 2 ? "ex1" : "ex0";
+        requests[i].timestamp =
+            Date::fromSecondsSinceEpoch(1376000000 + i * 10 * 60);
+    }
+
+    for (const FilterBase* filter : { (FilterBase*) &exchangeFilter, (FilterBase*) &hourFilter }) {
+        title(filter->name());
+
+        vector<FilterState> states;
+        for (const BidRequest& request : requests)
+            states.emplace_back(request, &conn, activeConfigs);
+
+        vector<FilterState*> batch;
+        for (FilterState& state : states) batch.push_back(&state);
+        filter->filterBatch(batch);
+
+        for (size_t i = 0; i < requests.size(); ++i) {
+            FilterState state(requests[i], &conn, activeConfigs);
+            filter->filter(state);
+            BOOST_CHECK_EQUAL(states[i].configs().print(), state.configs().print());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE( requiredIds )
 {
     RequiredIdsFilter filter;
@@ -698,3 +798,130 @@ BOOST_AUTO_TEST_CASE( LatLongDevFilterTest)
     doCheck(br9, { 2, 3});
 
 }
+
+
+/** Checks the grid index of the filter against going through all the squares
+    of all the configs, with radiuses both small enough for the grid and too
+    large for it.
+ */
+BOOST_AUTO_TEST_CASE( LatLongDevFilterIndex )
+{
+    LatLongDevFilter filt;
+    ConfigSet mask;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> latDist(40.0, 46.0);
+    std::uniform_real_distribution<float> lonDist(-80.0, -70.0);
+    std::uniform_real_distribution<float> unitDist(0.0, 1.0);
+
+    vector<AgentConfig> configs(200);
+    for (unsigned i = 0; i < configs.size(); ++i) {
+        for (unsigned j = 0; j < i % 3 + 1; ++j) {
+            // Mostly hyperlocal with a few large areas.
+            float radius = unitDist(rng) < 0.9 ? unitDist(rng) * 30.0 : 500.0;
+            configs[i].latLongDevFilter.latlonrads.emplace_back(
+                    latDist(rng), lonDist(rng), radius);
+        }
+        addConfig(filt, i, configs[i]);
+        mask.set(i);
+    }
+
+    auto checkAll = [&] {
+        for (unsigned iter = 0; iter < 1000; ++iter) {
+            BidRequest request;
+            request.device.emplace();
+            request.device->geo.emplace();
+            request.device->geo->lat.val = latDist(rng);
+            request.device->geo->lon.val = lonDist(rng);
+
+            ConfigSet expected;
+            for (size_t i = mask.next(); i < mask.size(); i = mask.next(i + 1)) {
+                auto squares = filt.squares_by_confindx.find(i);
+                if (LatLongDevFilter::pointInsideAnySquare(
+                                request.device->geo->lat.val,
+                                request.device->geo->lon.val,
+                                squares->second))
+                    expected.set(i);
+            }
+
+            FilterExchangeConnector conn("exch0");
+            request.imp.emplace_back();
+
+            CreativeMatrix activeConfigs;
+            for (size_t i = mask.next(); i < mask.size(); i = mask.next(i + 1))
+                activeConfigs.setConfig(i, 1);
+
+            FilterState state(request, &conn, activeConfigs);
+            filt.filter(state);
+
+            ConfigSet diff = state.configs() & mask;
+            diff ^= expected;
+            BOOST_CHECK(diff.empty());
+        }
+    };
+
+    title("Latitude/Longitude Index - all");
+    checkAll();
+
+    for (unsigned i = 0; i < configs.size(); i += 2) {
+        removeConfig(filt, i, configs[i]);
+        mask.reset(i);
+    }
+
+    title("Latitude/Longitude Index - removed");
+    checkAll();
+}
+
+
+/******************************************************************************/
+/* MAX QPS FILTER                                                             */
+/******************************************************************************/
+
+BOOST_AUTO_TEST_CASE( maxQps )
+{
+    MaxQpsFilter filter;
+    ConfigSet mask;
+
+    AgentConfig c0;
+    AgentConfig c1; c1.maxQps = 10;    // bursts of 1 request
+    AgentConfig c2; c2.maxQps = 100;   // bursts of 10 requests
+
+    title("maxQps-1");
+    addConfig(filter, 0, c0); mask.set(0);
+    addConfig(filter, 1, c1); mask.set(1);
+    addConfig(filter, 2, c2); mask.set(2);
+
+    std::vector<size_t> passed(3);
+
+    // Assumes the loop runs in well under 10ms.
+    for (size_t i = 0; i < 20; ++i) {
+        BidRequest request;
+        request.imp.emplace_back();
+
+        CreativeMatrix activeConfigs;
+        for (size_t cfg = mask.next(); cfg < mask.size(); cfg = mask.next(cfg+1))
+            activeConfigs.setConfig(cfg, 1);
+
+        FilterState state(request, nullptr, activeConfigs);
+        filter.filter(state);
+
+        for (size_t cfg = 0; cfg < passed.size(); ++cfg)
+            if (state.configs().test(cfg)) passed[cfg]++;
+    }
+
+    BOOST_CHECK_EQUAL(passed[0], 20);
+    BOOST_CHECK_EQUAL(passed[1], 1);
+    BOOST_CHECK_EQUAL(passed[2], 10);
+
+    // The buckets are shared with the copies of the filter.
+    std::unique_ptr<FilterBase> copy(filter.clone());
+    BidRequest r0;
+    check(*copy, r0, "ex1", mask, { 0 });
+
+    title("maxQps-2");
+    removeConfig(filter, 1, c1);
+    addConfig(filter, 1, c0);
+
+    BidRequest r1;
+    check(filter, r1, "ex1", mask, { 0, 1 });
+}
@@ -17,7 +17,6 @@
 #include "jml/utils/set_utils.h"
 #include "jml/utils/environment.h"
 #include "jml/arch/info.h"
-#include "jml/utils/lightweight_hash.h"
 #include "jml/math/xdiv.h"
 #include <boost/tuple/tuple.hpp>
 #include "jml/utils/pair_utils.h"
@@ -34,6 +33,9 @@
 #include "rtbkit/common/win_cost_model.h"
 #include "rtbkit/common/bidder_interface.h"
 #include "rtbkit/common/analytics.h"
+#include "rtbkit/common/mem_usage.h"
+#include <sys/eventfd.h>
+#include <poll.h>
 
 using namespace std;
 using namespace ML;
@@ -56,6 +58,67 @@ toJson() const
     return result;
 }
 
+
+/*****************************************************************************/
+/* ALL AGENT INFO                                                            */
+/*****************************************************************************/
+
+void
+AllAgentInfo::
+index()
+{
+    agentIndex.clear();
+    configIndex.clear();
+    accountIndex.clear();
+    accountSlots.clear();
+
+    std::unordered_map<AccountKey, std::vector<int> > accounts;
+
+    for (int i = 0;  i < size();  ++i) {
+        const AgentInfoEntry & entry = (*this)[i];
+
+        agentIndex[entry.name] = i;
+
+        if (entry.filterIndex >= configIndex.size())
+            configIndex.resize(entry.filterIndex + 1, -1);
+        configIndex[entry.filterIndex] = i;
+
+        accounts[entry.config->account].push_back(i);
+    }
+
+    accountSlots.reserve(size());
+    for (const auto & account: accounts) {
+        int begin = accountSlots.size();
+        accountSlots.insert(accountSlots.end(),
+                            account.second.begin(), account.second.end());
+        accountIndex[account.first] = { begin, int(accountSlots.size()) };
+    }
+}
+
+const AgentInfoEntry *
+AllAgentInfo::
+find(const std::string & agent) const
+{
+    auto it = agentIndex.find(agent);
+    if (it == agentIndex.end())
+        return nullptr;
+    return &(*this)[it->second];
+}
+
+const AgentInfoEntry *
+AllAgentInfo::
+find(unsigned configIndex, const std::string & agent) const
+{
+    if (configIndex < this->configIndex.size()) {
+        int slot = this->configIndex[configIndex];
+        if (slot != -1 && (*this)[slot].name == agent)
+            return &(*this)[slot];
+    }
+
+    // The config index has been given to another agent since
+    return find(agent);
+}
+
 /*****************************************************************************/
 /* AUCTION DEBUG INFO                                                        */
 /*****************************************************************************/
@@ -103,6 +166,56 @@ dumpSpot(Id spot) const
 }
 
 
+/*****************************************************************************/
+/* AUCTION SHARD                                                             */
+/*****************************************************************************/
+
+AuctionShard::
+AuctionShard(unsigned index)
+    : index(index),
+      startBiddingBuffer(65536),
+      submittedBuffer(65536),
+      doBidBuffer(65536),
+      agentBidBuffer(65536),
+      wakeup(EFD_NONBLOCK)
+{
+}
+
+bool
+AuctionShard::
+trackBidInFlight(const std::string & agent,
+                 const std::shared_ptr<AgentStatus> & status,
+                 const Id & auctionId, Date date)
+{
+    AgentBids & entry = bidsInFlight[agent];
+
+    // The agent went away and came back; what we had belongs to the old one
+    if (entry.status != status) {
+        entry.status = status;
+        entry.bids.clear();
+    }
+
+    if (!entry.bids.insert(make_pair(auctionId, date)).second)
+        return false;
+
+    ML::atomic_inc(status->numBidsInFlight);
+    return true;
+}
+
+bool
+AuctionShard::
+expireBidInFlight(const std::string & agent, const Id & auctionId)
+{
+    auto it = bidsInFlight.find(agent);
+    if (it == bidsInFlight.end()) return false;
+
+    if (!it->second.bids.erase(auctionId)) return false;
+
+    ML::atomic_dec(it->second.status->numBidsInFlight);
+    return true;
+}
+
+
 /*****************************************************************************/
 /* ROUTER                                                                    */
 /*****************************************************************************/
@@ -124,13 +237,11 @@ Router(ServiceBase & parent,
       postAuctionEndpoint(*this),
       configBuffer(1024),
       exchangeBuffer(64),
-      startBiddingBuffer(65536),
-      submittedBuffer(65536),
       auctionGraveyard(65536),
-      doBidBuffer(65536),
       augmentationLoop(*this),
       loopMonitor(*this),
       loadStabilizer(loopMonitor),
+      numLockContentions(0),
       secondsUntilLossAssumed_(secondsUntilLossAssumed),
       globalBidProbability(1.0),
       bidsErrorRate(0.0),
@@ -140,6 +251,7 @@ Router(ServiceBase & parent,
       allAgents(new AllAgentInfo()),
       configListener(getZmqContext()),
       initialized(false),
+      exchanges(exchangesGc),
       bridge(getZmqContext()),
       logAuctions(logAuctions),
       logBids(logBids),
@@ -155,8 +267,13 @@ Router(ServiceBase & parent,
       monitorProviderClient(getZmqContext()),
       maxBidAmount(maxBidAmount),
       slowModeTolerance(MonitorClient::DefaultTolerance),
-      augmentationWindow(augmentationWindow)
+      augmentationWindow(augmentationWindow),
+      earlyBlacklistFilter(false),
+      skipSlowAgents(true),
+      agentShm(false),
+      agentBroadcast(0)
 {
+    shards.emplace_back(new AuctionShard(0));
     monitorProviderClient.addProvider(this);
 }
 
@@ -177,13 +294,11 @@ Router(std::shared_ptr<ServiceProxies> services,
       postAuctionEndpoint(*this),
       configBuffer(1024),
       exchangeBuffer(64),
-      startBiddingBuffer(65536),
-      submittedBuffer(65536),
       auctionGraveyard(65536),
-      doBidBuffer(65536),
       augmentationLoop(*this),
       loopMonitor(*this),
       loadStabilizer(loopMonitor),
+      numLockContentions(0),
       secondsUntilLossAssumed_(secondsUntilLossAssumed),
       globalBidProbability(1.0),
       bidsErrorRate(0.0),
@@ -193,6 +308,7 @@ Router(std::shared_ptr<ServiceProxies> services,
       allAgents(new AllAgentInfo()),
       configListener(getZmqContext()),
       initialized(false),
+      exchanges(exchangesGc),
       bridge(getZmqContext()),
       logAuctions(logAuctions),
       logBids(logBids),
@@ -208,9 +324,14 @@ Router(std::shared_ptr<ServiceProxies> services,
       monitorProviderClient(getZmqContext()),
       maxBidAmount(maxBidAmount),
       slowModeTolerance(MonitorClient::DefaultTolerance),
-      augmentationWindow(augmentationWindow)
+      augmentationWindow(augmentationWindow),
+      earlyBlacklistFilter(false),
+      skipSlowAgents(true),
+      agentShm(false),
+      agentBroadcast(0)
 
 {
+    shards.emplace_back(new AuctionShard(0));
     monitorProviderClient.addProvider(this);
 }
 
@@ -225,8 +346,10 @@ initBidderInterface(Json::Value const & json)
 
 void
 Router::
-initAnalyticsPublisher(const string & baseUrl, const int numConnections)
+initAnalyticsPublisher(const string & baseUrl, const int numConnections,
+                       bool http2)
 {
+    analyticsPublisher.enableHttp2(http2);
     analyticsPublisher.init(baseUrl, numConnections);
 }
 
@@ -252,6 +375,39 @@ initExchange(const std::string & type,
     exchangeBuffer.push(item);
 }
 
+Router::Guard
+Router::
+lockControlPlane() const
+{
+    Guard guard(lock, std::try_to_lock);
+    if (guard.owns_lock())
+        return guard;
+
+    ML::atomic_inc(numLockContentions);
+
+    Date before = Date::now();
+    guard.lock();
+
+    recordHit("controlPlaneLock.contended");
+    recordOutcome(Date::now().secondsSince(before) * 1000.0,
+                  "controlPlaneLock.waitMs");
+    return guard;
+}
+
+void
+Router::
+publishExchange(const std::shared_ptr<ExchangeConnector> & exchange)
+{
+    Guard guard(lockControlPlane());
+
+    // Writers are serialized by the lock so the current version can't
+    // change under us
+    std::unique_ptr<Exchanges> newExchanges
+        (new Exchanges(*exchanges.unsafePtr()));
+    newExchanges->push_back(exchange);
+    exchanges.replace(newExchanges.release());
+}
+
 void
 Router::
 initExchange(const Json::Value & exchangeConfig)
@@ -371,6 +527,11 @@ init()
     registerServiceProvider(serviceName(), { "rtbRequestRouter" });
 
     filters.init(this);
+    filters.useHugePages(getHugePageMode("filterCache"));
+    blacklist.useHugePages(getHugePageMode("blacklist"));
+    for (auto & shard: shards)
+        shard->inFlight.useArena(ML::huge_page_arena(getHugePageMode("inFlight")));
+    allAgentsGc.reclaimInBackground();
 
     banker.reset(new NullBanker());
 
@@ -385,6 +546,9 @@ init()
     if (analytics) analytics->init();
 
     bridge.agents.init(getServices()->config, serviceName() + "/agents");
+    // A slow agent's messages wait in its own queue instead of holding up
+    // the others; they're flushed by our loop as we drive the socket.
+    bridge.agents.enablePeerQueues();
     bridge.agents.clientMessageHandler
         = std::bind(&Router::handleAgentMessage, this, std::placeholders::_1);
     bridge.agents.onConnection = [=] (const std::string & agent)
@@ -395,12 +559,17 @@ init()
     bridge.agents.onDisconnection = [=] (const std::string & agent)
         {
             cerr << "agent " << agent << " disconnected from router" << endl;
+            bridge.removeShm(agent);
+            bridge.unsubscribeBroadcast(agent);
         };
 
+    if (agentShm)
+        bridge.enableShm(getServices()->config, serviceName());
+
     configListener.onConfigChange = [=] (const std::string & agent,
                                          std::shared_ptr<const AgentConfig> config)
         {
-            configBuffer.push(make_pair(agent, config));
+            configBuffer.push(compileConfig(agent, config));
         };
 
     onSubmittedAuction = [=] (std::shared_ptr<Auction> auction,
@@ -413,6 +582,12 @@ init()
     monitorClient.init(getServices()->config);
     monitorProviderClient.init(getServices()->config);
 
+    placeMessageLoop("augmentationLoop", augmentationLoop);
+    placeMessageLoop("configListener", configListener);
+    placeMessageLoop("monitorClient", monitorClient);
+    placeMessageLoop("monitorProviderClient", monitorProviderClient);
+    placeMessageLoop("loopMonitor", loopMonitor);
+
     loopMonitor.init();
     loopMonitor.addMessageLoop("augmentationLoop", &augmentationLoop);
     loopMonitor.addMessageLoop("configListener", &configListener);
@@ -428,6 +603,14 @@ init()
                 keepProb -= loadStabilizer.shedProbability();
             }
 
+            // Ramp the auctions down and back up with the health of the
+            // system. The slow mode's trickle takes over once it's down to
+            // zero so we keep a small share of the auctions flowing.
+            double acceptRatio = monitorClient.updateAcceptRatio(
+                    loopMonitor.getUpdatePeriod(), slowModeTolerance);
+            keepProb *= std::max(acceptRatio, 0.01);
+            recordLevel(acceptRatio, "monitor.acceptRatio");
+
             setAcceptAuctionProbability(keepProb);
             recordEvent("auctionKeepPercentage", ET_LEVEL, keepProb * 100.0);
         };
@@ -462,6 +645,12 @@ bindTcp()
 {
     if (analytics) analytics->bindTcp();
     bridge.agents.bindTcp(getServices()->ports->getRange("router"));
+
+    if (agentBroadcast > 0) {
+        bridge.broadcastMinAgents = agentBroadcast;
+        bridge.enableBroadcast(getServices()->config, serviceName(),
+                               getServices()->ports->getRange("router"));
+    }
 }
 
 void
@@ -513,6 +702,25 @@ unsafeDisableAuctionProbability()
     disableAuctionProb = true;
 }
 
+void
+Router::
+setNumAuctionShards(unsigned numShards)
+{
+    if (runThread)
+        throw Exception("can't change the number of shards of a running router");
+    if (numShards == 0)
+        throw Exception("router needs at least one auction shard");
+
+    shards.clear();
+    for (unsigned i = 0;  i < numShards;  ++i) {
+        shards.emplace_back(new AuctionShard(i));
+
+        // Each shard thread gets an arena of its own
+        shards.back()->inFlight.useArena(
+                ML::huge_page_arena(getHugePageMode("inFlight")));
+    }
+}
+
 void
 Router::
 start(boost::function<void ()> onStop)
@@ -527,11 +735,13 @@ start(boost::function<void ()> onStop)
 
     auto runfn = [=] ()
         {
+            this->placeCurrentThread("main");
             this->run();
             if (onStop) onStop();
         };
 
-    for ( auto & exchange : exchanges) {
+    auto currentExchanges = exchanges();
+    for ( auto & exchange : *currentExchanges) {
         exchange->start();
         connectExchange(*exchange);
     }
@@ -540,6 +750,18 @@ start(boost::function<void ()> onStop)
     if (analytics) analytics->start();
     analyticsPublisher.start();
     augmentationLoop.start();
+
+    if (threadedShards()) {
+        for (auto & shard : shards) {
+            AuctionShard * s = shard.get();
+            shard->thread.reset(new boost::thread([=] ()
+                {
+                    this->placeCurrentThread("shards");
+                    this->runShard(*s);
+                }));
+        }
+    }
+
     runThread.reset(new boost::thread(runfn));
 
     if (connectPostAuctionLoop) {
@@ -579,12 +801,8 @@ size_t
 Router::
 numNonIdle() const
 {
-    size_t numInFlight, numAwaitingAugmentation;
-    {
-        Guard guard(lock);
-        numInFlight = inFlight.size();
-        numAwaitingAugmentation = augmentationLoop.numAugmenting();
-    }
+    size_t numInFlight = numAuctionsInProgress();
+    size_t numAwaitingAugmentation = augmentationLoop.numAugmenting();
 
     cerr << "numInFlight = " << numInFlight << endl;
     cerr << "numAwaitingAugmentation = " << numAwaitingAugmentation << endl;
@@ -623,13 +841,32 @@ run()
 {
     using namespace std;
 
-    zmq_pollitem_t items [] = {
+    // When the shards don't have their own threads, the auctions are
+    // processed here and we need to wake up when they have work for us.
+    AuctionShard * shard = threadedShards() ? nullptr : shards[0].get();
+
+    zmq_pollitem_t items [5] = {
         { bridge.agents.getSocketUnsafe(), 0, ZMQ_POLLIN, 0 },
-        { 0, wakeupMainLoop.fd(), ZMQ_POLLIN, 0 }
+        { 0, wakeupMainLoop.fd(), ZMQ_POLLIN, 0 },
+        { 0, bridge.agents.peerQueueFd(), ZMQ_POLLIN, 0 }
     };
+    int numItems = 3;
+
+    // Agents on shared memory signal this when we're waiting on them
+    int shmItem = -1;
+    if (bridge.shmWakeup) {
+        shmItem = numItems++;
+        items[shmItem] = { 0, bridge.shmWakeup->fd(), ZMQ_POLLIN, 0 };
+    }
+
+    int shardItem = -1;
+    if (shard) {
+        shardItem = numItems++;
+        items[shardItem] = { 0, shard->wakeup.fd(), ZMQ_POLLIN, 0 };
+    }
 
     double last_check = ML::wall_time(), last_check_pace = last_check,
-        lastPings = last_check;
+        lastPings = last_check, lastPeerFlush = last_check;
 
     //cerr << "server listening" << endl;
 
@@ -674,6 +911,23 @@ run()
         times[std::move(name)].add(microsecondsBetween(getTime(), start));
     };
 
+    auto onAgentMessage = [&] (vector<string> && message)
+        {
+            double atStart = getTime();
+            string topic = message.size() > 1 ? message[1] : "";
+            try {
+                bridge.agents.handleMessage(std::move(message));
+            } catch (const std::exception & exc) {
+                cerr << "error handling agent message " << message
+                     << ": " << exc.what() << endl;
+                logRouterError("handleAgentMessage", exc.what(),
+                               message);
+
+                if (analytics) analytics->logRouterErrorMessage("handleAgentMessage", exc.what(), message);
+            }
+
+            recordTime(topic, atStart);
+        };
 
     // Attempt to wake up once per millisecond
 
@@ -690,7 +944,7 @@ run()
             double atStart = getTime();
 
             for (unsigned i = 0;  i < 20 && rc == 0;  ++i)
-                rc = zmq_poll(items, 2, 0);
+                rc = zmq_poll(items, numItems, 0);
 
             recordTime("spinPoll", atStart);
         }
@@ -704,6 +958,11 @@ run()
                 recordTime("checkExpiredAuctions", atStart);
             }
 
+            // Nothing else to do so don't hold the batched auctions back
+            // while we sleep.
+            if (connectPostAuctionLoop)
+                postAuctionEndpoint.flush(true /* force */);
+
             {
                 double atStart = getTime();
 
@@ -721,7 +980,7 @@ run()
             }
 
             double pollStart = getTime();
-            rc = zmq_poll(items, 2, 50 /* milliseconds */);
+            rc = zmq_poll(items, numItems, 50 /* milliseconds */);
             recordTime("sleepPoll", pollStart);
         }
 
@@ -734,22 +993,19 @@ run()
             cerr << "zeromq error: " << zmq_strerror(zmq_errno()) << endl;
         }
 
-        {
+        if (shard) {
             double atStart = getTime();
-            std::shared_ptr<AugmentationInfo> info;
-            while (startBiddingBuffer.tryPop(info)) {
-                doStartBidding(info);
-            }
+            startBidding(*shard);
 
             recordTime("doStartBidding", atStart);
         }
 
-        {
+        if (shard) {
             double atStart = getTime();
 
             BidMessage message;
-            while (doBidBuffer.tryPop(message)) {
-                doBidImpl(message);
+            while (shard->doBidBuffer.tryPop(message)) {
+                doBidImpl(message, *shard);
             }
 
             recordTime("doBid", atStart);
@@ -759,64 +1015,109 @@ run()
             double atStart = getTime();
 
             std::shared_ptr<ExchangeConnector> exchange;
+            bool reconfigured = false;
             while (exchangeBuffer.tryPop(exchange)) {
                 for (auto & agent : agents) {
                     configureAgentOnExchange(exchange,
                                              agent.first,
                                              *agent.second.config);
+                    if (agent.second.configured) reconfigured = true;
                 };
             }
 
+            // The creative filters precompute their tables from the provider
+            // data so they need to see the new exchanges.  Re-adding a config
+            // can move it to another filter index.
+            if (reconfigured) {
+                FilterPool::ConfigUpdates updates;
+                for (auto & agent : agents) {
+                    if (agent.second.configured)
+                        updates.emplace_back(agent.first, &agent.second);
+                }
+
+                auto indexes = filters.updateConfigs(updates);
+                for (size_t i = 0; i < updates.size(); ++i)
+                    agents[updates[i].first].filterIndex = indexes[i];
+
+                updateAllAgents();
+            }
+
             recordTime("configureAgentOnExchange", atStart);
         }
 
         {
             double atStart = getTime();
 
-            std::pair<std::string, std::shared_ptr<const AgentConfig> > config;
+            // Only the latest configuration of each agent is applied.
+            std::map<std::string, PendingConfig> configs;
+            PendingConfig config;
             while (configBuffer.tryPop(config)) {
-                doConfig(config.first, config.second);
+                std::string agent = config.agent;
+                configs[agent] = std::move(config);
             }
 
+            if (!configs.empty()) doConfigs(configs);
+
             recordTime("doConfig", atStart);
         }
 
-        {
+        if (shard) {
             double atStart = getTime();
 
             std::shared_ptr<Auction> auction;
-            while (submittedBuffer.tryPop(auction))
-                doSubmitted(auction);
+            while (shard->submittedBuffer.tryPop(auction))
+                doSubmitted(auction, *shard);
 
             recordTime("doSubmitted", atStart);
         }
 
         if (items[0].revents & ZMQ_POLLIN) {
-            double atStart = getTime();
             // Agent message
             vector<string> message;
             try {
                 message = recvAll(bridge.agents.getSocketUnsafe());
-                bridge.agents.handleMessage(std::move(message));
-
             } catch (const std::exception & exc) {
-                cerr << "error handling agent message " << message
-                     << ": " << exc.what() << endl;
-                logRouterError("handleAgentMessage", exc.what(),
-                               message);
-
-                if (analytics) analytics->logRouterErrorMessage("handleAgentMessage", exc.what(), message);
+                cerr << "error receiving agent message: " << exc.what()
+                     << endl;
             }
+            if (!message.empty())
+                onAgentMessage(std::move(message));
+        }
+
+        // The rings are cheap to look at so they're checked on every turn,
+        // which keeps the agents that are on them from waiting on a sleep.
+        if (bridge.shmWakeup) {
+            if (items[shmItem].revents & ZMQ_POLLIN)
+                bridge.shmWakeup->drain();
 
-            recordTime(message.at(1), atStart);
+            vector<vector<string> > messages;
+            bridge.receiveShm(messages);
+            for (auto & message: messages)
+                onAgentMessage(std::move(message));
         }
 
         if (items[1].revents & ZMQ_POLLIN) {
             wakeupMainLoop.read();
         }
 
+        if (shard && (items[shardItem].revents & ZMQ_POLLIN)) {
+            shard->wakeup.tryRead();
+        }
+
+        if (connectPostAuctionLoop)
+            postAuctionEndpoint.flush();
+
         double now = ML::wall_time();
 
+        // Agents that were full are retried even if nothing new is queued
+        if ((items[2].revents & ZMQ_POLLIN) || now - lastPeerFlush > 0.01) {
+            double atStart = getTime();
+            bidder->flush();
+            bridge.agents.flushPeerQueues();
+            lastPeerFlush = now;
+            recordTime("flushAgentQueues", atStart);
+        }
+
         if (now - lastPings > 1.0) {
             double atStart = getTime();
 
@@ -841,6 +1142,7 @@ run()
 
         if (now - last_check > 10.0) {
             logUsageMetrics(10.0);
+            auctionStages.report(*this);
             if (analytics) analytics->logUsageMessage(*this, 10.0);
             if (analytics) analytics->logMarkMessage(*this,last_check);
             dutyCycleCurrent.ending = Date::now();
@@ -852,6 +1154,13 @@ run()
                                        dutyCycleHistory.end() - 100);
 
             checkDeadAgents();
+            if (shard) checkLostBids(*shard);
+            filters.reorderFilters();
+            filters.reportFilterTimes();
+
+            recordLevel(allAgentsGc.numDeferred(), "gc.allAgents.deferred");
+            recordLevel(allAgentsGc.numDeferOverflows(),
+                        "gc.allAgents.deferOverflows");
 
             double total = 0.0;
             for (auto it = times.begin(); it != times.end();  ++it)
@@ -899,6 +1208,59 @@ run()
     //cerr << "server shutdown" << endl;
 }
 
+void
+Router::
+runShard(AuctionShard & shard)
+{
+    Date lastLostBidsCheck = Date::now();
+
+    while (!shutdown_) {
+        int numEvents = 0;
+
+        numEvents += startBidding(shard);
+
+        {
+            std::vector<std::string> message;
+            for (; shard.agentBidBuffer.tryPop(message);  ++numEvents)
+                doBid(message, shard);
+        }
+
+        {
+            BidMessage message;
+            for (; shard.doBidBuffer.tryPop(message);  ++numEvents)
+                doBidImpl(message, shard);
+        }
+
+        {
+            std::shared_ptr<Auction> auction;
+            for (; shard.submittedBuffer.tryPop(auction);  ++numEvents)
+                doSubmitted(auction, shard);
+        }
+
+        checkExpiredAuctions(shard);
+
+        Date now = Date::now();
+        if (now.secondsSince(lastLostBidsCheck) > 10.0) {
+            checkLostBids(shard);
+            lastLostBidsCheck = now;
+        }
+
+        if (numEvents == 0) {
+            // Nothing to do; wait to be woken up, but not for longer than a
+            // millisecond so that expiries are processed in time.
+            RouterProfiler profiler(shard.dutyCycle.nsSleeping);
+
+            pollfd fd = { shard.wakeup.fd(), POLLIN, 0 };
+            int res = ::poll(&fd, 1, 1 /* milliseconds */);
+            if (res == -1 && errno != EINTR)
+                throw ML::Exception(errno, "poll");
+            if (res == 1)
+                shard.wakeup.tryRead();
+        }
+        else shard.dutyCycle.nEvents += numEvents;
+    }
+}
+
 void
 Router::
 shutdown()
@@ -916,6 +1278,12 @@ shutdown()
     if (runThread)
         runThread->join();
     runThread.reset();
+    for (auto & shard : shards) {
+        if (!shard->thread) continue;
+        shard->wakeup.signal();
+        shard->thread->join();
+        shard->thread.reset();
+    }
     if (cleanupThread)
         cleanupThread->join();
     cleanupThread.reset();
@@ -991,7 +1359,22 @@ int
 Router::
 numAuctionsInProgress() const
 {
-    return -1;//inFlight.size();
+    size_t result = 0;
+    for (auto & shard : shards)
+        result += shard->inFlight.size();
+    return result;
+}
+
+bool
+Router::
+injectBid(BidMessage && message)
+{
+    AuctionShard & shard = shardFor(message.auctionId);
+    if (!shard.doBidBuffer.tryPush(std::move(message)))
+        return false;
+
+    shard.wakeup.signal();
+    return true;
 }
 
 void
@@ -1015,6 +1398,16 @@ handleAgentMessage(const std::vector<std::string> & message)
             return;
         }
 
+        if (request == "SHM_CONNECT") {
+            bridge.acceptShm(address, message.at(2));
+            return;
+        }
+
+        if (request == "BROADCAST_SUBSCRIBE") {
+            bridge.subscribeBroadcast(address);
+            return;
+        }
+
         if (request == "CONFIG") {
             string configName = message.at(2);
             if (!agents.count(configName)) {
@@ -1032,7 +1425,7 @@ handleAgentMessage(const std::vector<std::string> & message)
         }
 
         AgentInfo & info = agents[address];
-        info.gotHeartbeat(Date::now());
+        info.gotHeartbeat(Date::nowCoarse());
 
         if (!info.configured) {
             throw ML::Exception("message to unconfigured agent");
@@ -1042,6 +1435,10 @@ handleAgentMessage(const std::vector<std::string> & message)
             doBid(message);
             return;
         }
+        if (request[0] == 'B' && request == "BIDS") {
+            doBids(message);
+            return;
+        }
 
         //cerr << "router got message " << message << endl;
 
@@ -1142,6 +1539,8 @@ checkDeadAgents()
 
     std::vector<Agents::iterator> deadAgents;
 
+    auto peerStats = bridge.agents.getPeerStats();
+
     for (auto it = agents.begin(), end = agents.end();  it != end;
          ++it) {
         auto & info = it->second;
@@ -1149,46 +1548,18 @@ checkDeadAgents()
         const std::string & account = info.config->account.toString('.');
 
         Date now = Date::now();
-        double oldest = 0.0;
-        double total = 0.0;
-
-        vector<Id> toExpire;
-
-        // Check for in flight timeouts.  This shouldn't happen, but there
-        // appears to be a way in which we lose track of an inflight auction
-        auto onInFlight = [&] (const Id & id, const Date & date)
-            {
-                double secondsSince = now.secondsSince(date);
-
-                oldest = std::max(oldest, secondsSince);
-                total += secondsSince;
-
-                if (secondsSince > 30.0) {
-
-                    this->recordHit("accounts.%s.lostBids", account);
-
-                    bidder->sendBidLostMessage(info.config, it->first, inFlight[id].auction);
-
-                    toExpire.push_back(id);
-                }
-            };
-
-        info.forEachInFlight(onInFlight);
 
         this->recordLevel(info.numBidsInFlight(),
                           "accounts.%s.inFlight.numInFlight", account);
-        this->recordLevel(oldest,
-                          "accounts.%s.inFlight.oldestAgeSeconds", account);
-        double averageAge = 0.0;
-        if (info.numBidsInFlight() != 0)
-            averageAge = total / info.numBidsInFlight();
-
-        this->recordLevel(averageAge,
-                          "accounts.%s.inFlight.averageAgeSeconds", account);
 
-        for (auto jt = toExpire.begin(), jend = toExpire.end();  jt != jend;
-             ++jt) {
-            info.expireBidInFlight(*jt);
+        auto stats = peerStats.find(it->first);
+        if (stats != peerStats.end()) {
+            this->recordLevel(stats->second.queued,
+                              "accounts.%s.sendQueue.queued", account);
+            this->recordLevel(stats->second.dropped,
+                              "accounts.%s.sendQueue.dropped", account);
+            this->recordLevel(stats->second.blocked,
+                              "accounts.%s.sendQueue.blocked", account);
         }
 
         double timeSinceHeartbeat
@@ -1202,16 +1573,7 @@ checkDeadAgents()
             if (it->second.numBidsInFlight() != 0) {
                 cerr << "agent " << it->first
                      << " has " << it->second.numBidsInFlight()
-                     << " undead auctions: " << endl;
-
-                auto onInFlight = [&] (const Id & id, Date date)
-                    {
-                        cerr << "  " << id << " --> "
-                        << date << " (" << now.secondsSince(date)
-                        << "s ago)" << endl;
-                    };
-
-                info.forEachInFlight(onInFlight);
+                     << " undead auctions" << endl;
             }
             else {
                 // agent is dead
@@ -1223,14 +1585,19 @@ checkDeadAgents()
         }
     }
 
+    FilterPool::ConfigUpdates removed;
     for (auto it = deadAgents.begin(), end = deadAgents.end();
          it != end;  ++it) {
         cerr << "WARNING: dead agent doesn't clean up its state properly"
              << endl;
         // TODO: undo all bids in progress
-        filters.removeConfig((*it)->first);
-        agents.erase(*it);
+        removed.emplace_back((*it)->first, nullptr);
     }
+    filters.updateConfigs(removed);
+
+    for (auto it = deadAgents.begin(), end = deadAgents.end();
+         it != end;  ++it)
+        agents.erase(*it);
 
     if (!deadAgents.empty())
         // Broadcast that we have different agents
@@ -1240,16 +1607,124 @@ checkDeadAgents()
     //     << endl;
 }
 
+void
+Router::
+checkLostBids(AuctionShard & shard)
+{
+    GcLock::SharedGuard guard(allAgentsGc);
+    const AllAgentInfo * ac = allAgents;
+
+    Date now = Date::now();
+
+    for (auto it = shard.bidsInFlight.begin(), end = shard.bidsInFlight.end();
+         it != end;  ++it) {
+        const std::string & agent = it->first;
+        auto & bids = it->second.bids;
+
+        const AgentInfoEntry * entry = findAgentEntry(ac, agent);
+        if (!entry) continue;
+
+        const std::string & account = entry->config->account.toString('.');
+
+        double oldest = 0.0;
+        double total = 0.0;
+
+        // Check for in flight timeouts.  This shouldn't happen, but there
+        // appears to be a way in which we lose track of an inflight auction
+        for (auto jt = bids.begin(), jend = bids.end();  jt != jend;) {
+            double secondsSince = now.secondsSince(jt->second);
+
+            oldest = std::max(oldest, secondsSince);
+            total += secondsSince;
+
+            if (secondsSince <= 30.0) {
+                ++jt;
+                continue;
+            }
+
+            this->recordHit("accounts.%s.lostBids", account);
+
+            auto auctionIt = shard.inFlight.find(jt->first);
+            if (auctionIt != shard.inFlight.end())
+                bidder->sendBidLostMessage(entry->config, agent,
+                                           auctionIt->second.auction);
+
+            jt = bids.erase(jt);
+            ML::atomic_dec(it->second.status->numBidsInFlight);
+        }
+
+        this->recordLevel(oldest,
+                          "accounts.%s.inFlight.oldestAgeSeconds", account);
+        double averageAge = 0.0;
+        if (!bids.empty())
+            averageAge = total / bids.size();
+
+        this->recordLevel(averageAge,
+                          "accounts.%s.inFlight.averageAgeSeconds", account);
+    }
+
+    recordMemUsage(shard);
+}
+
+void
+Router::
+recordMemUsage(AuctionShard & shard)
+{
+    // The auctions are shared with the exchange connectors and the post
+    // auction proxy, but it's the in flight map that keeps them alive.
+    MemUsageSample inFlightBytes;
+    size_t n = 0;
+    for (auto it = shard.inFlight.begin(), end = shard.inFlight.end();
+         it != end && n < MemUsageSample::DefaultSamples;  ++it, ++n) {
+        const AuctionInfo & info = it->second;
+        size_t bytes = sizeof(*it) + info.auction->memUsage();
+        for (auto & bidder: info.bidders)
+            bytes += sizeof(bidder) + 4 * sizeof(void *) + heapBytes(bidder.first);
+        inFlightBytes.add(bytes);
+    }
+
+    recordLevel(inFlightBytes.estimate(shard.inFlight.size()),
+                "memory.shards.%d.inFlightBytes", shard.index);
+
+    // One tree node per auction that an agent is bidding on
+    size_t numBids = 0;
+    for (auto & agent: shard.bidsInFlight)
+        numBids += agent.second.bids.size();
+    recordLevel(numBids * (sizeof(Id) + sizeof(Date) + 4 * sizeof(void *)),
+                "memory.shards.%d.bidsInFlightBytes", shard.index);
+}
+
 void
 Router::
 checkExpiredAuctions()
+{
+    if (!threadedShards())
+        checkExpiredAuctions(*shards[0]);
+
+    {
+        RouterProfiler profiler(dutyCycleCurrent.nsExpireBlacklist);
+        blacklist.doExpiries();
+    }
+
+    if (doDebug) {
+        RouterProfiler profiler(dutyCycleCurrent.nsExpireDebug);
+        expireDebugInfo();
+    }
+}
+
+void
+Router::
+checkExpiredAuctions(AuctionShard & shard)
 {
     //recentlySubmitted.clear();
 
     Date start = Date::now();
 
     {
-        RouterProfiler profiler(dutyCycleCurrent.nsExpireInFlight);
+        RouterProfiler profiler(shard.dutyCycle.nsExpireInFlight);
+
+        GcLock::SharedGuard guard(allAgentsGc);
+        const AllAgentInfo * ac = allAgents;
 
         // Look for in flight timeout expiries
         auto onExpiredInFlight = [&] (const Id & auctionId,
@@ -1262,17 +1737,20 @@ checkExpiredAuctions()
                          end = auctionInfo.bidders.end();
                      it != end;  ++it) {
                     string agent = it->first;
-                    if (!agents.count(agent)) continue;
+                    if (!shard.expireBidInFlight(agent, auctionId)) continue;
 
-                    if (agents[agent].expireBidInFlight(auctionId)) {
-                        AgentInfo & info = this->agents[agent];
-                        ++info.stats->tooLate;
+                    const AgentInfoEntry * entry = findAgentEntry(ac, agent);
+                    if (!entry) continue;
 
-                        this->recordHit("accounts.%s.EXPIRED",
-                                        info.config->account.toString('.'));
+                    ML::atomic_inc(entry->stats->tooLate);
+                    entry->stats->responseTimes.record(
+                            1000.0 * start.secondsSince(it->second.bidTime),
+                            start);
 
-                        bidder->sendBidDroppedMessage(info.config, agent, auctionInfo.auction);
-                    }
+                    this->recordHit("accounts.%s.EXPIRED",
+                                    entry->config->account.toString('.'));
+
+                    bidder->sendBidDroppedMessage(entry->config, agent, auctionInfo.auction);
                 }
 
 #if 0
@@ -1302,17 +1780,7 @@ checkExpiredAuctions()
                 return Date();
             };
 
-        inFlight.expire(onExpiredInFlight, start);
-    }
-
-    {
-        RouterProfiler profiler(dutyCycleCurrent.nsExpireBlacklist);
-        blacklist.doExpiries();
-    }
-
-    if (doDebug) {
-        RouterProfiler profiler(dutyCycleCurrent.nsExpireDebug);
-        expireDebugInfo();
+        shard.inFlight.expire(onExpiredInFlight, start);
     }
 }
 
@@ -1326,8 +1794,8 @@ returnErrorResponse(const std::vector<std::string> & message,
     if (analytics) analytics->logErrorMessage(error,message);
     logMessageToAnalytics("ERROR", error, message);
     const auto& agent = message[0];
-    AgentInfo & info = this->agents[agent];
-    bidder->sendErrorMessage(info.config, agent, error, message);
+    AgentInfoEntry entry = getAgentEntry(agent);
+    bidder->sendErrorMessage(entry.config, agent, error, message);
 }
 
 void
@@ -1337,7 +1805,8 @@ returnInvalidBid(
         const std::shared_ptr<Auction> &auction,
         const char *reason, const char *message, ...) {
 
-    auto& agentInfo = agents[agent];
+    AgentInfoEntry agentInfo = getAgentEntry(agent);
+    if (!agentInfo.valid()) return;
     const auto& agentConfig = agentInfo.config;
     this->recordHit("bidErrors.%s", reason);
     this->recordHit("accounts.%s.bidErrors.total",
@@ -1346,7 +1815,7 @@ returnInvalidBid(
                     agentConfig->account.toString('.'),
                     reason);
 
-    ++agentInfo.stats->invalid;
+    ML::atomic_inc(agentInfo.stats->invalid);
 
     va_list ap;
     va_start(ap, message);
@@ -1374,7 +1843,8 @@ returnInvalidBid(
         const std::shared_ptr<Auction> &auction,
         const std::string &reason, const char *message, ...) {
 
-    auto& agentInfo = agents[agent];
+    AgentInfoEntry agentInfo = getAgentEntry(agent);
+    if (!agentInfo.valid()) return;
     const auto& agentConfig = agentInfo.config;
     this->recordHit("bidErrors.%s", reason);
     this->recordHit("accounts.%s.bidErrors.total",
@@ -1383,7 +1853,7 @@ returnInvalidBid(
                     agentConfig->account.toString('.'),
                     reason);
 
-    ++agentInfo.stats->invalid;
+    ML::atomic_inc(agentInfo.stats->invalid);
 
     va_list ap;
     va_start(ap, message);
@@ -1411,7 +1881,8 @@ doStats(const std::vector<std::string> & message)
     Json::Value result(Json::objectValue);
 
     result["numAugmenting"] = augmentationLoop.numAugmenting();
-    result["numInFlight"] = inFlight.size();
+    result["numInFlight"] = numAuctionsInProgress();
+    result["numLockContentions"] = numLockContentions;
     result["blacklistUsers"] = blacklist.size();
 
     result["numAgents"] = agents.size();
@@ -1435,6 +1906,14 @@ doStats(const std::vector<std::string> & message)
         result["dutyCycle"] = dutyCycleCurrent.toJson();
     else result["dutyCycle"] = dutyCycleHistory.back().toJson();
 
+    for (auto & shard : shards) {
+        Json::Value & val = result["shards"][shard->index];
+        val["numInFlight"] = shard->inFlight.size();
+        val["dutyCycle"] = shard->dutyCycle.toJson();
+    }
+
+    result["filterOrder"] = filters.orderToJson();
+
     result["fileDescriptorCount"] = ML::num_open_files();
 
     addChildServiceStatus(result);
@@ -1471,7 +1950,7 @@ augmentAuction(const std::shared_ptr<AugmentationInfo> & info)
 
     auto onDoneAugmenting = [=] (const std::shared_ptr<AugmentationInfo> & info)
         {
-            info->auction->doneAugmenting = Date::now();
+            info->auction->doneAugmenting = Date::nowFast();
 
             if (info->auction->tooLate()) {
                 this->recordHit("tooLateAfterAugmenting");
@@ -1479,11 +1958,12 @@ augmentAuction(const std::shared_ptr<AugmentationInfo> & info)
             }
 
             // Send it off to be farmed out to the bidders
-            startBiddingBuffer.push(info);
-            wakeupMainLoop.signal();
+            AuctionShard & shard = this->shardFor(info->auction->id);
+            shard.startBiddingBuffer.push(info);
+            shard.wakeup.signal();
         };
 
-    augmentationLoop.augment(info, Date::now().plusSeconds(augmentationWindow.count()),
+    augmentationLoop.augment(info, Date::nowFast().plusSeconds(augmentationWindow.count()),
                              onDoneAugmenting);
 }
 
@@ -1493,12 +1973,12 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
 {
     ML::atomic_inc(numAuctions);
 
-    Date now = Date::now();
+    Date now = Date::nowFast();
     auction->inPrepro = now;
 
     if (auction->lossAssumed == Date())
         auction->lossAssumed
-            = Date::now().plusSeconds(secondsUntilLossAssumed_);
+            = Date::nowFast().plusSeconds(secondsUntilLossAssumed_);
     Date lossTimeout = auction->lossAssumed;
 
     //cerr << "AUCTION " << auction->id << " " << auction->requestStr << endl;
@@ -1544,10 +2024,17 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
                 });
     }
 
+    // Groups that won't bid are masked out before the filters are run.
+    ConfigSet bidMask(true);
+    if (enableBidProbability)
+        bidMask = sampleBidProbability();
+
     // Do the actual filtering.
-    auto biddableConfigs = filters.filter(*auction->request, exchangeConnector);
+    auto biddableConfigs =
+        filters.filter(*auction->request, exchangeConnector, bidMask);
 
     auto checkAgent = [&] (
+            const std::string & agent,
             const AgentConfig & config,
             const AgentStatus & status,
             AgentStats & stats)
@@ -1571,12 +2058,20 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
                 return false;
             }
 
+            if (earlyBlacklistFilter && config.hasBlacklist()) {
+                if (blacklist.matches(*auction->request, agent, config)) {
+                    ML::atomic_inc(stats.userBlacklisted);
+                    doFilterStat(config, "static.userBlacklisted");
+                    return false;
+                }
+            }
+
             return true;
         };
 
     for (const auto& entry : biddableConfigs) {
         if (entry.biddableSpots.empty()) continue;
-        if (!checkAgent(*entry.config, *entry.status, *entry.stats)) continue;
+        if (!checkAgent(entry.name, *entry.config, *entry.status, *entry.stats)) continue;
 
         ML::atomic_inc(entry.stats->passedStaticFilters);
         doFilterStat(*entry.config, "passedStaticFilters");
@@ -1586,6 +2081,7 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
 
         PotentialBidder bidder;
         bidder.agent = entry.name;
+        bidder.configIndex = entry.configIndex;
         bidder.config = entry.config;
         bidder.stats = entry.stats;
         bidder.imp = std::move(entry.biddableSpots);
@@ -1598,22 +2094,7 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
     std::vector<GroupPotentialBidders> validGroups;
 
     for(auto it = groupAgents.begin(), end = groupAgents.end(); it != end; ++it) {
-        // Check for bid probability and skip if we don't bid
-        if(enableBidProbability) {
-            double bidProbability
-                = it->second.totalBidProbability
-                / it->second.size()
-                * globalBidProbability;
-
-            if (bidProbability < 1.0) {
-                float val = (random() % 1000000) / 1000000.0;
-                if (val > bidProbability) {
-                    for (unsigned i = 0;  i < it->second.size();  ++i)
-                        ML::atomic_inc(it->second[i].stats->skippedBidProbability);
-                    continue;
-                }
-            }
-        }
+        // The bid probability was already sampled by sampleBidProbability().
 
         // Group is valid for bidding; next step is to augment the bid
         // request
@@ -1636,7 +2117,7 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
     auto info = std::make_shared<AugmentationInfo>(auction, lossTimeout);
     info->potentialGroups.swap(validGroups);
 
-    auction->outOfPrepro = Date::now();
+    auction->outOfPrepro = Date::nowFast();
 
     recordOutcome(auction->outOfPrepro.secondsSince(auction->inPrepro) * 1000.0,
                   "preprocessAuctionTimeMs");
@@ -1650,19 +2131,67 @@ doStartBidding(const std::vector<std::string> & message)
 {
     std::shared_ptr<AugmentationInfo> augInfo
         = sharedPtrFromMessage<AugmentationInfo>(message.at(2));
-    doStartBidding(augInfo);
+
+    AuctionShard & shard = shardFor(augInfo->auction->id);
+    shard.startBiddingBuffer.push(augInfo);
+    shard.wakeup.signal();
+}
+
+int
+Router::
+startBidding(AuctionShard & shard)
+{
+    auto & queue = shard.startBiddingQueue;
+
+    // Min-heap on the expiry of the auction.
+    auto laterDeadline = [] (const std::shared_ptr<AugmentationInfo> & lhs,
+                             const std::shared_ptr<AugmentationInfo> & rhs)
+        {
+            return lhs->auction->expiry > rhs->auction->expiry;
+        };
+
+    int numEvents = 0;
+
+    std::shared_ptr<AugmentationInfo> info;
+    for (; shard.startBiddingBuffer.tryPop(info);  ++numEvents) {
+        queue.push_back(std::move(info));
+        std::push_heap(queue.begin(), queue.end(), laterDeadline);
+    }
+
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), laterDeadline);
+        info = std::move(queue.back());
+        queue.pop_back();
+
+        // When we're falling behind, the auctions that can't make it are
+        // dropped here rather than having their agents ask for bids that
+        // will be thrown away.
+        if (info->auction->tooLate()
+            || info->auction->timeAvailable() <= 0.0) {
+            recordHit("tooLateBeforeStartBidding");
+            continue;
+        }
+
+        doStartBidding(info, shard);
+    }
+
+    return numEvents;
 }
 
 void
 Router::
-doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
+doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo,
+               AuctionShard & shard)
 {
     //static const char *fName = "Router::doStartBidding:";
-    RouterProfiler profiler(dutyCycleCurrent.nsStartBidding);
+    RouterProfiler profiler(shard.dutyCycle.nsStartBidding);
+
+    GcLock::SharedGuard guard(allAgentsGc);
+    const AllAgentInfo * ac = allAgents;
 
     try {
         Id auctionId = augInfo->auction->id;
-        if (inFlight.count(auctionId)) {
+        if (shard.inFlight.count(auctionId)) {
             throwException("doStartBidding.alreadyInFlight",
                            "auction with ID %s already in progress",
                            auctionId.toString().c_str());
@@ -1679,7 +2208,7 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
         auto groupAgents = augInfo->potentialGroups;
 
-        AuctionInfo & auctionInfo = addAuction(augInfo->auction,
+        AuctionInfo & auctionInfo = addAuction(shard, augInfo->auction,
                                                augInfo->lossTimeout);
         auto auction = augInfo->auction;
 
@@ -1703,8 +2232,9 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
             for (unsigned i = 0;  i < bidders.size();  ++i) {
                 PotentialBidder & bidder = bidders[i];
-                if (!agents.count(bidder.agent)) continue;
-                AgentInfo & info = agents[bidder.agent];
+                const AgentInfoEntry * info
+                    = ac->find(bidder.configIndex, bidder.agent);
+                if (!info) continue;
                 const AgentConfig & config = *bidder.config;
 
                 auto doFilterStat = [&] (const char * reason)
@@ -1729,8 +2259,8 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
                 doFilterStat("intoDynamicFilters");
 
                 /* Check if we have too many in flight. */
-                if (info.numBidsInFlight() >= info.config->maxInFlight) {
-                    ++info.stats->tooManyInFlight;
+                if (info->status->numBidsInFlight >= info->config->maxInFlight) {
+                    ML::atomic_inc(info->stats->tooManyInFlight);
                     bidder.inFlightProp = PotentialBidder::NULL_PROP;
                     doFilterStat("dynamic.tooManyInFlight");
                     continue;
@@ -1773,7 +2303,7 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
                         lock.unlock();
                     }
 
-                    ML::atomic_inc(info.stats->notEnoughTime);
+                    ML::atomic_inc(info->stats->notEnoughTime);
                     bidder.inFlightProp = PotentialBidder::NULL_PROP;
                     doFilterStat("dynamic.notEnoughTime");
                     doFilterMetric("metric.timeUsedBeforeDynamicFilter",
@@ -1785,7 +2315,18 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
                     doFilterMetric("metric.timeElapsedDuringPreproMs",
                                    auction->inPrepro.secondsUntil(auction->outOfPrepro) * 1000.0);
                     doFilterMetric("metric.timeWindowMs",
-                                   auction->expiry.secondsSince(auction->start) * 1000.0 - info.config->minTimeAvailableMs);
+                                   auction->expiry.secondsSince(auction->start) * 1000.0 - info->config->minTimeAvailableMs);
+                    continue;
+                }
+
+                /* Skip the agents that usually answer after it's too late;
+                   the auction can then close as soon as the others have
+                   answered. */
+                if (skipSlowAgents
+                    && info->stats->responseTimes.p95Ms(now) > timeLeftMs) {
+                    ML::atomic_inc(info->stats->tooSlow);
+                    bidder.inFlightProp = PotentialBidder::NULL_PROP;
+                    doFilterStat("dynamic.tooSlow");
                     continue;
                 }
 
@@ -1808,7 +2349,7 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
                     vector<string> tags = it->second.tagsForAccount(config.account);
                     if (augConfig.filters.anyIsIncluded(tags)) continue;
 
-                    ML::atomic_inc(info.stats->augmentationTagsExcluded);
+                    ML::atomic_inc(info->stats->augmentationTagsExcluded);
                     string stat = "dynamic." + augConfig.name + ".tags";
                     doFilterStat(stat.c_str());
                     filteredByAugmentation = true;
@@ -1818,18 +2359,19 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
 
                 /* Check that there is no blacklist hit on the user. */
-                if (config.hasBlacklist()
-                    && blacklist.matches(*auction->request, bidder.agent,
-                                         config)) {
-                    ML::atomic_inc(info.stats->userBlacklisted);
-                    doFilterStat("dynamic.userBlacklisted");
-                    continue;
+                if (config.hasBlacklist()) {
+                    if (blacklist.matches(*auction->request, bidder.agent,
+                                          config)) {
+                        ML::atomic_inc(info->stats->userBlacklisted);
+                        doFilterStat("dynamic.userBlacklisted");
+                        continue;
+                    }
                 }
 
                 bidder.inFlightProp
-                    = info.numBidsInFlight() / max(info.config->maxInFlight, 1);
+                    = info->status->numBidsInFlight / max(info->config->maxInFlight, 1);
 
-                ML::atomic_inc(info.stats->passedDynamicFilters);
+                ML::atomic_inc(info->stats->passedDynamicFilters);
                 doFilterStat("passedDynamicFilters");
             }
 
@@ -1858,13 +2400,13 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
             PotentialBidder & winner = bidders[best];
             string agent = winner.agent;
 
-            if (!agents.count(agent)) {
+            const AgentInfoEntry * info = ac->find(winner.configIndex, agent);
+            if (!info) {
                 //cerr << "!!!AGENT IS GONE" << endl;
                 continue;  // agent is gone
             }
-            AgentInfo & info = agents[agent];
 
-            ++info.stats->auctions;
+            ML::atomic_inc(info->stats->auctions);
 
             Json::Value aggregatedAug;
             for (const auto& aug : augList) {
@@ -1877,11 +2419,11 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
             BidInfo bidInfo;
             bidInfo.agentConfig = winner.config;
-            bidInfo.bidTime = Date::now();
+            bidInfo.bidTime = Date::nowFast();
             bidInfo.imp = winner.imp;
 
             auctionInfo.bidders.insert(make_pair(agent, std::move(bidInfo)));  // create empty bid response
-            if (!info.trackBidInFlight(auctionId, bidInfo.bidTime))
+            if (!shard.trackBidInFlight(agent, info->status, auctionId, bidInfo.bidTime))
                 throwException("doStartBidding.agentAlreadyBidding",
                                "agent %s is already processing auction %s",
                                agent.c_str(),
@@ -1893,6 +2435,8 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
         //auctionInfo.activities.push_back(ML::format("total of %zd agents",
         //                                 auctionInfo.bidders.size()));
+        auction->doneFiltering = Date::nowFast();
+
         if (auction->tooLate()) {
             recordHit("tooLateAfterRouting");
             // Unwind everything?
@@ -1903,11 +2447,12 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
         if (!auctionInfo.bidders.empty()) {
             bidder->sendAuctionMessage(
                     auctionInfo.auction, timeLeftMs, auctionInfo.bidders);
+            auction->sentToAgents = Date::nowFast();
         }
         else {
             /* No bidders; don't bother with the bid */
             ML::atomic_inc(numNoBidders);
-            inFlight.erase(auctionId);
+            shard.inFlight.erase(auctionId);
             //cerr << fName << "About to call finish " << endl;
             if (!auction->finish()) {
                 recordHit("tooLateToFinish");
@@ -1925,7 +2470,8 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
 AuctionInfo &
 Router::
-addAuction(std::shared_ptr<Auction> auction, Date lossTimeout)
+addAuction(AuctionShard & shard,
+           std::shared_ptr<Auction> auction, Date lossTimeout)
 {
     const Id & id = auction->id;
 
@@ -1933,7 +2479,7 @@ addAuction(std::shared_ptr<Auction> auction, Date lossTimeout)
 
     try {
         AuctionInfo & result
-            = inFlight.insert(id, AuctionInfo(auction, lossTimeout),
+            = shard.inFlight.insert(id, AuctionInfo(auction, lossTimeout),
                               getCurrentTime().plusSeconds(bidMemoryWindow));
         return result;
     } catch (const std::exception & exc) {
@@ -1963,6 +2509,27 @@ doBid(const std::vector<std::string> & message)
         return;
     }
 
+    Id auctionId(message[2]);
+    AuctionShard & shard = shardFor(auctionId);
+
+    if (!threadedShards()) {
+        doBid(message, shard);
+        return;
+    }
+
+    // Parsing the bids is left to the thread that owns the auction
+    if (!shard.agentBidBuffer.tryPush(message)) {
+        recordHit("bidError.shardOverloaded");
+        returnErrorResponse(message, "router can't keep up with bids");
+        return;
+    }
+    shard.wakeup.signal();
+}
+
+void
+Router::
+doBid(const std::vector<std::string> & message, AuctionShard & shard)
+{
     Id auctionId(message[2]);
 
     const string & agent = message[0];
@@ -1980,13 +2547,13 @@ doBid(const std::vector<std::string> & message)
     bidMessage.wcm = std::move(wcm);
     bidMessage.meta = std::move(meta);
 
-    Bids bids;
     try {
-        bids = Bids::fromJson(biddata);
+        // Fills the bids in place so that there's nothing to allocate
+        Bids::parse(biddata, bidMessage.bids);
     }
     catch (const std::exception & exc) {
-        auto it = inFlight.find(auctionId);
-        if (it == inFlight.end()) {
+        auto it = shard.inFlight.find(auctionId);
+        if (it == shard.inFlight.end()) {
             recordHit("bidError.unknownAuction");
             returnErrorResponse(message, "unknown auction");
             return;
@@ -1998,16 +2565,44 @@ doBid(const std::vector<std::string> & message)
         }
         return;
     }
-    bidMessage.bids = std::move(bids);
 
-    doBidImpl(bidMessage, message);
+    doBidImpl(bidMessage, shard, message);
 }
 
 void
 Router::
-doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMessage)
+doBids(const std::vector<std::string> & message)
 {
-    Date dateGotBid = Date::now();
+    // Each auction takes the same four parts as in a BID message
+    if (message.size() < 6 || (message.size() - 2) % 4 != 0) {
+        returnErrorResponse(message, "BIDS message has 4 parts per auction");
+        return;
+    }
+
+    recordLevel((message.size() - 2) / 4, "bidsPerBatch");
+
+    std::vector<std::string> bid(6);
+    bid[0] = message[0];
+    bid[1] = "BID";
+
+    for (size_t i = 2;  i < message.size();  i += 4) {
+        std::copy(message.begin() + i, message.begin() + i + 4,
+                  bid.begin() + 2);
+        try {
+            doBid(bid);
+        } catch (const std::exception & exc) {
+            // Don't lose the other auctions' bids
+            returnErrorResponse(bid, "threw exception: " + string(exc.what()));
+        }
+    }
+}
+
+void
+Router::
+doBidImpl(const BidMessage &message, AuctionShard & shard,
+          const std::vector<std::string> &originalMessage)
+{
+    Date dateGotBid = Date::nowFast();
 
     if (failBid(bidsErrorRate)) {
         returnErrorResponse(originalMessage, "Intentional error response (--bids-error-rate)");
@@ -2017,17 +2612,24 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
     ExcAssert(!message.agents.empty());
 
     const auto& auctionId = message.auctionId;
-    auto it = inFlight.find(auctionId);
-    if (it == inFlight.end()) {
+    auto it = shard.inFlight.find(auctionId);
+    if (it == shard.inFlight.end()) {
         recordHit("bidError.unknownAuction");
         returnErrorResponse(originalMessage, "unknown auction");
         return;
     }
 
     AuctionInfo & auctionInfo = it->second;
+    auctionInfo.auction->lastBid = dateGotBid;
+
+    GcLock::SharedGuard agentsGuard(allAgentsGc);
+    const AllAgentInfo * ac = allAgents;
+    const AgentInfoEntry * firstEntry = nullptr;
 
     for (const auto &agent: message.agents) {
-        if (!agents.count(agent)) {
+        const AgentInfoEntry * entry = findAgentEntry(ac, agent);
+        if (!firstEntry) firstEntry = entry;
+        if (!entry) {
             returnErrorResponse(originalMessage, "unknown agent");
             return;
         }
@@ -2040,15 +2642,13 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
             return;
         }
 
-        AgentInfo & info = agents[agent];
         /* One less in flight. */
-        if (!info.expireBidInFlight(auctionId)) {
+        if (!shard.expireBidInFlight(agent, auctionId)) {
             recordHit("bidError.agentNotBidding");
             returnErrorResponse(originalMessage, "agent wasn't bidding on this auction");
             return;
         }
-        auto & config = *biddersIt->second.agentConfig;
-        recordHit("accounts.%s.bids", config.account.toString('.'));
+        entry->metrics->bids.recordHit();
     }
 
 
@@ -2061,7 +2661,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
     const auto& agent = message.agents[0];
     auto biddersIt = auctionInfo.bidders.find(agent);
     auto & config = *biddersIt->second.agentConfig;
-    AgentInfo & info = agents[agent];
+    const AgentInfoEntry & info = *firstEntry;
     const auto& agentConfig = info.config;
 
     const auto& bids = message.bids;
@@ -2069,7 +2669,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
 
     BidInfo bidInfo(std::move(biddersIt->second));
 
-    RouterProfiler profiler(dutyCycleCurrent.nsBid);
+    RouterProfiler profiler(shard.dutyCycle.nsBid);
 
     ML::atomic_inc(numBids);
 
@@ -2082,6 +2682,16 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
 
     this->recordLevel(bids.size(), "bidsPerBidRequest");
 
+    // Bids that passed the checks, to be authorized together
+    struct PendingBid {
+        Bid bid;
+        int spotIndex;
+    };
+    std::vector<PendingBid> pending;
+    std::vector<BidAuthorization> authorizations;
+    pending.reserve(bids.size());
+    authorizations.reserve(bids.size());
+
     for (int i = 0; i < bids.size(); ++i) {
 
         Bid bid = bids[i];
@@ -2174,31 +2784,40 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
         // authorize an amount of money computed from the win cost model.
         Amount price = message.wcm.evaluate(bid, bid.price);
 
-        if (!monitorClient.getStatus(slowModeTolerance)) {
+        if (monitorClient.getAcceptRatio() == 0.0) {
             Date now = Date::now();
-            if ((uint32_t) slowModeLastAuction.secondsSinceEpoch()
-                    < (uint32_t) now.secondsSinceEpoch()) {
-                slowModeLastAuction = now;
-                slowModePeriodicSpentReached = false;
-                // TODO Insure in router.cc (not router_runner) that
-                // maxBidPrice <= slowModeAuthorizedMoneyLimit
-                // Here we're garanteed that price.value >= slowModeAuthorizedMoneyLimit
-                accumulatedBidMoneyInThisPeriod = price.value;
-
-                recordHit("monitor.systemInSlowMode"); 
+            bool dropBid = false;
+            {
+                std::lock_guard<ML::Spinlock> guard(slowModeLock);
+
+                if ((uint32_t) slowModeLastAuction.secondsSinceEpoch()
+                        < (uint32_t) now.secondsSinceEpoch()) {
+                    slowModeLastAuction = now;
+                    slowModePeriodicSpentReached = false;
+                    // TODO Insure in router.cc (not router_runner) that
+                    // maxBidPrice <= slowModeAuthorizedMoneyLimit
+                    // Here we're garanteed that price.value >= slowModeAuthorizedMoneyLimit
+                    accumulatedBidMoneyInThisPeriod = price.value;
+
+                    recordHit("monitor.systemInSlowMode"); 
+                }
+
+                else {
+                    accumulatedBidMoneyInThisPeriod += price.value;
+                    // Check if we're spending more in this period than what slowModeAuthorizedMoneyLimit
+                    // allows us to.
+                    if (accumulatedBidMoneyInThisPeriod > slowModeAuthorizedMoneyLimit.value) {
+                        slowModePeriodicSpentReached = true;
+                        dropBid = true;
+                    }
+                }
             }
 
-            else {
-                accumulatedBidMoneyInThisPeriod += price.value;
-                // Check if we're spending more in this period than what slowModeAuthorizedMoneyLimit
-                // allows us to.
-                if (accumulatedBidMoneyInThisPeriod > slowModeAuthorizedMoneyLimit.value) {
-                    slowModePeriodicSpentReached = true;
-                    bidder->sendBidDroppedMessage(agentConfig, agent, auctionInfo.auction);
-                    recordHit("slowMode.droppedBid");
-                    recordHit("accounts.%s.IGNORED", config.account.toString('.'));
+            if (dropBid) {
+                bidder->sendBidDroppedMessage(agentConfig, agent, auctionInfo.auction);
+                recordHit("slowMode.droppedBid");
+                info.metrics->ignored.recordHit();
                 continue;
-                }
             }
         } else {
             // Make sure slowModePeriodicSpentReached is false if monitor success is satisfied.
@@ -2206,15 +2825,31 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
             slowModePeriodicSpentReached = false;
         }
 
-        if (!banker->authorizeBid(config.account, auctionKey, price) || failBid(budgetErrorRate))
+        authorizations.emplace_back(config.account, info.metrics->account,
+                                    std::move(auctionKey), price);
+        pending.push_back({ std::move(bid), spotIndex });
+    }
+
+    // The banker looks up the account once for all of the agent's bids
+    banker->authorizeBids(authorizations);
+
+    for (size_t n = 0; n < pending.size(); ++n) {
+
+        const Bid & bid = pending[n].bid;
+        int spotIndex = pending[n].spotIndex;
+        const Creative & creative = config.creatives.at(bid.creativeIndex);
+        const string & auctionKey = authorizations[n].item;
+        Amount price = authorizations[n].amount;
+
+        if (!authorizations[n].authorized || failBid(budgetErrorRate))
         {
-            ++info.stats->noBudget;
+            ML::atomic_inc(info.stats->noBudget);
 
             bidder->sendNoBudgetMessage(agentConfig, agent, auctionInfo.auction);
 
             if (analytics) analytics->logNoBudgetMessage(agent, auctionId, bidsString, message.meta);
             this->logMessageToAnalytics("NOBUDGET", agent, auctionId);
-            recordHit("accounts.%s.NOBUDGET", config.account.toString('.'));
+            info.metrics->noBudget.recordHit();
             continue;
         }
         
@@ -2247,6 +2882,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
                 message.wcm);
 
         response.creativeName = creative.name;
+        response.accountHandle = info.metrics->account;
 
         Auction::WinLoss localResult
             = auctionInfo.auction->setResponse(spotIndex, response);
@@ -2267,41 +2903,46 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
                             auctionKey.c_str(), msg.c_str()));
 
 
+        auto recordBid = [&] ()
+            {
+                ML::atomic_inc(info.stats->bids);
+                std::lock_guard<ML::Spinlock> guard(info.stats->currencyLock);
+                info.stats->totalBid += price;
+            };
+
         switch (localResult.val) {
         case Auction::WinLoss::PENDING: {
-            ++info.stats->bids;
-            info.stats->totalBid += price;
+            recordBid();
             break; // response will be sent later once local winning bid known
         }
         case Auction::WinLoss::LOSS:
-            ++info.stats->bids;
-            info.stats->totalBid += price;
+            recordBid();
             // fall through
         case Auction::WinLoss::TOOLATE:
         case Auction::WinLoss::INVALID: {
             if (localResult.val == Auction::WinLoss::TOOLATE)
-                ++info.stats->tooLate;
+                ML::atomic_inc(info.stats->tooLate);
             else if (localResult.val == Auction::WinLoss::INVALID)
-                ++info.stats->invalid;
+                ML::atomic_inc(info.stats->invalid);
 
-            banker->cancelBid(config.account, auctionKey);
+            banker->cancelBidByHandle(info.metrics->account, auctionKey);
 
             BidStatus status;
             switch (localResult.val) {
             case Auction::WinLoss::LOSS:
                 status = BS_LOSS;
                 bidder->sendLossMessage(agentConfig, agent, auctionId.toString ());
-                recordHit("accounts.%s.LOCAL_LOSS", config.account.toString('.'));
+                info.metrics->localLoss.recordHit();
                 break;
             case Auction::WinLoss::TOOLATE:
                 status = BS_TOOLATE;
                 bidder->sendTooLateMessage(agentConfig, agent, auctionInfo.auction);
-                recordHit("accounts.%s.TOOLATE", config.account.toString('.'));
+                info.metrics->tooLate.recordHit();
                 continue;
             case Auction::WinLoss::INVALID:
                 status = BS_INVALID;
                 bidder->sendBidInvalidMessage(agentConfig, agent, msg, auctionInfo.auction);
-                recordHit("accounts.%s.INVALID", config.account.toString('.'));
+                info.metrics->invalid.recordHit();
                 break;
             default:
                 throw ML::Exception("logic error");
@@ -2348,18 +2989,17 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
     //cerr << "campaign " << info.config->campaign << " bidTime "
     //     << 1000.0 * bidTime << endl;
 
-    recordOutcome(1000.0 * bidTime,
-                  "accounts.%s.bidResponseTimeMs",
-                  config.account.toString('.'));
+    info.metrics->bidResponseTimeMs.record(1000.0 * bidTime);
+    info.stats->responseTimes.record(1000.0 * bidTime, dateGotBid);
 
 
     if (auctionInfo.bidders.empty()) {
         debugAuction(auctionId, "FINISH", originalMessage);
         if (!auctionInfo.auction->finish()) {
             debugAuction(auctionId, "FINISH TOO LATE", originalMessage);
-            recordHit("accounts.%s.FINISH_TOOLATE", agentConfig->account.toString('.'));
+            info.metrics->finishTooLate.recordHit();
         }
-        inFlight.erase(auctionId);
+        shard.inFlight.erase(auctionId);
         //cerr << "couldn't finish auction " << auctionInfo.auction->id
         //<< " after bid " << message << endl;
     }
@@ -2369,14 +3009,30 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
 
 void
 Router::
-doSubmitted(std::shared_ptr<Auction> auction)
+doSubmitted(std::shared_ptr<Auction> auction, AuctionShard & shard)
 {
     // Auction was submitted
 
     // Either a) move it across to the win queue, or b) drop it if we
     // didn't bid anything
 
-    RouterProfiler profiler(dutyCycleCurrent.nsSubmitted);
+    RouterProfiler profiler(shard.dutyCycle.nsSubmitted);
+
+    Date done = Date::nowFast();
+    auctionStages.record(*auction, done);
+
+    if (traced(auction->id)) {
+        AuctionStages::forEachStage(*auction, done,
+                                    [&] (AuctionStages::Stage stage,
+                                         Date from, Date to)
+            {
+                this->recordSpan(auction->id,
+                                 AuctionStages::stageName(stage), from, to);
+            });
+    }
+
+    GcLock::SharedGuard agentsGuard(allAgentsGc);
+    const AllAgentInfo * ac = allAgents;
 
     const Id & auctionId = auction->id;
 
@@ -2432,10 +3088,9 @@ doSubmitted(std::shared_ptr<Auction> auction)
 
             //cerr << "doing response " << i << endl;
 
-            if (!agents.count(response.agent)) continue;
-
-            AgentInfo & info = agents[response.agent];
-            const auto& agentConfig = info.config;
+            const AgentInfoEntry * info = findAgentEntry(ac, response.agent);
+            if (!info) continue;
+            const auto& agentConfig = info->config;
 
             Amount bid_price = response.price.maxPrice;
 
@@ -2448,7 +3103,12 @@ doSubmitted(std::shared_ptr<Auction> auction)
             ML::Call_Guard guard
                 ([&] ()
                  {
-                     banker->cancelBid(response.agentConfig->account, auctionKey);
+                     if (response.accountHandle != AccountHandles::NoAccount)
+                         banker->cancelBidByHandle(response.accountHandle,
+                                                   auctionKey);
+                     else
+                         banker->cancelBid(response.agentConfig->account,
+                                           auctionKey);
                  });
 
             // No bid
@@ -2473,17 +3133,17 @@ doSubmitted(std::shared_ptr<Auction> auction)
                                "auction should not be invalid");
             case Auction::WinLoss::LOSS:
                 bidStatus = BS_LOSS;
-                ++info.stats->losses;
+                ML::atomic_inc(info->stats->losses);
                 msg = "LOSS";
                 bidder->sendLossMessage(agentConfig, response.agent, auctionId.toString());
-                recordHit("accounts.%s.LOCAL_LOSS", agentConfig->account.toString('.'));
+                info->metrics->localLoss.recordHit();
                 break;
             case Auction::WinLoss::TOOLATE:
                 bidStatus = BS_TOOLATE;
-                ++info.stats->tooLate;
+                ML::atomic_inc(info->stats->tooLate);
                 msg = "TOOLATE";
                 bidder->sendTooLateMessage(agentConfig, response.agent, auction);
-                recordHit("accounts.%s.TOOLATE", agentConfig->account.toString('.'));
+                info->metrics->tooLate.recordHit();
                 break;
             default:
                 throwException("doSubmitted.unknownStatus",
@@ -2542,7 +3202,7 @@ void
 Router::
 onNewAuction(std::shared_ptr<Auction> auction)
 {
-    if (!monitorClient.getStatus(slowModeTolerance)) {
+    if (monitorClient.getAcceptRatio() == 0.0) {
         // check if slow mode active and in the same second then ignore the Auction
         Date now = Date::now();
         // TODO slowModeLastAuction is not atomic and a race condition could happen since it's
@@ -2594,7 +3254,10 @@ onAuctionDone(std::shared_ptr<Auction> auction)
 #endif
 
     debugAuction(auction->id, "SENT SUBMITTED");
-    submittedBuffer.push(auction);
+
+    AuctionShard & shard = shardFor(auction->id);
+    shard.submittedBuffer.push(auction);
+    shard.wakeup.signal();
 }
 
 void
@@ -2613,6 +3276,33 @@ onAuctionError(const std::string & channel,
     }
 }
 
+ConfigSet
+Router::
+sampleBidProbability()
+{
+    ConfigSet mask(true);
+
+    GcLock::SharedGuard guard(allAgentsGc);
+    const AllAgentInfo * ac = allAgents;
+    if (!ac) return mask;
+
+    for (const auto & group : ac->bidProbabilityGroups) {
+        double bidProbability = group.bidProbability * globalBidProbability;
+        if (bidProbability >= 1.0) continue;
+
+        float val = (random() % 1000000) / 1000000.0;
+        if (val <= bidProbability) continue;
+
+        for (int i : group.agents) {
+            const AgentInfoEntry & entry = (*ac)[i];
+            mask.reset(entry.filterIndex);
+            ML::atomic_inc(entry.stats->skippedBidProbability);
+        }
+    }
+
+    return mask;
+}
+
 void
 Router::
 updateAllAgents()
@@ -2636,11 +3326,26 @@ updateAllAgents()
             entry.config = it->second.config;
             entry.stats = it->second.stats;
             entry.status = it->second.status;
-            int i = newInfo->size();
+            entry.metrics = it->second.metrics;
             newInfo->push_back(entry);
+        }
+
+        newInfo->index();
 
-            newInfo->agentIndex[it->first] = i;
-            newInfo->accountIndex[it->second.config->account].push_back(i);
+        std::map<std::string, AllAgentInfo::BidProbabilityGroup> groups;
+        for (size_t i = 0; i < newInfo->size(); ++i) {
+            const AgentInfoEntry & entry = (*newInfo)[i];
+            string rrGroup = entry.config->roundRobinGroup;
+            if (rrGroup == "") rrGroup = entry.name;
+
+            auto & group = groups[rrGroup];
+            group.bidProbability += entry.config->bidProbability;
+            group.agents.push_back(i);
+        }
+
+        for (auto & group : groups) {
+            group.second.bidProbability /= group.second.agents.size();
+            newInfo->bidProbabilityGroups.push_back(std::move(group.second));
         }
 
         if (ML::cmp_xchg(allAgents, current, newInfo.get())) {
@@ -2653,54 +3358,96 @@ updateAllAgents()
     }
 }
 
+Router::PendingConfig
+Router::
+compileConfig(const std::string & agent,
+              std::shared_ptr<const AgentConfig> config)
+{
+    PendingConfig result;
+    result.agent = agent;
+    result.original = config;
+    if (!config) return result;
+
+    result.config = std::make_shared<AgentConfig>(*config);
+    if (result.config->roundRobinGroup == "")
+        result.config->roundRobinGroup = agent;
+
+    // Whatever wasn't checked here is checked again by the router loop.
+    try {
+        forAllExchanges([&] (const std::shared_ptr<ExchangeConnector> & exchange) {
+            configureAgentOnExchange(exchange, agent, *result.config);
+            result.exchanges.insert(exchange->exchangeName());
+        });
+    } catch (const std::exception & exc) {
+        cerr << "error checking the configuration of " << agent << ": "
+             << exc.what() << endl;
+    }
+
+    return result;
+}
+
 void
 Router::
-doConfig(const std::string & agent,
-         std::shared_ptr<const AgentConfig> config)
+doConfigs(std::map<std::string, PendingConfig> & configs)
 {
     RouterProfiler profiler(dutyCycleCurrent.nsConfig);
 
-    if (!config) {
-        auto it = agents.find(agent);
-        // It might happen that we don't find the agent if for example we received
-        // an empty configuration because the agent crashed prior to sending its initial
-        // configuration to the ACS.
-        if (it != std::end(agents)) {
-            cerr << "agent " << agent << " lost configuration" << endl;
-            filters.removeConfig(agent);
-            agents.erase(it);
+    FilterPool::ConfigUpdates updates;
+
+    for (auto & entry : configs) {
+        const std::string & agent = entry.first;
+        PendingConfig & pending = entry.second;
+
+        if (!pending.config) {
+            auto it = agents.find(agent);
+            // It might happen that we don't find the agent if for example we received
+            // an empty configuration because the agent crashed prior to sending its initial
+            // configuration to the ACS.
+            if (it != std::end(agents)) {
+                cerr << "agent " << agent << " lost configuration" << endl;
+                updates.emplace_back(agent, nullptr);
+                agents.erase(it);
+            }
+            continue;
         }
-    } else {
-        AgentInfo & info = agents[agent];
-        if (analytics) analytics->logConfigMessage(agent, boost::trim_copy(config->toJson().toString()));
-        logMessageToAnalytics("CONFIG", agent, boost::trim_copy(config->toJson().toString()));
 
-        // TODO: no need for this...
-        auto newConfig = std::make_shared<AgentConfig>(*config);
-        if (newConfig->roundRobinGroup == "")
-            newConfig->roundRobinGroup = agent;
+        // Rejected here rather than by configure() so that the rest of the
+        // batch still gets applied.
+        if (pending.config->account.empty()) {
+            cerr << "agent " << agent << " has an empty account" << endl;
+            continue;
+        }
 
+        AgentInfo & info = agents[agent];
+        string configStr = boost::trim_copy(pending.original->toJson().toString());
+        if (analytics) analytics->logConfigMessage(agent, configStr);
+        logMessageToAnalytics("CONFIG", agent, configStr);
 
         if (info.configured) {
             unconfigure(agent, *info.config);
             info.configured = false;
         }
 
-        info.config = newConfig;
-        //cerr << "configured " << agent << " strategy : " << info.config->strategy << " campaign "
-        //     <<  info.config->campaign << endl;
+        info.config = pending.config;
+        info.metrics = std::make_shared<AccountMetrics>(*this, info.config->account);
 
         string bidRequestFormat = "jsonRaw";
         info.setBidRequestFormat(bidRequestFormat);
 
-        configure(agent, *newConfig);
+        configure(agent, *info.config, pending.exchanges);
         info.configured = true;
-        bidder->sendMessage(config, agent, "GOTCONFIG");
+        bidder->sendMessage(pending.original, agent, "GOTCONFIG");
 
-        info.filterIndex = filters.addConfig(agent, info);
+        updates.emplace_back(agent, &info);
     }
 
-    // Broadcast that we have a new agent or it has a new configuration
+    auto indexes = filters.updateConfigs(updates);
+    for (size_t i = 0; i < updates.size(); ++i) {
+        if (updates[i].second)
+            agents[updates[i].first].filterIndex = indexes[i];
+    }
+
+    // Broadcast that we have new agents or new configurations
     updateAllAgents();
 }
 
@@ -2753,14 +3500,16 @@ configureAgentOnExchange(std::shared_ptr<ExchangeConnector> const & exchange,
 
 void
 Router::
-configure(const std::string & agent, AgentConfig & config)
+configure(const std::string & agent, AgentConfig & config,
+          const std::set<std::string> & checked)
 {
     if (config.account.empty())
         throw ML::Exception("attempt to add an account with empty values");
 
     // For each exchange, check campaign and creative compatibility
     forAllExchanges([&] (const std::shared_ptr<ExchangeConnector> & exchange) {
-        configureAgentOnExchange(exchange, agent, config);
+        if (!checked.count(exchange->exchangeName()))
+            configureAgentOnExchange(exchange, agent, config);
     });
 
     auto onDone = [=] (std::exception_ptr exc, ShadowAccount&& ac)
@@ -2897,9 +3646,16 @@ forEachAccountAgent(const AccountKey & account,
     if (it == ac->accountIndex.end())
         return;
 
-    for (auto jt = it->second.begin(), jend = it->second.end();
-         jt != jend;  ++jt)
-        onAgent(ac->at(*jt));
+    for (int i = it->second.first;  i < it->second.second;  ++i)
+        onAgent((*ac)[ac->accountSlots[i]]);
+}
+
+const AgentInfoEntry *
+Router::
+findAgentEntry(const AllAgentInfo * ac, const std::string & agent)
+{
+    if (!ac) return nullptr;
+    return ac->find(agent);
 }
 
 AgentInfoEntry
@@ -2910,10 +3666,10 @@ getAgentEntry(const std::string & agent) const
     const AllAgentInfo * ac = allAgents;
     if (!ac) return AgentInfoEntry();
 
-    auto it = ac->agentIndex.find(agent);
-    if (it == ac->agentIndex.end())
+    const AgentInfoEntry * entry = ac->find(agent);
+    if (!entry)
         return AgentInfoEntry();
-    return ac->at(it->second);
+    return *entry;
 }
 
 void
@@ -2936,9 +3692,15 @@ submitToPostAuctionService(std::shared_ptr<Auction> auction,
                         + "-" + adSpotId.toString()
                         + "-" + bid.agent;
 
-    banker->detachBid(bid.account, auctionKey);
-
-    recordHit("accounts.%s.submitted", bid.account.toString('.'));
+    if (bid.accountHandle != AccountHandles::NoAccount) {
+        banker->detachBidByHandle(bid.accountHandle, auctionKey);
+        recordHit("accounts.%s.submitted",
+                  accountHandles().metricName(bid.accountHandle));
+    }
+    else {
+        banker->detachBid(bid.account, auctionKey);
+        recordHit("accounts.%s.submitted", bid.account.toString('.'));
+    }
 
     if (connectPostAuctionLoop) {
         auto event = std::make_shared<SubmittedAuctionEvent>();
@@ -3060,12 +3822,14 @@ getProviderIndicators()
     const
 {
     bool connectedToPal = !connectPostAuctionLoop || postAuctionEndpoint.isConnected();
-    bool bankerOk = banker->getProviderIndicators().status;
+    MonitorIndicator bankerInd = banker->getProviderIndicators();
+    bool bankerOk = bankerInd.status;
 
     MonitorIndicator ind;
 
     ind.serviceName = serviceName();
     ind.status = connectedToPal && bankerOk;
+    ind.health = connectedToPal ? bankerInd.getHealth() : 0.0;
     ind.message = string()
         + "Connection to PAL: " + (connectedToPal ? "OK" : "ERROR") + ", "
         + "Banker: " + (bankerOk ? "OK": "ERROR");
@@ -18,16 +18,21 @@
 #include "soa/service/zmq_named_pub_sub.h"
 #include "soa/service/socket_per_thread.h"
 #include "soa/service/timeout_map.h"
+#include "soa/service/flat_timeout_map.h"
 #include "soa/service/pending_list.h"
 #include "soa/service/loop_monitor.h"
 #include "augmentation_loop.h"
+#include "auction_stages.h"
 #include "router_types.h"
 #include "soa/gc/gc_lock.h"
+#include "soa/gc/rcu_protected.h"
 #include "jml/utils/ring_buffer.h"
+#include "jml/utils/group_hash.h"
 #include "jml/arch/wakeup_fd.h"
 #include "jml/utils/smart_ptr_utils.h"
 #include <unordered_set>
 #include <thread>
+#include <mutex>
 #include "rtbkit/common/exchange_connector.h"
 #include "rtbkit/common/post_auction_proxy.h"
 #include "rtbkit/common/analytics_publisher.h"
@@ -54,8 +59,9 @@ struct AgentInfoEntry {
     std::string name;
     unsigned filterIndex;
     std::shared_ptr<const AgentConfig> config;
-    std::shared_ptr<const AgentStatus> status;
+    std::shared_ptr<AgentStatus> status;
     std::shared_ptr<AgentStats> stats;
+    std::shared_ptr<const AccountMetrics> metrics;
 
     bool valid() const { return config && stats; }
 
@@ -67,10 +73,48 @@ struct AgentInfoEntry {
 /** A read-only structure with information about all of the agents so
     that auctions can scan them without worrying about data dependencies.
     Uses RCU.
+
+    The entries are stored contiguously, and index() precomputes the ways
+    to get at them so that the bidding path, which knows the filter pool
+    config index of each agent, can find them without hashing a name.
 */
 struct AllAgentInfo : public std::vector<AgentInfoEntry> {
-    std::unordered_map<std::string, int> agentIndex;
-    std::unordered_map<AccountKey, std::vector<int> > accountIndex;
+
+    /** Build the indexes below from the entries. */
+    void index();
+
+    /** Return the entry of the given agent, or null if it's unknown. */
+    const AgentInfoEntry * find(const std::string & agent) const;
+
+    /** Return the entry of the agent with the given filter pool config
+        index, as long as that's still the given agent; otherwise it falls
+        back to looking the agent up by name.
+    */
+    const AgentInfoEntry *
+    find(unsigned configIndex, const std::string & agent) const;
+
+    /** Slot of each agent by name. */
+    ML::Group_Hash<std::string, int> agentIndex;
+
+    /** Slot of the agent with each filter pool config index, or -1. */
+    std::vector<int> configIndex;
+
+    /** Slots of the agents of each account, as a [begin, end) range of
+        accountSlots in which they are grouped together.
+    */
+    ML::Group_Hash<AccountKey, std::pair<int, int> > accountIndex;
+    std::vector<int> accountSlots;
+
+    /** Round robin group of agents that are sampled together according to
+        their average bid probability.
+    */
+    struct BidProbabilityGroup {
+        BidProbabilityGroup() : bidProbability(0.0) {}
+
+        double bidProbability;
+        std::vector<int> agents;  ///< Indexes of the agents in the group
+    };
+    std::vector<BidProbabilityGroup> bidProbabilityGroups;
 };
 
 /*****************************************************************************/
@@ -95,6 +139,71 @@ struct AuctionDebugInfo {
     std::vector<Message> messages;
 };
 
+/*****************************************************************************/
+/* AUCTION SHARD                                                             */
+/*****************************************************************************/
+
+/** State used to track auctions from the moment they are sent to the agents
+    until they are submitted or expire.
+
+    Auctions are assigned to a shard by the hash of their id so every event
+    of a given auction (start of bidding, bids, submission and expiry) is
+    processed by the thread that owns the shard and none of this needs to be
+    locked.  Agent configurations are only ever read through the allAgents
+    snapshot of the router.
+*/
+struct AuctionShard {
+    AuctionShard(unsigned index);
+
+    unsigned index;
+
+    ML::RingBufferSRMW<std::shared_ptr<AugmentationInfo> > startBiddingBuffer;
+    ML::RingBufferSRMW<std::shared_ptr<Auction> > submittedBuffer;
+    ML::RingBufferSRMW<BidMessage> doBidBuffer;
+
+    /** Raw BID messages received from the agents; they are parsed by the
+        shard thread.
+    */
+    ML::RingBufferSRMW<std::vector<std::string> > agentBidBuffer;
+
+    /** Signaled whenever something is pushed onto one of the buffers. */
+    ML::Wakeup_Fd wakeup;
+
+    /** Auctions taken off startBiddingBuffer that are waiting for
+        doStartBidding, kept as a heap on their expiry so that the closest
+        deadline goes first.
+    */
+    std::vector<std::shared_ptr<AugmentationInfo> > startBiddingQueue;
+
+    /** List of auctions we're currently tracking as active.  Open
+        addressed, so a reference to an entry only lasts until the next
+        auction is added.
+    */
+    typedef FlatTimeoutMap<Id, AuctionInfo> InFlight;
+    InFlight inFlight;
+
+    /** Auctions of this shard in which a given agent is participating. */
+    struct AgentBids {
+        std::shared_ptr<AgentStatus> status;
+        std::map<Id, Date> bids;
+    };
+    std::unordered_map<std::string, AgentBids> bidsInFlight;
+
+    /** Returns true if the bid was successfully recorded. */
+    bool trackBidInFlight(const std::string & agent,
+                          const std::shared_ptr<AgentStatus> & status,
+                          const Id & auctionId, Date date);
+
+    /** Returns true if the agent was bidding on the auction. */
+    bool expireBidInFlight(const std::string & agent, const Id & auctionId);
+
+    DutyCycleEntry dutyCycle;
+
+    /** Thread running the shard; null if the main router loop does it. */
+    boost::scoped_ptr<boost::thread> thread;
+};
+
+
 /*****************************************************************************/
 /* ROUTER                                                                    */
 /*****************************************************************************/
@@ -146,7 +255,8 @@ struct Router : public ServiceBase,
     void initBidderInterface(Json::Value const & json);
 
     /** Initialize analytics if it is used. */
-    void initAnalyticsPublisher(const std::string & baseUrl, const int numConnections);
+    void initAnalyticsPublisher(const std::string & baseUrl, const int numConnections,
+                                bool http2 = false);
 
     /** Initialize exchages from json configuration. */
     void initExchanges(const Json::Value & config);
@@ -201,10 +311,13 @@ struct Router : public ServiceBase,
     
     virtual void shutdown();
 
-    /** Iterate exchanges */
+    /** Iterate exchanges.  Works on a snapshot of the list so it doesn't
+        need to take the lock.
+    */
     template<typename F>
     void forAllExchanges(F functor) {
-        for(auto & item : exchanges)
+        auto current = exchanges();
+        for(auto & item : *current)
             functor(item);
     }
 
@@ -227,6 +340,10 @@ struct Router : public ServiceBase,
                                        std::shared_ptr<Auction> auction,
                                        const std::string message) {
                         this->onAuctionError(channel, auction, message); };
+
+        const ExchangeConnector * conn = &exchange;
+        exchange.preParseMatches = [=] (const BidRequest & br) {
+                        return this->filters.preParseMatches(br, conn); };
     }
 
     /** Register the exchange with the router and make it take ownership of it */
@@ -236,8 +353,7 @@ struct Router : public ServiceBase,
                 "exchanges." + exchange->exchangeName(),
                 exchange->getLoadSampleFn());
 
-        Guard guard(lock);
-        exchanges.push_back(std::shared_ptr<ExchangeConnector>(exchange));
+        publishExchange(std::shared_ptr<ExchangeConnector>(exchange));
         connectExchange(*exchange);
     }
 
@@ -251,8 +367,7 @@ struct Router : public ServiceBase,
                 "exchanges." + exchange.exchangeName(),
                 exchange.getLoadSampleFn());
 
-        Guard guard(lock);
-        exchanges.emplace_back(ML::make_unowned_std_sp(exchange));
+        publishExchange(ML::make_unowned_std_sp(exchange));
         connectExchange(exchange);
     }
     
@@ -269,8 +384,7 @@ struct Router : public ServiceBase,
                 "exchanges." + exchange->exchangeName(),
                 exchange->getLoadSampleFn());
 
-        Guard guard(lock);
-        exchanges.push_back(exchange);
+        publishExchange(exchange);
         connectExchange(*exchange);
     }
 
@@ -280,8 +394,7 @@ struct Router : public ServiceBase,
                 "exchanges." + exchange->exchangeName(),
                 exchange->getLoadSampleFn());
 
-        Guard guard(lock);
-        exchanges.push_back(exchange);
+        publishExchange(exchange);
     }
 
     /** Start up a new exchange from type and configuration from the given JSON blob. */
@@ -355,6 +468,21 @@ struct Router : public ServiceBase,
     /** Return the number of auctions in progress. */
     int numAuctionsInProgress() const;
 
+    /** Set the number of auction shards.  With more than one shard, each
+        shard gets its own thread to which auctions are dispatched based on
+        the hash of their id; otherwise the auctions are processed by the
+        main router loop.  Must be called before the router is started.
+    */
+    void setNumAuctionShards(unsigned numShards);
+
+    unsigned numAuctionShards() const { return shards.size(); }
+
+    /** Queue a parsed bid for processing by the shard that owns the
+        auction.  Can be called from any thread.  Returns false if the shard
+        can't keep up.
+    */
+    bool injectBid(BidMessage && message);
+
     /** Return the number of auctions awaiting a win/loss message. */
     int numAuctionsAwaitingResult() const;
 
@@ -387,9 +515,8 @@ struct Router : public ServiceBase,
     /** Auction accept probability */
     void setAcceptAuctionProbability(double val)
     {
-        Guard guard(lock);
-
-        for (auto& exchange : exchanges)
+        auto current = exchanges();
+        for (auto& exchange : *current)
             exchange->setAcceptBidRequestProbability(val);
     }
 
@@ -417,9 +544,22 @@ protected:
     // don't have to run in the main loop
     boost::scoped_ptr<boost::thread> cleanupThread;
 
-    typedef std::recursive_mutex Lock;
+    /** Only serializes the control plane (registration of exchanges and
+        the like); nothing on the auction path takes it.
+    */
+    typedef std::mutex Lock;
     typedef std::unique_lock<Lock> Guard;
 
+    /** Take the control plane lock, counting and timing the cases where
+        it is contended.
+    */
+    Guard lockControlPlane() const;
+
+    /** Add an exchange to the exchanges list, publishing a new version of
+        it.
+    */
+    void publishExchange(const std::shared_ptr<ExchangeConnector> & exchange);
+
     int shutdown_;
 
 public:
@@ -432,30 +572,59 @@ public:
     typedef std::map<std::string, AgentInfo> Agents;
     Agents agents;
 
-    ML::RingBufferSRMW<std::pair<std::string, std::shared_ptr<const AgentConfig> > > configBuffer;
+    /** Configuration received from the listener, already checked against
+        the exchanges on the listener's thread so that the router loop only
+        has to publish it.
+    */
+    struct PendingConfig {
+        std::string agent;
+        std::shared_ptr<const AgentConfig> original;
+        std::shared_ptr<AgentConfig> config;    ///< Null if the agent is gone
+        std::set<std::string> exchanges;        ///< Exchanges it was checked on
+    };
+
+    ML::RingBufferSRMW<PendingConfig> configBuffer;
     ML::RingBufferSRMW<std::shared_ptr<ExchangeConnector> > exchangeBuffer;
-    ML::RingBufferSRMW<std::shared_ptr<AugmentationInfo> > startBiddingBuffer;
-    ML::RingBufferSRMW<std::shared_ptr<Auction> > submittedBuffer;
     ML::RingBufferSWMR<std::shared_ptr<Auction> > auctionGraveyard;
-    ML::RingBufferSRMW<BidMessage> doBidBuffer;
 
     ML::Wakeup_Fd wakeupMainLoop;
 
     FilterPool filters;
 
+    /** Latency of the stages of the auctions, reported every 10 seconds. */
+    AuctionStages auctionStages;
+
     AugmentationLoop augmentationLoop;
+    /** Shared by all the auction shards; does its own locking. */
     Blacklist blacklist;
 
     LoopMonitor loopMonitor;
     LoadStabilizer loadStabilizer;
 
-    /** List of auctions we're currently tracking as active. */
-    typedef TimeoutMap<Id, AuctionInfo> InFlight;
-    InFlight inFlight;
+    typedef AuctionShard::InFlight InFlight;
+
+    /** Auction shards.  Never empty; there is a single shard processed by
+        the main loop unless setNumAuctionShards was called.
+    */
+    std::vector<std::unique_ptr<AuctionShard> > shards;
+
+    /** Shard that owns the given auction. */
+    AuctionShard & shardFor(const Id & auctionId)
+    {
+        if (shards.size() == 1) return *shards[0];
+        return *shards[auctionId.hash() % shards.size()];
+    }
+
+    /** Are the shards run by their own threads? */
+    bool threadedShards() const { return shards.size() > 1; }
+
+    /** Main loop of a shard's thread. */
+    void runShard(AuctionShard & shard);
 
     /** Add the given auction to our data structures. */
     AuctionInfo &
-    addAuction(std::shared_ptr<Auction> auction, Date timeout);
+    addAuction(AuctionShard & shard,
+               std::shared_ptr<Auction> auction, Date timeout);
 
     DutyCycleEntry dutyCycleCurrent;
     std::vector<DutyCycleEntry> dutyCycleHistory;
@@ -466,8 +635,20 @@ public:
 
     void checkDeadAgents();
 
+    /** Tell the agents about the bids of the shard that have been in
+        flight for so long that they were probably lost.
+    */
+    void checkLostBids(AuctionShard & shard);
+
+    /** Publishes estimates of the memory held by the auctions of the
+        shard.
+    */
+    void recordMemUsage(AuctionShard & shard);
+
     void checkExpiredAuctions();
 
+    void checkExpiredAuctions(AuctionShard & shard);
+
     void returnErrorResponse(const std::vector<std::string> & message,
                              const std::string & error);
 
@@ -488,6 +669,12 @@ public:
     std::shared_ptr<AugmentationInfo>
     preprocessAuction(const std::shared_ptr<Auction> & auction);
 
+    /** Draws which round robin groups will take part in an auction given
+        their bid probability and returns the mask of the filter indexes of
+        the agents that do, so that the others don't go through the filters.
+    */
+    ConfigSet sampleBidProbability();
+
     /** Send the auction for augmentation.  Once that is done, doStartBidding
         will be called.
     */
@@ -499,18 +686,36 @@ public:
     void doStartBidding(const std::vector<std::string> & message);
 
     /** Ditto but taking the augmented auction directly. */
-    void doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo);
+    void doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo,
+                        AuctionShard & shard);
+
+    /** Runs doStartBidding on everything waiting in the startBiddingBuffer
+        of the shard, earliest deadline first.  Auctions that are already
+        past their deadline are dropped without routing them.  Returns the
+        number of auctions that were taken off the buffer.
+    */
+    int startBidding(AuctionShard & shard);
 
     /** Auction has been submitted.  Do the final cleanup here and send
         it off to the post auction loop. */
-    void doSubmitted(std::shared_ptr<Auction> auction);
+    void doSubmitted(std::shared_ptr<Auction> auction, AuctionShard & shard);
 
     //std::unordered_set<Id> recentlySubmitted;  // DEBUG
 
-    /** An agent bid on an auction.  Arrange for this bid to be recorded. */
+    /** An agent bid on an auction.  Arrange for this bid to be recorded by
+        the shard that owns the auction.
+    */
     void doBid(const std::vector<std::string> & message);
 
-    void doBidImpl(const BidMessage &message,
+    /** An agent bid on several auctions at once.  Each is handled as if it
+        came in its own BID message.
+    */
+    void doBids(const std::vector<std::string> & message);
+
+    /** Parse and record the bid from an agent. */
+    void doBid(const std::vector<std::string> & message, AuctionShard & shard);
+
+    void doBidImpl(const BidMessage &message, AuctionShard & shard,
                    const std::vector<std::string> &originalMessage = std::vector<std::string>());
 
     /** An agent responded to a ping message.  Arrange for the ping time
@@ -536,9 +741,16 @@ public:
                         std::shared_ptr<Auction> auction,
                         const std::string & message);
 
-    /** Got a configuration message; update our internal data structures */
-    void doConfig(const std::string & agent,
-                  std::shared_ptr<const AgentConfig> config);
+    /** Copies the configuration and checks it against the exchanges.  Called
+        from the listener's thread.
+    */
+    PendingConfig compileConfig(const std::string & agent,
+                                std::shared_ptr<const AgentConfig> config);
+
+    /** Got a batch of configurations, at most one per agent; update our
+        internal data structures with a single swap of the filters.
+    */
+    void doConfigs(std::map<std::string, PendingConfig> & configs);
 
     /* Add a given agent (with the given configuration) to the exchange */
     void configureAgentOnExchange(std::shared_ptr<ExchangeConnector> const & exchange,
@@ -552,12 +764,18 @@ public:
     void unconfigure(const std::string & agent, const AgentConfig & config);
 
     /** Add the given agent (with the given configuration) to the
-        configuration structures.
+        configuration structures.  The exchanges in checked were already
+        configured by compileConfig().
     */
-    void configure(const std::string & agent, AgentConfig & config);
+    void configure(const std::string & agent, AgentConfig & config,
+                   const std::set<std::string> & checked
+                       = std::set<std::string>());
 
     mutable Lock lock;
 
+    /** Number of times lockControlPlane() had to wait for the lock. */
+    mutable uint64_t numLockContentions;
+
     std::shared_ptr<Banker> banker;
 
     double secondsUntilLossAssumed_;
@@ -576,7 +794,7 @@ public:
     AllAgentInfo * allAgents;
 
     /** RCU protection for allAgents. */
-    mutable GcLock allAgentsGc;
+    mutable ScalableGcLock allAgentsGc;
 
     typedef std::function<void (const AgentInfoEntry & info)> OnAgentFn;
     /** Call the given callback for each agent. */
@@ -593,6 +811,12 @@ public:
     */
     AgentInfoEntry getAgentEntry(const std::string & agent) const;
 
+    /** Find the entry for the given agent in a snapshot of allAgents.  The
+        caller must hold allAgentsGc.  Returns null if the agent is unknown.
+    */
+    static const AgentInfoEntry *
+    findAgentEntry(const AllAgentInfo * ac, const std::string & agent);
+
     /** Listen for changes in configuration and let the router know about
         them.
     */
@@ -601,8 +825,14 @@ public:
     /** Are we initialized? */
     bool initialized;
 
-    /** List of exchanges that are active. */
-    std::vector<std::shared_ptr<ExchangeConnector> > exchanges;
+    /** RCU protection for exchanges. */
+    mutable GcLock exchangesGc;
+
+    /** List of exchanges that are active.  Readers use a snapshot;
+        modifications replace the whole list under the lock.
+    */
+    typedef std::vector<std::shared_ptr<ExchangeConnector> > Exchanges;
+    RcuProtected<Exchanges> exchanges;
 
     /** Bid price calculator */
     std::shared_ptr<BidderInterface> bidder;
@@ -629,8 +859,9 @@ public:
                         const std::string & exception,
                         Args... args)
     {
-        analyticsPublisher.publish("ROUTERERROR", Date::now().print(5),
-                       function, exception, args...);
+        if (analyticsPublisher.isEnabled("ROUTERERROR"))
+            analyticsPublisher.publish("ROUTERERROR", Date::now().print(5),
+                                       function, exception, args...);
         recordHit("error.%s", function);
     }
 
@@ -725,6 +956,7 @@ public:
     template<typename... Args>
     void logMessageToAnalytics(const std::string & channel, Args... args)
     {
+        if (!analyticsPublisher.isEnabled(channel)) return;
         analyticsPublisher.publish(channel, Date::now().print(5), args...);
     }
 
@@ -764,7 +996,7 @@ public:
     void dumpAuction(const Id & auctionId) const;
     void dumpSpot(const Id & auctionId, const Id & spotId) const;
 
-    Date getCurrentTime() const { return Date::now(); }
+    Date getCurrentTime() const { return Date::nowFast(); }
 
     std::unique_ptr<Analytics> analytics;
     AnalyticsPublisher analyticsPublisher;
@@ -794,6 +1026,9 @@ public:
     Amount slowModeAuthorizedMoneyLimit;
     uint64_t accumulatedBidMoneyInThisPeriod;
 
+    /** Serializes the slow mode accounting between the auction shards. */
+    ML::Spinlock slowModeLock;
+
     /* MONITOR PROVIDER */
     /* Post service health status to Monitor */
     MonitorProviderClient monitorProviderClient;
@@ -807,6 +1042,30 @@ public:
 
     double slowModeTolerance;
     Seconds augmentationWindow;
+
+    /** Check the blacklist with the static filters, before the auction is
+        sent for augmentation, so that the augmentors aren't asked for
+        agents that can't bid.  The check is still done again once the
+        augmentation is done.
+    */
+    bool earlyBlacklistFilter;
+
+    /** Don't send an auction to the agents whose 95th percentile response
+        time over the last few seconds is more than the time it has left.
+    */
+    bool skipSlowAgents;
+
+    /** Offer the agents running on this host to talk to us through shared
+        memory instead of the agents bus.  Must be set before init().
+    */
+    bool agentShm;
+
+    /** Broadcast the auctions going to at least this many agents once
+        to all of them instead of sending them to each; 0 disables it.
+        Only done for the agents bus bound by bindTcp().  Must be set before
+        bindTcp().
+    */
+    int agentBroadcast;
 };
 
 
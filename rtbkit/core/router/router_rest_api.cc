@@ -21,10 +21,9 @@ namespace RTBKIT {
 
 RouterRestApiConnection::
 RouterRestApiConnection(const string& name,
-                        ServiceBase& parent,
-                        Router* router) :
-    HttpMonitorHandler(name, parent, router),
-    router(router)
+                        RouterRestApi* api) :
+    HttpMonitorHandler(name, api),
+    api(api)
 {
 }
 
@@ -32,22 +31,24 @@ void
 RouterRestApiConnection::
 doGet(const std::string& resource)
 {
+    auto snapshot = api->snapshot();
+    if (!snapshot) {
+        sendErrorResponse(503, string("router state not published yet"));
+        return;
+    }
+
     if (header.resource == "/stats")
-        sendResponse(router->getStats());
+        sendResponse(snapshot->stats);
     else if (header.resource == "/agents") {
-        sendResponse(router->getAllAgentInfo());
+        sendResponse(snapshot->agents);
     }
     else if (header.resource.find("/agent/") == 0) {
         string agentName(header.resource, 7);
-        sendResponse(router->getAgentInfo(agentName));
-    }
-    else if (header.resource.find("/strategy/") == 0) {
-        string strategyName(header.resource, 10);
-        sendResponse(router->getStrategyInfo(strategyName));
-    }
-    else if (header.resource.find("/campaign/") == 0) {
-        string campaignName(header.resource, 10);
-        sendResponse(router->getCampaignInfo(campaignName));
+        if (!snapshot->agents.isMember(agentName)) {
+            sendErrorResponse(404, "unknown agent '" + agentName + "'");
+            return;
+        }
+        sendResponse(snapshot->agents[agentName]);
     }
     else {
         sendErrorResponse(
@@ -84,4 +85,83 @@ doPost(const std::string& resource, const std::string& payload)
     }
 }
 
+
+/******************************************************************************/
+/* ROUTER REST API                                                            */
+/******************************************************************************/
+
+RouterRestApi::
+RouterRestApi(const string& name, Router* router, double period) :
+    HttpMonitor(name),
+    router(router),
+    period(period),
+    shutdown_(false)
+{
+}
+
+RouterRestApi::
+~RouterRestApi()
+{
+    shutdown();
+}
+
+void
+RouterRestApi::
+start(int port, int numThreads)
+{
+    publish();
+
+    publisher.reset(new boost::thread([=] () {
+                std::unique_lock<std::mutex> guard(lock);
+                while (!shutdown_) {
+                    cond.wait_for(guard, std::chrono::milliseconds(
+                                          int(period * 1000)));
+                    if (shutdown_) break;
+
+                    guard.unlock();
+                    try {
+                        publish();
+                    } catch (const std::exception & exc) {
+                        cerr << "error publishing the router's state: "
+                             << exc.what() << endl;
+                    }
+                    guard.lock();
+                }
+            }));
+
+    HttpMonitor::start(port, this, numThreads);
+}
+
+void
+RouterRestApi::
+shutdown()
+{
+    if (!publisher) return;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        shutdown_ = true;
+    }
+    cond.notify_all();
+    publisher->join();
+    publisher.reset();
+
+    HttpMonitor::shutdown();
+}
+
+void
+RouterRestApi::
+publish()
+{
+    // Only reads the RCU protected agent snapshot; nothing here waits on
+    // the bidding loop.
+    auto snapshot = std::make_shared<RouterRestSnapshot>();
+    snapshot->published = Date::now();
+    snapshot->stats = router->getStats();
+    snapshot->agents = router->getAllAgentInfo();
+
+    std::atomic_store(&current,
+                      std::shared_ptr<const RouterRestSnapshot>(snapshot));
+}
+
 } // namespace RTBKIT
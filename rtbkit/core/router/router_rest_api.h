@@ -10,23 +10,44 @@
 
 #include "soa/service/http_monitor.h"
 #include "soa/service/service_base.h"
+#include "soa/types/date.h"
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 
 namespace RTBKIT {
 
 struct Router;
+struct RouterRestApi;
+
+/******************************************************************************/
+/* ROUTER REST SNAPSHOT                                                       */
+/******************************************************************************/
+
+/** What the REST API serves.  Built away from the bidding loop and never
+    modified once published.
+*/
+struct RouterRestSnapshot {
+    Datacratic::Date published;
+    Json::Value stats;
+    Json::Value agents;         ///< Agent info by agent name
+};
+
 
 /******************************************************************************/
 /* ROUTER REST API CONNECTION                                                 */
 /******************************************************************************/
 
 struct RouterRestApiConnection
-    : public HttpMonitorHandler<RouterRestApiConnection, Router*> {
+    : public Datacratic::HttpMonitorHandler<RouterRestApiConnection, RouterRestApi*> {
 
     RouterRestApiConnection(const std::string& name,
-                            Router* router);
+                            RouterRestApi* api);
 
-    Router * router;
+    RouterRestApi * api;
 
     virtual void doGet(const std::string& resource);
 
@@ -34,7 +55,57 @@ struct RouterRestApiConnection
                         const std::string& payload);
 };
 
-typedef HttpMonitor<RouterRestApiConnection, Router*> RouterRestApi;
+
+/******************************************************************************/
+/* ROUTER REST API                                                            */
+/******************************************************************************/
+
+/** HTTP API to look at a running router:
+
+    - GET /stats: the router's stats;
+    - GET /agents: info on all the agents;
+    - GET /agent/<name>: info on one agent;
+    - POST /validateConfig: parse an agent configuration.
+
+    The reads are answered from a snapshot that a thread of its own rebuilds
+    every period seconds and publishes atomically, and the connections are
+    handled by the endpoint's own threads.  However often the API is polled,
+    the router only pays for one snapshot per period, and never on the
+    bidding loop.
+*/
+struct RouterRestApi
+    : public Datacratic::HttpMonitor<RouterRestApiConnection, RouterRestApi*> {
+
+    RouterRestApi(const std::string& name, Router* router,
+                  double period = 1.0);
+
+    ~RouterRestApi();
+
+    /** Publish a first snapshot and start serving on the given port. */
+    void start(int port, int numThreads = 2);
+
+    void shutdown();
+
+    /** The last published snapshot; never null once started. */
+    std::shared_ptr<const RouterRestSnapshot> snapshot() const
+    {
+        return std::atomic_load(&current);
+    }
+
+    /** Build a new snapshot from the router and publish it. */
+    void publish();
+
+    Router * router;
+    double period;
+
+private:
+    std::shared_ptr<const RouterRestSnapshot> current;
+
+    std::mutex lock;
+    std::condition_variable cond;
+    bool shutdown_;
+    boost::scoped_ptr<boost::thread> publisher;
+};
 
 } // namespace RTBKIT
 
@@ -64,7 +64,17 @@ RouterRunner() :
     analyticsPublisherOn(false),
     analyticsPublisherConnections(1),
     augmentationWindowms(5),
-    dableSlowMode(false)
+    augmentationReserveMs(0),
+    earlyBlacklistFilter(false),
+    noSlowAgentSkipping(false),
+    agentShm(false),
+    agentBroadcast(0),
+    dableSlowMode(false),
+    auctionShards(1),
+    filterCacheSize(0),
+    slowAuctionMs(50.0),
+    slowAuctionSampling(100),
+    restApiPort(0)
 {
 }
 
@@ -117,6 +127,34 @@ doOptions(int argc, char ** argv,
          "split or local banker can be chosen.")
          ("augmenter-timeout",value<int>(&augmentationWindowms),
          "configure the augmenter  timeout (in milliseconds)")
+        ("augmenter-reserve", value<int>(&augmentationReserveMs),
+         "time left to bid (in milliseconds) past which augmentors are no longer waited on (default is 0).")
+        ("early-blacklist-filter", bool_switch(&earlyBlacklistFilter),
+         "check the blacklist before sending the auctions for augmentation.")
+        ("no-slow-agent-skipping", bool_switch(&noSlowAgentSkipping),
+         "send the auctions to the agents even when they usually answer after the time left.")
+        ("agent-shm", bool_switch(&agentShm),
+         "let the bidding agents on this host talk to the router through shared memory.")
+        ("agent-broadcast", value<int>(&agentBroadcast),
+         "publish the auctions matched by at least this many agents once for all of them (default is 0, never).")
+        ("augmentor-cache", value<vector<string> >(&augmentorCaches),
+         "cache the responses of an augmentor per user, as name:ttlSeconds[:idDomain] (the domain defaults to prov).")
+        ("augmentor-affinity", value<vector<string> >(&augmentorAffinities),
+         "send the requests of each user to the same instance of an augmentor, as name[:idDomain[:maxLoad]] (the domain defaults to prov, the load past which the least loaded instance is used instead to 0.8).")
+        ("auction-shards", value<int>(&auctionShards),
+         "number of threads processing in flight auctions (default is 1).")
+        ("filter-cache-size", value<int>(&filterCacheSize),
+         "number of results of the request static filters to cache (default is 0, disabled).")
+        ("slow-auction-trace", value<string>(&slowAuctionTraceFile),
+         "file to write the timestamps of a sample of the slow auctions to.")
+        ("slow-auction-ms", value<double>(&slowAuctionMs),
+         "time past which an auction is traced as slow (default is 50ms).")
+        ("slow-auction-sampling", value<int>(&slowAuctionSampling),
+         "trace one in that many of the slow auctions (default is 100).")
+        ("agent-config-snapshot", value<string>(&agentConfigSnapshot),
+         "file to keep the agent configurations in, to bid with them right away on the next start.")
+        ("rest-api-port", value<int>(&restApiPort),
+         "port of the HTTP API serving the router's state (default is none).")
         ("no slow mode", value<bool>(&dableSlowMode)->zero_tokens(),
          "disable the slow mode.");
 
@@ -183,6 +221,40 @@ init()
                                       USD_CPM(maxBidPrice),
                                       slowModeTimeout, amountSlowModeMoneyLimit, augmentationWindow);
     router->slowModeTolerance = slowModeTolerance;
+    router->setNumAuctionShards(auctionShards);
+    router->filters.setCacheSize(filterCacheSize);
+    router->augmentationLoop.setDeadlineReserve(augmentationReserveMs);
+    router->earlyBlacklistFilter = earlyBlacklistFilter;
+    router->skipSlowAgents = !noSlowAgentSkipping;
+    router->agentShm = agentShm;
+    router->agentBroadcast = agentBroadcast;
+    router->auctionStages.traceSlowAuctions(
+            slowAuctionTraceFile, slowAuctionMs, slowAuctionSampling);
+    for (const auto & spec: augmentorCaches) {
+        vector<string> fields;
+        boost::split(fields, spec, boost::is_any_of(":"));
+        if (fields.size() < 2 || fields.size() > 3)
+            THROW(error) << "invalid augmentor-cache " << spec
+                         << ", expected name:ttlSeconds[:idDomain]" << endl;
+
+        router->augmentationLoop.setCache(
+                fields[0], std::stod(fields[1]),
+                fields.size() == 3 ? fields[2] : "prov");
+    }
+    for (const auto & spec: augmentorAffinities) {
+        vector<string> fields;
+        boost::split(fields, spec, boost::is_any_of(":"));
+        if (fields.size() > 3)
+            THROW(error) << "invalid augmentor-affinity " << spec
+                         << ", expected name[:idDomain[:maxLoad]]" << endl;
+
+        router->augmentationLoop.setAffinity(
+                fields[0],
+                fields.size() >= 2 ? fields[1] : "prov",
+                fields.size() == 3 ? std::stod(fields[2]) : 0.8);
+    }
+    if (!agentConfigSnapshot.empty())
+        router->configListener.setSnapshot(agentConfigSnapshot);
     router->initBidderInterface(bidderConfig);
     if (dableSlowMode) {
        router->unsafeDisableSlowMode();
@@ -190,7 +262,8 @@ init()
     if (analyticsPublisherOn) {
         const auto & analyticsPublisherUri = proxies->params["analytics-uri"].asString();
         if (!analyticsPublisherUri.empty()) {
-            router->initAnalyticsPublisher(analyticsPublisherUri, analyticsPublisherConnections);
+            router->initAnalyticsPublisher(analyticsPublisherUri, analyticsPublisherConnections,
+                                           proxies->params.get("analytics-http2", false).asBool());
         }
         else
             LOG(print) << "analyticsPublisher-uri is not in the config" << endl;
@@ -230,6 +303,10 @@ init()
     router->initExchanges(exchangeConfig);
     router->initFilters(filterConfig);
     router->bindTcp();
+
+    if (restApiPort)
+        restApi = make_shared<RouterRestApi>(
+                router->serviceName() + ".restApi", router.get());
 }
 
 void
@@ -239,12 +316,14 @@ start()
     if (slaveBanker) slaveBanker->start();
     if (localBanker) localBanker->start();
     router->start();
+    if (restApi) restApi->start(restApiPort);
 }
 
 void
 RouterRunner::
 shutdown()
 {
+    if (restApi) restApi->shutdown();
     router->shutdown();
     if (slaveBanker) slaveBanker->shutdown();
     if (localBanker) localBanker->shutdown();
@@ -10,6 +10,7 @@
 
 #include <boost/program_options/options_description.hpp>
 #include "rtbkit/core/router/router.h"
+#include "rtbkit/core/router/router_rest_api.h"
 #include "rtbkit/core/banker/slave_banker.h"
 #include "rtbkit/core/banker/local_banker.h"
 #include "soa/service/service_utils.h"
@@ -55,7 +56,21 @@ struct RouterRunner {
     bool analyticsPublisherOn;
     int analyticsPublisherConnections;
     int augmentationWindowms;
+    int augmentationReserveMs;
+    bool earlyBlacklistFilter;
+    bool noSlowAgentSkipping;
+    bool agentShm;
+    int agentBroadcast;
+    std::vector<std::string> augmentorCaches;
+    std::vector<std::string> augmentorAffinities;
     bool dableSlowMode;
+    int auctionShards;
+    int filterCacheSize;
+    std::string slowAuctionTraceFile;
+    double slowAuctionMs;
+    int slowAuctionSampling;
+    std::string agentConfigSnapshot;
+    int restApiPort;
 
     void doOptions(int argc, char ** argv,
                    const boost::program_options::options_description & opts
@@ -66,6 +81,7 @@ struct RouterRunner {
     std::shared_ptr<SlaveBanker> slaveBanker;
     std::shared_ptr<LocalBanker> localBanker;
     std::shared_ptr<Router> router;
+    std::shared_ptr<RouterRestApi> restApi;
 
     static Logging::Category print;
     static Logging::Category trace;
@@ -135,7 +135,7 @@ numNonIdle() const
 {
     size_t numInFlight, numAwaitingAugmentation;
     {
-        numInFlight = router.inFlight.size();
+        numInFlight = router.numAuctionsInProgress();
         numAwaitingAugmentation = router.augmentationLoop.numAugmenting();
     }
 
@@ -8,6 +8,7 @@
 #include "router_types.h"
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "jml/db/persistent.h"
+#include <mutex>
 
 using namespace std;
 using namespace ML;
@@ -141,6 +142,95 @@ setBidRequestFormat(const std::string & val)
     // TODO
 }
 
+AccountMetrics::
+AccountMetrics(const Datacratic::EventRecorder & recorder,
+               const AccountKey & account)
+    : account(accountHandles().intern(account))
+{
+    string prefix = "accounts." + accountHandles().metricName(this->account)
+        + ".";
+
+    auto hit = [&] (const char * name)
+        {
+            return recorder.getEventHandle(Datacratic::ET_HIT, prefix + name);
+        };
+
+    bids = hit("bids");
+    ignored = hit("IGNORED");
+    noBudget = hit("NOBUDGET");
+    localLoss = hit("LOCAL_LOSS");
+    tooLate = hit("TOOLATE");
+    invalid = hit("INVALID");
+    finishTooLate = hit("FINISH_TOOLATE");
+    bidResponseTimeMs = recorder.getEventHandle(Datacratic::ET_OUTCOME,
+                                                prefix + "bidResponseTimeMs");
+}
+
+AgentResponseTimes::
+AgentResponseTimes(double windowSeconds, uint64_t minSamples)
+    : windowSeconds(windowSeconds), minSamples(minSamples),
+      sinceUpdate(0), p95(0.0), p95Until(0.0)
+{
+}
+
+void
+AgentResponseTimes::
+record(double responseMs, Date now)
+{
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    bool rotated = false;
+    if (now.secondsSince(currentStart) >= windowSeconds) {
+        if (now.secondsSince(currentStart) >= 2 * windowSeconds)
+            previous.clear();
+        else std::swap(previous, current);
+        current.clear();
+        currentStart = now;
+        rotated = true;
+    }
+
+    current.record(responseMs);
+
+    // Going through the buckets for every response would cost more than
+    // the response itself
+    if (rotated || ++sinceUpdate == 16)
+        update();
+}
+
+void
+AgentResponseTimes::
+update()
+{
+    sinceUpdate = 0;
+
+    double value = 0.0;
+    if (current.count() + previous.count() >= minSamples) {
+        QuantileSketch both = previous;
+        both.merge(current);
+        value = both.percentile(95);
+    }
+
+    p95 = value;
+    p95Until = currentStart.plusSeconds(2 * windowSeconds).secondsSinceEpoch();
+}
+
+double
+AgentResponseTimes::
+p95Ms(Date now) const
+{
+    if (now.secondsSinceEpoch() >= p95Until) return 0.0;
+    return p95;
+}
+
+Json::Value
+AgentResponseTimes::
+toJson(Date now) const
+{
+    Json::Value result;
+    result["p95Ms"] = p95Ms(now);
+    return result;
+}
+
 AgentStats::
 AgentStats()
     : auctions(0), bids(0), wins(0), losses(0), tooLate(0),
@@ -162,7 +252,8 @@ AgentStats()
       filter2Excluded(0),
       filternExcluded(0),
       unknownWins(0), unknownLosses(0),
-      requiredAugmentorIsMissing(0), augmentorValueIsNull(0)
+      requiredAugmentorIsMissing(0), augmentorValueIsNull(0),
+      tooSlow(0)
 {
 }
 
@@ -216,6 +307,9 @@ toJson() const
     result["requiredAugmentorIsMissing"] = requiredAugmentorIsMissing;
     result["augmentorValueIsNull"] = augmentorValueIsNull;
 
+    result["tooSlow"] = tooSlow;
+    result["responseTimes"] = responseTimes.toJson();
+
     return result;
 }
 
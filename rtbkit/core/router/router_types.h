@@ -14,6 +14,10 @@
 #include <set>
 #include "rtbkit/common/currency.h"
 #include "rtbkit/common/bids.h"
+#include "jml/arch/spinlock.h"
+#include "soa/service/service_base.h"
+#include "soa/service/quantile_sketch.h"
+#include <atomic>
 
 
 namespace RTBKIT {
@@ -37,6 +41,53 @@ struct BiddableSpots : public BiddableSpotsBase {
     std::string toJsonStr() const;
 };
 
+/*****************************************************************************/
+/* AGENT RESPONSE TIMES                                                      */
+/*****************************************************************************/
+
+/** Recent response times of an agent, so that the router doesn't send it
+    the auctions that it won't answer before they close.  The times are
+    kept over two consecutive windows, and their 95th percentile is worked
+    out again every few responses so that reading it costs nothing.
+*/
+struct AgentResponseTimes {
+
+    AgentResponseTimes(double windowSeconds = 10.0, uint64_t minSamples = 20);
+
+    /** Records the time the agent took to answer.  Bids that expired
+        without an answer are recorded with the time they waited.
+    */
+    void record(double responseMs, Date now);
+
+    /** 95th percentile of the response times of the last two windows, or
+        0 if there were fewer than minSamples of them.  That way an agent
+        that is skipped for being slow gets tried again once its old
+        responses have aged out.
+    */
+    double p95Ms(Date now) const;
+
+    Json::Value toJson(Date now = Date::now()) const;
+
+private:
+    void update();
+
+    double windowSeconds;
+    uint64_t minSamples;
+
+    ML::Spinlock lock;
+    QuantileSketch current, previous;
+    Date currentStart;
+    unsigned sinceUpdate;
+
+    std::atomic<double> p95;
+    std::atomic<double> p95Until;   ///< Seconds since epoch it's valid until
+};
+
+
+/*****************************************************************************/
+/* AGENT STATS                                                               */
+/*****************************************************************************/
+
 struct AgentStats {
 
     AgentStats();
@@ -51,6 +102,11 @@ struct AgentStats {
     uint64_t invalid;
     uint64_t noBudget;
 
+    /** Protects the currency pools, which can be updated concurrently by
+        several auction shards.
+    */
+    ML::Spinlock currencyLock;
+
     CurrencyPool totalBid;
     CurrencyPool totalBidOnWins;
     CurrencyPool totalSpent;
@@ -89,6 +145,9 @@ struct AgentStats {
 
     uint64_t requiredAugmentorIsMissing;
     uint64_t augmentorValueIsNull;
+
+    uint64_t tooSlow;
+    AgentResponseTimes responseTimes;
 };
 
 
@@ -101,9 +160,34 @@ struct AgentStatus {
 
     bool dead;
     Date lastHeartbeat;
+
+    /** Total number of auctions that the agent is bidding on, over all of
+        the auction shards.  Updated atomically by the shards.
+    */
     size_t numBidsInFlight;
 };
 
+/** Handles on the metrics that the router records under accounts.<account>
+    on each bid, and on the account itself for the banker.  They are resolved
+    when the agent is configured, so that recording one doesn't format the
+    account into the name and look the stat up each time.
+*/
+struct AccountMetrics {
+    AccountMetrics(const Datacratic::EventRecorder & recorder,
+                   const AccountKey & account);
+
+    AccountHandle account;
+
+    Datacratic::EventHandle bids;
+    Datacratic::EventHandle ignored;
+    Datacratic::EventHandle noBudget;
+    Datacratic::EventHandle localLoss;
+    Datacratic::EventHandle tooLate;
+    Datacratic::EventHandle invalid;
+    Datacratic::EventHandle finishTooLate;
+    Datacratic::EventHandle bidResponseTimeMs;
+};
+
 /// Information about a agent
 struct AgentInfo {
     AgentInfo()
@@ -126,6 +210,7 @@ struct AgentInfo {
     std::shared_ptr<AgentConfig> config;
     std::shared_ptr<AgentStatus> status;
     std::shared_ptr<AgentStats> stats;
+    std::shared_ptr<const AccountMetrics> metrics;
     double throttleProbability;
 
     /** Address of the zeromq socket for this agent. */
@@ -189,47 +274,19 @@ struct AgentInfo {
     Json::Value toJson(bool includeConfig = true,
                        bool includeStats = true) const;
 
-    void gotHeartbeat(Date when = Date::now())
+    void gotHeartbeat(Date when = Date::nowCoarse())
     {
         status->lastHeartbeat = when;
         status->dead = false;
     }
 
-    template<typename Fn>
-    void forEachInFlight(const Fn & fn) const
-    {
-        for (auto it = bidsInFlight.begin(), end = bidsInFlight.end();
-             it != end;  ++it) {
-            fn(it->first, it->second);
-        }
-    }
-
+    /** Number of auctions that the agent is bidding on.  The auctions
+        themselves are tracked by the auction shard that owns them.
+    */
     size_t numBidsInFlight() const
     {
-        // DEBUG
-        if (status->numBidsInFlight != bidsInFlight.size())
-            throw ML::Exception("numBidsInFlight is wrong");
         return status->numBidsInFlight;
     }
-    
-    bool expireBidInFlight(const Id & id)
-    {
-        bool result = bidsInFlight.erase(id);
-        status->numBidsInFlight = bidsInFlight.size();
-        return result;
-    }
-
-    // Returns true if it was successfully inserted
-    bool trackBidInFlight(const Id & id, Date date = Date::now())
-    {
-        bool result = bidsInFlight.insert(std::make_pair(id, date)).second;
-        status->numBidsInFlight = bidsInFlight.size();
-        return result;
-    }
-
-private:
-    std::map<Id, Date> bidsInFlight;  /// Auctions in which we're participating
-    //std::set<std::pair<Id, Id> > awaitingResult;  ///< Auctions which are awaiting a win/loss result
 };
 
 /** Information about one of the agents in a round robin group. */
@@ -237,13 +294,14 @@ struct PotentialBidder {
     // If inFlightProp == NULL_PROP then the bidder has been filtered out.
     enum { NULL_PROP = 1000000 };
 
-    PotentialBidder() : inFlightProp(NULL_PROP) {}
+    PotentialBidder() : inFlightProp(NULL_PROP), configIndex(-1) {}
 
     std::string agent;
     float inFlightProp;
     BiddableSpots imp;
     std::shared_ptr<const AgentConfig> config;
     std::shared_ptr<AgentStats> stats;
+    unsigned configIndex;   ///< Index of the config in the filter pool
 
     bool operator < (const PotentialBidder & other) const
     {
@@ -16,9 +16,11 @@ $(eval $(call library,static_filters,$(LIB_FILTERS_SOURCES),$(LIB_FILTERS_LINK))
 LIBRTB_ROUTER_SOURCES := \
 	augmentation_loop.cc \
 	router.cc \
+	router_rest_api.cc \
 	router_types.cc \
 	router_stack.cc \
-	filter_pool.cc
+	filter_pool.cc \
+	auction_stages.cc
 
 LIBRTB_ROUTER_LINK := \
 	rtb zeromq boost_thread logger opstats crypto++ leveldb gc services redis banker gobanker agent_configuration monitor monitor_service post_auction static_filters openrtb
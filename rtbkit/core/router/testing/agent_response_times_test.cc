@@ -0,0 +1,46 @@
+/* agent_response_times_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the recent response times that slow agents are skipped on.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/core/router/router_types.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( test_agent_response_times )
+{
+    AgentResponseTimes times(10.0, 20);
+    Date start = Date::fromSecondsSinceEpoch(1000000);
+
+    // Not enough responses to tell yet
+    for (unsigned i = 0;  i < 19;  ++i)
+        times.record(100.0, start);
+    BOOST_CHECK_EQUAL(times.p95Ms(start), 0.0);
+
+    // 90% fast and 10% slow, so that the 95th percentile is the slow one
+    for (unsigned i = 0;  i < 81;  ++i)
+        times.record(i < 71 ? 5.0 : 100.0, start.plusSeconds(1.0));
+    BOOST_CHECK_CLOSE(times.p95Ms(start.plusSeconds(1.0)), 100.0, 2.0);
+
+    // Still counts the previous window
+    for (unsigned i = 0;  i < 16;  ++i)
+        times.record(5.0, start.plusSeconds(15.0));
+    BOOST_CHECK_CLOSE(times.p95Ms(start.plusSeconds(15.0)), 100.0, 2.0);
+
+    // Once a window without any slow ones has gone by, they're forgotten
+    for (unsigned i = 0;  i < 32;  ++i)
+        times.record(5.0, start.plusSeconds(26.0));
+    BOOST_CHECK_CLOSE(times.p95Ms(start.plusSeconds(26.0)), 5.0, 2.0);
+
+    // And without any responses at all the agent is tried again
+    BOOST_CHECK_EQUAL(times.p95Ms(start.plusSeconds(50.0)), 0.0);
+}
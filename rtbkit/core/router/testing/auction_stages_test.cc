@@ -0,0 +1,148 @@
+/* auction_stages_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the latency histograms of the auction stages.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/router/auction_stages.h"
+#include "jml/utils/file_functions.h"
+#include "jml/arch/format.h"
+
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <map>
+#include <unistd.h>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+struct RecordingEventService : public EventService {
+    virtual void onEvent(const std::string & name,
+                         const char * event,
+                         StatEventType type,
+                         float value,
+                         std::initializer_list<int> extra)
+    {
+        events[event] = value;
+    }
+
+    std::map<std::string, float> events;
+};
+
+std::shared_ptr<Auction> makeAuction(Date start, double stepMs)
+{
+    auto auction = std::make_shared<Auction>();
+    auction->request = std::make_shared<BidRequest>();
+    auction->request->exchange = "mock";
+    auction->id = Id(random());
+
+    Date date = start;
+    auction->start = date;
+    auction->doneParsing = date.addSeconds(stepMs / 1000.0);
+    auction->inPrepro = date;
+    auction->outOfPrepro = date.addSeconds(stepMs / 1000.0);
+    auction->doneAugmenting = date.addSeconds(stepMs / 1000.0);
+    auction->inStartBidding = date;
+    auction->doneFiltering = date.addSeconds(stepMs / 1000.0);
+    auction->sentToAgents = date.addSeconds(stepMs / 1000.0);
+    auction->lastBid = date.addSeconds(stepMs / 1000.0);
+    return auction;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_stages_from_all_threads )
+{
+    auto events = std::make_shared<RecordingEventService>();
+    EventRecorder recorder("", events);
+
+    AuctionStages stages;
+    Date start = Date::now();
+
+    boost::thread_group threads;
+    for (unsigned i = 0; i < 4; ++i) {
+        threads.create_thread([&, i] () {
+                for (unsigned j = 0; j < 1000; ++j) {
+                    // one in a hundred auctions is 10 times as slow
+                    double stepMs = j % 100 == 99 ? 10.0 : 1.0;
+                    auto auction = makeAuction(start, stepMs);
+                    stages.record(*auction,
+                                  auction->lastBid.plusSeconds(stepMs / 1000.0));
+                }
+            });
+    }
+    threads.join_all();
+
+    stages.report(recorder);
+
+    auto & ev = events->events;
+    BOOST_CHECK_EQUAL(ev["auctionStages.parse.count"], 4000);
+    BOOST_CHECK_EQUAL(ev["auctionStages.total.count"], 4000);
+
+    // within the 6% error of the histograms
+    BOOST_CHECK_CLOSE(ev["auctionStages.filter.p50Ms"], 1.0, 6.5);
+    BOOST_CHECK_CLOSE(ev["auctionStages.bids.p99Ms"], 1.0, 6.5);
+    BOOST_CHECK_CLOSE(ev["auctionStages.bids.p999Ms"], 10.0, 6.5);
+    BOOST_CHECK_CLOSE(ev["auctionStages.total.p50Ms"], 7.0, 6.5);
+    BOOST_CHECK_CLOSE(ev["auctionStages.total.maxMs"], 70.0, 6.5);
+
+    // the histograms start over after a report
+    events->events.clear();
+    stages.report(recorder);
+    BOOST_CHECK(events->events.empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_missing_stages )
+{
+    auto events = std::make_shared<RecordingEventService>();
+    EventRecorder recorder("", events);
+
+    AuctionStages stages;
+    auto auction = makeAuction(Date::now(), 1.0);
+    auction->lastBid = Date();   // nobody bid
+    auction->doneAugmenting = Date();
+
+    stages.record(*auction, auction->sentToAgents.plusSeconds(0.002));
+    stages.report(recorder);
+
+    auto & ev = events->events;
+    BOOST_CHECK(!ev.count("auctionStages.bids.count"));
+    BOOST_CHECK(!ev.count("auctionStages.augment.count"));
+    BOOST_CHECK(!ev.count("auctionStages.filter.count"));
+    BOOST_CHECK_CLOSE(ev["auctionStages.response.p50Ms"], 2.0, 6.5);
+}
+
+BOOST_AUTO_TEST_CASE( test_slow_auction_traces )
+{
+    string filename = ML::format("/tmp/auction_stages_test_%d.json",
+                                 getpid());
+
+    AuctionStages stages;
+    stages.traceSlowAuctions(filename, 20.0, 1);
+
+    Date start = Date::now();
+    auto fast = makeAuction(start, 1.0);
+    auto slow = makeAuction(start, 10.0);
+    stages.record(*fast, fast->lastBid);
+    stages.record(*slow, slow->lastBid);
+
+    stages.traceSlowAuctions("", 0.0);
+
+    ML::File_Read_Buffer buf(filename);
+    string contents(buf.start(), buf.end());
+    BOOST_CHECK_EQUAL(std::count(contents.begin(), contents.end(), '\n'), 1);
+
+    Json::Value trace = Json::parse(contents);
+    BOOST_CHECK_EQUAL(trace["id"].asString(), slow->id.toString());
+    BOOST_CHECK_CLOSE(trace["ms"]["sentToAgents"].asDouble(), 50.0, 0.1);
+
+    unlink(filename.c_str());
+}
@@ -11,5 +11,7 @@ $(eval $(call test,pending_list_test,types,boost))
 #$(eval $(call test,augmentation_test,rtb_router bid_request augmentor_base,boost))
 
 $(eval $(call test,router_analytics_test,boost_program_options rtb_router,boost))
+$(eval $(call test,auction_stages_test,rtb_router,boost))
+$(eval $(call test,agent_response_times_test,rtb_router,boost))
 
 .PHONY: $(LIB)/libzmq_analytics.so
@@ -12,6 +12,7 @@
 #include "soa/types/js/id_js.h"
 #include "soa/types/js/url_js.h"
 #include "currency_js.h"
+#include "soa/types/json_printing.h"
 #include <boost/make_shared.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include "rtbkit/openrtb/openrtb_parsing.h"
@@ -790,6 +791,34 @@ getFromJs(const void * field,
           const ValueDescription & desc,
           const std::shared_ptr<void> & owner);
 
+/** The values converted for the properties of a wrapped object are kept in
+    hidden values of the object so that reading the same property again
+    returns the same JS value instead of converting it again.  Setting the
+    property drops its cached value.
+*/
+template<typename Convert>
+v8::Handle<v8::Value>
+getCachedProperty(const v8::Handle<v8::Object> & This,
+                  const v8::Handle<v8::String> & property,
+                  Convert && convert)
+{
+    v8::Local<v8::Value> cached = This->GetHiddenValue(property);
+    if (!cached.IsEmpty())
+        return cached;
+
+    v8::Handle<v8::Value> result = convert();
+    if (!result.IsEmpty())
+        This->SetHiddenValue(property, result);
+    return result;
+}
+
+void
+dropCachedProperty(const v8::Handle<v8::Object> & This,
+                   const v8::Handle<v8::String> & property)
+{
+    This->DeleteHiddenValue(property);
+}
+
 struct WrappedArrayJS: public JSWrappedBase {
     const ValueDescription * desc;
     void * value;  // value being read
@@ -844,6 +873,23 @@ struct WrappedArrayJS: public JSWrappedBase {
         } HANDLE_JS_EXCEPTIONS;
     }
 
+    /** Elements already converted, by index; see getCachedProperty(). */
+    static v8::Local<v8::Object>
+    getElementCache(const v8::Handle<v8::Object> & This)
+    {
+        static v8::Persistent<v8::String> key
+            = v8::Persistent<v8::String>::New
+            (v8::String::NewSymbol("rtbkit.elements"));
+
+        v8::Local<v8::Value> cache = This->GetHiddenValue(key);
+        if (!cache.IsEmpty())
+            return v8::Local<v8::Object>::Cast(cache);
+
+        v8::Local<v8::Object> result = v8::Object::New();
+        This->SetHiddenValue(key, result);
+        return result;
+    }
+
     static v8::Handle<v8::Value>
     getIndexed(uint32_t index, const v8::AccessorInfo & info)
     {
@@ -855,10 +901,17 @@ struct WrappedArrayJS: public JSWrappedBase {
             if (index >= size)
                 return v8::Undefined();
 
+            v8::Local<v8::Object> cache = getElementCache(info.This());
+            if (cache->Has(index))
+                return scope.Close(cache->Get(index));
+
             void * element = wrapper->desc->getArrayElement(wrapper->value, index);
             
-            return scope.Close(getFromJs(element, wrapper->desc->contained(),
-                                         wrapper->owner_));
+            v8::Handle<v8::Value> result
+                = getFromJs(element, wrapper->desc->contained(),
+                            wrapper->owner_);
+            cache->Set(index, result);
+            return scope.Close(result);
         } HANDLE_JS_EXCEPTIONS;
     }
 
@@ -969,19 +1022,22 @@ struct WrappedStructureJS: public JSWrappedBase {
              const v8::AccessorInfo & info)
     {
         try {
-            string name = cstr(property);
+            return getCachedProperty(info.This(), property, [&] ()
+                -> v8::Handle<v8::Value>
+                {
+                    string name = cstr(property);
 
-            WrappedStructureJS * wrapper = getWrapper(info.This());
-            const ValueDescription::FieldDescription * fd
-                = wrapper->desc->hasField(wrapper->value, name);
-            
-            if (!fd)
-                return NULL_HANDLE;
+                    WrappedStructureJS * wrapper = getWrapper(info.This());
+                    const ValueDescription::FieldDescription * fd
+                        = wrapper->desc->hasField(wrapper->value, name);
 
-            return getFromJs(addOffset(wrapper->value, fd->offset),
-                             *fd->description,
-                             wrapper->owner_);
+                    if (!fd)
+                        return NULL_HANDLE;
 
+                    return getFromJs(addOffset(wrapper->value, fd->offset),
+                                     *fd->description,
+                                     wrapper->owner_);
+                });
         } HANDLE_JS_EXCEPTIONS;
     }
 
@@ -999,6 +1055,7 @@ struct WrappedStructureJS: public JSWrappedBase {
             
             setFromJs(addOffset(wrapper->value, fd.offset), value,
                       *fd.description);
+            dropCachedProperty(info.This(), property);
 
             return v8::Undefined();
         } HANDLE_JS_EXCEPTIONS;
@@ -1070,6 +1127,142 @@ struct Init {
 
 } // file scope
 
+/*****************************************************************************/
+/* JS VALUE PRINTING CONTEXT                                                 */
+/*****************************************************************************/
+
+/** Prints a value straight into plain JS objects and arrays in a single pass
+    instead of going through a Json::Value.  Must be used within a
+    HandleScope.
+*/
+struct JSValuePrintingContext : public JsonPrintingContext {
+
+    JSValuePrintingContext()
+        : output(v8::Null())
+    {
+    }
+
+    v8::Handle<v8::Value> output;
+
+    virtual void startObject()
+    {
+        v8::Local<v8::Object> object = v8::Object::New();
+        write(object);
+        path.push_back(Level(object, false /* isArray */));
+    }
+
+    virtual void startMember(const std::string & memberName)
+    {
+        path.back().member = memberSymbol(memberName);
+    }
+
+    virtual void endObject()
+    {
+        path.pop_back();
+    }
+
+    virtual void startArray(int knownSize = -1)
+    {
+        v8::Local<v8::Array> array = v8::Array::New(std::max(knownSize, 0));
+        write(array);
+        path.push_back(Level(array, true /* isArray */));
+    }
+
+    virtual void newArrayElement()
+    {
+        ++path.back().index;
+    }
+
+    virtual void endArray()
+    {
+        path.pop_back();
+    }
+
+    virtual void skip() { write(v8::Null()); }
+    virtual void writeNull() { write(v8::Null()); }
+    virtual void writeInt(int i) { write(v8::Integer::New(i)); }
+    virtual void writeUnsignedInt(unsigned i)
+    {
+        write(v8::Integer::NewFromUnsigned(i));
+    }
+    virtual void writeLong(long i) { write(v8::Number::New(i)); }
+    virtual void writeUnsignedLong(unsigned long i) { write(v8::Number::New(i)); }
+    virtual void writeLongLong(long long i) { write(v8::Number::New(i)); }
+    virtual void writeUnsignedLongLong(unsigned long long i)
+    {
+        write(v8::Number::New(i));
+    }
+    virtual void writeFloat(float f) { write(v8::Number::New(f)); }
+    virtual void writeDouble(double d) { write(v8::Number::New(d)); }
+    virtual void writeBool(bool b) { write(v8::Boolean::New(b)); }
+
+    virtual void writeString(const std::string & s)
+    {
+        write(v8::String::New(s.c_str(), s.length()));
+    }
+
+    virtual void writeStringUtf8(const Utf8String & s)
+    {
+        write(v8::String::New(s.rawData(), s.rawLength()));
+    }
+
+    virtual void writeJson(const Json::Value & val)
+    {
+        write(JS::toJS(val));
+    }
+
+private:
+    struct Level {
+        Level(v8::Handle<v8::Object> object, bool isArray)
+            : object(object), isArray(isArray), index(-1)
+        {
+        }
+
+        v8::Handle<v8::Object> object;
+        bool isArray;
+        v8::Handle<v8::String> member;
+        int index;
+    };
+
+    std::vector<Level> path;
+
+    void write(v8::Handle<v8::Value> value)
+    {
+        if (path.empty()) {
+            output = value;
+            return;
+        }
+
+        Level & level = path.back();
+        if (level.isArray)
+            level.object->Set(level.index, value);
+        else level.object->Set(level.member, value);
+    }
+
+    /** The same few field names come up in every value so their symbols are
+        created once and kept.
+    */
+    static v8::Handle<v8::String> memberSymbol(const std::string & name)
+    {
+        // Map keys such as segment sources come from the requests and have
+        // no bound, so only so many are kept.
+        enum { MaxSymbols = 4096 };
+
+        static std::unordered_map<std::string, v8::Persistent<v8::String> >
+            symbols;
+
+        auto it = symbols.find(name);
+        if (it != symbols.end())
+            return it->second;
+
+        v8::Local<v8::String> result
+            = v8::String::NewSymbol(name.c_str(), name.length());
+        if (symbols.size() < MaxSymbols)
+            symbols[name] = v8::Persistent<v8::String>::New(result);
+        return result;
+    }
+};
+
 void
 initJsConverters(const ValueDescription & desc)
 {
@@ -1304,9 +1497,9 @@ initJsConverters(const ValueDescription & desc)
     if (!converters->toJs) {
         converters->toJs = [=] (const void * field, std::shared_ptr<void>)
             {
-                StructuredJsonPrintingContext context;
+                JSValuePrintingContext context;
                 descPtr->printJson(field, context);
-                return JS::toJS(context.output);
+                return context.output;
             };
     }
 
@@ -1339,21 +1532,33 @@ getFromJs(const void * field,
 }
 
 
+/** Accessors for a field of a structure.  The field is looked up once when
+    the accessor is registered and passed as the accessor's data.
+*/
 template<typename Obj, typename Base>
 struct PropertyAccessViaDescription {
+
+    typedef StructureDescriptionBase::FieldDescription FieldDescription;
+
+    static const FieldDescription & getField(const v8::AccessorInfo & info)
+    {
+        return *reinterpret_cast<const FieldDescription *>
+            (v8::External::Unwrap(info.Data()));
+    }
+
     static v8::Handle<v8::Value>
     getter(v8::Local<v8::String> property,
            const v8::AccessorInfo & info)
     {
         try {
-            const ValueDescription * vd
-                = reinterpret_cast<const ValueDescription *>
-                (v8::External::Unwrap(info.Data()));
-            auto p = Base::getSharedPtr(info.This());
-            Obj * o = p.get();
-            const StructureDescriptionBase::FieldDescription & fd
-                = vd->getField(cstr(property));
-            return getFromJs(addOffset(o, fd.offset), *fd.description, p);
+            return getCachedProperty(info.This(), property, [&] ()
+                {
+                    const FieldDescription & fd = getField(info);
+                    auto p = Base::getSharedPtr(info.This());
+                    Obj * o = p.get();
+                    return getFromJs(addOffset(o, fd.offset),
+                                     *fd.description, p);
+                });
         } HANDLE_JS_EXCEPTIONS;
     }
 
@@ -1363,13 +1568,10 @@ struct PropertyAccessViaDescription {
            const v8::AccessorInfo & info)
     {
         try {
-            const ValueDescription * vd
-                = reinterpret_cast<const ValueDescription *>
-                (v8::External::Unwrap(info.Data()));
+            const FieldDescription & fd = getField(info);
             Obj * o = Base::getShared(info.This());
-            const StructureDescriptionBase::FieldDescription & fd
-                = vd->getField(cstr(property));
             setFromJs(addOffset(o, fd.offset), value, *fd.description);
+            dropCachedProperty(info.This(), property);
         } HANDLE_JS_EXCEPTIONS_SETTER;
     }
 };
@@ -1378,11 +1580,13 @@ template<typename Wrapper, typename T>
 void registerFieldFromDescription(const StructureDescription<T> & desc,
                                   const std::string & fieldName)
 {
+    const auto & fd = desc.getField(fieldName);
+
     Wrapper::tmpl->InstanceTemplate()
         ->SetAccessor(v8::String::NewSymbol(fieldName.c_str()),
                       PropertyAccessViaDescription<T, Wrapper>::getter,
                       PropertyAccessViaDescription<T, Wrapper>::setter,
-                      v8::External::Wrap((void *)&desc),
+                      v8::External::Wrap((void *)&fd),
                       v8::DEFAULT,
                       v8::PropertyAttribute(v8::DontDelete));
 }
@@ -1601,6 +1805,7 @@ struct BidRequestJS
 
         NODE_SET_PROTOTYPE_METHOD(t, "getSegmentsFromSource",
                                   getSegmentsFromSource);
+        NODE_SET_PROTOTYPE_METHOD(t, "toObject", toObject);
 
         t->InstanceTemplate()
             ->SetAccessor(String::NewSymbol("segments"), segmentsGetter,
@@ -1636,18 +1841,39 @@ struct BidRequestJS
         } HANDLE_JS_EXCEPTIONS;
     }
 
+    /** Returns the whole request as a plain JS object, built in a single
+        pass.  Agents that read most of the request are better off calling
+        this once than going through the accessors.
+    */
+    static Handle<v8::Value>
+    toObject(const Arguments & args)
+    {
+        try {
+            static DefaultDescription<BidRequest> desc;
+
+            HandleScope scope;
+            JSValuePrintingContext context;
+            desc.printJson(getShared(args.This()), context);
+            return scope.Close(context.output);
+        } HANDLE_JS_EXCEPTIONS;
+    }
+
     static v8::Handle<v8::Value>
     segmentsGetter(v8::Local<v8::String> property,
                   const v8::AccessorInfo & info)
     {
         try {
-            v8::Handle<v8::Value> segs
-                = SegmentsBySourceJS::toJS
-                (ML::make_unowned_std_sp(getShared(info.This())->segments));
-            SegmentsBySourceJS * wrapper
-                = SegmentsBySourceJS::getWrapper(segs);
-            wrapper->owner_ = getSharedPtr(info.This());
-            return segs;
+            return getCachedProperty(info.This(), property, [&] ()
+                {
+                    v8::Handle<v8::Value> segs
+                        = SegmentsBySourceJS::toJS
+                        (ML::make_unowned_std_sp
+                         (getShared(info.This())->segments));
+                    SegmentsBySourceJS * wrapper
+                        = SegmentsBySourceJS::getWrapper(segs);
+                    wrapper->owner_ = getSharedPtr(info.This());
+                    return segs;
+                });
         } HANDLE_JS_EXCEPTIONS;
     }
 
@@ -1657,6 +1883,8 @@ struct BidRequestJS
                   const v8::AccessorInfo & info)
     {
         try {
+            dropCachedProperty(info.This(), property);
+
             if (SegmentsBySourceJS::tmpl->HasInstance(value)) {
                 getShared(info.This())->segments
                     = *SegmentsBySourceJS::getShared(value);
@@ -1678,13 +1906,17 @@ struct BidRequestJS
                   const v8::AccessorInfo & info)
     {
         try {
-            v8::Handle<v8::Value> segs
-                = SegmentsBySourceJS::toJS
-                (ML::make_unowned_std_sp(getShared(info.This())->restrictions));
-            SegmentsBySourceJS * wrapper
-                = SegmentsBySourceJS::getWrapper(segs);
-            wrapper->owner_ = getSharedPtr(info.This());
-            return segs;
+            return getCachedProperty(info.This(), property, [&] ()
+                {
+                    v8::Handle<v8::Value> segs
+                        = SegmentsBySourceJS::toJS
+                        (ML::make_unowned_std_sp
+                         (getShared(info.This())->restrictions));
+                    SegmentsBySourceJS * wrapper
+                        = SegmentsBySourceJS::getWrapper(segs);
+                    wrapper->owner_ = getSharedPtr(info.This());
+                    return segs;
+                });
         } HANDLE_JS_EXCEPTIONS;
     }
 
@@ -1694,6 +1926,8 @@ struct BidRequestJS
                        const v8::AccessorInfo & info)
     {
         try {
+            dropCachedProperty(info.This(), property);
+
             if (SegmentsBySourceJS::tmpl->HasInstance(value)) {
                 getShared(info.This())->restrictions
                     = *SegmentsBySourceJS::getShared(value);
@@ -1715,8 +1949,11 @@ struct BidRequestJS
                   const v8::AccessorInfo & info)
     {
         try {
-            auto owner = getSharedPtr(info.This());
-            return UserIdsJS::toJS(owner->userIds, owner);
+            return getCachedProperty(info.This(), property, [&] ()
+                {
+                    auto owner = getSharedPtr(info.This());
+                    return UserIdsJS::toJS(owner->userIds, owner);
+                });
         } HANDLE_JS_EXCEPTIONS;
     }
 
@@ -1726,6 +1963,8 @@ struct BidRequestJS
                        const v8::AccessorInfo & info)
     {
         try {
+            dropCachedProperty(info.This(), property);
+
             if (UserIdsJS::tmpl->HasInstance(value)) {
                 getShared(info.This())->userIds
                     = *UserIdsJS::getShared(value);
@@ -1750,8 +1989,11 @@ struct BidRequestJS
                   const v8::AccessorInfo & info)
     {
         try {
-            auto owner = getSharedPtr(info.This());
-            return LocationJS::toJS(owner->location, owner);
+            return getCachedProperty(info.This(), property, [&] ()
+                {
+                    auto owner = getSharedPtr(info.This());
+                    return LocationJS::toJS(owner->location, owner);
+                });
         } HANDLE_JS_EXCEPTIONS;
     }
 
@@ -1761,6 +2003,8 @@ struct BidRequestJS
                        const v8::AccessorInfo & info)
     {
         try {
+            dropCachedProperty(info.This(), property);
+
             if (LocationJS::tmpl->HasInstance(value)) {
                 getShared(info.This())->location
                     = *LocationJS::getShared(value);
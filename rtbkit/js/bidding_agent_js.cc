@@ -196,6 +196,135 @@ struct DeliveryCbOps :
 RegisterJsOps<RTBKIT::BiddingAgent::DeliveryCb> reg_deliveryCb(DeliveryCbOps::op);
 
 
+/******************************************************************************/
+/* BID REQUEST BATCH CB OPS                                                   */
+/******************************************************************************/
+
+/** Calls JS once with an array holding the whole batch of bid requests, so
+    that a batch costs a single trip into the JS thread and into V8 instead of
+    one per request.  Each entry is a plain object with the same fields as
+    the arguments of onBidRequest; the agent fills in the bids and hands the
+    entries back to doBidBatch.
+*/
+struct BidRequestBatchCbOps:
+    public JS::JsOpsBase<BidRequestBatchCbOps,
+                         RTBKIT::BiddingAgent::BidRequestBatchCb>
+{
+    static v8::Handle<v8::Value>
+    callBoost(const Function & fn,
+              const JS::JSArgs & args)
+    {
+        throw ML::Exception("callBoost for bidRequestBatchCb");
+    }
+
+    struct Forwarder : public calltojsbase {
+
+        Forwarder(v8::Handle<v8::Function> fn,
+                  v8::Handle<v8::Object> This)
+            : calltojsbase(fn, This)
+        {
+        }
+
+        void operator () (std::vector<RTBKIT::AgentBidRequest> & requests)
+        {
+            static v8::Persistent<v8::String> timestampKey = symbol("timestamp");
+            static v8::Persistent<v8::String> idKey = symbol("id");
+            static v8::Persistent<v8::String> bidRequestKey = symbol("bidRequest");
+            static v8::Persistent<v8::String> bidsKey = symbol("bids");
+            static v8::Persistent<v8::String> timeLeftMsKey = symbol("timeLeftMs");
+            static v8::Persistent<v8::String> augmentationsKey
+                = symbol("augmentations");
+            static v8::Persistent<v8::String> wcmKey = symbol("wcm");
+
+            v8::HandleScope scope;
+            JSValue result;
+            {
+                v8::TryCatch tc;
+
+                v8::Local<v8::Array> batch = v8::Array::New(requests.size());
+                for (unsigned i = 0;  i < requests.size();  ++i) {
+                    const RTBKIT::AgentBidRequest & request = requests[i];
+
+                    v8::Local<v8::Object> entry = v8::Object::New();
+                    entry->Set(timestampKey, JS::toJS(request.timestamp));
+                    entry->Set(idKey, JS::toJS(request.id));
+                    entry->Set(bidRequestKey, JS::toJS(request.bidRequest));
+                    entry->Set(bidsKey, JS::toJS(request.bids));
+                    entry->Set(timeLeftMsKey, JS::toJS(request.timeLeftMs));
+                    entry->Set(augmentationsKey,
+                               JS::toJS(request.augmentations));
+                    entry->Set(wcmKey, JS::toJS(request.wcm));
+                    batch->Set(i, entry);
+                }
+
+                v8::Handle<v8::Value> argv[1] = { batch };
+                result = params->fn->Call(params->This, 1, argv);
+
+                if (result.IsEmpty()) {
+                    if(tc.HasCaught()) {
+                        // Print JS error and stack trace
+                        char msg[256];
+                        tc.Message()->Get()->WriteAscii(msg, 0, 256);
+                        cout << msg << endl;
+                        char st_msg[2500];
+                        tc.StackTrace()->ToString()->WriteAscii(st_msg, 0, 2500);
+                        cout << st_msg << endl;
+
+                        tc.ReThrow();
+                        throw JSPassException();
+                    }
+                    throw ML::Exception("didn't return anything");
+                }
+            }
+        }
+
+        static v8::Persistent<v8::String> symbol(const char * name)
+        {
+            return v8::Persistent<v8::String>::New(v8::String::NewSymbol(name));
+        }
+    };
+
+    static Function
+    asBoost(const v8::Handle<v8::Function> & fn,
+            const v8::Handle<v8::Object> * This)
+    {
+        v8::Handle<v8::Object> This2;
+        if (!This)
+            This2 = v8::Object::New();
+        return Forwarder(fn, This ? *This : This2);
+    }
+};
+
+RegisterJsOps<RTBKIT::BiddingAgent::BidRequestBatchCb>
+reg_bidRequestBatchCb(BidRequestBatchCbOps::op);
+
+RTBKIT::AgentBidRequest
+from_js(const JSValue & value, RTBKIT::AgentBidRequest *)
+{
+    if (!value->IsObject())
+        throw ML::Exception("can't convert " + cstr(value)
+                            + " into a batched bid");
+
+    v8::Local<v8::Object> obj = value->ToObject();
+
+    RTBKIT::AgentBidRequest result;
+    result.id = from_js(JSValue(obj->Get(v8::String::NewSymbol("id"))),
+                        &result.id);
+    result.bids = from_js(JSValue(obj->Get(v8::String::NewSymbol("bids"))),
+                          &result.bids);
+
+    v8::Local<v8::Value> meta = obj->Get(v8::String::NewSymbol("meta"));
+    if (!meta->IsUndefined())
+        result.meta = JS::fromJS(meta);
+
+    v8::Local<v8::Value> wcm = obj->Get(v8::String::NewSymbol("wcm"));
+    if (!wcm->IsUndefined())
+        result.wcm = from_js(JSValue(wcm), &result.wcm);
+
+    return result;
+}
+
+
 /******************************************************************************/
 /* BIDDING AGENT JS                                                           */
 /******************************************************************************/
@@ -259,6 +388,8 @@ struct BiddingAgentJS :
         Persistent<FunctionTemplate> t = Register(New);
 
         registerMemberFn(&RTBKIT::BiddingAgent::doBid, "doBid");
+        registerMemberFn(&RTBKIT::BiddingAgent::doBidBatch, "doBidBatch");
+        registerMemberFn(&RTBKIT::BiddingAgent::setBatching, "setBatching");
         registerMemberFn(&RTBKIT::BiddingAgent::doPong, "doPong");
         registerMemberFn(&RTBKIT::BiddingAgent::doConfigJson, "doConfig");
         registerMemberFn(&RTBKIT::BiddingAgent::init, "init");
@@ -267,6 +398,8 @@ struct BiddingAgentJS :
         registerMemberFn(&RTBKIT::BiddingAgent::strictMode, "strictMode");
 
         registerAsyncCallback(&RTBKIT::BiddingAgent::onBidRequest, "onBidRequest");
+        registerAsyncCallback(&RTBKIT::BiddingAgent::onBidRequestBatch,
+                              "onBidRequestBatch");
 
         registerAsyncCallback(&RTBKIT::BiddingAgent::onWin, "onWin");
         registerAsyncCallback(&RTBKIT::BiddingAgent::onLateWin, "onLateWin");
@@ -23,6 +23,11 @@ from_js(const JSValue & value, std::shared_ptr<RTBKIT::BiddingAgent> *);
 RTBKIT::BiddingAgent *
 from_js(const JSValue & value, RTBKIT::BiddingAgent **);
 
+/** Reads the id, bids and optional meta and wcm of an entry of the array
+    given to doBidBatch. */
+RTBKIT::AgentBidRequest
+from_js(const JSValue & value, RTBKIT::AgentBidRequest *);
+
 } // namespace JS
 } // namespace Datacratic
 
@@ -1 +1 @@
-$(eval $(call library,openrtb,openrtb_parsing.cc openrtb.cc,value_description))
+$(eval $(call library,openrtb,openrtb_parsing.cc openrtb.cc openrtb_overlay.cc,value_description))
@@ -0,0 +1,217 @@
+/* openrtb_overlay.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Per bidder changes over a shared OpenRTB bid request.
+*/
+
+#include "openrtb_overlay.h"
+#include "openrtb_parsing.h"
+#include "soa/types/json_printing.h"
+#include "jml/arch/exception.h"
+#include <sstream>
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace OpenRTB {
+
+namespace {
+
+typedef ValueDescription::FieldDescription FieldDescription;
+
+const void * fieldOf(const void * obj, const FieldDescription & fd)
+{
+    return reinterpret_cast<const char *>(obj) + fd.offset;
+}
+
+/** Prints a structure field by field like StructureDescription does, except
+    that the overridden fields are printed from the value they're given in
+    place of the structure's own.
+*/
+void printStructure(const ValueDescription & desc, const void * obj,
+                    JsonPrintingContext & context,
+                    const std::function<const void * (const FieldDescription &)>
+                        & override)
+{
+    context.startObject();
+
+    desc.forEachField(obj, [&] (const FieldDescription & fd)
+        {
+            const void * mbr = override(fd);
+            if (!mbr)
+                mbr = fieldOf(obj, fd);
+            if (fd.description->isDefault(mbr))
+                return;
+            context.startMember(fd.fieldName);
+            fd.description->printJson(mbr, context);
+        });
+
+    context.endObject();
+}
+
+const DefaultDescription<BidRequest> & requestDescription()
+{
+    static const DefaultDescription<BidRequest> desc;
+    return desc;
+}
+
+const DefaultDescription<Impression> & impressionDescription()
+{
+    static const DefaultDescription<Impression> desc;
+    return desc;
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* BID REQUEST OVERLAY                                                       */
+/*****************************************************************************/
+
+BidRequestOverlay::
+BidRequestOverlay(std::shared_ptr<const BidRequest> base)
+    : base_(std::move(base)), tmaxSet_(false)
+{
+    ExcAssert(base_);
+}
+
+Json::Value &
+BidRequestOverlay::
+ext()
+{
+    if (!ext_)
+        ext_.reset(new Json::Value(base_->ext));
+    return *ext_;
+}
+
+const Json::Value &
+BidRequestOverlay::
+ext() const
+{
+    return ext_ ? *ext_ : base_->ext;
+}
+
+Json::Value &
+BidRequestOverlay::
+impExt(size_t index)
+{
+    if (index >= base_->imp.size())
+        throw ML::Exception("impression %zd out of range", index);
+
+    auto it = impExt_.find(index);
+    if (it == impExt_.end())
+        it = impExt_.insert(make_pair(index, base_->imp[index].ext)).first;
+    return it->second;
+}
+
+const Json::Value &
+BidRequestOverlay::
+impExt(size_t index) const
+{
+    auto it = impExt_.find(index);
+    if (it != impExt_.end())
+        return it->second;
+    return base_->imp.at(index).ext;
+}
+
+void
+BidRequestOverlay::
+setTmax(int tmax)
+{
+    tmax_.val = tmax;
+    tmaxSet_ = true;
+}
+
+TaggedInt
+BidRequestOverlay::
+tmax() const
+{
+    return tmaxSet_ ? tmax_ : base_->tmax;
+}
+
+void
+BidRequestOverlay::
+printJson(JsonPrintingContext & context) const
+{
+    const auto & impDesc = impressionDescription();
+
+    auto printImps = [&] ()
+        {
+            context.startArray(base_->imp.size());
+            for (size_t i = 0;  i < base_->imp.size();  ++i) {
+                context.newArrayElement();
+
+                auto it = impExt_.find(i);
+                if (it == impExt_.end()) {
+                    impDesc.printJson(&base_->imp[i], context);
+                    continue;
+                }
+
+                printStructure(impDesc, &base_->imp[i], context,
+                               [&] (const FieldDescription & fd)
+                               -> const void *
+                               {
+                                   if (fd.fieldName == "ext")
+                                       return &it->second;
+                                   return nullptr;
+                               });
+            }
+            context.endArray();
+        };
+
+    context.startObject();
+
+    requestDescription().forEachField(base_.get(),
+        [&] (const FieldDescription & fd)
+        {
+            const void * mbr = fieldOf(base_.get(), fd);
+
+            if (fd.fieldName == "imp" && !impExt_.empty()) {
+                if (base_->imp.empty())
+                    return;
+                context.startMember(fd.fieldName);
+                printImps();
+                return;
+            }
+
+            if (fd.fieldName == "ext" && ext_)
+                mbr = ext_.get();
+            else if (fd.fieldName == "tmax" && tmaxSet_)
+                mbr = &tmax_;
+
+            if (fd.description->isDefault(mbr))
+                return;
+            context.startMember(fd.fieldName);
+            fd.description->printJson(mbr, context);
+        });
+
+    context.endObject();
+}
+
+std::string
+BidRequestOverlay::
+toJsonStr() const
+{
+    std::ostringstream stream;
+    StreamJsonPrintingContext context(stream);
+    printJson(context);
+    return stream.str();
+}
+
+BidRequest
+BidRequestOverlay::
+merged() const
+{
+    BidRequest result(*base_);
+    if (ext_)
+        result.ext = *ext_;
+    for (const auto & entry: impExt_)
+        result.imp[entry.first].ext = entry.second;
+    if (tmaxSet_)
+        result.tmax = tmax_;
+    return result;
+}
+
+} // namespace OpenRTB
@@ -0,0 +1,73 @@
+/* openrtb_overlay.h                                               -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Per bidder changes over a shared OpenRTB bid request.
+*/
+
+#pragma once
+
+#include "openrtb.h"
+#include <memory>
+#include <map>
+
+namespace Datacratic {
+struct JsonPrintingContext;
+} // namespace Datacratic
+
+namespace OpenRTB {
+
+
+/*****************************************************************************/
+/* BID REQUEST OVERLAY                                                       */
+/*****************************************************************************/
+
+/** Copy-on-write view of a BidRequest that is shared between the bidders of
+    an auction.  The base request is never modified nor copied: the fields
+    that a bidder changes are kept in the overlay, copied from the base the
+    first time they are written to, and printing the overlay merges them
+    back into the base as it goes.
+
+    Only the fields that are customized per bidder can be changed, which are
+    the ext of the request and of its impressions and tmax.
+*/
+
+struct BidRequestOverlay {
+
+    BidRequestOverlay(std::shared_ptr<const BidRequest> base);
+
+    const BidRequest & base() const { return *base_; }
+
+    /** Ext of the request, copied from the base on the first call. */
+    Json::Value & ext();
+    const Json::Value & ext() const;
+
+    /** Ext of the given impression, copied from the base on the first
+        call.
+    */
+    Json::Value & impExt(size_t index);
+    const Json::Value & impExt(size_t index) const;
+
+    void setTmax(int tmax);
+    Datacratic::TaggedInt tmax() const;
+
+    /** Prints the base request with the changes of the overlay merged in,
+        the same way as the request itself would have been printed if it
+        had been changed in place.
+    */
+    void printJson(Datacratic::JsonPrintingContext & context) const;
+    std::string toJsonStr() const;
+
+    /** Copy of the base with the changes applied to it. */
+    BidRequest merged() const;
+
+private:
+    std::shared_ptr<const BidRequest> base_;
+
+    std::unique_ptr<Json::Value> ext_;        ///< Null until changed
+    std::map<size_t, Json::Value> impExt_;    ///< Changed imp ext by index
+    Datacratic::TaggedInt tmax_;
+    bool tmaxSet_;
+};
+
+} // namespace OpenRTB
@@ -19,8 +19,9 @@ using namespace RTBKIT;
 
 HttpAdServerConnectionHandler::
 HttpAdServerConnectionHandler(HttpAdServerHttpEndpoint & endpoint,
-                              const HttpAdServerRequestCb & requestCb)
-    : endpoint_(endpoint), requestCb_(requestCb)
+                              const HttpAdServerRequestCb & requestCb,
+                              const HttpAdServerPayloadCb & payloadCb)
+    : endpoint_(endpoint), requestCb_(requestCb), payloadCb_(payloadCb)
 {
 }
 
@@ -35,46 +36,103 @@ handleUnknownHeader(const HttpHeader& header) {
     throw ML::Exception("Unknown resource '" + header.resource + "'");
 }
 
+void
+HttpAdServerConnectionHandler::
+handleHttpPayload(const HttpHeader & header, const string & payload)
+{
+    if (!payloadCb_) {
+        JsonConnectionHandler::handleHttpPayload(header, payload);
+        return;
+    }
+
+    HttpAdServerResponse response;
+
+    try {
+        response = payloadCb_(header, payload);
+    }
+    catch (const exception & exc) {
+        cerr << "error parsing adserver request " << payload << ": "
+             << exc.what() << endl;
+        response.valid = false;
+        response.error = "error parsing AdServer message";
+        response.details = exc.what();
+    }
+
+    // The payload is only parsed into a message for the error response.
+    Json::Value message;
+    if (!response.valid) {
+        Json::Reader reader;
+        if (!reader.parse(payload, message, false))
+            message = payload;
+    }
+
+    sendResponse(header, response, message);
+}
+
 void
 HttpAdServerConnectionHandler::
 handleJson(const HttpHeader & header, const Json::Value & json,
            const string & jsonStr)
+{
+    HttpAdServerResponse response;
+
+    try {
+        response = requestCb_(header, json, jsonStr);
+    }
+    catch (const exception & exc) {
+        cerr << "error parsing adserver request " << json << ": "
+             << exc.what() << endl;
+        response.valid = false;
+        response.error = "error parsing AdServer message";
+        response.details = exc.what();
+    }
+
+    sendResponse(header, response, json);
+}
+
+void
+HttpAdServerConnectionHandler::
+sendResponse(const HttpHeader & header,
+             const HttpAdServerResponse & response,
+             const Json::Value & message)
 {
     string resultMsg;
 
     transport().assertLockedByThisThread();
 
-    auto onSendFinished = [&] () {
+    bool close = !strcasecmp(header.tryGetHeader("connection").c_str(),
+                             "close");
+
+    auto onSendFinished = [=] () {
         Date endRq = Date::now();
         double timeElapsedMs = endRq.secondsSince(this->firstData) * 1000;
         endpoint_.doEvent("rqTimeMs", ET_OUTCOME, timeElapsedMs);
 
-        this->transport().associateWhenHandlerFinished
-        (endpoint_.makeNewHandler(), "rqFinished");
+        if (!close) {
+            this->transport().associateWhenHandlerFinished
+                (endpoint_.makeNewHandler(), "rqFinished");
+        }
     };
 
-    try {
-        HttpAdServerResponse returnValue = requestCb_(header, json, jsonStr);
-        if(returnValue.valid) {
-            resultMsg = ("HTTP/1.1 200 OK\r\n"
-                     "Content-Type: none\r\n"
-                     "Content-Length: 0\r\n"
-                     "\r\n");
-        }
-        else {
-            endpoint_.doEvent("error.rqParsingError");
-            resultMsg = sendErrorResponse(returnValue.error, returnValue.details, json);
-        }
+    if(response.valid) {
+        resultMsg = (close
+                     ? "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: none\r\n"
+                       "Content-Length: 0\r\n"
+                       "Connection: close\r\n"
+                       "\r\n"
+                     : "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: none\r\n"
+                       "Content-Length: 0\r\n"
+                       "\r\n");
     }
-    catch (const exception & exc) {
-        cerr << "error parsing adserver request " << json << ": "
-             << exc.what() << endl;
+    else {
         endpoint_.doEvent("error.rqParsingError");
-        resultMsg = sendErrorResponse("error parsing AdServer message", exc.what(), json);
+        resultMsg = sendErrorResponse(response.error, response.details, message);
     }
 
     send(resultMsg,
-         NEXT_CONTINUE,
+         close ? NEXT_CLOSE : NEXT_CONTINUE,
          onSendFinished);
 }
 
@@ -110,12 +168,20 @@ HttpAdServerHttpEndpoint(int port, const HttpAdServerRequestCb & requestCb)
 {
 }
 
+HttpAdServerHttpEndpoint::
+HttpAdServerHttpEndpoint(int port, const HttpAdServerPayloadCb & payloadCb)
+    : HttpEndpoint("adserver-ep-" + to_string(port)),
+      port_(port), payloadCb_(payloadCb)
+{
+}
+
 HttpAdServerHttpEndpoint::
 HttpAdServerHttpEndpoint(HttpAdServerHttpEndpoint && otherEndpoint)
 : HttpEndpoint("adserver-ep-" + to_string(otherEndpoint.port_))
 {
     port_ = otherEndpoint.port_;
     requestCb_ = otherEndpoint.requestCb_;
+    payloadCb_ = otherEndpoint.payloadCb_;
 }
 
 HttpAdServerHttpEndpoint::
@@ -131,6 +197,7 @@ operator = (const HttpAdServerHttpEndpoint& other)
     if (this != &other) {
         port_ = other.port_;
         requestCb_ = other.requestCb_;
+        payloadCb_ = other.payloadCb_;
     }
 
     return *this;
@@ -148,7 +215,8 @@ shared_ptr<ConnectionHandler>
 HttpAdServerHttpEndpoint::
 makeNewHandler()
 {
-    return std::make_shared<HttpAdServerConnectionHandler>(*this, requestCb_);
+    return std::make_shared<HttpAdServerConnectionHandler>(*this, requestCb_,
+                                                           payloadCb_);
 }
 
 
@@ -170,6 +238,13 @@ registerEndpoint(int port, const HttpAdServerRequestCb & requestCb)
     endpoints_.emplace_back(port, requestCb);
 }
 
+void
+HttpAdServerConnector::
+registerPayloadEndpoint(int port, const HttpAdServerPayloadCb & payloadCb)
+{
+    endpoints_.emplace_back(port, payloadCb);
+}
+
 void
 HttpAdServerConnector::
 init(const shared_ptr<ConfigurationService> & config)
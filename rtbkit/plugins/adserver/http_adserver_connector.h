@@ -40,22 +40,39 @@ typedef std::function<HttpAdServerResponse (const HttpHeader & header,
                             const std::string & jsonStr)>
     HttpAdServerRequestCb;
 
+/** Gets the raw body of the request instead of a parsed Json::Value, for
+    connectors that parse their requests themselves. */
+typedef std::function<HttpAdServerResponse (const HttpHeader & header,
+                            const std::string & payload)>
+    HttpAdServerPayloadCb;
+
 struct HttpAdServerConnectionHandler
     : public Datacratic::JsonConnectionHandler {
     HttpAdServerConnectionHandler(HttpAdServerHttpEndpoint & endpoint,
-                                  const HttpAdServerRequestCb & requestCb);
+                                  const HttpAdServerRequestCb & requestCb,
+                                  const HttpAdServerPayloadCb & payloadCb);
 
     virtual void handleUnknownHeader(const HttpHeader& header);
 
+    virtual void handleHttpPayload(const HttpHeader & header,
+                                   const std::string & payload);
+
     virtual void handleJson(const HttpHeader & header,
                             const Json::Value & json,
                             const std::string & jsonStr);
 
 private:
     std::string sendErrorResponse(const std::string & error, const std::string & details, const Json::Value & json);
+
+    /** Sends the response to the request, keeping the connection open for
+        the next one unless the client asked for it to be closed. */
+    void sendResponse(const HttpHeader & header,
+                      const HttpAdServerResponse & response,
+                      const Json::Value & message);
     
     HttpAdServerHttpEndpoint & endpoint_;
     const HttpAdServerRequestCb & requestCb_;
+    const HttpAdServerPayloadCb & payloadCb_;
 };
 
 
@@ -66,6 +83,8 @@ private:
 struct HttpAdServerHttpEndpoint : public Datacratic::HttpEndpoint {
     HttpAdServerHttpEndpoint(int port,
                              const HttpAdServerRequestCb & requestCb);
+    HttpAdServerHttpEndpoint(int port,
+                             const HttpAdServerPayloadCb & payloadCb);
     HttpAdServerHttpEndpoint(HttpAdServerHttpEndpoint && otherEndpoint);
 
     ~HttpAdServerHttpEndpoint();
@@ -98,6 +117,7 @@ struct HttpAdServerHttpEndpoint : public Datacratic::HttpEndpoint {
 private:
     int port_;
     HttpAdServerRequestCb requestCb_;
+    HttpAdServerPayloadCb payloadCb_;
 };
         
 /****************************************************************************/
@@ -114,6 +134,11 @@ struct HttpAdServerConnector : public AdServerConnector {
 
     void registerEndpoint(int port, const HttpAdServerRequestCb & requestCb);
 
+    /** Same as registerEndpoint() but the callback gets the body of the
+        requests as is instead of it being parsed into a Json::Value. */
+    void registerPayloadEndpoint(int port,
+                                 const HttpAdServerPayloadCb & payloadCb);
+
     void init(const std::shared_ptr<ConfigurationService> & config);
     void shutdown();
 
@@ -11,6 +11,7 @@
 #include "soa/service/service_base.h"
 #include "soa/service/service_utils.h"
 #include "soa/types/date.h"
+#include "soa/types/json_parsing.h"
 
 #include "standard_adserver_connector.h"
 
@@ -71,11 +72,11 @@ init(int winsPort, int eventsPort, bool verbose,
 
     shared_ptr<ServiceProxies> services = getServices();
 
-    auto win = &StandardAdServerConnector::handleWinRq;
-    registerEndpoint(winsPort, bind(win, this, _1, _2, _3));
+    auto win = &StandardAdServerConnector::handleWinPayload;
+    registerPayloadEndpoint(winsPort, bind(win, this, _1, _2));
 
-    auto delivery = &StandardAdServerConnector::handleDeliveryRq;
-    registerEndpoint(eventsPort, bind(delivery, this, _1, _2, _3));
+    auto delivery = &StandardAdServerConnector::handleDeliveryPayload;
+    registerPayloadEndpoint(eventsPort, bind(delivery, this, _1, _2));
 
     HttpAdServerConnector::init(services->config);
 
@@ -83,6 +84,7 @@ init(int winsPort, int eventsPort, bool verbose,
         const auto & analyticsPublisherUri = services->params["analytics-uri"].asString();
         if (!analyticsPublisherUri.empty()) {
             cout << "analyticsURI: " << analyticsPublisherUri << endl;
+            analyticsPublisher_.enableHttp2(services->params.get("analytics-http2", false).asBool());
             analyticsPublisher_.init(analyticsPublisherUri, analyticsPublisherConnections);
         }
         else cout << "analytics-uri is not in the config" << endl;
@@ -124,37 +126,169 @@ errorResponseHelper(HttpAdServerResponse & resp,
     resp.details = details;
 }
 
+namespace RTBKIT {
+
+/** Fields of a win notice or of a campaign event as they're sent to the
+    connector.  The missing fields are left empty and the errors reported
+    once the notice has been parsed.
+*/
+struct StandardNotice {
+    StandardNotice()
+        : hasTimestamp(false), timestamp(0.0),
+          hasPrice(false), price(0.0)
+    {
+    }
+
+    bool hasTimestamp;
+    double timestamp;
+    bool hasPrice;
+    double price;
+
+    std::string bidRequestId;
+    std::string impId;
+    std::string type;
+    std::string userId;       // first of the userIds
+    std::string passback;
+};
+
+} // namespace RTBKIT
+
+namespace {
+
+/** The ids are strings, but numbers are accepted as well. */
+std::string expectString(JsonParsingContext & context)
+{
+    if (context.isString())
+        return context.expectStringUtf8().rawString();
+    return context.expectJson().asString();
+}
+
+/** Same for numbers, which can be sent as strings. */
+double expectNumber(JsonParsingContext & context)
+{
+    if (context.isString())
+        return stod(context.expectStringAscii());
+    return context.expectDouble();
+}
+
+void parseNotice(JsonParsingContext & context, StandardNotice & notice)
+{
+    context.forEachMember([&] () {
+            const char * name = context.fieldNamePtr();
+
+            if (!strcmp(name, "timestamp")) {
+                notice.timestamp = expectNumber(context);
+                notice.hasTimestamp = true;
+            }
+            else if (!strcmp(name, "bidRequestId"))
+                notice.bidRequestId = expectString(context);
+            else if (!strcmp(name, "impid"))
+                notice.impId = expectString(context);
+            else if (!strcmp(name, "price")) {
+                notice.price = expectNumber(context);
+                notice.hasPrice = true;
+            }
+            else if (!strcmp(name, "type"))
+                notice.type = expectString(context);
+            else if (!strcmp(name, "userIds") && context.isArray()) {
+                context.forEachElement([&] () {
+                        if (notice.userId.empty())
+                            notice.userId = expectString(context);
+                        else context.skip();
+                    });
+            }
+            else if (!strcmp(name, "passback"))
+                notice.passback = expectString(context);
+            else context.skip();
+        });
+}
+
+/** Parses the notices in the payload, which holds either one of them or an
+    array.  They're all parsed before any is handled so that a malformed
+    batch isn't partly published.
+*/
+std::vector<StandardNotice>
+parseNotices(const std::string & payload)
+{
+    const char * start = payload.c_str();
+    const char * end = start + payload.length();
+
+    StreamingJsonParsingContext context(payload, start, end);
+
+    std::vector<StandardNotice> result;
+    if (context.isArray()) {
+        context.forEachElement([&] () {
+                result.emplace_back();
+                parseNotice(context, result.back());
+            });
+    }
+    else {
+        result.emplace_back();
+        parseNotice(context, result.back());
+    }
+
+    return result;
+}
+
+/** Handles each notice and returns the error of the first invalid one, if
+    any.  The other notices of the batch are still handled. */
+template<typename Handle>
+HttpAdServerResponse
+handleNotices(const std::string & payload, const Handle & handle)
+{
+    HttpAdServerResponse result;
+
+    for (const StandardNotice & notice : parseNotices(payload)) {
+        HttpAdServerResponse response = handle(notice);
+        if (!response.valid && result.valid)
+            result = response;
+    }
+
+    return result;
+}
+
+} // file scope
+
 HttpAdServerResponse
 StandardAdServerConnector::
 handleWinRq(const HttpHeader & header,
             const Json::Value & json, const std::string & jsonStr)
+{
+    StandardNotice notice;
+    StructuredJsonParsingContext context(json);
+    parseNotice(context, notice);
+    return handleWin(notice);
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleWinPayload(const HttpHeader & header, const std::string & payload)
+{
+    return handleNotices(payload, [&] (const StandardNotice & notice) {
+            return handleWin(notice);
+        });
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleWin(const StandardNotice & notice)
 {
     HttpAdServerResponse response;
 
     Date timestamp;
-    string bidRequestIdStr;
-    string impIdStr;
-    double winPriceDbl;
 
     Id bidRequestId;
     Id impId;
     USD_CPM winPrice;
 
     UserIds userIds;
-    string userIdStr;
-    string passback;
 
     /*
      *  Timestamp is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("timestamp")) {
-        if(json["timestamp"].isString()) {
-           double tm = stod(json["timestamp"].asString());
-           timestamp = Date::fromSecondsSinceEpoch(tm);
-        } else {
-            timestamp = Date::fromSecondsSinceEpoch(json["timestamp"].asDouble());
-        }
+    if (notice.hasTimestamp) {
+        timestamp = Date::fromSecondsSinceEpoch(notice.timestamp);
 
         // Check if timestamp is finite when treated as seconds
         if(!timestamp.isADate()) {
@@ -176,9 +310,8 @@ handleWinRq(const HttpHeader & header,
      *  bidRequestId is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("bidRequestId")) {
-        bidRequestIdStr = json["bidRequestId"].asString();
-        bidRequestId = Id(bidRequestIdStr); 
+    if (!notice.bidRequestId.empty()) {
+        bidRequestId = Id(notice.bidRequestId);
     } else {
         errorResponseHelper(response,
                             "MISSING_BIDREQUESTID",
@@ -191,9 +324,8 @@ handleWinRq(const HttpHeader & header,
      *  impid is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("impid")) {
-        impIdStr = json["impid"].asString();
-        impId = Id(impIdStr);
+    if (!notice.impId.empty()) {
+        impId = Id(notice.impId);
     } else {
         errorResponseHelper(response,
                             "MISSING_IMPID",
@@ -206,9 +338,8 @@ handleWinRq(const HttpHeader & header,
      *  price is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("price")) {
-        winPriceDbl = json["price"].asDouble();
-        winPrice = USD_CPM(winPriceDbl);
+    if (notice.hasPrice) {
+        winPrice = USD_CPM(notice.price);
     } else {
         errorResponseHelper(response,
                             "MISSING_WINPRICE",
@@ -221,25 +352,13 @@ handleWinRq(const HttpHeader & header,
      *  UserIds is an optional field.
      *  If null, we just put an empty array.
      */
-    if (json.isMember("userIds")) {
-        auto item =  json["userIds"];
-        if(!item.empty())
-            userIds.add(Id(item[0].asString()), ID_PROVIDER);
-    }
-    else {
-        // UserIds is optional
-    }
+    if (!notice.userId.empty())
+        userIds.add(Id(notice.userId), ID_PROVIDER);
 
     /*
      *  Passback is an optional field.
      *  If null, we just put an empty string.
      */
-    if (json.isMember("passback")) {
-        passback =  json["passback"].asString();
-    }
-    else {
-        // Passback is optional
-    }
 
     LOG(adserverTrace) << "{\"timestamp\":\"" << timestamp.print(3) << "\"," <<
         "\"bidRequestId\":\"" << bidRequestId << "\"," <<
@@ -247,8 +366,11 @@ handleWinRq(const HttpHeader & header,
         "\"winPrice\":\"" << winPrice.toString() << "\" }";
 
     if(response.valid) {
+        const std::string & bidRequestIdStr = notice.bidRequestId;
+        const std::string & impIdStr = notice.impId;
+
         publishWin(bidRequestId, impId, winPrice, timestamp, Json::Value(), userIds,
-                   AccountKey(passback), Date());
+                   AccountKey(notice.passback), Date());
         if (analytics) analytics->logStandardWinMessage(timestamp.print(3),
                                                         bidRequestIdStr,
                                                         impIdStr,
@@ -264,10 +386,28 @@ HttpAdServerResponse
 StandardAdServerConnector::
 handleDeliveryRq(const HttpHeader & header,
                  const Json::Value & json, const std::string & jsonStr)
+{
+    StandardNotice notice;
+    StructuredJsonParsingContext context(json);
+    parseNotice(context, notice);
+    return handleDelivery(notice);
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleDeliveryPayload(const HttpHeader & header, const std::string & payload)
+{
+    return handleNotices(payload, [&] (const StandardNotice & notice) {
+            return handleDelivery(notice);
+        });
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleDelivery(const StandardNotice & notice)
 {    
     HttpAdServerResponse response;
-    string bidRequestIdStr, impIdStr, userIdStr, event;
-    Id bidRequestId, impId, userId;
+    Id bidRequestId, impId;
     UserIds userIds;
     Date timestamp;
     
@@ -275,13 +415,8 @@ handleDeliveryRq(const HttpHeader & header,
      *  Timestamp is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("timestamp")) {
-        if(json["timestamp"].isString()) {
-           double tm = stod(json["timestamp"].asString());
-           timestamp = Date::fromSecondsSinceEpoch(tm);
-        } else {
-            timestamp = Date::fromSecondsSinceEpoch(json["timestamp"].asDouble());
-        }
+    if (notice.hasTimestamp) {
+        timestamp = Date::fromSecondsSinceEpoch(notice.timestamp);
         
         // Check if timestamp is finite when treated as seconds
         if(!timestamp.isADate()) {
@@ -303,34 +438,28 @@ handleDeliveryRq(const HttpHeader & header,
      *  type is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("type")) {
-
-        event = (json["type"].asString());
-        
-        if(eventType.find(event) == eventType.end()) {
-            errorResponseHelper(response,
-                                "UNSUPPORTED_TYPE",
-                                "A campaign event requires the type field.");
-            publishError(response);
-            return response;
-        }
-
-    } else {
+    auto event = eventType.find(notice.type);
 
+    if (notice.type.empty()) {
         errorResponseHelper(response,
                             "MISSING_TYPE",
                             "A campaign event requires the type field.");
         publishError(response);
         return response;
     }
+    else if (event == eventType.end()) {
+        errorResponseHelper(response,
+                            "UNSUPPORTED_TYPE",
+                            "A campaign event requires the type field.");
+        publishError(response);
+        return response;
+    }
 
     /*
      *  impid is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("impid")) {
-
-    } else {
+    if (notice.impId.empty()) {
         errorResponseHelper(response,
                             "MISSING_IMPID",
                             "A campaign event requires the impId field.");
@@ -342,9 +471,7 @@ handleDeliveryRq(const HttpHeader & header,
      *  bidRequestId is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("bidRequestId")) {
-
-    } else {
+    if (notice.bidRequestId.empty()) {
         errorResponseHelper(response,
                             "MISSING_BIDREQUESTID",
                             "A campaign event requires the bidRequestId field.");
@@ -356,36 +483,29 @@ handleDeliveryRq(const HttpHeader & header,
      *  UserIds is an optional field.
      *  If null, we just put an empty array.
      */
-    if (json.isMember("userIds")) {
-        auto item =  json["userIds"];
-
-        if(!item.empty())
-            userIds.add(Id(item[0].asString()), ID_PROVIDER);
-    }
-    else {
-        // UserIds is optional
-    }
+    if (!notice.userId.empty())
+        userIds.add(Id(notice.userId), ID_PROVIDER);
 
-    bidRequestIdStr = json["bidRequestId"].asString();
-    impIdStr = json["impid"].asString();
+    const std::string & bidRequestIdStr = notice.bidRequestId;
+    const std::string & impIdStr = notice.impId;
     bidRequestId = Id(bidRequestIdStr);
     impId = Id(impIdStr);
     
     LOG(adserverTrace) << "{\"timestamp\":\"" << timestamp.print(3) << "\"," <<
         "\"bidRequestId\":\"" << bidRequestIdStr << "\"," <<
         "\"impId\":\"" << impIdStr << "\"," <<
-        "\"event\":\"" << event << 
+        "\"event\":\"" << notice.type << 
         "\"userIds\":" << userIds.toString() << "\"}";
 
     if(response.valid) {
-        publishCampaignEvent(eventType[event], bidRequestId, impId, timestamp,
+        publishCampaignEvent(event->second, bidRequestId, impId, timestamp,
                                  Json::Value(), userIds);
-        if (analytics) analytics->logStandardEventMessage(eventType[event],
+        if (analytics) analytics->logStandardEventMessage(event->second,
                                                           timestamp.print(3),
                                                           bidRequestIdStr,
                                                           impIdStr,
                                                           userIds.toString());
-        analyticsPublisher_.publish(eventType[event], timestamp.print(3), bidRequestIdStr,
+        analyticsPublisher_.publish(event->second, timestamp.print(3), bidRequestIdStr,
                                 impIdStr, userIds.toString());
     }
     return response;
@@ -10,7 +10,7 @@
 #include "rtbkit/plugins/adserver/http_adserver_connector.h"
 #include "rtbkit/common/analytics_publisher.h"
 
-namespace RTBKIT { struct Analytics; }
+namespace RTBKIT { struct Analytics; struct StandardNotice; }
 namespace Datacratic { struct ServiceProxies; }
 namespace Json { struct Value; }
 
@@ -39,6 +39,19 @@ struct StandardAdServerConnector : public HttpAdServerConnector
                                           const Json::Value & json,
                                           const std::string & jsonStr);
 
+    /** Handle the body of a request received on the win port, parsed
+        straight into the win without going through a Json::Value.  The
+        body is either a single win notice or an array of them.
+    */
+    HttpAdServerResponse handleWinPayload(const HttpHeader & header,
+                                          const std::string & payload);
+
+    /** Handle the body of a request received on the events port; same as
+        handleWinPayload() but for events.
+    */
+    HttpAdServerResponse handleDeliveryPayload(const HttpHeader & header,
+                                               const std::string & payload);
+
     void publishError(HttpAdServerResponse & resp);
 
     /** */
@@ -50,6 +63,9 @@ private :
                     bool analyticsPublisherOn = false, int analyticsPublisherConnections = 1);
     virtual void initEventType(const Json::Value &json);
 
+    HttpAdServerResponse handleWin(const StandardNotice & notice);
+    HttpAdServerResponse handleDelivery(const StandardNotice & notice);
+
     std::map<std::string, std::string> eventType;
     bool verbose;
 };
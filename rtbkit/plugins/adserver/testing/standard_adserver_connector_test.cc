@@ -129,6 +129,46 @@ BOOST_AUTO_TEST_CASE( test_standard_adserver_win )
     proxies->events->dump(std::cerr);
 }
 
+BOOST_AUTO_TEST_CASE( test_standard_adserver_win_batch )
+{
+    // several wins in a single request
+    std::string win = loadFile(win_sample_filename);
+    std::string strJson = "[" + win + "," + win + "]";
+
+    std::string httpRequest = ML::format(
+                                  "POST / HTTP/1.1\r\n"
+                                  "Content-Length: %zd\r\n"
+                                  "Content-Type: application/json\r\n"
+                                  "\r\n"
+                                  "%s",
+                                  strJson.size(),
+                                  strJson.c_str());
+
+    winSource->write(httpRequest);
+    std::string result = winSource->read();
+
+    BOOST_CHECK_EQUAL(result.compare(0, statusOK.length(), statusOK), 0);
+
+    // the batch fails if one of its wins does
+    strJson = "[" + win + ",{\"timestamp\":1396461865}]";
+    httpRequest = ML::format(
+                      "POST / HTTP/1.1\r\n"
+                      "Content-Length: %zd\r\n"
+                      "Content-Type: application/json\r\n"
+                      "\r\n"
+                      "%s",
+                      strJson.size(),
+                      strJson.c_str());
+
+    winSource->write(httpRequest);
+    result = winSource->read();
+
+    BOOST_CHECK_NE(result.compare(0, statusOK.length(), statusOK), 0);
+    BOOST_CHECK_NE(result.find("MISSING_BIDREQUESTID"), std::string::npos);
+
+    proxies->events->dump(std::cerr);
+}
+
 BOOST_AUTO_TEST_CASE( test_standard_adserver_click )
 {
     // load click json
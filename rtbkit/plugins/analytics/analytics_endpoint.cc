@@ -80,6 +80,22 @@ init()
                     JsonParam<string>("event", "event to publish")
             );
 
+    addRouteSyncReturn(versionNode,
+                    "/events",
+                    {"POST","PUT"},
+                    "Add a batch of events to the logs.",
+                    "Returns the number of events that were logged.",
+                    [] (const string & r) {
+                        Json::Value response(Json::stringValue);
+                        response = r;
+                        return response;
+                    },
+                    &AnalyticsRestEndpoint::addEvents,
+                    this,
+                    JsonParam<Json::Value>("events",
+                            "array of objects with a channel and an event")
+            );
+
     addRouteSyncReturn(versionNode,
                     "/channels",
                     {"GET"},
@@ -165,6 +181,29 @@ addEvent(const string & channel, const string & event) const
     return print(channel, event);
 }
 
+string
+AnalyticsRestEndpoint::
+addEvents(const Json::Value & events) const
+{
+    if (!events.isArray())
+        return "events must be an array";
+
+    size_t numLogged = 0;
+
+    boost::shared_lock<boost::shared_mutex> lock(access);
+    for (const auto & event : events) {
+        const string & channel = event["channel"].asString();
+        auto it = channelFilter.find(channel);
+        if (it == channelFilter.end() || !it->second)
+            continue;
+
+        print(channel, event["event"].asString());
+        ++numLogged;
+    }
+
+    return to_string(numLogged) + " events logged";
+}
+
 Json::Value
 AnalyticsRestEndpoint::
 listChannels() const
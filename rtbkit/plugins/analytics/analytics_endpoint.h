@@ -54,6 +54,11 @@ private:
     std::string addEvent(const std::string & channel,
                          const std::string & event) const;
 
+    /** Logs each {"channel", "event"} object of the array whose channel is
+        enabled; that's what the AnalyticsPublisher sends when it batches.
+    */
+    std::string addEvents(const Json::Value & events) const;
+
     std::string print(const std::string & channel,
                       const std::string & event) const;
 
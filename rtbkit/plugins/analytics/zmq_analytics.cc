@@ -14,6 +14,7 @@
 #include "soa/types/id.h"
 #include "rtbkit/core/post_auction/events.h"
 #include "rtbkit/common/currency.h"
+#include "jml/utils/exc_check.h"
 #include "boost/algorithm/string/trim.hpp"
 
 using namespace Datacratic;
@@ -22,7 +23,8 @@ namespace RTBKIT {
 
 ZmqAnalytics::ZmqAnalytics(const std::string & service_name, std::shared_ptr<ServiceProxies> proxies)
     : Analytics(service_name+"/logger", proxies),
-      zmq_publisher_(getZmqContext())
+      zmq_publisher_(getZmqContext()),
+      maxBatchSize_(1), maxBatchLatency_(0.1)
 {}
 
 ZmqAnalytics::~ZmqAnalytics() {}
@@ -30,6 +32,16 @@ ZmqAnalytics::~ZmqAnalytics() {}
 void ZmqAnalytics::init()
 {
     zmq_publisher_.init(getServices()->config, serviceName());
+
+    const Json::Value & params = getServices()->params;
+    maxBatchSize_ = params.get("zmq-analytics-batch-size", 1).asInt();
+    maxBatchLatency_ = params.get("zmq-analytics-batch-latency", 0.1).asDouble();
+    ExcCheckGreater(maxBatchLatency_, 0.0, "batch latency must be positive");
+
+    if (maxBatchSize_ > 1) {
+        flushLoop_.addPeriodic("ZmqAnalytics::flush", maxBatchLatency_,
+                               [=] (uint64_t) { flush(); });
+    }
 }
 
 void ZmqAnalytics::bindTcp(const std::string & port_range)
@@ -40,13 +52,37 @@ void ZmqAnalytics::bindTcp(const std::string & port_range)
 void ZmqAnalytics::start()
 {
     zmq_publisher_.start();
+    if (maxBatchSize_ > 1)
+        flushLoop_.start();
 }
 
 void ZmqAnalytics::shutdown()
 {
+    if (maxBatchSize_ > 1) {
+        flushLoop_.shutdown();
+        flush();
+    }
     zmq_publisher_.shutdown();
 }
 
+void ZmqAnalytics::publishBatch(const AnalyticsBatch & batch)
+{
+    zmq_publisher_.publish(AnalyticsBatch::Channel,
+                           std::to_string(batch.size()),
+                           batch.data());
+}
+
+void ZmqAnalytics::flush()
+{
+    AnalyticsBatch pending;
+    {
+        std::lock_guard<ML::Spinlock> guard(batchLock_);
+        pending.swap(batch_);
+    }
+    if (!pending.empty())
+        publishBatch(pending);
+}
+
 
 /**********************************************************************************************
 * USED IN ROUTER
@@ -55,15 +91,15 @@ void ZmqAnalytics::shutdown()
 void ZmqAnalytics::logMarkMessage(const Router & router,
                                   const double & last_check)
 {
-    zmq_publisher_.publish("MARK",
-                           Date::now().print(5),
-                           Date::fromSecondsSinceEpoch(last_check).print(),
-                           ML::format("active: %zd augmenting, %zd inFlight, "
-                                      "%zd agents",
-                                      router.augmentationLoop.numAugmenting(),
-                                      router.inFlight.size(),                                             
-                                      router.agents.size())
-                           );
+    publish("MARK",
+            Date::now().print(5),
+            Date::fromSecondsSinceEpoch(last_check).print(),
+            ML::format("active: %zd augmenting, %zd inFlight, "
+                       "%zd agents",
+                       router.augmentationLoop.numAugmenting(),
+                       router.numAuctionsInProgress(),                                             
+                       router.agents.size())
+            );
 }
 
 void ZmqAnalytics::logBidMessage(const std::string & agent,
@@ -71,33 +107,33 @@ void ZmqAnalytics::logBidMessage(const std::string & agent,
                                  const std::string & bids,
                                  const std::string & meta) 
 {
-    zmq_publisher_.publish("BID",
-                           Date::now().print(5),
-                           agent,
-                           auctionId.toString(),
-                           bids,
-                           meta
-                           );
+    publish("BID",
+            Date::now().print(5),
+            agent,
+            auctionId.toString(),
+            bids,
+            meta
+            );
 }
 
 void ZmqAnalytics::logAuctionMessage(const Id & auctionId,
                                      const std::string & auctionRequest)
 {
-    zmq_publisher_.publish("AUCTION", 
-                           Date::now().print(5),
-                           auctionId.toString(),
-                           auctionRequest
-                           );
+    publish("AUCTION", 
+            Date::now().print(5),
+            auctionId.toString(),
+            auctionRequest
+            );
 }
 
 void ZmqAnalytics::logConfigMessage(const std::string & agent,
                                     const std::string & config)
 {
-    zmq_publisher_.publish("CONFIG",
-                           Date::now().print(5),
-                           agent,
-                           config
-                          );
+    publish("CONFIG",
+            Date::now().print(5),
+            agent,
+            config
+            );
 }
 
 void ZmqAnalytics::logNoBudgetMessage(const std::string agent,
@@ -105,13 +141,13 @@ void ZmqAnalytics::logNoBudgetMessage(const std::string agent,
                                       const std::string & bids,
                                       const std::string & meta)
 {
-    zmq_publisher_.publish("NOBUDGET",
-                           Date::now().print(5),
-                           agent,
-                           auctionId.toString(),
-                           bids,
-                           meta
-                          );
+    publish("NOBUDGET",
+            Date::now().print(5),
+            agent,
+            auctionId.toString(),
+            bids,
+            meta
+            );
 }
 
 void ZmqAnalytics::logMessage(const std::string & msg,
@@ -120,13 +156,13 @@ void ZmqAnalytics::logMessage(const std::string & msg,
                               const std::string & bids,
                               const std::string & meta)
 {
-    zmq_publisher_.publish(msg,
-                           Date::now().print(5),
-                           agent,
-                           auctionId.toString(),
-                           bids,
-                           meta
-                          );
+    publish(msg,
+            Date::now().print(5),
+            agent,
+            auctionId.toString(),
+            bids,
+            meta
+            );
 
 }
 
@@ -156,18 +192,18 @@ void ZmqAnalytics::logUsageMessage(Router & router,
                                      info.stats->bids);
         Router::AgentUsageMetrics delta = newMetrics - last;
 
-        zmq_publisher_.publish("USAGE",
-                               Date::now().print(5),
-                               "AGENT", 
-                               p, 
-                               item.first,
-                               info.config->account.toString(),
-                               delta.intoFilters,
-                               delta.passedStaticFilters,
-                               delta.passedDynamicFilters,
-                               delta.auctions,
-                               delta.bids,
-                               info.config->bidProbability);
+        publish("USAGE",
+                Date::now().print(5),
+                "AGENT", 
+                p, 
+                item.first,
+                info.config->account.toString(),
+                delta.intoFilters,
+                delta.passedStaticFilters,
+                delta.passedDynamicFilters,
+                delta.auctions,
+                delta.bids,
+                info.config->bidProbability);
         last = move(newMetrics);
     }
 
@@ -189,16 +225,16 @@ void ZmqAnalytics::logUsageMessage(Router & router,
         Router:: RouterUsageMetrics delta = newMetrics - router.lastRouterUsageMetrics;
 
 
-        zmq_publisher_.publish("USAGE",
-                               Date::now().print(5),
-                               "ROUTER", 
-                               p, 
-                               delta.numRequests,
-                               delta.numAuctions,
-                               delta.numNoPotentialBidders,
-                               delta.numBids,
-                               delta.numAuctionsWithBid,
-                               acceptAuctionProbability / numExchanges);
+        publish("USAGE",
+                Date::now().print(5),
+                "ROUTER", 
+                p, 
+                delta.numRequests,
+                delta.numAuctions,
+                delta.numNoPotentialBidders,
+                delta.numBids,
+                delta.numAuctionsWithBid,
+                acceptAuctionProbability / numExchanges);
 
         router.lastRouterUsageMetrics = move(newMetrics);
     }
@@ -207,23 +243,23 @@ void ZmqAnalytics::logUsageMessage(Router & router,
 void ZmqAnalytics::logErrorMessage(const std::string & error,
                                    const std::vector<std::string> & message)
 {
-    zmq_publisher_.publish("ERROR",
-                           Date::now().print(5),
-                           error,
-                           message
-                          );
+    publish("ERROR",
+            Date::now().print(5),
+            error,
+            message
+            );
 }
 
 void ZmqAnalytics::logRouterErrorMessage(const std::string & function,
                                          const std::string & exception, 
                                          const std::vector<std::string> & message)
 {
-    zmq_publisher_.publish("ROUTERERROR",
-                           Date::now().print(5),
-                           function,
-                           exception,
-                           message
-                          );
+    publish("ROUTERERROR",
+            Date::now().print(5),
+            function,
+            exception,
+            message
+            );
 }
 
 
@@ -233,7 +269,7 @@ void ZmqAnalytics::logRouterErrorMessage(const std::string & function,
 
 void ZmqAnalytics::logMatchedWinLoss(const MatchedWinLoss & matchedWinLoss) 
 {
-    zmq_publisher_.publish(
+    publish(
             "MATCHED" + matchedWinLoss.typeString(),                // 0
             Date::now().print(5),                                   // 1
 
@@ -275,7 +311,7 @@ void ZmqAnalytics::logMatchedWinLoss(const MatchedWinLoss & matchedWinLoss)
 
 void ZmqAnalytics::logMatchedCampaignEvent(const MatchedCampaignEvent & matchedCampaignEvent)
 {
-    zmq_publisher_.publish(
+    publish(
             "MATCHED" + matchedCampaignEvent.label,    // 0
             Date::now().print(5),                      // 1
 
@@ -298,7 +334,7 @@ void ZmqAnalytics::logMatchedCampaignEvent(const MatchedCampaignEvent & matchedC
 
 void ZmqAnalytics::logUnmatchedEvent(const UnmatchedEvent & unmatchedEvent)
 {
-    zmq_publisher_.publish(
+    publish(
             // Use event type not label since label is only defined for campaign events.
             "UNMATCHED" + string(print(unmatchedEvent.event.type)),             // 0
             Date::now().print(5),                                               // 1
@@ -314,22 +350,22 @@ void ZmqAnalytics::logUnmatchedEvent(const UnmatchedEvent & unmatchedEvent)
 
 void ZmqAnalytics::logPostAuctionErrorEvent(const PostAuctionErrorEvent & postAuctionErrorEvent)
 {
-    zmq_publisher_.publish("PAERROR",
-                           Date::now().print(5),
-                           postAuctionErrorEvent.key,
-                           postAuctionErrorEvent.message);
+    publish("PAERROR",
+            Date::now().print(5),
+            postAuctionErrorEvent.key,
+            postAuctionErrorEvent.message);
 }
 
 void ZmqAnalytics::logPAErrorMessage(const std::string & function,
                                      const std::string & exception, 
                                      const std::vector<std::string> & message)
 {
-    zmq_publisher_.publish("PAERROR",
-                           Date::now().print(5),
-                           function,
-                           exception,
-                           message
-                          );
+    publish("PAERROR",
+            Date::now().print(5),
+            function,
+            exception,
+            message
+            );
 }
 
 
@@ -340,11 +376,11 @@ void ZmqAnalytics::logPAErrorMessage(const std::string & function,
 void ZmqAnalytics::logMockWinMessage(const std::string & eventAuctionId,
                                      const std::string & eventWinPrice)
 {
-    zmq_publisher_.publish("WIN",
-                           Date::now().print(3),
-                           eventAuctionId,
-                           eventWinPrice,
-                           "0");
+    publish("WIN",
+            Date::now().print(3),
+            eventAuctionId,
+            eventWinPrice,
+            "0");
 }
 
 /**********************************************************************************************
@@ -356,11 +392,11 @@ void ZmqAnalytics::logStandardWinMessage(const std::string & timestamp,
                                          const std::string & impId,
                                          const std::string & winPrice) 
 {
-    zmq_publisher_.publish("WIN",
-                           timestamp,
-                           bidRequestId,
-                           impId,
-                           winPrice);
+    publish("WIN",
+            timestamp,
+            bidRequestId,
+            impId,
+            winPrice);
 }
 
 void ZmqAnalytics::logStandardEventMessage(const std::string & eventType,
@@ -369,11 +405,11 @@ void ZmqAnalytics::logStandardEventMessage(const std::string & eventType,
                                            const std::string & impId,
                                            const std::string & userIds)
 {
-    zmq_publisher_.publish(eventType,
-                           timestamp,
-                           bidRequestId,
-                           impId,
-                           userIds);
+    publish(eventType,
+            timestamp,
+            bidRequestId,
+            impId,
+            userIds);
 }
 
 /**********************************************************************************************
@@ -384,10 +420,10 @@ void ZmqAnalytics::logAdserverEvent(const std::string & type,
                                     const std::string & bidRequestId,
                                     const std::string & impId)
 {
-    zmq_publisher_.publish(type,
-                           type,
-                           bidRequestId,
-                           impId);
+    publish(type,
+            type,
+            bidRequestId,
+            impId);
 }
 
 void ZmqAnalytics::logAdserverWin(const std::string & timestamp,
@@ -397,13 +433,13 @@ void ZmqAnalytics::logAdserverWin(const std::string & timestamp,
                                   const std::string & winPrice,
                                   const std::string & dataCost)
 {
-    zmq_publisher_.publish("WIN",
-                           timestamp,
-                           auctionId,
-                           adSpotId,
-                           accountKey,
-                           winPrice,
-                           dataCost);
+    publish("WIN",
+            timestamp,
+            auctionId,
+            adSpotId,
+            accountKey,
+            winPrice,
+            dataCost);
 }
 
 void ZmqAnalytics::logAuctionEventMessage(const std::string & event,
@@ -412,20 +448,20 @@ void ZmqAnalytics::logAuctionEventMessage(const std::string & event,
                                           const std::string & adSpotId,
                                           const std::string & userId)
 {
-    zmq_publisher_.publish(event,
-                           timestamp,
-                           auctionId,
-                           adSpotId,
-                           userId);
+    publish(event,
+            timestamp,
+            auctionId,
+            adSpotId,
+            userId);
 }
 
 void ZmqAnalytics::logEventJson(const std::string & event,
                                 const std::string & timestamp,
                                 const std::string & json)
 {
-    zmq_publisher_.publish(event,
-                           timestamp,
-                           json);
+    publish(event,
+            timestamp,
+            json);
 }
 
 void ZmqAnalytics::logDetailedWin(const std::string timestamp,
@@ -438,16 +474,16 @@ void ZmqAnalytics::logDetailedWin(const std::string timestamp,
                                   const std::string & strategy,
                                   const std::string & bidTimeStamp)
 {
-    zmq_publisher_.publish("WIN",
-                           timestamp,
-                           json,
-                           auctionId,
-                           spotId,
-                           price,
-                           userIds,
-                           campaign,
-                           strategy,
-                           bidTimeStamp);
+    publish("WIN",
+            timestamp,
+            json,
+            auctionId,
+            spotId,
+            price,
+            userIds,
+            campaign,
+            strategy,
+            bidTimeStamp);
 }
 
 } // namespace RTBKIT
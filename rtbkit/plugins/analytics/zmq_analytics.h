@@ -12,7 +12,10 @@
 #include <string>
 
 #include "rtbkit/common/analytics.h"
+#include "rtbkit/common/analytics_batch.h"
 #include "soa/service/zmq_named_pub_sub.h"
+#include "soa/service/message_loop.h"
+#include "jml/arch/spinlock.h"
 
 namespace RTBKIT {
     class Router; 
@@ -28,6 +31,16 @@ namespace Datacratic {
 
 namespace RTBKIT {
 
+/** Publishes the events on a zeromq socket, one message per event with one
+    frame per field.
+
+    When the zmq-analytics-batch-size parameter of the services is over 1,
+    the events are instead packed into an AnalyticsBatch and published as a
+    single message on the BATCH channel, made of the number of events and
+    of the encoded batch, once the batch is full or has been waiting for
+    zmq-analytics-batch-latency seconds (0.1 by default).  The DataLogger
+    unpacks them back into the original messages.
+*/
 class ZmqAnalytics : public Analytics {
 
 public:
@@ -122,6 +135,38 @@ public:
 private:
     Datacratic::ZmqNamedPublisher zmq_publisher_;
 
+    size_t maxBatchSize_;
+    double maxBatchLatency_;
+
+    ML::Spinlock batchLock_;
+    AnalyticsBatch batch_;
+
+    /** Flushes the batch when it has been waiting for too long. */
+    Datacratic::MessageLoop flushLoop_;
+
+    template<typename... Args>
+    void publish(const std::string & channel, const Args & ... args)
+    {
+        if (maxBatchSize_ <= 1) {
+            zmq_publisher_.publish(channel, args...);
+            return;
+        }
+
+        AnalyticsBatch full;
+        {
+            std::lock_guard<ML::Spinlock> guard(batchLock_);
+            batch_.add(channel, args...);
+            if (batch_.size() < maxBatchSize_) return;
+            full.swap(batch_);
+        }
+        publishBatch(full);
+    }
+
+    void publishBatch(const AnalyticsBatch & batch);
+
+    /** Publishes whatever is in the batch. */
+    void flush();
+
 }; // class ZmqEventLogger
 
 } // namespace RTBKIT
@@ -39,6 +39,11 @@ Augmentor(const std::string & augmentorName,
       toRouters(getZmqContext()),
       responseQueue(QueueSize),
       requestQueue(QueueSize),
+      numWorkers(0),
+      maxInFlight(0),
+      binaryProtocol(false),
+      numInFlight(0),
+      workerBusyNs(0),
       loopMonitor(*this),
       loadStabilizer(loopMonitor)
 {
@@ -53,6 +58,11 @@ Augmentor(const std::string & augmentorName,
       toRouters(getZmqContext()),
       responseQueue(QueueSize),
       requestQueue(QueueSize),
+      numWorkers(0),
+      maxInFlight(0),
+      binaryProtocol(false),
+      numInFlight(0),
+      workerBusyNs(0),
       loopMonitor(*this),
       loadStabilizer(loopMonitor)
 {
@@ -73,16 +83,19 @@ init(int numThreads)
             const AugmentationRequest& request = resp.first;
             const AugmentationList& response = resp.second;
 
+            bool binary = request.version == "1.1";
             toRouters.sendMessage(
                     request.router,
                     "RESPONSE",
-                    "1.0",
+                    binary ? "1.1" : "1.0",
                     request.startTime,
                     request.id.toString(),
                     request.augmentor,
-                    chomp(response.toJson().toString()));
+                    binary ? response.serializeToString()
+                           : chomp(response.toJson().toString()));
 
             recordHit("messages.RESPONSE");
+            recordSpan(request.id, "augment", request.handled, Date::now());
         };
 
     addSource("Augmentor::responseQueue", responseQueue);
@@ -91,7 +104,11 @@ init(int numThreads)
 
     toRouters.connectHandler = [=] (const std::string & newRouter)
         {
-            toRouters.sendMessage(newRouter, "CONFIG", "1.0", augmentorName);
+            const char * version = binaryProtocol ? "1.1" : "1.0";
+            if (maxInFlight > 0)
+                toRouters.sendMessage(newRouter, "CONFIG", version, augmentorName,
+                                      to_string(maxInFlight));
+            else toRouters.sendMessage(newRouter, "CONFIG", version, augmentorName);
             recordHit("messages.CONFIG");
         };
 
@@ -113,13 +130,18 @@ init(int numThreads)
 
 
     stopWorkers = false;
+    numWorkers = numThreads;
     for (size_t i = 0; i < numThreads; ++i)
         workers.create_thread([=] { this->runWorker(); });
 
     loopMonitor.init();
     loopMonitor.addMessageLoop("augmentor", this);
+    loopMonitor.addCallback("augmentor.workers", [=] (double elapsedTime) {
+        return this->sampleWorkerLoad(elapsedTime);
+    });
     loopMonitor.onLoadChange = [=] (double) {
         recordLevel(this->loadStabilizer.shedProbability(), "shedProbability");
+        recordLevel(this->numInFlight, "numInFlight");
     };
     addSource("Augmentor::loopMonitor", loopMonitor);
 }
@@ -141,10 +163,28 @@ shutdown()
     toRouters.shutdown();
 }
 
+double
+Augmentor::
+sampleWorkerLoad(double elapsedTime)
+{
+    double load = 0.0;
+
+    uint64_t busyNs = workerBusyNs.exchange(0);
+    if (numWorkers && elapsedTime > 0.0)
+        load = busyNs / (elapsedTime * 1e9 * numWorkers);
+
+    if (maxInFlight > 0)
+        load = std::max(load, double(numInFlight) / maxInFlight);
+
+    return std::min(load, 1.0);
+}
+
 void
 Augmentor::
 respond(const AugmentationRequest & request, const AugmentationList & response)
 {
+    numInFlight.fetch_sub(1);
+
     if (responseQueue.tryPush(make_pair(request, response)))
         return;
 
@@ -156,8 +196,10 @@ Augmentor::
 parseMessage(AugmentationRequest& request, Message& message)
 {
     const string & version = message.second.at(1);
-    ExcCheckEqual(version, "1.0", "unexpected version in augment");
+    ExcCheck(version == "1.0" || version == "1.1",
+             "unexpected version in augment");
 
+    request.version = version;
     request.router = message.first;
     request.timeAvailableMs = 0.05;
     request.augmentor = std::move(message.second.at(2));
@@ -190,9 +232,22 @@ handleRouterMessage(const std::string & router, std::vector<std::string> & messa
 
         bool shedMessage = loadStabilizer.shedMessage();
 
+        if (!shedMessage && maxInFlight > 0 && numInFlight >= maxInFlight) {
+            recordHit("shedMessages.tooManyInFlight");
+            shedMessage = true;
+        }
+
         if (!shedMessage) {
+            numInFlight.fetch_add(1);
             Message value = make_pair(router, std::move(message));
             shedMessage = !requestQueue.tryPush(std::move(value));
+
+            // The value is left untouched when the push fails and we still
+            // need the message to answer.
+            if (shedMessage) {
+                message = std::move(value.second);
+                numInFlight.fetch_sub(1);
+            }
         }
 
         if (shedMessage) {
@@ -203,7 +258,7 @@ handleRouterMessage(const std::string & router, std::vector<std::string> & messa
                     message.at(7), // startTime
                     message.at(3), // auctionId
                     message.at(2), // augmentor
-                    "null");       // response
+                    message.at(1) == "1.1" ? "" : "null"); // response
             recordHit("shedMessages");
         }
     }
@@ -226,10 +281,14 @@ runWorker()
             cerr << "error while parsing message: "
                 << message << " -> " << ex.what()
                 << endl;
+            numInFlight.fetch_sub(1);
             continue;
         }
 
+        Date start = Date::now();
+        request.handled = start;
         handleRequest(request);
+        workerBusyNs.fetch_add(Date::now().secondsSince(start) * 1e9);
     }
 }
 
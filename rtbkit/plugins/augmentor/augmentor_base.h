@@ -49,6 +49,8 @@ struct AugmentationRequest
     std::vector<std::string> agents;          // Agents availble to bid
     double timeAvailableMs;                   // Time to respond
     Date startTime;                           // Start of the latency timer
+    std::string version;                      // Protocol version to answer in
+    Date handled;                             // When a worker picked it up
 };
 
 
@@ -72,10 +74,28 @@ struct Augmentor : public ServiceBase, public MessageLoop {
 
     ~Augmentor();
 
+    /** Requests are handed to the handler on a pool of numThreads worker
+        threads and the responses are sent back to the routers from the
+        message loop.
+    */
     void init(int numThreads = 1);
     void start();
     void shutdown();
 
+    /** Limits the number of requests that can be waiting for a response at
+        once.  The limit is advertised to the routers, which won't send more
+        than that, and the requests beyond it are answered right away with a
+        null augmentation.  Must be called before init(); 0 means no limit.
+    */
+    void setMaxInFlight(int maxInFlight) { this->maxInFlight = maxInFlight; }
+
+    /** Asks the routers for version 1.1 of the protocol, in which the bid
+        requests and the augmentations are sent in their binary encoding
+        instead of JSON.  Only supported by the newer routers.  Must be
+        called before init().
+    */
+    void setBinaryProtocol(bool binary) { this->binaryProtocol = binary; }
+
     /** Function to be called to respond to an augmentation request. */
     void respond(const AugmentationRequest & request,
                  const AugmentationList & response);
@@ -102,6 +122,18 @@ private:
 
     boost::thread_group workers;
     std::atomic<bool> stopWorkers;
+    int numWorkers;
+
+    int maxInFlight;
+    bool binaryProtocol;
+    std::atomic<int> numInFlight;      ///< Requests not responded to yet
+    std::atomic<uint64_t> workerBusyNs; ///< Time spent in the handler
+
+    /** Load of the worker pool for the load stabilizer: the fraction of the
+        time the workers spent in the handler or how close we are to the
+        in flight limit, whichever is higher.
+    */
+    double sampleWorkerLoad(double elapsedTime);
 
     LoopMonitor loopMonitor;
     LoadStabilizer loadStabilizer;
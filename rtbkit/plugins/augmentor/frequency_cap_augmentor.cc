@@ -0,0 +1,159 @@
+/** frequency_cap_augmentor.cc                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Implementation of the in memory frequency cap augmentor.
+
+*/
+
+#include "frequency_cap_augmentor.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+
+#include <limits>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* IN MEMORY FREQUENCY CAP AUGMENTOR                                          */
+/******************************************************************************/
+
+const string InMemoryFrequencyCapAugmentor::PassTag = "pass-frequency-cap";
+
+InMemoryFrequencyCapAugmentor::
+InMemoryFrequencyCapAugmentor(
+        std::shared_ptr<ServiceProxies> proxies,
+        const string& serviceName,
+        const string& augmentorName) :
+    AsyncAugmentor(augmentorName, serviceName, proxies),
+    agentConfig(getZmqContext()),
+    palEvents(getZmqContext())
+{
+    recordHit("up");
+}
+
+void
+InMemoryFrequencyCapAugmentor::
+init(int numThreads, double windowSeconds, unsigned numBuckets,
+     const string& idDomain)
+{
+    this->idDomain = idDomain;
+    counters_.reset(new FrequencyCounters(windowSeconds, numBuckets));
+
+    AsyncAugmentor::init(numThreads);
+
+    agentConfig.init(getServices()->config);
+    addSource("InMemoryFrequencyCapAugmentor::agentConfig", agentConfig);
+
+    palEvents.init(getServices()->config);
+    palEvents.messageHandler = [=] (const vector<zmq::message_t>& msg)
+        {
+            onWin(msg);
+        };
+    palEvents.connectAllServiceProviders(
+            "rtbPostAuctionService", "logger", {"MATCHEDWIN"});
+    addSource("InMemoryFrequencyCapAugmentor::palEvents", palEvents);
+
+    // Entries can only expire when a bucket slides out of the window.
+    addPeriodic("InMemoryFrequencyCapAugmentor::expire",
+                windowSeconds / numBuckets,
+                [=] (uint64_t) { expire(); });
+}
+
+uint64_t
+InMemoryFrequencyCapAugmentor::
+userKey(const UserIds& uids) const
+{
+    auto it = uids.find(idDomain);
+    if (it == uids.end() || !it->second) return 0;
+    return FrequencyCounters::userKey(it->second);
+}
+
+void
+InMemoryFrequencyCapAugmentor::
+onWin(const vector<zmq::message_t>& msg)
+{
+    AccountKey account(msg[19].toString());
+    UserIds uids = UserIds::createFromString(msg[15].toString());
+
+    uint64_t user = userKey(uids);
+    if (!user) {
+        recordHit("wins.noUserId");
+        return;
+    }
+
+    counters_->add(user, FrequencyCounters::campaignKey(account[0]));
+    recordHit("wins.counted");
+}
+
+void
+InMemoryFrequencyCapAugmentor::
+onRequest(const AugmentationRequest& request, SendResponseCB sendResponse)
+{
+    recordHit("requests");
+
+    AugmentationList result;
+
+    // Without an id every user looks new so nobody would ever be capped.
+    uint64_t user = userKey(request.bidRequest->userIds);
+    if (!user) {
+        recordHit("noUserId");
+        sendResponse(result);
+        return;
+    }
+
+    Date now = Date::nowFast();
+
+    for (const string& agent : request.agents) {
+        AgentConfigEntry config = agentConfig.getAgentEntry(agent);
+        if (!config.valid()) {
+            recordHit("unknownConfig");
+            continue;
+        }
+
+        const AccountKey& account = config.config->account;
+        uint64_t campaign = FrequencyCounters::campaignKey(account[0]);
+        unsigned count = counters_->get(user, campaign, now);
+
+        result[account[0]].data = count;
+
+        if (count < getCap(request.augmentor, config)) {
+            result[account].tags.insert(PassTag);
+            recordHit("accounts." + account[0] + ".passed");
+        }
+        else recordHit("accounts." + account[0] + ".capped");
+    }
+
+    sendResponse(result);
+}
+
+size_t
+InMemoryFrequencyCapAugmentor::
+getCap(const string& augmentor, const AgentConfigEntry& config) const
+{
+    for (const auto& augConfig : config.config->augmentations) {
+        if (augConfig.name != augmentor) continue;
+
+        const Json::Value& value = augConfig.config;
+        if (value.isObject()) return value["cap"].asInt();
+        return value.asInt();
+    }
+
+    // The router only sends us the agents that were configured for us.
+    return numeric_limits<size_t>::max();
+}
+
+void
+InMemoryFrequencyCapAugmentor::
+expire()
+{
+    size_t dropped = counters_->expire();
+    recordCount(dropped, "counters.expired");
+    recordLevel(counters_->size(), "counters.size");
+    recordLevel(counters_->memUsage(), "counters.bytes");
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,84 @@
+/** frequency_cap_augmentor.h                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Frequency cap augmentor which keeps its counters in memory.
+
+*/
+
+#pragma once
+
+#include "augmentor_base.h"
+#include "frequency_counters.h"
+#include "rtbkit/core/agent_configuration/agent_configuration_listener.h"
+#include "soa/service/zmq_named_pub_sub.h"
+
+#include <string>
+#include <memory>
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* IN MEMORY FREQUENCY CAP AUGMENTOR                                          */
+/******************************************************************************/
+
+/** Limits the number of times the campaign of an agent is shown to a user
+    over a sliding window of time.
+
+    The wins are counted from the MATCHEDWIN events of the post auction loop
+    into FrequencyCounters, so the augmentor answers every request right away
+    without going to an external store. The counts are lost on restart and
+    aren't shared between instances, so the router should be configured to
+    send the requests of a user to the same instance with
+    AugmentationLoop::setAffinity on the same id domain.
+
+    Agents opt in by adding an augmentation with the name of the augmentor
+    whose config is the cap, either as an integer or as {"cap": n}. Requests
+    under the cap for an account are given the pass-frequency-cap tag, and
+    the count itself is attached as the data of the campaign.
+ */
+struct InMemoryFrequencyCapAugmentor : public AsyncAugmentor
+{
+    InMemoryFrequencyCapAugmentor(
+            std::shared_ptr<ServiceProxies> proxies,
+            const std::string& serviceName,
+            const std::string& augmentorName = "frequency-cap");
+
+    /** Counts are kept over windowSeconds split in numBuckets buckets (see
+        FrequencyCounters) and keyed by the user id of idDomain.
+     */
+    void init(
+            int numThreads = 2,
+            double windowSeconds = 86400.0,
+            unsigned numBuckets = 4,
+            const std::string& idDomain = "xchg");
+
+    const FrequencyCounters& counters() const { return *counters_; }
+
+    static const std::string PassTag;
+
+private:
+
+    virtual void
+    onRequest(const AugmentationRequest& request, SendResponseCB sendResponse);
+
+    void onWin(const std::vector<zmq::message_t>& msg);
+
+    /** Id of the user in our domain or 0 if the request has none. */
+    uint64_t userKey(const UserIds& uids) const;
+
+    size_t getCap(const std::string& augmentor,
+                  const AgentConfigEntry& config) const;
+
+    void expire();
+
+    std::string idDomain;
+    std::unique_ptr<FrequencyCounters> counters_;
+
+    AgentConfigurationListener agentConfig;
+    Datacratic::ZmqNamedMultipleSubscriber palEvents;
+};
+
+} // namespace RTBKIT
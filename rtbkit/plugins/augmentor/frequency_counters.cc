@@ -0,0 +1,279 @@
+/** frequency_counters.cc                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Implementation of the frequency counters.
+
+*/
+
+#include "frequency_counters.h"
+#include "jml/arch/exception.h"
+#include "jml/utils/exc_check.h"
+
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* UTILS                                                                      */
+/******************************************************************************/
+
+namespace {
+
+enum { MinCapacity = 1024 };
+
+/** Finalizer of splitmix64 which spreads the bits of the ids well enough for
+    the low bits to be used as the slot and the high ones as the shard.
+ */
+uint64_t mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+size_t nextPowerOfTwo(size_t n)
+{
+    size_t result = MinCapacity;
+    while (result < n) result *= 2;
+    return result;
+}
+
+} // file scope
+
+
+/******************************************************************************/
+/* SHARD                                                                      */
+/******************************************************************************/
+
+FrequencyCounters::Entry*
+FrequencyCounters::Shard::
+find(uint64_t key)
+{
+    if (entries.empty()) return nullptr;
+
+    size_t mask = entries.size() - 1;
+    for (size_t slot = key & mask;; slot = (slot + 1) & mask) {
+        Entry& entry = entries[slot];
+        if (entry.key == key) return &entry;
+        if (!entry.key) return nullptr;
+    }
+}
+
+FrequencyCounters::Entry&
+FrequencyCounters::Shard::
+insert(uint64_t key)
+{
+    // Kept at most 3/4 full so that the probes stay short.
+    if ((used + 1) * 4 > entries.size() * 3)
+        rehash(nextPowerOfTwo(entries.size() * 2));
+
+    size_t mask = entries.size() - 1;
+    size_t slot = key & mask;
+    while (entries[slot].key) slot = (slot + 1) & mask;
+
+    Entry& entry = entries[slot];
+    memset(&entry, 0, sizeof(entry));
+    entry.key = key;
+    used++;
+    return entry;
+}
+
+void
+FrequencyCounters::Shard::
+rehash(size_t capacity)
+{
+    vector<Entry> old(capacity);
+    memset(old.data(), 0, capacity * sizeof(Entry));
+    old.swap(entries);
+
+    size_t mask = entries.size() - 1;
+    for (const Entry& entry : old) {
+        if (!entry.key) continue;
+
+        size_t slot = entry.key & mask;
+        while (entries[slot].key) slot = (slot + 1) & mask;
+        entries[slot] = entry;
+    }
+}
+
+
+/******************************************************************************/
+/* FREQUENCY COUNTERS                                                         */
+/******************************************************************************/
+
+FrequencyCounters::
+FrequencyCounters(
+        double windowSeconds, unsigned numBuckets, unsigned numShards) :
+    bucketSeconds(windowSeconds / numBuckets),
+    numBuckets(numBuckets),
+    shardBits(0)
+{
+    ExcCheckGreater(windowSeconds, 0.0, "invalid window");
+    ExcCheck(numBuckets > 0 && numBuckets <= MaxBuckets,
+            "invalid number of buckets");
+    ExcCheck(numShards > 0 && !(numShards & (numShards - 1)),
+            "number of shards must be a power of two");
+
+    while ((1U << shardBits) < numShards) shardBits++;
+    shards.reset(new Shard[numShards]);
+}
+
+uint64_t
+FrequencyCounters::
+campaignKey(const string& campaign)
+{
+    return std::hash<string>()(campaign);
+}
+
+uint64_t
+FrequencyCounters::
+makeKey(uint64_t user, uint64_t campaign)
+{
+    uint64_t key = mix(user ^ mix(campaign));
+    return key ? key : 1;
+}
+
+uint32_t
+FrequencyCounters::
+bucketOf(Date date) const
+{
+    return date.secondsSinceEpoch() / bucketSeconds;
+}
+
+FrequencyCounters::Shard&
+FrequencyCounters::
+shardOf(uint64_t key) const
+{
+    return shards[shardBits ? key >> (64 - shardBits) : 0];
+}
+
+unsigned
+FrequencyCounters::
+windowCount(const Entry& entry, uint32_t now) const
+{
+    if (now >= entry.bucket + numBuckets) return 0;
+
+    // Only the buckets from now - numBuckets + 1 up to entry.bucket are in
+    // the window; the older ones haven't been cleared yet.
+    uint32_t first = now >= numBuckets ? now - numBuckets + 1 : 0;
+
+    unsigned total = 0;
+    for (uint32_t bucket = first; bucket <= entry.bucket; ++bucket)
+        total += entry.counts[bucket % numBuckets];
+    return total;
+}
+
+void
+FrequencyCounters::
+add(uint64_t user, uint64_t campaign, Date now, unsigned count)
+{
+    uint64_t key = makeKey(user, campaign);
+    uint32_t bucket = bucketOf(now);
+
+    Shard& shard = shardOf(key);
+    std::lock_guard<Spinlock> guard(shard.lock);
+
+    Entry* entry = shard.find(key);
+    if (!entry) {
+        entry = &shard.insert(key);
+        entry->bucket = bucket;
+    }
+
+    // Late events, wins can come in well after the auction.
+    else if (bucket < entry->bucket) {
+        if (bucket + numBuckets <= entry->bucket) return;
+    }
+
+    // Clears the buckets that slid out of the window since the last event.
+    else if (bucket > entry->bucket) {
+        uint32_t gap = min<uint32_t>(bucket - entry->bucket, numBuckets);
+        for (uint32_t i = 1; i <= gap; ++i)
+            entry->counts[(entry->bucket + i) % numBuckets] = 0;
+        entry->bucket = bucket;
+    }
+
+    uint16_t& counter = entry->counts[bucket % numBuckets];
+    counter = min<unsigned>(counter + count, UINT16_MAX);
+}
+
+unsigned
+FrequencyCounters::
+get(uint64_t user, uint64_t campaign, Date now) const
+{
+    uint64_t key = makeKey(user, campaign);
+
+    Shard& shard = shardOf(key);
+    std::lock_guard<Spinlock> guard(shard.lock);
+
+    const Entry* entry = shard.find(key);
+    return entry ? windowCount(*entry, bucketOf(now)) : 0;
+}
+
+size_t
+FrequencyCounters::
+expire(Date now)
+{
+    uint32_t bucket = bucketOf(now);
+    size_t dropped = 0;
+
+    for (size_t i = 0; i < (1U << shardBits); ++i) {
+        Shard& shard = shards[i];
+
+        std::lock_guard<Spinlock> guard(shard.lock);
+
+        vector<Entry> live;
+        live.reserve(shard.used);
+        for (const Entry& entry : shard.entries)
+            if (entry.key && windowCount(entry, bucket)) live.push_back(entry);
+
+        if (live.size() == shard.used) continue;
+        dropped += shard.used - live.size();
+
+        // Also shrinks the tables of the shards that were mostly idle.
+        shard.entries.clear();
+        shard.rehash(nextPowerOfTwo(live.size() * 2));
+        shard.used = 0;
+        for (const Entry& entry : live)
+            shard.insert(entry.key) = entry;
+    }
+
+    return dropped;
+}
+
+size_t
+FrequencyCounters::
+size() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < (1U << shardBits); ++i) {
+        std::lock_guard<Spinlock> guard(shards[i].lock);
+        total += shards[i].used;
+    }
+    return total;
+}
+
+size_t
+FrequencyCounters::
+memUsage() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < (1U << shardBits); ++i) {
+        std::lock_guard<Spinlock> guard(shards[i].lock);
+        total += shards[i].entries.capacity() * sizeof(Entry);
+    }
+    return total;
+}
+
+} // namespace RTBKIT
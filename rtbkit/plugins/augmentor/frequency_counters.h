@@ -0,0 +1,113 @@
+/** frequency_counters.h                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Compact in memory counters of the number of times each user was shown
+    each campaign.
+
+*/
+
+#pragma once
+
+#include "soa/types/date.h"
+#include "soa/types/id.h"
+#include "jml/arch/spinlock.h"
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* FREQUENCY COUNTERS                                                         */
+/******************************************************************************/
+
+/** Number of times each campaign was shown to each user over a sliding
+    window of time.
+
+    The window is split in numBuckets buckets of time and each counter keeps
+    one 16 bit count per bucket, the whole bucket being forgotten at once
+    when it slides out of the window. An event is therefore forgotten between
+    window * (1 - 1 / numBuckets) and window seconds after it happened.
+
+    Counters are keyed by a hash of the user and the campaign and stored in
+    flat open addressing tables of 24 byte entries, one per shard, each
+    protected by a spinlock. Entries with nothing left in the window are only
+    dropped by expire() which should be called periodically.
+ */
+struct FrequencyCounters
+{
+    enum { MaxBuckets = 6 };
+
+    FrequencyCounters(
+            double windowSeconds = 86400.0,
+            unsigned numBuckets = 4,
+            unsigned numShards = 64);
+
+    /** Counts an event for the user and campaign at the given time. Events
+        older than the window are ignored.
+     */
+    void add(uint64_t user, uint64_t campaign,
+             Datacratic::Date now = Datacratic::Date::nowFast(),
+             unsigned count = 1);
+
+    /** Number of events for the user and campaign within the window. */
+    unsigned get(uint64_t user, uint64_t campaign,
+                 Datacratic::Date now = Datacratic::Date::nowFast()) const;
+
+    /** Drops the entries that have nothing left in the window and returns
+        how many were dropped.
+     */
+    size_t expire(Datacratic::Date now = Datacratic::Date::nowFast());
+
+    /** Number of entries, including those waiting to be expired. */
+    size_t size() const;
+
+    /** Bytes taken by the tables. */
+    size_t memUsage() const;
+
+    double windowSeconds() const { return bucketSeconds * numBuckets; }
+
+    static uint64_t userKey(const Datacratic::Id& id) { return id.hash(); }
+    static uint64_t campaignKey(const std::string& campaign);
+
+private:
+
+    struct Entry
+    {
+        uint64_t key;       // 0 when the slot is empty.
+        uint32_t bucket;    // Latest bucket that was counted.
+        uint16_t counts[MaxBuckets];
+    };
+
+    struct Shard
+    {
+        Shard() : used(0) {}
+
+        Entry* find(uint64_t key);
+        Entry& insert(uint64_t key);
+        void rehash(size_t capacity);
+
+        std::vector<Entry> entries;
+        size_t used;
+        mutable ML::Spinlock lock;
+    };
+
+    static uint64_t makeKey(uint64_t user, uint64_t campaign);
+
+    uint32_t bucketOf(Datacratic::Date date) const;
+    unsigned windowCount(const Entry& entry, uint32_t now) const;
+
+    Shard& shardOf(uint64_t key) const;
+
+    double bucketSeconds;
+    unsigned numBuckets;
+    unsigned shardBits;
+    std::unique_ptr<Shard[]> shards;
+};
+
+} // namespace RTBKIT
@@ -11,6 +11,7 @@
 #include <boost/range/irange.hpp>
 #include "redis_augmentor.h"
 #include "jml/utils/exc_assert.h"
+#include "jml/utils/exc_check.h"
 using namespace std;
 
 namespace RTBKIT {
@@ -29,12 +30,25 @@ RedisAugmentor::
 */
 void
 RedisAugmentor::
-init(int nthreads)
+init(int nthreads, int numConnections, double batchWindow)
 {
+    ExcCheckGreater(numConnections, 0, "need at least one redis connection");
+    ExcCheck(numConnections == 1 || !address_.uri().empty(),
+             "can't open more redis connections without the redis address");
+
+    while (redis_.size() < size_t(numConnections))
+        redis_.push_back(std::make_shared<Redis::AsyncConnection>(address_));
+
+    batchWindow_ = batchWindow;
+
     AsyncAugmentor::init(nthreads);
     /* Manages all the communications with the AgentConfigurationService. */
     agent_config_.init(getServices()->config);
     addSource("RedisAugmentor::agentConfig", agent_config_);
+
+    if (batchWindow_ > 0.0)
+        addPeriodic("RedisAugmentor::flushBatch", batchWindow_,
+                    [=] (uint64_t) { flushBatch(); });
 }
 
 
@@ -42,8 +56,6 @@ void
 RedisAugmentor::
 onRequest(const AugmentationRequest & request, SendResponseCB sendResponse)
 {
-    ML::Timer tm;
-
     recordHit("requests");
 
     // we build an *ordered* map indexed by Redis keys, pointing
@@ -99,37 +111,97 @@ onRequest(const AugmentationRequest & request, SendResponseCB sendResponse)
         return;
     }
 
-    auto doResponse = [=](const Redis::Results& results) {
-        ExcAssertEqual (results.size(), jobs.size());
-        AugmentationList auglret;
-        if (results)
+    PendingRequest pending;
+    pending.jobs = std::move(jobs);
+    pending.sendResponse = std::move(sendResponse);
+    pending.start = Date::now();
+
+    if (batchWindow_ <= 0.0) {
+        sendBatch({ std::move(pending) });
+        return;
+    }
+
+    /* Don't let a burst of requests build a batch larger than redis likes
+       to answer in one go. */
+    static const size_t MaxBatchKeys = 512;
+    std::vector<PendingRequest> full;
+    {
+        std::lock_guard<ML::Spinlock> guard(batchLock_);
+        batchKeys_ += pending.jobs.size();
+        batch_.push_back(std::move(pending));
+        if (batchKeys_ >= MaxBatchKeys) {
+            full.swap(batch_);
+            batchKeys_ = 0;
+        }
+    }
+
+    if (!full.empty())
+        sendBatch(std::move(full));
+}
+
+void
+RedisAugmentor::
+flushBatch()
+{
+    std::vector<PendingRequest> batch;
+    {
+        std::lock_guard<ML::Spinlock> guard(batchLock_);
+        batch.swap(batch_);
+        batchKeys_ = 0;
+    }
+
+    if (!batch.empty())
+        sendBatch(std::move(batch));
+}
+
+void
+RedisAugmentor::
+sendBatch(std::vector<PendingRequest> && batch)
+{
+    // The same keys come up in most of the requests in the batch so each of
+    // them is only asked for once.
+    map<string, int> keyIndex;
+    Redis::Command mget = Redis::MGET;
+    for (const auto& request: batch)
+        for (const auto& job: request.jobs)
+            if (keyIndex.insert(make_pair(job.first, keyIndex.size())).second)
+                mget.addArg(job.first);
+
+    recordOutcome(batch.size(), "batchRequests");
+    recordOutcome(keyIndex.size(), "batchKeys");
+
+    auto pending = std::make_shared<std::vector<PendingRequest> >(std::move(batch));
+
+    auto doResponse = [=](const Redis::Result& result) {
+        Date now = Date::now();
+
+        if (!result)
         {
-            auto i=0;
-            for (const auto& ii: jobs)
-            {
-                const auto& res = results.at(i).reply().asString();
-                if (!res.empty())
-                    for (const auto& jj: ii.second)
-                        auglret[jj].data.atStr(ii.first) = res;
-                ++i;
-            }
+            cerr << "RedisAugmentor::sendBatch::lambda(doResponse) error: " << result.error() << endl ;
+            recordHit("redisError."+result.error());
         }
-        else
+
+        for (const auto& request: *pending)
         {
-            cerr << "RedisAugmentor::onRequest::lambda(doResponse) error: " << results.error() << endl ;
-            recordHit("redisError."+results.error());
+            AugmentationList auglret;
+            if (result)
+            {
+                const auto& reply = result.reply();
+                for (const auto& job: request.jobs)
+                {
+                    const auto& res = reply[keyIndex.at(job.first)].asString();
+                    if (!res.empty())
+                        for (const auto& account: job.second)
+                            auglret[account].data.atStr(job.first) = res;
+                }
+            }
+            recordOutcome(now.secondsSince(request.start) * 1000.0, "redisResponseMs");
+            request.sendResponse(auglret);
         }
-        recordOutcome(tm.elapsed_wall() * 1000.0, "redisResponseMs");
-        sendResponse(auglret);
     };
 
-    // build a vector of commands
-    vector<Redis::Command> cmds;
-    for (auto& ii: jobs)
-        cmds.emplace_back (Redis::GET(ii.first));
-
-    // and post it
-    redis_->queueMulti(cmds, doResponse, 0.004);
-
+    auto& redis = redis_[nextConnection_.fetch_add(1) % redis_.size()];
+    redis->queue(mget, doResponse, 0.004 + batchWindow_);
 }
+
 } /* namespace RTBKIT */
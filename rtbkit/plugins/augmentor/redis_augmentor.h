@@ -9,8 +9,10 @@
 #define REDIS_AUGMENTOR_H_
 
 #include <string>
+#include <atomic>
 #include "augmentor_base.h"
 #include "soa/service/redis.h"
+#include "jml/arch/spinlock.h"
 #include "rtbkit/core/agent_configuration/agent_configuration_listener.h"
 
 namespace RTBKIT {
@@ -26,7 +28,9 @@ public:
                    const Redis::Address& redis)
         : RTBKIT::AsyncAugmentor(augmentorName,serviceName,proxies)
         , agent_config_ (proxies->zmqContext)
-        , redis_(std::make_shared<Redis::AsyncConnection>(redis))
+        , address_(redis)
+        , redis_ {std::make_shared<Redis::AsyncConnection>(redis)}
+        , nextConnection_(0), batchWindow_(0.0), batchKeys_(0)
     {
     }
 
@@ -36,7 +40,8 @@ public:
                    std::shared_ptr<Redis::AsyncConnection> redis)
         : RTBKIT::AsyncAugmentor(augmentorName,serviceName,proxies)
         , agent_config_ (proxies->zmqContext)
-        , redis_(redis)
+        , redis_ {redis}
+        , nextConnection_(0), batchWindow_(0.0), batchKeys_(0)
     {
     }
 
@@ -46,7 +51,9 @@ public:
                    const Redis::Address& redis)
         : RTBKIT::AsyncAugmentor(augmentorName,serviceName,parent)
         , agent_config_ (parent.getZmqContext())
-        , redis_(std::make_shared<Redis::AsyncConnection>(redis))
+        , address_(redis)
+        , redis_ {std::make_shared<Redis::AsyncConnection>(redis)}
+        , nextConnection_(0), batchWindow_(0.0), batchKeys_(0)
     {
     }
 
@@ -56,16 +63,48 @@ public:
                    std::shared_ptr<Redis::AsyncConnection> redis)
         : RTBKIT::AsyncAugmentor(augmentorName,serviceName,parent)
         , agent_config_ (parent.getZmqContext())
-        , redis_ (redis)
+        , redis_ {redis}
+        , nextConnection_(0), batchWindow_(0.0), batchKeys_(0)
     {
     }
 
-    void init(int nthreads);
+    /** Requests arriving within batchWindow seconds of each other are looked
+        up together with a single MGET, and the batches are spread round
+        robin over numConnections connections to redis.  A window of 0 sends
+        every request on its own as soon as it arrives.  Additional
+        connections can only be opened if the augmentor was given the
+        address of redis.
+    */
+    void init(int nthreads, int numConnections = 1, double batchWindow = 0.0005);
     virtual ~RedisAugmentor() ;
 private:
     void onRequest(const AugmentationRequest & request, SendResponseCB sendResponse);
+
+    /** Request waiting for the next batch: the redis keys to look up, each
+        with the accounts it is for.
+    */
+    struct PendingRequest {
+        std::map<std::string, std::set<RTBKIT::AccountKey> > jobs;
+        SendResponseCB sendResponse;
+        Date start;
+    };
+
+    /** Sends the pending requests to redis and answers each of them once the
+        lookup is done.  Thread safe.
+    */
+    void flushBatch();
+
+    void sendBatch(std::vector<PendingRequest> && batch);
+
     RTBKIT::AgentConfigurationListener agent_config_;
-    std::shared_ptr<Redis::AsyncConnection> redis_ ;
+    Redis::Address address_;
+    std::vector<std::shared_ptr<Redis::AsyncConnection> > redis_ ;
+    std::atomic<unsigned> nextConnection_;
+    double batchWindow_;
+
+    ML::Spinlock batchLock_;
+    std::vector<PendingRequest> batch_;
+    size_t batchKeys_;
 };
 
 } /* namespace RTBKIT */
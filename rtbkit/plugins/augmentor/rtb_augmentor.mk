@@ -6,5 +6,5 @@
 # RTBKit augmentor base makefile
 #------------------------------------------------------------------------------#
 
-$(eval $(call library,augmentor_base,augmentor_base.cc redis_augmentor.cc,zmq rtb bid_request services redis agent_configuration))
+$(eval $(call library,augmentor_base,augmentor_base.cc redis_augmentor.cc frequency_counters.cc frequency_cap_augmentor.cc,zmq rtb bid_request services redis agent_configuration))
 $(eval $(call include_sub_make,augmentor_testing,testing,augmentor_testing.mk))
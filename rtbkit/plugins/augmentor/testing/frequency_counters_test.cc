@@ -0,0 +1,122 @@
+/** frequency_counters_test.cc                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the in memory frequency counters.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/augmentor/frequency_counters.h"
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+BOOST_AUTO_TEST_CASE( test_counts )
+{
+    FrequencyCounters counters(3600, 4, 4);
+    Date now = Date::fromSecondsSinceEpoch(1400000000);
+
+    uint64_t campaign = FrequencyCounters::campaignKey("campaign");
+    uint64_t other = FrequencyCounters::campaignKey("other");
+
+    BOOST_CHECK_EQUAL(counters.get(1, campaign, now), 0);
+
+    counters.add(1, campaign, now);
+    counters.add(1, campaign, now, 2);
+    counters.add(1, other, now);
+    counters.add(2, campaign, now);
+
+    BOOST_CHECK_EQUAL(counters.get(1, campaign, now), 3);
+    BOOST_CHECK_EQUAL(counters.get(1, other, now), 1);
+    BOOST_CHECK_EQUAL(counters.get(2, campaign, now), 1);
+    BOOST_CHECK_EQUAL(counters.get(2, other, now), 0);
+    BOOST_CHECK_EQUAL(counters.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE( test_window )
+{
+    // 4 buckets of 15 minutes.
+    FrequencyCounters counters(3600, 4, 1);
+    Date start = Date::fromSecondsSinceEpoch(1400000000 / 900 * 900);
+
+    for (int i = 0; i < 4; ++i)
+        counters.add(1, 1, start.plusSeconds(i * 900));
+    BOOST_CHECK_EQUAL(counters.get(1, 1, start.plusSeconds(3 * 900)), 4);
+
+    // Each bucket is forgotten as a whole once it leaves the window.
+    BOOST_CHECK_EQUAL(counters.get(1, 1, start.plusSeconds(4 * 900)), 3);
+    BOOST_CHECK_EQUAL(counters.get(1, 1, start.plusSeconds(5 * 900 + 899)), 2);
+    BOOST_CHECK_EQUAL(counters.get(1, 1, start.plusSeconds(7 * 900)), 0);
+
+    // Events far apart only ever see the latest one.
+    counters.add(1, 1, start.plusSeconds(10 * 900));
+    BOOST_CHECK_EQUAL(counters.get(1, 1, start.plusSeconds(10 * 900)), 1);
+
+    // Late events are counted in their own bucket while it's in the window.
+    counters.add(1, 1, start.plusSeconds(8 * 900));
+    counters.add(1, 1, start.plusSeconds(5 * 900));
+    BOOST_CHECK_EQUAL(counters.get(1, 1, start.plusSeconds(10 * 900)), 2);
+    BOOST_CHECK_EQUAL(counters.get(1, 1, start.plusSeconds(12 * 900)), 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_expire )
+{
+    FrequencyCounters counters(3600, 4, 4);
+    Date now = Date::fromSecondsSinceEpoch(1400000000);
+
+    // Enough users to grow the tables a few times.
+    for (uint64_t user = 1; user <= 100000; ++user)
+        counters.add(user, 1, user % 2 ? now : now.plusSeconds(1800));
+    BOOST_CHECK_EQUAL(counters.size(), 100000);
+
+    size_t before = counters.memUsage();
+    BOOST_CHECK_EQUAL(counters.expire(now.plusSeconds(1800)), 0);
+    BOOST_CHECK_EQUAL(counters.expire(now.plusSeconds(3600)), 50000);
+    BOOST_CHECK_EQUAL(counters.size(), 50000);
+    BOOST_CHECK_LT(counters.memUsage(), before);
+
+    for (uint64_t user = 1; user <= 100000; ++user) {
+        unsigned expected = user % 2 ? 0 : 1;
+        BOOST_REQUIRE_EQUAL(
+                counters.get(user, 1, now.plusSeconds(3600)), expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_saturation )
+{
+    FrequencyCounters counters(3600, 1, 1);
+    Date now = Date::fromSecondsSinceEpoch(1400000000);
+
+    counters.add(1, 1, now, 70000);
+    BOOST_CHECK_EQUAL(counters.get(1, 1, now), 65535);
+}
+
+BOOST_AUTO_TEST_CASE( test_threads )
+{
+    enum { Threads = 4, Users = 1000, Wins = 10 };
+
+    FrequencyCounters counters(3600, 4, 8);
+    Date now = Date::fromSecondsSinceEpoch(1400000000);
+
+    vector<thread> threads;
+    for (int i = 0; i < Threads; ++i) {
+        threads.emplace_back([&] {
+                    for (int win = 0; win < Wins; ++win)
+                        for (uint64_t user = 1; user <= Users; ++user)
+                            counters.add(user, 1, now);
+                });
+    }
+    for (auto& th : threads) th.join();
+
+    for (uint64_t user = 1; user <= Users; ++user)
+        BOOST_REQUIRE_EQUAL(counters.get(user, 1, now), Threads * Wins);
+}
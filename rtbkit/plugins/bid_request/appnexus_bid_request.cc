@@ -41,6 +41,22 @@ convertAdPosition(AppNexus::AdPosition pos)
 
     return ret;
 }
+
+int
+currentYear()
+{
+    static struct current_year_st_ {
+    	current_year_st_ () {
+    		using namespace std;
+    		using namespace std::chrono;
+    		auto tt = system_clock::to_time_t(system_clock::now());
+    		auto utc_tm = *gmtime(&tt);
+    		val_ = utc_tm.tm_year + 1900;
+    	}
+    	int val_;
+    } current_year ;
+    return current_year.val_;
+}
 }  // anonym
 
 namespace RTBKIT {
@@ -66,17 +82,7 @@ fromAppNexus(const AppNexus::BidRequest & req_b,
     rv->user.reset(new OpenRTB::User);
     rv->user->id = Id(req.bidInfo.userId64.val);
     rv->user->gender = req.bidInfo.gender;
-    static struct current_year_st_ {
-    	current_year_st_ () {
-    		using namespace std;
-    		using namespace std::chrono;
-    		auto tt = system_clock::to_time_t(system_clock::now());
-    		auto utc_tm = *gmtime(&tt);
-    		val_ = utc_tm.tm_year + 1900;
-    	}
-    	int val_;
-    } current_year ;
-    rv->user->yob.val = current_year.val_ - (req.bidInfo.age.val<=0?0:req.bidInfo.age.val);
+    rv->user->yob.val = currentYear() - (req.bidInfo.age.val<=0?0:req.bidInfo.age.val);
     rv->device.reset (new OpenRTB::Device);
     rv->device->geo.reset(new OpenRTB::Geo);
     rv->device->ua = req.bidInfo.userAgent.utf8String();
@@ -197,16 +203,310 @@ fromAppNexus(const AppNexus::BidRequest & req_b,
     return rv;
 }
 
-shared_ptr<BidRequest>
-AppNexusBidRequestParser::
-parseBidRequest(const std::string & jsonValue,
-                const std::string & provider,
-                const std::string & exchange)
+/*****************************************************************************/
+/* DIRECT APPNEXUS PARSER                                                    */
+/*****************************************************************************/
+
+namespace {
+
+/** Parses a field with the same value description as the AppNexus
+    structures, so that both paths accept the same values.
+*/
+template<typename T>
+void expectField(JsonParsingContext & context, T & val)
+{
+    static const DefaultDescription<T> desc;
+    desc.parseJsonTyped(&val, context);
+}
+
+/** Parses an AppNexus bid request straight into an RTBKIT::BidRequest, in
+    a single pass over the JSON and without the AppNexus::BidRequest that
+    fromAppNexus() converts from.  The fields that fromAppNexus() doesn't
+    use are skipped without being parsed.
+
+    The result is the same as with fromAppNexus(): the fields are converted
+    the same way once the whole request is read, and the request is
+    rejected if its top level or its bid_request object has a field that
+    isn't in the AppNexus spec.
+*/
+struct DirectAppNexusParser {
+
+    DirectAppNexusParser()
+        : rv(new BidRequest), numTags(0)
+    {
+        rv->user.reset(new OpenRTB::User);
+        rv->device.reset(new OpenRTB::Device);
+        rv->device->geo.reset(new OpenRTB::Geo);
+        rv->imp.emplace_back(AdSpot());
+        rv->imp[0].banner.reset(new OpenRTB::Banner);
+    }
+
+    std::shared_ptr<BidRequest> rv;
+    Json::Value unparseable;
+
+    // Values that are converted once the whole request is read
+    std::string timestamp;
+    TaggedInt bidderTimeoutMs;
+    TaggedBoolDef<false> test;
+    std::vector<int> members;
+    std::vector<int> excludedAttributes;
+
+    TaggedInt64 userId64;
+    TaggedIntDef<0> operatingSystem;
+    std::string acceptedLanguages;
+    TaggedBoolDef<true> noFlash;
+    TaggedInt age;
+    UnicodeString country;
+    UnicodeString region;
+    std::string postalCode;
+    TaggedInt dma;
+    UnicodeString url;
+    TaggedInt publisherId;
+    std::string appId;
+    std::string loc;
+    TaggedInt carrier;
+    TaggedInt make;
+    TaggedInt model;
+
+    int numTags;
+    TaggedInt64 auctionId64;
+    Id inventorySourceId;
+    std::vector<std::string> sizes;
+    AppNexus::AdPosition position;
+    TaggedFloatDef<0> reservePrice;
+
+    void parse(JsonParsingContext & context)
+    {
+        context.forEachMember([&] () {
+                if (!strcmp(context.fieldNamePtr(), "bid_request"))
+                    parseBidRequestMsg(context);
+                else unparseable[context.fieldName()] = context.expectJson();
+            });
+    }
+
+    void parseBidRequestMsg(JsonParsingContext & context)
+    {
+        context.forEachMember([&] () {
+                const char * name = context.fieldNamePtr();
+
+                if (!strcmp(name, "timestamp"))
+                    expectField(context, timestamp);
+                else if (!strcmp(name, "bidder_timeout_ms"))
+                    expectField(context, bidderTimeoutMs);
+                else if (!strcmp(name, "bid_info"))
+                    parseBidInfo(context);
+                else if (!strcmp(name, "members"))
+                    context.forEachElement([&] () {
+                            Id id;
+                            context.forEachMember([&] () {
+                                    if (!strcmp(context.fieldNamePtr(), "id"))
+                                        expectField(context, id);
+                                    else context.skip();
+                                });
+                            members.push_back(id.toInt());
+                        });
+                else if (!strcmp(name, "tags"))
+                    context.forEachElement([&] () {
+                            if (numTags++ == 0) parseTag(context);
+                            else context.skip();
+                        });
+                else if (!strcmp(name, "test"))
+                    expectField(context, test);
+                else if (!strcmp(name, "excluded_attributes"))
+                    context.forEachElement([&] () {
+                            TaggedInt attribute;
+                            expectField(context, attribute);
+                            excludedAttributes.push_back(attribute.val);
+                        });
+                else if (!strcmp(name, "member_ad_profile_id")
+                         || !strcmp(name, "allow_exclusive")
+                         || !strcmp(name, "debug_requested")
+                         || !strcmp(name, "debug_member_id")
+                         || !strcmp(name, "single_phase"))
+                    context.skip();
+                else unparseable[context.fieldName()] = context.expectJson();
+            });
+    }
+
+    void parseBidInfo(JsonParsingContext & context)
+    {
+        OpenRTB::Device & device = *rv->device;
+        OpenRTB::Geo & geo = *device.geo;
+
+        context.forEachMember([&] () {
+                const char * name = context.fieldNamePtr();
+
+                if (!strcmp(name, "user_id_64"))
+                    expectField(context, userId64);
+                else if (!strcmp(name, "user_agent"))
+                    expectField(context, device.ua);
+                else if (!strcmp(name, "operating_system"))
+                    expectField(context, operatingSystem);
+                else if (!strcmp(name, "accepted_languages"))
+                    expectField(context, acceptedLanguages);
+                else if (!strcmp(name, "no_flash"))
+                    expectField(context, noFlash);
+                else if (!strcmp(name, "gender"))
+                    expectField(context, rv->user->gender);
+                else if (!strcmp(name, "age"))
+                    expectField(context, age);
+                else if (!strcmp(name, "ip_address"))
+                    expectField(context, device.ip);
+                else if (!strcmp(name, "country"))
+                    expectField(context, country);
+                else if (!strcmp(name, "region"))
+                    expectField(context, region);
+                else if (!strcmp(name, "city"))
+                    expectField(context, geo.city);
+                else if (!strcmp(name, "postal_code"))
+                    expectField(context, postalCode);
+                else if (!strcmp(name, "dma"))
+                    expectField(context, dma);
+                else if (!strcmp(name, "url"))
+                    expectField(context, url);
+                else if (!strcmp(name, "publisher_id"))
+                    expectField(context, publisherId);
+                else if (!strcmp(name, "app_id"))
+                    expectField(context, appId);
+                else if (!strcmp(name, "loc"))
+                    expectField(context, loc);
+                else if (!strcmp(name, "carrier"))
+                    expectField(context, carrier);
+                else if (!strcmp(name, "make"))
+                    expectField(context, make);
+                else if (!strcmp(name, "model"))
+                    expectField(context, model);
+                else context.skip();
+            });
+    }
+
+    void parseTag(JsonParsingContext & context)
+    {
+        context.forEachMember([&] () {
+                const char * name = context.fieldNamePtr();
+
+                if (!strcmp(name, "auction_id_64"))
+                    expectField(context, auctionId64);
+                else if (!strcmp(name, "inventory_source_id"))
+                    expectField(context, inventorySourceId);
+                else if (!strcmp(name, "sizes"))
+                    expectField(context, sizes);
+                else if (!strcmp(name, "position"))
+                    expectField(context, position);
+                else if (!strcmp(name, "reserve_price"))
+                    expectField(context, reservePrice);
+                else context.skip();
+            });
+    }
+
+    /** Same conversions as fromAppNexus(). */
+    std::shared_ptr<BidRequest>
+    finish(const std::string & provider, const std::string & exchange)
+    {
+        rv->timestamp = Date::parse(timestamp.c_str(), "%Y-%m-%d %H:%M:%S");
+
+        ExcAssertEqual(numTags, 1);
+
+        rv->user->id = Id(userId64.val);
+        rv->user->yob.val = currentYear() - (age.val <= 0 ? 0 : age.val);
+
+        OpenRTB::Device & device = *rv->device;
+        device.os = AppNexus::deviceOs.at(operatingSystem.val);
+        device.osv = "N/A";
+        device.language = acceptedLanguages;
+        device.flashver = noFlash.val == -1 ? "Flash not available"
+            : "Flash available - version unknown";
+        device.carrier = to_string(carrier.val);
+        device.make = to_string(make.val);
+        device.model = to_string(model.val);
+
+        OpenRTB::Geo & geo = *device.geo;
+        geo.country = country.rawString();
+        geo.region = region.rawString();
+        geo.zip = postalCode;
+        geo.dma = to_string(dma.val);
+
+        auto ix = loc.find(',');
+        if (string::npos != ix) {
+            geo.lat.val = boost::lexical_cast<float>(loc.substr(0, ix));
+            geo.lon.val = boost::lexical_cast<float>(loc.substr(ix + 1));
+        }
+
+        if (!url.empty())
+            rv->url = Url(url);
+
+        AdSpot & impression = rv->imp[0];
+        impression.bidfloor.val = reservePrice.val;
+        impression.id = Id(auctionId64.val);
+
+        for (const string & s : sizes) {
+            ix = s.find('x');
+            if (string::npos != ix) {
+                impression.banner->w.push_back(
+                        boost::lexical_cast<int>(s.substr(0, ix)));
+                impression.banner->h.push_back(
+                        boost::lexical_cast<int>(s.substr(ix + 1)));
+            }
+        }
+
+        impression.banner->pos.val = convertAdPosition(position).val;
+
+        rv->site.reset(new OpenRTB::Site);
+        rv->site->publisher.reset(new OpenRTB::Publisher);
+        rv->site->id = inventorySourceId;
+
+        rv->app.reset(new OpenRTB::App);
+        rv->app->publisher.reset(new OpenRTB::Publisher);
+
+        if (appId.empty())
+            rv->site->publisher->id = Id(publisherId.val);
+        else rv->app->publisher->id = Id(publisherId.val);
+        rv->app->id = Id(appId);
+
+        rv->auctionId = Id(auctionId64.val);
+        rv->auctionType = AuctionType::SECOND_PRICE;
+        rv->timeAvailableMs = bidderTimeoutMs.val;
+        rv->isTest = test.val ? true : false;
+        rv->provider = provider;
+        rv->exchange = (exchange.empty() ? provider : exchange);
+
+        if (!members.empty())
+            rv->restrictions.addInts("members", members);
+        if (!excludedAttributes.empty())
+            rv->restrictions.addInts("excluded_attributes",
+                                     excludedAttributes);
+
+        return rv;
+    }
+};
+
+std::shared_ptr<BidRequest>
+parseDirect(JsonParsingContext & context,
+            const std::string & provider,
+            const std::string & exchange)
+{
+    DirectAppNexusParser parser;
+    parser.parse(context);
+
+    if (!parser.unparseable.isNull()) {
+        cerr << "\n\n\n/*** WARNING!!! coudln't parse the following element: "
+             << parser.unparseable.toString()
+             << " INPUT IGNORED!!! ***/\n\n\n";
+        return shared_ptr<BidRequest>();
+    }
+
+    return parser.finish(provider, exchange);
+}
+
+/** The former path, through the AppNexus structures. */
+std::shared_ptr<BidRequest>
+parseIntermediate(JsonParsingContext & context,
+                  AppNexus::BidRequest & req,
+                  const std::string & provider,
+                  const std::string & exchange)
 {
-    StructuredJsonParsingContext jsonContext(jsonValue);
-    AppNexus::BidRequest req;
     Datacratic::DefaultDescription<AppNexus::BidRequest> desc;
-    desc.parseJson(&req, jsonContext);
+    desc.parseJson(&req, context);
     if (!(req.unparseable.isNull() && req.bidRequest.unparseable.isNull()))
     {
         auto str = req.unparseable.isNull() ?
@@ -220,6 +520,25 @@ parseBidRequest(const std::string & jsonValue,
     return fromAppNexus(req, provider, exchange);
 }
 
+} // file scope
+
+
+/*****************************************************************************/
+/* APPNEXUS BID REQUEST PARSER                                                */
+/*****************************************************************************/
+
+shared_ptr<BidRequest>
+AppNexusBidRequestParser::
+parseBidRequest(const std::string & jsonValue,
+                const std::string & provider,
+                const std::string & exchange)
+{
+    const char * strStart = jsonValue.c_str();
+    StreamingJsonParsingContext jsonContext(jsonValue, strStart,
+                                            strStart + jsonValue.size());
+    return parseDirect(jsonContext, provider, exchange);
+}
+
 shared_ptr<BidRequest>
 AppNexusBidRequestParser::
 parseBidRequest(ML::Parse_Context & context,
@@ -227,20 +546,31 @@ parseBidRequest(ML::Parse_Context & context,
                 const std::string & exchange)
 {
     StreamingJsonParsingContext jsonContext(context);
-    AppNexus::BidRequest req;
-    Datacratic::DefaultDescription<AppNexus::BidRequest> desc;
-    desc.parseJson(&req, jsonContext);
-    if (!(req.unparseable.isNull() && req.bidRequest.unparseable.isNull()))
-    {
-        auto str = req.unparseable.isNull() ?
-                   req.bidRequest.unparseable.toString() :
-                   req.unparseable.toString();
-        cerr << "\n\n\n/*** WARNING!!! coudln't parse the following element: "
-             << str
-             << " INPUT IGNORED!!! ***/\n\n\n";
-        return shared_ptr<BidRequest>();
-    }
-    return fromAppNexus(req, provider, exchange);
+    return parseDirect(jsonContext, provider, exchange);
+}
+
+shared_ptr<BidRequest>
+AppNexusBidRequestParser::
+parseBidRequest(const std::string & jsonValue,
+                AppNexus::BidRequest & intermediate,
+                const std::string & provider,
+                const std::string & exchange)
+{
+    const char * strStart = jsonValue.c_str();
+    StreamingJsonParsingContext jsonContext(jsonValue, strStart,
+                                            strStart + jsonValue.size());
+    return parseIntermediate(jsonContext, intermediate, provider, exchange);
+}
+
+shared_ptr<BidRequest>
+AppNexusBidRequestParser::
+parseBidRequest(ML::Parse_Context & context,
+                AppNexus::BidRequest & intermediate,
+                const std::string & provider,
+                const std::string & exchange)
+{
+    StreamingJsonParsingContext jsonContext(context);
+    return parseIntermediate(jsonContext, intermediate, provider, exchange);
 }
 
 } // namespace RTBKIT
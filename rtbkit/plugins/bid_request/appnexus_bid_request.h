@@ -24,6 +24,15 @@ fromAppNexus(const AppNexus::BidRequest & req,
 /*****************************************************************************/
 
 /** Parser for the AppNexus bid request format.
+
+    The request is parsed straight into the BidRequest in a single pass,
+    skipping the fields that aren't used.  The overloads that take an
+    AppNexus::BidRequest also fill it in, by parsing into it first and
+    converting it with fromAppNexus(); they're slower and only meant for
+    when the AppNexus fields themselves are needed.
+
+    Both return a null pointer if the request has fields that aren't part
+    of the AppNexus spec.
  */
 
 struct AppNexusBidRequestParser {
@@ -37,6 +46,18 @@ struct AppNexusBidRequestParser {
     parseBidRequest(ML::Parse_Context & context,
                     const std::string & provider,
                     const std::string & exchange = "");
+
+    static std::shared_ptr<BidRequest>
+    parseBidRequest(const std::string & jsonValue,
+                    AppNexus::BidRequest & intermediate,
+                    const std::string & provider,
+                    const std::string & exchange = "");
+
+    static std::shared_ptr<BidRequest>
+    parseBidRequest(ML::Parse_Context & context,
+                    AppNexus::BidRequest & intermediate,
+                    const std::string & provider,
+                    const std::string & exchange = "");
 };
 
 
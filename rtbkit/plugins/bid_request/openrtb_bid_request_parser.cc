@@ -139,24 +139,31 @@ RTBKIT::BidRequest *
 OpenRTBBidRequestParser::
 createBidRequestHelper(OpenRTB::BidRequest & br,
                        const std::string & provider,
-                       const std::string & exchange) {
+                       const std::string & exchange,
+                       RTBKIT::BidRequest * result) {
 
-    // Create context
-    ctx.br = std::unique_ptr<BidRequest>(new BidRequest());
-    
-    ctx.br->timestamp = Date::now();
-    ctx.br->isTest = false;
-    // Assign provider and exchange if available
-    ctx.br->provider = provider;
-    ctx.br->exchange = (exchange.empty() ? provider : exchange);
+    // Create context; a request given by the caller stays theirs
+    ctx.br = std::unique_ptr<BidRequest>(result ? result : new BidRequest());
+
+    try {
+        ctx.br->timestamp = Date::now();
+        ctx.br->isTest = false;
+        // Assign provider and exchange if available
+        ctx.br->provider = provider;
+        ctx.br->exchange = (exchange.empty() ? provider : exchange);
 
-    this->onBidRequest(br);
+        this->onBidRequest(br);
 
-    // Transfer app, site, device, user to br
-    ctx.br->app.reset(br.app.release());
-    ctx.br->site.reset(br.site.release());
-    ctx.br->device.reset(br.device.release());
-    ctx.br->user.reset(br.user.release());
+        // Transfer app, site, device, user to br
+        ctx.br->app.reset(br.app.release());
+        ctx.br->site.reset(br.site.release());
+        ctx.br->device.reset(br.device.release());
+        ctx.br->user.reset(br.user.release());
+    } catch (...) {
+        if (result)
+            ctx.br.release();
+        throw;
+    }
 
     // Release control upon exit
     return ctx.br.release();
@@ -176,6 +183,20 @@ parseBidRequest(ML::Parse_Context & context,
                                   exchange);
 }
 
+void
+OpenRTBBidRequestParser::
+parseBidRequest(ML::Parse_Context & context,
+                const std::string & provider,
+                const std::string & exchange,
+                RTBKIT::BidRequest & result)
+{
+    auto br = parseBidRequest(context);
+    createBidRequestHelper(br,
+                           provider,
+                           exchange,
+                           &result);
+}
+
 RTBKIT::BidRequest *
 OpenRTBBidRequestParser::
 parseBidRequest(const std::string & json,
@@ -44,6 +44,14 @@ struct OpenRTBBidRequestParser
                                         const std::string & provider,
                                         const std::string & exchange);
 
+    /** Parse into the given request, which must be empty, instead of a
+        new one; used with pooled requests.
+    */
+    void parseBidRequest(ML::Parse_Context & context,
+                         const std::string & provider,
+                         const std::string & exchange,
+                         RTBKIT::BidRequest & result);
+
     static std::unique_ptr<OpenRTBBidRequestParser>
         openRTBBidRequestParserFactory(const std::string & version);
 
@@ -78,7 +86,8 @@ struct OpenRTBBidRequestParser
     private:
         RTBKIT::BidRequest * createBidRequestHelper(OpenRTB::BidRequest & br,
                                     const std::string & provider,
-                                    const std::string & exchange);
+                                    const std::string & exchange,
+                                    RTBKIT::BidRequest * result = nullptr);
 };
 
 struct OpenRTBBidRequestParser2point1 : OpenRTBBidRequestParser {
@@ -0,0 +1,265 @@
+/* openrtb_pre_parse.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Scanner of the keys of a raw OpenRTB bid request.
+*/
+
+#include "openrtb_pre_parse.h"
+#include "soa/types/id.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+namespace {
+
+/** Walks over JSON text a byte at a time, only copying out the values that
+    are asked for. */
+struct Scanner {
+
+    Scanner(const std::string& text)
+        : p(text.data()), end(text.data() + text.size())
+    { }
+
+    const char* p;
+    const char* end;
+
+    void skipSpaces()
+    {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+            ++p;
+    }
+
+    char peek()
+    {
+        skipSpaces();
+        return p < end ? *p : 0;
+    }
+
+    bool expect(char c)
+    {
+        if (peek() != c) return false;
+        ++p;
+        return true;
+    }
+
+    /** Reads a string into out, or skips it if out is null. */
+    bool string(std::string* out)
+    {
+        if (!expect('"')) return false;
+
+        const char* start = p;
+        for (; p < end; ++p) {
+            if (*p == '"') {
+                if (out) out->append(start, p);
+                ++p;
+                return true;
+            }
+            if (*p != '\\') continue;
+
+            if (out) out->append(start, p);
+            if (++p == end) return false;
+
+            char c;
+            switch (*p) {
+            case '"': case '\\': case '/': c = *p; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'u':
+                if (out || end - p < 5) return false;
+                p += 4;
+                c = 0;
+                break;
+            default:
+                return false;
+            }
+
+            if (out) out->push_back(c);
+            start = p + 1;
+        }
+
+        return false;
+    }
+
+    /** Reads a number, true, false or null into out. */
+    bool scalar(std::string* out)
+    {
+        skipSpaces();
+        const char* start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']'
+               && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+            ++p;
+
+        if (p == start) return false;
+        if (out) out->assign(start, p);
+        return true;
+    }
+
+    /** Skips over an object or an array by counting the brackets. */
+    bool skipNested()
+    {
+        int depth = 0;
+        while (p < end) {
+            switch (*p) {
+            case '"':
+                if (!string(nullptr)) return false;
+                continue;
+            case '{': case '[':
+                ++depth;
+                break;
+            case '}': case ']':
+                if (--depth == 0) {
+                    ++p;
+                    return true;
+                }
+                break;
+            }
+            ++p;
+        }
+        return false;
+    }
+
+    bool skipValue()
+    {
+        switch (peek()) {
+        case '"': return string(nullptr);
+        case '{': case '[': return skipNested();
+        default: return scalar(nullptr);
+        }
+    }
+
+    /** Reads a string or a scalar value into out; objects and arrays are
+        skipped. */
+    bool value(std::string* out)
+    {
+        switch (peek()) {
+        case '"': return string(out);
+        case '{': case '[': return skipNested();
+        case 'n':
+            // null leaves the value empty
+            return scalar(nullptr);
+        default: return scalar(out);
+        }
+    }
+
+    /** Calls onElement for each element of an array, which must consume
+        it. */
+    template<typename OnElement>
+    bool array(const OnElement& onElement)
+    {
+        if (!expect('[')) return false;
+        if (expect(']')) return true;
+
+        for (;;) {
+            if (!onElement()) return false;
+            if (expect(',')) continue;
+            return expect(']');
+        }
+    }
+
+    /** Calls onKey for each key of an object, which must consume the
+        value. */
+    template<typename OnKey>
+    bool object(const OnKey& onKey)
+    {
+        if (!expect('{')) return false;
+        if (expect('}')) return true;
+
+        std::string key;
+        for (;;) {
+            key.clear();
+            if (!string(&key) || !expect(':')) return false;
+            if (!onKey(key)) return false;
+            if (expect(',')) continue;
+            return expect('}');
+        }
+    }
+};
+
+} // file scope
+
+
+/*****************************************************************************/
+/* PRE PARSE KEYS                                                            */
+/*****************************************************************************/
+
+Url
+PreParseKeys::
+url() const
+{
+    // Same as OpenRTBBidRequestParser::onSite and onApp.
+    if (hasSite) {
+        if (!sitePage.empty()) return Url(sitePage);
+        if (!siteId.empty() && Id(siteId))
+            return Url("http://" + Id(siteId).toString() + ".siteid/");
+    }
+    else if (hasApp) {
+        if (!appBundle.empty()) return Url(appBundle);
+        if (!appId.empty() && Id(appId))
+            return Url("http://" + Id(appId).toString() + ".appid/");
+    }
+    return Url();
+}
+
+bool
+PreParseKeys::
+scan(const std::string& payload)
+{
+    Scanner scanner(payload);
+
+    auto onSiteKey = [&] (const std::string& key) {
+        if (key == "page") return scanner.value(&sitePage);
+        if (key == "id") return scanner.value(&siteId);
+        return scanner.skipValue();
+    };
+
+    auto onAppKey = [&] (const std::string& key) {
+        if (key == "bundle") return scanner.value(&appBundle);
+        if (key == "id") return scanner.value(&appId);
+        return scanner.skipValue();
+    };
+
+    auto onImpKey = [&] (const std::string& key) {
+        if (key != "bidfloor") return scanner.skipValue();
+
+        std::string value;
+        if (!scanner.value(&value)) return false;
+        if (value.empty()) return true;
+
+        char* end;
+        double floor = strtod(value.c_str(), &end);
+        if (end != value.c_str() + value.size()) return false;
+        bidFloor = std::max(bidFloor, floor);
+        return true;
+    };
+
+    auto onImp = [&] () {
+        if (scanner.peek() != '{') return scanner.skipValue();
+        return scanner.object(onImpKey);
+    };
+
+    auto onKey = [&] (const std::string& key) {
+        if (key == "imp" && scanner.peek() == '[')
+            return scanner.array(onImp);
+        if (key == "site" && scanner.peek() == '{') {
+            hasSite = true;
+            return scanner.object(onSiteKey);
+        }
+        if (key == "app" && scanner.peek() == '{') {
+            hasApp = true;
+            return scanner.object(onAppKey);
+        }
+        return scanner.skipValue();
+    };
+
+    // Which of the two the parser keeps depends on the order of the keys.
+    return scanner.object(onKey) && !(hasSite && hasApp);
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,43 @@
+/* openrtb_pre_parse.h                                             -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Keys scanned out of a raw OpenRTB bid request without parsing it.
+*/
+
+#pragma once
+
+#include "soa/types/url.h"
+#include <string>
+
+namespace RTBKIT {
+
+/** Keys scanned out of the raw payload of an OpenRTB bid request. */
+struct PreParseKeys {
+
+    PreParseKeys() : hasSite(false), hasApp(false), bidFloor(0.0) { }
+
+    bool hasSite;
+    std::string sitePage;
+    std::string siteId;
+
+    bool hasApp;
+    std::string appBundle;
+    std::string appId;
+
+    /** Highest bidfloor of the impressions, or 0 if none has one. */
+    double bidFloor;
+
+    /** Url of the request as the OpenRTB parser sets it from the site or the
+        app. */
+    Datacratic::Url url() const;
+
+    /** Scans the keys out of the top level of the JSON payload, skipping
+        over everything else without parsing it.  Returns false if the
+        payload isn't a JSON object or uses a construct that the scanner
+        doesn't handle, like unicode escapes in the scanned keys.
+    */
+    bool scan(const std::string& payload);
+};
+
+} // namespace RTBKIT
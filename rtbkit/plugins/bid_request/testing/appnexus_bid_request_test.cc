@@ -207,3 +207,64 @@ BOOST_AUTO_TEST_CASE( test_openrtb_from_appnexus )
     cerr << "\n\nWOOT\n\n" << endl;
 }
 
+
+BOOST_AUTO_TEST_CASE( test_direct_parsing_matches_conversion )
+{
+    string request = loadFile("rtbkit/plugins/bid_request/testing/appnexus_parent_bid_request.json");
+
+    auto direct = AppNexusBidRequestParser::parseBidRequest(request, "appnexus");
+    BOOST_REQUIRE(direct);
+
+    AppNexus::BidRequest intermediate;
+    auto converted = AppNexusBidRequestParser::parseBidRequest(
+            request, intermediate, "appnexus");
+    BOOST_REQUIRE(converted);
+    BOOST_CHECK_EQUAL(intermediate.bidRequest.bidInfo.segments.size(), 1);
+
+    BOOST_CHECK_EQUAL(direct->toJsonStr(), converted->toJsonStr());
+    BOOST_CHECK_EQUAL(direct->exchange, "appnexus");
+    BOOST_CHECK_EQUAL(direct->imp.size(), 1);
+    BOOST_CHECK_EQUAL(direct->device->geo->zip, Datacratic::UnicodeString("10014"));
+
+    // Fields that aren't in the spec are rejected by both.
+    string unknown = request;
+    unknown.insert(unknown.find("\"timestamp\""), "\"not_in_spec\": 1, ");
+    BOOST_CHECK(!AppNexusBidRequestParser::parseBidRequest(unknown, "appnexus"));
+    AppNexus::BidRequest rejected;
+    BOOST_CHECK(!AppNexusBidRequestParser::parseBidRequest(
+                        unknown, rejected, "appnexus"));
+}
+
+BOOST_AUTO_TEST_CASE( benchmark_appnexus_parsing )
+{
+    cerr << "benchmarking AppNexus parsing" << endl;
+
+    string request = loadFile("rtbkit/plugins/bid_request/testing/appnexus_parent_bid_request.json");
+
+    auto run = [&] (const string & name, bool direct) {
+        int done = 0;
+        Date before = Date::now();
+
+        for (unsigned i = 0;  i < 10000;  ++i, ++done) {
+            ML::Parse_Context context("Bid Request", request.c_str(),
+                                      request.size());
+            if (direct) {
+                auto br = AppNexusBidRequestParser::parseBidRequest(
+                        context, "appnexus");
+            }
+            else {
+                AppNexus::BidRequest intermediate;
+                auto br = AppNexusBidRequestParser::parseBidRequest(
+                        context, intermediate, "appnexus");
+            }
+        }
+
+        double elapsed = Date::now().secondsSince(before);
+
+        cerr << name << ": did " << done << " in " << elapsed << "s at "
+             << done / elapsed << "/s" << endl;
+    };
+
+    run("through AppNexus::BidRequest", false);
+    run("direct", true);
+}
@@ -310,6 +310,38 @@ BOOST_AUTO_TEST_CASE( test_openrtb_round_trip )
     }
 }
 
+BOOST_AUTO_TEST_CASE( test_openrtb_binary_round_trip )
+{
+    auto p = OpenRTBBidRequestParser::openRTBBidRequestParserFactory("2.1");
+
+    for (auto s: samples) {
+        ML::Parse_Context c(s);
+        std::unique_ptr<BidRequest> br(p->parseBidRequest(c, "test", "test"));
+
+        string bin = br->serializeToString();
+        std::unique_ptr<BidRequest> br2(
+                BidRequest::parse(BidRequest::BinaryFormat, bin));
+
+        BOOST_CHECK_EQUAL(br2->auctionId, br->auctionId);
+        BOOST_CHECK_EQUAL(br2->auctionType.val, br->auctionType.val);
+        BOOST_CHECK_EQUAL(br2->timestamp, br->timestamp);
+        BOOST_CHECK_EQUAL(br2->imp.size(), br->imp.size());
+        BOOST_CHECK_EQUAL(br2->userIds.toJsonStr(), br->userIds.toJsonStr());
+        BOOST_CHECK_EQUAL(br2->badv.size(), br->badv.size());
+        BOOST_CHECK_EQUAL(br2->blockedCategories.size(),
+                          br->blockedCategories.size());
+        BOOST_CHECK_EQUAL(br2->ext, br->ext);
+
+        BOOST_CHECK_EQUAL(bool(br2->site), bool(br->site));
+        BOOST_CHECK_EQUAL(bool(br2->app), bool(br->app));
+        BOOST_CHECK_EQUAL(bool(br2->device), bool(br->device));
+        BOOST_CHECK_EQUAL(bool(br2->user), bool(br->user));
+        if (br->device)
+            BOOST_CHECK_EQUAL(jsonEncodeStr(*br2->device),
+                              jsonEncodeStr(*br->device));
+    }
+}
+
 BOOST_AUTO_TEST_CASE( benchmark_openrtb_round_trip )
 {
     vector<string> reqs;
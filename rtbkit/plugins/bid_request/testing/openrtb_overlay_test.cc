@@ -0,0 +1,104 @@
+/* openrtb_overlay_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Test cases for the copy-on-write overlay over OpenRTB bid requests.
+*/
+
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/openrtb/openrtb_overlay.h"
+#include "rtbkit/openrtb/openrtb_parsing.h"
+#include "soa/types/json_parsing.h"
+#include "soa/types/json_printing.h"
+#include <sstream>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace {
+
+vector<string> samples = {
+    "rtbkit/plugins/bid_request/testing/openrtb1_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_banner.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_mobile.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_video.json",
+};
+
+std::shared_ptr<const OpenRTB::BidRequest> loadRequest(const string & filename)
+{
+    StreamingJsonParsingContext context;
+    context.init(filename);
+
+    auto result = std::make_shared<OpenRTB::BidRequest>();
+    DefaultDescription<OpenRTB::BidRequest> desc;
+    desc.parseJson(result.get(), context);
+    return result;
+}
+
+string print(const OpenRTB::BidRequest & request)
+{
+    std::ostringstream stream;
+    StreamJsonPrintingContext context(stream);
+    DefaultDescription<OpenRTB::BidRequest> desc;
+    desc.printJson(&request, context);
+    return stream.str();
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_overlay_unchanged )
+{
+    for (const string & sample: samples) {
+        auto base = loadRequest(sample);
+        OpenRTB::BidRequestOverlay overlay(base);
+        BOOST_CHECK_EQUAL(overlay.toJsonStr(), print(*base));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_overlay_changes )
+{
+    for (const string & sample: samples) {
+        auto base = loadRequest(sample);
+        string before = print(*base);
+
+        // The same changes as the http bidder interface makes
+        OpenRTB::BidRequestOverlay overlay(base);
+        for (size_t i = 0;  i < base->imp.size();  ++i) {
+            overlay.impExt(i)["external-ids"].append(1234);
+            overlay.impExt(i)["creative-ids"]["1234"].append(int(i));
+        }
+        overlay.ext()["exchange"] = "test";
+        overlay.setTmax(42);
+
+        BOOST_CHECK_EQUAL(overlay.ext()["exchange"].asString(), "test");
+        BOOST_CHECK_EQUAL(overlay.tmax().val, 42);
+
+        OpenRTB::BidRequest merged = overlay.merged();
+        BOOST_CHECK_EQUAL(merged.ext["exchange"].asString(), "test");
+        BOOST_CHECK_EQUAL(merged.tmax.val, 42);
+        BOOST_CHECK_EQUAL(overlay.toJsonStr(), print(merged));
+
+        // The base is left untouched for the other bidders
+        BOOST_CHECK_EQUAL(print(*base), before);
+        BOOST_CHECK(!base->ext.isMember("exchange"));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_overlay_partial )
+{
+    auto base = loadRequest(samples[0]);
+    BOOST_REQUIRE(!base->imp.empty());
+
+    // Only the first impression is changed, the others are printed as is
+    OpenRTB::BidRequestOverlay overlay(base);
+    overlay.impExt(0)["external-ids"].append(1);
+    BOOST_CHECK_EQUAL(overlay.toJsonStr(), print(overlay.merged()));
+    BOOST_CHECK(overlay.impExt(0).isMember("external-ids"));
+    BOOST_CHECK(!base->imp[0].ext.isMember("external-ids"));
+
+    BOOST_CHECK_THROW(overlay.impExt(base->imp.size()), std::exception);
+}
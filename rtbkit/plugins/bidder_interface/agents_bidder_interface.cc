@@ -24,23 +24,110 @@ void AgentsBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const &
                                                double timeLeftMs,
                                                std::map<std::string, BidInfo> const & bidders) {
 
+    // The request frame is built once per format and shared by all the
+    // messages; only the per agent frames are encoded on each send.
+    zmq::message_t request, binaryRequest;
+    bool hasRequest = false, hasBinaryRequest = false;
+
+    auto getRequest = [&] (bool binary) -> const zmq::message_t & {
+        if (binary) {
+            if (!hasBinaryRequest) {
+                binaryRequest = sharedMessage(std::shared_ptr<const std::string>(
+                                auction, &auction->serializedRequest()));
+                hasBinaryRequest = true;
+            }
+            return binaryRequest;
+        }
+
+        if (!hasRequest) {
+            // The frame points straight into the auction, which it keeps
+            // alive until the last copy is sent.
+            request = sharedMessage(std::shared_ptr<const std::string>(
+                            auction, &auction->requestStr));
+            hasRequest = true;
+        }
+        return request;
+    };
+
+    // Agents with a broadcast slot, by slot, for each request format
+    std::map<int, std::vector<std::string> > slotted[2];
+
     for(auto & item : bidders) {
         auto & agent = item.first;
         auto & spots = item.second.imp;
-        auto & info = router->agents[agent];
-        WinCostModel wcm = auction->exchangeConnector->getWinCostModel(*auction, *info.config);
+        // Use the config that was active when the auction started; this
+        // can be called from an auction shard so the router's agent map
+        // must not be touched.
+        auto & config = *item.second.agentConfig;
+        WinCostModel wcm = auction->exchangeConnector->getWinCostModel(*auction, config);
+
+        bool binary = config.bidRequestFormat == BRQF_BINARY;
+
+        int slot = bridge->broadcastSlot(agent);
+        if (slot != -1) {
+            slotted[binary][slot] = {
+                agent,
+                spots.toJsonStr(),
+                auction->agentAugmentations[agent],
+                chomp(wcm.toJson().toString())
+            };
+            continue;
+        }
 
         bridge->sendAgentMessage(agent,
                                  "AUCTION",
                                  auction->start,
                                  auction->id,
-                                 info.getBidRequestEncoding(*auction),
-                                 info.encodeBidRequest(*auction),
+                                 binary ? BidRequest::BinaryFormat : auction->requestStrFormat,
+                                 getRequest(binary),
                                  spots.toJsonStr(),
                                  std::to_string(timeLeftMs),
                                  auction->agentAugmentations[agent],
                                  wcm.toJson());
     }
+
+    for (bool binary: { false, true }) {
+        auto & slots = slotted[binary];
+        if (slots.empty())
+            continue;
+
+        if ((int)slots.size() < bridge->broadcastMinAgents) {
+            for (auto & entry: slots) {
+                auto & frames = entry.second;
+                bridge->sendAgentMessage(frames[0],
+                                         "AUCTION",
+                                         auction->start,
+                                         auction->id,
+                                         binary ? BidRequest::BinaryFormat : auction->requestStrFormat,
+                                         getRequest(binary),
+                                         frames[1],
+                                         std::to_string(timeLeftMs),
+                                         frames[2],
+                                         frames[3]);
+            }
+            continue;
+        }
+
+        // One message for all of them: the bitmap of their slots, the
+        // frames common to all, then their own frames in slot order.
+        std::string bitmap(slots.rbegin()->first / 8 + 1, '\0');
+        std::vector<std::string> agentFrames;
+        agentFrames.reserve(slots.size() * 4);
+        for (auto & entry: slots) {
+            bitmap[entry.first / 8] |= 1 << (entry.first % 8);
+            for (auto & frame: entry.second)
+                agentFrames.emplace_back(std::move(frame));
+        }
+
+        bridge->broadcastMessage("AUCTION",
+                                 bitmap,
+                                 auction->start,
+                                 auction->id,
+                                 binary ? BidRequest::BinaryFormat : auction->requestStrFormat,
+                                 getRequest(binary),
+                                 std::to_string(timeLeftMs),
+                                 agentFrames);
+    }
 }
 
 
@@ -62,20 +149,60 @@ void AgentsBidderInterface::sendWinLossMessage(
                               event.requestStr,
                               event.response.bidData.toJsonStr(),
                               event.response.meta,
-                              event.augmentations.toJson());
+                              event.augmentations);
 
 }
 
 void AgentsBidderInterface::sendLossMessage(
         const std::shared_ptr<const AgentConfig>& agentConfig,
         std::string const & agent, std::string const & id) {
-    bridge->sendAgentMessage(agent,
-                             "LOSS",
-                             Date::now(),
-                             "guaranteed",
-                             id,
-                             0,
-                             Amount().toString());
+    if (!agentConfig || agentConfig->lossNotifications == LN_EACH) {
+        bridge->sendAgentMessage(agent,
+                                 "LOSS",
+                                 Date::now(),
+                                 "guaranteed",
+                                 id,
+                                 0,
+                                 Amount().toString());
+        return;
+    }
+
+    // Sent by flush()
+    std::unique_lock<std::mutex> guard(lossesLock);
+    auto & losses = pendingLosses[agent];
+    if (losses.count == 0)
+        losses.since = Date::now();
+    losses.batchMs = agentConfig->lossBatchMs;
+    ++losses.count;
+    if (agentConfig->lossNotifications == LN_BATCHED)
+        losses.ids.push_back(id);
+}
+
+void AgentsBidderInterface::flush() {
+    Date now = Date::now();
+
+    std::vector<std::pair<std::string, PendingLosses> > ready;
+    {
+        std::unique_lock<std::mutex> guard(lossesLock);
+        for (auto & entry: pendingLosses) {
+            auto & losses = entry.second;
+            if (losses.count == 0
+                || losses.since.plusSeconds(losses.batchMs * 0.001) > now)
+                continue;
+            ready.emplace_back(entry.first, std::move(losses));
+            losses = PendingLosses();
+        }
+    }
+
+    for (auto & entry: ready) {
+        auto & losses = entry.second;
+        if (losses.ids.empty())
+            bridge->sendAgentMessage(entry.first, "LOSSES", now,
+                                     losses.count);
+        else
+            bridge->sendAgentMessage(entry.first, "LOSSES", now,
+                                     losses.count, losses.ids);
+    }
 }
 
 void AgentsBidderInterface::sendCampaignEventMessage(
@@ -92,7 +219,7 @@ void AgentsBidderInterface::sendCampaignEventMessage(
 
                              event.requestStrFormat,
                              event.requestStr,
-                             event.augmentations.toJson(),
+                             event.augmentations,
 
                              event.bid,
                              event.win,
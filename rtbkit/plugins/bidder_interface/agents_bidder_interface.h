@@ -8,6 +8,8 @@
 #include "rtbkit/common/bidder_interface.h"
 #include "soa/jsoncpp/json.h"
 #include <iostream>
+#include <mutex>
+#include <unordered_map>
 
 namespace RTBKIT {
 
@@ -68,6 +70,29 @@ struct AgentsBidderInterface : public BidderInterface
                          std::string const & agent,
                          int ping);
 
+    /** Send the losses held back for the agents that don't want a message
+        per loss, as a LOSSES message with their number and, unless only
+        that is wanted, their auction ids.  Each agent gets one at most
+        every lossBatchMs.
+    */
+    void flush();
+
+private:
+    /** Losses held back for an agent. */
+    struct PendingLosses {
+        PendingLosses()
+            : batchMs(0), count(0)
+        {
+        }
+
+        Date since;   ///< When the first of them came in
+        int batchMs;
+        size_t count;
+        std::vector<std::string> ids;
+    };
+
+    std::mutex lossesLock;
+    std::unordered_map<std::string, PendingLosses> pendingLosses;
 };
 
 }
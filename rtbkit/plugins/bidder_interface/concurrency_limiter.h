@@ -0,0 +1,158 @@
+/* concurrency_limiter.h                                           -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Adaptive limit on the number of requests in flight to a remote bidder.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* CONCURRENCY LIMITER                                                       */
+/*****************************************************************************/
+
+/** Keeps the number of requests in flight to a bidder under a limit which
+    adapts to the round trip times that are observed.
+
+    The limit grows by one request per round trip as long as the responses
+    come back within rttTolerance times the fastest recent round trip, and
+    shrinks multiplicatively as soon as they don't (or when a request fails)
+    which is the usual AIMD scheme used by TCP. Like TCP, it backs off at
+    most once per window of requests so that a burst of slow responses
+    doesn't collapse the limit.
+
+    A window of the recent RTTs is also kept to estimate the 95th percentile,
+    which is used to drop the requests that have no chance of being answered
+    in time.
+
+    tryAcquire() and cancel() can be called from any thread while release()
+    and update() must all be called from the same thread (the message loop
+    of the bidder interface).
+*/
+struct ConcurrencyLimiter {
+
+    ConcurrencyLimiter(int minLimit = 8, int maxLimit = 1024,
+                       double rttTolerance = 2.0,
+                       size_t window = 1024)
+        : minLimit(minLimit), maxLimit(maxLimit), rttTolerance(rttTolerance),
+          inFlight_(0), limit_(maxLimit), p95Ms_(0.0),
+          limitApprox(maxLimit), minRttMs(0.0), windowMinRttMs(0.0),
+          sinceBackoff(0), samples(window), numSamples(0)
+    {
+    }
+
+    /** Reserves a slot for a request. Returns false when the limit is
+        reached, in which case release() must NOT be called.
+    */
+    bool tryAcquire()
+    {
+        int current = inFlight_.load(std::memory_order_relaxed);
+        do {
+            if (current >= limit_.load(std::memory_order_relaxed))
+                return false;
+        } while (!inFlight_.compare_exchange_weak(current, current + 1));
+        return true;
+    }
+
+    /** Frees the slot of a request that was never sent. Unlike release(),
+        can be called from any thread.
+    */
+    void cancel()
+    {
+        inFlight_.fetch_sub(1);
+    }
+
+    /** Frees the slot of a completed request. success is false for requests
+        that didn't get a response (timeouts, connection errors, ...).
+    */
+    void release(double rttMs, bool success)
+    {
+        inFlight_.fetch_sub(1);
+        ++sinceBackoff;
+
+        if (!success) {
+            backoff();
+            return;
+        }
+
+        samples[numSamples++ % samples.size()] = rttMs;
+
+        if (windowMinRttMs == 0.0 || rttMs < windowMinRttMs)
+            windowMinRttMs = rttMs;
+        if (minRttMs == 0.0 || rttMs < minRttMs)
+            minRttMs = rttMs;
+
+        if (rttMs > minRttMs * rttTolerance) backoff();
+        else {
+            limitApprox += 1.0 / limitApprox;
+            setLimit(limitApprox);
+        }
+    }
+
+    /** Recomputes the RTT percentile; meant to be called periodically. */
+    void update()
+    {
+        size_t n = std::min(numSamples, samples.size());
+        if (n) {
+            std::vector<double> sorted(samples.begin(), samples.begin() + n);
+            size_t rank = (n * 95) / 100;
+            std::nth_element(sorted.begin(), sorted.begin() + rank,
+                             sorted.end());
+            p95Ms_ = sorted[rank];
+        }
+
+        // Forget the old minimum so that the reference follows the bidder
+        // when it gets slower for good.
+        minRttMs = windowMinRttMs;
+        windowMinRttMs = 0.0;
+    }
+
+    int inFlight() const { return inFlight_; }
+    int limit() const { return limit_; }
+
+    /** 95th percentile of the recent RTTs or 0 if none were observed. */
+    double p95Ms() const { return p95Ms_; }
+
+    const int minLimit;
+    const int maxLimit;
+    const double rttTolerance;
+
+private:
+
+    void backoff()
+    {
+        if (sinceBackoff < limitApprox) return;
+
+        sinceBackoff = 0;
+        setLimit(limitApprox * 0.9);
+    }
+
+    void setLimit(double value)
+    {
+        limitApprox = std::max<double>(minLimit, std::min<double>(maxLimit, value));
+        limit_ = int(limitApprox);
+    }
+
+    std::atomic<int> inFlight_;
+    std::atomic<int> limit_;
+    std::atomic<double> p95Ms_;
+
+    // Owned by the thread calling release() and update().
+    double limitApprox;
+    double minRttMs;
+    double windowMinRttMs;
+    size_t sinceBackoff;
+    std::vector<double> samples;
+    size_t numSamples;
+};
+
+} // namespace RTBKIT
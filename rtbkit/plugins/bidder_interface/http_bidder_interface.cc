@@ -16,8 +16,6 @@ using namespace Datacratic;
 using namespace RTBKIT;
 
 namespace {
-    DefaultDescription<OpenRTB::BidRequest> desc;
-
     std::string httpErrorString(HttpClientError code)  {
         switch (code) {
             #define CASE(code) \
@@ -49,10 +47,17 @@ Logging::Category HttpBidderInterface::trace("HttpBidderInterface Trace", HttpBi
 HttpBidderInterface::HttpBidderInterface(std::string serviceName,
                                          std::shared_ptr<ServiceProxies> proxies,
                                          Json::Value const & json)
-        : BidderInterface(proxies, serviceName) {
+        : BidderInterface(proxies, serviceName),
+          dropLateRequests(true) {
 
     int routerHttpActiveConnections = 0;
     int adserverHttpActiveConnections = 0;
+    int routerMinActiveConnections = 0;
+    double routerRttTolerance = 0.0;
+    bool routerAdaptiveConcurrency = true;
+    bool routerPipelining = false;
+    bool routerHttp2 = false;
+    bool adserverHttp2 = false;
 
     try {
         const auto& router = json["router"];
@@ -61,6 +66,12 @@ HttpBidderInterface::HttpBidderInterface(std::string serviceName,
         routerHost = router["host"].asString();
         routerPath = router["path"].asString();
         routerHttpActiveConnections = router.get("httpActiveConnections", 1024).asInt();
+        routerMinActiveConnections = router.get("minActiveConnections", 8).asInt();
+        routerRttTolerance = router.get("rttTolerance", 2.0).asDouble();
+        routerAdaptiveConcurrency = router.get("adaptiveConcurrency", true).asBool();
+        routerPipelining = router.get("pipelining", false).asBool();
+        routerHttp2 = router.get("http2", false).asBool();
+        dropLateRequests = router.get("dropLateRequests", true).asBool();
 
         adserverHost = adserver["host"].asString();
 
@@ -74,6 +85,7 @@ HttpBidderInterface::HttpBidderInterface(std::string serviceName,
         adserverErrorPath = adserver.get("errorPath", "/").asString();
 
         adserverHttpActiveConnections = adserver.get("httpActiveConnections", 1024).asInt();
+        adserverHttp2 = adserver.get("http2", false).asBool();
     } catch (const std::exception & e) {
         THROW(error) << "configuration file is invalid" << std::endl
                    << "usage : " << std::endl
@@ -83,6 +95,18 @@ HttpBidderInterface::HttpBidderInterface(std::string serviceName,
                    << "\t\t\"format\" : <string : message format>" << std::endl
                    << "\t\t\"httpActiveConnections\" : <int : concurrent connections>"
                    << std::endl
+                   << "\t\t\"minActiveConnections\" : <int : lowest adaptive limit>"
+                   << std::endl
+                   << "\t\t\"rttTolerance\" : <double : RTT increase before backing off>"
+                   << std::endl
+                   << "\t\t\"adaptiveConcurrency\" : <bool : adapt the connections to the RTT>"
+                   << std::endl
+                   << "\t\t\"pipelining\" : <bool : HTTP/1.1 pipelining>"
+                   << std::endl
+                   << "\t\t\"http2\" : <bool : multiplex the requests over HTTP/2>"
+                   << std::endl
+                   << "\t\t\"dropLateRequests\" : <bool : drop when time left < p95 RTT>"
+                   << std::endl
                    << "\t\t"
                    << "\t}" << std::endl << "\t{" << std::endl 
                    << "\t{" << std::endl << "\t\"adserver\" : {" << std::endl
@@ -98,11 +122,25 @@ HttpBidderInterface::HttpBidderInterface(std::string serviceName,
                    << "\t\t\"errorFormat\" : <string : message format>" << std::endl
                    << "\t\t\"httpActiveConnections\" : <int : concurrent connections>"
                    << std::endl
+                   << "\t\t\"http2\" : <bool : multiplex the requests over HTTP/2>"
+                   << std::endl
                    << "\t}" << std::endl << "}";
     }
 
-    // Force http_client_v2 to avoid latency added by curl in v1
-    httpClientRouter.reset(new HttpClient(routerHost, routerHttpActiveConnections, 0, 2));
+    // Force http_client_v2 to avoid latency added by curl in v1, unless
+    // pipelining or HTTP/2 is asked for which only the curl based client
+    // supports.
+    if (routerHttp2) {
+        httpClientRouter.reset(new HttpClient(routerHost, routerHttpActiveConnections, 0, 1));
+        httpClientRouter->enableHttp2(true);
+    }
+    else if (routerPipelining) {
+        httpClientRouter.reset(new HttpClient(routerHost, routerHttpActiveConnections, 0, 1));
+        httpClientRouter->enablePipelining(true);
+    }
+    else {
+        httpClientRouter.reset(new HttpClient(routerHost, routerHttpActiveConnections, 0, 2));
+    }
     /* We do not want curl to add an extra "Expect: 100-continue" HTTP header
      * and then pay the cost of an extra HTTP roundtrip. Thus we remove this
      * header
@@ -111,22 +149,39 @@ HttpBidderInterface::HttpBidderInterface(std::string serviceName,
     loop.addSource("HttpBidderInterface::httpClientRouter", httpClientRouter);
 
     std::string winHost = adserverHost + ':' + std::to_string(adserverWinPort);
-    httpClientAdserverWins.reset(new HttpClient(winHost, adserverHttpActiveConnections));
+    httpClientAdserverWins.reset(new HttpClient(winHost, adserverHttpActiveConnections, 0, adserverHttp2 ? 1 : 0));
+    httpClientAdserverWins->enableHttp2(adserverHttp2);
     httpClientAdserverWins->sendExpect100Continue(false);
     loop.addSource("HttpBidderInterface::httpClientAdserverWins", httpClientAdserverWins);
 
     std::string eventHost = adserverHost + ':' + std::to_string(adserverEventPort);
-    httpClientAdserverEvents.reset(new HttpClient(eventHost, adserverHttpActiveConnections));
+    httpClientAdserverEvents.reset(new HttpClient(eventHost, adserverHttpActiveConnections, 0, adserverHttp2 ? 1 : 0));
+    httpClientAdserverEvents->enableHttp2(adserverHttp2);
     httpClientAdserverEvents->sendExpect100Continue(false);
     loop.addSource("HttpBidderInterface::httpClientAdserverEvents", httpClientAdserverEvents);
 
     std::string errorHost = adserverHost + ':' + std::to_string(adserverErrorPort);
-    httpClientAdserverErrors.reset(new HttpClient(errorHost, adserverHttpActiveConnections));
+    httpClientAdserverErrors.reset(new HttpClient(errorHost, adserverHttpActiveConnections, 0, adserverHttp2 ? 1 : 0));
+    httpClientAdserverErrors->enableHttp2(adserverHttp2);
     httpClientAdserverErrors->sendExpect100Continue(false);
     loop.addSource("HttpBidderInterface::httpClientAdserverErrors", httpClientAdserverErrors);
 
+    if (routerAdaptiveConcurrency) {
+        routerLimiter.reset(new ConcurrencyLimiter(
+                        std::min(routerMinActiveConnections, routerHttpActiveConnections),
+                        routerHttpActiveConnections,
+                        routerRttTolerance));
+    }
+
     loop.addPeriodic("HttpBidderInterface::reportQueues", 1.0, [=](uint64_t) {
         recordLevel(httpClientRouter->queuedRequests(), "queuedRequests");
+
+        if (routerLimiter) {
+            routerLimiter->update();
+            recordLevel(routerLimiter->inFlight(), "inFlightRequests");
+            recordLevel(routerLimiter->limit(), "concurrencyLimit");
+            recordLevel(routerLimiter->p95Ms(), "httpResponseTimeP95Ms");
+        }
     });
 
 }
@@ -151,6 +206,27 @@ void HttpBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const & au
     using namespace std;
 
     BidRequest & originalRequest = *auction->request;
+
+    // There's no point in sending a request that will only be answered
+    // after the exchange gave up on it.
+    if (dropLateRequests && routerLimiter) {
+        double p95 = routerLimiter->p95Ms();
+        if (p95 > 0.0 && timeLeftMs < p95) {
+            dropAuction(auction, bidders, "timeBudget");
+            return;
+        }
+    }
+
+    if (routerLimiter && !routerLimiter->tryAcquire()) {
+        dropAuction(auction, bidders, "concurrencyLimit");
+        return;
+    }
+
+    // If the request doesn't make it to the client, the response callback
+    // won't run so the slot has to be given back here.
+    ML::Call_Guard releaseGuard([&] { routerLimiter->cancel(); },
+                                routerLimiter != nullptr);
+
     std::vector<Datacratic::Id> ids;
     ids.reserve(originalRequest.imp.size());
     for(auto & imp : originalRequest.imp) {
@@ -159,9 +235,8 @@ void HttpBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const & au
 
     std::string openRtbVersion;
     string requestStr;
-    StructuredJsonPrintingContext context;
 
-    parseFormat(originalRequest, auction, bidders, requestStr, context, openRtbVersion);
+    parseFormat(originalRequest, auction, bidders, requestStr, openRtbVersion);
 
     Date sentResponseTime = Date::now();
     /* We need to capture by copy inside the lambda otherwise we might get
@@ -174,6 +249,11 @@ void HttpBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const & au
                 Date responseReceivedTime = Date::now();
                 const double responseTime = responseReceivedTime.secondsSince(sentResponseTime);
                 recordOutcome(1000.0 * responseTime, "httpResponseTimeMs");
+
+                if (routerLimiter) {
+                    routerLimiter->release(1000.0 * responseTime,
+                                           errorCode == HttpClientError::None);
+                }
                // cerr << "Response: " << "HTTP " << statusCode << std::endl << body << endl;
 
                  /* We need to make sure that we re-inject bids into the router for each
@@ -183,26 +263,7 @@ void HttpBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const & au
                   * be artificially waiting for that particular bidder to bid, and will
                   * expire the auction.
                   */
-                 AgentBids bidsToSubmit;
-
-                for (const auto &bidder: bidders) {
-                     AgentBidsInfo info;
-                     info.agentName = bidder.first;
-                     info.agentConfig = bidder.second.agentConfig;
-                     info.auctionId = auction->id;
-                     info.wcm = auction->exchangeConnector->getWinCostModel(
-                                       *auction, *info.agentConfig);
-
-                     const BiddableSpots& imps = bidder.second.imp;
-                     info.bids.reserve(imps.size());
-                     for (size_t i = 0; i < imps.size(); ++i) {
-                         Bid bid;
-                         bid.spotIndex = imps[i].first;
-                         info.bids.push_back(bid);
-                     }
-
-                     bidsToSubmit[bidder.first] = info;
-                 }
+                 AgentBids bidsToSubmit = makeEmptyBids(auction, bidders);
 
                  // Make sure to submit the bids no matter what
                  ML::Call_Guard submitGuard([&] { submitBids(bidsToSubmit); });
@@ -296,29 +357,79 @@ void HttpBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const & au
    // std::cerr << "Sending HTTP POST to: " << routerHost << " " << routerPath << std::endl;
    // std::cerr << "Content " << reqContent.str << std::endl;
 
-    httpClientRouter->post(routerPath, callbacks, reqContent,
-                     { } /* queryParams */, headers);
+    if (httpClientRouter->post(routerPath, callbacks, reqContent,
+                               { } /* queryParams */, headers)) {
+        releaseGuard.clear();
+    }
+}
+
+HttpBidderInterface::AgentBids
+HttpBidderInterface::makeEmptyBids(const std::shared_ptr<Auction> &auction,
+                                   const std::map<std::string, BidInfo> &bidders) const
+{
+    AgentBids result;
+
+    for (const auto &bidder: bidders) {
+        AgentBidsInfo info;
+        info.agentName = bidder.first;
+        info.agentConfig = bidder.second.agentConfig;
+        info.auctionId = auction->id;
+        info.wcm = auction->exchangeConnector->getWinCostModel(
+                          *auction, *info.agentConfig);
+
+        const BiddableSpots& imps = bidder.second.imp;
+        info.bids.reserve(imps.size());
+        for (size_t i = 0; i < imps.size(); ++i) {
+            Bid bid;
+            bid.spotIndex = imps[i].first;
+            info.bids.push_back(bid);
+        }
+
+        result[bidder.first] = info;
+    }
+
+    return result;
+}
+
+void HttpBidderInterface::dropAuction(const std::shared_ptr<Auction> &auction,
+                                      const std::map<std::string, BidInfo> &bidders,
+                                      const std::string &reason)
+{
+    recordHit("dropped.total");
+    recordHit("dropped.%s", reason);
+
+    AgentBids bids = makeEmptyBids(auction, bidders);
+    submitBids(bids);
 }
 
 void HttpBidderInterface::parseFormat (BidRequest & originalRequest,
        std::shared_ptr<Auction> const & auction,
        std::map<std::string, BidInfo> const & bidders, std::string & requestStr,
-       StructuredJsonPrintingContext & context, std::string & openRtbVersion)
+       std::string & openRtbVersion)
 {
     if (!originalRequest.protocolVersion.empty())
         openRtbVersion = originalRequest.protocolVersion;
     else
         openRtbVersion = "2.1";
 
-    std::shared_ptr<OpenRTBBidRequestParser> parser = OpenRTBBidRequestParser::openRTBBidRequestParserFactory(openRtbVersion);
-
-    OpenRTB::BidRequest openRtbRequest;
-    openRtbRequest = parser->toBidRequest(originalRequest);
+    // The conversion is shared with the other HTTP interfaces the auction
+    // goes to; only the per bidder fields below are filled in on a copy.
+    auto converted = auction->encodedRequest<OpenRTB::BidRequest>(
+            "openrtb-" + openRtbVersion,
+            [&] () {
+                auto parser = OpenRTBBidRequestParser
+                    ::openRTBBidRequestParserFactory(openRtbVersion);
+                return parser->toBidRequest(originalRequest);
+            });
+
+    // The per bidder fields go in an overlay rather than in a copy of the
+    // whole request, and are merged back in as it gets written out.
+    OpenRTB::BidRequestOverlay openRtbRequest(converted);
     if(!prepareStandardRequest(openRtbRequest, originalRequest, auction, bidders)) {
         return;
     }
-    desc.printJson(&openRtbRequest, context);
-    requestStr = context.output.toString();
+
+    requestStr = openRtbRequest.toJsonStr();
 }
 
 void HttpBidderInterface::routerFormat(OpenRTB::Bid const & bid, Bid & theBid,
@@ -561,7 +672,7 @@ void HttpBidderInterface::registerLoopMonitor(LoopMonitor *monitor) const {
     monitor->addMessageLoop(serviceName(), &loop);
 }
 
-void HttpBidderInterface::tagRequest(OpenRTB::BidRequest &request,
+void HttpBidderInterface::tagRequest(OpenRTB::BidRequestOverlay &request,
                                      const std::map<std::string, BidInfo> &bidders) const
 {
     static const Json::Value null(Json::nullValue);
@@ -571,8 +682,11 @@ void HttpBidderInterface::tagRequest(OpenRTB::BidRequest &request,
 
     // Make sure to tag every impression, even impressions that do not satisfy
     // filters
-    for (auto& imp: request.imp)
-        imp.ext[ExternalIdsFieldName] = imp.ext[CreativeIdsFieldName] = null;
+    const size_t numImps = request.base().imp.size();
+    for (size_t i = 0; i < numImps; ++i) {
+        auto& ext = request.impExt(i);
+        ext[ExternalIdsFieldName] = ext[CreativeIdsFieldName] = null;
+    }
 
     for (const auto &bidder: bidders) {
         const auto &agentConfig = bidder.second.agentConfig;
@@ -581,13 +695,13 @@ void HttpBidderInterface::tagRequest(OpenRTB::BidRequest &request,
         for (const auto &spot: spots) {
             const int adSpotIndex = spot.first;
             const auto& creativeIndexes = spot.second;
-            ExcCheck(adSpotIndex >= 0 && adSpotIndex < request.imp.size(),
+            ExcCheck(adSpotIndex >= 0 && adSpotIndex < numImps,
                      "adSpotIndex out of range");
-            auto &imp = request.imp[adSpotIndex];
-            auto &externalIds = imp.ext[ExternalIdsFieldName];
+            auto &ext = request.impExt(adSpotIndex);
+            auto &externalIds = ext[ExternalIdsFieldName];
             externalIds.append(agentConfig->externalId);
 
-            auto& creativesExtField = imp.ext[CreativeIdsFieldName];
+            auto& creativesExtField = ext[CreativeIdsFieldName];
 
 
             auto &creativesList = creativesExtField[std::to_string(agentConfig->externalId)];
@@ -604,13 +718,13 @@ void HttpBidderInterface::tagRequest(OpenRTB::BidRequest &request,
 
 }
 
-bool HttpBidderInterface::prepareStandardRequest(OpenRTB::BidRequest &request,
+bool HttpBidderInterface::prepareStandardRequest(OpenRTB::BidRequestOverlay &request,
                                          const RTBKIT::BidRequest &originalRequest,
                                          const std::shared_ptr<Auction> &auction,
                                          const std::map<std::string, BidInfo> &bidders) const {
     tagRequest(request, bidders);
 
-     request.ext["exchange"] = originalRequest.exchange;
+     request.ext()["exchange"] = originalRequest.exchange;
 
     // Take any augmentation data and fill in the ext field of the bid request with the data,
     // under the rtbkit "namespace"
@@ -621,7 +735,7 @@ bool HttpBidderInterface::prepareStandardRequest(OpenRTB::BidRequest &request,
             augJson[augmentor.first] = augmentor.second.toJson();
         }
 
-        request.ext["rtbkit"]["augmentationList"] = augJson;
+        request.ext()["rtbkit"]["augmentationList"] = augJson;
     }
 
 
@@ -632,7 +746,7 @@ bool HttpBidderInterface::prepareStandardRequest(OpenRTB::BidRequest &request,
         return false;
     }
 
-    request.tmax.val = remainingTimeMs;
+    request.setTmax(remainingTimeMs);
     return true;
 }
 
@@ -649,15 +763,13 @@ void HttpBidderInterface::injectBids(const std::string &agent, Id auctionId,
 
      // We can not directly call router->doBid here because otherwise we would end up
      // calling doBid from the context of an other thread (the MessageLoop worker thread).
-     // Since the object that handles in flight BidRequests for an agent is not
-     // thread-safe, we can not call the doBid function from an other thread.
-     // Instead, we use a queue to communicate with the router thread. We then avoid
-     // an evil race condition.
+     // Since the in flight state of an auction is owned by the thread of its
+     // auction shard, we hand the bid over to that shard's queue instead and
+     // avoid an evil race condition.
 
-     if (!router->doBidBuffer.tryPush(std::move(message))) {
-         throw ML::Exception("Main router loop can not keep up with HttpBidderInterface");
+     if (!router->injectBid(std::move(message))) {
+         throw ML::Exception("Router auction shard can not keep up with HttpBidderInterface");
      }
-     router->wakeupMainLoop.signal();
 }
 
 void HttpBidderInterface::submitBids(AgentBids &info) {
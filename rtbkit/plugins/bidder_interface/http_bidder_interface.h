@@ -6,6 +6,8 @@
 #pragma once
 
 #include "rtbkit/common/bidder_interface.h"
+#include "rtbkit/openrtb/openrtb_overlay.h"
+#include "concurrency_limiter.h"
 #include "soa/service/http_client.h"
 #include "soa/service/logs.h"
 
@@ -40,7 +42,7 @@ struct HttpBidderInterface : public BidderInterface
     virtual void  parseFormat(BidRequest & originalRequest,
             std::shared_ptr<Auction> const & auction,
             std::map<std::string, BidInfo> const & bidders, std::string & requestStr,
-            StructuredJsonPrintingContext & context,  std::string & openRtbversion);
+            std::string & openRtbversion);
 
     virtual void routerFormat(OpenRTB::Bid const & bid, Bid & theBid, std::string & agent,
                              shared_ptr<const AgentConfig> & config, std::string & body,
@@ -83,7 +85,7 @@ struct HttpBidderInterface : public BidderInterface
 
     void registerLoopMonitor(LoopMonitor *monitor) const;
 
-    virtual void tagRequest(OpenRTB::BidRequest &request,
+    virtual void tagRequest(OpenRTB::BidRequestOverlay &request,
                             const std::map<std::string, BidInfo> &bidders) const;
 
     static Logging::Category print;
@@ -112,6 +114,12 @@ protected:
     std::string routerHost;
     std::string routerPath;
 
+    /// Adapts the number of requests in flight to the bidder to its RTT
+    std::unique_ptr<ConcurrencyLimiter> routerLimiter;
+
+    /// Drop the requests that have less time left than the p95 RTT
+    bool dropLateRequests;
+
     std::string adserverHost;
 
     uint16_t adserverWinPort;
@@ -128,11 +136,22 @@ protected:
 
     void submitBids(AgentBids &info);
 
-    bool prepareRequest(OpenRTB::BidRequest &request,
+    /** Bids for all the spots of all the bidders that are yet to be
+        filled in; submitted as is they mean no-bid.
+    */
+    AgentBids makeEmptyBids(const std::shared_ptr<Auction> &auction,
+                            const std::map<std::string, BidInfo> &bidders) const;
+
+    /** Answers no-bid for all the bidders without querying the bidder. */
+    void dropAuction(const std::shared_ptr<Auction> &auction,
+                     const std::map<std::string, BidInfo> &bidders,
+                     const std::string &reason);
+
+    bool prepareRequest(OpenRTB::BidRequestOverlay &request,
                         const RTBKIT::BidRequest &originalRequest,
                         const std::shared_ptr<Auction> &auction,
                         const std::map<std::string, BidInfo> &bidders) const;
-    bool prepareStandardRequest(OpenRTB::BidRequest &request,
+    bool prepareStandardRequest(OpenRTB::BidRequestOverlay &request,
                                 const RTBKIT::BidRequest &originalRequest,
                                 const std::shared_ptr<Auction> &auction,
                                 const std::map<std::string, BidInfo> &bidders) const;
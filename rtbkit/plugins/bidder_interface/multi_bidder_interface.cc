@@ -15,7 +15,9 @@ MultiBidderInterface::MultiBidderInterface(
         std::shared_ptr<ServiceProxies> proxies,
         const Json::Value &config
         ) 
-    : BidderInterface(proxies, serviceName)
+    : BidderInterface(proxies, serviceName),
+      parallelDispatch(config.get("parallelDispatch", true).asBool()),
+      dispatchQueueSize(config.get("dispatchQueueSize", 4096).asUInt())
 {
     ExcCheck(config["type"].asString() == "multi",
              "Constructing bad BidderInterface type");
@@ -56,14 +58,70 @@ void MultiBidderInterface::start() {
     for (const auto &iface: bidderInterfaces) {
         iface.second->start();
     }
+
+    if (!parallelDispatch) return;
+
+    for (const auto &iface: bidderInterfaces) {
+        std::unique_ptr<Dispatcher> dispatcher(
+                new Dispatcher(this, iface.second, dispatchQueueSize));
+        auto * d = dispatcher.get();
+        d->thread.reset(new boost::thread([=] () { d->run(); }));
+        dispatchers[iface.second] = std::move(dispatcher);
+    }
 }
 
 void MultiBidderInterface::shutdown() {
+    // Whatever is still queued is too late to be sent anyway
+    for (auto &dispatcher: dispatchers) {
+        dispatcher.second->shutdown = true;
+    }
+    for (auto &dispatcher: dispatchers) {
+        dispatcher.second->thread->join();
+    }
+    dispatchers.clear();
+
     for (const auto &iface: bidderInterfaces) {
         iface.second->shutdown();
     }
 }
 
+void MultiBidderInterface::Dispatcher::run() {
+    while (!shutdown) {
+        AuctionMessage message;
+        if (!queue.tryPop(message, 0.1)) continue;
+
+        // Time spent in the queue comes out of the bidders' budget
+        double queuedMs = Date::now().secondsSince(message.queued) * 1000.0;
+        owner->recordLevel(queuedMs, "dispatch.%s.queuedMs",
+                           iface->interfaceName());
+
+        try {
+            iface->sendAuctionMessage(message.auction,
+                                      message.timeLeftMs - queuedMs,
+                                      message.bidders);
+        } catch (const std::exception &exc) {
+            owner->recordHit("dispatch.%s.error", iface->interfaceName());
+            std::cerr << "error sending auction to "
+                      << iface->interfaceName() << ": " << exc.what()
+                      << std::endl;
+        }
+    }
+}
+
+void MultiBidderInterface::sendAuction(
+        const std::shared_ptr<BidderInterface> &iface,
+        AuctionMessage && message) {
+
+    auto it = dispatchers.find(iface);
+    if (it != dispatchers.end()) {
+        if (it->second->queue.tryPush(std::move(message))) return;
+        recordHit("dispatch.%s.queueFull", iface->interfaceName());
+    }
+
+    iface->sendAuctionMessage(message.auction, message.timeLeftMs,
+                              message.bidders);
+}
+
 void MultiBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const & auction,
                                              double timeLeftMs,
                                              std::map<std::string, BidInfo> const & bidders) {
@@ -82,8 +140,10 @@ void MultiBidderInterface::sendAuctionMessage(std::shared_ptr<Auction> const & a
         aggregate[iface].insert(bidder);
     }
 
-    for (const auto &iface: aggregate) {
-        iface.first->sendAuctionMessage(auction, timeLeftMs, iface.second);
+    Date now = Date::now();
+    for (auto &iface: aggregate) {
+        sendAuction(iface.first, AuctionMessage {
+                auction, timeLeftMs, now, std::move(iface.second) });
     }
 }
 
@@ -189,6 +249,10 @@ void MultiBidderInterface::sendPingMessage(
                             agentConfig, agent, ping);
 }
 
+void MultiBidderInterface::flush() {
+    dispatchAllInterfaces(&BidderInterface::flush);
+}
+
 void MultiBidderInterface::registerLoopMonitor(LoopMonitor *monitor) const {
     for (const auto& iface: bidderInterfaces) {
         iface.second->registerLoopMonitor(monitor);
@@ -9,9 +9,23 @@
 
 #include "rtbkit/common/bidder_interface.h"
 #include "rtbkit/core/router/router.h"
+#include "jml/utils/ring_buffer.h"
+#include <boost/thread/thread.hpp>
+#include <atomic>
 
 namespace RTBKIT {
 
+/** Bidder interface that hands each agent to the interface named by its
+    bidderInterface field.
+
+    Unless "parallelDispatch" is false in the config, each interface gets a
+    thread and a queue of "dispatchQueueSize" (4096) auctions, and
+    sendAuctionMessage only queues the auction for each of the interfaces it
+    goes to.  They are then all sent to at once, off the thread that
+    started the bidding.  An interface whose queue is full is sent to
+    directly.  The request is encoded once per wire format for all of them
+    (see Auction::encodedRequest).  Every other message is sent directly.
+*/
 struct MultiBidderInterface : public BidderInterface {
 
     struct InterfaceStats {
@@ -147,6 +161,8 @@ struct MultiBidderInterface : public BidderInterface {
                          std::string const & agent,
                          int ping);
 
+    void flush();
+
     void registerLoopMonitor(LoopMonitor *monitor) const;
 
     Stats stats() const {
@@ -206,6 +222,41 @@ private:
 
     Stats stats_;
 
+    /** An auction queued for one of the interfaces. */
+    struct AuctionMessage {
+        std::shared_ptr<Auction> auction;
+        double timeLeftMs;
+        Date queued;
+        std::map<std::string, BidInfo> bidders;
+    };
+
+    /** Sends the queued auctions of one interface on its own thread. */
+    struct Dispatcher {
+        Dispatcher(MultiBidderInterface * owner,
+                   std::shared_ptr<BidderInterface> iface,
+                   size_t queueSize)
+            : owner(owner), iface(std::move(iface)), queue(queueSize),
+              shutdown(false)
+        {
+        }
+
+        void run();
+
+        MultiBidderInterface * owner;
+        std::shared_ptr<BidderInterface> iface;
+        ML::RingBufferSRMW<AuctionMessage> queue;
+        std::atomic<bool> shutdown;
+        boost::scoped_ptr<boost::thread> thread;
+    };
+
+    void sendAuction(const std::shared_ptr<BidderInterface> & iface,
+                     AuctionMessage && message);
+
+    bool parallelDispatch;
+    size_t dispatchQueueSize;
+    std::map<std::shared_ptr<BidderInterface>,
+             std::unique_ptr<Dispatcher> > dispatchers;
+
 
 };
 
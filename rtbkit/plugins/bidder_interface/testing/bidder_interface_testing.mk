@@ -0,0 +1,3 @@
+# bidder_interface_testing.mk
+
+$(eval $(call test,concurrency_limiter_test,,boost))
@@ -0,0 +1,87 @@
+/** concurrency_limiter_test.cc                                 -*- C++ -*-
+    14 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the adaptive concurrency limit of the http bidder interface.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/bidder_interface/concurrency_limiter.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( acquireRelease )
+{
+    ConcurrencyLimiter limiter(2, 4);
+    BOOST_CHECK_EQUAL(limiter.limit(), 4);
+
+    for (size_t i = 0; i < 4; ++i)
+        BOOST_CHECK(limiter.tryAcquire());
+    BOOST_CHECK(!limiter.tryAcquire());
+    BOOST_CHECK_EQUAL(limiter.inFlight(), 4);
+
+    limiter.cancel();
+    BOOST_CHECK_EQUAL(limiter.inFlight(), 3);
+    BOOST_CHECK(limiter.tryAcquire());
+
+    for (size_t i = 0; i < 4; ++i)
+        limiter.release(10.0, true);
+    BOOST_CHECK_EQUAL(limiter.inFlight(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( adaptsToRtt )
+{
+    ConcurrencyLimiter limiter(8, 128, 2.0);
+
+    auto complete = [&] (double rttMs) {
+        BOOST_REQUIRE(limiter.tryAcquire());
+        limiter.release(rttMs, true);
+    };
+
+    for (size_t i = 0; i < 100; ++i) complete(10.0);
+    BOOST_CHECK_EQUAL(limiter.limit(), 128);
+
+    // The bidder slows down so the limit has to go down and stay above the
+    // minimum.
+    for (size_t i = 0; i < 10000; ++i) complete(50.0);
+    BOOST_CHECK_EQUAL(limiter.limit(), 8);
+
+    // Once the old minimum is forgotten, the slower RTT is the new normal
+    // and the limit grows back.
+    limiter.update();
+    limiter.update();
+    for (size_t i = 0; i < 1000; ++i) complete(50.0);
+    BOOST_CHECK_GT(limiter.limit(), 8);
+}
+
+BOOST_AUTO_TEST_CASE( failuresBackOff )
+{
+    ConcurrencyLimiter limiter(1, 100);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        BOOST_REQUIRE(limiter.tryAcquire());
+        limiter.release(0.0, false);
+    }
+    BOOST_CHECK_LT(limiter.limit(), 100);
+}
+
+BOOST_AUTO_TEST_CASE( percentile )
+{
+    ConcurrencyLimiter limiter(1, 1000, 1000.0, 100);
+    BOOST_CHECK_EQUAL(limiter.p95Ms(), 0.0);
+
+    for (size_t i = 1; i <= 100; ++i) {
+        BOOST_REQUIRE(limiter.tryAcquire());
+        limiter.release(i, true);
+    }
+
+    limiter.update();
+    BOOST_CHECK_EQUAL(limiter.p95Ms(), 96.0);
+}
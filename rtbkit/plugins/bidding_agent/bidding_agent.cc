@@ -20,6 +20,7 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 #include <iostream>
+#include <sys/utsname.h>
 
 using namespace std;
 using namespace Datacratic;
@@ -81,6 +82,28 @@ jsonParse(const std::string & str)
     return Json::parse(str);
 }
 
+/** Calls the given function whenever the fd is readable. */
+struct FdEventSource : public AsyncEventSource {
+    FdEventSource(int fd, std::function<void ()> onEvent)
+        : fd(fd), onEvent(std::move(onEvent))
+    {
+    }
+
+    virtual int selectFd() const
+    {
+        return fd;
+    }
+
+    virtual bool processOne()
+    {
+        onEvent();
+        return false;
+    }
+
+    int fd;
+    std::function<void ()> onEvent;
+};
+
 /******************************************************************************/
 /* ROUTER PROXY                                                               */
 /******************************************************************************/
@@ -95,8 +118,14 @@ BiddingAgent(std::shared_ptr<ServiceProxies> proxies,
       toRouters(getZmqContext()),
       toPostAuctionServices(getZmqContext()),
       toConfigurationAgent(getZmqContext()),
-      toRouterChannel(65536),
-      requiresAllCB(true)
+      shmAllowed(true),
+      broadcastAllowed(true),
+      requiresAllCB(true),
+      maxBatchSize(64),
+      maxBatchDelay(0.001),
+      bidRequestQueue(65536),
+      stopBiddingThreads(false),
+      numBiddingThreads(0)
 {
 }
 
@@ -110,8 +139,14 @@ BiddingAgent(ServiceBase& parent,
       toRouters(getZmqContext()),
       toPostAuctionServices(getZmqContext()),
       toConfigurationAgent(getZmqContext()),
-      toRouterChannel(65536),
-      requiresAllCB(true)
+      shmAllowed(true),
+      broadcastAllowed(true),
+      requiresAllCB(true),
+      maxBatchSize(64),
+      maxBatchDelay(0.001),
+      bidRequestQueue(65536),
+      stopBiddingThreads(false),
+      numBiddingThreads(0)
 {
 }
 
@@ -153,6 +188,8 @@ init()
         };
 
     toRouters.init(getServices()->config, agentName);
+    // Bids are sent straight from the thread that makes them
+    toRouters.enableSocketPerThread();
     toRouters.connectHandler = [=] (const std::string & connectedTo)
         {
             std::stringstream ss;
@@ -160,12 +197,10 @@ init()
                  << connectedTo << endl;
             cerr << ss.str() ;
             toRouters.sendMessage(connectedTo, "CONFIG", agentName);
+            requestShm(connectedTo);
+            requestBroadcast(connectedTo, messageHandler);
         };
     toRouters.connectAllServiceProviders("rtbRequestRouter", "agents");
-    toRouterChannel.onEvent = [=] (const RouterMessage & msg)
-        {
-            toRouters.sendMessage(msg.toRouter, msg.type, msg.payload);
-        };
     toPostAuctionServices.init(getServices()->config, agentName);
     toPostAuctionServices.connectHandler = [=] (const std::string & connectedTo)
         {
@@ -179,7 +214,29 @@ init()
     addSource("BiddingAgent::toRouters", toRouters);
     addSource("BiddingAgent::toPostAuctionServices", toPostAuctionServices);
     addSource("BiddingAgent::toConfigurationAgent", toConfigurationAgent);
-    addSource("BiddingAgent::toRouterChannel", toRouterChannel);
+
+    if (shmAllowed) {
+        string name = agentName;
+        std::replace(name.begin(), name.end(), '/', '_');
+        try {
+            shmWakeup = ShmWakeup::create(
+                    "/dev/shm/rtbkit-agent-" + name + ".wakeup");
+            addSource("BiddingAgent::shmRouters",
+                      std::make_shared<FdEventSource>(
+                              shmWakeup->fd(),
+                              [=] { receiveShm(messageHandler); }));
+        } catch (const std::exception & exc) {
+            cerr << "not using shared memory for the routers: " << exc.what()
+                 << endl;
+        }
+    }
+
+    addPeriodic("BiddingAgent::flushBatch", maxBatchDelay,
+                [=] (uint64_t) { flushBatch(); });
+
+    stopBiddingThreads = false;
+    for (int i = 0; i < numBiddingThreads; ++i)
+        biddingThreads.create_thread([=] { this->runBiddingThread(); });
 
     // No need to init() message loop; it was done in the constructor
 }
@@ -188,11 +245,25 @@ void
 BiddingAgent::
 shutdown()
 {
+    stopBiddingThreads = true;
+    biddingThreads.join_all();
+
     MessageLoop::shutdown();
 
     toConfigurationAgent.shutdown();
     toRouters.shutdown();
     //toPostAuctionService.shutdown();
+
+    {
+        std::lock_guard<std::mutex> guard(broadcastLock);
+        for (auto & entry: broadcastRouters)
+            if (entry.second.subscriber)
+                entry.second.subscriber->shutdown();
+        broadcastRouters.clear();
+    }
+
+    std::unique_lock<std::mutex> guard(shmLock);
+    shmRouters.clear();
 }
 
 void
@@ -223,6 +294,7 @@ handleRouterMessage(const std::string & fromRouter,
         case hash_compile_time("AUCTION") : handleBidRequest(fromRouter, message, onBidRequest); break;
         case hash_compile_time("WIN") :     handleResult(message, onWin); break;
         case hash_compile_time("LOSS") :    handleResult(message, onLoss); break;
+        case hash_compile_time("LOSSES") :  handleLosses(message); break;
         case hash_compile_time("LATEWIN") : handleResult(message, onLateWin ); break;
         case hash_compile_time("NOBUDGET") : handleResult(message, onNoBudget); break;
         case hash_compile_time("NEEDCONFIG") : sendConfig(); break;
@@ -261,6 +333,8 @@ handleRouterMessage(const std::string & fromRouter,
         }
         case hash_compile_time("DROPPEDBID") : handleResult(message, onDroppedBid); break;
         case hash_compile_time("GOTCONFIG") : /* no-op */ ; break;
+        case hash_compile_time("SHM_READY") : acceptShm(fromRouter, message); break;
+        case hash_compile_time("BROADCAST_READY") : acceptBroadcast(fromRouter, message); break;
         case hash_compile_time("ERROR") : handleError(message, onError) ; break;
         case hash_compile_time("BYEBYE"): {
              if (onByebye) {
@@ -279,7 +353,10 @@ handleRouterMessage(const std::string & fromRouter,
             auto message_ = message;
             string received = message.at(1);
             message_.erase(message_.begin(), message_.begin() + 2);
-            toRouters.sendMessage(fromRouter, "PONG0", received, Date::now(), message_);
+            if (auto channel = getShmChannel(fromRouter))
+                channel->sendMessage("PONG0", received, Date::now(), message_);
+            else
+                toRouters.sendMessage(fromRouter, "PONG0", received, Date::now(), message_);
             break;
         } 
         case hash_compile_time("PING1") : {
@@ -366,25 +443,105 @@ BiddingAgent::
 handleBidRequest(const std::string & fromRouter,
                  const std::vector<std::string>& msg, BidRequestCbFn& callback)
 {
-    ExcCheck(!requiresAllCB || callback, "Null callback for " + msg[0]);
-    if (!callback) return;
+    bool batched = !!onBidRequestBatch;
+    ExcCheck(!requiresAllCB || callback || batched, "Null callback for " + msg[0]);
+    if (!callback && !batched) return;
 
     checkMessageSize(msg, 9);
 
-    double timestamp = boost::lexical_cast<double>(msg[1]);
     Id id(msg[2]);
+    recordHit("requests");
+    registerRequest(fromRouter, id);
+
+    if (numBiddingThreads > 0) {
+        if (!bidRequestQueue.tryPush(msg)) {
+            recordHit("droppedRequests");
+            forgetRequest(id);
+        }
+        return;
+    }
+
+    AgentBidRequest request;
+    try {
+        parseBidRequest(msg, request);
+    } catch (...) {
+        forgetRequest(id);
+        throw;
+    }
+
+    deliverBidRequest(request, callback);
+}
+
+void
+BiddingAgent::
+handleSharedBidRequest(const std::string & fromRouter,
+                       AgentBidRequest & request)
+{
+    bool batched = !!onBidRequestBatch;
+    ExcCheck(!requiresAllCB || onBidRequest || batched,
+             "Null callback for AUCTION");
+    if (!onBidRequest && !batched) return;
+
+    recordHit("AUCTION");
+    recordHit("requests");
+    recordHit("sharedRequests");
+    registerRequest(fromRouter, request.id);
+
+    deliverBidRequest(request, onBidRequest);
+}
+
+void
+BiddingAgent::
+registerRequest(const std::string & fromRouter, Id id)
+{
+    lock_guard<mutex> guard (requestsLock);
+    ExcCheck(!requests.count(id), "seen multiple requests with same ID");
+
+    requests[id].timestamp = Date::now();
+    requests[id].fromRouter = fromRouter;
+}
+
+void
+BiddingAgent::
+deliverBidRequest(AgentBidRequest & request, BidRequestCbFn & callback)
+{
+    if (onBidRequestBatch) {
+        batch.push_back(std::move(request));
+        if (batch.size() >= maxBatchSize) flushBatch();
+        return;
+    }
+
+    callback(request.timestamp, request.id, request.bidRequest, request.bids,
+             request.timeLeftMs, request.augmentations, request.wcm);
+}
+
+void
+BiddingAgent::
+parseBidRequest(const std::vector<std::string>& msg, AgentBidRequest& request)
+{
+    request.timestamp = boost::lexical_cast<double>(msg[1]);
+    request.id = Id(msg[2]);
 
     string bidRequestSource = msg[3];
 
-    std::shared_ptr<BidRequest> br(
-            BidRequest::parse(bidRequestSource, msg[4]));
+    request.bidRequest.reset(BidRequest::parse(bidRequestSource, msg[4]));
+    request.timeLeftMs = boost::lexical_cast<double>(msg[6]);
+
+    parseAgentFrames(msg[5], msg[7], msg[8], request);
+}
 
-    Json::Value imp = jsonParse(msg[5]);
-    double timeLeftMs = boost::lexical_cast<double>(msg[6]);
-    Json::Value augmentations = jsonParse(msg[7]);
-    WinCostModel wcm = WinCostModel::fromJson(jsonParse(msg[8]));
+void
+BiddingAgent::
+parseAgentFrames(const std::string & spots,
+                 const std::string & augmentations,
+                 const std::string & wcm,
+                 AgentBidRequest & request)
+{
+    Json::Value imp = jsonParse(spots);
+    request.augmentations = jsonParse(augmentations);
+    request.wcm = WinCostModel::fromJson(jsonParse(wcm));
 
-    Bids bids;
+    Bids & bids = request.bids;
     bids.reserve(imp.size());
 
     for (size_t i = 0; i < imp.size(); ++i) {
@@ -396,18 +553,75 @@ handleBidRequest(const std::string & fromRouter,
 
         bids.push_back(bid);
     }
+}
 
-    recordHit("requests");
+void
+BiddingAgent::
+forgetRequest(Id id)
+{
+    lock_guard<mutex> guard (requestsLock);
+    requests.erase(id);
+}
 
-    {
-        lock_guard<mutex> guard (requestsLock);
-        ExcCheck(!requests.count(id), "seen multiple requests with same ID");
+void
+BiddingAgent::
+runBiddingThread()
+{
+    std::vector<std::string> msg;
+    std::vector<AgentBidRequest> toBid;
+
+    while (!stopBiddingThreads) {
+        if (!bidRequestQueue.tryPop(msg, 1.0)) continue;
+
+        // Whatever else is already waiting goes in the same batch.
+        bool batched = !!onBidRequestBatch;
+        toBid.clear();
+
+        do {
+            AgentBidRequest request;
+            try {
+                parseBidRequest(msg, request);
+            } catch (const std::exception & ex) {
+                recordHit("error");
+                cerr << "Error parsing bid request " << ex.what() << endl;
+                forgetRequest(Id(msg[2]));
+                continue;
+            }
+            toBid.push_back(std::move(request));
+        } while (batched && toBid.size() < maxBatchSize
+                 && bidRequestQueue.tryPop(msg));
+
+        if (toBid.empty()) continue;
 
-        requests[id].timestamp = Date::now();
-        requests[id].fromRouter = fromRouter;
+        try {
+            if (batched) {
+                recordLevel(toBid.size(), "batchSize");
+                onBidRequestBatch(toBid);
+                continue;
+            }
+
+            const AgentBidRequest & request = toBid.front();
+            onBidRequest(request.timestamp, request.id, request.bidRequest,
+                         request.bids, request.timeLeftMs,
+                         request.augmentations, request.wcm);
+        } catch (const std::exception & ex) {
+            recordHit("error");
+            cerr << "Error handling bid request " << ex.what() << endl;
+        }
     }
+}
+
+void
+BiddingAgent::
+flushBatch()
+{
+    if (batch.empty()) return;
 
-    callback(timestamp, id, br, bids, timeLeftMs, augmentations, wcm);
+    std::vector<AgentBidRequest> requests;
+    requests.swap(batch);
+
+    recordLevel(requests.size(), "batchSize");
+    onBidRequestBatch(requests);
 }
 
 void
@@ -437,6 +651,42 @@ handleResult(const std::vector<std::string>& msg, ResultCbFn& callback)
     }
 }
 
+void
+BiddingAgent::
+handleLosses(const std::vector<std::string>& msg)
+{
+    ExcCheck(!requiresAllCB || onLosses || onLoss, "Null callback for " + msg[0]);
+
+    checkMessageSize(msg, 3);
+
+    double timestamp = boost::lexical_cast<double>(msg[1]);
+    size_t numLosses = boost::lexical_cast<size_t>(msg[2]);
+    recordCount(numLosses, eventName("LOSS"));
+
+    std::vector<Id> auctionIds;
+    auctionIds.reserve(msg.size() - 3);
+    for (size_t i = 3;  i < msg.size();  ++i)
+        auctionIds.emplace_back(msg[i]);
+
+    if (onLosses) {
+        onLosses(timestamp, numLosses, auctionIds);
+        return;
+    }
+
+    if (!onLoss) return;
+
+    // Same as the lightweight LOSS messages
+    BidResult result;
+    result.result = BS_LOSS;
+    result.timestamp = timestamp;
+    result.confidence = "guaranteed";
+    result.spotNum = 0;
+    for (auto & id: auctionIds) {
+        result.auctionId = id;
+        onLoss(result);
+    }
+}
+
 void
 BiddingAgent::
 handleError(const std::vector<std::string>& msg, ErrorCbFn& callback)
@@ -473,30 +723,7 @@ void
 BiddingAgent::
 doBid(Id id, Bids bids, const Json::Value & jsonMeta, const WinCostModel & wcm)
 {
-    for (Bid& bid : bids) {
-        if (bid.creativeIndex >= 0) {
-            if (!bid.isNullBid()) {
-                recordLevel(bid.price.value, "bidPrice." + bid.price.getCurrencyStr());
-            }
-
-            bid.price = agent_config.creatives[bid.creativeIndex].fees->applyFees(bid.price);
-        }
-    }
-
-    Json::FastWriter jsonWriter;
-
-    string response = jsonWriter.write(bids.toJson());
-    boost::trim(response);
-
-    string meta = jsonWriter.write(jsonMeta);
-    boost::trim(meta);
-
-    string model = jsonWriter.write(wcm.toJson());
-    boost::trim(model);
-
-    Date afterSend = Date::now();
-    Date beforeSend;
-    string fromRouter;
+    RequestStatus status;
 
     {
         lock_guard<mutex> guard (requestsLock);
@@ -511,16 +738,91 @@ doBid(Id id, Bids bids, const Json::Value & jsonMeta, const WinCostModel & wcm)
             return;
         }
 
-        beforeSend = it->second.timestamp;
-        fromRouter = it->second.fromRouter;
+        status = it->second;
         requests.erase(it);
     }
-    if (fromRouter.empty()) return;
 
-    recordLevel((afterSend - beforeSend) * 1000.0, "timeTakenMs");
+    sendBid(status, id, std::move(bids), jsonMeta, wcm);
+}
+
+void
+BiddingAgent::
+doBidBatch(const std::vector<AgentBidRequest> & toBid)
+{
+    std::vector<RequestStatus> status(toBid.size());
+
+    {
+        lock_guard<mutex> guard (requestsLock);
 
-    toRouterChannel.push(RouterMessage(
-                    fromRouter, "BID", { id.toString(), response, model, meta }));
+        for (size_t i = 0; i < toBid.size(); ++i) {
+            auto it = requests.find(toBid[i].id);
+            if (it == requests.end()) {
+                cerr << "Ignoring bid (dropped auction id): " << toBid[i].id << endl;
+                continue;
+            }
+
+            status[i] = it->second;
+            requests.erase(it);
+        }
+    }
+
+    // Payload of a BIDS message for each router
+    std::map<std::string, std::vector<std::string> > toRouter;
+
+    for (size_t i = 0; i < toBid.size(); ++i) {
+        if (status[i].fromRouter.empty()) continue;
+
+        const AgentBidRequest & request = toBid[i];
+        encodeBid(status[i], request.id, request.bids, request.meta,
+                  request.wcm, toRouter[status[i].fromRouter]);
+    }
+
+    for (auto & entry : toRouter) {
+        const char * type = entry.second.size() == 4 ? "BID" : "BIDS";
+        sendToRouter(RouterMessage(entry.first, type, entry.second));
+    }
+}
+
+void
+BiddingAgent::
+sendBid(const RequestStatus & status, Id id, Bids bids,
+        const Json::Value & jsonMeta, const WinCostModel & wcm)
+{
+    if (status.fromRouter.empty()) return;
+
+    std::vector<std::string> payload;
+    encodeBid(status, id, std::move(bids), jsonMeta, wcm, payload);
+    sendToRouter(RouterMessage(status.fromRouter, "BID", payload));
+}
+
+void
+BiddingAgent::
+encodeBid(const RequestStatus & status, Id id, Bids bids,
+          const Json::Value & jsonMeta, const WinCostModel & wcm,
+          std::vector<std::string> & payload)
+{
+    for (Bid& bid : bids) {
+        if (bid.creativeIndex >= 0) {
+            if (!bid.isNullBid()) {
+                recordLevel(bid.price.value, "bidPrice." + bid.price.getCurrencyStr());
+            }
+
+            bid.price = agent_config.creatives[bid.creativeIndex].fees->applyFees(bid.price);
+        }
+    }
+
+    string response = bids.toJsonStr();
+    string meta = jsonMeta.toStringNoNewLine();
+    string model = wcm.toJson().toStringNoNewLine();
+
+    Date afterSend = Date::now();
+    recordLevel((afterSend - status.timestamp) * 1000.0, "timeTakenMs");
+    recordSpan(id, "bid", status.timestamp, afterSend);
+
+    payload.push_back(id.toString());
+    payload.push_back(std::move(response));
+    payload.push_back(std::move(model));
+    payload.push_back(std::move(meta));
 
     /** Gather some stats */
     for (const Bid& bid : bids) {
@@ -563,7 +865,239 @@ doPong(const std::string & fromRouter, Date sent, Date received,
     };
 
     message.insert(message.end(), payload.begin(), payload.end());
-    toRouterChannel.push(RouterMessage(fromRouter, "PONG1", message));
+    sendToRouter(RouterMessage(fromRouter, "PONG1", message));
+}
+
+void
+BiddingAgent::
+sendToRouter(RouterMessage && message)
+{
+    if (auto channel = getShmChannel(message.toRouter)) {
+        channel->sendMessage(message.type, message.payload);
+        return;
+    }
+
+    try {
+        toRouters.sendMessage(message.toRouter, message.type, message.payload);
+    } catch (const std::exception & exc) {
+        // The router went away since it sent us the request
+        recordHit("errorSendingToRouter");
+    }
+}
+
+std::shared_ptr<ShmChannel>
+BiddingAgent::
+getShmChannel(const std::string & router) const
+{
+    if (!shmWakeup) return nullptr;
+
+    std::unique_lock<std::mutex> guard(shmLock);
+    auto it = shmRouters.find(router);
+    if (it == shmRouters.end())
+        return nullptr;
+    return it->second;
+}
+
+void
+BiddingAgent::
+requestShm(const std::string & router)
+{
+    if (!shmWakeup) return;
+
+    // A router that was restarted may not offer it anymore
+    {
+        std::unique_lock<std::mutex> guard(shmLock);
+        shmRouters.erase(router);
+    }
+
+    Json::Value offer = getServices()->config->getJson(router + "/agentsShm");
+    if (!offer.isObject()) return;
+
+    utsname host;
+    if (uname(&host) == -1
+        || offer["hostScope"].asString() != host.nodename)
+        return;
+
+    toRouters.sendMessage(router, "SHM_CONNECT", shmWakeup->path());
+}
+
+void
+BiddingAgent::
+acceptShm(const std::string & router, const std::vector<std::string> & msg)
+{
+    checkMessageSize(msg, 4);
+
+    auto in = ShmRing::open(msg[1]);
+    auto out = ShmRing::open(msg[2]);
+
+    // Nobody else needs to find them
+    ShmRing::unlink(in->name());
+    ShmRing::unlink(out->name());
+
+    auto channel = std::make_shared<ShmChannel>(
+            out, in, ShmWakeup::open(msg[3]));
+    {
+        std::unique_lock<std::mutex> guard(shmLock);
+        shmRouters[router] = channel;
+    }
+
+    cerr << "BiddingAgent is using shared memory for router " << router
+         << endl;
+
+    // The router may already have written to it
+    shmWakeup->signal();
+}
+
+void
+BiddingAgent::
+receiveShm(const RouterMessageHandler & handler)
+{
+    shmWakeup->drain();
+
+    std::vector<std::pair<std::string, std::shared_ptr<ShmChannel> > > channels;
+    {
+        std::unique_lock<std::mutex> guard(shmLock);
+        channels.assign(shmRouters.begin(), shmRouters.end());
+    }
+
+    vector<string> message;
+    for (auto & entry: channels) {
+        while (entry.second->receive(message))
+            handler(entry.first, message);
+    }
+}
+
+void
+BiddingAgent::
+requestBroadcast(const std::string & router,
+                 const RouterMessageHandler & handler)
+{
+    if (!broadcastAllowed) return;
+
+    // A router that was restarted gave our slot away
+    {
+        std::lock_guard<std::mutex> guard(broadcastLock);
+        auto it = broadcastRouters.find(router);
+        if (it != broadcastRouters.end()) {
+            if (it->second.subscriber)
+                removeSource(it->second.subscriber.get());
+            broadcastRouters.erase(it);
+        }
+    }
+
+    string endpoint = router + "/agentsBroadcast";
+    if (getServices()->config->getChildren(endpoint).empty())
+        return;
+
+    // The cluster receives and decodes the auctions once for all of its
+    // members; the bidding threads take raw messages so they keep their own
+    if (shareBroadcast && numBiddingThreads == 0) {
+        shareBroadcast(router);
+        {
+            std::lock_guard<std::mutex> guard(broadcastLock);
+            broadcastRouters[router] = { nullptr, -1 };
+        }
+        toRouters.sendMessage(router, "BROADCAST_SUBSCRIBE");
+        return;
+    }
+
+    auto subscriber = std::make_shared<ZmqNamedSubscriber>(
+            *getServices()->zmqContext);
+    subscriber->init(getServices()->config);
+    subscriber->messageHandler = [=] (std::vector<zmq::message_t> && message)
+        {
+            handleBroadcast(router, message, handler);
+        };
+    subscriber->connectToEndpoint(endpoint);
+    subscriber->subscribe("AUCTION");
+    addSource("BiddingAgent::broadcast:" + router, subscriber);
+
+    {
+        std::lock_guard<std::mutex> guard(broadcastLock);
+        broadcastRouters[router] = { subscriber, -1 };
+    }
+
+    toRouters.sendMessage(router, "BROADCAST_SUBSCRIBE");
+}
+
+void
+BiddingAgent::
+acceptBroadcast(const std::string & router,
+                const std::vector<std::string> & msg)
+{
+    checkMessageSize(msg, 2);
+    int slot = boost::lexical_cast<int>(msg[1]);
+
+    {
+        std::lock_guard<std::mutex> guard(broadcastLock);
+        auto it = broadcastRouters.find(router);
+        if (it == broadcastRouters.end()) return;
+        it->second.slot = slot;
+    }
+
+    cerr << "BiddingAgent has broadcast slot " << slot
+         << " on router " << router << endl;
+}
+
+int
+BiddingAgent::
+broadcastSlot(const std::string & router) const
+{
+    std::lock_guard<std::mutex> guard(broadcastLock);
+    auto it = broadcastRouters.find(router);
+    return it == broadcastRouters.end() ? -1 : it->second.slot;
+}
+
+int
+BiddingAgent::
+broadcastFrames(const std::vector<zmq::message_t> & message, int slot)
+{
+    if (slot == -1 || message.size() < BroadcastCommonFrames)
+        return -1;
+
+    const zmq::message_t & bitmap = message[1];
+    const uint8_t * bits = reinterpret_cast<const uint8_t *>(bitmap.data());
+    if (slot / 8 >= (int)bitmap.size() || !(bits[slot / 8] & (1 << (slot % 8))))
+        return -1;
+
+    // Our frames come after those of the slots before ours
+    int rank = __builtin_popcount(bits[slot / 8] & ((1 << (slot % 8)) - 1));
+    for (int i = 0;  i < slot / 8;  ++i)
+        rank += __builtin_popcount(bits[i]);
+
+    size_t first = BroadcastCommonFrames + rank * BroadcastFramesPerSlot;
+    if (message.size() < first + BroadcastFramesPerSlot)
+        return -1;
+    return first;
+}
+
+void
+BiddingAgent::
+handleBroadcast(const std::string & router,
+                const std::vector<zmq::message_t> & message,
+                const RouterMessageHandler & handler)
+{
+    int first = broadcastFrames(message, broadcastSlot(router));
+    if (first == -1)
+        return;
+
+    if (message[first].toString() != agentName) {
+        recordHit("broadcast.wrongSlot");
+        return;
+    }
+
+    vector<string> msg = {
+        message[0].toString(),
+        message[2].toString(),
+        message[3].toString(),
+        message[4].toString(),
+        message[5].toString(),
+        message[first + 1].toString(),
+        message[6].toString(),
+        message[first + 2].toString(),
+        message[first + 3].toString()
+    };
+    handler(router, msg);
 }
 
 void
@@ -20,21 +20,50 @@
 #include "soa/types/id.h"
 #include "soa/service/service_base.h"
 #include "soa/service/zmq_endpoint.h"
+#include "soa/service/zmq_named_pub_sub.h"
+#include "soa/service/shm_ring.h"
 #include "soa/service/typed_message_channel.h"
+#include "jml/utils/ring_buffer.h"
 
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/thread/barrier.hpp>
 #include <boost/smart_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
 #include <string>
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <map>
 
 
 namespace RTBKIT {
 
+/******************************************************************************/
+/* AGENT BID REQUEST                                                          */
+/******************************************************************************/
+
+/** Bid request as delivered by the onBidRequestBatch callback, with the same
+    content as the arguments of onBidRequest.  The bids, and optionally the
+    meta, are filled in by the agent before handing the request back to
+    doBidBatch().
+ */
+struct AgentBidRequest
+{
+    double timestamp;                       // Start time of the auction.
+    Id id;                                  // Auction id
+    std::shared_ptr<BidRequest> bidRequest;
+    Bids bids;                              // Impressions available for bidding
+    double timeLeftMs;                      // Time left of the bid request.
+    Json::Value augmentations;              // Data from the augmentors.
+    WinCostModel wcm;                       // Win cost model.
+    Json::Value meta;                       // Returned as is in the bid result.
+};
+
+
 /******************************************************************************/
 /* BIDDING AGENT                                                              */
 /******************************************************************************/
@@ -91,6 +120,57 @@ struct BiddingAgent : public ServiceBase, public MessageLoop {
                       const Json::Value& meta = Json::Value(),
                       const WinCostModel& wmc = WinCostModel());
 
+    /** Sends the bids of a batch of requests received through the
+        onBidRequestBatch callback.  The batch can be a subset of what was
+        received or span several callbacks.  The bids going to the same
+        router are sent together in a single message.
+     */
+    void doBidBatch(const std::vector<AgentBidRequest> & requests);
+
+    /** Sets how the bid requests are grouped for onBidRequestBatch: a batch
+        is delivered once it holds maxBatchSize requests and at most
+        maxBatchDelay seconds after its first request was received.  Should
+        be called before init().
+     */
+    void setBatching(size_t maxBatchSize, double maxBatchDelay)
+    {
+        this->maxBatchSize = maxBatchSize;
+        this->maxBatchDelay = maxBatchDelay;
+    }
+
+    /** Hands the bid requests over to a pool of numThreads bidding threads
+        instead of the message loop thread, so that agents with an expensive
+        bidding logic can use several cores behind a single router
+        connection.  The onBidRequest and onBidRequestBatch callbacks are
+        then called concurrently and must be thread safe; each batch is made
+        of the requests already queued when a thread picks one up.  All the
+        other callbacks are still called from the message loop.  Defaults to
+        0 which disables the pool.  Should be called before init().
+     */
+    void setBiddingThreads(int numThreads)
+    {
+        numBiddingThreads = numThreads;
+    }
+
+    /** Talk to the routers running on the same host through shared memory
+        instead of zeromq when they offer it, which they advertise in the
+        configuration service.  Only the heartbeats still go over zeromq.
+        Defaults to true.  Should be called before init().
+     */
+    void allowSharedMemory(bool allow)
+    {
+        shmAllowed = allow;
+    }
+
+    /** Subscribe to the auctions the routers broadcast when they do, so
+        that a request matched by many agents is sent only once.  Defaults
+        to true.  Should be called before init().
+     */
+    void allowBroadcast(bool allow)
+    {
+        broadcastAllowed = allow;
+    }
+
     /** Notify the AgentConfigurationService that the configuration of the
         bidding agent has changed.
 
@@ -158,6 +238,16 @@ struct BiddingAgent : public ServiceBase, public MessageLoop {
      */
     BidRequestCbFn onBidRequest;
 
+    typedef void (BidRequestBatchCb) (std::vector<AgentBidRequest> & requests);
+    typedef boost::function<BidRequestBatchCb> BidRequestBatchCbFn;
+
+    /** When set, replaces onBidRequest for agents that would rather process
+        their bid requests in batches: the requests received are parsed and
+        handed over together as configured by setBatching().  The callback
+        can keep or move out the requests it's given.
+     */
+    BidRequestBatchCbFn onBidRequestBatch;
+
 
     typedef void (ResultCb) (const BidResult & args);
     typedef boost::function<ResultCb> ResultCbFn;
@@ -173,6 +263,18 @@ struct BiddingAgent : public ServiceBase, public MessageLoop {
     /** We lost either the internal router auction or the exchange auction. */
     ResultCbFn onLoss;
 
+    typedef void (LossesCb) (double timestamp,
+                             size_t numLosses,
+                             const std::vector<Id> & auctionIds);
+    typedef boost::function<LossesCb> LossesCbFn;
+
+    /** Losses in the router's auction sent together, when the agent's
+        configuration sets lossNotifications; the auction ids are only given
+        with "batched".  If not set, onLoss is called for each of the auction
+        ids instead.
+    */
+    LossesCbFn onLosses;
+
     /** No bids were placed because the the account for our agent does not
         contain enough funds. */
     ResultCbFn onNoBudget;
@@ -266,7 +368,91 @@ private:
     ZmqMultipleNamedClientBusProxy toRouters;
     ZmqMultipleNamedClientBusProxy toPostAuctionServices;
     ZmqNamedClientBusProxy toConfigurationAgent;
-    TypedMessageSink<RouterMessage> toRouterChannel;
+
+    /** Sends the message through shared memory if the router is on it,
+        otherwise on the calling thread's socket to the router.  Thread
+        safe.
+     */
+    void sendToRouter(RouterMessage && message);
+
+    bool shmAllowed;
+    std::shared_ptr<ShmWakeup> shmWakeup;
+
+    /** Routers we talk to through shared memory. */
+    std::map<std::string, std::shared_ptr<ShmChannel> > shmRouters;
+    mutable std::mutex shmLock;
+
+    std::shared_ptr<ShmChannel> getShmChannel(const std::string & router) const;
+
+    /** Asks the router for a shared memory channel if it offers them and
+        is on this host. */
+    void requestShm(const std::string & router);
+
+    /** Switches to the channel given by the router's SHM_READY. */
+    void acceptShm(const std::string & router,
+                   const std::vector<std::string> & msg);
+
+    typedef std::function<void (const std::string &,
+                                const std::vector<std::string> &)>
+        RouterMessageHandler;
+
+    /** Handles the messages waiting in the shared memory channels. */
+    void receiveShm(const RouterMessageHandler & handler);
+
+    bool broadcastAllowed;
+
+    struct BroadcastSubscription {
+        std::shared_ptr<ZmqNamedSubscriber> subscriber;  ///< Null if shared
+        int slot;   ///< -1 until the router's BROADCAST_READY
+    };
+
+    /** Subscriptions to the auctions broadcast by each router.  Protected
+        by broadcastLock, as the cluster we're in reads our slots.
+    */
+    std::map<std::string, BroadcastSubscription> broadcastRouters;
+    mutable std::mutex broadcastLock;
+
+    /** Frames of a broadcast auction: AUCTION, bitmap, start, id, format,
+        request and timeLeftMs, then name, spots, augmentations and win cost
+        model for each slot set in the bitmap.
+    */
+    enum { BroadcastCommonFrames = 7, BroadcastFramesPerSlot = 4 };
+
+    /** Index of the frames of the given slot in a broadcast auction, or -1
+        if the slot isn't in it. */
+    static int broadcastFrames(const std::vector<zmq::message_t> & message,
+                               int slot);
+
+    /** Our slot in the router's broadcasts, or -1 if we don't have one. */
+    int broadcastSlot(const std::string & router) const;
+
+    friend class BiddingAgentCluster;
+
+    /** Set by the BiddingAgentCluster we're a member of, so that it
+        subscribes to the router's broadcasts once for all of its members
+        instead of each of them doing it.  It then passes our auctions on to
+        handleSharedBidRequest() already decoded.
+    */
+    std::function<void (const std::string & router)> shareBroadcast;
+
+    /** Takes an auction received and decoded by our cluster, which shares
+        the bid request with the other members it was sent to. */
+    void handleSharedBidRequest(const std::string & fromRouter,
+                                AgentBidRequest & request);
+
+    /** Subscribes to the router's auctions if it broadcasts them and asks
+        it for a slot. */
+    void requestBroadcast(const std::string & router,
+                          const RouterMessageHandler & handler);
+
+    /** Records the slot given by the router's BROADCAST_READY. */
+    void acceptBroadcast(const std::string & router,
+                         const std::vector<std::string> & msg);
+
+    /** Passes on a broadcast auction if our slot is in it. */
+    void handleBroadcast(const std::string & router,
+                         const std::vector<zmq::message_t> & message,
+                         const RouterMessageHandler & handler);
 
     struct RequestStatus {
         Date timestamp;
@@ -276,6 +462,36 @@ private:
     std::map<Id, RequestStatus> requests;
     std::mutex requestsLock; // Protects concurrent writes to requests
 
+    size_t maxBatchSize;
+    double maxBatchDelay;
+    std::vector<AgentBidRequest> batch; // Only touched by the message loop
+
+    void flushBatch();
+
+    /** Raw AUCTION messages waiting for a bidding thread; the requests are
+        registered in the requests map before being queued so that the reply
+        semantics are the same as on the message loop.
+     */
+    ML::RingBufferSWMR<std::vector<std::string> > bidRequestQueue;
+    boost::thread_group biddingThreads;
+    std::atomic<bool> stopBiddingThreads;
+    int numBiddingThreads;
+
+    void runBiddingThread();
+
+    /** Applies the fees, encodes and sends the bids for a request that was
+        already taken out of the requests map.
+     */
+    void sendBid(const RequestStatus & status, Id id, Bids bids,
+                 const Json::Value & meta, const WinCostModel & wcm);
+
+    /** Applies the fees and appends the four parts of a BID message for
+        the request to the payload.
+     */
+    void encodeBid(const RequestStatus & status, Id id, Bids bids,
+                   const Json::Value & meta, const WinCostModel & wcm,
+                   std::vector<std::string> & payload);
+
     bool requiresAllCB;
 
 
@@ -299,10 +515,27 @@ private:
     void handleError(const std::vector<std::string>& msg, ErrorCbFn& callback);
     void handleBidRequest(const std::string & fromRouter,
             const std::vector<std::string>& msg, BidRequestCbFn& callback);
+    void parseBidRequest(
+            const std::vector<std::string>& msg, AgentBidRequest& request);
+
+    /** Parses the parts of an auction that are specific to the agent. */
+    static void parseAgentFrames(const std::string & spots,
+                                 const std::string & augmentations,
+                                 const std::string & wcm,
+                                 AgentBidRequest & request);
+
+    /** Records that the router is waiting on a bid from us. */
+    void registerRequest(const std::string & fromRouter, Id id);
+
+    /** Hands a parsed request to the batch or the callback. */
+    void deliverBidRequest(AgentBidRequest & request,
+                           BidRequestCbFn & callback);
+    void forgetRequest(Id id);
     void handleWin(
             const std::vector<std::string>& msg, ResultCbFn& callback);
     void handleResult(
             const std::vector<std::string>& msg, ResultCbFn& callback);
+    void handleLosses(const std::vector<std::string>& msg);
     void handleDelivery(
             const std::vector<std::string>& msg, DeliveryCbFn& callback);
     void handlePing(const std::string & fromRouter,
@@ -2,7 +2,8 @@
 # Jeremy Barnes, 16 January 2010
 
 LIBRTB_ROUTER_PROXY_SOURCES := \
-	bidding_agent.cc
+	bidding_agent.cc \
+	bidding_agent_cluster.cc
 
 LIBRTB_ROUTER_PROXY_LINK := \
 	ACE arch utils jsoncpp boost_thread zmq opstats bid_request services
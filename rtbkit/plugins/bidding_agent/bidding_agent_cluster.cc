@@ -0,0 +1,116 @@
+/* bidding_agent_cluster.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Broadcast auctions received once for all the agents of a cluster.
+*/
+
+#include "bidding_agent_cluster.h"
+#include <boost/lexical_cast.hpp>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* BIDDING AGENT CLUSTER                                                     */
+/*****************************************************************************/
+
+void
+BiddingAgentCluster::
+subscribeBroadcast(const std::string & router)
+{
+    std::lock_guard<std::mutex> guard(broadcastMtx_);
+
+    // The subscriber follows the router's endpoint if it's restarted
+    if (broadcasts_.count(router)) return;
+
+    auto subscriber = std::make_shared<ZmqNamedSubscriber>(
+            *getServices()->zmqContext);
+    subscriber->init(getServices()->config);
+    subscriber->messageHandler = [=] (std::vector<zmq::message_t> && message)
+        {
+            handleBroadcast(router, message);
+        };
+    subscriber->connectToEndpoint(router + "/agentsBroadcast");
+    subscriber->subscribe("AUCTION");
+    addSource("BiddingAgentCluster::broadcast:" + router, subscriber);
+
+    broadcasts_[router] = subscriber;
+}
+
+void
+BiddingAgentCluster::
+handleBroadcast(const std::string & router,
+                const std::vector<zmq::message_t> & message)
+{
+    // Members the auction was sent to, with the index of their frames
+    std::vector<std::pair<agent_ptr, int> > targets;
+    {
+        std::lock_guard<std::mutex> guard(broadcastMtx_);
+        for (auto & member: members_) {
+            int first = BiddingAgent::broadcastFrames(
+                    message, member->broadcastSlot(router));
+            if (first == -1) continue;
+
+            if (message[first].toString() != member->agentName) {
+                member->recordHit("broadcast.wrongSlot");
+                continue;
+            }
+            targets.emplace_back(member, first);
+        }
+    }
+
+    if (targets.empty()) return;
+    recordLevel(targets.size(), "broadcast.membersPerRequest");
+
+    // Decoded once for all of them
+    AgentBidRequest shared;
+    try {
+        shared.timestamp = boost::lexical_cast<double>(message[2].toString());
+        shared.id = Id(message[3].toString());
+        shared.bidRequest.reset(BidRequest::parse(message[4].toString(),
+                                                  message[5].toString()));
+        shared.timeLeftMs = boost::lexical_cast<double>(message[6].toString());
+    } catch (const std::exception & exc) {
+        recordHit("broadcast.error");
+        cerr << "Error decoding broadcast auction " << exc.what() << endl;
+        return;
+    }
+
+    for (auto & target: targets) {
+        BiddingAgent & agent = *target.first;
+        int first = target.second;
+
+        AgentBidRequest request;
+        request.timestamp = shared.timestamp;
+        request.id = shared.id;
+        request.bidRequest = shared.bidRequest;
+        request.timeLeftMs = shared.timeLeftMs;
+
+        try {
+            BiddingAgent::parseAgentFrames(message[first + 1].toString(),
+                                           message[first + 2].toString(),
+                                           message[first + 3].toString(),
+                                           request);
+            agent.handleSharedBidRequest(router, request);
+        } catch (const std::exception & exc) {
+            agent.recordHit("error");
+            cerr << "Error handling auction message " << exc.what() << endl;
+        }
+    }
+}
+
+void
+BiddingAgentCluster::
+shutdownBroadcasts()
+{
+    std::lock_guard<std::mutex> guard(broadcastMtx_);
+    for (auto & entry: broadcasts_)
+        entry.second->shutdown();
+    broadcasts_.clear();
+}
+
+} // namespace RTBKIT
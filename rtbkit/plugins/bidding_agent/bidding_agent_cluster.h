@@ -9,7 +9,10 @@
 #define BIDDING_AGENT_CLUSTER_H_
 
 #include <mutex>
+#include <map>
+#include <vector>
 #include <memory>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <functional>
@@ -25,6 +28,12 @@ namespace RTBKIT {
  * to share a same poll loop.
  * The shared poll loop belong to the cluster (which is a MessageLoop)
  * Limited groupped operations are supported: (init, shutdown)
+ *
+ * The cluster also subscribes to the auctions broadcast by each router on
+ * behalf of its members: an auction sent to several of them is received
+ * and its bid request decoded once, and the same BidRequest is handed to
+ * each of the members it was sent to, which must not modify it.  Members
+ * with bidding threads keep their own subscription.
  */
 class BiddingAgentCluster: 
     public Datacratic::ServiceBase,
@@ -67,15 +76,26 @@ public:
         for (auto& agent: agents_)
             if (agent.second.get())
                 agent.second->shutdown();
+        shutdownBroadcasts ();
     }
 
-    /** attempt to add new_member in the cluster. return true when success */
+    /** attempt to add new_member in the cluster. return true when success.
+        Should be called before the member's init(). */
     bool join (const agent_ptr& new_member, const std::string& name)
     {
         std::lock_guard<std::mutex> l(mtx_);
         auto it = agents_.insert ({name, new_member});
-        if (it.second)
+        if (it.second) {
+            new_member->shareBroadcast = [=] (const std::string & router)
+                {
+                    this->subscribeBroadcast (router);
+                };
+            {
+                std::lock_guard<std::mutex> b(broadcastMtx_);
+                members_.push_back (new_member);
+            }
             this->addSource (name, new_member);
+        }
         return it.second ;
     }
 
@@ -85,6 +105,12 @@ public:
         std::lock_guard<std::mutex> l(mtx_);
         auto it = agents_.find(name);
         if (it != std::end(agents_)) {
+            {
+                std::lock_guard<std::mutex> b(broadcastMtx_);
+                members_.erase (std::remove (members_.begin(), members_.end(),
+                                             it->second),
+                                members_.end());
+            }
             removeSourceSync(it->second.get());
             it->second->shutdown();
             agents_.erase(it);
@@ -112,6 +138,24 @@ public:
 private:
     mutable std::mutex mtx_;
     std::unordered_map<std::string, std::shared_ptr<BiddingAgent>> agents_;
+
+    /** Subscribes to the auctions broadcast by the router for all of the
+        members, unless it's already done.  Called by the members as they
+        connect to the router. */
+    void subscribeBroadcast (const std::string & router);
+
+    /** Decodes a broadcast auction once and hands it to each of the
+        members whose slot is in it. */
+    void handleBroadcast (const std::string & router,
+                          const std::vector<zmq::message_t> & message);
+
+    void shutdownBroadcasts ();
+
+    /** Protects members_ and broadcasts_, which are used from the poll
+        loop; mtx_ is held while waiting on it in leave(). */
+    std::mutex broadcastMtx_;
+    std::vector<agent_ptr> members_;
+    std::map<std::string, std::shared_ptr<ZmqNamedSubscriber>> broadcasts_;
 };
 
 } /* namespace RTBKIT */
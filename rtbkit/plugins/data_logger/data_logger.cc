@@ -8,6 +8,8 @@
 
 
 #include "data_logger.h"
+#include "rtbkit/common/analytics_batch.h"
+#include "soa/logger/columnar_output.h"
 
 
 using namespace std;
@@ -49,6 +51,16 @@ init()
         s.reserve(msg.size());
         for (auto & m: msg)
             s.push_back(m.toString());
+
+        // Batches of events are logged as the messages they were made of
+        if (s.size() == 3 && s[0] == AnalyticsBatch::Channel) {
+            auto onEvent = [&] (vector<string> && event) {
+                this->logMessageNoTimestamp(event);
+            };
+            AnalyticsBatch::forEach(s[2], onEvent);
+            return;
+        }
+
         this->logMessageNoTimestamp(s);
     };
     loopMonitor_.init();
@@ -87,6 +99,29 @@ connectAllServiceProviders(const string & serviceClass, const string & epName)
     multipleSubscriber.connectAllServiceProviders(serviceClass, epName);
 }
 
+void
+DataLogger::
+logToColumnar(const string & filename,
+              const boost::regex & allowChannels,
+              const boost::regex & denyChannels)
+{
+    auto output = std::make_shared<ColumnarOutput>(filename);
+
+    // As published by the router and the post auction events
+    output->setColumnNames("AUCTION", { "timestamp", "auctionId" });
+    output->setColumnNames("BID",
+                           { "timestamp", "agent", "auctionId", "bids" });
+    output->setColumnNames("NOBUDGET", { "timestamp", "agent", "auctionId" });
+    output->setColumnNames("SUBMITTED",
+                           { "timestamp", "auctionId", "agent", "price" });
+    for (string type: { "WIN", "LOSS" })
+        output->setColumnNames("MATCHED" + type,
+                               { "timestamp", "auctionId", "account",
+                                 "winPrice", "rawWinPrice", "uids" });
+
+    addOutput(output, allowChannels, denyChannels);
+}
+
 /** MonitorProvider interface */
 string
 DataLogger::
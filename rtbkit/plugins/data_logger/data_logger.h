@@ -38,6 +38,14 @@ struct DataLogger : public Datacratic::ServiceBase,
     void connectAllServiceProviders(const std::string & serviceClass,
                                     const std::string & epName);
 
+    /** Log the messages to the given file in the columnar format of
+        ColumnarOutput, with the fields of the router and post auction
+        channels named.
+    */
+    void logToColumnar(const std::string & filename,
+                       const boost::regex & allowChannels = boost::regex(),
+                       const boost::regex & denyChannels = boost::regex());
+
     void unsafeDisableMonitor() {
         monitorProviderClient.disable();
     }
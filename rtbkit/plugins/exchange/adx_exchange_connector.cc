@@ -21,6 +21,7 @@
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "rtbkit/openrtb/openrtb_parsing.h"
 #include "soa/types/json_printing.h"
+#include "jml/arch/thread_specific.h"
 
 using namespace std;
 using namespace Datacratic;
@@ -196,6 +197,30 @@ typedef ::BidResponse GoogleBidResponse ;
 
 namespace {
 
+/** The protobuf messages are reused by each thread; Clear() keeps the memory
+    of their strings and sub-messages around for the next request.
+ */
+struct GbrTag {};
+ML::Thread_Specific<GoogleBidRequest, GbrTag> threadGbr;
+
+struct GrespTag {};
+ML::Thread_Specific<GoogleBidResponse, GrespTag> threadGresp;
+
+/** Hex encoding of the binary ids without going through a stream. */
+std::string
+binaryToHex(const std::string & str)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    std::string result(str.size() * 2, '0');
+    for (size_t i = 0; i < str.size(); ++i) {
+        unsigned char c = str[i];
+        result[2 * i] = digits[c >> 4];
+        result[2 * i + 1] = digits[c & 0xf];
+    }
+    return result;
+}
+
 /**
  *    void ParseGbrMobile ()
  *
@@ -515,41 +540,58 @@ parseBidRequest(HttpAuctionHandler & connection,
         return std::shared_ptr<BidRequest> ();
     }
 
+    DecodeStatus status;
+    auto res = decodeBidRequest(payload, status);
+
+    switch (status) {
+    case DECODED: break;
+
+    case DECODE_ERROR:
+        connection.sendErrorResponse("couldn't decode BidRequest message");
+        break;
+
+    // check if this BidRequest is handled by us;
+    // or it's a ping.
+    case PING:
+    case NOT_HANDLED: {
+        auto msg = status == PING ? "pingRequest" : "requestNotHandled" ;
+        connection.dropAuction (msg);
+        this->recordHit(msg);
+        break;
+    }
+    }
+
+    return res;
+}
+
+std::shared_ptr<BidRequest>
+AdXExchangeConnector::
+decodeBidRequest(const std::string & payload, DecodeStatus & status) const
+{
     // Try and parse the protocol buffer payload
-    GoogleBidRequest gbr;
+    GoogleBidRequest & gbr = *threadGbr;
+    gbr.Clear();
     if (!gbr.ParseFromString (payload))
     {
-        connection.sendErrorResponse("couldn't decode BidRequest message");
+        status = DECODE_ERROR;
         return std::shared_ptr<BidRequest> ();
     }
 
-    // check if this BidRequest is handled by us;
-    // or it's a ping.
     if (!GbrIsHandled(gbr) || gbr.is_ping())
     {
-        auto msg = gbr.is_ping() ? "pingRequest" : "requestNotHandled" ;
-        connection.dropAuction (msg);
-        this->recordHit(msg);
+        status = gbr.is_ping() ? PING : NOT_HANDLED;
         return std::shared_ptr<BidRequest> ();
     }
 
+    status = DECODED;
+
     std::shared_ptr<BidRequest> res (new BidRequest);
     res->timeAvailableMs = deadline_ms () ;
 
     auto& br = *res ;
 
-    // TODO: check reuse
-    auto binary_to_hexstr = [] (const std::string& str)
-    {
-        std::ostringstream os;
-        os << std::hex << std::setfill('0');
-        const unsigned char* pc = reinterpret_cast<const unsigned char*>(str.c_str()) ;
-        for (auto i=0 ; i<str.size(); i++,pc++) os << std::setw(2) << int(*pc) ;
-        return os.str() ;
-    };
-
     // TODO couldn't get Id() to represent correctly [required bytes id = 2;]
-    br.auctionId = Id (binary_to_hexstr(gbr.id()));
+    br.auctionId = Id (binaryToHex(gbr.id()));
     // AdX is a second price auction type.
 
     br.timestamp = Date::now();
@@ -642,7 +684,7 @@ parseBidRequest(HttpAuctionHandler & connection,
 
     if (gbr.has_hosted_match_data())
     {
-        br.user->buyeruid = Id(binary_to_hexstr(gbr.hosted_match_data()));
+        br.user->buyeruid = Id(binaryToHex(gbr.hosted_match_data()));
         // Provider ID is needed to map different bid requests to the same user
         br.userIds.add(br.user->buyeruid, ID_PROVIDER);
     }
@@ -654,7 +696,8 @@ parseBidRequest(HttpAuctionHandler & connection,
         }
         else if (gbr.has_ip() && has_user_agent){
             // Use a hashing function of IP + User Agent concatenation
-            br.userAgentIPHash = Id(CityHash64((gbr.ip() + gbr.user_agent()).c_str(),(gbr.ip() + gbr.user_agent()).length()));
+            std::string key = gbr.ip() + gbr.user_agent();
+            br.userAgentIPHash = Id(CityHash64(key.c_str(), key.length()));
             br.userIds.add(br.userAgentIPHash, ID_PROVIDER);
         }
         else {
@@ -742,7 +785,8 @@ getResponse(const HttpAuctionHandler & connection,
     if (current->hasError())
         return getErrorResponse(connection,current->error + ": " + current->details);
 
-    GoogleBidResponse gresp ;
+    GoogleBidResponse & gresp = *threadGresp;
+    gresp.Clear();
     gresp.set_processing_time_ms(static_cast<uint32_t>(auction.timeUsed()*1000));
 
     auto en = exchangeName();
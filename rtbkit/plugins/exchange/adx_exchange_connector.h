@@ -73,6 +73,23 @@ struct AdXExchangeConnector: public HttpExchangeConnector {
                     const HttpHeader & header,
                     const std::string & payload) ;
 
+    /** Outcome of decodeBidRequest(). */
+    enum DecodeStatus {
+        DECODED,        ///< Bid request we can bid on
+        DECODE_ERROR,   ///< Not a valid protobuf message
+        PING,           ///< Ping request, to be answered right away
+        NOT_HANDLED     ///< Bid request that we don't support
+    };
+
+    /** Decodes a serialized AdX bid request and maps it onto a BidRequest,
+        which is only returned if status is DECODED.
+
+        The protobuf message is kept per thread and reused from one request
+        to the next so that its buffers don't have to be allocated again.
+     */
+    std::shared_ptr<BidRequest>
+    decodeBidRequest(const std::string & payload, DecodeStatus & status) const;
+
     virtual double
     getTimeAvailableMs(HttpAuctionHandler & connection,
                        const HttpHeader & header,
@@ -377,12 +377,25 @@ parseBidRequest(HttpAuctionHandler & connection,
     return res;
 }
 
-void
+Id
 BidSwitchExchangeConnector::
-setSeatBid(Auction const & auction,
-           int spotNum,
-           OpenRTB::BidResponse & response) const {
+getSeat(Auction const & auction, int spotNum) const
+{
+    auto & resp = auction.getCurrentData()->winningResponse(spotNum);
+
+    const AgentConfig * config =
+        std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
 
+    // Get the exchange specific data for this campaign
+    return config->getProviderData<CampaignInfo>(exchangeName())->seat;
+}
+
+void
+BidSwitchExchangeConnector::
+writeBid(Auction const & auction,
+         int spotNum,
+         OpenRTBResponseWriter & writer) const
+{
     const Auction::Data * current = auction.getCurrentData();
 
     // Get the winning bid
@@ -406,26 +419,6 @@ setSeatBid(Auction const & auction,
     // Get the exchange specific data for this creative
     auto crinfo = creative.getProviderData<CreativeInfo>(en);
 
-    // Find the index in the seats array
-    int seatIndex = 0;
-    while(response.seatbid.size() != seatIndex) {
-        if(response.seatbid[seatIndex].seat == cpinfo->seat) break;
-        ++seatIndex;
-    }
-
-    // Create if required
-    if(seatIndex == response.seatbid.size()) {
-        response.seatbid.emplace_back();
-        response.seatbid.back().seat = cpinfo->seat;
-    }
-
-    // Get the seatBid object
-    OpenRTB::SeatBid & seatBid = response.seatbid.at(seatIndex);
-
-    // Add a new bid to the array
-    seatBid.bid.emplace_back();
-    auto & b = seatBid.bid.back();
-
     BidSwitchCreativeConfiguration::Context context {
         creative,
         resp,
@@ -433,19 +426,19 @@ setSeatBid(Auction const & auction,
         spotNum
     };
 
-    // Put in the variable parts
-    b.cid = Id(resp.agent);
-    b.id = Id(auction.id, auction.request->imp[0].id);
-    b.impid = auction.request->imp[spotNum].id;
-    b.price.val = USD_CPM(resp.price.maxPrice);
-    b.nurl = configuration_.expand(crinfo->nurl, context);
-    b.adid = crinfo->adid;
-    b.adomain = crinfo->adomain;
-    b.iurl = cpinfo->iurl;
-
-    if (!crinfo->adm.empty()) b.adm = configuration_.expand(crinfo->adm, context);
+    // Put in the variable parts, in the order of the OpenRTB bid
+    writer.writeId("id", Id(auction.id, auction.request->imp[0].id));
+    writer.writeId("impid", auction.request->imp[spotNum].id);
+    writer.writeDouble("price", USD_CPM(resp.price.maxPrice));
+    writer.writeId("adid", crinfo->adid);
+    writer.writeString("nurl", configuration_.expand(crinfo->nurl, context));
+    if (!crinfo->adm.empty())
+        writer.writeString("adm", configuration_.expand(crinfo->adm, context));
+    writer.writeStringList("adomain", crinfo->adomain);
+    writer.writeString("iurl", cpinfo->iurl);
+    writer.writeString("cid", resp.agent);
 
-    auto& ext = b.ext;
+    Json::Value ext;
     if (!crinfo->ext.advertiserName.empty())
        ext["advertiser_name"] = crinfo->ext.advertiserName;
     if (!crinfo->ext.agencyName.empty())
@@ -468,6 +461,8 @@ setSeatBid(Auction const & auction,
     if (!yieldOneExt.isNull()) {
         ext["yieldone"] = std::move(yieldOneExt);
     }
+
+    writer.writeJson("ext", ext);
 }
 
 Json::Value
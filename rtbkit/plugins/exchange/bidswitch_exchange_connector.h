@@ -118,9 +118,11 @@ struct BidSwitchExchangeConnector: public OpenRTBExchangeConnector {
     typedef TypedCreativeConfiguration<CreativeInfo> BidSwitchCreativeConfiguration;
     BidSwitchCreativeConfiguration configuration_;
     
-    virtual void setSeatBid(Auction const & auction,
-                            int spotNum,
-                            OpenRTB::BidResponse & response) const;
+    virtual Id getSeat(Auction const & auction, int spotNum) const;
+
+    virtual void writeBid(Auction const & auction,
+                          int spotNum,
+                          OpenRTBResponseWriter & writer) const;
 
     Json::Value
     getResponseExt(const HttpAuctionHandler& connection,
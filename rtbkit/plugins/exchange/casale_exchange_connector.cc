@@ -156,11 +156,25 @@ CasaleExchangeConnector::parseBidRequest(
 
 }
 
+Id
+CasaleExchangeConnector::getSeat(
+        const Auction& auction,
+        int spotNum) const {
+
+    auto& resp = auction.getCurrentData()->winningResponse(spotNum);
+
+    const AgentConfig* config
+        = std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
+
+    auto campaignInfo = config->getProviderData<CampaignInfo>(exchangeName());
+    return Id(campaignInfo->seat);
+}
+
 void
-CasaleExchangeConnector::setSeatBid(
+CasaleExchangeConnector::writeBid(
         const Auction& auction,
         int spotNum,
-        OpenRTB::BidResponse& response) const {
+        OpenRTBResponseWriter& writer) const {
 
     const Auction::Data *current = auction.getCurrentData();
 
@@ -170,34 +184,11 @@ CasaleExchangeConnector::setSeatBid(
         = std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
     std::string name = exchangeName();
 
-    auto campaignInfo = config->getProviderData<CampaignInfo>(name);
     int creativeIndex = resp.agentCreativeIndex;
 
     auto& creative = config->creatives[creativeIndex];
     auto creativeInfo = creative.getProviderData<CreativeInfo>(name);
 
-    // Find the index in the seats array
-    int seatIndex = indexOf(response.seatbid, &OpenRTB::SeatBid::seat, Id(campaignInfo->seat));
-
-    OpenRTB::SeatBid* seatBid;
-
-    // Creative the seat if it does not exist
-    if (seatIndex == -1) {
-        OpenRTB::SeatBid sbid;
-        sbid.seat = Id(campaignInfo->seat);
-
-        response.seatbid.push_back(std::move(sbid));
-
-        seatBid = &response.seatbid.back();
-    }
-    else {
-        seatBid = &response.seatbid[seatIndex];
-    }
-
-    ExcAssert(seatBid);
-    seatBid->bid.emplace_back();
-    auto& bid = seatBid->bid.back();
-
     CasaleCreativeConfiguration::Context context {
         creative,
         resp,
@@ -205,16 +196,15 @@ CasaleExchangeConnector::setSeatBid(
         spotNum
     };
 
-    bid.cid = Id(resp.agent);
-    bid.crid = Id(resp.creativeId);
-    bid.impid = auction.request->imp[spotNum].id;
-    bid.id = Id(auction.id, auction.request->imp[0].id);
-    bid.price.val = USD_CPM(resp.price.maxPrice);
+    writer.writeId("id", Id(auction.id, auction.request->imp[0].id));
+    writer.writeId("impid", auction.request->imp[spotNum].id);
+    double price = USD_CPM(resp.price.maxPrice);
     /* Prices are in Cents CPM */
-    bid.price.val *= 100;
-
-    if (!creativeInfo->adomain.empty()) bid.adomain = creativeInfo->adomain;
-    bid.adm = configuration_.expand(creativeInfo->adm, context);
+    writer.writeDouble("price", price * 100);
+    writer.writeString("adm", configuration_.expand(creativeInfo->adm, context));
+    writer.writeStringList("adomain", creativeInfo->adomain);
+    writer.writeString("cid", resp.agent);
+    writer.writeString("crid", std::to_string(resp.creativeId));
 
 }
 
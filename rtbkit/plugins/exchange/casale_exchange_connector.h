@@ -64,9 +64,11 @@ private:
     typedef TypedCreativeConfiguration<CreativeInfo> CasaleCreativeConfiguration;
     CasaleCreativeConfiguration configuration_;
     
-    void setSeatBid(const Auction& auction,
-                    int spotNum,
-                    OpenRTB::BidResponse& response) const;
+    Id getSeat(const Auction& auction, int spotNum) const;
+
+    void writeBid(const Auction& auction,
+                  int spotNum,
+                  OpenRTBResponseWriter& writer) const;
 
 };
 
@@ -0,0 +1,353 @@
+/* content_encoding.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   gzip and deflate Content-Encoding of the bid requests and responses.
+*/
+
+#include "content_encoding.h"
+#include "jml/arch/exception.h"
+#include "jml/arch/format.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/thread/tss.hpp>
+#include <zlib.h>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* ZLIB STREAMS                                                              */
+/*****************************************************************************/
+
+namespace {
+
+/** Accepts both the gzip and the zlib formats. */
+enum { AutoWindowBits = 15 + 32, RawWindowBits = -15 };
+
+struct Inflater : public z_stream {
+    Inflater()
+    {
+        memset(static_cast<z_stream *>(this), 0, sizeof(z_stream));
+        if (inflateInit2(this, AutoWindowBits) != Z_OK)
+            throw ML::Exception("inflateInit2 failed");
+    }
+
+    ~Inflater()
+    {
+        inflateEnd(this);
+    }
+
+    /** Decompresses the whole of data into out.  Returns false if the data
+        isn't in the format of windowBits.
+    */
+    bool run(int windowBits, const char * data, size_t length,
+             std::string & out, size_t maxBytes)
+    {
+        if (inflateReset2(this, windowBits) != Z_OK)
+            throw ML::Exception("inflateReset2 failed");
+
+        next_in = (Bytef *)data;
+        avail_in = length;
+
+        // Requests typically shrink 4 to 6 times; the buffer keeps its
+        // capacity so this rarely allocates.
+        out.resize(std::min(length * 6 + 1024, maxBytes + 1));
+
+        for (;;) {
+            next_out = (Bytef *)&out[total_out];
+            avail_out = out.size() - total_out;
+
+            int res = inflate(this, Z_NO_FLUSH);
+
+            if (res == Z_STREAM_END) {
+                out.resize(total_out);
+                return true;
+            }
+            if (res == Z_DATA_ERROR)
+                return false;
+            if (res != Z_OK && res != Z_BUF_ERROR)
+                throw ML::Exception("inflate failed with error %d", res);
+
+            if (avail_out == 0) {
+                if (out.size() > maxBytes)
+                    throw ML::Exception("body decompresses to more than %zd "
+                                        "bytes", maxBytes);
+                out.resize(std::min(out.size() * 2, maxBytes + 1));
+            }
+            else if (avail_in == 0)
+                throw ML::Exception("truncated compressed body");
+        }
+    }
+};
+
+struct Deflater : public z_stream {
+    Deflater()
+        : initialized(false), level(0), windowBits(0)
+    {
+        memset(static_cast<z_stream *>(this), 0, sizeof(z_stream));
+    }
+
+    ~Deflater()
+    {
+        if (initialized) deflateEnd(this);
+    }
+
+    /** Ready the stream for new data, only allocating a new one when the
+        parameters change.
+    */
+    void reset(int level, int windowBits)
+    {
+        if (initialized
+            && level == this->level && windowBits == this->windowBits) {
+            if (deflateReset(this) != Z_OK)
+                throw ML::Exception("deflateReset failed");
+            return;
+        }
+
+        if (initialized) deflateEnd(this);
+        initialized = false;
+
+        int res = deflateInit2(this, level, Z_DEFLATED, windowBits, 8,
+                               Z_DEFAULT_STRATEGY);
+        if (res != Z_OK)
+            throw ML::Exception("deflateInit2 failed with error %d", res);
+
+        initialized = true;
+        this->level = level;
+        this->windowBits = windowBits;
+    }
+
+    bool initialized;
+    int level;
+    int windowBits;
+};
+
+/** Streams and buffer of each thread, reused from one request to the next. */
+struct ThreadStreams {
+    Inflater inflater;
+    Deflater deflater;
+    std::string buffer;
+};
+
+boost::thread_specific_ptr<ThreadStreams> threadStreams;
+
+ThreadStreams & getThreadStreams()
+{
+    if (!threadStreams.get())
+        threadStreams.reset(new ThreadStreams());
+    return *threadStreams;
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* CONTENT CODING                                                            */
+/*****************************************************************************/
+
+ContentCoding
+parseContentCoding(const std::string & name)
+{
+    string coding = boost::to_lower_copy(boost::trim_copy(name));
+
+    if (coding.empty() || coding == "identity") return CC_IDENTITY;
+    if (coding == "gzip" || coding == "x-gzip") return CC_GZIP;
+    if (coding == "deflate") return CC_DEFLATE;
+    return CC_UNKNOWN;
+}
+
+const char *
+contentCodingName(ContentCoding coding)
+{
+    switch (coding) {
+    case CC_IDENTITY: return "identity";
+    case CC_GZIP:     return "gzip";
+    case CC_DEFLATE:  return "deflate";
+    default:          return "unknown";
+    }
+}
+
+bool
+acceptsContentCoding(const std::string & acceptEncoding,
+                     ContentCoding coding)
+{
+    if (coding == CC_IDENTITY) return true;
+    if (coding == CC_UNKNOWN) return false;
+
+    // Each entry is a coding, possibly followed by a quality where 0 means
+    // that it's refused; an explicit entry wins over the * wildcard.
+    bool wildcard = false;
+
+    vector<string> entries;
+    boost::split(entries, acceptEncoding, boost::is_any_of(","));
+
+    for (const string & entry : entries) {
+        vector<string> params;
+        boost::split(params, entry, boost::is_any_of(";"));
+
+        double quality = 1.0;
+        for (size_t i = 1;  i < params.size();  ++i) {
+            string param = boost::trim_copy(params[i]);
+            if (param.compare(0, 2, "q=") == 0)
+                quality = strtod(param.c_str() + 2, nullptr);
+        }
+
+        string name = boost::trim_copy(params[0]);
+        if (name == "*") wildcard = quality > 0.0;
+        else if (parseContentCoding(name) == coding)
+            return quality > 0.0;
+    }
+
+    return wildcard;
+}
+
+void
+decompressBody(const char * data, size_t length, ContentCoding coding,
+               std::string & out, size_t maxBytes)
+{
+    if (coding == CC_IDENTITY) {
+        if (length > maxBytes)
+            throw ML::Exception("body of %zd bytes is too large", length);
+        out.assign(data, length);
+        return;
+    }
+
+    if (coding != CC_GZIP && coding != CC_DEFLATE)
+        throw ML::Exception("unsupported content coding");
+
+    Inflater & inflater = getThreadStreams().inflater;
+    if (inflater.run(AutoWindowBits, data, length, out, maxBytes))
+        return;
+
+    // Some servers send raw deflate data without the zlib header.
+    if (coding == CC_DEFLATE
+        && inflater.run(RawWindowBits, data, length, out, maxBytes))
+        return;
+
+    throw ML::Exception("corrupt %s body", contentCodingName(coding));
+}
+
+void
+compressBody(const char * data, size_t length, ContentCoding coding,
+             int level, std::string & out)
+{
+    int windowBits;
+    switch (coding) {
+    case CC_GZIP:    windowBits = 15 + 16;  break;
+    case CC_DEFLATE: windowBits = 15;       break;
+    default:
+        throw ML::Exception("can't compress with %s",
+                            contentCodingName(coding));
+    }
+
+    Deflater & deflater = getThreadStreams().deflater;
+    deflater.reset(level, windowBits);
+
+    out.resize(deflateBound(&deflater, length));
+
+    deflater.next_in = (Bytef *)data;
+    deflater.avail_in = length;
+    deflater.next_out = (Bytef *)&out[0];
+    deflater.avail_out = out.size();
+
+    int res = deflate(&deflater, Z_FINISH);
+    if (res != Z_STREAM_END)
+        throw ML::Exception("deflate failed with error %d", res);
+
+    out.resize(deflater.total_out);
+}
+
+
+/*****************************************************************************/
+/* CONTENT ENCODING                                                          */
+/*****************************************************************************/
+
+ContentEncoding::
+ContentEncoding()
+    : decompressRequests(true), maxRequestBytes(4 * 1024 * 1024),
+      responseCoding(CC_IDENTITY), level(1), minResponseBytes(256)
+{
+}
+
+void
+ContentEncoding::
+configure(const Json::Value & config)
+{
+    if (config.isNull()) return;
+
+    decompressRequests
+        = config.get("decompressRequests", decompressRequests).asBool();
+    maxRequestBytes
+        = config.get("maxRequestBytes", Json::UInt(maxRequestBytes)).asUInt();
+    level = config.get("level", level).asInt();
+    minResponseBytes
+        = config.get("minResponseBytes", Json::UInt(minResponseBytes))
+          .asUInt();
+
+    if (config.isMember("compressResponses")) {
+        string name = config["compressResponses"].asString();
+        responseCoding = parseContentCoding(name);
+        if (responseCoding == CC_UNKNOWN)
+            throw ML::Exception("unknown response content coding '%s'",
+                                name.c_str());
+    }
+
+    if (level < 1 || level > 9)
+        throw ML::Exception("compression level must be between 1 and 9");
+}
+
+const std::string &
+ContentEncoding::
+decodeRequest(const HttpHeader & header, const std::string & payload) const
+{
+    auto it = header.headers.find("content-encoding");
+    if (it == header.headers.end()) return payload;
+
+    ContentCoding coding = parseContentCoding(it->second);
+    if (coding == CC_IDENTITY) return payload;
+
+    if (coding == CC_UNKNOWN || !decompressRequests)
+        throw ML::Exception("unsupported Content-Encoding '%s'",
+                            it->second.c_str());
+
+    string & buffer = getThreadStreams().buffer;
+    decompressBody(payload.data(), payload.size(), coding,
+                   buffer, maxRequestBytes);
+    return buffer;
+}
+
+bool
+ContentEncoding::
+encodeResponse(const HttpHeader & request, HttpResponse & response) const
+{
+    if (responseCoding == CC_IDENTITY
+        || !response.sendBody
+        || response.body.size() < minResponseBytes)
+        return false;
+
+    if (!acceptsContentCoding(request.tryGetHeader("accept-encoding"),
+                              responseCoding))
+        return false;
+
+    string body;
+    compressBody(response.body.data(), response.body.size(), responseCoding,
+                 level, body);
+
+    // Incompressible bodies are sent as they are.
+    if (body.size() >= response.body.size()) return false;
+
+    response.body.swap(body);
+    response.extraHeaders.push_back(
+            { "Content-Encoding", contentCodingName(responseCoding) });
+    return true;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,104 @@
+/* content_encoding.h                                              -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   gzip and deflate Content-Encoding of the bid requests and responses
+   exchanged with the exchanges.
+*/
+
+#pragma once
+
+#include "soa/service/http_header.h"
+#include "soa/service/http_endpoint.h"
+#include "soa/jsoncpp/json.h"
+#include <string>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* CONTENT CODING                                                            */
+/*****************************************************************************/
+
+enum ContentCoding {
+    CC_IDENTITY,
+    CC_GZIP,
+    CC_DEFLATE,   ///< zlib format as per the HTTP spec; raw deflate is accepted
+    CC_UNKNOWN
+};
+
+/** Parses the value of a Content-Encoding header; an empty one is identity. */
+ContentCoding parseContentCoding(const std::string & name);
+
+const char * contentCodingName(ContentCoding coding);
+
+/** Whether the value of an Accept-Encoding header allows the coding. */
+bool acceptsContentCoding(const std::string & acceptEncoding,
+                          ContentCoding coding);
+
+/** Decompresses data into out, which is resized to the decompressed size
+    but keeps its capacity from one call to the next.  Throws if the data is
+    corrupt or truncated, or if it decompresses to more than maxBytes.
+*/
+void decompressBody(const char * data, size_t length, ContentCoding coding,
+                    std::string & out, size_t maxBytes);
+
+/** Compresses data at the given zlib level (1 to 9). */
+void compressBody(const char * data, size_t length, ContentCoding coding,
+                  int level, std::string & out);
+
+
+/*****************************************************************************/
+/* CONTENT ENCODING                                                          */
+/*****************************************************************************/
+
+/** Content-Encoding support of an HTTP exchange connector, configured by the
+    "contentEncoding" object of its configuration:
+
+    - decompressRequests: whether gzip and deflate encoded bid requests are
+      accepted (default true); when false they are rejected as invalid;
+    - maxRequestBytes: largest decompressed request (default 4MB), which
+      keeps a small corrupt or hostile body from eating all the memory;
+    - compressResponses: "gzip" or "deflate" to compress the responses for
+      the exchanges whose requests accept it (default none);
+    - level: zlib compression level of the responses (default 1, the
+      fastest, as responses are small and latency matters more);
+    - minResponseBytes: responses shorter than this are sent as is (default
+      256) as they would barely shrink.
+
+    The zlib streams and the decompression buffer belong to the calling
+    thread and are reused from one request to the next, so that a busy
+    connector doesn't allocate them over and over.  All the methods are
+    thread safe.
+*/
+struct ContentEncoding {
+
+    ContentEncoding();
+
+    void configure(const Json::Value & config);
+
+    /** Returns the body of the request, decompressed according to its
+        Content-Encoding.  A decompressed body is held in the buffer of the
+        calling thread, so the reference is only valid until the next call
+        on the same thread.  Throws if the coding isn't supported or if the
+        body can't be decompressed.
+    */
+    const std::string & decodeRequest(const Datacratic::HttpHeader & header,
+                                      const std::string & payload) const;
+
+    /** Compresses the body of the response if it's enabled, accepted by the
+        request and worth it, and sets its Content-Encoding header.  Returns
+        whether the body was compressed.
+    */
+    bool encodeResponse(const Datacratic::HttpHeader & request,
+                        Datacratic::HttpResponse & response) const;
+
+    bool decompressRequests;
+    size_t maxRequestBytes;
+    ContentCoding responseCoding;
+    int level;
+    size_t minResponseBytes;
+};
+
+} // namespace RTBKIT
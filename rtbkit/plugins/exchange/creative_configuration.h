@@ -9,13 +9,16 @@
 #include <string>
 #include <vector>
 #include <map>
-
-#include <boost/thread.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "rtbkit/common/exchange_connector.h"
 #include "rtbkit/common/auction.h"
 #include "rtbkit/common/expand_variable.h"
 #include "rtbkit/common/creative_field.h"
+#include "soa/gc/gc_lock.h"
+#include "soa/gc/rcu_protected.h"
 
 namespace RTBKIT {
 
@@ -84,7 +87,8 @@ public:
     struct Expander;
 
     TypedCreativeConfiguration(const std::string& exchange)
-        : CreativeConfiguration(exchange)
+        : CreativeConfiguration(exchange),
+          expanders_(expandersGc_)
     { }
 
     Field & addField(const std::string & name,
@@ -106,18 +110,24 @@ private:
     extractVariables(const std::string& snippet) const;
 
     Expander
-    generateExpander(const std::vector<ExpandVariable>& variables) const;
+    generateExpander(const std::string& snippet,
+                     const std::vector<ExpandVariable>& variables) const;
 
     ExpanderCallable getAssociatedCallable(ExpandVariable const& var) const;
     std::string jsonValueToStr(Json::Value const& val) const;
 
     /**
-     * The map is mutable because it is populated in the
-     * getCreativeCompatibility and this member function is required to be
-     * const
+     * The snippets compiled by handleCreativeCompatibility. The map is never
+     * modified once published: a new version is swapped in under RCU
+     * whenever a snippet is added, so that expand() can be called from any
+     * number of threads without locking. It is mutable because
+     * handleCreativeCompatibility is required to be const.
      */
-    mutable std::unordered_map<std::string, Expander> expanders_;
-    mutable boost::shared_mutex mutex_;
+    typedef std::unordered_map<std::string, std::shared_ptr<const Expander> >
+        Expanders;
+    mutable Datacratic::GcLock expandersGc_;
+    mutable Datacratic::RcuProtected<Expanders> expanders_;
+    mutable std::mutex expandersLock_; // Serializes the updates
 
     std::map<std::string, Field> fields_;
 };
@@ -128,38 +138,42 @@ const std::string TypedCreativeConfiguration<CreativeData>::VARIABLE_MARKER_BEGI
 template<typename CreativeData>
 const std::string TypedCreativeConfiguration<CreativeData>::VARIABLE_MARKER_END = "}";
 
+/**
+ * Snippet compiled into the list of its literal parts, each followed by the
+ * callable that expands the variable after it.
+ */
 template<typename CreativeData>
 struct TypedCreativeConfiguration<CreativeData>::Expander
 {
-    typedef std::vector<std::pair<ExpandVariable, ExpanderCallable>> FunctorCollection;
-
-    void addFunctor(const ExpandVariable& var, ExpanderCallable fn)
+    struct Segment
     {
-        collection.push_back(std::make_pair(var, fn));
-    }
+        std::string literal;
+        ExpanderCallable variable; // null for the text after the last one
+    };
 
-    void finalize()
+    Expander() : literalSize(0) {}
+
+    void addSegment(std::string literal, ExpanderCallable variable)
     {
-        std::reverse(collection.begin(), collection.end());
+        literalSize += literal.size();
+        segments.push_back(Segment{std::move(literal), std::move(variable)});
     }
 
-    std::string expand(std::string toExpand, const Context& ctx) const
+    std::string expand(const Context& ctx) const
     {
-        for (auto& element : collection) {
-            auto const& var = element.first;
-            auto const& fn = element.second;
-
-            auto const& location = var.getReplaceLocation();
+        std::string result;
+        result.reserve(literalSize + segments.size() * 32);
 
-            toExpand.replace(
-                location.first, location.second - location.first, fn(ctx));
+        for (auto& segment : segments) {
+            result.append(segment.literal);
+            if (segment.variable) result.append(segment.variable(ctx));
         }
 
-        return toExpand;
+        return result;
     }
 
-    FunctorCollection collection;
-
+    std::vector<Segment> segments;
+    size_t literalSize;
 };
 
 
@@ -225,9 +239,16 @@ TypedCreativeConfiguration<CreativeData>::handleCreativeCompatibility(
             if (field.isSnippet()) {
                 // assume string
                 auto const& snippet = value.asString();
-                auto expander = generateExpander(extractVariables(snippet));
-                boost::unique_lock<boost::shared_mutex> lock(mutex_);
-                expanders_[snippet] = expander;
+                auto expander = std::make_shared<const Expander>(
+                        generateExpander(snippet, extractVariables(snippet)));
+
+                std::lock_guard<std::mutex> guard(expandersLock_);
+                auto current = expanders_();
+                if (!current->count(snippet)) {
+                    std::unique_ptr<Expanders> expanders(new Expanders(*current));
+                    (*expanders)[snippet] = std::move(expander);
+                    expanders_.replace(expanders.release());
+                }
             }
         }
     }
@@ -324,10 +345,17 @@ TypedCreativeConfiguration<CreativeData>::getAssociatedCallable(
 template <typename CreativeData>
 typename TypedCreativeConfiguration<CreativeData>::Expander
 TypedCreativeConfiguration<CreativeData>::generateExpander(
+    const std::string& snippet,
     const std::vector<ExpandVariable>& variables) const
 {
     Expander expander;
+    size_t position = 0;
+
     for (auto const& variable : variables) {
+        auto const& location = variable.getReplaceLocation();
+        auto literal = snippet.substr(position, location.first - position);
+        position = location.second;
+
         auto callable = getAssociatedCallable(variable);
 
         ExpanderFilterCallable filterFn;
@@ -353,19 +381,21 @@ TypedCreativeConfiguration<CreativeData>::generateExpander(
 
         if (filterFn) {
 
-            expander.addFunctor(
-                    variable,
+            expander.addSegment(
+                    std::move(literal),
                     [filterFn, callable](Context const & ctx) {
                         std::string result = callable(ctx);
                         filterFn(result);
                         return result;
             });
         } else {
-            expander.addFunctor(variable, callable);
+            expander.addSegment(std::move(literal), callable);
         }
     }
 
-    expander.finalize();
+    if (position < snippet.size())
+        expander.addSegment(snippet.substr(position), ExpanderCallable());
+
     return expander;
 }
 
@@ -398,9 +428,14 @@ std::string
 TypedCreativeConfiguration<CreativeData>::expand(const std::string& templateString,
                                             const Context& context) const
 {
-    boost::shared_lock<boost::shared_mutex> lock(mutex_);
-    auto const& expander = expanders_[templateString];
-    return expander.expand(templateString, context);
+    auto expanders = expanders_();
+
+    // Snippets that weren't seen by handleCreativeCompatibility have
+    // nothing to expand.
+    auto it = expanders->find(templateString);
+    if (it == expanders->end()) return templateString;
+
+    return it->second->expand(context);
 }
 
 
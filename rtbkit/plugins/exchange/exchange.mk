@@ -3,14 +3,17 @@
 LIBRTB_EXCHANGE_SOURCES := \
 	http_exchange_connector.cc \
 	http_auction_handler.cc \
+	content_encoding.cc \
+	value_shedder.cc \
+	request_sampler.cc \
 	creative_configuration.cc
 
 LIBRTB_EXCHANGE_LINK := \
-	zeromq boost_thread utils endpoint services rtb bid_request
+	zeromq boost_thread utils endpoint services rtb bid_request gc z logger
 
 $(eval $(call library,exchange,$(LIBRTB_EXCHANGE_SOURCES),$(LIBRTB_EXCHANGE_LINK)))
 
-$(eval $(call library,openrtb_exchange,openrtb_exchange_connector.cc,exchange bid_test_utils openrtb_bid_request))
+$(eval $(call library,openrtb_exchange,openrtb_exchange_connector.cc openrtb_response_writer.cc,exchange bid_test_utils openrtb_bid_request))
 $(eval $(call library,rubicon_exchange,rubicon_exchange_connector.cc,openrtb_exchange))
 $(eval $(call library,mopub_exchange,mopub_exchange_connector.cc,openrtb_exchange))
 $(eval $(call library,smaato_exchange,smaato_exchange_connector.cc,openrtb_exchange))
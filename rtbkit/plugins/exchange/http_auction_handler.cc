@@ -7,6 +7,7 @@
 
 #include "http_auction_handler.h"
 #include "http_exchange_connector.h"
+#include "request_sampler.h"
 
 #include "jml/arch/exception.h"
 #include "jml/arch/format.h"
@@ -16,6 +17,8 @@
 #include "jml/utils/vector_utils.h"
 #include "jml/arch/timers.h"
 #include <set>
+#include <atomic>
+#include <sstream>
 
 #include <boost/foreach.hpp>
 
@@ -134,9 +137,24 @@ parse(const std::string & filename,
 long HttpAuctionHandler::created = 0;
 long HttpAuctionHandler::destroyed = 0;
 
+/** Step of the bid request pipeline that the request is waiting on.  Either
+    the pipeline calling back or the timeout carries on with the request,
+    whichever gets to set done first.
+*/
+struct HttpAuctionHandler::PipelineStep {
+    PipelineStep(void (HttpAuctionHandler::* next) (PipelineStatus))
+        : next(next), done(false)
+    {
+    }
+
+    void (HttpAuctionHandler::* next) (PipelineStatus);
+    std::atomic<bool> done;
+};
+
 HttpAuctionHandler::
 HttpAuctionHandler()
-    : hasTimer(false), disconnected(false), servingRequest(false)
+    : hasTimer(false), disconnected(false), servingRequest(false),
+      pipelineTimeAvailableMs(0.0)
 {
     atomic_add(created, 1);
 }
@@ -174,6 +192,18 @@ onGotTransport()
     startReading();
 }
 
+void
+HttpAuctionHandler::
+onGotPipelinedRequest()
+{
+    this->endpoint = dynamic_cast<HttpExchangeConnector *>(get_endpoint());
+    if (!this->endpoint)
+        throw Exception("HttpAuctionHandler needs to be owned by an "
+                        "HttpExchangeConnector");
+
+    HttpConnectionHandler::onGotPipelinedRequest();
+}
+
 void
 HttpAuctionHandler::
 handleDisconnect()
@@ -191,6 +221,22 @@ handleTimeout(Date date, size_t cookie)
 {
     checkMagic();
 
+    // The timers of the pipelined requests go through the connection
+    if (isPipelineOwner()) {
+        HttpConnectionHandler::handleTimeout(date, cookie);
+        return;
+    }
+
+    if (cookie == PIPELINE_TIMEOUT) {
+        auto step = pipelineStep;
+        if (!step || step->done.exchange(true))
+            return;  // the pipeline got there first
+
+        doEvent("pipelineTimeout");
+        finishPipelineStep(step, PipelineStatus::Continue);
+        return;
+    }
+
     std::shared_ptr<Auction> auction_ = auction;
     if (auction->tooLate()) return;  // was sent before timeout
 
@@ -221,7 +267,7 @@ cancelTimer()
     //cerr << "cancelling timer" << endl;
 
     addActivityS("cancelTimer");
-    ConnectionHandler::cancelTimer();
+    cancelRequestTimer();
     hasTimer = false;
 }
 
@@ -231,8 +277,17 @@ onDisassociate()
 {
     //cerr << "onDisassociate" << endl;
 
+    HttpConnectionHandler::onDisassociate();
+
     cancelTimer();
 
+    /* Pipeline stages that are still running mustn't carry on with the
+       request. */
+    if (pipelineStep) {
+        pipelineStep->done = true;
+        pipelineStep.reset();
+    }
+
     /* We need to make sure that the handler doesn't try to send us
        anything. */
     if (auction && !auction->tooLate()) {
@@ -297,6 +352,12 @@ handleHttpPayload(const HttpHeader & header,
         logger->recordRequest(header, payload);
     }
 
+    if (sampler && sampler->sample()) {
+        std::ostringstream stream;
+        stream << header << payload;
+        sampledRequest = stream.str();
+    }
+
     ML::atomic_add(endpoint->numRequests, 1);
 
     doEvent("auctionReceived");
@@ -307,11 +368,13 @@ handleHttpPayload(const HttpHeader & header,
 
     addActivityS("handleHttpPayload");
 
-    stopReading();
+    // The connection keeps reading the requests pipelined behind this one
+    if (!isPipelinedRequest())
+        stopReading();
 
     // First check if we are authorized to bid.  If not we drop the auction
     // with prejudice.
-    Date now = Date::now();
+    Date now = Date::nowFast();
 
     if (!endpoint->isEnabled(now)) {
         doEvent("auctionEarlyDrop.notEnabled");
@@ -320,7 +383,22 @@ handleHttpPayload(const HttpHeader & header,
     }
 
     double acceptProbability = endpoint->acceptAuctionProbability;
-    if (acceptProbability < 1.0
+
+    // Drop the same fraction of the requests as below, but the ones that
+    // are worth the least rather than random ones
+    double value = endpoint->valueShedder.enabled()
+        ? endpoint->getRequestValue(header, payload) : -1.0;
+    if (value >= 0.0) {
+        double keep = 1.0 - endpoint->loadShedder.shedProbability();
+        if (!endpoint->disableAcceptProbability)
+            keep *= acceptProbability;
+        if (endpoint->valueShedder.shed(value, 1.0 - keep)) {
+            doEvent("auctionEarlyDrop.valueShedding");
+            dropAuction("value shedding");
+            return;
+        }
+    }
+    else if (acceptProbability < 1.0
         && random() % 1000000 > 1000000 * acceptProbability) {
         // early drop...
         doEvent("auctionEarlyDrop.randomEarlyDrop");
@@ -330,8 +408,43 @@ handleHttpPayload(const HttpHeader & header,
         }
     }
 
-    double timeAvailableMs = getTimeAvailableMs(header, payload);
-    double networkTimeMs = getRoundTripTimeMs(header);
+    if (value < 0.0 && endpoint->loadShedder.shedRequest()) {
+        doEvent("auctionEarlyDrop.loadShedding");
+        dropAuction("load shedding");
+        return;
+    }
+
+    // The pipeline can finish after we return, so keep hold of the request,
+    // decompressed now that the cheap reasons to drop it are out of the way.
+    pipelineHeader = header;
+    Date beforeDecode = Date::nowFast();
+    try {
+        const std::string & body
+            = endpoint->contentEncoding.decodeRequest(header, payload);
+
+        if (&body != &payload) {
+            double decodeMs
+                = Date::nowFast().secondsSince(beforeDecode) * 1000.0;
+            doEvent("auctionBodyDecodeMs", ET_OUTCOME, decodeMs, "ms");
+            doEvent("auctionBodyDecodedLength", ET_OUTCOME, body.size(),
+                    "bytes");
+            doEvent("auctionBodyBytesSaved", ET_COUNT,
+                    double(body.size()) - double(payload.size()), "bytes");
+
+            pipelineHeader.headers.erase("content-encoding");
+            pipelineHeader.contentLength = body.size();
+        }
+
+        pipelinePayload = body;
+    } catch (const std::exception & exc) {
+        doEvent("auctionEarlyDrop.badContentEncoding");
+        sendErrorResponse("INVALID_CONTENT_ENCODING", exc.what());
+        return;
+    }
+
+    double timeAvailableMs = getTimeAvailableMs(pipelineHeader,
+                                                pipelinePayload);
+    double networkTimeMs = getRoundTripTimeMs(pipelineHeader);
 
     doEvent("auctionStartLatencyMs",
             ET_OUTCOME,
@@ -359,6 +472,98 @@ handleHttpPayload(const HttpHeader & header,
         return;
     }
 
+    // We always give ourselves 5ms to bid in, no matter what (let upstream
+    // deal with it if it's really that much too slow).
+    Date expiry = firstData.plusSeconds
+        (max(5.0, (timeAvailableMs - networkTimeMs)) / 1000.0);
+
+    pipelineStart = now;
+    pipelineExpiry = expiry;
+    pipelineTimeAvailableMs = timeAvailableMs;
+
+    runPipelineStep(&HttpAuctionHandler::afterPreBidRequest,
+                    [=] (Date deadline, const OnPipelineDone & onDone)
+        {
+            endpoint->preBidRequestAsync(pipelineHeader, pipelinePayload,
+                                         deadline, onDone);
+        });
+}
+
+void
+HttpAuctionHandler::
+runPipelineStep(void (HttpAuctionHandler::* next) (PipelineStatus),
+                const std::function<void (Date, const OnPipelineDone &)> & start)
+{
+    auto step = std::make_shared<PipelineStep>(next);
+    pipelineStep = step;
+
+    Date deadline = pipelineExpiry;
+    if (endpoint->pipelineTimeMaxMs >= 0.0)
+        deadline = std::min(deadline, Date::nowFast().plusSeconds
+                            (endpoint->pipelineTimeMaxMs / 1000.0));
+
+    auto handler = shared_from_this();
+
+    auto onDone = [=] (PipelineStatus status)
+        {
+            if (step->done.exchange(true))
+                return;  // timed out or disconnected
+
+            auto finish = [=] ()
+                {
+                    handler->finishPipelineStep(step, status);
+                };
+
+            if (handler->transport().lockedByThisThread())
+                finish();
+            else handler->transport().doAsync(finish, "AsyncPipeline");
+        };
+
+    try {
+        start(deadline, onDone);
+    } catch (const std::exception & exc) {
+        // Thrown after the step finished, by the rest of the request
+        if (step->done.exchange(true))
+            throw;
+
+        pipelineStep.reset();
+
+        std::stringstream details;
+        details << "Error parsing bid request : " <<  exc.what() << std::endl;
+        sendErrorResponse("INVALID_BID_REQUEST" , details.str() );
+        return;
+    }
+
+    // Stages that answer straight away have already moved the request on.
+    if (!step->done) {
+        scheduleRequestTimer(deadline, PIPELINE_TIMEOUT);
+        hasTimer = true;
+    }
+}
+
+void
+HttpAuctionHandler::
+finishPipelineStep(const std::shared_ptr<PipelineStep> & step,
+                   PipelineStatus status)
+{
+    if (pipelineStep != step)
+        return;
+
+    pipelineStep.reset();
+    cancelTimer();
+
+    (this->*step->next)(status);
+}
+
+void
+HttpAuctionHandler::
+afterPreBidRequest(PipelineStatus status)
+{
+    if (status == PipelineStatus::Stop) {
+        dropAuction("pre bid request pipeline");
+        return;
+    }
+
     /* This is the callback that the auction will call once finish()
        has been called on it.  It will be called exactly once.
     */
@@ -380,21 +585,10 @@ handleHttpPayload(const HttpHeader & header,
                              "AsyncSendResponse");
             }
         };
-    
-    // We always give ourselves 5ms to bid in, no matter what (let upstream
-    // deal with it if it's really that much too slow).
-    Date expiry = firstData.plusSeconds
-        (max(5.0, (timeAvailableMs - networkTimeMs)) / 1000.0);
 
     try {
 
-        auto preStatus = endpoint->preBidRequest(header, payload);
-        if (preStatus == PipelineStatus::Stop) {
-            dropAuction("pre bid request pipeline");
-            return;
-        }
-
-        auto bidRequest = parseBidRequest(header, payload);
+        auto bidRequest = parseBidRequest(pipelineHeader, pipelinePayload);
 
         if (!bidRequest) {
             endpoint->recordHit("error.noBidRequest");
@@ -403,33 +597,26 @@ handleHttpPayload(const HttpHeader & header,
             return;
         }
 
-        auction.reset(new Auction(endpoint,
-                                  handleAuction, bidRequest,
-                                  bidRequest->toJsonStr(),
-                                  "datacratic",
-                                  firstData, expiry));
+        auction = endpoint->auctionPool->getAuction(endpoint,
+                                                    handleAuction, bidRequest,
+                                                    bidRequest->toJsonStr(),
+                                                    "datacratic",
+                                                    firstData, pipelineExpiry);
 
-        auction->requestOriginal = payload;
+        auction->requestOriginal = pipelinePayload;
         endpoint->adjustAuction(auction);
 
-        auto postStatus = endpoint->postBidRequest(auction);
-        if (postStatus == PipelineStatus::Stop) {
-            dropAuction("post bid request pipeline");
-            return;
-        }
-
-
 #if 0
         static std::mutex lock;
         std::unique_lock<std::mutex> guard(lock);
-        cerr << "bytes before = " << payload.size() << " after "
+        cerr << "bytes before = " << pipelinePayload.size() << " after "
              << auction->requestStr.size() << " ratio "
-             << 100.0 * auction->requestStr.size() / payload.size()
+             << 100.0 * auction->requestStr.size() / pipelinePayload.size()
              << "%" << endl;
         string s = bidRequest->serializeToString();
-        cerr << "serialized bytes before = " << payload.size() << " after "
-             << s.size() << " ratio "
-             << 100.0 * s.size() / payload.size() << "%" << endl;
+        cerr << "serialized bytes before = " << pipelinePayload.size()
+             << " after " << s.size() << " ratio "
+             << 100.0 * s.size() / pipelinePayload.size() << "%" << endl;
 #endif
 
     } catch (const std::exception & exc) {
@@ -440,6 +627,28 @@ handleHttpPayload(const HttpHeader & header,
         return;
     }
 
+    auto auction = this->auction;
+
+    runPipelineStep(&HttpAuctionHandler::afterPostBidRequest,
+                    [=] (Date deadline, const OnPipelineDone & onDone)
+        {
+            endpoint->postBidRequestAsync(auction, deadline, onDone);
+        });
+}
+
+void
+HttpAuctionHandler::
+afterPostBidRequest(PipelineStatus status)
+{
+    if (status == PipelineStatus::Stop) {
+        dropAuction("post bid request pipeline");
+        return;
+    }
+
+    Date now = pipelineStart;
+    Date expiry = pipelineExpiry;
+    double timeAvailableMs = pipelineTimeAvailableMs;
+
     doEvent("auctionNetworkLatencyMs",
             ET_OUTCOME,
             (firstData.secondsSince(auction->request->timestamp)) * 1000.0,
@@ -453,14 +662,17 @@ handleHttpPayload(const HttpHeader & header,
     doEvent("auctionStart");
 
     addActivity("gotAuction %s", auction->id.toString().c_str());
-    
-    if (now > expiry) {
+
+    // The pipeline may have taken up some of the time
+    Date started = Date::nowFast();
+
+    if (started > expiry) {
         doEvent("auctionAlreadyExpired");
 
         string msg = format("auction started after time already elapsed: "
                             "%s vs %s, available time = %.1fms, "
                             "firstData = %s",
-                            now.print(4).c_str(),
+                            started.print(4).c_str(),
                             expiry.print(4).c_str(),
                             timeAvailableMs,
                             firstData.print(4).c_str());
@@ -473,13 +685,13 @@ handleHttpPayload(const HttpHeader & header,
     
     addActivity("timeAvailable: %.1fms", timeAvailableMs);
     
-    scheduleTimerAbsolute(expiry, 1);
+    scheduleRequestTimer(expiry, 1);
     hasTimer = true;
     
     addActivity("gotTimer for %s",
                 expiry.print(4).c_str());
 
-    auction->doneParsing = Date::now();
+    auction->doneParsing = Date::nowFast();
 
     ML::atomic_add(endpoint->numAuctions, 1);
     endpoint->onNewAuction(auction);
@@ -499,7 +711,7 @@ sendResponse()
     //cerr << "locked by " << bid->lock.get_thread_id() << endl;
     //cerr << "my thread " << ACE_OS::thr_self() << endl;
 
-    Date before = Date::now();
+    Date before = Date::nowFast();
 
     /* Make sure the transport isn't dead. */
     transport().checkMagic();
@@ -515,7 +727,7 @@ sendResponse()
         throw Exception("auction is not finished");
 
     addActivity("sendResponse (lock took %.2fms)",
-                Date::now().secondsSince(before) * 1000);
+                Date::nowFast().secondsSince(before) * 1000);
     
     cancelTimer();
 
@@ -529,10 +741,22 @@ sendResponse()
         return;
     }
     
-    HttpResponse response = getResponse();
+    // Nobody bid: send the pre-rendered reply if the exchange has one.
+    bool sendNoBid = false;
+    if (endpoint->hasNoBidResponse) {
+        const Auction::Data * current = auction->getCurrentData();
+        sendNoBid = !current->hasError();
+        for (unsigned spotNum = 0;
+             sendNoBid && spotNum < current->responses.size();  ++spotNum)
+            sendNoBid = !current->hasValidResponse(spotNum);
+    }
+
+    HttpResponse response;
+    if (!sendNoBid)
+        response = getResponse();
     
     Date startTime = auction->start;
-    Date beforeSend = Date::now();
+    Date beforeSend = Date::nowFast();
 
     auto onSendFinished = [=] ()
         {
@@ -541,19 +765,40 @@ sendResponse()
             //cerr << "sendFinished canBlock = " << canBlock << " "
             //<< n << endl;
             this->addActivityS("sendFinished");
-            double sendTime = Date::now().secondsSince(beforeSend);
+            double sendTime = Date::nowFast().secondsSince(beforeSend);
             if (sendTime > 0.01)
                 cerr << "sendTime = " << sendTime << " for "
                      << (auction ? auction->id.toString() : "NO AUCTION")
                      << endl;
 
+            double totalTimeMs
+                = Date::nowFast().secondsSince(this->firstData) * 1000.0;
+
             this->doEvent("auctionResponseSent");
             this->doEvent("auctionTotalTimeMs",
                           ET_OUTCOME,
-                          Date::now().secondsSince(this->firstData) * 1000.0,
+                          totalTimeMs,
                           "ms",
                           { 90, 95, 98, 99 });
 
+            if (auction) {
+                double availableMs
+                    = auction->expiry.secondsSince(this->firstData) * 1000.0;
+                endpoint->loadShedder.recordResponse(totalTimeMs, availableMs);
+
+                if (endpoint->traced(auction->id)) {
+                    Date sent = Date::nowFast();
+                    endpoint->recordSpan(auction->id, "request",
+                                         this->firstData, sent);
+                    endpoint->recordSpan(auction->id, "send",
+                                         beforeSend, sent);
+                }
+            }
+
+            // The connection carries on with its other requests
+            if (this->isPipelinedRequest())
+                return;
+
             if (random() % 1000 == 0) {
                 this->transport().closeWhenHandlerFinished();
             }
@@ -567,9 +812,26 @@ sendResponse()
     
     double timeTaken = beforeSend.secondsSince(startTime) * 1000;
 
+    if (sendNoBid) {
+        recordSample(endpoint->noBidResponseStr);
+        putRenderedResponseOnWire(endpoint->noBidResponseStr, onSendFinished);
+        return;
+    }
+
+    size_t bodyLength = response.body.size();
+    if (endpoint->contentEncoding.encodeResponse(pipelineHeader, response)) {
+        double encodeMs = Date::nowFast().secondsSince(beforeSend) * 1000.0;
+        doEvent("auctionResponseEncodeMs", ET_OUTCOME, encodeMs, "ms");
+        doEvent("auctionResponseBytesSaved", ET_COUNT,
+                bodyLength - response.body.size(), "bytes");
+    }
+
     response.extraHeaders
         .push_back({"X-Processing-Time-Ms", to_string(timeTaken)});
 
+    if (!sampledRequest.empty())
+        recordSample(renderResponse(response));
+
     putResponseOnWire(response, onSendFinished);
 }
 
@@ -579,6 +841,10 @@ dropAuction(const std::string & reason)
 {
     auto onSendFinished = [=] ()
         {
+            // The connection carries on with its other requests
+            if (this->isPipelinedRequest())
+                return;
+
             if (random() % 1000 == 0) {
                 this->transport().closeWhenHandlerFinished();
             }
@@ -588,8 +854,16 @@ dropAuction(const std::string & reason)
             }
         };
 
-    putResponseOnWire(endpoint->getDroppedAuctionResponse(*this, reason),
-                      onSendFinished);
+    if (endpoint->hasNoBidResponse) {
+        recordSample(endpoint->noBidResponseStr);
+        putRenderedResponseOnWire(endpoint->noBidResponseStr, onSendFinished);
+        return;
+    }
+
+    HttpResponse response = endpoint->getDroppedAuctionResponse(*this, reason);
+    if (!sampledRequest.empty())
+        recordSample(renderResponse(response));
+    putResponseOnWire(response, onSendFinished);
 }
 
 void
@@ -597,7 +871,11 @@ HttpAuctionHandler::
 sendErrorResponse(const std::string & error,
                   const std::string & details)
 {
-    putResponseOnWire(endpoint->getErrorResponse(*this,  error + ": " + details));
+    HttpResponse response
+        = endpoint->getErrorResponse(*this,  error + ": " + details);
+    if (!sampledRequest.empty())
+        recordSample(renderResponse(response));
+    putResponseOnWire(response);
     endpoint->onAuctionError("EXCHANGE_ERROR", auction, error + ": " + details);
 }
 
@@ -646,4 +924,15 @@ getRoundTripTimeMs(const HttpHeader & header)
     return endpoint->getRoundTripTimeMs(*this, header);
 }
 
+void
+HttpAuctionHandler::
+recordSample(const std::string & response)
+{
+    if (sampledRequest.empty() || !sampler) return;
+
+    sampler->record(endpoint->exchangeName(), sampledRequest, response,
+                    firstData);
+    sampledRequest.clear();
+}
+
 } // namespace RTBKIT
@@ -11,10 +11,12 @@
 #include "soa/service/http_endpoint.h"
 #include "soa/service/stats_events.h"
 #include "rtbkit/common/auction.h"
+#include "rtbkit/common/bid_request_pipeline.h"
 
 namespace RTBKIT {
 
 struct HttpExchangeConnector;
+struct RequestSampler;
 
 /*****************************************************************************/
 /* HTTP AUCTION LOGGER                                                       */
@@ -63,10 +65,14 @@ struct HttpAuctionHandler
     /** We got our transport. */
     void onGotTransport();
 
+    /** We got a request pipelined on another handler's connection. */
+    virtual void onGotPipelinedRequest();
+
     HttpExchangeConnector * endpoint;
 
     std::shared_ptr<Auction> auction;
     std::shared_ptr<HttpAuctionLogger> logger;
+    std::shared_ptr<RequestSampler> sampler;
     bool hasTimer;
     bool disconnected;
     bool servingRequest;  ///< Are we currently, actively serving a request?
@@ -153,6 +159,43 @@ struct HttpAuctionHandler
 
     static long created;
     static long destroyed;
+
+private:
+    /** Timer cookie for a pipeline step that took too long; the auction's own
+        timer uses 1. */
+    enum { PIPELINE_TIMEOUT = 2 };
+
+    struct PipelineStep;
+    std::shared_ptr<PipelineStep> pipelineStep;
+
+    /** The request as it was when it came in, kept for the pipeline steps
+        which can finish after handleHttpPayload() returns. */
+    HttpHeader pipelineHeader;
+    std::string pipelinePayload;
+    Date pipelineStart;
+    Date pipelineExpiry;
+    double pipelineTimeAvailableMs;
+
+    /** Start a step of the pipeline, and call next on the handler's thread
+        once it's done or it reaches its deadline. */
+    void runPipelineStep(
+            void (HttpAuctionHandler::* next) (PipelineStatus),
+            const std::function<void (Date, const OnPipelineDone &)> & start);
+
+    void finishPipelineStep(const std::shared_ptr<PipelineStep> & step,
+                            PipelineStatus status);
+
+    /** Parses the request and starts the post bid request step. */
+    void afterPreBidRequest(PipelineStatus status);
+
+    /** Hands the auction over to the router. */
+    void afterPostBidRequest(PipelineStatus status);
+
+    /** The request as it was received, when the sampler picked it. */
+    std::string sampledRequest;
+
+    /** Gives the sampled request and its response to the sampler. */
+    void recordSample(const std::string & response);
 };
 
 
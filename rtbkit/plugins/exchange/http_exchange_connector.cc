@@ -7,6 +7,7 @@
 
 #include "http_exchange_connector.h"
 #include "http_auction_handler.h"
+#include "request_sampler.h"
 #include "jml/arch/exception.h"
 #include "jml/arch/format.h"
 #include "jml/arch/backtrace.h"
@@ -58,12 +59,15 @@ postConstructorInit()
     bindHost = "*";
     performNameLookup = true;
     backlog = DEF_BACKLOG;
+    numAcceptors = 1;
+    hasNoBidResponse = false;
     pingTimeUnknownHostsMs = 20;
     auctionVerb = "POST";
     auctionResource = "/";
     absoluteTimeMax = 50.0;
     disableAcceptProbability = false;
     disableExceptionPrinting = false;
+    pipelineTimeMaxMs = -1.0;
 
     numServingRequest = 0;
 
@@ -83,6 +87,11 @@ postConstructorInit()
     addPeriodic(1.0,
                 [=] (uint64_t numWakeUps)
                 { this->periodicCallback(numWakeUps); });
+
+    // Sub-second so that we react before the queues have built up.
+    addPeriodic(0.1,
+                [=] (uint64_t)
+                { this->updateLoadShedding(); });
 }
 
 HttpExchangeConnector::
@@ -103,6 +112,7 @@ configure(const Json::Value & parameters)
     getParam(parameters, bindHost, "bindHost");
     getParam(parameters, performNameLookup, "performNameLookup");
     getParam(parameters, backlog, "connectionBacklog");
+    getParam(parameters, numAcceptors, "numAcceptors");
     getParam(parameters, auctionResource, "auctionResource");
     getParam(parameters, auctionVerb, "auctionVerb");
     getParam(parameters, pingTimesByHostMs, "pingTimesByHostMs");
@@ -110,6 +120,15 @@ configure(const Json::Value & parameters)
     getParam(parameters, absoluteTimeMax, "absoluteTimeMax");
     getParam(parameters, disableAcceptProbability, "disableAcceptProbability");
     getParam(parameters, disableExceptionPrinting, "disableExceptionPrinting");
+    getParam(parameters, pipelineTimeMaxMs, "pipelineTimeMaxMs");
+    getParam(parameters, maxPipelinedRequests, "maxPipelinedRequests");
+
+    loadShedder.configure(parameters["loadShedding"]);
+    valueShedder.configure(parameters["valueShedding"]);
+    contentEncoding.configure(parameters["contentEncoding"]);
+
+    if (parameters.isMember("requestSampling"))
+        setRequestSampler(RequestSampler::create(parameters["requestSampling"]));
 
     if (parameters.isMember("realTimePolling"))
         realTimePolling(parameters["realTimePolling"].asBool());
@@ -161,6 +180,12 @@ void
 HttpExchangeConnector::
 start()
 {
+    HttpResponse noBidResponse(204, "none", "");
+    hasNoBidResponse = getStaticNoBidResponse(noBidResponse);
+    if (hasNoBidResponse)
+        noBidResponseStr = HttpConnectionHandler::renderResponse(noBidResponse);
+
+    PassiveEndpoint::setNumAcceptors(numAcceptors);
     PassiveEndpoint::init(listenPort, bindHost, numThreads, true,
                           performNameLookup, backlog);
     if (realTimePriority > -1) {
@@ -174,6 +199,7 @@ shutdown()
 {
     HttpEndpoint::shutdown();
     ExchangeConnector::shutdown();
+    stopRequestSampling();
 }
 
 void
@@ -194,6 +220,33 @@ stopRequestLogging() {
     logger.reset();
 }
 
+void
+HttpExchangeConnector::
+startRequestSampling(std::string const & filename, unsigned sampleRate) {
+    setRequestSampler(std::make_shared<RequestSampler>(filename, sampleRate));
+}
+
+void
+HttpExchangeConnector::
+stopRequestSampling() {
+    setRequestSampler(nullptr);
+}
+
+void
+HttpExchangeConnector::
+setRequestSampler(std::shared_ptr<RequestSampler> newSampler) {
+    std::shared_ptr<RequestSampler> oldSampler;
+    {
+        Guard guard(handlersLock);
+        oldSampler = sampler;
+        sampler = newSampler;
+    }
+
+    // Handlers that still hold it only queue their samples, which aren't
+    // written anymore.
+    if (oldSampler) oldSampler->close();
+}
+
 std::shared_ptr<ConnectionHandler>
 HttpExchangeConnector::
 makeNewHandler()
@@ -219,6 +272,7 @@ makeNewHandlerShared()
         if (logger) {
             handler->logger = logger;
         }
+        handler->sampler = sampler;
 
         handlers.insert(handlerSp);
     }
@@ -251,6 +305,14 @@ getServiceStatus() const
     BOOST_FOREACH(auto cnt, peerCounts)
         result["hostConnections"][cnt.first] = cnt.second;
 
+    std::shared_ptr<RequestSampler> currentSampler;
+    {
+        Guard guard(handlersLock);
+        currentSampler = sampler;
+    }
+    if (currentSampler)
+        result["requestSampling"] = currentSampler->stats();
+
     return result;
 }
 
@@ -278,6 +340,14 @@ getTimeAvailableMs(HttpAuctionHandler & connection,
     throw ML::Exception("need to override HttpExchangeConnector::getTimeAvailableMs");
 }
 
+double
+HttpExchangeConnector::
+getRequestValue(const HttpHeader & header,
+                const std::string & payload) const
+{
+    return -1.0;
+}
+
 double
 HttpExchangeConnector::
 getRoundTripTimeMs(HttpAuctionHandler & connection,
@@ -308,6 +378,13 @@ getDroppedAuctionResponse(const HttpAuctionHandler & connection,
     return HttpResponse(204, "none", "");
 }
 
+bool
+HttpExchangeConnector::
+getStaticNoBidResponse(HttpResponse & response) const
+{
+    return false;
+}
+
 HttpResponse
 HttpExchangeConnector::
 getErrorResponse(const HttpAuctionHandler & connection,
@@ -357,6 +434,34 @@ periodicCallback(uint64_t numWakeups) const
     recordLevel(numConnections(), "httpConnections");
 }
 
+void
+HttpExchangeConnector::
+updateLoadShedding()
+{
+    double load = 0.0;
+    if (loadShedder.loadThreshold > 0.0) {
+        // Can't be done in the constructor as it's virtual.
+        if (!loadSampleFn) loadSampleFn = getLoadSampleFn();
+        load = loadSampleFn(0.1);
+    }
+
+    loadShedder.update(load, numServingRequest);
+    recordLevel(loadShedder.shedProbability() * 100.0, "loadShedPercentage");
+
+    if (!valueShedder.enabled()) return;
+
+    auto shed = valueShedder.update();
+    if (!shed.requests) return;
+
+    recordLevel(shed.shedValue, "valueShedding.shedValue");
+    recordLevel(shed.value, "valueShedding.offeredValue");
+    recordLevel(100.0 * shed.shedRequests / shed.requests,
+                "valueShedding.shedRequestPercentage");
+    if (shed.value > 0.0)
+        recordLevel(100.0 * shed.shedValue / shed.value,
+                    "valueShedding.shedValuePercentage");
+}
+
 PipelineStatus
 HttpExchangeConnector::
 preBidRequest(const HttpHeader& header, const std::string& payload) {
@@ -369,4 +474,18 @@ postBidRequest(const std::shared_ptr<Auction>& auction) {
     return pipeline->postBidRequest(this, auction);
 }
 
+void
+HttpExchangeConnector::
+preBidRequestAsync(const HttpHeader& header, const std::string& payload,
+                   Date deadline, const OnPipelineDone& onDone) {
+    pipeline->preBidRequestAsync(this, header, payload, deadline, onDone);
+}
+
+void
+HttpExchangeConnector::
+postBidRequestAsync(const std::shared_ptr<Auction>& auction,
+                    Date deadline, const OnPipelineDone& onDone) {
+    pipeline->postBidRequestAsync(this, auction, deadline, onDone);
+}
+
 } // namespace RTBKIT
@@ -16,6 +16,9 @@
 #include <limits>
 #include "rtbkit/common/exchange_connector.h"
 #include "rtbkit/common/bid_request_pipeline.h"
+#include "rtbkit/plugins/exchange/load_shedder.h"
+#include "rtbkit/plugins/exchange/value_shedder.h"
+#include "rtbkit/plugins/exchange/content_encoding.h"
 #include <boost/algorithm/string.hpp>
 
 
@@ -23,6 +26,7 @@ namespace RTBKIT {
 
 struct HttpExchangeConnector;
 struct HttpAuctionLogger;
+struct RequestSampler;
 struct HttpAuctionHandler;
 
 /*****************************************************************************/
@@ -51,6 +55,13 @@ struct HttpExchangeConnector
     /** Stop logging */
     void stopRequestLogging();
 
+    /** Start sampling requests (see RequestSampler) */
+    void startRequestSampling(std::string const & filename,
+                              unsigned sampleRate = 1000);
+
+    /** Stop sampling */
+    void stopRequestSampling();
+
     /*************************************************************************/
     /* METHODS CALLED BY THE ROUTER TO CONTROL THE EXCHANGE CONNECTOR        */
     /*************************************************************************/
@@ -177,6 +188,18 @@ struct HttpExchangeConnector
                        const HttpHeader & header,
                        const std::string & payload);
 
+    /** Return a cheap estimate of what the bid request is worth, for the
+        value based load shedding, or a negative value if it can't be
+        scored.  Like getTimeAvailableMs() it should not parse the bid
+        request; see ValueShedder::value().
+
+        The default implementation returns -1, so that the requests are
+        shed at random.
+    */
+    virtual double
+    getRequestValue(const HttpHeader & header,
+                    const std::string & payload) const;
+
     /** Return an estimate of how long a round trip with the connected
         server takes, in milliseconds at the exchange's latency percentile,
         including all hops (load balancers, reverse proxies, etc).
@@ -211,6 +234,17 @@ struct HttpExchangeConnector
     getDroppedAuctionResponse(const HttpAuctionHandler & connection,
                               const std::string & reason) const;
 
+    /** Return in response the reply for auctions where no agent bid and for
+        dropped auctions when that reply is always the same, and true if
+        so.  Such a response is rendered once when the connector starts
+        and sent as is, skipping getResponse() and
+        getDroppedAuctionResponse() along with their allocations.
+
+        Default returns false which means that the response depends on the
+        auction.
+    */
+    virtual bool getStaticNoBidResponse(HttpResponse & response) const;
+
     /** Return a stringified JSON of the response for our auction.  Default
         implementation calls getResponse() and stringifies the result.
 
@@ -266,6 +300,9 @@ struct HttpExchangeConnector
     /** Method invoked every second for accounting */
     virtual void periodicCallback(uint64_t numWakeups) const;
 
+    /** Method invoked every 100ms to adjust the load shedding. */
+    void updateLoadShedding();
+
     /** Invokes the pre bid-request pipeline operation */
     PipelineStatus
     preBidRequest(const HttpHeader& header, const std::string& payload);
@@ -274,6 +311,15 @@ struct HttpExchangeConnector
     PipelineStatus
     postBidRequest(const std::shared_ptr<Auction>& auction);
 
+    /** Asynchronous versions of the above; see BidRequestPipeline. */
+    void
+    preBidRequestAsync(const HttpHeader& header, const std::string& payload,
+                       Date deadline, const OnPipelineDone& onDone);
+
+    void
+    postBidRequestAsync(const std::shared_ptr<Auction>& auction,
+                        Date deadline, const OnPipelineDone& onDone);
+
 protected:
     virtual std::shared_ptr<ConnectionHandler> makeNewHandler();
     virtual std::shared_ptr<HttpAuctionHandler> makeNewHandlerShared();
@@ -299,6 +345,19 @@ protected:
 
     int numServingRequest;  ///< How many connections are serving a request
 
+    /// Drops requests when we can't keep up with the deadlines
+    LoadShedder loadShedder;
+
+    /// Picks the requests that the load shedding drops by their value
+    ValueShedder valueShedder;
+
+    /// Compression of the requests and responses
+    ContentEncoding contentEncoding;
+
+    /// Pre-rendered reply to no-bids, if getStaticNoBidResponse() gave one
+    bool hasNoBidResponse;
+    std::string noBidResponseStr;
+
     /// Configuration parameters
     int numThreads;
     int realTimePriority;
@@ -306,12 +365,18 @@ protected:
     std::string bindHost;
     bool performNameLookup;
     int backlog;
+    int numAcceptors;  ///< Listening sockets sharing the port (SO_REUSEPORT)
     std::string auctionResource;
     std::string auctionVerb;
     double absoluteTimeMax;
     bool disableAcceptProbability;
     bool disableExceptionPrinting;
 
+    /** Longest time in milliseconds that an auction waits on each step of
+        the bid request pipeline.  Negative means until the auction expires.
+    */
+    double pipelineTimeMaxMs;
+
     /// The ping time to known hosts in milliseconds
     std::unordered_map<std::string, float> pingTimesByHostMs;
 
@@ -322,9 +387,15 @@ private:
     friend class HttpAuctionHandler;
 
     std::shared_ptr<HttpAuctionLogger> logger;
+    std::shared_ptr<RequestSampler> sampler;
     std::shared_ptr<BidRequestPipeline> pipeline;
 
-    Lock handlersLock;
+    void setRequestSampler(std::shared_ptr<RequestSampler> newSampler);
+
+    /// Samples the load of our threads for the load shedding
+    std::function<double(double)> loadSampleFn;
+
+    mutable Lock handlersLock;
     std::set<std::shared_ptr<HttpAuctionHandler> > handlers;
     void finishedWithHandler(std::shared_ptr<HttpAuctionHandler> handler);
 
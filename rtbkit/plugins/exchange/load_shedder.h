@@ -0,0 +1,141 @@
+/* load_shedder.h                                                  -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Feedback controller deciding which fraction of the bid requests an
+   exchange connector should drop to keep up with its deadlines.
+*/
+
+#pragma once
+
+#include "soa/jsoncpp/json.h"
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* LOAD SHEDDER                                                              */
+/*****************************************************************************/
+
+/** Sheds a fraction of the incoming bid requests with an immediate no-bid
+    when the connector falls behind.
+
+    Three signals are looked at on every update():
+    - the fraction of the responses sent late, that is after lateRatio of the
+      time that was available to answer; keeping it under lateTarget keeps
+      the corresponding percentile of the response time under the deadline;
+    - the CPU load of the connector threads as sampled for the LoopMonitor,
+      off by default since busy polling threads always look loaded;
+    - the number of requests being served, which includes the ones waiting
+      in the router, off by default as well.
+
+    When any of them is over its threshold, the shedding probability goes up
+    in proportion to the worst overshoot; otherwise it decays slowly. The
+    asymmetry is what keeps the controller responsive to load spikes without
+    oscillating. update() is meant to be called a few times per second.
+
+    shedRequest() and recordResponse() are thread safe and lock-free while
+    update() must be called from a single thread.
+*/
+struct LoadShedder {
+
+    LoadShedder()
+        : enabled(true), lateRatio(0.9), lateTarget(0.01),
+          loadThreshold(0.0), maxServing(0), maxShedProbability(0.9),
+          increase(0.1), decrease(0.01),
+          shedProb(0.0), numResponses(0), numLate(0)
+    {
+    }
+
+    /** Reads the parameters out of the "loadShedding" object of the
+        connector configuration.
+    */
+    void configure(const Json::Value & config)
+    {
+        if (config.isNull()) return;
+
+        enabled = config.get("enabled", enabled).asBool();
+        lateRatio = config.get("lateRatio", lateRatio).asDouble();
+        lateTarget = config.get("lateTarget", lateTarget).asDouble();
+        loadThreshold = config.get("loadThreshold", loadThreshold).asDouble();
+        maxServing = config.get("maxServingRequests", maxServing).asInt();
+        maxShedProbability
+            = config.get("maxShedProbability", maxShedProbability).asDouble();
+        increase = config.get("increase", increase).asDouble();
+        decrease = config.get("decrease", decrease).asDouble();
+    }
+
+    /** Returns true if the request should be dropped right away. */
+    bool shedRequest() const
+    {
+        double prob = shedProb.load(std::memory_order_relaxed);
+        return prob > 0.0 && random() % 1000000 < 1000000 * prob;
+    }
+
+    /** Records the time it took to answer a request out of the time that
+        was available.
+    */
+    void recordResponse(double timeTakenMs, double timeAvailableMs)
+    {
+        numResponses.fetch_add(1, std::memory_order_relaxed);
+        if (timeTakenMs > timeAvailableMs * lateRatio)
+            numLate.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** Adjusts the shedding probability from the signals gathered since the
+        last update.
+    */
+    void update(double load, int numServing)
+    {
+        uint64_t responses = numResponses.exchange(0);
+        uint64_t late = numLate.exchange(0);
+
+        if (!enabled) {
+            shedProb = 0.0;
+            return;
+        }
+
+        // How far over its threshold the worst signal is; 1.0 is right at
+        // the threshold.
+        double overshoot = 0.0;
+
+        if (responses && lateTarget > 0.0)
+            overshoot = std::max(overshoot, (double(late) / responses) / lateTarget);
+        if (loadThreshold > 0.0)
+            overshoot = std::max(overshoot, load / loadThreshold);
+        if (maxServing > 0)
+            overshoot = std::max(overshoot, double(numServing) / maxServing);
+
+        double prob = shedProb;
+        if (overshoot > 1.0)
+            prob += increase * std::min(overshoot, 10.0);
+        else prob -= decrease;
+
+        shedProb = std::max(0.0, std::min(maxShedProbability, prob));
+    }
+
+    /** Probability at which requests are currently dropped. */
+    double shedProbability() const { return shedProb; }
+
+    bool enabled;
+
+    double lateRatio;
+    double lateTarget;
+    double loadThreshold;      ///< 0 means the signal is ignored
+    int maxServing;            ///< 0 means the signal is ignored
+    double maxShedProbability;
+
+    double increase;
+    double decrease;
+
+private:
+    std::atomic<double> shedProb;
+    std::atomic<uint64_t> numResponses;
+    std::atomic<uint64_t> numLate;
+};
+
+} // namespace RTBKIT
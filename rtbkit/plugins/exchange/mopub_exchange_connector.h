@@ -98,9 +98,11 @@ struct MoPubExchangeConnector: public OpenRTBExchangeConnector {
     typedef TypedCreativeConfiguration<CreativeInfo> MopubCreativeConfiguration;
     MopubCreativeConfiguration configuration_;
 
-    virtual void setSeatBid(Auction const & auction,
-                            int spotNum,
-                            OpenRTB::BidResponse & response) const;
+    virtual Id getSeat(Auction const & auction, int spotNum) const;
+
+    virtual void writeBid(Auction const & auction,
+                          int spotNum,
+                          OpenRTBResponseWriter & writer) const;
 };
 
 
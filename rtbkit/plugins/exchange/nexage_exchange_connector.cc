@@ -202,12 +202,25 @@ parseBidRequest(HttpAuctionHandler & connection,
 }
 
 
-void
+Id
 NexageExchangeConnector::
-setSeatBid(Auction const & auction,
-           int spotNum,
-           OpenRTB::BidResponse & response) const {
+getSeat(Auction const & auction, int spotNum) const
+{
+    auto & resp = auction.getCurrentData()->winningResponse(spotNum);
+
+    const AgentConfig * config =
+        std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
 
+    // Get the exchange specific data for this campaign
+    return config->getProviderData<CampaignInfo>(exchangeName())->seat;
+}
+
+void
+NexageExchangeConnector::
+writeBid(Auction const & auction,
+         int spotNum,
+         OpenRTBResponseWriter & writer) const
+{
     const Auction::Data * current = auction.getCurrentData();
 
     // Get the winning bid
@@ -220,9 +233,6 @@ setSeatBid(Auction const & auction,
 
     std::string en = exchangeName();
 
-    // Get the exchange specific data for this campaign
-    auto cpinfo = config->getProviderData<CampaignInfo>(en);
-
     // Put in the fixed parts from the creative
     int creativeIndex = resp.agentCreativeIndex;
 
@@ -231,26 +241,6 @@ setSeatBid(Auction const & auction,
     // Get the exchange specific data for this creative
     auto crinfo = creative.getProviderData<CreativeInfo>(en);
 
-    // Find the index in the seats array
-    int seatIndex = 0;
-    while(response.seatbid.size() != seatIndex) {
-        if(response.seatbid[seatIndex].seat == cpinfo->seat) break;
-        ++seatIndex;
-    }
-
-    // Create if required
-    if(seatIndex == response.seatbid.size()) {
-        response.seatbid.emplace_back();
-        response.seatbid.back().seat = cpinfo->seat;
-    }
-
-    // Get the seatBid object
-    OpenRTB::SeatBid & seatBid = response.seatbid.at(seatIndex);
-
-    // Add a new bid to the array
-    seatBid.bid.emplace_back();
-    auto & b = seatBid.bid.back();
-
     NexageCreativeConfiguration::Context ctx = {
         creative,
         resp,
@@ -258,17 +248,18 @@ setSeatBid(Auction const & auction,
         spotNum
     };
 
-    // Put in the variable parts
-    b.cid = Id(resp.agent);
-    b.iurl = crinfo->iurl;
-    b.impid = auction.request->imp[spotNum].id;
-    b.id = Id(auction.id, auction.request->imp[0].id);
-    b.price.val = USD_CPM(resp.price.maxPrice);
-    b.crid = crinfo->crid;
-    b.adomain = crinfo->adomain;
+    // Put in the variable parts, in the order of the OpenRTB bid
+    writer.writeId("id", Id(auction.id, auction.request->imp[0].id));
+    writer.writeId("impid", auction.request->imp[spotNum].id);
+    writer.writeDouble("price", USD_CPM(resp.price.maxPrice));
     // optional parts
-    if (!crinfo->nurl.empty()) b.nurl = crinfo->nurl;
-    if (!crinfo->adm.empty()) b.adm = configuration_.expand(crinfo->adm, ctx);
+    writer.writeString("nurl", crinfo->nurl);
+    if (!crinfo->adm.empty())
+        writer.writeString("adm", configuration_.expand(crinfo->adm, ctx));
+    writer.writeStringList("adomain", crinfo->adomain);
+    writer.writeString("iurl", crinfo->iurl);
+    writer.writeString("cid", resp.agent);
+    writer.writeId("crid", crinfo->crid);
 }
 
 template<typename T>
@@ -92,9 +92,11 @@ struct NexageExchangeConnector: public OpenRTBExchangeConnector {
                                           const void * info) const;
 
   private:
-    virtual void setSeatBid(Auction const & auction,
-                            int spotNum,
-                            OpenRTB::BidResponse & response) const;
+    virtual Id getSeat(Auction const & auction, int spotNum) const;
+
+    virtual void writeBid(Auction const & auction,
+                          int spotNum,
+                          OpenRTBResponseWriter & writer) const;
 
     NexageCreativeConfiguration configuration_;
 };
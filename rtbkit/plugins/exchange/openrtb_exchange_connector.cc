@@ -8,6 +8,7 @@
 #include "rtbkit/common/testing/exchange_source.h"
 #include "rtbkit/plugins/bid_request/openrtb_bid_source.h"
 #include "rtbkit/plugins/bid_request/openrtb_bid_request_parser.h"
+#include "rtbkit/plugins/bid_request/openrtb_pre_parse.h"
 #include "rtbkit/plugins/exchange/http_auction_handler.h"
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "rtbkit/openrtb/openrtb_parsing.h"
@@ -154,9 +155,11 @@ parseBidRequest(HttpAuctionHandler & connection,
     try {
         JML_TRACE_EXCEPTIONS(!disableExceptionPrinting);
         ML::Parse_Context context("Bid Request", payload.c_str(), payload.size());
-        result.reset(OpenRTBBidRequestParser::openRTBBidRequestParserFactory(openRtbVersion)->parseBidRequest(context,
+        result = auctionPool->getBidRequest();
+        OpenRTBBidRequestParser::openRTBBidRequestParserFactory(openRtbVersion)->parseBidRequest(context,
                                                                                               exchangeName(),
-                                                                                              exchangeName()));
+                                                                                              exchangeName(),
+                                                                                              *result);
         result->protocolVersion = openRtbVersion;
     }
     catch(ML::Exception const & e) {
@@ -197,6 +200,19 @@ getTimeAvailableMs(HttpAuctionHandler & connection,
     return (absoluteTimeMax < tmax) ? absoluteTimeMax : tmax;
 }
 
+double
+OpenRTBExchangeConnector::
+getRequestValue(const HttpHeader & header,
+                const std::string & payload) const
+{
+    PreParseKeys keys;
+    if (!keys.scan(payload))
+        return -1.0;
+
+    return valueShedder.value(keys.bidFloor,
+                              keys.hasSite ? keys.siteId : keys.appId);
+}
+
 HttpResponse
 OpenRTBExchangeConnector::
 getResponse(const HttpAuctionHandler & connection,
@@ -209,28 +225,62 @@ getResponse(const HttpAuctionHandler & connection,
         return getErrorResponse(connection,
                                 current->error + ": " + current->details);
 
-    OpenRTB::BidResponse response;
-    response.id = auction.id;
+    std::string * buffer = responseBuffer.get();
+    if (!buffer) {
+        buffer = new std::string();
+        buffer->reserve(4096);
+        responseBuffer.reset(buffer);
+    }
+
+    OpenRTBResponseWriter writer(*buffer);
+    writer.startResponse(auction.id);
+
+    size_t numSpots = current->responses.size();
+
+    std::vector<Id> seats(numSpots);
+    for (unsigned spotNum = 0; spotNum < numSpots; ++spotNum) {
+        if (current->hasValidResponse(spotNum))
+            seats[spotNum] = getSeat(auction, spotNum);
+    }
 
-    response.ext = getResponseExt(connection, auction);
+    // Write a seatbid for each seat, starting from the first spot it won
+    for (unsigned first = 0; first < numSpots; ++first) {
+        if (!current->hasValidResponse(first))
+            continue;
 
-    // Create a spot for each of the bid responses
-    for (unsigned spotNum = 0; spotNum < current->responses.size(); ++spotNum) {
-        if (!current->hasValidResponse(spotNum))
+        bool written = false;
+        for (unsigned spotNum = 0; spotNum < first && !written; ++spotNum) {
+            written = current->hasValidResponse(spotNum)
+                && seats[spotNum] == seats[first];
+        }
+        if (written)
             continue;
 
-        setSeatBid(auction, spotNum, response);
+        writer.startSeat();
+
+        for (unsigned spotNum = first; spotNum < numSpots; ++spotNum) {
+            if (!current->hasValidResponse(spotNum)
+                || seats[spotNum] != seats[first])
+                continue;
+
+            writer.startBid();
+            writeBid(auction, spotNum, writer);
+            writer.endBid();
+        }
+
+        writer.endSeat(seats[first], getSeatExt(auction, first));
     }
 
-    if (response.seatbid.empty())
+    writer.endSeats();
+
+    if (writer.numBids() == 0)
         return HttpResponse(204, "none", "");
 
-    static Datacratic::DefaultDescription<OpenRTB::BidResponse> desc;
-    std::ostringstream stream;
-    StreamJsonPrintingContext context(stream);
-    desc.printJsonTyped(&response, context);
+    writeResponseMembers(auction, writer);
+    writer.writeJson("ext", getResponseExt(connection, auction));
+    writer.endResponse();
 
-    return HttpResponse(200, "application/json", stream.str());
+    return HttpResponse(200, "application/json", *buffer);
 }
 
 Json::Value
@@ -249,6 +299,14 @@ getDroppedAuctionResponse(const HttpAuctionHandler & connection,
     return HttpResponse(204, "none", "");
 }
 
+bool
+OpenRTBExchangeConnector::
+getStaticNoBidResponse(HttpResponse & response) const
+{
+    response = HttpResponse(204, "none", "");
+    return true;
+}
+
 HttpResponse
 OpenRTBExchangeConnector::
 getErrorResponse(const HttpAuctionHandler & connection,
@@ -268,34 +326,51 @@ getBidSourceConfiguration() const
                       ML::fqdn_hostname(suffix) + ":" + suffix);
 }
 
+Id
+OpenRTBExchangeConnector::
+getSeat(const Auction & auction, int spotNum) const
+{
+    return Id();
+}
+
+Json::Value
+OpenRTBExchangeConnector::
+getSeatExt(const Auction & auction, int spotNum) const
+{
+    return {};
+}
+
 void
 OpenRTBExchangeConnector::
-setSeatBid(Auction const & auction,
-           int spotNum,
-           OpenRTB::BidResponse & response) const
+writeBid(const Auction & auction,
+         int spotNum,
+         OpenRTBResponseWriter & writer) const
 {
     const Auction::Data * data = auction.getCurrentData();
 
     // Get the winning bid
     auto & resp = data->winningResponse(spotNum);
 
-    int seatIndex = 0;
-    if(response.seatbid.empty()) {
-        response.seatbid.emplace_back();
-    }
-
-    OpenRTB::SeatBid & seatBid = response.seatbid.at(seatIndex);
+    writer.writeId("id", Id(auction.id, auction.request->imp[0].id));
+    writer.writeId("impid", auction.request->imp[spotNum].id);
+    writer.writeDouble("price", getAmountIn<CPM>(resp.price.maxPrice));
+    writer.writeString("cid", std::to_string(resp.agentConfig->externalId));
+    writer.writeString("crid", std::to_string(resp.creativeId));
+    writer.writeJson("ext", getBidExt(auction, spotNum));
+}
 
-    // Add a new bid to the array
-    seatBid.bid.emplace_back();
+Json::Value
+OpenRTBExchangeConnector::
+getBidExt(const Auction & auction, int spotNum) const
+{
+    return {};
+}
 
-    // Put in the variable parts
-    auto & b = seatBid.bid.back();
-    b.cid = Id(resp.agentConfig->externalId);
-    b.crid = Id(std::to_string(resp.creativeId));
-    b.id = Id(auction.id, auction.request->imp[0].id);
-    b.impid = auction.request->imp[spotNum].id;
-    b.price.val = getAmountIn<CPM>(resp.price.maxPrice);
+void
+OpenRTBExchangeConnector::
+writeResponseMembers(const Auction & auction,
+                     OpenRTBResponseWriter & writer) const
+{
 }
 
 } // namespace RTBKIT
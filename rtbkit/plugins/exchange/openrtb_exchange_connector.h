@@ -7,6 +7,8 @@
 #pragma once
 
 #include "rtbkit/plugins/exchange/http_exchange_connector.h"
+#include "rtbkit/plugins/exchange/openrtb_response_writer.h"
+#include <boost/thread/tss.hpp>
 
 namespace RTBKIT {
 
@@ -18,6 +20,10 @@ namespace RTBKIT {
 
     Configuration options are the same as the HttpExchangeConnector on which
     it is based.
+
+    The bid response is written straight from the auction by an
+    OpenRTBResponseWriter; connectors for exchanges that need more in it
+    override the hooks below rather than getResponse().
 */
 
 struct OpenRTBExchangeConnector : public HttpExchangeConnector {
@@ -43,6 +49,13 @@ struct OpenRTBExchangeConnector : public HttpExchangeConnector {
                        const HttpHeader & header,
                        const std::string & payload);
 
+    /** Bid floor times the win rate of the site or app, as scanned out of
+        the payload by PreParseKeys.
+    */
+    virtual double
+    getRequestValue(const HttpHeader & header,
+                    const std::string & payload) const;
+
     virtual HttpResponse
     getResponse(const HttpAuctionHandler & connection,
                 const HttpHeader & requestHeader,
@@ -52,6 +65,8 @@ struct OpenRTBExchangeConnector : public HttpExchangeConnector {
     getDroppedAuctionResponse(const HttpAuctionHandler & connection,
                               const std::string & reason) const;
 
+    virtual bool getStaticNoBidResponse(HttpResponse & response) const;
+
     virtual HttpResponse
     getErrorResponse(const HttpAuctionHandler & connection,
                      const std::string & errorMessage) const;
@@ -65,9 +80,35 @@ private:
                    const Auction & auction) const;
 protected:
 
-    virtual void setSeatBid(Auction const & auction,
-                            int spotNum,
-                            OpenRTB::BidResponse & response) const;
+    /** Seat on behalf of which the bid on the spot is made.  The bids are
+        grouped by seat, in the order in which the seats first appear; by
+        default they all go in one seatbid without a seat.
+    */
+    virtual Id getSeat(const Auction & auction, int spotNum) const;
+
+    /** Extension of the seatbid of the seat of the spot.  None by default. */
+    virtual Json::Value getSeatExt(const Auction & auction, int spotNum) const;
+
+    /** Writes the members of the bid on the spot.  By default these are the
+        id, impid, price, cid and crid followed by the getBidExt() extension.
+    */
+    virtual void writeBid(const Auction & auction, int spotNum,
+                          OpenRTBResponseWriter & writer) const;
+
+    /** Extension of the bids written by the default writeBid().  None by
+        default.
+    */
+    virtual Json::Value getBidExt(const Auction & auction, int spotNum) const;
+
+    /** Writes the members of the response that go between the seatbid and
+        the ext, such as the bidid and the cur.  None by default.
+    */
+    virtual void writeResponseMembers(const Auction & auction,
+                                      OpenRTBResponseWriter & writer) const;
+
+private:
+    /// Buffer in which each thread writes its responses
+    mutable boost::thread_specific_ptr<std::string> responseBuffer;
 };
 
 } // namespace RTBKIT
@@ -0,0 +1,205 @@
+/* openrtb_response_writer.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Writes OpenRTB bid responses as JSON without building them first.
+*/
+
+#include "openrtb_response_writer.h"
+#include "soa/types/dtoa.h"
+#include "jml/utils/json_parsing.h"
+#include <cmath>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* OPENRTB RESPONSE WRITER                                                   */
+/*****************************************************************************/
+
+OpenRTBResponseWriter::
+OpenRTBResponseWriter(std::string & buffer)
+    : buffer(buffer), firstMember(true), firstSeat(true), firstBid(true),
+      numBids_(0)
+{
+    buffer.clear();
+}
+
+void
+OpenRTBResponseWriter::
+startResponse(const Id & id)
+{
+    buffer += '{';
+    firstMember = true;
+    writeId("id", id);
+}
+
+void
+OpenRTBResponseWriter::
+startSeat()
+{
+    if (firstSeat) {
+        startMember("seatbid");
+        buffer += '[';
+        firstSeat = false;
+    }
+    else buffer += ',';
+
+    buffer += "{\"bid\":[";
+    firstBid = true;
+}
+
+void
+OpenRTBResponseWriter::
+startBid()
+{
+    if (!firstBid) buffer += ',';
+    buffer += '{';
+    firstBid = false;
+    firstMember = true;
+    ++numBids_;
+}
+
+void
+OpenRTBResponseWriter::
+endBid()
+{
+    buffer += '}';
+}
+
+void
+OpenRTBResponseWriter::
+endSeat(const Id & seat, const Json::Value & ext)
+{
+    buffer += ']';
+    firstMember = false;
+    writeId("seat", seat);
+    writeJson("ext", ext);
+    buffer += '}';
+}
+
+void
+OpenRTBResponseWriter::
+endSeats()
+{
+    if (!firstSeat) buffer += ']';
+    firstMember = false;
+}
+
+void
+OpenRTBResponseWriter::
+endResponse()
+{
+    buffer += '}';
+}
+
+void
+OpenRTBResponseWriter::
+writeId(const char * name, const Id & val)
+{
+    if (!val.notNull()) return;
+    startMember(name);
+    string s = val.toString();
+    appendString(s.data(), s.size());
+}
+
+void
+OpenRTBResponseWriter::
+writeString(const char * name, const std::string & val)
+{
+    if (val.empty()) return;
+    startMember(name);
+    appendString(val.data(), val.size());
+}
+
+void
+OpenRTBResponseWriter::
+writeString(const char * name, const Utf8String & val)
+{
+    if (val.empty()) return;
+    startMember(name);
+    appendString(val.rawData(), val.rawLength());
+}
+
+void
+OpenRTBResponseWriter::
+writeStringList(const char * name, const std::vector<std::string> & val)
+{
+    if (val.empty()) return;
+    startMember(name);
+    buffer += '[';
+    for (unsigned i = 0;  i < val.size();  ++i) {
+        if (i) buffer += ',';
+        appendString(val[i].data(), val[i].size());
+    }
+    buffer += ']';
+}
+
+void
+OpenRTBResponseWriter::
+writeDouble(const char * name, double val)
+{
+    startMember(name);
+    if (std::isfinite(val))
+        buffer += Datacratic::dtoa(val);
+    else buffer += '"' + std::to_string(val) + '"';
+}
+
+void
+OpenRTBResponseWriter::
+writeJson(const char * name, const Json::Value & val)
+{
+    if (val.isNull()) return;
+    startMember(name);
+    buffer += val.toStringNoNewLine();
+}
+
+void
+OpenRTBResponseWriter::
+startMember(const char * name)
+{
+    if (!firstMember) buffer += ',';
+    firstMember = false;
+
+    buffer += '"';
+    buffer += name;
+    buffer += "\":";
+}
+
+void
+OpenRTBResponseWriter::
+appendString(const char * s, size_t length)
+{
+    // Escapes the same characters as StreamJsonPrintingContext, leaving the
+    // UTF-8 as it is.
+    const char * end = s + length;
+
+    buffer += '"';
+
+    while (s != end) {
+        const char * special = ML::findJsonSpecialChar(s, end);
+        buffer.append(s, special - s);
+        if (special == end) break;
+
+        char c = *special;
+        s = special + 1;
+
+        switch (c) {
+        case '\t': buffer += "\\t";  break;
+        case '\n': buffer += "\\n";  break;
+        case '\r': buffer += "\\r";  break;
+        case '\b': buffer += "\\b";  break;
+        case '\f': buffer += "\\f";  break;
+        case '\\':
+        case '\"': buffer += '\\';  buffer += c;  break;
+        default:   buffer += c;
+        }
+    }
+
+    buffer += '"';
+}
+
+} // namespace RTBKIT
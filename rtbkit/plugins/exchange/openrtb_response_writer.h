@@ -0,0 +1,94 @@
+/* openrtb_response_writer.h                                       -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Writes OpenRTB bid responses as JSON without building them first.
+*/
+
+#pragma once
+
+#include "soa/types/id.h"
+#include "soa/types/string.h"
+#include "soa/jsoncpp/json.h"
+#include <string>
+#include <vector>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* OPENRTB RESPONSE WRITER                                                   */
+/*****************************************************************************/
+
+/** Writes the JSON of an OpenRTB bid response straight into a string, one
+    member at a time, instead of filling an OpenRTB::BidResponse and printing
+    it through its value description.
+
+    The calls must follow the layout of the response:
+
+        startResponse(id)
+            startSeat()
+                startBid()  write*()...  endBid()
+                ...
+            endSeat(seat, ext)
+            ...
+        endSeats()
+        write*()...
+        endResponse()
+
+    and the members should be written in the order of the value descriptions
+    so that the output is the same as theirs.  Like them, the write*()
+    functions skip the values that are null or empty.
+
+    The string is cleared but keeps its capacity, so that a buffer that's
+    reused for each response doesn't need to grow once it's warm.
+*/
+
+struct OpenRTBResponseWriter {
+
+    OpenRTBResponseWriter(std::string & buffer);
+
+    void startResponse(const Datacratic::Id & id);
+
+    void startSeat();
+
+    void startBid();
+
+    void endBid();
+
+    void endSeat(const Datacratic::Id & seat,
+                 const Json::Value & ext = Json::Value());
+
+    void endSeats();
+
+    void endResponse();
+
+    void writeId(const char * name, const Datacratic::Id & val);
+
+    void writeString(const char * name, const std::string & val);
+
+    void writeString(const char * name, const Datacratic::Utf8String & val);
+
+    void writeStringList(const char * name,
+                         const std::vector<std::string> & val);
+
+    void writeDouble(const char * name, double val);
+
+    void writeJson(const char * name, const Json::Value & val);
+
+    /** Number of bids written so far. */
+    size_t numBids() const { return numBids_; }
+
+private:
+    std::string & buffer;
+    bool firstMember;
+    bool firstSeat;
+    bool firstBid;
+    size_t numBids_;
+
+    void startMember(const char * name);
+    void appendString(const char * s, size_t length);
+};
+
+} // namespace RTBKIT
@@ -0,0 +1,133 @@
+/* request_sampler.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Continuous sampling of the requests and responses of an exchange
+   connector.
+*/
+
+#include "request_sampler.h"
+#include "soa/logger/columnar_output.h"
+#include "soa/logger/threaded_output.h"
+#include "jml/arch/exception.h"
+#include "jml/arch/format.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* REQUEST SAMPLER                                                           */
+/*****************************************************************************/
+
+const std::string RequestSampler::Channel = "requests";
+
+RequestSampler::
+RequestSampler(const std::string & filename,
+               unsigned sampleRate,
+               size_t ringBufferSize,
+               size_t rowsPerChunk)
+    : sampleRate_(sampleRate), recorded(0)
+{
+    if (sampleRate_ == 0)
+        throw ML::Exception("request sample rate must be at least 1");
+
+    columnar = std::make_shared<ColumnarOutput>(filename, rowsPerChunk);
+    columnar->setColumnNames(Channel, { "timestamp", "exchange", "latencyMs",
+                                        "request", "response" });
+    output = std::make_shared<ThreadedOutput>(columnar, ringBufferSize);
+}
+
+RequestSampler::
+~RequestSampler()
+{
+    close();
+}
+
+std::shared_ptr<RequestSampler>
+RequestSampler::
+create(const Json::Value & config)
+{
+    if (!config.isMember("filename"))
+        throw ML::Exception("requestSampling needs a filename");
+
+    return std::make_shared<RequestSampler>(
+            config["filename"].asString(),
+            config.get("sampleRate", 1000).asUInt(),
+            config.get("ringBufferSize", 4096).asUInt(),
+            config.get("rowsPerChunk", 1024).asUInt());
+}
+
+bool
+RequestSampler::
+sample()
+{
+    unsigned * left = countdown.get();
+    if (!left) {
+        // Start each thread at a different point so that they don't all
+        // sample at once.
+        left = new unsigned(1 + random() % sampleRate_);
+        countdown.reset(left);
+    }
+
+    if (--*left) return false;
+
+    *left = sampleRate_;
+    return true;
+}
+
+void
+RequestSampler::
+record(const std::string & exchange,
+       const std::string & request,
+       const std::string & response,
+       Date received)
+{
+    string latency = ML::format("%.3f",
+                                Date::now().secondsSince(received) * 1000.0);
+    string timestamp = received.print(6);
+
+    string message;
+    message.reserve(timestamp.size() + exchange.size() + latency.size()
+                    + request.size() + response.size() + 4);
+
+    auto append = [&] (const std::string & field, bool last) {
+        size_t start = message.size();
+        message += field;
+        std::replace(message.begin() + start, message.end(), '\t', ' ');
+        if (!last) message += '\t';
+    };
+
+    append(timestamp, false);
+    append(exchange, false);
+    append(latency, false);
+    append(request, false);
+    append(response, true);
+
+    output->logMessage(Channel, message);
+    recorded.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+RequestSampler::
+close()
+{
+    if (output) output->close();
+}
+
+Json::Value
+RequestSampler::
+stats() const
+{
+    Json::Value result = output->stats();
+    result["sampleRate"] = sampleRate_;
+    result["recorded"] = (Json::UInt)recorded.load();
+    return result;
+}
+
+} // namespace RTBKIT
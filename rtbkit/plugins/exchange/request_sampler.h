@@ -0,0 +1,97 @@
+/* request_sampler.h                                               -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Continuous sampling of the requests and responses of an exchange
+   connector, to always have fresh data to replay.
+*/
+
+#pragma once
+
+#include "soa/types/date.h"
+#include "soa/jsoncpp/json.h"
+#include <boost/thread/tss.hpp>
+#include <memory>
+#include <string>
+#include <atomic>
+
+
+namespace Datacratic {
+struct ColumnarOutput;
+struct ThreadedOutput;
+} // namespace Datacratic
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* REQUEST SAMPLER                                                           */
+/*****************************************************************************/
+
+/** Keeps one in sampleRate of the requests of a connector along with the
+    response that was sent for them, and writes them to a columnar log
+    (see ColumnarOutput) on the "requests" channel with the columns
+
+        timestamp, exchange, latencyMs, request, response
+
+    where the request is the header and the body as they were received and
+    the response is as it went on the wire.  Tabs in either are written as
+    spaces, which leaves JSON and HTTP headers meaning the same.
+
+    Unlike startRequestLogging(), it's meant to be left on: deciding to
+    sample a request is a countdown of the calling thread, and a sampled
+    request is only copied into the lock free ring of a ThreadedOutput,
+    whose thread does the compression and the writing.  When the ring is
+    full the sample is dropped rather than holding up the connector.
+*/
+
+struct RequestSampler {
+
+    RequestSampler(const std::string & filename,
+                   unsigned sampleRate = 1000,
+                   size_t ringBufferSize = 4096,
+                   size_t rowsPerChunk = 1024);
+
+    ~RequestSampler();
+
+    /** Creates a sampler from the "requestSampling" configuration of a
+        connector:
+
+            { "filename": "requests.clog",
+              "sampleRate": 1000, "ringBufferSize": 4096,
+              "rowsPerChunk": 1024 }
+
+        Only the filename is required.
+    */
+    static std::shared_ptr<RequestSampler>
+    create(const Json::Value & config);
+
+    /** Whether the next request of the calling thread should be sampled. */
+    bool sample();
+
+    /** Queues the sampled request and its response to be written. */
+    void record(const std::string & exchange,
+                const std::string & request,
+                const std::string & response,
+                Datacratic::Date received);
+
+    /** Writes out the queued samples and closes the log. */
+    void close();
+
+    Json::Value stats() const;
+
+    unsigned sampleRate() const { return sampleRate_; }
+
+    static const std::string Channel;
+
+private:
+    unsigned sampleRate_;
+    std::shared_ptr<Datacratic::ColumnarOutput> columnar;
+    std::shared_ptr<Datacratic::ThreadedOutput> output;
+    std::atomic<uint64_t> recorded;
+
+    /// Requests left until the next sample, for each thread
+    boost::thread_specific_ptr<unsigned> countdown;
+};
+
+} // namespace RTBKIT
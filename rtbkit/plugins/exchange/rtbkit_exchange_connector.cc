@@ -121,29 +121,20 @@ adjustAuction(std::shared_ptr<Auction>& auction) const
     }
 }
 
-void
+Json::Value
 RTBKitExchangeConnector::
-setSeatBid(const Auction & auction,
-           int spotNum,
-           OpenRTB::BidResponse &response) const
+getBidExt(const Auction & auction, int spotNum) const
 {
-    // Same as OpenRTB
-    OpenRTBExchangeConnector::setSeatBid(auction, spotNum, response);
-
-    // We also add the externalId in the Bid extension field
+    // We add the externalId in the Bid extension field
     const Auction::Data *data = auction.getCurrentData();
 
     auto &resp = data->winningResponse(spotNum);
     const auto &agentConfig = resp.agentConfig;
 
-    OpenRTB::SeatBid &seatBid = response.seatbid.back();
-
-    OpenRTB::Bid &bid = seatBid.bid.back();
-
     Json::Value ext(Json::objectValue);
     ext["external-id"] = agentConfig->externalId;
     ext["priority"] = resp.price.priority;
-    bid.ext = ext;
+    return ext;
 }
 
 
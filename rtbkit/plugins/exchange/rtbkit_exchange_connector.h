@@ -181,10 +181,8 @@ struct RTBKitExchangeConnector : public OpenRTBExchangeConnector {
 
 protected:
 
-    virtual void
-    setSeatBid(const Auction &auction,
-               int spotNum,
-               OpenRTB::BidResponse &response) const;
+    virtual Json::Value
+    getBidExt(const Auction &auction, int spotNum) const;
 };
 
 } // namespace RTBKIT
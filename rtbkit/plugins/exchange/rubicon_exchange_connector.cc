@@ -10,6 +10,7 @@
 #include "soa/types/json_printing.h"
 #include <boost/any.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/tss.hpp>
 #include "jml/utils/file_functions.h"
 
 #include "crypto++/blowfish.h"
@@ -136,6 +137,21 @@ getCreativeCompatibility(const Creative & creative,
     return configuration_.handleCreativeCompatibility(creative, includeReasons);
 }
 
+namespace {
+
+struct WinPriceCipher {
+    WinPriceCipher()
+        : keyed(false)
+    {
+    }
+
+    bool keyed;
+    std::string secret;
+    CryptoPP::ECB_Mode<CryptoPP::Blowfish>::Decryption decryption;
+};
+
+} // file scope
+
 float
 RubiconExchangeConnector::
 decodeWinPrice(const std::string & sharedSecret,
@@ -160,32 +176,54 @@ decodeWinPrice(const std::string & sharedSecret,
             = tox(winPriceStr[i * 2]) * 16
             + tox(winPriceStr[i * 2 + 1]);
         
-    CryptoPP::ECB_Mode<CryptoPP::Blowfish>::Decryption d;
-    d.SetKey((byte *)sharedSecret.c_str(), sharedSecret.size());
-    CryptoPP::StreamTransformationFilter
-        filt(d, nullptr,
-             CryptoPP::StreamTransformationFilter::NO_PADDING);
-    filt.Put(input, 8);
-    filt.MessageEnd();
-    char recovered[9];
-    size_t nrecovered = filt.Get((byte *)recovered, 8);
+    // Setting up the Blowfish key is what costs, so each thread keeps its
+    // cipher keyed with the last secret that it was given.  The price is a
+    // single block, which is decrypted in place without a filter.
+    static boost::thread_specific_ptr<WinPriceCipher> ciphers;
+
+    WinPriceCipher * cipher = ciphers.get();
+    if (!cipher) {
+        cipher = new WinPriceCipher();
+        ciphers.reset(cipher);
+    }
+
+    if (!cipher->keyed || cipher->secret != sharedSecret) {
+        cipher->decryption.SetKey((byte *)sharedSecret.c_str(),
+                                  sharedSecret.size());
+        cipher->secret = sharedSecret;
+        cipher->keyed = true;
+    }
 
-    ExcAssertEqual(nrecovered, 8);
-    recovered[nrecovered] = 0;
+    char recovered[9];
+    cipher->decryption.ProcessData((byte *)recovered, input, 8);
+    recovered[8] = 0;
 
     float res = boost::lexical_cast<float>(recovered);
 
     return res;
 }
 
+Id
+RubiconExchangeConnector::
+getSeat(Auction const & auction, int spotNum) const
+{
+    auto & resp = auction.getCurrentData()->winningResponse(spotNum);
+
+    const AgentConfig * config =
+        std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
+
+    // Get the exchange specific data for this campaign
+    return config->getProviderData<CampaignInfo>(exchangeName())->seat;
+}
+
 void
 RubiconExchangeConnector::
-setSeatBid(Auction const & auction,
-           int spotNum,
-           OpenRTB::BidResponse & response) const
+writeBid(Auction const & auction,
+         int spotNum,
+         OpenRTBResponseWriter & writer) const
 {
     const Auction::Data * current = auction.getCurrentData();
-    
+
     // Get the winning bid
     auto & resp = current->winningResponse(spotNum);
 
@@ -196,9 +234,6 @@ setSeatBid(Auction const & auction,
 
     std::string en = exchangeName();
 
-    // Get the exchange specific data for this campaign
-    auto cpinfo = config->getProviderData<CampaignInfo>(en);
-
     // Put in the fixed parts from the creative
     int creativeIndex = resp.agentCreativeIndex;
 
@@ -207,49 +242,29 @@ setSeatBid(Auction const & auction,
     // Get the exchange specific data for this creative
     auto crinfo = creative.getProviderData<CreativeInfo>(en);
 
-    // Find the index in the seats array
-    int seatIndex = 0;
-    while(response.seatbid.size() != seatIndex) {
-        if(response.seatbid[seatIndex].seat == cpinfo->seat) break;
-        ++seatIndex;
-    }
-
-    // Create if required
-    if(seatIndex == response.seatbid.size()) {
-        response.seatbid.emplace_back();
-        response.seatbid.back().seat = cpinfo->seat;
-    }
+    RubiconCreativeConfiguration::Context ctx = {
+        creative,
+        resp,
+        *auction.request,
+        spotNum
+    };
 
-    // Get the seatBid object
-    OpenRTB::SeatBid & seatBid = response.seatbid.at(seatIndex);
-    
-    // Add a new bid to the array
-    seatBid.bid.emplace_back();
-    auto & b = seatBid.bid.back();
+    // Put in the variable parts, in the order of the OpenRTB bid
+    writer.writeId("id", Id(auction.id, auction.request->imp[0].id));
+    writer.writeId("impid", auction.request->imp[spotNum].id);
+    writer.writeDouble("price", getAmountIn<CPM>(resp.price.maxPrice));
+    writer.writeString("adm", configuration_.expand(crinfo->adm, ctx));
+    writer.writeStringList("adomain", crinfo->adomain);
 
-    // Put in the variable parts
     if (crinfo->cid.notNull()) {
         // either we use the configured campaign id...
-        b.cid = crinfo->cid;
+        writer.writeId("cid", crinfo->cid);
     } else {
         // ...or we use the agent name
-        b.cid = Id(resp.agent);
+        writer.writeString("cid", resp.agent);
     }
 
-    b.id = Id(auction.id, auction.request->imp[0].id);
-    b.impid = auction.request->imp[spotNum].id;
-    b.price.val = getAmountIn<CPM>(resp.price.maxPrice);
-
-    RubiconCreativeConfiguration::Context ctx = {
-        creative,
-        resp,
-        *auction.request,
-        spotNum
-    };
-
-    b.adm = configuration_.expand(crinfo->adm, ctx);
-    b.adomain = crinfo->adomain;
-    b.crid = crinfo->crid;
+    writer.writeId("crid", crinfo->crid);
 }
 
 } // namespace RTBKIT
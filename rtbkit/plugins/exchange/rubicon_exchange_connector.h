@@ -73,9 +73,11 @@ private:
     typedef TypedCreativeConfiguration<CreativeInfo> RubiconCreativeConfiguration;
     RubiconCreativeConfiguration configuration_;
     
-    virtual void setSeatBid(Auction const & auction,
-                            int spotNum,
-                            OpenRTB::BidResponse & response) const;
+    virtual Id getSeat(Auction const & auction, int spotNum) const;
+
+    virtual void writeBid(Auction const & auction,
+                          int spotNum,
+                          OpenRTBResponseWriter & writer) const;
 
     static Logging::Category print;
     static Logging::Category error;
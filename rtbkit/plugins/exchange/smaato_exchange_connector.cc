@@ -255,12 +255,25 @@ ExchangeConnector::ExchangeCompatibility
        return false;
   }
 
-void
+Id
 SmaatoExchangeConnector::
-setSeatBid(Auction const & auction,
-           int spotNum,
-           OpenRTB::BidResponse & response) const {
+getSeat(Auction const & auction, int spotNum) const
+{
+    auto & resp = auction.getCurrentData()->winningResponse(spotNum);
+
+    const AgentConfig * config =
+        std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
 
+    // Get the exchange specific data for this campaign
+    return config->getProviderData<CampaignInfo>(exchangeName())->seat;
+}
+
+void
+SmaatoExchangeConnector::
+writeBid(Auction const & auction,
+         int spotNum,
+         OpenRTBResponseWriter & writer) const
+{
     const Auction::Data * current = auction.getCurrentData();
 
     // Get the winning bid
@@ -273,9 +286,6 @@ setSeatBid(Auction const & auction,
 
     std::string en = exchangeName();
 
-    // Get the exchange specific data for this campaign
-    auto cpinfo = config->getProviderData<CampaignInfo>(en);
-
     // Put in the fixed parts from the creative
     int creativeIndex = resp.agentCreativeIndex;
 
@@ -284,34 +294,14 @@ setSeatBid(Auction const & auction,
     // Get the exchange specific data for this creative
     auto crinfo = creative.getProviderData<CreativeInfo>(en);
 
-    // Find the index in the seats array
-    int seatIndex = 0;
-    while(response.seatbid.size() != seatIndex) {
-        if(response.seatbid[seatIndex].seat == cpinfo->seat) break;
-        ++seatIndex;
-    }
-
-    // Create if required
-    if(seatIndex == response.seatbid.size()) {
-        response.seatbid.emplace_back();
-        response.seatbid.back().seat = cpinfo->seat;
-    }
-
-    // Get the seatBid object
-    OpenRTB::SeatBid & seatBid = response.seatbid.at(seatIndex);
-
-    // Add a new bid to the array
-    seatBid.bid.emplace_back();
-    auto & b = seatBid.bid.back();
-
-    // Put in the variable parts
-    b.cid = Id(resp.agent);
-    b.id = Id(auction.id, auction.request->imp[0].id);
-    b.impid = auction.request->imp[spotNum].id;
-    b.price.val = getAmountIn<CPM>(resp.price.maxPrice);
-    b.adm = crinfo->adm;
-    b.adomain = crinfo->adomain;
-    b.nurl = crinfo->nurl;
+    // Put in the variable parts, in the order of the OpenRTB bid
+    writer.writeId("id", Id(auction.id, auction.request->imp[0].id));
+    writer.writeId("impid", auction.request->imp[spotNum].id);
+    writer.writeDouble("price", getAmountIn<CPM>(resp.price.maxPrice));
+    writer.writeString("nurl", crinfo->nurl);
+    writer.writeString("adm", crinfo->adm);
+    writer.writeStringList("adomain", crinfo->adomain);
+    writer.writeString("cid", resp.agent);
 }
 
 } // namespace RTBKIT
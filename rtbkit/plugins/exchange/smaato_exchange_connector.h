@@ -78,9 +78,11 @@ struct SmaatoExchangeConnector: public OpenRTBExchangeConnector {
     typedef TypedCreativeConfiguration<CreativeInfo> SmaatoCreativeConfiguration;
     SmaatoCreativeConfiguration configuration_;
 
-    virtual void setSeatBid(Auction const & auction,
-                            int spotNum,
-                            OpenRTB::BidResponse & response) const;
+    virtual Id getSeat(Auction const & auction, int spotNum) const;
+
+    virtual void writeBid(Auction const & auction,
+                          int spotNum,
+                          OpenRTBResponseWriter & writer) const;
 
 
 
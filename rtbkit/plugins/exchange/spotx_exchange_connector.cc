@@ -164,11 +164,38 @@ SpotXExchangeConnector::getCreativeCompatibility(
     return configuration_.handleCreativeCompatibility(creative, includeReasons);
 }
 
+const SpotXExchangeConnector::CampaignInfo*
+SpotXExchangeConnector::getCampaignInfo(
+        const Auction& auction,
+        int spotNum) const {
+
+    auto& resp = auction.getCurrentData()->winningResponse(spotNum);
+
+    const AgentConfig* config
+        = std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
+
+    return config->getProviderData<CampaignInfo>(exchangeName());
+}
+
+Id
+SpotXExchangeConnector::getSeat(
+        const Auction& auction,
+        int spotNum) const {
+    return getCampaignInfo(auction, spotNum)->seat;
+}
+
+Json::Value
+SpotXExchangeConnector::getSeatExt(
+        const Auction& auction,
+        int spotNum) const {
+    return getSeatBidExtension(getCampaignInfo(auction, spotNum));
+}
+
 void
-SpotXExchangeConnector::setSeatBid(
+SpotXExchangeConnector::writeBid(
         const Auction& auction,
         int spotNum,
-        OpenRTB::BidResponse& response) const {
+        OpenRTBResponseWriter& writer) const {
 
     const Auction::Data *current = auction.getCurrentData();
 
@@ -178,35 +205,11 @@ SpotXExchangeConnector::setSeatBid(
         = std::static_pointer_cast<const AgentConfig>(resp.agentConfig).get();
     std::string name = exchangeName();
 
-    auto campaignInfo = config->getProviderData<CampaignInfo>(name);
     int creativeIndex = resp.agentCreativeIndex;
 
     auto& creative = config->creatives[creativeIndex];
     auto creativeInfo = creative.getProviderData<CreativeInfo>(name);
 
-    // Find the index in the seats array
-    int seatIndex = indexOf(response.seatbid, &OpenRTB::SeatBid::seat, Id(campaignInfo->seat));
-
-    OpenRTB::SeatBid* seatBid;
-
-    // Create the seat if it does not exist
-    if (seatIndex == -1) {
-        OpenRTB::SeatBid sbid;
-        sbid.seat = Id(campaignInfo->seat);
-        sbid.ext = getSeatBidExtension(campaignInfo);
-
-        response.seatbid.push_back(std::move(sbid));
-
-        seatBid = &response.seatbid.back();
-    }
-    else {
-        seatBid = &response.seatbid[seatIndex];
-    }
-
-    ExcAssert(seatBid);
-    seatBid->bid.emplace_back();
-    auto& bid = seatBid->bid.back();
-
     SpotXCreativeConfiguration::Context context {
         creative,
         resp,
@@ -214,18 +217,33 @@ SpotXExchangeConnector::setSeatBid(
         spotNum
     };
 
-    bid.cid = Id(resp.agent);
-    bid.crid = Id(resp.creativeId);
-    bid.impid = auction.request->imp[spotNum].id;
-    bid.id = Id(auction.id, auction.request->imp[0].id);
-    bid.price.val = USD_CPM(resp.price.maxPrice);
+    writer.writeId("id", Id(auction.id, auction.request->imp[0].id));
+    writer.writeId("impid", auction.request->imp[spotNum].id);
+    writer.writeDouble("price", USD_CPM(resp.price.maxPrice));
+    writer.writeString("adid", creativeInfo->adid);
+    writer.writeString("adm", configuration_.expand(creativeInfo->adm, context));
+    writer.writeStringList("adomain", creativeInfo->adomain);
+    writer.writeString("cid", resp.agent);
+    writer.writeString("crid", std::to_string(resp.creativeId));
+}
 
-    bid.adomain = creativeInfo->adomain;
-    bid.adid = Id(creativeInfo->adid);
-    bid.adm = configuration_.expand(creativeInfo->adm, context);
+void
+SpotXExchangeConnector::writeResponseMembers(
+        const Auction& auction,
+        OpenRTBResponseWriter& writer) const {
+
+    const Auction::Data *current = auction.getCurrentData();
+
+    // The bidid is the one of the campaign of the last bid
+    for (int spotNum = current->responses.size() - 1; spotNum >= 0; --spotNum) {
+        if (!current->hasValidResponse(spotNum))
+            continue;
+
+        writer.writeString("bidid", getCampaignInfo(auction, spotNum)->bidid);
+        break;
+    }
 
-    response.bidid = Id(campaignInfo->bidid);
-    response.cur = "USD";
+    writer.writeString("cur", std::string("USD"));
 }
 
 Json::Value
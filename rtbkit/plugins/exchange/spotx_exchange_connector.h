@@ -67,9 +67,19 @@ private:
     typedef TypedCreativeConfiguration<CreativeInfo> SpotXCreativeConfiguration;
     SpotXCreativeConfiguration configuration_;
 
-    void setSeatBid(const Auction& auction,
-                    int spotNum,
-                    OpenRTB::BidResponse& response) const;
+    Id getSeat(const Auction& auction, int spotNum) const;
+
+    Json::Value getSeatExt(const Auction& auction, int spotNum) const;
+
+    void writeBid(const Auction& auction,
+                  int spotNum,
+                  OpenRTBResponseWriter& writer) const;
+
+    void writeResponseMembers(const Auction& auction,
+                              OpenRTBResponseWriter& writer) const;
+
+    const CampaignInfo* getCampaignInfo(const Auction& auction,
+                                        int spotNum) const;
 
     Json::Value getSeatBidExtension(const CampaignInfo* info) const;
 
@@ -0,0 +1,71 @@
+/* adx_exchange_connector_bench.cc                                 -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Benchmark of the decoding of the captured AdX bid requests.
+*/
+
+#include "rtbkit/plugins/exchange/adx_exchange_connector.h"
+#include "soa/types/date.h"
+#include "jml/utils/exc_check.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+const std::string bid_sample_filename("rtbkit/plugins/exchange/testing/adx-bidrequests.dat");
+
+/** The capture file is a sequence of serialized bid requests, each preceded
+    by its length on 4 bytes.
+*/
+vector<string> loadRequests(const std::string & filename)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::in|std::ios::binary);
+    ExcCheck(ifs.is_open(), "couldn't open " + filename);
+
+    vector<string> requests;
+    for (;;) {
+        uint32_t len = 0;
+        if (!ifs.read((char *)&len, 4)) break;
+
+        string payload(len, '\0');
+        ifs.read(&payload[0], len);
+        ExcCheck(ifs, "truncated bid request in " + filename);
+        requests.push_back(payload);
+    }
+
+    ExcCheck(!requests.empty(), "no bid requests in " + filename);
+    return requests;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    auto requests = loadRequests(bid_sample_filename);
+
+    auto proxies = std::make_shared<ServiceProxies>();
+    AdXExchangeConnector connector("connector", proxies);
+
+    size_t decoded = 0;
+    Date start = Date::now();
+
+    for (size_t i = 0; i < iterations; ++i) {
+        AdXExchangeConnector::DecodeStatus status;
+        auto br = connector.decodeBidRequest(requests[i % requests.size()], status);
+        if (br) ++decoded;
+    }
+
+    double elapsed = Date::now().secondsSince(start);
+
+    cerr << iterations << " requests (" << decoded << " decoded) in "
+         << elapsed << "s: " << (elapsed / iterations * 1e6) << "us/request, "
+         << (iterations / elapsed) << " requests/s"
+         << endl;
+}
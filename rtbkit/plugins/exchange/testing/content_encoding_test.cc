@@ -0,0 +1,169 @@
+/** content_encoding_test.cc                                 -*- C++ -*-
+    15 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the Content-Encoding support of the http exchange connector.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/exchange/content_encoding.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+string makeBody()
+{
+    string body = "{\"id\":\"51dc0333-1cbb-4753-8db9-69cbb38000c1\",\"imp\":[";
+    for (int i = 0; i < 50; ++i) {
+        if (i) body += ",";
+        body += "{\"id\":\"" + to_string(i) + "\",\"banner\":{\"w\":300,"
+            "\"h\":250},\"bidfloor\":0.15}";
+    }
+    return body + "]}";
+}
+
+HttpHeader makeHeader(const string & contentEncoding,
+                      const string & acceptEncoding = "")
+{
+    HttpHeader header;
+    header.verb = "POST";
+    header.resource = "/auctions";
+    if (!contentEncoding.empty())
+        header.headers["content-encoding"] = contentEncoding;
+    if (!acceptEncoding.empty())
+        header.headers["accept-encoding"] = acceptEncoding;
+    return header;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( roundTrip )
+{
+    string body = makeBody();
+
+    for (ContentCoding coding: { CC_GZIP, CC_DEFLATE }) {
+        string compressed, decompressed;
+        compressBody(body.data(), body.size(), coding, 1, compressed);
+        BOOST_CHECK_LT(compressed.size() * 4, body.size());
+
+        decompressBody(compressed.data(), compressed.size(), coding,
+                       decompressed, 1 << 20);
+        BOOST_CHECK_EQUAL(decompressed, body);
+
+        // Too small a limit
+        BOOST_CHECK_THROW(decompressBody(compressed.data(), compressed.size(),
+                                         coding, decompressed, 100),
+                          std::exception);
+
+        // Truncated or corrupt
+        BOOST_CHECK_THROW(decompressBody(compressed.data(),
+                                         compressed.size() / 2,
+                                         coding, decompressed, 1 << 20),
+                          std::exception);
+        BOOST_CHECK_THROW(decompressBody(body.data(), body.size(),
+                                         coding, decompressed, 1 << 20),
+                          std::exception);
+    }
+
+    // gzip data is accepted as deflate, as some exchanges mix them up.
+    string compressed, decompressed;
+    compressBody(body.data(), body.size(), CC_GZIP, 6, compressed);
+    decompressBody(compressed.data(), compressed.size(), CC_DEFLATE,
+                   decompressed, 1 << 20);
+    BOOST_CHECK_EQUAL(decompressed, body);
+}
+
+BOOST_AUTO_TEST_CASE( parsing )
+{
+    BOOST_CHECK_EQUAL(parseContentCoding(""), CC_IDENTITY);
+    BOOST_CHECK_EQUAL(parseContentCoding("identity"), CC_IDENTITY);
+    BOOST_CHECK_EQUAL(parseContentCoding(" GZip "), CC_GZIP);
+    BOOST_CHECK_EQUAL(parseContentCoding("x-gzip"), CC_GZIP);
+    BOOST_CHECK_EQUAL(parseContentCoding("deflate"), CC_DEFLATE);
+    BOOST_CHECK_EQUAL(parseContentCoding("br"), CC_UNKNOWN);
+
+    BOOST_CHECK(acceptsContentCoding("gzip, deflate", CC_GZIP));
+    BOOST_CHECK(acceptsContentCoding("gzip, deflate", CC_DEFLATE));
+    BOOST_CHECK(!acceptsContentCoding("deflate", CC_GZIP));
+    BOOST_CHECK(!acceptsContentCoding("", CC_GZIP));
+    BOOST_CHECK(acceptsContentCoding("", CC_IDENTITY));
+    BOOST_CHECK(acceptsContentCoding("*", CC_GZIP));
+    BOOST_CHECK(!acceptsContentCoding("*, gzip;q=0", CC_GZIP));
+    BOOST_CHECK(acceptsContentCoding("deflate;q=0.5, gzip;q=1.0", CC_GZIP));
+}
+
+BOOST_AUTO_TEST_CASE( requests )
+{
+    string body = makeBody();
+    string compressed;
+    compressBody(body.data(), body.size(), CC_GZIP, 1, compressed);
+
+    ContentEncoding encoding;
+
+    // Plain requests are passed through without a copy.
+    BOOST_CHECK_EQUAL(&encoding.decodeRequest(makeHeader(""), body), &body);
+    BOOST_CHECK_EQUAL(&encoding.decodeRequest(makeHeader("identity"), body),
+                      &body);
+
+    BOOST_CHECK_EQUAL(encoding.decodeRequest(makeHeader("gzip"), compressed),
+                      body);
+    BOOST_CHECK_THROW(encoding.decodeRequest(makeHeader("br"), compressed),
+                      std::exception);
+
+    Json::Value config;
+    config["decompressRequests"] = false;
+    encoding.configure(config);
+    BOOST_CHECK_THROW(encoding.decodeRequest(makeHeader("gzip"), compressed),
+                      std::exception);
+
+    config["decompressRequests"] = true;
+    config["maxRequestBytes"] = 1000;
+    encoding.configure(config);
+    BOOST_CHECK_THROW(encoding.decodeRequest(makeHeader("gzip"), compressed),
+                      std::exception);
+}
+
+BOOST_AUTO_TEST_CASE( responses )
+{
+    string body = makeBody();
+    ContentEncoding encoding;
+
+    // Off by default
+    HttpResponse response(200, "application/json", body);
+    BOOST_CHECK(!encoding.encodeResponse(makeHeader("", "gzip"), response));
+    BOOST_CHECK_EQUAL(response.body, body);
+
+    Json::Value config;
+    config["compressResponses"] = "gzip";
+    encoding.configure(config);
+
+    // Not accepted by the exchange
+    BOOST_CHECK(!encoding.encodeResponse(makeHeader("", "deflate"), response));
+    BOOST_CHECK(response.extraHeaders.empty());
+
+    // Too small to be worth it
+    HttpResponse small(200, "application/json", "{}");
+    BOOST_CHECK(!encoding.encodeResponse(makeHeader("", "gzip"), small));
+
+    BOOST_CHECK(encoding.encodeResponse(makeHeader("", "gzip"), response));
+    BOOST_REQUIRE_EQUAL(response.extraHeaders.size(), 1);
+    BOOST_CHECK_EQUAL(response.extraHeaders[0].first, "Content-Encoding");
+    BOOST_CHECK_EQUAL(response.extraHeaders[0].second, "gzip");
+
+    string decompressed;
+    decompressBody(response.body.data(), response.body.size(), CC_GZIP,
+                   decompressed, 1 << 20);
+    BOOST_CHECK_EQUAL(decompressed, body);
+
+    config["compressResponses"] = "br";
+    BOOST_CHECK_THROW(encoding.configure(config), std::exception);
+}
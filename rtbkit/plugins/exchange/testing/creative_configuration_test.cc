@@ -400,3 +400,43 @@ BOOST_AUTO_TEST_CASE(test_exchange_expander)
     // Note that it currently throws because %{city} is an unknown variable for rubicon.
     BOOST_CHECK_THROW(test("rubicon", "%{city}"), std::runtime_error);
 }
+
+BOOST_AUTO_TEST_CASE(test_literal_segments)
+{
+    struct CreativeInfo { };
+
+    typedef TypedCreativeConfiguration<CreativeInfo> MyCreativeConfig;
+
+    MyCreativeConfig config("test");
+    config.addField("snippet",
+        [](const Json::Value& value, CreativeInfo&)
+        {
+            return true;
+        }
+    ).snippet();
+
+    const std::string snippet =
+        "<a href=\"%{bidrequest.id}\">%{creative.name}%{bidrequest.id}</a>";
+
+    Json::Value providerConfig;
+    providerConfig["test"]["snippet"] = snippet;
+    example1.providerConfig = providerConfig;
+
+    auto result = config.handleCreativeCompatibility(example1, true);
+    BOOST_CHECK(result.isCompatible);
+
+    RTBKIT::BidRequest br;
+    br.auctionId = Datacratic::Id("abc");
+
+    RTBKIT::Auction::Response response;
+    MyCreativeConfig::Context context {
+        example1, response, br, 0
+    };
+
+    BOOST_CHECK_EQUAL(config.expand(snippet, context),
+                      "<a href=\"abc\">" + example1.name + "abc</a>");
+
+    // Snippets that weren't configured are left as they are.
+    BOOST_CHECK_EQUAL(config.expand("%{bidrequest.id}", context),
+                      "%{bidrequest.id}");
+}
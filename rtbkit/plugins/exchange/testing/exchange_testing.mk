@@ -10,9 +10,15 @@ $(eval $(call test,bidswitch_filters_test,static_filters bidswitch_exchange,boos
 $(eval $(call test,nexage_exchange_connector_test,nexage_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
 $(eval $(call test,adx_exchange_connector_test,adx_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
 $(eval $(call test,openrtb_exchange_connector_test,openrtb_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
+$(eval $(call test,openrtb_response_writer_test,openrtb_exchange openrtb,boost))
 $(eval $(call test,rtbkit_exchange_connector_test,rtbkit_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
 $(eval $(call test,casale_exchange_connector_test,casale_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
 $(eval $(call test,creative_ids_exchange_filter_test,static_filters rtbkit_exchange,boost))
 $(eval $(call test,spotx_exchange_connector_test,spotx_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
 
 $(eval $(call test,creative_configuration_test,exchange agent_configuration bid_request jsoncpp types,boost))
+$(eval $(call test,load_shedder_test,jsoncpp,boost))
+$(eval $(call test,value_shedder_test,exchange,boost))
+$(eval $(call test,content_encoding_test,exchange,boost))
+$(eval $(call test,request_sampler_test,exchange,boost))
+$(eval $(call program,adx_exchange_connector_bench,adx_exchange services))
@@ -0,0 +1,91 @@
+/** load_shedder_test.cc                                 -*- C++ -*-
+    14 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the load shedding controller of the http exchange connector.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/exchange/load_shedder.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( shedsOnLateResponses )
+{
+    LoadShedder shedder;
+    BOOST_CHECK_EQUAL(shedder.shedProbability(), 0.0);
+    BOOST_CHECK(!shedder.shedRequest());
+
+    // Everything on time: nothing to shed.
+    for (size_t i = 0; i < 100; ++i)
+        shedder.recordResponse(10.0, 100.0);
+    shedder.update(0.0, 0);
+    BOOST_CHECK_EQUAL(shedder.shedProbability(), 0.0);
+
+    // 5% of the responses are too late so we start dropping.
+    for (size_t i = 0; i < 95; ++i)
+        shedder.recordResponse(10.0, 100.0);
+    for (size_t i = 0; i < 5; ++i)
+        shedder.recordResponse(95.0, 100.0);
+    shedder.update(0.0, 0);
+    double prob = shedder.shedProbability();
+    BOOST_CHECK_GT(prob, 0.0);
+
+    // Back on time: the probability decays.
+    for (size_t i = 0; i < 100; ++i)
+        shedder.recordResponse(10.0, 100.0);
+    shedder.update(0.0, 0);
+    BOOST_CHECK_LT(shedder.shedProbability(), prob);
+
+    for (size_t i = 0; i < 1000; ++i)
+        shedder.update(0.0, 0);
+    BOOST_CHECK_EQUAL(shedder.shedProbability(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( boundedProbability )
+{
+    LoadShedder shedder;
+
+    for (size_t i = 0; i < 100; ++i) {
+        shedder.recordResponse(100.0, 100.0);
+        shedder.update(0.0, 0);
+    }
+    BOOST_CHECK_EQUAL(shedder.shedProbability(), shedder.maxShedProbability);
+}
+
+BOOST_AUTO_TEST_CASE( loadAndQueueSignals )
+{
+    LoadShedder shedder;
+
+    // Ignored by default.
+    shedder.update(1.0, 1000);
+    BOOST_CHECK_EQUAL(shedder.shedProbability(), 0.0);
+
+    Json::Value config;
+    config["loadThreshold"] = 0.8;
+    config["maxServingRequests"] = 100;
+    shedder.configure(config);
+
+    shedder.update(0.5, 10);
+    BOOST_CHECK_EQUAL(shedder.shedProbability(), 0.0);
+
+    shedder.update(0.9, 10);
+    BOOST_CHECK_GT(shedder.shedProbability(), 0.0);
+
+    LoadShedder queued;
+    queued.configure(config);
+    queued.update(0.0, 200);
+    BOOST_CHECK_GT(queued.shedProbability(), 0.0);
+
+    config["enabled"] = false;
+    queued.configure(config);
+    queued.update(0.0, 200);
+    BOOST_CHECK_EQUAL(queued.shedProbability(), 0.0);
+}
@@ -0,0 +1,141 @@
+/** openrtb_response_writer_test.cc                            -*- C++ -*-
+    15 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests that the OpenRTB response writer gives the same JSON as the value
+    descriptions.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/exchange/openrtb_response_writer.h"
+#include "rtbkit/openrtb/openrtb_parsing.h"
+#include "soa/types/json_printing.h"
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+string print(const OpenRTB::BidResponse & response)
+{
+    static DefaultDescription<OpenRTB::BidResponse> desc;
+    std::ostringstream stream;
+    StreamJsonPrintingContext context(stream);
+    desc.printJsonTyped(&response, context);
+    return stream.str();
+}
+
+void write(OpenRTBResponseWriter & writer, const OpenRTB::Bid & bid)
+{
+    writer.startBid();
+    writer.writeId("id", bid.id);
+    writer.writeId("impid", bid.impid);
+    writer.writeDouble("price", bid.price.val);
+    writer.writeId("adid", bid.adid);
+    writer.writeString("nurl", bid.nurl);
+    writer.writeString("adm", bid.adm);
+    writer.writeStringList("adomain", bid.adomain);
+    writer.writeString("iurl", bid.iurl);
+    writer.writeId("cid", bid.cid);
+    writer.writeId("crid", bid.crid);
+    writer.writeJson("ext", bid.ext);
+    writer.endBid();
+}
+
+string write(const OpenRTB::BidResponse & response)
+{
+    string buffer;
+    OpenRTBResponseWriter writer(buffer);
+    writer.startResponse(response.id);
+    for (auto & seat: response.seatbid) {
+        writer.startSeat();
+        for (auto & bid: seat.bid)
+            write(writer, bid);
+        writer.endSeat(seat.seat, seat.ext);
+    }
+    writer.endSeats();
+    writer.writeId("bidid", response.bidid);
+    writer.writeString("cur", response.cur);
+    writer.writeJson("ext", response.ext);
+    writer.endResponse();
+    return buffer;
+}
+
+OpenRTB::Bid makeBid(int imp, double price)
+{
+    OpenRTB::Bid bid;
+    bid.id = Id(Id("auction-1234"), Id(imp));
+    bid.impid = Id(imp);
+    bid.price.val = price;
+    bid.cid = Id("agent");
+    bid.crid = Id(std::to_string(imp * 10));
+    return bid;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( same_as_description )
+{
+    OpenRTB::BidResponse response;
+    response.id = Id("auction-1234");
+    response.seatbid.emplace_back();
+    response.seatbid.back().bid.push_back(makeBid(1, 1.25));
+    BOOST_CHECK_EQUAL(write(response), print(response));
+
+    // Everything that the connectors write
+    auto & bid = response.seatbid.back().bid.back();
+    bid.adid = Id("ad-1");
+    bid.nurl = "http://win.com/?price=${AUCTION_PRICE}&a=\"b\"\\c/d";
+    bid.adm = "<a href=\"http://x.com/\">\t\xc3\xa9t\xc3\xa9\r\n</a>";
+    bid.adomain = { "x.com", "y.com" };
+    bid.iurl = "http://x.com/image.png";
+    bid.ext["priority"] = 2;
+    bid.ext["names"][0] = "n";
+    BOOST_CHECK_EQUAL(write(response), print(response));
+
+    // Several seats with several bids
+    response.seatbid.back().seat = Id("seat-1");
+    response.seatbid.back().bid.push_back(makeBid(2, 0.0001));
+    response.seatbid.emplace_back();
+    response.seatbid.back().seat = Id(42);
+    response.seatbid.back().ext["seatname"] = "forty two";
+    response.seatbid.back().bid.push_back(makeBid(3, 1e6));
+    response.bidid = Id("bid-1");
+    response.cur = "USD";
+    response.ext["protocol"] = "4.0";
+    BOOST_CHECK_EQUAL(write(response), print(response));
+}
+
+BOOST_AUTO_TEST_CASE( buffer_is_reused )
+{
+    string buffer;
+    {
+        OpenRTBResponseWriter writer(buffer);
+        writer.startResponse(Id("abc"));
+        writer.startSeat();
+        writer.startBid();
+        writer.writeString("adm", string(10000, 'x'));
+        writer.endBid();
+        writer.endSeat(Id());
+        writer.endSeats();
+        writer.endResponse();
+        BOOST_CHECK_EQUAL(writer.numBids(), 1);
+    }
+
+    size_t capacity = buffer.capacity();
+
+    OpenRTBResponseWriter writer(buffer);
+    writer.startResponse(Id("abc"));
+    writer.endSeats();
+    writer.endResponse();
+    BOOST_CHECK_EQUAL(writer.numBids(), 0);
+    BOOST_CHECK_EQUAL(buffer, "{\"id\":\"abc\"}");
+    BOOST_CHECK_EQUAL(buffer.capacity(), capacity);
+}
@@ -0,0 +1,106 @@
+/** request_sampler_test.cc                                    -*- C++ -*-
+    15 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the sampling of the requests of the exchange connectors.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/exchange/request_sampler.h"
+#include "soa/logger/columnar_output.h"
+
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include <thread>
+#include <iostream>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+string tempFile()
+{
+    return "tmp/request_sampler_test-" + to_string(getpid()) + ".clog";
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( sampleRate )
+{
+    string filename = tempFile();
+    RequestSampler sampler(filename, 100);
+
+    // Each thread samples exactly one in 100 of its requests.
+    auto countSamples = [&] () {
+        int n = 0;
+        for (int i = 0;  i < 10000;  ++i)
+            n += sampler.sample();
+        return n;
+    };
+
+    BOOST_CHECK_EQUAL(countSamples(), 100);
+
+    int otherThread = 0;
+    std::thread thread([&] () { otherThread = countSamples(); });
+    thread.join();
+    BOOST_CHECK_EQUAL(otherThread, 100);
+
+    BOOST_CHECK_THROW(RequestSampler(filename, 0), std::exception);
+
+    sampler.close();
+    unlink(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( record )
+{
+    string filename = tempFile();
+
+    string request = "POST /auctions HTTP/1.1\r\nContent-Length: 17\r\n\r\n"
+        "{\"id\":\t\"abc\"}\n";
+    string response = "HTTP/1.1 204 No Content\r\n\r\n";
+
+    {
+        Json::Value config;
+        config["filename"] = filename;
+        config["sampleRate"] = 1;
+        auto sampler = RequestSampler::create(config);
+        BOOST_CHECK(sampler->sample());
+
+        Date received = Date::now();
+        for (unsigned i = 0;  i < 10;  ++i)
+            sampler->record("openrtb", request, response, received);
+
+        BOOST_CHECK_EQUAL(sampler->stats()["recorded"].asInt(), 10);
+        sampler->close();
+    }
+
+    ColumnarLogReader reader(filename);
+    ColumnarChunk chunk;
+    BOOST_REQUIRE(reader.next(chunk));
+    BOOST_CHECK_EQUAL(chunk.channel, RequestSampler::Channel);
+    BOOST_CHECK_EQUAL(chunk.numRows, 10);
+
+    int exchange = chunk.columnIndex("exchange");
+    int req = chunk.columnIndex("request");
+    int resp = chunk.columnIndex("response");
+    BOOST_REQUIRE(exchange != -1 && req != -1 && resp != -1);
+
+    BOOST_CHECK_EQUAL(chunk.column(exchange)[9], "openrtb");
+    BOOST_CHECK_EQUAL(chunk.column(resp)[0], response);
+
+    // Tabs are written as spaces so that the columns stay aligned.
+    string expected = request;
+    replace(expected.begin(), expected.end(), '\t', ' ');
+    BOOST_CHECK_EQUAL(chunk.column(req)[0], expected);
+
+    BOOST_CHECK(!reader.next(chunk));
+    unlink(filename.c_str());
+
+    Json::Value config;
+    BOOST_CHECK_THROW(RequestSampler::create(config), std::exception);
+}
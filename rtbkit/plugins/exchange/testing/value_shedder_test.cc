@@ -0,0 +1,117 @@
+/** value_shedder_test.cc                                -*- C++ -*-
+    15 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the value based load shedding of the http exchange connector.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/exchange/value_shedder.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( valuesFromWinRates )
+{
+    ValueShedder shedder;
+    BOOST_CHECK(!shedder.enabled());
+
+    Json::Value config;
+    config["defaultWinRate"] = 0.5;
+    config["minFloor"] = 0.1;
+    shedder.configure(config);
+    BOOST_CHECK(shedder.enabled());
+
+    shedder.setWinRates({ { "site1", 0.2 } });
+    BOOST_CHECK_CLOSE(shedder.value(2.0, "site1"), 0.4, 1e-9);
+    BOOST_CHECK_CLOSE(shedder.value(2.0, "site2"), 1.0, 1e-9);
+    BOOST_CHECK_CLOSE(shedder.value(2.0, ""), 1.0, 1e-9);
+
+    // No floor is worth the minimum one
+    BOOST_CHECK_CLOSE(shedder.value(0.0, "site1"), 0.02, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( buckets )
+{
+    BOOST_CHECK_EQUAL(ValueShedder::bucketOf(0.0), 0);
+    BOOST_CHECK_EQUAL(ValueShedder::bucketOf(1e-9), 0);
+    BOOST_CHECK_EQUAL(ValueShedder::bucketOf(1e9), ValueShedder::NumBuckets - 1);
+
+    int last = 0;
+    for (double value = 1e-4;  value < 1e4;  value *= 1.1) {
+        int bucket = ValueShedder::bucketOf(value);
+        BOOST_CHECK_GE(bucket, last);
+        BOOST_CHECK_GT(bucket, 0);
+        BOOST_CHECK_LT(bucket, ValueShedder::NumBuckets - 1);
+        last = bucket;
+    }
+
+    // Four buckets per doubling
+    BOOST_CHECK_EQUAL(ValueShedder::bucketOf(2.0) - ValueShedder::bucketOf(1.0),
+                      ValueShedder::BucketsPerOctave);
+}
+
+BOOST_AUTO_TEST_CASE( shedsTheLowestValues )
+{
+    ValueShedder shedder;
+
+    // Nothing to rank against yet: dropped at random, whatever the value
+    size_t dropped = 0;
+    for (size_t i = 0; i < 10000; ++i)
+        dropped += shedder.shed(100.0, 0.5);
+    BOOST_CHECK_GT(dropped, 4000);
+    BOOST_CHECK_LT(dropped, 6000);
+
+    auto stats = shedder.update();
+    BOOST_CHECK_EQUAL(stats.requests, 10000);
+    BOOST_CHECK_EQUAL(stats.shedRequests, dropped);
+
+    // Values of 1 to 8, evenly spread
+    auto offer = [&] (double fraction, double & shedValue, double & keptValue)
+        {
+            shedValue = keptValue = 0.0;
+            size_t shed = 0;
+            for (size_t i = 0; i < 8000; ++i) {
+                double value = 1 + i % 8;
+                if (shedder.shed(value, fraction)) {
+                    shedValue += value;
+                    ++shed;
+                }
+                else keptValue += value;
+            }
+            return shed;
+        };
+
+    double shedValue, keptValue;
+    offer(0.0, shedValue, keptValue);
+    BOOST_CHECK_EQUAL(shedValue, 0.0);
+    shedder.update();
+
+    // Half of the requests go, and they're the cheap half
+    size_t shed = offer(0.5, shedValue, keptValue);
+    BOOST_CHECK_GT(shed, 3600);
+    BOOST_CHECK_LT(shed, 4400);
+    BOOST_CHECK_LT(shedValue, keptValue / 2);
+
+    stats = shedder.update();
+    BOOST_CHECK_EQUAL(stats.requests, 8000);
+    BOOST_CHECK_EQUAL(stats.shedRequests, shed);
+    BOOST_CHECK_CLOSE(stats.value, 36000.0, 1e-3);
+    BOOST_CHECK_CLOSE(stats.shedValue, shedValue, 1e-3);
+
+    // Everything goes when we have to
+    BOOST_CHECK_EQUAL(offer(1.0, shedValue, keptValue), 8000);
+
+    // Unscored requests are still dropped at random
+    dropped = 0;
+    for (size_t i = 0; i < 10000; ++i)
+        dropped += shedder.shed(-1.0, 0.25);
+    BOOST_CHECK_GT(dropped, 2000);
+    BOOST_CHECK_LT(dropped, 3000);
+}
@@ -0,0 +1,199 @@
+/* value_shedder.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Picks the bid requests to drop when shedding load by their value.
+*/
+
+#include "value_shedder.h"
+#include "jml/arch/exception.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+namespace {
+
+/// Fewer values than this in a period aren't enough to rank the next ones
+const uint64_t MinRankedValues = 100;
+
+bool randomlyUnder(double probability)
+{
+    return random() % 1000000 < 1000000 * probability;
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* VALUE SHEDDER                                                             */
+/*****************************************************************************/
+
+ValueShedder::
+ValueShedder()
+    : enabled_(false), defaultWinRate(1.0), minFloor(0.01),
+      reloadSeconds(60.0), current(-1),
+      numRequests(0), numShed(0), valueMicros(0), shedValueMicros(0)
+{
+    for (auto & count: counts)
+        count = 0;
+}
+
+void
+ValueShedder::
+configure(const Json::Value & config)
+{
+    if (config.isNull()) return;
+
+    enabled_ = config.get("enabled", true).asBool();
+    winRatesFile = config.get("winRates", winRatesFile).asString();
+    defaultWinRate = config.get("defaultWinRate", defaultWinRate).asDouble();
+    minFloor = config.get("minFloor", minFloor).asDouble();
+    reloadSeconds = config.get("reloadSeconds", reloadSeconds).asDouble();
+
+    if (enabled_ && !winRatesFile.empty())
+        loadWinRates();
+}
+
+void
+ValueShedder::
+loadWinRates()
+{
+    Json::Value json = Json::parseFromFile(winRatesFile);
+    if (!json.isObject())
+        throw ML::Exception("win rates in %s aren't an object",
+                            winRatesFile.c_str());
+
+    WinRates rates;
+    for (auto it = json.begin(), end = json.end();  it != end;  ++it)
+        rates[it.memberName()] = (*it).asDouble();
+
+    setWinRates(rates);
+    lastReload = Date::now();
+}
+
+void
+ValueShedder::
+setWinRates(const std::unordered_map<std::string, double> & rates)
+{
+    std::atomic_store(&winRates,
+                      std::shared_ptr<const WinRates>(new WinRates(rates)));
+}
+
+double
+ValueShedder::
+value(double bidFloor, const std::string & site) const
+{
+    double rate = defaultWinRate;
+
+    auto rates = std::atomic_load(&winRates);
+    if (rates && !site.empty()) {
+        auto it = rates->find(site);
+        if (it != rates->end())
+            rate = it->second;
+    }
+
+    return std::max(bidFloor, minFloor) * rate;
+}
+
+int
+ValueShedder::
+bucketOf(double value)
+{
+    if (!(value >= std::ldexp(1.0, MinExponent)))
+        return 0;
+    if (value >= std::ldexp(1.0, MaxExponent))
+        return NumBuckets - 1;
+
+    int bucket = std::floor((std::log2(value) - MinExponent) * BucketsPerOctave);
+    return 1 + std::min<int>(bucket, NumBuckets - 3);
+}
+
+bool
+ValueShedder::
+shed(double value, double fraction)
+{
+    numRequests.fetch_add(1, std::memory_order_relaxed);
+
+    bool drop;
+    if (value < 0.0)
+        drop = fraction > 0.0 && randomlyUnder(fraction);
+    else {
+        int bucket = bucketOf(value);
+        counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        valueMicros.fetch_add(value * 1e6, std::memory_order_relaxed);
+
+        int ranking = current.load(std::memory_order_acquire);
+        if (fraction <= 0.0)
+            drop = false;
+        else if (ranking == -1)
+            drop = randomlyUnder(fraction);
+        else {
+            // The requests of the bucket that the fraction ends in are
+            // dropped at random, so that the right fraction is
+            const Ranking & r = rankings[ranking];
+            double under = r.below[bucket], over = r.below[bucket + 1];
+            if (fraction <= under) drop = false;
+            else if (fraction >= over) drop = true;
+            else drop = randomlyUnder((fraction - under) / (over - under));
+        }
+
+        if (drop)
+            shedValueMicros.fetch_add(value * 1e6, std::memory_order_relaxed);
+    }
+
+    if (drop)
+        numShed.fetch_add(1, std::memory_order_relaxed);
+    return drop;
+}
+
+ValueShedder::Stats
+ValueShedder::
+update(Date now)
+{
+    Stats stats;
+    stats.requests = numRequests.exchange(0);
+    stats.shedRequests = numShed.exchange(0);
+    stats.value = valueMicros.exchange(0) / 1e6;
+    stats.shedValue = shedValueMicros.exchange(0) / 1e6;
+
+    uint64_t seen[NumBuckets];
+    uint64_t total = 0;
+    for (unsigned i = 0;  i < NumBuckets;  ++i)
+        total += seen[i] = counts[i].exchange(0);
+
+    // Otherwise the last ranking stays
+    if (total >= MinRankedValues) {
+        int next = current == 0 ? 1 : 0;
+        Ranking & r = rankings[next];
+
+        uint64_t under = 0;
+        for (unsigned i = 0;  i < NumBuckets;  ++i) {
+            r.below[i] = double(under) / total;
+            under += seen[i];
+        }
+        r.below[NumBuckets] = 1.0;
+
+        current.store(next, std::memory_order_release);
+    }
+
+    if (enabled_ && !winRatesFile.empty()
+        && now.secondsSince(lastReload) >= reloadSeconds) {
+        try {
+            loadWinRates();
+        } catch (const std::exception & exc) {
+            cerr << "couldn't reload the win rates from " << winRatesFile
+                 << ": " << exc.what() << endl;
+            lastReload = now;
+        }
+    }
+
+    return stats;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,131 @@
+/* value_shedder.h                                                 -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Picks the bid requests to drop when shedding load by their value.
+*/
+
+#pragma once
+
+#include "soa/jsoncpp/json.h"
+#include "soa/types/date.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* VALUE SHEDDER                                                             */
+/*****************************************************************************/
+
+/** Turns the fraction of the bid requests that a connector has to drop,
+    whether to keep up with the load or because the router asked for it
+    through the accept probability, into drops of the requests that are
+    worth the least instead of random ones.
+
+    A request is worth its bid floor times the rate at which we win the
+    requests of its site, as measured by the post auction stats and
+    exported to the winRates file, which is reloaded periodically.  The
+    values of the requests seen during the last update period are kept in a
+    log scale histogram, and a request is dropped when its value falls in
+    the bottom fraction of that distribution.
+
+    Configured by the "valueShedding" object of the connector
+    configuration:
+
+        {
+            "enabled": true,
+            "winRates": "site_win_rates.json",  // { "<site id>": rate }
+            "defaultWinRate": 0.1,              // for the sites not in it
+            "minFloor": 0.01,                   // for requests without one
+            "reloadSeconds": 60
+        }
+
+    value() and shed() are thread safe and lock-free, while update() must
+    be called from a single thread.
+*/
+struct ValueShedder {
+
+    ValueShedder();
+
+    void configure(const Json::Value & config);
+
+    bool enabled() const { return enabled_; }
+
+    /** Value of a request with the given bid floor on the given site. */
+    double value(double bidFloor, const std::string & site) const;
+
+    /** Returns true if a request of the given value should be dropped for
+        the given fraction of the requests to be.  A negative value means
+        that the request couldn't be scored, in which case it's dropped with
+        that probability.
+    */
+    bool shed(double value, double fraction);
+
+    /** What was offered and shed since the last update. */
+    struct Stats {
+        Stats() : requests(0), shedRequests(0), value(0.0), shedValue(0.0) {}
+
+        uint64_t requests;
+        uint64_t shedRequests;
+        double value;
+        double shedValue;
+    };
+
+    /** Ranks the values against those seen since the last update, reloads
+        the win rates when they're due and returns what was shed.
+    */
+    Stats update(Datacratic::Date now = Datacratic::Date::now());
+
+    /** Replaces the win rates, as when they're reloaded. */
+    void setWinRates(const std::unordered_map<std::string, double> & rates);
+
+    /** Buckets of a value: 4 per power of two between 2^-16 and 2^16 of
+        the currency, and the values under or over that at either end.
+    */
+    enum {
+        BucketsPerOctave = 4,
+        MinExponent = -16,
+        MaxExponent = 16,
+        NumBuckets = (MaxExponent - MinExponent) * BucketsPerOctave + 2
+    };
+
+    static int bucketOf(double value);
+
+private:
+    bool enabled_;
+    std::string winRatesFile;
+    double defaultWinRate;
+    double minFloor;
+    double reloadSeconds;
+    Datacratic::Date lastReload;
+
+    typedef std::unordered_map<std::string, double> WinRates;
+    std::shared_ptr<const WinRates> winRates;   ///< Use the atomic accessors
+
+    void loadWinRates();
+
+    /** Counts of the values seen since the last update. */
+    std::atomic<uint64_t> counts[NumBuckets];
+
+    /** Fraction of the values of the last period under each bucket and
+        under the next one; double buffered so that update() doesn't change
+        the ones being read.
+    */
+    struct Ranking {
+        float below[NumBuckets + 1];
+    };
+    Ranking rankings[2];
+    std::atomic<int> current;   ///< -1 until there was enough to rank
+
+    std::atomic<uint64_t> numRequests;
+    std::atomic<uint64_t> numShed;
+    std::atomic<uint64_t> valueMicros;
+    std::atomic<uint64_t> shedValueMicros;
+};
+
+} // namespace RTBKIT
@@ -0,0 +1,312 @@
+/** model_filter.cc                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Filter that scores the bid request with each agent's model and drops the
+    agents whose score is below their threshold.
+*/
+
+#include "model_filter.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+using namespace std;
+using namespace ML;
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* MODEL FEATURES                                                             */
+/******************************************************************************/
+
+bool
+ModelFeatures::
+parse(const string& name, Spec& spec)
+{
+    static const string segmentPrefix = "segment:";
+
+    if (name == "hourOfWeek") spec.type = HourOfWeek;
+    else if (name == "imp.count") spec.type = ImpCount;
+    else if (name == "imp.width") spec.type = ImpWidth;
+    else if (name == "imp.height") spec.type = ImpHeight;
+    else if (name.compare(0, segmentPrefix.size(), segmentPrefix) == 0) {
+        size_t pos = name.find(':', segmentPrefix.size());
+        if (pos == string::npos) return false;
+
+        spec.type = Segment;
+        spec.source = name.substr(
+                segmentPrefix.size(), pos - segmentPrefix.size());
+        spec.segment = name.substr(pos + 1);
+    }
+    else return false;
+
+    return true;
+}
+
+bool
+ModelFeatures::
+isKnown(const string& name)
+{
+    Spec spec;
+    return parse(name, spec);
+}
+
+unsigned
+ModelFeatures::
+add(const string& name)
+{
+    auto it = index.find(name);
+    if (it != index.end()) return it->second;
+
+    Spec spec;
+    if (!parse(name, spec))
+        throw Exception("unknown model feature '%s'", name.c_str());
+
+    specs.push_back(spec);
+    index[name] = specs.size() - 1;
+    return specs.size() - 1;
+}
+
+void
+ModelFeatures::
+extract(const BidRequest& request, float* output) const
+{
+    static const float NaN = numeric_limits<float>::quiet_NaN();
+
+    const Format* format = nullptr;
+    if (!request.imp.empty() && !request.imp[0].formats.empty())
+        format = &request.imp[0].formats[0];
+
+    for (size_t i = 0; i < specs.size(); ++i) {
+        const Spec& spec = specs[i];
+
+        switch (spec.type) {
+        case HourOfWeek:
+            output[i] = request.timestamp.hourOfWeek();
+            break;
+
+        case ImpCount:
+            output[i] = request.imp.size();
+            break;
+
+        case ImpWidth:
+            output[i] = format ? format->width : NaN;
+            break;
+
+        case ImpHeight:
+            output[i] = format ? format->height : NaN;
+            break;
+
+        case Segment: {
+            auto it = request.segments.find(spec.source);
+            output[i] = it != request.segments.end() && it->second
+                && it->second->contains(spec.segment);
+            break;
+        }
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* MODEL FILTER EXTENSION                                                     */
+/******************************************************************************/
+
+float
+ModelFilterExtension::Model::
+predict(int label, const float* features) const
+{
+    if (compiled) return compiled->predict(label, features);
+    return classifier->predict(label, features, info);
+}
+
+shared_ptr<const ModelFilterExtension::Model>
+ModelFilterExtension::
+load(const string& path)
+{
+    static mutex lock;
+    static unordered_map<string, weak_ptr<const Model> > loaded;
+
+    lock_guard<mutex> guard(lock);
+
+    weak_ptr<const Model>& entry = loaded[path];
+    if (auto model = entry.lock()) return model;
+
+    Classifier classifier;
+    classifier.load(path);
+
+    auto model = make_shared<Model>();
+    model->classifier = classifier.impl;
+
+    vector<Feature> features = model->classifier->all_features();
+    auto featureSpace = model->classifier->feature_space();
+
+    for (const Feature& feature : features) {
+        string name = featureSpace->print(feature);
+        if (!ModelFeatures::isKnown(name)) {
+            throw Exception("model '%s' uses feature '%s' which isn't a "
+                    "bid request feature", path.c_str(), name.c_str());
+        }
+        model->features.push_back(name);
+    }
+
+    // Decision trees and boosted stumps get flattened; everything else uses
+    // the classifier's optimized predict.
+    try {
+        model->compiled.reset(
+                new Compiled_Trees(*model->classifier, features));
+    }
+    catch (const Exception&) {
+        model->info = model->classifier->optimize(features);
+    }
+
+    entry = model;
+    return model;
+}
+
+void
+ModelFilterExtension::
+parse(const Json::Value& value)
+{
+    for (auto it = value.begin(), end = value.end(); it != end; ++it) {
+        if (it.memberName() == "model")
+            path = it->asString();
+        else if (it.memberName() == "label")
+            label = it->asInt();
+        else if (it.memberName() == "threshold")
+            threshold = it->asDouble();
+        else {
+            throw Exception("unknown modelFilter field '%s'",
+                    it.memberName().c_str());
+        }
+    }
+
+    if (path.empty())
+        throw Exception("modelFilter requires a model");
+
+    model = load(path);
+
+    if (label < 0 || label >= model->classifier->label_count()) {
+        throw Exception("modelFilter label %d is out of range for model '%s'",
+                label, path.c_str());
+    }
+}
+
+Json::Value
+ModelFilterExtension::
+toJson() const
+{
+    Json::Value result;
+    result["model"] = path;
+    result["label"] = label;
+    result["threshold"] = threshold;
+    return result;
+}
+
+
+/******************************************************************************/
+/* MODEL FILTER                                                               */
+/******************************************************************************/
+
+void
+ModelFilter::
+setConfig(unsigned configIndex, const AgentConfig& config, bool value)
+{
+    auto ext = config.extensions.tryGet<ModelFilterExtension>();
+    if (!ext) return;
+
+    auto it = find_if(groups.begin(), groups.end(), [&] (const Group& group) {
+                return group.model == ext->model && group.label == ext->label;
+            });
+
+    if (value) {
+        if (it == groups.end()) {
+            Group group;
+            group.model = ext->model;
+            group.label = ext->label;
+
+            // Features are never removed from the extracted vector; there are
+            // only ever a handful.
+            for (const string& name : ext->model->features)
+                group.inputs.push_back(features.add(name));
+
+            groups.push_back(std::move(group));
+            it = groups.end() - 1;
+        }
+
+        it->configs.set(configIndex);
+        it->thresholds.push_back({ configIndex, ext->threshold });
+        scored.set(configIndex);
+    }
+
+    else {
+        if (it == groups.end()) return;
+
+        it->configs.reset(configIndex);
+        scored.reset(configIndex);
+
+        auto& thresholds = it->thresholds;
+        thresholds.erase(
+                remove_if(thresholds.begin(), thresholds.end(),
+                        [&] (const Threshold& threshold) {
+                            return threshold.configIndex == configIndex;
+                        }),
+                thresholds.end());
+
+        if (it->configs.empty()) groups.erase(it);
+    }
+}
+
+void
+ModelFilter::
+filter(FilterState& state) const
+{
+    ConfigSet active = state.configs() & scored;
+    if (active.empty()) return;
+
+    float values[features.size()];
+    features.extract(state.request, values);
+
+    ConfigSet result = scored.negate();
+
+    for (const Group& group : groups) {
+        if ((group.configs & active).empty()) continue;
+
+        float inputs[group.inputs.size()];
+        for (size_t i = 0; i < group.inputs.size(); ++i)
+            inputs[i] = values[group.inputs[i]];
+
+        float score = group.model->predict(group.label, inputs);
+
+        for (const Threshold& threshold : group.thresholds) {
+            if (score >= threshold.threshold)
+                result.set(threshold.configIndex);
+        }
+    }
+
+    state.narrowConfigs(result);
+}
+
+} // namespace RTBKIT
+
+
+/******************************************************************************/
+/* INIT FILTERS                                                               */
+/******************************************************************************/
+
+namespace {
+
+struct AtInit {
+    AtInit()
+    {
+        RTBKIT::FilterBase::registerFactory<RTBKIT::ModelFilter>();
+        RTBKIT::ExtensionRegistry::registerFactory<
+            RTBKIT::ModelFilterExtension>();
+    }
+
+} AtInit;
+
+} // namespace anonymous
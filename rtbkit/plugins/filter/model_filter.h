@@ -0,0 +1,172 @@
+/** model_filter.h                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Filter that scores the bid request with each agent's model and drops the
+    agents whose score is below their threshold.
+*/
+
+#pragma once
+
+#include "rtbkit/core/router/filters/generic_filters.h"
+#include "rtbkit/core/router/filters/priority.h"
+#include "rtbkit/common/extension.h"
+#include "jml/boosting/classifier.h"
+#include "jml/boosting/compiled_trees.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* MODEL FEATURES                                                             */
+/******************************************************************************/
+
+/** Features of a bid request that a model can be trained on, named after the
+    features of the model's feature space:
+
+    - "hourOfWeek": hour of the week of the request (0 to 167);
+    - "imp.count": number of impressions;
+    - "imp.width", "imp.height": size of the first format of the first
+      impression;
+    - "segment:<source>:<segment>": 1 if the request has the segment in the
+      given source, 0 otherwise.
+
+    The features used by all of the models are extracted once per request
+    into a single vector.
+ */
+struct ModelFeatures
+{
+    /** Returns true if the feature with the given name can be extracted. */
+    static bool isKnown(const std::string& name);
+
+    /** Returns the index of the feature in the extracted vector, adding it if
+        it's not already there. Throws if the feature isn't known. */
+    unsigned add(const std::string& name);
+
+    size_t size() const { return specs.size(); }
+
+    /** Fill in size() values for the request. */
+    void extract(const BidRequest& request, float* output) const;
+
+private:
+    enum Type { HourOfWeek, ImpCount, ImpWidth, ImpHeight, Segment };
+
+    struct Spec
+    {
+        Type type;
+        std::string source;
+        std::string segment;
+    };
+
+    static bool parse(const std::string& name, Spec& spec);
+
+    std::vector<Spec> specs;
+    std::unordered_map<std::string, unsigned> index;
+};
+
+
+/******************************************************************************/
+/* MODEL FILTER EXTENSION                                                     */
+/******************************************************************************/
+
+/** Agent configuration of the model filter:
+
+        "modelFilter": {
+            "model": "path/to/model.cls",
+            "label": 1,
+            "threshold": 0.05
+        }
+
+    The model is any classifier that can be loaded with ML::Classifier. The
+    agent is only sent requests for which the model's output for the label is
+    at least the threshold. Agents that load the same model file share it.
+ */
+struct ModelFilterExtension : public Extension
+{
+    NAME("modelFilter")
+
+    ModelFilterExtension() : label(0), threshold(0.0) {}
+
+    /** A model loaded and ready to score dense vectors of its features. */
+    struct Model
+    {
+        std::shared_ptr<ML::Classifier_Impl> classifier;
+
+        /** Names of the features of the vectors scored by the model. */
+        std::vector<std::string> features;
+
+        ML::Optimization_Info info;
+
+        /** Set if the model could be compiled; used instead of the optimized
+            predict. */
+        std::unique_ptr<ML::Compiled_Trees> compiled;
+
+        float predict(int label, const float* features) const;
+    };
+
+    std::string path;
+    int label;
+    float threshold;
+    std::shared_ptr<const Model> model;
+
+    void parse(const Json::Value& value);
+    Json::Value toJson() const;
+
+    /** Loads the model, or returns the already loaded one if the file's been
+        loaded before. */
+    static std::shared_ptr<const Model> load(const std::string& path);
+};
+
+
+/******************************************************************************/
+/* MODEL FILTER                                                               */
+/******************************************************************************/
+
+/** Drops the configs whose model scores the request below their threshold.
+    Configs without a modelFilter extension are left alone.
+
+    The request's features are extracted once and each model is scored once
+    per label for all the configs that use it, so many agents sharing a model
+    cost a single prediction.
+ */
+struct ModelFilter : public FilterBaseT<ModelFilter>
+{
+    static constexpr const char* name = "Model";
+    unsigned priority() const { return Priority::Model; }
+
+    void setConfig(unsigned configIndex, const AgentConfig& config, bool value);
+    void filter(FilterState& state) const;
+
+private:
+
+    struct Threshold
+    {
+        unsigned configIndex;
+        float threshold;
+    };
+
+    /** Configs that share a model and a label. */
+    struct Group
+    {
+        std::shared_ptr<const ModelFilterExtension::Model> model;
+        int label;
+
+        /** Index in the extracted vector of each of the model's features. */
+        std::vector<unsigned> inputs;
+
+        ConfigSet configs;
+        std::vector<Threshold> thresholds;
+    };
+
+    ModelFeatures features;
+    std::vector<Group> groups;
+    ConfigSet scored;
+};
+
+
+} // namespace RTBKIT
@@ -0,0 +1,171 @@
+/** model_filter_test.cc                                 -*- C++ -*-
+    15 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the model filter.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/core/router/filters/testing/utils.h"
+#include "rtbkit/plugins/filter/model_filter.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/boosting/decision_tree.h"
+#include "jml/boosting/dense_features.h"
+#include "jml/boosting/feature_info.h"
+
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+using namespace RTBKIT::Test;
+
+namespace {
+
+/** Saves a tree scoring label 1 with 0.1 if the user isn't young, 0.8 if they
+    are and it's Sunday, and 0.4 otherwise.
+ */
+string saveModel()
+{
+    auto fs = make_shared<Dense_Feature_Space>();
+    Feature label(fs->add_feature("LABEL", Feature_Info(BOOLEAN, false, true)));
+    Feature young(fs->add_feature("segment:age:young", BOOLEAN));
+    Feature hour(fs->add_feature("hourOfWeek", REAL));
+
+    auto dist = [] (float p) {
+        distribution<float> result(2);
+        result[0] = 1.0 - p;
+        result[1] = p;
+        return result;
+    };
+
+    auto tree = make_shared<Decision_Tree>(fs, label);
+
+    Tree::Node* sunday = tree->tree.new_node();
+    sunday->split = Split(hour, 24, Split::LESS);
+    sunday->child_true = tree->tree.new_leaf(dist(0.8), 1.0);
+    sunday->child_false = tree->tree.new_leaf(dist(0.4), 1.0);
+    sunday->child_missing = tree->tree.new_leaf(dist(0.0), 1.0);
+
+    Tree::Node* root = tree->tree.new_node();
+    root->split = Split(young, 0.5, Split::LESS);
+    root->child_true = tree->tree.new_leaf(dist(0.1), 1.0);
+    root->child_false = sunday;
+    root->child_missing = tree->tree.new_leaf(dist(0.0), 1.0);
+    tree->tree.root = root;
+
+    string path = ML::format("/tmp/model_filter_test_%d.cls", getpid());
+    Classifier(tree).save(path);
+    return path;
+}
+
+void addModel(AgentConfig& config, const string& path, int label, float threshold)
+{
+    Json::Value json;
+    json["model"] = path;
+    json["label"] = label;
+    json["threshold"] = threshold;
+    config.extensions.add(ExtensionRegistry::create("modelFilter", json));
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( modelFilter_simple )
+{
+    string path = saveModel();
+
+    ModelFilter filter;
+    ConfigSet mask;
+
+    auto doCheck = [&] (
+            BidRequest& request,
+            const initializer_list<size_t>& expected)
+    {
+        check(filter, request, "ex0", mask, expected);
+    };
+
+    AgentConfig c0;
+    addModel(c0, path, 1, 0.5);
+
+    AgentConfig c1;
+    addModel(c1, path, 1, 0.3);
+
+    AgentConfig c2;
+
+    AgentConfig c3;
+    addModel(c3, path, 0, 0.5);
+
+    // Same model file so it's loaded once.
+    BOOST_CHECK_EQUAL(
+            c0.extensions.get<ModelFilterExtension>()->model,
+            c3.extensions.get<ModelFilterExtension>()->model);
+
+    BidRequest r0;
+    r0.timestamp = Date(2013, 8, 11, 10, 0, 0);
+    addSegment(r0, "age", segment("young"));
+
+    BidRequest r1;
+    r1.timestamp = Date(2013, 8, 12, 10, 0, 0);
+    addSegment(r1, "age", segment("young"));
+
+    BidRequest r2;
+    r2.timestamp = Date(2013, 8, 11, 10, 0, 0);
+    addSegment(r2, "age", segment("old"));
+
+    BidRequest r3;
+    r3.timestamp = Date(2013, 8, 11, 10, 0, 0);
+
+    title("model-simple-1");
+    addConfig(filter, 0, c0); mask.set(0);
+    addConfig(filter, 1, c1); mask.set(1);
+    addConfig(filter, 2, c2); mask.set(2);
+    addConfig(filter, 3, c3); mask.set(3);
+
+    doCheck(r0, { 0, 1, 2 });
+    doCheck(r1, { 1, 2, 3 });
+    doCheck(r2, { 2, 3 });
+    doCheck(r3, { 2, 3 });
+
+    title("model-simple-2");
+    removeConfig(filter, 1, c1); mask.reset(1);
+
+    doCheck(r0, { 0, 2 });
+    doCheck(r1, { 2, 3 });
+
+    title("model-simple-3");
+    removeConfig(filter, 0, c0); mask.reset(0);
+    removeConfig(filter, 3, c3); mask.reset(3);
+
+    doCheck(r0, { 2 });
+    doCheck(r2, { 2 });
+
+    unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( modelFilter_unknownFeature )
+{
+    auto fs = make_shared<Dense_Feature_Space>();
+    Feature label(fs->add_feature("LABEL", Feature_Info(BOOLEAN, false, true)));
+    Feature age(fs->add_feature("user.age", REAL));
+
+    auto tree = make_shared<Decision_Tree>(fs, label);
+    Tree::Node* root = tree->tree.new_node();
+    root->split = Split(age, 30, Split::LESS);
+    root->child_true = tree->tree.new_leaf(distribution<float>(2, 0.5), 1.0);
+    root->child_false = tree->tree.new_leaf(distribution<float>(2, 0.5), 1.0);
+    root->child_missing = tree->tree.new_leaf(distribution<float>(2, 0.5), 1.0);
+    tree->tree.root = root;
+
+    string path = ML::format("/tmp/model_filter_test_unknown_%d.cls", getpid());
+    Classifier(tree).save(path);
+
+    AgentConfig config;
+    BOOST_CHECK_THROW(addModel(config, path, 1, 0.5), ML::Exception);
+
+    unlink(path.c_str());
+}
@@ -0,0 +1,122 @@
+/* parallel_pipeline.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Implementation of the Parallel Pipeline
+*/
+
+#include "parallel_pipeline.h"
+#include "jml/arch/exception.h"
+#include "jml/arch/format.h"
+#include <atomic>
+
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+ParallelBidRequestPipeline::ParallelBidRequestPipeline(
+        std::shared_ptr<ServiceProxies> proxies, std::string serviceName,
+        const Json::Value& json)
+    : BidRequestPipeline(proxies, serviceName)
+{
+    const Json::Value& stages = json["stages"];
+    if (!stages.isArray() || stages.empty())
+        throw ML::Exception("parallel pipeline requires a list of stages");
+
+    for (size_t i = 0; i < stages.size(); ++i) {
+        std::string name = ML::format("%s.%zd", serviceName.c_str(), i);
+        stages_.push_back(BidRequestPipeline::create(name, proxies, stages[i]));
+    }
+}
+
+PipelineStatus
+ParallelBidRequestPipeline::preBidRequest(
+        const ExchangeConnector* exchange,
+        const HttpHeader& header,
+        const std::string& payload) {
+    for (const auto& stage : stages_) {
+        if (stage->preBidRequest(exchange, header, payload) == PipelineStatus::Stop)
+            return PipelineStatus::Stop;
+    }
+    return PipelineStatus::Continue;
+}
+
+PipelineStatus
+ParallelBidRequestPipeline::postBidRequest(
+        const ExchangeConnector* exchange,
+        const std::shared_ptr<Auction>& auction) {
+    for (const auto& stage : stages_) {
+        if (stage->postBidRequest(exchange, auction) == PipelineStatus::Stop)
+            return PipelineStatus::Stop;
+    }
+    return PipelineStatus::Continue;
+}
+
+void
+ParallelBidRequestPipeline::preBidRequestAsync(
+        const ExchangeConnector* exchange,
+        const HttpHeader& header,
+        const std::string& payload,
+        Date deadline,
+        const OnPipelineDone& onDone) {
+    auto onStageDone = join(onDone);
+    for (const auto& stage : stages_)
+        stage->preBidRequestAsync(exchange, header, payload, deadline, onStageDone);
+}
+
+void
+ParallelBidRequestPipeline::postBidRequestAsync(
+        const ExchangeConnector* exchange,
+        const std::shared_ptr<Auction>& auction,
+        Date deadline,
+        const OnPipelineDone& onDone) {
+    auto onStageDone = join(onDone);
+    for (const auto& stage : stages_)
+        stage->postBidRequestAsync(exchange, auction, deadline, onStageDone);
+}
+
+OnPipelineDone
+ParallelBidRequestPipeline::join(const OnPipelineDone& onDone) const {
+    struct Join {
+        Join(size_t pending, OnPipelineDone onDone)
+            : pending(pending), stop(false), onDone(std::move(onDone))
+        { }
+
+        std::atomic<size_t> pending;
+        std::atomic<bool> stop;
+        OnPipelineDone onDone;
+    };
+
+    auto state = std::make_shared<Join>(stages_.size(), onDone);
+
+    return [=] (PipelineStatus status) {
+        if (status == PipelineStatus::Stop)
+            state->stop = true;
+
+        // The stages can finish on different threads; the last one to do so
+        // is the one that carries on with the request.
+        if (--state->pending == 0) {
+            state->onDone(state->stop ? PipelineStatus::Stop
+                                      : PipelineStatus::Continue);
+        }
+    };
+}
+
+namespace {
+
+struct AtInit {
+    AtInit()
+    {
+      PluginInterface<BidRequestPipeline>::registerPlugin("parallel",
+          [](std::string serviceName,
+             std::shared_ptr<ServiceProxies> proxies,
+             Json::Value const &json)
+          {
+              return new ParallelBidRequestPipeline(std::move(proxies), std::move(serviceName), json);
+          });
+    }
+} atInit;
+
+}
+
+} // namespace RTBKIT
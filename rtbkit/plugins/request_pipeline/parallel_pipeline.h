@@ -0,0 +1,72 @@
+/* parallel_pipeline.h
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   A Bid Request Pipeline that runs several stages at the same time
+*/
+
+#pragma once
+
+#include "rtbkit/common/bid_request_pipeline.h"
+#include <vector>
+
+namespace RTBKIT {
+
+/** Runs a list of independent pipelines, configured as
+
+        { "type": "parallel", "stages": [ { "type": ... }, ... ] }
+
+    The asynchronous calls start all the stages at once and are done when the
+    last of them is, so the request waits for the slowest stage rather than
+    for the sum of them.  The request is stopped if any of the stages stops it.
+
+    The synchronous calls run the stages one after the other and stop at the
+    first one that stops the request.
+*/
+class ParallelBidRequestPipeline : public BidRequestPipeline {
+public:
+
+    ParallelBidRequestPipeline(
+            std::shared_ptr<Datacratic::ServiceProxies> proxies, std::string serviceName,
+            const Json::Value& json);
+
+    PipelineStatus
+    preBidRequest(
+            const ExchangeConnector* exchange,
+            const HttpHeader& header,
+            const std::string& payload);
+
+    PipelineStatus
+    postBidRequest(
+            const ExchangeConnector* exchange,
+            const std::shared_ptr<Auction>& auction);
+
+    void
+    preBidRequestAsync(
+            const ExchangeConnector* exchange,
+            const HttpHeader& header,
+            const std::string& payload,
+            Datacratic::Date deadline,
+            const OnPipelineDone& onDone);
+
+    void
+    postBidRequestAsync(
+            const ExchangeConnector* exchange,
+            const std::shared_ptr<Auction>& auction,
+            Datacratic::Date deadline,
+            const OnPipelineDone& onDone);
+
+    const std::vector<std::shared_ptr<BidRequestPipeline>>& stages() const
+    {
+        return stages_;
+    }
+
+private:
+    std::vector<std::shared_ptr<BidRequestPipeline>> stages_;
+
+    /** Returns the callback to give to each stage, which calls onDone once
+        all of them have called it. */
+    OnPipelineDone join(const OnPipelineDone& onDone) const;
+};
+
+} // namespace RTBKIT
@@ -0,0 +1,83 @@
+/* pre_parse_pipeline.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Implementation of the Pre Parse Pipeline
+*/
+
+#include "pre_parse_pipeline.h"
+#include "rtbkit/common/exchange_connector.h"
+
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+/*****************************************************************************/
+/* PRE PARSE BID REQUEST PIPELINE                                            */
+/*****************************************************************************/
+
+PreParseBidRequestPipeline::PreParseBidRequestPipeline(
+        std::shared_ptr<ServiceProxies> proxies, std::string serviceName,
+        const Json::Value& json)
+    : BidRequestPipeline(std::move(proxies), std::move(serviceName))
+{ }
+
+PipelineStatus
+PreParseBidRequestPipeline::preBidRequest(
+        const ExchangeConnector* exchange,
+        const HttpHeader& header,
+        const std::string& payload) {
+
+    if (!exchange || !exchange->preParseMatches)
+        return PipelineStatus::Continue;
+
+    PreParseKeys keys;
+    if (!keys.scan(payload)) {
+        recordHit("preParse.unscanned");
+        return PipelineStatus::Continue;
+    }
+
+    BidRequest br;
+    br.exchange = exchange->exchangeName();
+
+    try {
+        br.url = keys.url();
+    } catch (const std::exception& exc) {
+        recordHit("preParse.badUrl");
+        return PipelineStatus::Continue;
+    }
+
+    if (exchange->preParseMatches(br)) {
+        recordHit("preParse.passed");
+        return PipelineStatus::Continue;
+    }
+
+    recordHit("preParse.dropped");
+    return PipelineStatus::Stop;
+}
+
+PipelineStatus
+PreParseBidRequestPipeline::postBidRequest(
+        const ExchangeConnector* exchange,
+        const std::shared_ptr<Auction>& auction) {
+    return PipelineStatus::Continue;
+}
+
+namespace {
+
+struct AtInit {
+    AtInit()
+    {
+      PluginInterface<BidRequestPipeline>::registerPlugin("preParse",
+          [](std::string serviceName,
+             std::shared_ptr<ServiceProxies> proxies,
+             Json::Value const &json)
+          {
+              return new PreParseBidRequestPipeline(std::move(proxies), std::move(serviceName), json);
+          });
+    }
+} atInit;
+
+}
+
+} // namespace RTBKIT
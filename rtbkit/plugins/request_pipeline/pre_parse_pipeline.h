@@ -0,0 +1,48 @@
+/* pre_parse_pipeline.h
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   A Bid Request Pipeline that drops the requests that no agent targets
+   before they're parsed
+*/
+
+#pragma once
+
+#include "rtbkit/common/bid_request_pipeline.h"
+#include "rtbkit/plugins/bid_request/openrtb_pre_parse.h"
+#include <string>
+
+namespace RTBKIT {
+
+/** Drops the bid requests that no agent can bid on because of their exchange
+    or of their url, before the connector parses them and creates their
+    auction.  Configured as
+
+        { "type": "preParse" }
+
+    The site or app that the url of the request is made from is scanned out
+    of the raw OpenRTB payload and checked against the filters of the router
+    that only depend on the exchange and the url (see
+    FilterPool::preParseMatches).  Requests that can't be scanned, or whose
+    connector isn't connected to a router, are let through.
+*/
+class PreParseBidRequestPipeline : public BidRequestPipeline {
+public:
+
+    PreParseBidRequestPipeline(
+            std::shared_ptr<Datacratic::ServiceProxies> proxies, std::string serviceName,
+            const Json::Value& json);
+
+    PipelineStatus
+    preBidRequest(
+            const ExchangeConnector* exchange,
+            const HttpHeader& header,
+            const std::string& payload);
+
+    PipelineStatus
+    postBidRequest(
+            const ExchangeConnector* exchange,
+            const std::shared_ptr<Auction>& auction);
+};
+
+} // namespace RTBKIT
@@ -1 +1,5 @@
 $(eval $(call library,null_pipeline,null_pipeline.cc,rtb))
+$(eval $(call library,parallel_pipeline,parallel_pipeline.cc,rtb))
+$(eval $(call library,pre_parse_pipeline,pre_parse_pipeline.cc,rtb openrtb_bid_request))
+
+$(eval $(call include_sub_make,request_pipeline_testing,testing,request_pipeline_testing.mk))
@@ -0,0 +1,191 @@
+/* parallel_pipeline_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the parallel bid request pipeline.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/plugins/request_pipeline/parallel_pipeline.h"
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+/** Stage that answers with the configured status, either straight away or
+    from another thread after the configured delay. */
+struct TestPipeline : public BidRequestPipeline {
+
+    TestPipeline(std::shared_ptr<ServiceProxies> proxies, std::string serviceName,
+                 const Json::Value& json)
+        : BidRequestPipeline(std::move(proxies), std::move(serviceName)),
+          status(json.get("stop", false).asBool()
+                 ? PipelineStatus::Stop : PipelineStatus::Continue),
+          delayMs(json.get("delayMs", 0).asInt()),
+          calls(0)
+    { }
+
+    PipelineStatus
+    preBidRequest(const ExchangeConnector*, const HttpHeader&, const std::string&)
+    {
+        ++calls;
+        return status;
+    }
+
+    PipelineStatus
+    postBidRequest(const ExchangeConnector*, const std::shared_ptr<Auction>&)
+    {
+        ++calls;
+        return status;
+    }
+
+    void
+    postBidRequestAsync(const ExchangeConnector*, const std::shared_ptr<Auction>&,
+                        Date, const OnPipelineDone& onDone)
+    {
+        ++calls;
+        if (!delayMs) {
+            onDone(status);
+            return;
+        }
+
+        auto status = this->status;
+        auto delayMs = this->delayMs;
+        std::thread([=] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+            onDone(status);
+        }).detach();
+    }
+
+    PipelineStatus status;
+    int delayMs;
+    std::atomic<int> calls;
+};
+
+struct AtInit {
+    AtInit()
+    {
+        PluginInterface<BidRequestPipeline>::registerPlugin("test",
+            [](std::string serviceName,
+               std::shared_ptr<ServiceProxies> proxies,
+               Json::Value const &json)
+            {
+                return new TestPipeline(std::move(proxies), std::move(serviceName), json);
+            });
+    }
+} atInit;
+
+std::shared_ptr<ParallelBidRequestPipeline>
+makePipeline(const std::string& stages)
+{
+    Json::Value config;
+    config["type"] = "parallel";
+    config["stages"] = Json::parse(stages);
+
+    auto pipeline = BidRequestPipeline::create("test", std::make_shared<ServiceProxies>(), config);
+    return std::dynamic_pointer_cast<ParallelBidRequestPipeline>(pipeline);
+}
+
+int calls(const std::shared_ptr<ParallelBidRequestPipeline>& pipeline, size_t stage)
+{
+    return static_cast<TestPipeline&>(*pipeline->stages()[stage]).calls;
+}
+
+/** Runs the asynchronous post step and waits for it to finish. */
+PipelineStatus
+runAsync(const std::shared_ptr<ParallelBidRequestPipeline>& pipeline, int& doneCalls)
+{
+    std::atomic<int> done(0);
+    std::atomic<int> result(-1);
+
+    pipeline->postBidRequestAsync(nullptr, nullptr, Date::now().plusSeconds(1),
+            [&] (PipelineStatus status) {
+                result = static_cast<int>(status);
+                ++done;
+            });
+
+    while (!done)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // Give any extra calls the chance to show up
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    doneCalls = done;
+
+    return static_cast<PipelineStatus>(result.load());
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_parallel_pipeline_sync )
+{
+    auto pipeline = makePipeline(R"([ {"type":"test"}, {"type":"test","stop":true}, {"type":"test"} ])");
+    BOOST_REQUIRE(pipeline);
+    BOOST_CHECK_EQUAL(pipeline->stages().size(), 3);
+
+    HttpHeader header;
+    auto status = pipeline->preBidRequest(nullptr, header, "");
+    BOOST_CHECK(status == PipelineStatus::Stop);
+
+    // Stops at the first stage that stops the request
+    BOOST_CHECK_EQUAL(calls(pipeline, 0), 1);
+    BOOST_CHECK_EQUAL(calls(pipeline, 1), 1);
+    BOOST_CHECK_EQUAL(calls(pipeline, 2), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_pipeline_async )
+{
+    int doneCalls;
+
+    {
+        auto pipeline = makePipeline(R"([ {"type":"test","delayMs":100}, {"type":"test","delayMs":100}, {"type":"test"} ])");
+
+        // The stages run at the same time, so this takes as long as the
+        // slowest of them rather than the sum.
+        Date start = Date::now();
+        auto status = runAsync(pipeline, doneCalls);
+        double elapsedMs = Date::now().secondsSince(start) * 1000.0 - 50.0;
+
+        BOOST_CHECK(status == PipelineStatus::Continue);
+        BOOST_CHECK_EQUAL(doneCalls, 1);
+        BOOST_CHECK_GE(elapsedMs, 100.0);
+        BOOST_CHECK_LT(elapsedMs, 190.0);
+
+        for (size_t i = 0; i < 3; ++i)
+            BOOST_CHECK_EQUAL(calls(pipeline, i), 1);
+    }
+
+    {
+        auto pipeline = makePipeline(R"([ {"type":"test","delayMs":20}, {"type":"test","delayMs":10,"stop":true}, {"type":"test"} ])");
+
+        auto status = runAsync(pipeline, doneCalls);
+        BOOST_CHECK(status == PipelineStatus::Stop);
+        BOOST_CHECK_EQUAL(doneCalls, 1);
+
+        // All stages run even if one stops the request
+        for (size_t i = 0; i < 3; ++i)
+            BOOST_CHECK_EQUAL(calls(pipeline, i), 1);
+    }
+
+    {
+        // Stages that finish straight away finish the pipeline straight away
+        auto pipeline = makePipeline(R"([ {"type":"test"}, {"type":"test"} ])");
+
+        int done = 0;
+        pipeline->postBidRequestAsync(nullptr, nullptr, Date::now(),
+                [&] (PipelineStatus) { ++done; });
+        BOOST_CHECK_EQUAL(done, 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_pipeline_no_stages )
+{
+    BOOST_CHECK_THROW(makePipeline("[]"), ML::Exception);
+}
@@ -0,0 +1,104 @@
+/** pre_parse_pipeline_test.cc                                 -*- C++ -*-
+    15 Oct 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Tests for the scanning of the raw bid requests by the pre parse pipeline.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/plugins/request_pipeline/pre_parse_pipeline.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+const string Imps =
+    "\"imp\":[{\"id\":\"1\",\"banner\":{\"w\":300,\"h\":250,"
+    "\"battr\":[1,2]},\"ext\":{\"site\":{\"page\":\"http://nope.com/\"}}}]";
+
+PreParseKeys scan(const string & payload)
+{
+    PreParseKeys keys;
+    BOOST_REQUIRE(keys.scan(payload));
+    return keys;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( site )
+{
+    auto keys = scan("{\"id\":\"abc\"," + Imps + ",\"site\":{\"id\":\"1234\","
+                     "\"publisher\":{\"id\":\"p\",\"name\":\"}\"},"
+                     "\"page\":\"http:\\/\\/example.com\\/a?b=\\\"c\\\"\"},"
+                     "\"tmax\":100}");
+    BOOST_CHECK(keys.hasSite);
+    BOOST_CHECK(!keys.hasApp);
+    BOOST_CHECK_EQUAL(keys.siteId, "1234");
+    BOOST_CHECK_EQUAL(keys.sitePage, "http://example.com/a?b=\"c\"");
+    BOOST_CHECK_EQUAL(keys.url().host(), "example.com");
+
+    // Without a page the url is made from the id, as the parser does.
+    keys = scan("{ \"site\" : { \"id\" : \"1234\" } , " + Imps + " }");
+    BOOST_CHECK_EQUAL(keys.url().toString(), "http://1234.siteid/");
+
+    // Neither of them
+    keys = scan("{\"site\":{\"page\":null,\"cat\":[\"IAB1\"]}}");
+    BOOST_CHECK(keys.hasSite);
+    BOOST_CHECK(keys.url().empty());
+}
+
+BOOST_AUTO_TEST_CASE( app )
+{
+    auto keys = scan("{" + Imps + ",\"app\":{\"id\":\"42\","
+                     "\"bundle\":\"http://com.example.game/\"}}");
+    BOOST_CHECK(keys.hasApp);
+    BOOST_CHECK(!keys.hasSite);
+    BOOST_CHECK_EQUAL(keys.url().host(), "com.example.game");
+
+    keys = scan("{\"app\":{\"id\":\"42\"}}");
+    BOOST_CHECK_EQUAL(keys.url().toString(), "http://42.appid/");
+
+    // Numeric ids are read as they are written.
+    keys = scan("{\"app\":{\"id\":42}}");
+    BOOST_CHECK_EQUAL(keys.appId, "42");
+}
+
+BOOST_AUTO_TEST_CASE( bid_floor )
+{
+    BOOST_CHECK_EQUAL(scan("{" + Imps + "}").bidFloor, 0.0);
+
+    auto keys = scan("{\"imp\":[{\"id\":\"1\",\"bidfloor\":0.5},"
+                     "{\"bidfloor\":1.25,\"banner\":{\"w\":1}},"
+                     "{\"bidfloor\":null}]}");
+    BOOST_CHECK_EQUAL(keys.bidFloor, 1.25);
+
+    BOOST_CHECK(!PreParseKeys().scan("{\"imp\":[{\"bidfloor\":\"x\"}]}"));
+}
+
+BOOST_AUTO_TEST_CASE( unscannable )
+{
+    PreParseKeys keys;
+    BOOST_CHECK(!keys.scan(""));
+    BOOST_CHECK(!PreParseKeys().scan("[]"));
+    BOOST_CHECK(!PreParseKeys().scan("{\"site\":{\"page\":\"http://a.com/"));
+    BOOST_CHECK(!PreParseKeys().scan("{\"imp\":[{\"id\":\"1\"}}"));
+
+    // Unicode escapes are only handled where they're skipped.
+    BOOST_CHECK(!PreParseKeys().scan(
+                        "{\"site\":{\"page\":\"http://\\u00e9.com/\"}}"));
+    BOOST_CHECK(PreParseKeys().scan(
+                        "{\"site\":{\"name\":\"\\u00e9\"," +
+                        string("\"page\":\"http://a.com/\"}}")));
+
+    // The parser would keep whichever of the two comes last.
+    BOOST_CHECK(!PreParseKeys().scan(
+                        "{\"site\":{\"id\":\"1\"},\"app\":{\"id\":\"2\"}}"));
+}
@@ -0,0 +1,4 @@
+# request_pipeline_testing.mk
+
+$(eval $(call test,parallel_pipeline_test,parallel_pipeline,boost))
+$(eval $(call test,pre_parse_pipeline_test,pre_parse_pipeline,boost))
@@ -186,3 +186,24 @@ BOOST_FIXTURE_TEST_CASE( test_merge, AugmentationFixture )
 
 }
 
+
+BOOST_FIXTURE_TEST_CASE( test_binary_encoding, AugmentationFixture )
+{
+    AugmentationList list;
+    list[AccountKey()] = Augmentation(set<string>{ tag0 });
+    list[accA] = { { tag1, tag2 }, data0 };
+    list[accBBA] = Augmentation(data2);
+
+    AugmentationList copy =
+        AugmentationList::createFromString(list.serializeToString());
+
+    BOOST_CHECK_EQUAL(copy.size(), list.size());
+    BOOST_CHECK(copy.toJson() == list.toJson());
+    BOOST_CHECK(copy[AccountKey()].data.isNull());
+    checkTags(copy[accA].tags, { tag1, tag2 });
+    checkData(copy[accBBA].data, { data2 });
+
+    AugmentationList empty =
+        AugmentationList::createFromString(AugmentationList().serializeToString());
+    BOOST_CHECK(empty.empty());
+}
@@ -0,0 +1,365 @@
+/* exchange_parsing_bench.cc                                       -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Benchmark of the bid request parsing and response rendering of the
+   exchange connectors over captured traffic.
+
+   The configuration has the same layout as the one of
+   exchange_parsing_from_file, one entry per exchange:
+
+   {
+       "exchangeType" : "openrtb",
+       "headers" : { "x-openrtb-version" : "2.1" },
+       "config" : { ... },
+       "samples" : [ "requests.json.xz" ]
+   }
+
+   Each sample file holds one request per line and may be compressed. The
+   requests are handed straight to the parseBidRequest() and getResponse()
+   of the connector, without going through the network. An entry can give
+   a bid request "format" instead of an "exchangeType", in which case the
+   requests are parsed with BidRequest::parse(); that is how the
+   20000-datacratic-auctions corpus is replayed.
+
+   An entry can also have "synthetic" requests generated from its samples
+   with a BidRequestTraffic, to bench more or more complex requests than
+   were captured:
+
+   "synthetic" : {
+       "samples" : [ "requests.json.xz" ],
+       "count" : 100000,
+       "config" : { "numUsers" : 1000000, "arrayScales" : { "imp" : 4 } }
+   }
+*/
+
+#include "rtbkit/plugins/exchange/http_exchange_connector.h"
+#include "rtbkit/plugins/exchange/http_auction_handler.h"
+#include "rtbkit/common/auction.h"
+#include "rtbkit/common/testing/bid_request_traffic.h"
+#include "soa/service/service_base.h"
+#include "jml/utils/filter_streams.h"
+#include "jml/utils/file_functions.h"
+#include "jml/arch/format.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+/******************************************************************************/
+/* ALLOCATION COUNTERS                                                        */
+/******************************************************************************/
+
+namespace {
+
+std::atomic<uint64_t> numAllocs(0);
+std::atomic<uint64_t> bytesAllocated(0);
+
+} // file scope
+
+void * operator new(size_t size)
+{
+    numAllocs.fetch_add(1, std::memory_order_relaxed);
+    bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+
+    void * result = malloc(size ? size : 1);
+    if (!result) throw std::bad_alloc();
+    return result;
+}
+
+void operator delete(void * ptr) noexcept
+{
+    free(ptr);
+}
+
+
+namespace {
+
+/******************************************************************************/
+/* MEASUREMENT                                                                */
+/******************************************************************************/
+
+/** Time and allocations spent in one step over all the requests. */
+struct Measurement {
+    Measurement() : ns(0), allocs(0), bytes(0) {}
+
+    struct Scope {
+        Scope(Measurement & m)
+            : m(m),
+              start(std::chrono::steady_clock::now()),
+              allocs(numAllocs.load()),
+              bytes(bytesAllocated.load())
+        {
+        }
+
+        ~Scope()
+        {
+            auto end = std::chrono::steady_clock::now();
+            m.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    end - start).count();
+            m.allocs += numAllocs.load() - allocs;
+            m.bytes += bytesAllocated.load() - bytes;
+        }
+
+        Measurement & m;
+        std::chrono::steady_clock::time_point start;
+        uint64_t allocs;
+        uint64_t bytes;
+    };
+
+    std::string print(const std::string & step, uint64_t count) const
+    {
+        if (!count) count = 1;
+        return ML::format("%-14s %10.0f ns/req %8.1f allocs/req %10.0f bytes/req",
+                          step.c_str(),
+                          double(ns) / count,
+                          double(allocs) / count,
+                          double(bytes) / count);
+    }
+
+    uint64_t ns;
+    uint64_t allocs;
+    uint64_t bytes;
+};
+
+
+/******************************************************************************/
+/* BENCH HANDLER                                                              */
+/******************************************************************************/
+
+/** Connection that keeps the errors and dropped auctions to itself instead
+    of writing them out to a transport.
+*/
+struct BenchHandler : public HttpAuctionHandler {
+
+    virtual void sendErrorResponse(const std::string & error,
+                                   const std::string & details = "")
+    {
+        this->error = error;
+    }
+
+    virtual void dropAuction(const std::string & reason = "")
+    {
+        this->error = reason;
+    }
+
+    std::string error;
+};
+
+
+/******************************************************************************/
+/* BENCH                                                                      */
+/******************************************************************************/
+
+vector<string> loadRequests(const Json::Value & samples)
+{
+    vector<string> requests;
+
+    for (const auto & sample: samples) {
+        ML::filter_istream stream(sample.asString(), { { "mapped", "true" } });
+
+        auto mapped = stream.mapped();
+        if (mapped.first) {
+            const char * p = mapped.first;
+            const char * end = p + mapped.second;
+            while (p < end) {
+                auto eol = (const char *)memchr(p, '\n', end - p);
+                if (!eol)
+                    eol = end;
+                if (eol != p)
+                    requests.emplace_back(p, eol);
+                p = eol + 1;
+            }
+            continue;
+        }
+
+        string line;
+        while (getline(stream, line)) {
+            if (!line.empty())
+                requests.push_back(line);
+        }
+    }
+
+    return requests;
+}
+
+vector<string> synthesizeRequests(const Json::Value & synthetic)
+{
+    BidRequestTraffic traffic(BidRequestTraffic::parseConfig(synthetic["config"]));
+    for (const auto & sample: synthetic["samples"])
+        traffic.recordFile(sample.asString());
+
+    size_t count = synthetic.get("count", 10000).asUInt();
+
+    vector<string> requests;
+    requests.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        requests.push_back(traffic.nextString());
+
+    return requests;
+}
+
+HttpHeader makeHeader(const Json::Value & headers, const std::string & payload)
+{
+    std::ostringstream stream;
+    stream << "POST /auctions HTTP/1.1\r\n"
+           << "Content-Length: " << payload.size() << "\r\n";
+
+    if (!headers.isMember("Content-Type"))
+        stream << "Content-Type: application/json\r\n";
+
+    for (auto it = headers.begin(), end = headers.end(); it != end; ++it)
+        stream << it.memberName() << ": " << (*it).asString() << "\r\n";
+    stream << "\r\n";
+
+    HttpHeader header;
+    header.parse(stream.str());
+    return header;
+}
+
+void benchFormat(const std::string & format,
+                 const vector<string> & requests,
+                 int iterations)
+{
+    Measurement parsing;
+    uint64_t count = 0, rejected = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        for (const auto & request: requests) {
+            ++count;
+            Measurement::Scope scope(parsing);
+            try {
+                BidRequest::parse(format, request);
+            } catch (const std::exception & exc) {
+                ++rejected;
+            }
+        }
+    }
+
+    cerr << format << ": " << requests.size() << " requests, "
+         << rejected / iterations << " rejected" << endl
+         << "    " << parsing.print("parse", count) << endl;
+}
+
+void benchExchange(const Json::Value & config,
+                   const vector<string> & requests,
+                   int iterations)
+{
+    const std::string type = config["exchangeType"].asString();
+
+    auto proxies = std::make_shared<ServiceProxies>();
+    ServiceBase owner("bench", proxies);
+
+    std::shared_ptr<ExchangeConnector> exchange
+        = ExchangeConnector::create(type, owner, type);
+    auto connector = std::dynamic_pointer_cast<HttpExchangeConnector>(exchange);
+    if (!connector)
+        throw ML::Exception("%s is not an HTTP exchange connector", type.c_str());
+
+    if (config.isMember("config"))
+        connector->configure(config["config"]);
+
+    /* the headers are parsed once as they aren't part of the bench */
+    vector<HttpHeader> headers;
+    for (const auto & request: requests)
+        headers.push_back(makeHeader(config["headers"], request));
+
+    Measurement parsing, response;
+    uint64_t count = 0, responses = 0, rejected = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        for (size_t j = 0; j < requests.size(); ++j) {
+            ++count;
+
+            BenchHandler handler;
+            handler.endpoint = connector.get();
+
+            std::shared_ptr<BidRequest> br;
+            try {
+                Measurement::Scope scope(parsing);
+                br = connector->parseBidRequest(handler, headers[j], requests[j]);
+            } catch (const std::exception & exc) {
+                handler.error = exc.what();
+            }
+
+            if (!br) {
+                ++rejected;
+                continue;
+            }
+
+            /* the auction is what the router would hand back without any
+               bid in it */
+            Date now = Date::now();
+            Auction auction(connector.get(), Auction::HandleAuction(),
+                            br, br->toJsonStr(), "datacratic",
+                            now, now.plusSeconds(0.1));
+
+            Measurement::Scope scope(response);
+            connector->getResponse(handler, headers[j], auction);
+            ++responses;
+        }
+    }
+
+    cerr << type << ": " << requests.size() << " requests, "
+         << rejected / iterations << " rejected" << endl
+         << "    " << parsing.print("parse", count) << endl
+         << "    " << response.print("getResponse", responses) << endl;
+}
+
+} // file scope
+
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    string configFile = "./rtbkit/testing/exchange_parsing_bench_config.json";
+    int iterations = 10;
+
+    options_description opt("Bench options");
+    opt.add_options()
+        ("config,c", value<string>(&configFile),
+         "bench configuration file")
+        ("iterations,i", value<int>(&iterations),
+         "number of passes over each sample")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(opt).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << opt << endl;
+        return 1;
+    }
+
+    ML::File_Read_Buffer buf(configFile);
+    Json::Value config = Json::parse(std::string(buf.start(), buf.end()));
+
+    for (const auto & entry: config) {
+        auto requests = loadRequests(entry["samples"]);
+
+        if (entry.isMember("synthetic")) {
+            auto synthetic = synthesizeRequests(entry["synthetic"]);
+            requests.insert(requests.end(),
+                            make_move_iterator(synthetic.begin()),
+                            make_move_iterator(synthetic.end()));
+        }
+
+        if (entry.isMember("format"))
+            benchFormat(entry["format"].asString(), requests, iterations);
+        else benchExchange(entry, requests, iterations);
+    }
+}
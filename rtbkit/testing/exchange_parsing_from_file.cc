@@ -17,6 +17,8 @@
 
 #include "jml/utils/file_functions.h"
 
+#include <string.h>
+
 using namespace std;
 using namespace Datacratic;
 using namespace RTBKIT;
@@ -91,12 +93,27 @@ run()
             std::string req = sample.asString();
             vector<string> reqs;
 
-            ML::filter_istream stream(req);
-
-            while (stream) {
-                string line;
-                getline(stream, line);
-                reqs.push_back(line);
+            ML::filter_istream stream(req, { { "mapped", "true" } });
+
+            auto mapped = stream.mapped();
+            if (mapped.first) {
+                // Split the lines straight from the mapped file
+                const char * p = mapped.first;
+                const char * end = p + mapped.second;
+                for (;;) {
+                    auto eol = (const char *)memchr(p, '\n', end - p);
+                    reqs.emplace_back(p, eol ? eol : end);
+                    if (!eol)
+                        break;
+                    p = eol + 1;
+                }
+            }
+            else {
+                while (stream) {
+                    string line;
+                    getline(stream, line);
+                    reqs.push_back(line);
+                }
             }
 
             std::stringstream ss;
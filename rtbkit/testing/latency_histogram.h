@@ -0,0 +1,139 @@
+/* latency_histogram.h                                             -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Histogram of response times with a bounded relative error.
+*/
+
+#pragma once
+
+#include "soa/jsoncpp/json.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* LATENCY HISTOGRAM                                                         */
+/*****************************************************************************/
+
+/** HDR style histogram: the values below 128 each get their own bucket and
+    above that, each power of two is split into 64 buckets, so a recorded
+    value is off by less than 1.6% whatever its magnitude. That's 30KB for
+    the whole 64 bit range, so it can be filled without any allocation or
+    branching beyond finding the highest bit.
+
+    The unit of the values is up to the caller; the load generator records
+    microseconds.
+
+    Not thread safe; keep one per thread and add() them up.
+*/
+struct LatencyHistogram {
+
+    LatencyHistogram()
+        : counts(NumBuckets), total(0), sum(0), min_(UINT64_MAX), max_(0)
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        ++counts[indexOf(value)];
+        ++total;
+        sum += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void add(const LatencyHistogram & other)
+    {
+        for (size_t i = 0; i < NumBuckets; ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void clear()
+    {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = sum = max_ = 0;
+        min_ = UINT64_MAX;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total ? double(sum) / total : 0.0; }
+
+    /** Returns the value under which the given percentage of the recorded
+        values fall; that is the highest value of its bucket.
+    */
+    uint64_t percentile(double percent) const
+    {
+        if (!total) return 0;
+
+        uint64_t rank = std::ceil(total * std::min(percent, 100.0) / 100.0);
+        rank = std::max<uint64_t>(rank, 1);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < NumBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(highestOf(i), max_);
+        }
+        return max_;
+    }
+
+    Json::Value toJson() const
+    {
+        Json::Value result;
+        result["count"] = Json::UInt(total);
+        result["min"] = Json::UInt(min());
+        result["mean"] = mean();
+        result["p50"] = Json::UInt(percentile(50));
+        result["p90"] = Json::UInt(percentile(90));
+        result["p99"] = Json::UInt(percentile(99));
+        result["p999"] = Json::UInt(percentile(99.9));
+        result["max"] = Json::UInt(max());
+        return result;
+    }
+
+private:
+
+    enum {
+        SubBucketBits = 7,
+        SubBuckets = 1 << SubBucketBits,
+        HalfSubBuckets = SubBuckets / 2,
+        NumBuckets = (64 - SubBucketBits) * HalfSubBuckets + SubBuckets
+    };
+
+    static size_t indexOf(uint64_t value)
+    {
+        if (value < SubBuckets) return value;
+
+        int shift = 64 - __builtin_clzll(value) - SubBucketBits;
+        return shift * HalfSubBuckets + (value >> shift);
+    }
+
+    static uint64_t highestOf(size_t index)
+    {
+        if (index < SubBuckets) return index;
+
+        int shift = (index - HalfSubBuckets) / HalfSubBuckets;
+        uint64_t subBucket = index - shift * HalfSubBuckets;
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t sum;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+} // namespace RTBKIT
@@ -0,0 +1,64 @@
+/* latency_histogram_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the latency histogram of the load generator.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/testing/latency_histogram.h"
+
+using namespace std;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( test_percentiles )
+{
+    LatencyHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.percentile(99), 0);
+
+    for (uint64_t i = 1; i <= 100000; ++i)
+        histogram.record(i);
+
+    BOOST_CHECK_EQUAL(histogram.count(), 100000);
+    BOOST_CHECK_EQUAL(histogram.min(), 1);
+    BOOST_CHECK_EQUAL(histogram.max(), 100000);
+    BOOST_CHECK_CLOSE(histogram.mean(), 50000.5, 0.001);
+
+    // Values are within 1.6% of what was recorded.
+    BOOST_CHECK_CLOSE(double(histogram.percentile(50)), 50000, 1.6);
+    BOOST_CHECK_CLOSE(double(histogram.percentile(99)), 99000, 1.6);
+    BOOST_CHECK_CLOSE(double(histogram.percentile(99.9)), 99900, 1.6);
+    BOOST_CHECK_EQUAL(histogram.percentile(100), 100000);
+}
+
+BOOST_AUTO_TEST_CASE( test_small_values_are_exact )
+{
+    LatencyHistogram histogram;
+    for (uint64_t i = 0; i < 128; ++i)
+        histogram.record(i);
+
+    BOOST_CHECK_EQUAL(histogram.percentile(50), 63);
+    BOOST_CHECK_EQUAL(histogram.percentile(100), 127);
+}
+
+BOOST_AUTO_TEST_CASE( test_add )
+{
+    LatencyHistogram fast, slow;
+    for (int i = 0; i < 990; ++i)
+        fast.record(1000);
+    for (int i = 0; i < 10; ++i)
+        slow.record(1ULL << 40);
+
+    fast.add(slow);
+    BOOST_CHECK_EQUAL(fast.count(), 1000);
+    BOOST_CHECK_CLOSE(double(fast.percentile(99)), 1000, 1.6);
+    BOOST_CHECK_CLOSE(double(fast.percentile(99.9)), double(1ULL << 40), 1.6);
+    BOOST_CHECK_EQUAL(fast.max(), 1ULL << 40);
+
+    fast.clear();
+    BOOST_CHECK_EQUAL(fast.count(), 0);
+    BOOST_CHECK_EQUAL(fast.max(), 0);
+}
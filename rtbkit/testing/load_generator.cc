@@ -0,0 +1,260 @@
+/* load_generator.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Implementation of the load generator.
+*/
+
+#include "load_generator.h"
+
+#include "rtbkit/common/testing/exchange_source.h"
+#include "soa/types/date.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+#include "jml/utils/exc_assert.h"
+
+#include <boost/thread.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+namespace {
+
+/** Sends requests on one connection from start to end at the given rate,
+    one at a time.
+*/
+void runConnection(const Json::Value & config, double rate, double offset,
+                   Date start, Date end,
+                   LoadGenerator::SourceResult & result)
+{
+    std::unique_ptr<BidSource> bids;
+
+    auto connect = [&] () {
+        try {
+            bids = BidSource::createBidSource(config);
+        } catch (const std::exception & exc) {
+            cerr << "couldn't connect: " << exc.what() << endl;
+            bids.reset();
+        }
+    };
+
+    connect();
+
+    double interval = 1.0 / rate;
+    Date due = start.plusSeconds(interval * offset);
+
+    for (; due < end; due.addSeconds(interval)) {
+        double wait = due.secondsSince(Date::now());
+        if (wait > 0) ML::sleep(wait);
+
+        ++result.sent;
+
+        if (!bids) {
+            ++result.errors;
+            connect();
+            continue;
+        }
+
+        try {
+            bids->sendBidRequest();
+            auto response = bids->receiveBid();
+            result.latency.record(Date::now().secondsSince(due) * 1000000);
+
+            bool bid = false;
+            if (response.first) {
+                for (auto & item: response.second)
+                    bid = bid || !item.maxPrice.isZero();
+            }
+
+            if (bid) ++result.bids;
+            else ++result.noBids;
+        } catch (const std::exception & exc) {
+            ++result.errors;
+            connect();
+        }
+    }
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* LOAD GENERATOR                                                            */
+/*****************************************************************************/
+
+LoadGenerator::
+LoadGenerator(const Json::Value & config)
+{
+    qps = config.get("qps", 1000).asDouble();
+    step = config.get("step", 1.25).asDouble();
+    stepSeconds = config.get("stepSeconds", 10).asDouble();
+    maxQps = config.get("maxQps", 1000000).asDouble();
+    sloMs = config.get("sloMs", 50).asDouble();
+    sloPercentile = config.get("sloPercentile", 99).asDouble();
+    maxErrorRate = config.get("maxErrorRate", 0.001).asDouble();
+
+    ExcCheck(qps > 0, "qps must be positive");
+    ExcCheck(step > 1.0, "step must be over 1");
+    ExcCheck(stepSeconds > 0, "stepSeconds must be positive");
+
+    const Json::Value & entries = config["sources"];
+    ExcCheck(entries.size() > 0, "load generator needs at least one source");
+
+    for (const auto & entry: entries) {
+        Source source;
+        source.name = entry.get("name", entry["bids"]["type"]).asString();
+        source.weight = entry.get("weight", 1.0).asDouble();
+        source.connections = entry.get("connections", 1).asInt();
+        source.bids = entry["bids"];
+
+        ExcCheck(source.weight > 0, "source weight must be positive");
+        ExcCheck(source.connections > 0, "source needs at least one connection");
+        sources.push_back(source);
+    }
+}
+
+LoadGenerator::StepResult
+LoadGenerator::
+runStep(double qps, double seconds)
+{
+    double totalWeight = 0.0;
+    for (auto & source: sources)
+        totalWeight += source.weight;
+
+    size_t numConnections = 0;
+    for (auto & source: sources)
+        numConnections += source.connections;
+
+    // Leave the connections some time to be set up before the schedule
+    // starts.
+    Date start = Date::now().plusSeconds(0.5);
+    Date end = start.plusSeconds(seconds);
+
+    std::vector<SourceResult> results(numConnections);
+    boost::thread_group threads;
+
+    size_t index = 0;
+    for (auto & source: sources) {
+        double rate = qps * source.weight / totalWeight / source.connections;
+
+        for (int i = 0; i < source.connections; ++i, ++index) {
+            // Spread the connections of a source over their interval.
+            double offset = double(i) / source.connections;
+            auto & result = results[index];
+            const Json::Value & config = source.bids;
+
+            threads.create_thread([=, &result, &config] () {
+                        runConnection(config, rate, offset, start, end, result);
+                    });
+        }
+    }
+
+    threads.join_all();
+
+    StepResult stepResult;
+    stepResult.qps = qps;
+    stepResult.seconds = seconds;
+
+    index = 0;
+    for (auto & source: sources) {
+        auto & total = stepResult.sources[source.name];
+
+        for (int i = 0; i < source.connections; ++i, ++index) {
+            const auto & result = results[index];
+            for (SourceResult * r: { &total, &stepResult.total }) {
+                r->latency.add(result.latency);
+                r->sent += result.sent;
+                r->errors += result.errors;
+                r->noBids += result.noBids;
+                r->bids += result.bids;
+            }
+        }
+    }
+
+    return stepResult;
+}
+
+bool
+LoadGenerator::
+withinSlo(const StepResult & result) const
+{
+    const SourceResult & total = result.total;
+    if (!total.sent) return false;
+    if (total.errors > total.sent * maxErrorRate) return false;
+
+    return total.latency.percentile(sloPercentile) <= sloMs * 1000;
+}
+
+double
+LoadGenerator::
+findCapacity()
+{
+    double sustained = 0.0;
+
+    for (double rate = qps; rate <= maxQps; rate *= step) {
+        StepResult result = runStep(rate, stepSeconds);
+        const SourceResult & total = result.total;
+        bool ok = withinSlo(result);
+
+        cerr << ML::format("%9.0f qps: sent %9.0f/s p50 %8.2fms p99 %8.2fms "
+                           "p999 %8.2fms errors %lld %s",
+                           rate, total.sent / result.seconds,
+                           total.latency.percentile(50) / 1000.0,
+                           total.latency.percentile(99) / 1000.0,
+                           total.latency.percentile(99.9) / 1000.0,
+                           (long long)total.errors,
+                           ok ? "ok" : "SLO missed")
+             << endl;
+
+        if (result.sources.size() > 1) {
+            for (auto & source: result.sources) {
+                cerr << "    " << source.first << ": "
+                     << source.second.toJson(result.seconds).toStringNoNewLine()
+                     << endl;
+            }
+        }
+
+        if (!ok) break;
+        sustained = rate;
+    }
+
+    cerr << ML::format("max sustainable rate: %.0f qps "
+                       "(p%g under %gms)",
+                       sustained, sloPercentile, sloMs)
+         << endl;
+
+    return sustained;
+}
+
+Json::Value
+LoadGenerator::SourceResult::
+toJson(double seconds) const
+{
+    Json::Value result;
+    result["qps"] = seconds > 0 ? sent / seconds : 0.0;
+    result["sent"] = Json::UInt(sent);
+    result["errors"] = Json::UInt(errors);
+    result["noBids"] = Json::UInt(noBids);
+    result["bids"] = Json::UInt(bids);
+    result["latencyUs"] = latency.toJson();
+    return result;
+}
+
+Json::Value
+LoadGenerator::StepResult::
+toJson() const
+{
+    Json::Value result;
+    result["targetQps"] = qps;
+    result["seconds"] = seconds;
+    result["total"] = total.toJson(seconds);
+    for (auto & source: sources)
+        result["sources"][source.first] = source.second.toJson(seconds);
+    return result;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,115 @@
+/* load_generator.h                                                -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Open loop load generator used to find the capacity of a router.
+*/
+
+#pragma once
+
+#include "rtbkit/testing/latency_histogram.h"
+#include "soa/jsoncpp/json.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* LOAD GENERATOR                                                            */
+/*****************************************************************************/
+
+/** Sends bid requests at a fixed rate through the bid sources of the mock
+    exchange and records the response times.
+
+    The load is open loop: each connection has its own schedule and the
+    response time of a request is measured from the time it was due to be
+    sent, so a router that falls behind shows up in the latencies rather
+    than just slowing the generator down.
+
+    The configuration looks like
+
+    {
+        "sources": [
+            {
+                "name": "openrtb",
+                "weight": 1.0,
+                "connections": 16,
+                "bids": { "type": "openrtb", "url": "localhost:12339" }
+            }
+        ],
+        "qps": 1000,            // starting rate of the ramp
+        "step": 1.25,           // rate multiplier between steps
+        "stepSeconds": 10,
+        "maxQps": 100000,
+        "sloMs": 50,            // latency the percentile must stay under
+        "sloPercentile": 99,
+        "maxErrorRate": 0.001
+    }
+
+    The rate is split between the sources according to their weight and
+    between the connections of a source evenly; a source stands for an
+    exchange with the agents that are configured for it.
+*/
+struct LoadGenerator {
+
+    LoadGenerator(const Json::Value & config);
+
+    struct SourceResult {
+        SourceResult() : sent(0), errors(0), noBids(0), bids(0) {}
+
+        LatencyHistogram latency;   ///< In microseconds
+        uint64_t sent;
+        uint64_t errors;
+        uint64_t noBids;
+        uint64_t bids;
+
+        Json::Value toJson(double seconds) const;
+    };
+
+    struct StepResult {
+        StepResult() : qps(0), seconds(0) {}
+
+        double qps;                 ///< Target rate
+        double seconds;
+        SourceResult total;
+        std::map<std::string, SourceResult> sources;
+
+        Json::Value toJson() const;
+    };
+
+    /** Sends requests at the given rate for the given duration. */
+    StepResult runStep(double qps, double seconds);
+
+    /** Returns true if the step kept within the SLO. */
+    bool withinSlo(const StepResult & result) const;
+
+    /** Ramps the rate up until the SLO is missed and returns the highest
+        rate that was sustained, or 0 if not even the first one was. Each
+        step is printed as it completes.
+    */
+    double findCapacity();
+
+    double qps;
+    double step;
+    double stepSeconds;
+    double maxQps;
+    double sloMs;
+    double sloPercentile;
+    double maxErrorRate;
+
+private:
+    struct Source {
+        std::string name;
+        double weight;
+        int connections;
+        Json::Value bids;
+    };
+
+    std::vector<Source> sources;
+};
+
+} // namespace RTBKIT
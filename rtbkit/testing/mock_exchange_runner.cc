@@ -7,6 +7,7 @@
 
 #include "soa/service/service_utils.h"
 #include "mock_exchange.h"
+#include "load_generator.h"
 #include "jml/utils/file_functions.h"
 
 #include <boost/program_options/parsers.hpp>
@@ -21,12 +22,16 @@ int main(int argc, char ** argv)
     using namespace boost::program_options;
 
     std::string configuration = "rtbkit/examples/mock-exchange-config.json";
+    bool load = false;
 
     ServiceProxyArguments args;
     options_description options = args.makeProgramOptions();
     options_description more("Mock Exchange");
     more.add_options()
-        ("configuration,f", value(&configuration), "mock exchange configuration file");
+        ("configuration,f", value(&configuration), "mock exchange configuration file")
+        ("load,l", bool_switch(&load),
+         "ramp the load up until the SLO is missed; the configuration is then "
+         "the one of the load generator");
 
     options.add(more);
     options.add_options() ("help,h", "Print this message");
@@ -43,6 +48,12 @@ int main(int argc, char ** argv)
     ML::File_Read_Buffer buf(configuration);
     Json::Value result = Json::parse(std::string(buf.start(), buf.end()));
 
+    if (load) {
+        RTBKIT::LoadGenerator generator(result);
+        generator.findCapacity();
+        return 0;
+    }
+
     RTBKIT::MockExchange exchange(args);
     exchange.start(result);
 
@@ -0,0 +1,423 @@
+/* rtbkit_microbench.cc                                            -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Microbenchmarks of the operations on the hot path of the router: config
+   set operations, id and JSON parsing, filtering and bid authorization.
+
+   The results can be saved with --json and compared against a saved run
+   with --baseline, in which case the exit code tells whether anything got
+   slower by more than --threshold.
+
+   The filtering is benched once per --configs value, so that repeating it
+   shows how it scales with the number of agents, and over synthetic
+   requests learned from the --traffic samples when there are any.
+
+   The huge page benchmarks do random lookups in a table of --table-size
+   entries allocated with each huge page mode; comparing their dtlbMisses
+   counter shows what the huge pages save on the big tables of the router
+   and post auction loop.
+
+   The in flight benchmarks compare the router's table of in flight
+   auctions with the TimeoutMap it used to be, with --in-flight auctions
+   that each live for five seconds of simulated time: lookups of the
+   auctions, and the churn of adding one and expiring the oldest.
+*/
+
+#include "rtbkit/core/router/filter_pool.h"
+#include "rtbkit/core/router/router_types.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+#include "rtbkit/core/banker/account.h"
+#include "rtbkit/common/exchange_connector.h"
+#include "rtbkit/common/bid_request.h"
+#include "rtbkit/common/filter.h"
+#include "rtbkit/common/testing/bid_request_traffic.h"
+#include "soa/utils/benchmarks.h"
+#include "soa/types/id.h"
+#include "soa/service/timeout_map.h"
+#include "soa/service/flat_timeout_map.h"
+#include "jml/arch/huge_page_allocator.h"
+#include "jml/utils/filter_streams.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+namespace {
+
+const string openRtbRequest =
+    "{\"id\":\"51dc0333-1cbb-4753-8db9-69cbb38000c1\","
+    "\"imp\":[{\"id\":\"1\",\"banner\":{\"w\":300,\"h\":250,\"battr\":[10,13]},"
+    "\"bidfloor\":0.15}],"
+    "\"site\":{\"id\":\"1234\",\"domain\":\"example.com\","
+    "\"page\":\"http://example.com/news/today.html\",\"cat\":[\"IAB12\"]},"
+    "\"device\":{\"ip\":\"192.168.1.1\",\"os\":\"Osx\",\"language\":\"en\","
+    "\"ua\":\"Mozilla/5.0 (Macintosh; Intel Mac OS X 10_9_2) AppleWebKit/537.36"
+    " (KHTML, like Gecko) Chrome/33.0.1750.152 Safari/537.36\","
+    "\"geo\":{\"country\":\"US\",\"region\":\"MA\",\"city\":\"Boston\","
+    "\"zip\":\"02114\"}},"
+    "\"user\":{\"id\":\"9c560b647cc51cd96f842f16095b43ec\"},"
+    "\"at\":2,\"tmax\":100,\"bcat\":[],\"badv\":[]}";
+
+
+/******************************************************************************/
+/* BENCH EXCHANGE CONNECTOR                                                   */
+/******************************************************************************/
+
+struct BenchExchangeConnector : public ExchangeConnector
+{
+    BenchExchangeConnector(const std::string & name) :
+        ExchangeConnector(name), name(name)
+    {}
+
+    std::string exchangeName() const { return name; }
+
+    void configure(const Json::Value & parameters) {}
+    void enableUntil(Date date) {}
+
+private:
+    std::string name;
+};
+
+
+/******************************************************************************/
+/* BENCHMARKS                                                                 */
+/******************************************************************************/
+
+void benchConfigSet(BenchmarkRunner & runner, size_t numConfigs)
+{
+    ConfigSet a, b;
+    for (size_t i = 0; i < numConfigs; i += 3) a.set(i);
+    for (size_t i = 0; i < numConfigs; i += 5) b.set(i);
+    b.expand(numConfigs);
+
+    runner.run("configSet.and", [&] {
+                ConfigSet result = a;
+                result &= b;
+                doNotOptimize(result);
+            });
+
+    runner.run("configSet.count", [&] { doNotOptimize(a.count()); });
+
+    runner.run("configSet.iterate", [&] {
+                size_t total = 0;
+                for (size_t i = a.next(); i < a.size(); i = a.next(i + 1))
+                    total += i;
+                doNotOptimize(total);
+            });
+}
+
+void benchIds(BenchmarkRunner & runner)
+{
+    const string uuid = "51dc0333-1cbb-4753-8db9-69cbb38000c1";
+    const string number = "1234567890123";
+    const string other = "-ad2c310:1347a70eba8:-8000";
+
+    runner.run("id.parse.uuid", [&] { doNotOptimize(Id(uuid)); });
+    runner.run("id.parse.int", [&] { doNotOptimize(Id(number)); });
+    runner.run("id.parse.string", [&] { doNotOptimize(Id(other)); });
+
+    Id id(uuid);
+    runner.run("id.toString", [&] { doNotOptimize(id.toString()); });
+}
+
+void benchJson(BenchmarkRunner & runner)
+{
+    runner.run("json.parse", [&] {
+                doNotOptimize(Json::parse(openRtbRequest));
+            });
+
+    runner.run("bidRequest.parse.openrtb", [&] {
+                std::unique_ptr<BidRequest> br(
+                        BidRequest::parse("openrtb", openRtbRequest));
+                doNotOptimize(br->auctionId);
+            });
+}
+
+/** Requests the filters are benched over; the fixed one unless there are
+    samples to learn synthetic ones from.
+ */
+vector<std::shared_ptr<BidRequest> >
+makeRequests(const vector<string> & samples, const string & format,
+             size_t count)
+{
+    vector<string> requests;
+
+    if (samples.empty()) requests.push_back(openRtbRequest);
+    else {
+        BidRequestTraffic traffic;
+        for (const string & sample: samples)
+            traffic.recordFile(sample);
+        for (size_t i = 0; i < count; ++i)
+            requests.push_back(traffic.nextString());
+    }
+
+    vector<std::shared_ptr<BidRequest> > result;
+    for (const string & request: requests) {
+        std::shared_ptr<BidRequest> br(BidRequest::parse(format, request));
+        br->exchange = "bench";
+        result.push_back(br);
+    }
+
+    return result;
+}
+
+void benchFilterPool(BenchmarkRunner & runner, size_t numConfigs,
+                     const vector<std::shared_ptr<BidRequest> > & requests)
+{
+    FilterPool pool;
+    pool.initWithDefaultFilters();
+
+    // Half of the configs have a creative of the right size for the request
+    for (size_t i = 0; i < numConfigs; ++i) {
+        auto config = std::make_shared<AgentConfig>();
+        config->account = { "campaign" + to_string(i), "strategy" };
+        config->creatives.push_back(i % 2
+                                    ? Creative::image(300, 250, "mrec", 0)
+                                    : Creative::image(728, 90, "lb", 0));
+
+        AgentInfo info;
+        info.config = config;
+        info.configured = true;
+        pool.addConfig("agent" + to_string(i), info);
+    }
+
+    BenchExchangeConnector conn("bench");
+
+    size_t next = 0;
+    runner.run("filterPool.filter." + to_string(numConfigs), [&] {
+                const BidRequest & br = *requests[next];
+                if (++next == requests.size()) next = 0;
+                doNotOptimize(pool.filter(br, &conn));
+            });
+
+    // Same requests filtered 64 at a time; timed per request
+    vector<const BidRequest *> batch;
+    runner.runBatches("filterPool.filterBatch." + to_string(numConfigs),
+            [&] (uint64_t n) {
+                while (n) {
+                    batch.clear();
+                    for (; n && batch.size() < 64; --n) {
+                        batch.push_back(requests[next].get());
+                        if (++next == requests.size()) next = 0;
+                    }
+                    doNotOptimize(pool.filterBatch(batch, &conn));
+                }
+            });
+}
+
+void benchBanker(BenchmarkRunner & runner)
+{
+    Accounts accounts;
+    AccountKey campaign("campaign");
+    AccountKey strategy("campaign:strategy");
+    AccountKey spend("campaign:strategy:spend");
+
+    accounts.createBudgetAccount(campaign);
+    accounts.createBudgetAccount(strategy);
+    accounts.createSpendAccount(spend);
+    accounts.setBudget(campaign, USD(1000000));
+    accounts.setBalance(strategy, USD(1000000), AT_NONE);
+    accounts.setBalance(spend, USD(1000000), AT_NONE);
+
+    ShadowAccounts shadow;
+    shadow.activateAccount(spend);
+    shadow.syncFrom(accounts);
+
+    // Cancelled right away so that the balance never runs out
+    const string item = "51dc0333-1cbb-4753-8db9-69cbb38000c1-1";
+    runner.run("banker.authorize", [&] {
+                doNotOptimize(shadow.authorizeBid(spend, item, USD_CPM(1)));
+                shadow.cancelBid(spend, item);
+            });
+}
+
+void benchHugePages(BenchmarkRunner & runner, size_t tableSize)
+{
+    typedef Huge_Page_Allocator<std::pair<const uint64_t, uint64_t> > Alloc;
+    typedef std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>,
+                               std::equal_to<uint64_t>, Alloc> Table;
+
+    std::mt19937_64 rng(1);
+    vector<uint64_t> keys(tableSize);
+    for (auto & key: keys)
+        key = rng();
+
+    vector<uint64_t> lookups(1 << 16);
+    for (auto & key: lookups)
+        key = keys[rng() % keys.size()];
+
+    for (auto mode: { HP_NONE, HP_TRANSPARENT, HP_EXPLICIT }) {
+        string name = string("hugePages.lookup.") + ML::print(mode);
+        if (!runner.filter.empty() && name.find(runner.filter) == string::npos)
+            continue;
+
+        // Without an arena the allocator uses operator new, which is what
+        // the tables did before.
+        Table table(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(),
+                    Alloc(huge_page_arena(mode)));
+        table.reserve(keys.size());
+        for (uint64_t key: keys)
+            table[key] = key;
+
+        size_t next = 0;
+        runner.run(name, [&] {
+                    doNotOptimize(table.find(lookups[next])->second);
+                    if (++next == lookups.size()) next = 0;
+                });
+    }
+}
+
+template<typename InFlight>
+void benchInFlight(BenchmarkRunner & runner, const string & name,
+                   size_t numInFlight)
+{
+    string lookupName = "inFlight.lookup." + name;
+    string churnName = "inFlight.churn." + name;
+    if (!runner.filter.empty()
+        && lookupName.find(runner.filter) == string::npos
+        && churnName.find(runner.filter) == string::npos)
+        return;
+
+    // As many auctions as there are in flight during a five second window
+    Date now = Date::fromSecondsSinceEpoch(1000000);
+    double lifetime = 5.0;
+    double interval = lifetime / numInFlight;
+
+    InFlight inFlight;
+    inFlight.expire(now);
+
+    uint64_t next = 0;
+    auto add = [&] {
+        inFlight.insert(Id(next++), AuctionInfo(nullptr, now),
+                        now.plusSeconds(lifetime));
+        now = now.plusSeconds(interval);
+    };
+    for (size_t i = 0;  i < numInFlight;  ++i)
+        add();
+
+    std::mt19937_64 rng(1);
+    vector<Id> lookups(1 << 16);
+    for (auto & id: lookups)
+        id = Id(next - 1 - rng() % numInFlight);
+
+    size_t n = 0;
+    runner.run(lookupName, [&] {
+                doNotOptimize(inFlight.find(lookups[n])->second.auction);
+                if (++n == lookups.size()) n = 0;
+            });
+
+    auto onExpired = [] (const Id &, const AuctionInfo &) { return Date(); };
+    runner.run(churnName, [&] {
+                add();
+                inFlight.expire(onExpired, now);
+            });
+}
+
+} // file scope
+
+
+/******************************************************************************/
+/* MAIN                                                                       */
+/******************************************************************************/
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    BenchmarkRunner runner;
+    vector<size_t> numConfigs;
+    vector<string> trafficSamples;
+    string trafficFormat = "openrtb";
+    size_t numRequests = 10000;
+    size_t tableSize = 4 << 20;
+    size_t numInFlight = 100000;
+    string jsonFile;
+    string baselineFile;
+    double threshold = 0.1;
+
+    options_description options("Options");
+    options.add_options()
+        ("filter,f", value<string>(&runner.filter),
+         "only run the benchmarks whose name contains this")
+        ("configs,c", value<vector<size_t> >(&numConfigs),
+         "number of agent configs for the config set and filter benchmarks;"
+         " can be repeated")
+        ("traffic", value<vector<string> >(&trafficSamples),
+         "sample requests to filter synthetic requests learned from")
+        ("traffic-format", value<string>(&trafficFormat),
+         "bid request format of the traffic samples")
+        ("requests", value<size_t>(&numRequests),
+         "number of synthetic requests to cycle through")
+        ("table-size", value<size_t>(&tableSize),
+         "number of entries of the huge page lookup tables")
+        ("in-flight", value<size_t>(&numInFlight),
+         "number of auctions in flight for the in flight table benchmarks")
+        ("json,j", value<string>(&jsonFile),
+         "write the results as JSON to this file")
+        ("baseline,b", value<string>(&baselineFile),
+         "compare against the JSON results of an earlier run")
+        ("threshold,t", value<double>(&threshold),
+         "slowdown ratio at which a benchmark is reported as a regression")
+        ("max-time", value<double>(&runner.maxTime),
+         "maximum seconds of sampling per benchmark")
+        ("tolerance", value<double>(&runner.tolerance),
+         "relative error of the median at which sampling stops")
+        ("no-counters", "don't read the hardware performance counters")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(options).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << options << endl;
+        return 1;
+    }
+
+    runner.useCounters = !vm.count("no-counters");
+    if (runner.useCounters && !PerfCounters().available())
+        cerr << "hardware counters aren't available" << endl;
+
+    if (numConfigs.empty()) numConfigs.push_back(1024);
+
+    benchConfigSet(runner, numConfigs.front());
+    benchIds(runner);
+    benchJson(runner);
+
+    auto requests = makeRequests(trafficSamples, trafficFormat, numRequests);
+    for (size_t n: numConfigs)
+        benchFilterPool(runner, n, requests);
+
+    benchBanker(runner);
+    benchHugePages(runner, tableSize);
+    benchInFlight<TimeoutMap<Id, AuctionInfo> >
+        (runner, "timeoutMap", numInFlight);
+    benchInFlight<FlatTimeoutMap<Id, AuctionInfo> >
+        (runner, "flat", numInFlight);
+
+    runner.dump(cout);
+
+    if (!jsonFile.empty()) {
+        ML::filter_ostream stream(jsonFile);
+        stream << runner.toJson().toStyledString();
+    }
+
+    if (!baselineFile.empty()) {
+        auto baseline = Json::parseFromFile(baselineFile);
+        auto regressions = runner.compare(baseline, threshold, cout);
+        return regressions.empty() ? 0 : 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/* synthetic_traffic.cc                                            -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Generates synthetic bid requests that look like the samples they were
+   learned from, one per line, for the benchmarks and load tests:
+
+       synthetic_traffic --samples requests.json.xz --count 1000000 \
+                         --scale segments=4 --output synthetic.json.xz
+
+   The model learned from the samples can be saved with --save-model and
+   reused with --model so that the samples aren't needed anymore.
+*/
+
+#include "rtbkit/common/testing/bid_request_traffic.h"
+#include "jml/utils/filter_streams.h"
+#include "jml/arch/exception.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    BidRequestTraffic::Config config;
+    vector<string> samples;
+    vector<string> scales;
+    string modelFile;
+    string saveModelFile;
+    string outputFile = "-";
+    size_t count = 1000;
+
+    options_description options("Options");
+    options.add_options()
+        ("samples,s", value<vector<string> >(&samples),
+         "file of sample requests, one per line; can be repeated")
+        ("model,m", value<string>(&modelFile),
+         "load a model saved with --save-model instead of the samples")
+        ("save-model", value<string>(&saveModelFile),
+         "save the model learned from the samples to this file")
+        ("count,n", value<size_t>(&count),
+         "number of requests to generate")
+        ("output,o", value<string>(&outputFile),
+         "file to write the requests to; may end in .gz or .xz")
+        ("seed", value<uint32_t>(&config.seed),
+         "seed of the random number generator")
+        ("users", value<size_t>(&config.numUsers),
+         "number of distinct users")
+        ("user-skew", value<double>(&config.userSkew),
+         "zipf skew of the user popularity")
+        ("urls", value<size_t>(&config.numUrls),
+         "number of distinct pages")
+        ("url-skew", value<double>(&config.urlSkew),
+         "zipf skew of the page popularity")
+        ("pages-per-domain", value<size_t>(&config.pagesPerDomain),
+         "number of pages on each domain")
+        ("scale", value<vector<string> >(&scales),
+         "name=factor: scales the size of the arrays with that name")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(options).run(), vm);
+    notify(vm);
+
+    if (vm.count("help") || (samples.empty() && modelFile.empty())) {
+        cerr << options << endl;
+        return 1;
+    }
+
+    for (const string & scale: scales) {
+        size_t pos = scale.find('=');
+        if (pos == string::npos)
+            throw ML::Exception("invalid scale '%s': expected name=factor",
+                                scale.c_str());
+        config.arrayScales[scale.substr(0, pos)] = stod(scale.substr(pos + 1));
+    }
+
+    BidRequestTraffic traffic(config);
+
+    if (!modelFile.empty()) {
+        filter_istream stream(modelFile);
+        traffic.load(stream);
+    }
+
+    for (const string & sample: samples) {
+        size_t recorded = traffic.recordFile(sample);
+        cerr << "recorded " << recorded << " requests from " << sample << endl;
+    }
+
+    if (!saveModelFile.empty()) {
+        filter_ostream stream(saveModelFile);
+        traffic.dump(stream);
+    }
+
+    filter_ostream stream(outputFile);
+    traffic.write(stream, count);
+
+    return 0;
+}
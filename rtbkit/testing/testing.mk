@@ -12,7 +12,7 @@ $(eval $(call test,agent_configuration_test,rtb_router bidding_agent,boost))
 $(eval $(call test,augmentation_list_test,rtb,boost))
 $(eval $(call test,historical_bid_request_test,bid_request,boost))
 
-$(eval $(call library,integration_test_utils,generic_exchange_connector.cc mock_exchange.cc,rtb_router bid_test_utils exchange))
+$(eval $(call library,integration_test_utils,generic_exchange_connector.cc mock_exchange.cc load_generator.cc,rtb_router bid_test_utils exchange))
 
 $(eval $(call test,win_cost_model_test,openrtb_exchange bidding_agent integration_test_utils,boost))
 $(eval $(call test,bidder_test,openrtb_exchange bidding_agent integration_test_utils,boost))
@@ -22,5 +22,9 @@ $(eval $(call program,json_feeder,boost_program_options services utils))
 $(eval $(call program,json_listener,boost_program_options services utils))
 
 $(eval $(call test,exchange_parsing_from_file_test,openrtb_bid_request rtb_router openrtb_exchange,boost))
+$(eval $(call program,exchange_parsing_bench,openrtb_exchange rtb_router services bid_request_synth boost_program_options utils))
+$(eval $(call program,rtbkit_microbench,rtb_router openrtb_bid_request bid_request_synth test_utils boost_program_options utils))
+$(eval $(call program,synthetic_traffic,bid_request_synth boost_program_options utils))
 
 $(eval $(call test,agent_context_switch_test,rtb_router bidding_agent,boost))
+$(eval $(call test,latency_histogram_test,jsoncpp,boost))
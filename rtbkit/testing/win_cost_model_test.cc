@@ -86,3 +86,48 @@ BOOST_AUTO_TEST_CASE( win_cost_model_test )
     BOOST_CHECK_EQUAL(events["router.cummulatedAuthorizedPrice"], count * 505);
 }
 
+
+BOOST_AUTO_TEST_CASE( win_cost_model_compiled_test )
+{
+    int compiled = 0;
+
+    WinCostModel::registerCompiler("compiledTest", [&] (Json::Value const & data) {
+        ++compiled;
+        double m = data["m"].asDouble();
+        return WinCostModel::Model([=] (WinCostModel const & model,
+                                        Bid const & bid,
+                                        Amount const & price) {
+            return price * m;
+        });
+    });
+
+    Json::Value data;
+    data["m"] = 0.5;
+
+    Bid bid;
+
+    // Copies of a bound model share its parsed data.
+    WinCostModel model("compiledTest", data);
+    model.bind();
+    WinCostModel copy = model;
+    BOOST_CHECK_EQUAL(model.evaluate(bid, MicroUSD(1000)), MicroUSD(500));
+    BOOST_CHECK_EQUAL(copy.evaluate(bid, MicroUSD(1000)), MicroUSD(500));
+    BOOST_CHECK_EQUAL(compiled, 1);
+
+    // An unbound model is bound on its first evaluate.
+    WinCostModel parsed = WinCostModel::fromJson(model.toJson());
+    BOOST_CHECK_EQUAL(parsed.evaluate(bid, MicroUSD(2000)), MicroUSD(1000));
+    BOOST_CHECK_EQUAL(parsed.evaluate(bid, MicroUSD(2000)), MicroUSD(1000));
+    BOOST_CHECK_EQUAL(compiled, 2);
+
+    // Plain models are looked up once and shared.
+    WinCostModel::registerModel("test", linearWinCostModel);
+    data["b"] = MicroUSD(5.0).toJson();
+    WinCostModel linear("test", data);
+    BOOST_CHECK_EQUAL(linear.evaluate(bid, MicroUSD(1000)), MicroUSD(505));
+    linear.name = "compiledTest";
+    BOOST_CHECK_EQUAL(linear.evaluate(bid, MicroUSD(1000)), MicroUSD(500));
+
+    WinCostModel unknown("unknownTest", data);
+    BOOST_CHECK_THROW(unknown.evaluate(bid, MicroUSD(1000)), ML::Exception);
+}
@@ -16,7 +16,12 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdlib.h>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 using namespace std;
 using namespace ML;
@@ -234,6 +239,200 @@ struct GcLockBase::Deferred {
     }
 };
 
+/// Background thread that runs the deferred work of the locks using it
+struct GcLockBase::Reclaimer {
+
+    static Reclaimer & instance()
+    {
+        static Reclaimer reclaimer;
+        return reclaimer;
+    }
+
+    Reclaimer()
+        : running(0), shutdown(false),
+          thread([=] () { this->run(); })
+    {
+    }
+
+    ~Reclaimer()
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            shutdown = true;
+        }
+        wakeup.notify_all();
+        thread.join();
+    }
+
+    /** Queue the work of a closed epoch, or run it straight away once the
+        process is going down.
+    */
+    void enqueue(GcLockBase * owner, std::vector<DeferredList *> lists)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if (!shutdown) {
+                queue.emplace_back(owner, std::move(lists));
+                wakeup.notify_one();
+                return;
+            }
+        }
+
+        owner->runDeferredLists(lists);
+    }
+
+    /** Wait until none of the given lock's work is queued or running. */
+    void waitFor(const GcLockBase * owner)
+    {
+        if (std::this_thread::get_id() == thread.get_id())
+            return;
+
+        std::unique_lock<std::mutex> guard(lock);
+        idle.wait(guard, [&] () { return !isBusy(owner); });
+    }
+
+    bool isBusy(const GcLockBase * owner) const
+    {
+        if (running == owner)
+            return true;
+        for (auto & batch: queue)
+            if (batch.first == owner)
+                return true;
+        return false;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+
+        for (;;) {
+            if (queue.empty()) {
+                if (shutdown)
+                    return;
+                wakeup.wait(guard);
+                continue;
+            }
+
+            auto batch = std::move(queue.front());
+            queue.pop_front();
+            running = batch.first;
+
+            guard.unlock();
+            batch.first->runDeferredLists(batch.second);
+            guard.lock();
+
+            running = 0;
+            idle.notify_all();
+        }
+    }
+
+    std::mutex lock;
+    std::condition_variable wakeup;  ///< Work was queued or we're stopping
+    std::condition_variable idle;    ///< A batch has been run
+    std::deque<std::pair<GcLockBase *, std::vector<DeferredList *> > > queue;
+    GcLockBase * running;            ///< Owner of the batch being run
+    bool shutdown;
+    std::thread thread;
+};
+
+namespace {
+
+/** Number given to the calling thread, from 1, to pick its epoch slot. */
+__thread unsigned gcThreadNumber = 0;
+unsigned gcThreadCount = 0;
+
+} // file scope
+
+/// Readers of a ScalableGcLock and the writers waiting on them
+struct GcLockBase::Epochs {
+
+    /// Count of the readers of one group of threads in each epoch parity
+    struct Slot {
+        int64_t in[2];
+    } JML_ALIGNED(64);
+
+    Epochs()
+        : waiters(0), pending(0), wakeups(0), rescan(0)
+    {
+        numSlots = 1;
+        while (numSlots < std::thread::hardware_concurrency()
+               && numSlots < 1024)
+            numSlots *= 2;
+
+        void * mem = 0;
+        int res = posix_memalign(&mem, sizeof(Slot), numSlots * sizeof(Slot));
+        if (res != 0)
+            throw ML::Exception(res, "posix_memalign");
+        slots = (Slot *)mem;
+        std::fill(slots, slots + numSlots, Slot());
+    }
+
+    ~Epochs()
+    {
+        free(slots);
+    }
+
+    Slot & mySlot()
+    {
+        if (JML_UNLIKELY(!gcThreadNumber))
+            gcThreadNumber = __sync_add_and_fetch(&gcThreadCount, 1);
+        return slots[gcThreadNumber & (numSlots - 1)];
+    }
+
+    /** Number of readers in the given epoch.  Only exact when the epoch is
+        no longer the current one, as nothing more can then enter it.
+    */
+    int64_t readers(int32_t epoch) const
+    {
+        int64_t result = 0;
+        for (unsigned i = 0;  i < numSlots;  ++i)
+            result += ((volatile Slot *)slots)[i].in[epoch & 1];
+        return result;
+    }
+
+    /** Called after a reader has left to wake up any writer waiting for the
+        readers to go.
+    */
+    void wakeWaiters()
+    {
+        if (waiters) {
+            __sync_fetch_and_add(&wakeups, 1);
+            futex_wake(wakeups);
+        }
+    }
+
+    /** Block until done() returns true.  It's checked again whenever a
+        reader leaves or the epoch moves on.
+    */
+    template<typename Fn>
+    void wait(Fn done)
+    {
+        for (;;) {
+            int wakeup = wakeups;
+            __sync_fetch_and_add(&waiters, 1);
+            bool finished = done();
+            if (!finished)
+                futex_wait(wakeups, wakeup);
+            __sync_fetch_and_add(&waiters, -1);
+            if (finished)
+                return;
+        }
+    }
+
+    Slot * slots;
+    unsigned numSlots;
+
+    /* These are only written when something waits for the readers or has
+       been deferred, so the line stays shared by the readers who check
+       them on the way out.
+    */
+    volatile int waiters;   ///< Writers waiting for the readers to leave
+    volatile int pending;   ///< Is there deferred work?
+    volatile int wakeups;   ///< Futex for the waiting writers
+    volatile int rescan;    ///< Someone missed the chance to advance
+    ML::Spinlock advanceLock;
+};
+
 std::string
 GcLockBase::ThreadGcInfoEntry::
 print() const
@@ -329,6 +528,8 @@ print() const
 
 GcLockBase::
 GcLockBase()
+    : epochs(0), reclaimer(0), maxDeferred(0), deferredCount(0),
+      deferOverflows(0)
 {
     deferred = new Deferred();
 }
@@ -336,6 +537,9 @@ GcLockBase()
 GcLockBase::
 ~GcLockBase()
 {
+    if (reclaimer)
+        reclaimer->waitFor(this);
+
     if (!deferred->empty()) {
         dump();
     }
@@ -385,7 +589,7 @@ updateData(Data & oldValue, Data & newValue, RunDefer runDefer)
 
 void
 GcLockBase::
-runDefers()
+runDefers(bool runInline)
 {
     std::vector<DeferredList *> toRun;
     {
@@ -393,12 +597,50 @@ runDefers()
         toRun = checkDefers();
     }
 
-    for (unsigned i = 0;  i < toRun.size();  ++i) {
-        toRun[i]->runAll();
-        delete toRun[i];
+    if (toRun.empty())
+        return;
+
+    if (reclaimer && !runInline)
+        reclaimer->enqueue(this, std::move(toRun));
+    else runDeferredLists(toRun);
+}
+
+void
+GcLockBase::
+runDeferredLists(const std::vector<DeferredList *> & lists)
+{
+    for (DeferredList * list: lists) {
+        int64_t size = list->size();
+        list->runAll();
+        delete list;
+        __sync_fetch_and_add(&deferredCount, -size);
     }
 }
 
+void
+GcLockBase::
+reclaimOverflow()
+{
+    __sync_fetch_and_add(&deferOverflows, 1);
+
+    // Nothing we deferred can become ready while we're in a critical section
+    if (getEntry().inEpoch == -1)
+        visibleBarrier();
+
+    runDefers(true /* runInline */);
+
+    if (reclaimer)
+        reclaimer->waitFor(this);
+}
+
+void
+GcLockBase::
+reclaimInBackground(size_t maxDeferred)
+{
+    this->maxDeferred = maxDeferred;
+    reclaimer = &Reclaimer::instance();
+}
+
 std::vector<GcLockBase::DeferredList *>
 GcLockBase::
 checkDefers()
@@ -428,9 +670,50 @@ checkDefers()
         }
     }
 
+    if (epochs)
+        epochs->pending = !deferred->entries.empty();
+
     return result;
 }
 
+void
+GcLockBase::
+advanceEpoch(RunDefer runDefer)
+{
+    bool advanced = false;
+
+    /* whoever holds the lock goes round again if anyone else wanted to
+       advance in the meantime, as its scan may have missed them leaving */
+    epochs->rescan = 1;
+    ML::memory_barrier();
+
+    while (epochs->rescan && epochs->advanceLock.try_lock()) {
+        epochs->rescan = 0;
+        ML::memory_barrier();
+
+        for (unsigned i = 0;  i < 2;  ++i) {
+            int32_t epoch = data->epoch;
+            if (epochs->readers(epoch - 1) != 0)
+                break;
+            data->epoch = epoch + 1;
+            ML::memory_barrier();
+            data->visibleEpoch = epoch - 1;
+            advanced = true;
+        }
+
+        epochs->advanceLock.unlock();
+        ML::memory_barrier();
+    }
+
+    if (!advanced)
+        return;
+
+    epochs->wakeWaiters();
+    futex_wake(data->visibleEpoch);
+    if (runDefer)
+        runDefers();
+}
+
 void
 GcLockBase::
 enterCS(ThreadGcInfoEntry * entry, RunDefer runDefer)
@@ -439,6 +722,29 @@ enterCS(ThreadGcInfoEntry * entry, RunDefer runDefer)
         
     ExcAssertEqual(entry->inEpoch, -1);
 
+    if (epochs) {
+        Epochs::Slot & slot = epochs->mySlot();
+
+        for (;;) {
+            int32_t epoch = data->epoch;
+            if (data->exclusive) {
+                futex_wait(data->exclusive, 1);
+                continue;
+            }
+
+            /* a writer that moved the epoch on or locked exclusively
+               without seeing us will be seen when we check again */
+            __sync_fetch_and_add(&slot.in[epoch & 1], 1);
+            if (data->epoch == epoch && !data->exclusive) {
+                entry->inEpoch = epoch & 1;
+                return;
+            }
+
+            __sync_fetch_and_add(&slot.in[epoch & 1], -1);
+            epochs->wakeWaiters();
+        }
+    }
+
 #if 0 // later...
     // Be optimistic...
     int optimisticEpoch = data->epoch;
@@ -488,6 +794,17 @@ exitCS(ThreadGcInfoEntry * entry, RunDefer runDefer /* = true */)
 
     ExcCheck(entry->inEpoch == 0 || entry->inEpoch == 1,
             "Invalid inEpoch");
+
+    if (epochs) {
+        __sync_fetch_and_add(&epochs->mySlot().in[entry->inEpoch], -1);
+        entry->inEpoch = -1;
+
+        epochs->wakeWaiters();
+        if (runDefer && epochs->pending)
+            advanceEpoch(runDefer);
+        return;
+    }
+
     // Fast path
     if (__sync_fetch_and_add(data->in + entry->inEpoch, -1) > 1) {
         entry->inEpoch = -1;
@@ -516,6 +833,24 @@ enterCSExclusive(ThreadGcInfoEntry * entry)
 {
     ExcAssertEqual(entry->inEpoch, -1);
 
+    if (epochs) {
+        for (;;) {
+            int old = 0;
+            if (ML::cmp_xchg(data->exclusive, old, 1))
+                break;
+            futex_wait(data->exclusive, 1);
+        }
+
+        // New readers now stay out; wait for the others to leave
+        epochs->wait([&] ()
+                     {
+                         return epochs->readers(0) + epochs->readers(1) == 0;
+                     });
+
+        entry->inEpoch = data->epoch & 1;
+        return;
+    }
+
     Data current = *data, newValue;
 
     for (;;) {
@@ -639,6 +974,18 @@ visibleBarrier()
         throw ML::Exception("visibleBarrier called in critical section will "
                             "deadlock");
 
+    if (epochs) {
+        // Everything that's visible now is gone two epochs from now
+        int32_t endEpoch = data->epoch + 2;
+        epochs->wait([&] ()
+                     {
+                         if (compareEpochs(data->epoch, endEpoch) < 0)
+                             advanceEpoch(RD_NO);
+                         return compareEpochs(data->epoch, endEpoch) >= 0;
+                     });
+        return;
+    }
+
     Data current = *data;
     int startEpoch = data->epoch;
     //int startVisible = data.visibleEpoch;
@@ -700,6 +1047,12 @@ deferBarrier()
         defer(futex_unlock, &lock);
         
         ML::atomic_add(lock, -1);
+
+        // Readers only move a ScalableGcLock on if they run deferred work
+        if (epochs) {
+            visibleBarrier();
+            runDefers();
+        }
         
         futex_wait(lock, -1);
     }
@@ -708,6 +1061,9 @@ deferBarrier()
     // then it's possible that not all deferred work will have been executed.
     // To be sure, we run any leftover work.
     runDefers();
+
+    if (reclaimer)
+        reclaimer->waitFor(this);
 }
 
 /** Helper function to call an arbitrary boost::function passed through with a void * */
@@ -751,6 +1107,35 @@ doDefer(void (fn) (Args...), Args... args)
     // If there are threads in the current epoch (irrespective of the old
     // epoch) then we need to wait until the current epoch is done.
 
+    if (epochs) {
+        // Anyone who could see what's being deferred is in the count now
+        ML::memory_barrier();
+
+        if (epochs->readers(0) + epochs->readers(1) == 0) {
+            fn(std::forward<Args>(args)...);
+            return;
+        }
+
+        {
+            boost::lock_guard<ML::Spinlock> guard(deferred->lock);
+
+            int32_t epoch = data->epoch;
+            DeferredList * & list = deferred->entries[epoch];
+            if (!list)
+                list = new DeferredList();
+            list->addDeferred(epoch, fn, std::forward<Args>(args)...);
+            __sync_fetch_and_add(&deferredCount, 1);
+            epochs->pending = 1;
+        }
+
+        // The readers may all have left before they could see pending
+        advanceEpoch(RD_YES);
+
+        if (JML_UNLIKELY(maxDeferred && deferredCount > maxDeferred))
+            reclaimOverflow();
+        return;
+    }
+
     Data current = *data;
 
     int32_t newestVisibleEpoch = current.epoch;
@@ -764,6 +1149,8 @@ doDefer(void (fn) (Args...), Args... args)
     }
 #endif
 
+    bool queued = false;
+
     for (int i = 0; i == 0; ++i) {
         // Lock the deferred structure
         boost::lock_guard<ML::Spinlock> guard(deferred->lock);
@@ -802,11 +1189,18 @@ doDefer(void (fn) (Args...), Args... args)
         
         DeferredList & list = *epochIt->second;
         list.addDeferred(newestVisibleEpoch, fn, std::forward<Args>(args)...);
+        __sync_fetch_and_add(&deferredCount, 1);
 
         // TODO: we only need to do this if the newestVisibleEpoch has
         // changed since we last calculated it...
         //checkDefers();
 
+        queued = true;
+    }
+
+    if (queued) {
+        if (JML_UNLIKELY(maxDeferred && deferredCount > maxDeferred))
+            reclaimOverflow();
         return;
     }
     
@@ -841,8 +1235,13 @@ GcLockBase::
 dump()
 {
     Data current = *data;
-    cerr << "epoch " << current.epoch << " in " << current.inCurrent()
-         << " in-1 " << current.inOld() << " vis " << current.visibleEpoch
+    int64_t in = current.inCurrent(), inOld = current.inOld();
+    if (epochs) {
+        in = epochs->readers(current.epoch);
+        inOld = epochs->readers(current.epoch - 1);
+    }
+    cerr << "epoch " << current.epoch << " in " << in
+         << " in-1 " << inOld << " vis " << current.visibleEpoch
          << " excl " << current.exclusive << endl;
     cerr << "deferred: ";
     {
@@ -883,6 +1282,36 @@ unlink()
 }
 
 
+/*****************************************************************************/
+/* SCALABLE GC LOCK                                                          */
+/*****************************************************************************/
+
+ScalableGcLock::
+ScalableGcLock()
+{
+    data = &localData;
+
+    // Deferred work waits for the epoch to move on twice
+    localData.visibleEpoch = localData.epoch - 2;
+
+    epochs = new Epochs();
+}
+
+ScalableGcLock::
+~ScalableGcLock()
+{
+    delete epochs;
+    epochs = 0;
+}
+
+void
+ScalableGcLock::
+unlink()
+{
+    // Nothing to cleanup.
+}
+
+
 /*****************************************************************************/
 /* SHARED GC LOCK                                                            */
 /*****************************************************************************/
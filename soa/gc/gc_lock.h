@@ -45,6 +45,12 @@
     Further details is available in the documentation of each respective
     operand.
 
+    GcLock and SharedGcLock keep all their state in a single 16 byte word
+    that is updated by every thread entering or leaving a critical section.
+    ScalableGcLock has the same interface but counts readers in per-thread
+    slots, so that readers on different cores don't share cache lines; see
+    its documentation for the trade-offs.
+
 */
 
 namespace Datacratic {
@@ -554,19 +560,57 @@ public:
         this->defer(bound);
     }
 
+    /** Run the deferred work of each closed epoch as one batch on a
+        background thread, shared by all the locks that ask for it, instead
+        of on whichever thread happened to close the epoch.
+
+        Once more than maxDeferred entries are waiting to run, defer() runs
+        the work that's ready itself, waiting first for the epoch to close
+        if it isn't in a critical section, and then for the background
+        thread to catch up.  That keeps the memory held by deferred work
+        bounded when it's produced faster than it can be reclaimed.
+    */
+    void reclaimInBackground(size_t maxDeferred = 65536);
+
+    /** Number of deferred entries that haven't been run yet. */
+    size_t numDeferred() const
+    {
+        return deferredCount;
+    }
+
+    /** Number of times defer() found more than maxDeferred entries waiting
+        and had to run them itself.
+    */
+    uint64_t numDeferOverflows() const
+    {
+        return deferOverflows;
+    }
+
     void dump();
 
 protected:
     Data* data;
 
+    /** Reader counts of a ScalableGcLock; null for the other locks, which
+        count their readers in data.
+    */
+    struct Epochs;
+    Epochs * epochs;
+
 private:
     struct Deferred;
     struct DeferredList;
+    struct Reclaimer;
 
     GcInfo gcInfo;
 
     Deferred * deferred;   ///< Deferred workloads (hidden structure)
 
+    Reclaimer * reclaimer; ///< Runs our deferred work if not null
+    size_t maxDeferred;    ///< Entries that may wait before defer() helps
+    volatile int64_t deferredCount;
+    volatile uint64_t deferOverflows;
+
     /** Update with the new value after first checking that the current
         value is the same as the old value.  Returns true if it
         succeeded; otherwise oldValue is updated with the new old
@@ -579,8 +623,24 @@ private:
     */
     bool updateData(Data & oldValue, Data & newValue, RunDefer runDefer);
 
-    /** Executes any available deferred work. */
-    void runDefers();
+    /** Executes any available deferred work, or hands it to the
+        reclaimer if there is one and runInline is false.
+    */
+    void runDefers(bool runInline = false);
+
+    /** Run deferred work from the calling thread until no more than
+        maxDeferred entries are waiting.
+    */
+    void reclaimOverflow();
+
+    /** Run the given deferred work and account for it. */
+    void runDeferredLists(const std::vector<DeferredList *> & lists);
+
+    /** Move the epoch of a ScalableGcLock forward as far as the readers
+        allow, which is at most twice, and run the deferred work that it
+        made safe to run.
+    */
+    void advanceEpoch(RunDefer runDefer);
 
     /** Check what deferred updates need to be run and do them.  Must be
         called with deferred locked.
@@ -609,6 +669,38 @@ private:
 };
 
 
+/*****************************************************************************/
+/* SCALABLE GC LOCK                                                          */
+/*****************************************************************************/
+
+/** GcLock for use within a single process, for locks whose critical
+    sections are entered by many threads at once.
+
+    Each thread is given one of a set of cache line sized slots, at least as
+    many as there are cores, and counts itself in there under the parity of
+    the epoch it entered.  The epoch only moves forward when a writer (which
+    includes a reader leaving while there is deferred work) has summed the
+    slots and found that nothing is left in the previous epoch.  Deferred
+    work registered in an epoch runs once the epoch has moved on twice.
+
+    Entering and leaving is cheaper and scales with the number of threads;
+    defer(), the barriers and exclusive locking cost a scan of the slots.
+*/
+
+struct ScalableGcLock : public GcLockBase
+{
+    ScalableGcLock();
+    virtual ~ScalableGcLock();
+
+    virtual void unlink();
+
+private:
+
+    Data localData;
+
+};
+
+
 /*****************************************************************************/
 /* SHARED GC LOCK                                                            */
 /*****************************************************************************/
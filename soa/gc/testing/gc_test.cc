@@ -64,6 +64,75 @@ BOOST_AUTO_TEST_CASE ( test_gc )
     BOOST_CHECK(deferred);
 }
 
+BOOST_AUTO_TEST_CASE ( test_scalable_gc )
+{
+    ScalableGcLock gc;
+    gc.lockShared();
+
+    BOOST_CHECK(gc.isLockedShared());
+
+    bool deferred = false;
+
+    gc.defer([&] () { deferred = true; memory_barrier(); });
+
+    BOOST_CHECK(!deferred);
+
+    gc.unlockShared();
+
+    BOOST_CHECK(!gc.isLockedShared());
+    BOOST_CHECK(deferred);
+
+    /* nothing is in a critical section so it runs straight away */
+    deferred = false;
+    gc.defer([&] () { deferred = true; memory_barrier(); });
+    BOOST_CHECK(deferred);
+}
+
+BOOST_AUTO_TEST_CASE ( test_scalable_gc_mutual_exclusion )
+{
+    ScalableGcLock lock;
+    volatile bool finished = false;
+    volatile int numExclusive = 0;
+    volatile int numShared = 0;
+    int errors = 0;
+    uint64_t exclusiveIterations = 0;
+
+    auto sharedThread = [&] ()
+        {
+            while (!finished) {
+                GcLockBase::SharedGuard guard(lock);
+                ML::atomic_inc(numShared);
+                if (numExclusive > 0)
+                    ML::atomic_inc(errors);
+                ML::atomic_dec(numShared);
+            }
+        };
+
+    auto exclusiveThread = [&] ()
+        {
+            while (!finished) {
+                GcLockBase::ExclusiveGuard guard(lock);
+                ML::atomic_inc(numExclusive);
+                if (numExclusive > 1 || numShared > 0)
+                    ML::atomic_inc(errors);
+                ML::atomic_dec(numExclusive);
+                ML::atomic_inc(exclusiveIterations);
+            }
+        };
+
+    boost::thread_group tg;
+    for (unsigned i = 0;  i < 4;  ++i)
+        tg.create_thread(sharedThread);
+    for (unsigned i = 0;  i < 2;  ++i)
+        tg.create_thread(exclusiveThread);
+    sleep(1);
+    finished = true;
+    tg.join_all();
+
+    BOOST_CHECK_EQUAL(errors, 0);
+    BOOST_CHECK_GT(exclusiveIterations, 0);
+}
+
 BOOST_AUTO_TEST_CASE(test_mutual_exclusion)
 {
     cerr << "testing mutual exclusion" << endl;
@@ -648,6 +717,66 @@ BOOST_AUTO_TEST_CASE ( test_gc_deferred )
 }
 
 
+BOOST_AUTO_TEST_CASE ( test_scalable_gc_sync )
+{
+    cerr << "testing synchronized ScalableGcLock" << endl;
+
+    int nthreads = 8;
+    int nSpinThreads = 16;
+    int nblocks = 2;
+
+    TestBase<ScalableGcLock> test(nthreads, nblocks, nSpinThreads);
+    test.run(boost::bind(&TestBase<ScalableGcLock>::allocThreadSync,
+                         &test, _1));
+}
+
+BOOST_AUTO_TEST_CASE ( test_scalable_gc_deferred )
+{
+    cerr << "testing deferred ScalableGcLock" << endl;
+
+    int nthreads = 8;
+    int nblocks = 2;
+
+    TestBase<ScalableGcLock> test(nthreads, nblocks);
+    test.run(boost::bind(&TestBase<ScalableGcLock>::allocThreadDefer,
+                         &test, _1));
+}
+
+
+BOOST_AUTO_TEST_CASE ( test_gc_reclaim_in_background )
+{
+    cerr << "testing deferred GcLock reclaimed in the background" << endl;
+
+    int nthreads = 8;
+    int nblocks = 2;
+
+    TestBase<GcLock> test(nthreads, nblocks);
+    test.gc.reclaimInBackground(1024);
+    test.run(boost::bind(&TestBase<GcLock>::allocThreadDefer, &test, _1));
+
+    BOOST_CHECK_EQUAL(test.gc.numDeferred(), 0);
+    cerr << "overflows " << test.gc.numDeferOverflows() << endl;
+}
+
+BOOST_AUTO_TEST_CASE ( test_scalable_gc_reclaim_in_background )
+{
+    cerr << "testing deferred ScalableGcLock reclaimed in the background"
+         << endl;
+
+    int nthreads = 8;
+    int nblocks = 2;
+
+    TestBase<ScalableGcLock> test(nthreads, nblocks);
+    test.gc.reclaimInBackground(1024);
+    test.run(boost::bind(&TestBase<ScalableGcLock>::allocThreadDefer,
+                         &test, _1));
+
+    BOOST_CHECK_EQUAL(test.gc.numDeferred(), 0);
+    BOOST_CHECK_LE(test.allocator.highestAlloc, 1024 * 4 * (nthreads + 1));
+    cerr << "overflows " << test.gc.numDeferOverflows() << endl;
+}
+
+
 struct SharedGcLockProxy : public SharedGcLock {
     static const char* name;
     SharedGcLockProxy() :
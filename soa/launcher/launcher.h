@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <set>
 #include <string>
 #include <vector>
 #include <sys/prctl.h>
@@ -23,8 +25,10 @@
 #include "jml/arch/timers.h"
 #include "jml/utils/ring_buffer.h"
 #include "soa/jsoncpp/json.h"
+#include "soa/types/date.h"
 #include "soa/service/service_base.h"
 #include "soa/service/message_loop.h"
+#include "soa/service/thread_placement.h"
 #include "soa/service/typed_message_channel.h"
 #include "soa/service/logs.h"
 
@@ -37,20 +41,56 @@ struct Launcher
 {
     struct Task
     {
-        Task() : pid(-1), log(false), delay(45.0), once(false) {
+        Task() : pid(-1), log(false), delay(45.0), once(false), readyTimeout(60.0) {
         }
 
         std::string const & getName() const {
             return name;
         }
 
+        // Names of the tasks that must be ready before this one is launched.
+        // Children implicitly come after their parent.
+        std::vector<std::string> const & getAfter() const {
+            return after;
+        }
+
         void launch(std::string const & node) {
             spawn(node);
+            launched = Date::now();
+        }
+
+        // Adds this task and its children to the list of tasks to launch.
+        void collect(std::vector<Task *> & tasks, std::string const & parent = "") {
+            if(!parent.empty() && std::find(after.begin(), after.end(), parent) == after.end()) {
+                after.push_back(parent);
+            }
+
+            tasks.push_back(this);
             for(auto & item : children) {
-                item.launch(node);
+                item.collect(tasks, name);
             }
         }
 
+        // A launched task is ready once its 'ready' command succeeds, right
+        // away if it doesn't have one.
+        bool isReady() {
+            if(ready.empty()) {
+                return true;
+            }
+
+            std::string command = "cd '" + root + "' && " + ready + " >/dev/null 2>&1";
+            if(system(command.c_str()) == 0) {
+                return true;
+            }
+
+            if(Date::now().secondsSince(launched) > readyTimeout) {
+                LOG(launcherError) << name << " still not ready after " << readyTimeout << "s, launching its dependents anyway" << std::endl;
+                return true;
+            }
+
+            return false;
+        }
+
         void restart(std::string const & node) {
             if (!once) {
                 stop();
@@ -155,6 +195,25 @@ struct Launcher
                 else if(i.memberName() == "once") {
                     result.once = i->asBool();
                 }
+                else if(i.memberName() == "after") {
+                    auto & json = *i;
+                    if(!json.empty() && !json.isArray()) {
+                        THROW(launcherError) << "'after' is not an array" << std::endl;
+                    }
+
+                    for(auto j = json.begin(), end = json.end(); j != end; ++j) {
+                        result.after.push_back(j->asString());
+                    }
+                }
+                else if(i.memberName() == "ready") {
+                    result.ready = i->asString();
+                }
+                else if(i.memberName() == "readyTimeout") {
+                    result.readyTimeout = i->asDouble();
+                }
+                else if(i.memberName() == "cpus") {
+                    result.cpus = parseCpuList(i->asString());
+                }
                 else if(i.memberName() == "arg") {
                     auto & json = *i;
                     if(!json.empty() && !json.isArray()) {
@@ -231,6 +290,11 @@ struct Launcher
                     redirect();
                 }
 
+                // The whole process and all its threads start out there
+                if(!cpus.empty()) {
+                    pinCurrentThread(cpus);
+                }
+
                 res = chdir(root.c_str());
                 if(res == -1) {
                     THROW(launcherError) << "chdir failed errno=" << errno << std::endl;
@@ -281,6 +345,11 @@ struct Launcher
         bool log;
         double delay;
         bool once;
+        std::vector<int> cpus;
+        std::vector<std::string> after;
+        std::string ready;
+        double readyTimeout;
+        Date launched;
     };
 
     struct Node
@@ -300,9 +369,72 @@ struct Launcher
             return 0;
         }
 
+        // Launches every task whose dependencies are ready at once, then the
+        // ones that were waiting on them as they become ready.
         void launch() {
+            std::vector<Task *> pending;
             for(auto & item : tasks) {
-                item.launch(name);
+                item.collect(pending);
+            }
+
+            std::set<std::string> names;
+            for(auto item : pending) {
+                names.insert(item->getName());
+            }
+
+            for(auto item : pending) {
+                for(auto & dependency : item->getAfter()) {
+                    if(!names.count(dependency)) {
+                        THROW(launcherError) << "task '" << item->getName() << "' comes after unknown task '" << dependency << "'" << std::endl;
+                    }
+                }
+            }
+
+            std::set<std::string> ready;
+            std::vector<Task *> starting;
+
+            while(!pending.empty()) {
+                auto isLaunchable = [&](Task * item) {
+                    for(auto & dependency : item->getAfter()) {
+                        if(!ready.count(dependency)) {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                };
+
+                auto it = std::stable_partition(pending.begin(), pending.end(), [&](Task * item) {
+                    return !isLaunchable(item);
+                });
+
+                bool launchedAny = it != pending.end();
+                for(auto i = it; i != pending.end(); ++i) {
+                    (*i)->launch(name);
+                    starting.push_back(*i);
+                }
+
+                pending.erase(it, pending.end());
+
+                bool readied = false;
+                for(auto i = starting.begin(); i != starting.end();) {
+                    if((*i)->isReady()) {
+                        ready.insert((*i)->getName());
+                        i = starting.erase(i);
+                        readied = true;
+                    }
+                    else {
+                        ++i;
+                    }
+                }
+
+                if(!launchedAny && !readied && starting.empty() && !pending.empty()) {
+                    THROW(launcherError) << "circular dependency between the tasks of node " << name << std::endl;
+                }
+
+                if(!pending.empty() && !readied) {
+                    ML::sleep(0.1);
+                }
             }
         }
 
@@ -0,0 +1,475 @@
+/* columnar_output.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Binary log format that stores the messages of each channel by column.
+*/
+
+#include "columnar_output.h"
+#include "jml/db/persistent.h"
+#include "jml/utils/lz4.h"
+#include "jml/utils/exc_assert.h"
+#include "jml/utils/exc_check.h"
+#include <boost/algorithm/string.hpp>
+#include <sstream>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace Datacratic {
+
+
+namespace {
+
+const uint32_t ChunkMagic = 0x43425452;   // "RTBC"
+const unsigned char ChunkVersion = 1;
+
+void appendCompact(std::string & out, unsigned long long value)
+{
+    char buf[16];
+    char * pos = buf;
+    DB::encode_compact(pos, buf + sizeof(buf), value);
+    out.append(buf, pos);
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* COLUMNAR CHUNK                                                            */
+/*****************************************************************************/
+
+ColumnarChunk::
+ColumnarChunk()
+    : numRows(0)
+{
+}
+
+int
+ColumnarChunk::
+columnIndex(const std::string & name) const
+{
+    for (unsigned i = 0;  i < columnNames.size();  ++i)
+        if (columnNames[i] == name)
+            return i;
+    return -1;
+}
+
+const std::vector<std::string> &
+ColumnarChunk::
+column(size_t index) const
+{
+    ExcAssertLess(index, columns.size());
+
+    const Column & column = columns[index];
+    if (!column.decoded)
+        decodeColumn(column);
+    return column.values;
+}
+
+std::string
+ColumnarChunk::
+message(size_t row) const
+{
+    ExcAssertLess(row, numRows);
+
+    std::string result;
+    for (unsigned i = 0;  i < columns.size();  ++i) {
+        if (i > 0) result += '\t';
+        result += column(i)[row];
+    }
+    return result;
+}
+
+std::string
+ColumnarChunk::
+encodeColumn(const std::vector<std::string> & values, int & encoding)
+{
+    std::string result;
+
+    // Dictionary when there are few enough distinct values
+    std::unordered_map<std::string, size_t> index;
+    std::vector<const std::string *> distinct;
+    std::vector<size_t> indexes;
+    indexes.reserve(values.size());
+
+    bool useDictionary = true;
+    for (auto & value: values) {
+        auto res = index.insert(make_pair(value, distinct.size()));
+        if (res.second) {
+            distinct.push_back(&res.first->first);
+            if (distinct.size() * 4 > values.size() && distinct.size() > 1) {
+                useDictionary = false;
+                break;
+            }
+        }
+        indexes.push_back(res.first->second);
+    }
+
+    if (useDictionary) {
+        encoding = ENC_DICTIONARY;
+        appendCompact(result, distinct.size());
+        for (auto value: distinct) {
+            appendCompact(result, value->size());
+            result += *value;
+        }
+        for (size_t i: indexes)
+            appendCompact(result, i);
+        return result;
+    }
+
+    encoding = ENC_PREFIX;
+    const std::string * previous = nullptr;
+    for (auto & value: values) {
+        size_t prefix = 0;
+        if (previous) {
+            size_t maxPrefix = std::min(value.size(), previous->size());
+            while (prefix < maxPrefix && value[prefix] == (*previous)[prefix])
+                ++prefix;
+        }
+
+        appendCompact(result, prefix);
+        appendCompact(result, value.size() - prefix);
+        result.append(value, prefix, string::npos);
+        previous = &value;
+    }
+
+    return result;
+}
+
+void
+ColumnarChunk::
+decodeColumn(const Column & column) const
+{
+    std::string uncompressed;
+    const std::string * raw = &column.data;
+
+    if (column.compressed) {
+        uncompressed.resize(column.rawSize);
+        int size = LZ4_decompress_safe(column.data.data(), &uncompressed[0],
+                                       column.data.size(), column.rawSize);
+        if (size < 0 || size_t(size) != column.rawSize)
+            throw ML::Exception("corrupted column in chunk of " + channel);
+        raw = &uncompressed;
+    }
+
+    const char * pos = raw->data();
+    const char * end = pos + raw->size();
+
+    auto readString = [&] (size_t length)
+        {
+            if (length > size_t(end - pos))
+                throw ML::Exception("truncated column in chunk of "
+                                    + channel);
+            std::string result(pos, length);
+            pos += length;
+            return result;
+        };
+
+    std::vector<std::string> values;
+    values.reserve(numRows);
+
+    switch (column.encoding) {
+    case ENC_DICTIONARY: {
+        std::vector<std::string> distinct(DB::decode_compact(pos, end));
+        for (auto & value: distinct)
+            value = readString(DB::decode_compact(pos, end));
+
+        for (size_t i = 0;  i < numRows;  ++i) {
+            size_t index = DB::decode_compact(pos, end);
+            ExcCheckLess(index, distinct.size(), "bad dictionary index");
+            values.push_back(distinct[index]);
+        }
+        break;
+    }
+
+    case ENC_PREFIX:
+        for (size_t i = 0;  i < numRows;  ++i) {
+            size_t prefix = DB::decode_compact(pos, end);
+            size_t length = DB::decode_compact(pos, end);
+            std::string value = i == 0 ? "" : values.back().substr(0, prefix);
+            value += readString(length);
+            values.push_back(std::move(value));
+        }
+        break;
+
+    default:
+        throw ML::Exception("unknown column encoding %d", column.encoding);
+    }
+
+    column.values.swap(values);
+    column.decoded = true;
+}
+
+std::string
+ColumnarChunk::
+encode(const std::string & channel,
+       const std::vector<std::string> & columnNames,
+       const std::vector<std::vector<std::string> > & columns)
+{
+    ExcAssertEqual(columnNames.size(), columns.size());
+    size_t numRows = columns.empty() ? 0 : columns[0].size();
+
+    std::ostringstream stream;
+
+    {
+        DB::Store_Writer store(stream);
+        store << ChunkVersion << channel
+              << DB::compact_size_t(numRows)
+              << DB::compact_size_t(columns.size());
+
+        for (unsigned i = 0;  i < columns.size();  ++i) {
+            ExcAssertEqual(columns[i].size(), numRows);
+
+            int encoding;
+            std::string raw = encodeColumn(columns[i], encoding);
+
+            std::string compressed(LZ4_compressBound(raw.size()), '\0');
+            int size = LZ4_compress(raw.data(), &compressed[0], raw.size());
+            bool isCompressed = size > 0 && size_t(size) < raw.size();
+            if (isCompressed)
+                compressed.resize(size);
+
+            store << columnNames[i]
+                  << DB::compact_size_t(encoding)
+                  << isCompressed
+                  << DB::compact_size_t(raw.size())
+                  << (isCompressed ? compressed : raw);
+        }
+    }
+
+    std::string body = stream.str();
+    uint32_t header[2] = { ChunkMagic, uint32_t(body.size()) };
+
+    std::string result((const char *)header, sizeof(header));
+    result += body;
+    return result;
+}
+
+bool
+ColumnarChunk::
+read(std::istream & stream)
+{
+    uint32_t header[2];
+    stream.read((char *)header, sizeof(header));
+    if (stream.gcount() == 0 && stream.eof())
+        return false;
+    if (!stream || header[0] != ChunkMagic)
+        throw ML::Exception("not a columnar log chunk");
+
+    std::string body(header[1], '\0');
+    stream.read(&body[0], body.size());
+    if (!stream)
+        throw ML::Exception("truncated columnar log chunk");
+
+    DB::Store_Reader store(body.data(), body.size());
+
+    unsigned char version;
+    store >> version;
+    if (version != ChunkVersion)
+        throw ML::Exception("unknown columnar log version %d", version);
+
+    store >> channel;
+    numRows = DB::compact_size_t(store);
+
+    size_t numColumns = DB::compact_size_t(store);
+    columnNames.resize(numColumns);
+    columns.clear();
+    columns.resize(numColumns);
+
+    for (unsigned i = 0;  i < numColumns;  ++i) {
+        Column & column = columns[i];
+        store >> columnNames[i];
+        column.encoding = DB::compact_size_t(store);
+        store >> column.compressed;
+        column.rawSize = DB::compact_size_t(store);
+        store >> column.data;
+    }
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/* COLUMNAR OUTPUT                                                           */
+/*****************************************************************************/
+
+ColumnarOutput::
+ColumnarOutput(const std::string & filename, size_t rowsPerChunk)
+    : rowsPerChunk(rowsPerChunk), isOpen(false),
+      bytesIn(0), bytesOut(0), chunksWritten(0)
+{
+    ExcAssertGreater(rowsPerChunk, 0);
+
+    if (!filename.empty())
+        open(filename);
+}
+
+ColumnarOutput::
+~ColumnarOutput()
+{
+    close();
+}
+
+void
+ColumnarOutput::
+open(const std::string & filename)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    if (isOpen)
+        throw ML::Exception("columnar output is already open");
+
+    stream.open(filename);
+    isOpen = true;
+}
+
+void
+ColumnarOutput::
+setColumnNames(const std::string & channel,
+               const std::vector<std::string> & names)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    columnNames[channel] = names;
+}
+
+void
+ColumnarOutput::
+logMessage(const std::string & channel,
+           const std::string & message)
+{
+    std::vector<std::string> fields;
+    boost::split(fields, message, boost::is_any_of("\t"));
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    if (!isOpen)
+        throw ML::Exception("columnar output is not open");
+
+    Pending & entry = pending[channel];
+
+    // Every message of a chunk has the same fields
+    if (entry.numRows && entry.columns.size() != fields.size())
+        writeChunk(channel, entry);
+
+    if (!entry.numRows)
+        entry.columns.resize(fields.size());
+
+    for (unsigned i = 0;  i < fields.size();  ++i)
+        entry.columns[i].emplace_back(std::move(fields[i]));
+    ++entry.numRows;
+    bytesIn += channel.size() + message.size() + 2;
+
+    if (entry.numRows >= rowsPerChunk)
+        writeChunk(channel, entry);
+}
+
+void
+ColumnarOutput::
+writeChunk(const std::string & channel, Pending & entry)
+{
+    std::vector<std::string> names = columnNames[channel];
+    names.resize(entry.columns.size());
+    for (unsigned i = 0;  i < names.size();  ++i)
+        if (names[i].empty())
+            names[i] = std::to_string(i);
+
+    std::string chunk = ColumnarChunk::encode(channel, names, entry.columns);
+    stream.write(chunk.data(), chunk.size());
+
+    bytesOut += chunk.size();
+    ++chunksWritten;
+
+    entry.columns.clear();
+    entry.numRows = 0;
+}
+
+void
+ColumnarOutput::
+flush()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    for (auto & entry: pending)
+        if (entry.second.numRows)
+            writeChunk(entry.first, entry.second);
+
+    stream.flush();
+}
+
+void
+ColumnarOutput::
+close()
+{
+    if (!isOpen)
+        return;
+
+    flush();
+
+    std::unique_lock<std::mutex> guard(lock);
+    stream.close();
+    isOpen = false;
+}
+
+Json::Value
+ColumnarOutput::
+stats() const
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    Json::Value result;
+    result["bytesIn"] = (Json::UInt)bytesIn;
+    result["bytesOut"] = (Json::UInt)bytesOut;
+    result["chunks"] = (Json::UInt)chunksWritten;
+    return result;
+}
+
+void
+ColumnarOutput::
+clearStats()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    bytesIn = bytesOut = chunksWritten = 0;
+}
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG READER                                                       */
+/*****************************************************************************/
+
+ColumnarLogReader::
+ColumnarLogReader(const std::string & filename)
+    : stream(filename)
+{
+}
+
+bool
+ColumnarLogReader::
+next(ColumnarChunk & chunk)
+{
+    return chunk.read(stream);
+}
+
+size_t
+ColumnarLogReader::
+forEachMessage(const std::string & filename,
+               const std::function<void (const std::string & channel,
+                                         const std::string & message)>
+                   & onMessage)
+{
+    ColumnarLogReader reader(filename);
+    ColumnarChunk chunk;
+    size_t result = 0;
+
+    while (reader.next(chunk)) {
+        for (size_t i = 0;  i < chunk.numRows;  ++i)
+            onMessage(chunk.channel, chunk.message(i));
+        result += chunk.numRows;
+    }
+
+    return result;
+}
+
+} // namespace Datacratic
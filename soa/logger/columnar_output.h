@@ -0,0 +1,202 @@
+/* columnar_output.h                                               -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Binary log format that stores the messages of each channel by column.
+*/
+
+#ifndef __logger__columnar_output_h__
+#define __logger__columnar_output_h__
+
+#include "logger.h"
+#include "jml/utils/filter_streams.h"
+#include <unordered_map>
+#include <mutex>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* COLUMNAR CHUNK                                                            */
+/*****************************************************************************/
+
+/** A chunk of a columnar log: up to a few thousand messages of a single
+    channel, all with the same number of fields, stored field by field.
+
+    Each column is encoded on its own, with a dictionary when it has few
+    distinct values (agents, accounts, exchanges) and otherwise with the
+    prefix it shares with the previous value (timestamps, ids), and then
+    compressed with lz4.  A reader only pays for decoding the columns that
+    it looks at.
+
+    On disk a chunk is a 32 bit magic number and length followed by the
+    chunk serialized with the jml/db archives.
+*/
+
+struct ColumnarChunk {
+
+    ColumnarChunk();
+
+    std::string channel;
+    size_t numRows;
+
+    /** Names of the columns, which are the fields of the messages in
+        order.  Those that weren't named are called by their index.
+    */
+    std::vector<std::string> columnNames;
+
+    size_t numColumns() const { return columns.size(); }
+
+    /** Returns the index of the named column, or -1 if there is none. */
+    int columnIndex(const std::string & name) const;
+
+    /** Returns the values of the given column, which are decoded the
+        first time that they are asked for.
+    */
+    const std::vector<std::string> & column(size_t index) const;
+
+    /** Returns the message at the given row as the logger got it, with the
+        fields separated by tabs.
+    */
+    std::string message(size_t row) const;
+
+    /** Encodes the given columns, which all have numRows values, into a
+        chunk ready to be written.
+    */
+    static std::string
+    encode(const std::string & channel,
+           const std::vector<std::string> & columnNames,
+           const std::vector<std::vector<std::string> > & columns);
+
+    /** Reads a chunk written by encode() from the stream.  Returns false
+        at the end of the stream.
+    */
+    bool read(std::istream & stream);
+
+private:
+    enum Encoding {
+        ENC_DICTIONARY = 0,  ///< Distinct values then an index per row
+        ENC_PREFIX = 1       ///< Prefix shared with the previous value
+    };
+
+    struct Column {
+        Column()
+            : encoding(ENC_PREFIX), compressed(false), rawSize(0),
+              decoded(false)
+        {
+        }
+
+        int encoding;
+        bool compressed;
+        size_t rawSize;           ///< Size of the data once uncompressed
+        std::string data;
+        mutable std::vector<std::string> values;
+        mutable bool decoded;
+    };
+
+    std::vector<Column> columns;
+
+    static std::string encodeColumn(const std::vector<std::string> & values,
+                                    int & encoding);
+    void decodeColumn(const Column & column) const;
+};
+
+
+/*****************************************************************************/
+/* COLUMNAR OUTPUT                                                           */
+/*****************************************************************************/
+
+/** LogOutput that writes the messages into a file of ColumnarChunks.  The
+    messages are gathered per channel and written out once rowsPerChunk of
+    them are there, or when the output is flushed or closed.
+
+    The file name can end in .gz, .xz or .lz4 like for filter_ostream,
+    although the columns are already compressed.
+*/
+
+struct ColumnarOutput : public LogOutput {
+
+    ColumnarOutput(const std::string & filename = "",
+                   size_t rowsPerChunk = 8192);
+
+    virtual ~ColumnarOutput();
+
+    void open(const std::string & filename);
+
+    /** Names the fields of the messages of the given channel.  Must be
+        called before any message is logged to that channel.
+    */
+    void setColumnNames(const std::string & channel,
+                        const std::vector<std::string> & names);
+
+    virtual void logMessage(const std::string & channel,
+                            const std::string & message);
+
+    /** Writes the messages that are waiting for their chunk to fill up. */
+    void flush();
+
+    virtual void close();
+
+    virtual Json::Value stats() const;
+
+    virtual void clearStats();
+
+private:
+    struct Pending {
+        Pending()
+            : numRows(0)
+        {
+        }
+
+        size_t numRows;
+        std::vector<std::vector<std::string> > columns;
+    };
+
+    void writeChunk(const std::string & channel, Pending & pending);
+
+    size_t rowsPerChunk;
+    ML::filter_ostream stream;
+    bool isOpen;
+
+    mutable std::mutex lock;
+    std::unordered_map<std::string, Pending> pending;
+    std::unordered_map<std::string, std::vector<std::string> > columnNames;
+
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t chunksWritten;
+};
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG READER                                                       */
+/*****************************************************************************/
+
+/** Reads the chunks of a file written by ColumnarOutput one at a time. */
+
+struct ColumnarLogReader {
+
+    ColumnarLogReader(const std::string & filename);
+
+    /** Reads the next chunk.  Returns false at the end of the file. */
+    bool next(ColumnarChunk & chunk);
+
+    /** Calls the function with each of the messages of the file, chunk by
+        chunk.  Returns the number of messages.
+    */
+    static size_t
+    forEachMessage(const std::string & filename,
+                   const std::function<void (const std::string & channel,
+                                             const std::string & message)>
+                       & onMessage);
+
+private:
+    ML::filter_istream stream;
+};
+
+
+} // namespace Datacratic
+
+
+#endif /* __logger__columnar_output_h__ */
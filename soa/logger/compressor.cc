@@ -7,8 +7,14 @@
 
 #include "compressor.h"
 #include "jml/utils/exc_assert.h"
+#include "jml/utils/lz4_filter.h"
+#include <boost/lexical_cast.hpp>
 #include <zlib.h>
 #include <iostream>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
@@ -33,6 +39,16 @@ bool ends_with(const std::string & str, const std::string & what)
         && result == str.size() - what.size();
 }
 
+/** Passes all of the data to onData, which may take it in pieces. */
+size_t writeAll(const char * data, size_t len,
+                const Compressor::OnData & onData)
+{
+    size_t done = 0;
+    while (done < len)
+        done += onData(data + done, len - done);
+    return done;
+}
+
 } // file scope
 
 std::string
@@ -45,6 +61,8 @@ filenameToCompression(const std::string & filename)
         return "bzip2";
     if (ends_with(filename, ".xz") || ends_with(filename, ".xz~"))
         return "lzma";
+    if (ends_with(filename, ".lz4") || ends_with(filename, ".lz4~"))
+        return "lz4";
     return "none";
 }
 
@@ -57,8 +75,23 @@ create(const std::string & compression,
         return new GzipCompressor(level);
     else if (compression == "" || compression == "none")
         return new NullCompressor();
-    else throw ML::Exception("unknown compression %s:%d", compression.c_str(),
-                             level);
+    else if (compression == "lz4")
+        return new Lz4Compressor(level);
+
+    // Compressed on a pool of threads, as in "gzip:4"
+    string::size_type pos = compression.find(':');
+    if (pos != string::npos) {
+        string scheme(compression, 0, pos);
+        int numThreads = boost::lexical_cast<int>(compression.substr(pos + 1));
+
+        if (scheme == "gzip" || scheme == "gz")
+            return ParallelCompressor::gzip(level, numThreads);
+        else if (scheme == "lz4")
+            return ParallelCompressor::lz4(level, numThreads);
+    }
+
+    throw ML::Exception("unknown compression %s:%d", compression.c_str(),
+                        level);
 }
 
 
@@ -246,4 +279,427 @@ finish(const OnData & onData)
 /* LZMA COMPRESSOR                                                           */
 /*****************************************************************************/
 
+
+/*****************************************************************************/
+/* LZ4 COMPRESSOR                                                            */
+/*****************************************************************************/
+
+namespace {
+
+ML::lz4::Header lz4Header(int blockSizeId)
+{
+    return ML::lz4::Header(blockSizeId, true /* independent blocks */,
+                           true /* block checksums */, false);
+}
+
+} // file scope
+
+struct Lz4Compressor::Itl {
+
+    Itl(int level, int blockSizeId)
+        : head(lz4Header(blockSizeId)), level(level), headerWritten(false)
+    {
+        current.reserve(head.blockSize());
+    }
+
+    ML::lz4::Header head;
+    int level;
+    bool headerWritten;
+    std::string current;   ///< Block being filled
+
+    size_t writeHeader(const OnData & onData)
+    {
+        if (headerWritten)
+            return 0;
+        headerWritten = true;
+        return writeAll((const char *)&head, sizeof(head), onData);
+    }
+
+    size_t writeBlock(const OnData & onData)
+    {
+        size_t result = writeHeader(onData);
+
+        std::string block = encodeBlock(current.data(), current.size(), level);
+        result += writeAll(block.data(), block.size(), onData);
+        current.clear();
+
+        return result;
+    }
+
+    size_t compress(const char * data, size_t len, const OnData & onData)
+    {
+        size_t result = 0;
+
+        while (len) {
+            size_t toCopy = std::min(len, head.blockSize() - current.size());
+            current.append(data, toCopy);
+            data += toCopy;
+            len -= toCopy;
+
+            if (current.size() == head.blockSize())
+                result += writeBlock(onData);
+        }
+
+        return result;
+    }
+
+    size_t flush(FlushLevel flushLevel, const OnData & onData)
+    {
+        switch (flushLevel) {
+        case FLUSH_NONE:
+        case FLUSH_AVAILABLE:
+            return 0;
+        case FLUSH_SYNC:
+        case FLUSH_RESTART:
+            return current.empty() ? 0 : writeBlock(onData);
+        default:
+            throw ML::Exception("bad flush level");
+        }
+    }
+
+    size_t finish(const OnData & onData)
+    {
+        size_t result = flush(FLUSH_RESTART, onData);
+        result += writeHeader(onData);
+
+        uint32_t endMark = 0;
+        result += writeAll((const char *)&endMark, sizeof(endMark), onData);
+        return result;
+    }
+};
+
+Lz4Compressor::
+Lz4Compressor(int level, int blockSizeId)
+    : itl(new Itl(level, blockSizeId))
+{
+}
+
+Lz4Compressor::
+~Lz4Compressor()
+{
+}
+
+size_t
+Lz4Compressor::
+compress(const char * data, size_t len, const OnData & onData)
+{
+    return itl->compress(data, len, onData);
+}
+    
+size_t
+Lz4Compressor::
+flush(FlushLevel flushLevel, const OnData & onData)
+{
+    return itl->flush(flushLevel, onData);
+}
+
+size_t
+Lz4Compressor::
+finish(const OnData & onData)
+{
+    return itl->finish(onData);
+}
+
+std::string
+Lz4Compressor::
+encodeBlock(const char * data, size_t len, int level)
+{
+    std::string result(LZ4_compressBound(len) + 8, '\0');
+    char * out = &result[0];
+
+    int size = level < 3
+        ? LZ4_compress(data, out + 4, len)
+        : LZ4_compressHC(data, out + 4, len);
+    uint32_t header = size;
+
+    // Stored as is when it doesn't compress
+    if (size <= 0 || size_t(size) >= len) {
+        size = len;
+        header = size | ML::lz4::NotCompressedMask;
+        memcpy(out + 4, data, len);
+    }
+
+    uint32_t checksum = XXH32(out + 4, size, ML::lz4::ChecksumSeed);
+    memcpy(out, &header, 4);
+    memcpy(out + 4 + size, &checksum, 4);
+    result.resize(size + 8);
+
+    return result;
+}
+
+
+/*****************************************************************************/
+/* PARALLEL COMPRESSOR                                                       */
+/*****************************************************************************/
+
+struct ParallelCompressor::Itl {
+
+    Itl(const EncodeBlock & encodeBlock,
+        int numThreads,
+        size_t blockSize,
+        const std::string & header,
+        const std::string & trailer)
+        : encodeBlock(encodeBlock), blockSize(blockSize),
+          maxPending(2 * std::max(numThreads, 1)),
+          header(header), trailer(trailer), headerWritten(false),
+          shutdown(false)
+    {
+        ExcAssertGreater(blockSize, 0);
+        current.reserve(blockSize);
+
+        for (int i = 0;  i < std::max(numThreads, 1);  ++i)
+            threads.emplace_back([=] () { this->runWorkerThread(); });
+    }
+
+    ~Itl()
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            shutdown = true;
+        }
+        workCond.notify_all();
+
+        for (auto & thread: threads)
+            thread.join();
+    }
+
+    struct Block {
+        Block()
+            : done(false)
+        {
+        }
+
+        std::string data;
+        std::string encoded;
+        std::exception_ptr error;
+        bool done;   ///< Protected by lock
+    };
+
+    EncodeBlock encodeBlock;
+    size_t blockSize;
+    size_t maxPending;
+    std::string header;
+    std::string trailer;
+    bool headerWritten;
+
+    std::string current;   ///< Block being filled
+
+    /// Blocks in the order they have to be written; only used by the
+    /// writing thread
+    std::deque<std::shared_ptr<Block> > pending;
+
+    std::mutex lock;
+    std::condition_variable workCond;
+    std::condition_variable doneCond;
+    std::deque<std::shared_ptr<Block> > todo;   ///< Protected by lock
+    bool shutdown;                              ///< Protected by lock
+    std::vector<std::thread> threads;
+
+    void runWorkerThread()
+    {
+        for (;;) {
+            std::shared_ptr<Block> block;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                workCond.wait(guard, [&] () { return shutdown || !todo.empty(); });
+                if (todo.empty())
+                    return;
+                block = todo.front();
+                todo.pop_front();
+            }
+
+            try {
+                block->encoded = encodeBlock(block->data.data(),
+                                             block->data.size());
+            } catch (...) {
+                block->error = std::current_exception();
+            }
+            block->data = std::string();
+
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                block->done = true;
+            }
+            doneCond.notify_all();
+        }
+    }
+
+    /** Writes out the blocks that are done, in order.  Waits until there
+        are no more than maxPending left, or none if wait is true.
+    */
+    size_t writeBlocks(const OnData & onData, bool wait)
+    {
+        size_t result = 0;
+
+        while (!pending.empty()) {
+            std::shared_ptr<Block> block = pending.front();
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                if (!block->done) {
+                    if (!wait && pending.size() <= maxPending)
+                        break;
+                    doneCond.wait(guard, [&] () { return block->done; });
+                }
+            }
+
+            pending.pop_front();
+
+            if (block->error)
+                std::rethrow_exception(block->error);
+
+            if (!headerWritten) {
+                result += writeAll(header.data(), header.size(), onData);
+                headerWritten = true;
+            }
+            result += writeAll(block->encoded.data(), block->encoded.size(),
+                               onData);
+        }
+
+        return result;
+    }
+
+    void submitBlock()
+    {
+        auto block = std::make_shared<Block>();
+        block->data.swap(current);
+        current.reserve(blockSize);
+
+        pending.push_back(block);
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            todo.push_back(block);
+        }
+        workCond.notify_one();
+    }
+
+    size_t compress(const char * data, size_t len, const OnData & onData)
+    {
+        bool submitted = false;
+
+        while (len) {
+            size_t toCopy = std::min(len, blockSize - current.size());
+            current.append(data, toCopy);
+            data += toCopy;
+            len -= toCopy;
+
+            if (current.size() == blockSize) {
+                submitBlock();
+                submitted = true;
+            }
+        }
+
+        return submitted ? writeBlocks(onData, false) : 0;
+    }
+
+    size_t flush(FlushLevel flushLevel, const OnData & onData)
+    {
+        switch (flushLevel) {
+        case FLUSH_NONE:
+            return 0;
+        case FLUSH_AVAILABLE:
+            return writeBlocks(onData, false);
+        case FLUSH_SYNC:
+        case FLUSH_RESTART:
+            if (!current.empty())
+                submitBlock();
+            return writeBlocks(onData, true);
+        default:
+            throw ML::Exception("bad flush level");
+        }
+    }
+
+    size_t finish(const OnData & onData)
+    {
+        size_t result = flush(FLUSH_RESTART, onData);
+
+        if (!headerWritten) {
+            result += writeAll(header.data(), header.size(), onData);
+            headerWritten = true;
+        }
+
+        result += writeAll(trailer.data(), trailer.size(), onData);
+        return result;
+    }
+};
+
+ParallelCompressor::
+ParallelCompressor(const EncodeBlock & encodeBlock,
+                   int numThreads,
+                   size_t blockSize,
+                   const std::string & header,
+                   const std::string & trailer)
+    : itl(new Itl(encodeBlock, numThreads, blockSize, header, trailer))
+{
+}
+
+ParallelCompressor::
+~ParallelCompressor()
+{
+}
+
+ParallelCompressor *
+ParallelCompressor::
+gzip(int level, int numThreads, size_t blockSize)
+{
+    // Concatenated gzip members decompress to the concatenation of their
+    // contents
+    auto encodeBlock = [=] (const char * data, size_t len)
+        {
+            std::string result;
+            auto onData = [&] (const char * data, size_t len)
+                {
+                    result.append(data, len);
+                    return len;
+                };
+
+            GzipCompressor compressor(level);
+            compressor.compress(data, len, onData);
+            compressor.finish(onData);
+
+            return result;
+        };
+
+    return new ParallelCompressor(encodeBlock, numThreads, blockSize);
+}
+
+ParallelCompressor *
+ParallelCompressor::
+lz4(int level, int numThreads, int blockSizeId)
+{
+    auto encodeBlock = [=] (const char * data, size_t len)
+        {
+            return Lz4Compressor::encodeBlock(data, len, level);
+        };
+
+    ML::lz4::Header head = lz4Header(blockSizeId);
+    uint32_t endMark = 0;
+
+    return new ParallelCompressor(encodeBlock, numThreads, head.blockSize(),
+                                  std::string((const char *)&head,
+                                              sizeof(head)),
+                                  std::string((const char *)&endMark,
+                                              sizeof(endMark)));
+}
+
+size_t
+ParallelCompressor::
+compress(const char * data, size_t len, const OnData & onData)
+{
+    return itl->compress(data, len, onData);
+}
+    
+size_t
+ParallelCompressor::
+flush(FlushLevel flushLevel, const OnData & onData)
+{
+    return itl->flush(flushLevel, onData);
+}
+
+size_t
+ParallelCompressor::
+finish(const OnData & onData)
+{
+    return itl->finish(onData);
+}
+
 } // namespace Datacratic
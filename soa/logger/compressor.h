@@ -65,7 +65,10 @@ struct Compressor {
     /** Convert a filename to a compression scheme. */
     static std::string filenameToCompression(const std::string & filename);
 
-    /** Create a compressor with the given scheme. */
+    /** Create a compressor with the given scheme.  "gzip" and "lz4" can
+        be followed by the number of threads to compress with, as in
+        "gzip:4", to get a ParallelCompressor.
+    */
     static Compressor * create(const std::string & compression,
                                int level);
 };
@@ -135,6 +138,99 @@ private:
     std::unique_ptr<Itl> itl;
 };
 
+
+/*****************************************************************************/
+/* LZ4 COMPRESSOR                                                            */
+/*****************************************************************************/
+
+/** Writes the lz4 framing that ML::lz4_decompressor and filter_streams
+    read back, with independent blocks.  A level of 3 or more uses the high
+    compression mode.
+
+    Blocks can't be added to once they are written, so writing out the
+    partial block at every FLUSH_AVAILABLE would give a block per message.
+    Only FLUSH_SYNC, FLUSH_RESTART and finish() write out the data that
+    doesn't fill a block yet.
+*/
+
+struct Lz4Compressor : public Compressor {
+
+    Lz4Compressor(int level = 0, int blockSizeId = 7);
+
+    virtual ~Lz4Compressor();
+
+    virtual size_t compress(const char * data, size_t len,
+                            const OnData & onData);
+    
+    virtual size_t flush(FlushLevel flushLevel, const OnData & onData);
+
+    virtual size_t finish(const OnData & onData);
+
+    /** Returns the given block with its framing: size, data and
+        checksum.
+    */
+    static std::string encodeBlock(const char * data, size_t len,
+                                   int level);
+
+private:
+    struct Itl;
+    std::unique_ptr<Itl> itl;
+};
+
+
+/*****************************************************************************/
+/* PARALLEL COMPRESSOR                                                       */
+/*****************************************************************************/
+
+/** Compressor that splits the stream into blocks that are compressed
+    independently of each other on a pool of threads, and writes them out
+    in order.  The writing thread only waits for the pool when more than
+    two blocks per thread are outstanding.
+
+    Each block is encoded so that the concatenation of the header, the
+    blocks and the trailer is a stream that standard tools read: a gzip
+    member per block for gzip, and lz4 blocks within a single frame for
+    lz4.
+
+    As for Lz4Compressor, a block is only cut short by FLUSH_SYNC,
+    FLUSH_RESTART or finish(); FLUSH_AVAILABLE writes out the blocks that
+    are done without waiting for the others.
+*/
+
+struct ParallelCompressor : public Compressor {
+
+    /** Encodes a block so that it can be written on its own. */
+    typedef std::function<std::string (const char * data, size_t len)>
+        EncodeBlock;
+
+    ParallelCompressor(const EncodeBlock & encodeBlock,
+                       int numThreads,
+                       size_t blockSize,
+                       const std::string & header = "",
+                       const std::string & trailer = "");
+
+    virtual ~ParallelCompressor();
+
+    /** Compressor writing gzip members of blockSize bytes of input. */
+    static ParallelCompressor * gzip(int level, int numThreads,
+                                     size_t blockSize = 1 << 20);
+
+    /** Compressor writing an lz4 frame. */
+    static ParallelCompressor * lz4(int level, int numThreads,
+                                    int blockSizeId = 7);
+
+    virtual size_t compress(const char * data, size_t len,
+                            const OnData & onData);
+    
+    virtual size_t flush(FlushLevel flushLevel, const OnData & onData);
+
+    virtual size_t finish(const OnData & onData);
+
+private:
+    struct Itl;
+    std::unique_ptr<Itl> itl;
+};
+
 } // namespace Datacratic
 
 #endif /* __logger__compressor_h__ */
@@ -14,7 +14,10 @@
 #include "file_output.h"
 #include "publish_output.h"
 #include "callback_output.h"
+#include "threaded_output.h"
+#include "columnar_output.h"
 #include <boost/make_shared.hpp>
+#include <unordered_map>
 
 
 using namespace std;
@@ -51,6 +54,7 @@ Logger(size_t bufferSize)
     : context(std::make_shared<zmq::context_t>(1)),
       messages(bufferSize),
       outputs(0),
+      outputQueueSize(0),
       messagesSent(0), messagesDone(0)
 {
     doShutdown = false;
@@ -61,6 +65,7 @@ Logger(zmq::context_t & contextRef, size_t bufferSize)
     : context(ML::make_unowned_std_sp(contextRef)),
       messages(bufferSize),
       outputs(0),
+      outputQueueSize(0),
       messagesSent(0), messagesDone(0)
 {
     doShutdown = false;
@@ -71,6 +76,7 @@ Logger(std::shared_ptr<zmq::context_t> & context, size_t bufferSize)
     : context(context),
       messages(bufferSize),
       outputs(0),
+      outputQueueSize(0),
       messagesSent(0), messagesDone(0)
 {
     doShutdown = false;
@@ -186,35 +192,66 @@ struct Logger::Outputs : public std::vector<Output> {
     void logMessage(const std::string & channel,
                     const std::string & message)
     {
-        for (auto it = begin(); it != end();  ++it) {
+        for (int i: route(channel)) {
+            Output & output = (*this)[i];
             try {
-                //cerr << "channel = " << channel << endl;
-                //cerr << "output = " << ML::type_name(*it->output) << endl;
-                //cerr << "it->allowChannels = " << it->allowChannels.str() << endl;
-                //cerr << "it->denyChannels = " << it->denyChannels.str() << endl;
-                if (it->allowChannels.empty()
-                    || boost::regex_match(channel, it->allowChannels)) {
-                    //cerr << "   allow" << endl;
-                    if (it->denyChannels.empty()
-                        || !boost::regex_match(channel, it->denyChannels)) {
-
-                        if (it->logProbability == 1.0
-                            || ((random() % 100000)
-                                < (it->logProbability * 100000))) {
-                            it->output->logMessage(channel, message);
-                        }
-                        //cerr << "  *** log" << endl;
-                    }
+                if (output.logProbability == 1.0
+                    || ((random() % 100000)
+                        < (output.logProbability * 100000))) {
+                    output.output->logMessage(channel, message);
                 }
             } catch (const std::exception & exc) {
                 cerr << "error: writing message to channel " << channel
-                     << " with output " << ML::type_name(*it->output)
+                     << " with output " << ML::type_name(*output.output)
                      << ": " << exc.what() << "; message = "
                      << message << endl;
             }
         }
     }
-    
+
+    /** Returns the indexes of the outputs whose filters accept the given
+        channel.  They're worked out the first time that the channel is
+        seen and cached from then on, so that logging a message costs a
+        hash lookup instead of matching the regexes of every output.  As
+        the outputs are replaced as a whole when one is added or they are
+        cleared, so is the cache.
+
+        Only called from the thread that writes the messages.
+    */
+    const std::vector<int> & route(const std::string & channel)
+    {
+        auto it = routes.find(channel);
+        if (it != routes.end())
+            return it->second;
+
+        // Don't let channel names that are made up on the fly grow it
+        // forever
+        if (routes.size() >= MaxRoutes)
+            routes.clear();
+
+        std::vector<int> & result = routes[channel];
+        for (unsigned i = 0;  i < size();  ++i) {
+            const Output & output = (*this)[i];
+            try {
+                if ((output.allowChannels.empty()
+                     || boost::regex_match(channel, output.allowChannels))
+                    && (output.denyChannels.empty()
+                        || !boost::regex_match(channel, output.denyChannels)))
+                    result.push_back(i);
+            } catch (const std::exception & exc) {
+                cerr << "error: matching channel " << channel
+                     << " for output " << ML::type_name(*output.output)
+                     << ": " << exc.what() << endl;
+            }
+        }
+
+        return result;
+    }
+
+    enum { MaxRoutes = 10000 };
+
+    std::unordered_map<std::string, std::vector<int> > routes;
+
     Outputs * old;   // to allow cleanup
 };
 
@@ -239,6 +276,9 @@ logTo(const std::string & uri,
     if (startsWith(rest, "file://"))
         addOutput(ML::make_std_sp(new FileOutput(rest)),
                   allowChannels, denyChannels, logProbability);
+    else if (startsWith(rest, "columnar://"))
+        addOutput(std::make_shared<ColumnarOutput>(rest),
+                  allowChannels, denyChannels, logProbability);
     else if (startsWith(rest, "pub://")) {
         auto output = ML::make_std_sp(new PublishOutput(context));
         output->bind(rest);
@@ -254,6 +294,16 @@ addOutput(std::shared_ptr<LogOutput> output,
           const boost::regex & denyChannels,
           double logProbability)
 {
+    if (outputQueueSize) {
+        auto threaded = std::make_shared<ThreadedOutput>(output,
+                                                         outputQueueSize);
+        {
+            std::lock_guard<std::mutex> guard(threadedOutputsLock);
+            threadedOutputs.push_back(threaded);
+        }
+        output = threaded;
+    }
+
     Outputs * current = outputs;
 
     for (;;) {
@@ -293,6 +343,16 @@ clearOutputs()
     }
 
     newOutputs.release();
+
+    std::lock_guard<std::mutex> guard(threadedOutputsLock);
+    threadedOutputs.clear();
+}
+
+void
+Logger::
+useOutputThreads(size_t queueSize)
+{
+    outputQueueSize = queueSize;
 }
 
 void
@@ -327,6 +387,10 @@ waitUntilFinished()
         ML::sleep(0.01);
     }
 
+    std::lock_guard<std::mutex> guard(threadedOutputsLock);
+    for (auto & output: threadedOutputs)
+        output->waitUntilEmpty();
+
     //cerr << "finished: sent " << messagesSent << " done "
     //     << messagesDone << endl;
 }
@@ -341,6 +405,11 @@ shutdown()
 
     delete outputs;  outputs = 0;
 
+    {
+        std::lock_guard<std::mutex> guard(threadedOutputsLock);
+        threadedOutputs.clear();
+    }
+
     doShutdown = false;
 }
 
@@ -10,6 +10,7 @@
 #include "soa/service/zmq_utils.h"
 #include "soa/service/socket_per_thread.h"
 #include <sstream>
+#include <mutex>
 #include "jml/utils/filter_streams.h"
 #include <boost/thread/thread.hpp>
 #include "jml/utils/smart_ptr_utils.h"
@@ -65,6 +66,9 @@ struct LogOutput {
 };
 
 
+struct ThreadedOutput;
+
+
 /*****************************************************************************/
 /* LOGGER                                                                    */
 /*****************************************************************************/
@@ -107,6 +111,8 @@ struct Logger {
     /** Tell where to log to.  The place it goes depends upon the URI:
         - file://path: log to the filename; if it finishes in "+" then it is
           appended;
+        - columnar://path: log to the filename in the binary format of
+          ColumnarOutput;
         - ipc://path: publish to the given zeromq socket;
         - tcp://hostname: send over tcp/ip
     */
@@ -139,6 +145,13 @@ struct Logger {
     /** Clear all outputs. */
     void clearOutputs();
 
+    /** Make the outputs added from now on write from threads of their own,
+        each with a queue of the given size, rather than from the logging
+        thread.  A slow output then only holds back itself; messages that
+        don't fit in its queue are dropped.  See ThreadedOutput.
+    */
+    void useOutputThreads(size_t queueSize = 65536);
+
     /** Log a given message to the given channel.  Each of the arguments will
         be converted to a string and logged like that.
     */
@@ -244,6 +257,13 @@ private:
     struct Output;
     struct Outputs;
 
+    /// Size of the queue of the threaded outputs; 0 when they're not used
+    size_t outputQueueSize;
+
+    /// Outputs that have their own thread, to wait for them to finish
+    std::vector<std::shared_ptr<ThreadedOutput> > threadedOutputs;
+    std::mutex threadedOutputsLock;
+
     /// Current list of outputs.  Must be swapped atomically.
     Outputs * outputs;
 
@@ -7,10 +7,11 @@ LIBLOGGER_SOURCES := \
 	file_output.cc publish_output.cc \
 	filter.cc json_filter.cc stats_output.cc callback_output.cc \
 	rotating_output.cc cloud_output.cc compressor.cc compressing_output.cc \
+	threaded_output.cc columnar_output.cc \
 	multi_output.cc 
 
 LIBLOGGER_LINK := \
-	ACE arch utils boost_thread boost_regex zeromq endpoint lzma boost_filesystem opstats cloud gc
+	ACE arch utils boost_thread boost_regex zeromq endpoint lzma boost_filesystem opstats cloud gc db
 
 $(eval $(call library,logger,$(LIBLOGGER_SOURCES),$(LIBLOGGER_LINK)))
 
@@ -6,10 +6,8 @@
 */
 
 #include "remote_input.h"
-#include <boost/iostreams/categories.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/bzip2.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
+#include "jml/utils/lz4_filter.h"
+#include <sstream>
 
 using namespace std;
 
@@ -22,33 +20,16 @@ namespace Datacratic {
 
 struct RemoteInputConnection : public PassiveConnectionHandler {
 
-    RemoteInputConnection()
-        : bytes_in(0)
+    RemoteInputConnection(RemoteInput * input)
+        : input(input), bytes_in(0), messages_in(0), inStream(false)
     {
-#if 0
-        using namespace boost::iostreams;
-
-        auto_ptr<filtering_ostream> new_stream
-            (new filtering_ostream());
-
-        bool gzip = true;
-        bool bzip2 = false;
-
-        if (gzip)
-            new_stream->push(gzip_decompressor());
-        else if (bzip2)
-            new_stream->push(bzip2_decompressor());
-    
-        new_stream->push(ConnectionSink(this));
-
-        stream.reset(new_stream.release());
-#endif
     }
 
     ~RemoteInputConnection()
     {
         
-        cerr << "input got total of " << bytes_in << " bytes" << endl;
+        cerr << "input got total of " << bytes_in << " bytes and "
+             << messages_in << " messages" << endl;
     }
 
     virtual void onGotTransport()
@@ -59,10 +40,19 @@ struct RemoteInputConnection : public PassiveConnectionHandler {
 
     virtual void handleData(const std::string & data)
     {
-        // We shouldn't get anything back on this (yet)
-        //cerr << "warning: input handleData: shouldn't have received anything"
-        //     << " but got " << data.size() << " bytes" << endl;
         bytes_in += data.size();
+        buffer += data;
+
+        try {
+            size_t done = 0;
+            while (decodeNext(done)) ;
+            buffer.erase(0, done);
+        } catch (const std::exception & exc) {
+            cerr << "Remote Log Input Connection got a bad stream: "
+                 << exc.what() << endl;
+            buffer.clear();
+            closeWhenHandlerFinished();
+        }
     }
 
     virtual void handleError(const std::string & error)
@@ -83,44 +73,101 @@ struct RemoteInputConnection : public PassiveConnectionHandler {
         closeWhenHandlerFinished();
     }
 
+    RemoteInput * input;
     uint64_t bytes_in;
-
-#if 0
-    void logMessage(const std::string & channel,
-                    const std::string & message)
+    uint64_t messages_in;
+
+    std::string buffer;      ///< Received but not yet decoded
+    bool inStream;           ///< Have we had the header of the stream?
+    ML::lz4::Header head;    ///< Header of the current stream
+    std::string partial;     ///< Message split across blocks
+    std::vector<char> block; ///< Decompression buffer
+
+    /** Decode the header, block or end mark at the given offset of the
+        buffer, if it's all there, and advance the offset past it.
+    */
+    bool decodeNext(size_t & done)
     {
-        //cerr << "remoteOutputConnection::logMessage()" << endl;
-        (*stream) << channel << '\t' << message << flush;
-        //this->send(channel + "-" + message, NEXT_CONTINUE, onSendFinished);
-    }
+        const char * p = buffer.data() + done;
+        size_t avail = buffer.size() - done;
+
+        if (!inStream) {
+            if (avail < sizeof(head)) return false;
+            std::istringstream stream(string(p, sizeof(head)));
+            head = ML::lz4::Header::read(stream);
+            inStream = true;
+            done += sizeof(head);
+            return true;
+        }
 
-    boost::scoped_ptr<std::ostream> stream;
+        uint32_t size;
+        if (avail < sizeof(size)) return false;
+        memcpy(&size, p, sizeof(size));
 
-    // TODO: how to deal with dropped messages?
-    struct ConnectionSink : public boost::iostreams::sink {
-        ConnectionSink(RemoteOutputConnection * connection)
-            : connection(connection)
-        {
+        if (size == 0) {
+            // End of this stream; another one may follow
+            inStream = false;
+            done += sizeof(size);
+            return true;
         }
-        
-        RemoteOutputConnection * connection;
 
-        std::streamsize write(const char * s, std::streamsize n)
-        {
-            auto onSendFinished = [=] ()
-                {
-                    cerr << "finished sending remote log message" << endl;
-                    abort();
-                };
-            
-            connection->send(std::string(s, n),
-                             NEXT_CONTINUE,
-                             onSendFinished);
-
-            return n;
+        bool notCompressed = size & ML::lz4::NotCompressedMask;
+        size &= ~ML::lz4::NotCompressedMask;
+
+        size_t checksumSize = head.blockChecksum() ? 4 : 0;
+        if (avail < sizeof(size) + size + checksumSize) return false;
+        const char * data = p + sizeof(size);
+
+        if (checksumSize) {
+            uint32_t expected;
+            memcpy(&expected, data + size, sizeof(expected));
+            if (XXH32(data, size, ML::lz4::ChecksumSeed) != expected)
+                throw ML::Exception("invalid block checksum");
+        }
+
+        if (notCompressed) dispatch(data, size);
+        else {
+            block.resize(head.blockSize());
+            int len = LZ4_decompress_safe(data, block.data(), size,
+                                          block.size());
+            if (len < 0)
+                throw ML::Exception("malformed lz4 block");
+            dispatch(block.data(), len);
         }
-    };
-#endif    
+
+        done += sizeof(size) + size + checksumSize;
+        return true;
+    }
+
+    /** Pass on the whole messages of a decoded block in one go. */
+    void dispatch(const char * data, size_t len)
+    {
+        partial.append(data, len);
+
+        size_t end = partial.rfind('\n');
+        if (end == string::npos) return;
+        ++end;
+
+        if (input->onData)
+            input->onData(partial.substr(0, end));
+
+        RemoteInput::Messages messages;
+        for (size_t pos = 0;  pos < end;) {
+            size_t eol = partial.find('\n', pos);
+            size_t tab = partial.find('\t', pos);
+            if (tab > eol) tab = eol;
+            messages.emplace_back(partial.substr(pos, tab - pos),
+                                  tab == eol
+                                  ? string()
+                                  : partial.substr(tab + 1, eol - tab - 1));
+            pos = eol + 1;
+        }
+        partial.erase(0, end);
+
+        messages_in += messages.size();
+        if (input->onMessages)
+            input->onMessages(messages);
+    }
 };
 
 
@@ -152,7 +199,7 @@ listen(int port,
     endpoint.onMakeNewHandler
         = [=] () -> std::shared_ptr<ConnectionHandler>
         {
-            return ML::make_std_sp(new RemoteInputConnection());
+            return ML::make_std_sp(new RemoteInputConnection(this));
         };
 
     endpoint.onAcceptError = [=] (const std::string & str)
@@ -13,6 +13,14 @@
 
 namespace Datacratic {
 
+/*****************************************************************************/
+/* REMOTE INPUT                                                              */
+/*****************************************************************************/
+
+/** Accepts the connections of RemoteOutputs and decodes the lz4 blocks of
+    messages that they send.
+*/
+
 struct RemoteInput {
     
     RemoteInput();
@@ -33,9 +41,18 @@ struct RemoteInput {
         return endpoint.port();
     }
 
-    /** Function used to respond to having data. */
+    /** Function used to respond to having data.  Called with the lines of
+        each block received, as "channel\tmessage\n".
+    */
     boost::function<void (const std::string &)> onData;
 
+    typedef std::vector<std::pair<std::string, std::string> > Messages;
+
+    /** Function called with the (channel, message) pairs of each block
+        received.
+    */
+    boost::function<void (const Messages &)> onMessages;
+
 private:
     PassiveEndpointT<SocketTransport> endpoint;
     boost::function<void ()> onShutdown;
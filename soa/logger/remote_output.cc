@@ -9,7 +9,8 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/bzip2.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
-#include "filter.h"
+#include "compressor.h"
+#include "jml/utils/lz4_filter.h"
 
 using namespace std;
 using namespace ML;
@@ -19,6 +20,41 @@ namespace Datacratic {
 
 
 
+namespace {
+
+/** Largest block of the stream: the 4MB blocks of lz4 block size id 7. */
+const size_t MaxBlockSize = 4 * 1024 * 1024;
+
+/** Header of the lz4 stream with independent, checksummed blocks that
+    the blocks of messages are sent in.
+*/
+std::string streamHeader()
+{
+    ML::lz4::Header head(7, true /* independent blocks */,
+                         true /* block checksums */, false);
+    return std::string((const char *)&head, sizeof(head));
+}
+
+/** Marks the end of an lz4 stream. */
+std::string endMark()
+{
+    return std::string(4, '\0');
+}
+
+/** Number of bytes of the given batch to put in the next block: all of it
+    if it fits, otherwise up to the last full message that does.
+*/
+size_t blockLength(const std::string & batch)
+{
+    if (batch.size() <= MaxBlockSize)
+        return batch.size();
+    size_t pos = batch.rfind('\n', MaxBlockSize - 1);
+    return pos == string::npos ? MaxBlockSize : pos + 1;
+}
+
+} // file scope
+
+
 /*****************************************************************************/
 /* REMOTE LOG CONNECTION                                                     */
 /*****************************************************************************/
@@ -26,15 +62,12 @@ namespace Datacratic {
 struct RemoteOutputConnection
     : public PassiveConnectionHandler {
 
-    RemoteOutputConnection()
-        : messageSerial(0), messageWritten(0)
+    RemoteOutputConnection(RemoteOutput * output)
+        : output(output), batchSize(output->batchSize),
+          flushInterval(output->flushInterval),
+          maxQueuedBytes(output->maxQueuedBytes),
+          headerSent(false), timerPending(false), bytesQueued(0)
     {
-        std::shared_ptr<ZlibCompressor> filter
-            (new ZlibCompressor());
-        filter->onOutput = boost::bind(&RemoteOutputConnection::write,
-                                       this,
-                                       _1, _2, _4);
-        this->filter = filter;
     }
 
     ~RemoteOutputConnection()
@@ -69,62 +102,118 @@ struct RemoteOutputConnection
     virtual void handleDisconnect()
     {
         cerr << "handleDisconnect()" << endl;
+
+        // What's left won't get there
+        while (!batch.empty()) {
+            size_t len = blockLength(batch);
+            output->spill(Lz4Compressor::encodeBlock(batch.data(), len, 0),
+                          len);
+            batch.erase(0, len);
+        }
+
         closeWhenHandlerFinished();
     }
 
+    virtual void handleTimeout(Date time, size_t cookie)
+    {
+        timerPending = false;
+        flush();
+    }
+
     void logMessage(const std::string & channel,
-                    const std::string & message,
-                    boost::function<void ()> onMessageDone)
+                    const std::string & message)
     {
-        string buf = format("%s\t%s\n\r", channel.c_str(), message.c_str());
-        filter->process(buf, FLUSH_SYNC, onMessageDone);
+        batch.append(channel);
+        batch.push_back('\t');
+        batch.append(message);
+        batch.push_back('\n');
+
+        while (batch.size() >= batchSize)
+            sendBlock();
+
+        if (!batch.empty() && !timerPending) {
+            scheduleTimerRelative(flushInterval);
+            timerPending = true;
+        }
     }
 
-    void flush(FlushLevel level = FLUSH_FULL,
-               boost::function<void ()> onFlushDone
+    void flush(boost::function<void ()> onFlushDone
                    = boost::function<void ()>())
     {
-        filter->flush(level, onFlushDone);
+        while (batch.size() > MaxBlockSize)
+            sendBlock();
+        sendBlock(onFlushDone);
     }
 
     void close(boost::function<void ()> onCloseDone
                    = boost::function<void ()>())
     {
         cerr << "closing" << endl;
-        filter->flush(FLUSH_FINISH, onCloseDone);
+        flush();
+        if (headerSent)
+            write(endMark(), onCloseDone);
+        else if (onCloseDone)
+            onCloseDone();
+        headerSent = false;
     }
 
-    size_t messageSerial;
-    size_t messageWritten;
-
-    std::shared_ptr<Filter> filter;
+    RemoteOutput * output;
+    size_t batchSize;
+    double flushInterval;
+    size_t maxQueuedBytes;
+
+    std::string batch;     ///< Messages not yet in a block
+    bool headerSent;       ///< Has the stream been started?
+    bool timerPending;     ///< Is the batch due to be flushed?
+    size_t bytesQueued;    ///< Bytes given to send() but not yet written
+
+    /** Encode the start of the batch into a block and send it, or spill it
+        if too much is already waiting to be written.  The callback is
+        called once it's written or spilled.
+    */
+    void sendBlock(boost::function<void ()> onBlockDone
+                       = boost::function<void ()>())
+    {
+        if (batch.empty()) {
+            if (onBlockDone) onBlockDone();
+            return;
+        }
+
+        size_t len = blockLength(batch);
+        std::string block = Lz4Compressor::encodeBlock(batch.data(), len, 0);
+        batch.erase(0, len);
+
+        if (bytesQueued + block.size() > maxQueuedBytes) {
+            output->spill(block, len);
+            if (onBlockDone) onBlockDone();
+            return;
+        }
+
+        write(block, onBlockDone);
+    }
 
-    // TODO: how to deal with dropped messages?
-    std::streamsize write(const char * s, size_t n,
-                          boost::function<void ()> onWriteFinished)
+    void write(const std::string & data,
+               boost::function<void ()> onWriteFinished)
     {
-        size_t serial JML_UNUSED = ++messageSerial;
-        //cerr << "sending " << n << " bytes" << endl;
+        std::string toSend;
+        if (!headerSent) {
+            toSend = streamHeader();
+            headerSent = true;
+        }
+        toSend += data;
+
+        size_t n = toSend.size();
+        bytesQueued += n;
 
-        std::string toSend(s, n);
-        
         auto onSendFinished = [=] ()
             {
-                ++messageWritten;
+                this->bytesQueued -= n;
                 if (onWriteFinished)
                     onWriteFinished();
             };
-        
-        auto doSend = [=] ()
-            {
-                this->send(toSend, NEXT_CONTINUE, onSendFinished);
-            };
-        
-        doAsync(doSend, "doSendLog");
-        
-        return n;
+
+        send(toSend, NEXT_CONTINUE, onSendFinished);
     }
-    
 };
 
 
@@ -134,7 +223,10 @@ struct RemoteOutputConnection
 
 RemoteOutput::
 RemoteOutput()
-    : ActiveEndpointT<SocketTransport>("remoteOutput")
+    : ActiveEndpointT<SocketTransport>("remoteOutput"),
+      batchSize(64 * 1024), flushInterval(0.1),
+      maxQueuedBytes(64 * 1024 * 1024), backlogBytes(0),
+      bytesSpilled(0), bytesDropped(0)
 {
     shuttingDown = false;
 }
@@ -204,11 +296,18 @@ setupConnection(std::shared_ptr<TransportBase> transport,
         {
             try {
                 std::shared_ptr<RemoteOutputConnection> connection
-                    (new RemoteOutputConnection());
+                    (new RemoteOutputConnection(this));
                 transport->associate(connection);
 
                 Guard guard(this->lock);
                 this->connection = connection;
+
+                // We're in the connection's thread, so it can take the
+                // backlog directly
+                for (auto & m: backlog)
+                    connection->logMessage(m.first, m.second);
+                backlog.clear();
+                backlogBytes = 0;
                 if (onFinished) onFinished();
             } catch (const std::exception & exc) {
                 onError("setupConnection: error: " + string(exc.what()));
@@ -225,6 +324,8 @@ barrier()
 {
     Guard guard(lock);
 
+    if (!connection) return;
+
     ACE_Semaphore sem(0);
 
     auto onBarrierDone = [&] ()
@@ -234,7 +335,7 @@ barrier()
 
     auto finishBarrier = [&] ()
         {
-            this->connection->flush(FLUSH_NONE, onBarrierDone);
+            this->connection->flush(onBarrierDone);
         };
 
     connection->doAsync(finishBarrier, "finishBarrier");
@@ -248,6 +349,8 @@ sync()
 {
     Guard guard(lock);
 
+    if (!connection) return;
+
     ACE_Semaphore sem(0);
 
     auto onSyncDone = [&] ()
@@ -257,7 +360,7 @@ sync()
 
     auto finishSync = [&] ()
         {
-            this->connection->flush(FLUSH_SYNC, onSyncDone);
+            this->connection->flush(onSyncDone);
         };
 
     connection->doAsync(finishSync, "finishSync");
@@ -271,6 +374,8 @@ flush()
 {
     Guard guard(lock);
 
+    if (!connection) return;
+
     ACE_Semaphore sem(0);
 
     auto onFlushDone = [&] ()
@@ -280,7 +385,7 @@ flush()
 
     auto finishFlush = [&] ()
         {
-            this->connection->flush(FLUSH_FULL, onFlushDone);
+            this->connection->flush(onFlushDone);
         };
 
     connection->doAsync(finishFlush, "finishFlush");
@@ -294,6 +399,8 @@ close()
 {
     Guard guard(lock);
 
+    if (!connection) return;
+
     ACE_Semaphore sem(0);
 
     auto onCloseDone = [&] ()
@@ -318,10 +425,16 @@ shutdown()
     shuttingDown = true;
 
     if (connection)
-        connection->flush();
+        flush();
 
     ActiveEndpointT<SocketTransport>::shutdown();
 
+    {
+        Guard guard(lock);
+        spillBacklog();
+    }
+    closeSpill();
+
     shuttingDown = false;
 }
 
@@ -336,23 +449,121 @@ logMessage(const std::string & channel,
         throw Exception("attempt to log message whilst shutting down");
 
     if (!connection) {
-        cerr << "adding to backlog; currently " << backlog.size()
-             << " messages" << endl;
         backlog.push_back(make_pair(channel, message));
+        backlogBytes += channel.size() + message.size() + 2;
+        if (backlogBytes > maxQueuedBytes)
+            spillBacklog();
         return;
     }
 
-    auto onMessageLogged = [] () {};
-
     // Safe to call from any thread on the connection
     connection->doAsync(std::bind(&RemoteOutputConnection::logMessage,
                                   connection,
                                   channel,
-                                  message,
-                                  onMessageLogged),
+                                  message),
                         "logMessage");
 }
 
+void
+RemoteOutput::
+setBatching(size_t batchSize, double flushInterval)
+{
+    Guard guard(lock);
+
+    if (batchSize == 0 || flushInterval <= 0.0)
+        throw Exception("RemoteOutput::setBatching(): batches need a size "
+                        "and an interval");
+
+    this->batchSize = std::min(batchSize, MaxBlockSize);
+    this->flushInterval = flushInterval;
+}
+
+void
+RemoteOutput::
+setSpill(const std::string & filename, size_t maxQueuedBytes)
+{
+    Guard guard(lock);
+    std::unique_lock<std::mutex> spillGuard(spillLock);
+
+    if (filename != spillFile && spillStream)
+        throw Exception("RemoteOutput::setSpill(): already spilling to "
+                        + spillFile);
+
+    this->spillFile = filename;
+    this->maxQueuedBytes = maxQueuedBytes;
+}
+
+void
+RemoteOutput::
+spillBacklog()
+{
+    std::string lines;
+    auto spillLines = [&] ()
+        {
+            if (lines.empty()) return;
+            spill(Lz4Compressor::encodeBlock(lines.data(), lines.size(), 0),
+                  lines.size());
+            lines.clear();
+        };
+
+    for (auto & m: backlog) {
+        if (lines.size() + m.first.size() + m.second.size() + 2
+            > MaxBlockSize)
+            spillLines();
+        lines += m.first + '\t' + m.second + '\n';
+    }
+    spillLines();
+
+    backlog.clear();
+    backlogBytes = 0;
+}
+
+void
+RemoteOutput::
+spill(const std::string & block, size_t messageBytes)
+{
+    std::unique_lock<std::mutex> guard(spillLock);
+
+    if (!spillStream && !spillFile.empty()) {
+        std::unique_ptr<std::ofstream> stream
+            (new std::ofstream(spillFile.c_str(),
+                               std::ios::out | std::ios::app
+                               | std::ios::binary));
+        if (*stream) {
+            std::string head = streamHeader();
+            stream->write(head.data(), head.size());
+            spillStream = std::move(stream);
+        }
+        else cerr << "couldn't open remote output spill file " << spillFile
+                  << ": " << strerror(errno) << endl;
+    }
+
+    if (!spillStream) {
+        if (bytesDropped == 0)
+            cerr << "remote output is dropping messages that it can't send"
+                 << endl;
+        bytesDropped += messageBytes;
+        return;
+    }
+
+    spillStream->write(block.data(), block.size());
+    spillStream->flush();
+    bytesSpilled += messageBytes;
+}
+
+void
+RemoteOutput::
+closeSpill()
+{
+    std::unique_lock<std::mutex> guard(spillLock);
+
+    if (!spillStream) return;
+
+    std::string end = endMark();
+    spillStream->write(end.data(), end.size());
+    spillStream.reset();
+}
+
 void
 RemoteOutput::
 notifyCloseTransport(const std::shared_ptr<TransportBase> & transport)
@@ -11,6 +11,9 @@
 
 #include "logger.h"
 #include "soa/service/active_endpoint.h"
+#include <atomic>
+#include <fstream>
+#include <mutex>
 
 
 namespace Datacratic {
@@ -25,6 +28,17 @@ struct RemoteOutputConnection;
 
 /** Logging output class that establishes a connection to another machine and
     sends zipped versions of the log file to that machine.
+
+    The messages are batched into lz4 blocks, which are sent as a single
+    lz4 stream per connection that RemoteInput decodes.  A block is sent
+    once it's full or when the flush interval has passed since it was
+    started, whichever comes first.
+
+    logMessage() never waits for the network.  When too many bytes are
+    already waiting to be written to the socket, or whilst there is no
+    connection, the blocks go to the spill file instead (or are dropped if
+    there is none).  The spill file gets an lz4 stream of log lines per
+    RemoteOutput, in the same format as a log file.
 */
 
 struct RemoteOutput
@@ -58,6 +72,24 @@ struct RemoteOutput
     virtual void logMessage(const std::string & channel,
                             const std::string & message);
 
+    /** Set up the size in bytes that a block is sent at (at most 4MB) and
+        the number of seconds that a block waits for more messages.  Takes
+        effect on the next connection.
+    */
+    void setBatching(size_t batchSize, double flushInterval);
+
+    /** Append the blocks that can't be sent to the given file once more
+        than maxQueuedBytes are waiting to be sent.  With no filename, they
+        are dropped.
+    */
+    void setSpill(const std::string & filename, size_t maxQueuedBytes);
+
+    /** Bytes of messages that were written to the spill file. */
+    uint64_t spilledBytes() const { return bytesSpilled; }
+
+    /** Bytes of messages that were dropped for lack of a spill file. */
+    uint64_t droppedBytes() const { return bytesDropped; }
+
     /** Notification that a connection was closed.  This can be used to give a
         new set of data.
     */
@@ -70,6 +102,8 @@ struct RemoteOutput
     boost::function<void (const std::string)> onConnectionError;
 
 private:
+    friend struct RemoteOutputConnection;
+
     /** Internal helper function used to reconnect to the remote server. */
     void reconnect(boost::function<void ()> onFinished,
                    boost::function<void (const std::string &)> onError,
@@ -89,8 +123,30 @@ private:
     std::shared_ptr<RemoteOutputConnection> connection;
     bool shuttingDown;
 
+    size_t batchSize;
+    double flushInterval;
+    size_t maxQueuedBytes;
+
     /** Backlog of messages to send whilst connection is down. */
     std::vector<std::pair<std::string, std::string> > backlog;
+    size_t backlogBytes;
+
+    /** Send the backlog to the spill file. */
+    void spillBacklog();
+
+    /** Write the given encoded block, holding messageBytes bytes of
+        messages, to the spill file.  Thread safe.
+    */
+    void spill(const std::string & block, size_t messageBytes);
+
+    /** Finish the stream in the spill file. */
+    void closeSpill();
+
+    std::string spillFile;
+    std::mutex spillLock;
+    std::unique_ptr<std::ofstream> spillStream;
+    std::atomic<uint64_t> bytesSpilled;
+    std::atomic<uint64_t> bytesDropped;
 };
 
 } // namespace Datacratic
@@ -0,0 +1,88 @@
+/* columnar_output_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the columnar log format.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/logger/columnar_output.h"
+#include "jml/utils/guard.h"
+#include <unistd.h>
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_columnar_round_trip )
+{
+    string filename = "tmp/columnar_output_test.rtbc";
+    Call_Guard guard([&] () { unlink(filename.c_str()); });
+
+    vector<pair<string, string> > messages;
+    for (unsigned i = 0;  i < 20000;  ++i) {
+        string timestamp = "2014-Jan-20 12:34:" + to_string(10 + i / 1000)
+            + "." + to_string(10000 + i);
+        string auctionId = "aa2ef3-" + to_string(1000000 + i * 7);
+        if (i % 3 == 0)
+            messages.emplace_back("AUCTION", timestamp + "\t" + auctionId);
+        else messages.emplace_back("BID", timestamp + "\tagent" + to_string(i % 5)
+                                   + "\t" + auctionId + "\t[{\"price\":" +
+                                   to_string(i % 100) + "}]");
+    }
+
+    // A message with a different number of fields starts a new chunk
+    messages.emplace_back("BID", "2014-Jan-20 12:35:00.00000\tagent1");
+    messages.emplace_back("BID", "");
+
+    size_t bytesIn = 0;
+
+    {
+        ColumnarOutput output(filename, 4096);
+        output.setColumnNames("BID", { "timestamp", "agent", "auctionId" });
+        for (auto & message: messages) {
+            output.logMessage(message.first, message.second);
+            bytesIn += message.first.size() + message.second.size() + 2;
+        }
+        output.close();
+
+        BOOST_CHECK_EQUAL(output.stats()["bytesIn"].asInt(), bytesIn);
+        BOOST_CHECK_LT(output.stats()["bytesOut"].asInt(), bytesIn / 4);
+    }
+
+    // Messages of a channel come back in order
+    map<string, vector<string> > expected, found;
+    for (auto & message: messages)
+        expected[message.first].push_back(message.second);
+
+    size_t numMessages = ColumnarLogReader::forEachMessage
+        (filename, [&] (const string & channel, const string & message)
+         {
+             found[channel].push_back(message);
+         });
+
+    BOOST_CHECK_EQUAL(numMessages, messages.size());
+    BOOST_CHECK(found == expected);
+
+    // Single columns can be read by name
+    ColumnarLogReader reader(filename);
+    ColumnarChunk chunk;
+    size_t numBids = 0;
+    while (reader.next(chunk)) {
+        if (chunk.channel != "BID") continue;
+        int agent = chunk.columnIndex("agent");
+        if (agent == -1) continue;
+        if (chunk.numColumns() == 4)
+            BOOST_CHECK_EQUAL(chunk.columnNames[3], "3");
+        for (auto & value: chunk.column(agent)) {
+            BOOST_CHECK_EQUAL(value.compare(0, 5, "agent"), 0);
+            ++numBids;
+        }
+    }
+    BOOST_CHECK_EQUAL(numBids, expected["BID"].size() - 1);
+}
@@ -0,0 +1,121 @@
+/* compressor_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests that what the compressors write can be read back.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/logger/compressor.h"
+#include "jml/utils/lz4_filter.h"
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <sstream>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace {
+
+template<typename Decompressor>
+string decompress(const string & compressed)
+{
+    namespace io = boost::iostreams;
+
+    io::filtering_istream stream;
+    stream.push(Decompressor());
+    stream.push(io::array_source(compressed.data(), compressed.size()));
+
+    ostringstream result;
+    result << stream.rdbuf();
+    return result.str();
+}
+
+string logLines(size_t n)
+{
+    string result;
+    for (size_t i = 0;  i < n;  ++i)
+        result += "AUCTION\t" + to_string(i) + "\t{\"bid\":" + to_string(i % 97)
+            + "}\n";
+    return result;
+}
+
+string compress(Compressor & compressor, const string & data,
+                Compressor::FlushLevel flushLevel)
+{
+    string result;
+    auto onData = [&] (const char * data, size_t len)
+        {
+            result.append(data, len);
+            return len;
+        };
+
+    // Written in pieces of a line as the logger does
+    for (size_t pos = 0;  pos < data.size();) {
+        size_t end = data.find('\n', pos) + 1;
+        compressor.compress(data.data() + pos, end - pos, onData);
+        compressor.flush(flushLevel, onData);
+        pos = end;
+    }
+
+    compressor.finish(onData);
+    return result;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_lz4_compressor_round_trip )
+{
+    string data = logLines(200000);
+
+    // Small blocks so that there are many of them
+    Lz4Compressor compressor(0, 4);
+    string compressed = compress(compressor, data,
+                                 Compressor::FLUSH_AVAILABLE);
+    BOOST_CHECK_LT(compressed.size(), data.size() / 2);
+    BOOST_CHECK(decompress<ML::lz4_decompressor>(compressed) == data);
+
+    // Partial blocks written on every flush, and the high compression mode
+    unique_ptr<Compressor> hc(Compressor::create("lz4", 9));
+    string small = logLines(100);
+    BOOST_CHECK(decompress<ML::lz4_decompressor>
+                (compress(*hc, small, Compressor::FLUSH_SYNC)) == small);
+}
+
+BOOST_AUTO_TEST_CASE( test_parallel_compressor )
+{
+    namespace io = boost::iostreams;
+
+    string data = logLines(200000);
+
+    unique_ptr<ParallelCompressor> lz4(ParallelCompressor::lz4(0, 4, 4));
+    BOOST_CHECK(decompress<ML::lz4_decompressor>
+                (compress(*lz4, data, Compressor::FLUSH_AVAILABLE)) == data);
+
+    // One gzip member per block, which gunzip reads as a single stream
+    unique_ptr<ParallelCompressor> gzip
+        (ParallelCompressor::gzip(1, 4, 65536));
+    string compressed = compress(*gzip, data, Compressor::FLUSH_AVAILABLE);
+    BOOST_CHECK_LT(compressed.size(), data.size() / 2);
+    BOOST_CHECK(decompress<io::gzip_decompressor>(compressed) == data);
+
+    unique_ptr<Compressor> created(Compressor::create("gzip:2", 1));
+    string small = logLines(100);
+    BOOST_CHECK(decompress<io::gzip_decompressor>
+                (compress(*created, small, Compressor::FLUSH_SYNC)) == small);
+}
+
+BOOST_AUTO_TEST_CASE( test_compressor_empty )
+{
+    Lz4Compressor compressor;
+    BOOST_CHECK_EQUAL(decompress<ML::lz4_decompressor>
+                      (compress(compressor, "", Compressor::FLUSH_NONE)), "");
+    BOOST_CHECK_EQUAL(Compressor::filenameToCompression("bids.log.lz4"),
+                      "lz4");
+}
@@ -0,0 +1,73 @@
+/* logger_routing_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests that the logger routes each channel to the outputs whose filters
+   accept it, as the outputs change.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/logger/logger.h"
+#include "jml/utils/guard.h"
+#include "jml/utils/filter_streams.h"
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_logger_routing )
+{
+    string filename = "build/x86_64/tmp/logger_routing_test.log";
+    Call_Guard guard([&] () { unlink(filename.c_str()); });
+
+    {
+        filter_ostream stream(filename);
+        for (unsigned i = 0;  i < 10;  ++i)
+            stream << "AUCTION\t" << i << "\n"
+                   << "WIN\t" << i << "\n"
+                   << "MATCHEDWIN\t" << i << "\n";
+    }
+
+    Logger logger;
+
+    map<string, int> all, wins, notMatched;
+    auto countInto = [] (map<string, int> & counts)
+        {
+            return [&counts] (string channel, string message)
+                {
+                    ++counts[channel];
+                };
+        };
+
+    logger.addCallback(countInto(all));
+    logger.addCallback(countInto(wins), boost::regex(".*WIN"));
+    logger.replayDirect(filename);
+
+    BOOST_CHECK_EQUAL(all["AUCTION"], 10);
+    BOOST_CHECK_EQUAL(all["WIN"], 10);
+    BOOST_CHECK_EQUAL(all["MATCHEDWIN"], 10);
+    BOOST_CHECK_EQUAL(wins.count("AUCTION"), 0);
+    BOOST_CHECK_EQUAL(wins["WIN"], 10);
+    BOOST_CHECK_EQUAL(wins["MATCHEDWIN"], 10);
+
+    // The channels already seen are routed to the new output too
+    logger.addCallback(countInto(notMatched), boost::regex(),
+                       boost::regex("MATCHED.*"));
+    logger.replayDirect(filename);
+
+    BOOST_CHECK_EQUAL(all["AUCTION"], 20);
+    BOOST_CHECK_EQUAL(wins["WIN"], 20);
+    BOOST_CHECK_EQUAL(notMatched["AUCTION"], 10);
+    BOOST_CHECK_EQUAL(notMatched["WIN"], 10);
+    BOOST_CHECK_EQUAL(notMatched.count("MATCHEDWIN"), 0);
+
+    // And to nothing once they're cleared
+    logger.clearOutputs();
+    logger.replayDirect(filename);
+    BOOST_CHECK_EQUAL(all["AUCTION"], 20);
+}
@@ -5,6 +5,10 @@ $(eval $(call vowscoffee_test,logger_fs_test,logger))
 $(eval $(call test,logger_deadlock_test,logger,boost manual))
 
 $(eval $(call test,multi_output_logger_test,logger,boost))
+$(eval $(call test,threaded_output_test,logger,boost))
+$(eval $(call test,logger_routing_test,logger,boost))
+$(eval $(call test,compressor_test,logger,boost))
+$(eval $(call test,columnar_output_test,logger,boost))
 $(eval $(call test,rotating_file_logger_test,logger,manual boost))
 
 ifeq ($(NODEJS_ENABLED),1)
@@ -17,6 +17,8 @@
 #include "jml/utils/testing/watchdog.h"
 #include "jml/utils/testing/fd_exhauster.h"
 #include "jml/arch/timers.h"
+#include "jml/utils/filter_streams.h"
+#include <atomic>
 
 using namespace std;
 using namespace ML;
@@ -29,6 +31,18 @@ BOOST_AUTO_TEST_CASE( test_remote_logger )
     // get to the other end.
 
     RemoteInput input;
+    std::atomic<int> numReceived(0), numBlocks(0);
+    input.onMessages = [&] (const RemoteInput::Messages & messages)
+        {
+            for (auto & m: messages) {
+                BOOST_CHECK_EQUAL(m.first, "channelname");
+                BOOST_CHECK_EQUAL(m.second,
+                                  "blah blah this is another message");
+            }
+            numReceived += messages.size();
+            ++numBlocks;
+        };
+
     input.listen(-1, "localhost");
     int port = input.port();
 
@@ -41,9 +55,52 @@ BOOST_AUTO_TEST_CASE( test_remote_logger )
         output.logMessage("channelname", "blah blah this is another message");
         output.barrier();
     }
+
+    // Without the barriers, they go in as few blocks as fit
+    for (int i = 0;  i < 10000;  ++i)
+        output.logMessage("channelname", "blah blah this is another message");
+    output.flush();
+
+    for (int i = 0;  i < 100 && numReceived < 11000;  ++i)
+        ML::sleep(0.1);
+
+    BOOST_CHECK_EQUAL(numReceived, 11000);
+    BOOST_CHECK_LT(numBlocks, 1000 + 20);
+    BOOST_CHECK_EQUAL(output.spilledBytes(), 0);
     
     //output.close();
 
     output.shutdown();
     input.shutdown();
 }
+
+BOOST_AUTO_TEST_CASE( test_remote_logger_spill )
+{
+    // With nowhere to send them, the messages go to the spill file, which
+    // can be read back as a log file
+    string filename = "build/x86_64/tmp/remote_logger_test2_spill.lz4";
+    unlink(filename.c_str());
+    Call_Guard guard([&] () { unlink(filename.c_str()); });
+
+    {
+        RemoteOutput output;
+        output.setSpill(filename, 1000);
+
+        for (int i = 0;  i < 100;  ++i)
+            output.logMessage("channel" + to_string(i % 3),
+                              "message " + to_string(i));
+
+        BOOST_CHECK_GT(output.spilledBytes(), 0);
+        BOOST_CHECK_EQUAL(output.droppedBytes(), 0);
+    }
+
+    filter_istream stream(filename);
+    for (int i = 0;  i < 100;  ++i) {
+        string line;
+        BOOST_REQUIRE(getline(stream, line));
+        BOOST_CHECK_EQUAL(line, "channel" + to_string(i % 3)
+                          + "\tmessage " + to_string(i));
+    }
+    string line;
+    BOOST_CHECK(!getline(stream, line));
+}
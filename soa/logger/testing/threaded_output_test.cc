@@ -0,0 +1,75 @@
+/* threaded_output_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Tests for the output that writes from its own thread.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/logger/threaded_output.h"
+#include "soa/logger/callback_output.h"
+#include "jml/arch/futex.h"
+#include <atomic>
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_threaded_output_order )
+{
+    vector<string> received;
+
+    auto callback = make_shared<CallbackOutput>([&] (string channel,
+                                                     string message)
+        {
+            received.push_back(channel + ":" + message);
+        });
+
+    ThreadedOutput output(callback, 1024, 16);
+
+    for (unsigned i = 0;  i < 1000;  ++i)
+        output.logMessage("chan", to_string(i));
+
+    output.waitUntilEmpty();
+
+    BOOST_REQUIRE_EQUAL(received.size(), 1000);
+    for (unsigned i = 0;  i < 1000;  ++i)
+        BOOST_CHECK_EQUAL(received[i], "chan:" + to_string(i));
+    BOOST_CHECK_EQUAL(output.numDropped(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_threaded_output_slow_output )
+{
+    // An output that is stuck until we let it go
+    int blocked = 1;
+    std::atomic<int> numWritten(0);
+
+    auto callback = make_shared<CallbackOutput>([&] (string, string)
+        {
+            while (blocked)
+                futex_wait(blocked, 1);
+            ++numWritten;
+        });
+
+    ThreadedOutput output(callback, 16, 4);
+
+    // None of these wait for the output; those that don't fit are dropped
+    for (unsigned i = 0;  i < 100;  ++i)
+        output.logMessage("chan", "message");
+
+    uint64_t dropped = output.numDropped();
+    BOOST_CHECK_GT(dropped, 0);
+    BOOST_CHECK_EQUAL(output.stats()["dropped"].asInt(), dropped);
+
+    blocked = 0;
+    futex_wake(blocked);
+
+    // What was queued is still written when the output is closed
+    output.close();
+    BOOST_CHECK_EQUAL(numWritten, 100 - dropped);
+}
@@ -0,0 +1,175 @@
+/* threaded_output.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Output that writes to another output from its own thread.
+*/
+
+#include "threaded_output.h"
+#include "jml/arch/demangle.h"
+#include "jml/arch/futex.h"
+#include "jml/arch/timers.h"
+#include "jml/utils/exc_assert.h"
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* THREADED OUTPUT                                                           */
+/*****************************************************************************/
+
+ThreadedOutput::
+ThreadedOutput(std::shared_ptr<LogOutput> output,
+               size_t ringBufferSize,
+               size_t batchSize)
+    : output_(output),
+      ringBuffer(ringBufferSize),
+      batchSize(batchSize),
+      queued(0), written(0), dropped(0),
+      sleeping(0), shutdown_(false)
+{
+    ExcAssert(output_);
+    writeThread = std::thread([=] () { this->runWriteThread(); });
+}
+
+ThreadedOutput::
+~ThreadedOutput()
+{
+    stopWriteThread();
+}
+
+void
+ThreadedOutput::
+logMessage(const std::string & channel,
+           const std::string & message)
+{
+    if (!ringBuffer.tryPush(Entry(channel, message))) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    queued.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the fence in runWriteThread(): either the writer sees the
+    // message before it goes to sleep or we see that it's sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed)) {
+        sleeping = 0;
+        futex_wake(sleeping);
+    }
+}
+
+void
+ThreadedOutput::
+close()
+{
+    stopWriteThread();
+    output_->close();
+}
+
+void
+ThreadedOutput::
+stopWriteThread()
+{
+    if (!writeThread.joinable())
+        return;
+
+    shutdown_ = true;
+    sleeping = 0;
+    futex_wake(sleeping);
+
+    writeThread.join();
+}
+
+void
+ThreadedOutput::
+waitUntilEmpty() const
+{
+    while (written.load() < queued.load())
+        ML::sleep(0.01);
+}
+
+Json::Value
+ThreadedOutput::
+stats() const
+{
+    Json::Value result = output_->stats();
+    if (result.isNull())
+        result = Json::Value(Json::objectValue);
+
+    result["dropped"] = (Json::UInt)dropped.load();
+    result["pending"] = (Json::UInt)(queued.load() - written.load());
+
+    return result;
+}
+
+void
+ThreadedOutput::
+clearStats()
+{
+    output_->clearStats();
+    dropped = 0;
+}
+
+void
+ThreadedOutput::
+writeBatch(std::vector<Entry> & batch)
+{
+    for (auto & entry: batch) {
+        try {
+            output_->logMessage(entry.first, entry.second);
+        } catch (const std::exception & exc) {
+            cerr << "error: writing message to channel " << entry.first
+                 << " with output " << ML::type_name(*output_)
+                 << ": " << exc.what() << "; message = "
+                 << entry.second << endl;
+        }
+    }
+
+    written.fetch_add(batch.size(), std::memory_order_release);
+    batch.clear();
+}
+
+void
+ThreadedOutput::
+runWriteThread()
+{
+    std::vector<Entry> batch;
+    batch.reserve(batchSize);
+
+    Entry entry;
+
+    for (;;) {
+        while (batch.size() < batchSize && ringBuffer.tryPop(entry))
+            batch.emplace_back(std::move(entry));
+
+        if (!batch.empty()) {
+            writeBatch(batch);
+            continue;
+        }
+
+        // Everything that was queued before the shutdown is written out
+        if (shutdown_)
+            break;
+
+        sleeping = 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (ringBuffer.tryPop(entry)) {
+            sleeping = 0;
+            batch.emplace_back(std::move(entry));
+            continue;
+        }
+
+        // The timeout is only a safety net; we're woken up by logMessage()
+        futex_wait(sleeping, 1, 0.1);
+        sleeping = 0;
+    }
+}
+
+} // namespace Datacratic
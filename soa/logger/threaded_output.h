@@ -0,0 +1,92 @@
+/* threaded_output.h                                               -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Output that writes to another output from its own thread.
+*/
+
+#ifndef __logger__threaded_output_h__
+#define __logger__threaded_output_h__
+
+#include "logger.h"
+#include "jml/utils/ring_buffer.h"
+#include <atomic>
+#include <thread>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* THREADED OUTPUT                                                           */
+/*****************************************************************************/
+
+/** LogOutput that queues the messages and passes them on to another output
+    from a thread of its own, so that a slow output (a saturated disk, an
+    upload to S3) only holds back itself and not the thread that logs.
+
+    logMessage() is a push onto a lock free ring buffer and never blocks:
+    when the buffer is full the message is dropped and counted in the
+    "dropped" entry of stats().  The writer thread takes the messages off
+    in batches of up to batchSize and only sleeps when the buffer is
+    empty.
+*/
+
+struct ThreadedOutput : public LogOutput {
+
+    ThreadedOutput(std::shared_ptr<LogOutput> output,
+                   size_t ringBufferSize = 65536,
+                   size_t batchSize = 256);
+
+    virtual ~ThreadedOutput();
+
+    virtual void logMessage(const std::string & channel,
+                            const std::string & message);
+
+    /** Writes what is left in the buffer, stops the thread and closes the
+        output.
+    */
+    virtual void close();
+
+    virtual Json::Value stats() const;
+
+    virtual void clearStats();
+
+    /** Waits until every message that was queued so far has been passed
+        on to the output.
+    */
+    void waitUntilEmpty() const;
+
+    const std::shared_ptr<LogOutput> & output() const { return output_; }
+
+    uint64_t numDropped() const { return dropped; }
+
+private:
+    typedef std::pair<std::string, std::string> Entry;
+
+    std::shared_ptr<LogOutput> output_;
+    ML::RingBufferLockFreeSRMW<Entry> ringBuffer;
+    size_t batchSize;
+
+    std::atomic<uint64_t> queued;
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> dropped;
+
+    /// Set by the writer thread before it waits for messages
+    std::atomic<int> sleeping;
+    std::atomic<bool> shutdown_;
+    std::thread writeThread;
+
+    void stopWriteThread();
+
+    void runWriteThread();
+
+    /** Writes the batch to the output; returns once all of it is done. */
+    void writeBatch(std::vector<Entry> & batch);
+};
+
+
+} // namespace Datacratic
+
+
+#endif /* __logger__threaded_output_h__ */
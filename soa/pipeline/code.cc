@@ -20,4 +20,5 @@ using namespace Datacratic;
 #include "importer_block.cc"
 #include "pin.cc"
 #include "pipeline.cc"
+#include "threaded_pipeline.cc"
 
@@ -9,6 +9,12 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 namespace Datacratic
 {
@@ -17,14 +23,18 @@ namespace Datacratic
     struct IncomingPin;
     struct OutgoingPin;
     struct Connector;
+    struct StreamQueue;
 }
 
 #include "soa/types/basic_value_descriptions.h"
+#include "soa/types/date.h"
 #include "soa/service/logs.h"
+#include "jml/utils/ring_buffer.h"
 #include "soa/pipeline/pin.h"
 #include "soa/pipeline/block.h"
 #include "soa/pipeline/pipeline.h"
 #include "soa/pipeline/default_pipeline.h"
+#include "soa/pipeline/threaded_pipeline.h"
 #include "soa/pipeline/file_reader_block.h"
 #include "soa/pipeline/file_writer_block.h"
 #include "soa/pipeline/importer_block.h"
@@ -245,3 +245,36 @@ void OutgoingPin::onDeleteConnector(Connector * handle) {
     }
 }
 
+
+StreamQueue::StreamQueue(OutgoingPin * pin) :
+    items(0),
+    busyTime(0),
+    starvedTime(0),
+    pin(pin),
+    cancelled(false) {
+}
+
+void StreamQueue::cancel() {
+    cancelled = true;
+}
+
+bool StreamQueue::isCancelled() const {
+    return cancelled;
+}
+
+OutgoingPin * StreamQueue::getPin() const {
+    return pin;
+}
+
+std::deque<StreamQueue::Producer> const & StreamQueue::getProducers() const {
+    return producers;
+}
+
+StreamQueue::Producer * StreamQueue::addProducer(Block * block) {
+    producers.push_back(Producer { block, 0 });
+    return &producers.back();
+}
+
+void StreamQueue::throwCancelled() const {
+    THROW(pin->getBlock()->error) << "stream to '" << pin->getPath() << "' was cancelled" << std::endl;
+}
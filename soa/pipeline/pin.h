@@ -294,16 +294,176 @@ namespace Datacratic
         }
     };
 
+    // bounded queue carrying a stream to the thread of the block that consumes it
+    struct StreamQueue :
+        public std::enable_shared_from_this<StreamQueue>
+    {
+        StreamQueue(OutgoingPin * pin);
+
+        virtual ~StreamQueue() {
+        }
+
+        // calls the handlers of the stream until every producer is done
+        virtual void drain() = 0;
+
+        // makes waiting producers throw and drain return
+        void cancel();
+        bool isCancelled() const;
+
+        OutgoingPin * getPin() const;
+
+        struct Producer {
+            Block * block;
+            double blockedTime;
+        };
+
+        std::deque<Producer> const & getProducers() const;
+
+        uint64_t items;
+        double busyTime;
+        double starvedTime;
+
+    protected:
+        Producer * addProducer(Block * block);
+        void throwCancelled() const;
+
+        // how long to wait on the queue before checking if it was cancelled
+        static constexpr double WaitTime = 0.1;
+
+    private:
+        OutgoingPin * pin;
+        std::deque<Producer> producers;
+        std::atomic<bool> cancelled;
+    };
+
+    template<typename T>
+    struct TypedStreamQueue :
+        public StreamQueue
+    {
+        TypedStreamQueue(OutgoingPin * pin, std::shared_ptr<Stream<T>> stream, size_t capacity) :
+            StreamQueue(pin),
+            stream(std::move(stream)),
+            entries(capacity) {
+        }
+
+        // stream to give to the producing block, which pushes into the queue
+        std::shared_ptr<Stream<T>> createFront(Block * producer) {
+            auto self = std::static_pointer_cast<TypedStreamQueue<T>>(shared_from_this());
+            auto item = addProducer(producer);
+            auto result = std::make_shared<Stream<T>>();
+
+            result->pushHandler = [=](T const & value) {
+                self->put(item, Entry(value));
+            };
+
+            result->doneHandler = [=]() {
+                self->put(item, Entry());
+            };
+
+            return result;
+        }
+
+        void drain() {
+            Date start = Date::now();
+            size_t done = 0;
+            Entry entry;
+
+            while(done < getProducers().size()) {
+                if(!entries.tryPop(entry)) {
+                    Date waiting = Date::now();
+                    while(!entries.tryPop(entry, WaitTime)) {
+                        if(isCancelled()) {
+                            break;
+                        }
+                    }
+
+                    starvedTime += Date::now().secondsSince(waiting);
+                    if(isCancelled()) {
+                        break;
+                    }
+                }
+
+                if(entry.done) {
+                    ++done;
+                    stream->doneHandler();
+                }
+                else {
+                    ++items;
+                    stream->pushHandler(entry.value);
+                }
+            }
+
+            busyTime = Date::now().secondsSince(start) - starvedTime;
+        }
+
+    private:
+        // an entry without a value marks the end of a producer
+        struct Entry {
+            Entry() : done(true) {
+            }
+
+            Entry(T const & value) : value(value), done(false) {
+            }
+
+            T value;
+            bool done;
+        };
+
+        void put(Producer * producer, Entry && entry) {
+            if(entries.tryPush(std::move(entry))) {
+                return;
+            }
+
+            // backpressure: the consumer is behind so wait for it
+            Date start = Date::now();
+            while(!entries.tryPush(std::move(entry), WaitTime)) {
+                if(isCancelled()) {
+                    throwCancelled();
+                }
+            }
+
+            producer->blockedTime += Date::now().secondsSince(start);
+        }
+
+        std::shared_ptr<Stream<T>> stream;
+        ML::RingBufferSRMW<Entry> entries;
+    };
+
     // pin for consuming streaming data
     template<typename T>
     struct PullingPin :
         public WritingPin<Stream<T>>
     {
         PullingPin(Block * block, std::string name) :
-            WritingPin<Stream<T>>(block, std::move(name)) {
+            WritingPin<Stream<T>>(block, std::move(name)),
+            queueSize(0) {
             auto stream = std::make_shared<Stream<T>>();
             this->set(stream);
         }
+
+        void push() {
+            auto pipeline = this->getBlock()->getPipeline();
+            if(!queueSize || !pipeline->isConcurrent()) {
+                WritingPin<Stream<T>>::push();
+                return;
+            }
+
+            // each producer gets its own end of the queue
+            auto stream = this->get();
+            auto queue = std::make_shared<TypedStreamQueue<T>>(this, stream, queueSize);
+            for(auto item : this->getConnectors()) {
+                this->set(queue->createFront(item->getIncomingPin()->getBlock()));
+                item->push();
+            }
+
+            this->set(stream);
+            pipeline->drain(queue);
+        }
+
+        // when the pipeline runs blocks concurrently, calls the handlers on their own
+        // thread with up to that many items waiting for them, or on the thread of the
+        // producer when 0
+        size_t queueSize;
     };
 }
 
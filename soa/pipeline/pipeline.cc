@@ -49,3 +49,10 @@ Pipeline::Pipeline() :
     environment(this, "environment") {
 }
 
+bool Pipeline::isConcurrent() const {
+    return false;
+}
+
+void Pipeline::drain(std::shared_ptr<StreamQueue> queue) {
+    THROW(error) << "pipeline cannot run streams concurrently" << std::endl;
+}
@@ -25,6 +25,11 @@ namespace Datacratic
 
         virtual Connector * createConnector(IncomingPin * incoming, OutgoingPin * outgoing) = 0;
 
+        // whether blocks can run at the same time, in which case pulling pins with a
+        // queue hand their stream to drain() instead of being called by the producer
+        virtual bool isConcurrent() const;
+        virtual void drain(std::shared_ptr<StreamQueue> queue);
+
         ReadingPin<Environment> environment;
     };
 }
@@ -164,3 +164,136 @@ BOOST_AUTO_TEST_CASE( test_blocks )
     }
 }
 
+
+struct MyBlockThatCounts :
+    public Block
+{
+    MyBlockThatCounts() :
+        lines(this, "lines"), count(0), failAt(-1) {
+    }
+
+    void run() {
+        for(int i = 0; i < count; ++i) {
+            if(i == failAt) {
+                THROW(error) << "failing at " << i << std::endl;
+            }
+
+            lines.push(std::to_string(i));
+        }
+
+        lines.done();
+    }
+
+    PushingPin<std::string> lines;
+    int count;
+    int failAt;
+};
+
+struct MyBlockThatRelays :
+    public Block
+{
+    MyBlockThatRelays() :
+        input(this, "input"), output(this, "output") {
+    }
+
+    void run() {
+        input->pushHandler = [&](std::string const & line) {
+            output.push(line + "!");
+        };
+
+        input->doneHandler = [&]() {
+            output.done();
+        };
+
+        input.push();
+    }
+
+    PullingPin<std::string> input;
+    PushingPin<std::string> output;
+};
+
+struct MyBlockThatCollects :
+    public Block
+{
+    MyBlockThatCollects() :
+        lines(this, "lines"), done(0) {
+    }
+
+    void run() {
+        lines->pushHandler = [&](std::string const & line) {
+            items.push_back(line);
+        };
+
+        lines->doneHandler = [&]() {
+            ++done;
+        };
+
+        lines.push();
+    }
+
+    PullingPin<std::string> lines;
+    std::vector<std::string> items;
+    int done;
+};
+
+BOOST_AUTO_TEST_CASE( test_threaded_pipeline )
+{
+    int count = 100000;
+
+    for(int threads : { 0, 1, 4 }) {
+        ThreadedPipeline pipeline(threads);
+
+        auto a = pipeline.create<MyBlockThatCounts>("a");
+        a->count = count;
+
+        auto b = pipeline.create<MyBlockThatRelays>("b");
+        b->input.queueSize = 64;
+        b->input.connectWith(a->lines);
+
+        auto c = pipeline.create<MyBlockThatCollects>("c");
+        c->lines.queueSize = 16;
+        c->lines.connectWith(b->output);
+
+        pipeline.run();
+
+        BOOST_REQUIRE_EQUAL(c->items.size(), count);
+        BOOST_CHECK_EQUAL(c->done, 1);
+        for(int i = 0; i < count; ++i) {
+            BOOST_REQUIRE_EQUAL(c->items[i], std::to_string(i) + "!");
+        }
+
+        auto & stats = pipeline.getStats();
+        BOOST_CHECK_EQUAL(stats.at("/b").items, count);
+        BOOST_CHECK_EQUAL(stats.at("/c").items, count);
+        BOOST_CHECK_EQUAL(stats.at("/a").items, 0);
+    }
+
+    // without a queue the handlers are called by the producer as before
+    ThreadedPipeline pipeline(2);
+    auto a = pipeline.create<MyBlockThatCounts>("a");
+    a->count = 1000;
+    auto c = pipeline.create<MyBlockThatCollects>("c");
+    c->lines.connectWith(a->lines);
+    pipeline.run();
+
+    BOOST_CHECK_EQUAL(c->items.size(), 1000);
+    BOOST_CHECK_EQUAL(c->done, 1);
+    BOOST_CHECK_EQUAL(pipeline.getStats().at("/c").items, 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_threaded_pipeline_failure )
+{
+    ThreadedPipeline pipeline;
+
+    auto a = pipeline.create<MyBlockThatCounts>("a");
+    a->count = 100000;
+    a->failAt = 50000;
+
+    auto c = pipeline.create<MyBlockThatCollects>("c");
+    c->lines.queueSize = 16;
+    c->lines.connectWith(a->lines);
+
+    // the collector never gets its done so the run only ends if the queue is cancelled
+    BOOST_CHECK_THROW(pipeline.run(), std::exception);
+    BOOST_CHECK_EQUAL(c->done, 0);
+}
@@ -0,0 +1,240 @@
+/* threaded_pipeline.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+*/
+
+ThreadedPipeline::ThreadedPipeline(int threads) :
+    threads(threads),
+    active(0),
+    stopping(false) {
+}
+
+void ThreadedPipeline::run() {
+    states.clear();
+    runTimes.clear();
+    stats.clear();
+    queues.clear();
+    ready.clear();
+    active = 0;
+    stopping = false;
+    failure = nullptr;
+
+    std::vector<Block *> initial;
+    for(auto item : getBlocks()) {
+        State state;
+        state.pipeline = this;
+        state.block = item.get();
+        state.count = 0;
+        for(auto pin : item->getIncomingPins()) {
+            if(pin->isConnected()) {
+                state.count++;
+            }
+        }
+
+        if(state.count == 0) {
+            initial.push_back(state.block);
+        }
+        else {
+            states[state.block] = state;
+        }
+    }
+
+    for(auto & item : connectors) {
+        auto block = item->getIncomingPin()->getBlock();
+        item->state = &states[block];
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        for(int i = 0; i < threads; ++i) {
+            start([=]() { work(); });
+        }
+
+        for(auto block : initial) {
+            schedule(block);
+        }
+
+        changed.wait(guard, [&]() { return active == 0; });
+        stopping = true;
+        changed.notify_all();
+    }
+
+    // nothing else gets started once there's no more work
+    for(auto & item : running) {
+        item.join();
+    }
+
+    running.clear();
+    collectStats();
+
+    if(failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+Connector * ThreadedPipeline::createConnector(IncomingPin * incoming, OutgoingPin * outgoing) {
+    auto item = std::make_shared<ThreadedConnector>(incoming, outgoing);
+    connectors.insert(item);
+    return item.get();
+}
+
+bool ThreadedPipeline::isConcurrent() const {
+    return true;
+}
+
+void ThreadedPipeline::drain(std::shared_ptr<StreamQueue> queue) {
+    std::lock_guard<std::mutex> guard(lock);
+    queues.push_back(queue);
+    if(failure) {
+        queue->cancel();
+    }
+
+    ++active;
+    start([=]() {
+        try {
+            queue->drain();
+        }
+        catch(...) {
+            fail(std::current_exception());
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        release();
+    });
+}
+
+std::map<std::string, ThreadedPipeline::Stats> const & ThreadedPipeline::getStats() const {
+    return stats;
+}
+
+void ThreadedPipeline::schedule(Block * block) {
+    LOG(debug) << "block ready to run name='" << block->getPath() << "'" << std::endl;
+    ++active;
+    if(threads) {
+        ready.push_back(block);
+        changed.notify_all();
+    }
+    else {
+        start([=]() { execute(block); });
+    }
+}
+
+void ThreadedPipeline::release() {
+    if(--active == 0) {
+        changed.notify_all();
+    }
+}
+
+void ThreadedPipeline::start(std::function<void()> work) {
+    running.emplace_back(std::move(work));
+}
+
+void ThreadedPipeline::work() {
+    std::unique_lock<std::mutex> guard(lock);
+    for(;;) {
+        changed.wait(guard, [&]() { return stopping || !ready.empty(); });
+        if(ready.empty()) {
+            return;
+        }
+
+        auto block = ready.front();
+        ready.pop_front();
+
+        guard.unlock();
+        execute(block);
+        guard.lock();
+    }
+}
+
+void ThreadedPipeline::execute(Block * block) {
+    bool skip;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        skip = !!failure;
+    }
+
+    double elapsed = 0;
+    if(!skip) {
+        LOG(debug) << "running block='" << block->getPath() << "'" << std::endl;
+        Date start = Date::now();
+        try {
+            block->run();
+        }
+        catch(...) {
+            fail(std::current_exception());
+        }
+
+        elapsed = Date::now().secondsSince(start);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    runTimes[block] += elapsed;
+    release();
+}
+
+void ThreadedPipeline::fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> guard(lock);
+    if(!failure) {
+        failure = error;
+    }
+
+    // unblocks whoever waits on a queue so that the run can end
+    for(auto & item : queues) {
+        item->cancel();
+    }
+}
+
+void ThreadedPipeline::collectStats() {
+    for(auto & item : runTimes) {
+        stats[item.first->getPath()].runTime = item.second;
+    }
+
+    for(auto & item : queues) {
+        auto & consumer = stats[item->getPin()->getBlock()->getPath()];
+        consumer.items += item->items;
+        consumer.busyTime += item->busyTime;
+        consumer.starvedTime += item->starvedTime;
+
+        for(auto & producer : item->getProducers()) {
+            stats[producer.block->getPath()].blockedTime += producer.blockedTime;
+        }
+    }
+
+    for(auto & item : stats) {
+        auto & value = item.second;
+        LOG(trace) << "block '" << item.first << "' ran for " << value.runTime << "s"
+                   << " handled " << value.items << " items in " << value.busyTime << "s"
+                   << " (" << (value.busyTime > 0 ? value.items / value.busyTime : 0) << " items/s)"
+                   << " starved for " << value.starvedTime << "s"
+                   << " blocked for " << value.blockedTime << "s"
+                   << std::endl;
+    }
+}
+
+ThreadedPipeline::Stats::Stats() :
+    runTime(0),
+    items(0),
+    busyTime(0),
+    starvedTime(0),
+    blockedTime(0) {
+}
+
+ThreadedPipeline::
+ThreadedConnector::ThreadedConnector(IncomingPin * incoming, OutgoingPin * outgoing) :
+    Connector(incoming, outgoing),
+    state(nullptr) {
+}
+
+void ThreadedPipeline::ThreadedConnector::push() {
+    auto incoming = getIncomingPin();
+    auto outgoing = getOutgoingPin();
+    LOG(state->pipeline->debug) << "push from '" << outgoing->getPath() << "'" << std::endl;
+    incoming->readFrom(outgoing);
+
+    auto pipeline = state->pipeline;
+    std::lock_guard<std::mutex> guard(pipeline->lock);
+    if(--state->count == 0) {
+        pipeline->schedule(state->block);
+    }
+}
@@ -0,0 +1,81 @@
+/* threaded_pipeline.h
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+*/
+
+namespace Datacratic
+{
+    struct ThreadedPipeline :
+        public Pipeline
+    {
+        // runs the blocks on a pool of that many threads, or each on its own thread
+        // when 0; the streams of pulling pins with a queue are drained on their own
+        // thread either way
+        ThreadedPipeline(int threads = 0);
+
+        void run();
+
+        Connector * createConnector(IncomingPin * incoming, OutgoingPin * outgoing);
+
+        bool isConcurrent() const;
+        void drain(std::shared_ptr<StreamQueue> queue);
+
+        struct Stats {
+            Stats();
+
+            double runTime;         // seconds spent in run()
+            uint64_t items;         // items received through queued pins
+            double busyTime;        // seconds spent handling those items
+            double starvedTime;     // seconds spent waiting for items
+            double blockedTime;     // seconds spent waiting on full queues downstream
+        };
+
+        // stats of the last run by block path
+        std::map<std::string, Stats> const & getStats() const;
+
+    private:
+        struct State {
+            ThreadedPipeline * pipeline;
+            int count;
+            Block * block;
+        };
+
+        struct ThreadedConnector :
+            public Connector
+        {
+            ThreadedConnector(IncomingPin * incoming, OutgoingPin * outgoing);
+
+            void push();
+
+            State * state;
+        };
+
+        // all of these need the lock
+        void schedule(Block * block);
+        void release();
+        void start(std::function<void()> work);
+
+        void work();
+        void execute(Block * block);
+        void fail(std::exception_ptr error);
+        void collectStats();
+
+        int threads;
+        std::set<std::shared_ptr<ThreadedConnector>> connectors;
+        std::map<Block *, State> states;
+        std::map<Block *, double> runTimes;
+        std::map<std::string, Stats> stats;
+
+        std::mutex lock;
+        std::condition_variable changed;
+        std::deque<Block *> ready;
+        std::vector<std::thread> running;
+        std::vector<std::shared_ptr<StreamQueue>> queues;
+        int active;
+        bool stopping;
+        std::exception_ptr failure;
+
+        friend struct ThreadedConnector;
+    };
+}
@@ -9,6 +9,7 @@
 
 #include "soa/service//endpoint.h"
 #include "connection_handler.h"
+#include "uring_transport.h"
 #include "ace/SOCK_Connector.h"
 
 namespace Datacratic {
@@ -286,6 +287,10 @@ struct ConnectorT : public Connector {
     virtual std::shared_ptr<TransportBase>
     makeNewTransport(EndpointBase * owner)
     {
+        // Plain sockets can be swapped for their io_uring version
+        if (std::is_same<Transport, SocketTransport>::value
+            && owner->usesIoUring())
+            return std::make_shared<UringSocketTransport>(owner);
         return ML::make_std_sp(new Transport(owner));
     }
 
@@ -6,9 +6,12 @@
 */
 
 #include <fcntl.h>
+#include <limits.h>
 #include <sys/epoll.h>
+#include <sys/uio.h>
 #include <poll.h>
 #include <unistd.h>
+#include <algorithm>
 
 #include "jml/utils/exc_assert.h"
 #include "jml/utils/file_functions.h"
@@ -24,16 +27,19 @@ AsyncWriterSource(const OnClosed & onClosed,
                   const OnReceivedData & onReceivedData,
                   const OnException & onException,
                   size_t maxMessages,
-                  size_t readBufferSize)
+                  size_t readBufferSize,
+                  size_t maxBatchSize)
     : EpollLoop(onException),
       fd_(-1),
       closing_(false),
       readBufferSize_(readBufferSize),
+      maxBatchSize_(maxBatchSize),
       writeReady_(false),
       writeReadyFlag_(false),
       queueEnabled_(false),
       queue_([&] { this->handleQueueNotification(); },
              maxMessages),
+      writesBytes_(0),
       bytesSent_(0),
       bytesReceived_(0),
       msgsSent_(0),
@@ -221,6 +227,25 @@ handleQueueNotification()
     }
 }
 
+void
+AsyncWriterSource::
+fillWrites()
+{
+    /* without batching, a message is only taken once the previous one has
+       been entirely written */
+    size_t maxBytes = max<size_t>(maxBatchSize_, 1);
+
+    auto accept = [&] (const AsyncWrite & write) {
+        if (writesBytes_ >= maxBytes || writes_.size() >= IOV_MAX
+            || (writes_.size() > 0 && writes_.back().message.empty())) {
+            return false;
+        }
+        writesBytes_ += write.message.size();
+        return true;
+    };
+    queue_.pop_front_while(writes_, accept);
+}
+
 void
 AsyncWriterSource::
 flush()
@@ -230,50 +255,49 @@ flush()
         return;
     }
 
-    auto popWrite = [&] () {
-        if (queue_.size() == 0) {
-            return false;
+    struct iovec iov[IOV_MAX];
+
+    while (true) {
+        fillWrites();
+        if (writes_.empty()) {
+            break;
         }
-        auto writes = queue_.pop_front(1);
-        ExcAssert(writes.size() > 0);
-        currentWrite_ = move(writes[0]);
-        return true;
-    };
 
-    if (currentWrite_.message.empty()) {
-        if (!popWrite()) {
-            return;
+        size_t iovCount(0);
+        for (const AsyncWrite & write: writes_) {
+            if (write.message.empty()) {
+                break;
+            }
+            iov[iovCount].iov_base = (void *) (write.message.c_str()
+                                               + write.sent);
+            iov[iovCount].iov_len = write.message.size() - write.sent;
+            iovCount++;
         }
-        if (currentWrite_.message.empty()) {
+
+        /* everything before the close request has been written */
+        if (iovCount == 0) {
             ExcAssert(closing_);
             handleClosing(false, true);
-            return;
+            break;
         }
-    }
-
-    ssize_t remaining(currentWrite_.message.size() - currentWrite_.sent);
 
-    errno = 0;
-
-    while (true) {
-        const char * data = currentWrite_.message.c_str() + currentWrite_.sent;
-        ssize_t len = ::write(fd_, data, remaining);
+        errno = 0;
+        ssize_t len = ::writev(fd_, iov, iovCount);
         if (len > 0) {
-            currentWrite_.sent += len;
-            remaining -= len;
             bytesSent_ += len;
-            if (remaining == 0) {
-                msgsSent_++;
-                handleWriteResult(0, move(currentWrite_));
-                if (!popWrite()) {
-                    break;
-                }
-                if (currentWrite_.message.empty()) {
-                    ExcAssert(closing_);
-                    handleClosing(false, true);
-                    break;
+            writesBytes_ -= len;
+            while (len > 0) {
+                AsyncWrite & write = writes_.front();
+                size_t written = min<size_t>(len,
+                                             write.message.size() - write.sent);
+                write.sent += written;
+                len -= written;
+                if (write.sent == write.message.size()) {
+                    msgsSent_++;
+                    AsyncWrite done(move(write));
+                    writes_.pop_front();
+                    handleWriteResult(0, move(done));
                 }
-                remaining = currentWrite_.message.size();
             }
         }
         else if (len < 0) {
@@ -281,8 +305,12 @@ flush()
             if (errno == EWOULDBLOCK || errno == EAGAIN) {
                 break;
             }
-            handleWriteResult(errno, move(currentWrite_));
-            if (errno == EPIPE || errno == EBADF) {
+            int error = errno;
+            AsyncWrite failed(move(writes_.front()));
+            writes_.pop_front();
+            writesBytes_ -= failed.message.size() - failed.sent;
+            handleWriteResult(error, move(failed));
+            if (error == EPIPE || error == EBADF) {
                 handleClosing(true, true);
                 break;
             }
@@ -290,7 +318,7 @@ flush()
                 /* This exception indicates a lack of code in the handling of
                    errno. In a perfect world, it should never ever be
                    thrown. */
-                throw ML::Exception(errno, "unhandled write error");
+                throw ML::Exception(error, "unhandled write error");
             }
         }
     }
@@ -349,6 +377,16 @@ emptyMessageQueue()
 {
     std::vector<std::string> messages;
 
+    /* messages taken from the queue but not entirely written, without the
+       close request */
+    for (auto & write: writes_) {
+        if (!write.message.empty()) {
+            messages.emplace_back(move(write.message));
+        }
+    }
+    writes_.clear();
+    writesBytes_ = 0;
+
     auto writes = queue_.pop_front(0);
     for (auto & write: writes) {
         messages.emplace_back(move(write.message));
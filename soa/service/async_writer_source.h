@@ -8,6 +8,7 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -47,7 +48,8 @@ struct AsyncWriteResult {
 /****************************************************************************/
 
 /* A base class enabling the asynchronous and buffered writing of data to a
- * file descriptor. */
+ * file descriptor. Queued messages are coalesced and sent with a single
+ * writev call, up to "maxBatchSize" bytes at a time. */
 
 struct AsyncWriterSource : public EpollLoop
 {
@@ -69,11 +71,15 @@ struct AsyncWriterSource : public EpollLoop
                       /* size of the message queue */
                       size_t maxMessages,
                       /* size of the read/receive buffer */
-                      size_t readBufferSize);
+                      size_t readBufferSize,
+                      /* number of bytes of queued messages to coalesce into
+                         a single syscall, 0 for one message per syscall */
+                      size_t maxBatchSize = 65536);
     virtual ~AsyncWriterSource();
 
     /* enqueue "data" for writing, provided the file descriptor is open or
-     * being opened, or throws */
+     * being opened, or throws. The buffer is moved into the queue and
+     * written from there, so passing an rvalue avoids any copy. */
     bool write(std::string data,
                const OnWriteResult & onWriteResult);
     bool write(const char * data, size_t size,
@@ -176,6 +182,10 @@ private:
     void handleReadReady();
     void handleWriteReady();
     void handleWriteResult(int error, AsyncWrite && currentWrite);
+
+    /* move messages from the queue to "writes_" until "maxBatchSize_" bytes
+       are pending */
+    void fillWrites();
     void handleClosing(bool fromPeer, bool delayedUnregistration);
 
     /* wakeup operations */
@@ -184,12 +194,17 @@ private:
     int fd_;
     std::atomic<bool> closing_;
     size_t readBufferSize_;
+    size_t maxBatchSize_;
     bool writeReady_;
     bool writeReadyFlag_;
 
     bool queueEnabled_;
     TypedMessageQueue<AsyncWrite> queue_;
-    AsyncWrite currentWrite_;
+
+    /* messages taken from the queue and being written, the first one
+       possibly in part; an empty message is a close request */
+    std::deque<AsyncWrite> writes_;
+    size_t writesBytes_;
 
     uint64_t bytesSent_;
     uint64_t bytesReceived_;
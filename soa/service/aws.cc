@@ -29,6 +29,13 @@ namespace {
 std::mutex awsCredentialsLock;
 std::map<string, std::string> awsCredentials;
 
+/* Derived V4 signing keys, by date, access key, region, service and
+   signing.  Entries for previous days are never used again, so the whole
+   cache is dropped when the date changes. */
+std::mutex signingKeysLock;
+std::string signingKeysDate;
+std::map<std::string, std::string> signingKeys;
+
 } // file scope
 
 
@@ -263,6 +270,18 @@ signingKeyV4(const std::string & accessKey,
              const std::string & service,
              const std::string & signing)
 {
+    string cacheKey = accessKey + '\0' + region + '\0' + service
+        + '\0' + signing;
+
+    {
+        unique_lock<mutex> guard(signingKeysLock);
+        if (date == signingKeysDate) {
+            auto it = signingKeys.find(cacheKey);
+            if (it != signingKeys.end())
+                return it->second;
+        }
+    }
+
     auto hmac = [&] (const std::string & key, const std::string & data)
         {
             return hmacSha256Digest(data, key);
@@ -274,6 +293,18 @@ signingKeyV4(const std::string & accessKey,
                          region),
                     service),
                signing);
+
+    unique_lock<mutex> guard(signingKeysLock);
+    if (date != signingKeysDate) {
+        // Requests signed just before midnight may still come in after the
+        // cache moved on to the next day; don't go back for them.
+        if (date < signingKeysDate)
+            return signingKey;
+        signingKeys.clear();
+        signingKeysDate = date;
+    }
+    signingKeys[cacheKey] = signingKey;
+
     return signingKey;
 }
 
@@ -402,6 +433,15 @@ addSignatureV4(BasicRequest & request,
     request.headers.push_back({"Authorization", authHeader});
 }
 
+std::shared_ptr<HttpRestProxy::ConnectionPool>
+AwsApi::
+sharedConnections()
+{
+    static std::shared_ptr<HttpRestProxy::ConnectionPool> pool
+        = std::make_shared<HttpRestProxy::ConnectionPool>();
+    return pool;
+}
+
 
 
 /*****************************************************************************/
@@ -445,7 +485,10 @@ init(const std::string & accessKeyId,
 
 AwsBasicApi::
 AwsBasicApi()
+    : numRequests(0), numRetries(0), numFailures(0),
+      created(Date::now())
 {
+    proxy.setConnectionPool(sharedConnections());
 }
 
 void
@@ -556,6 +599,10 @@ perform(const BasicRequest & request,
 {
     int retry = 0;
     for (; retry < retries;  ++retry) {
+        ++numRequests;
+        if (retry > 0)
+            ++numRetries;
+
         HttpRestProxy::Response response;
         try {
             response = proxy.perform(request.method,
@@ -581,9 +628,22 @@ perform(const BasicRequest & request,
         }
     }
 
+    ++numFailures;
     throw ML::Exception("failed request after %d retries", retries);
 }
 
+AwsBasicApi::RequestStats
+AwsBasicApi::
+getRequestStats() const
+{
+    RequestStats result;
+    result.requests = numRequests;
+    result.retries = numRetries;
+    result.failures = numFailures;
+    result.seconds = Date::now().secondsSince(created);
+    return result;
+}
+
 std::string
 AwsBasicApi::
 performGet(RestParams && params,
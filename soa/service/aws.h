@@ -6,6 +6,7 @@
 */
 
 #pragma once
+#include <atomic>
 #include <string>
 #include "http_rest_proxy.h"
 
@@ -87,7 +88,11 @@ struct AwsApi {
     /** Helper for url-escaping of resource names */
     static std::string escapeResource(const std::string & resource);
 
-    /** See http://docs.aws.amazon.com/general/latest/gr/sigv4-calculate-signature.html */
+    /** See http://docs.aws.amazon.com/general/latest/gr/sigv4-calculate-signature.html
+
+        The keys only depend on the day, so they are cached and only
+        derived once per day for each key, region and service.
+    */
     static std::string signingKeyV4(const std::string & accessKey,
                                     const std::string & date,
                                     const std::string & region,
@@ -117,6 +122,12 @@ struct AwsApi {
                    std::string accessKeyId,
                    std::string accessKey,
                    Date now = Date::now());
+
+    /** Pool of keep-alive connections shared by the AWS services of the
+        process, so that S3, SQS and SNS requests made from different
+        objects reuse the same connections.
+    */
+    static std::shared_ptr<HttpRestProxy::ConnectionPool> sharedConnections();
 };
 
 
@@ -171,7 +182,29 @@ struct AwsBasicApi : public AwsApi {
     BasicRequest signPost(RestParams && params, const std::string & resource = "");
     BasicRequest signGet(RestParams && params, const std::string & resource = "");
 
+    /** Counts of the requests made through perform(). */
+    struct RequestStats {
+        uint64_t requests;   ///< HTTP requests, including the retries
+        uint64_t retries;    ///< requests repeated after an error or a 503
+        uint64_t failures;   ///< perform() calls that threw
+        double seconds;      ///< time over which they were counted
+
+        double requestRate() const
+        {
+            return seconds > 0 ? requests / seconds : 0.0;
+        }
+    };
+
+    /** Counts since the object was created. */
+    RequestStats getRequestStats() const;
+
     HttpRestProxy proxy;
+
+private:
+    std::atomic<uint64_t> numRequests;
+    std::atomic<uint64_t> numRetries;
+    std::atomic<uint64_t> numFailures;
+    Date created;
 };
 
 /** Register an AWS access key for future referencing in urls or association
@@ -20,6 +20,8 @@
 #include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
 #include <poll.h>
+#include <cstring>
+#include <algorithm>
 
 
 using namespace std;
@@ -153,7 +155,10 @@ void
 MultiAggregator::
 recordHit(const std::string & stat)
 {
-    getAggregator(stat, createNewCounter).record(1.0);
+    StatAggregator & aggregator = getAggregator(stat, createNewCounter);
+    if (StripedCounter * counter = aggregator.hitCounter())
+        counter->add();
+    else aggregator.record(1.0);
 }
 
 void
@@ -182,9 +187,59 @@ MultiAggregator::
 recordOutcome(const std::string & stat, float value,
               const std::vector<int>& percentiles)
 {
-    getAggregator(stat, createNewOutcome, percentiles).record(value);
+    getAggregator(stat, createOutcome, this, stat, percentiles).record(value);
 }
 
+StatAggregator *
+MultiAggregator::
+createOutcome(MultiAggregator * self,
+              const std::string & stat,
+              const std::vector<int> & percentiles)
+{
+    // Called with the lock held
+    for (auto & prefix: self->sketchPrefixes) {
+        if (stat.compare(0, prefix.size(), prefix) == 0)
+            return new OutcomeSketchAggregator(percentiles);
+    }
+    return createNewOutcome(percentiles);
+}
+
+void
+MultiAggregator::
+sketchOutcomes(const std::string & statPrefix)
+{
+    std::unique_lock<Lock> guard(lock);
+    sketchPrefixes.push_back(statPrefix);
+}
+
+std::shared_ptr<StatAggregator>
+MultiAggregator::
+getStat(const std::string & stat, StatEventType type,
+        std::initializer_list<int> extra)
+{
+    switch (type) {
+    case ET_HIT:
+    case ET_COUNT:
+        getAggregator(stat, createNewCounter);
+        break;
+    case ET_STABLE_LEVEL:
+        getAggregator(stat, createNewStableLevel);
+        break;
+    case ET_LEVEL:
+        getAggregator(stat, createNewLevel);
+        break;
+    case ET_OUTCOME: {
+        const std::vector<int> percentiles(extra);
+        getAggregator(stat, createOutcome, this, stat, percentiles);
+        break;
+    }
+    default:
+        throw ML::Exception("unknown stat type %d", int(type));
+    }
+
+    std::unique_lock<Lock> guard(lock);
+    return stats[stat];
+}
 
 void
 MultiAggregator::
@@ -262,8 +317,26 @@ runDumpingThread()
         bool dumpNow = doDump.exchange(false) ||
                        (current % static_cast<size_t>(dumpInterval)) == 0;
 
-        // Now dump them without the lock held. Note that we still need to call
-        // read every second even if we're not flushing to carbon.
+        if (!dumpNow) {
+            // We still need to call read every second even if we're not
+            // flushing to carbon.
+            for (auto it = toDump.begin(), end = toDump.end(); it != end;  ++it) {
+                try {
+                    (*it)->second->read((*it)->first);
+                } catch (const std::exception & exc) {
+                    cerr << "error reading stat: " << exc.what() << endl;
+                }
+            }
+            continue;
+        }
+
+        // Now read them without the lock held.  Each read swaps out what
+        // the aggregator accumulated, and the whole lot goes out in a single
+        // call to doStat.
+        Date before = Date::now();
+        vector<StatReading> readings;
+        readings.reserve(toDump.size());
+
         for (auto it = toDump.begin(), end = toDump.end(); it != end;  ++it) {
 
             try {
@@ -271,13 +344,24 @@ runDumpingThread()
 
                 // Hack: ensures that all timestamps are consistent and that we
                 // will not have any gaps within carbon.
-                for (auto& s : stat) s.timestamp = nextWakeup;
+                for (auto& s : stat) {
+                    s.timestamp = nextWakeup;
+                    readings.push_back(std::move(s));
+                }
+            } catch (const std::exception & exc) {
+                cerr << "error reading stat: " << exc.what() << endl;
+            }
+        }
 
-                if (dumpNow) doStat(std::move(stat));
+        if (!readings.empty()) {
+            try {
+                doStat(readings);
             } catch (const std::exception & exc) {
-                cerr << "error writing stat: " << exc.what() << endl;
+                cerr << "error writing stats: " << exc.what() << endl;
             }
         }
+
+        recordLevel("stats.dumpMs", Date::now().secondsSince(before) * 1000.0);
     }
 }
 
@@ -288,6 +372,7 @@ runDumpingThread()
 
 CarbonConnector::
 CarbonConnector()
+    : protocol(PLAINTEXT), stopSending(false)
 {
 }
 
@@ -296,6 +381,7 @@ CarbonConnector(const std::string & carbonAddr,
                 const std::string & path,
                 double dumpInterval,
                 std::function<void ()> onStop)
+    : protocol(PLAINTEXT), stopSending(false)
 {
     open(carbonAddr, path, dumpInterval, onStop);
 }
@@ -305,6 +391,7 @@ CarbonConnector(const std::vector<std::string> & carbonAddrs,
                 const std::string & path,
                 double dumpInterval,
                 std::function<void ()> onStop)
+    : protocol(PLAINTEXT), stopSending(false)
 {
     open(carbonAddrs, path,dumpInterval,  onStop);
 }
@@ -333,6 +420,7 @@ open(const std::vector<std::string> & carbonAddrs,
      std::function<void ()> onStop)
 {
     stop();
+    stopSendingThread();
 
     int numConnections = 0;
 
@@ -354,6 +442,11 @@ open(const std::vector<std::string> & carbonAddrs,
     this->onPostShutdown = std::bind(&CarbonConnector::doShutdown, this);
 
     MultiAggregator::open(path, OutputFn(), dumpInterval, onStop);
+
+    stopSending = false;
+    sendingThread.reset
+        (new std::thread(std::bind(&CarbonConnector::runSendingThread,
+                                   this)));
 }
 
 void
@@ -361,9 +454,27 @@ CarbonConnector::
 doShutdown()
 {
     stop();
+    stopSendingThread();
     connections.clear();
 }
 
+void
+CarbonConnector::
+setProtocol(Protocol protocol)
+{
+    std::lock_guard<std::mutex> guard(sendLock);
+    this->protocol = protocol;
+}
+
+CarbonConnector::Protocol
+CarbonConnector::
+parseProtocol(const std::string & name)
+{
+    if (name == "plaintext") return PLAINTEXT;
+    if (name == "pickle") return PICKLE;
+    throw ML::Exception("unknown Carbon protocol '%s'", name.c_str());
+}
+
 void
 CarbonConnector::
 doStat(const std::vector<StatReading> & values) const
@@ -371,18 +482,168 @@ doStat(const std::vector<StatReading> & values) const
     if (connections.empty())
         return;
 
+    {
+        std::lock_guard<std::mutex> guard(sendLock);
+
+        // If Carbon can't keep up we lose the oldest dumps rather than
+        // letting them pile up
+        if (sendQueue.size() >= MaxQueuedDumps) {
+            cerr << "warning: Carbon is falling behind; dropping "
+                 << sendQueue.front().size() << " stats" << endl;
+            sendQueue.pop_front();
+        }
+
+        sendQueue.push_back(values);
+    }
+
+    sendCond.notify_one();
+}
+
+void
+CarbonConnector::
+runSendingThread()
+{
+    for (;;) {
+        std::vector<StatReading> values;
+        Protocol protocol;
+
+        {
+            std::unique_lock<std::mutex> guard(sendLock);
+            sendCond.wait(guard, [&] ()
+                          { return stopSending || !sendQueue.empty(); });
+
+            // Stopped, and everything that was dumped has been sent
+            if (sendQueue.empty())
+                return;
+
+            values.swap(sendQueue.front());
+            sendQueue.pop_front();
+            protocol = this->protocol;
+        }
+
+        Date before = Date::now();
+
+        std::string message = protocol == PICKLE
+            ? formatPickle(prefix, values)
+            : formatPlaintext(prefix, values);
+
+        for (unsigned i = 0;  i < connections.size();  ++i) {
+            try {
+                connections[i]->send(message);
+            } catch (const std::exception & exc) {
+                cerr << "error sending stats to Carbon at "
+                     << connections[i]->addr << ": " << exc.what() << endl;
+            }
+        }
+
+        recordLevel("carbon.sendMs", Date::now().secondsSince(before) * 1000.0);
+    }
+}
+
+void
+CarbonConnector::
+stopSendingThread()
+{
+    if (!sendingThread) return;
+
+    {
+        std::lock_guard<std::mutex> guard(sendLock);
+        stopSending = true;
+    }
+
+    sendCond.notify_all();
+
+    sendingThread->join();
+    sendingThread.reset();
+}
+
+std::string
+CarbonConnector::
+formatPlaintext(const std::string & prefix,
+                const std::vector<StatReading> & values)
+{
     std::string message;
+    message.reserve(values.size() * (prefix.size() + 64));
+
+    char buffer[64];
 
     for (unsigned i = 0;  i < values.size();  ++i) {
-        message += ML::format("%s%s %g %lld\n",
-                              prefix.c_str(), values[i].name.c_str(),
-                              values[i].value,
-                              (unsigned long long)
-                              values[i].timestamp.secondsSinceEpoch());
+        int n = snprintf(buffer, sizeof(buffer), " %g %lld\n",
+                         values[i].value,
+                         (long long)
+                         values[i].timestamp.secondsSinceEpoch());
+        message += prefix;
+        message += values[i].name;
+        message.append(buffer, n);
+    }
+
+    return message;
+}
+
+namespace {
+
+// BINUNICODE: the length in 4 little endian bytes then the UTF-8
+void pickleString(std::string & out, const std::string & prefix,
+                  const std::string & name)
+{
+    uint32_t length = prefix.size() + name.size();
+    out += 'X';
+    for (int i = 0;  i < 4;  ++i)
+        out += char(length >> (8 * i));
+    out += prefix;
+    out += name;
+}
+
+// BINFLOAT: an IEEE 754 double in 8 big endian bytes
+void pickleFloat(std::string & out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    out += 'G';
+    for (int i = 7;  i >= 0;  --i)
+        out += char(bits >> (8 * i));
+}
+
+} // file scope
+
+std::string
+CarbonConnector::
+formatPickle(const std::string & prefix,
+             const std::vector<StatReading> & values,
+             size_t maxPerMessage)
+{
+    ExcAssertGreater(maxPerMessage, 0);
+
+    std::string message;
+    message.reserve(values.size() * (prefix.size() + 64));
+
+    // Each message is [(path, (timestamp, value)), ...] pickled with
+    // protocol 2, preceded by its length in 4 big endian bytes.
+    for (size_t start = 0;  start < values.size();  start += maxPerMessage) {
+        size_t end = std::min(values.size(), start + maxPerMessage);
+
+        size_t header = message.size();
+        message.append(4, '\0');
+
+        message += "\x80\x02";  // PROTO 2
+        message += "](";        // EMPTY_LIST MARK
+
+        for (size_t i = start;  i < end;  ++i) {
+            pickleString(message, prefix, values[i].name);
+            pickleFloat(message, (long long)
+                        values[i].timestamp.secondsSinceEpoch());
+            pickleFloat(message, values[i].value);
+            message += "\x86\x86";  // TUPLE2 TUPLE2
+        }
+
+        message += "e.";  // APPENDS STOP
+
+        uint32_t length = message.size() - header - 4;
+        for (int i = 0;  i < 4;  ++i)
+            message[header + i] = char(length >> (8 * (3 - i)));
     }
 
-    for (unsigned i = 0;  i < connections.size();  ++i)
-        connections[i]->send(message);
+    return message;
 }
 
 CarbonConnector::Connection::
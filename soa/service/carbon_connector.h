@@ -13,6 +13,7 @@
 #include "jml/stats/distribution.h"
 #include "soa/types/date.h"
 #include <unordered_map>
+#include <deque>
 #include <map>
 #include <memory>
 #include <thread>
@@ -101,6 +102,23 @@ struct MultiAggregator {
     void recordOutcome(const std::string & stat, float value,
             const std::vector<int>& percentiles = DefaultOutcomePercentiles);
 
+    /** Aggregates the outcomes of the stats whose name starts with the given
+        prefix into a fixed size OutcomeSketchAggregator rather than keeping
+        all of their values, for the metrics recorded at a high rate.  An
+        empty prefix selects all of the outcomes.  Only applies to the stats
+        that are recorded for the first time afterwards.
+    */
+    void sketchOutcomes(const std::string & statPrefix);
+
+    /** Returns the aggregator of the stat, creating it for the given type
+        of event if it doesn't exist yet.  Recording directly into it saves
+        formatting and looking up the stat on each event; it stays valid for
+        as long as the pointer is held.
+    */
+    std::shared_ptr<StatAggregator>
+    getStat(const std::string & stat, StatEventType type,
+            std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
     /** Dump synchronously (taking the lock).  This should only be used in
         testing or debugging, not when connected to Carbon.
     */
@@ -136,6 +154,13 @@ private:
 
     typedef std::unordered_map<std::string, Stats::iterator> LookupCache;
 
+    // Prefixes of the outcomes that go into a sketch; protected by lock
+    std::vector<std::string> sketchPrefixes;
+
+    static StatAggregator * createOutcome(MultiAggregator * self,
+                                          const std::string & stat,
+                                          const std::vector<int> & percentiles);
+
     // Cache of lookups for each thread to avoid needing to acquire a lock
     // very much.
     boost::thread_specific_ptr<LookupCache> lookupCache;
@@ -208,6 +233,10 @@ private:
 
 /** A connector to carbon that pings it once/second and accumulates
     statistics apart from that.
+
+    The stats of each dump are handed to a thread of its own, which formats
+    and writes them to every connection in one go, so that a slow Carbon or a
+    large number of stats doesn't hold up the dumping.
 */
 
 struct CarbonConnector : public MultiAggregator {
@@ -239,13 +268,58 @@ struct CarbonConnector : public MultiAggregator {
               std::function<void ()> onStop
                   = std::function<void ()>());
 
-    /** Override for doStat to send it over to Carbon. */
+    /** Format of the messages sent to Carbon. */
+    enum Protocol {
+        PLAINTEXT,   ///< "path value timestamp" lines (port 2003)
+        PICKLE       ///< Length prefixed pickled lists (port 2004)
+    };
+
+    /** Set the format of the messages.  The default is PLAINTEXT; the
+        addresses must be those of the matching Carbon receivers.
+    */
+    void setProtocol(Protocol protocol);
+
+    /** Returns the protocol called "plaintext" or "pickle". */
+    static Protocol parseProtocol(const std::string & name);
+
+    /** Override for doStat to send it over to Carbon.  The stats are queued
+        for the sending thread.
+    */
     virtual void doStat(const std::vector<StatReading> & value) const;
 
+    /** Format the readings as plaintext lines. */
+    static std::string
+    formatPlaintext(const std::string & prefix,
+                    const std::vector<StatReading> & values);
+
+    /** Format the readings for the pickle receiver, as messages of at most
+        maxPerMessage metrics each.
+    */
+    static std::string
+    formatPickle(const std::string & prefix,
+                 const std::vector<StatReading> & values,
+                 size_t maxPerMessage = 500);
+
 private:
     // Do our own internal shutdown
     void doShutdown();
 
+    /** Thread that formats the queued dumps and sends them. */
+    void runSendingThread();
+
+    /** Send what's left in the queue and stop the sending thread. */
+    void stopSendingThread();
+
+    // Number of dumps that can wait to be sent before we drop the oldest
+    enum { MaxQueuedDumps = 16 };
+
+    Protocol protocol;
+    std::unique_ptr<std::thread> sendingThread;
+    mutable std::mutex sendLock;
+    mutable std::condition_variable sendCond;
+    mutable std::deque<std::vector<StatReading> > sendQueue;
+    bool stopSending;
+
     struct Connection {
 
         Connection(const std::string & addr)
@@ -187,6 +187,15 @@ struct ConnectionHandler {
 
     EndpointBase * get_endpoint() { return transport().get_endpoint(); }
 
+    /** Use the transport of the given handler without being associated
+        with it, for a handler that works on behalf of that one.  The
+        transport's events still go to the owner.
+    */
+    void shareTransport(ConnectionHandler & owner)
+    {
+        setTransport(&owner.transport());
+    }
+
     /** What should the return code be for the handler?  Should be zero if
         there isn't a fundamental protocol error, -1 if the connection
         should be closed (normally due to an error) and 1 if more events
@@ -9,6 +9,7 @@
 #include "soa/service//endpoint.h"
 
 #include "soa/service//http_endpoint.h"
+#include "soa/service/io_uring.h"
 #include "jml/arch/cmp_xchg.h"
 #include "jml/arch/atomic_ops.h"
 #include "jml/arch/format.h"
@@ -44,7 +45,8 @@ EndpointBase(const std::string & name)
       name_(name),
       threadsActive_(0),
       numTransports(0), shutdown_(false), disallowTimers_(false),
-      pollingMode_(MIN_CONTEXT_SWITCH_POLLING)
+      pollingMode_(MIN_CONTEXT_SWITCH_POLLING),
+      ioBackend_(EPOLL_IO)
 {
     Epoller::init(16384);
     auto wakeupData = make_shared<EpollData>(EpollData::EpollDataType::WAKEUP,
@@ -62,6 +64,13 @@ EndpointBase::
     shutdown();
 }
 
+bool
+EndpointBase::
+usesIoUring() const
+{
+    return ioBackend_ == IO_URING_IO && IoUring::available();
+}
+
 void
 EndpointBase::
 setPollingMode(enum PollingMode mode)
@@ -45,6 +45,12 @@ struct EndpointBase : public Epoller {
                                     ///< looping the CPU
     };
 
+    enum IoBackend {
+        EPOLL_IO,                   ///< Socket reads and writes on readiness
+        IO_URING_IO                 ///< Batched through an io_uring per
+                                    ///< connection, where the kernel has it
+    };
+
     EndpointBase(const std::string & name);
 
     virtual ~EndpointBase();
@@ -137,6 +143,15 @@ struct EndpointBase : public Epoller {
                        : MIN_CONTEXT_SWITCH_POLLING);
     }
 
+    /** Set how the connections of this endpoint do their I/O.  Only affects
+        connections made after the call.  IO_URING_IO falls back to
+        EPOLL_IO when the kernel doesn't support it.
+    */
+    void setIoBackend(enum IoBackend backend) { ioBackend_ = backend; }
+
+    /** Do new connections use UringSocketTransport? */
+    bool usesIoUring() const;
+
     /** Spin up the threads as part of the initialization.  NOTE: make sure that this is
         only called once; normally it will be done as part of init().  Calling directly is
         only for advanced use where init() is not called.
@@ -285,6 +300,8 @@ private:
     // Turns the polling loop into a busy loop with no sleeps.
     enum PollingMode pollingMode_;
 
+    enum IoBackend ioBackend_;
+
     std::map<std::string, int> numTransportsByHost;
 
     std::vector<double> totalSleepTime;
@@ -114,30 +114,38 @@ handleEvents(int usToWait, int nEvents,
 
     for (;;) {
         epoll_event events[nEvents];
-                
-        if (beforeSleep)
-            beforeSleep();
-
-        // Do the sleep with nanosecond resolution
-        // Let's hope it doesn't busy-wait
-        if (usToWait != 0) {
-            pollfd fd[1] = { { epoll_fd, POLLIN, 0 } };
-            timespec timeout = { 0, usToWait * 1000 };
-            int res = ppoll(fd, 1, &timeout, 0);
-            if (res == -1 && errno == EBADF) {
-                cerr << "got bad FD on sleep" << endl;
-                return -1;
+
+        // When we're busy there are events waiting already; fetch them
+        // straight away and save the sleep and its system call
+        int res = 0;
+        if (usToWait != 0)
+            res = epoll_wait(epoll_fd, events, nEvents, 0);
+
+        if (res <= 0) {
+            if (beforeSleep)
+                beforeSleep();
+
+            // Do the sleep with nanosecond resolution
+            // Let's hope it doesn't busy-wait
+            if (usToWait != 0) {
+                pollfd fd[1] = { { epoll_fd, POLLIN, 0 } };
+                timespec timeout = { 0, usToWait * 1000 };
+                int res = ppoll(fd, 1, &timeout, 0);
+                if (res == -1 && errno == EBADF) {
+                    cerr << "got bad FD on sleep" << endl;
+                    return -1;
+                }
+                if (res == -1 && errno == EINTR)
+                    continue;
+                //if (debug) cerr << "handleEvents: res = " << res << endl;
+                if (res == 0) return 0;
             }
-            if (res == -1 && errno == EINTR)
-                continue;
-            //if (debug) cerr << "handleEvents: res = " << res << endl;
-            if (res == 0) return 0;
-        }
 
-        int res = epoll_wait(epoll_fd, events, nEvents, timeout_);
+            res = epoll_wait(epoll_fd, events, nEvents, timeout_);
 
-        if (afterSleep)
-            afterSleep();
+            if (afterSleep)
+                afterSleep();
+        }
 
         // sys call interrupt
         if (res == -1 && errno == EINTR) continue;
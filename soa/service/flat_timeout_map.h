@@ -0,0 +1,291 @@
+/* flat_timeout_map.h                                              -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Open addressed map from key -> value with inbuilt timeouts.
+*/
+
+#pragma once
+
+#include "soa/types/date.h"
+#include "jml/arch/exception.h"
+#include "jml/arch/huge_page_allocator.h"
+#include "jml/utils/group_hash.h"
+#include <boost/function.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* FLAT TIMEOUT MAP                                                          */
+/*****************************************************************************/
+
+/** Drop in replacement for the parts of TimeoutMap that the router uses,
+    for the maps that hold a lot of short lived entries.
+
+    The entries live inline in an open addressed ML::Group_Hash, with their
+    timeout next to the value, instead of in a tree node plus a node of a
+    multimap of timeouts.  The timeouts are filed in a wheel of slots that
+    each cover resolution seconds: an entry's key goes in the slot of its
+    timeout, and erasing an entry leaves its key in there to be skipped
+    when the slot expires.  A timeout further out than the wheel goes
+    round in the slot it falls on until it's due.
+
+    As in any open addressed table, inserting may move the entries, which
+    invalidates the references and iterators to them.
+*/
+template<typename Key, class Value, class Hash = std::hash<Key> >
+struct FlatTimeoutMap {
+
+    FlatTimeoutMap(double resolution = 0.01, size_t numSlots = 1024)
+        : resolution(resolution), nextTick(0), started(false)
+    {
+        size_t n = 1;
+        while (n < numSlots) n *= 2;
+        slots.resize(n);
+    }
+
+    boost::function<void (const std::string & reason)> throwException;
+
+    void doThrowException(const std::string & reason) const
+    {
+        if (throwException) throwException(reason);
+        else throw ML::Exception(reason);
+        std::cerr << "FlatTimeoutMap exception thrower returned" << std::endl;
+        abort();
+    }
+
+    struct Entry : public Value {
+        Entry() : slot(0) {}
+        Entry(const Value & val, Date timeout)
+            : Value(val), timeout(timeout), slot(0)
+        {
+        }
+
+        Entry(Value && val, Date timeout)
+            : Value(std::move(val)), timeout(timeout), slot(0)
+        {
+        }
+
+        Date timeout;
+        uint32_t slot;          ///< Slot of the wheel the key was filed in
+    };
+
+    typedef ML::Huge_Page_Allocator<char> Allocator;
+
+    typedef ML::Group_Hash<Key, Entry, Hash,
+                           std::pair<Key, Entry>, std::pair<const Key, Entry>,
+                           ML::Group_Hash_PairOps<Key, Entry>,
+                           Allocator> Entries;
+
+    typedef typename Entries::iterator iterator;
+    typedef typename Entries::const_iterator const_iterator;
+
+    bool count(const Key & key) const
+    {
+        return entries.count(key);
+    }
+
+    iterator find(const Key & key)
+    {
+        return entries.find(key);
+    }
+
+    const_iterator find(const Key & key) const
+    {
+        return entries.find(key);
+    }
+
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    /** Insert the given key, value pair with the given timeout.  Throws an
+        exception if the key already exists.
+    */
+    Entry & insert(const Key & key, const Value & value, Date timeout)
+    {
+        return insertEntry(key, Entry(value, timeout));
+    }
+
+    Entry & insert(const Key & key, Value && value, Date timeout)
+    {
+        return insertEntry(key, Entry(std::move(value), timeout));
+    }
+
+    void updateTimeout(const Key & key, Date timeout)
+    {
+        auto it = entries.find(key);
+        if (it == entries.end())
+            doThrowException("FlatTimeoutMap: "
+                             "attempt to update nonexistant key");
+        it->second.timeout = timeout;
+        file(key, it->second);
+    }
+
+    /** Remove the entry for the given key.  Returns true if it was erased
+        or false otherwise.
+    */
+    bool erase(const Key & key)
+    {
+        return entries.erase(key);
+    }
+
+    void erase(const iterator & it)
+    {
+        if (it == entries.end())
+            doThrowException("erasing with invalid iterator");
+        entries.erase(it);
+    }
+
+    /** Call the callback on any which have expired.  The callback returns
+        the new timeout of the entry, or Date() for it to be removed.  It
+        may not insert into the map.
+    */
+    template<typename Callback>
+    void expire(const Callback & callback, Date now = Date::now())
+    {
+        if (!started) {
+            started = true;
+            if (entries.empty()) nextTick = tickOf(now);
+        }
+
+        int64_t nowTick = tickOf(now);
+        int64_t last = std::min<int64_t>(nowTick, nextTick + slots.size() - 1);
+
+        for (int64_t tick = nextTick;  tick <= last;  ++tick)
+            expireSlot(tick & (slots.size() - 1), now, callback);
+
+        // The current slot isn't over yet and will be gone through again
+        nextTick = std::max(nextTick, nowTick);
+    }
+
+    /** Remove any which have expired. */
+    void expire(Date now = Date::now())
+    {
+        expire([] (const Key &, const Entry &) { return Date(); }, now);
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    bool empty() const
+    {
+        return entries.empty();
+    }
+
+    void clear()
+    {
+        entries.clear();
+        for (auto & slot: slots)
+            slot.clear();
+    }
+
+    /** Makes room for the given number of entries without moving them. */
+    void reserve(size_t numEntries)
+    {
+        entries.reserve(numEntries);
+    }
+
+    /** Allocates the table and the slots from the given arena, or with
+        operator new if it's null.  The map must be empty.
+    */
+    void useArena(std::shared_ptr<ML::Huge_Page_Arena> arena)
+    {
+        if (!empty())
+            doThrowException("can't change the arena of a non-empty map");
+        entries = Entries(Allocator(arena));
+        Slots newSlots(slots.size(), Slot(KeyAllocator(arena)));
+        slots.swap(newSlots);
+    }
+
+private:
+    typedef typename Allocator::template rebind<Key>::other KeyAllocator;
+    typedef std::vector<Key, KeyAllocator> Slot;
+    typedef std::vector<Slot> Slots;
+
+    Entries entries;
+    Slots slots;
+    double resolution;       ///< Seconds covered by each slot
+    int64_t nextTick;        ///< Earliest slot that wasn't expired yet
+    bool started;            ///< Whether expire() was ever called
+
+    int64_t tickOf(Date date) const
+    {
+        return std::floor(date.secondsSinceEpoch() / resolution);
+    }
+
+    Entry & insertEntry(const Key & key, Entry && entry)
+    {
+        auto res = entries.insert(std::make_pair(key, std::move(entry)));
+        if (!res.second) {
+            std::cerr << "key = " << key << std::endl;
+            doThrowException("FlatTimeoutMap: "
+                             "attempt to re-insert existing key");
+        }
+        Entry & result = res.first->second;
+        file(key, result);
+        return result;
+    }
+
+    /** Puts the key in the slot of its entry's timeout, or in the next one
+        to expire if that's in the past.
+    */
+    void file(const Key & key, Entry & entry)
+    {
+        int64_t tick = tickOf(entry.timeout);
+        if (!started && (entries.size() == 1 || tick < nextTick))
+            nextTick = tick;
+        tick = std::max(tick, nextTick);
+
+        entry.slot = tick & (slots.size() - 1);
+        slots[entry.slot].push_back(key);
+    }
+
+    template<typename Callback>
+    void expireSlot(uint32_t slotNum, Date now, const Callback & callback)
+    {
+        // Taken out so that what's filed while we go through it goes in a
+        // fresh one
+        Slot slot(slots[slotNum].get_allocator());
+        slot.swap(slots[slotNum]);
+
+        auto keep = slot.begin();
+        for (auto it = slot.begin(), end = slot.end();  it != end;  ++it) {
+            auto found = entries.find(*it);
+
+            // Erased, or since filed somewhere else
+            if (found == entries.end() || found->second.slot != slotNum)
+                continue;
+
+            Entry & entry = found->second;
+            if (entry.timeout > now) {
+                if (keep != it) *keep = std::move(*it);
+                ++keep;
+                continue;
+            }
+
+            Date newTimeout = callback(found->first, entry);
+            if (newTimeout == Date()) {
+                entries.erase(found);
+                continue;
+            }
+
+            entry.timeout = newTimeout;
+            file(found->first, entry);
+        }
+
+        slot.erase(keep, slot.end());
+        Slot & filed = slots[slotNum];
+        if (filed.empty()) filed.swap(slot);
+        else filed.insert(filed.end(), slot.begin(), slot.end());
+    }
+};
+
+} // namespace Datacratic
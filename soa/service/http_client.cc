@@ -3,6 +3,8 @@
    Copyright (c) 2014 Datacratic.  All rights reserved.
 */
 
+#include <string.h>
+#include <strings.h>
 #include "http_client.h"
 #include "http_client_v1.h"
 #include "http_client_v2.h"
@@ -15,6 +17,34 @@ namespace {
 
 int httpClientImplVersion;
 
+/* bodies announced as larger than this are not reserved for in advance */
+const size_t MaxBodyReserve = 64 * 1024 * 1024;
+
+/* returns the value of a "Content-Length" header line, or 0 for other
+   headers */
+size_t contentLength(const char * data, size_t size)
+{
+    static const char name[] = "content-length:";
+    const size_t nameSize = sizeof(name) - 1;
+
+    if (size <= nameSize || ::strncasecmp(data, name, nameSize) != 0) {
+        return 0;
+    }
+
+    size_t result(0);
+    for (size_t i = nameSize; i < size; i++) {
+        char c = data[i];
+        if (c >= '0' && c <= '9') {
+            result = result * 10 + (c - '0');
+        }
+        else if (c != ' ' && c != '\t') {
+            break;
+        }
+    }
+
+    return result;
+}
+
 struct AtInit {
     AtInit()
     {
@@ -105,6 +135,7 @@ HttpClient(const string & baseUrl, int numParallel, int queueSize,
     enableSSLChecks(true);
     enableTcpNoDelay(false);
     enablePipelining(false);
+    enableHttp2(false);
 }
 
 void
@@ -194,7 +225,7 @@ onDone(const HttpRequest & rq, HttpClientError errorCode)
 
 HttpClientSimpleCallbacks::
 HttpClientSimpleCallbacks(const OnResponse & onResponse)
-    : onResponse_(onResponse)
+    : onResponse_(onResponse), statusCode_(0)
 {
 }
 
@@ -211,6 +242,12 @@ HttpClientSimpleCallbacks::
 onHeader(const HttpRequest & rq, const char * data, size_t size)
 {
     headers_.append(data, size);
+
+    /* size the body once rather than growing it as the data comes */
+    size_t length = contentLength(data, size);
+    if (length > 0) {
+        body_.reserve(min(length, MaxBodyReserve));
+    }
 }
 
 void
@@ -240,3 +277,240 @@ onResponse(const HttpRequest & rq,
         onResponse_(rq, error, status, move(headers), move(body));
     }
 }
+
+
+/****************************************************************************/
+/* HTTP BUFFER POOL                                                         */
+/****************************************************************************/
+
+HttpBufferPool::
+HttpBufferPool(size_t blockSize, size_t maxFreeBlocks)
+    : blockSize_(blockSize), maxFreeBlocks_(maxFreeBlocks)
+{
+    if (blockSize == 0) {
+        throw ML::Exception("'blockSize' must be positive");
+    }
+}
+
+HttpBufferPool::
+~HttpBufferPool()
+{
+    for (char * block: freeBlocks_) {
+        delete[] block;
+    }
+}
+
+shared_ptr<HttpBufferPool>
+HttpBufferPool::
+defaultPool()
+{
+    static shared_ptr<HttpBufferPool> pool = make_shared<HttpBufferPool>();
+    return pool;
+}
+
+shared_ptr<char>
+HttpBufferPool::
+allocate()
+{
+    char * block(nullptr);
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        if (!freeBlocks_.empty()) {
+            block = freeBlocks_.back();
+            freeBlocks_.pop_back();
+        }
+    }
+    if (!block) {
+        block = new char[blockSize_];
+    }
+
+    /* the block holds on to the pool until it comes back */
+    auto pool = shared_from_this();
+    return shared_ptr<char>(block, [pool] (char * block) {
+        pool->release(block);
+    });
+}
+
+size_t
+HttpBufferPool::
+freeBlocks()
+    const
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    return freeBlocks_.size();
+}
+
+void
+HttpBufferPool::
+release(char * block)
+    noexcept
+{
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        if (freeBlocks_.size() < maxFreeBlocks_) {
+            freeBlocks_.push_back(block);
+            return;
+        }
+    }
+    delete[] block;
+}
+
+
+/****************************************************************************/
+/* HTTP BODY SLICES                                                         */
+/****************************************************************************/
+
+void
+HttpBodySlices::
+append(shared_ptr<char> buffer, const char * data, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    /* extend the last slice when the data follows it in the same buffer */
+    if (!slices_.empty()) {
+        Slice & last = slices_.back();
+        if (last.buffer == buffer && last.data + last.size == data) {
+            last.size += size;
+            size_ += size;
+            return;
+        }
+    }
+
+    slices_.emplace_back(Slice{move(buffer), data, size});
+    size_ += size;
+}
+
+void
+HttpBodySlices::
+copyTo(char * dest)
+    const
+{
+    for (const Slice & slice: slices_) {
+        ::memcpy(dest, slice.data, slice.size);
+        dest += slice.size;
+    }
+}
+
+string
+HttpBodySlices::
+toString()
+    const
+{
+    string result(size_, '\0');
+    if (size_ > 0) {
+        copyTo(&result[0]);
+    }
+
+    return result;
+}
+
+
+/****************************************************************************/
+/* HTTP CLIENT SLICE CALLBACKS                                              */
+/****************************************************************************/
+
+HttpClientSliceCallbacks::
+HttpClientSliceCallbacks(const OnResponse & onResponse,
+                         shared_ptr<HttpBufferPool> pool)
+    : onResponse_(onResponse),
+      pool_(pool ? pool : HttpBufferPool::defaultPool()),
+      userBuffer_(nullptr), userCapacity_(0),
+      blockStart_(nullptr), blockPos_(nullptr), blockEnd_(nullptr),
+      statusCode_(0)
+{
+}
+
+void
+HttpClientSliceCallbacks::
+setBuffer(char * buffer, size_t capacity)
+{
+    userBuffer_ = buffer;
+    userCapacity_ = capacity;
+}
+
+void
+HttpClientSliceCallbacks::
+onResponseStart(const HttpRequest & rq,
+                const string & httpVersion, int code)
+{
+    statusCode_ = code;
+}
+
+void
+HttpClientSliceCallbacks::
+onHeader(const HttpRequest & rq, const char * data, size_t size)
+{
+    headers_.append(data, size);
+}
+
+void
+HttpClientSliceCallbacks::
+onData(const HttpRequest & rq, const char * data, size_t size)
+{
+    /* the caller's buffer first, as long as it has room */
+    if (userCapacity_ > 0) {
+        size_t chunkSize = min(size, userCapacity_);
+        ::memcpy(userBuffer_, data, chunkSize);
+        body_.append(nullptr, userBuffer_, chunkSize);
+        userBuffer_ += chunkSize;
+        userCapacity_ -= chunkSize;
+        data += chunkSize;
+        size -= chunkSize;
+    }
+
+    while (size > 0) {
+        if (blockPos_ == blockEnd_) {
+            flushBlock();
+            block_ = pool_->allocate();
+            blockStart_ = blockPos_ = block_.get();
+            blockEnd_ = blockStart_ + pool_->blockSize();
+        }
+
+        size_t chunkSize = min(size, size_t(blockEnd_ - blockPos_));
+        ::memcpy(blockPos_, data, chunkSize);
+        blockPos_ += chunkSize;
+        data += chunkSize;
+        size -= chunkSize;
+    }
+}
+
+void
+HttpClientSliceCallbacks::
+flushBlock()
+{
+    /* a block makes a single slice, however many chunks it received */
+    if (block_) {
+        body_.append(move(block_), blockStart_, blockPos_ - blockStart_);
+        block_.reset();
+    }
+    blockStart_ = blockPos_ = blockEnd_ = nullptr;
+}
+
+void
+HttpClientSliceCallbacks::
+onDone(const HttpRequest & rq, HttpClientError error)
+{
+    flushBlock();
+
+    /* the caller's buffer only serves a single response */
+    userBuffer_ = nullptr;
+    userCapacity_ = 0;
+
+    onResponse(rq, error, statusCode_, move(headers_), move(body_));
+    statusCode_ = 0;
+    headers_ = "";
+    body_.clear();
+}
+
+void
+HttpClientSliceCallbacks::
+onResponse(const HttpRequest & rq,
+           HttpClientError error, int status,
+           string && headers, HttpBodySlices && body)
+{
+    if (onResponse_) {
+        onResponse_(rq, error, status, move(headers), move(body));
+    }
+}
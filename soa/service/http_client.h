@@ -22,7 +22,9 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "soa/jsoncpp/value.h"
 #include "soa/service/async_event_source.h"
@@ -132,6 +134,10 @@ struct HttpClientImpl : public AsyncEventSource {
     /** Use with servers that support HTTP pipelining */
     virtual void enablePipelining(bool value) = 0;
 
+    /** Use HTTP/2, with the requests multiplexed as concurrent streams over
+     * the connections */
+    virtual void enableHttp2(bool value) = 0;
+
     /** Enqueue (or perform) the specified request */
     virtual bool enqueueRequest(const std::string & verb,
                                 const std::string & resource,
@@ -229,6 +235,16 @@ struct HttpClient : public AsyncEventSource {
         impl->enablePipelining(value);
     }
 
+    /** Use HTTP/2 and multiplex the concurrent requests over as few
+     * connections as the server allows, rather than having one request per
+     * connection at a time. "https" urls negotiate it with ALPN and fall
+     * back to HTTP/1.1, while "http" urls assume that the server speaks it.
+     * Only supported by the version 1 of the HttpClientImpl. */
+    void enableHttp2(bool value)
+    {
+        impl->enableHttp2(value);
+    }
+
     /** Performs a GET request, with "resource" as the location of the
      *  resource on the server indicated in "baseUrl". Query parameters
      *  should preferably be passed via "queryParams".
@@ -421,4 +437,160 @@ private:
     std::string body_;
 };
 
+
+/****************************************************************************/
+/* HTTP BUFFER POOL                                                         */
+/****************************************************************************/
+
+/* A thread-safe pool of fixed-size blocks that response bodies are
+ * received into. Blocks go back to the pool when the last slice referring to
+ * them is released, so that steady traffic causes no allocations. */
+
+struct HttpBufferPool : public std::enable_shared_from_this<HttpBufferPool> {
+    HttpBufferPool(size_t blockSize = 65536, size_t maxFreeBlocks = 256);
+    ~HttpBufferPool();
+
+    HttpBufferPool(const HttpBufferPool & other) = delete;
+    HttpBufferPool & operator = (const HttpBufferPool & other) = delete;
+
+    /* pool shared by the callbacks created without one */
+    static std::shared_ptr<HttpBufferPool> defaultPool();
+
+    size_t blockSize() const
+    {
+        return blockSize_;
+    }
+
+    /* returns a block of "blockSize()" bytes, owned by the returned pointer */
+    std::shared_ptr<char> allocate();
+
+    /* number of blocks kept for reuse */
+    size_t freeBlocks() const;
+
+private:
+    void release(char * block) noexcept;
+
+    size_t blockSize_;
+    size_t maxFreeBlocks_;
+
+    mutable std::mutex lock_;
+    std::vector<char *> freeBlocks_;
+};
+
+
+/****************************************************************************/
+/* HTTP BODY SLICES                                                         */
+/****************************************************************************/
+
+/* A response body, as the chain of buffer slices it was received into. The
+ * slices keep their buffers alive. */
+
+struct HttpBodySlices {
+    struct Slice {
+        std::shared_ptr<char> buffer; /* null for caller-provided buffers */
+        const char * data;
+        size_t size;
+    };
+
+    HttpBodySlices()
+        : size_(0)
+    {
+    }
+
+    /* total number of bytes in the body */
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    const std::vector<Slice> & slices() const
+    {
+        return slices_;
+    }
+
+    /* copies the body into "dest", which must have room for "size()"
+       bytes */
+    void copyTo(char * dest) const;
+
+    /* copies the body into a string */
+    std::string toString() const;
+
+    void append(std::shared_ptr<char> buffer, const char * data, size_t size);
+
+    void clear()
+    {
+        slices_.clear();
+        size_ = 0;
+    }
+
+private:
+    std::vector<Slice> slices_;
+    size_t size_;
+};
+
+
+/****************************************************************************/
+/* HTTP CLIENT SLICE CALLBACKS                                              */
+/****************************************************************************/
+
+/* This class is an alternative to HttpClientSimpleCallbacks for large
+ * responses. The body is received directly into a buffer provided by the
+ * caller, if any, and then into blocks from a HttpBufferPool, and handed
+ * over as a chain of slices. This avoids the reallocations and copies of a
+ * growing string. */
+
+struct HttpClientSliceCallbacks : public HttpClientCallbacks
+{
+    typedef std::function<void (const HttpRequest &,  /* request */
+                                HttpClientError,      /* error code */
+                                int,                  /* status code */
+                                std::string &&,       /* headers */
+                                HttpBodySlices &&)>   /* body */
+        OnResponse;
+    HttpClientSliceCallbacks(const OnResponse & onResponse = nullptr,
+                             std::shared_ptr<HttpBufferPool> pool = nullptr);
+
+    /* receives the start of the next body into "buffer". The buffer must
+     * remain valid until the slices referring to it are released. */
+    void setBuffer(char * buffer, size_t capacity);
+
+    /* HttpClientCallbacks overrides */
+    virtual void onResponseStart(const HttpRequest & rq,
+                                 const std::string & httpVersion, int code);
+    virtual void onHeader(const HttpRequest & rq,
+                          const char * data, size_t size);
+    virtual void onData(const HttpRequest & rq,
+                        const char * data, size_t size);
+    virtual void onDone(const HttpRequest & rq, HttpClientError errorCode);
+
+    virtual void onResponse(const HttpRequest & rq,
+                            HttpClientError error,
+                            int status,
+                            std::string && headers,
+                            HttpBodySlices && body);
+
+private:
+    void flushBlock();
+
+    OnResponse onResponse_;
+    std::shared_ptr<HttpBufferPool> pool_;
+
+    char * userBuffer_;
+    size_t userCapacity_;
+
+    std::shared_ptr<char> block_;    /* block being filled */
+    char * blockStart_;              /* first byte not yet in a slice */
+    char * blockPos_;                /* first free byte */
+    char * blockEnd_;
+
+    int statusCode_;
+    std::string headers_;
+    HttpBodySlices body_;
+};
+
 } // namespace Datacratic
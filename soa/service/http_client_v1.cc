@@ -70,7 +70,7 @@ translateError(CURLcode curlError)
 HttpClientV1::
 HttpClientV1(const string & baseUrl, int numParallel, int queueSize)
     : HttpClientImpl(baseUrl, numParallel, queueSize),
-      baseUrl_(baseUrl),
+      baseUrl_(baseUrl), http2_(false),
       fd_(-1),
       wakeup_(EFD_NONBLOCK | EFD_CLOEXEC),
       timerFd_(-1),
@@ -165,6 +165,21 @@ enablePipelining(bool value)
     ::curl_multi_setopt(multi_.get(), CURLMOPT_PIPELINING, value ? 1 : 0);
 }
 
+void
+HttpClientV1::
+enableHttp2(bool value)
+{
+#if LIBCURL_VERSION_NUM >= 0x073100 /* 7.49.0 */
+    http2_ = value;
+    ::curl_multi_setopt(multi_.get(), CURLMOPT_PIPELINING,
+                        value ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+#else
+    if (value) {
+        throw ML::Exception("HTTP/2 requires curl 7.49.0 or later");
+    }
+#endif
+}
+
 void
 HttpClientV1::
 addFd(int fd, bool isMod, int flags)
@@ -321,7 +336,7 @@ handleWakeupEvent()
         for (auto & request: requests) {
             HttpConnection *conn = getConnection();
             conn->request_ = move(request);
-            conn->perform(noSSLChecks_, tcpNoDelay_, debug_);
+            conn->perform(noSSLChecks_, tcpNoDelay_, http2_, debug_);
 
             CURLMcode code = ::curl_multi_add_handle(multi_.get(),
                                                      conn->easy_);
@@ -535,7 +550,7 @@ HttpConnection()
 void
 HttpClientV1::
 HttpConnection::
-perform(bool noSSLChecks, bool tcpNoDelay, bool debug)
+perform(bool noSSLChecks, bool tcpNoDelay, bool http2, bool debug)
 {
     // cerr << "* performRequest\n";
 
@@ -595,6 +610,18 @@ perform(bool noSSLChecks, bool tcpNoDelay, bool debug)
     if (tcpNoDelay) {
         easy_.add_option(CURLOPT_TCP_NODELAY, true);
     }
+#if LIBCURL_VERSION_NUM >= 0x073100 /* 7.49.0 */
+    if (http2) {
+        bool isHttps(request_->url_.compare(0, 8, "https://") == 0);
+        easy_.add_option(CURLOPT_HTTP_VERSION,
+                         isHttps
+                         ? CURL_HTTP_VERSION_2TLS
+                         : CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+        /* wait for a connection to multiplex on rather than opening a new
+           one for each request */
+        easy_.add_option(CURLOPT_PIPEWAIT, true);
+    }
+#endif
 }
 
 size_t
@@ -622,7 +649,8 @@ onCurlHeader(const char * data, size_t size)
             string version = headerLine.substr(oldTokenIdx, tokenIdx);
 
             oldTokenIdx = tokenIdx + 1;
-            tokenIdx = headerLine.find(" ", oldTokenIdx);
+            /* HTTP/2 status lines have no reason phrase */
+            tokenIdx = headerLine.find_first_of(" \r\n", oldTokenIdx);
             if (tokenIdx == string::npos || tokenIdx >= lineSize) {
                 throw ML::Exception("malformed header");
             }
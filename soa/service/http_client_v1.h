@@ -45,6 +45,7 @@ struct HttpClientV1 : public HttpClientImpl {
     void enableSSLChecks(bool value);
     void enableTcpNoDelay(bool value);
     void enablePipelining(bool value);
+    void enableHttp2(bool value);
 
     bool enqueueRequest(const std::string & verb,
                         const std::string & resource,
@@ -92,7 +93,8 @@ private:
             afterContinue_ = false;
             uploadOffset_ = 0;
         }
-        void perform(bool noSSLChecks, bool tcpNoDelay, bool debug);
+        void perform(bool noSSLChecks, bool tcpNoDelay, bool http2,
+                     bool debug);
 
         /* header and body write callbacks */
         CurlWrapper::Easy::CurlCallback onHeader_;
@@ -121,6 +123,7 @@ private:
     bool expect100Continue_;
     bool tcpNoDelay_;
     bool noSSLChecks_;
+    bool http2_;
 
     int fd_;
     ML::Wakeup_Fd wakeup_;
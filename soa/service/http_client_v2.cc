@@ -485,6 +485,15 @@ enablePipelining(bool value)
     }
 }
 
+void
+HttpClientV2::
+enableHttp2(bool value)
+{
+    if (value) {
+        throw ML::Exception("HTTP/2 is not supported");
+    }
+}
+
 bool
 HttpClientV2::
 enqueueRequest(const string & verb, const string & resource,
@@ -117,6 +117,7 @@ struct HttpClientV2 : public HttpClientImpl {
     void enableSSLChecks(bool value);
     void enableTcpNoDelay(bool value);
     void enablePipelining(bool value);
+    void enableHttp2(bool value);
 
     bool enqueueRequest(const std::string & verb,
                         const std::string & resource,
@@ -10,6 +10,8 @@
 #include "jml/utils/parse_context.h"
 #include "jml/utils/string_functions.h"
 #include "jml/utils/exc_assert.h"
+#include "jml/utils/guard.h"
+#include <deque>
 #include <fstream>
 #include <boost/make_shared.hpp>
 
@@ -25,6 +27,51 @@ namespace Datacratic {
 /* HTTP CONNECTION HANDLER                                                   */
 /*****************************************************************************/
 
+struct HttpConnectionHandler::Pipeline {
+
+    Pipeline(HttpConnectionHandler * owner, int maxRequests)
+        : owner(owner), maxRequests(maxRequests), reading(true),
+          inData(false)
+    {
+    }
+
+    /** A request in flight, in the order in which they came in. */
+    struct Request {
+        Request(std::shared_ptr<HttpConnectionHandler> handler)
+            : handler(std::move(handler)), responded(false),
+              next(NEXT_CONTINUE), hasTimer(false), cookie(0)
+        {
+        }
+
+        std::shared_ptr<HttpConnectionHandler> handler;
+
+        bool responded;                       ///< Is the response below in?
+        std::string response;
+        std::function<void ()> onSendFinished;
+        NextAction next;
+
+        bool hasTimer;
+        Date timer;
+        size_t cookie;
+    };
+
+    HttpConnectionHandler * owner;  ///< Null once the connection is gone
+    size_t maxRequests;
+    std::deque<Request> requests;
+
+    std::string pending;  ///< Received but not yet dispatched
+    bool reading;         ///< Is the connection being read from?
+    bool inData;          ///< Are we in handlePipelinedData()?
+
+    Request * find(const HttpConnectionHandler * handler)
+    {
+        for (auto & r: requests)
+            if (r.handler.get() == handler)
+                return &r;
+        return nullptr;
+    }
+};
+
 HttpConnectionHandler::
 HttpConnectionHandler()
     : readState(INVALID), httpEndpoint(0)
@@ -36,11 +83,43 @@ HttpConnectionHandler::
 onGotTransport()
 {
     this->httpEndpoint = dynamic_cast<HttpEndpoint *>(get_endpoint());
+
+    if (httpEndpoint && httpEndpoint->maxPipelinedRequests > 1)
+        pipeline = std::make_shared<Pipeline>
+            (this, httpEndpoint->maxPipelinedRequests);
     
     readState = HEADER;
     startReading();
 }
 
+void
+HttpConnectionHandler::
+onGotPipelinedRequest()
+{
+}
+
+void
+HttpConnectionHandler::
+onDisassociate()
+{
+    if (isPipelineOwner())
+        abandonPipeline();
+}
+
+bool
+HttpConnectionHandler::
+isPipelineOwner() const
+{
+    return pipeline && pipeline->owner == this;
+}
+
+bool
+HttpConnectionHandler::
+isPipelinedRequest() const
+{
+    return pipeline && pipeline->owner != this;
+}
+
 std::shared_ptr<ConnectionHandler>
 HttpConnectionHandler::
 makeNewHandlerShared()
@@ -58,6 +137,11 @@ handleData(const std::string & data)
    //cerr << "HttpConnectionHandler::handleData: got data <" << data << ">" << endl;
     //httpData.write(data.c_str(), data.length());
 
+    if (pipeline) {
+        handlePipelinedData(data);
+        return;
+    }
+
     if (headerText == "" && readState == HEADER)
         firstData = Date::now();
 
@@ -90,10 +174,20 @@ handleData(const std::string & data)
                         readState, data.c_str(), this);
     }
     
-    headerText += data;
+    // Only look for the break in what's new, plus enough of the previous
+    // data for it to straddle both.
+    string::size_type searchFrom
+        = headerText.size() > 3 ? headerText.size() - 3 : 0;
+
+    // Most requests come in a single packet; assigning shares the buffer
+    // instead of copying it.
+    if (headerText.empty())
+        headerText = data;
+    else headerText += data;
+
     // The first time that we see that character sequence, it's the break
     // between the header and the data.
-    string::size_type breakPos = headerText.find("\r\n\r\n");
+    string::size_type breakPos = headerText.find("\r\n\r\n", searchFrom);
     
 
     if (breakPos == string::npos)
@@ -133,6 +227,234 @@ handleData(const std::string & data)
     handleHttpData(header.knownData);
 }
 
+void
+HttpConnectionHandler::
+handlePipelinedData(const std::string & data)
+{
+    std::shared_ptr<Pipeline> pipeline = this->pipeline;
+    Pipeline & p = *pipeline;
+
+    if (!data.empty() && p.pending.empty() && readState == HEADER)
+        firstData = Date::now();
+
+    p.pending += data;
+
+    // Responses sent whilst dispatching can make room for more requests;
+    // the loop below takes care of them.
+    if (p.inData) return;
+    p.inData = true;
+    Call_Guard guard([&] () { p.inData = false; });
+
+    size_t done = 0;
+
+    while (p.owner == this && p.requests.size() < p.maxRequests) {
+        if (readState == HEADER) {
+            string::size_type breakPos = p.pending.find("\r\n\r\n", done);
+            if (breakPos == string::npos) {
+                if (p.pending.size() - done > 16384)
+                    throw ML::Exception("HTTP header exceeds 16kb");
+                break;
+            }
+
+            header.parse(p.pending.substr(done, breakPos + 4 - done));
+
+            if (header.isChunked)
+                throw ML::Exception("chunked requests can't be pipelined");
+            if (header.contentLength == -1)
+                header.contentLength = 0;
+
+            handleHttpHeader(header);
+
+            done = breakPos + 4;
+            readState = PAYLOAD;
+        }
+
+        if (int64_t(p.pending.size() - done) < header.contentLength)
+            break;
+
+        string payload(p.pending, done, header.contentLength);
+        done += header.contentLength;
+        readState = HEADER;
+
+        dispatchPipelined(payload);
+
+        // The next one is already here if there is anything left
+        firstData = Date::now();
+    }
+
+    p.pending.erase(0, done);
+
+    // Leave the rest in the socket until there is room for it
+    if (p.owner == this && p.reading
+        && p.requests.size() >= p.maxRequests) {
+        stopReading();
+        p.reading = false;
+    }
+}
+
+void
+HttpConnectionHandler::
+dispatchPipelined(const std::string & payload)
+{
+    auto handler = std::dynamic_pointer_cast<HttpConnectionHandler>
+        (makeNewHandlerShared());
+    if (!handler)
+        throw ML::Exception("pipelined requests need an "
+                            "HttpConnectionHandler");
+
+    handler->shareTransport(*this);
+    handler->httpEndpoint = httpEndpoint;
+    handler->pipeline = pipeline;
+    handler->header = header;
+    handler->firstData = firstData;
+    handler->readState = DONE;
+
+    pipeline->requests.emplace_back(handler);
+
+    addActivityS("dispatchPipelined");
+
+    handler->onGotPipelinedRequest();
+    handler->handleHttpPayload(handler->header, payload);
+}
+
+void
+HttpConnectionHandler::
+writePipelined()
+{
+    std::shared_ptr<Pipeline> pipeline = this->pipeline;
+    Pipeline & p = *pipeline;
+
+    while (!p.requests.empty() && p.requests.front().responded) {
+        Pipeline::Request request = std::move(p.requests.front());
+        p.requests.pop_front();
+
+        // Keep the handler until its response is written
+        auto handler = request.handler;
+        auto onSendFinished = request.onSendFinished;
+        auto onWritten = [handler, onSendFinished] ()
+            {
+                if (onSendFinished)
+                    onSendFinished();
+            };
+
+        send(request.response, request.next, onWritten);
+
+        handler->onDisassociate();
+    }
+
+    if (p.owner != this) return;
+
+    schedulePipelineTimer();
+
+    if (!p.reading && p.requests.size() < p.maxRequests) {
+        p.reading = true;
+        startReading();
+        handlePipelinedData("");
+    }
+}
+
+void
+HttpConnectionHandler::
+schedulePipelineTimer()
+{
+    Date next;
+    bool hasTimer = false;
+
+    for (auto & r: pipeline->requests) {
+        if (r.hasTimer && (!hasTimer || r.timer < next)) {
+            next = r.timer;
+            hasTimer = true;
+        }
+    }
+
+    if (hasTimer)
+        scheduleTimerAbsolute(next);
+    else cancelTimer();
+}
+
+void
+HttpConnectionHandler::
+setPipelinedTimer(bool hasTimer, Date timeout, size_t cookie)
+{
+    HttpConnectionHandler * owner = pipeline->owner;
+    if (!owner) return;
+
+    // Requests that have responded don't need their timer any more
+    Pipeline::Request * request = pipeline->find(this);
+    if (!request) return;
+
+    request->hasTimer = hasTimer;
+    request->timer = timeout;
+    request->cookie = cookie;
+
+    owner->schedulePipelineTimer();
+}
+
+void
+HttpConnectionHandler::
+scheduleRequestTimer(Date timeout, size_t cookie)
+{
+    if (isPipelinedRequest())
+        setPipelinedTimer(true, timeout, cookie);
+    else scheduleTimerAbsolute(timeout, cookie);
+}
+
+void
+HttpConnectionHandler::
+cancelRequestTimer()
+{
+    if (isPipelinedRequest())
+        setPipelinedTimer(false, Date(), 0);
+    else cancelTimer();
+}
+
+void
+HttpConnectionHandler::
+handleTimeout(Date time, size_t cookie)
+{
+    if (!isPipelineOwner()) {
+        PassiveConnectionHandler::handleTimeout(time, cookie);
+        return;
+    }
+
+    std::shared_ptr<Pipeline> pipeline = this->pipeline;
+
+    Date now = Date::now();
+    if (time > now)
+        now = time;
+
+    // The handlers can respond, and so change the requests
+    vector<pair<std::shared_ptr<HttpConnectionHandler>, size_t> > due;
+    for (auto & r: pipeline->requests) {
+        if (r.hasTimer && r.timer <= now) {
+            r.hasTimer = false;
+            due.emplace_back(r.handler, r.cookie);
+        }
+    }
+
+    for (auto & d: due)
+        d.first->handleTimeout(time, d.second);
+
+    if (pipeline->owner == this)
+        schedulePipelineTimer();
+}
+
+void
+HttpConnectionHandler::
+abandonPipeline()
+{
+    std::shared_ptr<Pipeline> pipeline;
+    pipeline.swap(this->pipeline);
+
+    pipeline->owner = nullptr;
+
+    std::deque<Pipeline::Request> requests;
+    requests.swap(pipeline->requests);
+
+    for (auto & r: requests)
+        r.handler->onDisassociate();
+}
+
 void
 HttpConnectionHandler::
 handleHttpHeader(const HttpHeader & header)
@@ -172,7 +494,16 @@ handleHttpData(const std::string & data)
         if (readState != PAYLOAD)
             throw Exception("invalid state: expected payload");
 
-        payload += data;
+        // Share the buffer when the whole payload comes in one piece, which
+        // is the common case; otherwise make room for all of it up front.
+        if (payload.empty() && data.length() == header.contentLength)
+            payload = data;
+        else {
+            if (payload.empty())
+                payload.reserve(std::min<int64_t>(header.contentLength,
+                                                  1024 * 1024));
+            payload += data;
+        }
 #if 0
         cerr << "payload = " << payload << endl;
         cerr << "payload.length() = " << payload.length() << endl;
@@ -320,6 +651,8 @@ void
 HttpConnectionHandler::
 onCleanup()
 {
+    if (isPipelineOwner())
+        abandonPipeline();
 }
 
 void
@@ -328,6 +661,33 @@ putResponseOnWire(HttpResponse response,
                   std::function<void ()> onSendFinished,
                   NextAction next)
 {
+    putRenderedResponseOnWire(renderResponse(response), onSendFinished, next);
+}
+
+void
+HttpConnectionHandler::
+putRenderedResponseOnWire(const std::string & responseStr,
+                          std::function<void ()> onSendFinished,
+                          NextAction next)
+{
+    if (isPipelinedRequest()) {
+        // Goes out once the requests before it have had theirs
+        HttpConnectionHandler * owner = pipeline->owner;
+        if (!owner) return;  // the connection is gone
+
+        Pipeline::Request * request = pipeline->find(this);
+        if (!request || request->responded)
+            throw ML::Exception("second response to a pipelined request");
+
+        request->responded = true;
+        request->response = responseStr;
+        request->onSendFinished = onSendFinished;
+        request->next = next;
+
+        owner->writePipelined();
+        return;
+    }
+
     onSendFinished = [=] ()
         {
 #if 0
@@ -349,6 +709,17 @@ putResponseOnWire(HttpResponse response,
             else onSendFinished();
         };
 
+    //cerr << "sending " << responseStr << endl;
+    
+    send(responseStr,
+         next,
+         onSendFinished);
+}
+
+std::string
+HttpConnectionHandler::
+renderResponse(const HttpResponse & response)
+{
     std::string responseStr;
     responseStr.reserve(1024 + response.body.length());
 
@@ -381,11 +752,7 @@ putResponseOnWire(HttpResponse response,
     responseStr.append("\r\n");
     responseStr.append(response.body);
 
-    //cerr << "sending " << responseStr << endl;
-    
-    send(responseStr,
-         next,
-         onSendFinished);
+    return responseStr;
 }
 
 
@@ -395,7 +762,8 @@ putResponseOnWire(HttpResponse response,
 
 HttpEndpoint::
 HttpEndpoint(const std::string & name)
-    : PassiveEndpointT<SocketTransport>(name)
+    : PassiveEndpointT<SocketTransport>(name),
+      maxPipelinedRequests(1)
 {
     handlerFactory = [] ()
         {
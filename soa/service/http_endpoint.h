@@ -28,6 +28,12 @@ class HttpEndpoint;
 */
 
 struct HttpResponse {
+    /** Construct an empty response, to be assigned later. */
+    HttpResponse()
+        : responseCode(0), sendBody(false)
+    {
+    }
+
     HttpResponse(int responseCode,
                  std::string contentType,
                  std::string body,
@@ -88,6 +94,16 @@ struct HttpResponse {
     This will handle parsing the header, but will forward the data off
     to another slave handler.  It's the HTTP Endpoint's responsibility to
     generate a slave handler once a header is received.
+
+    When the endpoint allows more than one request in flight on a
+    connection, the handler of the connection parses the requests as they
+    come in and hands each one to a handler of its own from
+    makeNewHandlerShared(), without waiting for the response to the one
+    before.  The handlers of the requests share the connection's
+    transport but are never associated with it: their responses are
+    written in the order of the requests, their timers are multiplexed
+    onto the connection's timer and their onDisassociate() is called once
+    their response is on its way.  Chunked requests can't be pipelined.
 */
 
 struct HttpConnectionHandler : public PassiveConnectionHandler {
@@ -124,6 +140,22 @@ struct HttpConnectionHandler : public PassiveConnectionHandler {
 
     virtual void onGotTransport();
 
+    /** Called on the handler of a pipelined request, instead of
+        onGotTransport(), once it shares the connection's transport and
+        before it's given the request.
+    */
+    virtual void onGotPipelinedRequest();
+
+    virtual void onDisassociate();
+
+    /** Is this the handler of a connection that pipelines its requests? */
+    bool isPipelineOwner() const;
+
+    /** Is this the handler of one of the requests of a connection that
+        pipelines them?
+    */
+    bool isPipelinedRequest() const;
+
     /** Create a new connection handler.  Delegates to the endpoint.  This
         is used after a response is sent to set the connection up for a
         new request.
@@ -135,6 +167,21 @@ struct HttpConnectionHandler : public PassiveConnectionHandler {
     virtual void handleError(const std::string & message);
     virtual void onCleanup();
 
+    /** Dispatches the timers of the pipelined requests; otherwise there
+        is no timer handler.
+    */
+    virtual void handleTimeout(Date time, size_t cookie);
+
+    /** Schedule the timer of the request that we're handling.  This is
+        the transport's timer, except for a pipelined request which has a
+        share of the connection's.  As for the transport, there is only one
+        per handler.
+    */
+    void scheduleRequestTimer(Date timeout, size_t cookie = 0);
+
+    /** Cancel the timer of the request that we're handling. */
+    void cancelRequestTimer();
+
     /** Called when the HTTP header comes through.  Default will pass it
         back to the endpoint to do something with it.
     */
@@ -174,6 +221,47 @@ struct HttpConnectionHandler : public PassiveConnectionHandler {
                                    = std::function<void ()>(),
                                    NextAction next = NEXT_CONTINUE);
 
+    /** Send a response that was already rendered with renderResponse().
+        This is meant for responses that never change, which can be
+        rendered once and sent without any formatting or allocation.
+    */
+    void putRenderedResponseOnWire(const std::string & responseStr,
+                                   std::function<void ()> onSendFinished
+                                   = std::function<void ()>(),
+                                   NextAction next = NEXT_CONTINUE);
+
+    /** Format the status line, headers and body of the response as they
+        go on the wire.
+    */
+    static std::string renderResponse(const HttpResponse & response);
+
+private:
+    struct Pipeline;
+
+    /** Requests in flight on a pipelining connection, shared between the
+        handler of the connection and those of its requests.
+    */
+    std::shared_ptr<Pipeline> pipeline;
+
+    /** Parse the requests out of the data, and dispatch them until as many
+        are in flight as are allowed.
+    */
+    void handlePipelinedData(const std::string & data);
+
+    /** Hand the request that was just parsed to a new handler. */
+    void dispatchPipelined(const std::string & payload);
+
+    /** Write out the responses that are next in line. */
+    void writePipelined();
+
+    /** Point the connection's timer at the first request timer due. */
+    void schedulePipelineTimer();
+
+    /** Set or clear the timer of this pipelined request. */
+    void setPipelinedTimer(bool hasTimer, Date timeout, size_t cookie);
+
+    /** The connection is gone: finish with the requests in flight. */
+    void abandonPipeline();
 };
 
 
@@ -194,6 +282,11 @@ struct HttpEndpoint: public PassiveEndpointT<SocketTransport> {
 
     HandlerFactory handlerFactory;
 
+    /** Number of requests that can be in flight at once on a connection.
+        With more than one, the requests are pipelined.  Defaults to 1.
+    */
+    int maxPipelinedRequests;
+
     virtual std::shared_ptr<ConnectionHandler>
     makeNewHandler()
     {
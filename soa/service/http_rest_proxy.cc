@@ -27,6 +27,11 @@ namespace Datacratic {
 
 HttpRestProxy::
 ~HttpRestProxy()
+{
+}
+
+HttpRestProxy::ConnectionPool::
+~ConnectionPool()
 {
     for (auto c: inactive)
         delete c;
@@ -191,34 +196,28 @@ HttpRestProxy::Connection::
 {
     if (!conn)
         return;
-    proxy->doneConnection(conn);
+
+    std::unique_lock<std::mutex> guard(pool->lock);
+    conn->reset();
+    pool->inactive.push_back(conn);
 }
 
 HttpRestProxy::Connection
 HttpRestProxy::
 getConnection() const
 {
-    std::unique_lock<std::mutex> guard(lock);
+    std::unique_lock<std::mutex> guard(connections->lock);
 
-    if (inactive.empty()) {
-        return Connection(new CurlWrapper::Easy, const_cast<HttpRestProxy *>(this));
+    if (connections->inactive.empty()) {
+        return Connection(new CurlWrapper::Easy, connections);
     }
     else {
-        auto res = inactive.back();
-        inactive.pop_back();
-        return Connection(res, const_cast<HttpRestProxy *>(this));
+        auto res = connections->inactive.back();
+        connections->inactive.pop_back();
+        return Connection(res, connections);
     }
 }
 
-void
-HttpRestProxy::
-doneConnection(CurlWrapper::Easy * conn)
-{
-    std::unique_lock<std::mutex> guard(lock);
-    conn->reset();
-    inactive.push_back(conn);
-}
-
 
 /****************************************************************************/
 /* JSON REST PROXY                                                          */
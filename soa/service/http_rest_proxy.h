@@ -25,7 +25,8 @@ namespace Datacratic {
 
 struct HttpRestProxy {
     HttpRestProxy(const std::string & serviceUri = "")
-        : serviceUri(serviceUri), noSSLChecks(false), debug(false)
+        : serviceUri(serviceUri), noSSLChecks(false), debug(false),
+          connections(std::make_shared<ConnectionPool>())
     {
     }
 
@@ -36,6 +37,27 @@ struct HttpRestProxy {
 
     ~HttpRestProxy();
 
+    /** Pool of idle curl handles.  Each handle keeps its connections alive
+        between requests, so that requests made through any proxy sharing
+        the pool reuse them instead of setting up a new connection (and SSL
+        session) every time.
+    */
+    struct ConnectionPool {
+        ~ConnectionPool();
+
+        std::mutex lock;
+        std::vector<CurlWrapper::Easy*> inactive;
+    };
+
+    /** Use the given pool instead of this proxy's own.  Must be called
+        before any request is made.
+    */
+    void setConnectionPool(const std::shared_ptr<ConnectionPool> & pool)
+    {
+        ExcAssert(pool);
+        connections = pool;
+    }
+
     /** The response of a request.  Has a return code and a body. */
     struct Response {
         Response()
@@ -239,14 +261,10 @@ struct HttpRestProxy {
     bool debug;
 
 private:    
-    /** Lock for connection pool. */
-    mutable std::mutex lock;
-
-    /** List of inactive handles.  These can be selected from when a new
-        connection needs to be made.
+    /** Inactive handles.  These can be selected from when a new connection
+        needs to be made.
     */
-    //TODO replace with a safer storage - typedef std::shared_ptr<CurlWrapper::Easy> EasyPtr;
-    mutable std::vector<CurlWrapper::Easy*> inactive;
+    std::shared_ptr<ConnectionPool> connections;
 
     std::vector<std::string> cookies;
 
@@ -254,15 +272,15 @@ public:
     /** Get a connection. */
     struct Connection {
         Connection(CurlWrapper::Easy * conn,
-                   HttpRestProxy * proxy)
-            : conn(conn), proxy(proxy)
+                   std::shared_ptr<ConnectionPool> pool)
+            : conn(conn), pool(std::move(pool))
         {
         }
 
         ~Connection();
 
         Connection(Connection && other)
-            : conn(other.conn), proxy(other.proxy)
+            : conn(other.conn), pool(std::move(other.pool))
         {
             other.conn = 0;
         }
@@ -270,7 +288,7 @@ public:
         Connection & operator = (Connection && other)
         {
             this->conn = other.conn;
-            this->proxy = other.proxy;
+            this->pool = std::move(other.pool);
             other.conn = 0;
             return *this;
         }
@@ -279,11 +297,10 @@ public:
 
     private:
         CurlWrapper::Easy * conn;
-        HttpRestProxy * proxy;
+        std::shared_ptr<ConnectionPool> pool;
     };
 
     Connection getConnection() const;
-    void doneConnection(CurlWrapper::Easy * conn);
 };
 
 inline std::ostream &
@@ -0,0 +1,205 @@
+/* io_uring.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Minimal wrapper around the io_uring system calls.
+*/
+
+#include "io_uring.h"
+#include "jml/arch/exception.h"
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+
+using namespace std;
+
+
+namespace Datacratic {
+
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params * params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete,
+                   unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags,
+                   nullptr, 0);
+}
+
+int io_uring_register(int fd, unsigned opcode, const void * arg,
+                      unsigned numArgs)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, numArgs);
+}
+
+template<typename T>
+T * at(void * base, unsigned offset)
+{
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(base) + offset);
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* IO URING                                                                  */
+/*****************************************************************************/
+
+IoUring::
+IoUring(unsigned entries)
+    : fd_(-1), sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqes(nullptr),
+      sqeHead(0), sqeTail(0)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    fd_ = io_uring_setup(entries, &params);
+    if (fd_ == -1)
+        throw ML::Exception(errno, "io_uring_setup");
+
+    numEntries = params.sq_entries;
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes
+        + params.cq_entries * sizeof(io_uring_cqe);
+
+    // Recent kernels map both rings at once
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap)
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+    sqRing = mmap(0, sqRingSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        int error = errno;
+        close(fd_);
+        throw ML::Exception(error, "mmap of io_uring submission ring");
+    }
+
+    if (singleMap)
+        cqRing = sqRing;
+    else {
+        cqRing = mmap(0, cqRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            int error = errno;
+            munmap(sqRing, sqRingSize);
+            close(fd_);
+            throw ML::Exception(error, "mmap of io_uring completion ring");
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void * sqesMap = mmap(0, sqesSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqesMap == MAP_FAILED) {
+        int error = errno;
+        if (!singleMap) munmap(cqRing, cqRingSize);
+        munmap(sqRing, sqRingSize);
+        close(fd_);
+        throw ML::Exception(error, "mmap of io_uring submission entries");
+    }
+    sqes = reinterpret_cast<io_uring_sqe *>(sqesMap);
+
+    sqHead = at<unsigned>(sqRing, params.sq_off.head);
+    sqTail = at<unsigned>(sqRing, params.sq_off.tail);
+    sqMask = *at<unsigned>(sqRing, params.sq_off.ring_mask);
+    cqHead = at<unsigned>(cqRing, params.cq_off.head);
+    cqTail = at<unsigned>(cqRing, params.cq_off.tail);
+    cqMask = *at<unsigned>(cqRing, params.cq_off.ring_mask);
+    cqes = at<io_uring_cqe>(cqRing, params.cq_off.cqes);
+
+    // Entries are always used in order, so slot i of the ring is entry i
+    unsigned * array = at<unsigned>(sqRing, params.sq_off.array);
+    for (unsigned i = 0;  i < params.sq_entries;  ++i)
+        array[i] = i;
+
+    sqeHead = sqeTail = *sqTail;
+}
+
+IoUring::
+~IoUring()
+{
+    munmap(sqes, sqesSize);
+    if (cqRing != sqRing)
+        munmap(cqRing, cqRingSize);
+    munmap(sqRing, sqRingSize);
+    close(fd_);
+}
+
+bool
+IoUring::
+available()
+{
+    static const bool result = [] ()
+        {
+            io_uring_params params;
+            memset(&params, 0, sizeof(params));
+
+            int fd = io_uring_setup(2, &params);
+            if (fd == -1)
+                return false;
+            close(fd);
+
+            return (params.features & IORING_FEAT_FAST_POLL) != 0;
+        } ();
+
+    return result;
+}
+
+io_uring_sqe *
+IoUring::
+getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (sqeTail - head >= numEntries)
+        return nullptr;
+
+    io_uring_sqe * result = &sqes[sqeTail & sqMask];
+    memset(result, 0, sizeof(*result));
+    ++sqeTail;
+    return result;
+}
+
+int
+IoUring::
+submit(unsigned minComplete)
+{
+    unsigned toSubmit = sqeTail - sqeHead;
+    if (toSubmit == 0 && minComplete == 0)
+        return 0;
+
+    // The entries are filled in; publish them to the kernel
+    __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+
+    for (;;) {
+        int res = io_uring_enter(fd_, toSubmit, minComplete,
+                                 minComplete ? IORING_ENTER_GETEVENTS : 0);
+        if (res == -1 && errno == EINTR)
+            continue;
+        if (res == -1)
+            throw ML::Exception(errno, "io_uring_enter");
+
+        sqeHead += res;
+        return res;
+    }
+}
+
+bool
+IoUring::
+registerBuffers(const iovec * buffers, unsigned numBuffers)
+{
+    int res = io_uring_register(fd_, IORING_REGISTER_BUFFERS, buffers,
+                                numBuffers);
+    return res == 0;
+}
+
+} // namespace Datacratic
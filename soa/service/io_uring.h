@@ -0,0 +1,118 @@
+/* io_uring.h                                                      -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Minimal wrapper around the io_uring system calls.
+*/
+
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <stdint.h>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* IO URING                                                                  */
+/*****************************************************************************/
+
+/** Submission and completion queues shared with the kernel.  Operations are
+    prepared with getSqe() and handed to the kernel all at once by submit(),
+    which is a single system call whatever their number; their completions
+    are then read from memory without any system call.
+
+    The fd becomes readable when there are completions to read, so that the
+    ring can be waited on by epoll with everything else.
+
+    Not thread safe: each ring belongs to whoever owns it.
+*/
+
+struct IoUring {
+
+    /** Sets up a ring with the given number of entries.  Throws if the
+        kernel doesn't have io_uring.
+    */
+    IoUring(unsigned entries);
+
+    ~IoUring();
+
+    IoUring(const IoUring & other) = delete;
+    IoUring & operator = (const IoUring & other) = delete;
+
+    /** Tells whether the kernel has the io_uring features we need (socket
+        send and recv, from 5.7).  Only checked the first time.
+    */
+    static bool available();
+
+    int fd() const { return fd_; }
+
+    /** Returns a cleared submission entry for the next operation, or null
+        if the submission queue is full.
+    */
+    io_uring_sqe * getSqe();
+
+    /** Number of entries prepared and not yet submitted. */
+    unsigned numPrepared() const { return sqeTail - sqeHead; }
+
+    /** Submits what was prepared and waits until there are at least
+        minComplete completions to read.  Returns the number submitted.
+    */
+    int submit(unsigned minComplete = 0);
+
+    /** Calls fn(userData, res, flags) for each of the completions that are
+        there and returns how many there were.
+    */
+    template<typename Fn>
+    unsigned forEachCompletion(Fn && fn)
+    {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        unsigned result = tail - head;
+
+        for (;  head != tail;  ++head) {
+            const io_uring_cqe & cqe = cqes[head & cqMask];
+            uint64_t userData = cqe.user_data;
+            int res = cqe.res;
+            unsigned flags = cqe.flags;
+
+            // Give the entry back before the call, which may submit more
+            __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+            fn(userData, res, flags);
+        }
+
+        return result;
+    }
+
+    /** Registers buffers for the *_FIXED operations, which then save the
+        kernel mapping them on each operation.  Returns false when the
+        buffers can't be locked in memory.
+    */
+    bool registerBuffers(const iovec * buffers, unsigned numBuffers);
+
+private:
+    int fd_;
+    unsigned numEntries;
+
+    void * sqRing;
+    size_t sqRingSize;
+    void * cqRing;
+    size_t cqRingSize;
+    io_uring_sqe * sqes;
+    size_t sqesSize;
+
+    unsigned * sqTail;
+    unsigned * sqHead;
+    unsigned sqMask;
+    unsigned * cqHead;
+    unsigned * cqTail;
+    unsigned cqMask;
+    io_uring_cqe * cqes;
+
+    unsigned sqeHead;   ///< First prepared entry not yet submitted
+    unsigned sqeTail;   ///< One past the last prepared entry
+};
+
+} // namespace Datacratic
@@ -103,6 +103,12 @@ addMessageLoop(const string& name, const MessageLoop* loop)
         }
 
         lastSample = sample;
+
+        // Where the loop runs, to check that it stays where it was placed
+        int cpu = loop->lastCpu();
+        if (cpu != -1)
+            recordLevel(cpu, name + ".cpu");
+
         return load;
     };
 
@@ -42,7 +42,9 @@ MessageLoop(int numThreads, double maxAddedLatency, int epollTimeout)
     : sourceActions_([&] () { handleSourceActions(); }),
       numThreadsCreated(0),
       shutdown_(true),
-      totalSleepTime_(0.0)
+      totalSleepTime_(0.0),
+      busyPollTime_(0.0),
+      lastCpu_(-1)
 {
     init(numThreads, maxAddedLatency, epollTimeout);
 }
@@ -239,12 +241,15 @@ void
 MessageLoop::
 runWorkerThread()
 {
+    placement_.applyToCurrentThread();
+
     Date lastCheck = Date::now();
 
     ML::Duty_Cycle_Timer duty;
 
     while (!shutdown_) {
         Date start = Date::now();
+        lastCpu_ = currentCpu();
 
         if (debug_) {
             cerr << "handling events from " << sources.size()
@@ -319,6 +324,17 @@ runWorkerThread()
         // at all.
         Date end = Date::now();
 
+        // In busy poll mode we spin instead, so that new work is picked up
+        // without waiting for a wakeup.
+        if (busyPollTime_ > 0.0) {
+            Date spinEnd = end.plusSeconds(busyPollTime_);
+            bool ready = false;
+            while (!shutdown_ && !(ready = poll()) && end < spinEnd)
+                end = Date::now();
+            if (ready)
+                continue;
+        }
+
         double elapsed = end.secondsSince(start);
         double sleepTime = maxAddedLatency_ - elapsed;
 
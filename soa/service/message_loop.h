@@ -18,6 +18,7 @@
 #include "typed_message_channel.h"
 #include "logs.h"
 #include "rusage.h"
+#include "thread_placement.h"
 
 namespace Datacratic {
 
@@ -137,6 +138,28 @@ struct MessageLoop : public Epoller {
         Can be polled regularly to determine the duty cycle of the loop.
      */
     double totalSleepSeconds() const { return totalSleepTime_; }
+
+    /** Spin for up to the given number of seconds waiting for work once
+        there is none left, before going to sleep.  This burns a core but
+        saves the latency of a wakeup for loops that need it; zero (the
+        default) never spins.
+    */
+    void setBusyPollTime(double seconds) { busyPollTime_ = seconds; }
+    double busyPollTime() const { return busyPollTime_; }
+
+    /** Pin the thread of the loop as given when it starts.  Must be called
+        before start().
+    */
+    void setThreadPlacement(const ThreadPlacement & placement)
+    {
+        placement_ = placement;
+    }
+
+    const ThreadPlacement & threadPlacement() const { return placement_; }
+
+    /** Cpu that the loop was last seen running on, or -1 before it runs. */
+    int lastCpu() const { return lastCpu_; }
+
     rusage getResourceUsage() const { return resourceUsage; }
 
     void debug(bool debugOn);
@@ -212,6 +235,12 @@ private:
     */
     double maxAddedLatency_;
 
+    /** Number of seconds to spin for work before sleeping. */
+    double busyPollTime_;
+
+    ThreadPlacement placement_;
+    volatile int lastCpu_;
+
     Epoller::HandleEventResult handleEpollEvent(epoll_event & event);
     void handleSourceActions();
     void processAddSource(const SourceEntry & entry);
@@ -62,5 +62,105 @@ void syslog_probe_sink(const ProbeCtx& ctx, const std::vector<Span>& vs)
     }
 }
 
+void syslog_span_sink(uint32_t freq, const std::vector<TracedSpan>& vs)
+{
+    static auto hostname = ML::hostname();
+    static auto pid = ::getpid();
+    auto nanos = [] (Date date) {
+        return (int64_t)(date.secondsSinceEpoch() * 1000000000.0);
+    };
+    for (const auto& s: vs)
+    {
+        std::ostringstream oss;
+        oss << "{"
+        << "\"tid\":" << std::this_thread::get_id()
+        << ",\"host\":\"" << hostname << "\""
+        << ",\"kpid\":" << pid
+        << ",\"kind\":\"auction\""
+        << ",\"svc\":\"" << s.service << "\""
+        << ",\"uniq\":\"" << s.uniq << "\""
+        << ",\"freq\":" << freq
+        << ",\"pid\":-1"
+        << ",\"id\":0"
+        << ",\"tag\":\"" << s.tag << "\""
+        << ",\"t1\":" << nanos(s.start)
+        << ",\"t2\":" << nanos(s.end)
+        << "}";
+        syslog (LOG_INFO, "%s", oss.str().c_str());
+    }
+}
+
+
+/******************************************************************************/
+/* SPAN RECORDER                                                              */
+/******************************************************************************/
+
+SpanRecorder::
+SpanRecorder(uint32_t samplingFreq, size_t capacity, SpanSinkCb sink)
+    : freq_(samplingFreq), sink_(std::move(sink)), spans_(capacity),
+      recorded_(0), dropped_(0), shipped_(0), shutdown_(false)
+{
+    shippingThread_ = std::thread([=] () { this->runShippingThread(); });
+}
+
+SpanRecorder::
+~SpanRecorder()
+{
+    shutdown_ = true;
+    shippingThread_.join();
+}
+
+void
+SpanRecorder::
+record(const Id & uniq, const std::string & service,
+       const std::string & tag, Date start, Date end)
+{
+    if (!sampled(uniq)) return;
+
+    if (spans_.tryPush(TracedSpan{ uniq, service, tag, start, end }))
+        ++recorded_;
+    else ++dropped_;
+}
+
+void
+SpanRecorder::
+flush()
+{
+    uint64_t target = recorded_;
+    while (shipped_ < target)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void
+SpanRecorder::
+runShippingThread()
+{
+    enum { MaxBatch = 1024 };
+
+    std::vector<TracedSpan> batch;
+    TracedSpan span;
+
+    for (;;) {
+        bool stopping = shutdown_;
+
+        batch.clear();
+        if (spans_.tryPop(span, 0.1)) {
+            batch.emplace_back(std::move(span));
+            while (batch.size() < MaxBatch && spans_.tryPop(span))
+                batch.emplace_back(std::move(span));
+        }
+
+        if (!batch.empty()) {
+            try {
+                if (sink_) sink_(freq_, batch);
+            } catch (const std::exception & exc) {
+                std::cerr << "error shipping spans: " << exc.what()
+                          << std::endl;
+            }
+            shipped_ += batch.size();
+        }
+        else if (stopping) break;
+    }
+}
 
 } // Datacratic namespace
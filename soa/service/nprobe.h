@@ -9,14 +9,19 @@
 #define NPROBE_H_
 
 #include "jml/arch/thread_specific.h"
+#include "jml/utils/ring_buffer.h"
+#include "soa/types/id.h"
+#include "soa/types/date.h"
 
 #include <unordered_map>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <functional>
 #include <string>
 #include <stack>
 #include <vector>
+#include <thread>
 #include <tuple>
 #include <city.h>
 #include <iostream>
@@ -204,6 +209,85 @@ template <typename T>
 SinkCb
 Trace<T>::S_sink_ = syslog_probe_sink ;
 
+
+
+/******************************************************************************/
+/* TRACED SPAN                                                                */
+/******************************************************************************/
+
+/** A span that a service recorded for a sampled object, usually an auction.
+    The times are wall clock ones so that the spans recorded by the services
+    of different hosts can be put side by side.
+*/
+struct TracedSpan
+{
+    Id          uniq;       // id of the traced object
+    std::string service;    // service that recorded the span
+    std::string tag;
+    Date        start, end;
+};
+
+typedef std::function<void(uint32_t freq, const std::vector<TracedSpan>&)>
+    SpanSinkCb;
+
+// default span sink: one line per span in the format of syslog_probe_sink
+extern void syslog_span_sink(uint32_t freq, const std::vector<TracedSpan>& vs);
+
+
+/******************************************************************************/
+/* SPAN RECORDER                                                              */
+/******************************************************************************/
+
+/** Records spans of the objects that are sampled across all the services.
+
+    Whether an object is sampled only depends on its id and the sampling
+    frequency, so every service that sees an auction and has the same
+    frequency takes the same decision: the auction id that's already in all
+    the messages is the trace context.
+
+    record() is called from the hot threads: it pushes the span into a lock
+    free ring buffer and never blocks, dropping the span when the buffer is
+    full.  A thread of the recorder takes them out and hands them over to the
+    sink in batches.
+*/
+struct SpanRecorder
+{
+    SpanRecorder(uint32_t samplingFreq, size_t capacity = 16384,
+                 SpanSinkCb sink = syslog_span_sink);
+    ~SpanRecorder();
+
+    SpanRecorder(const SpanRecorder &) = delete;
+    SpanRecorder & operator = (const SpanRecorder &) = delete;
+
+    uint32_t samplingFreq() const { return freq_; }
+
+    /** Whether the spans of the object with the given id are recorded. */
+    bool sampled(const Id & uniq) const
+    {
+        return freq_ && uniq.hash() % freq_ == 0;
+    }
+
+    /** Records a span of a sampled object; does nothing if it isn't. */
+    void record(const Id & uniq, const std::string & service,
+                const std::string & tag, Date start, Date end);
+
+    /** Waits until the spans recorded so far were given to the sink. */
+    void flush();
+
+    uint64_t numRecorded() const { return recorded_; }
+    uint64_t numDropped() const { return dropped_; }
+
+private:
+    void runShippingThread();
+
+    uint32_t freq_;
+    SpanSinkCb sink_;
+    ML::RingBufferSRMW<TracedSpan> spans_;
+    std::atomic<uint64_t> recorded_, dropped_, shipped_;
+    std::atomic<bool> shutdown_;
+    std::thread shippingThread_;
+};
+
 } // Datacratic
 
 
@@ -6,6 +6,7 @@
 #include <endian.h>
 #include <arpa/inet.h>
 
+#include <algorithm>
 #include <iostream>
 #include <mutex>
 #include <vector>
@@ -45,6 +46,14 @@ NsqIdentifyPayloadDescription()
 void
 NsqClient::
 onReceivedData(const char * bufferData, size_t bufferSize)
+{
+    parseData(bufferData, bufferSize);
+    deliverMessages();
+}
+
+void
+NsqClient::
+parseData(const char * bufferData, size_t bufferSize)
 {
     const char * data;
     size_t dataSize;
@@ -77,7 +86,6 @@ onReceivedData(const char * bufferData, size_t bufferSize)
         return true;
     };
 
-    int responseHandled(0);
     while (dataSize > 0) {
         if (parserStep_ == 0) {
             if (!parseUInt32(parserRemaining_)) {
@@ -101,7 +109,6 @@ onReceivedData(const char * bufferData, size_t bufferSize)
             parserRemaining_ -= chunkSize;
             if (parserRemaining_ == 0) {
                 handleFrame();
-                responseHandled++;
                 parserStep_ = 0;
             }
             data += chunkSize;
@@ -118,7 +125,6 @@ onReceivedData(const char * bufferData, size_t bufferSize)
             }
         }
     }
-    cerr << "response handled: " + to_string(responseHandled) + "\n";
 }
 
 void
@@ -192,15 +198,59 @@ handleNsqMessage()
     double nanoDouble = (double) nanos;
     Date ts = Date::fromSecondsSinceEpoch(nanoDouble / 1000000000);
     uint16_t attempts = ntohs(*(uint16_t *) (data + 8));
-    string messageId(data + 10, 16);
-    string message(data + 26,
-                   parserFrame_.data.size() - 26);
 
-    onMessage(ts, attempts, messageId, message);
+    messages_.emplace_back();
+    NsqMessage & message = messages_.back();
+    message.timestamp = ts;
+    message.attempts = attempts;
+    message.id.assign(data + 10, 16);
+    message.body.assign(data + 26, parserFrame_.data.size() - 26);
+}
+
+void
+NsqClient::
+deliverMessages()
+{
+    if (messages_.empty()) {
+        return;
+    }
+
+    Date start = Date::now();
+    onMessages(messages_);
+    double elapsed = Date::now().secondsSince(start);
+
+    if (elapsed > 0) {
+        double rate = messages_.size() / elapsed;
+        handlerRate_ = (handlerRate_ == 0.0
+                        ? rate : 0.9 * handlerRate_ + 0.1 * rate);
+    }
+
+    remainingRdy_ -= messages_.size();
+    messages_.clear();
+
+    int target = maxRdy_;
+    if (handlerRate_ > 0.0) {
+        target = max(1, min(maxRdy_, int(handlerRate_ * rdySeconds_)));
+    }
+
+    /* topping up before running out avoids nsqd waiting for us */
+    if (remainingRdy_ <= target / 4) {
+        resetRdy(target);
+    }
+}
+
+void
+NsqClient::
+onMessages(const vector<NsqMessage> & messages)
+{
+    if (onMessages_) {
+        onMessages_(messages);
+        return;
+    }
 
-    remainingRdy_--;
-    if (remainingRdy_ == 0) {
-        resetRdy();
+    for (const NsqMessage & message: messages) {
+        onMessage(message.timestamp, message.attempts,
+                  message.id, message.body);
     }
 }
 
@@ -283,7 +333,7 @@ sub(const string & topic, const string & channel,
     unique_lock<mutex> guard(callbacksLock_);
     callbacks_.emplace(onFrame);
     forceWrite("SUB " + topic + " " + channel + "\n");
-    resetRdy();
+    resetRdy(maxRdy_);
 }
 
 void
@@ -307,6 +357,22 @@ fin(const string & messageId)
     forceWrite("FIN " + messageId + "\n");
 }
 
+void
+NsqClient::
+fin(const vector<string> & messageIds)
+{
+    string data;
+    data.reserve(messageIds.size() * 21);
+    for (const string & messageId: messageIds) {
+        data.append("FIN ");
+        data.append(messageId);
+        data.push_back('\n');
+    }
+    if (!data.empty()) {
+        forceWrite(move(data));
+    }
+}
+
 void
 NsqClient::
 rdy(int count)
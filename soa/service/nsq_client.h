@@ -61,24 +61,55 @@ struct NsqFrame {
 
 
 /****************************************************************************/
-/* NSQ CLIENT                                                               */
+/* NSQ MESSAGE                                                              */
 /****************************************************************************/
 
+struct NsqMessage {
+    Date timestamp;
+    uint16_t attempts;
+    std::string id;
+    std::string body;
+};
+
+
+/* The messages received are delivered in batches, one per read from the
+ * socket, either to the "onMessages" callback or one at a time to
+ * "onMessage". The RDY count is tuned to the rate at which the handler
+ * processes them: enough messages are kept in flight for "rdySeconds" of
+ * processing, between 1 and "maxRdy". */
+
 struct NsqClient : public TcpClient {
     typedef std::function<void (const NsqFrame &)> OnFrame;
     typedef std::function<void (Date, uint16_t,
                                 const std::string &,
                                 const std::string &)> OnMessage;
+    typedef std::function<void (const std::vector<NsqMessage> &)> OnMessages;
 
     NsqClient(OnClosed onClosed = nullptr,
               const OnMessage & onMessage = nullptr)
         : TcpClient(onClosed, nullptr, nullptr, 0),
           parserStep_(0), parserRemaining_(0),
-          onMessage_(onMessage), remainingRdy_(0)
+          onMessage_(onMessage), remainingRdy_(0),
+          maxRdy_(1000), rdySeconds_(1.0), handlerRate_(0.0)
     {
         setUseNagle(true);
     }
 
+    /* deliver the messages in batches to "onMessages" rather than one at a
+       time to the "onMessage" given to the constructor */
+    void setOnMessages(const OnMessages & onMessages)
+    {
+        onMessages_ = onMessages;
+    }
+
+    /* bounds of the RDY count and number of seconds of processing to keep
+       in flight; must be called before "sub" */
+    void setRdyTuning(int maxRdy, double rdySeconds = 1.0)
+    {
+        maxRdy_ = maxRdy;
+        rdySeconds_ = rdySeconds;
+    }
+
     TcpConnectionResult connectSync();
 
     void nop();
@@ -95,12 +126,18 @@ struct NsqClient : public TcpClient {
 
     void fin(const std::string & messageId);
 
+    /* finish all of the given messages with a single write */
+    void fin(const std::vector<std::string> & messageIds);
+
+    virtual void onMessages(const std::vector<NsqMessage> & messages);
+
     virtual void onMessage(Date ts, uint16_t attempts,
                            const std::string & messageId,
                            const std::string & message);
 
 private:
     void onReceivedData(const char * buffer, size_t bufferSize);
+    void parseData(const char * buffer, size_t bufferSize);
 
     void forceWrite(std::string data);
 
@@ -108,10 +145,14 @@ private:
     void handleCommandFrame();
     void handleNsqMessage();
 
-    void resetRdy()
+    /* deliver the messages parsed from the last read and top up the RDY
+       count if needed */
+    void deliverMessages();
+
+    void resetRdy(int count)
     {
-        remainingRdy_ = 1000;
-        rdy(1000);
+        remainingRdy_ = count;
+        rdy(count);
     }
 
     /* response parsing */
@@ -124,7 +165,13 @@ private:
     std::queue<OnFrame> callbacks_;
 
     OnMessage onMessage_;
+    OnMessages onMessages_;
+    std::vector<NsqMessage> messages_;
+
     int remainingRdy_;
+    int maxRdy_;
+    double rdySeconds_;
+    double handlerRate_; /* messages per second, averaged */
 };
 
 } // namespace Datacratic
@@ -9,6 +9,7 @@
 
 #include "jml/arch/futex.h"
 #include "soa/service//passive_endpoint.h"
+#include "soa/service/uring_transport.h"
 #include <poll.h>
 #include <boost/date_time/gregorian/gregorian.hpp>
 
@@ -25,7 +26,7 @@ namespace Datacratic {
 
 PassiveEndpoint::
 PassiveEndpoint(const std::string & name)
-    : EndpointBase(name)
+    : EndpointBase(name), numAcceptors_(1)
 {
 }
 
@@ -57,7 +58,7 @@ init(PortRange const & portRange, const std::string & hostname, int num_threads,
 
 AcceptorT<SocketTransport>::
 AcceptorT()
-    : fd(-1), endpoint(0), listening_(false)
+    : endpoint(0), listening_(false)
 {
 }
 
@@ -67,6 +68,36 @@ AcceptorT<SocketTransport>::
     closePeer();
 }
 
+int
+AcceptorT<SocketTransport>::
+makeSocket(bool reusePort)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1)
+        throw Exception("error creating socket: %s", strerror(errno));
+
+    // Avoid already bound messages for the minute after a server has exited
+    int tr = 1;
+    int res = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &tr, sizeof(int));
+
+    if (res == -1) {
+        close(fd);
+        throw Exception("error setsockopt SO_REUSEADDR: %s", strerror(errno));
+    }
+
+    if (reusePort) {
+        res = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &tr, sizeof(int));
+
+        if (res == -1) {
+            close(fd);
+            throw Exception("error setsockopt SO_REUSEPORT: %s",
+                            strerror(errno));
+        }
+    }
+
+    return fd;
+}
+
 int
 AcceptorT<SocketTransport>::
 listen(PortRange const & portRange,
@@ -80,17 +111,17 @@ listen(PortRange const & portRange,
     this->endpoint = endpoint;
     this->nameLookup = nameLookup;
 
-    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int numSockets = endpoint->numAcceptors();
+    bool reusePort = numSockets > 1;
 
-    // Avoid already bound messages for the minute after a server has exited
-    int tr = 1;
-    int res = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &tr, sizeof(int));
+    auto closeAll = [&] ()
+        {
+            for (int fd: fds) close(fd);
+            fds.clear();
+        };
 
-    if (res == -1) {
-        close(fd);
-        fd = -1;
-        throw Exception("error setsockopt SO_REUSEADDR: %s", strerror(errno));
-    }
+    int fd = makeSocket(reusePort);
+    fds.push_back(fd);
 
     const char * hostNameToUse
         = (hostname == "*" ? "0.0.0.0" : hostname.c_str());
@@ -115,24 +146,24 @@ listen(PortRange const & portRange,
          });
     
     if (port == -1) {
+        closeAll();
         throw Exception("couldn't bind to any port in range [%d,%d]", portRange.first,
                                                             portRange.last);
     }
 
     // Avoid already bound messages for the minute after a server has exited
-    res = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &tr, sizeof(int));
+    int tr = 1;
+    int res = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &tr, sizeof(int));
 
     if (res == -1) {
-        close(fd);
-        fd = -1;
+        closeAll();
         throw Exception("error setsockopt SO_REUSEADDR: %s", strerror(errno));
     }
 
     res = ::listen(fd, backlog);
 
     if (res == -1) {
-        close(fd);
-        fd = -1;
+        closeAll();
         throw Exception("error on listen: %s", strerror(errno));
     }
 
@@ -144,12 +175,38 @@ listen(PortRange const & portRange,
         addr.set(&inAddr, inAddrLen);
     }
 
+    // The other sockets join the group on the port that the first one got;
+    // the kernel then balances the new connections between all of them.
+    for (int i = 1;  i < numSockets;  ++i) {
+        int fd = makeSocket(true);
+        fds.push_back(fd);
+
+        res = ::bind(fd,
+                     reinterpret_cast<sockaddr *>(addr.get_addr()),
+                     addr.get_addr_size());
+        if (res == -1) {
+            closeAll();
+            throw Exception("listen: bind of acceptor %d returned %s",
+                            i, strerror(errno));
+        }
+
+        res = ::listen(fd, backlog);
+        if (res == -1) {
+            closeAll();
+            throw Exception("error on listen: %s", strerror(errno));
+        }
+    }
+
     listening_ = true;
     ML::futex_wake(listening_);
 
     shutdown = false;
 
-    acceptThread.reset(new boost::thread([=] () { this->runAcceptThread(); }));
+    for (int fd: fds) {
+        acceptThreads.emplace_back
+            (new boost::thread([=] () { this->runAcceptThread(fd); }));
+    }
+
     return port;
 }
 
@@ -157,18 +214,22 @@ void
 AcceptorT<SocketTransport>::
 closePeer()
 {
-    if (!acceptThread) return;
+    if (acceptThreads.empty()) return;
     shutdown = true;
 
     ML::memory_barrier();
 
+    // The threads don't read the wakeup once shut down so a single signal
+    // wakes all of them up.
     wakeup.signal();
 
-    close(fd);
-    fd = -1;
+    for (auto & thread: acceptThreads)
+        thread->join();
+    acceptThreads.clear();
 
-    acceptThread->join();
-    acceptThread.reset();
+    for (int fd: fds)
+        close(fd);
+    fds.clear();
 }
 
 std::string
@@ -200,7 +261,7 @@ struct NameEntry {
 
 void
 AcceptorT<SocketTransport>::
-runAcceptThread()
+runAcceptThread(int fd)
 {
     //static const char *fName = "AcceptorT<SocketTransport>::runAcceptThread:";
     unordered_map<string,NameEntry> addr2Name;
@@ -274,7 +335,9 @@ runAcceptThread()
              << " pointer " << endpoint << endl;
 #endif
         std::shared_ptr<SocketTransport> newTransport
-            (new SocketTransport(this->endpoint));
+            (this->endpoint->usesIoUring()
+             ? new UringSocketTransport(this->endpoint)
+             : new SocketTransport(this->endpoint));
 
         newTransport->peer_ = ACE_SOCK_Stream(res);
         string peerName = addr2.get_host_addr();
@@ -119,6 +119,21 @@ struct PassiveEndpoint: public EndpointBase {
         return acceptor->port();
     }
 
+    /** Number of listening sockets to accept connections on, each with its
+        own accept thread.  When more than one, the sockets are bound to the
+        same port with SO_REUSEPORT so that the kernel spreads the incoming
+        connections over them instead of funneling them through a single
+        accept thread.  Must be set before init() or listen().
+    */
+    void setNumAcceptors(int num)
+    {
+        if (num < 1)
+            throw ML::Exception("need at least one acceptor");
+        numAcceptors_ = num;
+    }
+
+    int numAcceptors() const { return numAcceptors_; }
+
     /** Object that can be overridden to create the connection handler to
         be associated with the transport.
     */
@@ -168,6 +183,8 @@ protected:
     template<typename Transport> friend struct AcceptorT;
     // whether or not to perform a host name look up
     bool nameLookup_;// whether or not to perform a host name look up
+
+    int numAcceptors_;
 };
 
 
@@ -205,19 +222,23 @@ struct AcceptorT<SocketTransport> : public Acceptor {
     /** What port are we listening on? */
     virtual int port() const;
 
-    /** Special thread to deal with accepting connections all by itself to
-        avoid multiplexing them on the router.
+    /** Special thread to deal with accepting connections on the given
+        listening socket all by itself to avoid multiplexing them on the
+        router.
     */
-    void runAcceptThread();
+    void runAcceptThread(int fd);
 
     /** Wait until we are ready to accept connections */
     void waitListening() const;
 
 protected:
-    std::shared_ptr<boost::thread> acceptThread;
+    /** Create a socket ready to be bound. */
+    int makeSocket(bool reusePort);
+
+    std::vector<std::shared_ptr<boost::thread> > acceptThreads;
     ML::Wakeup_Fd wakeup;
     ACE_INET_Addr addr;
-    int fd;
+    std::vector<int> fds;
     PassiveEndpoint * endpoint;
     int listening_; // whether the socket is listening
     bool nameLookup;
@@ -10,7 +10,15 @@
 
 #include "timeout_map.h"
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 #include "jml/utils/guard.h"
+#include "jml/utils/exc_check.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace Datacratic {
 
@@ -35,10 +43,34 @@ struct PendingPersistence {
                       const OnError & onError = OnError()) const = 0;
 };
 
+/** Pending entries kept in a leveldb database.
+
+    By default every put() and erase() is its own leveldb write.  Once
+    startBatching() is called they are instead gathered into a WriteBatch
+    that a background thread commits, which is much cheaper when there are
+    many of them.  The writes of the batch that hasn't been committed yet
+    are lost if the process dies; since a batch is applied entirely or not
+    at all, the database then comes back as it was at the end of an
+    earlier batch.
+*/
 struct LeveldbPendingPersistence : public PendingPersistence {
     std::shared_ptr<leveldb::DB> db;
 
-    void open(const std::string & filename)
+    LeveldbPendingPersistence()
+        : sync(false), batching(false), flushPeriod(0.0), maxBatchSize(0),
+          stopping(false)
+    {
+    }
+
+    ~LeveldbPendingPersistence()
+    {
+        stopBatching();
+    }
+
+    /** Opens the database.  If sync is set, each write (or each batch,
+        when batching) waits until it's on disk before returning.
+    */
+    void open(const std::string & filename, bool sync = false)
     {
         leveldb::DB* db;
         leveldb::Options options;
@@ -49,6 +81,53 @@ struct LeveldbPendingPersistence : public PendingPersistence {
         if (!status.ok()) {
             throw ML::Exception("Opening leveldb: " + status.ToString());
         }
+        this->sync = sync;
+    }
+
+    /** Gathers the writes into batches which are committed every
+        flushPeriod seconds, or as soon as maxBatchSize writes are waiting.
+        Note that scan() only sees what was committed.  Batching must be
+        started and stopped by the thread that owns the object, when
+        nothing else is using it.
+    */
+    void startBatching(double flushPeriod = 0.1, size_t maxBatchSize = 4096)
+    {
+        ExcCheck(db, "leveldb must be opened before batching");
+        ExcCheck(!batching, "already batching");
+        ExcCheckGreater(flushPeriod, 0.0, "invalid flush period");
+        ExcCheck(maxBatchSize > 0, "invalid batch size");
+
+        this->flushPeriod = flushPeriod;
+        this->maxBatchSize = maxBatchSize;
+        current.reset(new Batch);
+        stopping = false;
+        batching = true;
+        committer = std::thread([=] () { this->runCommitter(); });
+    }
+
+    /** Commits what's waiting and goes back to writing directly. */
+    void stopBatching()
+    {
+        if (!batching) return;
+
+        {
+            std::lock_guard<std::mutex> guard(batchLock);
+            stopping = true;
+        }
+        batchReady.notify_one();
+        committer.join();
+
+        commit();
+        batching = false;
+        current.reset();
+    }
+
+    /** Commits the writes that are waiting, returning once they're in the
+        database.  No-op unless batching.
+    */
+    void flush()
+    {
+        if (batching) commit();
     }
 
     void compact()
@@ -102,7 +181,13 @@ struct LeveldbPendingPersistence : public PendingPersistence {
 
     virtual void put(const std::string & key, const std::string & value)
     {
+        if (batching) {
+            addToBatch(key, &value);
+            return;
+        }
+
         leveldb::WriteOptions options;
+        options.sync = sync;
         leveldb::Status status = db->Put(options, key, value);
         if (!status.ok()) {
             throw ML::Exception("Writing to leveldb: " + status.ToString());
@@ -119,6 +204,22 @@ struct LeveldbPendingPersistence : public PendingPersistence {
     virtual std::string
     get(const std::string & key) const
     {
+        if (batching) {
+            std::lock_guard<std::mutex> guard(batchLock);
+
+            // Newest writes first
+            for (const Batch * batch: { current.get(), committing.get() }) {
+                if (!batch) continue;
+                auto it = batch->entries.find(key);
+                if (it == batch->entries.end()) continue;
+                if (!it->second.first) {
+                    throw ML::Exception("Writing to leveldb: "
+                            + leveldb::Status::NotFound(key).ToString());
+                }
+                return it->second.second;
+            }
+        }
+
         leveldb::ReadOptions options;
         std::string value;
         leveldb::Status status = db->Get(options, key, &value);
@@ -130,7 +231,13 @@ struct LeveldbPendingPersistence : public PendingPersistence {
 
     virtual void erase(const std::string & key)
     {
+        if (batching) {
+            addToBatch(key, nullptr);
+            return;
+        }
+
         leveldb::WriteOptions options;
+        options.sync = sync;
         leveldb::Status status = db->Delete(options, key);
         if (!status.ok()) {
             throw ML::Exception("Writing to leveldb: " + status.ToString());
@@ -176,6 +283,96 @@ struct LeveldbPendingPersistence : public PendingPersistence {
         using namespace std;
         cerr << "scanned " << numScanned << " entries" << endl;
     }
+
+private:
+
+    /** Writes waiting to be committed along with the value they leave for
+        each key, so that get() sees them; an erased key has no value.
+    */
+    struct Batch {
+        leveldb::WriteBatch writes;
+        std::unordered_map<std::string, std::pair<bool, std::string> > entries;
+        size_t numWrites = 0;
+    };
+
+    void addToBatch(const std::string & key, const std::string * value)
+    {
+        bool full;
+        {
+            std::lock_guard<std::mutex> guard(batchLock);
+            if (!commitError.empty())
+                throw ML::Exception("Writing to leveldb: " + commitError);
+
+            if (value) {
+                current->writes.Put(key, *value);
+                current->entries[key] = std::make_pair(true, *value);
+            }
+            else {
+                current->writes.Delete(key);
+                current->entries[key] = std::make_pair(false, std::string());
+            }
+            full = ++current->numWrites == maxBatchSize;
+        }
+
+        if (full) batchReady.notify_one();
+    }
+
+    void runCommitter()
+    {
+        auto period = std::chrono::microseconds(int64_t(flushPeriod * 1000000));
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> guard(batchLock);
+                batchReady.wait_for(guard, period, [&] () {
+                            return stopping
+                                || current->numWrites >= maxBatchSize;
+                        });
+                if (stopping) return;
+            }
+
+            commit();
+        }
+    }
+
+    /** Writes out the current batch.  A failed write can't be reported to
+        whoever made it, so the next one throws instead.
+    */
+    void commit()
+    {
+        std::lock_guard<std::mutex> commitGuard(commitLock);
+
+        {
+            std::lock_guard<std::mutex> guard(batchLock);
+            if (!current->numWrites) return;
+            committing = std::move(current);
+            current.reset(new Batch);
+        }
+
+        leveldb::WriteOptions options;
+        options.sync = sync;
+        leveldb::Status status = db->Write(options, &committing->writes);
+
+        std::lock_guard<std::mutex> guard(batchLock);
+        committing.reset();
+        if (!status.ok())
+            commitError = status.ToString();
+    }
+
+    bool sync;
+    bool batching;
+    double flushPeriod;
+    size_t maxBatchSize;
+
+    std::unique_ptr<Batch> current;     ///< Being filled by the writes
+    std::unique_ptr<Batch> committing;  ///< Being written by commit()
+    std::string commitError;
+    bool stopping;
+
+    mutable std::mutex batchLock;       ///< Guards the batches
+    std::mutex commitLock;              ///< One commit at a time
+    std::condition_variable batchReady;
+    std::thread committer;
 };
 
 template<typename Key, typename Value>
@@ -0,0 +1,155 @@
+/* quantile_sketch.h                                               -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Fixed size histogram that percentiles can be read from.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* QUANTILE SKETCH                                                           */
+/*****************************************************************************/
+
+/** Log-linear histogram of floats: each power of two between 2^-16 and
+    2^48 is split into 32 buckets, so a percentile read from the sketch is
+    within about 1.5% of the real value.  The bucket is taken straight from
+    the exponent and the top bits of the mantissa of the float.
+
+    Values under 2^-16, including zero and the negative ones, all go in the
+    first bucket and those over 2^48 in the last one; percentiles that fall
+    in those are reported as the minimum or the maximum.
+
+    The memory is fixed at 16kB whatever the number of values, and two
+    sketches can be merged by adding up their buckets, for example to
+    combine the sketches of several periods or of several processes.
+
+    Not thread safe; see OutcomeSketchAggregator.
+*/
+struct QuantileSketch {
+
+    enum {
+        SubBucketBits = 5,
+        SubBuckets = 1 << SubBucketBits,
+        MinExponent = -16,
+        MaxExponent = 47,
+        NumExponents = MaxExponent - MinExponent + 1,
+        NumBuckets = NumExponents * SubBuckets + 2
+    };
+
+    QuantileSketch()
+        : counts(NumBuckets)
+    {
+        clear();
+    }
+
+    void record(float value, uint64_t n = 1)
+    {
+        counts[bucketOf(value)] += n;
+        total += n;
+        sum += double(value) * n;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const QuantileSketch & other)
+    {
+        for (size_t i = 0;  i < NumBuckets;  ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void clear()
+    {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        sum = 0.0;
+        min_ = std::numeric_limits<float>::infinity();
+        max_ = -std::numeric_limits<float>::infinity();
+    }
+
+    uint64_t count() const { return total; }
+    bool empty() const { return total == 0; }
+    double mean() const { return total ? sum / total : 0.0; }
+    float min() const { return total ? min_ : 0.0; }
+    float max() const { return total ? max_ : 0.0; }
+
+    /** Returns the value that the given percentage of the values are under,
+        taking the same element of the distribution as GaugeAggregator does
+        once it has sorted its values.
+    */
+    double percentile(double outOf100) const
+    {
+        if (!total) return 0.0;
+
+        uint64_t rank = std::min<double>(total - 1, outOf100 / 100.0 * total);
+        if (rank == 0) return min_;
+        if (rank == total - 1) return max_;
+
+        uint64_t seen = 0;
+        for (size_t i = 0;  i < NumBuckets;  ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                double value = valueOf(i);
+                return std::max<double>(min_, std::min<double>(max_, value));
+            }
+        }
+        return max_;
+    }
+
+    /** Bucket of a value; monotonic in the value. */
+    static unsigned bucketOf(float value)
+    {
+        // Also catches the NaNs
+        if (!(value >= std::ldexp(1.0f, MinExponent)))
+            return 0;
+
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        int exponent = int((bits >> 23) & 0xff) - 127;
+        if (exponent > MaxExponent)
+            return NumBuckets - 1;
+
+        unsigned subBucket = (bits >> (23 - SubBucketBits)) & (SubBuckets - 1);
+        return 1 + (exponent - MinExponent) * SubBuckets + subBucket;
+    }
+
+    /** Middle of the range of values of a bucket.  The first and last
+        buckets are unbounded and return the infinities.
+    */
+    static double valueOf(unsigned bucket)
+    {
+        if (bucket == 0)
+            return -std::numeric_limits<double>::infinity();
+        if (bucket >= NumBuckets - 1)
+            return std::numeric_limits<double>::infinity();
+
+        unsigned index = bucket - 1;
+        int exponent = index / SubBuckets + MinExponent;
+        unsigned subBucket = index % SubBuckets;
+        return std::ldexp(1.0 + (subBucket + 0.5) / SubBuckets, exponent);
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    double sum;
+    float min_;
+    float max_;
+};
+
+} // namespace Datacratic
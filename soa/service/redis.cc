@@ -234,6 +234,30 @@ doDeepCopy(redisReply * r)
     return result;
 }
 
+Reply
+Reply::
+array(const std::vector<Reply> & elements)
+{
+    redisReply * result = (redisReply *)malloc(sizeof(redisReply));
+    memset(result, 0, sizeof(redisReply));
+    result->type = REDIS_REPLY_ARRAY;
+    result->element
+        = (redisReply **)malloc(elements.size() * sizeof(redisReply *));
+
+    try {
+        for (const Reply & element: elements) {
+            ExcAssert(element.r_);
+            result->element[result->elements] = doDeepCopy(element.r_.get());
+            result->elements += 1;
+        }
+    } catch (...) {
+        freeReplyObject(result);
+        throw;
+    }
+
+    return Reply(result, true);
+}
+
 std::ostream & operator << (std::ostream & stream, const Reply & reply)
 {
     return stream << reply.asString();
@@ -661,8 +685,11 @@ struct AsyncConnection::EventLoop {
 
     void startWriting()
     {
-        //cerr << "start writing" << endl;
-        //if (fds[1].events & POLLOUT) return;  // already reading
+        // Called for every command; the ones queued while a write is
+        // already pending are sent along with it without waking the loop
+        // up again.  hiredis calls this with the connection lock held, so
+        // it can't race with the loop clearing the flag.
+        if (fds[1].events & POLLOUT) return;
         fds[1].events |= POLLOUT;
         wakeup();
     }
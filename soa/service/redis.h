@@ -72,6 +72,9 @@ struct Reply {
 
     static redisReply * doDeepCopy(redisReply * r);
 
+    /** Makes an array reply out of deep copies of the given replies. */
+    static Reply array(const std::vector<Reply> & elements);
+
     operator std::string () const
     {
         return asString();
@@ -361,7 +364,14 @@ struct Address {
 /* ASYNC CONNECTION                                                          */
 /*****************************************************************************/
 
-/** Asynchronous connection to Redis. */
+/** Asynchronous connection to Redis.  Commands are pipelined: any number
+    of them can be in flight at once, and the ones queued while a write is
+    pending go out with it.
+
+    The queueing methods are virtual so that ConnectionPool and
+    ClusterConnection (see redis_cluster.h) can be used wherever a
+    connection is.
+*/
 
 struct AsyncConnection {
     
@@ -369,7 +379,7 @@ struct AsyncConnection {
     
     AsyncConnection(const Address & address);
 
-    ~AsyncConnection();
+    virtual ~AsyncConnection();
 
     void connect(const Address & address);
 
@@ -377,11 +387,11 @@ struct AsyncConnection {
         This is synchronous.  Once this method returns, it is sure that
         the connection works.
     */
-    void test();
-    void auth(std::string password);
-    void select(int database);
+    virtual void test();
+    virtual void auth(std::string password);
+    virtual void select(int database);
 
-    void close();
+    virtual void close();
 
     // Struct to specify a timeout, either absolute or relative
     struct Timeout {
@@ -409,17 +419,17 @@ struct AsyncConnection {
     /** Queue an asynchronous command with a timeout.  Returns a handle that
         can be used to cancel the command (which means ignore the result).
     */
-    int64_t queue(const Command & command,
-                  const OnResult & onResult = OnResult(),
-                  Timeout timeout = Timeout());
+    virtual int64_t queue(const Command & command,
+                          const OnResult & onResult = OnResult(),
+                          Timeout timeout = Timeout());
 
     /** Execute synchronously. */
     Result exec(const Command & command, Timeout timeout = Timeout());
 
     /** Queue a list of asynchronous commands atomically with a timeout. */
-    void queueMulti(const std::vector<Command> & commands,
-                    const OnResults & onResults = OnResults(),
-                    Timeout timeout = Timeout());
+    virtual void queueMulti(const std::vector<Command> & commands,
+                            const OnResults & onResults = OnResults(),
+                            Timeout timeout = Timeout());
     
     /** Execute multiple commands synchronously. */
     Results execMulti(const std::vector<Command> & command,
@@ -428,12 +438,12 @@ struct AsyncConnection {
     /** Cancel the given command. */
     void cancel(int handle);
     
-    size_t numRequestsPending() const
+    virtual size_t numRequestsPending() const
     {
         return requests.size();
     }
 
-    size_t numTimeoutsPending() const
+    virtual size_t numTimeoutsPending() const
     {
         return timeouts.size();
     }
@@ -0,0 +1,603 @@
+/* redis_cluster.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Pools of connections to a Redis server and routing of commands over the
+   masters of a Redis Cluster.
+*/
+
+#include "soa/service/redis_cluster.h"
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <iostream>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace Redis {
+
+namespace {
+
+/** CRC16-CCITT (XMODEM) as used by Redis Cluster. */
+struct Crc16Table {
+    Crc16Table()
+    {
+        for (unsigned i = 0;  i < 256;  ++i) {
+            uint16_t crc = i << 8;
+            for (unsigned j = 0;  j < 8;  ++j)
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+            table[i] = crc;
+        }
+    }
+
+    uint16_t operator () (const char * data, size_t len) const
+    {
+        uint16_t crc = 0;
+        for (size_t i = 0;  i < len;  ++i)
+            crc = (crc << 8) ^ table[((crc >> 8) ^ (uint8_t)data[i]) & 0xff];
+        return crc;
+    }
+
+    uint16_t table[256];
+};
+
+const Crc16Table crc16;
+
+/** Key on which a command is routed, or 0 if it doesn't have one. */
+const std::string * commandKey(const Command & command)
+{
+    return command.args.empty() ? 0 : &command.args[0];
+}
+
+/** A "MOVED <slot> <host>:<port>" or "ASK <slot> <host>:<port>" error. */
+struct Redirection {
+    bool moved;
+    int slot;
+    Address address;
+
+    bool parse(const std::string & error)
+    {
+        size_t pos;
+        if (error.compare(0, 6, "MOVED ") == 0) {
+            moved = true;
+            pos = 6;
+        }
+        else if (error.compare(0, 4, "ASK ") == 0) {
+            moved = false;
+            pos = 4;
+        }
+        else return false;
+
+        size_t space = error.find(' ', pos);
+        if (space == string::npos)
+            return false;
+
+        try {
+            slot = boost::lexical_cast<int>(error.substr(pos, space - pos));
+        } catch (const boost::bad_lexical_cast &) {
+            return false;
+        }
+        address = Address(error.substr(space + 1));
+        return slot >= 0 && slot < NUM_SLOTS && address.isTcp();
+    }
+};
+
+/** Gathers the replies of the parts of a command sent to several nodes. */
+struct Gather {
+    Gather(int numParts, const AsyncConnection::OnResult & onResult)
+        : parts(numParts), numPending(numParts), onResult(onResult)
+    {
+    }
+
+    void result(int part, const Result & result)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if (result)
+                parts[part] = result.reply();
+            else if (error.empty())
+                error = result.error();
+            if (--numPending > 0)
+                return;
+        }
+
+        if (!error.empty()) {
+            onResult(Result(error));
+            return;
+        }
+
+        try {
+            onResult(Result(finish()));
+        } catch (const std::exception & exc) {
+            onResult(Result(string("invalid reply: ") + exc.what()));
+        }
+    }
+
+    /** Puts the reply to the whole command together from those of the
+        parts. */
+    std::function<Reply ()> finish;
+
+    std::mutex lock;
+    std::vector<Reply> parts;
+    int numPending;
+    std::string error;
+    AsyncConnection::OnResult onResult;
+};
+
+} // file scope
+
+uint16_t keySlot(const std::string & key)
+{
+    const char * data = key.c_str();
+    size_t len = key.size();
+
+    size_t open = key.find('{');
+    if (open != string::npos) {
+        size_t close = key.find('}', open + 1);
+        if (close != string::npos && close > open + 1) {
+            data += open + 1;
+            len = close - open - 1;
+        }
+    }
+
+    return crc16(data, len) & (NUM_SLOTS - 1);
+}
+
+
+/*****************************************************************************/
+/* CONNECTION POOL                                                           */
+/*****************************************************************************/
+
+ConnectionPool::
+ConnectionPool(const Address & address, int numConnections,
+               const std::string & password)
+{
+    if (numConnections < 1)
+        throw ML::Exception("a connection pool needs at least one "
+                            "connection");
+
+    auto onAuth = [=] (const Result & result)
+        {
+            if (!result)
+                cerr << "couldn't authenticate redis connection to "
+                     << address.uri() << ": " << result.error() << endl;
+        };
+
+    for (int i = 0;  i < numConnections;  ++i) {
+        auto connection = std::make_shared<AsyncConnection>(address);
+        // Commands go out in order, so the ones queued from now on come
+        // after the authentication
+        if (!password.empty())
+            connection->queue(AUTH(password), onAuth);
+        connections.push_back(connection);
+    }
+}
+
+ConnectionPool::
+~ConnectionPool()
+{
+    close();
+}
+
+void
+ConnectionPool::
+auth(std::string password)
+{
+    for (auto & connection: connections)
+        connection->auth(password);
+}
+
+void
+ConnectionPool::
+select(int database)
+{
+    for (auto & connection: connections)
+        connection->select(database);
+}
+
+void
+ConnectionPool::
+close()
+{
+    for (auto & connection: connections)
+        connection->close();
+}
+
+AsyncConnection &
+ConnectionPool::
+connectionFor(const std::string & key)
+{
+    if (connections.size() == 1)
+        return *connections[0];
+    return *connections[keySlot(key) % connections.size()];
+}
+
+int64_t
+ConnectionPool::
+queue(const Command & command, const OnResult & onResult, Timeout timeout)
+{
+    const std::string * key = commandKey(command);
+    return connectionFor(key ? *key : "").queue(command, onResult, timeout);
+}
+
+void
+ConnectionPool::
+queueMulti(const std::vector<Command> & commands,
+           const OnResults & onResults,
+           Timeout timeout)
+{
+    std::string key;
+    for (const Command & command: commands) {
+        if (commandKey(command)) {
+            key = *commandKey(command);
+            break;
+        }
+    }
+
+    connectionFor(key).queueMulti(commands, onResults, timeout);
+}
+
+size_t
+ConnectionPool::
+numRequestsPending() const
+{
+    size_t result = 0;
+    for (auto & connection: connections)
+        result += connection->numRequestsPending();
+    return result;
+}
+
+size_t
+ConnectionPool::
+numTimeoutsPending() const
+{
+    size_t result = 0;
+    for (auto & connection: connections)
+        result += connection->numTimeoutsPending();
+    return result;
+}
+
+
+/*****************************************************************************/
+/* CLUSTER CONNECTION                                                        */
+/*****************************************************************************/
+
+constexpr int ClusterConnection::MaxRedirections;
+
+ClusterConnection::
+ClusterConnection(const Address & seed, int connectionsPerNode)
+    : seed(seed), connectionsPerNode(connectionsPerNode), ids(0),
+      slots(NUM_SLOTS)
+{
+    refresh();
+}
+
+ClusterConnection::
+~ClusterConnection()
+{
+    close();
+}
+
+ClusterConnection::Node
+ClusterConnection::
+getNode(const Address & address)
+{
+    Node & node = nodes[address.uri()];
+    if (!node) {
+        node = std::make_shared<ConnectionPool>(address, connectionsPerNode,
+                                                password);
+    }
+    return node;
+}
+
+ClusterConnection::Node
+ClusterConnection::
+nodeForSlot(uint16_t slot)
+{
+    std::unique_lock<std::mutex> guard(nodesLock);
+    Node node = slots[slot];
+    if (!node)
+        throw ML::Exception("no redis cluster node serves slot %d", slot);
+    return node;
+}
+
+std::vector<ClusterConnection::Node>
+ClusterConnection::
+masters()
+{
+    std::unique_lock<std::mutex> guard(nodesLock);
+
+    std::vector<Node> result;
+    for (auto & node: nodes) {
+        if (std::find(slots.begin(), slots.end(), node.second) != slots.end())
+            result.push_back(node.second);
+    }
+    return result;
+}
+
+void
+ClusterConnection::
+refresh()
+{
+    Node seedNode;
+    {
+        std::unique_lock<std::mutex> guard(nodesLock);
+        seedNode = getNode(seed);
+    }
+
+    Result result = seedNode->exec(Command("CLUSTER", "SLOTS"), 5.0);
+
+    std::vector<Node> newSlots(NUM_SLOTS);
+
+    std::unique_lock<std::mutex> guard(nodesLock);
+
+    if (!result) {
+        if (result.error().find("cluster support disabled")
+            == string::npos) {
+            throw ML::Exception("couldn't get the redis cluster slots: "
+                                + result.error());
+        }
+
+        // A plain server serves everything
+        std::fill(newSlots.begin(), newSlots.end(), seedNode);
+    }
+    else {
+        const Reply & reply = result.reply();
+        for (unsigned i = 0;  i < reply.length();  ++i) {
+            Reply range = reply[i];
+            long long first = range[0].asInt();
+            long long last = range[1].asInt();
+            if (first < 0 || last >= NUM_SLOTS || first > last)
+                throw ML::Exception("invalid redis cluster slot range");
+
+            Reply master = range[2];
+            std::string host = master[0].asString();
+            if (host.empty())
+                host = seed.tcpHost();
+
+            Node node = getNode(Address::tcp(host, master[1].asInt()));
+            std::fill(newSlots.begin() + first, newSlots.begin() + last + 1,
+                      node);
+        }
+    }
+
+    slots.swap(newSlots);
+}
+
+void
+ClusterConnection::
+auth(std::string password)
+{
+    std::vector<Node> toAuth;
+    {
+        std::unique_lock<std::mutex> guard(nodesLock);
+        this->password = password;
+        for (auto & node: nodes)
+            toAuth.push_back(node.second);
+    }
+
+    for (auto & node: toAuth)
+        node->auth(password);
+}
+
+void
+ClusterConnection::
+select(int database)
+{
+    if (database != 0)
+        throw ML::Exception("a redis cluster only has database 0");
+}
+
+void
+ClusterConnection::
+close()
+{
+    std::map<std::string, Node> toClose;
+    {
+        std::unique_lock<std::mutex> guard(nodesLock);
+        std::fill(slots.begin(), slots.end(), Node());
+        toClose.swap(nodes);
+    }
+
+    for (auto & node: toClose)
+        node.second->close();
+}
+
+size_t
+ClusterConnection::
+numNodes() const
+{
+    std::unique_lock<std::mutex> guard(nodesLock);
+    return nodes.size();
+}
+
+size_t
+ClusterConnection::
+numRequestsPending() const
+{
+    std::unique_lock<std::mutex> guard(nodesLock);
+    size_t result = 0;
+    for (auto & node: nodes)
+        result += node.second->numRequestsPending();
+    return result;
+}
+
+size_t
+ClusterConnection::
+numTimeoutsPending() const
+{
+    std::unique_lock<std::mutex> guard(nodesLock);
+    size_t result = 0;
+    for (auto & node: nodes)
+        result += node.second->numTimeoutsPending();
+    return result;
+}
+
+int64_t
+ClusterConnection::
+queue(const Command & command, const OnResult & onResult, Timeout timeout)
+{
+    if (command.formatStr == "KEYS")
+        sendToAll(command, onResult, timeout);
+    else if (command.formatStr == "MGET" && command.args.size() > 1)
+        sendSplit(command, onResult, timeout);
+    else send(command, onResult, timeout);
+
+    return ids++;
+}
+
+void
+ClusterConnection::
+queueMulti(const std::vector<Command> & commands,
+           const OnResults & onResults,
+           Timeout timeout)
+{
+    const std::string * key = 0;
+    bool transaction = false;
+    for (const Command & command: commands) {
+        if (!key)
+            key = commandKey(command);
+        if (command.formatStr == "MULTI")
+            transaction = true;
+    }
+
+    if (!transaction) {
+        AsyncConnection::queueMulti(commands, onResults, timeout);
+        return;
+    }
+
+    nodeForSlot(key ? keySlot(*key) : 0)
+        ->queueMulti(commands, onResults, timeout);
+}
+
+void
+ClusterConnection::
+send(const Command & command, const OnResult & onResult, Timeout timeout)
+{
+    const std::string * key = commandKey(command);
+    sendTo(nodeForSlot(key ? keySlot(*key) : 0), false,
+           command, onResult, timeout, MaxRedirections);
+}
+
+void
+ClusterConnection::
+sendTo(const Node & node, bool asking,
+       const Command & command, const OnResult & onResult,
+       Timeout timeout, int redirections)
+{
+    auto onNodeResult = [=] (const Result & result)
+        {
+            Redirection redirection;
+            if (result || redirections == 0
+                || !redirection.parse(result.error())) {
+                onResult(result);
+                return;
+            }
+
+            Node target;
+            {
+                std::unique_lock<std::mutex> guard(nodesLock);
+                target = this->getNode(redirection.address);
+                if (redirection.moved)
+                    slots[redirection.slot] = target;
+            }
+
+            this->sendTo(target, !redirection.moved,
+                         command, onResult, timeout, redirections - 1);
+        };
+
+    if (!asking) {
+        node->queue(command, onNodeResult, timeout);
+        return;
+    }
+
+    // The migrating slot is only served for the command following ASKING
+    auto onAskingResults = [=] (const Results & results)
+        {
+            onNodeResult(results[1]);
+        };
+
+    node->queueMulti({ Command("ASKING"), command }, onAskingResults,
+                     timeout);
+}
+
+void
+ClusterConnection::
+sendSplit(const Command & command, const OnResult & onResult,
+          Timeout timeout)
+{
+    // Position of each key in the command, by slot
+    std::map<uint16_t, std::vector<int> > bySlot;
+    for (unsigned i = 0;  i < command.args.size();  ++i)
+        bySlot[keySlot(command.args[i])].push_back(i);
+
+    if (bySlot.size() == 1) {
+        send(command, onResult, timeout);
+        return;
+    }
+
+    auto gather = std::make_shared<Gather>(bySlot.size(), onResult);
+    std::weak_ptr<Gather> weakGather = gather;
+    size_t numKeys = command.args.size();
+
+    std::vector<std::vector<int> > positions;
+    for (auto & slot: bySlot)
+        positions.push_back(slot.second);
+
+    gather->finish = [=] ()
+        {
+            auto gather = weakGather.lock();
+            std::vector<Reply> values(numKeys);
+            for (unsigned i = 0;  i < positions.size();  ++i) {
+                const Reply & part = gather->parts[i];
+                if (part.length() != positions[i].size())
+                    throw ML::Exception("wrong number of values");
+                for (unsigned j = 0;  j < positions[i].size();  ++j)
+                    values[positions[i][j]] = part[j];
+            }
+            return Reply::array(values);
+        };
+
+    for (unsigned i = 0;  i < positions.size();  ++i) {
+        Command part(command.formatStr);
+        for (int position: positions[i])
+            part.addArg(command.args[position]);
+
+        using namespace std::placeholders;
+        send(part, std::bind(&Gather::result, gather, i, _1), timeout);
+    }
+}
+
+void
+ClusterConnection::
+sendToAll(const Command & command, const OnResult & onResult,
+          Timeout timeout)
+{
+    std::vector<Node> nodes = masters();
+    if (nodes.empty())
+        throw ML::Exception("no redis cluster node to send to");
+
+    auto gather = std::make_shared<Gather>(nodes.size(), onResult);
+    std::weak_ptr<Gather> weakGather = gather;
+
+    gather->finish = [=] ()
+        {
+            auto gather = weakGather.lock();
+            std::vector<Reply> values;
+            for (const Reply & part: gather->parts) {
+                for (unsigned i = 0;  i < part.length();  ++i)
+                    values.push_back(part[i]);
+            }
+            return Reply::array(values);
+        };
+
+    for (unsigned i = 0;  i < nodes.size();  ++i) {
+        using namespace std::placeholders;
+        nodes[i]->queue(command, std::bind(&Gather::result, gather, i, _1),
+                        timeout);
+    }
+}
+
+} // namespace Redis
@@ -0,0 +1,178 @@
+/* redis_cluster.h                                                 -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Pools of connections to a Redis server and routing of commands over the
+   masters of a Redis Cluster.
+*/
+
+#pragma once
+
+#include "soa/service/redis.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace Redis {
+
+/** Number of hash slots the keys of a Redis Cluster are spread over. */
+enum { NUM_SLOTS = 16384 };
+
+/** Hash slot of the given key: the CRC16 of the key modulo NUM_SLOTS, or of
+    the part between its first '{' and the following '}' if that's not
+    empty, so that related keys can be kept on the same slot.
+*/
+uint16_t keySlot(const std::string & key);
+
+
+/*****************************************************************************/
+/* CONNECTION POOL                                                           */
+/*****************************************************************************/
+
+/** Several connections to the same server, each with its own event loop,
+    over which the commands are spread.
+
+    Commands on the same key (their first argument) always go over the same
+    connection, so that their order is kept.  A queueMulti block goes as a
+    whole over the connection of its first command with a key, which keeps
+    MULTI/EXEC blocks working.
+*/
+
+struct ConnectionPool : public AsyncConnection {
+
+    /** Opens "numConnections" connections to the address.  If a password
+        is given, an AUTH command is queued first on each of them.
+    */
+    ConnectionPool(const Address & address, int numConnections,
+                   const std::string & password = "");
+
+    ~ConnectionPool();
+
+    virtual void auth(std::string password);
+    virtual void select(int database);
+    virtual void close();
+
+    virtual int64_t queue(const Command & command,
+                          const OnResult & onResult = OnResult(),
+                          Timeout timeout = Timeout());
+
+    virtual void queueMulti(const std::vector<Command> & commands,
+                            const OnResults & onResults = OnResults(),
+                            Timeout timeout = Timeout());
+
+    virtual size_t numRequestsPending() const;
+    virtual size_t numTimeoutsPending() const;
+
+    /** Connection over which the commands on the given key are sent. */
+    AsyncConnection & connectionFor(const std::string & key);
+
+    size_t size() const
+    {
+        return connections.size();
+    }
+
+private:
+    std::vector<std::shared_ptr<AsyncConnection> > connections;
+};
+
+
+/*****************************************************************************/
+/* CLUSTER CONNECTION                                                        */
+/*****************************************************************************/
+
+/** Connection to a Redis Cluster, with a ConnectionPool to each of its
+    masters.
+
+    Each command is sent to the master serving the slot of its key, as
+    given by CLUSTER SLOTS when connecting.  MOVED redirections update the
+    slot and ASK redirections are followed for the one command, up to a few
+    times per command.  MGET is split by slot and its replies put back
+    together in order; KEYS is sent to every master and their replies
+    concatenated.
+
+    A queueMulti block containing a MULTI is sent as a whole to the master
+    of its first command with a key, so its keys must all be on the same
+    slot as required by Redis; other blocks are routed one command at a
+    time.
+
+    If the server doesn't have cluster support enabled, all of the slots go
+    to it.
+*/
+
+struct ClusterConnection : public AsyncConnection {
+
+    ClusterConnection(const Address & seed, int connectionsPerNode = 1);
+
+    ~ClusterConnection();
+
+    /** Reloads which master serves each slot from CLUSTER SLOTS.  This is
+        synchronous.
+    */
+    void refresh();
+
+    /** Authenticates the connections to all of the masters, including the
+        ones found later on. */
+    virtual void auth(std::string password);
+
+    /** Only database 0 exists in a cluster. */
+    virtual void select(int database);
+
+    virtual void close();
+
+    virtual int64_t queue(const Command & command,
+                          const OnResult & onResult = OnResult(),
+                          Timeout timeout = Timeout());
+
+    virtual void queueMulti(const std::vector<Command> & commands,
+                            const OnResults & onResults = OnResults(),
+                            Timeout timeout = Timeout());
+
+    virtual size_t numRequestsPending() const;
+    virtual size_t numTimeoutsPending() const;
+
+    /** Number of masters currently known. */
+    size_t numNodes() const;
+
+    /** Redirections followed for a single command before its error is
+        returned. */
+    static constexpr int MaxRedirections = 5;
+
+private:
+    typedef std::shared_ptr<ConnectionPool> Node;
+
+    /** Node for the given address, created if it's not known yet.  Must be
+        called with nodesLock held. */
+    Node getNode(const Address & address);
+
+    Node nodeForSlot(uint16_t slot);
+
+    /** The distinct nodes serving at least one slot. */
+    std::vector<Node> masters();
+
+    void send(const Command & command, const OnResult & onResult,
+              Timeout timeout);
+
+    void sendTo(const Node & node, bool asking,
+                const Command & command, const OnResult & onResult,
+                Timeout timeout, int redirections);
+
+    void sendSplit(const Command & command, const OnResult & onResult,
+                   Timeout timeout);
+
+    void sendToAll(const Command & command, const OnResult & onResult,
+                   Timeout timeout);
+
+    Address seed;
+    int connectionsPerNode;
+    std::string password;
+    std::atomic<int64_t> ids;
+
+    mutable std::mutex nodesLock;
+    std::map<std::string, Node> nodes;
+    std::vector<Node> slots;
+};
+
+} // namespace Redis
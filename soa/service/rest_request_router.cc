@@ -9,6 +9,8 @@
 #include "jml/arch/exception_handler.h"
 #include "jml/utils/set_utils.h"
 #include "jml/utils/file_functions.h"
+#include <algorithm>
+#include <cstring>
 
 
 using namespace std;
@@ -44,7 +46,7 @@ std::ostream & operator << (std::ostream & stream, const RequestFilter & filter)
 std::ostream & operator << (std::ostream & stream,
                             const RestRequestParsingContext & context)
 {
-    return stream << context.resources << " " << context.remaining;
+    return stream << context.resources << " " << context.remaining();
 }
 
 
@@ -144,10 +146,16 @@ processRequest(const RestServiceEndpoint::ConnectionId & connection,
         return MR_YES;
     }
 
-    if (rootHandler && (!terminal || context.remaining.empty()))
+    if (rootHandler && (!terminal || context.finished()))
         return rootHandler(connection, request, context);
 
-    for (auto & sr: subRoutes) {
+    ML::compact_vector<unsigned, 16> candidates;
+    routeIndex.candidates(context.resource.c_str() + context.consumed,
+                          context.resource.size() - context.consumed,
+                          candidates);
+
+    for (unsigned i: candidates) {
+        auto & sr = subRoutes[i];
         if (debug)
             cerr << "  trying subroute " << sr.router->description << endl;
         try {
@@ -175,8 +183,13 @@ options(std::set<std::string> & verbsAccepted,
         const RestRequest & request,
         RestRequestParsingContext & context) const
 {
-    for (auto & sr: subRoutes) {
-        sr.options(verbsAccepted, help, request, context);
+    ML::compact_vector<unsigned, 16> candidates;
+    routeIndex.candidates(context.resource.c_str() + context.consumed,
+                          context.resource.size() - context.consumed,
+                          candidates);
+
+    for (unsigned i: candidates) {
+        subRoutes[i].options(verbsAccepted, help, request, context);
     }
 }
 
@@ -185,34 +198,35 @@ RestRequestRouter::Route::
 matchPath(const RestRequest & request,
           RestRequestParsingContext & context) const
 {
+    const std::string & resource = context.resource;
+
     switch (path.type) {
     case PathSpec::STRING: {
-        std::string::size_type pos = context.remaining.find(path.path);
-        if (pos == 0) {
-            using namespace std;
-            //cerr << "context string " << pos << endl;
-            context.resources.push_back(path.path);
-            context.remaining = string(context.remaining, path.path.size());
-            break;
-        }
-        else return false;
+        if (resource.size() - context.consumed < path.path.size()
+            || resource.compare(context.consumed, path.path.size(),
+                                path.path) != 0)
+            return false;
+        context.resources.push_back(path.path);
+        context.consumed += path.path.size();
+        break;
     }
     case PathSpec::REGEX: {
-        boost::smatch results;
+        // match_continuous anchors the match at the start of what's left
+        boost::match_results<std::string::const_iterator> results;
         bool found
-            = boost::regex_search(context.remaining,
+            = boost::regex_search(resource.begin() + context.consumed,
+                                  resource.end(),
                                   results,
-                                  path.rex)
-            && !results.prefix().matched;  // matches from the start
+                                  path.rex,
+                                  boost::match_continuous);
         
         //cerr << "matching regex " << path.path << " against "
-        //     << context.remaining << " with found " << found << endl;
+        //     << context.remaining() << " with found " << found << endl;
         if (!found)
             return false;
         for (unsigned i = 0;  i < results.size();  ++i)
             context.resources.push_back(results[i]);
-        context.remaining = std::string(context.remaining,
-                                        results[0].length());
+        context.consumed += results[0].length();
         break;
     }
     case PathSpec::NONE:
@@ -268,7 +282,7 @@ options(std::set<std::string> & verbsAccepted,
     if (!matchPath(request, context))
         return;
 
-    if (context.remaining.empty()) {
+    if (context.finished()) {
         verbsAccepted.insert(filter.verbs.begin(), filter.verbs.end());
 
         string path = "";//this->path.getPathDesc();
@@ -295,7 +309,7 @@ addRoute(PathSpec path, RequestFilter filter,
     route.router = handler;
     route.extractObject = extractObject;
 
-    subRoutes.emplace_back(std::move(route));
+    pushRoute(std::move(route));
 }
 
 void
@@ -368,8 +382,111 @@ addSubRouter(PathSpec path, const std::string & description, ExtractObject extra
     route.router->description = description;
     route.extractObject = extractObject;
 
-    subRoutes.push_back(route);
-    return *route.router;
+    auto & result = *route.router;
+    pushRoute(std::move(route));
+    return result;
+}
+
+void
+RestRequestRouter::
+pushRoute(Route && route)
+{
+    routeIndex.add(subRoutes.size(), route.path);
+    subRoutes.emplace_back(std::move(route));
+}
+
+
+/*****************************************************************************/
+/* ROUTE INDEX                                                               */
+/*****************************************************************************/
+
+RestRequestRouter::RouteIndex::
+RouteIndex()
+    : nodes(1)
+{
+}
+
+void
+RestRequestRouter::RouteIndex::
+add(unsigned routeNum, const PathSpec & path)
+{
+    std::string prefix;
+    switch (path.type) {
+    case PathSpec::STRING: prefix = path.path;  break;
+    case PathSpec::REGEX:
+        if (!(path.rex.flags() & boost::regex::icase))
+            prefix = literalPrefix(path.path);
+        break;
+    default:
+        throw ML::Exception("unknown rest request type");
+    }
+
+    unsigned node = 0;
+    for (char c: prefix) {
+        auto & children = nodes[node].children;
+        auto it = std::find_if(children.begin(), children.end(),
+                               [&] (const std::pair<char, unsigned> & child)
+                               {
+                                   return child.first == c;
+                               });
+        if (it != children.end()) {
+            node = it->second;
+            continue;
+        }
+
+        unsigned child = nodes.size();
+        nodes[node].children.emplace_back(c, child);
+        nodes.emplace_back();
+        node = child;
+    }
+
+    nodes[node].routes.push_back(routeNum);
+}
+
+void
+RestRequestRouter::RouteIndex::
+candidates(const char * path, size_t length,
+           ML::compact_vector<unsigned, 16> & result) const
+{
+    unsigned node = 0;
+    for (size_t i = 0;  ;  ++i) {
+        const Node & n = nodes[node];
+        result.insert(result.end(), n.routes.begin(), n.routes.end());
+        if (i == length) break;
+
+        auto it = std::find_if(n.children.begin(), n.children.end(),
+                               [&] (const std::pair<char, unsigned> & child)
+                               {
+                                   return child.first == path[i];
+                               });
+        if (it == n.children.end()) break;
+        node = it->second;
+    }
+
+    // Routes are tried in the order they were added, whatever their prefix
+    std::sort(result.begin(), result.end());
+}
+
+std::string
+RestRequestRouter::RouteIndex::
+literalPrefix(const std::string & regex)
+{
+    // An alternation can match anything at the start
+    if (regex.find('|') != std::string::npos)
+        return "";
+
+    std::string result;
+    for (size_t i = 0;  i < regex.size();  ++i) {
+        char c = regex[i];
+        if (strchr(".[](){}*+?^$\\", c)) {
+            // A quantifier makes the character before it optional
+            if (c == '*' || c == '?' || c == '{')
+                if (!result.empty()) result.resize(result.size() - 1);
+            break;
+        }
+        result += c;
+    }
+    return result;
 }
 
 RestRequestRouter::OnProcessRequest
@@ -11,6 +11,7 @@
 #include "soa/service/rest_service_endpoint.h"
 #include "jml/utils/vector_utils.h"
 #include "jml/utils/positioned_types.h"
+#include "jml/utils/compact_vector.h"
 #include "jml/arch/rtti_utils.h"
 #include "jml/arch/demangle.h"
 //#include <regex>
@@ -165,7 +166,7 @@ std::ostream & operator << (std::ostream & stream, const RequestFilter & filter)
 
 struct RestRequestParsingContext {
     RestRequestParsingContext(const RestRequest & request)
-        : remaining(request.resource)
+        : resource(request.resource), consumed(0)
     {
     }
 
@@ -295,14 +296,31 @@ struct RestRequestParsingContext {
     /// They are shared pointers as the contexts are copied.
     std::vector<ObjectEntry> objects;
 
+    /// The resource being matched.  Refers to the request's, which must
+    /// outlive the context.
+    const std::string & resource;
+
+    /// Number of characters at the start of the resource that have been
+    /// consumed; matching moves this forward instead of copying what's left.
+    size_t consumed;
+
     /// Part of the resource that has not yet been consumed
-    std::string remaining;
+    std::string remaining() const
+    {
+        return std::string(resource, consumed);
+    }
+
+    /// Has the whole resource been consumed?
+    bool finished() const
+    {
+        return consumed == resource.size();
+    }
 
     /// Used to save the state so that whatever was pushed after can be
     /// removed and the object can get back to its old state (without making
     /// a copy).
     struct State {
-        std::string remaining;
+        size_t consumed;
         int resourcesLength;
         int objectsLength;
     };
@@ -311,7 +329,7 @@ struct RestRequestParsingContext {
     State saveState() const
     {
         State result;
-        result.remaining = remaining;
+        result.consumed = consumed;
         result.resourcesLength = resources.size();
         result.objectsLength = objects.size();
         return result;
@@ -320,7 +338,7 @@ struct RestRequestParsingContext {
     /// Restore the current state
     void restoreState(State && state)
     {
-        remaining = std::move(state.remaining);
+        consumed = state.consumed;
         ExcAssertGreaterEqual(resources.size(), state.resourcesLength);
         resources.resize(state.resourcesLength);
         ExcAssertGreaterEqual(objects.size(), state.objectsLength);
@@ -469,6 +487,37 @@ struct RestRequestRouter {
                 RestRequestParsingContext & context) const;
     };
 
+    /** Index of the sub-routes by the literal prefix of their path, so that
+        only the routes that can match a resource are tried.
+
+        It's a character trie: a string path is stored at the node for the
+        whole path, and a regex at the node for the literal characters it
+        starts with, so the regexes are only ever run at the leaves of a
+        walk down the trie.  Walking the unconsumed part of the resource
+        down the trie gives every route whose prefix it starts with.
+    */
+    struct RouteIndex {
+        RouteIndex();
+
+        void add(unsigned routeNum, const PathSpec & path);
+
+        /** Numbers of the routes that can match the given path, in the
+            order in which they were added. */
+        void candidates(const char * path, size_t length,
+                        ML::compact_vector<unsigned, 16> & result) const;
+
+        /** Literal characters a regex has to start with. */
+        static std::string literalPrefix(const std::string & regex);
+
+    private:
+        struct Node {
+            std::vector<std::pair<char, unsigned> > children;
+            std::vector<unsigned> routes;
+        };
+
+        std::vector<Node> nodes;
+    };
+
     /** Add a route that will match the given path and filter and will
         delegate to the given sub-route.
     */
@@ -535,15 +584,22 @@ struct RestRequestRouter {
         route.router = res;
         route.router->description = description;
         route.extractObject = getExtractObject(res.get());
-        subRoutes.push_back(route);
+        pushRoute(std::move(route));
         return *res;
     }
     
     OnProcessRequest rootHandler;
+
+    /// Routes in the order in which they're tried.  Only add to it through
+    /// the add functions, which keep the index up to date.
     std::vector<Route> subRoutes;
+    RouteIndex routeIndex;
     std::string description;
     bool terminal;
     Json::Value argHelp;
+
+private:
+    void pushRoute(Route && route);
 };
 
 
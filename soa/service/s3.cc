@@ -27,7 +27,10 @@
 #include "xml_helpers.h"
 
 #include <boost/iostreams/stream_buffer.hpp>
+#include <condition_variable>
 #include <exception>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 
@@ -1627,7 +1630,9 @@ size_t getTotalSystemMemory()
 }
 
 struct StreamingDownloadSource {
-    StreamingDownloadSource(const std::string & urlStr)
+    StreamingDownloadSource(const std::string & urlStr,
+                            int numThreads = 0,
+                            size_t maxBufferedBytes = 0)
     {
         impl.reset(new Impl());
         impl->owner = getS3ApiForUri(urlStr);
@@ -1635,15 +1640,19 @@ struct StreamingDownloadSource {
         impl->info = impl->owner->getObjectInfo(urlStr);
         impl->baseChunkSize = 1024 * 1024;  // start with 1MB and ramp up
 
-        int numThreads = 1;
-        if (impl->info.size > 1024 * 1024)
-            numThreads = 2;
-        if (impl->info.size > 16 * 1024 * 1024)
-            numThreads = 3;
-        if (impl->info.size > 256 * 1024 * 1024)
-            numThreads = 5;
+        if (numThreads <= 0) {
+            numThreads = 1;
+            if (impl->info.size > 1024 * 1024)
+                numThreads = 2;
+            if (impl->info.size > 16 * 1024 * 1024)
+                numThreads = 3;
+            if (impl->info.size > 256 * 1024 * 1024)
+                numThreads = 5;
+            if (impl->info.size > 1024 * 1024 * 1024)
+                numThreads = 8;
+        }
         
-        impl->start(numThreads);
+        impl->start(numThreads, maxBufferedBytes);
     }
 
     typedef char char_type;
@@ -1654,6 +1663,11 @@ struct StreamingDownloadSource {
         boost::iostreams::closable_tag
     { };
 
+    /* The object is downloaded as a sequence of ranged chunks.  The http
+       threads take the next chunk to download as soon as they are free,
+       as long as it is within "maxChunksAhead" of the chunk being read,
+       which bounds the memory used while the reader is slower than the
+       network. */
     struct Impl {
         Impl()
             : baseChunkSize(0)
@@ -1675,8 +1689,12 @@ struct StreamingDownloadSource {
 
         /* variables set during or after "start" has been called */
         size_t maxChunkSize;
+        unsigned maxChunksAhead;
+
+        std::mutex lock;
+        std::condition_variable cond; /* signalled on every change below */
 
-        atomic<bool> shutdown;
+        bool shutdown;
         exception_ptr lastExc;
 
         /* read thread */
@@ -1688,20 +1706,22 @@ struct StreamingDownloadSource {
         ssize_t readPartOffset; /* number of bytes from "readPart" that have
                                  * been returned to the caller, or -1 when
                                  * awaiting a new part */
-        int readPartDone; /* the number of the chunk representing "readPart" */
+        unsigned readPartDone; /* the number of the chunk representing
+                                * "readPart" */
 
         /* http threads */
-        typedef RingBufferSRMW<string> ThreadData;
+        unsigned nextChunk; /* next chunk to be downloaded */
+        uint64_t nextChunkOffset; /* offset of that chunk in the object */
+        map<unsigned, string> doneChunks; /* downloaded, not yet read */
 
-        int numThreads; /* number of http threads */
         vector<thread> threads; /* thread pool */
-        vector<ThreadData> threadQueues; /* per-thread queue of chunk data */
 
         /* cleanup all the variables that are used during reading, the
            "static" ones are left untouched */
         void reset()
         {
             shutdown = false;
+            lastExc = nullptr;
 
             readOffset = 0;
 
@@ -1709,12 +1729,14 @@ struct StreamingDownloadSource {
             readPartOffset = -1;
             readPartDone = 0;
 
-            threadQueues.clear();
+            nextChunk = 0;
+            nextChunkOffset = 0;
+            doneChunks.clear();
+
             threads.clear();
-            numThreads = 0;
         }
 
-        void start(int nThreads)
+        void start(int numThreads, size_t maxBufferedBytes)
         {
             // Maximum chunk size is what we can do in 3 seconds
             maxChunkSize = (owner->bandwidthToServiceMbps
@@ -1725,27 +1747,29 @@ struct StreamingDownloadSource {
             // Limit each chunk to 1% of system memory
             maxChunkSize = std::min(maxChunkSize, sysMemory / 100);
             //cerr << "maxChunkSize = " << maxChunkSize << endl;
-            numThreads = nThreads;
 
-            for (int i = 0; i < numThreads; i++) {
-                threadQueues.emplace_back(2);
+            // Two chunks per thread keep them busy while the reader catches
+            // up, unless the buffer is limited to less
+            maxChunksAhead = numThreads * 2;
+            if (maxBufferedBytes > 0) {
+                size_t maxChunks = maxBufferedBytes / maxChunkSize;
+                maxChunksAhead = std::max<size_t>(std::min<size_t>(maxChunks, maxChunksAhead),
+                                                  numThreads);
             }
-            
-            /* ensure that the queues are ready before the threads are
-               launched */
-            ML::memory_barrier();
 
             for (int i = 0; i < numThreads; i++) {
-                auto threadFn = [&] (int threadNum) {
-                    this->runThread(threadNum);
-                };
-                threads.emplace_back(threadFn, i);
+                threads.emplace_back([&] () { this->runThread(); });
             }
         }
 
         void stop()
         {
-            shutdown = true;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                shutdown = true;
+            }
+            cond.notify_all();
+
             for (thread & th: threads) {
                 th.join();
             }
@@ -1756,10 +1780,6 @@ struct StreamingDownloadSource {
         /* reader thread */
         std::streamsize read(char_type* s, std::streamsize n)
         {
-            if (lastExc) {
-                rethrow_exception(lastExc);
-            }
-
             if (readOffset == info.size)
                 return -1;
 
@@ -1767,10 +1787,6 @@ struct StreamingDownloadSource {
                 waitNextPart();
             }
 
-            if (lastExc) {
-                rethrow_exception(lastExc);
-            }
-
             size_t toDo = min<size_t>(readPart.size() - readPartOffset,
                                       n);
             const char_type * start = readPart.c_str() + readPartOffset;
@@ -1788,52 +1804,56 @@ struct StreamingDownloadSource {
 
         void waitNextPart()
         {
-            int partThread = readPartDone % numThreads;
-            ThreadData & threadQueue = threadQueues[partThread];
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                cond.wait(guard, [&] () {
+                    return lastExc || doneChunks.count(readPartDone);
+                });
 
-            /* We set a timeout to avoid dead locking when http threads have
-             * exited after an exception. */
-            while (!lastExc) {
-                if (threadQueue.tryPop(readPart, 1.0)) {
-                    break;
+                if (lastExc) {
+                    rethrow_exception(lastExc);
                 }
+
+                auto it = doneChunks.find(readPartDone);
+                readPart = std::move(it->second);
+                doneChunks.erase(it);
+                readPartDone++;
             }
 
+            /* there is room for one more chunk ahead */
+            cond.notify_all();
+
             readPartOffset = 0;
-            readPartDone++;
         }
 
         /* download threads */
-        void runThread(int threadNum)
+        void runThread()
         {
-            ThreadData & threadQueue = threadQueues[threadNum];
-
-            uint64_t start = 0;
-            unsigned int prevChunkNbr = 0;
-
             try {
-                for (int loop = 0;; loop++) {
-                    /* number of the chunk that we need to process */
-                    unsigned int chunkNbr = loop * numThreads + threadNum;
-
-                    /* we adjust the offset by adding the chunk sizes of all
-                       the chunks downloaded between our previous loop until
-                       now */
-                    for (unsigned int i = prevChunkNbr; i < chunkNbr; i++) {
-                        start += getChunkSize(i);
-                    }
-
-                    if (start >= info.size) {
-                        /* we are done */
-                        return;
-                    }
-                    prevChunkNbr = chunkNbr;
+                for (;;) {
+                    unsigned int chunkNbr;
+                    uint64_t start;
+                    size_t chunkSize;
+
+                    {
+                        std::unique_lock<std::mutex> guard(lock);
+                        cond.wait(guard, [&] () {
+                            return (shutdown || lastExc
+                                    || nextChunkOffset >= info.size
+                                    || nextChunk < readPartDone + maxChunksAhead);
+                        });
+
+                        if (shutdown || lastExc
+                            || nextChunkOffset >= info.size) {
+                            /* we are done */
+                            return;
+                        }
 
-                    size_t chunkSize = getChunkSize(chunkNbr);
-                    uint64_t end = start + chunkSize;
-                    if (end > info.size) {
-                        end = info.size;
-                        chunkSize = end - start;
+                        chunkNbr = nextChunk++;
+                        start = nextChunkOffset;
+                        chunkSize = std::min<uint64_t>(getChunkSize(chunkNbr),
+                                                       info.size - start);
+                        nextChunkOffset += chunkSize;
                     }
 
                     auto partResult
@@ -1851,23 +1871,21 @@ struct StreamingDownloadSource {
                     string chunkEtag = partResult.getHeader("etag") ;
                     if(chunkEtag != info.etag)
                         throw ML::Exception("chunk etag %s not equal to file etag %s: file <%s> has changed during download!!", chunkEtag.c_str(), info.etag.c_str(), object.c_str());
-                    ExcAssert(partResult.body().size() == chunkSize);
+                    ExcAssert(partResult.body_.size() == chunkSize);
 
-                    while (true) {
-                        if (shutdown || lastExc) {
-                            return;
-                        }
-                        if (threadQueue.tryPush(partResult.body())) {
-                            break;
-                        }
-                        else {
-                            ML::sleep(0.1);
-                        }
+                    {
+                        std::unique_lock<std::mutex> guard(lock);
+                        doneChunks[chunkNbr] = std::move(partResult.body_);
                     }
+                    cond.notify_all();
                 }
             }
             catch (...) {
-                lastExc = current_exception();
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    lastExc = current_exception();
+                }
+                cond.notify_all();
             }
         }
 
@@ -1899,11 +1917,13 @@ struct StreamingDownloadSource {
 };
 
 std::unique_ptr<std::streambuf>
-makeStreamingDownload(const std::string & uri)
+makeStreamingDownload(const std::string & uri,
+                      int numThreads = 0,
+                      size_t maxBufferedBytes = 0)
 {
     std::unique_ptr<std::streambuf> result;
     result.reset(new boost::iostreams::stream_buffer<StreamingDownloadSource>
-                 (StreamingDownloadSource(uri),
+                 (StreamingDownloadSource(uri, numThreads, maxBufferedBytes),
                   131072));
     return result;
 }
@@ -2385,7 +2405,13 @@ void S3Api::setDefaultBandwidthToServiceMbps(double mbps){
     S3Api::defaultBandwidthToServiceMbps = mbps;
 }
 
-HttpRestProxy S3Api::proxy;
+// Shares its connections with the other AWS services of the process
+HttpRestProxy S3Api::proxy = [] ()
+    {
+        HttpRestProxy result;
+        result.setConnectionPool(AwsApi::sharedConnections());
+        return result;
+    }();
 
 S3Api::Redundancy S3Api::defaultRedundancy = S3Api::REDUNDANCY_STANDARD;
 
@@ -2479,7 +2505,18 @@ struct RegisterS3Handler {
         string bucket(resource, 0, pos);
 
         if (mode == ios::in) {
-            return make_pair(makeStreamingDownload("s3://" + resource)
+            int numThreads = 0;
+            size_t maxBufferedBytes = 0;
+            for (auto & opt: options) {
+                if (opt.first == "num-threads")
+                    numThreads = std::stoi(opt.second);
+                else if (opt.first == "max-buffer")
+                    maxBufferedBytes = std::stoull(opt.second);
+            }
+
+            return make_pair(makeStreamingDownload("s3://" + resource,
+                                                   numThreads,
+                                                   maxBufferedBytes)
                              .release(),
                              true);
         }
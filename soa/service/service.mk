@@ -41,11 +41,15 @@ LIBSERVICES_SOURCES := \
 	passive_endpoint.cc \
 	chunked_http_endpoint.cc \
 	epoller.cc \
+	io_uring.cc \
+	uring_transport.cc \
 	epoll_loop.cc \
 	http_header.cc \
 	port_range_service.cc \
 	service_base.cc \
+	shared_metrics.cc \
 	message_loop.cc \
+	thread_placement.cc \
 	loop_monitor.cc \
 	named_endpoint.cc \
 	zookeeper_configuration_service.cc \
@@ -74,9 +78,10 @@ LIBSERVICES_SOURCES := \
 	nsq_event_handler.cc \
 	event_publisher.cc \
 	event_subscriber.cc \
-	nsq_client.cc 
+	nsq_client.cc \
+	shm_ring.cc
 
-LIBSERVICES_LINK := opstats curl boost_regex runner_common zeromq zookeeper_mt ACE arch utils jsoncpp boost_thread zmq types tinyxml2 boost_system value_description crypto
+LIBSERVICES_LINK := opstats curl boost_regex runner_common zeromq zookeeper_mt ACE arch utils jsoncpp boost_thread zmq types tinyxml2 boost_system value_description crypto rt
 
 $(eval $(call library,services,$(LIBSERVICES_SOURCES),$(LIBSERVICES_LINK)))
 $(eval $(call set_compile_option,runner.cc,-DBIN=\"$(BIN)\"))
@@ -108,7 +113,8 @@ $(eval $(call python_addon,py_cloud,cloud_py.cc,cloud))
 
 
 LIBREDIS_SOURCES := \
-	redis.cc
+	redis.cc \
+	redis_cluster.cc
 
 LIBREDIS_LINK := hiredis utils types boost_thread
 
@@ -120,6 +126,7 @@ $(eval $(call program,s3tee,cloud boost_program_options utils))
 $(eval $(call program,s3cp,cloud boost_program_options utils))
 $(eval $(call program,s3_multipart_cmd,cloud boost_program_options utils))
 $(eval $(call program,syslog_trace,services))
+$(eval $(call program,shared_metrics_exporter,services boost_program_options))
 $(eval $(call program,s3cat,cloud boost_program_options utils))
 $(eval $(call program,sns_send,cloud boost_program_options utils))
 
@@ -8,6 +8,9 @@
 #include "service_base.h"
 #include <iostream>
 #include "soa/service/carbon_connector.h"
+#include "soa/service/shared_metrics.h"
+#include "soa/service/message_loop.h"
+#include "soa/service/nprobe.h"
 #include "zookeeper_configuration_service.h"
 #include "jml/arch/demangle.h"
 #include "jml/utils/exc_assert.h"
@@ -93,6 +96,16 @@ dump(std::ostream & stream) const
     stats->dumpSync(stream);
 }
 
+std::shared_ptr<StatAggregator>
+NullEventService::
+getAggregator(const std::string & name,
+              const char * event,
+              StatEventType type,
+              std::initializer_list<int> extra)
+{
+    return stats->getStat(name + "." + event, type, extra);
+}
+
 
 /*****************************************************************************/
 /* CARBON EVENT SERVICE                                                      */
@@ -142,6 +155,56 @@ onEvent(const std::string & name,
     connector->record(stat, type, value, extra);
 }
 
+std::shared_ptr<StatAggregator>
+CarbonEventService::
+getAggregator(const std::string & name,
+              const char * event,
+              StatEventType type,
+              std::initializer_list<int> extra)
+{
+    std::string stat = name.empty() ? std::string(event) : name + "." + event;
+    return connector->getStat(stat, type, extra);
+}
+
+
+/*****************************************************************************/
+/* EVENT HANDLE                                                              */
+/*****************************************************************************/
+
+EventHandle::
+EventHandle(const std::shared_ptr<EventService> & events,
+            const std::string & prefix,
+            const std::string & event,
+            StatEventType type,
+            std::initializer_list<int> extra)
+    : counter(nullptr), event(event), type(type)
+{
+    if (events)
+        aggregator = events->getAggregator(prefix, event.c_str(), type, extra);
+
+    if (aggregator) {
+        if (type == ET_HIT)
+            counter = aggregator->hitCounter();
+    }
+    else {
+        this->events = events;
+        this->prefix = prefix;
+    }
+}
+
+void
+EventHandle::
+record(float value) const
+{
+    if (aggregator)
+        aggregator->record(value);
+    else if (events)
+        events->onEvent(prefix, event.c_str(), type, value,
+                        type == ET_OUTCOME
+                        ? DefaultOutcomePercentiles
+                        : std::initializer_list<int>());
+}
+
 
 /*****************************************************************************/
 /* CONFIGURATION SERVICE                                                     */
@@ -507,6 +570,14 @@ logToCarbon(std::shared_ptr<CarbonConnector> conn)
     events.reset(new CarbonEventService(conn));
 }
 
+void
+ServiceProxies::
+logToSharedMemory(const std::string & segmentName,
+                  const std::string & prefix)
+{
+    events.reset(new SharedMemoryEventService(segmentName, prefix));
+}
+
 
 void
 ServiceProxies::
@@ -528,7 +599,13 @@ useZookeeper(std::string url,
         prefix = "/dev/" + node + cwd + "_" + __progname + "/";
     }
 
-    config.reset(new ZookeeperConfigurationService(url, prefix, location));
+    auto zookeeper = std::make_shared<ZookeeperConfigurationService>
+        (url, prefix, location);
+
+    // Discovery then reads what it needs from the cache
+    zookeeper->prefetch();
+
+    config = zookeeper;
 }
 
 
@@ -639,7 +716,11 @@ bootstrap(const Json::Value& config)
         bankerUri = config.get("bankerHost", "").asString();
     }
 
-    if (config.isMember("carbon-uri")) {
+    // The exporter sends the metrics of the segment to carbon
+    if (config.isMember("metrics-segment")) {
+        logToSharedMemory(config["metrics-segment"].asString(), install);
+    }
+    else if (config.isMember("carbon-uri")) {
         const Json::Value& entry = config["carbon-uri"];
         vector<string> uris;
 
@@ -651,7 +732,15 @@ bootstrap(const Json::Value& config)
 
         double dumpInterval = config.get("carbon-dump-interval", 1.0).asDouble();
 
-        logToCarbon(uris, install, dumpInterval);
+        if (config.isMember("carbon-protocol")) {
+            auto protocol = CarbonConnector::parseProtocol(
+                    config["carbon-protocol"].asString());
+            auto connector = std::make_shared<CarbonConnector>(
+                    uris, install, dumpInterval);
+            connector->setProtocol(protocol);
+            logToCarbon(connector);
+        }
+        else logToCarbon(uris, install, dumpInterval);
     }
 
     if (config.isMember("zookeeper-uri"))
@@ -659,6 +748,44 @@ bootstrap(const Json::Value& config)
 
     if (config.isMember("portRanges"))
         usePortRanges(config["portRanges"]);
+
+    if (config.isMember("threadPlacement"))
+        useThreadPlacement(config["threadPlacement"]);
+
+    if (config.isMember("hugePages"))
+        useHugePages(config["hugePages"]);
+
+    if (config.isMember("traceSampling"))
+        useTraceSampling(config["traceSampling"].asUInt());
+}
+
+void
+ServiceProxies::
+useThreadPlacement(const Json::Value& config)
+{
+    ExcCheck(config.isObject(), "threadPlacement must be an object");
+
+    for (auto it = config.begin(), end = config.end(); it != end; ++it)
+        threadPlacement[it.memberName()] = ThreadPlacement::fromJson(*it);
+}
+
+void
+ServiceProxies::
+useHugePages(const Json::Value& config)
+{
+    ExcCheck(config.isObject(), "hugePages must be an object");
+
+    for (auto it = config.begin(), end = config.end(); it != end; ++it)
+        hugePages[it.memberName()] = ML::parse_huge_page_mode(it->asString());
+}
+
+void
+ServiceProxies::
+useTraceSampling(uint32_t samplingFreq)
+{
+    if (samplingFreq)
+        spans = std::make_shared<SpanRecorder>(samplingFreq);
+    else spans.reset();
 }
 
 /*****************************************************************************/
@@ -681,6 +808,18 @@ EventRecorder(const std::string & eventPrefix,
 {
 }
 
+EventHandle
+EventRecorder::
+getEventHandle(StatEventType type,
+               const std::string & event,
+               std::initializer_list<int> extra) const
+{
+    std::shared_ptr<EventService> es = events_;
+    if (!es && services_)
+        es = services_->events;
+    return EventHandle(es, eventPrefix_, event, type, extra);
+}
+
 void
 EventRecorder::
 recordEventFmt(StatEventType type,
@@ -748,6 +887,67 @@ ServiceBase::
 {
 }
 
+ThreadPlacement
+ServiceBase::
+getThreadPlacement(const std::string & threadName) const
+{
+    auto & placements = services_->threadPlacement;
+
+    auto it = placements.find(serviceName_ + "." + threadName);
+    if (it == placements.end())
+        it = placements.find(serviceName_);
+    if (it == placements.end())
+        return ThreadPlacement();
+
+    return it->second;
+}
+
+void
+ServiceBase::
+placeCurrentThread(const std::string & threadName) const
+{
+    getThreadPlacement(threadName).applyToCurrentThread();
+}
+
+void
+ServiceBase::
+placeMessageLoop(const std::string & threadName, MessageLoop & loop) const
+{
+    loop.setThreadPlacement(getThreadPlacement(threadName));
+}
+
+ML::Huge_Page_Mode
+ServiceBase::
+getHugePageMode(const std::string & tableName) const
+{
+    auto & modes = services_->hugePages;
+
+    auto it = modes.find(serviceName_ + "." + tableName);
+    if (it == modes.end())
+        it = modes.find(serviceName_);
+    if (it == modes.end())
+        return ML::HP_NONE;
+
+    return it->second;
+}
+
+bool
+ServiceBase::
+traced(const Id & auctionId) const
+{
+    auto & spans = services_->spans;
+    return spans && spans->sampled(auctionId);
+}
+
+void
+ServiceBase::
+recordSpan(const Id & auctionId, const std::string & tag,
+           Date start, Date end) const
+{
+    if (auto & spans = services_->spans)
+        spans->record(auctionId, serviceName_, tag, start, end);
+}
+
 void
 ServiceBase::
 registerServiceProvider(const std::string & name,
@@ -8,7 +8,9 @@
 #define __service__service_base_h__
 
 #include "port_range_service.h"
+#include "thread_placement.h"
 #include "soa/service/stats_events.h"
+#include "soa/service/striped_counter.h"
 #include "stdarg.h"
 #include "jml/compiler/compiler.h"
 #include <string>
@@ -16,6 +18,9 @@
 #include "jml/arch/exception.h"
 #include "jml/arch/format.h"
 #include "jml/arch/spinlock.h"
+#include "jml/arch/vm.h"
+#include "soa/types/id.h"
+#include "soa/types/date.h"
 #include <map>
 #include <mutex>
 #include "soa/jsoncpp/json.h"
@@ -36,6 +41,9 @@ namespace Datacratic {
 
 class MultiAggregator;
 class CarbonConnector;
+struct SpanRecorder;
+struct StatAggregator;
+struct MessageLoop;
 
 /*****************************************************************************/
 /* EVENT SERVICE                                                             */
@@ -56,11 +64,76 @@ struct EventService {
     {
     }
 
+    /** Returns the aggregator that the event is recorded into so that it
+        can be recorded into directly, or null if the service doesn't keep
+        its own aggregators.  See EventHandle.
+    */
+    virtual std::shared_ptr<StatAggregator>
+    getAggregator(const std::string & name,
+                  const char * event,
+                  StatEventType type,
+                  std::initializer_list<int> extra = DefaultOutcomePercentiles)
+    {
+        return nullptr;
+    }
+
     /** Dump the content
     */
     std::map<std::string, double> get(std::ostream & output) const;
 };
 
+
+/*****************************************************************************/
+/* EVENT HANDLE                                                              */
+/*****************************************************************************/
+
+/** Handle on an event whose name was formatted and looked up once, for the
+    events that are recorded all the time.  A hit is then a relaxed atomic
+    increment on the thread's stripe of the counter and the other events go
+    straight to their aggregator.
+
+    Event services that don't have aggregators get the events through
+    onEvent() as usual.  A default constructed handle doesn't record
+    anything.
+*/
+struct EventHandle {
+
+    EventHandle()
+        : counter(nullptr), type(ET_HIT)
+    {
+    }
+
+    EventHandle(const std::shared_ptr<EventService> & events,
+                const std::string & prefix,
+                const std::string & event,
+                StatEventType type,
+                std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
+    void recordHit() const
+    {
+        if (JML_LIKELY(counter != nullptr))
+            counter->add();
+        else record(1.0);
+    }
+
+    /** Records a count, level or outcome, depending on the type of the
+        event.
+    */
+    void record(float value) const;
+
+    const std::string & name() const { return event; }
+
+private:
+    std::shared_ptr<StatAggregator> aggregator;
+    StripedCounter * counter;       ///< Hit counter of the aggregator
+
+    // For the services that don't have aggregators
+    std::shared_ptr<EventService> events;
+    std::string prefix;
+    std::string event;
+    StatEventType type;
+};
+
 /*****************************************************************************/
 /* NULL EVENT SERVICE                                                        */
 /*****************************************************************************/
@@ -78,6 +151,12 @@ struct NullEventService : public EventService {
 
     virtual void dump(std::ostream & stream) const;
 
+    virtual std::shared_ptr<StatAggregator>
+    getAggregator(const std::string & name,
+                  const char * event,
+                  StatEventType type,
+                  std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
     std::unique_ptr<MultiAggregator> stats;
 };
 
@@ -102,6 +181,12 @@ struct CarbonEventService : public EventService {
                          float value,
                          std::initializer_list<int> extra = std::initializer_list<int>());
 
+    virtual std::shared_ptr<StatAggregator>
+    getAggregator(const std::string & name,
+                  const char * event,
+                  StatEventType type,
+                  std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
     std::shared_ptr<CarbonConnector> connector;
 };
 
@@ -422,6 +507,12 @@ struct ServiceProxies {
                      const std::string & prefix = "",
                      double dumpInterval = 1.0);
 
+    /** Record the events into a shared memory segment that
+        shared_metrics_exporter sends to carbon from its own process.
+    */
+    void logToSharedMemory(const std::string & segmentName,
+                           const std::string & prefix = "");
+
     void useZookeeper(std::string url = "localhost:2181",
                       std::string prefix = "CWD",
                       std::string location = "global");
@@ -429,6 +520,36 @@ struct ServiceProxies {
     void usePortRanges(const std::string& path);
     void usePortRanges(const Json::Value& config);
 
+    /** Where the threads of the services run, keyed by
+        "<serviceName>.<threadName>" or by "<serviceName>" for all the
+        threads of a service.
+    */
+    std::map<std::string, ThreadPlacement> threadPlacement;
+
+    /** Reads threadPlacement from a JSON object like
+        { "router.augmentationLoop": "2", "router": "0-7" }.
+    */
+    void useThreadPlacement(const Json::Value& config);
+
+    /** How the large tables of the services are backed by huge pages,
+        keyed by "<serviceName>.<tableName>" or by "<serviceName>" for all
+        the tables of a service.
+    */
+    std::map<std::string, ML::Huge_Page_Mode> hugePages;
+
+    /** Reads hugePages from a JSON object like
+        { "router.inFlight": "explicit", "postAuction": "transparent" }.
+    */
+    void useHugePages(const Json::Value& config);
+
+    /** Records the spans of one in every samplingFreq auctions, or of none
+        when it's null.  Every service in the cluster should use the same
+        frequency so that they trace the same auctions.
+    */
+    std::shared_ptr<SpanRecorder> spans;
+
+    void useTraceSampling(uint32_t samplingFreq);
+
     std::vector<std::string>
     getServiceClassInstances(std::string const & name,
                              std::string const & protocol = "http");
@@ -644,6 +765,16 @@ struct EventRecorder {
         recordEvent(event.c_str(), ET_STABLE_LEVEL, level);
     }
 
+    /** Returns a handle to record the event with, for events that are
+        recorded often enough that formatting their name and looking it up
+        each time shows up.  The handle stays valid when the recorder goes
+        away.
+    */
+    EventHandle getEventHandle(StatEventType type,
+                               const std::string & event,
+                               std::initializer_list<int> extra
+                                   = DefaultOutcomePercentiles) const;
+
 protected:
     std::string eventPrefix_;
     std::shared_ptr<EventService> events_;
@@ -723,6 +854,48 @@ struct ServiceBase: public EventRecorder {
         return services_->config;
     }
 
+    /*************************************************************************/
+    /* THREAD PLACEMENT                                                      */
+    /*************************************************************************/
+
+    /** Returns the placement configured for the given thread of this
+        service, which is empty when there is none.
+    */
+    ThreadPlacement getThreadPlacement(const std::string & threadName) const;
+
+    /** Pins the calling thread as configured for the given thread name. */
+    void placeCurrentThread(const std::string & threadName) const;
+
+    /** Makes the loop pin its thread as configured for the given thread
+        name when it starts.
+    */
+    void placeMessageLoop(const std::string & threadName,
+                          MessageLoop & loop) const;
+
+    /*************************************************************************/
+    /* HUGE PAGES                                                            */
+    /*************************************************************************/
+
+    /** Returns how the given table of this service is configured to be
+        backed by huge pages, which is HP_NONE when it isn't.
+    */
+    ML::Huge_Page_Mode getHugePageMode(const std::string & tableName) const;
+
+    /*************************************************************************/
+    /* TRACING                                                               */
+    /*************************************************************************/
+
+    /** Whether the auction with the given id is one of those traced across
+        the services.
+    */
+    bool traced(const Id & auctionId) const;
+
+    /** Records a span of this service for a traced auction; does nothing
+        for the others.
+    */
+    void recordSpan(const Id & auctionId, const std::string & tag,
+                    Date start, Date end) const;
+
     /*************************************************************************/
     /* EXCEPTION LOGGING                                                     */
     /*************************************************************************/
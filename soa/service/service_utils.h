@@ -148,6 +148,9 @@ struct ServiceProxyArguments
              "path to bootstrap.json file")
             ("carbon-connection,c", value(&carbonUri),
              "URI for connecting to carbon daemon")
+            ("metrics-segment", value(&metricsSegment),
+             "shared memory segment to write the metrics into instead of "
+             "sending them to carbon")
             ("installation,I", value(&installation),
              "name of the current installation")
             ("location,L", value(&location),
@@ -193,7 +196,11 @@ struct ServiceProxyArguments
             services->config.reset(new NullConfigurationService);
         }
 
-        if (!carbonUri.empty()) {
+        if (!metricsSegment.empty()) {
+            ExcCheck(!installation.empty(), "installation is required");
+            services->logToSharedMemory(metricsSegment, installation);
+        }
+        else if (!carbonUri.empty()) {
             ExcCheck(!installation.empty(), "installation is required");
             services->logToCarbon(carbonUri, installation);
         }
@@ -204,6 +211,7 @@ struct ServiceProxyArguments
     std::string bootstrap;
     std::string zookeeperUri;
     std::string carbonUri;
+    std::string metricsSegment;
     std::string installation;
     std::string location;
     std::string preload;
@@ -0,0 +1,553 @@
+/* shared_metrics.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Metrics written into a shared memory segment.
+*/
+
+#include "soa/service/shared_metrics.h"
+#include "jml/arch/exception.h"
+#include "jml/arch/format.h"
+#include "jml/arch/vm.h"
+#include "jml/utils/exc_check.h"
+#include <boost/static_assert.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace Datacratic {
+
+
+BOOST_STATIC_ASSERT(sizeof(SharedMetricsSegment::Metric) == 192);
+BOOST_STATIC_ASSERT(sizeof(SharedMetricsSegment::Header) <= 4096);
+
+
+/*****************************************************************************/
+/* SHARED METRICS SEGMENT                                                    */
+/*****************************************************************************/
+
+namespace {
+
+size_t roundToPage(size_t size)
+{
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+} // file scope
+
+SharedMetricsSegment::
+SharedMetricsSegment()
+    : base(nullptr), size(0), fd(-1), inode(0)
+{
+}
+
+SharedMetricsSegment::
+~SharedMetricsSegment()
+{
+    close();
+}
+
+size_t
+SharedMetricsSegment::
+histogramsOffset(size_t maxMetrics)
+{
+    return roundToPage(MetricsOffset + maxMetrics * sizeof(Metric));
+}
+
+size_t
+SharedMetricsSegment::
+segmentSize(size_t maxMetrics, size_t maxHistograms)
+{
+    return roundToPage(histogramsOffset(maxMetrics)
+                       + maxHistograms * sizeof(Histogram));
+}
+
+void
+SharedMetricsSegment::
+create(const std::string & name,
+       const std::string & prefix,
+       size_t maxMetrics,
+       size_t maxHistograms)
+{
+    ExcCheck(!isOpen(), "segment is already open");
+    ExcCheck(prefix.size() < PrefixLength, "prefix is too long: " + prefix);
+    ExcCheck(maxMetrics > 0 && maxMetrics < NoHistogram, "invalid maxMetrics");
+    ExcCheck(maxHistograms < NoHistogram, "invalid maxHistograms");
+
+    // A restarted process gets a new segment rather than reusing the old
+    // one, so that the reader can tell that the values started over.
+    unlink(name);
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd == -1)
+        throw ML::Exception(errno, "shm_open: " + name);
+
+    size_t size = segmentSize(maxMetrics, maxHistograms);
+
+    // The new pages read as zeros, which is what all of the metrics start
+    // as.
+    if (ftruncate(fd, size) == -1) {
+        int err = errno;
+        ::close(fd);
+        throw ML::Exception(err, "ftruncate: " + name);
+    }
+
+    name_ = name;
+    map(fd, size, true);
+
+    Header & header = this->header();
+    header.magic = Magic;
+    header.version = Version;
+    header.maxMetrics = maxMetrics;
+    header.maxHistograms = maxHistograms;
+    header.pid = getpid();
+    header.created = Date::now().secondsSinceEpoch();
+    strncpy(header.prefix, prefix.c_str(), PrefixLength - 1);
+}
+
+void
+SharedMetricsSegment::
+open(const std::string & name)
+{
+    ExcCheck(!isOpen(), "segment is already open");
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+        throw ML::Exception(errno, "shm_open: " + name);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int err = errno;
+        ::close(fd);
+        throw ML::Exception(err, "fstat: " + name);
+    }
+
+    if (st.st_size < MetricsOffset) {
+        ::close(fd);
+        throw ML::Exception("shared metrics segment " + name + " is too small");
+    }
+
+    name_ = name;
+    map(fd, st.st_size, false);
+
+    const Header & header = this->header();
+    if (header.magic != Magic || header.version != Version
+        || size != segmentSize(header.maxMetrics, header.maxHistograms)) {
+        close();
+        throw ML::Exception("%s is not a shared metrics segment",
+                            name.c_str());
+    }
+}
+
+void
+SharedMetricsSegment::
+map(int fd, size_t size, bool writable)
+{
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void * addr = mmap(0, size, prot, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        int err = errno;
+        ::close(fd);
+        throw ML::Exception(err, "mmap: " + name_);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+        inode = st.st_ino;
+
+    this->fd = fd;
+    this->base = reinterpret_cast<char *>(addr);
+    this->size = size;
+}
+
+void
+SharedMetricsSegment::
+close()
+{
+    if (base) {
+        munmap(base, size);
+        base = nullptr;
+        size = 0;
+    }
+
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void
+SharedMetricsSegment::
+unlink(const std::string & name)
+{
+    int res = shm_unlink(name.c_str());
+    if (res == -1 && errno != ENOENT)
+        throw ML::Exception(errno, "shm_unlink: " + name);
+}
+
+bool
+SharedMetricsSegment::
+replaced() const
+{
+    if (!isOpen()) return true;
+
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd == -1) return true;
+
+    struct stat st;
+    bool result = fstat(fd, &st) == -1 || st.st_ino != inode;
+    ::close(fd);
+    return result;
+}
+
+
+/*****************************************************************************/
+/* SHARED MEMORY EVENT SERVICE                                               */
+/*****************************************************************************/
+
+namespace {
+
+struct SharedMetricAggregator : public StatAggregator {
+
+    SharedMetricAggregator(SharedMetricsSegment::Metric * metric,
+                           SharedMetricsSegment::Histogram * histogram)
+        : metric(metric), histogram(histogram)
+    {
+    }
+
+    virtual void record(float value)
+    {
+        SharedMemoryEventService::record(*metric, histogram, value);
+    }
+
+    // The exporter reads these, not the process
+    virtual std::vector<StatReading> read(const std::string & prefix)
+    {
+        return std::vector<StatReading>();
+    }
+
+    SharedMetricsSegment::Metric * metric;
+    SharedMetricsSegment::Histogram * histogram;
+};
+
+void atomicAdd(std::atomic<double> & sum, double value)
+{
+    double current = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(current, current + value,
+                                      std::memory_order_relaxed))
+        ;
+}
+
+} // file scope
+
+SharedMemoryEventService::
+SharedMemoryEventService(const std::string & segmentName,
+                         const std::string & prefix,
+                         size_t maxMetrics,
+                         size_t maxHistograms)
+{
+    segment_.create(segmentName, prefix, maxMetrics, maxHistograms);
+}
+
+SharedMemoryEventService::
+~SharedMemoryEventService()
+{
+    // Leave the segment behind if another process already replaced it
+    if (!segment_.replaced())
+        shm_unlink(segment_.name().c_str());
+}
+
+void
+SharedMemoryEventService::
+record(SharedMetricsSegment::Metric & metric,
+       SharedMetricsSegment::Histogram * histogram,
+       float value)
+{
+    // The type was set when the metric was added; hits only need the
+    // count.
+    if (metric.type != ET_HIT)
+        atomicAdd(metric.sum, value);
+
+    if (histogram)
+        histogram->counts[QuantileSketch::bucketOf(value)]
+            .fetch_add(1, std::memory_order_relaxed);
+
+    // Last so that the reader never sees more events than values
+    metric.count.fetch_add(1, std::memory_order_release);
+}
+
+SharedMemoryEventService::Entry
+SharedMemoryEventService::
+getEntry(const std::string & stat, StatEventType type)
+{
+    if (!lookupCache.get())
+        lookupCache.reset(new Entries());
+
+    auto found = lookupCache->find(stat);
+    if (found != lookupCache->end())
+        return found->second;
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    auto found2 = entries.find(stat);
+    if (found2 != entries.end()) {
+        guard.unlock();
+        return (*lookupCache)[stat] = found2->second;
+    }
+
+    Entry entry = { nullptr, nullptr };
+
+    SharedMetricsSegment::Header & header = segment_.header();
+    uint32_t index = header.numMetrics.load(std::memory_order_relaxed);
+    bool needsHistogram = type == ET_LEVEL || type == ET_OUTCOME;
+    uint32_t histogram = header.numHistograms.load(std::memory_order_relaxed);
+
+    if (stat.size() >= SharedMetricsSegment::NameLength
+        || index >= header.maxMetrics
+        || (needsHistogram && histogram >= header.maxHistograms))
+        return entry;
+
+    SharedMetricsSegment::Metric & metric = segment_.metric(index);
+    strncpy(metric.name, stat.c_str(), SharedMetricsSegment::NameLength - 1);
+    metric.type = type;
+    metric.histogram = SharedMetricsSegment::NoHistogram;
+
+    entry.metric = &metric;
+
+    if (needsHistogram) {
+        metric.histogram = histogram;
+        entry.histogram = &segment_.histogram(histogram);
+        header.numHistograms.store(histogram + 1, std::memory_order_relaxed);
+    }
+
+    // Publish the metric to the readers
+    header.numMetrics.store(index + 1, std::memory_order_release);
+
+    entries[stat] = entry;
+    guard.unlock();
+
+    return (*lookupCache)[stat] = entry;
+}
+
+void
+SharedMemoryEventService::
+onEvent(const std::string & name,
+        const char * event,
+        StatEventType type,
+        float value,
+        std::initializer_list<int> extra)
+{
+    std::string stat;
+    if (name.empty()) {
+        stat = event;
+    }
+    else {
+        size_t l = strlen(event);
+        stat.reserve(name.length() + l + 2);
+        stat.append(name);
+        stat.push_back('.');
+        stat.append(event, event + l);
+    }
+
+    Entry entry = getEntry(stat, type);
+    if (!entry.metric) {
+        segment_.header().numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record(*entry.metric, entry.histogram, value);
+}
+
+std::shared_ptr<StatAggregator>
+SharedMemoryEventService::
+getAggregator(const std::string & name,
+              const char * event,
+              StatEventType type,
+              std::initializer_list<int> extra)
+{
+    std::string stat = name.empty() ? std::string(event) : name + "." + event;
+
+    // Events that don't fit go through onEvent() to be counted as dropped
+    Entry entry = getEntry(stat, type);
+    if (!entry.metric)
+        return nullptr;
+
+    return std::make_shared<SharedMetricAggregator>(entry.metric,
+                                                    entry.histogram);
+}
+
+void
+SharedMemoryEventService::
+dump(std::ostream & stream) const
+{
+    const SharedMetricsSegment::Header & header = segment_.header();
+    uint32_t numMetrics = header.numMetrics.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0;  i < numMetrics;  ++i) {
+        const SharedMetricsSegment::Metric & metric = segment_.metric(i);
+        stream << metric.name << " " << metric.count
+               << " " << metric.sum << endl;
+    }
+}
+
+
+/*****************************************************************************/
+/* SHARED METRICS READER                                                     */
+/*****************************************************************************/
+
+SharedMetricsReader::
+SharedMetricsReader(const std::string & segmentName)
+    : segmentName(segmentName)
+{
+    // The process may not have been started yet; in that case everything
+    // in the segment will be new when it is found.
+    first = reopen();
+    lastRead = Date::now();
+}
+
+std::string
+SharedMetricsReader::
+prefix() const
+{
+    return segment.isOpen() ? segment.header().prefix : "";
+}
+
+uint64_t
+SharedMetricsReader::
+numDropped() const
+{
+    if (!segment.isOpen()) return 0;
+    return segment.header().numDropped.load(std::memory_order_relaxed);
+}
+
+bool
+SharedMetricsReader::
+reopen()
+{
+    segment.close();
+    previous.clear();
+
+    try {
+        segment.open(segmentName);
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<StatReading>
+SharedMetricsReader::
+read()
+{
+    if (segment.replaced()) {
+        // Everything in the new segment happened since it was created
+        first = false;
+        if (!reopen()) {
+            lastRead = Date::now();
+            return std::vector<StatReading>();
+        }
+    }
+
+    Date now = Date::now();
+    double elapsed = std::max(now.secondsSince(lastRead), 1e-3);
+    lastRead = now;
+
+    const SharedMetricsSegment::Header & header = segment.header();
+    uint32_t numMetrics = header.numMetrics.load(std::memory_order_acquire);
+    if (previous.size() < numMetrics)
+        previous.resize(numMetrics);
+
+    std::vector<StatReading> result;
+
+    for (uint32_t i = 0;  i < numMetrics;  ++i) {
+        const SharedMetricsSegment::Metric & metric = segment.metric(i);
+        Previous & prev = previous[i];
+
+        uint64_t count = metric.count.load(std::memory_order_acquire);
+        double sum = metric.sum.load(std::memory_order_relaxed);
+
+        QuantileSketch sketch;
+        bool hasHistogram = metric.histogram != SharedMetricsSegment::NoHistogram;
+
+        if (hasHistogram) {
+            const SharedMetricsSegment::Histogram & histogram
+                = segment.histogram(metric.histogram);
+            prev.counts.resize(QuantileSketch::NumBuckets);
+
+            // Bounds of the values from the buckets that were hit
+            for (unsigned j = 0;  j < QuantileSketch::NumBuckets;  ++j) {
+                uint64_t n = histogram.counts[j].load(std::memory_order_relaxed);
+                uint64_t delta = n - prev.counts[j];
+                prev.counts[j] = n;
+                if (!delta) continue;
+
+                double value = QuantileSketch::valueOf(j);
+                if (j == 0) value = 0.0;
+                if (j == QuantileSketch::NumBuckets - 1)
+                    value = std::ldexp(1.0, QuantileSketch::MaxExponent + 1);
+                sketch.counts[j] = delta;
+                sketch.total += delta;
+                sketch.min_ = std::min<float>(sketch.min_, value);
+                sketch.max_ = std::max<float>(sketch.max_, value);
+            }
+        }
+
+        uint64_t numEvents = count - prev.count;
+        double total = sum - prev.sum;
+        prev.count = count;
+        prev.sum = sum;
+
+        if (first || !numEvents) continue;
+
+        sketch.sum = total;
+
+        std::string name = metric.name;
+        auto addMetric = [&] (const std::string & suffix, double value)
+            {
+                if (suffix.empty())
+                    result.push_back(StatReading(name, value, now));
+                else result.push_back(StatReading(name + "." + suffix,
+                                                  value, now));
+            };
+
+        switch (metric.type) {
+        case ET_HIT:
+            addMetric("", numEvents / elapsed);
+            break;
+        case ET_COUNT:
+            addMetric("", total / elapsed);
+            break;
+        case ET_STABLE_LEVEL:
+            addMetric("", total / numEvents);
+            break;
+        case ET_LEVEL:
+        case ET_OUTCOME:
+            addMetric("mean", total / numEvents);
+            if (!sketch.empty()) {
+                addMetric("upper", sketch.max());
+                addMetric("lower", sketch.min());
+            }
+            if (metric.type == ET_LEVEL) break;
+            addMetric("count", numEvents);
+            for (int pct: DefaultOutcomePercentiles)
+                addMetric(ML::format("upper_%d", pct), sketch.percentile(pct));
+            break;
+        default:
+            break;
+        }
+    }
+
+    first = false;
+    return result;
+}
+
+} // namespace Datacratic
@@ -0,0 +1,267 @@
+/* shared_metrics.h                                                -*- C++ -*-
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Metrics written into a shared memory segment for an exporter process to
+   read and forward to carbon.
+*/
+
+#pragma once
+
+#include "soa/service/service_base.h"
+#include "soa/service/stat_aggregator.h"
+#include "soa/service/quantile_sketch.h"
+#include "soa/types/date.h"
+#include <boost/thread/tss.hpp>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <sys/types.h>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* SHARED METRICS SEGMENT                                                    */
+/*****************************************************************************/
+
+/** POSIX shared memory segment holding the metrics of a process.
+
+    The segment starts with a header page, followed by a fixed array of
+    metrics and a fixed array of histograms for the levels and outcomes.
+    Metrics are only ever added, never removed, and their values are
+    cumulative since the segment was created: the process never resets
+    anything and the reader works out what happened over each period from
+    the difference with its previous read.
+
+    A metric is published by filling it in and then incrementing
+    numMetrics with release semantics, so a reader only needs to look at
+    the first numMetrics entries.
+*/
+struct SharedMetricsSegment {
+
+    static const uint64_t Magic = 0x31525445534d4252ULL;  // "RBMSETR1"
+
+    enum {
+        Version = 1,
+        PrefixLength = 128,
+        NameLength = 168,
+        NoHistogram = 0xffffffff
+    };
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t maxMetrics;
+        uint32_t maxHistograms;
+        uint32_t unused;
+        int64_t pid;
+        double created;                     ///< Seconds since the epoch
+        char prefix[PrefixLength];          ///< Carbon path of the process
+        std::atomic<uint32_t> numMetrics;
+        std::atomic<uint32_t> numHistograms;
+        std::atomic<uint64_t> numDropped;   ///< Events with no room left
+    };
+
+    struct Metric {
+        char name[NameLength];              ///< Null terminated
+        uint32_t type;                      ///< StatEventType
+        uint32_t histogram;                 ///< Index or NoHistogram
+        std::atomic<uint64_t> count;        ///< Number of events
+        std::atomic<double> sum;            ///< Sum of their values
+    };
+
+    struct Histogram {
+        std::atomic<uint64_t> counts[QuantileSketch::NumBuckets];
+    };
+
+    SharedMetricsSegment();
+    ~SharedMetricsSegment();
+
+    /** Creates a new segment with the given name, replacing any existing
+        segment of that name so that a restarted process starts from zero.
+    */
+    void create(const std::string & name,
+                const std::string & prefix,
+                size_t maxMetrics,
+                size_t maxHistograms);
+
+    /** Maps an existing segment, read only. */
+    void open(const std::string & name);
+
+    void close();
+
+    /** Removes the name of the segment; the processes that have it mapped
+        keep using it.
+    */
+    static void unlink(const std::string & name);
+
+    bool isOpen() const { return base != nullptr; }
+
+    /** Returns true if the name no longer refers to the segment that is
+        mapped, because it was removed or a new process created another one.
+    */
+    bool replaced() const;
+
+    const std::string & name() const { return name_; }
+
+    Header & header() const
+    {
+        return *reinterpret_cast<Header *>(base);
+    }
+
+    Metric & metric(size_t index) const
+    {
+        return reinterpret_cast<Metric *>(base + MetricsOffset)[index];
+    }
+
+    Histogram & histogram(size_t index) const
+    {
+        Histogram * histograms = reinterpret_cast<Histogram *>
+            (base + histogramsOffset(header().maxMetrics));
+        return histograms[index];
+    }
+
+private:
+    enum { MetricsOffset = 4096 };
+
+    static size_t histogramsOffset(size_t maxMetrics);
+    static size_t segmentSize(size_t maxMetrics, size_t maxHistograms);
+
+    void map(int fd, size_t size, bool writable);
+
+    std::string name_;
+    char * base;
+    size_t size;
+    int fd;
+    ino_t inode;
+};
+
+
+/*****************************************************************************/
+/* SHARED MEMORY EVENT SERVICE                                               */
+/*****************************************************************************/
+
+/** Event service that records the events into a SharedMetricsSegment
+    rather than aggregating them and sending them to carbon itself.  An
+    event is a couple of atomic adds in the segment; there is no dumping
+    thread and no socket in the process, that is left to the exporter (see
+    shared_metrics_exporter).
+
+    Names are looked up in a per thread cache like MultiAggregator does,
+    and EventHandle records straight into the segment.  Events that don't
+    fit, because the segment is full or the name is too long, are counted
+    in the numDropped field of the header.
+*/
+struct SharedMemoryEventService : public EventService {
+
+    SharedMemoryEventService(const std::string & segmentName,
+                             const std::string & prefix = "",
+                             size_t maxMetrics = 16384,
+                             size_t maxHistograms = 1024);
+
+    ~SharedMemoryEventService();
+
+    virtual void onEvent(const std::string & name,
+                         const char * event,
+                         StatEventType type,
+                         float value,
+                         std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
+    virtual void dump(std::ostream & stream) const;
+
+    virtual std::shared_ptr<StatAggregator>
+    getAggregator(const std::string & name,
+                  const char * event,
+                  StatEventType type,
+                  std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
+    const SharedMetricsSegment & segment() const { return segment_; }
+
+    /** Records a value into a metric of the segment. */
+    static void record(SharedMetricsSegment::Metric & metric,
+                       SharedMetricsSegment::Histogram * histogram,
+                       float value);
+
+private:
+    SharedMetricsSegment segment_;
+
+    struct Entry {
+        SharedMetricsSegment::Metric * metric;
+        SharedMetricsSegment::Histogram * histogram;
+    };
+
+    typedef std::unordered_map<std::string, Entry> Entries;
+    Entries entries;        ///< Protected by lock
+    mutable std::mutex lock;
+
+    boost::thread_specific_ptr<Entries> lookupCache;
+
+    /** Returns the entry of the stat, adding it to the segment if it isn't
+        there yet.  Returns a null metric if it can't be added.
+    */
+    Entry getEntry(const std::string & stat, StatEventType type);
+};
+
+
+/*****************************************************************************/
+/* SHARED METRICS READER                                                     */
+/*****************************************************************************/
+
+/** Reads the metrics of a SharedMetricsSegment and turns them into the
+    readings that the aggregators of a MultiAggregator would have given for
+    the period since the previous read:
+
+    - hits and counts are reported per second;
+    - stable levels as their mean;
+    - levels as their mean, upper and lower;
+    - outcomes as their mean, upper, lower, count and 90th, 95th and 98th
+      percentiles, taken from the histogram.
+
+    The upper and lower values of the levels and outcomes come from the
+    histogram too and are within 1.5% of the real ones.
+
+    The first read only takes note of the current values.  When the process
+    is restarted and replaces the segment the reader maps the new one; while
+    there is no segment, there are no readings.
+*/
+struct SharedMetricsReader {
+
+    SharedMetricsReader(const std::string & segmentName);
+
+    /** Returns the readings since the last call, named after the metrics.
+        Doesn't include the prefix of the process; see prefix().
+    */
+    std::vector<StatReading> read();
+
+    /** Carbon path that the process was started with. */
+    std::string prefix() const;
+
+    /** Number of events that the process couldn't record. */
+    uint64_t numDropped() const;
+
+private:
+    std::string segmentName;
+    SharedMetricsSegment segment;
+
+    struct Previous {
+        Previous()
+            : count(0), sum(0.0)
+        {
+        }
+
+        uint64_t count;
+        double sum;
+        std::vector<uint64_t> counts;
+    };
+
+    std::vector<Previous> previous;
+    Date lastRead;
+    bool first;
+
+    /** Maps the segment again, returning false if it doesn't exist. */
+    bool reopen();
+};
+
+} // namespace Datacratic
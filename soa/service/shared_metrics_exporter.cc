@@ -0,0 +1,109 @@
+/** shared_metrics_exporter.cc
+    14 October 2026
+    Copyright (c) 2026 Datacratic.  All rights reserved.
+
+    Reads the metrics that a process writes into shared memory and sends
+    them to carbon, or prints them when no carbon connection is given.
+*/
+
+#include "soa/service/shared_metrics.h"
+#include "soa/service/carbon_connector.h"
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <thread>
+#include <chrono>
+#include <iostream>
+
+namespace po = boost::program_options;
+
+using namespace std;
+using namespace Datacratic;
+using namespace ML;
+
+int main(int argc, char* argv[])
+{
+    ios::sync_with_stdio(true);
+
+    string segmentName;
+    vector<string> carbonUris;
+    string prefix;
+    string protocol = "plaintext";
+    double interval = 1.0;
+
+    po::options_description desc("Main options");
+    desc.add_options()
+        ("segment,s", po::value(&segmentName),
+         "name of the shared memory segment of the process")
+        ("carbon-connection,c", po::value(&carbonUris),
+         "URI for connecting to carbon daemon; may be repeated")
+        ("prefix,p", po::value(&prefix),
+         "carbon path to use instead of the one of the process")
+        ("protocol", po::value(&protocol)->default_value(protocol),
+         "format of the messages sent to carbon: plaintext or pickle")
+        ("interval,i", po::value(&interval)->default_value(interval),
+         "seconds between two reads of the segment")
+        ("help,h", "Produce help message");
+
+    po::variables_map vm;
+    bool showHelp = false;
+
+    try{
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }catch(const std::exception & exc){
+        //invalid command line param
+        cerr << "command line parsing error: " << exc.what() << endl;
+        showHelp = true;
+    }
+
+    if (showHelp || vm.count("help") || segmentName.empty()){
+        cout << desc << "\n";
+        return showHelp ? 0 : 1;
+    }
+
+    SharedMetricsReader reader(segmentName);
+    std::unique_ptr<CarbonConnector> carbon;
+    uint64_t numDropped = 0;
+
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::microseconds(
+                                            int64_t(interval * 1000000)));
+
+        vector<StatReading> readings = reader.read();
+
+        uint64_t dropped = reader.numDropped();
+        if (dropped > numDropped)
+            cerr << "warning: " << segmentName << " dropped "
+                 << dropped - numDropped << " events" << endl;
+        numDropped = dropped;
+
+        if (readings.empty()) continue;
+
+        if (carbonUris.empty()) {
+            string path = prefix.empty() ? reader.prefix() : prefix;
+            if (!path.empty()) path += ".";
+
+            for (auto & reading: readings)
+                cout << path << reading.name << " " << reading.value << " "
+                     << (uint64_t)reading.timestamp.secondsSinceEpoch()
+                     << "\n";
+            cout.flush();
+            continue;
+        }
+
+        // Connected the first time that the prefix of the process is known.
+        // Its own aggregators only get its dump and send times; the readings
+        // go to doStat().
+        if (!carbon) {
+            carbon.reset(new CarbonConnector(
+                                 carbonUris,
+                                 prefix.empty() ? reader.prefix() : prefix,
+                                 interval));
+            carbon->setProtocol(CarbonConnector::parseProtocol(protocol));
+        }
+
+        carbon->doStat(readings);
+    }
+}
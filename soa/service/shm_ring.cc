@@ -0,0 +1,394 @@
+/* shm_ring.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Message rings in shared memory.
+*/
+
+#include "shm_ring.h"
+#include "jml/arch/exception.h"
+#include "jml/utils/exc_assert.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* SHM RING                                                                  */
+/*****************************************************************************/
+
+/* Layout of the start of the segment.  The positions only ever grow, and
+   are taken modulo the capacity; each is on its own cache line so that the
+   two sides don't fight over it.
+
+   A message is written as its number of frames followed by the size and
+   content of each frame, all sizes being 32 bits.
+*/
+struct ShmRing::Header {
+    enum { MAGIC = 0x676e6972206d6873ULL /* "shm ring" */ };
+
+    uint64_t magic;
+    uint64_t capacity;
+    char pad0[48];
+
+    std::atomic<uint64_t> head;     ///< Bytes ever written
+    char pad1[56];
+
+    std::atomic<uint64_t> tail;     ///< Bytes ever read
+    char pad2[56];
+
+    std::atomic<uint32_t> waiting;  ///< Reader found the ring empty
+    char pad3[60];
+};
+
+std::shared_ptr<ShmRing>
+ShmRing::
+create(const std::string & name, size_t capacity)
+{
+    size_t rounded = 4096;
+    while (rounded < capacity)
+        rounded *= 2;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+        throw Exception(errno, "shm_open " + name);
+
+    size_t mappedSize = sizeof(Header) + rounded;
+    if (ftruncate(fd, mappedSize) == -1) {
+        int err = errno;
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw Exception(err, "ftruncate " + name);
+    }
+
+    void * mapping = mmap(0, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd, 0);
+    int err = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw Exception(err, "mmap " + name);
+    }
+
+    // The segment comes zeroed, which is what the positions start at
+    Header * header = reinterpret_cast<Header *>(mapping);
+    header->capacity = rounded;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = Header::MAGIC;
+
+    return std::shared_ptr<ShmRing>
+        (new ShmRing(name, mapping, mappedSize, true /* owner */));
+}
+
+std::shared_ptr<ShmRing>
+ShmRing::
+open(const std::string & name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1)
+        throw Exception(errno, "shm_open " + name);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int err = errno;
+        ::close(fd);
+        throw Exception(err, "fstat " + name);
+    }
+
+    size_t mappedSize = st.st_size;
+    if (mappedSize < sizeof(Header)) {
+        ::close(fd);
+        throw Exception("shared memory segment " + name + " is too small");
+    }
+
+    void * mapping = mmap(0, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd, 0);
+    int err = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        throw Exception(err, "mmap " + name);
+
+    Header * header = reinterpret_cast<Header *>(mapping);
+    if (header->magic != Header::MAGIC
+        || header->capacity + sizeof(Header) != mappedSize) {
+        munmap(mapping, mappedSize);
+        throw Exception("shared memory segment " + name + " isn't a ring");
+    }
+
+    return std::shared_ptr<ShmRing>
+        (new ShmRing(name, mapping, mappedSize, false /* owner */));
+}
+
+void
+ShmRing::
+unlink(const std::string & name)
+{
+    if (shm_unlink(name.c_str()) == -1 && errno != ENOENT)
+        throw Exception(errno, "shm_unlink " + name);
+}
+
+ShmRing::
+ShmRing(const std::string & name, void * mapping, size_t mappedSize,
+        bool owner)
+    : name_(name),
+      header(reinterpret_cast<Header *>(mapping)),
+      data(reinterpret_cast<char *>(mapping) + sizeof(Header)),
+      mappedSize(mappedSize),
+      mask(header->capacity - 1),
+      owner(owner)
+{
+}
+
+ShmRing::
+~ShmRing()
+{
+    munmap(header, mappedSize);
+    if (owner)
+        shm_unlink(name_.c_str());
+}
+
+size_t
+ShmRing::
+capacity() const
+{
+    return mask + 1;
+}
+
+void
+ShmRing::
+write(uint64_t pos, const void * src, size_t size)
+{
+    size_t offset = pos & mask;
+    size_t first = std::min(size, capacity() - offset);
+    memcpy(data + offset, src, first);
+    memcpy(data, (const char *)src + first, size - first);
+}
+
+void
+ShmRing::
+read(uint64_t pos, void * dest, size_t size) const
+{
+    size_t offset = pos & mask;
+    size_t first = std::min(size, capacity() - offset);
+    memcpy(dest, data + offset, first);
+    memcpy((char *)dest + first, data, size - first);
+}
+
+bool
+ShmRing::
+tryPush(const Frame * frames, size_t numFrames, bool & wakeup)
+{
+    wakeup = false;
+
+    size_t size = sizeof(uint32_t);
+    for (size_t i = 0;  i < numFrames;  ++i)
+        size += sizeof(uint32_t) + frames[i].size;
+
+    if (size > capacity())
+        throw Exception("message of %zd bytes can't fit in ring %s",
+                        size, name_.c_str());
+
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    uint64_t tail = header->tail.load(std::memory_order_acquire);
+    if (head + size - tail > capacity())
+        return false;
+
+    uint64_t pos = head;
+    uint32_t count = numFrames;
+    write(pos, &count, sizeof(count));
+    pos += sizeof(count);
+
+    for (size_t i = 0;  i < numFrames;  ++i) {
+        uint32_t frameSize = frames[i].size;
+        write(pos, &frameSize, sizeof(frameSize));
+        pos += sizeof(frameSize);
+        write(pos, frames[i].data, frameSize);
+        pos += frameSize;
+    }
+
+    // Sequentially consistent so that either we see the reader waiting
+    // or it sees the message once it has said it's waiting.
+    header->head.store(pos);
+    if (header->waiting.load() && header->waiting.exchange(0))
+        wakeup = true;
+
+    return true;
+}
+
+bool
+ShmRing::
+tryPush(const std::vector<std::string> & message, bool & wakeup)
+{
+    Frame frames[message.size()];
+    for (size_t i = 0;  i < message.size();  ++i)
+        frames[i] = { message[i].data(), message[i].size() };
+    return tryPush(frames, message.size(), wakeup);
+}
+
+bool
+ShmRing::
+tryPop(std::vector<std::string> & message)
+{
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    uint64_t head = header->head.load(std::memory_order_acquire);
+
+    if (head == tail) {
+        header->waiting.store(1);
+        head = header->head.load();
+        if (head == tail)
+            return false;
+        header->waiting.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t pos = tail;
+    uint32_t count;
+    read(pos, &count, sizeof(count));
+    pos += sizeof(count);
+
+    message.resize(count);
+    for (uint32_t i = 0;  i < count;  ++i) {
+        uint32_t frameSize;
+        read(pos, &frameSize, sizeof(frameSize));
+        pos += sizeof(frameSize);
+
+        ExcAssertLessEqual(pos + frameSize, head);
+        message[i].resize(frameSize);
+        read(pos, &message[i][0], frameSize);
+        pos += frameSize;
+    }
+
+    header->tail.store(pos, std::memory_order_release);
+    return true;
+}
+
+
+/*****************************************************************************/
+/* SHM WAKEUP                                                                */
+/*****************************************************************************/
+
+std::shared_ptr<ShmWakeup>
+ShmWakeup::
+create(const std::string & path)
+{
+    if (mkfifo(path.c_str(), 0600) == -1)
+        throw Exception(errno, "mkfifo " + path);
+
+    // Opened read-write so that it never reports end of file when there's
+    // no writer
+    int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        int err = errno;
+        ::unlink(path.c_str());
+        throw Exception(err, "open " + path);
+    }
+
+    return std::shared_ptr<ShmWakeup>
+        (new ShmWakeup(path, fd, true /* owner */));
+}
+
+std::shared_ptr<ShmWakeup>
+ShmWakeup::
+open(const std::string & path)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1)
+        throw Exception(errno, "open " + path);
+
+    return std::shared_ptr<ShmWakeup>
+        (new ShmWakeup(path, fd, false /* owner */));
+}
+
+ShmWakeup::
+ShmWakeup(const std::string & path, int fd, bool owner)
+    : path_(path), fd_(fd), owner(owner)
+{
+}
+
+ShmWakeup::
+~ShmWakeup()
+{
+    ::close(fd_);
+    if (owner)
+        ::unlink(path_.c_str());
+}
+
+void
+ShmWakeup::
+signal()
+{
+    char c = 0;
+    // A full pipe already has signals pending
+    while (::write(fd_, &c, 1) == -1 && errno == EINTR)
+        ;
+}
+
+void
+ShmWakeup::
+drain()
+{
+    char buf[256];
+    for (;;) {
+        ssize_t res = ::read(fd_, buf, sizeof(buf));
+        if (res == -1 && errno == EINTR)
+            continue;
+        if (res < (ssize_t)sizeof(buf))
+            break;
+    }
+}
+
+
+/*****************************************************************************/
+/* SHM CHANNEL                                                               */
+/*****************************************************************************/
+
+ShmChannel::
+ShmChannel(std::shared_ptr<ShmRing> out,
+           std::shared_ptr<ShmRing> in,
+           std::shared_ptr<ShmWakeup> peer)
+    : out(std::move(out)), in(std::move(in)), peer(std::move(peer)),
+      dropped(0)
+{
+    ExcAssert(this->out);
+    ExcAssert(this->in);
+    ExcAssert(this->peer);
+}
+
+bool
+ShmChannel::
+send(const ShmRing::Frame * frames, size_t numFrames)
+{
+    bool wakeup;
+    {
+        std::unique_lock<std::mutex> guard(sendLock);
+        if (!out->tryPush(frames, numFrames, wakeup)) {
+            ++dropped;
+            return false;
+        }
+    }
+
+    if (wakeup)
+        peer->signal();
+    return true;
+}
+
+bool
+ShmChannel::
+send(const std::vector<std::string> & message)
+{
+    ShmRing::Frame frames[message.size()];
+    for (size_t i = 0;  i < message.size();  ++i)
+        frames[i] = { message[i].data(), message[i].size() };
+    return send(frames, message.size());
+}
+
+} // namespace Datacratic
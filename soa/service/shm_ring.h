@@ -0,0 +1,236 @@
+/* shm_ring.h                                                      -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Message rings in shared memory, to talk to a process on the same host
+   without going through the kernel.
+*/
+
+#pragma once
+
+#include "soa/service/zmq_utils.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* SHM RING                                                                  */
+/*****************************************************************************/
+
+/** Ring of messages in a POSIX shared memory segment, written by one
+    process and read by another.  A message is a list of frames, as with
+    zeromq, which tryPush() copies into the ring and tryPop() copies out of
+    it; neither makes a system call.
+
+    Only one thread at a time may push and only one may pop.
+
+    The reader marks the ring as waiting when it finds it empty, and
+    tryPush() tells the writer when it has to wake the reader up, which is
+    done through a ShmWakeup.
+*/
+
+struct ShmRing {
+
+    struct Frame {
+        const void * data;
+        size_t size;
+    };
+
+    /** Creates the segment with the given name ("/something"), with room
+        for capacity bytes of messages rounded up to a power of two.  The
+        name is removed when the ring is destroyed.
+    */
+    static std::shared_ptr<ShmRing>
+    create(const std::string & name, size_t capacity);
+
+    /** Maps the existing segment with the given name. */
+    static std::shared_ptr<ShmRing> open(const std::string & name);
+
+    /** Removes the name of the segment, if it's still there.  Mappings of
+        the segment stay valid.
+    */
+    static void unlink(const std::string & name);
+
+    ~ShmRing();
+
+    /** Copies the message into the ring.  Returns false, leaving the ring
+        untouched, if there isn't room for it right now; messages that
+        could never fit throw.  Sets wakeup if the reader is waiting for
+        the message.
+    */
+    bool tryPush(const Frame * frames, size_t numFrames, bool & wakeup);
+
+    bool tryPush(const std::vector<std::string> & message, bool & wakeup);
+
+    /** Takes the oldest message out of the ring.  Returns false if it's
+        empty, in which case the ring is marked as waiting.
+    */
+    bool tryPop(std::vector<std::string> & message);
+
+    const std::string & name() const
+    {
+        return name_;
+    }
+
+    size_t capacity() const;
+
+private:
+    struct Header;
+
+    ShmRing(const std::string & name, void * mapping, size_t mappedSize,
+            bool owner);
+
+    void write(uint64_t pos, const void * data, size_t size);
+    void read(uint64_t pos, void * data, size_t size) const;
+
+    std::string name_;
+    Header * header;
+    char * data;
+    size_t mappedSize;
+    uint64_t mask;
+    bool owner;
+};
+
+
+/*****************************************************************************/
+/* SHM WAKEUP                                                                */
+/*****************************************************************************/
+
+/** Named pipe used to wake up a process waiting on the rings it reads.
+    Its fd becomes readable once signalled, and stays so until drained.
+*/
+
+struct ShmWakeup {
+
+    /** Creates the pipe at the given path, to wait on it.  The path is
+        removed when the object is destroyed.
+    */
+    static std::shared_ptr<ShmWakeup> create(const std::string & path);
+
+    /** Opens the pipe of another process, to signal it. */
+    static std::shared_ptr<ShmWakeup> open(const std::string & path);
+
+    ~ShmWakeup();
+
+    int fd() const
+    {
+        return fd_;
+    }
+
+    const std::string & path() const
+    {
+        return path_;
+    }
+
+    /** Wakes the other side up.  Never blocks. */
+    void signal();
+
+    /** Reads the pending signals so that the fd isn't readable anymore. */
+    void drain();
+
+private:
+    ShmWakeup(const std::string & path, int fd, bool owner);
+
+    std::string path_;
+    int fd_;
+    bool owner;
+};
+
+
+/*****************************************************************************/
+/* SHM CHANNEL                                                               */
+/*****************************************************************************/
+
+/** Connection to a process on the same host made of a ring for each
+    direction.  The peer's wakeup is signalled when it's waiting on a
+    message we send.
+
+    Sending is thread safe; receiving must always be done by the same
+    thread.
+*/
+
+struct ShmChannel {
+
+    ShmChannel(std::shared_ptr<ShmRing> out,
+               std::shared_ptr<ShmRing> in,
+               std::shared_ptr<ShmWakeup> peer);
+
+    /** Sends a message made of the given frames.  Returns false and drops
+        the message if the peer is too far behind to take it.
+    */
+    bool send(const ShmRing::Frame * frames, size_t numFrames);
+
+    bool send(const std::vector<std::string> & message);
+
+    /** Sends a message made of the arguments, encoded as they would be for
+        zeromq by sendMessage().  A trailing vector of strings adds one
+        frame per string.
+    */
+    template<typename... Args>
+    bool sendMessage(Args&&... args)
+    {
+        std::vector<zmq::message_t> encoded;
+        encoded.reserve(sizeof...(Args) + 4);
+        encodeAll(encoded, std::forward<Args>(args)...);
+
+        ShmRing::Frame frames[encoded.size()];
+        for (size_t i = 0;  i < encoded.size();  ++i)
+            frames[i] = { encoded[i].data(), encoded[i].size() };
+        return send(frames, encoded.size());
+    }
+
+    /** Takes the next message sent by the peer, if there is one. */
+    bool receive(std::vector<std::string> & message)
+    {
+        return in->tryPop(message);
+    }
+
+    /** Number of messages dropped because the peer couldn't take them. */
+    uint64_t numDropped() const
+    {
+        return dropped;
+    }
+
+private:
+    template<typename Head, typename... Tail>
+    static void encodeAll(std::vector<zmq::message_t> & encoded,
+                          Head && head, Tail&&... tail)
+    {
+        encodeOne(encoded, std::forward<Head>(head));
+        encodeAll(encoded, std::forward<Tail>(tail)...);
+    }
+
+    static void encodeAll(std::vector<zmq::message_t> & encoded)
+    {
+    }
+
+    template<typename T>
+    static void encodeOne(std::vector<zmq::message_t> & encoded,
+                          const T & value)
+    {
+        encoded.emplace_back(encodeMessage(value));
+    }
+
+    static void encodeOne(std::vector<zmq::message_t> & encoded,
+                          const std::vector<std::string> & values)
+    {
+        for (auto & v: values)
+            encoded.emplace_back(encodeMessage(v));
+    }
+
+    std::shared_ptr<ShmRing> out;
+    std::shared_ptr<ShmRing> in;
+    std::shared_ptr<ShmWakeup> peer;
+
+    std::mutex sendLock;
+    std::atomic<uint64_t> dropped;
+};
+
+} // namespace Datacratic
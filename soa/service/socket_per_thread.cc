@@ -30,7 +30,7 @@ namespace Datacratic {
 SocketPerThread::
 SocketPerThread()
     : context(0), type(0), numOpen(0), state(NOTINITIALIZED),
-      entries(onFreeEntry)
+      generation(0), entries(onFreeEntry)
 {
 }
 
@@ -41,7 +41,7 @@ SocketPerThread(zmq::context_t & context,
                 bool allowForceClose)
     : context(&context), type(type), uri(uri),
       allowForceClose(allowForceClose), numOpen(0),
-      state(READY), entries(onFreeEntry)
+      state(READY), generation(0), entries(onFreeEntry)
 {
     //std::cerr << "finished init of socket " << uri << std::endl;
 }
@@ -98,6 +98,15 @@ shutdown()
     }
 }
 
+void
+SocketPerThread::
+setUri(const std::string & newUri)
+{
+    Guard guard(allThreadsLock);
+    uri = newUri;
+    ++generation;
+}
+
 void
 SocketPerThread::
 initForThisThread() const
@@ -119,9 +128,17 @@ initForThisThread() const
             
     std::auto_ptr<zmq::socket_t> newPtr
         (new zmq::socket_t(*context, type));
-    setIdentity(*newPtr, ML::format("thr%lld",
-                                    (long long)ACE_OS::thr_self()));
-    newPtr->connect(uri.c_str());
+    if (onNewSocket)
+        onNewSocket(*newPtr);
+    else setIdentity(*newPtr, ML::format("thr%lld",
+                                         (long long)ACE_OS::thr_self()));
+
+    {
+        Guard guard(allThreadsLock);
+        newEntry->connectedUri = uri;
+        newEntry->generation = generation;
+    }
+    newPtr->connect(newEntry->connectedUri.c_str());
 
     newEntry->sock = newPtr.release();
     //if (!allForThread.get())
@@ -132,8 +149,29 @@ initForThisThread() const
     mThis->addThreadEntry(entries.get());
     ML::atomic_inc(numOpen);
 
-    // wait for ZMQ when connecting...
-    ML::sleep(0.1);
+    // No need to wait for the connection: zeromq queues what we send until
+    // it's up.
+}
+
+void
+SocketPerThread::
+reconnectThisThread() const
+{
+    Entry * entry = entries.get();
+
+    std::string newUri;
+    {
+        Guard guard(allThreadsLock);
+        newUri = uri;
+        entry->generation = generation;
+    }
+
+    if (newUri == entry->connectedUri)
+        return;
+
+    entry->sock->tryDisconnect(entry->connectedUri);
+    entry->sock->connect(newUri.c_str());
+    entry->connectedUri = newUri;
 }
     
 void
@@ -16,6 +16,8 @@
 #include "jml/compiler/compiler.h"
 #include "jml/arch/spinlock.h"
 #include "jml/arch/exception.h"
+#include <atomic>
+#include <functional>
 #include <set>
 
 
@@ -58,12 +60,22 @@ struct SocketPerThread : boost::noncopyable {
 
     void shutdown();
 
+    /** Connect the sockets to the given URI instead.  Each thread moves its
+        socket over the next time it uses it.
+    */
+    void setUri(const std::string & newUri);
+
     zmq::context_t * context;   ///< Owning zeromq context
     int type;                   ///< Type to create
     std::string uri;            ///< URI to connect to
     bool allowForceClose;       ///< Cleanup open sockets on destruction?
     mutable int numOpen;        ///< Num of open connections to detect misuse
 
+    /** Called on each new socket before it connects, to set its options.
+        When not set, the identity is "thr" followed by the thread's id.
+    */
+    std::function<void (zmq::socket_t &)> onNewSocket;
+
     /** Return (creating if necessary) the socket for this thread. */
     inline zmq::socket_t & operator () () const
     {
@@ -73,12 +85,18 @@ struct SocketPerThread : boost::noncopyable {
         if (JML_UNLIKELY(!entries.get())) {
             initForThisThread();
         }
+        else if (JML_UNLIKELY(entries->generation != generation)) {
+            reconnectThisThread();
+        }
 
         return *entries->sock;
     }
 
     /** Initialize the socket for this thread. */
     void initForThisThread() const;
+
+    /** Connect the socket for this thread to the current URI. */
+    void reconnectThisThread() const;
     
     /** Prematurely pretend that this thread has exited for this socket. */
     void cleanupThisThread();
@@ -101,12 +119,17 @@ private:
     struct Entry {
         zmq::socket_t * sock;
         SocketPerThread * owner;
+        std::string connectedUri;
+        int generation;         ///< Of the uri we're connected to
     };
 
+    /** Bumped each time the uri changes. */
+    std::atomic<int> generation;
+
     /** All threads that are alive */
     std::set<Entry *> allThreads;
 
-    /** Lock to protect allThreads. */
+    /** Lock to protect allThreads and changes to the uri. */
     typedef ML::Spinlock Lock;
     typedef boost::unique_lock<Lock> Guard;
     mutable Lock allThreadsLock;
@@ -10,6 +10,8 @@
 #include <boost/algorithm/string.hpp>
 #include "jml/utils/exc_assert.h"
 #include "soa/types/basic_value_descriptions.h"
+#include <exception>
+#include <thread>
 
 using namespace std;
 using namespace ML;
@@ -355,7 +357,56 @@ SqsApi::
 receiveMessageBatch(const std::string & queueUri,
                     int maxNumberOfMessages,
                     int visibilityTimeout,
-                    int waitTimeSeconds)
+                    int waitTimeSeconds,
+                    int numReceivers)
+{
+    ExcAssertGreaterEqual(numReceivers, 1);
+
+    if (numReceivers == 1) {
+        return receiveMessages(queueUri, maxNumberOfMessages,
+                               visibilityTimeout, waitTimeSeconds);
+    }
+
+    vector<vector<Message> > received(numReceivers);
+    vector<std::exception_ptr> errors(numReceivers);
+
+    auto receive = [&] (int i)
+        {
+            try {
+                received[i] = receiveMessages(queueUri, maxNumberOfMessages,
+                                              visibilityTimeout,
+                                              waitTimeSeconds);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+
+    // The calling thread is one of the receivers
+    vector<std::thread> threads;
+    for (int i = 1;  i < numReceivers;  ++i)
+        threads.emplace_back(receive, i);
+    receive(0);
+    for (auto & t: threads)
+        t.join();
+
+    vector<Message> messages;
+    for (int i = 0;  i < numReceivers;  ++i) {
+        if (errors[i])
+            std::rethrow_exception(errors[i]);
+        messages.insert(messages.end(),
+                        std::make_move_iterator(received[i].begin()),
+                        std::make_move_iterator(received[i].end()));
+    }
+
+    return messages;
+}
+
+vector<SqsApi::Message>
+SqsApi::
+receiveMessages(const std::string & queueUri,
+                int maxNumberOfMessages,
+                int visibilityTimeout,
+                int waitTimeSeconds)
 {
     vector<SqsApi::Message> messages;
 
@@ -152,10 +152,20 @@ struct SqsApi : public AwsBasicApi {
                            int visibilityTimeout = -1,
                            int waitTimeSeconds = -1);
 
+    /* Receive a batch of messages from a queue.
+
+        \param numReceivers   Number of ReceiveMessage requests made in
+                              parallel, each of which returns up to
+                              maxNumberOfMessages messages.  Long polling
+                              with several receivers keeps more than one
+                              batch in flight, which raises the throughput
+                              on busy queues.
+    */
     std::vector<Message> receiveMessageBatch(const std::string & queueUri,
                                              int maxNumberOfMessages = 1,
                                              int visibilityTimeout = -1,
-                                             int waitTimeSeconds = -1);
+                                             int waitTimeSeconds = -1,
+                                             int numReceivers = 1);
 
     /* Delete a message from a queue.
 
@@ -251,6 +261,12 @@ struct SqsApi : public AwsBasicApi {
     /** Turns a queue URI into a relative resource path for the HttpRestProxy */
     std::string getQueueResource(const std::string & queueUri) const;
 
+private:
+    /** A single ReceiveMessage request. */
+    std::vector<Message> receiveMessages(const std::string & queueUri,
+                                         int maxNumberOfMessages,
+                                         int visibilityTimeout,
+                                         int waitTimeSeconds);
 };
 
 CREATE_STRUCTURE_DESCRIPTION_NAMED(SqsSnsMessageBodyDescription, SqsApi::SnsMessageBody);
@@ -16,6 +16,7 @@
 #include "jml/utils/exc_check.h"
 #include <boost/tuple/tuple.hpp>
 #include <algorithm>
+#include <limits>
 
 
 using namespace std;
@@ -57,6 +58,8 @@ reset()
 
     while (!ML::cmp_xchg(total, oldval, 0.0));
 
+    oldval += hits.reset();
+
     Date oldStart = start;
     start = Date::now();
 
@@ -191,4 +194,97 @@ read(const std::string & prefix)
     return result;
 }
 
+
+/*****************************************************************************/
+/* OUTCOME SKETCH AGGREGATOR                                                 */
+/*****************************************************************************/
+
+OutcomeSketchAggregator::
+OutcomeSketchAggregator(const std::vector<int> & extra)
+    : start(Date::now()), extra(extra),
+      sum(0.0),
+      min_(std::numeric_limits<float>::infinity()),
+      max_(-std::numeric_limits<float>::infinity())
+{
+    ExcCheck(this->extra.size() > 0, "Can not construct with empty percentiles");
+
+    for (auto & count: counts)
+        count = 0;
+}
+
+OutcomeSketchAggregator::
+~OutcomeSketchAggregator()
+{
+}
+
+void
+OutcomeSketchAggregator::
+record(float value)
+{
+    counts[QuantileSketch::bucketOf(value)]
+        .fetch_add(1, std::memory_order_relaxed);
+
+    double oldSum = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(oldSum, oldSum + value,
+                                      std::memory_order_relaxed));
+
+    float oldMin = min_.load(std::memory_order_relaxed);
+    while (value < oldMin
+           && !min_.compare_exchange_weak(oldMin, value,
+                                          std::memory_order_relaxed));
+
+    float oldMax = max_.load(std::memory_order_relaxed);
+    while (value > oldMax
+           && !max_.compare_exchange_weak(oldMax, value,
+                                          std::memory_order_relaxed));
+}
+
+QuantileSketch
+OutcomeSketchAggregator::
+reset()
+{
+    QuantileSketch result;
+
+    for (size_t i = 0;  i < QuantileSketch::NumBuckets;  ++i) {
+        uint64_t count = counts[i].exchange(0);
+        result.counts[i] = count;
+        result.total += count;
+    }
+
+    result.sum = sum.exchange(0.0);
+    result.min_ = min_.exchange(std::numeric_limits<float>::infinity());
+    result.max_ = max_.exchange(-std::numeric_limits<float>::infinity());
+
+    start = Date::now();
+
+    return result;
+}
+
+std::vector<StatReading>
+OutcomeSketchAggregator::
+read(const std::string & prefix)
+{
+    QuantileSketch sketch = reset();
+
+    if (sketch.empty())
+        return vector<StatReading>();
+
+    vector<StatReading> result;
+
+    auto addMetric = [&] (const char * name, double value)
+        {
+            result.push_back(StatReading(prefix + "." + name,
+                                         value, start));
+        };
+
+    addMetric("mean", sketch.mean());
+    addMetric("upper", sketch.max());
+    addMetric("lower", sketch.min());
+    addMetric("count", sketch.count());
+    for (int pct: extra)
+        addMetric(ML::format("upper_%d", pct).c_str(), sketch.percentile(pct));
+
+    return result;
+}
+
 } // namespace Datacratic
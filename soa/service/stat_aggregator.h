@@ -12,6 +12,9 @@
 #include <boost/thread.hpp>
 #include "soa/types/date.h"
 #include "stats_events.h"
+#include "striped_counter.h"
+#include "quantile_sketch.h"
+#include <atomic>
 #include <unordered_map>
 #include <map>
 #include <deque>
@@ -52,6 +55,14 @@ struct StatAggregator {
     /** Read and reset the counter, providing output in Graphite's preferred
         format. */
     virtual std::vector<StatReading> read(const std::string & prefix) = 0;
+
+    /** Counter that hits can be added to directly, or null if the
+        aggregator doesn't count hits.
+    */
+    virtual StripedCounter * hitCounter()
+    {
+        return nullptr;
+    }
 };
 
 
@@ -74,9 +85,18 @@ struct CounterAggregator : public StatAggregator {
         format. */
     virtual std::vector<StatReading> read(const std::string & prefix);
 
+    /** Hits are counted on their own so that they can be recorded without
+        the compare and swap on the total; reset() adds them in.
+    */
+    virtual StripedCounter * hitCounter()
+    {
+        return &hits;
+    }
+
 private:
     Date start;    //< Date at which we last cleared the counter
     double total;  //< total since we last added it up
+    StripedCounter hits;
 
     std::deque<double> totalsBuffer; //< Totals for the last n reads.
 
@@ -122,4 +142,45 @@ private:
 };
 
 
+
+/*****************************************************************************/
+/* OUTCOME SKETCH AGGREGATOR                                                 */
+/*****************************************************************************/
+
+/** Aggregates outcomes like a GaugeAggregator in Outcome mode, with the same
+    readings, but into a QuantileSketch instead of keeping every value of
+    the period and sorting them when they're read.  Recording is a relaxed
+    atomic add on the bucket plus an update of the sum, and the memory and
+    the cost of a read don't depend on the rate of the metric; the price is
+    the 1.5% of error on the percentiles.
+
+    A value recorded while the aggregator is being read may be counted in
+    the period after the one its sum was added to.
+*/
+struct OutcomeSketchAggregator : public StatAggregator {
+
+    OutcomeSketchAggregator(const std::vector<int> & extra
+                                = DefaultOutcomePercentiles);
+
+    virtual ~OutcomeSketchAggregator();
+
+    virtual void record(float value);
+
+    /** Returns the sketch of the values since the last reset and starts
+        over.
+    */
+    QuantileSketch reset();
+
+    virtual std::vector<StatReading> read(const std::string & prefix);
+
+private:
+    Date start;
+    std::vector<int> extra;
+
+    std::atomic<uint64_t> counts[QuantileSketch::NumBuckets];
+    std::atomic<double> sum;
+    std::atomic<float> min_;
+    std::atomic<float> max_;
+};
+
 } // namespace Datacratic
@@ -8,6 +8,9 @@
 #include "ace/INET_Addr.h"
 #include "jml/arch/exception.h"
 #include "jml/arch/format.h"
+#include <sys/socket.h>
+#include <algorithm>
+#include <map>
 #include <iostream>
 
 
@@ -21,32 +24,71 @@ namespace Datacratic {
 /* STATSD CONNECTOR                                                          */
 /*****************************************************************************/
 
+struct StatsdConnector::ThreadMetrics {
+    std::mutex lock;
+
+    /// Sum of the increments of each counter and sample rate
+    std::map<std::pair<std::string, float>, int> counters;
+
+    /// Gauges, which can't be aggregated, as lines
+    std::vector<std::string> lines;
+};
+
 StatsdConnector::
 StatsdConnector()
+    : packetSize(1432), shutdown(false)
 {
 }
 
 StatsdConnector::
-StatsdConnector(const string& statsdAddr)
+StatsdConnector(const string& statsdAddr, double flushInterval,
+                size_t packetSize)
+    : packetSize(packetSize), shutdown(false)
 {
-    open(statsdAddr);
+    open(statsdAddr, flushInterval, packetSize);
 }
 
 StatsdConnector::
 ~StatsdConnector()
 {
+    stopFlushThread();
+    flush();
     sckt.close();
 }
 
 void
 StatsdConnector::
-open(const string& statsdAddr)
+open(const string& statsdAddr, double flushInterval, size_t packetSize)
 {
+    stopFlushThread();
     sckt.close();
     addr = ACE_INET_Addr(statsdAddr.c_str());
+    this->packetSize = packetSize;
 
-    if(sckt.open(addr) == -1)
+    // The address is where we send to; the socket itself binds anywhere
+    if(sckt.open(ACE_Addr::sap_any, addr.get_type()) == -1)
         throw Exception("could not create statsd udp socket");
+
+    if (flushInterval > 0.0) {
+        shutdown = false;
+        flushThread.reset(new std::thread(&StatsdConnector::runFlushThread,
+                                          this, flushInterval));
+    }
+}
+
+StatsdConnector::ThreadMetrics &
+StatsdConnector::
+threadMetrics()
+{
+    auto entry = metrics.get();
+    if (!entry) {
+        entry = new std::shared_ptr<ThreadMetrics>(new ThreadMetrics());
+        metrics.reset(entry);
+
+        std::lock_guard<std::mutex> guard(threadsLock);
+        threads.push_back(*entry);
+    }
+    return **entry;
 }
     
 void
@@ -56,19 +98,14 @@ incrementCounter(const char* counterName, float sampleRate, int value)
     if (sampleRate < 1.0 && ((random() % 10000) / 10000.0) >= sampleRate)
         return;
 
-    char msgBuf[1024];
-    int res = snprintf(msgBuf, 1024, "%s:%d|c|@%.2f", counterName, value,
-                       sampleRate);
-    if (res >= 1024) {
+    if (strlen(counterName) >= 1000) {
         cerr << "invalid statsd counter name: " << counterName << endl;
         return;
     }
-    
-    int sendRes = sckt.send(msgBuf, res, addr, MSG_DONTWAIT);
-    if (sendRes == -1) {
-        cerr << "statsd message failure: " << strerror(errno)
-             << endl;
-    }
+
+    ThreadMetrics & thread = threadMetrics();
+    std::lock_guard<std::mutex> guard(thread.lock);
+    thread.counters[make_pair(string(counterName), sampleRate)] += value;
 }
 
 void
@@ -85,12 +122,140 @@ recordGauge(const char* counterName, float sampleRate, float value)
         cerr << "invalid statsd counter name: " << counterName << endl;
         return;
     }
-    
-    int sendRes = sckt.send(msgBuf, res, addr, MSG_DONTWAIT);
-    if (sendRes == -1) {
-        cerr << "statsd message failure: " << strerror(errno)
-             << endl;
+
+    ThreadMetrics & thread = threadMetrics();
+    std::lock_guard<std::mutex> guard(thread.lock);
+    thread.lines.emplace_back(msgBuf, res);
+}
+
+void
+StatsdConnector::
+flush()
+{
+    std::map<std::pair<std::string, float>, int> counters;
+    std::vector<std::string> lines;
+
+    {
+        std::lock_guard<std::mutex> guard(threadsLock);
+
+        for (auto & thread: threads) {
+            std::lock_guard<std::mutex> threadGuard(thread->lock);
+            for (auto & counter: thread->counters)
+                counters[counter.first] += counter.second;
+            thread->counters.clear();
+
+            if (lines.empty()) lines.swap(thread->lines);
+            else {
+                lines.insert(lines.end(),
+                             std::make_move_iterator(thread->lines.begin()),
+                             std::make_move_iterator(thread->lines.end()));
+                thread->lines.clear();
+            }
+        }
+
+        // Forget about the threads that are gone, now that they're drained
+        threads.erase(std::remove_if(threads.begin(), threads.end(),
+                                     [] (const std::shared_ptr<ThreadMetrics> & t)
+                                     { return t.use_count() == 1; }),
+                      threads.end());
+    }
+
+    for (auto & counter: counters) {
+        lines.push_back(ML::format("%s:%d|c|@%.2f",
+                                   counter.first.first.c_str(),
+                                   counter.second,
+                                   counter.first.second));
+    }
+
+    if (!lines.empty())
+        sendPackets(packLines(lines, packetSize));
+}
+
+std::vector<std::string>
+StatsdConnector::
+packLines(const std::vector<std::string> & lines, size_t packetSize)
+{
+    std::vector<std::string> packets;
+
+    for (auto & line: lines) {
+        if (packets.empty()
+            || packets.back().size() + 1 + line.size() > packetSize) {
+            packets.emplace_back();
+            packets.back().reserve(std::max(packetSize, line.size()));
+        }
+        else packets.back() += '\n';
+
+        packets.back() += line;
+    }
+
+    return packets;
+}
+
+void
+StatsdConnector::
+sendPackets(const std::vector<std::string> & packets)
+{
+    enum { MaxBatch = 64 };
+
+    mmsghdr messages[MaxBatch];
+    iovec iovecs[MaxBatch];
+
+    for (size_t start = 0;  start < packets.size();) {
+        unsigned n = std::min<size_t>(MaxBatch, packets.size() - start);
+
+        for (unsigned i = 0;  i < n;  ++i) {
+            const std::string & packet = packets[start + i];
+            iovecs[i].iov_base = (void *)packet.data();
+            iovecs[i].iov_len = packet.size();
+
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_name = addr.get_addr();
+            messages[i].msg_hdr.msg_namelen = addr.get_size();
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int res = sendmmsg(sckt.get_handle(), messages, n, MSG_DONTWAIT);
+        if (res == -1) {
+            if (errno == EINTR) continue;
+            cerr << "statsd message failure: " << strerror(errno)
+                 << endl;
+            return;
+        }
+
+        start += res;
     }
 }
 
+void
+StatsdConnector::
+runFlushThread(double flushInterval)
+{
+    auto interval = std::chrono::microseconds((int64_t)(flushInterval * 1e6));
+
+    std::unique_lock<std::mutex> guard(flushLock);
+    while (!flushCond.wait_for(guard, interval, [&] { return shutdown; })) {
+        guard.unlock();
+        flush();
+        guard.lock();
+    }
+}
+
+void
+StatsdConnector::
+stopFlushThread()
+{
+    if (!flushThread)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(flushLock);
+        shutdown = true;
+    }
+    flushCond.notify_all();
+
+    flushThread->join();
+    flushThread.reset();
+}
+
 } // namespace Datacratic
@@ -5,7 +5,13 @@
 #pragma once
 
 #include "ace/SOCK_Dgram.h"
+#include <boost/thread/tss.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace Datacratic {
 
@@ -15,6 +21,12 @@ namespace Datacratic {
 /*****************************************************************************/
 
 /** Class that sends UDP packets to statsd for monitoring purposes.
+
+    Metrics aren't sent as they are recorded.  Each thread accumulates its
+    own, adding up the increments of each counter, and every flushInterval
+    seconds (or on flush()) they are merged and sent as lines packed into
+    packets of at most packetSize bytes, several packets per system call.
+    With a flushInterval of 0 they are only sent by flush().
 */
 
 class StatsdConnector {
@@ -23,13 +35,49 @@ class StatsdConnector {
 
 public:
     StatsdConnector();
-    StatsdConnector(const std::string & statsdAddr);
+    StatsdConnector(const std::string & statsdAddr,
+                    double flushInterval = 1.0,
+                    size_t packetSize = 1432);
     ~StatsdConnector();
 
-    void open(const std::string & statsdAddr);
+    void open(const std::string & statsdAddr,
+              double flushInterval = 1.0,
+              size_t packetSize = 1432);
 
     void incrementCounter(const char* counterName, float sampleRate, int value=1 );
     void recordGauge(const char* counterName, float sampleRate, float gauge );
+
+    /** Sends what all the threads have accumulated so far. */
+    void flush();
+
+    /** Joins the lines with newlines into as few packets of at most
+        packetSize bytes as possible.  A line that's longer than that goes
+        in a packet of its own.
+    */
+    static std::vector<std::string>
+    packLines(const std::vector<std::string> & lines, size_t packetSize);
+
+private:
+    size_t packetSize;
+
+    /// What a thread has accumulated since the last flush
+    struct ThreadMetrics;
+    ThreadMetrics & threadMetrics();
+
+    boost::thread_specific_ptr<std::shared_ptr<ThreadMetrics> > metrics;
+
+    std::mutex threadsLock;
+    std::vector<std::shared_ptr<ThreadMetrics> > threads;
+
+    void sendPackets(const std::vector<std::string> & packets);
+
+    void runFlushThread(double flushInterval);
+    void stopFlushThread();
+
+    std::unique_ptr<std::thread> flushThread;
+    std::mutex flushLock;
+    std::condition_variable flushCond;
+    bool shutdown;
 };
 
 
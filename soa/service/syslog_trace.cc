@@ -30,6 +30,7 @@ struct App {
     struct TraceEntry {
         int64_t tid;
         std::string hostname;
+        std::string service;
         int64_t id;
         int64_t parent_id;
         std::string tag;
@@ -44,6 +45,7 @@ struct App {
             try {
                 const auto tid = root["tid"].asInt();
                 const auto hostname = root["host"].asString();
+                const auto service = root.get("svc", "").asString();
 
                 const auto id = root["id"].asInt();
                 const auto parent_id = root["pid"].asInt();
@@ -55,7 +57,7 @@ struct App {
                 const auto t1 = std::chrono::nanoseconds { root["t1"].asInt() };
                 const auto t2 = std::chrono::nanoseconds { root["t2"].asInt() };
 
-                return TraceEntry { tid, hostname, id, parent_id, tag, 
+                return TraceEntry { tid, hostname, service, id, parent_id, tag, 
                                     uniq, freq, pid, t1, t2 };
             } catch (const std::runtime_error &e) {
             }
@@ -67,6 +69,7 @@ struct App {
             std::ostringstream oss;
             oss << "TraceEntry { ";
             oss << "tid=" << tid << ", hostname=" << hostname
+                << ", service=" << service
                 << ", id=" << id << ", parent_id=" << parent_id
                 << ", tag=" << tag << ", uniq=" << uniq
                 << ", freq=" << freq << ", pid=" << pid
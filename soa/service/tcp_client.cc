@@ -52,7 +52,7 @@ void
 TcpClient::
 init(const Url & url)
 {
-    int port = url.url->EffectiveIntPort();
+    int port = url.gurl().EffectiveIntPort();
     init(url.host(), port);
 }
 
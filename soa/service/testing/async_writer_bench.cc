@@ -21,8 +21,9 @@ using namespace Datacratic;
 
 
 struct WriterSource : public AsyncWriterSource {
-    WriterSource(int fd, size_t maxMessages)
-        : AsyncWriterSource(nullptr, nullptr, nullptr, maxMessages, 0)
+    WriterSource(int fd, size_t maxMessages, size_t maxBatchSize)
+        : AsyncWriterSource(nullptr, nullptr, nullptr, maxMessages, 0,
+                            maxBatchSize)
     {
         setFd(fd);
         enableQueue();
@@ -118,7 +119,7 @@ pair<int, int> makeTcpSocketPair()
 
 void doBench(const string & label,
              int writerFd, int readerFd,
-             int numMessages, size_t msgSize)
+             int numMessages, size_t msgSize, size_t maxBatchSize)
 {
     string message = randomString(msgSize);
     MessageLoop writerLoop, readerLoop;
@@ -141,7 +142,7 @@ void doBench(const string & label,
         }
     };
 
-    auto writer = make_shared<WriterSource>(writerFd, 1000);
+    auto writer = make_shared<WriterSource>(writerFd, 1000, maxBatchSize);
     writerLoop.addSource("writer", writer);
 
     /* reader setup */
@@ -164,7 +165,9 @@ void doBench(const string & label,
     Date start = Date::now();
     ML::memory_barrier();
     for (numWritten = 0 ; numWritten < numMessages;) {
-        if (writer->write(message, onWriteResult)) {
+        /* the copy is handed over to the writer, which sends it from the
+           queue without copying it again */
+        if (writer->write(string(message), onWriteResult)) {
             numWritten++;
         }
         else {
@@ -184,8 +187,8 @@ void doBench(const string & label,
     }
 
     double totalTime = lastRead - start;
-    ::printf("%s,%d,%lu,%lu,%d,%f,%f,%f,%f,%f\n",
-             label.c_str(),
+    ::printf("%s,%lu,%d,%lu,%lu,%d,%f,%f,%f,%f,%f\n",
+             label.c_str(), maxBatchSize,
              numMessages, msgSize, bytesRead, numMissed,
              (lastWrite - start),
              (lastWriteResult - start),
@@ -197,21 +200,24 @@ void doBench(const string & label,
     writerLoop.shutdown();
 }
 
+/* throughput for message sizes from 16 bytes to 64k, with each message
+   written by its own syscall and with writes coalesced into batches */
 void benchFunction(const string & label,
                    std::function<pair<int, int> ()> f)
 {
-    int multiplier(1);
-    for (int i = 0; i < 4; i++) {
-        multiplier *= 10;
-        auto fds = f();
-        doBench(label, fds.first, fds.second,
-                10000000 / multiplier, 50 * multiplier);
+    for (size_t maxBatchSize: { 0, 65536 }) {
+        for (size_t msgSize = 16; msgSize <= 65536; msgSize *= 4) {
+            int numMessages = min<size_t>(1000000, 200000000 / msgSize);
+            auto fds = f();
+            doBench(label, fds.first, fds.second,
+                    numMessages, msgSize, maxBatchSize);
+        }
     }
 }
 
 int main()
 {
-    ::printf("label,msgs_count,msg_size,bytes_xfer,miss_count,"
+    ::printf("label,batch_size,msgs_count,msg_size,bytes_xfer,miss_count,"
              "delta_last_write,delta_last_written,delta_last_read,"
              "msg_rate,byte_rate\n");
 
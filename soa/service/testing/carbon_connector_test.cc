@@ -169,6 +169,39 @@ BOOST_AUTO_TEST_CASE( test_multi_aggregator )
     BOOST_CHECK_EQUAL(readings[0].value, 50.0);
 }
 
+BOOST_AUTO_TEST_CASE( test_carbon_formats )
+{
+    Date ts = Date::fromSecondsSinceEpoch(1400000000);
+
+    vector<StatReading> readings;
+    readings.push_back(StatReading("a", 1.5, ts));
+
+    BOOST_CHECK_EQUAL(CarbonConnector::formatPlaintext("svc.", readings),
+                      "svc.a 1.5 1400000000\n");
+
+    // The length, then [("svc.a", (1400000000.0, 1.5))] pickled
+    const char pickled[]
+        = "\x00\x00\x00\x24"
+          "\x80\x02](X\x05\x00\x00\x00svc.a"
+          "GA\xd4\xdc\x93\x80\x00\x00\x00"
+          "G?\xf8\x00\x00\x00\x00\x00\x00"
+          "\x86\x86" "e.";
+    BOOST_CHECK_EQUAL(CarbonConnector::formatPickle("svc.", readings),
+                      string(pickled, sizeof(pickled) - 1));
+
+    // Split into messages of at most 2 metrics
+    readings.push_back(StatReading("b", 2.0, ts));
+    readings.push_back(StatReading("c", 3.0, ts));
+
+    string message = CarbonConnector::formatPickle("svc.", readings, 2);
+    BOOST_REQUIRE_EQUAL(message.size(), (4 + 6 + 2 * 30) + (4 + 6 + 30));
+    BOOST_CHECK_EQUAL(message.substr(0, 4), string("\x00\x00\x00\x42", 4));
+    BOOST_CHECK_EQUAL(message.substr(68, 2), "e.");
+    BOOST_CHECK_EQUAL(message.substr(70, 4), string("\x00\x00\x00\x24", 4));
+    BOOST_CHECK_EQUAL(message.substr(74 + 4, 10),
+                      string("X\x05\x00\x00\x00svc.c", 10));
+}
+
 struct FakeCarbon : public PassiveEndpointT<SocketTransport> {
 
     FakeCarbon()
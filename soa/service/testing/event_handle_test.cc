@@ -0,0 +1,124 @@
+/* event_handle_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the pre-registered event handles and their counters.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/service/service_base.h"
+#include "soa/service/stat_aggregator.h"
+#include "soa/service/carbon_connector.h"
+#include <boost/thread.hpp>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_striped_counter )
+{
+    // Counters are reset while the threads are still counting; nothing
+    // should be lost.
+
+    StripedCounter counter;
+
+    uint64_t nthreads = 8, iter = 100000;
+    std::atomic<uint64_t> total(0);
+    boost::barrier barrier(nthreads);
+    boost::thread_group tg;
+
+    for (unsigned i = 0;  i < nthreads;  ++i) {
+        auto doThread = [&] ()
+            {
+                barrier.wait();
+                for (unsigned i = 0;  i < iter;  ++i) {
+                    counter.add();
+                    if (i % 1000 == 0)
+                        total += counter.reset();
+                }
+            };
+        tg.create_thread(doThread);
+    }
+
+    tg.join_all();
+    total += counter.reset();
+
+    BOOST_CHECK_EQUAL(total, nthreads * iter);
+    BOOST_CHECK_EQUAL(counter.reset(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_counter_aggregator_hits )
+{
+    CounterAggregator aggregator;
+    BOOST_REQUIRE(aggregator.hitCounter());
+
+    aggregator.hitCounter()->add();
+    aggregator.hitCounter()->add();
+    aggregator.record(2.5);
+
+    BOOST_CHECK_EQUAL(aggregator.reset().first, 4.5);
+    BOOST_CHECK_EQUAL(aggregator.reset().first, 0.0);
+
+    GaugeAggregator gauge;
+    BOOST_CHECK(!gauge.hitCounter());
+}
+
+BOOST_AUTO_TEST_CASE( test_event_handle )
+{
+    auto events = std::make_shared<NullEventService>();
+    EventRecorder recorder("router", events);
+
+    EventHandle bids = recorder.getEventHandle(ET_HIT, "accounts.a.bids");
+    EventHandle time = recorder.getEventHandle(ET_OUTCOME, "accounts.a.timeMs");
+
+    for (unsigned i = 0;  i < 10;  ++i) {
+        bids.recordHit();
+        time.record(i);
+    }
+
+    // The handles share the aggregators of the events recorded by name
+    recorder.recordHit("accounts.%s.bids", "a");
+
+    auto counter = events->getAggregator("router", "accounts.a.bids", ET_HIT);
+    auto readings = counter->read("bids");
+    BOOST_REQUIRE_EQUAL(readings.size(), 1);
+    BOOST_CHECK_EQUAL(readings[0].value, 11);
+
+    auto outcome = events->getAggregator("router", "accounts.a.timeMs",
+                                         ET_OUTCOME);
+    BOOST_CHECK(!outcome->hitCounter());
+
+    // A default constructed handle records nowhere
+    EventHandle none;
+    none.recordHit();
+    none.record(1.0);
+}
+
+struct RecordingEventService : public EventService {
+    virtual void onEvent(const std::string & name,
+                         const char * event,
+                         StatEventType type,
+                         float value,
+                         std::initializer_list<int> extra)
+    {
+        events[name + "." + event] += value;
+    }
+
+    std::map<std::string, float> events;
+};
+
+BOOST_AUTO_TEST_CASE( test_event_handle_without_aggregators )
+{
+    auto events = std::make_shared<RecordingEventService>();
+    EventRecorder recorder("router", events);
+
+    EventHandle bids = recorder.getEventHandle(ET_HIT, "accounts.a.bids");
+    bids.recordHit();
+    bids.recordHit();
+
+    BOOST_CHECK_EQUAL(events->events["router.accounts.a.bids"], 2);
+}
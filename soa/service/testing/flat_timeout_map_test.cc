@@ -0,0 +1,160 @@
+/* flat_timeout_map_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the flat timeout map, against the TimeoutMap it replaces.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "soa/service/flat_timeout_map.h"
+#include "soa/service/timeout_map.h"
+#include "soa/types/id.h"
+
+#include <boost/test/unit_test.hpp>
+#include <map>
+#include <random>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace {
+
+struct Info {
+    Info(int n = 0) : n(n) {}
+    int n;
+};
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_basics )
+{
+    FlatTimeoutMap<Id, Info> map;
+    Date start = Date::fromSecondsSinceEpoch(1000000);
+
+    BOOST_CHECK(map.empty());
+    map.expire(start);
+
+    map.insert(Id(1), Info(1), start.plusSeconds(0.5));
+    map.insert(Id(2), Info(2), start.plusSeconds(0.1));
+    map.insert(Id(3), Info(3), start.plusSeconds(100.0));   // past the wheel
+    BOOST_CHECK_THROW(map.insert(Id(1), Info(4), start), std::exception);
+
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK(map.count(Id(2)));
+    BOOST_CHECK_EQUAL(map.find(Id(2))->second.n, 2);
+    BOOST_CHECK(map.find(Id(4)) == map.end());
+
+    vector<int> expired;
+    auto onExpired = [&] (const Id & id, const Info & info)
+        {
+            expired.push_back(info.n);
+            return Date();
+        };
+
+    map.expire(onExpired, start.plusSeconds(0.05));
+    BOOST_CHECK(expired.empty());
+
+    map.expire(onExpired, start.plusSeconds(0.1));
+    BOOST_CHECK(expired == vector<int>({ 2 }));
+
+    // Erased entries don't expire
+    BOOST_CHECK(map.erase(Id(1)));
+    BOOST_CHECK(!map.erase(Id(1)));
+    map.expire(onExpired, start.plusSeconds(1.0));
+    BOOST_CHECK(expired == vector<int>({ 2 }));
+
+    // Goes round the wheel until it's due
+    map.expire(onExpired, start.plusSeconds(99.0));
+    BOOST_CHECK_EQUAL(map.size(), 1);
+    map.expire(onExpired, start.plusSeconds(100.0));
+    BOOST_CHECK(expired == vector<int>({ 2, 3 }));
+    BOOST_CHECK(map.empty());
+
+    // A timeout in the past expires on the next call, and the callback can
+    // push the timeout back
+    map.insert(Id(5), Info(5), start);
+    int calls = 0;
+    auto extend = [&] (const Id & id, const Info & info)
+        {
+            return ++calls == 1 ? start.plusSeconds(101.0) : Date();
+        };
+    map.expire(extend, start.plusSeconds(100.0));
+    BOOST_CHECK_EQUAL(calls, 1);
+    BOOST_CHECK_EQUAL(map.size(), 1);
+    map.expire(extend, start.plusSeconds(101.0));
+    BOOST_CHECK_EQUAL(calls, 2);
+    BOOST_CHECK(map.empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_same_as_timeout_map )
+{
+    FlatTimeoutMap<Id, Info> flat(0.01, 64);
+    TimeoutMap<Id, Info> tree;
+
+    mt19937 rng(42);
+    Date now = Date::fromSecondsSinceEpoch(1000000);
+    map<int, Date> flatExpired, treeExpired;
+
+    auto onExpired = [&] (map<int, Date> & expired, Date now)
+        {
+            return [&expired, now] (const Id & id, const Info & info)
+                {
+                    expired[info.n] = now;
+                    return Date();
+                };
+        };
+
+    flat.expire(now);
+    int next = 0;
+
+    for (unsigned i = 0;  i < 20000;  ++i) {
+        now = now.plusSeconds((rng() % 1000) / 100000.0);
+
+        switch (rng() % 4) {
+        case 0:
+        case 1: {
+            // Timeouts from the past to well beyond the wheel
+            Date timeout = now.plusSeconds((int(rng() % 2000) - 100) / 1000.0);
+            flat.insert(Id(next), Info(next), timeout);
+            tree.insert(Id(next), Info(next), timeout);
+            ++next;
+            break;
+        }
+        case 2: {
+            if (!next) break;
+            Id id(rng() % next);
+            BOOST_REQUIRE_EQUAL(flat.erase(id), tree.erase(id));
+            break;
+        }
+        case 3:
+            flat.expire(onExpired(flatExpired, now), now);
+            tree.expire(onExpired(treeExpired, now), now);
+            BOOST_REQUIRE_EQUAL(flat.size(), tree.size());
+            break;
+        }
+    }
+
+    BOOST_CHECK(flatExpired == treeExpired);
+    BOOST_CHECK_GT(flatExpired.size(), 1000);
+
+    for (auto it = tree.begin();  it != tree.end();  ++it)
+        BOOST_CHECK(flat.count(it->first));
+}
+
+BOOST_AUTO_TEST_CASE( test_arena )
+{
+    FlatTimeoutMap<Id, Info> map;
+    map.useArena(ML::huge_page_arena(ML::HP_TRANSPARENT));
+
+    Date start = Date::fromSecondsSinceEpoch(1000000);
+    for (unsigned i = 0;  i < 10000;  ++i)
+        map.insert(Id(i), Info(i), start.plusSeconds(i / 1000.0));
+    BOOST_CHECK_EQUAL(map.size(), 10000);
+
+    BOOST_CHECK_THROW(map.useArena(nullptr), std::exception);
+
+    map.expire(start.plusSeconds(5.0));
+    BOOST_CHECK_EQUAL(map.size(), 4999);
+}
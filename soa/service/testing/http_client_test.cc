@@ -253,6 +253,90 @@ BOOST_AUTO_TEST_CASE( test_http_client_get )
 }
 #endif
 
+#if 1
+/* large bodies received into pooled blocks and a caller buffer */
+BOOST_AUTO_TEST_CASE( test_http_client_slice_callbacks )
+{
+    cerr << "client_slice_callbacks\n";
+    ML::Watchdog watchdog(10);
+    auto proxies = make_shared<ServiceProxies>();
+    HttpGetService service(proxies);
+
+    string largeBody;
+    for (int i = 0; i < 200000; i++) {
+        largeBody += char('a' + i % 26);
+    }
+    service.addResponse("GET", "/large", 200, largeBody);
+    service.start();
+
+    MessageLoop loop;
+    loop.start();
+
+    service.waitListening();
+
+    string baseUrl("http://127.0.0.1:" + to_string(service.port()));
+    auto client = make_shared<HttpClient>(baseUrl, 4);
+    loop.addSource("client", client);
+    client->waitConnectionState(AsyncEventSource::CONNECTED);
+
+    auto pool = make_shared<HttpBufferPool>(16384, 64);
+
+    int done(false);
+    HttpClientError error;
+    int status;
+    HttpBodySlices body;
+    auto onResponse = [&] (const HttpRequest & rq,
+                           HttpClientError newError,
+                           int newStatus,
+                           string && headers,
+                           HttpBodySlices && newBody) {
+        error = newError;
+        status = newStatus;
+        body = move(newBody);
+        done = true;
+        ML::futex_wake(done);
+    };
+    auto cbs = make_shared<HttpClientSliceCallbacks>(onResponse, pool);
+
+    auto doGet = [&] () {
+        done = false;
+        client->get("/large", cbs);
+        while (!done) {
+            int oldDone = done;
+            ML::futex_wait(done, oldDone);
+        }
+    };
+
+    /* pooled blocks only */
+    doGet();
+    BOOST_CHECK_EQUAL(error, HttpClientError::None);
+    BOOST_CHECK_EQUAL(status, 200);
+    BOOST_CHECK_EQUAL(body.size(), largeBody.size());
+    BOOST_CHECK(body.toString() == largeBody);
+    BOOST_CHECK_GE(body.slices().size(), largeBody.size() / 16384);
+
+    /* the blocks go back to the pool with the slices */
+    size_t numSlices = body.slices().size();
+    body.clear();
+    BOOST_CHECK_EQUAL(pool->freeBlocks(), numSlices);
+
+    /* the start of the body goes to our buffer */
+    vector<char> buffer(100000);
+    cbs->setBuffer(buffer.data(), buffer.size());
+    doGet();
+    BOOST_CHECK_EQUAL(body.size(), largeBody.size());
+    BOOST_CHECK(body.toString() == largeBody);
+    BOOST_CHECK(body.slices()[0].data == buffer.data());
+    BOOST_CHECK_EQUAL(body.slices()[0].size, buffer.size());
+    BOOST_CHECK(!body.slices()[0].buffer);
+
+    loop.removeSource(client.get());
+    client->waitConnectionState(AsyncEventSource::DISCONNECTED);
+
+    service.shutdown();
+}
+#endif
+
 #if 1
 BOOST_AUTO_TEST_CASE( test_http_client_post )
 {
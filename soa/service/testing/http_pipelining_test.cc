@@ -0,0 +1,126 @@
+/* http_pipelining_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Test that pipelined requests are handled at the same time and answered
+   in order.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/service/http_endpoint.h"
+#include "jml/utils/testing/watchdog.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <atomic>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+namespace {
+
+std::atomic<int> inFlight(0), maxInFlight(0);
+
+/** Answers each request with its payload, later for the earlier ones, so
+    that the responses are ready in the opposite order to the requests.
+*/
+struct DelayedHandler : public HttpConnectionHandler {
+
+    std::string body;
+
+    virtual void handleHttpPayload(const HttpHeader & header,
+                                   const std::string & payload)
+    {
+        body = payload;
+
+        int n = ++inFlight;
+        if (n > maxInFlight)
+            maxInFlight = n;
+
+        double delay = 0.005 * (20 - std::stoi(payload) % 20);
+        scheduleRequestTimer(Date::now().plusSeconds(delay));
+    }
+
+    virtual void handleTimeout(Date date, size_t cookie)
+    {
+        if (isPipelineOwner()) {
+            HttpConnectionHandler::handleTimeout(date, cookie);
+            return;
+        }
+
+        --inFlight;
+        putResponseOnWire(HttpResponse(200, "text/plain", body));
+    }
+};
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_pipelined_requests )
+{
+    Watchdog watchdog(10.0);
+
+    HttpEndpoint endpoint("pipelining");
+    endpoint.maxPipelinedRequests = 4;
+    endpoint.handlerFactory = [] ()
+        {
+            return std::make_shared<DelayedHandler>();
+        };
+
+    int port = endpoint.init();
+
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE_NE(s, -1);
+
+    struct sockaddr_in addr = { AF_INET, htons(port), { INADDR_ANY } };
+    int res = connect(s, reinterpret_cast<const sockaddr *>(&addr),
+                      sizeof(addr));
+    BOOST_REQUIRE_EQUAL(res, 0);
+
+    // All of the requests in one go, more than can be in flight at once
+    int numRequests = 10;
+    string requests;
+    for (int i = 0;  i < numRequests;  ++i) {
+        string payload = to_string(i);
+        requests += "POST / HTTP/1.1\r\nContent-Length: "
+            + to_string(payload.size()) + "\r\n\r\n" + payload;
+    }
+    BOOST_REQUIRE_EQUAL(write(s, requests.c_str(), requests.size()),
+                        requests.size());
+
+    // Read the responses back, in order
+    string received;
+    vector<string> bodies;
+    while (bodies.size() < numRequests) {
+        char buf[4096];
+        ssize_t n = read(s, buf, sizeof(buf));
+        BOOST_REQUIRE_GT(n, 0);
+        received.append(buf, n);
+
+        for (;;) {
+            auto headerEnd = received.find("\r\n\r\n");
+            if (headerEnd == string::npos) break;
+
+            HttpHeader header;
+            header.parse(received.substr(0, headerEnd + 4));
+            size_t length = headerEnd + 4 + header.contentLength;
+            if (received.size() < length) break;
+
+            bodies.push_back(received.substr(headerEnd + 4,
+                                             header.contentLength));
+            received.erase(0, length);
+        }
+    }
+
+    for (int i = 0;  i < numRequests;  ++i)
+        BOOST_CHECK_EQUAL(bodies[i], to_string(i));
+
+    BOOST_CHECK_GT(maxInFlight, 1);
+    BOOST_CHECK_LE(maxInFlight, 4);
+
+    close(s);
+    endpoint.shutdown();
+}
@@ -0,0 +1,96 @@
+/* io_uring_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the io_uring wrapper.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/service/io_uring.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <poll.h>
+#include <map>
+#include <iostream>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_io_uring_socket_pair )
+{
+    if (!IoUring::available()) {
+        cerr << "io_uring is not available; skipping" << endl;
+        return;
+    }
+
+    int fds[2];
+    int res = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    BOOST_REQUIRE_EQUAL(res, 0);
+
+    IoUring ring(4);
+
+    char recvBuffer[64];
+    iovec buffer = { recvBuffer, sizeof(recvBuffer) };
+    bool fixed = ring.registerBuffers(&buffer, 1);
+
+    // A receive waits in the kernel until there is something to read
+    io_uring_sqe * sqe = ring.getSqe();
+    BOOST_REQUIRE(sqe);
+    sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_RECV;
+    sqe->fd = fds[0];
+    sqe->addr = (uint64_t)recvBuffer;
+    sqe->len = sizeof(recvBuffer);
+    sqe->user_data = 1;
+
+    // Submitted along with a send on the other end, in one call
+    string message = "hello";
+    sqe = ring.getSqe();
+    BOOST_REQUIRE(sqe);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fds[1];
+    sqe->addr = (uint64_t)message.data();
+    sqe->len = message.size();
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = 2;
+
+    BOOST_CHECK_EQUAL(ring.numPrepared(), 2);
+    BOOST_CHECK_EQUAL(ring.submit(2), 2);
+    BOOST_CHECK_EQUAL(ring.numPrepared(), 0);
+
+    // The fd tells epoll that there are completions
+    struct pollfd item = { ring.fd(), POLLIN, 0 };
+    BOOST_CHECK_EQUAL(poll(&item, 1, 1000), 1);
+
+    map<uint64_t, int> results;
+    unsigned n = ring.forEachCompletion([&] (uint64_t userData, int res,
+                                             unsigned flags)
+                                        {
+                                            results[userData] = res;
+                                        });
+    BOOST_CHECK_EQUAL(n, 2);
+    BOOST_CHECK_EQUAL(results[1], message.size());
+    BOOST_CHECK_EQUAL(results[2], message.size());
+    BOOST_CHECK_EQUAL(string(recvBuffer, message.size()), message);
+
+    BOOST_CHECK_EQUAL(poll(&item, 1, 0), 0);
+
+    // The submission queue doesn't take more than its entries
+    for (unsigned i = 0;  i < 4;  ++i) {
+        sqe = ring.getSqe();
+        BOOST_REQUIRE(sqe);
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = 10 + i;
+    }
+    BOOST_CHECK(!ring.getSqe());
+    ring.submit(4);
+    BOOST_CHECK_EQUAL(ring.forEachCompletion([] (uint64_t, int, unsigned) {}),
+                      4);
+
+    close(fds[0]);
+    close(fds[1]);
+}
@@ -1,6 +1,7 @@
 #define BOOST_TEST_MAIN
 #define BOOST_TEST_DYN_LINK
 
+#include <atomic>
 #include <iostream>
 
 #include <boost/test/unit_test.hpp>
@@ -102,3 +103,35 @@ BOOST_AUTO_TEST_CASE( test_addSource_after_before_start )
         }
     }
 }
+
+/* This test ensures that messages pushed into a sink are all handled when
+ * they are taken in batches by a loop that busy polls. */
+BOOST_AUTO_TEST_CASE( test_busy_poll_batches )
+{
+    ML::Watchdog wd(30);
+    const int numMessages(100000);
+
+    MessageLoop loop;
+    loop.setBusyPollTime(0.001);
+
+    std::atomic<int> numReceived(0);
+    TypedMessageSink<int> sink(1024, 16);
+    sink.onEvent = [&] (int && message) {
+        BOOST_CHECK_EQUAL(message, numReceived);
+        ++numReceived;
+    };
+
+    loop.addSource("sink", sink);
+    loop.start();
+    sink.waitConnectionState(AsyncEventSource::CONNECTED);
+
+    for (int i = 0; i < numMessages; i++) {
+        sink.push(i);
+    }
+    while (numReceived < numMessages) {
+        ML::sleep(0.01);
+    }
+
+    loop.removeSource(&sink);
+    sink.waitConnectionState(AsyncEventSource::DISCONNECTED);
+}
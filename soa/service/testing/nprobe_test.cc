@@ -16,6 +16,7 @@
 #include <random>
 #include <chrono>
 #include <atomic>
+#include <mutex>
 
 #include "soa/service/nprobe.h"
 #include "jml/arch/timers.h"
@@ -308,3 +309,59 @@ BOOST_AUTO_TEST_CASE( test_multithreaded_traces )
     BOOST_CHECK_EQUAL(total, (Iterations * Threads));
 
 }
+
+BOOST_AUTO_TEST_CASE( test_span_recorder )
+{
+    std::cout << "=========================================" << std::endl
+              << " test_span_recorder" << std::endl
+              << "-----------------------------------------" << std::endl;
+
+    enum { Freq = 8, Auctions = 10000 };
+
+    std::mutex lock;
+    std::vector<TracedSpan> shipped;
+
+    auto sinkFn = [&](uint32_t freq, const std::vector<TracedSpan> &vs) {
+        BOOST_CHECK_EQUAL(freq, Freq);
+        std::lock_guard<std::mutex> guard(lock);
+        shipped.insert(shipped.end(), vs.begin(), vs.end());
+    };
+
+    SpanRecorder recorder(Freq, 1 << 14, sinkFn);
+    SpanRecorder other(Freq, 16, nullptr);
+
+    Date start = Date::now();
+    size_t sampled { 0 };
+
+    for (size_t i { 0 }; i < Auctions; ++i) {
+        Id id("auction-" + std::to_string(i));
+
+        // Every recorder with the same frequency samples the same ids
+        BOOST_CHECK_EQUAL(recorder.sampled(id), other.sampled(id));
+        if (recorder.sampled(id)) ++sampled;
+
+        recorder.record(id, "router", "total", start, start.plusSeconds(0.01));
+    }
+
+    // Roughly one in Freq
+    BOOST_CHECK_GT(sampled, Auctions / Freq / 2);
+    BOOST_CHECK_LT(sampled, Auctions / Freq * 2);
+
+    recorder.flush();
+
+    BOOST_CHECK_EQUAL(recorder.numRecorded(), sampled);
+    BOOST_CHECK_EQUAL(recorder.numDropped(), 0);
+
+    std::lock_guard<std::mutex> guard(lock);
+    BOOST_REQUIRE_EQUAL(shipped.size(), sampled);
+    for (const auto & span: shipped) {
+        BOOST_CHECK(recorder.sampled(span.uniq));
+        BOOST_CHECK_EQUAL(span.service, "router");
+        BOOST_CHECK_EQUAL(span.tag, "total");
+        BOOST_CHECK_CLOSE(span.end.secondsSince(span.start), 0.01, 0.001);
+    }
+
+    // Nothing is sampled at a frequency of 0
+    SpanRecorder off(0, 16, sinkFn);
+    BOOST_CHECK(!off.sampled(Id("auction-0")));
+}
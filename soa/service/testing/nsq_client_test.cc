@@ -117,18 +117,21 @@ doSubscriberThread()
     set<string> ids;
     set<string> contents;
 
-    auto onMessage = [&] (Date ts, uint16_t attempts,
-                          const string & messageId,
-                          const string & message) {
+    /* messages are received in batches and finished with a single write */
+    auto onMessages = [&] (const vector<NsqMessage> & messages) {
         last = Date::now();
-        numReceived++;
-        ids.insert(messageId);
-        contents.insert(message);
-        // cerr << "received: /" + message + "/\n";
-        client->fin(messageId);
+        numReceived += messages.size();
+        vector<string> messageIds;
+        for (const NsqMessage & message: messages) {
+            ids.insert(message.id);
+            contents.insert(message.body);
+            messageIds.push_back(message.id);
+        }
+        client->fin(messageIds);
     };
 
-    client.reset(new NsqClient(onClosed, onMessage));
+    client.reset(new NsqClient(onClosed));
+    client->setOnMessages(onMessages);
     loop.addSource("client", client);
     client->init("http://127.0.0.1:4150");
     cerr << "subscriber: connect...\n";
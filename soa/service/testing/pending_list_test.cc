@@ -0,0 +1,113 @@
+/* pending_list_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests of the leveldb store of pending entries.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "soa/service/pending_list.h"
+#include "jml/arch/format.h"
+#include "jml/arch/timers.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <map>
+#include <unistd.h>
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace {
+
+string uniquePath(const string & what)
+{
+    string path = ML::format("/tmp/pending_list_test-%d-%s", getpid(),
+                             what.c_str());
+    boost::filesystem::remove_all(path);
+    return path;
+}
+
+map<string, string> contents(const LeveldbPendingPersistence & store)
+{
+    map<string, string> result;
+    auto onEntry = [&] (const string & key, const string & value)
+        {
+            result[key] = value;
+        };
+    store.scan(onEntry, PendingPersistence::OnError());
+    return result;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_batched_writes )
+{
+    string path = uniquePath("batched");
+    LeveldbPendingPersistence store;
+    store.open(path);
+    store.put("kept", "0");
+
+    // Long enough that only flush() or a full batch commits anything
+    store.startBatching(3600.0, 1000);
+
+    store.put("a", "1");
+    store.put("b", "2");
+    store.erase("kept");
+    store.put("a", "3");
+
+    // The writes are seen by get() before they're committed
+    BOOST_CHECK_EQUAL(store.get("a"), "3");
+    BOOST_CHECK_EQUAL(store.get("b"), "2");
+    BOOST_CHECK_THROW(store.get("kept"), std::exception);
+    BOOST_CHECK_EQUAL(contents(store).size(), 1);
+
+    store.flush();
+    auto committed = contents(store);
+    BOOST_CHECK_EQUAL(committed.size(), 2);
+    BOOST_CHECK_EQUAL(committed["a"], "3");
+    BOOST_CHECK_EQUAL(committed["b"], "2");
+
+    // A full batch gets committed without waiting for the period
+    for (int i = 0;  i < 1000;  ++i)
+        store.put(ML::format("key%04d", i), to_string(i));
+
+    Date start = Date::now();
+    while (contents(store).size() < 1002 && Date::now() < start.plusSeconds(10))
+        ML::sleep(0.01);
+    BOOST_CHECK_EQUAL(contents(store).size(), 1002);
+
+    // Stopping commits what's left and goes back to direct writes
+    store.erase("a");
+    store.stopBatching();
+    BOOST_CHECK_EQUAL(contents(store).size(), 1001);
+    store.put("c", "4");
+    BOOST_CHECK_EQUAL(contents(store)["c"], "4");
+}
+
+BOOST_AUTO_TEST_CASE( test_batches_committed_periodically )
+{
+    string path = uniquePath("periodic");
+    {
+        LeveldbPendingPersistence store;
+        store.open(path, true /* sync */);
+        store.startBatching(0.01);
+
+        store.put("a", "1");
+        Date start = Date::now();
+        while (contents(store).empty() && Date::now() < start.plusSeconds(10))
+            ML::sleep(0.01);
+        BOOST_CHECK_EQUAL(contents(store).size(), 1);
+
+        store.put("b", "2");
+    }
+
+    // Destroying the store commits the last batch
+    LeveldbPendingPersistence store;
+    store.open(path);
+    auto committed = contents(store);
+    BOOST_CHECK_EQUAL(committed.size(), 2);
+    BOOST_CHECK_EQUAL(committed["b"], "2");
+}
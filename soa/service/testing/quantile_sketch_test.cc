@@ -0,0 +1,147 @@
+/* quantile_sketch_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the quantile sketch and the outcome aggregator built on it.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/service/quantile_sketch.h"
+#include "soa/service/stat_aggregator.h"
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <random>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_sketch_buckets )
+{
+    BOOST_CHECK_EQUAL(QuantileSketch::bucketOf(0.0), 0);
+    BOOST_CHECK_EQUAL(QuantileSketch::bucketOf(-5.0), 0);
+    BOOST_CHECK_EQUAL(QuantileSketch::bucketOf(NAN), 0);
+    BOOST_CHECK_EQUAL(QuantileSketch::bucketOf(1e30),
+                      QuantileSketch::NumBuckets - 1);
+
+    unsigned last = 0;
+    for (float value = 1e-5;  value < 1e15;  value *= 1.01) {
+        unsigned bucket = QuantileSketch::bucketOf(value);
+        BOOST_CHECK_GE(bucket, last);
+        last = bucket;
+
+        if (bucket == 0 || bucket == QuantileSketch::NumBuckets - 1)
+            continue;
+
+        double mid = QuantileSketch::valueOf(bucket);
+        BOOST_CHECK_LE(fabs(mid - value) / value, 0.016);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_sketch_percentiles )
+{
+    std::mt19937 rng(1);
+    std::lognormal_distribution<float> dist(2.0, 1.0);
+
+    QuantileSketch sketch;
+    vector<float> values;
+    for (unsigned i = 0;  i < 100000;  ++i) {
+        float value = dist(rng);
+        sketch.record(value);
+        values.push_back(value);
+    }
+
+    std::sort(values.begin(), values.end());
+
+    BOOST_CHECK_EQUAL(sketch.count(), values.size());
+    BOOST_CHECK_EQUAL(sketch.min(), values.front());
+    BOOST_CHECK_EQUAL(sketch.max(), values.back());
+    BOOST_CHECK_EQUAL(sketch.percentile(100), values.back());
+
+    for (double pct: { 10.0, 50.0, 90.0, 95.0, 98.0, 99.9 }) {
+        double exact = values[std::min<size_t>(values.size() - 1,
+                                               pct / 100.0 * values.size())];
+        double approx = sketch.percentile(pct);
+        BOOST_CHECK_LE(fabs(approx - exact) / exact, 0.016);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_sketch_merge )
+{
+    QuantileSketch a, b, both;
+    for (unsigned i = 1;  i <= 1000;  ++i) {
+        (i % 2 ? a : b).record(i);
+        both.record(i);
+    }
+
+    a.merge(b);
+
+    BOOST_CHECK_EQUAL(a.count(), both.count());
+    BOOST_CHECK_EQUAL(a.mean(), both.mean());
+    BOOST_CHECK_EQUAL(a.min(), 1);
+    BOOST_CHECK_EQUAL(a.max(), 1000);
+    BOOST_CHECK(a.counts == both.counts);
+
+    QuantileSketch empty;
+    BOOST_CHECK_EQUAL(empty.percentile(50), 0.0);
+    BOOST_CHECK_EQUAL(empty.min(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( test_outcome_sketch_aggregator )
+{
+    // Values are recorded from several threads while the aggregator is
+    // being reset; none should be lost.
+
+    OutcomeSketchAggregator aggregator;
+
+    uint64_t nthreads = 8, iter = 100000;
+    boost::barrier barrier(nthreads + 1);
+    boost::thread_group tg;
+
+    for (unsigned i = 0;  i < nthreads;  ++i) {
+        auto doThread = [&] ()
+            {
+                barrier.wait();
+                for (unsigned i = 0;  i < iter;  ++i)
+                    aggregator.record(i % 100 + 1);
+            };
+        tg.create_thread(doThread);
+    }
+
+    barrier.wait();
+
+    QuantileSketch total;
+    for (unsigned i = 0;  i < 10;  ++i)
+        total.merge(aggregator.reset());
+
+    tg.join_all();
+    total.merge(aggregator.reset());
+
+    BOOST_CHECK_EQUAL(total.count(), nthreads * iter);
+    BOOST_CHECK_EQUAL(total.min(), 1);
+    BOOST_CHECK_EQUAL(total.max(), 100);
+    BOOST_CHECK_CLOSE(total.mean(), 50.5, 0.001);
+
+    aggregator.record(3.0);
+    aggregator.record(5.0);
+    auto readings = aggregator.read("stat");
+
+    vector<string> names;
+    for (auto & reading: readings)
+        names.push_back(reading.name);
+
+    vector<string> expected = {
+        "stat.mean", "stat.upper", "stat.lower", "stat.count",
+        "stat.upper_90", "stat.upper_95", "stat.upper_98"
+    };
+    BOOST_CHECK_EQUAL_COLLECTIONS(names.begin(), names.end(),
+                                  expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(readings[0].value, 4.0);
+    BOOST_CHECK_EQUAL(readings[3].value, 2);
+
+    BOOST_CHECK(aggregator.read("stat").empty());
+}
@@ -0,0 +1,85 @@
+/* redis_cluster_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Test of the Redis connection pool and cluster routing.
+*/
+
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "soa/service/redis_cluster.h"
+#include "soa/service/testing/redis_temporary_server.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace Datacratic;
+using namespace Redis;
+
+
+BOOST_AUTO_TEST_CASE( test_key_slot )
+{
+    // Values given by CLUSTER KEYSLOT
+    BOOST_CHECK_EQUAL(keySlot("123456789"), 12739);
+    BOOST_CHECK_EQUAL(keySlot("somekey"), 11058);
+    BOOST_CHECK_EQUAL(keySlot("foo{hash_tag}"), 2515);
+    BOOST_CHECK_EQUAL(keySlot("bar{hash_tag}"), 2515);
+
+    // Empty hash tags are part of the key
+    BOOST_CHECK_NE(keySlot("{}a"), keySlot("{}b"));
+    BOOST_CHECK_EQUAL(keySlot("{a}{b}"), keySlot("a"));
+}
+
+BOOST_AUTO_TEST_CASE( test_connection_pool )
+{
+    RedisTemporaryServer redis;
+
+    ConnectionPool pool(redis, 4);
+    pool.test();
+
+    for (unsigned i = 0;  i < 20;  ++i) {
+        string key = "key" + to_string(i);
+        BOOST_CHECK(pool.exec(SET(key, to_string(i))));
+    }
+
+    for (unsigned i = 0;  i < 20;  ++i) {
+        Result result = pool.exec(GET("key" + to_string(i)));
+        BOOST_REQUIRE(result);
+        BOOST_CHECK_EQUAL(result.reply().asString(), to_string(i));
+    }
+
+    // A transaction goes over a single connection
+    Results results
+        = pool.execMulti({ MULTI, SET("key1", "a"), SET("key2", "b"), EXEC });
+    BOOST_REQUIRE(results);
+    BOOST_CHECK_EQUAL(results.reply(3).length(), 2);
+
+    BOOST_CHECK_EQUAL(pool.numRequestsPending(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_cluster_without_cluster_support )
+{
+    RedisTemporaryServer redis;
+
+    // A plain server serves all of the slots
+    ClusterConnection cluster(redis, 2);
+    BOOST_CHECK_EQUAL(cluster.numNodes(), 1);
+
+    BOOST_CHECK(cluster.exec(SET("somekey", "a")));
+    BOOST_CHECK(cluster.exec(SET("foo{hash_tag}", "b")));
+
+    // MGET is split by slot and put back together in order
+    Result result = cluster.exec(MGET("foo{hash_tag}", "missing", "somekey"));
+    BOOST_REQUIRE(result);
+    BOOST_REQUIRE_EQUAL(result.reply().length(), 3);
+    BOOST_CHECK_EQUAL(result.reply()[0].asString(), "b");
+    BOOST_CHECK_EQUAL(result.reply()[1].type(), NIL);
+    BOOST_CHECK_EQUAL(result.reply()[2].asString(), "a");
+
+    result = cluster.exec(KEYS("*"));
+    BOOST_REQUIRE(result);
+    BOOST_CHECK_EQUAL(result.reply().length(), 2);
+
+    BOOST_CHECK_THROW(cluster.select(1), ML::Exception);
+}
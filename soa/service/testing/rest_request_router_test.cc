@@ -0,0 +1,122 @@
+/* rest_request_router_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Test of the route matching of the REST request router.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/service/rest_request_router.h"
+
+using namespace std;
+using namespace Datacratic;
+
+namespace {
+
+/** Records which handler was called and what had been matched. */
+struct Matched {
+    string name;
+    vector<string> resources;
+};
+
+RestRequestRouter::OnProcessRequest
+handler(const string & name, Matched * matched)
+{
+    return [=] (const RestServiceEndpoint::ConnectionId & connection,
+                const RestRequest & request,
+                RestRequestParsingContext & context)
+        {
+            matched->name = name;
+            matched->resources = context.resources;
+            return RestRequestRouter::MR_YES;
+        };
+}
+
+string route(const RestRequestRouter & router, Matched & matched,
+             const string & resource, const string & verb = "GET")
+{
+    RestRequest request;
+    request.verb = verb;
+    request.resource = resource;
+
+    RestRequestParsingContext context(request);
+    RestServiceEndpoint::ConnectionId connection("test", "1", nullptr);
+
+    matched = Matched();
+    auto res = router.processRequest(connection, request, context);
+
+    // Whatever was matched is given back
+    BOOST_CHECK_EQUAL(context.consumed, 0);
+    BOOST_CHECK(context.resources.empty());
+
+    // Nothing is ever sent back over this connection
+    connection.itl->responseSent = true;
+
+    return res == RestRequestRouter::MR_YES ? matched.name : "";
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_literal_prefix )
+{
+    typedef RestRequestRouter::RouteIndex Index;
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/v1/accounts/([^/]*)"),
+                      "/v1/accounts/");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/([^/]*)"), "/");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/abc?"), "/ab");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/ab*"), "/a");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/ab+"), "/ab");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/a{0,2}"), "/");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/a|/b"), "");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("^/a"), "");
+    BOOST_CHECK_EQUAL(Index::literalPrefix("/a\\.b"), "/a");
+}
+
+BOOST_AUTO_TEST_CASE( test_route_matching )
+{
+    Matched matched;
+
+    RestRequestRouter router;
+    auto & v1 = router.addSubRouter("/v1", "version 1");
+
+    auto & accounts = v1.addSubRouter("/accounts", "accounts");
+    accounts.addRoute("", "GET", "list", handler("list", &matched),
+                      Json::Value());
+    accounts.addRoute(Rx("/([^/]*)/summary", "/<account>/summary"), "GET",
+                      "summary", handler("summary", &matched), Json::Value());
+    accounts.addRoute(Rx("/([^/]*)", "/<account>"), "GET",
+                      "account", handler("account", &matched), Json::Value());
+    accounts.addRoute(Rx("/([^/]*)", "/<account>"), "PUT",
+                      "putAccount", handler("putAccount", &matched),
+                      Json::Value());
+
+    v1.addRoute("/acc", "GET", "acc", handler("acc", &matched), Json::Value());
+    v1.addRoute(Rx("/(.*)", "/<any>"), "GET", "any",
+                handler("any", &matched), Json::Value());
+    v1.addRoute("/summary", "GET", "never", handler("never", &matched),
+                Json::Value());
+
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/accounts"), "list");
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/accounts/a:b"), "account");
+    BOOST_CHECK_EQUAL(matched.resources.size(), 4);
+    BOOST_CHECK_EQUAL(matched.resources[0], "/v1");
+    BOOST_CHECK_EQUAL(matched.resources[1], "/accounts");
+    BOOST_CHECK_EQUAL(matched.resources[2], "/a:b");
+    BOOST_CHECK_EQUAL(matched.resources[3], "a:b");
+
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/accounts/a/summary"),
+                      "summary");
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/accounts/a", "PUT"),
+                      "putAccount");
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/acc"), "acc");
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/accountsX"), "any");
+
+    // Routes are tried in the order they were added
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/summary"), "any");
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1/other"), "any");
+    BOOST_CHECK_EQUAL(route(router, matched, "/v2/other"), "");
+    BOOST_CHECK_EQUAL(route(router, matched, "/v1"), "");
+}
@@ -12,13 +12,17 @@ service_utils_test: $(LIB)/libcustom_preload_1.so \
 					$(LIB)/libcustom_preload_4.so
 
 $(eval $(call test,epoll_test,services,boost))
+$(eval $(call test,io_uring_test,services,boost))
 $(eval $(call test,epoll_wait_test,services,boost manual))
 
 $(eval $(call test,named_endpoint_test,services,boost manual))
 $(eval $(call test,zmq_named_pub_sub_test,services,boost manual))
 $(eval $(call test,zmq_endpoint_test,services,boost manual))
 $(eval $(call test,message_channel_test,services,boost))
+$(eval $(call test,shm_ring_test,services,boost))
+$(eval $(call test,pending_list_test,services leveldb boost_filesystem,boost))
 $(eval $(call test,rest_service_endpoint_test,services,boost))
+$(eval $(call test,rest_request_router_test,services,boost))
 $(eval $(call test,multiple_service_test,services,boost manual))
 
 $(eval $(call test,zookeeper_test,cloud,boost manual))
@@ -26,11 +30,15 @@ $(eval $(call test,aws_test,cloud,boost))
 
 $(eval $(call test,redis_async_test,redis,boost))
 $(eval $(call test,redis_commands_test,redis,boost))
+$(eval $(call test,redis_cluster_test,redis,boost))
 
 $(eval $(call nodejs_test,opstats_js_test,opstats,,,manual))
 
 $(eval $(call test,statsd_connector_test,opstats,boost  manual))
 $(eval $(call test,carbon_connector_test,opstats endpoint,boost manual))
+$(eval $(call test,event_handle_test,services,boost))
+$(eval $(call test,quantile_sketch_test,opstats,boost))
+$(eval $(call test,shared_metrics_test,services,boost))
 
 $(eval $(call test,endpoint_unit_test,endpoint,boost))
 $(eval $(call test,test_active_endpoint_nothing_listening,endpoint,boost manual))
@@ -42,6 +50,7 @@ $(eval $(call test,endpoint_periodic_test,endpoint,boost))
 $(eval $(call test,endpoint_closed_connection_test,endpoint,boost))
 $(eval $(call test,http_long_header_test,endpoint,boost manual))
 $(eval $(call test,http_header_test,endpoint,boost manual))
+$(eval $(call test,http_pipelining_test,endpoint,boost))
 $(eval $(call test,http_rest_proxy_stress_test,services,boost manual))
 $(eval $(call test,service_proxies_test,endpoint,boost manual))
 
@@ -73,6 +82,7 @@ $(eval $(call test,logs_test,services,boost))
 
 $(eval $(call test,sns_mock_test,cloud services,boost))
 $(eval $(call test,zmq_message_loop_test,services,boost))
+$(eval $(call test,flat_timeout_map_test,services,boost))
 
 $(eval $(call test,event_handler_test,cloud services,boost manual))
 #$(eval $(call test,mongo_basic_test,services boost_filesystem mongo_tmp_server,boost manual))
@@ -0,0 +1,164 @@
+/* shared_metrics_test.cc
+   14 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the metrics recorded into shared memory.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/service/shared_metrics.h"
+#include <boost/thread.hpp>
+#include <unistd.h>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace {
+
+string segmentName(const string & test)
+{
+    return "/shared_metrics_test_" + test + "_" + to_string(getpid());
+}
+
+map<string, float> byName(const vector<StatReading> & readings)
+{
+    map<string, float> result;
+    for (auto & reading: readings)
+        result[reading.name] = reading.value;
+    return result;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_shared_metrics_readings )
+{
+    string name = segmentName("readings");
+    auto events = std::make_shared<SharedMemoryEventService>(name, "test");
+    EventRecorder recorder("router", events);
+
+    SharedMetricsReader reader(name);
+    BOOST_CHECK_EQUAL(reader.prefix(), "test");
+
+    // The first read is the baseline
+    recorder.recordHit("before");
+    BOOST_CHECK(reader.read().empty());
+
+    EventHandle bids = recorder.getEventHandle(ET_HIT, "bids");
+    for (unsigned i = 0;  i < 10;  ++i)
+        bids.recordHit();
+    recorder.recordHit("bids");
+    recorder.recordEvent("level", ET_STABLE_LEVEL, 3.0);
+    recorder.recordEvent("level", ET_STABLE_LEVEL, 5.0);
+    for (unsigned i = 1;  i <= 100;  ++i)
+        recorder.recordOutcome(i, "timeMs");
+
+    auto readings = byName(reader.read());
+
+    BOOST_CHECK(readings.count("router.bids"));
+    BOOST_CHECK(!readings.count("router.before"));
+    BOOST_CHECK_EQUAL(readings["router.level"], 4.0);
+    BOOST_CHECK_EQUAL(readings["router.timeMs.count"], 100);
+    BOOST_CHECK_CLOSE(readings["router.timeMs.mean"], 50.5, 0.001);
+    BOOST_CHECK_CLOSE(readings["router.timeMs.upper"], 100, 1.6);
+    BOOST_CHECK_CLOSE(readings["router.timeMs.lower"], 1, 1.6);
+    BOOST_CHECK_CLOSE(readings["router.timeMs.upper_90"], 91, 1.6);
+
+    // Only what happened since the last read is reported
+    recorder.recordOutcome(7.0, "timeMs");
+    readings = byName(reader.read());
+    BOOST_CHECK_EQUAL(readings.size(), 7);
+    BOOST_CHECK_EQUAL(readings["router.timeMs.count"], 1);
+    BOOST_CHECK_EQUAL(readings["router.timeMs.mean"], 7.0);
+}
+
+BOOST_AUTO_TEST_CASE( test_shared_metrics_threads )
+{
+    string name = segmentName("threads");
+    auto events = std::make_shared<SharedMemoryEventService>(name);
+    EventRecorder recorder("svc", events);
+
+    uint64_t nthreads = 8, iter = 10000;
+    boost::barrier barrier(nthreads);
+    boost::thread_group tg;
+
+    for (unsigned i = 0;  i < nthreads;  ++i) {
+        auto doThread = [&] ()
+            {
+                barrier.wait();
+                for (unsigned i = 0;  i < iter;  ++i) {
+                    recorder.recordCount(2.0, "bytes");
+                    recorder.recordHit("metric%d", i % 100);
+                }
+            };
+        tg.create_thread(doThread);
+    }
+
+    tg.join_all();
+
+    // All of the threads see the same metrics
+    const SharedMetricsSegment & segment = events->segment();
+    BOOST_REQUIRE_EQUAL(segment.header().numMetrics, 101);
+
+    uint64_t hits = 0;
+    for (unsigned i = 0;  i < segment.header().numMetrics;  ++i) {
+        auto & metric = segment.metric(i);
+        if (metric.name == string("svc.bytes")) {
+            BOOST_CHECK_EQUAL(metric.count, nthreads * iter);
+            BOOST_CHECK_EQUAL(metric.sum, 2.0 * nthreads * iter);
+        }
+        else hits += metric.count;
+    }
+    BOOST_CHECK_EQUAL(hits, nthreads * iter);
+}
+
+BOOST_AUTO_TEST_CASE( test_shared_metrics_full )
+{
+    string name = segmentName("full");
+    auto events = std::make_shared<SharedMemoryEventService>(name, "", 4, 1);
+    EventRecorder recorder("svc", events);
+
+    recorder.recordOutcome(1.0, "a");
+    recorder.recordOutcome(1.0, "b");    // no histogram left
+    recorder.recordHit("c");
+    recorder.recordHit("d");
+    recorder.recordHit(string(200, 'x')); // name too long
+    recorder.recordHit("e");
+    recorder.recordHit("f");             // no metric left
+
+    BOOST_CHECK_EQUAL(events->segment().header().numMetrics, 4);
+    BOOST_CHECK_EQUAL(events->segment().header().numDropped, 3);
+
+    EventHandle handle = recorder.getEventHandle(ET_HIT, "g");
+    handle.recordHit();
+    BOOST_CHECK_EQUAL(events->segment().header().numDropped, 4);
+}
+
+BOOST_AUTO_TEST_CASE( test_shared_metrics_restart )
+{
+    string name = segmentName("restart");
+
+    SharedMetricsReader reader(name);
+    BOOST_CHECK(reader.read().empty());
+
+    {
+        auto events = std::make_shared<SharedMemoryEventService>(name);
+        EventRecorder recorder("svc", events);
+        recorder.recordEvent("level", ET_STABLE_LEVEL, 1.0);
+
+        // A segment that appears afterwards is read from the start
+        auto readings = byName(reader.read());
+        BOOST_CHECK_EQUAL(readings["svc.level"], 1.0);
+    }
+
+    auto events = std::make_shared<SharedMemoryEventService>(name);
+    EventRecorder recorder("svc", events);
+    recorder.recordEvent("level", ET_STABLE_LEVEL, 2.0);
+
+    auto readings = byName(reader.read());
+    BOOST_CHECK_EQUAL(readings["svc.level"], 2.0);
+}
@@ -0,0 +1,182 @@
+/* shm_ring_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Test of the shared memory message rings.
+*/
+
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "soa/service/shm_ring.h"
+#include "jml/arch/format.h"
+#include <boost/test/unit_test.hpp>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace {
+
+string uniqueName(const string & what)
+{
+    return ML::format("/shm_ring_test-%d-%s", getpid(), what.c_str());
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_push_pop )
+{
+    auto writer = ShmRing::create(uniqueName("push_pop"), 4096);
+    auto reader = ShmRing::open(writer->name());
+    BOOST_CHECK_EQUAL(reader->capacity(), 4096);
+
+    vector<string> message;
+    BOOST_CHECK(!reader->tryPop(message));
+
+    // The reader is waiting now so the first push must wake it up
+    bool wakeup;
+    BOOST_CHECK(writer->tryPush({ "AUCTION", "", string(100, 'x') }, wakeup));
+    BOOST_CHECK(wakeup);
+    BOOST_CHECK(writer->tryPush({ "WIN" }, wakeup));
+    BOOST_CHECK(!wakeup);
+
+    BOOST_CHECK(reader->tryPop(message));
+    BOOST_CHECK_EQUAL(message.size(), 3);
+    BOOST_CHECK_EQUAL(message[0], "AUCTION");
+    BOOST_CHECK_EQUAL(message[1], "");
+    BOOST_CHECK_EQUAL(message[2], string(100, 'x'));
+
+    BOOST_CHECK(reader->tryPop(message));
+    BOOST_CHECK_EQUAL(message.size(), 1);
+    BOOST_CHECK_EQUAL(message[0], "WIN");
+
+    BOOST_CHECK(!reader->tryPop(message));
+}
+
+BOOST_AUTO_TEST_CASE( test_full_and_wrap )
+{
+    auto writer = ShmRing::create(uniqueName("wrap"), 4096);
+    auto reader = ShmRing::open(writer->name());
+
+    // 1000 bytes of payload and 12 of sizes: 4 fit, the 5th doesn't
+    string payload(1000, 'a');
+    bool wakeup;
+    for (int i = 0;  i < 4;  ++i)
+        BOOST_CHECK(writer->tryPush({ payload }, wakeup));
+    BOOST_CHECK(!writer->tryPush({ payload }, wakeup));
+
+    BOOST_CHECK_THROW(writer->tryPush({ string(5000, 'b') }, wakeup),
+                      std::exception);
+
+    // Messages going across the end of the ring come back whole
+    vector<string> message;
+    for (int i = 0;  i < 1000;  ++i) {
+        string expected = to_string(i) + string(i % 777, 'c');
+        BOOST_CHECK(reader->tryPop(message));
+        BOOST_CHECK(writer->tryPush({ expected, "x" }, wakeup));
+        if (i >= 4) {
+            BOOST_REQUIRE_EQUAL(message.size(), 2);
+            string sent = to_string(i - 4) + string((i - 4) % 777, 'c');
+            BOOST_CHECK_EQUAL(message[0], sent);
+            BOOST_CHECK_EQUAL(message[1], "x");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_unlink_after_open )
+{
+    string name = uniqueName("unlink");
+    auto writer = ShmRing::create(name, 4096);
+    auto reader = ShmRing::open(name);
+    ShmRing::unlink(name);
+    ShmRing::unlink(name);
+
+    BOOST_CHECK_THROW(ShmRing::open(name), std::exception);
+
+    bool wakeup;
+    vector<string> message;
+    BOOST_CHECK(writer->tryPush({ "hello" }, wakeup));
+    BOOST_CHECK(reader->tryPop(message));
+    BOOST_CHECK_EQUAL(message.at(0), "hello");
+}
+
+BOOST_AUTO_TEST_CASE( test_channel_across_processes )
+{
+    string toChild = uniqueName("to_child");
+    string toParent = uniqueName("to_parent");
+    string parentWake = ML::format("/tmp/shm_ring_test-%d-parent", getpid());
+    string childWake = ML::format("/tmp/shm_ring_test-%d-child", getpid());
+
+    auto out = ShmRing::create(toChild, 65536);
+    auto in = ShmRing::create(toParent, 65536);
+    auto wakeup = ShmWakeup::create(parentWake);
+
+    int numMessages = 10000;
+
+    pid_t pid = fork();
+    BOOST_REQUIRE_NE(pid, -1);
+
+    if (pid == 0) {
+        // Child: echo everything back with its frames reversed
+        int result = 0;
+        try {
+            auto myWakeup = ShmWakeup::create(childWake);
+            ShmChannel channel(ShmRing::open(toParent), ShmRing::open(toChild),
+                               ShmWakeup::open(parentWake));
+            channel.sendMessage("READY");
+
+            vector<string> message;
+            for (int i = 0;  i < numMessages;) {
+                if (!channel.receive(message)) {
+                    pollfd fd = { myWakeup->fd(), POLLIN, 0 };
+                    ::poll(&fd, 1, 1000);
+                    myWakeup->drain();
+                    continue;
+                }
+                std::reverse(message.begin(), message.end());
+                while (!channel.send(message))
+                    ;
+                ++i;
+            }
+        } catch (const std::exception & exc) {
+            cerr << "child: " << exc.what() << endl;
+            result = 1;
+        }
+        _exit(result);
+    }
+
+    vector<string> message;
+    auto receive = [&] ()
+        {
+            while (!in->tryPop(message)) {
+                pollfd fd = { wakeup->fd(), POLLIN, 0 };
+                BOOST_REQUIRE_EQUAL(::poll(&fd, 1, 10000), 1);
+                wakeup->drain();
+            }
+        };
+
+    receive();
+    BOOST_REQUIRE_EQUAL(message.at(0), "READY");
+
+    ShmChannel channel(out, in, ShmWakeup::open(childWake));
+
+    for (int i = 0;  i < numMessages;  ++i) {
+        BOOST_REQUIRE(channel.sendMessage("PING", i, string(i % 100, 'p')));
+        receive();
+        BOOST_REQUIRE_EQUAL(message.size(), 3);
+        BOOST_CHECK_EQUAL(message[0], string(i % 100, 'p'));
+        BOOST_CHECK_EQUAL(message[1], to_string(i));
+        BOOST_CHECK_EQUAL(message[2], "PING");
+    }
+
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_CHECK(WIFEXITED(status));
+    BOOST_CHECK_EQUAL(WEXITSTATUS(status), 0);
+    BOOST_CHECK_EQUAL(channel.numDropped(), 0);
+}
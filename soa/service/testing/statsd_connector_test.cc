@@ -10,6 +10,13 @@
 
 #include <boost/test/unit_test.hpp>
 #include "soa/service/statsd_connector.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 
 using namespace std;
@@ -23,3 +30,83 @@ BOOST_AUTO_TEST_CASE( test_statsd_connector )
     for(int i=0; i<300; i++) x.recordGauge("testGauge", 0.1, 5.2);
     BOOST_CHECK_EQUAL(2, 2);
 }
+
+BOOST_AUTO_TEST_CASE( test_statsd_pack_lines )
+{
+    vector<string> lines = { "a:1|c|@1.00", "b:2|c|@1.00", "c:3|c|@1.00",
+                             string(30, 'x') };
+
+    auto packets = StatsdConnector::packLines(lines, 24);
+    BOOST_REQUIRE_EQUAL(packets.size(), 3);
+    BOOST_CHECK_EQUAL(packets[0], "a:1|c|@1.00\nb:2|c|@1.00");
+    BOOST_CHECK_EQUAL(packets[1], "c:3|c|@1.00");
+    BOOST_CHECK_EQUAL(packets[2], lines[3]);
+
+    BOOST_CHECK(StatsdConnector::packLines({}, 24).empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_statsd_batching )
+{
+    // Receive on an ephemeral port of the loopback
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    BOOST_REQUIRE(fd != -1);
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    BOOST_REQUIRE_EQUAL(::bind(fd, (sockaddr *)&sa, sizeof(sa)), 0);
+    socklen_t len = sizeof(sa);
+    getsockname(fd, (sockaddr *)&sa, &len);
+
+    string address = "127.0.0.1:" + to_string(ntohs(sa.sin_port));
+
+    {
+        StatsdConnector x(address, 0.0 /* flush by hand */, 512);
+
+        // Counters from several threads are summed into one line
+        auto record = [&] () {
+            for (int i = 0;  i < 1000;  ++i)
+                x.incrementCounter("test.counter", 1.0);
+        };
+        std::thread t1(record), t2(record);
+        record();
+        t1.join();
+        t2.join();
+
+        for (int i = 0;  i < 100;  ++i)
+            x.recordGauge("test.gauge", 1.0, i);
+
+        x.flush();
+    }
+
+    vector<string> lines;
+    size_t numPackets = 0;
+    char buf[65536];
+    for (;;) {
+        ssize_t res = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (res == -1) break;
+        BOOST_CHECK_LE(res, 512);
+        ++numPackets;
+
+        string packet(buf, res);
+        size_t start = 0;
+        for (;;) {
+            size_t end = packet.find('\n', start);
+            lines.push_back(packet.substr(start, end - start));
+            if (end == string::npos) break;
+            start = end + 1;
+        }
+    }
+    close(fd);
+
+    BOOST_CHECK_EQUAL(lines.size(), 101);
+    BOOST_CHECK_LT(numPackets, 10);
+    BOOST_CHECK(std::find(lines.begin(), lines.end(),
+                          "test.counter:3000|c|@1.00") != lines.end());
+    BOOST_CHECK_EQUAL(std::count_if(lines.begin(), lines.end(),
+                                    [] (const string & line)
+                                    {
+                                        return line.find("test.gauge:") == 0;
+                                    }),
+                      100);
+}
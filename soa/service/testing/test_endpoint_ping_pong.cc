@@ -24,7 +24,7 @@ using namespace std;
 using namespace ML;
 using namespace Datacratic;
 
-BOOST_AUTO_TEST_CASE( test_ping_pong )
+void doPingPongTest(EndpointBase::IoBackend backend)
 {
     BOOST_REQUIRE_EQUAL(TransportBase::created, TransportBase::destroyed);
     BOOST_REQUIRE_EQUAL(ConnectionHandler::created,
@@ -35,6 +35,7 @@ BOOST_AUTO_TEST_CASE( test_ping_pong )
     string connectionError;
 
     PassiveEndpointT<SocketTransport> acceptor("acceptor");
+    acceptor.setIoBackend(backend);
     
     acceptor.onMakeNewHandler = [&] ()
         {
@@ -48,6 +49,7 @@ BOOST_AUTO_TEST_CASE( test_ping_pong )
     BOOST_CHECK_EQUAL(acceptor.numConnections(), 0);
 
     ActiveEndpointT<SocketTransport> connector("connector");
+    connector.setIoBackend(backend);
     int nconnections = 1;
     connector.init(port, "localhost", nconnections);
 
@@ -103,3 +105,14 @@ BOOST_AUTO_TEST_CASE( test_ping_pong )
     BOOST_CHECK_EQUAL(ConnectionHandler::created,
                       ConnectionHandler::destroyed);
 }
+
+BOOST_AUTO_TEST_CASE( test_ping_pong )
+{
+    doPingPongTest(EndpointBase::EPOLL_IO);
+}
+
+BOOST_AUTO_TEST_CASE( test_ping_pong_io_uring )
+{
+    // Falls back to epoll where the kernel has no io_uring
+    doPingPongTest(EndpointBase::IO_URING_IO);
+}
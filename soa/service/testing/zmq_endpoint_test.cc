@@ -39,3 +39,43 @@ BOOST_AUTO_TEST_CASE( test_no_connect )
     ML::sleep(1.0);
     socket.shutdown();
 }
+
+/** Messages for a peer that isn't taking them are held in its own queue,
+    which drops the oldest once it's full, and are counted as dropped once
+    the socket says the peer is unknown.
+ */
+BOOST_AUTO_TEST_CASE( test_client_bus_peer_queues )
+{
+    Watchdog watchdog(10.0);
+
+    auto proxies = std::make_shared<ServiceProxies>();
+
+    ZmqNamedClientBus bus(proxies->zmqContext);
+    bus.init(proxies->config, "bus");
+    bus.enablePeerQueues(10, ZmqNamedClientBus::DROP_OLDEST);
+    bus.setPeerQueueLimit("slow", 5, ZmqNamedClientBus::DROP_NEWEST);
+
+    // The bus' loop isn't running so nothing is flushed yet
+    for (unsigned i = 0;  i < 25;  ++i) {
+        bus.sendMessage("nobody", "TOPIC", i);
+        bus.sendMessage("slow", "TOPIC", i);
+    }
+
+    auto stats = bus.getPeerStats();
+    BOOST_CHECK_EQUAL(stats["nobody"].queued, 10);
+    BOOST_CHECK_EQUAL(stats["nobody"].dropped, 15);
+    BOOST_CHECK_EQUAL(stats["slow"].queued, 5);
+    BOOST_CHECK_EQUAL(stats["slow"].dropped, 20);
+    BOOST_CHECK_EQUAL(stats["slow"].sent, 0);
+
+    bus.flushPeerQueues();
+
+    stats = bus.getPeerStats();
+    BOOST_CHECK_EQUAL(stats["nobody"].queued, 0);
+    BOOST_CHECK_EQUAL(stats["nobody"].sent, 0);
+    BOOST_CHECK_EQUAL(stats["nobody"].dropped, 25);
+    BOOST_CHECK_EQUAL(stats["slow"].queued, 0);
+    BOOST_CHECK_EQUAL(stats["slow"].dropped, 25);
+
+    bus.shutdown();
+}
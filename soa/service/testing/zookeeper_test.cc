@@ -18,8 +18,10 @@
 #include "jml/arch/exception_handler.h"
 #include "jml/arch/timers.h"
 #include "soa/service/zookeeper.h"
+#include "soa/service/zookeeper_configuration_service.h"
 #include "soa/service/testing/zookeeper_temporary_server.h"
 
+#include <atomic>
 #include <thread>
 #include <iostream>
 #include <set>
@@ -251,3 +253,51 @@ BOOST_AUTO_TEST_CASE( test_zookeeper )
     BOOST_CHECK_EQUAL(killed, 180);
 }
 
+
+BOOST_AUTO_TEST_CASE( test_zookeeper_configuration_cache )
+{
+    ML::set_default_trace_exceptions(false);
+
+    ZooKeeper::TemporaryServer server;
+    std::string uri = ML::format("localhost:%d", server.getPort());
+
+    signal(SIGCHLD, SIG_DFL);
+    server.start();
+
+    ZookeeperConfigurationService writer(uri, "cache", "here");
+    writer.set("serviceClass/router/r1", "one");
+    writer.set("serviceClass/router/r2", "two");
+
+    ZookeeperConfigurationService reader(uri, "cache", "here");
+    reader.prefetch();
+
+    BOOST_CHECK_EQUAL(reader.getChildren("serviceClass/router").size(), 2);
+    BOOST_CHECK_EQUAL(reader.getJson("serviceClass/router/r1").asString(),
+                      "one");
+
+    // Watches on the same node are called once each for a change
+    std::atomic<int> changes(0);
+    ConfigurationService::Watch watch
+        ([&] (std::string path, ConfigurationService::ChangeType change)
+         {
+             ++changes;
+         });
+    reader.getJson("serviceClass/router/r1", watch);
+    reader.getJson("serviceClass/router/r1", watch);
+
+    writer.set("serviceClass/router/r1", "uno");
+    while (changes == 0)
+        ML::sleep(0.1);
+    BOOST_CHECK_EQUAL(reader.getJson("serviceClass/router/r1").asString(),
+                      "uno");
+
+    // The cache of the writer itself is up to date as soon as it returns
+    writer.setUnique("serviceClass/router/r3", "three");
+    BOOST_CHECK_EQUAL(writer.getChildren("serviceClass/router").size(), 3);
+    writer.removePath("serviceClass/router/r3");
+    BOOST_CHECK_EQUAL(writer.getChildren("serviceClass/router").size(), 2);
+    BOOST_CHECK(writer.getJson("serviceClass/router/r3").isNull());
+
+    ML::sleep(0.5);
+    BOOST_CHECK_EQUAL(changes, 1);
+}
@@ -0,0 +1,205 @@
+/* thread_placement.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Pinning of threads to cpus and to the memory of their NUMA node.
+*/
+
+#include "thread_placement.h"
+#include "jml/arch/exception.h"
+#include <boost/algorithm/string.hpp>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <sched.h>
+#include <dirent.h>
+#include <errno.h>
+
+
+using namespace std;
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* THREAD PLACEMENT                                                          */
+/*****************************************************************************/
+
+void
+ThreadPlacement::
+applyToCurrentThread() const
+{
+    if (empty())
+        return;
+
+    pinCurrentThread(cpus);
+
+    if (!localMemory)
+        return;
+
+    int node = numaNodeOfCpu(cpus[0]);
+    for (int cpu: cpus)
+        if (numaNodeOfCpu(cpu) != node)
+            return;
+
+    if (node != -1)
+        preferNumaNode(node);
+}
+
+std::string
+ThreadPlacement::
+print() const
+{
+    return printCpuList(cpus) + (localMemory ? " (local memory)" : "");
+}
+
+ThreadPlacement
+ThreadPlacement::
+fromJson(const Json::Value & json)
+{
+    ThreadPlacement result;
+
+    if (json.isString()) {
+        result.cpus = parseCpuList(json.asString());
+    }
+    else if (json.isObject()) {
+        result.cpus = parseCpuList(json["cpus"].asString());
+        result.localMemory = json.get("localMemory", true).asBool();
+    }
+    else if (!json.isNull())
+        throw ML::Exception("thread placement must be a cpu list or an object: "
+                            + json.toStringNoNewLine());
+
+    return result;
+}
+
+Json::Value
+ThreadPlacement::
+toJson() const
+{
+    Json::Value result;
+    result["cpus"] = printCpuList(cpus);
+    result["localMemory"] = localMemory;
+    return result;
+}
+
+
+/*****************************************************************************/
+/* FREE FUNCTIONS                                                            */
+/*****************************************************************************/
+
+std::vector<int>
+parseCpuList(const std::string & cpus)
+{
+    std::vector<int> result;
+
+    std::vector<std::string> ranges;
+    boost::split(ranges, cpus, boost::is_any_of(","));
+
+    for (auto range: ranges) {
+        boost::trim(range);
+        if (range.empty())
+            continue;
+
+        int first, last;
+        char dummy;
+        int res = sscanf(range.c_str(), "%d-%d%c", &first, &last, &dummy);
+        if (res == 1)
+            last = first;
+        else if (res != 2)
+            throw ML::Exception("invalid cpu list '%s'", cpus.c_str());
+
+        if (first < 0 || last < first || last >= CPU_SETSIZE)
+            throw ML::Exception("invalid cpu range '%s'", range.c_str());
+
+        for (int cpu = first;  cpu <= last;  ++cpu)
+            result.push_back(cpu);
+    }
+
+    return result;
+}
+
+std::string
+printCpuList(const std::vector<int> & cpus)
+{
+    std::string result;
+
+    for (unsigned i = 0;  i < cpus.size();) {
+        unsigned j = i + 1;
+        while (j < cpus.size() && cpus[j] == cpus[j - 1] + 1)
+            ++j;
+
+        if (!result.empty()) result += ",";
+        result += to_string(cpus[i]);
+        if (j - i > 1)
+            result += "-" + to_string(cpus[j - 1]);
+        i = j;
+    }
+
+    return result;
+}
+
+void
+pinCurrentThread(const std::vector<int> & cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu: cpus)
+        CPU_SET(cpu, &set);
+
+    int res = sched_setaffinity(0, sizeof(set), &set);
+    if (res == -1)
+        throw ML::Exception(errno, "sched_setaffinity to cpus "
+                            + printCpuList(cpus));
+}
+
+int
+numaNodeOfCpu(int cpu)
+{
+    std::string dirName
+        = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+
+    DIR * dir = opendir(dirName.c_str());
+    if (!dir)
+        return -1;
+
+    int result = -1;
+    while (dirent * entry = readdir(dir)) {
+        int node;
+        if (sscanf(entry->d_name, "node%d", &node) == 1) {
+            result = node;
+            break;
+        }
+    }
+
+    closedir(dir);
+    return result;
+}
+
+void
+preferNumaNode(int node)
+{
+    unsigned long mask[16] = { 0 };
+    size_t bitsPerWord = sizeof(mask[0]) * 8;
+    if (node < 0 || size_t(node) >= bitsPerWord * 16)
+        throw ML::Exception("invalid NUMA node %d", node);
+
+    mask[node / bitsPerWord] = 1UL << (node % bitsPerWord);
+
+    int res = syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+                      bitsPerWord * 16 + 1);
+
+    // A kernel without NUMA support has nothing to prefer
+    if (res == -1 && errno != ENOSYS)
+        throw ML::Exception(errno, "set_mempolicy to node "
+                            + to_string(node));
+}
+
+int
+currentCpu()
+{
+    return sched_getcpu();
+}
+
+} // namespace Datacratic
@@ -0,0 +1,76 @@
+/* thread_placement.h                                              -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Pinning of threads to cpus and to the memory of their NUMA node.
+*/
+
+#pragma once
+
+#include "soa/jsoncpp/json.h"
+#include <string>
+#include <vector>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* THREAD PLACEMENT                                                          */
+/*****************************************************************************/
+
+/** Where a thread should run: the cpus it may be scheduled on and whether
+    its memory should come from the NUMA node of those cpus.
+
+    In JSON it's either a cpu list in the format of taskset, like "0-3,8",
+    or an object like { "cpus": "0-3,8", "localMemory": false }.
+*/
+
+struct ThreadPlacement {
+
+    ThreadPlacement()
+        : localMemory(true)
+    {
+    }
+
+    std::vector<int> cpus;
+
+    /** Prefer memory from the node of the cpus for what the thread
+        allocates from then on.  Only done when all the cpus are on the
+        same node.
+    */
+    bool localMemory;
+
+    bool empty() const { return cpus.empty(); }
+
+    /** Pins the calling thread.  Does nothing when empty. */
+    void applyToCurrentThread() const;
+
+    std::string print() const;
+
+    static ThreadPlacement fromJson(const Json::Value & json);
+    Json::Value toJson() const;
+};
+
+
+/** Parses a list of cpus like "0-3,8,10-11" as used by taskset. */
+std::vector<int> parseCpuList(const std::string & cpus);
+
+/** Prints a list of cpus in the format read by parseCpuList. */
+std::string printCpuList(const std::vector<int> & cpus);
+
+/** Restricts the calling thread to the given cpus. */
+void pinCurrentThread(const std::vector<int> & cpus);
+
+/** Returns the NUMA node of the given cpu, or -1 if it isn't known. */
+int numaNodeOfCpu(int cpu);
+
+/** Makes the memory that the calling thread allocates from now on come
+    from the given NUMA node when it has some free.
+*/
+void preferNumaNode(int node);
+
+/** Returns the cpu that the calling thread is running on. */
+int currentCpu();
+
+} // namespace Datacratic
@@ -14,6 +14,7 @@
 #include "soa/types/date.h"
 #include <boost/function.hpp>
 #include "jml/arch/exception.h"
+#include "jml/arch/huge_page_allocator.h"
 #include <math.h>
 
 namespace Datacratic {
@@ -215,13 +216,30 @@ struct TimeoutMap {
         }
     }
     
-    typedef std::map<Key, Node> Nodes;
+    typedef ML::Huge_Page_Allocator<std::pair<const Key, Node> > Allocator;
+
+    typedef std::map<Key, Node, std::less<Key>, Allocator> Nodes;
     Nodes nodes;
 
     /** Ordered set of timeouts in submitted for auction loss messages. */
-    typedef std::multimap<Date, typename Nodes::iterator> Timeouts;
+    typedef std::multimap<Date, typename Nodes::iterator, std::less<Date>,
+                          typename Allocator::template
+                          rebind<std::pair<const Date,
+                                           typename Nodes::iterator> >::other>
+        Timeouts;
     Timeouts timeouts;
 
+    /** Allocates the entries from the given arena, or with operator new if
+        it's null.  The map must be empty.
+    */
+    void useArena(std::shared_ptr<ML::Huge_Page_Arena> arena)
+    {
+        if (!empty())
+            doThrowException("can't change the arena of a non-empty map");
+        nodes = Nodes(std::less<Key>(), arena);
+        timeouts = Timeouts(std::less<Date>(), arena);
+    }
+
     // Date of the earliest timeout
     Date earliest;
 
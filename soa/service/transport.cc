@@ -52,8 +52,8 @@ TransportBase(EndpointBase * endpoint)
     : lockThread(0), lockActivity(0), debug(DEBUG_TRANSPORTS),
       asyncHead_(0),
       endpoint_(endpoint),
-      recycle_(0), close_(0), flags_(0),
-      hasConnection_(false), zombie_(false)
+      recycle_(0), close_(0), flags_(0), epollFlags_(0),
+      handlingEvents_(false), hasConnection_(false), zombie_(false)
 {
     atomic_add(created, 1);
 
@@ -541,16 +541,20 @@ hasConnection()
     if (getHandle() < 0)
         throw ML::Exception("hasConnection without a connection");
 
+    epollFlags_ = pollHandleFlags();
+
     struct epoll_event data;
     data.data.u64 = 0;
-    data.data.fd = getHandle();
-    data.events = pollFlagsToEpoll(flags_);
-    int res = epoll_ctl(epollFd_, EPOLL_CTL_ADD, getHandle(), &data);
+    data.data.fd = pollHandle();
+    data.events = pollFlagsToEpoll(epollFlags_);
+    int res = epoll_ctl(epollFd_, EPOLL_CTL_ADD, pollHandle(), &data);
     if (res == -1)
         throw ML::Exception(errno, "epoll_ctl ADD getHandle()");
 
     hasConnection_ = true;
 
+    flushIo();
+
     //cerr << "transport " << getHandle() << " "
     //     << status() << " has a connection" << endl;
 }
@@ -589,15 +593,19 @@ handleEvents()
     int rc = 0;
 
     addActivity("handleEvents");
-        
+
+    handlingEvents_ = true;
+    Call_Guard clearHandling([&] () { this->handlingEvents_ = false; });
+
     while (!isZombie() && rc != -1) {
         struct pollfd items[3] = {
             { eventFd_, POLLIN, 0 },
             { timerFd_, POLLIN, 0 },
-            { getHandle(), flags_, 0 }
+            { pollHandle(), pollHandleFlags(), 0 }
         };
 
         int res = poll(items, 3, 0);
+        items[2].revents = connectionEvents(items[2].revents);
         
 #if 0
         cerr << "handleevents for " << getHandle() << " " << status()
@@ -619,7 +627,7 @@ handleEvents()
         }
 #endif
 
-        if (res == 0 && !hasAsync()) break;
+        if (res == 0 && !items[2].revents && !hasAsync()) break;
         
         if (items[0].revents) {
             // Clear the wakeup if there was one
@@ -631,16 +639,11 @@ handleEvents()
         }
         if (rc != -1 && items[2].revents & POLLERR) {
             // Connection finished or has an error; check which one
-            int error = 0;
-            socklen_t error_len = sizeof(int);
-            int res = getsockopt(getHandle(), SOL_SOCKET, SO_ERROR,
-                                 &error, &error_len);
-            if (res == -1 || error_len != sizeof(int))
-                throw ML::Exception(errno, "getsockopt(SO_ERROR)");
-            
+            std::string error = connectionError();
+
             {
                 TransportTimer timer(this, "error");
-                rc = handleError(strerror(error));
+                rc = handleError(error);
             }
         }
         if (rc != -1 && items[1].revents & POLLIN) {
@@ -721,7 +724,7 @@ handleEvents()
         }
 
         if (hasConnection_) {
-            int res = epoll_ctl(epollFd_, EPOLL_CTL_DEL, getHandle(), 0);
+            int res = epoll_ctl(epollFd_, EPOLL_CTL_DEL, pollHandle(), 0);
             if (res == -1)
                 throw ML::Exception("TransportBase::close(): epoll_ctl DEL %d: %s",
                                     getHandle(), strerror(errno));
@@ -733,25 +736,42 @@ handleEvents()
         endpoint_->notifyCloseTransport(tr);
     }
     else if (hasConnection_) {
-        // Change the epoll event set
+        flushIo();
 
-        struct epoll_event data;
-        data.data.u64 = 0;
-        data.data.fd = getHandle();
-        data.events = pollFlagsToEpoll(flags_);
-        
-        //cerr << "setting flags to " << epollFlags(flags_) << endl;
+        // Change the epoll event set, if it changed
+        short newFlags = pollHandleFlags();
+        if (newFlags != epollFlags_) {
+            struct epoll_event data;
+            data.data.u64 = 0;
+            data.data.fd = pollHandle();
+            data.events = pollFlagsToEpoll(newFlags);
 
-        int res = epoll_ctl(epollFd_, EPOLL_CTL_MOD, getHandle(), &data);
-        
-        // TODO: no setting of mask if not necessary
-        if (res == -1)
-            throw ML::Exception(errno, "TransportBase::close(): epoll_ctl MOD");
+            //cerr << "setting flags to " << epollFlags(newFlags) << endl;
+
+            int res = epoll_ctl(epollFd_, EPOLL_CTL_MOD, pollHandle(), &data);
+            if (res == -1)
+                throw ML::Exception(errno, "TransportBase::close(): epoll_ctl MOD");
+            epollFlags_ = newFlags;
+        }
     }
 
     return rc;
 }
 
+std::string
+TransportBase::
+connectionError()
+{
+    int error = 0;
+    socklen_t error_len = sizeof(int);
+    int res = getsockopt(getHandle(), SOL_SOCKET, SO_ERROR,
+                         &error, &error_len);
+    if (res == -1 || error_len != sizeof(int))
+        throw ML::Exception(errno, "getsockopt(SO_ERROR)");
+
+    return strerror(error);
+}
+
 std::string
 TransportBase::
 status() const
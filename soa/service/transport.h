@@ -459,6 +459,35 @@ public:
     */
     void hasConnection();
 
+protected:
+    /* Hooks for transports that do their own I/O on the connection rather
+       than being told by poll when the socket is ready. */
+
+    /** Fd polled for the events of the connection. */
+    virtual int pollHandle() const { return getHandle(); }
+
+    /** Poll flags to wait for on pollHandle(). */
+    virtual short pollHandleFlags() const { return flags_; }
+
+    /** Turns what poll said about pollHandle() into the poll flags of the
+        connection.
+    */
+    virtual short connectionEvents(short revents) { return revents; }
+
+    /** Error to report when the connection events have POLLERR. */
+    virtual std::string connectionError();
+
+    /** Called once the events have been handled and the connection is
+        still open, to start what the handlers asked for.
+    */
+    virtual void flushIo() {}
+
+    /** Are we in handleEvents(), where flushIo() will be called? */
+    bool handlingEvents() const { return handlingEvents_; }
+
+    /** Current set of poll flags wanted by the handlers. */
+    short flags() const { return flags_; }
+
 private:
     std::shared_ptr<ConnectionHandler> slave_;
     EndpointBase * endpoint_;
@@ -480,6 +509,12 @@ private:
     /** Current set of flags */
     short flags_;
 
+    /** Flags that the epoll fd was last set up with for pollHandle(). */
+    short epollFlags_;
+
+    /** True while handleEvents() runs. */
+    bool handlingEvents_;
+
     /** FD used for epoll when multiplexing events */
     int epollFd_;
 
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <queue>
 #include <thread>
 
@@ -26,18 +27,24 @@ struct TypedMessageChannel {
 template<typename Message>
 struct TypedMessageSink: public AsyncEventSource {
 
-    TypedMessageSink(size_t bufferSize)
-        : wakeup(EFD_NONBLOCK), buf(bufferSize)
+    /** maxBatchSize is the number of messages handled per call to
+        processOne(), ie per wakeup of the loop when they come in quickly.
+    */
+    TypedMessageSink(size_t bufferSize, size_t maxBatchSize = 64)
+        : maxBatchSize(maxBatchSize), wakeup(EFD_NONBLOCK), signalled(false),
+          buf(bufferSize)
     {
     }
 
+    size_t maxBatchSize;
+
     std::function<void (Message && message)> onEvent;
 
     template<typename MessageT>
     void push(MessageT&& message)
     {
         buf.push(std::forward<MessageT>(message));
-        wakeup.signal();
+        signal();
     }
 
     template<typename MessageT>
@@ -45,7 +52,7 @@ struct TypedMessageSink: public AsyncEventSource {
     {
         bool pushed = buf.tryPush(std::forward<MessageT>(message));
         if (pushed)
-            wakeup.signal();
+            signal();
 
         return pushed;
     }
@@ -63,25 +70,43 @@ struct TypedMessageSink: public AsyncEventSource {
 
     virtual bool processOne()
     {
-        // Try to do one
+        // Do as many as we're allowed to
         Message msg;
         if (!buf.tryPop(msg))
             return false;
         onEvent(std::move(msg));
 
+        for (size_t i = 1;  i < maxBatchSize && buf.tryPop(msg);  ++i)
+            onEvent(std::move(msg));
+
         // Are there more waiting for us?
         if (buf.couldPop())
             return true;
         
-        // Warning: race condition... that's why we need the couldPop from
-        // the next instruction to be accurate
+        // We're about to run dry: the next push needs to signal again.  The
+        // fence pairs with the one in signal() so that either that push
+        // sees the flag cleared or we see its message.
         wakeup.tryRead();
+        signalled = false;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
 
         return buf.couldPop();
     }
-    uint64_t size() const { return buf.ring.size() ; }
+    uint64_t size() const { return buf.capacity(); }
 private:
+    /** Writes to the wakeup fd only when the loop may be asleep, so that a
+        busy sink costs one system call per wakeup and not one per message.
+    */
+    void signal()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!signalled.load(std::memory_order_relaxed)
+            && !signalled.exchange(true))
+            wakeup.signal();
+    }
+
     ML::Wakeup_Fd wakeup;
+    std::atomic<bool> signalled;
     ML::RingBufferSRMW<Message> buf;
 };
 
@@ -187,6 +212,28 @@ struct TypedMessageQueue: public AsyncEventSource
         return messages;
     }
 
+    /* moves messages from the front of the queue to "output" for as long as
+       "accept" returns true for the next one, returning how many were
+       moved */
+    template<typename Output, typename Accept>
+    size_t pop_front_while(Output & output, const Accept & accept)
+    {
+        size_t count(0);
+        Guard guard(queueLock_);
+
+        while (queue_.size() > 0 && accept(queue_.front())) {
+            output.emplace_back(std::move(queue_.front()));
+            queue_.pop();
+            count++;
+        }
+
+        if (queue_.size() == 0) {
+            pending_ = false;
+        }
+
+        return count;
+    }
+
     /* number of messages present in the queue */
     uint64_t size()
         const
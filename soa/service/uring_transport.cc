@@ -0,0 +1,413 @@
+/* uring_transport.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Socket transport that does its I/O through io_uring.
+*/
+
+#include "uring_transport.h"
+#include "jml/utils/exc_assert.h"
+#include <sys/socket.h>
+#include <poll.h>
+#include <string.h>
+#include <chrono>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* URING SOCKET TRANSPORT                                                    */
+/*****************************************************************************/
+
+UringSocketTransport::
+UringSocketTransport(EndpointBase * endpoint)
+    : SocketTransport(endpoint),
+      ring_(new IoUring(8)),
+      recvBuffer_(new char[RecvBufferSize]),
+      recvFixed_(false),
+      recvStart_(0), recvEnd_(0), recvInFlight_(false), recvNeedsPoll_(false),
+      peerClosed_(false), recvError_(0),
+      sendOffset_(0), sendInFlight_(false), sendNeedsPoll_(false),
+      sendError_(0), writable_(false), writablePollInFlight_(false),
+      socketError_(false), errorReported_(false),
+      nopInFlight_(false), closing_(false)
+{
+    iovec buffer = { recvBuffer_.get(), RecvBufferSize };
+    recvFixed_ = ring_->registerBuffers(&buffer, 1);
+}
+
+UringSocketTransport::
+~UringSocketTransport()
+{
+    // The kernel mustn't be left writing into the buffers we free
+    cancelAll();
+}
+
+ssize_t
+UringSocketTransport::
+send(const char * buf, size_t len, int flags)
+{
+    if (sendError_) {
+        errno = sendError_;
+        return -1;
+    }
+
+    if (queuedBytes() >= MaxQueuedBytes) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    sendQueue_.append(buf, len);
+
+    // Within the events, it goes out with everything else at the end
+    if (!handlingEvents())
+        flushIo();
+
+    return len;
+}
+
+ssize_t
+UringSocketTransport::
+recv(char * buf, size_t buf_size, int flags)
+{
+    if (recvStart_ < recvEnd_) {
+        size_t n = std::min(buf_size, recvEnd_ - recvStart_);
+        memcpy(buf, recvBuffer_.get() + recvStart_, n);
+        if (!(flags & MSG_PEEK))
+            recvStart_ += n;
+
+        if (recvStart_ == recvEnd_ && !handlingEvents())
+            flushIo();
+
+        return n;
+    }
+
+    if (recvError_) {
+        errno = recvError_;
+        return -1;
+    }
+
+    if (peerClosed_)
+        return 0;
+
+    errno = EAGAIN;
+    return -1;
+}
+
+int
+UringSocketTransport::
+closePeer()
+{
+    addActivityS("closePeer");
+
+    if (getHandle() != -1) {
+        closing_ = true;
+
+        // Give what was queued a chance to go out, as the socket would
+        auto deadline = std::chrono::steady_clock::now()
+            + std::chrono::seconds(1);
+        for (;;) {
+            prepareIo();
+            ring_->submit();
+
+            if (sendError_ || (!sendInFlight_ && sendQueue_.empty()))
+                break;
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                break;
+
+            int timeout = std::chrono::duration_cast<std::chrono::milliseconds>
+                (deadline - now).count();
+            waitForCompletions(timeout + 1);
+        }
+
+        // Wakes up what is still in flight
+        ::shutdown(getHandle(), SHUT_RDWR);
+        cancelAll();
+    }
+
+    recvStart_ = recvEnd_ = 0;
+    recvNeedsPoll_ = peerClosed_ = false;
+    recvError_ = 0;
+    sendQueue_.clear();
+    sending_.clear();
+    sendOffset_ = 0;
+    sendNeedsPoll_ = false;
+    sendError_ = 0;
+    writable_ = socketError_ = errorReported_ = false;
+    closing_ = false;
+
+    return SocketTransport::closePeer();
+}
+
+int
+UringSocketTransport::
+pollHandle() const
+{
+    return ring_->fd();
+}
+
+short
+UringSocketTransport::
+pollHandleFlags() const
+{
+    // Everything arrives as a completion, whatever the handlers wait for
+    return POLLIN;
+}
+
+short
+UringSocketTransport::
+connectionEvents(short revents)
+{
+    reapCompletions();
+
+    // While connecting, the ring isn't being waited on yet; check for the
+    // socket becoming writable each time we're called, as poll would
+    if ((flags() & POLLOUT) && !writable_ && !writablePollInFlight_) {
+        flushIo();
+        reapCompletions();
+    }
+
+    return readyEvents();
+}
+
+std::string
+UringSocketTransport::
+connectionError()
+{
+    errorReported_ = true;
+    if (sendError_)
+        return strerror(sendError_);
+
+    return SocketTransport::connectionError();
+}
+
+void
+UringSocketTransport::
+flushIo()
+{
+    prepareIo();
+
+    // Events that don't come from the ring, like the socket being ready
+    // for writing, need a completion to wake up the loop
+    if (!handlingEvents() && !nopInFlight_ && readyEvents()) {
+        io_uring_sqe * sqe = ring_->getSqe();
+        ExcAssert(sqe);
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = OP_NOP;
+        nopInFlight_ = true;
+    }
+
+    ring_->submit();
+}
+
+size_t
+UringSocketTransport::
+queuedBytes() const
+{
+    return sendQueue_.size() + sending_.size() - sendOffset_;
+}
+
+short
+UringSocketTransport::
+readyEvents() const
+{
+    short result = 0;
+
+    if (flags() & POLLIN) {
+        if (recvStart_ < recvEnd_ || peerClosed_ || recvError_)
+            result |= POLLIN;
+    }
+    if ((flags() & POLLOUT) && writable_) {
+        if (sendError_ || queuedBytes() < MaxQueuedBytes)
+            result |= POLLOUT;
+    }
+    if ((flags() & POLLRDHUP) && peerClosed_ && recvStart_ == recvEnd_)
+        result |= POLLRDHUP;
+    if ((sendError_ || socketError_) && !errorReported_)
+        result |= POLLERR;
+
+    return result;
+}
+
+void
+UringSocketTransport::
+reapCompletions()
+{
+    auto onCompletion = [&] (uint64_t userData, int res, unsigned flags)
+        {
+            switch (userData) {
+            case OP_RECV:
+                recvInFlight_ = false;
+                recvNeedsPoll_ = false;
+                if (res > 0)
+                    recvEnd_ = res;
+                else if (res == 0)
+                    peerClosed_ = true;
+                else if (res == -EAGAIN)
+                    recvNeedsPoll_ = true;
+                else if (res != -EINTR && res != -ECANCELED)
+                    recvError_ = -res;
+                break;
+
+            case OP_SEND:
+                sendInFlight_ = false;
+                sendNeedsPoll_ = false;
+                if (res >= 0) {
+                    sendOffset_ += res;
+                    writable_ = true;
+                }
+                else if (res == -EAGAIN)
+                    sendNeedsPoll_ = true;
+                else if (res != -EINTR && res != -ECANCELED)
+                    sendError_ = -res;
+                break;
+
+            case OP_NOP:
+                nopInFlight_ = false;
+                break;
+
+            case OP_WRITABLE:
+                writablePollInFlight_ = false;
+                if (res > 0) {
+                    writable_ = true;
+                    if (res & POLLERR)
+                        socketError_ = true;
+                }
+                break;
+
+            default:
+                break;
+            }
+        };
+
+    ring_->forEachCompletion(onCompletion);
+}
+
+void
+UringSocketTransport::
+prepareIo()
+{
+    int fd = getHandle();
+    if (fd == -1)
+        return;
+
+    // Older kernels give EAGAIN for non-blocking sockets instead of waiting
+    // for them to be ready; we then wait in the ring with a linked poll
+    auto pollFirst = [&] (short events)
+        {
+            io_uring_sqe * sqe = ring_->getSqe();
+            ExcAssert(sqe);
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = fd;
+            sqe->poll_events = events;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = OP_POLL;
+        };
+
+    if ((flags() & POLLIN) && !closing_ && !recvInFlight_
+        && recvStart_ == recvEnd_ && !peerClosed_ && !recvError_) {
+        if (recvNeedsPoll_)
+            pollFirst(POLLIN);
+
+        io_uring_sqe * sqe = ring_->getSqe();
+        ExcAssert(sqe);
+        sqe->opcode = recvFixed_ ? IORING_OP_READ_FIXED : IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)recvBuffer_.get();
+        sqe->len = RecvBufferSize;
+        sqe->buf_index = 0;
+        sqe->user_data = OP_RECV;
+
+        recvStart_ = recvEnd_ = 0;
+        recvInFlight_ = true;
+    }
+
+    if ((flags() & POLLOUT) && !writable_ && !writablePollInFlight_) {
+        io_uring_sqe * sqe = ring_->getSqe();
+        ExcAssert(sqe);
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll_events = POLLOUT;
+        sqe->user_data = OP_WRITABLE;
+        writablePollInFlight_ = true;
+    }
+
+    if (!sendInFlight_ && !sendError_) {
+        // Everything queued since the last send goes out in one
+        if (sendOffset_ == sending_.size()) {
+            sending_.clear();
+            sendOffset_ = 0;
+            sending_.swap(sendQueue_);
+        }
+
+        if (sendOffset_ < sending_.size()) {
+            if (sendNeedsPoll_)
+                pollFirst(POLLOUT);
+
+            io_uring_sqe * sqe = ring_->getSqe();
+            ExcAssert(sqe);
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t)(sending_.data() + sendOffset_);
+            sqe->len = sending_.size() - sendOffset_;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            sqe->user_data = OP_SEND;
+
+            sendInFlight_ = true;
+        }
+    }
+}
+
+void
+UringSocketTransport::
+waitForCompletions(int timeoutMs)
+{
+    struct pollfd item = { ring_->fd(), POLLIN, 0 };
+    int res = poll(&item, 1, timeoutMs);
+    if (res == -1 && errno != EINTR)
+        throw ML::Exception(errno, "poll on io_uring");
+
+    reapCompletions();
+}
+
+bool
+UringSocketTransport::
+inFlight() const
+{
+    return recvInFlight_ || sendInFlight_ || writablePollInFlight_
+        || nopInFlight_;
+}
+
+void
+UringSocketTransport::
+cancelAll()
+{
+    ring_->submit();
+    reapCompletions();
+
+    bool cancelled = false;
+    while (inFlight()) {
+        if (!cancelled) {
+            for (uint64_t op: { OP_RECV, OP_SEND, OP_WRITABLE }) {
+                io_uring_sqe * sqe = ring_->getSqe();
+                ExcAssert(sqe);
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = op;
+                sqe->user_data = OP_CANCEL;
+            }
+            cancelled = true;
+        }
+
+        ring_->submit(1);
+        reapCompletions();
+    }
+}
+
+} // namespace Datacratic
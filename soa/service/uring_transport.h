@@ -0,0 +1,122 @@
+/* uring_transport.h                                               -*- C++ -*-
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Socket transport that does its I/O through io_uring.
+*/
+
+#pragma once
+
+#include "soa/service/transport.h"
+#include "soa/service/io_uring.h"
+#include <memory>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* URING SOCKET TRANSPORT                                                    */
+/*****************************************************************************/
+
+/** SocketTransport that reads and writes through an io_uring of its own
+    instead of a read or write system call per event.
+
+    A receive is always posted into a buffer registered with the ring while
+    the handler is reading, and recv() is served from what it brought in.
+    send() queues the data and returns straight away; what is queued while
+    the events are handled goes out in a single send.  The receive and the
+    send that answer a request are thus submitted together, by one system
+    call at the end of the events, and the ring's fd replaces the socket in
+    the epoll set so that its mask never needs changing.
+
+    Only to be created when IoUring::available() says so; the endpoints
+    take care of that and use SocketTransport otherwise.
+*/
+
+struct UringSocketTransport : public SocketTransport {
+
+    UringSocketTransport(EndpointBase * endpoint);
+
+    virtual ~UringSocketTransport();
+
+    /** Size of the receive buffer. */
+    static constexpr size_t RecvBufferSize = 65536;
+
+    /** send() fails with EAGAIN once this much is waiting to go out. */
+    static constexpr size_t MaxQueuedBytes = 4 * 1024 * 1024;
+
+    virtual ssize_t send(const char * buf, size_t len, int flags);
+    virtual ssize_t recv(char * buf, size_t buf_size, int flags);
+    virtual int closePeer();
+
+protected:
+    virtual int pollHandle() const;
+    virtual short pollHandleFlags() const;
+    virtual short connectionEvents(short revents);
+    virtual std::string connectionError();
+    virtual void flushIo();
+
+private:
+    /** What each completion is for, in its user data. */
+    enum Operation {
+        OP_RECV = 1,
+        OP_SEND = 2,
+        OP_POLL = 3,
+        OP_NOP = 4,
+        OP_CANCEL = 5,
+        OP_WRITABLE = 6
+    };
+
+    /** Bytes given to send() that haven't gone out yet. */
+    size_t queuedBytes() const;
+
+    /** Poll flags of the connection, from the state below. */
+    short readyEvents() const;
+
+    /** Reads the completions and turns them into the state below. */
+    void reapCompletions();
+
+    /** Prepares the receive and send that are due. */
+    void prepareIo();
+
+    /** Waits up to the given time for completions and reaps them. */
+    void waitForCompletions(int timeoutMs);
+
+    /** Is anything of ours in the kernel? */
+    bool inFlight() const;
+
+    /** Cancels what the kernel still has of ours and waits for it. */
+    void cancelAll();
+
+    std::unique_ptr<IoUring> ring_;
+    std::unique_ptr<char[]> recvBuffer_;
+    bool recvFixed_;        ///< Is recvBuffer_ registered with the ring?
+
+    size_t recvStart_;      ///< First byte not yet given to recv()
+    size_t recvEnd_;        ///< One past the last byte received
+    bool recvInFlight_;
+    bool recvNeedsPoll_;    ///< Wait for the socket before the next one
+    bool peerClosed_;
+    int recvError_;
+
+    std::string sendQueue_; ///< Waiting for the send in flight to finish
+    std::string sending_;   ///< In the send in flight
+    size_t sendOffset_;     ///< What of sending_ was already sent
+    bool sendInFlight_;
+    bool sendNeedsPoll_;
+    int sendError_;
+
+    /** Has the socket been seen writable?  Until then, as when connecting,
+        the handlers are only told it is once the kernel says so.
+    */
+    bool writable_;
+    bool writablePollInFlight_;
+    bool socketError_;      ///< Did that poll come back with POLLERR?
+    bool errorReported_;    ///< Was the error given to handleError()?
+
+    bool nopInFlight_;
+    bool closing_;
+};
+
+} // namespace Datacratic
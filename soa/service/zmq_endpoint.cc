@@ -411,6 +411,172 @@ bindTcp(PortRange const & portRange, std::string host)
 
  
 
+/*****************************************************************************/
+/* ZMQ NAMED CLIENT BUS                                                      */
+/*****************************************************************************/
+
+void
+ZmqNamedClientBus::
+enablePeerQueues(size_t maxQueued, OverflowPolicy policy)
+{
+    ExcAssert(!peerQueuesEnabled);
+
+#ifdef ZMQ_ROUTER_MANDATORY
+    // Full or unknown peers are reported instead of silently dropped
+    int mandatory = 1;
+    getSocketUnsafe().setsockopt(ZMQ_ROUTER_MANDATORY,
+                                 &mandatory, sizeof(mandatory));
+#endif
+
+    defaultPeerLimit.maxQueued = maxQueued;
+    defaultPeerLimit.policy = policy;
+    peerQueuesEnabled = true;
+
+    addSource("ZmqNamedClientBus::peerQueues", peerQueueSource);
+    addPeriodic("ZmqNamedClientBus::retryPeers", 0.01,
+                [=] (uint64_t) { this->flushPeerQueues(); });
+}
+
+void
+ZmqNamedClientBus::
+setPeerQueueLimit(const std::string & peer,
+                  size_t maxQueued,
+                  OverflowPolicy policy)
+{
+    std::unique_lock<std::mutex> guard(peerQueuesLock);
+    PeerLimit & limit = peerLimits[peer];
+    limit.maxQueued = maxQueued;
+    limit.policy = policy;
+
+    auto it = peerQueues.find(peer);
+    if (it != peerQueues.end())
+        trimPeerQueue(peer, it->second);
+}
+
+std::map<std::string, ZmqNamedClientBus::PeerStats>
+ZmqNamedClientBus::
+getPeerStats() const
+{
+    std::unique_lock<std::mutex> guard(peerQueuesLock);
+
+    std::map<std::string, PeerStats> result;
+    for (auto & q: peerQueues) {
+        PeerStats & stats = result[q.first];
+        stats = q.second.stats;
+        stats.queued = q.second.messages.size();
+    }
+    return result;
+}
+
+void
+ZmqNamedClientBus::
+queueMessage(const std::string & peer, Message && message)
+{
+    {
+        std::unique_lock<std::mutex> guard(peerQueuesLock);
+        PeerQueue & queue = peerQueues[peer];
+        queue.messages.emplace_back(std::move(message));
+        trimPeerQueue(peer, queue);
+    }
+
+    peerQueueSource->signal();
+}
+
+void
+ZmqNamedClientBus::
+trimPeerQueue(const std::string & peer, PeerQueue & queue)
+{
+    auto it = peerLimits.find(peer);
+    const PeerLimit & limit
+        = it == peerLimits.end() ? defaultPeerLimit : it->second;
+
+    while (queue.messages.size() > limit.maxQueued) {
+        if (limit.policy == DROP_OLDEST)
+            queue.messages.pop_front();
+        else queue.messages.pop_back();
+        ++queue.stats.dropped;
+    }
+}
+
+void
+ZmqNamedClientBus::
+flushPeerQueues()
+{
+    std::unique_lock<std::mutex> flushGuard(flushLock);
+
+    // Cleared first so that a message queued during the flush signals again
+    peerQueueSource->signalled = false;
+    peerQueueSource->wakeup.tryRead();
+
+    // The messages are taken out so that the senders aren't held up while
+    // they go out on the socket
+    std::vector<std::pair<std::string, std::deque<Message> > > toSend;
+    {
+        std::unique_lock<std::mutex> guard(peerQueuesLock);
+        for (auto & q: peerQueues) {
+            if (q.second.messages.empty())
+                continue;
+            toSend.emplace_back(q.first, std::move(q.second.messages));
+            q.second.messages.clear();
+        }
+    }
+
+    for (auto & peer: toSend) {
+        std::deque<Message> & messages = peer.second;
+        uint64_t sent = 0;
+        bool blocked = false, gone = false;
+
+        while (!messages.empty()) {
+            try {
+                if (!trySendMessage(messages.front())) {
+                    blocked = true;
+                    break;
+                }
+            } catch (const zmq::error_t & exc) {
+                if (exc.num() != EHOSTUNREACH)
+                    throw;
+                gone = true;
+                break;
+            }
+            messages.pop_front();
+            ++sent;
+        }
+
+        std::unique_lock<std::mutex> guard(peerQueuesLock);
+        auto it = peerQueues.find(peer.first);
+        if (it == peerQueues.end())
+            continue;  // disconnected while we were sending
+
+        PeerQueue & queue = it->second;
+        queue.stats.sent += sent;
+        if (blocked)
+            ++queue.stats.blocked;
+
+        if (gone) {
+            queue.stats.dropped += messages.size() + queue.messages.size();
+            queue.messages.clear();
+            continue;
+        }
+
+        // What's left goes back in front of what was queued meanwhile
+        if (!messages.empty()) {
+            for (auto & m: queue.messages)
+                messages.emplace_back(std::move(m));
+            queue.messages.swap(messages);
+            trimPeerQueue(peer.first, queue);
+        }
+    }
+}
+
+bool
+ZmqNamedClientBus::PeerQueueSource::
+processOne()
+{
+    bus->flushPeerQueues();
+    return false;
+}
+
+
 /*****************************************************************************/
 /* NAMED ZEROMQ PROXY                                                        */
 /*****************************************************************************/
@@ -418,6 +584,7 @@ bindTcp(PortRange const & portRange, std::string host)
 ZmqNamedProxy::
 ZmqNamedProxy() :
     context_(new zmq::context_t(1)),
+    socketType(0),
     local(true),
     shardIndex(-1)
 {
@@ -426,6 +593,7 @@ ZmqNamedProxy() :
 ZmqNamedProxy::
 ZmqNamedProxy(std::shared_ptr<zmq::context_t> context, int shardIndex) :
     context_(context),
+    socketType(0),
     local(true),
     shardIndex(shardIndex)
 {
@@ -441,6 +609,8 @@ init(std::shared_ptr<ConfigurationService> config,
     this->connectionState = NOT_CONNECTED;
 
     this->config = config;
+    this->socketType = socketType;
+    this->identity = identity;
     socket_.reset(new zmq::socket_t(*context_, socketType));
     if (identity != "")
         setIdentity(*socket_, identity);
@@ -457,6 +627,29 @@ init(std::shared_ptr<ConfigurationService> config,
                                  std::placeholders::_2));
 }
 
+void
+ZmqNamedProxy::
+enableSocketPerThread()
+{
+    ExcAssert(socket_);
+    ExcAssertEqual(connectionState, NOT_CONNECTED);
+
+    threadSockets.reset(new SocketPerThread());
+    threadSockets->init(*context_, socketType, "");
+
+    auto numSockets = std::make_shared<std::atomic<int> >(0);
+    std::string prefix = identity;
+    threadSockets->onNewSocket = [=] (zmq::socket_t & socket)
+        {
+            if (!prefix.empty()) {
+                setIdentity(socket,
+                            prefix + ZmqNamedClientBus::ThreadIdentitySeparator
+                            + std::to_string((*numSockets)++));
+            }
+            setHwm(socket, 65536);
+        };
+}
+
 bool
 ZmqNamedProxy::
 connect(const std::string & endpointName,
@@ -518,6 +711,8 @@ connect(const std::string & endpointName,
             {
                 std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
                 socket().connect(uri.c_str());
+                if (threadSockets)
+                    threadSockets->setUri(uri);
                 connectedUri = uri;
                 connectionState = CONNECTED;
             }
@@ -853,6 +1048,8 @@ watchServiceProvider(const std::string & name, const std::string & path, int sha
     try {
         auto newClient = std::make_shared<ZmqNamedClientBusProxy>(zmqContext, shardIndex);
         newClient->init(config, identity);
+        if (socketPerThread)
+            newClient->enableSocketPerThread();
 
         // The connect call below could trigger this callback while we're
         // holding the connectionsLock which is a big no-no. This fancy
@@ -12,6 +12,8 @@
 #include "message_loop.h"
 #include "logs.h"
 #include <set>
+#include <deque>
+#include <atomic>
 #include <type_traits>
 #include "jml/utils/smart_ptr_utils.h"
 #include "jml/utils/vector_utils.h"
@@ -20,6 +22,7 @@
 #include "jml/arch/timers.h"
 #include "jml/arch/cmp_xchg.h"
 #include "zmq_utils.h"
+#include "socket_per_thread.h"
 
 namespace Datacratic {
 
@@ -561,6 +564,29 @@ struct ZmqNamedEndpoint : public NamedEndpoint, public MessageLoop {
         }
     }
 
+    /** Send a raw message without waiting for the socket.  Returns false,
+        leaving the message untouched, if the socket can't take it right now;
+        other errors are thrown as zmq::error_t.
+
+        Only the first frame can be refused; the ones after it are sent
+        normally, which never waits on a ROUTER socket.
+    */
+    bool trySendMessage(std::vector<zmq::message_t> & message)
+    {
+        std::unique_lock<Lock> guard(lock);
+        ExcAssert(socket_);
+        ExcAssert(!message.empty());
+        int flags = message.size() == 1 ? 0 : ZMQ_SNDMORE;
+        if (!socket_->send(message[0], flags | ZMQ_DONTWAIT))
+            return false;
+        for (unsigned i = 1;  i < message.size();  ++i) {
+            socket_->send(message[i],
+                          i == message.size() - 1
+                          ? 0 : ZMQ_SNDMORE);
+        }
+        return true;
+    }
+
     /** Very unsafe method as it bypasses all thread safety. */
     zmq::socket_t & getSocketUnsafe() const
     {
@@ -699,8 +725,12 @@ struct ZmqNamedClientBus: public ZmqNamedEndpoint {
 
     ZmqNamedClientBus(std::shared_ptr<zmq::context_t> context,
                       double deadClientDelay = 5.0)
-        : ZmqNamedEndpoint(context), deadClientDelay(deadClientDelay)
+        : ZmqNamedEndpoint(context), deadClientDelay(deadClientDelay),
+          peerQueuesEnabled(false),
+          peerQueueSource(std::make_shared<PeerQueueSource>(this))
     {
+        defaultPeerLimit.maxQueued = 4096;
+        defaultPeerLimit.policy = DROP_OLDEST;
     }
 
     void init(std::shared_ptr<ConfigurationService> config,
@@ -727,6 +757,12 @@ struct ZmqNamedClientBus: public ZmqNamedEndpoint {
     */
     double deadClientDelay;
 
+    /** Messages from a client identity followed by this and anything else
+        are taken as coming from the client itself.  This lets a client send
+        from several sockets (see ZmqNamedProxy::enableSocketPerThread()).
+    */
+    static constexpr char ThreadIdentitySeparator = '\x1f';
+
     /** Function called when something connects to the bus */
     std::function<void (std::string)> onConnection;
 
@@ -742,14 +778,83 @@ struct ZmqNamedClientBus: public ZmqNamedEndpoint {
                      const std::string & topic,
                      Args&&... args)
     {
-        ZmqNamedEndpoint::sendMessage(address, topic,
-                                      std::forward<Args>(args)...);
+        if (!peerQueuesEnabled) {
+            ZmqNamedEndpoint::sendMessage(address, topic,
+                                          std::forward<Args>(args)...);
+            return;
+        }
+
+        std::vector<zmq::message_t> message;
+        message.reserve(sizeof...(Args) + 2);
+        encodeAll(message, address, topic, std::forward<Args>(args)...);
+        queueMessage(address, std::move(message));
+    }
+
+    /** What to do with a message for a peer whose queue is full. */
+    enum OverflowPolicy {
+        DROP_NEWEST,    ///< The message being sent is dropped
+        DROP_OLDEST     ///< The oldest queued message makes room for it
+    };
+
+    /** Counters for the messages sent to one peer through its queue. */
+    struct PeerStats {
+        PeerStats()
+            : queued(0), sent(0), dropped(0), blocked(0)
+        {
+        }
+
+        size_t queued;      ///< Messages waiting in the queue
+        uint64_t sent;      ///< Messages taken by the socket
+        uint64_t dropped;   ///< Messages dropped by the policy or as the
+                            ///< peer had gone
+        uint64_t blocked;   ///< Times the socket couldn't take more
+    };
+
+    /** Give each peer a queue of its own for the messages sent to it,
+        instead of sending them on the socket from the caller's thread.  The
+        queues are drained without waiting by flushPeerQueues(), which the
+        bus' own loop calls when messages are queued; a peer that can't take
+        more keeps its messages until the next flush, holding up no other
+        peer.  Once a queue holds maxQueued messages, the policy decides
+        which message is dropped.
+
+        The socket is made to report peers that are full or gone instead of
+        silently dropping their messages, which it does only where that is
+        supported.  To be called after init() and before the bus is used.
+    */
+    void enablePeerQueues(size_t maxQueued = 4096,
+                          OverflowPolicy policy = DROP_OLDEST);
+
+    /** Override the size of the queue and the policy for the given peer. */
+    void setPeerQueueLimit(const std::string & peer,
+                           size_t maxQueued,
+                           OverflowPolicy policy);
+
+    /** Send what is queued for each peer until the socket can't take more
+        for it.  Thread safe.  Must be called by those that drive the socket
+        themselves instead of running the bus' loop, whenever the fd of
+        peerQueueFd() is readable and also every few milliseconds, to retry
+        the peers that were full.
+    */
+    void flushPeerQueues();
+
+    /** File descriptor that becomes readable when messages are queued. */
+    int peerQueueFd() const
+    {
+        return peerQueueSource->selectFd();
     }
 
+    /** Counters for each peer that has a queue. */
+    std::map<std::string, PeerStats> getPeerStats() const;
+
     virtual void handleMessage(std::vector<std::string> && message)
     {
         using namespace std;
 
+        auto pos = message.at(0).find(ThreadIdentitySeparator);
+        if (pos != std::string::npos)
+            message[0].resize(pos);
+
         const std::string & agent = message.at(0);
         const std::string & topic = message.at(1);
 
@@ -825,8 +930,92 @@ private:
                 onDisconnection(d);
             clientInfo.erase(d);
         }
+
+        if (peerQueuesEnabled) {
+            std::unique_lock<std::mutex> guard(peerQueuesLock);
+            for (auto d: deadClients)
+                peerQueues.erase(d);
+        }
     }
 
+    template<typename Head, typename... Tail>
+    static void encodeAll(std::vector<zmq::message_t> & messages,
+                          Head && head,
+                          Tail&&... tail)
+    {
+        encodeOne(messages, head);
+        encodeAll(messages, std::forward<Tail>(tail)...);
+    }
+
+    static void encodeAll(std::vector<zmq::message_t> & messages)
+    {
+    }
+
+    template<typename T>
+    static void encodeOne(std::vector<zmq::message_t> & messages,
+                          const T & value)
+    {
+        messages.emplace_back(encodeMessage(value));
+    }
+
+    // Vectors of strings give one frame per string, as with sendMessage()
+    static void encodeOne(std::vector<zmq::message_t> & messages,
+                          const std::vector<std::string> & values)
+    {
+        for (auto & v: values)
+            messages.emplace_back(encodeMessage(v));
+    }
+
+    typedef std::vector<zmq::message_t> Message;
+
+    void queueMessage(const std::string & peer, Message && message);
+
+    struct PeerLimit {
+        size_t maxQueued;
+        OverflowPolicy policy;
+    };
+
+    struct PeerQueue {
+        std::deque<Message> messages;
+        PeerStats stats;
+    };
+
+    /** Drops messages from the queue until it fits into its limit. */
+    void trimPeerQueue(const std::string & peer, PeerQueue & queue);
+
+    /** Wakes up the loop when messages are queued to flush them. */
+    struct PeerQueueSource : public AsyncEventSource {
+        PeerQueueSource(ZmqNamedClientBus * bus)
+            : bus(bus), wakeup(EFD_NONBLOCK | EFD_CLOEXEC), signalled(false)
+        {
+        }
+
+        virtual int selectFd() const
+        {
+            return wakeup.fd();
+        }
+
+        virtual bool processOne();
+
+        void signal()
+        {
+            if (!signalled.exchange(true))
+                wakeup.signal();
+        }
+
+        ZmqNamedClientBus * bus;
+        ML::Wakeup_Fd wakeup;
+        std::atomic<bool> signalled;
+    };
+
+    bool peerQueuesEnabled;
+    PeerLimit defaultPeerLimit;
+    std::map<std::string, PeerLimit> peerLimits;
+    std::map<std::string, PeerQueue> peerQueues;
+    mutable std::mutex peerQueuesLock;
+    std::mutex flushLock;
+    std::shared_ptr<PeerQueueSource> peerQueueSource;
+
     struct ClientInfo {
         ClientInfo()
             : lastHeartbeat(Date::now())
@@ -876,10 +1065,27 @@ struct ZmqNamedProxy: public MessageLoop {
             std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
             socket_.reset();
         }
+        if (threadSockets)
+            threadSockets->shutdown();
     }
 
     bool isConnected() const { return connectionState == CONNECTED; }
 
+    /** Send the messages from each thread on a socket of its own connected
+        to the same endpoint, so that threads don't wait on each other or on
+        the thread receiving.  The proxy's socket is then only used to
+        receive.
+
+        With an identity, each socket has the identity followed by
+        ZmqNamedClientBus::ThreadIdentitySeparator and a number, so that a
+        ZmqNamedClientBus takes its messages as the proxy's and answers on
+        the proxy's socket.  Other services see a different sender per
+        thread, so this is only for messages that they don't answer.
+
+        Must be called after init() and before connecting.
+    */
+    void enableSocketPerThread();
+
     /** Type of callback for a new connection. */
     typedef std::function<void (std::string)> ConnectionHandler;
 
@@ -956,6 +1162,21 @@ struct ZmqNamedProxy: public MessageLoop {
     template<typename... Args>
     void sendMessage(Args&&... args)
     {
+        if (threadSockets) {
+            ExcCheckNotEqual(connectionState, NOT_CONNECTED,
+                    "sending on an unconnected socket: " + endpointName);
+
+            if (connectionState == CONNECTION_PENDING) {
+                LOG(ZmqLogs::error)
+                    << "dropping message for " << endpointName << std::endl;
+                return;
+            }
+
+            Datacratic::sendMessage((*threadSockets)(),
+                                    std::forward<Args>(args)...);
+            return;
+        }
+
         std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
 
         ExcCheckNotEqual(connectionState, NOT_CONNECTED,
@@ -996,9 +1217,14 @@ protected:
     std::shared_ptr<ConfigurationService> config;
     std::shared_ptr<zmq::context_t> context_;
     std::shared_ptr<zmq::socket_t> socket_;
+    int socketType;
+    std::string identity;
 
     mutable ZmqEventSource::SocketLock socketLock_;
 
+    /// Sockets used to send from each thread, if enabled
+    std::unique_ptr<SocketPerThread> threadSockets;
+
     enum ConnectionType {
         NO_CONNECTION,        ///< No connection type yet
         CONNECT_DIRECT,       ///< Connect directly to a named service
@@ -1143,6 +1369,7 @@ struct ZmqMultipleNamedClientBusProxy: public MessageLoop {
     {
         connected = false;
         inProvidersChanged = false;
+        socketPerThread = false;
     }
 
     ZmqMultipleNamedClientBusProxy(std::shared_ptr<zmq::context_t> context)
@@ -1151,6 +1378,7 @@ struct ZmqMultipleNamedClientBusProxy: public MessageLoop {
     {
         connected = false;
         inProvidersChanged = false;
+        socketPerThread = false;
     }
 
 #undef CHANGES_MAP_INITIALIZER
@@ -1167,6 +1395,16 @@ struct ZmqMultipleNamedClientBusProxy: public MessageLoop {
         this->identity = identity;
     }
 
+    /** Send from each thread on sockets of its own; see
+        ZmqNamedProxy::enableSocketPerThread().  Connections are then looked
+        up under the lock but the messages are sent outside of it.  Must be
+        called before connecting.
+    */
+    void enableSocketPerThread()
+    {
+        socketPerThread = true;
+    }
+
     void shutdown()
     {
         MessageLoop::shutdown();
@@ -1188,6 +1426,12 @@ struct ZmqMultipleNamedClientBusProxy: public MessageLoop {
                 << " to unknown client " << recipient
                 << std::endl;
         }
+        if (socketPerThread) {
+            auto conn = it->second;
+            guard.unlock();
+            conn->sendMessage(topic, std::forward<Args>(args)...);
+            return;
+        }
         it->second->sendMessage(topic, std::forward<Args>(args)...);
     }
 
@@ -1201,6 +1445,12 @@ struct ZmqMultipleNamedClientBusProxy: public MessageLoop {
         for (const auto& conn : connections) {
             if (conn.second->getShardIndex() != shard) continue;
 
+            if (socketPerThread) {
+                auto proxy = conn.second;
+                guard.unlock();
+                proxy->sendMessage(topic, std::forward<Args>(args)...);
+                return true;
+            }
             conn.second->sendMessage(topic, std::forward<Args>(args)...);
             return true;
         }
@@ -1313,6 +1563,9 @@ private:
     /** Identity for our zeromq socket. */
     std::string identity;
 
+    /** Do the connections send from a socket per thread? */
+    bool socketPerThread;
+
     typedef ML::Spinlock Lock;
 
     /** Lock to be used when modifying the list of connections. */
@@ -198,6 +198,57 @@ inline zmq::message_t encodeMessage(char c)
     return ML::format("%c", c);
 }
 
+/** Copies of a message share its content so the frame can be given to any
+    number of sends without copying the payload.
+*/
+inline zmq::message_t encodeMessage(const zmq::message_t & msg)
+{
+    return msg;
+}
+
+inline void freeSharedMessage(void * data, void * hint)
+{
+    delete (std::string *)hint;
+}
+
+/** Create a message that takes over the contents of the string instead of
+    copying them. Copies of the message (such as the ones made by
+    encodeMessage() on each send) all refer to the same buffer which is
+    released once the last of them has been sent.
+*/
+inline zmq::message_t sharedMessage(std::string && str)
+{
+    if (str.empty()) return zmq::message_t();
+
+    std::unique_ptr<std::string> owned(new std::string(std::move(str)));
+    zmq::message_t result((void *)owned->data(), owned->size(),
+                          freeSharedMessage, owned.get());
+    owned.release();
+    return result;
+}
+
+inline void freeSharedPtrMessage(void * data, void * hint)
+{
+    delete (std::shared_ptr<const std::string> *)hint;
+}
+
+/** Create a message that refers to the contents of the shared string without
+    copying them, keeping a reference to it until the message is released.
+    Using the aliasing constructor of shared_ptr, the string can be a member
+    of a shared object such as the request of an auction.
+*/
+inline zmq::message_t sharedMessage(const std::shared_ptr<const std::string> & str)
+{
+    if (!str || str->empty()) return zmq::message_t();
+
+    std::unique_ptr<std::shared_ptr<const std::string> > owned(
+            new std::shared_ptr<const std::string>(str));
+    zmq::message_t result((void *)str->data(), str->size(),
+                          freeSharedPtrMessage, owned.get());
+    owned.release();
+    return result;
+}
+
 inline std::string chomp(const std::string & s)
 {
     const char * start = s.c_str();
@@ -98,7 +98,7 @@ ZookeeperCallbackManager::sendEvent(int type, int state)
         localCallbacks = std::move(callbacks_);
     }
 
-    for( auto it = localCallbacks.begin(); it != callbacks_.end(); ++it)
+    for( auto it = localCallbacks.begin(); it != localCallbacks.end(); ++it)
     {
         //Only invoke if valid
         if(it->second.valid)
@@ -589,6 +589,132 @@ getChildren(const std::string & path_, bool failIfNodeMissing,
     return result;
 }
 
+std::vector<ZookeeperConnection::NodeContents>
+ZookeeperConnection::
+readNodes(const std::vector<std::string> & paths_,
+          ZookeeperCallbackType valueWatcher,
+          ZookeeperCallbackType childrenWatcher,
+          void * watcherData)
+{
+    /* Answers are written by the zookeeper completion thread */
+    struct Batch {
+        std::mutex lock;
+        std::condition_variable cv;
+        size_t pending;
+        std::vector<NodeContents> results;
+        std::vector<int> valueRes, childrenRes;
+    };
+
+    struct Request {
+        Batch * batch;
+        size_t index;
+    };
+
+    auto finish = [] (Batch & batch)
+        {
+            std::unique_lock<std::mutex> guard(batch.lock);
+            if (--batch.pending == 0)
+                batch.cv.notify_all();
+        };
+
+    auto onValue = [] (int rc, const char * value, int valueLen,
+                       const Stat * stat, const void * data)
+        {
+            auto request = reinterpret_cast<const Request *>(data);
+            Batch & batch = *request->batch;
+            {
+                std::unique_lock<std::mutex> guard(batch.lock);
+                batch.valueRes[request->index] = rc;
+                if (rc == ZOK && value)
+                    batch.results[request->index].value.assign(value, valueLen);
+                if (--batch.pending == 0)
+                    batch.cv.notify_all();
+            }
+        };
+
+    auto onChildren = [] (int rc, const String_vector * strings,
+                          const void * data)
+        {
+            auto request = reinterpret_cast<const Request *>(data);
+            Batch & batch = *request->batch;
+            {
+                std::unique_lock<std::mutex> guard(batch.lock);
+                batch.childrenRes[request->index] = rc;
+                if (rc == ZOK && strings) {
+                    auto & children = batch.results[request->index].children;
+                    for (int i = 0;  i < strings->count;  ++i)
+                        children.push_back(strings->data[i]);
+                }
+                if (--batch.pending == 0)
+                    batch.cv.notify_all();
+            }
+        };
+
+    std::vector<std::string> paths;
+    for (auto & path: paths_)
+        paths.push_back(fixPath(path));
+
+    size_t n = paths.size();
+
+    Batch batch;
+    batch.pending = 2 * n;
+    batch.results.resize(n);
+    batch.valueRes.resize(n, ZSYSTEMERROR);
+    batch.childrenRes.resize(n, ZSYSTEMERROR);
+
+    std::vector<Request> requests(n);
+    std::vector<uintptr_t> valueCbs(n), childrenCbs(n);
+
+    for (size_t i = 0;  i < n;  ++i) {
+        requests[i].batch = &batch;
+        requests[i].index = i;
+
+        const char * path = paths[i].c_str();
+
+        valueCbs[i] = callbackMgr_.createCallback(valueWatcher, paths[i],
+                                                  watcherData);
+        int res = zoo_awget(handle, path,
+                            valueWatcher ? zk_callback : nullptr,
+                            reinterpret_cast<void *>(valueCbs[i]),
+                            onValue, &requests[i]);
+        if (res != ZOK)
+            finish(batch);
+
+        childrenCbs[i] = callbackMgr_.createCallback(childrenWatcher,
+                                                     paths[i], watcherData);
+        res = zoo_awget_children(handle, path,
+                                 childrenWatcher ? zk_callback : nullptr,
+                                 reinterpret_cast<void *>(childrenCbs[i]),
+                                 onChildren, &requests[i]);
+        if (res != ZOK)
+            finish(batch);
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(batch.lock);
+        batch.cv.wait(guard, [&] () { return batch.pending == 0; });
+    }
+
+    for (size_t i = 0;  i < n;  ++i) {
+        NodeContents & result = batch.results[i];
+        int valueRes = batch.valueRes[i];
+        int childrenRes = batch.childrenRes[i];
+
+        if (valueRes == ZOK)
+            callbackMgr_.mark(valueCbs[i], true);
+        if (childrenRes == ZOK)
+            callbackMgr_.mark(childrenCbs[i], true);
+
+        // A node that changed in between or an error count as missing; the
+        // caller reads those again the usual way
+        if (valueRes == ZOK && childrenRes == ZOK)
+            result.exists = true;
+        else result = NodeContents();
+    }
+
+    return batch.results;
+}
+
 void
 ZookeeperConnection::
 eventHandlerFn(zhandle_t * handle,
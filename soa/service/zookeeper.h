@@ -183,6 +183,30 @@ struct ZookeeperConnection {
                 ZookeeperCallbackType watcher = 0,
                 void * watcherData = 0);
 
+    /** What readNodes() found at one path. */
+    struct NodeContents {
+        NodeContents()
+            : exists(false)
+        {
+        }
+
+        bool exists;                        ///< False for missing nodes
+        std::string value;
+        std::vector<std::string> children;
+    };
+
+    /** Read the value and the children of each of the given nodes.  The
+        requests are all sent before waiting for any of the answers, so
+        that the whole batch costs about one round trip instead of two per
+        node.  When a watcher is given, it is set on the value and the
+        children of every node that exists.
+    */
+    std::vector<NodeContents>
+    readNodes(const std::vector<std::string> & paths,
+              ZookeeperCallbackType valueWatcher = 0,
+              ZookeeperCallbackType childrenWatcher = 0,
+              void * watcherData = 0);
+
     static void eventHandlerFn(zhandle_t * handle,
                                int event,
                                int state,
@@ -10,6 +10,9 @@
 #include "jml/utils/exc_assert.h"
 #include <boost/algorithm/string.hpp>
 #include <sys/utsname.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 
 using namespace std;
 using namespace ML;
@@ -69,48 +72,193 @@ std::string printChangeType(ConfigurationService::ChangeType change)
 }
     
 
-void
-watcherFn(int type, int state, std::string const & path, void * watcherCtx)
+ConfigurationService::ChangeType
+getChangeType(int type)
 {
-    typedef std::shared_ptr<ConfigurationService::Watch::Data> SharedPtr;
-       std::unique_ptr<SharedPtr> data(reinterpret_cast<SharedPtr *>(watcherCtx));
-//    SharedPtr * data = reinterpret_cast<SharedPtr *>(watcherCtx);
-#if 0
-    cerr << "zookeeper_configuration_service.cc::watcherFn:type = " << printZookeeperEventType(type)
-         << " state = " << printZookeeperState(state)
-         << " path = " << path << " context "
-         << watcherCtx << " data " << data->get() << endl << endl;
-#endif
-
-
-    ConfigurationService::ChangeType change;
     if (type == ZOO_CREATED_EVENT)
-        change = ConfigurationService::CREATED;
+        return ConfigurationService::CREATED;
     if (type == ZOO_DELETED_EVENT)
-        change = ConfigurationService::DELETED;
-    if (type == ZOO_CHANGED_EVENT)
-        change = ConfigurationService::VALUE_CHANGED;
+        return ConfigurationService::DELETED;
     if (type == ZOO_CHILD_EVENT)
-        change = ConfigurationService::NEW_CHILD;
-
-    auto & item = *data;
-    if (item->watchReferences > 0) {
-#if 0
-        cerr << "watcherFn:calling with path " << path << " and change " 
-             << printChangeType(change) << endl;
-#endif
-        item->onChange(path, change);
-    }
+        return ConfigurationService::NEW_CHILD;
+    return ConfigurationService::VALUE_CHANGED;
 }
 
-ZookeeperCallbackType
-getWatcherFn(const ConfigurationService::Watch & watch)
-{
-    if (!watch)
-        return nullptr;
-    return watcherFn;
-}
+/*****************************************************************************/
+/* ZOOKEEPER CONFIGURATION SERVICE CACHE                                     */
+/*****************************************************************************/
+
+/** Nodes read from zookeeper, by full path.  Each cached value or list of
+    children has a watch of ours set on it, which uncaches it and calls the
+    watches that were asked for when the node changes.
+
+    The watches find the cache through its id rather than a pointer, as
+    zookeeper may call them after the service is gone or never at all.
+*/
+
+struct ZookeeperConfigurationService::Cache {
 
+    typedef std::map<Watch::Data *, std::shared_ptr<Watch::Data> > Watches;
+
+    struct Entry {
+        Entry()
+            : valueCached(false), childrenCached(false), generation(0)
+        {
+        }
+
+        bool valueCached;
+        std::string value;
+        bool childrenCached;
+        std::vector<std::string> children;
+        unsigned generation;  ///< Bumped each time the entry is uncached
+        Watches valueWatches;
+        Watches childrenWatches;
+    };
+
+    Cache()
+        : id(0)
+    {
+    }
+
+    ~Cache()
+    {
+        std::unique_lock<std::mutex> guard(registryLock());
+        registry().erase(id);
+    }
+
+    static std::shared_ptr<Cache> create()
+    {
+        static uintptr_t lastId = 0;
+
+        auto result = std::make_shared<Cache>();
+        std::unique_lock<std::mutex> guard(registryLock());
+        result->id = ++lastId;
+        registry()[result->id] = result;
+        return result;
+    }
+
+    void * watcherData() const
+    {
+        return reinterpret_cast<void *>(id);
+    }
+
+    static void valueWatcherFn(int type, int state, std::string const & path,
+                               void * watcherData)
+    {
+        onWatch(type, path, watcherData, false /* children */);
+    }
+
+    static void childrenWatcherFn(int type, int state,
+                                  std::string const & path,
+                                  void * watcherData)
+    {
+        onWatch(type, path, watcherData, true /* children */);
+    }
+
+    static void addWatch(Watches & watches, Watch & watch)
+    {
+        std::unique_ptr<std::shared_ptr<Watch::Data> > data(watch.get());
+        if (data)
+            watches[data->get()] = *data;
+    }
+
+    /** Uncache what was written at the given path, as well as the children
+        of its parents which may have been created with it.
+    */
+    void invalidate(const std::string & path, bool subtree)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+
+        auto uncache = [&] (Entry & entry, bool value)
+            {
+                ++entry.generation;
+                if (value) {
+                    entry.valueCached = false;
+                    entry.value.clear();
+                }
+                entry.childrenCached = false;
+                entry.children.clear();
+            };
+
+        auto it = entries.find(path);
+        if (it != entries.end())
+            uncache(it->second, true);
+
+        if (subtree) {
+            string below = path + "/";
+            for (auto & entry: entries) {
+                if (entry.first.compare(0, below.size(), below) == 0)
+                    uncache(entry.second, true);
+            }
+        }
+
+        for (string::size_type pos = path.rfind('/');
+             pos != string::npos && pos > 0;
+             pos = path.rfind('/', pos - 1)) {
+            it = entries.find(path.substr(0, pos));
+            if (it != entries.end())
+                uncache(it->second, false);
+        }
+    }
+
+    std::mutex lock;
+    std::unordered_map<std::string, Entry> entries;
+    uintptr_t id;
+
+private:
+    static void onWatch(int type, std::string const & path,
+                        void * watcherData, bool children)
+    {
+        std::shared_ptr<Cache> cache;
+        {
+            std::unique_lock<std::mutex> guard(registryLock());
+            auto it = registry().find(reinterpret_cast<uintptr_t>(watcherData));
+            if (it != registry().end())
+                cache = it->second.lock();
+        }
+        if (!cache)
+            return;
+
+        Watches toNotify;
+        {
+            std::unique_lock<std::mutex> guard(cache->lock);
+            auto it = cache->entries.find(path);
+            if (it == cache->entries.end())
+                return;
+
+            Entry & entry = it->second;
+            ++entry.generation;
+            if (children) {
+                entry.childrenCached = false;
+                entry.children.clear();
+                toNotify.swap(entry.childrenWatches);
+            }
+            else {
+                entry.valueCached = false;
+                entry.value.clear();
+                toNotify.swap(entry.valueWatches);
+            }
+        }
+
+        ChangeType change = getChangeType(type);
+        for (auto & item: toNotify) {
+            if (item.second->watchReferences > 0)
+                item.second->onChange(path, change);
+        }
+    }
+
+    static std::mutex & registryLock()
+    {
+        static std::mutex result;
+        return result;
+    }
+
+    static std::unordered_map<uintptr_t, std::weak_ptr<Cache> > & registry()
+    {
+        static std::unordered_map<uintptr_t, std::weak_ptr<Cache> > result;
+        return result;
+    }
+};
 
 
 /*****************************************************************************/
@@ -119,6 +267,7 @@ getWatcherFn(const ConfigurationService::Watch & watch)
 
 ZookeeperConfigurationService::
 ZookeeperConfigurationService()
+    : cache(Cache::create())
 {
 }
 
@@ -127,6 +276,7 @@ ZookeeperConfigurationService(std::string host,
                               std::string prefix,
                               std::string location,
                               int timeout)
+    : cache(Cache::create())
 {
     init(std::move(host), std::move(prefix), std::move(location));
 }
@@ -166,8 +316,42 @@ ZookeeperConfigurationService::
 getJson(const std::string & key, Watch watch)
 {
     ExcAssert(zoo);
-    auto val = zoo->readNode(prefix + key, getWatcherFn(watch),
-                             watch.get());
+
+    string path = ZookeeperConnection::fixPath(prefix + key);
+    string val;
+
+    for (;;) {
+        unsigned generation;
+        {
+            std::unique_lock<std::mutex> guard(cache->lock);
+            Cache::Entry & entry = cache->entries[path];
+            if (entry.valueCached) {
+                if (watch)
+                    Cache::addWatch(entry.valueWatches, watch);
+                val = entry.value;
+                break;
+            }
+            generation = entry.generation;
+        }
+
+        val = zoo->readNode(path, Cache::valueWatcherFn, cache->watcherData());
+
+        std::unique_lock<std::mutex> guard(cache->lock);
+        Cache::Entry & entry = cache->entries[path];
+        if (entry.generation != generation)
+            continue;  // it changed while we were reading it
+
+        // A missing node reads as empty and has no watch set on it, so the
+        // empty values are read again each time
+        if (val != "") {
+            entry.valueCached = true;
+            entry.value = val;
+        }
+        if (watch)
+            Cache::addWatch(entry.valueWatches, watch);
+        break;
+    }
+
     try {
         if (val == "")
             return Json::Value();
@@ -191,6 +375,8 @@ set(const std::string & key,
                          true /* create path */).second)
         zoo->writeNode(prefix + key, boost::trim_copy(value.toString()));
     ExcAssert(zoo);
+
+    cache->invalidate(ZookeeperConnection::fixPath(prefix + key), false);
 }
 
 std::string
@@ -200,12 +386,16 @@ setUnique(const std::string & key,
 {
     //cerr << "setting unique " << key << " to " << value << endl;
     ExcAssert(zoo);
-    return zoo->createNode(prefix + key, boost::trim_copy(value.toString()),
-                           true /* ephemeral */,
-                           false /* sequential */,
-                           true /* mustSucceed */,
-                           true /* create path */)
+    string result
+        = zoo->createNode(prefix + key, boost::trim_copy(value.toString()),
+                          true /* ephemeral */,
+                          false /* sequential */,
+                          true /* mustSucceed */,
+                          true /* create path */)
         .first;
+
+    cache->invalidate(ZookeeperConnection::fixPath(prefix + key), false);
+    return result;
 }
 
 std::vector<std::string>
@@ -214,10 +404,44 @@ getChildren(const std::string & key,
             Watch watch)
 {
     //cerr << "getChildren " << key << " watch " << watch << endl;
-    return zoo->getChildren(prefix + key,
-                            false /* fail if not there */,
-                            getWatcherFn(watch),
-                            watch.get());
+    ExcAssert(zoo);
+
+    string path = ZookeeperConnection::fixPath(prefix + key);
+
+    for (;;) {
+        unsigned generation;
+        {
+            std::unique_lock<std::mutex> guard(cache->lock);
+            Cache::Entry & entry = cache->entries[path];
+            if (entry.childrenCached) {
+                if (watch)
+                    Cache::addWatch(entry.childrenWatches, watch);
+                return entry.children;
+            }
+            generation = entry.generation;
+        }
+
+        vector<string> children
+            = zoo->getChildren(path,
+                               false /* fail if not there */,
+                               Cache::childrenWatcherFn,
+                               cache->watcherData());
+
+        std::unique_lock<std::mutex> guard(cache->lock);
+        Cache::Entry & entry = cache->entries[path];
+        if (entry.generation != generation)
+            continue;  // it changed while we were reading it
+
+        // No children may mean a missing node, whose watch on its creation
+        // doesn't survive a reconnection; those are read again each time
+        if (!children.empty()) {
+            entry.childrenCached = true;
+            entry.children = children;
+        }
+        if (watch)
+            Cache::addWatch(entry.childrenWatches, watch);
+        return children;
+    }
 }
 
 bool
@@ -274,6 +498,57 @@ removePath(const std::string & path)
 {
     ExcAssert(zoo);
     zoo->removePath(prefix + path);
+    cache->invalidate(ZookeeperConnection::fixPath(prefix + path), true);
+}
+
+void
+ZookeeperConfigurationService::
+prefetch(const std::string & path)
+{
+    ExcAssert(zoo);
+
+    vector<string> level = { ZookeeperConnection::fixPath(prefix + path) };
+
+    while (!level.empty()) {
+        vector<unsigned> generations;
+        {
+            std::unique_lock<std::mutex> guard(cache->lock);
+            for (auto & node: level)
+                generations.push_back(cache->entries[node].generation);
+        }
+
+        auto contents = zoo->readNodes(level,
+                                       Cache::valueWatcherFn,
+                                       Cache::childrenWatcherFn,
+                                       cache->watcherData());
+
+        vector<string> nextLevel;
+
+        std::unique_lock<std::mutex> guard(cache->lock);
+        for (unsigned i = 0;  i < level.size();  ++i) {
+            auto & node = contents[i];
+            if (!node.exists)
+                continue;
+
+            // Both watches are set on the nodes that exist, so even their
+            // empty values and children can be cached
+            Cache::Entry & entry = cache->entries[level[i]];
+            if (entry.generation == generations[i]) {
+                entry.valueCached = true;
+                entry.value = node.value;
+                entry.childrenCached = true;
+                entry.children = node.children;
+            }
+
+            for (auto & child: node.children) {
+                if (level[i] == "/")
+                    nextLevel.push_back("/" + child);
+                else nextLevel.push_back(level[i] + "/" + child);
+            }
+        }
+
+        level.swap(nextLevel);
+    }
 }
 
 
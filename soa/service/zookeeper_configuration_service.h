@@ -21,7 +21,13 @@ struct ZookeeperConnection;
 /* ZOOKEEPER CONFIGURATION SERVICE                                           */
 /*****************************************************************************/
 
-/** Configuration service built on top of Zookeeper. */
+/** Configuration service built on top of Zookeeper.
+
+    The values and children that are read are kept in a local cache, which
+    zookeeper keeps fresh through a single watch per node whatever the
+    number of watches asked for on it.  Reads of cached nodes don't leave
+    the process.
+*/
 
 struct ZookeeperConfigurationService
     : public ConfigurationService {
@@ -62,9 +68,18 @@ struct ZookeeperConfigurationService
     /** Recursively remove everything below this path. */
     virtual void removePath(const std::string & path);
 
+    /** Read everything below this path into the cache, a level of the tree
+        at a time.  Done at startup, it saves the discovery of services
+        two round trips per node.
+    */
+    void prefetch(const std::string & path = "");
+
 private:
     std::unique_ptr<ZookeeperConnection> zoo;
     std::string prefix;
+
+    struct Cache;
+    std::shared_ptr<Cache> cache;
 };
 
 
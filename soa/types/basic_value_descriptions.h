@@ -591,7 +591,7 @@ struct DefaultDescription<Date>
     virtual void printJsonTyped(const Date * val,
                                 JsonPrintingContext & context) const
     {
-        context.writeJson(val->printIso8601());//val->secondsSinceEpoch());
+        context.writeString(val->printIso8601());
     }
 
     virtual bool isDefaultTyped(const Date * val) const
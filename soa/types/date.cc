@@ -7,13 +7,17 @@
 #include "date.h"
 #include <cmath>
 #include <limits>
+#include <cstring>
 #include "jml/arch/format.h"
 #include "soa/jsoncpp/json.h"
 #include <cmath>
 #include "ace/Time_Value.h"
 #include "jml/arch/exception.h"
 #include "jml/db/persistent.h"
+#include "jml/arch/tick_counter.h"
+#include "jml/arch/cpuid.h"
 #include <boost/regex.hpp>
+#include <atomic>
 
 #if NODEJS_ENABLED == 1
 #include "soa/js/js_value.h"
@@ -83,8 +87,241 @@ expectFixedWidthInt(ML::Parse_Context & context,
     return result;
 }
 
+/** Day number relative to 1970-01-01 of the given proleptic Gregorian
+    date.  This is Howard Hinnant's days_from_civil algorithm, which
+    works on 400 year eras starting on the 1st of March.
+*/
+long long daysFromCivil(long long year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yoe = year - era * 400;
+    unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/** Inverse of daysFromCivil(). */
+void civilFromDays(long long days, long long & year,
+                   unsigned & month, unsigned & day)
+{
+    days += 719468;
+    long long era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = days - era * 146097;
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = yoe + era * 400 + (month <= 2);
+}
+
+bool isLeapYear(long long year)
+{
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+unsigned daysInMonth(long long year, unsigned month)
+{
+    static const unsigned char days[12]
+        = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return days[month - 1] + (month == 2 && isLeapYear(year));
+}
+
+const char monthNames[12][4] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+const double powersOfTen[10] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+inline char * writeDigits(char * p, unsigned value, int digits)
+{
+    for (int i = digits - 1;  i >= 0;  --i, value /= 10)
+        p[i] = '0' + value % 10;
+    return p + digits;
+}
+
+/** Broken down time of the last whole second printed by this thread.
+    Logs and events are printed in bursts within the same second, so the
+    calendar computation and the digits of the date and time are reused
+    until the second changes.
+*/
+struct PrintedSecond {
+    bool valid;
+    long long second;
+    unsigned month;
+    unsigned yearLength;
+    char year[24];         ///< Year, at least 4 digits
+    char monthDay[6];      ///< "MM-DD"
+    char day[2];           ///< "DD"
+    char time[8];          ///< "HH:MM:SS"
+};
+
+__thread PrintedSecond printedSecond;
+
+const PrintedSecond & breakDownSecond(long long second)
+{
+    PrintedSecond & result = printedSecond;
+    if (result.valid && result.second == second)
+        return result;
+
+    long long days = second / 86400;
+    long long inDay = second % 86400;
+    if (inDay < 0) {
+        inDay += 86400;
+        days -= 1;
+    }
+
+    long long year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    if (year >= 0 && year <= 9999) {
+        writeDigits(result.year, year, 4);
+        result.yearLength = 4;
+    }
+    else result.yearLength = snprintf(result.year, sizeof(result.year),
+                                      "%lld", year);
+
+    writeDigits(result.monthDay, month, 2);
+    result.monthDay[2] = '-';
+    writeDigits(result.monthDay + 3, day, 2);
+    writeDigits(result.day, day, 2);
+
+    writeDigits(result.time, inDay / 3600, 2);
+    result.time[2] = ':';
+    writeDigits(result.time + 3, inDay / 60 % 60, 2);
+    result.time[5] = ':';
+    writeDigits(result.time + 6, inDay % 60, 2);
+
+    result.month = month;
+    result.second = second;
+    result.valid = true;
+    return result;
+}
+
+/** Writes NaD, Inf or -Inf for a value that isn't a printable date,
+    returning 0 for a date.  The limits are those of print(format).
+*/
+size_t printNonDate(char * buffer, double seconds)
+{
+    const char * text;
+    if (std::isnan(seconds))
+        text = "NaD";
+    else if (seconds >= 100000000000)
+        text = "Inf";
+    else if (seconds <= -1000000000000)
+        text = "-Inf";
+    else return 0;
+
+    size_t length = strlen(text);
+    memcpy(buffer, text, length);
+    return length;
+}
+
+/** Splits the date into whole seconds and a fraction rounded to the
+    given number of digits, carrying into the seconds when the fraction
+    rounds up to 1.  Without any digits the seconds are truncated, as
+    strftime() does.
+*/
+void splitSeconds(double seconds, unsigned digits,
+                  long long & whole, unsigned & fraction)
+{
+    if (digits > 9)
+        throw ML::Exception("Date: can't print more than 9 fractional digits");
+
+    double floored = std::floor(seconds);
+    whole = floored;
+    fraction = 0;
+    if (!digits)
+        return;
+
+    fraction = std::nearbyint((seconds - floored) * powersOfTen[digits]);
+    if (fraction >= powersOfTen[digits]) {
+        whole += 1;
+        fraction = 0;
+    }
+}
+
+inline char * writeFraction(char * p, unsigned fraction, unsigned digits)
+{
+    if (!digits)
+        return p;
+    *p++ = '.';
+    return writeDigits(p, fraction, digits);
+}
+
+inline bool matchDigits(const char * p, int digits, unsigned & value)
+{
+    value = 0;
+    for (int i = 0;  i < digits;  ++i) {
+        unsigned d = (unsigned char)p[i] - '0';
+        if (d > 9)
+            return false;
+        value = value * 10 + d;
+    }
+    return true;
 }
 
+/** Parses the canonical form printed by printIso8601() and printClassic(),
+    "YYYY-MM-DD HH:MM:SS" with a 'T' or ' ' separator, optionally followed
+    by up to 9 fractional digits and a 'Z', straight from the characters.
+    The result is computed in the same way as Iso8601Parser does, so that
+    it is bit for bit identical; anything else, such as a time zone
+    offset, is left to the general parsers by returning false.
+*/
+bool matchCanonicalDateTime(const char * p, const char * end,
+                            bool allowFraction, double & result)
+{
+    if (end - p < 19)
+        return false;
+
+    unsigned year, month, day, hour, minute, second;
+    if (!matchDigits(p, 4, year) || p[4] != '-'
+        || !matchDigits(p + 5, 2, month) || p[7] != '-'
+        || !matchDigits(p + 8, 2, day)
+        || (p[10] != 'T' && p[10] != ' ')
+        || !matchDigits(p + 11, 2, hour) || p[13] != ':'
+        || !matchDigits(p + 14, 2, minute) || p[16] != ':'
+        || !matchDigits(p + 17, 2, second))
+        return false;
+
+    if (year < 1400 || month < 1 || month > 12
+        || day < 1 || day > daysInMonth(year, month)
+        || hour > 23 || minute > 59 || second > 59)
+        return false;
+
+    p += 19;
+
+    double fraction = 0.0;
+    if (allowFraction) {
+        if (p != end && *p == '.') {
+            const char * start = ++p;
+            unsigned long long digits = 0;
+            while (p != end && p - start < 10
+                   && (unsigned char)*p - '0' <= 9)
+                digits = digits * 10 + (*p++ - '0');
+            if (p == start || p - start > 9)
+                return false;
+            fraction = double(digits) / pow(10, p - start);
+        }
+        if (p != end && *p == 'Z')
+            ++p;
+    }
+
+    if (p != end)
+        return false;
+
+    double time = 3600.0 * hour + 60.0 * minute + second + fraction;
+    result = 86400.0 * daysFromCivil(year, month, day) + time;
+    return true;
+}
+
+} // file scope
+
 namespace Datacratic {
 
 
@@ -183,6 +420,12 @@ parseDefaultUtc(const std::string & date)
     else if (date == "-Inf")
         return negativeInfinity();
 
+    double seconds;
+    if (date.size() == 19 && date[10] == ' '
+        && matchCanonicalDateTime(date.c_str(), date.c_str() + 19,
+                                  false /* allowFraction */, seconds))
+        return fromSecondsSinceEpoch(seconds);
+
     return parse_date_time(date, "%y-%M-%d", "%H:%M:%S");
 }
 
@@ -205,6 +448,12 @@ Date
 Date::
 parseIso8601DateTime(const std::string & dateTimeStr)
 {
+    double seconds;
+    if (matchCanonicalDateTime(dateTimeStr.c_str(),
+                               dateTimeStr.c_str() + dateTimeStr.size(),
+                               true /* allowFraction */, seconds))
+        return fromSecondsSinceEpoch(seconds);
+
     if (dateTimeStr == "NaD" || dateTimeStr == "NaN")
         return notADate();
     else if (dateTimeStr == "Inf")
@@ -215,6 +464,17 @@ parseIso8601DateTime(const std::string & dateTimeStr)
         return Iso8601Parser::parseDateTimeString(dateTimeStr);
 }
 
+Date
+Date::
+parseIso8601DateTime(const char * start, const char * end)
+{
+    double seconds;
+    if (matchCanonicalDateTime(start, end, true /* allowFraction */, seconds))
+        return fromSecondsSinceEpoch(seconds);
+
+    return parseIso8601DateTime(std::string(start, end));
+}
+
 Date
 Date::
 notADate()
@@ -253,6 +513,163 @@ now()
     return fromSecondsSinceEpoch(time.tv_sec + time.tv_nsec * 0.000000001);
 }
 
+namespace {
+
+/*****************************************************************************/
+/* TICK CLOCK                                                                */
+/*****************************************************************************/
+
+/** Wall clock read from the tick counter, which costs a couple dozen cycles
+    where clock_gettime() costs a few times that even through the vDSO.
+
+    The time is extrapolated from an anchor, a tick count and a wall time
+    taken together, at a rate measured since the first anchor.  The anchor
+    is taken again every AnchorInterval seconds so that the clock follows
+    the adjustments made to the system clock; it can step back by the error
+    accumulated since the previous anchor when that happens, which is well
+    under a microsecond once the rate has been measured over a few seconds.
+
+    The anchor is published under a sequence lock so that reading the clock
+    never waits.  Only usable when the counter ticks at the same constant
+    rate on every core.
+*/
+struct TickClock {
+
+    static constexpr double AnchorInterval = 1.0;
+
+    TickClock()
+        : sequence(0), anchoring(false)
+    {
+#if defined(JML_INTEL_ISA)
+        available = ML::invariant_tsc() && ML::seconds_per_tick > 0.0;
+#else
+        available = false;
+#endif
+        if (!available) return;
+
+        firstTicks = anchor(firstSeconds);
+        anchorTicks = firstTicks;
+        anchorSeconds = firstSeconds;
+        secondsPerTick = ML::seconds_per_tick;
+        intervalTicks = AnchorInterval / ML::seconds_per_tick;
+    }
+
+    double now()
+    {
+        for (;;) {
+            uint64_t seq = sequence.load(std::memory_order_acquire);
+            uint64_t ticks = anchorTicks.load(std::memory_order_relaxed);
+            double seconds = anchorSeconds.load(std::memory_order_relaxed);
+            double rate = secondsPerTick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if ((seq & 1) || sequence.load(std::memory_order_relaxed) != seq)
+                continue;
+
+            // Signed since another core can be a few ticks behind.
+            int64_t elapsed = ML::ticks() - ticks;
+            if (elapsed > intervalTicks && reanchor())
+                continue;
+
+            return seconds + elapsed * rate;
+        }
+    }
+
+    bool available;
+
+private:
+    /** Reads the system clock along with the tick count at the middle of
+        the call, retrying when we were preempted in the middle of it.
+    */
+    static uint64_t anchor(double & seconds)
+    {
+        uint64_t before, after;
+        timespec time;
+
+        for (int i = 0;  ;  ++i) {
+            before = ML::ticks();
+            clock_gettime(CLOCK_REALTIME, &time);
+            after = ML::ticks();
+            if (i == 10 || (after - before) * ML::seconds_per_tick < 1e-6)
+                break;
+        }
+
+        seconds = time.tv_sec + time.tv_nsec * 0.000000001;
+        return before + (after - before) / 2;
+    }
+
+    /** Takes a new anchor unless another thread is already at it. */
+    bool reanchor()
+    {
+        if (anchoring.exchange(true, std::memory_order_acquire))
+            return false;
+
+        double seconds;
+        uint64_t ticks = anchor(seconds);
+
+        double rate = (seconds - firstSeconds) / (ticks - firstTicks);
+        double oldRate = secondsPerTick.load(std::memory_order_relaxed);
+
+        // The system clock was set rather than slewed: measure from here.
+        if (std::abs(rate / oldRate - 1.0) > 0.001) {
+            firstTicks = ticks;
+            firstSeconds = seconds;
+            rate = oldRate;
+        }
+
+        uint64_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        anchorTicks.store(ticks, std::memory_order_relaxed);
+        anchorSeconds.store(seconds, std::memory_order_relaxed);
+        secondsPerTick.store(rate, std::memory_order_relaxed);
+        sequence.store(seq + 2, std::memory_order_release);
+
+        anchoring.store(false, std::memory_order_release);
+        return true;
+    }
+
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> anchorTicks;
+    std::atomic<double> anchorSeconds;
+    std::atomic<double> secondsPerTick;
+    int64_t intervalTicks;
+
+    // Only touched by the thread that holds anchoring
+    std::atomic<bool> anchoring;
+    uint64_t firstTicks;
+    double firstSeconds;
+};
+
+TickClock & tickClock()
+{
+    static TickClock clock;
+    return clock;
+}
+
+} // file scope
+
+Date
+Date::
+nowFast()
+{
+    TickClock & clock = tickClock();
+    if (JML_UNLIKELY(!clock.available))
+        return now();
+    return fromSecondsSinceEpoch(clock.now());
+}
+
+Date
+Date::
+nowCoarse()
+{
+    timespec time;
+    int res = clock_gettime(CLOCK_REALTIME_COARSE, &time);
+    if (res == -1)
+        throw ML::Exception(errno, "clock_gettime");
+    return fromSecondsSinceEpoch(time.tv_sec + time.tv_nsec * 0.000000001);
+}
+
 Date
 Date::
 nowOld()
@@ -284,8 +701,12 @@ print(unsigned seconds_digits) const
         else return "-Inf";
     }
 
+    if (seconds_digits <= 9) {
+        char buffer[MaxPrintLength];
+        return string(buffer, print(buffer, seconds_digits));
+    }
+
     string result = print("%Y-%b-%d %H:%M:%S");
-    if (seconds_digits == 0) return result;
 
     double partial_seconds = fractionalSeconds();
     string fractional = format("%0.*f", seconds_digits, partial_seconds);
@@ -294,6 +715,33 @@ print(unsigned seconds_digits) const
     return result;
 }
 
+size_t
+Date::
+print(char * buffer, unsigned seconds_digits) const
+{
+    if (size_t length = printNonDate(buffer, secondsSinceEpoch_))
+        return length;
+
+    long long whole;
+    unsigned fraction;
+    splitSeconds(secondsSinceEpoch_, seconds_digits, whole, fraction);
+    const PrintedSecond & second = breakDownSecond(whole);
+
+    char * p = buffer;
+    memcpy(p, second.year, second.yearLength);
+    p += second.yearLength;
+    *p++ = '-';
+    memcpy(p, monthNames[second.month - 1], 3);
+    p += 3;
+    *p++ = '-';
+    memcpy(p, second.day, 2);
+    p += 2;
+    *p++ = ' ';
+    memcpy(p, second.time, 8);
+    p = writeFraction(p + 8, fraction, seconds_digits);
+    return p - buffer;
+}
+
 std::string
 Date::
 printRfc2616() const
@@ -325,6 +773,11 @@ printIso8601(unsigned int fraction) const
         else return "-Inf";
     }
 
+    if (fraction <= 9) {
+        char buffer[MaxPrintLength];
+        return string(buffer, printIso8601(buffer, fraction));
+    }
+
     string result = print("%Y-%m-%dT%H:%M:%S");
 
     if (result == "Inf" || result == "-Inf" || result == "NaD")
@@ -338,6 +791,31 @@ printIso8601(unsigned int fraction) const
     return result;
 }
 
+size_t
+Date::
+printIso8601(char * buffer, unsigned int fraction) const
+{
+    if (size_t length = printNonDate(buffer, secondsSinceEpoch_))
+        return length;
+
+    long long whole;
+    unsigned digits;
+    splitSeconds(secondsSinceEpoch_, fraction, whole, digits);
+    const PrintedSecond & second = breakDownSecond(whole);
+
+    char * p = buffer;
+    memcpy(p, second.year, second.yearLength);
+    p += second.yearLength;
+    *p++ = '-';
+    memcpy(p, second.monthDay, 5);
+    p += 5;
+    *p++ = 'T';
+    memcpy(p, second.time, 8);
+    p = writeFraction(p + 8, digits, fraction);
+    *p++ = 'Z';
+    return p - buffer;
+}
+
 std::string
 Date::
 printClassic() const
@@ -352,7 +830,29 @@ printClassic() const
         else return "-Inf";
     }
 
-    return print("%Y-%m-%d %H:%M:%S");
+    char buffer[MaxPrintLength];
+    return string(buffer, printClassic(buffer));
+}
+
+size_t
+Date::
+printClassic(char * buffer) const
+{
+    if (size_t length = printNonDate(buffer, secondsSinceEpoch_))
+        return length;
+
+    const PrintedSecond & second
+        = breakDownSecond(std::floor(secondsSinceEpoch_));
+
+    char * p = buffer;
+    memcpy(p, second.year, second.yearLength);
+    p += second.yearLength;
+    *p++ = '-';
+    memcpy(p, second.monthDay, 5);
+    p += 5;
+    *p++ = ' ';
+    memcpy(p, second.time, 8);
+    return p + 8 - buffer;
 }
 
 Date
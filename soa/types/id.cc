@@ -6,12 +6,19 @@
 
 #include <boost/algorithm/string.hpp>
 #include "id.h"
+#include "jml/arch/arch.h"
 #include "jml/arch/bit_range_ops.h"
 #include "jml/arch/format.h"
 #include "jml/arch/exception.h"
 #include "jml/db/persistent.h"
 #include "jml/utils/exc_assert.h"
 #include "soa/jsoncpp/value.h"
+#include <atomic>
+#include <cstddef>
+
+#if JML_INTEL_ISA
+#  include <emmintrin.h>
+#endif
 
 using namespace ML;
 using namespace std;
@@ -69,6 +76,297 @@ JML_ALWAYS_INLINE int base64ToDec(unsigned c)
     return base64ToDecLookups[c & 0x7f] * mask - 1 + mask;
 }
 
+/** Decodes a decimal number, modulo 2^128 for the longest ones.  Each run
+    of up to 19 digits is accumulated in 64 bits, so that only one 128 bit
+    multiplication is needed per run instead of one per digit.
+*/
+static bool decodeDecimal(const char * p, size_t len, __uint128_t & val)
+{
+    static const uint64_t powersOf10[20] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+        10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+        100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+        100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+        100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL
+    };
+
+    auto decodeRun = [&] (size_t start, size_t n, uint64_t & run) -> bool
+        {
+            run = 0;
+            for (size_t j = start;  j < start + n;  ++j) {
+                unsigned digit = p[j] - '0';
+                if (digit > 9)
+                    return false;
+                run = 10 * run + digit;
+            }
+            return true;
+        };
+
+    uint64_t run;
+    if (len <= max64_base10_len) {
+        if (!decodeRun(0, len, run))
+            return false;
+        val = run;
+        return true;
+    }
+
+    __uint128_t res = 0;
+    for (size_t i = 0;  i < len;) {
+        size_t n = std::min(len - i, max64_base10_len);
+        if (!decodeRun(i, n, run))
+            return false;
+        res = res * powersOf10[n] + run;
+        i += n;
+    }
+
+    val = res;
+    return true;
+}
+
+/* The fixed length formats are validated and decoded 16 characters at a
+   time.  With SSE2, each character is classified by range comparisons and
+   turned into its value by subtracting the offset of its range; the values
+   are then packed together with shifts.  Other architectures use the
+   lookup tables above.
+*/
+
+enum {
+    LOWER_CASE = 1,
+    UPPER_CASE = 2
+};
+
+#if JML_INTEL_ISA
+
+/** Mask of the bytes of x that are between lo and hi inclusive.  Bytes over
+    0x7f are negative and so are never in a range of ASCII characters.
+*/
+JML_ALWAYS_INLINE __m128i inRange(__m128i x, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(x, _mm_set1_epi8(hi + 1)));
+}
+
+/** Values of 16 hex digits, in the low nibble of each byte.  Adds to the
+    case flags the case of the letters; sets valid to false if one of them
+    isn't a hex digit.
+*/
+JML_ALWAYS_INLINE __m128i
+hexValues(const char * p, bool & valid, int & letters)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+    __m128i lc = _mm_or_si128(x, _mm_set1_epi8(0x20));
+
+    __m128i digit = inRange(x, '0', '9');
+    __m128i letter = inRange(lc, 'a', 'f');
+    int letterMask = _mm_movemask_epi8(letter);
+    int lowerMask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, lc)) & letterMask;
+
+    valid = valid
+        && _mm_movemask_epi8(_mm_or_si128(digit, letter)) == 0xffff;
+    letters |= (lowerMask ? LOWER_CASE : 0)
+        | (letterMask & ~lowerMask ? UPPER_CASE : 0);
+
+    return _mm_or_si128
+        (_mm_and_si128(digit, _mm_sub_epi8(x, _mm_set1_epi8('0'))),
+         _mm_and_si128(letter, _mm_sub_epi8(lc, _mm_set1_epi8('a' - 10))));
+}
+
+/** Packs the 16 nibbles into the low bytes of the 16 bit words. */
+JML_ALWAYS_INLINE __m128i packNibbles(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)),
+                                       4),
+                        _mm_srli_epi16(v, 8));
+}
+
+/** Decodes 32 hex digits into two big endian words.  Returns the case of
+    the letters that were seen, or -1 if one of the characters isn't a hex
+    digit.
+*/
+static int decodeHex32(const char * p, uint64_t & high, uint64_t & low)
+{
+    bool valid = true;
+    int letters = 0;
+    __m128i v0 = hexValues(p, valid, letters);
+    __m128i v1 = hexValues(p + 16, valid, letters);
+    if (!valid)
+        return -1;
+
+    __m128i packed = _mm_packus_epi16(packNibbles(v0), packNibbles(v1));
+    high = __builtin_bswap64(_mm_cvtsi128_si64(packed));
+    low = __builtin_bswap64(_mm_cvtsi128_si64(_mm_unpackhi_epi64(packed,
+                                                                 packed)));
+    return letters;
+}
+
+/** Decodes the 16 characters of a BASE64_96 Id. */
+static bool decodeBase64_96(const char * p, __uint128_t & val)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+
+    // '/' comes just before '0' and so shares its offset
+    __m128i plus = _mm_cmpeq_epi8(x, _mm_set1_epi8('+'));
+    __m128i digit = inRange(x, '/', '9');
+    __m128i upper = inRange(x, 'A', 'Z');
+    __m128i lower = inRange(x, 'a', 'z');
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(plus, digit),
+                                 _mm_or_si128(upper, lower));
+    if (_mm_movemask_epi8(valid) != 0xffff)
+        return false;
+
+    __m128i offset = _mm_or_si128
+        (_mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8('+')),
+                      _mm_and_si128(digit, _mm_set1_epi8('/' - 1))),
+         _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8('A' - 12)),
+                      _mm_and_si128(lower, _mm_set1_epi8('a' - 38))));
+    __m128i v = _mm_sub_epi8(x, offset);
+
+    // Pairs of 6 bit values into 12 bits, then pairs of those into 24
+    __m128i v12 = _mm_or_si128
+        (_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), 6),
+         _mm_srli_epi16(v, 8));
+    __m128i v24 = _mm_madd_epi16(v12, _mm_set1_epi32(0x00011000));
+
+    uint32_t words[4];
+    _mm_storeu_si128((__m128i *)words, v24);
+
+    uint64_t high = (uint64_t)words[0] << 24 | words[1];
+    uint64_t low = (uint64_t)words[2] << 24 | words[3];
+    val = (__uint128_t)high << 48 | low;
+    return true;
+}
+
+/** Values of 16 characters of the base64 alphabet of the google ids. */
+JML_ALWAYS_INLINE __m128i googValues(const char * p, bool & valid)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+
+    __m128i digit = inRange(x, '0', '9');
+    __m128i upper = inRange(x, 'A', 'Z');
+    __m128i lower = inRange(x, 'a', 'z');
+    __m128i dash = _mm_cmpeq_epi8(x, _mm_set1_epi8('-'));
+    __m128i underscore = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+
+    __m128i all = _mm_or_si128(_mm_or_si128(digit, upper),
+                               _mm_or_si128(_mm_or_si128(lower, dash),
+                                            underscore));
+    valid = valid && _mm_movemask_epi8(all) == 0xffff;
+
+    __m128i offset = _mm_or_si128
+        (_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8('0')),
+                      _mm_and_si128(upper, _mm_set1_epi8('A' - 10))),
+         _mm_or_si128(_mm_or_si128(_mm_and_si128(lower,
+                                                 _mm_set1_epi8('a' - 36)),
+                                   _mm_and_si128(dash,
+                                                 _mm_set1_epi8('-' - 62))),
+                      _mm_and_si128(underscore, _mm_set1_epi8('_' - 63))));
+    return _mm_sub_epi8(x, offset);
+}
+
+/** Decodes the 21 characters that follow the CAESE of a google id. */
+static bool decodeGoog128(const char * p, __uint128_t & val)
+{
+    // The second load overlaps the first to end on the last character
+    bool valid = true;
+    unsigned char values[32];
+    _mm_storeu_si128((__m128i *)values, googValues(p, valid));
+    _mm_storeu_si128((__m128i *)(values + 16), googValues(p + 5, valid));
+    if (!valid)
+        return false;
+
+    __uint128_t res = 0;
+    for (unsigned i = 0;  i < 16;  ++i)
+        res = (res << 6) | values[i];
+    for (unsigned i = 27;  i < 32;  ++i)
+        res = (res << 6) | values[i];
+    val = res;
+    return true;
+}
+
+#else // JML_INTEL_ISA
+
+static int decodeHex32(const char * p, uint64_t & high, uint64_t & low)
+{
+    int letters = 0;
+
+    auto scanRange = [&] (const char * q) -> uint64_t
+        {
+            uint64_t val = 0;
+            for (unsigned i = 0;  i < 16;  ++i) {
+                int c = q[i];
+                int v = hexToDec(c);
+                if (v == -1) {
+                    letters = -1;
+                    return val;
+                }
+                if (v >= 10)
+                    letters |= (c >= 'a' ? LOWER_CASE : UPPER_CASE);
+                val = (val << 4) + v;
+            }
+            return val;
+        };
+
+    high = scanRange(p);
+    if (letters == -1)
+        return -1;
+    low = scanRange(p + 16);
+    return letters;
+}
+
+static bool decodeBase64_96(const char * p, __uint128_t & val)
+{
+    auto scanRange = [&] (const char * q) -> int64_t
+        {
+            uint64_t res = 0;
+            for (unsigned i = 0;  i < 8;  ++i) {
+                int c = base64ToDec(q[i]);
+                if (c == -1) return -1;
+                res = res << 6 | c;
+            }
+            return res;
+        };
+
+    int64_t high = scanRange(p);
+    int64_t low  = scanRange(p + 8);
+    if (high == -1 || low == -1)
+        return false;
+
+    val = (__uint128_t)high << 48 | low;
+    return true;
+}
+
+static bool decodeGoog128(const char * p, __uint128_t & val)
+{
+    auto b64Decode = [] (int c) -> int
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            else if (c >= 'A' && c <= 'Z')
+                return 10 + c - 'A';
+            else if (c >= 'a' && c <= 'z')
+                return 36 + c - 'a';
+            else if (c == '-')
+                return 62;
+            else if (c == '_')
+                return 63;
+            else return -1;
+        };
+
+    __uint128_t res = 0;
+    for (unsigned i = 0;  i < 21;  ++i) {
+        int v = b64Decode(p[i]);
+        if (v == -1)
+            return false;
+        res = (res << 6) | v;
+    }
+    val = res;
+    return true;
+}
+
+#endif // JML_INTEL_ISA
+
 inline int hexToDec3(int c)
 {
     int d = c & 0x1f;
@@ -121,7 +419,7 @@ parse(const char * value, size_t len, Type type)
     }
 
     if ((type == UNKNOWN || type == NULLID) && len == 4
-        && strcmp(value, "null") == 0) {
+        && memcmp(value, "null", 4) == 0) {
         //throw ML::Exception("null id");
         r.type = NULLID;
         r.val1 = r.val2 = 0;
@@ -136,105 +434,43 @@ parse(const char * value, size_t len, Type type)
         return;
     }
 
-    while ((type == UNKNOWN || type == UUID || type == UUID_CAPS) && len == 36) {
-        // not really a while...
+    if ((type == UNKNOWN || type == UUID || type == UUID_CAPS) && len == 36
+        && value[8] == '-' && value[13] == '-' && value[18] == '-'
+        && value[23] == '-') {
         // Try a uuid
         // AGID: --> 0828398c-5965-11e0-84c8-0026b937c8e1
 
-        if (value[8] != '-') break;
-        if (value[13] != '-') break;
-        if (value[18] != '-') break;
-        if (value[23] != '-') break;
-
-        unsigned f1;
-        short f2, f3, f4;
-        unsigned long long f5;
+        // Gather the digits from between the dashes
+        char digits[32];
+        memcpy(digits, value, 8);
+        memcpy(digits + 8, value + 9, 4);
+        memcpy(digits + 12, value + 14, 4);
+        memcpy(digits + 16, value + 19, 4);
+        memcpy(digits + 20, value + 24, 12);
 
-        const char * p = value;
-        bool failed = false;
-        int capsType = -1; // -1 = unknown, 0 = no, 1 = yes
-
-        auto scanRange = [&] (int start, int len) -> unsigned long long
-            {
-                unsigned long long val = 0;
-                for (unsigned i = start;  i != start + len;  ++i) {
-                    int c = p[i];
-                    {
-                        // case handling
-                        if (c >= 'a' && c <= 'f') {
-                            if (capsType == -1) {
-                                capsType = 0;
-                            }
-                            else if (capsType != 0) {
-                                failed = true;
-                                return val;
-                            }
-                        }
-                        else if (c >= 'A' && c <= 'F') {
-                            if (capsType == -1) {
-                                capsType = 1;
-                            }
-                            else if (capsType != 1) {
-                                failed = true;
-                                return val;
-                            }
-                        }
-                    }
-                    int v = hexToDec(c);
-                    if (v == -1) {
-                        failed = true;
-                        return val;
-                    }
-                    val = (val << 4) + v;
-                }
-                return val;
-            };
-
-        f1 = scanRange(0, 8);
-        f2 = scanRange(9, 4);
-        f3 = scanRange(14, 4);
-        if (failed) break;
-        f4 = scanRange(19, 4);
-        f5 = scanRange(24, 12);
-        if (failed) break;
-
-        r.type = capsType == 1 ? UUID_CAPS : UUID;
-        r.f1 = f1;  r.f2 = f2;  r.f3 = f3;  r.f4 = f4;  r.f5 = f5;
-        finish();
-        return;
+        uint64_t high, low;
+        int letters = decodeHex32(digits, high, low);
+
+        // Mixed case isn't a uuid
+        if (letters != -1 && letters != (LOWER_CASE | UPPER_CASE)) {
+            r.type = letters == UPPER_CASE ? UUID_CAPS : UUID;
+            r.f1 = high >> 32;
+            r.f2 = (high >> 16) & 0xffff;
+            r.f3 = high & 0xffff;
+            r.f4 = low >> 48;
+            r.f5 = low & 0xffffffffffffULL;
+            finish();
+            return;
+        }
     }
 
     if ((type == UNKNOWN || type == GOOG128)
-        && len == 26 && value[0] == 'C' && value[1] == 'A'
-        && value[2] == 'E' && value[3] == 'S' && value[4] == 'E') {
+        && len == 26 && memcmp(value, "CAESE", 5) == 0) {
 
         // Google ID: --> CAESEAYra3NIxLT9C8twKrzqaA
 
-        __uint128_t res = 0;
-
-        auto b64Decode = [] (int c) -> int
-            {
-                if (c >= '0' && c <= '9')
-                    return c - '0';
-                else if (c >= 'A' && c <= 'Z')
-                    return 10 + c - 'A';
-                else if (c >= 'a' && c <= 'z')
-                    return 36 + c - 'a';
-                else if (c == '-')
-                    return 62;
-                else if (c == '_')
-                    return 63;
-                else return -1;
-            };
-
-        bool error = false;
-        for (unsigned i = 5;  i < 26 && !error;  ++i) {
-            int v = b64Decode(value[i]);
-            if (v == -1) error = true;
-            res = (res << 6) | v;
-        }
-
-        if (!error) {
+        __uint128_t res;
+        if (decodeGoog128(value + 5, res)) {
             r.type = GOOG128;
             r.val = res;
             finish();
@@ -246,66 +482,20 @@ parse(const char * value, size_t len, Type type)
         && value[0] != '0' && len < 40 /* TODO: better condition */) {
         // Try a big integer
         //ANID: --> 7394206091425759590
-        uint64_t res64(0);
-        bool error = false;
-
-        int maxLowLen = min(len, max64_base10_len);
-        for (unsigned i = 0; i < maxLowLen; ++i) {
-            if (!isdigit(value[i])) {
-                error = true;
-                break;
-            }
-            res64 = 10 * res64 + value[i] - '0';
-        }
-
-        if (!error) {
-            if (len <= max64_base10_len) {
-                r.type = BIGDEC;
-                r.val1 = res64;
-                finish();
-                return;
-            }
-            else {
-                __uint128_t res128 = res64;
-                for (unsigned i = maxLowLen; i < len; ++i) {
-                    if (!isdigit(value[i])) {
-                        error = true;
-                        break;
-                    }
-                    res128 = res128 * 10 + value[i] - '0';
-                }
-                if (!error) {
-                    r.type = BIGDEC;
-                    r.val = res128;
-                    finish();
-                    return;
-                }
-            }
+        __uint128_t res;
+        if (decodeDecimal(value, len, res)) {
+            r.type = BIGDEC;
+            r.val = res;
+            finish();
+            return;
         }
     }
 
     if ((type == UNKNOWN || type == BASE64_96) && len == 16) {
-        auto scanRange = [&] (const char * p, size_t l) -> int64_t
-            {
-                uint64_t res = 0;
-                for (unsigned i = 0;  i < l;  ++i) {
-                    int c = base64ToDec(p[i]);
-                    if (c == -1) return -1;
-                    res = res << 6 | c;
-                }
-                return res;
-            };
-        
-        int64_t high = scanRange(value, 8);
-        int64_t low  = scanRange(value + 8, 8);
-
-        if (low != -1 && high != -1) {
-            __int128_t val = high;
-            val <<= 48;
-            val |= low;
-            
+        __uint128_t res;
+        if (decodeBase64_96(value, res)) {
             r.type = BASE64_96;
-            r.val = val;
+            r.val = res;
             finish();
             return;
         }
@@ -314,60 +504,90 @@ parse(const char * value, size_t len, Type type)
     //cerr << "len = " << len
     //     << " value = " << value << " type = " << (int)type << endl;
 
-    while ((type == UNKNOWN || type == HEX128LC) && len == 32) {
+    if ((type == UNKNOWN || type == HEX128LC) && len == 32) {
         uint64_t high, low;
+        if (decodeHex32(value, high, low) != -1) {
+            r.type = HEX128LC;
+            r.val1 = high;
+            r.val2 = low;
+            finish();
+            return;
+        }
+    }
 
-        const char * p = value;
-        bool failed = false;
+    // Fall back to string
+    r.initString(value, len);
+    finish();
+    return;
+}
 
-        auto scanRange = [&] (int start, int len) -> unsigned long long
-            {
-                uint64_t val = 0;
-                for (unsigned i = start;  i != start + len;  ++i) {
-                    int c = p[i];
-                    int v = hexToDec(c);
-
-                    //cerr << "c = " << c << " " << p[i] << " v = " << v << endl;
-
-                    if (v == -1) {
-                        failed = true;
-                        return val;
-                    }
-                    val = (val << 4) + v;
-                }
+struct Id::SharedString {
+    std::atomic<int> refs;
+    char data[1];
+
+    static const char * create(const char * value, size_t len)
+    {
+        void * mem = ::operator new(offsetof(SharedString, data) + len);
+        SharedString * result = new (mem) SharedString();
+        result->refs = 1;
+        std::copy(value, value + len, result->data);
+        return result->data;
+    }
 
-                //cerr << "val = " << val << " failed = " << failed << endl;
+    static SharedString * of(const char * str)
+    {
+        return (SharedString *)(str - offsetof(SharedString, data));
+    }
 
-                return val;
-            };
+    static void release(const char * str)
+    {
+        SharedString * shared = of(str);
+        if (shared->refs.fetch_sub(1) == 1) {
+            shared->~SharedString();
+            ::operator delete(shared);
+        }
+    }
+};
 
-        high = scanRange(0, 16);
-        if (failed)
-            break;
-        low = scanRange(16, 16);
-        if (failed)
-            break;
+struct Id::SharedCompound {
+    SharedCompound(const Id & first, const Id & second)
+        : refs(1), first(first), second(second)
+    {
+    }
 
-        r.type = HEX128LC;
-        r.val1 = high;
-        r.val2 = low;
-        finish();
-        return;
+    std::atomic<int> refs;
+    Id first;
+    Id second;
+
+    static void release(SharedCompound * compound)
+    {
+        if (compound->refs.fetch_sub(1) == 1)
+            delete compound;
     }
+};
 
-    // Fall back to string
-    r.type = STR;
-    r.len = len;
-    char * s = new char[r.len];
-    r.str = s;
-    r.ownstr = true;
-#if 0
-    memcpy(s, value, len);
-#else
-    std::copy(value, value + len, s);
-#endif
-    finish();
-    return;
+Id::
+Id(const Id & underlying1, const Id & underlying2)
+    : type(COMPOUND2), shortLen(0),
+      cmp(new SharedCompound(underlying1, underlying2))
+{
+}
+
+void
+Id::
+initString(const char * value, size_t len)
+{
+    type = STR;
+    if (len <= MaxShortLength) {
+        shortLen = len + 1;
+        std::copy(value, value + len, shortStr);
+    }
+    else {
+        shortLen = 0;
+        this->len = len;
+        ownstr = true;
+        str = SharedString::create(value, len);
+    }
 }
 
 const Id &
@@ -375,7 +595,7 @@ Id::
 compoundId1() const
 {
     ExcAssertEqual(type, COMPOUND2);
-    return *cmp1;
+    return cmp->first;
 }
 
 const Id &
@@ -383,7 +603,7 @@ Id::
 compoundId2() const
 {
     ExcAssertEqual(type, COMPOUND2);
-    return *cmp2;
+    return cmp->second;
 }
     
     
@@ -479,7 +699,7 @@ toString() const
     case COMPOUND2:
         return compoundId1().toString() + ":" + compoundId2().toString();
     case STR:
-        return std::string(str, str + len);
+        return std::string(strData(), strLength());
     default:
         throw ML::Exception("unknown ID type");
     }
@@ -489,8 +709,14 @@ bool
 Id::
 complexEqual(const Id & other) const
 {
-    if (type == STR)
-        return len == other.len && (str == other.str || std::equal(str, str + len, other.str));
+    if (type == STR) {
+        size_t length = strLength();
+        const char * data = strData();
+        const char * otherData = other.strData();
+        return length == other.strLength()
+            && (data == otherData
+                || std::equal(data, data + length, otherData));
+    }
     else if (type == COMPOUND2) {
         return compoundId1() == other.compoundId1()
             && compoundId2() == other.compoundId2();
@@ -503,8 +729,9 @@ Id::
 complexLess(const Id & other) const
 {
     if (type == STR)
-        return std::lexicographical_compare(str, str + len,
-                                            other.str, other.str + other.len);
+        return std::lexicographical_compare
+            (strData(), strData() + strLength(),
+             other.strData(), other.strData() + other.strLength());
     else if (type == COMPOUND2) {
         return ML::less_all(compoundId1(), other.compoundId1(),
                             compoundId2(), other.compoundId2());
@@ -517,7 +744,7 @@ Id::
 complexHash() const
 {
     if (type == STR)
-        return CityHash64(str, len);
+        return CityHash64(strData(), strLength());
     else if (type == COMPOUND2) {
         return Hash128to64(make_pair(compoundId1().hash(),
                                      compoundId2().hash()));
@@ -533,14 +760,16 @@ complexDestroy()
 {
     if (type < STR) return;
     if (type == STR) {
-        if (ownstr) delete[] str;
+        if (!shortLen && ownstr)
+            SharedString::release(str);
+        shortLen = 0;
         str = 0;
         ownstr = false;
     }
     else if (type == COMPOUND2) {
-        delete cmp1;
-        delete cmp2;
-        cmp1 = cmp2 = 0;
+        if (cmp)
+            SharedCompound::release(cmp);
+        cmp = 0;
     }
     //else if (type == CUSTOM)
     //    controlFn(CF_DESTROY, data);
@@ -552,17 +781,11 @@ Id::
 complexFinishCopy()
 {
     if (type == STR) {
-        if (!ownstr) return;
-        const char * oldStr = str;
-        char * s = new char[len];
-        str = s;
-        std::copy(oldStr, oldStr + len, s);
+        if (shortLen || !ownstr) return;
+        SharedString::of(str)->refs.fetch_add(1);
     }
     else if (type == COMPOUND2) {
-        //cerr << "cmp1 = " << cmp1 << " cmp2 = " << cmp2 << " type = "
-        //     << (int)type << endl;
-        cmp1 = new Id(compoundId1());
-        cmp2 = new Id(compoundId2());
+        cmp->refs.fetch_add(1);
     }
     //else if (type == CUSTOM)
     //    data = (void *)controlFn(CF_COPY, data);
@@ -594,7 +817,7 @@ serialize(ML::DB::Store_Writer & store) const
         store.save_binary(&val2, 8);
         break;
     case STR:
-        store << string(str, str + len);
+        store << string(strData(), strLength());
         break;
     case COMPOUND2:
         compoundId1().serialize(store);
@@ -663,18 +886,13 @@ reconstitute(ML::DB::Store_Reader & store)
     case STR: {
         std::string s;
         store >> s;
-        r.len = s.size();
-        r.ownstr = true;
-        char * s2 = new char[s.size()];
-        r.str = s2;
-        std::copy(s.begin(), s.end(), s2);
+        r.initString(s.data(), s.size());
         break;
     }
     case COMPOUND2: {
-        unique_ptr<Id> id1(new Id()), id2(new Id());
-        store >> *id1 >> *id2;
-        r.cmp1 = id1.release();
-        r.cmp2 = id2.release();
+        Id id1, id2;
+        store >> id1 >> id2;
+        r.cmp = new SharedCompound(id1, id2);
         break;
     }
     default:
@@ -69,7 +69,7 @@ struct Id {
     };
 
     Id()
-        : type(NONE), val1(0), val2(0)
+        : type(NONE), shortLen(0), val1(0), val2(0)
     {
     }
 
@@ -81,42 +81,37 @@ struct Id {
 
     explicit Id(const std::string & value,
                 Type type = UNKNOWN)
-        : type(NONE), val1(0), val2(0)
+        : type(NONE), shortLen(0), val1(0), val2(0)
     {
         parse(value, type);
     }
     
     explicit Id(const char * value, size_t len,
                 Type type = UNKNOWN)
-        : type(NONE), val1(0), val2(0)
+        : type(NONE), shortLen(0), val1(0), val2(0)
     {
         parse(value, len, type);
     }
     
     explicit Id(uint64_t value):
-    		type(BIGDEC),
+    		type(BIGDEC), shortLen(0),
     		val1(value),val2(0)
     {
     }
 
 
     // Construct a compound ID from two others
-    Id(const Id & underlying1, const Id & underlying2)
-        : type(COMPOUND2),
-          cmp1(new Id(underlying1)),
-          cmp2(new Id(underlying2))
-    {
-    }
+    Id(const Id & underlying1, const Id & underlying2);
 
     Id(Id && other)
-        : type(other.type),
+        : type(other.type), shortLen(other.shortLen),
           val1(other.val1), val2(other.val2)
     {
         other.type = NONE;
     }
 
     Id(const Id & other)
-        : type(other.type),
+        : type(other.type), shortLen(other.shortLen),
           val1(other.val1), val2(other.val2)
     {
         if (other.type >= STR)
@@ -128,6 +123,7 @@ struct Id {
         if (type >= STR)
             complexDestroy();
         type = other.type;
+        shortLen = other.shortLen;
         val1 = other.val1;
         val2 = other.val2;
         other.type = NONE;
@@ -136,9 +132,12 @@ struct Id {
 
     Id & operator = (const Id & other)
     {
+        if (this == &other)
+            return *this;
         if (type >= STR)
             complexDestroy();
         type = other.type;
+        shortLen = other.shortLen;
         val1 = other.val1;
         val2 = other.val2;
         if (other.type >= STR)
@@ -202,11 +201,30 @@ struct Id {
         return (*this != other && !(*this < other));
     }
 
+    /** Integer encoded ids are hashed by multiplying their two halves,
+        each mixed with a constant, and folding the 128 bit product.
+    */
     uint64_t hash() const
     {
         if (type == NONE || type == NULLID) return 0;
         if (JML_UNLIKELY(type >= STR)) return complexHash();
-        return Hash128to64(std::make_pair(val1, val2));
+        __uint128_t product = (__uint128_t)(val1 ^ 0xa0761d6478bd642fULL)
+            * (val2 ^ 0xe7037ed1a0b428dbULL);
+        return uint64_t(product) ^ uint64_t(product >> 64);
+    }
+
+    /** Strings up to this long are stored inline instead of on the heap. */
+    static constexpr size_t MaxShortLength = 16;
+
+    /** Text and length of a STR, wherever it is stored. */
+    const char * strData() const
+    {
+        return shortLen ? shortStr : str;
+    }
+
+    size_t strLength() const
+    {
+        return shortLen ? shortLen - 1 : len;
     }
 
     bool complexEqual(const Id & other) const;
@@ -215,8 +233,18 @@ struct Id {
     void complexDestroy();
     void complexFinishCopy();
 
+    /** Makes this a STR with a copy of the given text. */
+    void initString(const char * value, size_t len);
+
+    /** Longer strings and compound ids are shared between copies of the
+        Id, which never modify them, and freed with the last of them.
+    */
+    struct SharedString;
+    struct SharedCompound;
+
     uint8_t type;
-    uint8_t unused[3];
+    uint8_t shortLen;   ///< Length + 1 of a STR stored in shortStr, else 0
+    uint8_t unused[2];
 
     union {
         // 128 byte integer
@@ -241,17 +269,19 @@ struct Id {
             uint64_t f5:48;
         };
 
-        // string
+        // string; when owned, str is the text of a SharedString
         struct {
             uint64_t len:56;
             uint64_t ownstr:8;
             const char * str;
         };
 
+        // string of up to MaxShortLength characters, when shortLen != 0
+        char shortStr[16];
+
         // compound2
         struct {
-            Id * cmp1;
-            Id * cmp2;
+            SharedCompound * cmp;
         };
 #if 0
         // custom
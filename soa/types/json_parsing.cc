@@ -7,6 +7,12 @@
 #include "json_parsing.h"
 #include "string.h"
 #include "value_description.h"
+#include "jml/arch/arch.h"
+#include <algorithm>
+
+#if JML_INTEL_ISA
+#  include <emmintrin.h>
+#endif
 
 using namespace std;
 using namespace ML;
@@ -51,6 +57,15 @@ expectStringUtf8()
             bufferSize = newBufferSize;
         }
 
+        size_t run = std::min(jsonPlainRun(*context), bufferSize - 4 - pos);
+        if (run) {
+            std::copy(context->buffer_pos(), context->buffer_pos() + run,
+                      buffer + pos);
+            pos += run;
+            context->skip_in_buffer(run);
+            continue;
+        }
+
         int c = *(*context);
         
         //cerr << "c = " << c << " " << (char)c << endl;
@@ -105,4 +120,153 @@ expectStringUtf8()
 }
 
 
+/*****************************************************************************/
+/* JSON STRUCTURAL INDEX                                                     */
+/*****************************************************************************/
+
+namespace {
+
+/** Return the first character in [p, end) that is one of the given ones,
+    or end if there are none.  Blocks of 16 characters are compared with
+    all of them at once.
+*/
+template<size_t N>
+const char * findFirstOf(const char * p, const char * end,
+                         const char (&chars)[N])
+{
+#if JML_INTEL_ISA
+    for (;  end - p >= 16;  p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i found = _mm_setzero_si128();
+        for (size_t i = 0;  i < N - 1;  ++i)
+            found = _mm_or_si128(found,
+                                 _mm_cmpeq_epi8(x, _mm_set1_epi8(chars[i])));
+        int mask = _mm_movemask_epi8(found);
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif // JML_INTEL_ISA
+
+    for (;  p < end;  ++p) {
+        for (size_t i = 0;  i < N - 1;  ++i)
+            if (*p == chars[i])
+                return p;
+    }
+
+    return end;
+}
+
+} // file scope
+
+void
+JsonStructuralIndex::
+index(const char * start, const char * end)
+{
+    entries.clear();
+    cursor = 0;
+    valid = false;
+
+    if (end - start >= UINT32_MAX)
+        return;
+
+    vector<uint32_t> open;  // entries that aren't closed yet
+    uint32_t newlines = 0;
+
+    for (const char * p = start;  p < end;  ++p) {
+        p = findFirstOf(p, end, "\"{}[]\n");
+        if (p == end)
+            break;
+
+        char c = *p;
+        uint32_t offset = p - start;
+
+        if (c == '"') {
+            // Find the closing quote, stepping over escaped characters
+            for (++p;;  p += 2) {
+                p = findFirstOf(p, end, "\"\\");
+                if (p >= end) {
+                    entries.clear();
+                    return;
+                }
+                if (*p == '"') break;
+            }
+        }
+        else if (c == '\n')
+            ++newlines;
+        else if (c == '{' || c == '[') {
+            open.push_back(entries.size());
+            entries.push_back({ offset, 0, 0, newlines });
+        }
+        else {
+            if (open.empty() || start[entries[open.back()].open] != c - 2) {
+                // '}' and ']' are two after '{' and '['
+                entries.clear();
+                return;
+            }
+            Entry & entry = entries[open.back()];
+            entry.close = offset;
+            entry.next = entries.size();
+            entry.newlines = newlines - entry.newlines;
+            open.pop_back();
+        }
+    }
+
+    if (!open.empty()) {
+        entries.clear();
+        return;
+    }
+
+    valid = true;
+}
+
+const JsonStructuralIndex::Entry *
+JsonStructuralIndex::
+find(size_t offset)
+{
+    // Parsing went backwards; find it again from the start
+    if (cursor > 0 && entries[cursor - 1].open >= offset) {
+        auto compare = [] (const Entry & entry, size_t offset)
+            {
+                return entry.open < offset;
+            };
+        cursor = std::lower_bound(entries.begin(), entries.begin() + cursor,
+                                  offset, compare)
+            - entries.begin();
+    }
+
+    while (cursor < entries.size() && entries[cursor].open < offset)
+        ++cursor;
+
+    if (cursor == entries.size() || entries[cursor].open != offset)
+        return nullptr;
+
+    return &entries[cursor];
+}
+
+
+/*****************************************************************************/
+/* INDEXED JSON PARSING CONTEXT                                              */
+/*****************************************************************************/
+
+void
+IndexedJsonParsingContext::
+skip()
+{
+    skipJsonWhitespace(*context);
+
+    if (index.valid && !context->eof()
+        && (*(*context) == '{' || *(*context) == '[')) {
+        if (auto entry = index.find(context->get_offset())) {
+            size_t length = entry->close + 1 - entry->open;
+            if (entry->newlines)
+                context->skip_lines_in_buffer(length);
+            else context->skip_in_buffer(length);
+            index.cursor = entry->next;
+            return;
+        }
+    }
+
+    ML::skipJson(*context);
+}
+
 }  // namespace Datacratic
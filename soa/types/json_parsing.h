@@ -343,7 +343,7 @@ struct StreamingJsonParsingContext
 
     void skip()
     {
-        ML::expectJson(*context);
+        ML::skipJson(*context);
     }
 
     virtual int expectInt()
@@ -787,6 +787,89 @@ struct StringJsonParsingContext
 };
 
 
+/*****************************************************************************/
+/* JSON STRUCTURAL INDEX                                                     */
+/*****************************************************************************/
+
+/** Position of every object and array of a JSON document held in memory,
+    along with where each one ends.  It is built in a single pass over the
+    text that only looks at brackets, quotes, backslashes and newlines, so
+    that a parser can then jump over the values it has no use for.
+
+    A document that isn't properly nested gives an invalid index, which
+    the parser ignores; the error is found when it gets to it.
+*/
+struct JsonStructuralIndex {
+
+    JsonStructuralIndex()
+        : cursor(0), valid(false)
+    {
+    }
+
+    JsonStructuralIndex(const char * start, const char * end)
+    {
+        index(start, end);
+    }
+
+    /** Index the text between start and end. */
+    void index(const char * start, const char * end);
+
+    struct Entry {
+        uint32_t open;      ///< Offset of the opening '{' or '['
+        uint32_t close;     ///< Offset of the matching '}' or ']'
+        uint32_t next;      ///< Number of the entry following its contents
+        uint32_t newlines;  ///< Number of newlines between open and close
+    };
+
+    /** Return the entry of the object or array that opens at the given
+        offset, or null if there is none.  The search starts from the last
+        entry found, which makes it constant time when the document is
+        parsed from start to end.
+    */
+    const Entry * find(size_t offset);
+
+    std::vector<Entry> entries;   ///< In the order they open
+    size_t cursor;                ///< Entry to start the next search at
+    bool valid;
+};
+
+
+/*****************************************************************************/
+/* INDEXED JSON PARSING CONTEXT                                              */
+/*****************************************************************************/
+
+/** Parsing context for a JSON document held in memory, which is given a
+    structural index before being parsed so that skip() jumps over objects
+    and arrays in one step instead of reading them.  It's for when only a
+    few fields of a document are wanted and the rest are skipped, for
+    example from an onUnknownField handler.
+
+    The text must outlive the context.  The values that are skipped aren't
+    validated past the nesting of their brackets and strings.
+*/
+struct IndexedJsonParsingContext
+    : public StreamingJsonParsingContext  {
+
+    IndexedJsonParsingContext(const char * start, const char * end,
+                              const std::string & filename = "<<internal>>")
+        : index(start, end)
+    {
+        init(filename, start, end);
+    }
+
+    IndexedJsonParsingContext(const std::string & str,
+                              const std::string & filename = "<<internal>>")
+        : index(str.c_str(), str.c_str() + str.size())
+    {
+        init(filename, str.c_str(), str.c_str() + str.size());
+    }
+
+    virtual void skip();
+
+    JsonStructuralIndex index;
+};
+
+
 /*****************************************************************************/
 /* UTILITIES                                                                 */
 /*****************************************************************************/
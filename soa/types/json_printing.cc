@@ -22,30 +22,36 @@ writeStringUtf8(const Utf8String & s)
 {
     stream << '\"';
 
-    for (auto it = s.begin(), end = s.end();  it != end;  ++it) {
-        int c = *it;
-        if (c >= ' ' && c < 127 && c != '\"' && c != '\\')
-            stream << (char)c;
-        else {
-            switch (c) {
-            case '\t': stream << "\\t";  break;
-            case '\n': stream << "\\n";  break;
-            case '\r': stream << "\\r";  break;
-            case '\b': stream << "\\b";  break;
-            case '\f': stream << "\\f";  break;
-            case '/':
-            case '\\':
-            case '\"': stream << '\\' << (char)c;  break;
-            default:
-                if (writeUtf8) {
-                    char buf[4];
-                    char * p = utf8::unchecked::append(c, buf);
-                    stream.write(buf, p - buf);
-                }
-                else {
-                    ExcAssert(c >= 0 && c < 65536);
-                    stream << ML::format("\\u%04x", (unsigned)c);
-                }
+    const char * it = s.rawData(), * end = it + s.rawLength();
+
+    while (it != end) {
+        // Write the characters that need no escaping in one go
+        const char * special = ML::findJsonSpecialChar(it, end);
+        if (special != it) {
+            stream.write(it, special - it);
+            it = special;
+            continue;
+        }
+
+        int c = utf8::next(it, end);
+        switch (c) {
+        case '\t': stream << "\\t";  break;
+        case '\n': stream << "\\n";  break;
+        case '\r': stream << "\\r";  break;
+        case '\b': stream << "\\b";  break;
+        case '\f': stream << "\\f";  break;
+        case '/':
+        case '\\':
+        case '\"': stream << '\\' << (char)c;  break;
+        default:
+            if (writeUtf8) {
+                char buf[4];
+                char * p = utf8::unchecked::append(c, buf);
+                stream.write(buf, p - buf);
+            }
+            else {
+                ExcAssert(c >= 0 && c < 65536);
+                stream << ML::format("\\u%04x", (unsigned)c);
             }
         }
     }
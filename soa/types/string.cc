@@ -9,6 +9,12 @@
 #include <iostream>
 #include "jml/arch/exception.h"
 #include "jml/db/persistent.h"
+#include "jml/arch/arch.h"
+#include <cwctype>
+
+#if JML_INTEL_ISA
+#  include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -39,9 +45,9 @@ Utf8String::fromLatin1(const std::string & lat1Str)
 }
 
 Utf8String::Utf8String(const string & in, bool check)
-    : data_(in)
+    : data_(in), isAscii_(isAscii(data_.data(), data_.size()))
 {
-    if (check)
+    if (check && !isAscii_)
     {
         // Check if we find an invalid encoding
         string::const_iterator end_it = utf8::find_invalid(in.begin(), in.end());
@@ -53,9 +59,9 @@ Utf8String::Utf8String(const string & in, bool check)
 }
 
 Utf8String::Utf8String(string && in, bool check)
-    : data_(std::move(in))
+    : data_(std::move(in)), isAscii_(isAscii(data_.data(), data_.size()))
 {
-    if (check)
+    if (check && !isAscii_)
     {
         // Check if we find an invalid encoding
         string::const_iterator end_it = utf8::find_invalid(data_.begin(), data_.end());
@@ -81,9 +87,65 @@ Utf8String::end() const
 Utf8String &Utf8String::operator+=(const Utf8String &utf8str)
 {
     data_ += utf8str.data_;
+    isAscii_ = isAscii_ && utf8str.isAscii_;
     return *this;
 }
 
+bool
+Utf8String::
+isAscii(const char * data, size_t length)
+{
+    size_t i = 0;
+
+#if JML_INTEL_ISA
+    // The top bits of all the bytes are or'ed together and only looked at
+    // once at the end, since nearly every string is ASCII.
+    __m128i bits = _mm_setzero_si128();
+    for (;  i + 16 <= length;  i += 16)
+        bits = _mm_or_si128(bits,
+                            _mm_loadu_si128((const __m128i *)(data + i)));
+    if (_mm_movemask_epi8(bits))
+        return false;
+#endif
+
+    unsigned char rest = 0;
+    for (;  i < length;  ++i)
+        rest |= data[i];
+    return (rest & 0x80) == 0;
+}
+
+Utf8String
+Utf8String::
+toLower() const
+{
+    Utf8String result;
+
+    if (isAscii_) {
+        result.data_.resize(data_.size());
+        for (size_t i = 0;  i < data_.size();  ++i) {
+            char c = data_[i];
+            result.data_[i] = c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+        }
+        return result;
+    }
+
+    result.data_.reserve(data_.size());
+    auto out = std::back_inserter(result.data_);
+    for (auto it = begin(), e = end();  it != e;  ++it)
+        out = utf8::append(std::towlower(*it), out);
+    result.isAscii_ = isAscii(result.data_.data(), result.data_.size());
+    return result;
+}
+
+size_t
+Utf8String::
+length() const
+{
+    if (isAscii_)
+        return data_.size();
+    return utf8::distance(data_.begin(), data_.end());
+}
+
 std::ostream & operator << (std::ostream & stream, const Utf8String & str)
 {
     stream << string(str.rawData(), str.rawLength()) ;
@@ -102,11 +164,19 @@ Utf8String::
 reconstitute(ML::DB::Store_Reader & store)
 {
     store >> data_;
+    isAscii_ = isAscii(data_.data(), data_.size());
 }
     
 string Utf8String::extractAscii() const
 {
     string s;
+    if (isAscii_) {
+        s = data_;
+        for (char & c: s)
+            if (c < ' ' || c == 127) c = '?';
+        return s;
+    }
+
     for(auto it = begin(); it != end(); it++) {
         char c = *it;
         if (c >= ' ' && c < 127) {
@@ -26,18 +26,19 @@ public:
 
     /** Allow default construction of an empty string. */
     Utf8String()
+        : isAscii_(true)
     {
     }
 
     /** Move constructor. */
     Utf8String(Utf8String && str) noexcept
-        : data_(std::move(str.data_))
+        : data_(std::move(str.data_)), isAscii_(str.isAscii_)
     {
     }
 
     /** Copy constructor. */
     Utf8String(const Utf8String & str)
-        : data_(str.data_)
+        : data_(str.data_), isAscii_(str.isAscii_)
     {
     }
 
@@ -68,18 +69,21 @@ public:
     Utf8String & operator=(const std::string &str)
     {
     	data_ = str;
+	isAscii_ = isAscii(data_.data(), data_.size());
     	return *this;
     }
 
     Utf8String & operator=(std::string &&str)
     {
     	data_ = std::move(str);
+	isAscii_ = isAscii(data_.data(), data_.size());
     	return *this;
     }
 
     void swap(Utf8String & other)
     {
         data_.swap(other.data_);
+        std::swap(isAscii_, other.isAscii_);
     }
 
     bool empty() const
@@ -96,6 +100,7 @@ public:
     Utf8String&  operator+=(const std::string& str)
     {
     	data_+=str;
+	isAscii_ = isAscii_ && isAscii(str.data(), str.size());
     	return *this;
     }
     Utf8String &operator+=(const Utf8String &utf8str);
@@ -112,14 +117,33 @@ public:
 
     std::string extractAscii() const;
 
+    /** Whether every character is ASCII, in which case there is one byte
+        per code point and the string can be worked on byte by byte.  Known
+        from construction, since it's the case of nearly all of the user
+        agents and languages that come in bid requests.
+    */
+    bool isAscii() const { return isAscii_; }
+
+    /** Tells whether the bytes are all ASCII, 16 at a time. */
+    static bool isAscii(const char * data, size_t length);
+
+    /** Copy with the letters in lower case, byte by byte when the string is
+        ASCII and code point by code point according to the C library
+        otherwise.
+    */
+    Utf8String toLower() const;
+
+    /** Number of code points. */
+    size_t length() const;
+
     bool operator == (const Utf8String & other) const
     {
-        return data_ == other.data_;
+        return isAscii_ == other.isAscii_ && data_ == other.data_;
     }
 
     bool operator != (const Utf8String & other) const
     {
-        return data_ != other.data_;
+        return !operator == (other);
     }
 
     bool operator < (const Utf8String & other) const
@@ -129,6 +153,7 @@ public:
 
 private:
     std::string data_; // original utf8-encoded string
+    bool isAscii_;     // no byte of data_ has its top bit set
 };
 
 inline void swap(Utf8String & s1, Utf8String & s2)
@@ -0,0 +1,103 @@
+/* date_profile.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Compares the direct date printing and parsing with the strftime and
+   Parse_Context based routines they replace, and the clocks with each
+   other.
+*/
+
+#include <iostream>
+#include <vector>
+#include "soa/types/date.h"
+#include "jml/arch/format.h"
+
+using namespace ML;
+using namespace std;
+using namespace Datacratic;
+
+template<typename Fn>
+void profile(const std::string & what, int n, Fn fn)
+{
+    Date before = Date::now();
+
+    size_t total = 0;
+    for (unsigned i = 0;  i < n;  ++i)
+        total += fn(i);
+
+    Date after = Date::now();
+    double elapsed = after.secondsSince(before);
+
+    cerr << ML::format("%-32s %8.1f ns each (%zd)",
+                       what.c_str(), elapsed * 1e9 / n, total)
+         << endl;
+}
+
+int main(int argc, char ** argv)
+{
+    int n = 2000000;
+
+    profile("now", n, [&] (int i)
+            {
+                return Date::now().secondsSinceEpoch() > 0;
+            });
+
+    profile("nowFast", n, [&] (int i)
+            {
+                return Date::nowFast().secondsSinceEpoch() > 0;
+            });
+
+    profile("nowCoarse", n, [&] (int i)
+            {
+                return Date::nowCoarse().secondsSinceEpoch() > 0;
+            });
+
+    /* a burst of events, a few per millisecond */
+    Date start = Date::now();
+    vector<Date> dates;
+    for (unsigned i = 0;  i < 1000;  ++i)
+        dates.push_back(start.plusSeconds(i * 0.000317));
+
+    vector<string> printed;
+    for (const Date & date: dates)
+        printed.push_back(date.printIso8601());
+
+    profile("printIso8601 strftime", n, [&] (int i)
+            {
+                const Date & date = dates[i % dates.size()];
+                string result = date.print("%Y-%m-%dT%H:%M:%S");
+                string fractional = format("%.*fZ", 3,
+                                           date.fractionalSeconds());
+                result.append(fractional, 1, -1);
+                return result.size();
+            });
+
+    profile("printIso8601", n, [&] (int i)
+            {
+                return dates[i % dates.size()].printIso8601().size();
+            });
+
+    profile("printIso8601 buffer", n, [&] (int i)
+            {
+                char buffer[Date::MaxPrintLength];
+                return dates[i % dates.size()].printIso8601(buffer, 3);
+            });
+
+    profile("printClassic buffer", n, [&] (int i)
+            {
+                char buffer[Date::MaxPrintLength];
+                return dates[i % dates.size()].printClassic(buffer);
+            });
+
+    profile("parseIso8601DateTime general", n, [&] (int i)
+            {
+                const string & str = printed[i % printed.size()];
+                return Iso8601Parser::parseDateTimeString(str).hour();
+            });
+
+    profile("parseIso8601DateTime", n, [&] (int i)
+            {
+                const string & str = printed[i % printed.size()];
+                return Date::parseIso8601DateTime(str).hour();
+            });
+}
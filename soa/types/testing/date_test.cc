@@ -302,6 +302,30 @@ BOOST_AUTO_TEST_CASE( test_now )
     cerr << "old: " << Date::nowOld().print(6) << endl;
 }
 
+BOOST_AUTO_TEST_CASE( test_now_fast )
+{
+    /* the tick clock is anchored again every second, so this goes through
+       a few anchors */
+    Date start = Date::now();
+    double maxError = 0.0;
+    while (Date::now().secondsSince(start) < 2.5) {
+        Date before = Date::now();
+        Date fast = Date::nowFast();
+        Date after = Date::now();
+        double error = std::max(before.secondsSince(fast),
+                                fast.secondsSince(after));
+        maxError = std::max(maxError, error);
+    }
+
+    cerr << "nowFast max error: " << maxError * 1e6 << "us" << endl;
+    BOOST_CHECK_LT(maxError, 0.001);
+
+    /* the coarse clock is a kernel tick behind at most */
+    double behind = Date::now().secondsSince(Date::nowCoarse());
+    BOOST_CHECK_GE(behind, 0.0);
+    BOOST_CHECK_LT(behind, 0.1);
+}
+
 BOOST_AUTO_TEST_CASE( test_date_equality )
 {
     BOOST_CHECK_EQUAL(Date(), Date());
@@ -589,3 +613,69 @@ BOOST_AUTO_TEST_CASE( test_second )
     }
 
 }
+
+BOOST_AUTO_TEST_CASE( test_print_buffer )
+{
+    char buffer[Date::MaxPrintLength];
+    Date date = Date::fromSecondsSinceEpoch(1348089400.416978);
+
+    size_t length = date.printIso8601(buffer, 6);
+    BOOST_CHECK_EQUAL(string(buffer, length), "2012-09-19T21:16:40.416978Z");
+    length = date.printClassic(buffer);
+    BOOST_CHECK_EQUAL(string(buffer, length), "2012-09-19 21:16:40");
+    length = date.print(buffer, 3);
+    BOOST_CHECK_EQUAL(string(buffer, length), "2012-Sep-19 21:16:40.417");
+
+    /* the same second a second time comes from the per thread cache */
+    length = date.plusSeconds(0.5).printIso8601(buffer, 3);
+    BOOST_CHECK_EQUAL(string(buffer, length), "2012-09-19T21:16:40.917Z");
+
+    /* fractions that round up carry into the seconds */
+    date = Date::fromSecondsSinceEpoch(1348089599.9996);
+    BOOST_CHECK_EQUAL(date.printIso8601(), "2012-09-19T21:20:00.000Z");
+    BOOST_CHECK_EQUAL(date.print(0), "2012-Sep-19 21:19:59");
+
+    /* dates before the epoch count back from the previous second */
+    date = Date::fromSecondsSinceEpoch(-1.25);
+    BOOST_CHECK_EQUAL(date.printIso8601(), "1969-12-31T23:59:58.750Z");
+
+    BOOST_CHECK_EQUAL(Date::notADate().printIso8601(buffer, 3), 3);
+    BOOST_CHECK_EQUAL(string(buffer, 3), "NaD");
+    BOOST_CHECK_THROW(date.printIso8601(buffer, 10), ML::Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_parse_canonical )
+{
+    /* the canonical forms are parsed directly and must give exactly the
+       same result as the general parser */
+    vector<string> dates = {
+        "2012-09-19T21:16:40.416978Z",
+        "2012-09-19T21:16:40.417Z",
+        "2012-09-19T21:16:40Z",
+        "2012-09-19 21:16:40.5",
+        "2012-02-29T00:00:00",
+        "1969-12-31T23:59:58.984375"
+    };
+
+    for (const string & str: dates) {
+        Date date = Date::parseIso8601DateTime(str);
+        BOOST_CHECK_EQUAL(date.secondsSinceEpoch(),
+                          Iso8601Parser::parseDateTimeString(str)
+                          .secondsSinceEpoch());
+        BOOST_CHECK_EQUAL(Date::parseIso8601DateTime(str.c_str(),
+                                                     str.c_str() + str.size()),
+                          date);
+    }
+
+    BOOST_CHECK_EQUAL(Date::parseDefaultUtc("2012-09-19 21:16:40"),
+                      Date(2012, 9, 19, 21, 16, 40));
+
+    /* anything else goes to the general parser */
+    BOOST_CHECK_EQUAL(Date::parseIso8601DateTime("2012-09-19T21:16:40+01:00"),
+                      Date(2012, 9, 19, 22, 16, 40));
+    {
+        JML_TRACE_EXCEPTIONS(false);
+        BOOST_CHECK_THROW(Date::parseIso8601DateTime("2013-02-29T00:00:00"),
+                          std::exception);
+    }
+}
@@ -0,0 +1,114 @@
+/* hash_map_profile.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic Inc.  All rights reserved.
+
+   Compares the hash maps on the keys looked up by the router and the post
+   auction loop: auction ids, agent names and the 64 bit hashes of the
+   include/exclude lists.
+*/
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "jml/utils/group_hash.h"
+#include "jml/utils/lightweight_hash.h"
+#include "soa/types/id.h"
+#include "soa/types/date.h"
+
+using namespace ML;
+using namespace std;
+using namespace Datacratic;
+
+
+/** Inserts the first half of the keys, then looks up all of them (half
+    hits, half misses) over and over and prints the rates.
+*/
+template<typename Map, typename Key>
+void profileMap(const std::string & name, const std::vector<Key> & keys)
+{
+    size_t n = keys.size() / 2;
+    int rounds = std::max<int>(1, 20000000 / keys.size());
+
+    Date before = Date::now();
+
+    Map map;
+    for (unsigned r = 0;  r < rounds;  ++r) {
+        map = Map();
+        for (unsigned i = 0;  i < n;  ++i)
+            map[keys[i]] = i;
+    }
+
+    double insertElapsed = Date::now().secondsSince(before);
+
+    before = Date::now();
+    uint64_t found = 0;
+
+    for (unsigned r = 0;  r < rounds;  ++r)
+        for (auto & key: keys)
+            found += map.find(key) != map.end();
+
+    double findElapsed = Date::now().secondsSince(before);
+
+    if (found != n * rounds)
+        cerr << "wrong number of hits" << endl;
+
+    cerr << name << " " << n << ": "
+         << 1.0 * n * rounds / insertElapsed / 1e6 << "M inserts/s, "
+         << 1.0 * keys.size() * rounds / findElapsed / 1e6 << "M finds/s"
+         << endl;
+}
+
+std::vector<Id> auctionIds(size_t n)
+{
+    std::vector<Id> result;
+    for (unsigned i = 0;  i < n;  ++i) {
+        char buf[40];
+        snprintf(buf, sizeof(buf), "%08x-1ac1-4001-15e8-%012x",
+                 (unsigned)random(), i);
+        result.emplace_back(buf);
+    }
+    return result;
+}
+
+std::vector<std::string> agentNames(size_t n)
+{
+    std::vector<std::string> result;
+    for (unsigned i = 0;  i < n;  ++i)
+        result.push_back("rtbkit_agent_" + to_string(random()) + "_"
+                         + to_string(i));
+    return result;
+}
+
+std::vector<uint64_t> hashes(size_t n)
+{
+    std::vector<uint64_t> result;
+    for (unsigned i = 0;  i < n;  ++i)
+        result.push_back(std::hash<std::string>()(to_string(i)) | 1);
+    return result;
+}
+
+int main(int argc, char ** argv)
+{
+    for (size_t n: { 32, 2000, 200000 }) {
+        auto ids = auctionIds(n);
+        profileMap<Group_Hash<Id, int> >("Group_Hash<Id>", ids);
+        profileMap<std::unordered_map<Id, int> >("unordered_map<Id>", ids);
+
+        auto names = agentNames(n);
+        profileMap<Group_Hash<std::string, int> >
+            ("Group_Hash<string>", names);
+        profileMap<std::unordered_map<std::string, int> >
+            ("unordered_map<string>", names);
+
+        // Lightweight_Hash can't have Id or string keys, as it needs a guard
+        // key value
+        auto hs = hashes(n);
+        profileMap<Group_Hash<uint64_t, int> >("Group_Hash<uint64_t>", hs);
+        profileMap<Lightweight_Hash<uint64_t, int> >
+            ("Lightweight_Hash<uint64_t>", hs);
+        profileMap<std::unordered_map<uint64_t, int> >
+            ("unordered_map<uint64_t>", hs);
+
+        cerr << endl;
+    }
+}
@@ -5,6 +5,7 @@
 */
 
 #include <iostream>
+#include <vector>
 #include "soa/types/id.h"
 #include "soa/types/date.h"
 
@@ -105,37 +106,87 @@ void profile3()
          << 1.0 * n / elapsed << " per second)" << endl;
 }
 
-int main(int argc, char ** argv)
+/** Parses each of the ids in turn n times over and prints the rate. */
+void profileParse(const std::string & format, const std::vector<string> & ids)
 {
-    //profile1();
-    //profile2();
-    //profile3();
-
-    string ids[5] = {
-        "2fa07c3c-1ac1-4001-15e8-42e6000003a1",
-        "a78e802f-1ac1-4001-15e8-c6b0000003a0",
-        "f8ece33b-1ac1-4001-15e8-42e6000003a1",
-        "e46ead3d-1ac1-4001-15e8-ade2000003a1",
-        "7081463e-1ac1-4001-15e8-01e8000003a0"
-    };
-
-    int nids = 5;
-
     Date before = Date::now();
-    
+
     int n = 10000000;
-    
+    uint64_t total = 0;
+
     for (unsigned i = 0;  i < n;  ++i) {
-        Id id(ids[i % nids]);
-        //if (id.type != Id::UUID)
-        //    cerr << "bad type" << endl;
-        //if (id.toString() != ids[i % nids])
-        //    cerr << "bad parse" << endl;
+        Id id(ids[i % ids.size()]);
+        total += id.type;
     }
 
     Date after = Date::now();
     double elapsed = after.secondsSince(before);
-    
-    cerr << "processed " << n << " in " << elapsed << "s ("
+
+    cerr << format << ": parsed " << n << " in " << elapsed << "s ("
          << 1.0 * n / elapsed << " per second)" << endl;
+
+    if (total == 0)
+        cerr << "no ids" << endl;
+}
+
+/** Hashes the parsed ids n times over and prints the rate. */
+void profileHash(const std::string & format, const std::vector<string> & ids)
+{
+    std::vector<Id> parsed;
+    for (auto & s: ids)
+        parsed.emplace_back(s);
+
+    Date before = Date::now();
+
+    int n = 100000000;
+    uint64_t total = 0;
+
+    for (unsigned i = 0;  i < n;  ++i)
+        total += parsed[i % parsed.size()].hash();
+
+    Date after = Date::now();
+    double elapsed = after.secondsSince(before);
+
+    cerr << format << ": hashed " << n << " in " << elapsed << "s ("
+         << 1.0 * n / elapsed << " per second) " << (total & 1) << endl;
+}
+
+int main(int argc, char ** argv)
+{
+    //profile1();
+    //profile2();
+    //profile3();
+
+    std::vector<std::pair<std::string, std::vector<string> > > formats = {
+        { "uuid", {
+                "2fa07c3c-1ac1-4001-15e8-42e6000003a1",
+                "a78e802f-1ac1-4001-15e8-c6b0000003a0",
+                "f8ece33b-1ac1-4001-15e8-42e6000003a1",
+                "e46ead3d-1ac1-4001-15e8-ade2000003a1",
+                "7081463e-1ac1-4001-15e8-01e8000003a0" } },
+        { "goog128", {
+                "CAESEAYra3NIxLT9C8twKrzqaA",
+                "CAESEOfM7z6ZfS0q3Qm-OyBhUvc",
+                "CAESEHc4vd_ptDPsU2qfZKD9U2Q" } },
+        { "bigdec", {
+                "7394206091425759590",
+                "1234567890",
+                "340282366920938463463374607431768211" } },
+        { "base64_96", {
+                "++++VpWW999gvYaw",
+                "+++/uRXa99O0T0+w",
+                "jDhUJMWW9997leCw" } },
+        { "hex128lc", {
+                "0828398c596511e084c80026b937c8e1",
+                "7081463e1ac1400115e801e8000003a0" } },
+        { "str", {
+                "a string id that is not anything else",
+                "bid-request-1234" } }
+    };
+
+    for (auto & f: formats)
+        profileParse(f.first, f.second);
+
+    for (auto & f: formats)
+        profileHash(f.first, f.second);
 }
@@ -163,6 +163,42 @@ BOOST_AUTO_TEST_CASE( test_string_id_copying )
     checkSerializeReconstitute(id);
 }
 
+BOOST_AUTO_TEST_CASE( test_string_id_storage )
+{
+    // Either side of the inline limit
+    for (string s: { string("x"),
+                     string(Id::MaxShortLength - 1, 'a'),
+                     string(Id::MaxShortLength, 'b'),
+                     string(Id::MaxShortLength + 1, 'c'),
+                     string(100, 'd') }) {
+        Id id(s, Id::STR);
+        BOOST_CHECK_EQUAL(id.type, Id::STR);
+        BOOST_CHECK_EQUAL(id.toString(), s);
+        BOOST_CHECK_EQUAL(id.strLength(), s.size());
+        BOOST_CHECK_EQUAL(id.shortLen != 0, s.size() <= Id::MaxShortLength);
+
+        Id copy(id);
+        BOOST_CHECK_EQUAL(copy, id);
+        BOOST_CHECK_EQUAL(copy.hash(), id.hash());
+        BOOST_CHECK_EQUAL(copy.toString(), s);
+
+        Id assigned;
+        assigned = copy;
+        assigned = assigned;
+        BOOST_CHECK_EQUAL(assigned, id);
+
+        // Copies outlive the original
+        id = Id();
+        BOOST_CHECK_EQUAL(copy.toString(), s);
+        BOOST_CHECK_EQUAL(assigned.toString(), s);
+
+        checkSerializeReconstitute(copy);
+    }
+
+    BOOST_CHECK(Id(string("abc"), Id::STR) < Id(string("abcd"), Id::STR));
+    BOOST_CHECK(Id(string(20, 'a'), Id::STR) < Id(string(20, 'b'), Id::STR));
+}
+
 BOOST_AUTO_TEST_CASE( test_null_id )
 {
     string s = "null";
@@ -347,4 +383,78 @@ BOOST_AUTO_TEST_CASE( test_id_sorting )
 BOOST_AUTO_TEST_CASE( test_compound_id )
 {
     Id id(Id("hello"), Id("world"));
+    BOOST_CHECK_EQUAL(id.type, Id::COMPOUND2);
+    BOOST_CHECK_EQUAL(id.compoundId1(), Id("hello"));
+    BOOST_CHECK_EQUAL(id.compoundId2(), Id("world"));
+
+    Id copy(id);
+    id = Id();
+    BOOST_CHECK_EQUAL(copy.compoundId1(), Id("hello"));
+    BOOST_CHECK_EQUAL(copy.compoundId2(), Id("world"));
+    checkSerializeReconstitute(copy);
+}
+
+/** Random ids of each fixed length format, and the same with one character
+    that doesn't belong, so that each position of the decoders is covered.
+*/
+BOOST_AUTO_TEST_CASE( test_id_parse_formats )
+{
+    struct Format {
+        Id::Type type;
+        string prefix;
+        string alphabet;
+        int length;
+    };
+
+    vector<Format> formats = {
+        { Id::HEX128LC, "", "0123456789abcdef", 32 },
+        { Id::BASE64_96, "",
+          "+/0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz",
+          16 },
+        { Id::GOOG128, "CAESE",
+          "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz-_",
+          21 }
+    };
+
+    srand(42);
+
+    for (auto & f: formats) {
+        for (unsigned i = 0;  i < 1000;  ++i) {
+            string s = f.prefix;
+            s += f.alphabet[1 + rand() % (f.alphabet.size() - 1)];
+            for (unsigned j = 1;  j < f.length;  ++j)
+                s += f.alphabet[rand() % f.alphabet.size()];
+
+            Id id(s);
+            BOOST_CHECK_EQUAL(id.type, f.type);
+            BOOST_CHECK_EQUAL(id.toString(), s);
+
+            // Anything outside of the alphabet makes it a string
+            string bad = s;
+            bad[f.prefix.size() + rand() % f.length]
+                = "!.:@[`{\x80\xff"[rand() % 9];
+            BOOST_CHECK_EQUAL(Id(bad).type, Id::STR);
+        }
+    }
+
+    // Uppercase hex is also accepted as HEX128LC
+    Id upper("0828398C596511E084C80026B937C8E1");
+    BOOST_CHECK_EQUAL(upper.type, Id::HEX128LC);
+    BOOST_CHECK_EQUAL(upper, Id("0828398c596511e084c80026b937c8e1"));
+
+    // A uuid with both lower and upper case letters is only a string
+    BOOST_CHECK_EQUAL(Id("0828398c-5965-11E0-84c8-0026b937c8e1").type,
+                      Id::STR);
+    BOOST_CHECK_EQUAL(Id("0828398c-5965-11e0-84c8-0026b937c8\xe1").type,
+                      Id::STR);
+    BOOST_CHECK_EQUAL(Id("08283980-5965-1100-8408-002609370801").type,
+                      Id::UUID);
+
+    // Decimals longer than 64 bits
+    BOOST_CHECK_EQUAL(Id("340282366920938463463374607431768211").toString(),
+                      "340282366920938463463374607431768211");
+    Id big("18446744073709551616");
+    BOOST_CHECK_EQUAL(big.type, Id::BIGDEC);
+    BOOST_CHECK(big.val1 == 0 && big.val2 == 1);
+    BOOST_CHECK_EQUAL(Id("1844674407370955161a").type, Id::STR);
 }
@@ -63,3 +63,52 @@ BOOST_AUTO_TEST_CASE(test_utf8_round_trip_streaming_ascii)
         BOOST_CHECK_EQUAL(str, str2);
     }
 }
+
+BOOST_AUTO_TEST_CASE(test_indexed_skip)
+{
+    string json = "{ \"a\": 1,\n"
+        "  \"ext\": { \"x\": [1, 2, { \"y\": \"}]\\\"[\" } ],\n"
+        "           \"z\": {} },\n"
+        "  \"b\": \"two\", \"c\": [[], [3]], \"d\": 4 }";
+
+    JsonStructuralIndex index(json.c_str(), json.c_str() + json.size());
+    BOOST_CHECK(index.valid);
+    BOOST_CHECK_EQUAL(index.entries.size(), 8);
+    BOOST_CHECK_EQUAL(index.entries[0].close, json.size() - 1);
+    BOOST_CHECK_EQUAL(index.entries[0].newlines, 3);
+    BOOST_CHECK_EQUAL(index.entries[1].next, 5);
+    BOOST_CHECK(!index.find(1));
+
+    auto parse = [] (JsonParsingContext & context)
+        {
+            string result;
+            context.forEachMember([&] ()
+                {
+                    string name = context.fieldName();
+                    if (name == "a" || name == "d")
+                        result += name + to_string(context.expectInt());
+                    else if (name == "b")
+                        result += name + context.expectStringAscii();
+                    else context.skip();
+                });
+            return result;
+        };
+
+    IndexedJsonParsingContext indexed(json);
+    BOOST_CHECK_EQUAL(parse(indexed), "a1btwod4");
+    BOOST_CHECK(indexed.context->eof());
+    BOOST_CHECK_EQUAL(indexed.context->get_line(), 4);
+    BOOST_CHECK_EQUAL(indexed.context->get_col(), 39);
+
+    // Same positions as when the skipped values are read
+    StringJsonParsingContext streaming(json);
+    BOOST_CHECK_EQUAL(parse(streaming), "a1btwod4");
+    BOOST_CHECK_EQUAL(streaming.context->get_line(), 4);
+    BOOST_CHECK_EQUAL(streaming.context->get_col(), 39);
+
+    // Badly nested documents aren't indexed, and fail when parsed
+    string bad = "{ \"a\": [1, 2}, \"b\": 3 }";
+    IndexedJsonParsingContext badContext(bad);
+    BOOST_CHECK(!badContext.index.valid);
+    BOOST_CHECK_THROW(parse(badContext), std::exception);
+}
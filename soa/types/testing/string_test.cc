@@ -11,6 +11,7 @@
 #include "soa/jsoncpp/json.h"
 #include "soa/types/dtoa.h"
 #include "jml/arch/format.h"
+#include "jml/arch/exception_handler.h"
 
 using namespace std;
 using namespace ML;
@@ -119,6 +120,55 @@ BOOST_AUTO_TEST_CASE( test_u32_string )
 
 }
 
+BOOST_AUTO_TEST_CASE( test_ascii_fast_path )
+{
+    /* long enough to go through the vector loop, with the non ascii byte
+       in the vector part and in the tail */
+    string longAscii = "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_9_2)";
+    BOOST_CHECK(Utf8String::isAscii(longAscii.data(), longAscii.size()));
+    for (size_t i: { size_t(3), size_t(20), longAscii.size() - 1 }) {
+        string str = longAscii;
+        str[i] = '\xc3';
+        BOOST_CHECK(!Utf8String::isAscii(str.data(), str.size()));
+    }
+
+    Utf8String ascii(longAscii);
+    BOOST_CHECK(ascii.isAscii());
+    BOOST_CHECK_EQUAL(ascii.length(), longAscii.size());
+    BOOST_CHECK_EQUAL(ascii.toLower().rawString(),
+                      "mozilla/5.0 (macintosh; intel mac os x 10_9_2)");
+    BOOST_CHECK(ascii.toLower().isAscii());
+
+    Utf8String french("Ô Mélodie");
+    BOOST_CHECK(!french.isAscii());
+    BOOST_CHECK_EQUAL(french.length(), 9);
+    BOOST_CHECK_EQUAL(french.extractAscii(), "? M?lodie");
+
+    Utf8String empty;
+    BOOST_CHECK(empty.isAscii());
+
+    /* the flag follows the contents */
+    Utf8String str("fr");
+    str += Utf8String("-Ô");
+    BOOST_CHECK(!str.isAscii());
+    str = string("en");
+    BOOST_CHECK(str.isAscii());
+    str += "ü";
+    BOOST_CHECK(!str.isAscii());
+
+    Utf8String a("en"), b("ü");
+    swap(a, b);
+    BOOST_CHECK(!a.isAscii());
+    BOOST_CHECK(b.isAscii());
+
+    BOOST_CHECK_EQUAL(Utf8String("en-US"), Utf8String(string("en-US")));
+    BOOST_CHECK(Utf8String("en") != Utf8String("ën"));
+
+    /* invalid sequences are still caught */
+    JML_TRACE_EXCEPTIONS(false);
+    BOOST_CHECK_THROW(Utf8String(string("abc\xff")), std::exception);
+}
+
 BOOST_AUTO_TEST_CASE( test_basic_dtoa )
 {
     double value = 365.0;
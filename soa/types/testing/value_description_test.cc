@@ -524,3 +524,74 @@ BOOST_AUTO_TEST_CASE( test_date_value_description_validation )
     BOOST_CHECK_EQUAL(numChildValidations, 1);
     BOOST_CHECK_EQUAL(numParentValidations, 1);
 }
+
+/* ensure that fields are found by name whatever their number, including
+   those that come from a parent */
+
+struct ManyFields : public S1 {
+    ManyFields()
+        : f0(-1), f1(-1), f2(-1), f3(-1), f4(-1), f5(-1), f6(-1), f7(-1),
+          f8(-1), f9(-1), f10(-1), f11(-1)
+    {
+    }
+
+    int f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11;
+};
+
+CREATE_STRUCTURE_DESCRIPTION(ManyFields);
+
+ManyFieldsDescription::ManyFieldsDescription()
+{
+    addParent<S1>();
+
+    // Enough to grow the index, with names of the same length and some
+    // that are prefixes of others
+    addField("f0", &ManyFields::f0, "");
+    addField("f1", &ManyFields::f1, "");
+    addField("f2", &ManyFields::f2, "");
+    addField("f3", &ManyFields::f3, "");
+    addField("f4", &ManyFields::f4, "");
+    addField("f5", &ManyFields::f5, "");
+    addField("f6", &ManyFields::f6, "");
+    addField("f7", &ManyFields::f7, "");
+    addField("f8", &ManyFields::f8, "");
+    addField("f9", &ManyFields::f9, "");
+    addField("f10", &ManyFields::f10, "");
+    addField("f11", &ManyFields::f11, "");
+}
+
+BOOST_AUTO_TEST_CASE( test_structure_description_field_lookup )
+{
+    ManyFieldsDescription desc;
+    BOOST_CHECK_EQUAL(desc.getFieldCount(nullptr), 13);
+    BOOST_CHECK(desc.hasField(nullptr, "val1"));
+    BOOST_CHECK(desc.hasField(nullptr, "f11"));
+    BOOST_CHECK(!desc.hasField(nullptr, "f12"));
+    BOOST_CHECK(!desc.hasField(nullptr, "f"));
+    BOOST_CHECK(!desc.hasField(nullptr, ""));
+    BOOST_CHECK_EQUAL(desc.getField("f7").fieldName, "f7");
+
+    string testJson("{ \"f11\": 11, \"val1\": \"hello\", \"f1\": 1,"
+                    "  \"f10\": 10, \"f0\": 0, \"f\": 99, \"f100\": 99 }");
+    ManyFields testStruct;
+
+    StreamingJsonParsingContext context(testJson,
+                                        testJson.c_str(),
+                                        testJson.c_str()
+                                        + testJson.size());
+    int numUnknown = 0;
+    context.onUnknownFieldHandlers.push_back([&] (const ValueDescription *)
+                                             {
+                                                 ++numUnknown;
+                                                 context.skip();
+                                             });
+    desc.parseJson(&testStruct, context);
+
+    BOOST_CHECK_EQUAL(testStruct.val1, "hello");
+    BOOST_CHECK_EQUAL(testStruct.f0, 0);
+    BOOST_CHECK_EQUAL(testStruct.f1, 1);
+    BOOST_CHECK_EQUAL(testStruct.f10, 10);
+    BOOST_CHECK_EQUAL(testStruct.f11, 11);
+    BOOST_CHECK_EQUAL(testStruct.f2, -1);
+    BOOST_CHECK_EQUAL(numUnknown, 2);
+}
@@ -7,6 +7,7 @@
 #include "jml/db/persistent.h"
 
 #include <iostream>
+#include <ctype.h>
 
 using namespace std;
 
@@ -22,61 +23,311 @@ struct Init {
     }
 } init;
 
+/** Parses the URL as it always has been, adding a scheme if it has none. */
+GURL * parseUrl(std::string s)
+{
+    if (s == "")
+        return new GURL(s);
+
+    if (s.find("://") == string::npos) {
+        s = "http://" + s;
+    }
+    std::unique_ptr<GURL> url(new GURL(s));
+
+    if (url->possibly_invalid_spec().empty()) {
+        //cerr << "bad parse 1" << endl;
+        url.reset(new GURL("http://" + s));
+        if (url->possibly_invalid_spec().empty()) {
+            //cerr << "bad parse 2" << endl;
+            url.reset(new GURL("http://" + s + "/"));
+        }
+    }
+
+    return url.release();
+}
+
+/** Characters that googleurl leaves alone in a path.  '%' is checked
+    separately, as is '.' which is special in the "." and ".." segments.
+*/
+bool isPlainPathChar(char c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+        || (c >= '0' && c <= '9'))
+        return true;
+    switch (c) {
+    case '!': case '$': case '&': case '\'': case '(': case ')': case '*':
+    case '+': case ',': case '-': case '.': case '/': case ':': case ';':
+    case '=': case '@': case '[': case ']': case '_': case '~':
+        return true;
+    default:
+        return false;
+    }
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/** Whether a host label would be read as part of an IPv4 address. */
+bool isNumericLabel(const char * p, const char * e)
+{
+    if (e - p >= 2 && p[0] == '0' && p[1] == 'x') {
+        for (p += 2;  p < e;  ++p)
+            if (hexValue(*p) == -1)
+                return false;
+        return true;
+    }
+
+    for (;  p < e;  ++p)
+        if (*p < '0' || *p > '9')
+            return false;
+    return true;
 }
 
+} // file scope
+
+
+/*****************************************************************************/
+/* URL                                                                       */
+/*****************************************************************************/
+
 Url::
 Url()
-    : url(new GURL())
+    : simple(false), https(false), hostBegin(0), hostLen(0),
+      pathBegin(0), pathLen(0), queryBegin(-1), queryLen(-1), portNum(-1),
+      url(nullptr)
 {
 }
 
 Url::
 Url(const std::string & s_)
-    : original(s_)
+    : url(nullptr)
 {
-    init(original);
+    init(s_);
 }
 
 Url::
 Url(const Utf8String & s_)
-    : original(s_.rawString())
+    : url(nullptr)
 {
-    init(original);
+    init(s_.rawString());
 }
 
 Url::
 Url(const Utf32String & s_)
-        : original(s_.utf8String())
+    : url(nullptr)
+{
+    init(s_.utf8String());
+}
+
+Url::
+Url(const Url & other)
+    : url(nullptr)
+{
+    *this = other;
+}
+
+Url::
+Url(Url && other)
+    : url(nullptr)
+{
+    *this = std::move(other);
+}
+
+Url &
+Url::
+operator = (const Url & other)
+{
+    if (this == &other)
+        return *this;
+
+    original = other.original;
+    simple = other.simple;
+    https = other.https;
+    hostBegin = other.hostBegin;  hostLen = other.hostLen;
+    pathBegin = other.pathBegin;  pathLen = other.pathLen;
+    queryBegin = other.queryBegin;  queryLen = other.queryLen;
+    portNum = other.portNum;
+
+    // Copying an existing parse is cheaper than doing it again
+    GURL * otherUrl = other.url.load();
+    delete url.exchange(otherUrl ? new GURL(*otherUrl) : nullptr);
+
+    return *this;
+}
+
+Url &
+Url::
+operator = (Url && other)
 {
-    init(original);
+    if (this == &other)
+        return *this;
+
+    original = std::move(other.original);
+    simple = other.simple;
+    https = other.https;
+    hostBegin = other.hostBegin;  hostLen = other.hostLen;
+    pathBegin = other.pathBegin;  pathLen = other.pathLen;
+    queryBegin = other.queryBegin;  queryLen = other.queryLen;
+    portNum = other.portNum;
+
+    delete url.exchange(other.url.exchange(nullptr));
+    other.simple = false;
+
+    return *this;
 }
 
 void
 Url::init(std::string s)
 {
-    if (s == "") {
-        url.reset(new GURL(s));
-        return;
-    }
+    original = std::move(s);
+    delete url.exchange(nullptr);
+    simple = scan();
+}
 
-    if (s.find("://") == string::npos) {
-        s = "http://" + s;
+bool
+Url::
+scan()
+{
+    const char * start = original.c_str();
+    const char * end = start + original.size();
+
+    // googleurl would strip or escape any of these
+    if (start == end)
+        return false;
+    for (const char * p = start;  p < end;  ++p)
+        if (*p <= ' ' || *p >= 127)
+            return false;
+
+    const char * p = start;
+    if (original.compare(0, 7, "http://") == 0) {
+        https = false;
+        p += 7;
     }
-    url.reset(new GURL(s));
-
-    if (url->possibly_invalid_spec().empty()) {
-        //cerr << "bad parse 1" << endl;
-        url.reset(new GURL("http://" + s));
-        if (url->possibly_invalid_spec().empty()) {
-            //cerr << "bad parse 2" << endl;
-            url.reset(new GURL("http://" + s + "/"));
+    else if (original.compare(0, 8, "https://") == 0) {
+        https = true;
+        p += 8;
+    }
+    else if (original.find("://") != string::npos)
+        return false;
+    else https = false;  // we'll assume http:// like parseUrl does
+
+    // Host: lower case names only, as IP addresses, IDNs and user info are
+    // rewritten
+    const char * host = p;
+    const char * label = p;
+    bool allNumeric = true;
+    for (;  p < end && *p != ':' && *p != '/' && *p != '?' && *p != '#';  ++p) {
+        char c = *p;
+        if (c == '.') {
+            if (p == label)
+                return false;
+            allNumeric = allNumeric && isNumericLabel(label, p);
+            label = p + 1;
+        }
+        else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                   || c == '-'))
+            return false;
+    }
+    if (p == label)
+        return false;
+    allNumeric = allNumeric && isNumericLabel(label, p);
+    if (allNumeric)
+        return false;
+    hostBegin = host - start;
+    hostLen = p - host;
+
+    // Port: leading zeros and the scheme's default port are removed
+    portNum = -1;
+    if (p < end && *p == ':') {
+        const char * digits = ++p;
+        int value = 0;
+        for (;  p < end && *p >= '0' && *p <= '9';  ++p) {
+            if (p - digits == 5)
+                return false;
+            value = value * 10 + (*p - '0');
+        }
+        if (p == digits || *digits == '0' || value > 65535)
+            return false;
+        if (value != (https ? 443 : 80))
+            portNum = value;
+    }
+    if (p < end && *p != '/' && *p != '?' && *p != '#')
+        return false;
+
+    // Path: no dot segments, and only the escapes that are kept as they are
+    const char * path = p;
+    const char * segment = p;
+    for (;  p <= end;  ++p) {
+        char c = (p < end ? *p : 0);
+        if (c == '/' || c == '?' || c == '#' || c == 0) {
+            int len = p - segment;
+            if (segment < p && segment[0] == '.'
+                && (len == 1 || (len == 2 && segment[1] == '.')))
+                return false;
+            if (c != '/')
+                break;
+            segment = p + 1;
         }
+        else if (c == '%') {
+            if (end - p < 3)
+                return false;
+            int hi = hexValue(p[1]), lo = hexValue(p[2]);
+            if (hi == -1 || lo == -1)
+                return false;
+            // Unreserved characters are unescaped
+            unsigned char decoded = hi * 16 + lo;
+            if (decoded == 0 || isalnum(decoded) || decoded == '-'
+                || decoded == '.' || decoded == '_' || decoded == '~')
+                return false;
+            p += 2;
+        }
+        else if (!isPlainPathChar(c))
+            return false;
+    }
+    pathBegin = path - start;
+    pathLen = p - path;
+
+    // Query: printable characters except the ones that get escaped
+    queryBegin = queryLen = -1;
+    if (p < end && *p == '?') {
+        const char * query = ++p;
+        for (;  p < end && *p != '#';  ++p)
+            if (*p == '"' || *p == '<' || *p == '>')
+                return false;
+        queryBegin = query - start;
+        queryLen = p - query;
     }
+
+    // The fragment is never rewritten in a way that matters here
+
+    return true;
 }
 
 Url::
 ~Url()
 {
+    delete url.load();
+}
+
+const GURL &
+Url::
+gurl() const
+{
+    GURL * result = url.load();
+    if (result)
+        return *result;
+
+    // Another thread may get there first; if so we use theirs
+    GURL * parsed = parseUrl(original);
+    if (url.compare_exchange_strong(result, parsed))
+        return *parsed;
+    delete parsed;
+    return *result;
 }
 
 std::string
@@ -102,7 +353,7 @@ Url::
 c_str() const
 {
     if (valid())
-        return url->spec().c_str();
+        return gurl().spec().c_str();
     return original.c_str();
 }
 
@@ -110,14 +361,14 @@ bool
 Url::
 valid() const
 {
-    return url->is_valid();
+    return simple || gurl().is_valid();
 }
 
 bool
 Url::
 empty() const
 {
-    return url->is_empty();
+    return !simple && gurl().is_empty();
 }
 
 std::string
@@ -125,72 +376,101 @@ Url::
 canonical() const
 {
     if (!valid()) return "";
-    return url->spec();
+    return gurl().spec();
 }
 
 std::string
 Url::
 scheme() const
 {
-    return url->scheme();
+    if (simple)
+        return https ? "https" : "http";
+    return gurl().scheme();
 }
 
 std::string
 Url::
 username() const
 {
-    return url->username();
+    if (simple)
+        return "";
+    return gurl().username();
 }
 
 std::string
 Url::
 password() const
 {
-    return url->password();
+    if (simple)
+        return "";
+    return gurl().password();
 }
 
 std::string
 Url::
 host() const
 {
-    return url->host();
+    if (simple)
+        return original.substr(hostBegin, hostLen);
+    return gurl().host();
 }
 
 bool
 Url::
 hostIsIpAddress() const
 {
-    return url->HostIsIPAddress();
+    return !simple && gurl().HostIsIPAddress();
 }
 
 bool
 Url::
 domainMatches(const std::string & str) const
 {
-    return url->DomainIs(str.c_str(), str.length());
+    if (!simple)
+        return gurl().DomainIs(str.c_str(), str.length());
+
+    // Same as GURL::DomainIs; our host is lower case with no trailing dot
+    int len = str.length();
+    if (len == 0 || hostLen < len)
+        return false;
+
+    const char * start = original.c_str() + hostBegin + hostLen - len;
+    if (str.compare(0, len, start, len) != 0)
+        return false;
+
+    // www.google.com is in google.com, but www.iamnotgoogle.com isn't
+    return str[0] == '.' || hostLen == len || start[-1] == '.';
 }
 
 int
 Url::
 port() const
 {
-    return url->IntPort();
+    if (simple)
+        return portNum;
+    return gurl().IntPort();
 }
 
 std::string
 Url::
 path() const
 {
-    if (url->scheme() == "file")
-        return url->host() + url->path();
-    else return url->path();
+    if (simple)
+        return pathLen ? original.substr(pathBegin, pathLen) : "/";
+
+    const GURL & parsed = gurl();
+    if (parsed.scheme() == "file")
+        return parsed.host() + parsed.path();
+    else return parsed.path();
 }
 
 std::string
 Url::
 query() const
 {
-    return url->query();
+    if (simple)
+        return queryBegin == -1 ? "" : original.substr(queryBegin, queryLen);
+    return gurl().query();
 }
 
 uint64_t
@@ -9,6 +9,7 @@
 
 #include <string>
 #include <memory>
+#include <atomic>
 #include "jml/db/persistent_fwd.h"
 #include "string.h"
 
@@ -16,13 +17,28 @@ class GURL;
 
 namespace Datacratic {
 
+/*****************************************************************************/
+/* URL                                                                       */
+/*****************************************************************************/
+
+/** A URL.  Construction only scans the string for where its components are;
+    if they are already in canonical form, the accessors answer from there.
+    The full googleurl parse is only done when something needs it, such as
+    the canonical form or a URL that isn't that simple.
+*/
+
 struct Url {
     Url();
     explicit Url(const std::string & s);
     explicit Url(const Utf8String & s);
     explicit Url(const Utf32String & s);
+    Url(const Url & other);
+    Url(Url && other);
     ~Url();
 
+    Url & operator = (const Url & other);
+    Url & operator = (Url && other);
+
     void init(std::string s);
 
     Utf8String toUtf8String() const;
@@ -47,11 +63,30 @@ struct Url {
     uint64_t urlHash();
     uint64_t hostHash();
 
-    std::shared_ptr<GURL> url;
+    /** The fully parsed URL, which is created the first time it's asked
+        for.
+    */
+    const GURL & gurl() const;
+
     std::string original;
 
     void serialize(ML::DB::Store_Writer & store) const;
     void reconstitute(ML::DB::Store_Reader & store);
+
+private:
+    /** Scans original and records its components if it is a http or https
+        URL that googleurl wouldn't change.  Returns false if it isn't.
+    */
+    bool scan();
+
+    bool simple;       ///< The components below are filled in
+    bool https;        ///< Scheme is https rather than http
+    int hostBegin, hostLen;
+    int pathBegin, pathLen;
+    int queryBegin, queryLen;    ///< queryBegin is -1 if there is no query
+    int portNum;                 ///< -1 if it is the default port
+
+    mutable std::atomic<GURL *> url;
 };
 
 inline std::ostream & operator << (std::ostream & stream, const Url & url)
@@ -12,6 +12,8 @@
 #include <memory>
 #include <unordered_map>
 #include <set>
+#include <deque>
+#include <cstring>
 #include "jml/arch/exception.h"
 #include "jml/arch/demangle.h"
 #include "jml/arch/demangle.h"
@@ -787,10 +789,76 @@ struct StructureDescriptionBase {
     typedef std::map<const char *, FieldDescription, StrCompare> Fields;
     Fields fields;
 
-    std::vector<std::string> fieldNames;
+    /// Owns the names the fields are keyed by, so they must not move
+    std::deque<std::string> fieldNames;
 
     std::vector<Fields::const_iterator> orderedFields;
 
+    /** Open addressed hash table of the fields, used to find each member
+        while parsing without walking the map and comparing strings along
+        the way.  It has a power of two size and is at most half full.
+    */
+    struct IndexEntry {
+        const char * name;           ///< null if the slot is empty
+        unsigned length;
+        unsigned hash;
+        const FieldDescription * field;
+    };
+
+    std::vector<IndexEntry> fieldIndex;
+
+    static unsigned hashFieldName(const char * name, unsigned & length)
+    {
+        unsigned hash = 5381;
+        const char * p = name;
+        for (;  *p;  ++p)
+            hash = hash * 33 + (unsigned char)*p;
+        length = p - name;
+        return hash;
+    }
+
+    /** Rebuild the index once the fields have changed. */
+    void indexFields()
+    {
+        size_t size = 8;
+        while (size < fields.size() * 2)
+            size *= 2;
+
+        fieldIndex.clear();
+        fieldIndex.resize(size, IndexEntry{ nullptr, 0, 0, nullptr });
+
+        for (auto & f: fields) {
+            IndexEntry entry;
+            entry.name = f.second.fieldName.c_str();
+            entry.hash = hashFieldName(entry.name, entry.length);
+            entry.field = &f.second;
+
+            size_t i = entry.hash & (size - 1);
+            while (fieldIndex[i].name)
+                i = (i + 1) & (size - 1);
+            fieldIndex[i] = entry;
+        }
+    }
+
+    const FieldDescription * findField(const char * name) const
+    {
+        if (fieldIndex.empty())
+            return nullptr;
+
+        unsigned length;
+        unsigned hash = hashFieldName(name, length);
+        size_t mask = fieldIndex.size() - 1;
+
+        for (size_t i = hash & mask;  fieldIndex[i].name;  i = (i + 1) & mask) {
+            const IndexEntry & entry = fieldIndex[i];
+            if (entry.hash == hash && entry.length == length
+                && memcmp(entry.name, name, length) == 0)
+                return entry.field;
+        }
+
+        return nullptr;
+    }
+
     struct Exception: public ML::Exception {
         Exception(JsonParsingContext & context,
                   const std::string & message)
@@ -821,14 +889,13 @@ struct StructureDescriptionBase {
                 {
                     try {
                         auto n = context.fieldNamePtr();
-                        auto it = fields.find(n);
-                        if (it == fields.end()) {
+                        auto field = findField(n);
+                        if (!field) {
                             context.onUnknownField(owner);
                         }
                         else {
-                            it->second.description
-                                ->parseJson(addOffset(output,
-                                                      it->second.offset),
+                            field->description
+                                ->parseJson(addOffset(output, field->offset),
                                             context);
                         }
                     }
@@ -977,6 +1044,7 @@ struct StructureDescription
         fd.offset = (size_t)&(p->*field);
         fd.fieldNum = fields.size() - 1;
         orderedFields.push_back(it);
+        indexFields();
         //using namespace std;
         //cerr << "offset = " << fd.offset << endl;
     }
@@ -1006,10 +1074,7 @@ struct StructureDescription
     virtual const FieldDescription *
     hasField(const void * val, const std::string & field) const
     {
-        auto it = fields.find(field.c_str());
-        if (it != fields.end())
-            return &it->second;
-        return nullptr;
+        return findField(field.c_str());
     }
 
     virtual void forEachField(const void * val,
@@ -1023,9 +1088,9 @@ struct StructureDescription
     virtual const FieldDescription & 
     getField(const std::string & field) const
     {
-        auto it = fields.find(field.c_str());
-        if (it != fields.end())
-            return it->second;
+        auto result = findField(field.c_str());
+        if (result)
+            return *result;
         throw ML::Exception("structure has no field " + field);
     }
 
@@ -1119,6 +1184,8 @@ addParent(ValueDescriptionT<V> * description_)
         fd.fieldNum = fields.size() - 1;
         orderedFields.push_back(it);
     }
+
+    indexFields();
 }
 
 
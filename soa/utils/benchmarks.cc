@@ -1,5 +1,15 @@
 #include "benchmarks.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 using namespace std;
 using namespace Datacratic;
 
@@ -42,3 +52,423 @@ clear()
     Guard lock(dataLock_);
     data_.clear();
 }
+
+
+/* PERF COUNTERS */
+
+namespace {
+
+int
+openCounter(uint32_t type, uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attr, 0 /* this thread */,
+                   -1 /* any cpu */, groupFd, 0);
+}
+
+} // file scope
+
+PerfCounters::
+PerfCounters()
+{
+    static const uint64_t configs[DTLB_MISSES] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    leader_ = -1;
+    for (int i = 0;  i < DTLB_MISSES;  ++i) {
+        fds_[i] = openCounter(PERF_TYPE_HARDWARE, configs[i], leader_);
+        if (leader_ == -1)
+            leader_ = fds_[i];
+    }
+
+    // Cache events aren't supported by every PMU, and one that can't be
+    // scheduled would keep the whole group from counting, so this one is
+    // opened on its own.
+    fds_[DTLB_MISSES]
+        = openCounter(PERF_TYPE_HW_CACHE,
+                      PERF_COUNT_HW_CACHE_DTLB
+                      | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                      -1);
+}
+
+PerfCounters::
+~PerfCounters()
+{
+    for (int fd: fds_) {
+        if (fd != -1)
+            ::close(fd);
+    }
+}
+
+bool
+PerfCounters::
+available() const
+{
+    return leader_ != -1;
+}
+
+bool
+PerfCounters::
+available(Counter counter) const
+{
+    return fds_[counter] != -1;
+}
+
+void
+PerfCounters::
+start()
+{
+    if (leader_ == -1)
+        return;
+    ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    if (fds_[DTLB_MISSES] != -1) {
+        ioctl(fds_[DTLB_MISSES], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds_[DTLB_MISSES], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void
+PerfCounters::
+stop()
+{
+    if (leader_ == -1)
+        return;
+    ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (fds_[DTLB_MISSES] != -1)
+        ioctl(fds_[DTLB_MISSES], PERF_EVENT_IOC_DISABLE, 0);
+}
+
+PerfCounters::Values
+PerfCounters::
+read() const
+{
+    Values result;
+    for (int i = 0;  i < NUM_COUNTERS;  ++i) {
+        uint64_t value = 0;
+        if (fds_[i] != -1 && ::read(fds_[i], &value, sizeof(value)) != sizeof(value))
+            value = 0;
+        result[i] = value;
+    }
+    return result;
+}
+
+const char *
+PerfCounters::
+name(Counter counter)
+{
+    switch (counter) {
+    case CYCLES: return "cycles";
+    case INSTRUCTIONS: return "instructions";
+    case CACHE_MISSES: return "cacheMisses";
+    case BRANCH_MISSES: return "branchMisses";
+    case DTLB_MISSES: return "dtlbMisses";
+    default: return "unknown";
+    }
+}
+
+
+/* BENCHMARK RESULT */
+
+BenchmarkResult::
+BenchmarkResult()
+    : iterations(0), stable(false),
+      min(0), median(0), p90(0), p99(0), mean(0), stddev(0)
+{
+}
+
+double
+BenchmarkResult::
+percentile(vector<double> sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Linear interpolation between the two closest ranks
+    double rank = p * (sorted.size() - 1);
+    size_t below = rank;
+    if (below + 1 >= sorted.size())
+        return sorted.back();
+    double fraction = rank - below;
+    return sorted[below] + fraction * (sorted[below + 1] - sorted[below]);
+}
+
+void
+BenchmarkResult::
+computeStats()
+{
+    if (samples.empty())
+        return;
+
+    vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+
+    min = sorted.front();
+    median = percentile(sorted, 0.5);
+    p90 = percentile(sorted, 0.9);
+    p99 = percentile(sorted, 0.99);
+
+    double total = 0;
+    for (double sample: samples)
+        total += sample;
+    mean = total / samples.size();
+
+    double squares = 0;
+    for (double sample: samples)
+        squares += (sample - mean) * (sample - mean);
+    stddev = samples.size() > 1 ? sqrt(squares / (samples.size() - 1)) : 0;
+}
+
+double
+BenchmarkResult::
+medianError() const
+{
+    if (samples.size() < 2)
+        return INFINITY;
+
+    vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    double med = percentile(sorted, 0.5);
+    if (med <= 0)
+        return INFINITY;
+
+    vector<double> deviations;
+    deviations.reserve(sorted.size());
+    for (double sample: sorted)
+        deviations.push_back(fabs(sample - med));
+
+    // The MAD scaled to a standard deviation, then the standard error of the
+    // median which is sqrt(pi / 2) times the one of the mean; the MAD is used
+    // so that a few samples disturbed by the rest of the system don't count.
+    double sigma = 1.4826 * percentile(deviations, 0.5);
+    return 1.2533 * sigma / sqrt(samples.size()) / med;
+}
+
+Json::Value
+BenchmarkResult::
+toJson() const
+{
+    Json::Value result;
+    result["name"] = name;
+    result["iterations"] = Json::UInt(iterations);
+    result["numSamples"] = Json::UInt(samples.size());
+    result["stable"] = stable;
+    result["min"] = min;
+    result["median"] = median;
+    result["p90"] = p90;
+    result["p99"] = p99;
+    result["mean"] = mean;
+    result["stddev"] = stddev;
+
+    Json::Value & values = result["samples"];
+    values = Json::Value(Json::arrayValue);
+    for (double sample: samples)
+        values.append(sample);
+
+    if (!counters.empty()) {
+        Json::Value & perf = result["counters"];
+        for (const auto & entry: counters)
+            perf[entry.first] = entry.second;
+    }
+
+    return result;
+}
+
+BenchmarkResult
+BenchmarkResult::
+fromJson(const Json::Value & json)
+{
+    BenchmarkResult result;
+    result.name = json["name"].asString();
+    result.iterations = json["iterations"].asUInt();
+    result.stable = json["stable"].asBool();
+    for (const auto & sample: json["samples"])
+        result.samples.push_back(sample.asDouble());
+
+    const Json::Value & perf = json["counters"];
+    for (auto it = perf.begin(), end = perf.end();  it != end;  ++it)
+        result.counters[it.memberName()] = it->asDouble();
+
+    result.computeStats();
+    return result;
+}
+
+
+/* BENCHMARK RUNNER */
+
+BenchmarkRunner::
+BenchmarkRunner()
+    : warmupTime(0.1), sampleTime(0.01),
+      minSamples(10), maxSamples(200), maxTime(5.0),
+      tolerance(0.01), useCounters(true)
+{
+}
+
+const BenchmarkResult *
+BenchmarkRunner::
+runBatches(const string & name, const function<void (uint64_t)> & fn)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    if (!filter.empty() && name.find(filter) == string::npos)
+        return nullptr;
+
+    auto elapsed = [] (Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    if (useCounters && !counters_)
+        counters_.reset(new PerfCounters());
+    PerfCounters * perf = useCounters && counters_->available()
+        ? counters_.get() : nullptr;
+
+    BenchmarkResult result;
+    result.name = name;
+
+    // Warm up while growing the batch until it takes about sampleTime
+    uint64_t iterations = 1;
+    Clock::time_point warmupStart = Clock::now();
+    for (;;) {
+        Clock::time_point start = Clock::now();
+        fn(iterations);
+        double batchTime = elapsed(start);
+
+        if (batchTime < sampleTime) {
+            double factor = batchTime > 0 ? sampleTime / batchTime : 10.0;
+            iterations = std::max<uint64_t>(iterations + 1,
+                                            iterations * std::min(factor, 10.0));
+        }
+        else if (elapsed(warmupStart) >= warmupTime)
+            break;
+    }
+    result.iterations = iterations;
+
+    // Sample until the median is known well enough
+    PerfCounters::Values totals = {};
+    Clock::time_point samplingStart = Clock::now();
+    while (result.samples.size() < maxSamples) {
+        if (perf)
+            perf->start();
+        Clock::time_point start = Clock::now();
+        fn(iterations);
+        double batchTime = elapsed(start);
+        if (perf) {
+            perf->stop();
+            auto values = perf->read();
+            for (int i = 0;  i < PerfCounters::NUM_COUNTERS;  ++i)
+                totals[i] += values[i];
+        }
+
+        result.samples.push_back(batchTime * 1e9 / iterations);
+
+        if (result.samples.size() >= minSamples) {
+            if (result.medianError() < tolerance) {
+                result.stable = true;
+                break;
+            }
+            if (elapsed(samplingStart) >= maxTime)
+                break;
+        }
+    }
+
+    result.computeStats();
+
+    if (perf) {
+        double total = double(iterations) * result.samples.size();
+        for (int i = 0;  i < PerfCounters::NUM_COUNTERS;  ++i) {
+            auto counter = PerfCounters::Counter(i);
+            if (perf->available(counter))
+                result.counters[PerfCounters::name(counter)] = totals[i] / total;
+        }
+    }
+
+    results.emplace_back(std::move(result));
+    return &results.back();
+}
+
+void
+BenchmarkRunner::
+dump(ostream & out) const
+{
+    out << left << setw(32) << "benchmark" << right
+        << setw(12) << "median ns" << setw(12) << "p90 ns"
+        << setw(12) << "p99 ns" << setw(10) << "error"
+        << setw(9) << "samples" << "  counters/op" << endl;
+
+    for (const auto & result: results) {
+        out << left << setw(32) << result.name << right << fixed
+            << setprecision(2)
+            << setw(12) << result.median << setw(12) << result.p90
+            << setw(12) << result.p99
+            << setw(9) << result.medianError() * 100 << "%"
+            << setw(8) << result.samples.size() << (result.stable ? " " : "?");
+        for (const auto & counter: result.counters)
+            out << " " << counter.first << "=" << counter.second;
+        out << endl;
+    }
+}
+
+Json::Value
+BenchmarkRunner::
+toJson() const
+{
+    Json::Value result;
+    Json::Value & benchmarks = result["benchmarks"];
+    benchmarks = Json::Value(Json::arrayValue);
+    for (const auto & item: results)
+        benchmarks.append(item.toJson());
+    return result;
+}
+
+vector<string>
+BenchmarkRunner::
+compare(const Json::Value & baseline, double threshold, ostream & out) const
+{
+    map<string, BenchmarkResult> previous;
+    for (const auto & item: baseline["benchmarks"]) {
+        auto result = BenchmarkResult::fromJson(item);
+        previous[result.name] = std::move(result);
+    }
+
+    vector<string> regressions;
+    for (const auto & result: results) {
+        auto it = previous.find(result.name);
+        if (it == previous.end()) {
+            out << result.name << ": not in the baseline" << endl;
+            continue;
+        }
+
+        const BenchmarkResult & before = it->second;
+        if (before.median <= 0)
+            continue;
+
+        // Changes within the noise of either run aren't regressions
+        double ratio = result.median / before.median;
+        double noise = result.medianError() + before.medianError();
+        bool regressed = ratio > 1.0 + std::max(threshold, noise);
+
+        out << result.name << ": " << fixed << setprecision(2)
+            << before.median << "ns -> " << result.median << "ns ("
+            << showpos << (ratio - 1.0) * 100 << noshowpos << "%)"
+            << (regressed ? " REGRESSION" : "") << endl;
+
+        if (regressed)
+            regressions.push_back(result.name);
+    }
+
+    return regressions;
+}
@@ -2,21 +2,23 @@
     Wolfgang Sourdeau, 13 April 2014
     Copyright (c) 2014 Datacratic Inc.  All rights reserved.
 
-    Simple utility class to benchmark operations easily.
-
-    Possible improvements:
-    - statistics
+    Simple utility class to benchmark operations easily, and a harness to
+    measure the cost of small operations with some statistical confidence.
 */
 
 #pragma once
 
+#include <array>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
 #include "soa/types/date.h"
+#include "soa/jsoncpp/json.h"
 
 
 namespace Datacratic {
@@ -86,4 +88,169 @@ struct Benchmark {
     Date start_;
 };
 
+
+/****************************************************************************/
+/* DO NOT OPTIMIZE                                                          */
+/****************************************************************************/
+
+/* Keeps the compiler from optimizing away the computation of a value that a
+   benchmarked operation produces but nobody uses. */
+
+template<typename T>
+inline void doNotOptimize(const T & value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+/****************************************************************************/
+/* PERF COUNTERS                                                            */
+/****************************************************************************/
+
+/* Hardware counters of the calling thread, read through perf_event_open(2).
+   The events are opened as a group so that the kernel always schedules them
+   together.  Those the kernel refuses us (no PMU in a VM, a restrictive
+   perf_event_paranoid...) simply read as zero, and available() tells
+   whether any could be opened. */
+
+struct PerfCounters {
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        DTLB_MISSES,        // data TLB load misses
+        NUM_COUNTERS
+    };
+
+    typedef std::array<uint64_t, NUM_COUNTERS> Values;
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters & other) = delete;
+    PerfCounters & operator = (const PerfCounters & other) = delete;
+
+    bool available() const;
+    bool available(Counter counter) const;
+
+    /* Resets the counters and starts counting. */
+    void start();
+
+    /* Stops counting; read() then returns the counts since start(). */
+    void stop();
+
+    Values read() const;
+
+    static const char * name(Counter counter);
+
+private:
+    int fds_[NUM_COUNTERS];
+    int leader_;
+};
+
+
+/****************************************************************************/
+/* BENCHMARK RESULT                                                         */
+/****************************************************************************/
+
+/* Timings of one benchmark: each sample is the mean time of one iteration
+   over a batch of iterations. */
+
+struct BenchmarkResult {
+    BenchmarkResult();
+
+    std::string name;
+    uint64_t iterations;            // per sample
+    std::vector<double> samples;    // nanoseconds per iteration
+    bool stable;                    // whether the median converged
+
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double mean;
+    double stddev;
+
+    /* Hardware counters per iteration, by name; empty without counters. */
+    std::map<std::string, double> counters;
+
+    /* Computes the statistics from the samples. */
+    void computeStats();
+
+    /* Relative standard error of the median of the samples. */
+    double medianError() const;
+
+    Json::Value toJson() const;
+    static BenchmarkResult fromJson(const Json::Value & json);
+
+    static double percentile(std::vector<double> sorted, double p);
+};
+
+
+/****************************************************************************/
+/* BENCHMARK RUNNER                                                         */
+/****************************************************************************/
+
+/* Runs operations repeatedly to measure how long one takes:
+   - the operation first runs for warmupTime seconds, which is also used to
+     find how many iterations make a sample of about sampleTime seconds;
+   - samples are then taken until the relative standard error of their
+     median goes under tolerance, with at least minSamples and at most
+     maxSamples of them or maxTime seconds;
+   - the hardware counters, when they're available, are read around each
+     sample.
+
+   The results can be written as JSON and compared against the JSON of an
+   earlier run to find regressions. */
+
+struct BenchmarkRunner {
+    BenchmarkRunner();
+
+    double warmupTime;
+    double sampleTime;
+    size_t minSamples;
+    size_t maxSamples;
+    double maxTime;
+    double tolerance;
+    bool useCounters;
+
+    /* Only the benchmarks whose name contains this string are run. */
+    std::string filter;
+
+    /* Benchmarks fn, which performs one iteration of the operation.  Returns
+       null when the benchmark is filtered out. */
+    template<typename Fn>
+    const BenchmarkResult * run(const std::string & name, Fn && fn)
+    {
+        return runBatches(name, [&] (uint64_t n) {
+                for (uint64_t i = 0;  i < n;  ++i)
+                    fn();
+            });
+    }
+
+    /* Same as run() but fn performs the given number of iterations, which
+       allows for setting up the state of each batch. */
+    const BenchmarkResult *
+    runBatches(const std::string & name,
+               const std::function<void (uint64_t)> & fn);
+
+    std::vector<BenchmarkResult> results;
+
+    /* Prints a table of the results. */
+    void dump(std::ostream & out = std::cerr) const;
+
+    Json::Value toJson() const;
+
+    /* Prints how the median of each benchmark compares to the one of the
+       baseline, as written by toJson(), and returns the names of those that
+       are slower by more than the threshold ratio. */
+    std::vector<std::string>
+    compare(const Json::Value & baseline, double threshold = 0.1,
+            std::ostream & out = std::cerr) const;
+
+private:
+    std::unique_ptr<PerfCounters> counters_;
+};
+
 } // namespace Datacratic
@@ -9,6 +9,7 @@
 #include "cryptopp/crc.h"
 #include "cryptopp/osrng.h"
 #include "cryptopp/aes.h"
+#include "jml/arch/exception.h"
 #include <iostream>
 
 using namespace std; 
@@ -24,9 +25,50 @@ namespace Datacratic {
  * Used to encrypt and decrypt passbacks in exchange connector
 */
 
+struct StringEncryption::Contexts {
+    Contexts(const string & key, const string & iv) {
+        const byte * bk = reinterpret_cast<const byte *>(key.c_str());
+        const byte * biv =  reinterpret_cast<const byte *>(iv.c_str());
+
+        encryption.SetKeyWithIV(bk, AES::DEFAULT_KEYLENGTH, biv);
+        decryption.SetKeyWithIV(bk, AES::DEFAULT_KEYLENGTH, biv);
+    }
+
+    CFB_Mode<AES>::Encryption encryption;
+    CFB_Mode<AES>::Decryption decryption;
+    HexEncoder hexEncoder;
+    HexDecoder hexDecoder;
+};
+
 StringEncryption::StringEncryption() : hexEncoder(), hexDecoder() {
 }
 
+StringEncryption::StringEncryption(const string & key, const string & iv)
+    : hexEncoder(), hexDecoder(), key_(key), iv_(iv) {
+    if (key.size() < AES::DEFAULT_KEYLENGTH)
+        throw ML::Exception("passback key must be at least %d bytes long",
+                            (int)AES::DEFAULT_KEYLENGTH);
+    if (iv.size() < AES::BLOCKSIZE)
+        throw ML::Exception("passback iv must be at least %d bytes long",
+                            (int)AES::BLOCKSIZE);
+}
+
+StringEncryption::~StringEncryption() {
+}
+
+StringEncryption::Contexts &
+StringEncryption::getContexts() {
+    if (key_.empty())
+        throw ML::Exception("StringEncryption was constructed without a key");
+
+    Contexts * result = contexts.get();
+    if (!result) {
+        result = new Contexts(key_, iv_);
+        contexts.reset(result);
+    }
+    return *result;
+}
+
 string
 StringEncryption::encrypt(const string & passback, const string & key, const string & iv) {
     const byte * bk = reinterpret_cast<const byte *>(key.c_str());
@@ -38,7 +80,7 @@ StringEncryption::encrypt(const string & passback, const string & key, const str
     byte pEnc[passback.size()];
     stfE.Get(pEnc, passback.size());
     string cipher(pEnc, pEnc + passback.size());
-    return addDigest(cipher);
+    return addDigest(hexEncoder, cipher);
 }
 
 string
@@ -46,7 +88,7 @@ StringEncryption::decrypt(const string & passback, const string & key, const str
     const byte * bk = reinterpret_cast<const byte *>(key.c_str());
     const byte * biv =  reinterpret_cast<const byte *>(iv.c_str());
 
-    string noDigest = removeDigest(hexDecode(passback));
+    string noDigest = removeDigest(hexDecode(hexDecoder, passback));
     if (noDigest == "")
         return "";
 
@@ -59,8 +101,44 @@ StringEncryption::decrypt(const string & passback, const string & key, const str
     return recovered;
 }
 
-string StringEncryption::addDigest(const string & encrypted) {
-    return hexEncode(encrypted) + hexEncode(digest(encrypted));
+string
+StringEncryption::encrypt(const string & passback) {
+    Contexts & c = getContexts();
+
+    // Only the iv needs resetting; the key schedule is kept
+    c.encryption.Resynchronize(reinterpret_cast<const byte *>(iv_.c_str()));
+
+    string cipher(passback.size(), '\0');
+    c.encryption.ProcessData((byte *) &cipher[0],
+                             (const byte *) passback.c_str(), passback.size());
+    return addDigest(c.hexEncoder, cipher);
+}
+
+string
+StringEncryption::decrypt(const string & passback) {
+    Contexts & c = getContexts();
+
+    string recovered = removeDigest(hexDecode(c.hexDecoder, passback));
+    if (recovered == "")
+        return "";
+
+    c.decryption.Resynchronize(reinterpret_cast<const byte *>(iv_.c_str()));
+    c.decryption.ProcessData((byte *) &recovered[0],
+                             (const byte *) recovered.c_str(), recovered.size());
+    return recovered;
+}
+
+vector<string>
+StringEncryption::decrypt(const vector<string> & passbacks) {
+    vector<string> result;
+    result.reserve(passbacks.size());
+    for (auto & passback: passbacks)
+        result.emplace_back(decrypt(passback));
+    return result;
+}
+
+string StringEncryption::addDigest(HexEncoder & encoder, const string & encrypted) {
+    return hexEncode(encoder, encrypted) + hexEncode(encoder, digest(encrypted));
 }
 
 string StringEncryption::removeDigest(const string & digested) {
@@ -88,21 +166,21 @@ string StringEncryption::digest(const string & encrypted) {
 }
 
 string
-StringEncryption::hexEncode(const string & decoded) {
-    hexEncoder.Put((const byte *)decoded.c_str(), decoded.size());
+StringEncryption::hexEncode(HexEncoder & encoder, const string & decoded) {
+    encoder.Put((const byte *)decoded.c_str(), decoded.size());
     size_t dLen = decoded.size() * 2;
     byte outBuf[dLen];
-    hexEncoder.Get(outBuf, dLen);
+    encoder.Get(outBuf, dLen);
     string encoded(outBuf, outBuf + dLen);
     return encoded;
 }
     
 string
-StringEncryption::hexDecode(const string & encoded) {
-    hexDecoder.Put((const byte *)encoded.c_str(), encoded.size());
+StringEncryption::hexDecode(HexDecoder & decoder, const string & encoded) {
+    decoder.Put((const byte *)encoded.c_str(), encoded.size());
     size_t eLen = encoded.size() / 2;
     byte outBuf[eLen];
-    hexDecoder.Get(outBuf, eLen);
+    decoder.Get(outBuf, eLen);
     string decoded(outBuf, outBuf + eLen);
     return decoded;
 }
@@ -114,7 +192,7 @@ StringEncryption::generateKey() {
     byte key[size];
     rnd.GenerateBlock(key, size);
     string sKey(key, key + size - 1);
-    return hexEncode(sKey);
+    return hexEncode(hexEncoder, sKey);
 }
 
 string
@@ -124,7 +202,7 @@ StringEncryption::generateIV() {
     byte iv[size];
     rnd.GenerateBlock(iv, size);
     string sIv(iv, iv + size - 1);
-    return hexEncode(sIv);
+    return hexEncode(hexEncoder, sIv);
 }
 
 } // namespace Datacratic
@@ -7,6 +7,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <boost/thread/tss.hpp>
 #include "cryptopp/hex.h"
 
 namespace Datacratic {
@@ -17,6 +19,10 @@ namespace Datacratic {
 
 /**
  * Used to encrypt and decrypt passbacks in exchange connector
+ *
+ * The key and iv can either be given with each call, which sets up the
+ * cipher each time, or once to the constructor, in which case each thread
+ * keeps a cipher keyed for them and only resets its iv between calls.
 */
 
 struct StringEncryption {
@@ -25,6 +31,13 @@ struct StringEncryption {
     
     StringEncryption();
 
+    /** Loads the key and iv used by the calls that don't take them.  Both
+        must be at least 16 bytes long.
+    */
+    StringEncryption(const std::string & key, const std::string & iv);
+
+    ~StringEncryption();
+
     std::string generateKey();
 
     std::string generateIV();
@@ -36,22 +49,45 @@ struct StringEncryption {
     std::string decrypt(const std::string & passback,
                         const std::string & key,
                         const std::string & iv);
+
+    /** Same as above with the key and iv given to the constructor. */
+    std::string encrypt(const std::string & passback);
+
+    std::string decrypt(const std::string & passback);
+
+    /** Decrypts a batch of passbacks with the key and iv given to the
+        constructor.  As with decrypt(), those that don't match their
+        digest come out as empty strings.
+    */
+    std::vector<std::string>
+    decrypt(const std::vector<std::string> & passbacks);
+
 private: 
 
     CryptoPP::HexEncoder hexEncoder;
     CryptoPP::HexDecoder hexDecoder;
 
-    std::string digest(const std::string & encrypted);
+    std::string key_;
+    std::string iv_;
+
+    /// Ciphers and hex coders of each thread, for key_ and iv_
+    struct Contexts;
+    boost::thread_specific_ptr<Contexts> contexts;
+
+    Contexts & getContexts();
 
-    std::string addDigest(const std::string & encrypted);
+    static std::string digest(const std::string & encrypted);
 
-    std::string removeDigest(const std::string & digested);
+    static std::string addDigest(CryptoPP::HexEncoder & encoder,
+                                 const std::string & encrypted);
 
-    std::string byteToStr(byte * encode, size_t size);
+    static std::string removeDigest(const std::string & digested);
 
-    std::string hexEncode(const std::string & decoded);
+    static std::string hexEncode(CryptoPP::HexEncoder & encoder,
+                                 const std::string & decoded);
 
-    std::string hexDecode(const std::string & encoded);
+    static std::string hexDecode(CryptoPP::HexDecoder & decoder,
+                                 const std::string & encoded);
 };
 
 } // namespace Datacratic
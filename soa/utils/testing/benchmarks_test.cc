@@ -0,0 +1,85 @@
+/* benchmarks_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the benchmark harness.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "soa/utils/benchmarks.h"
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_result_stats )
+{
+    BenchmarkResult result;
+    for (int i = 100;  i >= 1;  --i)
+        result.samples.push_back(i);
+    result.computeStats();
+
+    BOOST_CHECK_EQUAL(result.min, 1);
+    BOOST_CHECK_CLOSE(result.median, 50.5, 1e-9);
+    BOOST_CHECK_CLOSE(result.p90, 90.1, 1e-9);
+    BOOST_CHECK_CLOSE(result.p99, 99.01, 1e-9);
+    BOOST_CHECK_CLOSE(result.mean, 50.5, 1e-9);
+
+    // A couple of wild samples don't make the median look any less known,
+    // even though they blow up the standard deviation
+    BenchmarkResult steady;
+    for (int i = 0;  i < 50;  ++i)
+        steady.samples.push_back(100 + i % 2);
+    steady.samples.push_back(10000);
+    steady.samples.push_back(20000);
+    steady.computeStats();
+    BOOST_CHECK_GT(steady.stddev / steady.mean, 1.0);
+    BOOST_CHECK_LT(steady.medianError(), 0.01);
+}
+
+BOOST_AUTO_TEST_CASE( test_run_and_compare )
+{
+    BenchmarkRunner runner;
+    runner.warmupTime = 0.01;
+    runner.sampleTime = 0.001;
+    runner.maxTime = 0.5;
+
+    uint64_t sum = 0;
+    auto fast = runner.run("fast", [&] () { doNotOptimize(sum += 1); });
+    BOOST_REQUIRE(fast);
+    BOOST_CHECK_GE(fast->samples.size(), runner.minSamples);
+    BOOST_CHECK_GT(fast->iterations, 1);
+    BOOST_CHECK_GT(fast->median, 0);
+
+    runner.filter = "slow";
+    BOOST_CHECK(!runner.run("fast", [] () {}));
+    BOOST_CHECK_EQUAL(runner.results.size(), 1);
+
+    // Going through JSON gives back the same numbers
+    Json::Value json = runner.toJson();
+    auto parsed = BenchmarkResult::fromJson(json["benchmarks"][0]);
+    BOOST_CHECK_EQUAL(parsed.name, "fast");
+    BOOST_CHECK_EQUAL(parsed.samples.size(), fast->samples.size());
+    BOOST_CHECK_CLOSE(parsed.median, fast->median, 1e-6);
+
+    // A baseline twice as fast makes it a regression; half as fast doesn't
+    auto scaled = [&] (double factor) {
+        Json::Value result = json;
+        for (auto & sample: result["benchmarks"][0]["samples"])
+            sample = sample.asDouble() * factor;
+        return result;
+    };
+
+    ostringstream out;
+    auto regressions = runner.compare(scaled(0.5), 0.1, out);
+    BOOST_REQUIRE_EQUAL(regressions.size(), 1);
+    BOOST_CHECK_EQUAL(regressions[0], "fast");
+
+    BOOST_CHECK(runner.compare(scaled(2.0), 0.1, out).empty());
+    BOOST_CHECK(runner.compare(json, 0.1, out).empty());
+}
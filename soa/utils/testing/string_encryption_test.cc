@@ -0,0 +1,121 @@
+/* string_encryption_test.cc
+   15 October 2026
+   Copyright (c) 2026 Datacratic.  All rights reserved.
+
+   Tests for the passback encryption
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "soa/utils/string_encryption.h"
+#include "soa/types/date.h"
+
+#include <boost/test/unit_test.hpp>
+#include <functional>
+#include <thread>
+#include <iostream>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace {
+
+const string Key = "9B3A5BC8A1E7D0F2C46E11A2B3C4D5";
+const string IV = "0F1E2D3C4B5A69788796A5B4C3D2E1";
+
+const vector<string> Passbacks = {
+    "", "a", "campaign=1234&creative=5678",
+    string(1000, 'x'), "\xc3\xa9t\xc3\xa9"
+};
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( keyed_same_as_per_call )
+{
+    StringEncryption perCall;
+    StringEncryption keyed(Key, IV);
+
+    for (auto & passback: Passbacks) {
+        string encrypted = perCall.encrypt(passback, Key, IV);
+        BOOST_CHECK_EQUAL(keyed.encrypt(passback), encrypted);
+
+        // Twice, to check that the iv is reset between calls
+        BOOST_CHECK_EQUAL(keyed.encrypt(passback), encrypted);
+
+        if (passback.empty())
+            continue;
+        BOOST_CHECK_EQUAL(keyed.decrypt(encrypted), passback);
+        BOOST_CHECK_EQUAL(keyed.decrypt(encrypted), passback);
+        BOOST_CHECK_EQUAL(perCall.decrypt(keyed.encrypt(passback), Key, IV),
+                          passback);
+    }
+
+    // A passback that doesn't match its digest decrypts to nothing
+    string tampered = keyed.encrypt("campaign=1234");
+    tampered[0] = tampered[0] == 'A' ? 'B' : 'A';
+    BOOST_CHECK_EQUAL(keyed.decrypt(tampered), "");
+    BOOST_CHECK_EQUAL(perCall.decrypt(tampered, Key, IV), "");
+
+    BOOST_CHECK_THROW(StringEncryption("short", IV), std::exception);
+    BOOST_CHECK_THROW(StringEncryption(Key, "short"), std::exception);
+    BOOST_CHECK_THROW(perCall.encrypt("abc"), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE( batch_and_threads )
+{
+    StringEncryption keyed(Key, IV);
+
+    vector<string> encrypted;
+    for (unsigned i = 0;  i < 100;  ++i)
+        encrypted.push_back(keyed.encrypt("passback " + to_string(i)));
+    encrypted.push_back("00");
+
+    // Each thread decrypts with its own contexts
+    auto check = [&] () {
+        auto decrypted = keyed.decrypt(encrypted);
+        BOOST_REQUIRE_EQUAL(decrypted.size(), encrypted.size());
+        for (unsigned i = 0;  i < 100;  ++i)
+            BOOST_CHECK_EQUAL(decrypted[i], "passback " + to_string(i));
+        BOOST_CHECK_EQUAL(decrypted.back(), "");
+    };
+
+    std::thread t1(check), t2(check);
+    check();
+    t1.join();
+    t2.join();
+}
+
+BOOST_AUTO_TEST_CASE( benchmark_decryption )
+{
+    cerr << "benchmarking passback decryption" << endl;
+
+    StringEncryption perCall;
+    StringEncryption keyed(Key, IV);
+
+    vector<string> encrypted;
+    for (unsigned i = 0;  i < 100000;  ++i)
+        encrypted.push_back(keyed.encrypt("campaign=" + to_string(i)
+                                          + "&creative=5678"));
+
+    auto run = [&] (const string & name, std::function<void ()> decrypt) {
+        Date before = Date::now();
+        decrypt();
+        double elapsed = Date::now().secondsSince(before);
+
+        cerr << name << ": did " << encrypted.size() << " in " << elapsed
+             << "s at " << encrypted.size() / elapsed << "/s" << endl;
+    };
+
+    run("per call", [&] () {
+            for (auto & passback: encrypted)
+                perCall.decrypt(passback, Key, IV);
+        });
+
+    run("keyed", [&] () {
+            for (auto & passback: encrypted)
+                keyed.decrypt(passback);
+        });
+
+    run("batch", [&] () { keyed.decrypt(encrypted); });
+}
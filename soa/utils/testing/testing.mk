@@ -7,8 +7,10 @@
 #------------------------------------------------------------------------------#
 
 $(eval $(call test,fixture_test,test_utils,boost))
+$(eval $(call test,benchmarks_test,test_utils,boost))
 $(eval $(call test,print_utils_test,,boost))
 $(eval $(call test,variadic_hash_test,variadic_hash,boost))
 $(eval $(call test,fnv_hash_test,,boost))
 $(eval $(call test,type_traits_test,,boost))
 $(eval $(call test,scope_test,arch,boost))
+$(eval $(call test,string_encryption_test,string_encryption types,boost))
@@ -12,12 +12,12 @@ LIB_TEST_UTILS_SOURCES := \
         threaded_test.cc
 
 LIB_TEST_UTILS_LINK := \
-	arch utils boost_filesystem boost_thread
+	arch utils jsoncpp boost_filesystem boost_thread
 
 $(eval $(call library,test_utils,$(LIB_TEST_UTILS_SOURCES),$(LIB_TEST_UTILS_LINK)))
 
 $(eval $(call library,variadic_hash,variadic_hash.cc,cityhash))
-$(eval $(call library,string_encryption,string_encryption.cc,crypto++))
+$(eval $(call library,string_encryption,string_encryption.cc,crypto++ arch boost_thread))
 $(eval $(call program,string_encryption_keygen,string_encryption))
 
 ifeq ($(PYTHON_ENABLED),1)